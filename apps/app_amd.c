@@ -257,9 +257,14 @@ static void isAnsweringMachine(struct ast_channel *chan, const char *data)
 				initialSilence, greeting, afterGreetingSilence, totalAnalysisTime,
 				minimumWordLength, betweenWordsSilence, maximumNumberOfWords, silenceThreshold, maximumWordLength);
 
-	/* Set read format to signed linear so we get signed linear frames in */
+	/* Set read format to signed linear so we get signed linear frames in.
+	 * The silence detector reads ulaw and alaw as they are, so frames in
+	 * those need not be translated. */
 	readFormat = ao2_bump(ast_channel_readformat(chan));
-	if (ast_set_read_format(chan, ast_format_slin) < 0 ) {
+	if (ast_format_cmp(readFormat, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL
+		|| ast_format_cmp(readFormat, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) {
+		ao2_replace(readFormat, NULL);
+	} else if (ast_set_read_format(chan, ast_format_slin) < 0 ) {
 		ast_log(LOG_WARNING, "AMD: Channel [%s]. Unable to set to linear mode, giving up\n", ast_channel_name(chan));
 		pbx_builtin_setvar_helper(chan , "AMDSTATUS", "");
 		pbx_builtin_setvar_helper(chan , "AMDCAUSE", "");
@@ -56,8 +56,12 @@
 #include "asterisk/stasis_channels.h"
 #include "asterisk/json.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/linkedlists.h"
 
 #define AST_NAME_STRLEN 256
+
+/*! Frames queued for a spy sharing a tap before the oldest are dropped */
+#define SPY_TAP_QUEUE_MAX 10
 #define NUM_SPYGROUPS 128
 
 /*** DOCUMENTATION
@@ -429,9 +433,42 @@ AST_APP_OPTIONS(spy_opts, {
 	AST_APP_OPTION('X', OPTION_EXIT),
 });
 
+struct chanspy_tap_spy;
+
+/*!
+ * \brief A spy audiohook on a channel shared by the spies listening to it the same way
+ *
+ * The audio of the channel is mixed once for all the spies of the tap.
+ * Whichever spy runs out of audio first reads the next frame from the
+ * audiohook and queues a copy of it for each of the others.
+ */
+struct chanspy_tap {
+	struct ast_audiohook audiohook;
+	/*! The spies listening, protected by the audiohook lock */
+	AST_LIST_HEAD_NOLOCK(, chanspy_tap_spy) spies;
+	/*! Whether only the audio read from the channel is heard */
+	int readonly;
+	/*! Whether the audiohook uses a long queue */
+	int long_queue;
+	int volfactor;
+	char uniqueid[AST_MAX_UNIQUEID];
+};
+
+/*! \brief A spy listening to a tap */
+struct chanspy_tap_spy {
+	struct chanspy_tap *tap;
+	/*! Frames read by other spies not yet heard by this one */
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+	unsigned int queued;
+	AST_LIST_ENTRY(chanspy_tap_spy) list;
+};
+
+/*! The taps of every spied upon channel */
+static struct ao2_container *spy_taps;
+
 struct chanspy_translation_helper {
 	/* spy data */
-	struct ast_audiohook spy_audiohook;
+	struct chanspy_tap_spy *spy;
 	struct ast_audiohook whisper_audiohook;
 	struct ast_audiohook bridge_whisper_audiohook;
 	int fd;
@@ -456,26 +493,67 @@ static void spy_release(struct ast_channel *chan, void *data)
 	/* nothing to do */
 }
 
+/*!
+ * \internal
+ * \brief Queue a copy of the frames read by a spy for the other spies of its tap
+ * \note The audiohook of the tap must be locked.
+ */
+static void spy_tap_share(struct chanspy_tap_spy *reader, struct ast_frame *f)
+{
+	struct chanspy_tap_spy *spy;
+	struct ast_frame *cur;
+	struct ast_frame *dup;
+
+	AST_LIST_TRAVERSE(&reader->tap->spies, spy, list) {
+		if (spy == reader) {
+			continue;
+		}
+		for (cur = f; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			if (spy->queued >= SPY_TAP_QUEUE_MAX) {
+				/* The spy is not keeping up, so it loses the oldest audio */
+				ast_frfree(AST_LIST_REMOVE_HEAD(&spy->frames, frame_list));
+				spy->queued--;
+			}
+			dup = ast_frdup(cur);
+			if (!dup) {
+				break;
+			}
+			AST_LIST_INSERT_TAIL(&spy->frames, dup, frame_list);
+			spy->queued++;
+		}
+	}
+}
+
 static int spy_generate(struct ast_channel *chan, void *data, int len, int samples)
 {
 	struct chanspy_translation_helper *csth = data;
+	struct chanspy_tap_spy *spy = csth->spy;
+	struct chanspy_tap *tap = spy->tap;
 	struct ast_frame *f, *cur;
 
-	ast_audiohook_lock(&csth->spy_audiohook);
-	if (csth->spy_audiohook.status != AST_AUDIOHOOK_STATUS_RUNNING) {
+	ast_audiohook_lock(&tap->audiohook);
+	if (tap->audiohook.status != AST_AUDIOHOOK_STATUS_RUNNING) {
 		/* Channel is already gone more than likely */
-		ast_audiohook_unlock(&csth->spy_audiohook);
+		ast_audiohook_unlock(&tap->audiohook);
 		return -1;
 	}
 
-	if (ast_test_flag(&csth->flags, OPTION_READONLY)) {
-		/* Option 'o' was set, so don't mix channel audio */
-		f = ast_audiohook_read_frame(&csth->spy_audiohook, samples, AST_AUDIOHOOK_DIRECTION_READ, ast_format_slin);
+	f = AST_LIST_REMOVE_HEAD(&spy->frames, frame_list);
+	if (f) {
+		spy->queued--;
 	} else {
-		f = ast_audiohook_read_frame(&csth->spy_audiohook, samples, AST_AUDIOHOOK_DIRECTION_BOTH, ast_format_slin);
+		if (tap->readonly) {
+			/* Option 'o' was set, so don't mix channel audio */
+			f = ast_audiohook_read_frame(&tap->audiohook, samples, AST_AUDIOHOOK_DIRECTION_READ, ast_format_slin);
+		} else {
+			f = ast_audiohook_read_frame(&tap->audiohook, samples, AST_AUDIOHOOK_DIRECTION_BOTH, ast_format_slin);
+		}
+		if (f) {
+			spy_tap_share(spy, f);
+		}
 	}
 
-	ast_audiohook_unlock(&csth->spy_audiohook);
+	ast_audiohook_unlock(&tap->audiohook);
 
 	if (!f)
 		return 0;
@@ -527,6 +605,140 @@ static int start_spying(struct ast_autochan *autochan, const char *spychan_name,
 	return res;
 }
 
+static void spy_tap_destructor(void *obj)
+{
+	struct chanspy_tap *tap = obj;
+
+	ast_audiohook_lock(&tap->audiohook);
+	ast_audiohook_detach(&tap->audiohook);
+	ast_audiohook_unlock(&tap->audiohook);
+	ast_audiohook_destroy(&tap->audiohook);
+}
+
+struct spy_tap_search {
+	const char *uniqueid;
+	int readonly;
+	int long_queue;
+	int volfactor;
+};
+
+static int spy_tap_match(void *obj, void *arg, int flags)
+{
+	struct chanspy_tap *tap = obj;
+	struct spy_tap_search *search = arg;
+
+	if (tap->audiohook.status != AST_AUDIOHOOK_STATUS_RUNNING
+		|| tap->readonly != search->readonly
+		|| tap->long_queue != search->long_queue
+		|| tap->volfactor != search->volfactor
+		|| strcmp(tap->uniqueid, search->uniqueid)) {
+		return 0;
+	}
+
+	return CMP_MATCH | CMP_STOP;
+}
+
+/*!
+ * \internal
+ * \brief Start listening to a channel, sharing the tap of spies already listening the same way
+ *
+ * \retval NULL if the channel could not be spied upon
+ * \return The spy, to be stopped with spy_tap_leave()
+ */
+static struct chanspy_tap_spy *spy_tap_join(struct ast_autochan *autochan, const char *spychan_name,
+	struct ast_flags *flags, int volfactor)
+{
+	struct spy_tap_search search;
+	struct chanspy_tap *tap;
+	struct chanspy_tap_spy *spy;
+	char uniqueid[AST_MAX_UNIQUEID];
+
+	spy = ast_calloc(1, sizeof(*spy));
+	if (!spy) {
+		return NULL;
+	}
+
+	ast_autochan_channel_lock(autochan);
+	ast_copy_string(uniqueid, ast_channel_uniqueid(autochan->chan), sizeof(uniqueid));
+	ast_autochan_channel_unlock(autochan);
+
+	search.uniqueid = uniqueid;
+	search.readonly = ast_test_flag(flags, OPTION_READONLY) ? 1 : 0;
+	search.long_queue = ast_test_flag(flags, OPTION_LONG_QUEUE) ? 1 : 0;
+	search.volfactor = volfactor;
+
+	ao2_lock(spy_taps);
+	tap = ao2_callback(spy_taps, OBJ_NOLOCK, spy_tap_match, &search);
+	if (tap) {
+		ast_verb(3, "Spy channel %s shares the audio of %s with other spies\n",
+			spychan_name, uniqueid);
+	} else {
+		tap = ao2_alloc_options(sizeof(*tap), spy_tap_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!tap) {
+			ao2_unlock(spy_taps);
+			ast_free(spy);
+			return NULL;
+		}
+
+		/* This is the audiohook which gives us the audio off the channel we are
+		   spying on.
+		*/
+		ast_audiohook_init(&tap->audiohook, AST_AUDIOHOOK_TYPE_SPY, "ChanSpy", 0);
+		ast_copy_string(tap->uniqueid, uniqueid, sizeof(tap->uniqueid));
+		tap->readonly = search.readonly;
+		tap->long_queue = search.long_queue;
+		tap->volfactor = volfactor;
+		if (volfactor) {
+			tap->audiohook.options.read_volume = volfactor;
+			tap->audiohook.options.write_volume = volfactor;
+		}
+
+		if (start_spying(autochan, spychan_name, &tap->audiohook, flags)) {
+			ao2_unlock(spy_taps);
+			ao2_ref(tap, -1);
+			ast_free(spy);
+			return NULL;
+		}
+		ao2_link_flags(spy_taps, tap, OBJ_NOLOCK);
+	}
+
+	/* The spy takes the reference of the tap */
+	spy->tap = tap;
+	ast_audiohook_lock(&tap->audiohook);
+	AST_LIST_INSERT_TAIL(&tap->spies, spy, list);
+	ast_audiohook_unlock(&tap->audiohook);
+	ao2_unlock(spy_taps);
+
+	return spy;
+}
+
+/*!
+ * \internal
+ * \brief Stop listening to a tap, removing the tap when it was the last spy
+ */
+static void spy_tap_leave(struct chanspy_tap_spy *spy)
+{
+	struct chanspy_tap *tap = spy->tap;
+	struct ast_frame *f;
+
+	ao2_lock(spy_taps);
+	ast_audiohook_lock(&tap->audiohook);
+	AST_LIST_REMOVE(&tap->spies, spy, list);
+	if (AST_LIST_EMPTY(&tap->spies)) {
+		ao2_unlink_flags(spy_taps, tap, OBJ_NOLOCK);
+	}
+	ast_audiohook_unlock(&tap->audiohook);
+	ao2_unlock(spy_taps);
+
+	while ((f = AST_LIST_REMOVE_HEAD(&spy->frames, frame_list))) {
+		ast_frfree(f);
+	}
+	ast_free(spy);
+
+	/* The audiohook is detached once the last spy is done with the tap */
+	ao2_ref(tap, -1);
+}
+
 static void change_spy_mode(const char digit, struct ast_flags *flags)
 {
 	if (digit == '4') {
@@ -673,13 +885,10 @@ static int channel_spy(struct ast_channel *chan, struct ast_autochan *spyee_auto
 	memset(&csth, 0, sizeof(csth));
 	ast_copy_flags(&csth.flags, flags, AST_FLAGS_ALL);
 
-	/* This is the audiohook which gives us the audio off the channel we are
-	   spying on.
-	*/
-	ast_audiohook_init(&csth.spy_audiohook, AST_AUDIOHOOK_TYPE_SPY, "ChanSpy", 0);
+	csth.volfactor = *volfactor;
 
-	if (start_spying(spyee_autochan, spyer_name, &csth.spy_audiohook, flags)) {
-		ast_audiohook_destroy(&csth.spy_audiohook);
+	csth.spy = spy_tap_join(spyee_autochan, spyer_name, flags, csth.volfactor);
+	if (!csth.spy) {
 		return 0;
 	}
 
@@ -696,13 +905,6 @@ static int channel_spy(struct ast_channel *chan, struct ast_autochan *spyee_auto
 
 	ast_channel_set_flag(chan, AST_FLAG_END_DTMF_ONLY);
 
-	csth.volfactor = *volfactor;
-
-	if (csth.volfactor) {
-		csth.spy_audiohook.options.read_volume = csth.volfactor;
-		csth.spy_audiohook.options.write_volume = csth.volfactor;
-	}
-
 	csth.fd = fd;
 
 	if (ast_test_flag(flags, OPTION_PRIVATE))
@@ -724,7 +926,7 @@ static int channel_spy(struct ast_channel *chan, struct ast_autochan *spyee_auto
 	   has arrived, since the spied-on channel could have gone away while
 	   we were waiting
 	*/
-	while (ast_waitfor(chan, -1) > -1 && csth.spy_audiohook.status == AST_AUDIOHOOK_STATUS_RUNNING) {
+	while (ast_waitfor(chan, -1) > -1 && csth.spy->tap->audiohook.status == AST_AUDIOHOOK_STATUS_RUNNING) {
 		if (!(f = ast_read(chan)) || ast_check_hangup(chan)) {
 			running = -1;
 			if (f) {
@@ -814,8 +1016,20 @@ static int channel_spy(struct ast_channel *chan, struct ast_autochan *spyee_auto
 			ast_verb(3, "Setting spy volume on %s to %d\n", ast_channel_name(chan), *volfactor);
 
 			csth.volfactor = *volfactor;
-			csth.spy_audiohook.options.read_volume = csth.volfactor;
-			csth.spy_audiohook.options.write_volume = csth.volfactor;
+
+			/* The volume is set on the audiohook, so move to a tap with the new volume. */
+			if (!ast_test_flag(flags, OPTION_PRIVATE)) {
+				ast_deactivate_generator(chan);
+			}
+			spy_tap_leave(csth.spy);
+			csth.spy = spy_tap_join(spyee_autochan, spyer_name, flags, csth.volfactor);
+			if (!csth.spy) {
+				running = 0;
+				break;
+			}
+			if (!ast_test_flag(flags, OPTION_PRIVATE)) {
+				ast_activate_generator(chan, &spygen, &csth);
+			}
 		}
 	}
 
@@ -840,10 +1054,9 @@ static int channel_spy(struct ast_channel *chan, struct ast_autochan *spyee_auto
 		ast_audiohook_destroy(&csth.bridge_whisper_audiohook);
 	}
 
-	ast_audiohook_lock(&csth.spy_audiohook);
-	ast_audiohook_detach(&csth.spy_audiohook);
-	ast_audiohook_unlock(&csth.spy_audiohook);
-	ast_audiohook_destroy(&csth.spy_audiohook);
+	if (csth.spy) {
+		spy_tap_leave(csth.spy);
+	}
 
 	if (spyee_bridge_autochan) {
 		ast_autochan_destroy(spyee_bridge_autochan);
@@ -1487,6 +1700,9 @@ static int unload_module(void)
 	res |= ast_unregister_application(app_ext);
 	res |= ast_unregister_application(app_dahdiscan);
 
+	ao2_cleanup(spy_taps);
+	spy_taps = NULL;
+
 	return res;
 }
 
@@ -1494,6 +1710,11 @@ static int load_module(void)
 {
 	int res = 0;
 
+	spy_taps = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+	if (!spy_taps) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	res |= ast_register_application_xml(app_chan, chanspy_exec);
 	res |= ast_register_application_xml(app_ext, extenspy_exec);
 	res |= ast_register_application_xml(app_dahdiscan, dahdiscan_exec);
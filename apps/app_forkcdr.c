@@ -135,7 +135,6 @@ static int forkcdr_exec(struct ast_channel *chan, const char *data)
 {
 	RAII_VAR(struct stasis_message *, message, NULL, ao2_cleanup);
 	RAII_VAR(struct fork_cdr_message_payload *, payload, NULL, ao2_cleanup);
-	RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
 
 	char *parse;
 	struct ast_flags flags = { 0, };
@@ -162,12 +161,6 @@ static int forkcdr_exec(struct ast_channel *chan, const char *data)
 		return -1;
 	}
 
-	if (!router) {
-		ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
-			ast_channel_name(chan));
-		return -1;
-	}
-
 	payload->channel_name = ast_channel_name(chan);
 	payload->flags = &flags;
 	message = stasis_message_create(forkcdr_message_type(), payload);
@@ -176,18 +169,18 @@ static int forkcdr_exec(struct ast_channel *chan, const char *data)
 			ast_channel_name(chan));
 		return -1;
 	}
-	stasis_message_router_publish_sync(router, message);
+	if (ast_cdr_message_publish_sync(chan, message)) {
+		ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
+			ast_channel_name(chan));
+		return -1;
+	}
 
 	return 0;
 }
 
 static int unload_module(void)
 {
-	RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
-
-	if (router) {
-		stasis_message_router_remove(router, forkcdr_message_type());
-	}
+	ast_cdr_message_router_remove(forkcdr_message_type());
 	STASIS_MESSAGE_TYPE_CLEANUP(forkcdr_message_type);
 	ast_unregister_application(app);
 	return 0;
@@ -195,17 +188,12 @@ static int unload_module(void)
 
 static int load_module(void)
 {
-	RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
 	int res = 0;
 
-	if (!router) {
-		return AST_MODULE_LOAD_DECLINE;
-	}
-
 	res |= STASIS_MESSAGE_TYPE_INIT(forkcdr_message_type);
 	res |= ast_register_application_xml(app, forkcdr_exec);
-	res |= stasis_message_router_add(router, forkcdr_message_type(),
-	                                 forkcdr_callback, NULL);
+	res |= ast_cdr_message_router_add(forkcdr_message_type(),
+	                                  forkcdr_callback, NULL);
 
 	if (res) {
 		unload_module();
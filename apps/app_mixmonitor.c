@@ -58,6 +58,7 @@
 #include "asterisk/mixmonitor.h"
 #include "asterisk/format_cache.h"
 #include "asterisk/beep.h"
+#include "asterisk/threadpool.h"
 
 /*** DOCUMENTATION
 	<application name="MixMonitor" language="en_US">
@@ -120,6 +121,14 @@
 						option, inserts silence when necessary to maintain synchronization between the receive
 						and transmit audio streams.</para>
 					</option>
+					<option name="D">
+						<para>Record the <emphasis>receive</emphasis> and <emphasis>transmit</emphasis>
+						audio feeds as the left and right channels of a single stereo file, rather than
+						mixing them. The file must use a signed linear format such as <literal>sln</literal>
+						or <literal>sln16</literal>, as the interleaved audio is stored without being
+						translated. The <replaceable>r</replaceable> and <replaceable>t</replaceable>
+						options are ignored.</para>
+					</option>
 					<option name="i">
 						<argument name="chanvar" required="true" />
 						<para>Stores the MixMonitor's ID on this channel variable.</para>
@@ -354,6 +363,7 @@ enum mixmonitor_flags {
 	MUXFLAG_BEEP_START = (1 << 12),
 	MUXFLAG_BEEP_STOP = (1 << 13),
 	MUXFLAG_RWSYNC = (1 << 14),
+	MUXFLAG_INTERLEAVED = (1 << 15),
 };
 
 enum mixmonitor_args {
@@ -372,6 +382,7 @@ enum mixmonitor_args {
 AST_APP_OPTIONS(mixmonitor_opts, {
 	AST_APP_OPTION('a', MUXFLAG_APPEND),
 	AST_APP_OPTION('b', MUXFLAG_BRIDGED),
+	AST_APP_OPTION('D', MUXFLAG_INTERLEAVED),
 	AST_APP_OPTION_ARG('B', MUXFLAG_BEEP, OPT_ARG_BEEP_INTERVAL),
 	AST_APP_OPTION('p', MUXFLAG_BEEP_START),
 	AST_APP_OPTION('P', MUXFLAG_BEEP_STOP),
@@ -385,6 +396,20 @@ AST_APP_OPTIONS(mixmonitor_opts, {
 	AST_APP_OPTION_ARG('S', MUXFLAG_RWSYNC, OPT_ARG_RWSYNC),
 });
 
+/*! Frames of a recording queued before more are dropped, 5 seconds of 20ms frames */
+#define MIXMONITOR_MAX_QUEUED 250
+
+/*! \brief The frames mixed at once, queued for the writer pool */
+struct mixmonitor_frames {
+	struct ast_frame *fr;
+	struct ast_frame *fr_read;
+	struct ast_frame *fr_write;
+	AST_LIST_ENTRY(mixmonitor_frames) list;
+};
+
+/*! \brief Writes the frames of all the recordings, so disk latency does not stall the mixing */
+static struct ast_threadpool *writer_pool;
+
 struct mixmonitor_ds {
 	unsigned int destruction_ok;
 	ast_cond_t destruction_condition;
@@ -403,8 +428,158 @@ struct mixmonitor_ds {
 	unsigned int samp_rate;
 	char *filename;
 	char *beep_id;
+
+	/*! Held while frames are written to the filestreams */
+	ast_mutex_t writer_lock;
+	/*! Protects the queue and its statistics, taken after writer_lock */
+	ast_mutex_t queue_lock;
+	/*! Signaled once no task of the writer pool is writing the queue */
+	ast_cond_t queue_cond;
+	AST_LIST_HEAD_NOLOCK(, mixmonitor_frames) queue;
+	/*! Whether a task of the writer pool is writing the queue */
+	unsigned int writing;
+	/*! Frames queued */
+	unsigned int queued;
+	/*! Most frames queued at once */
+	unsigned int max_queued;
+	/*! Frames dropped since the queue was full */
+	unsigned int dropped;
 };
 
+static void mixmonitor_frames_free(struct mixmonitor_frames *frames)
+{
+	if (frames->fr) {
+		ast_frame_free(frames->fr, 0);
+	}
+	if (frames->fr_read) {
+		ast_frame_free(frames->fr_read, 0);
+	}
+	if (frames->fr_write) {
+		ast_frame_free(frames->fr_write, 0);
+	}
+	ast_free(frames);
+}
+
+static void mixmonitor_writestream(struct ast_filestream *fs, struct ast_frame *fr)
+{
+	struct ast_frame *cur;
+
+	if (!fs || !fr) {
+		return;
+	}
+	for (cur = fr; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+		ast_writestream(fs, cur);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Write the frames queued to the filestreams
+ * \pre writer_lock must be locked before calling this function
+ */
+static void mixmonitor_write_queue(struct mixmonitor_ds *mixmonitor_ds)
+{
+	struct mixmonitor_frames *frames;
+
+	for (;;) {
+		ast_mutex_lock(&mixmonitor_ds->queue_lock);
+		frames = AST_LIST_REMOVE_HEAD(&mixmonitor_ds->queue, list);
+		if (frames) {
+			--mixmonitor_ds->queued;
+		}
+		ast_mutex_unlock(&mixmonitor_ds->queue_lock);
+		if (!frames) {
+			return;
+		}
+
+		mixmonitor_writestream(mixmonitor_ds->fs_read, frames->fr_read);
+		mixmonitor_writestream(mixmonitor_ds->fs_write, frames->fr_write);
+		mixmonitor_writestream(mixmonitor_ds->fs, frames->fr);
+		mixmonitor_frames_free(frames);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Task of the writer pool writing the frames queued for a recording
+ */
+static int mixmonitor_writer_task(void *data)
+{
+	struct mixmonitor_ds *mixmonitor_ds = data;
+
+	for (;;) {
+		ast_mutex_lock(&mixmonitor_ds->writer_lock);
+		mixmonitor_write_queue(mixmonitor_ds);
+		ast_mutex_unlock(&mixmonitor_ds->writer_lock);
+
+		ast_mutex_lock(&mixmonitor_ds->queue_lock);
+		if (AST_LIST_EMPTY(&mixmonitor_ds->queue)) {
+			/* The recording may be freed once this is unlocked */
+			mixmonitor_ds->writing = 0;
+			ast_cond_signal(&mixmonitor_ds->queue_cond);
+			ast_mutex_unlock(&mixmonitor_ds->queue_lock);
+			return 0;
+		}
+		ast_mutex_unlock(&mixmonitor_ds->queue_lock);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Queue the frames mixed for the writer pool, which owns them from then on
+ */
+static void mixmonitor_queue_frames(struct mixmonitor_ds *mixmonitor_ds,
+	struct ast_frame *fr, struct ast_frame *fr_read, struct ast_frame *fr_write)
+{
+	struct mixmonitor_frames *frames;
+	int write_now = 0;
+
+	frames = ast_calloc(1, sizeof(*frames));
+	if (!frames) {
+		if (fr) {
+			ast_frame_free(fr, 0);
+		}
+		if (fr_read) {
+			ast_frame_free(fr_read, 0);
+		}
+		if (fr_write) {
+			ast_frame_free(fr_write, 0);
+		}
+		return;
+	}
+	frames->fr = fr;
+	frames->fr_read = fr_read;
+	frames->fr_write = fr_write;
+
+	ast_mutex_lock(&mixmonitor_ds->queue_lock);
+	if (mixmonitor_ds->queued >= MIXMONITOR_MAX_QUEUED) {
+		/* The storage does not keep up, the oldest frames are kept */
+		if (!mixmonitor_ds->dropped++) {
+			ast_log(LOG_WARNING, "MixMonitor of '%s' is dropping audio, writing it does not keep up\n",
+				mixmonitor_ds->filename);
+		}
+		ast_mutex_unlock(&mixmonitor_ds->queue_lock);
+		mixmonitor_frames_free(frames);
+		return;
+	}
+	AST_LIST_INSERT_TAIL(&mixmonitor_ds->queue, frames, list);
+	mixmonitor_ds->max_queued = MAX(mixmonitor_ds->max_queued, ++mixmonitor_ds->queued);
+	if (!mixmonitor_ds->writing) {
+		mixmonitor_ds->writing = 1;
+		if (!writer_pool || ast_threadpool_push(writer_pool, mixmonitor_writer_task, mixmonitor_ds)) {
+			mixmonitor_ds->writing = 0;
+			write_now = 1;
+		}
+	}
+	ast_mutex_unlock(&mixmonitor_ds->queue_lock);
+
+	if (write_now) {
+		ast_mutex_lock(&mixmonitor_ds->writer_lock);
+		mixmonitor_write_queue(mixmonitor_ds);
+		ast_mutex_unlock(&mixmonitor_ds->writer_lock);
+	}
+}
+
 /*!
  * \internal
  * \pre mixmonitor_ds must be locked before calling this function
@@ -413,6 +588,10 @@ static void mixmonitor_ds_close_fs(struct mixmonitor_ds *mixmonitor_ds)
 {
 	unsigned char quitting = 0;
 
+	/* The frames queued are written before the files are closed */
+	ast_mutex_lock(&mixmonitor_ds->writer_lock);
+	mixmonitor_write_queue(mixmonitor_ds);
+
 	if (mixmonitor_ds->fs) {
 		quitting = 1;
 		ast_closestream(mixmonitor_ds->fs);
@@ -433,6 +612,7 @@ static void mixmonitor_ds_close_fs(struct mixmonitor_ds *mixmonitor_ds)
 		mixmonitor_ds->fs_write = NULL;
 		ast_verb(2, "MixMonitor close filestream (write)\n");
 	}
+	ast_mutex_unlock(&mixmonitor_ds->writer_lock);
 
 	if (quitting) {
 		mixmonitor_ds->fs_quit = 1;
@@ -550,9 +730,25 @@ static void mixmonitor_free(struct mixmonitor *mixmonitor)
 {
 	if (mixmonitor) {
 		if (mixmonitor->mixmonitor_ds) {
-			ast_mutex_destroy(&mixmonitor->mixmonitor_ds->lock);
-			ast_cond_destroy(&mixmonitor->mixmonitor_ds->destruction_condition);
-			ast_free(mixmonitor->mixmonitor_ds);
+			struct mixmonitor_ds *mixmonitor_ds = mixmonitor->mixmonitor_ds;
+			struct mixmonitor_frames *frames;
+
+			/* Wait for the writer pool to be done with the recording */
+			ast_mutex_lock(&mixmonitor_ds->queue_lock);
+			while (mixmonitor_ds->writing) {
+				ast_cond_wait(&mixmonitor_ds->queue_cond, &mixmonitor_ds->queue_lock);
+			}
+			while ((frames = AST_LIST_REMOVE_HEAD(&mixmonitor_ds->queue, list))) {
+				mixmonitor_frames_free(frames);
+			}
+			ast_mutex_unlock(&mixmonitor_ds->queue_lock);
+
+			ast_mutex_destroy(&mixmonitor_ds->writer_lock);
+			ast_mutex_destroy(&mixmonitor_ds->queue_lock);
+			ast_cond_destroy(&mixmonitor_ds->queue_cond);
+			ast_mutex_destroy(&mixmonitor_ds->lock);
+			ast_cond_destroy(&mixmonitor_ds->destruction_condition);
+			ast_free(mixmonitor_ds);
 		}
 
 		ast_free(mixmonitor->name);
@@ -679,8 +875,16 @@ static void *mixmonitor_thread(void *obj)
 
 	ast_mutex_lock(&mixmonitor->mixmonitor_ds->lock);
 	mixmonitor_save_prep(mixmonitor, mixmonitor->filename, fs, &oflags, &errflag, &fs_ext);
-	mixmonitor_save_prep(mixmonitor, mixmonitor->filename_read, fs_read, &oflags, &errflag, &fs_read_ext);
-	mixmonitor_save_prep(mixmonitor, mixmonitor->filename_write, fs_write, &oflags, &errflag, &fs_write_ext);
+	if (ast_test_flag(mixmonitor, MUXFLAG_INTERLEAVED)
+		&& (!*fs || !ast_format_cache_is_slinear((*fs)->fmt->format))) {
+		ast_log(LOG_WARNING, "MixMonitor %s can only interleave into a signed linear file, mixing instead\n",
+			mixmonitor->name);
+		ast_clear_flag(mixmonitor, MUXFLAG_INTERLEAVED);
+	}
+	if (!ast_test_flag(mixmonitor, MUXFLAG_INTERLEAVED)) {
+		mixmonitor_save_prep(mixmonitor, mixmonitor->filename_read, fs_read, &oflags, &errflag, &fs_read_ext);
+		mixmonitor_save_prep(mixmonitor, mixmonitor->filename_write, fs_write, &oflags, &errflag, &fs_write_ext);
+	}
 
 	format_slin = ast_format_cache_get_slin_by_rate(mixmonitor->mixmonitor_ds->samp_rate);
 
@@ -693,8 +897,14 @@ static void *mixmonitor_thread(void *obj)
 		struct ast_frame *fr_read = NULL;
 		struct ast_frame *fr_write = NULL;
 
-		if (!(fr = ast_audiohook_read_frame_all(&mixmonitor->audiohook, SAMPLES_PER_FRAME, format_slin,
-						&fr_read, &fr_write))) {
+		if (ast_test_flag(mixmonitor, MUXFLAG_INTERLEAVED)) {
+			/* Both directions in one frame, neither mixed nor translated */
+			fr = ast_audiohook_read_frame_interleaved(&mixmonitor->audiohook, SAMPLES_PER_FRAME, format_slin);
+		} else {
+			fr = ast_audiohook_read_frame_all(&mixmonitor->audiohook, SAMPLES_PER_FRAME, format_slin,
+				&fr_read, &fr_write);
+		}
+		if (!fr) {
 			ast_audiohook_trigger_wait(&mixmonitor->audiohook);
 
 			if (mixmonitor->audiohook.status != AST_AUDIOHOOK_STATUS_RUNNING) {
@@ -709,43 +919,19 @@ static void *mixmonitor_thread(void *obj)
 
 		if (!ast_test_flag(mixmonitor, MUXFLAG_BRIDGED)
 			|| mixmonitor_autochan_is_bridged(mixmonitor->autochan)) {
-			ast_mutex_lock(&mixmonitor->mixmonitor_ds->lock);
-
-			/* Write out the frame(s) */
-			if ((*fs_read) && (fr_read)) {
-				struct ast_frame *cur;
-
-				for (cur = fr_read; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs_read, cur);
-				}
+			/* Write out the frame(s), without waiting for the storage */
+			mixmonitor_queue_frames(mixmonitor->mixmonitor_ds, fr, fr_read, fr_write);
+		} else {
+			/* All done! free it. */
+			if (fr) {
+				ast_frame_free(fr, 0);
 			}
-
-			if ((*fs_write) && (fr_write)) {
-				struct ast_frame *cur;
-
-				for (cur = fr_write; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs_write, cur);
-				}
+			if (fr_read) {
+				ast_frame_free(fr_read, 0);
 			}
-
-			if ((*fs) && (fr)) {
-				struct ast_frame *cur;
-
-				for (cur = fr; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs, cur);
-				}
+			if (fr_write) {
+				ast_frame_free(fr_write, 0);
 			}
-			ast_mutex_unlock(&mixmonitor->mixmonitor_ds->lock);
-		}
-		/* All done! free it. */
-		if (fr) {
-			ast_frame_free(fr, 0);
-		}
-		if (fr_read) {
-			ast_frame_free(fr_read, 0);
-		}
-		if (fr_write) {
-			ast_frame_free(fr_write, 0);
 		}
 
 		fr = NULL;
@@ -827,10 +1013,16 @@ static int setup_mixmonitor_ds(struct mixmonitor *mixmonitor, struct ast_channel
 
 	ast_mutex_init(&mixmonitor_ds->lock);
 	ast_cond_init(&mixmonitor_ds->destruction_condition, NULL);
+	ast_mutex_init(&mixmonitor_ds->writer_lock);
+	ast_mutex_init(&mixmonitor_ds->queue_lock);
+	ast_cond_init(&mixmonitor_ds->queue_cond, NULL);
 
 	if (!(datastore = ast_datastore_alloc(&mixmonitor_ds_info, *datastore_id))) {
 		ast_mutex_destroy(&mixmonitor_ds->lock);
 		ast_cond_destroy(&mixmonitor_ds->destruction_condition);
+		ast_mutex_destroy(&mixmonitor_ds->writer_lock);
+		ast_mutex_destroy(&mixmonitor_ds->queue_lock);
+		ast_cond_destroy(&mixmonitor_ds->queue_cond);
 		ast_free(mixmonitor_ds);
 		return -1;
 	}
@@ -1254,7 +1446,7 @@ static char *handle_cli_mixmonitor(struct ast_cli_entry *e, int cmd, struct ast_
 	} else if (!strcasecmp(a->argv[1], "stop")){
 		stop_mixmonitor_exec(chan, (a->argc >= 4) ? a->argv[3] : "");
 	} else if (!strcasecmp(a->argv[1], "list")) {
-		ast_cli(a->fd, "MixMonitor ID\tFile\tReceive File\tTransmit File\n");
+		ast_cli(a->fd, "MixMonitor ID\tFile\tReceive File\tTransmit File\tQueued\tMax Queued\tDropped\n");
 		ast_cli(a->fd, "=========================================================================\n");
 		ast_channel_lock(chan);
 		AST_LIST_TRAVERSE(ast_channel_datastores(chan), datastore, entry) {
@@ -1273,7 +1465,10 @@ static char *handle_cli_mixmonitor(struct ast_cli_entry *e, int cmd, struct ast_
 				if (mixmonitor_ds->fs_write) {
 					filename_write = mixmonitor_ds->fs_write->filename;
 				}
-				ast_cli(a->fd, "%p\t%s\t%s\t%s\n", mixmonitor_ds, filename, filename_read, filename_write);
+				ast_mutex_lock(&mixmonitor_ds->queue_lock);
+				ast_cli(a->fd, "%p\t%s\t%s\t%s\t%u\t%u\t%u\n", mixmonitor_ds, filename, filename_read,
+					filename_write, mixmonitor_ds->queued, mixmonitor_ds->max_queued, mixmonitor_ds->dropped);
+				ast_mutex_unlock(&mixmonitor_ds->queue_lock);
 			}
 		}
 		ast_channel_unlock(chan);
@@ -1548,13 +1743,28 @@ static int unload_module(void)
 	res |= ast_custom_function_unregister(&mixmonitor_function);
 	res |= clear_mixmonitor_methods();
 
+	ast_threadpool_shutdown(writer_pool);
+	writer_pool = NULL;
+
 	return res;
 }
 
 static int load_module(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 2,
+		.max_size = 16,
+	};
 	int res;
 
+	writer_pool = ast_threadpool_create("mixmonitor-writer", NULL, &options);
+	if (!writer_pool) {
+		ast_log(LOG_WARNING, "Could not create the writer pool, recordings will be written by their own threads\n");
+	}
+
 	ast_cli_register_multiple(cli_mixmonitor, ARRAY_LEN(cli_mixmonitor));
 	res = ast_register_application_xml(app, mixmonitor_exec);
 	res |= ast_register_application_xml(stop_app, stop_mixmonitor_exec);
@@ -109,6 +109,7 @@
 #include "asterisk/mixmonitor.h"
 #include "asterisk/bridge_basic.h"
 #include "asterisk/max_forwards.h"
+#include "asterisk/heap.h"
 
 /*!
  * \par Please read before modifying this file.
@@ -1459,9 +1460,12 @@ static char *app_ql = "QueueLog" ;
 
 static char *app_qupd = "QueueUpdate";
 
-/*! \brief Persistent Members astdb family */
+/*! \brief Persistent Members astdb family, as one record per queue once written */
 static const char * const pm_family = "Queue/PersistentMembers";
 
+/*! \brief Persistent Members astdb family, with one record per member */
+static const char * const pm_member_family = "Queue/DynamicMembers";
+
 /*! \brief queues.conf [general] option */
 static int queue_persistent_members = 0;
 
@@ -1543,6 +1547,8 @@ struct callattempt {
 	struct ast_channel *chan;
 	char interface[256];			/*!< An Asterisk dial string (not a channel name) */
 	int metric;
+	/*! Order of the member in the queue, breaking ties between equal metrics */
+	int pos;
 	time_t lastcall;
 	struct call_queue *lastqueue;
 	struct member *member;
@@ -1585,6 +1591,8 @@ struct queue_ent {
 	int raise_penalty;                     /*!< Float lower penalty mambers to a minimum penalty */
 	int linpos;                            /*!< If using linear strategy, what position are we at? */
 	int linwrapped;                        /*!< Is the linpos wrapped? */
+	struct ast_heap *ring_order;           /*!< Call attempts of the current try, best metric on top */
+	int64_t decision_usec;                 /*!< Time spent calculating metrics and picking members this try */
 	time_t start;                          /*!< When we started holding */
 	time_t expire;                         /*!< When this entry should expire (time out of queue) */
 	int cancel_answered_elsewhere;         /*!< Whether we should force the CAE flag on this call (C) option*/
@@ -1716,6 +1724,7 @@ struct call_queue {
 	int strategy:4;
 	unsigned int realtime:1;
 	unsigned int found:1;
+	unsigned int members_restored:1;    /*!< Whether the persistent members were read from the astdb */
 	unsigned int relativeperiodicannounce:1;
 	unsigned int autopausebusy:1;
 	unsigned int autopauseunavail:1;
@@ -1733,6 +1742,9 @@ struct call_queue {
 	int callscompleted;                 /*!< Number of queue calls completed */
 	int callsabandoned;                 /*!< Number of queue calls abandoned */
 	int callsabandonedinsl;             /*!< Number of queue calls abandoned in servicelevel */
+	int decisions;                      /*!< Number of tries the strategy picked members for */
+	int64_t decision_usec;              /*!< Total time the strategy took picking members, in microseconds */
+	int64_t decision_max_usec;          /*!< Longest time the strategy took for a single try */
 	int servicelevel;                   /*!< seconds setting for servicelevel*/
 	int callscompletedinsl;             /*!< Number of calls answered with servicelevel*/
 	char monfmt[8];                     /*!< Format to use when recording calls */
@@ -2434,6 +2446,139 @@ static void pending_members_remove(struct member *mem)
 	ao2_find(pending_members, mem, OBJ_POINTER | OBJ_NODATA | OBJ_UNLINK);
 }
 
+/*!
+ * \brief Index of the members of every queue by the device they read their state from
+ *
+ * State changes of a device only visit the queues the device is a member of
+ * instead of every member of every queue.
+ */
+static struct ao2_container *member_devices;
+#define MAX_MEMBER_DEVICE_BUCKETS 563
+#define MEMBER_DEVICE_NAME_LEN (AST_CHANNEL_NAME + AST_MAX_EXTENSION + AST_MAX_CONTEXT + 6)
+
+struct member_device {
+	/*! The member, a reference is held */
+	struct member *member;
+	/*! See member_device_name() */
+	char *device;
+	/*! Name of the queue the member is in */
+	char queue[0];
+};
+
+static int member_device_hash(const void *obj, const int flags)
+{
+	const struct member_device *object;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		object = obj;
+		key = object->device;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_case_hash(key);
+}
+
+static int member_device_cmp(void *obj, void *arg, int flags)
+{
+	const struct member_device *object_left = obj;
+	const struct member_device *object_right = arg;
+	const char *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->device;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		return strcasecmp(object_left->device, right_key) ? 0 : CMP_MATCH;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		/* Not supported by container. */
+		ast_assert(0);
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+static void member_device_destructor(void *obj)
+{
+	struct member_device *entry = obj;
+
+	ao2_cleanup(entry->member);
+}
+
+/*!
+ * \internal
+ * \brief Get the name a member is found by in the index
+ *
+ * This is the device its state is read from, as published by device state
+ * with any Local channel reduced to exten@context, or the hint used.
+ */
+static void member_device_name(const struct member *mem, char *buf, size_t size)
+{
+	char *slash_pos;
+
+	if (!ast_strlen_zero(mem->state_exten)) {
+		snprintf(buf, size, "hint:%s@%s", mem->state_exten, mem->state_context);
+		return;
+	}
+
+	ast_copy_string(buf, mem->state_interface, size);
+	if (!strncasecmp(buf, "Local/", 6) && (slash_pos = strchr(buf + 6, '/'))) {
+		*slash_pos = '\0';
+	}
+}
+
+/*! \brief Add a member of a queue to the index */
+static void member_device_link(struct call_queue *q, struct member *mem)
+{
+	struct member_device *entry;
+	char device[MEMBER_DEVICE_NAME_LEN];
+	size_t queue_len = strlen(q->name) + 1;
+
+	member_device_name(mem, device, sizeof(device));
+	entry = ao2_alloc_options(sizeof(*entry) + queue_len + strlen(device) + 1,
+		member_device_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->queue, q->name); /* Safe */
+	entry->device = entry->queue + queue_len;
+	strcpy(entry->device, device); /* Safe */
+	ao2_ref(mem, +1);
+	entry->member = mem;
+
+	ao2_link(member_devices, entry);
+	ao2_ref(entry, -1);
+}
+
+static int member_device_is_member(void *obj, void *arg, void *data, int flags)
+{
+	struct member_device *entry = obj;
+
+	return entry->member == data ? CMP_MATCH | CMP_STOP : 0;
+}
+
+/*! \brief Remove a member of a queue from the index */
+static void member_device_unlink(struct member *mem)
+{
+	char device[MEMBER_DEVICE_NAME_LEN];
+
+	if (!member_devices) {
+		return;
+	}
+
+	member_device_name(mem, device, sizeof(device));
+	ao2_callback_data(member_devices, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA,
+		member_device_is_member, device, mem);
+}
+
 /*! \brief set a member's status based on device state of that member's state_interface.
  *
  * Lock interface list find sc, iterate through each queues queue_member list for member to
@@ -2504,17 +2649,49 @@ static int is_member_available(struct call_queue *q, struct member *mem)
 	return available;
 }
 
+/*!
+ * \internal
+ * \brief Find the queue of an index entry, locked
+ *
+ * \retval NULL if the member is no longer in the queue
+ */
+static struct call_queue *member_device_queue_lock(struct member_device *entry)
+{
+	struct call_queue tmpq = {
+		.name = entry->queue,
+	};
+	struct call_queue *q;
+	struct member *mem;
+
+	q = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Find queue of device member");
+	if (!q) {
+		return NULL;
+	}
+
+	ao2_lock(q);
+	mem = ao2_find(q->members, entry->member->interface, OBJ_KEY);
+	if (mem != entry->member) {
+		/* Removed, or the queue was replaced since the index was searched */
+		ao2_unlock(q);
+		queue_t_unref(q, "Member of device is gone");
+		q = NULL;
+	}
+	ao2_cleanup(mem);
+
+	return q;
+}
+
 /*! \brief set a member's status based on device state of that member's interface*/
 static void device_state_cb(void *unused, struct stasis_subscription *sub, struct stasis_message *msg)
 {
-	struct ao2_iterator miter, qiter;
+	struct ao2_iterator *entries;
+	struct ao2_iterator miter;
 	struct ast_device_state_message *dev_state;
+	struct member_device *entry;
 	struct member *m;
 	struct call_queue *q;
-	char interface[80], *slash_pos;
 	int found = 0;			/* Found this member in any queue */
-	int found_member;		/* Found this member in this queue */
-	int avail = 0;			/* Found an available member in this queue */
+	int avail;			/* Found an available member in this queue */
 
 	if (ast_device_state_message_type() != stasis_message_type(msg)) {
 		return;
@@ -2526,55 +2703,39 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		return;
 	}
 
-	qiter = ao2_iterator_init(queues, 0);
-	while ((q = ao2_t_iterator_next(&qiter, "Iterate over queues"))) {
-		ao2_lock(q);
+	entries = ao2_callback(member_devices, OBJ_SEARCH_KEY | OBJ_MULTIPLE, NULL,
+		(char *) dev_state->device);
+	while (entries && (entry = ao2_iterator_next(entries))) {
+		q = member_device_queue_lock(entry);
+		if (!q) {
+			ao2_ref(entry, -1);
+			continue;
+		}
 
+		found = 1;
+		update_status(q, entry->member, dev_state->state);
+		ao2_ref(entry, -1);
+
+		/* check every member until we find one NOT_INUSE */
 		avail = 0;
-		found_member = 0;
 		miter = ao2_iterator_init(q->members, 0);
-		for (; (m = ao2_iterator_next(&miter)); ao2_ref(m, -1)) {
-			if (!found_member) {
-				ast_copy_string(interface, m->state_interface, sizeof(interface));
-
-				if ((slash_pos = strchr(interface, '/'))) {
-					if (!strncasecmp(interface, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
-						*slash_pos = '\0';
-					}
-				}
-
-				if (!strcasecmp(interface, dev_state->device)) {
-					found_member = 1;
-					update_status(q, m, dev_state->state);
-				}
-			}
-
-			/* check every member until we find one NOT_INUSE */
-			if (!avail) {
-				avail = is_member_available(q, m);
-			}
-			if (avail && found_member) {
-				/* early exit as we've found an available member and the member of interest */
-				ao2_ref(m, -1);
-				break;
-			}
+		for (; !avail && (m = ao2_iterator_next(&miter)); ao2_ref(m, -1)) {
+			avail = is_member_available(q, m);
 		}
+		ao2_iterator_destroy(&miter);
 
-		if (found_member) {
-			found = 1;
-			if (avail) {
-				ast_devstate_changed(AST_DEVICE_NOT_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
-			} else {
-				ast_devstate_changed(AST_DEVICE_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
-			}
+		if (avail) {
+			ast_devstate_changed(AST_DEVICE_NOT_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
+		} else {
+			ast_devstate_changed(AST_DEVICE_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
 		}
 
-		ao2_iterator_destroy(&miter);
-
 		ao2_unlock(q);
-		queue_t_unref(q, "Done with iterator");
+		queue_t_unref(q, "Done with device member");
+	}
+	if (entries) {
+		ao2_iterator_destroy(entries);
 	}
-	ao2_iterator_destroy(&qiter);
 
 	if (found) {
 		ast_debug(1, "Device '%s' changed to state '%u' (%s)\n",
@@ -2625,9 +2786,10 @@ static int extensionstate2devicestate(int state)
 
 static int extension_state_cb(const char *context, const char *exten, struct ast_state_cb_info *info, void *data)
 {
-	struct ao2_iterator miter, qiter;
-	struct member *m;
+	struct ao2_iterator *entries;
+	struct member_device *entry;
 	struct call_queue *q;
+	char device[MEMBER_DEVICE_NAME_LEN];
 	int state = info->exten_state;
 	int found = 0, device_state = extensionstate2devicestate(state);
 
@@ -2636,25 +2798,26 @@ static int extension_state_cb(const char *context, const char *exten, struct ast
 		return 0;
 	}
 
-	qiter = ao2_iterator_init(queues, 0);
-	while ((q = ao2_t_iterator_next(&qiter, "Iterate through queues"))) {
-		ao2_lock(q);
-
-		miter = ao2_iterator_init(q->members, 0);
-		for (; (m = ao2_iterator_next(&miter)); ao2_ref(m, -1)) {
-			if (!strcmp(m->state_context, context) && !strcmp(m->state_exten, exten)) {
-				update_status(q, m, device_state);
-				ao2_ref(m, -1);
-				found = 1;
-				break;
-			}
+	snprintf(device, sizeof(device), "hint:%s@%s", exten, context);
+	entries = ao2_callback(member_devices, OBJ_SEARCH_KEY | OBJ_MULTIPLE, NULL, device);
+	while (entries && (entry = ao2_iterator_next(entries))) {
+		/* The index does not tell case apart */
+		if (strcmp(entry->member->state_context, context) || strcmp(entry->member->state_exten, exten)
+			|| !(q = member_device_queue_lock(entry))) {
+			ao2_ref(entry, -1);
+			continue;
 		}
-		ao2_iterator_destroy(&miter);
+
+		update_status(q, entry->member, device_state);
+		found = 1;
+		ao2_ref(entry, -1);
 
 		ao2_unlock(q);
-		queue_t_unref(q, "Done with iterator");
+		queue_t_unref(q, "Done with hint member");
+	}
+	if (entries) {
+		ao2_iterator_destroy(entries);
 	}
-	ao2_iterator_destroy(&qiter);
 
         if (found) {
 		ast_debug(1, "Extension '%s@%s' changed to state '%d' (%s)\n", exten, context, device_state, ast_devstate2str(device_state));
@@ -2867,6 +3030,9 @@ static void clear_queue(struct call_queue *q)
 	q->callscompletedinsl = 0;
 	q->callsabandonedinsl = 0;
 	q->talktime = 0;
+	q->decisions = 0;
+	q->decision_usec = 0;
+	q->decision_max_usec = 0;
 
 	if (q->members) {
 		struct member *mem;
@@ -3361,6 +3527,7 @@ static void member_add_to_queue(struct call_queue *queue, struct member *mem)
 	ao2_lock(queue->members);
 	mem->queuepos = ao2_container_count(queue->members);
 	ao2_link(queue->members, mem);
+	member_device_link(queue, mem);
 	ast_devstate_changed(mem->paused ? QUEUE_PAUSED_DEVSTATE : QUEUE_UNPAUSED_DEVSTATE,
 		AST_DEVSTATE_CACHABLE, "Queue:%s_pause_%s", queue->name, mem->interface);
 	ao2_unlock(queue->members);
@@ -3379,6 +3546,7 @@ static void member_remove_from_queue(struct call_queue *queue, struct member *me
 	ast_devstate_changed(QUEUE_UNKNOWN_PAUSED_DEVSTATE, AST_DEVSTATE_CACHABLE, "Queue:%s_pause_%s", queue->name, mem->interface);
 	queue_member_follower_removal(queue, mem);
 	ao2_unlink(queue->members, mem);
+	member_device_unlink(mem);
 	ao2_unlock(queue->members);
 }
 
@@ -3467,7 +3635,9 @@ static void rt_handle_member_record(struct call_queue *q, char *category, struct
 					AST_DEVSTATE_CACHABLE, "Queue:%s_pause_%s", q->name, m->interface);
 			}
 			if (strcasecmp(state_interface, m->state_interface)) {
+				member_device_unlink(m);
 				ast_copy_string(m->state_interface, state_interface, sizeof(m->state_interface));
+				member_device_link(q, m);
 			}
 			m->penalty = penalty;
 			m->ringinuse = ringinuse;
@@ -3698,6 +3868,8 @@ static struct call_queue *find_queue_by_name_rt(const char *queuename, struct as
  * \retval the queue
  * \retval NULL if it doesn't exist
  */
+static int restore_queue_members(struct call_queue *q);
+
 static struct call_queue *find_load_queue_rt_friendly(const char *queuename)
 {
 	struct ast_variable *queue_vars;
@@ -3750,6 +3922,12 @@ static struct call_queue *find_load_queue_rt_friendly(const char *queuename)
 	} else {
 		update_realtime_members(q);
 	}
+
+	if (q && queue_persistent_members && !q->members_restored) {
+		/* Realtime queues get their persistent members the first time they are loaded */
+		restore_queue_members(q);
+	}
+
 	return q;
 }
 
@@ -4268,6 +4446,10 @@ static void hangupcalls(struct queue_ent *qe, struct callattempt *outgoing, stru
 {
 	struct callattempt *oo;
 
+	if (qe->ring_order) {
+		qe->ring_order = ast_heap_destroy(qe->ring_order);
+	}
+
 	while (outgoing) {
 		/* If someone else answered the call we should indicate this in the CANCEL */
 		/* Hangup any existing lines we have open */
@@ -4626,18 +4808,78 @@ static int ring_entry(struct queue_ent *qe, struct callattempt *tmp, int *busies
 	return 1;
 }
 
-/*! \brief find the entry with the best metric, or NULL */
-static struct callattempt *find_best(struct callattempt *outgoing)
+/*!
+ * \internal
+ * \brief Order call attempts in the ring_order heap
+ *
+ * The heap keeps the greatest element on top, so the lowest metric is the
+ * greatest here.  Equal metrics go to the member first in the outgoing list,
+ * which is the one added last.
+ */
+static int callattempt_ring_order_cmp(void *elm1, void *elm2)
 {
-	struct callattempt *best = NULL, *cur;
+	struct callattempt *a = elm1;
+	struct callattempt *b = elm2;
+
+	if (a->metric != b->metric) {
+		return a->metric < b->metric ? 1 : -1;
+	}
+
+	return a->pos - b->pos;
+}
+
+/*!
+ * \internal
+ * \brief Put the call attempts of a try in the ring_order heap of the caller
+ *
+ * If this fails the best entry is searched for in the outgoing list instead.
+ */
+static void ring_order_build(struct queue_ent *qe, struct callattempt *outgoing)
+{
+	struct callattempt *cur;
+
+	qe->ring_order = ast_heap_create(4, callattempt_ring_order_cmp, -1);
+	if (!qe->ring_order) {
+		return;
+	}
 
 	for (cur = outgoing; cur; cur = cur->q_next) {
-		if (cur->stillgoing &&					/* Not already done */
-			!cur->chan &&					/* Isn't already going */
-			(!best || cur->metric < best->metric)) {		/* We haven't found one yet, or it's better */
-			best = cur;
+		if (ast_heap_push(qe->ring_order, cur)) {
+			qe->ring_order = ast_heap_destroy(qe->ring_order);
+			return;
+		}
+	}
+}
+
+/*!
+ * \brief find the entry with the best metric, or NULL
+ *
+ * \note A call attempt never becomes eligible again once it is ringing or
+ * done, so those found on top of the ring_order heap are simply dropped.
+ */
+static struct callattempt *find_best(struct queue_ent *qe, struct callattempt *outgoing)
+{
+	struct callattempt *best = NULL, *cur;
+	struct timeval start = ast_tvnow();
+
+	if (qe->ring_order) {
+		while ((cur = ast_heap_peek(qe->ring_order, 1))) {
+			if (cur->stillgoing && !cur->chan) {
+				best = cur;
+				break;
+			}
+			ast_heap_pop(qe->ring_order);
+		}
+	} else {
+		for (cur = outgoing; cur; cur = cur->q_next) {
+			if (cur->stillgoing &&					/* Not already done */
+				!cur->chan &&					/* Isn't already going */
+				(!best || cur->metric < best->metric)) {		/* We haven't found one yet, or it's better */
+				best = cur;
+			}
 		}
 	}
+	qe->decision_usec += ast_tvdiff_us(ast_tvnow(), start);
 
 	return best;
 }
@@ -4667,7 +4909,7 @@ static int ring_one(struct queue_ent *qe, struct callattempt *outgoing, int *bus
 	}
 
 	while (ret == 0) {
-		struct callattempt *best = find_best(outgoing);
+		struct callattempt *best = find_best(qe, outgoing);
 		if (!best) {
 			ast_debug(1, "Nobody left to try ringing in queue\n");
 			break;
@@ -4714,7 +4956,7 @@ static int ring_one(struct queue_ent *qe, struct callattempt *outgoing, int *bus
 /*! \brief Search for best metric and add to Round Robbin queue */
 static int store_next_rr(struct queue_ent *qe, struct callattempt *outgoing)
 {
-	struct callattempt *best = find_best(outgoing);
+	struct callattempt *best = find_best(qe, outgoing);
 
 	if (best) {
 		/* Ring just the best channel */
@@ -4738,7 +4980,7 @@ static int store_next_rr(struct queue_ent *qe, struct callattempt *outgoing)
 /*! \brief Search for best metric and add to Linear queue */
 static int store_next_lin(struct queue_ent *qe, struct callattempt *outgoing)
 {
-	struct callattempt *best = find_best(outgoing);
+	struct callattempt *best = find_best(qe, outgoing);
 
 	if (best) {
 		/* Ring just the best channel */
@@ -6737,10 +6979,13 @@ static int try_calling(struct queue_ent *qe, struct ast_flags opts, char **opt_a
 	struct queue_end_bridge *queue_end_bridge = NULL;
 	int callcompletedinsl;
 	time_t starttime;
+	struct timeval metric_start;
+	int metric_res;
 
 	memset(&bridge_config, 0, sizeof(bridge_config));
 	tmpid[0] = 0;
 	time(&now);
+	qe->decision_usec = 0;
 
 	/* If we've already exceeded our timeout, then just stop
 	 * This should be extremely rare. queue_exec will take care
@@ -6848,7 +7093,11 @@ static int try_calling(struct queue_ent *qe, struct ast_flags opts, char **opt_a
 		tmp->lastqueue = cur->lastqueue;
 		ast_copy_string(tmp->interface, cur->interface, sizeof(tmp->interface));
 		/* Calculate the metric for the appropriate strategy. */
-		if (!calc_metric(qe->parent, cur, x++, qe, tmp)) {
+		tmp->pos = x;
+		metric_start = ast_tvnow();
+		metric_res = calc_metric(qe->parent, cur, x++, qe, tmp);
+		qe->decision_usec += ast_tvdiff_us(ast_tvnow(), metric_start);
+		if (!metric_res) {
 			/* Put them in the list of outgoing thingies...  We're ready now.
 			   XXX If we're forcibly removed, these outgoing calls won't get
 			   hung up XXX */
@@ -6863,6 +7112,10 @@ static int try_calling(struct queue_ent *qe, struct ast_flags opts, char **opt_a
 	}
 	ao2_iterator_destroy(&memi);
 
+	metric_start = ast_tvnow();
+	ring_order_build(qe, outgoing);
+	qe->decision_usec += ast_tvdiff_us(ast_tvnow(), metric_start);
+
 	if (qe->parent->timeoutpriority == TIMEOUT_PRIORITY_APP) {
 		/* Application arguments have higher timeout priority (behaviour for <=1.6) */
 		if (qe->expire && (!qe->parent->timeout || (qe->expire - now) <= qe->parent->timeout)) {
@@ -6897,6 +7150,11 @@ static int try_calling(struct queue_ent *qe, struct ast_flags opts, char **opt_a
 	if (qe->parent->strategy == QUEUE_STRATEGY_LINEAR) {
 		store_next_lin(qe, outgoing);
 	}
+	qe->parent->decisions++;
+	qe->parent->decision_usec += qe->decision_usec;
+	if (qe->decision_usec > qe->parent->decision_max_usec) {
+		qe->parent->decision_max_usec = qe->decision_usec;
+	}
 	ao2_unlock(qe->parent);
 	peer = lpeer ? lpeer->chan : NULL;
 	if (!peer) {
@@ -7232,78 +7490,67 @@ static int wait_a_bit(struct queue_ent *qe)
 
 static struct member *interface_exists(struct call_queue *q, const char *interface)
 {
-	struct member *mem;
-	struct ao2_iterator mem_iter;
-
 	if (!q) {
 		return NULL;
 	}
-	mem_iter = ao2_iterator_init(q->members, 0);
-	while ((mem = ao2_iterator_next(&mem_iter))) {
-		if (!strcasecmp(interface, mem->interface)) {
-			ao2_iterator_destroy(&mem_iter);
-			return mem;
-		}
-		ao2_ref(mem, -1);
-	}
-	ao2_iterator_destroy(&mem_iter);
 
-	return NULL;
+	/* Members are keyed by interface, without regard to case */
+	return ao2_find(q->members, interface, OBJ_KEY);
 }
 
 
-/*! \brief Dump all members in a specific queue to the database
+/*!
+ * \internal
+ * \brief Write a dynamic member of a queue to the database
  * \code
- * <pm_family>/<queuename> = <interface>;<penalty>;<paused>;<state_interface>[|...]
+ * <pm_member_family>/<queuename>/<interface> = <penalty>;<paused>;<membername>;<state_interface>;<reason_paused>;<wrapuptime>
  * \endcode
+ *
+ * \note Only the record of this member is written, the astdb batches it
+ * with the other changes made meanwhile.
  */
-static void dump_queue_members(struct call_queue *pm_queue)
+static void pm_member_put(struct call_queue *q, struct member *mem)
 {
-	struct member *cur_member;
-	struct ast_str *value;
-	struct ao2_iterator mem_iter;
+	char value[sizeof(mem->membername) + sizeof(mem->state_interface) + sizeof(mem->reason_paused) + 48];
+	char *key;
 
-	if (!pm_queue) {
+	if (!mem->dynamic) {
 		return;
 	}
 
-	/* 4K is a reasonable default for most applications, but we grow to
-	 * accommodate more if necessary. */
-	if (!(value = ast_str_create(4096))) {
+	if (ast_asprintf(&key, "%s/%s", q->name, mem->interface) < 0) {
 		return;
 	}
 
-	mem_iter = ao2_iterator_init(pm_queue->members, 0);
-	while ((cur_member = ao2_iterator_next(&mem_iter))) {
-		if (!cur_member->dynamic) {
-			ao2_ref(cur_member, -1);
-			continue;
-		}
-
-		ast_str_append(&value, 0, "%s%s;%d;%d;%s;%s;%s;%d",
-			ast_str_strlen(value) ? "|" : "",
-			cur_member->interface,
-			cur_member->penalty,
-			cur_member->paused,
-			cur_member->membername,
-			cur_member->state_interface,
-			cur_member->reason_paused,
-			cur_member->wrapuptime);
+	snprintf(value, sizeof(value), "%d;%d;%s;%s;%s;%d",
+		mem->penalty,
+		mem->paused,
+		mem->membername,
+		mem->state_interface,
+		mem->reason_paused,
+		mem->wrapuptime);
 
-		ao2_ref(cur_member, -1);
+	if (ast_db_put(pm_member_family, key, value)) {
+		ast_log(LOG_WARNING, "failed to create persistent dynamic entry!\n");
 	}
-	ao2_iterator_destroy(&mem_iter);
 
-	if (ast_str_strlen(value) && !cur_member) {
-		if (ast_db_put(pm_family, pm_queue->name, ast_str_buffer(value))) {
-			ast_log(LOG_WARNING, "failed to create persistent dynamic entry!\n");
-		}
-	} else {
-		/* Delete the entry if the queue is empty or there is an error */
-		ast_db_del(pm_family, pm_queue->name);
+	ast_free(key);
+}
+
+/*!
+ * \internal
+ * \brief Remove a dynamic member of a queue from the database
+ */
+static void pm_member_del(struct call_queue *q, const char *interface)
+{
+	char *key;
+
+	if (ast_asprintf(&key, "%s/%s", q->name, interface) < 0) {
+		return;
 	}
 
-	ast_free(value);
+	ast_db_del(pm_member_family, key);
+	ast_free(key);
 }
 
 /*! \brief Remove member from queue
@@ -7337,11 +7584,11 @@ static int remove_from_queue(const char *queuename, const char *interface)
 			queue_publish_member_blob(queue_member_removed_type(), queue_member_blob_create(q, mem));
 
 			member_remove_from_queue(q, mem);
-			ao2_ref(mem, -1);
 
 			if (queue_persistent_members) {
-				dump_queue_members(q);
+				pm_member_del(q, mem->interface);
 			}
+			ao2_ref(mem, -1);
 
 			if (!num_available_members(q)) {
 				ast_devstate_changed(AST_DEVICE_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
@@ -7358,26 +7605,21 @@ static int remove_from_queue(const char *queuename, const char *interface)
 	return res;
 }
 
-/*! \brief Add member to queue
- * \retval RES_NOT_DYNAMIC when they aren't a RT member
- * \retval RES_NOSUCHQUEUE queue does not exist
- * \retval RES_OKAY added member from queue
- * \retval RES_EXISTS queue exists but no members
- * \retval RES_OUT_OF_MEMORY queue exists but not enough memory to create member
-*/
-static int add_to_queue(const char *queuename, const char *interface, const char *membername, int penalty, int paused, int dump, const char *state_interface, const char *reason_paused, int wrapuptime)
+/*!
+ * \internal
+ * \brief Add a dynamic member to a queue
+ *
+ * \pre The q is locked on entry.
+ *
+ * \retval RES_OKAY added member to queue
+ * \retval RES_EXISTS the member is already in the queue
+ * \retval RES_OUTOFMEMORY not enough memory to create member
+ */
+static int add_dynamic_member(struct call_queue *q, const char *interface, const char *membername, int penalty, int paused, int dump, const char *state_interface, const char *reason_paused, int wrapuptime)
 {
-	struct call_queue *q;
 	struct member *new_member, *old_member;
-	int res = RES_NOSUCHQUEUE;
-
-	/*! \note Ensure the appropriate realtime queue is loaded.  Note that this
-	 * short-circuits if the queue is already in memory. */
-	if (!(q = find_load_queue_rt_friendly(queuename))) {
-		return res;
-	}
+	int res;
 
-	ao2_lock(q);
 	if ((old_member = interface_exists(q, interface)) == NULL) {
 		if ((new_member = create_queue_member(interface, membername, penalty, paused, state_interface, q->ringinuse, wrapuptime))) {
 			new_member->dynamic = 1;
@@ -7391,13 +7633,13 @@ static int add_to_queue(const char *queuename, const char *interface, const char
 				ast_devstate_changed(AST_DEVICE_NOT_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
 			}
 
-			ao2_ref(new_member, -1);
-			new_member = NULL;
-
 			if (dump) {
-				dump_queue_members(q);
+				pm_member_put(q, new_member);
 			}
 
+			ao2_ref(new_member, -1);
+			new_member = NULL;
+
 			res = RES_OKAY;
 		} else {
 			res = RES_OUTOFMEMORY;
@@ -7406,6 +7648,30 @@ static int add_to_queue(const char *queuename, const char *interface, const char
 		ao2_ref(old_member, -1);
 		res = RES_EXISTS;
 	}
+
+	return res;
+}
+
+/*! \brief Add member to queue
+ * \retval RES_NOT_DYNAMIC when they aren't a RT member
+ * \retval RES_NOSUCHQUEUE queue does not exist
+ * \retval RES_OKAY added member from queue
+ * \retval RES_EXISTS queue exists but no members
+ * \retval RES_OUT_OF_MEMORY queue exists but not enough memory to create member
+*/
+static int add_to_queue(const char *queuename, const char *interface, const char *membername, int penalty, int paused, int dump, const char *state_interface, const char *reason_paused, int wrapuptime)
+{
+	struct call_queue *q;
+	int res = RES_NOSUCHQUEUE;
+
+	/*! \note Ensure the appropriate realtime queue is loaded.  Note that this
+	 * short-circuits if the queue is already in memory. */
+	if (!(q = find_load_queue_rt_friendly(queuename))) {
+		return res;
+	}
+
+	ao2_lock(q);
+	res = add_dynamic_member(q, interface, membername, penalty, paused, dump, state_interface, reason_paused, wrapuptime);
 	ao2_unlock(q);
 	queue_t_unref(q, "Expiring temporary reference");
 
@@ -7499,7 +7765,7 @@ static void set_queue_member_pause(struct call_queue *q, struct member *mem, con
 		AST_DEVSTATE_CACHABLE, "Queue:%s_pause_%s", q->name, mem->interface);
 
 	if (queue_persistent_members) {
-		dump_queue_members(q);
+		pm_member_put(q, mem);
 	}
 
 	if (is_member_available(q, mem)) {
@@ -7754,14 +8020,22 @@ static int get_member_penalty(char *queuename, char *interface)
 	return RESULT_FAILURE;
 }
 
-/*! \brief Reload dynamic queue members persisted into the astdb */
-static void reload_queue_members(void)
+/*!
+ * \internal
+ * \brief Add a persistent member to a queue from its record
+ *
+ * \param q The queue
+ * \param interface The interface of the member
+ * \param fields <penalty>;<paused>;<membername>;<state_interface>;<reason_paused>;<wrapuptime>
+ *
+ * \pre The q is locked on entry.
+ *
+ * \retval 0 on success
+ * \retval -1 if the record is not valid or there is no memory left
+ */
+static int restore_queue_member(struct call_queue *q, const char *interface, char *fields)
 {
-	char *cur_ptr;
-	const char *queue_name;
-	char *member;
-	char *interface;
-	char *membername = NULL;
+	char *membername;
 	char *state_interface;
 	char *penalty_tok;
 	int penalty = 0;
@@ -7770,99 +8044,204 @@ static void reload_queue_members(void)
 	char *wrapuptime_tok;
 	int wrapuptime = 0;
 	char *reason_paused;
-	struct ast_db_entry *db_tree;
-	struct ast_db_entry *entry;
-	struct call_queue *cur_queue;
-	char *queue_data;
 
-	/* Each key in 'pm_family' is the name of a queue */
-	db_tree = ast_db_gettree(pm_family, NULL);
-	for (entry = db_tree; entry; entry = entry->next) {
+	penalty_tok = strsep(&fields, ";");
+	paused_tok = strsep(&fields, ";");
+	membername = strsep(&fields, ";");
+	state_interface = strsep(&fields, ";");
+	reason_paused = strsep(&fields, ";");
+	wrapuptime_tok = strsep(&fields, ";");
 
-		queue_name = entry->key + strlen(pm_family) + 2;
+	if (!penalty_tok) {
+		ast_log(LOG_WARNING, "Error parsing persistent member string for '%s' (penalty)\n", q->name);
+		return -1;
+	}
+	penalty = strtol(penalty_tok, NULL, 10);
+	if (errno == ERANGE) {
+		ast_log(LOG_WARNING, "Error converting penalty: %s: Out of range.\n", penalty_tok);
+		return -1;
+	}
 
-		{
-			struct call_queue tmpq = {
-				.name = queue_name,
-			};
-			cur_queue = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Reload queue members");
-		}
+	if (!paused_tok) {
+		ast_log(LOG_WARNING, "Error parsing persistent member string for '%s' (paused)\n", q->name);
+		return -1;
+	}
+	paused = strtol(paused_tok, NULL, 10);
+	if ((errno == ERANGE) || paused < 0 || paused > 1) {
+		ast_log(LOG_WARNING, "Error converting paused: %s: Expected 0 or 1.\n", paused_tok);
+		return -1;
+	}
 
-		if (!cur_queue) {
-			cur_queue = find_load_queue_rt_friendly(queue_name);
+	if (!ast_strlen_zero(wrapuptime_tok)) {
+		wrapuptime = strtol(wrapuptime_tok, NULL, 10);
+		if (errno == ERANGE) {
+			ast_log(LOG_WARNING, "Error converting wrapuptime: %s: Out of range.\n", wrapuptime_tok);
+			return -1;
 		}
+	}
 
-		if (!cur_queue) {
-			/* If the queue no longer exists, remove it from the
-			 * database */
-			ast_log(LOG_WARNING, "Error loading persistent queue: '%s': it does not exist\n", queue_name);
-			ast_db_del(pm_family, queue_name);
-			continue;
-		}
+	ast_debug(1, "Reload Members: Queue: %s  Member: %s  Name: %s  Penalty: %d  Paused: %d ReasonPause: %s  Wrapuptime: %d\n",
+	              q->name, interface, membername, penalty, paused, reason_paused, wrapuptime);
 
-		if (ast_db_get_allocated(pm_family, queue_name, &queue_data)) {
-			queue_t_unref(cur_queue, "Expire reload reference");
+	if (add_dynamic_member(q, interface, membername, penalty, paused, 0, state_interface, reason_paused, wrapuptime) == RES_OUTOFMEMORY) {
+		ast_log(LOG_ERROR, "Out of Memory when reloading persistent queue member\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Restore the persistent members of a queue from the astdb
+ *
+ * \note This is only done once for each queue, later changes to the
+ * members are written as they happen.
+ *
+ * \return The number of members restored
+ */
+static int restore_queue_members(struct call_queue *q)
+{
+	struct ast_db_entry *db_tree;
+	struct ast_db_entry *entry;
+	size_t prefix_len;
+	int restored = 0;
+
+	ao2_lock(q);
+	if (q->members_restored) {
+		ao2_unlock(q);
+		return 0;
+	}
+	q->members_restored = 1;
+
+	/* Each key below <pm_member_family>/<queuename> is the interface of a member */
+	db_tree = ast_db_gettree(pm_member_family, q->name);
+	prefix_len = strlen(pm_member_family) + strlen(q->name) + 3;
+	for (entry = db_tree; entry; entry = entry->next) {
+		if (strlen(entry->key) <= prefix_len) {
 			continue;
 		}
+		if (!restore_queue_member(q, entry->key + prefix_len, entry->data)) {
+			++restored;
+		}
+	}
+	ao2_unlock(q);
+
+	ast_db_freetree(db_tree);
 
-		cur_ptr = queue_data;
+	return restored;
+}
+
+/*!
+ * \internal
+ * \brief Convert the members persisted as one record per queue to a record per member
+ * \code
+ * <pm_family>/<queuename> = <interface>;<penalty>;<paused>;<membername>;<state_interface>;<reason_paused>;<wrapuptime>[|...]
+ * \endcode
+ */
+static void convert_queue_members(void)
+{
+	struct ast_db_entry *db_tree;
+	struct ast_db_entry *entry;
+	const char *queue_name;
+	char *cur_ptr;
+	char *member;
+	char *interface;
+	char *key;
+
+	/* Each key in 'pm_family' is the name of a queue */
+	db_tree = ast_db_gettree(pm_family, NULL);
+	for (entry = db_tree; entry; entry = entry->next) {
+		queue_name = entry->key + strlen(pm_family) + 2;
+
+		cur_ptr = entry->data;
 		while ((member = strsep(&cur_ptr, ",|"))) {
-			if (ast_strlen_zero(member)) {
+			interface = strsep(&member, ";");
+			if (ast_strlen_zero(interface) || !member) {
 				continue;
 			}
 
-			interface = strsep(&member, ";");
-			penalty_tok = strsep(&member, ";");
-			paused_tok = strsep(&member, ";");
-			membername = strsep(&member, ";");
-			state_interface = strsep(&member, ";");
-			reason_paused = strsep(&member, ";");
-			wrapuptime_tok = strsep(&member, ";");
-
-			if (!penalty_tok) {
-				ast_log(LOG_WARNING, "Error parsing persistent member string for '%s' (penalty)\n", queue_name);
-				break;
-			}
-			penalty = strtol(penalty_tok, NULL, 10);
-			if (errno == ERANGE) {
-				ast_log(LOG_WARNING, "Error converting penalty: %s: Out of range.\n", penalty_tok);
-				break;
+			/* What follows the interface is the record of the member as is */
+			if (ast_asprintf(&key, "%s/%s", queue_name, interface) < 0) {
+				continue;
 			}
+			ast_db_put(pm_member_family, key, member);
+			ast_free(key);
+		}
 
-			if (!paused_tok) {
-				ast_log(LOG_WARNING, "Error parsing persistent member string for '%s' (paused)\n", queue_name);
-				break;
-			}
-			paused = strtol(paused_tok, NULL, 10);
-			if ((errno == ERANGE) || paused < 0 || paused > 1) {
-				ast_log(LOG_WARNING, "Error converting paused: %s: Expected 0 or 1.\n", paused_tok);
-				break;
-			}
+		ast_db_del(pm_family, queue_name);
+		ast_log(LOG_NOTICE, "Converted the persistent members of queue '%s' to one record each\n", queue_name);
+	}
 
-			if (!ast_strlen_zero(wrapuptime_tok)) {
-				wrapuptime = strtol(wrapuptime_tok, NULL, 10);
-				if (errno == ERANGE) {
-					ast_log(LOG_WARNING, "Error converting wrapuptime: %s: Out of range.\n", wrapuptime_tok);
-					break;
-				}
-			}
+	ast_db_freetree(db_tree);
+}
 
-			ast_debug(1, "Reload Members: Queue: %s  Member: %s  Name: %s  Penalty: %d  Paused: %d ReasonPause: %s  Wrapuptime: %d\n",
-			              queue_name, interface, membername, penalty, paused, reason_paused, wrapuptime);
+/*!
+ * \brief Reload dynamic queue members persisted into the astdb
+ *
+ * Only the queues in memory are restored here, realtime queues are restored
+ * the first time they are loaded.
+ */
+static void reload_queue_members(void)
+{
+	struct ast_db_entry *db_tree;
+	struct ast_db_entry *entry;
+	struct call_queue *cur_queue;
+	struct ao2_iterator queue_iter;
+	const char *last_name = NULL;
+	int restored = 0;
 
-			if (add_to_queue(queue_name, interface, membername, penalty, paused, 0, state_interface, reason_paused, wrapuptime) == RES_OUTOFMEMORY) {
-				ast_log(LOG_ERROR, "Out of Memory when reloading persistent queue member\n");
-				break;
-			}
-		}
-		queue_t_unref(cur_queue, "Expire reload reference");
-		ast_free(queue_data);
+	convert_queue_members();
+
+	queue_iter = ao2_iterator_init(queues, 0);
+	while ((cur_queue = ao2_t_iterator_next(&queue_iter, "Iterate through queues"))) {
+		restored += restore_queue_members(cur_queue);
+		queue_t_unref(cur_queue, "Done with iterator");
 	}
+	ao2_iterator_destroy(&queue_iter);
 
-	if (db_tree) {
+	if (restored) {
 		ast_log(LOG_NOTICE, "Queue members successfully reloaded from database.\n");
-		ast_db_freetree(db_tree);
 	}
+
+	if (ast_check_realtime("queues")) {
+		return;
+	}
+
+	/* Without realtime queues, the members of queues that do not exist can be removed */
+	db_tree = ast_db_gettree(pm_member_family, NULL);
+	for (entry = db_tree; entry; entry = entry->next) {
+		char *queue_name = entry->key + strlen(pm_member_family) + 2;
+		char *slash = strchr(queue_name, '/');
+
+		if (!slash) {
+			continue;
+		}
+		*slash = '\0';
+
+		/* The keys of a queue are next to each other */
+		if (last_name && !strcmp(last_name, queue_name)) {
+			continue;
+		}
+		last_name = queue_name;
+
+		{
+			struct call_queue tmpq = {
+				.name = queue_name,
+			};
+			cur_queue = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Reload queue members");
+		}
+
+		if (cur_queue) {
+			queue_t_unref(cur_queue, "Expire reload reference");
+			continue;
+		}
+
+		ast_log(LOG_WARNING, "Error loading persistent queue: '%s': it does not exist\n", queue_name);
+		ast_db_deltree(pm_member_family, queue_name);
+	}
+
+	ast_db_freetree(db_tree);
 }
 
 /*! \brief PauseQueueMember application */
@@ -9314,6 +9693,8 @@ static void reload_single_member(const char *memberdata, struct call_queue *q)
 			newm->queuepos = cur->queuepos;
 			ao2_link(q->members, newm);
 			ao2_unlink(q->members, cur);
+			member_device_link(q, newm);
+			member_device_unlink(cur);
 			ao2_unlock(q->members);
 		} else {
 			/* Otherwise we need to add using the function that will apply a round robin queue position manually. */
@@ -9345,6 +9726,7 @@ static int kill_dead_members(void *obj, void *arg, int flags)
 		member->status = get_queue_member_status(member);
 		return 0;
 	} else {
+		member_device_unlink(member);
 		return CMP_MATCH;
 	}
 }
@@ -9619,16 +10001,26 @@ static int reload_handler(int reload, struct ast_flags *mask, const char *queuen
 	return res;
 }
 
-/*! \brief direct ouput to manager or cli with proper terminator */
-static void do_print(struct mansession *s, int fd, const char *str)
+/*!
+ * \brief direct ouput to manager or cli
+ *
+ * \param terminate Whether to end the output with the proper terminator
+ */
+static void do_print(struct mansession *s, int fd, const char *str, int terminate)
 {
 	if (s) {
-		astman_append(s, "%s\r\n", str);
+		astman_append(s, "%s%s", str, terminate ? "\r\n" : "");
 	} else {
-		ast_cli(fd, "%s\n", str);
+		ast_cli(fd, "%s%s", str, terminate ? "\n" : "");
 	}
 }
 
+/*! \brief add a line of output for manager or cli, with proper terminator, to a buffer */
+static void do_print_line(struct mansession *s, struct ast_str **buf, const char *str)
+{
+	ast_str_append(buf, 0, "%s%s", str, s ? "\r\n" : "\n");
+}
+
 /*!
  * \brief Show queue(s) status and statistics
  *
@@ -9639,6 +10031,7 @@ static char *__queues_show(struct mansession *s, int fd, int argc, const char *
 {
 	struct call_queue *q;
 	struct ast_str *out = ast_str_alloca(512);
+	struct ast_str *lines;
 	int found = 0;
 	time_t now = time(NULL);
 	struct ao2_iterator queue_iter;
@@ -9669,15 +10062,28 @@ static char *__queues_show(struct mansession *s, int fd, int argc, const char *
 		}
 	}
 
-	ao2_lock(queues);
-	queue_iter = ao2_iterator_init(queues, AO2_ITERATOR_DONTLOCK);
+	lines = ast_str_create(1024);
+	if (!lines) {
+		return CLI_FAILURE;
+	}
+
+	/*
+	 * Neither the container nor a queue is locked while output is written,
+	 * so that a slow CLI or manager connection does not hold up calls.
+	 * Each queue is rendered into lines while locked, then written out.
+	 */
+	queue_iter = ao2_iterator_init(queues, 0);
 	while ((q = ao2_t_iterator_next(&queue_iter, "Iterate through queues"))) {
 		float sl;
 		float sl2;
 
 		struct call_queue *realtime_queue = NULL;
 
-		ao2_lock(q);
+		if (argc == 3 && strcasecmp(q->name, argv[2])) {
+			queue_t_unref(q, "Done with iterator");
+			continue;
+		}
+
 		/* This check is to make sure we don't print information for realtime
 		 * queues which have been deleted from realtime but which have not yet
 		 * been deleted from the in-core container. Only do this if we're not
@@ -9686,19 +10092,15 @@ static char *__queues_show(struct mansession *s, int fd, int argc, const char *
 		if (argc < 3 && q->realtime) {
 			realtime_queue = find_load_queue_rt_friendly(q->name);
 			if (!realtime_queue) {
-				ao2_unlock(q);
 				queue_t_unref(q, "Done with iterator");
 				continue;
 			}
 			queue_t_unref(realtime_queue, "Queue is already in memory");
 		}
 
-		if (argc == 3 && strcasecmp(q->name, argv[2])) {
-			ao2_unlock(q);
-			queue_t_unref(q, "Done with iterator");
-			continue;
-		}
+		ao2_lock(q);
 		found = 1;
+		ast_str_reset(lines);
 
 		ast_str_set(&out, 0, "%s has %d calls (max ", q->name, q->count);
 		if (q->maxlen) {
@@ -9717,13 +10119,18 @@ static char *__queues_show(struct mansession *s, int fd, int argc, const char *
 
 		ast_str_append(&out, 0, ") in '%s' strategy (%ds holdtime, %ds talktime), W:%d, C:%d, A:%d, SL:%2.1f%%, SL2:%2.1f%% within %ds",
 			int2strat(q->strategy), q->holdtime, q->talktime, q->weight, q->callscompleted, q->callsabandoned, sl, sl2, q->servicelevel);
-		do_print(s, fd, ast_str_buffer(out));
+		do_print_line(s, &lines, ast_str_buffer(out));
+		if (q->decisions) {
+			ast_str_set(&out, 0, "   Strategy decisions: %d, %" PRId64 " us average, %" PRId64 " us max",
+				q->decisions, q->decision_usec / q->decisions, q->decision_max_usec);
+			do_print_line(s, &lines, ast_str_buffer(out));
+		}
 		if (!ao2_container_count(q->members)) {
-			do_print(s, fd, "   No Members");
+			do_print_line(s, &lines, "   No Members");
 		} else {
 			struct member *mem;
 
-			do_print(s, fd, "   Members: ");
+			do_print_line(s, &lines, "   Members: ");
 			mem_iter = ao2_iterator_init(q->members, 0);
 			while ((mem = ao2_iterator_next(&mem_iter))) {
 				ast_str_set(&out, 0, "      %s", mem->membername);
@@ -9766,38 +10173,40 @@ static char *__queues_show(struct mansession *s, int fd, int argc, const char *
 				} else {
 					ast_str_append(&out, 0, " has taken no calls yet");
 				}
-				do_print(s, fd, ast_str_buffer(out));
+				do_print_line(s, &lines, ast_str_buffer(out));
 				ao2_ref(mem, -1);
 			}
 			ao2_iterator_destroy(&mem_iter);
 		}
 		if (!q->head) {
-			do_print(s, fd, "   No Callers");
+			do_print_line(s, &lines, "   No Callers");
 		} else {
 			struct queue_ent *qe;
 			int pos = 1;
 
-			do_print(s, fd, "   Callers: ");
+			do_print_line(s, &lines, "   Callers: ");
 			for (qe = q->head; qe; qe = qe->next) {
 				ast_str_set(&out, 0, "      %d. %s (wait: %ld:%2.2ld, prio: %d)",
 					pos++, ast_channel_name(qe->chan), (long) (now - qe->start) / 60,
 					(long) (now - qe->start) % 60, qe->prio);
-				do_print(s, fd, ast_str_buffer(out));
+				do_print_line(s, &lines, ast_str_buffer(out));
 			}
 		}
-		do_print(s, fd, "");	/* blank line between entries */
+		do_print_line(s, &lines, "");	/* blank line between entries */
 		ao2_unlock(q);
 		queue_t_unref(q, "Done with iterator"); /* Unref the iterator's reference */
+
+		do_print(s, fd, ast_str_buffer(lines), 0);
 	}
 	ao2_iterator_destroy(&queue_iter);
-	ao2_unlock(queues);
+	ast_free(lines);
 	if (!found) {
 		if (argc == 3) {
 			ast_str_set(&out, 0, "No such queue: %s.", argv[2]);
 		} else {
 			ast_str_set(&out, 0, "No queues.");
 		}
-		do_print(s, fd, ast_str_buffer(out));
+		do_print(s, fd, ast_str_buffer(out), 1);
 	}
 	return CLI_SUCCESS;
 }
@@ -11254,8 +11663,10 @@ static int unload_module(void)
 	ast_unload_realtime("queue_members");
 	ao2_cleanup(queues);
 	ao2_cleanup(pending_members);
+	ao2_cleanup(member_devices);
 
 	queues = NULL;
+	member_devices = NULL;
 	return 0;
 }
 
@@ -11290,6 +11701,13 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	member_devices = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		MAX_MEMBER_DEVICE_BUCKETS, member_device_hash, NULL, member_device_cmp);
+	if (!member_devices) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	use_weight = 0;
 
 	if (reload_handler(0, &mask, NULL)) {
@@ -955,6 +955,27 @@ static struct ao2_container *mailbox_alias_mappings;
 AO2_STRING_FIELD_HASH_FN(mailbox_alias_mapping, mailbox);
 AO2_STRING_FIELD_CMP_FN(mailbox_alias_mapping, mailbox);
 
+/*!
+ * \brief Message count of a folder on the filesystem
+ *
+ * Adding or removing a message changes the modification time of its
+ * folder, so the folder is only read again once that changed.  A stat
+ * is far cheaper than reading the directory, especially over NFS.
+ */
+struct vm_folder_count {
+	/*! Modification time of the folder when it was counted */
+	time_t mtime;
+	/*! Messages in the folder */
+	int count;
+	/*! Path of the folder */
+	char dir[0];
+};
+
+#define FOLDER_COUNT_BUCKETS 1021
+static struct ao2_container *folder_counts;
+AO2_STRING_FIELD_HASH_FN(vm_folder_count, dir);
+AO2_STRING_FIELD_CMP_FN(vm_folder_count, dir);
+
 /* custom audio control prompts for voicemail playback */
 static char listen_control_forward_key[12];
 static char listen_control_reverse_key[12];
@@ -6018,6 +6039,68 @@ static int copy_message(struct ast_channel *chan, struct ast_vm_user *vmu, int i
 #endif
 #if !(defined(IMAP_STORAGE) || defined(ODBC_STORAGE))
 
+/*!
+ * \brief Count the messages in a folder, reading it only if it changed
+ * \param dir The path of the folder
+ *
+ * This method is used when mailboxes are stored on the filesystem. (not ODBC and not IMAP).
+ *
+ * \return the count of messages, zero or more.
+ */
+static int count_folder_messages(const char *dir)
+{
+	struct vm_folder_count *folder;
+	struct stat st;
+	DIR *vmdir;
+	struct dirent *vment;
+	time_t now = time(NULL);
+	int vmcount = 0;
+
+	if (stat(dir, &st)) {
+		return 0;
+	}
+
+	folder = ao2_find(folder_counts, dir, OBJ_SEARCH_KEY);
+	if (folder && folder->mtime == st.st_mtime) {
+		vmcount = folder->count;
+		ao2_ref(folder, -1);
+		return vmcount;
+	}
+	ao2_cleanup(folder);
+
+	if (!(vmdir = opendir(dir))) {
+		return 0;
+	}
+
+	while ((vment = readdir(vmdir))) {
+		if (!strncasecmp(vment->d_name, "msg", 3) && !strncasecmp(vment->d_name + 8, "txt", 3)) {
+			vmcount++;
+		}
+	}
+	closedir(vmdir);
+
+	ao2_lock(folder_counts);
+	ao2_find(folder_counts, dir, OBJ_SEARCH_KEY | OBJ_NOLOCK | OBJ_UNLINK | OBJ_NODATA);
+	/*
+	 * A message added within the same second as the folder last changed
+	 * may leave its modification time as it was, so such a count is not
+	 * remembered.
+	 */
+	if (st.st_mtime < now - 1) {
+		folder = ao2_alloc_options(sizeof(*folder) + strlen(dir) + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (folder) {
+			folder->mtime = st.st_mtime;
+			folder->count = vmcount;
+			strcpy(folder->dir, dir); /* Safe */
+			ao2_link_flags(folder_counts, folder, OBJ_NOLOCK);
+			ao2_ref(folder, -1);
+		}
+	}
+	ao2_unlock(folder_counts);
+
+	return vmcount;
+}
+
 static int messagecount(const char *mailbox_id, const char *folder)
 {
 	char *context;
@@ -6033,10 +6116,8 @@ static int messagecount(const char *mailbox_id, const char *folder)
 
 static int __has_voicemail(const char *context, const char *mailbox, const char *folder, int shortcircuit)
 {
-	DIR *dir;
-	struct dirent *de;
 	char fn[256];
-	int ret = 0;
+	int ret;
 	struct alias_mailbox_mapping *mapping;
 	char *c;
 	char *m;
@@ -6066,23 +6147,9 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 
 	snprintf(fn, sizeof(fn), "%s%s/%s/%s", VM_SPOOL_DIR, c, m, folder);
 
-	if (!(dir = opendir(fn)))
-		return 0;
-
-	while ((de = readdir(dir))) {
-		if (!strncasecmp(de->d_name, "msg", 3)) {
-			if (shortcircuit) {
-				ret = 1;
-				break;
-			} else if (!strncasecmp(de->d_name + 8, "txt", 3)) {
-				ret++;
-			}
-		}
-	}
+	ret = count_folder_messages(fn);
 
-	closedir(dir);
-
-	return ret;
+	return shortcircuit ? !!ret : ret;
 }
 
 /**
@@ -15044,6 +15111,7 @@ static int unload_module(void)
 	ao2_cleanup(alias_mailbox_mappings);
 	ao2_container_unregister("voicemail_mailbox_alias_mappings");
 	ao2_cleanup(mailbox_alias_mappings);
+	ao2_cleanup(folder_counts);
 
 	if (poll_thread != AST_PTHREADT_NULL)
 		stop_poll_thread();
@@ -15130,6 +15198,18 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	folder_counts = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, FOLDER_COUNT_BUCKETS,
+		vm_folder_count_hash_fn, NULL, vm_folder_count_cmp_fn);
+	if (!folder_counts) {
+		ast_log(LOG_ERROR, "Unable to create folder_counts container\n");
+		ao2_cleanup(inprocess_container);
+		ao2_container_unregister("voicemail_alias_mailbox_mappings");
+		ao2_cleanup(alias_mailbox_mappings);
+		ao2_container_unregister("voicemail_mailbox_alias_mappings");
+		ao2_cleanup(mailbox_alias_mappings);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	/* compute the location of the voicemail spool directory */
 	snprintf(VM_SPOOL_DIR, sizeof(VM_SPOOL_DIR), "%s/voicemail/", ast_config_AST_SPOOL_DIR);
 
@@ -283,6 +283,19 @@
 						though, the native sample rate will never exceed it.
 					</para></description>
 				</configOption>
+				<configOption name="max_mixed_talkers">
+					<synopsis>Limit the number of talkers mixed at once</synopsis>
+					<description><para>
+						Only mix the audio of this many of the loudest talkers
+						in the conference at once.  Talkers already being mixed
+						must be clearly outspoken to be left out, so the mix
+						does not keep switching between talkers of similar
+						volume.  In large conferences this keeps background
+						noise from many open lines out of the mix and makes the
+						mixing work depend on this number rather than on the
+						number of talkers.  By default every talker is mixed.
+					</para></description>
+				</configOption>
 				<configOption name="language" default="en">
 					<synopsis>The language used for announcements to the conference.</synopsis>
 					<description><para>
@@ -529,6 +542,19 @@
 						</enumlist>
 					</description>
 				</configOption>
+				<configOption name="remb_min_bitrate" default="0">
+					<synopsis>Sets the bitrate below which a receiver is sent no video</synopsis>
+					<description><para>
+						Sets the estimated maximum bitrate, in bits per second, that a receiver
+						must report for each video source it receives to be sent video. A
+						receiver below it has its video paused and its REMB reports left out
+						of the combined ones, so a single receiver on a poor connection does
+						not force every sender to lower its bitrate. Video resumes once the
+						receiver reports twice this bitrate. This requires
+						<literal>remb_send_interval</literal> to be set. This defaults to 0,
+						or disabled.
+					</para></description>
+				</configOption>
 				<configOption name="enable_events" default="no">
 					<synopsis>Enables events for this bridge</synopsis>
 					<description><para>
@@ -1704,6 +1730,12 @@ static char *handle_cli_confbridge_show_bridge_profile(struct ast_cli_entry *e,
 		ast_cli(a->fd,"Mixing Interval:      Default 20ms\n");
 	}
 
+	if (b_profile.max_mixed_talkers) {
+		ast_cli(a->fd,"Max Mixed Talkers:    %u\n", b_profile.max_mixed_talkers);
+	} else {
+		ast_cli(a->fd,"Max Mixed Talkers:    No Limit\n");
+	}
+
 	ast_cli(a->fd,"Record Conference:    %s\n",
 		b_profile.flags & BRIDGE_OPT_RECORD_CONFERENCE ?
 		"yes" : "no");
@@ -1762,6 +1794,7 @@ static char *handle_cli_confbridge_show_bridge_profile(struct ast_cli_entry *e,
 
 	ast_cli(a->fd,"Video Update Discard: %u\n", b_profile.video_update_discard);
 	ast_cli(a->fd,"REMB Send Interval: %u\n", b_profile.remb_send_interval);
+	ast_cli(a->fd,"REMB Min Bitrate: %u\n", b_profile.remb_min_bitrate);
 
 	switch (b_profile.flags
 		& (BRIDGE_OPT_REMB_BEHAVIOR_AVERAGE | BRIDGE_OPT_REMB_BEHAVIOR_LOWEST
@@ -2393,6 +2426,7 @@ int conf_load_config(void)
 	aco_option_register(&cfg_info, "internal_sample_rate", ACO_EXACT, bridge_types, "0", OPT_UINT_T, PARSE_DEFAULT, FLDSET(struct bridge_profile, internal_sample_rate), 0);
 	aco_option_register(&cfg_info, "binaural_active", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_BINAURAL_ACTIVE);
 	aco_option_register(&cfg_info, "maximum_sample_rate", ACO_EXACT, bridge_types, "0", OPT_UINT_T, PARSE_DEFAULT, FLDSET(struct bridge_profile, maximum_sample_rate), 0);
+	aco_option_register(&cfg_info, "max_mixed_talkers", ACO_EXACT, bridge_types, "0", OPT_UINT_T, 0, FLDSET(struct bridge_profile, max_mixed_talkers));
 	aco_option_register_custom(&cfg_info, "mixing_interval", ACO_EXACT, bridge_types, "20", mix_interval_handler, 0);
 	aco_option_register(&cfg_info, "record_conference", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_CONFERENCE);
 	aco_option_register_custom(&cfg_info, "video_mode", ACO_EXACT, bridge_types, NULL, video_mode_handler, 0);
@@ -2408,6 +2442,7 @@ int conf_load_config(void)
 	aco_option_register(&cfg_info, "video_update_discard", ACO_EXACT, bridge_types, "2000", OPT_UINT_T, 0, FLDSET(struct bridge_profile, video_update_discard));
 	aco_option_register(&cfg_info, "remb_send_interval", ACO_EXACT, bridge_types, "0", OPT_UINT_T, 0, FLDSET(struct bridge_profile, remb_send_interval));
 	aco_option_register_custom(&cfg_info, "remb_behavior", ACO_EXACT, bridge_types, "average", remb_behavior_handler, 0);
+	aco_option_register(&cfg_info, "remb_min_bitrate", ACO_EXACT, bridge_types, "0", OPT_UINT_T, 0, FLDSET(struct bridge_profile, remb_min_bitrate));
 	aco_option_register(&cfg_info, "enable_events", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_ENABLE_EVENTS);
 	/* This option should only be used with the CONFBRIDGE dialplan function */
 	aco_option_register_custom(&cfg_info, "template", ACO_EXACT, bridge_types, NULL, bridge_template_handler, 0);
@@ -230,10 +230,12 @@ struct bridge_profile {
 	unsigned int internal_sample_rate; /*!< The internal sample rate of the bridge. 0 when set to auto adjust mode. */
 	unsigned int maximum_sample_rate; /*!< The maximum sample rate of the bridge. 0 when set to no maximum. */
 	unsigned int mix_interval;  /*!< The internal mixing interval used by the bridge. When set to 0 the bridgewill use a default interval. */
+	unsigned int max_mixed_talkers; /*!< The most talkers mixed at once, the loudest ones. 0 when every talker is mixed. */
 	struct bridge_profile_sounds *sounds;
 	char regcontext[AST_MAX_CONTEXT];
 	unsigned int video_update_discard; /*!< Amount of time after sending a video update request that subsequent requests should be discarded */
 	unsigned int remb_send_interval; /*!< Interval at which a combined REMB frame is sent to video sources */
+	unsigned int remb_min_bitrate; /*!< Bitrate per video source below which a receiver is sent no video, 0 when disabled */
 };
 
 /*! \brief The structure that represents a conference bridge */
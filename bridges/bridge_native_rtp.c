@@ -43,6 +43,23 @@
 #include "asterisk/bridge_technology.h"
 #include "asterisk/frame.h"
 #include "asterisk/rtp_engine.h"
+#include "asterisk/config.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/astobj2.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+/*! \brief Locally bridged RTP can be read by a pool of I/O threads */
+#define NATIVE_RTP_IO
+#endif
+
+#define CONFIG_FILE_NAME "bridge_native_rtp.conf"
+
+/*! \brief Most I/O threads that can be configured */
+#define NATIVE_RTP_IO_THREADS_MAX	64
+
+/*! \brief Most socket events an I/O thread handles per wakeup */
+#define NATIVE_RTP_IO_EVENTS	64
 
 /*! \brief Internal structure which contains bridged RTP channel hook data */
 struct native_rtp_framehook_data {
@@ -83,8 +100,387 @@ struct native_rtp_bridge_channel_data {
 	struct ast_rtp_glue *remote_cb;
 	/*! \brief Channel's cached RTP glue information */
 	struct rtp_glue_data glue;
+	/*! \brief Channel's audio stream while read by an I/O thread */
+	struct native_rtp_io *io;
+};
+
+#ifdef NATIVE_RTP_IO
+/*! \brief A thread reading the RTP of many locally bridged channels */
+struct native_rtp_io_thread {
+	ast_mutex_t lock;
+	pthread_t thread;
+	/*! epoll instance with the RTP sockets and the alert pipe */
+	int epfd;
+	/*! Wakes the thread up to release streams or exit */
+	int alert_pipe[2];
+	/*! Set when the thread should exit (Protected by lock) */
+	unsigned int stop;
+	/*! Streams removed since the thread last waited (Protected by lock) */
+	AST_LIST_HEAD_NOLOCK(, native_rtp_io) removed;
+};
+
+/*!
+ * \brief An RTP stream read by an I/O thread instead of its channel's thread
+ *
+ * \details While the stream is read by an I/O thread its socket is taken out of
+ * the channel's file descriptors, so the channel thread only wakes for frames
+ * queued to it.  The packets are relayed to the bridged RTP instance the same
+ * way the channel thread would have relayed them.
+ */
+struct native_rtp_io {
+	/*! The channel the stream belongs to */
+	struct ast_channel *chan;
+	/*! The RTP instance read */
+	struct ast_rtp_instance *instance;
+	/*! Glue callbacks of the channel's technology */
+	struct ast_rtp_glue *cb;
+	/*! The thread reading the stream */
+	struct native_rtp_io_thread *thread;
+	/*! The RTP socket */
+	int fd;
+	/*! The channel file descriptor the socket was taken from */
+	int fdno;
+	/*! Set once the stream is no longer read by the thread (Protected by the thread lock) */
+	unsigned int removed;
+	AST_LIST_ENTRY(native_rtp_io) list;
 };
 
+static struct native_rtp_io_thread *io_threads;
+static unsigned int io_thread_count;
+static unsigned int io_thread_next;
+
+static void native_rtp_io_destroy(void *obj)
+{
+	struct native_rtp_io *io = obj;
+
+	ao2_cleanup(io->instance);
+	ast_channel_cleanup(io->chan);
+}
+
+/*!
+ * \internal
+ * \brief Give the socket of a stream back to its channel
+ *
+ * \note The channel must be locked.
+ */
+static void native_rtp_io_restore(struct native_rtp_io *io)
+{
+	struct ast_rtp_instance *current = NULL;
+
+	/*
+	 * Only if the channel driver has not changed its descriptors in the
+	 * meantime and the instance is still the channel's audio stream.
+	 */
+	if (ast_channel_fd(io->chan, io->fdno) != -1
+		|| ast_rtp_instance_fd(io->instance, 0) != io->fd) {
+		return;
+	}
+	io->cb->get_rtp_info(io->chan, &current);
+	if (current == io->instance) {
+		ast_channel_set_fd(io->chan, io->fdno, io->fd);
+	}
+	ao2_cleanup(current);
+}
+
+/*!
+ * \internal
+ * \brief Stop an I/O thread reading a stream
+ *
+ * \retval 1 if the stream was removed from the thread.
+ * \retval 0 if it already was.
+ */
+static int native_rtp_io_remove(struct native_rtp_io *io)
+{
+	struct native_rtp_io_thread *thread = io->thread;
+
+	ast_mutex_lock(&thread->lock);
+	if (io->removed) {
+		ast_mutex_unlock(&thread->lock);
+		return 0;
+	}
+	epoll_ctl(thread->epfd, EPOLL_CTL_DEL, io->fd, NULL);
+	io->removed = 1;
+	/*
+	 * The thread may still hold the stream from its last wait so it
+	 * releases the reference of the epoll registration itself.
+	 */
+	AST_LIST_INSERT_TAIL(&thread->removed, io, list);
+	ast_mutex_unlock(&thread->lock);
+
+	ast_alertpipe_write(thread->alert_pipe);
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Read what arrived on a stream
+ */
+static void native_rtp_io_read(struct native_rtp_io *io)
+{
+	struct ast_frame *frame;
+	struct ast_frame *cur;
+
+	frame = ast_rtp_instance_read(io->instance, 0);
+	if (frame) {
+		ast_rtp_instance_set_last_rx(io->instance, time(NULL));
+	}
+	if (frame == &ast_null_frame) {
+		/* Relayed or nothing to do */
+		return;
+	}
+
+	for (cur = frame; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+		if (cur->frametype == AST_FRAME_VOICE) {
+			break;
+		}
+	}
+	if (!frame || cur) {
+		/*
+		 * Audio that could not be relayed, such as a format change, needs
+		 * the channel driver to look at it.  Hand the socket back.
+		 */
+		ast_debug(2, "Channel '%s' RTP is read by its own thread again\n",
+			ast_channel_name(io->chan));
+		if (native_rtp_io_remove(io)) {
+			ast_channel_lock(io->chan);
+			native_rtp_io_restore(io);
+			ast_channel_unlock(io->chan);
+		}
+		if (frame) {
+			ast_frfree(frame);
+		}
+		return;
+	}
+
+	/* DTMF and the like go to the channel as if it had read them. */
+	ast_queue_frame(io->chan, frame);
+	ast_frfree(frame);
+}
+
+static void *native_rtp_io_thread_run(void *data)
+{
+	struct native_rtp_io_thread *thread = data;
+	struct epoll_event events[NATIVE_RTP_IO_EVENTS];
+	struct native_rtp_io *ready[NATIVE_RTP_IO_EVENTS];
+	struct native_rtp_io *io;
+	int count;
+	int num_ready;
+	int i;
+
+	for (;;) {
+		ast_mutex_lock(&thread->lock);
+		while ((io = AST_LIST_REMOVE_HEAD(&thread->removed, list))) {
+			ao2_ref(io, -1);
+		}
+		if (thread->stop) {
+			ast_mutex_unlock(&thread->lock);
+			break;
+		}
+		ast_mutex_unlock(&thread->lock);
+
+		count = epoll_wait(thread->epfd, events, ARRAY_LEN(events), -1);
+		if (count < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_WARNING, "Native RTP I/O thread wait failed: %s\n", strerror(errno));
+			}
+			continue;
+		}
+
+		/* Streams removed since the wait returned are skipped. */
+		num_ready = 0;
+		ast_mutex_lock(&thread->lock);
+		for (i = 0; i < count; ++i) {
+			io = events[i].data.ptr;
+			if (!io) {
+				ast_alertpipe_read(thread->alert_pipe);
+			} else if (!io->removed) {
+				ready[num_ready++] = ao2_bump(io);
+			}
+		}
+		ast_mutex_unlock(&thread->lock);
+
+		for (i = 0; i < num_ready; ++i) {
+			native_rtp_io_read(ready[i]);
+			ao2_ref(ready[i], -1);
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Have an I/O thread read the audio of a locally bridged channel
+ *
+ * \note The channel must be locked.
+ *
+ * \return The stream or NULL if the channel thread keeps reading it.
+ */
+static struct native_rtp_io *native_rtp_io_start(struct ast_channel *chan, struct rtp_glue_data *glue)
+{
+	struct native_rtp_io *io;
+	struct epoll_event event = { .events = EPOLLIN, };
+	int fd;
+	int fdno;
+
+	if (!io_thread_count || !glue->audio.instance) {
+		return NULL;
+	}
+
+	fd = ast_rtp_instance_fd(glue->audio.instance, 0);
+	if (fd < 0) {
+		return NULL;
+	}
+	for (fdno = 0; fdno < ast_channel_fd_count(chan); ++fdno) {
+		if (ast_channel_fd(chan, fdno) == fd) {
+			break;
+		}
+	}
+	if (fdno == ast_channel_fd_count(chan)) {
+		/* The channel does not read the socket itself. */
+		return NULL;
+	}
+
+	io = ao2_alloc_options(sizeof(*io), native_rtp_io_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!io) {
+		return NULL;
+	}
+	io->chan = ast_channel_ref(chan);
+	io->instance = ao2_bump(glue->audio.instance);
+	io->cb = glue->cb;
+	io->fd = fd;
+	io->fdno = fdno;
+	io->thread = &io_threads[ast_atomic_fetchadd_int((int *) &io_thread_next, +1) % io_thread_count];
+
+	/* The epoll registration holds a reference, released by the thread. */
+	event.data.ptr = ao2_bump(io);
+	if (epoll_ctl(io->thread->epfd, EPOLL_CTL_ADD, fd, &event)) {
+		ast_log(LOG_WARNING, "Could not have channel '%s' RTP read by an I/O thread: %s\n",
+			ast_channel_name(chan), strerror(errno));
+		ao2_ref(io, -2);
+		return NULL;
+	}
+	ast_channel_set_fd(chan, fdno, -1);
+
+	ast_debug(2, "Channel '%s' RTP is read by an I/O thread\n", ast_channel_name(chan));
+	return io;
+}
+
+/*!
+ * \internal
+ * \brief Give the audio of a channel back to the channel thread
+ *
+ * \note The channel must be locked.
+ */
+static void native_rtp_io_stop(struct native_rtp_io **io)
+{
+	if (!*io) {
+		return;
+	}
+
+	if (native_rtp_io_remove(*io)) {
+		native_rtp_io_restore(*io);
+	}
+	ao2_ref(*io, -1);
+	*io = NULL;
+}
+
+static void native_rtp_io_threads_stop(void)
+{
+	struct native_rtp_io *io;
+	unsigned int idx;
+
+	for (idx = 0; idx < io_thread_count; ++idx) {
+		struct native_rtp_io_thread *thread = &io_threads[idx];
+
+		ast_mutex_lock(&thread->lock);
+		thread->stop = 1;
+		ast_mutex_unlock(&thread->lock);
+		ast_alertpipe_write(thread->alert_pipe);
+		pthread_join(thread->thread, NULL);
+
+		while ((io = AST_LIST_REMOVE_HEAD(&thread->removed, list))) {
+			ao2_ref(io, -1);
+		}
+		close(thread->epfd);
+		ast_alertpipe_close(thread->alert_pipe);
+		ast_mutex_destroy(&thread->lock);
+	}
+
+	ast_free(io_threads);
+	io_threads = NULL;
+	io_thread_count = 0;
+}
+
+static int native_rtp_io_threads_start(unsigned int count)
+{
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL, };
+
+	if (!count) {
+		return 0;
+	}
+
+	io_threads = ast_calloc(count, sizeof(*io_threads));
+	if (!io_threads) {
+		return -1;
+	}
+
+	for (io_thread_count = 0; io_thread_count < count; ++io_thread_count) {
+		struct native_rtp_io_thread *thread = &io_threads[io_thread_count];
+
+		ast_mutex_init(&thread->lock);
+		AST_LIST_HEAD_INIT_NOLOCK(&thread->removed);
+		if (ast_alertpipe_init(thread->alert_pipe)) {
+			ast_mutex_destroy(&thread->lock);
+			break;
+		}
+		thread->epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (thread->epfd < 0
+			|| epoll_ctl(thread->epfd, EPOLL_CTL_ADD, ast_alertpipe_readfd(thread->alert_pipe), &event)
+			|| ast_pthread_create(&thread->thread, NULL, native_rtp_io_thread_run, thread)) {
+			if (thread->epfd >= 0) {
+				close(thread->epfd);
+			}
+			ast_alertpipe_close(thread->alert_pipe);
+			ast_mutex_destroy(&thread->lock);
+			break;
+		}
+	}
+
+	if (io_thread_count != count) {
+		ast_log(LOG_ERROR, "Could not start native RTP I/O threads\n");
+		native_rtp_io_threads_stop();
+		return -1;
+	}
+
+	ast_debug(1, "Started %u native RTP I/O threads\n", count);
+	return 0;
+}
+#else
+struct native_rtp_io;
+
+static struct native_rtp_io *native_rtp_io_start(struct ast_channel *chan, struct rtp_glue_data *glue)
+{
+	return NULL;
+}
+
+static void native_rtp_io_stop(struct native_rtp_io **io)
+{
+}
+
+static void native_rtp_io_threads_stop(void)
+{
+}
+
+static int native_rtp_io_threads_start(unsigned int count)
+{
+	if (count) {
+		ast_log(LOG_WARNING, "Native RTP I/O threads are not supported on this platform\n");
+	}
+	return 0;
+}
+#endif /* NATIVE_RTP_IO */
+
 static void rtp_glue_data_init(struct rtp_glue_data *glue)
 {
 	glue->cb = NULL;
@@ -323,6 +719,12 @@ static void native_rtp_bridge_start(struct ast_bridge *bridge, struct ast_channe
 		}
 		ast_rtp_instance_set_bridged(glue0->audio.instance, glue1->audio.instance);
 		ast_rtp_instance_set_bridged(glue1->audio.instance, glue0->audio.instance);
+		if (!data0->io) {
+			data0->io = native_rtp_io_start(bc0->chan, glue0);
+		}
+		if (!data1->io) {
+			data1->io = native_rtp_io_start(bc1->chan, glue1);
+		}
 		ast_verb(4, "Locally RTP bridged '%s' and '%s' in stack\n",
 			ast_channel_name(bc0->chan), ast_channel_name(bc1->chan));
 		break;
@@ -466,6 +868,9 @@ static void native_rtp_bridge_stop(struct ast_bridge *bridge, struct ast_channel
 
 	ast_channel_lock_both(bc0->chan, bc1->chan);
 
+	native_rtp_io_stop(&data0->io);
+	native_rtp_io_stop(&data1->io);
+
 	switch (glue0->result) {
 	case AST_RTP_GLUE_RESULT_LOCAL:
 		if (ast_rtp_instance_get_engine(glue0->audio.instance)->local_bridge) {
@@ -951,14 +1356,46 @@ static struct ast_bridge_technology native_rtp_bridge = {
 	.compatible = native_rtp_bridge_compatible,
 };
 
+/*!
+ * \internal
+ * \brief Get the number of I/O threads to read locally bridged RTP with
+ */
+static unsigned int native_rtp_io_threads_load(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	const char *value;
+	unsigned int count = 0;
+
+	cfg = ast_config_load(CONFIG_FILE_NAME, config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return 0;
+	}
+
+	value = ast_variable_retrieve(cfg, "general", "io_threads");
+	if (value && (sscanf(value, "%30u", &count) != 1 || count > NATIVE_RTP_IO_THREADS_MAX)) {
+		ast_log(LOG_WARNING, "Invalid io_threads '%s' in %s, must be 0 to %d\n",
+			value, CONFIG_FILE_NAME, NATIVE_RTP_IO_THREADS_MAX);
+		count = 0;
+	}
+
+	ast_config_destroy(cfg);
+	return count;
+}
+
 static int unload_module(void)
 {
 	ast_bridge_technology_unregister(&native_rtp_bridge);
+	native_rtp_io_threads_stop();
 	return 0;
 }
 
 static int load_module(void)
 {
+	if (native_rtp_io_threads_start(native_rtp_io_threads_load())) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (ast_bridge_technology_register(&native_rtp_bridge)) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
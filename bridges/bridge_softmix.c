@@ -39,6 +39,8 @@
 #include "asterisk/test.h"
 #include "asterisk/vector.h"
 #include "asterisk/message.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 #include "bridge_softmix/include/bridge_softmix_internal.h"
 
 /*! The minimum sample rate of the bridge. */
@@ -56,6 +58,15 @@
 /*! \brief Number of mixing iterations to perform between gathering statistics. */
 #define SOFTMIX_STAT_INTERVAL 100
 
+/*! \brief Number of participants at which writing out the mix is split across the worker pool. */
+#define SOFTMIX_PARALLEL_WRITE_CHANNELS 64
+
+/*! \brief Number of participants written out by each worker pool task. */
+#define SOFTMIX_PARALLEL_WRITE_CHUNK 16
+
+/*! \brief Seconds an idle worker pool thread is kept around. */
+#define SOFTMIX_POOL_IDLE_TIMEOUT 60
+
 /*!
  * \brief Default time in ms of silence necessary to declare talking stopped by the bridge.
  *
@@ -68,6 +79,15 @@
 /*! Default minimum average magnitude threshold to determine talking by the DSP. */
 #define DEFAULT_SOFTMIX_TALKING_THRESHOLD 160
 
+/*! Weight of the average energy of a channel against the energy of a new frame. */
+#define SOFTMIX_ENERGY_WEIGHT 4
+
+/*! How many times louder a talker being mixed counts when picking the loudest talkers. */
+#define SOFTMIX_TALKER_HYSTERESIS 2
+
+/*! How many times the minimum REMB bitrate a paused receiver must report to be sent video again. */
+#define SOFTMIX_REMB_RESUME_FACTOR 2
+
 #define SOFTBRIDGE_VIDEO_DEST_PREFIX "softbridge_dest"
 #define SOFTBRIDGE_VIDEO_DEST_LEN strlen(SOFTBRIDGE_VIDEO_DEST_PREFIX)
 #define SOFTBRIDGE_VIDEO_DEST_SEPARATOR '_'
@@ -103,6 +123,7 @@ struct softmix_stats {
 struct softmix_translate_helper_entry {
 	int num_times_requested; /*!< Once this entry is no longer requested, free the trans_pvt
 								  and re-init if it was usable. */
+	int num_shared; /*!< The number of channels using out_frame in a parallel write out */
 	struct ast_format *dst_format; /*!< The destination format for this helper */
 	struct ast_trans_pvt *trans_pvt; /*!< the translator for this slot. */
 	struct ast_frame *out_frame; /*!< The output frame from the last translation */
@@ -205,14 +226,11 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 	struct softmix_channel *sc, unsigned int default_sample_size)
 {
 	struct softmix_translate_helper_entry *entry = NULL;
-	int i;
 
 	/* If we provided audio that was not determined to be silence,
 	 * then take it out while in slinear format. */
 	if (sc->have_audio && sc->talking && !sc->binaural) {
-		for (i = 0; i < sc->write_frame.samples; i++) {
-			ast_slinear_saturated_subtract(&sc->final_buf[i], &sc->our_buf[i]);
-		}
+		softmix_mix->subtract(sc->final_buf, sc->our_buf, sc->write_frame.samples);
 		/* check to see if any entries exist for the format. if not we'll want
 		   to remove it during cleanup */
 		AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
@@ -269,6 +287,66 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 	}
 }
 
+/*!
+ * \internal
+ * \brief Get the translated mix a channel not talking can be given as is
+ *
+ * \details Channels that do not need their own audio removed from the mix
+ * all get the same frame.  Once one of them has had the mix translated to a
+ * shared format the others are given that frame, avoiding copying the mix
+ * and the translation into the buffer of each channel.
+ *
+ * \param trans_helper The translation helper of the mixing thread.
+ * \param raw_write_fmt The write format of the channel.
+ *
+ * \return The shared frame or NULL if the channel must build its own.
+ */
+static struct ast_frame *softmix_translate_helper_shared_frame(
+	struct softmix_translate_helper *trans_helper, struct ast_format *raw_write_fmt)
+{
+	struct softmix_translate_helper_entry *entry;
+
+	AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
+		if (ast_format_cmp(entry->dst_format, raw_write_fmt) != AST_FORMAT_CMP_EQUAL) {
+			continue;
+		}
+		if (entry->out_frame && entry->out_frame->frametype == AST_FRAME_VOICE
+			&& entry->out_frame->datalen < MAX_DATALEN) {
+			++entry->num_times_requested;
+			return entry->out_frame;
+		}
+		break;
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Give a channel not talking the mix another channel had translated
+ *
+ * \retval 1 if the shared frame was queued to the channel.
+ * \retval 0 if the channel must build its own frame.
+ */
+static int softmix_write_shared_frame(struct softmix_translate_helper *trans_helper,
+	struct ast_bridge_channel *bridge_channel)
+{
+	struct softmix_channel *sc = bridge_channel->tech_pvt;
+	struct ast_frame *shared_frame = NULL;
+
+	ast_mutex_lock(&sc->lock);
+	if (!(sc->have_audio && sc->talking) && !sc->binaural) {
+		shared_frame = softmix_translate_helper_shared_frame(trans_helper,
+			ast_channel_rawwriteformat(bridge_channel->chan));
+	}
+	ast_mutex_unlock(&sc->lock);
+
+	if (!shared_frame) {
+		return 0;
+	}
+	ast_bridge_channel_queue_frame(bridge_channel, shared_frame);
+	return 1;
+}
+
 static void softmix_translate_helper_cleanup(struct softmix_translate_helper *trans_helper)
 {
 	struct softmix_translate_helper_entry *entry;
@@ -297,10 +375,307 @@ static void softmix_translate_helper_cleanup(struct softmix_translate_helper *tr
 		   of references to a given entry is recalculated, so reset the number of
 		   times requested */
 		entry->num_times_requested = 0;
+		entry->num_shared = 0;
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
 }
 
+/*! \brief Worker pool helping the mixing threads of large bridges write out the mix */
+static struct ast_threadpool *softmix_pool;
+
+/*! \brief Write out of the mix for one channel in a parallel write out */
+struct softmix_write_item {
+	struct ast_bridge_channel *bridge_channel;
+	/*! The shared translation to give the channel or NULL */
+	struct softmix_translate_helper_entry *entry;
+	/*! TRUE if the channel's own audio must be removed from the mix */
+	int remove_own;
+};
+
+/*! \brief Work shared by the tasks of a parallel write out */
+struct softmix_write_run {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! The number of tasks not yet done */
+	unsigned int pending;
+	/*! The mixed audio in the bridge's signed linear format */
+	struct ast_frame mix_frame;
+};
+
+/*! \brief A worker pool task of a parallel write out */
+struct softmix_write_task {
+	struct softmix_write_run *run;
+	/*! The shared translation to perform or NULL */
+	struct softmix_translate_helper_entry *entry;
+	/*! The channels to write out */
+	struct softmix_write_item *items;
+	unsigned int num_items;
+};
+
+/*! \brief Storage kept by the mixing thread between parallel write outs */
+struct softmix_parallel_write {
+	AST_VECTOR(, struct softmix_write_item) items;
+	AST_VECTOR(, struct softmix_write_task) tasks;
+	AST_VECTOR(, struct ast_taskprocessor_task) batch;
+};
+
+static void softmix_parallel_write_destroy(struct softmix_parallel_write *parallel)
+{
+	AST_VECTOR_FREE(&parallel->items);
+	AST_VECTOR_FREE(&parallel->tasks);
+	AST_VECTOR_FREE(&parallel->batch);
+}
+
+/*!
+ * \internal
+ * \brief Request a shared translation of the mix for a parallel write out
+ *
+ * \details Like softmix_process_write_audio() this tracks the translation
+ * paths that are wanted by the channels, but the translation itself is
+ * left for the worker pool.
+ *
+ * \param trans_helper The translation helper of the mixing thread.
+ * \param raw_write_fmt The write format of the channel.
+ * \param share TRUE if the channel can use a translation of the mix.
+ *
+ * \return The entry whose out_frame the channel shares or NULL.
+ */
+static struct softmix_translate_helper_entry *softmix_translate_helper_request(
+	struct softmix_translate_helper *trans_helper, struct ast_format *raw_write_fmt, int share)
+{
+	struct softmix_translate_helper_entry *entry;
+
+	AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
+		if (ast_format_cmp(entry->dst_format, raw_write_fmt) == AST_FORMAT_CMP_EQUAL) {
+			break;
+		}
+	}
+
+	if (!share) {
+		if (entry) {
+			++entry->num_times_requested;
+		}
+		return NULL;
+	}
+
+	if (!entry) {
+		/* A format used by a single channel is translated by the channel itself. */
+		if ((entry = softmix_translate_helper_entry_alloc(raw_write_fmt))) {
+			AST_LIST_INSERT_HEAD(&trans_helper->entries, entry, entry);
+			++entry->num_shared;
+		}
+		return entry;
+	}
+
+	++entry->num_times_requested;
+	++entry->num_shared;
+	if (!entry->trans_pvt && entry->num_times_requested > 1) {
+		entry->trans_pvt = ast_translator_build_path(entry->dst_format, trans_helper->slin_src);
+	}
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Write out the mix to one channel of a parallel write out
+ */
+static void softmix_write_item_exec(struct softmix_write_run *run, struct softmix_write_item *item)
+{
+	struct softmix_channel *sc = item->bridge_channel->tech_pvt;
+	struct softmix_translate_helper_entry *entry = item->entry;
+
+	if (!item->remove_own && entry && entry->out_frame
+		&& entry->out_frame->frametype == AST_FRAME_VOICE
+		&& entry->out_frame->datalen < MAX_DATALEN) {
+		/* Channels sharing the translated mix are all given the same frame. */
+		ast_bridge_channel_queue_frame(item->bridge_channel, entry->out_frame);
+		return;
+	}
+
+	ast_mutex_lock(&sc->lock);
+	ao2_t_replace(sc->write_frame.subclass.format, run->mix_frame.subclass.format,
+		"Replace softmix channel slin format");
+	sc->write_frame.datalen = run->mix_frame.datalen;
+	sc->write_frame.samples = run->mix_frame.samples;
+	memcpy(sc->final_buf, run->mix_frame.data.ptr, run->mix_frame.datalen);
+
+	if (item->remove_own) {
+		softmix_mix->subtract(sc->final_buf, sc->our_buf, sc->write_frame.samples);
+	}
+	ast_mutex_unlock(&sc->lock);
+
+	/* A frame is now ready for the channel. */
+	ast_bridge_channel_queue_frame(item->bridge_channel, &sc->write_frame);
+}
+
+static void softmix_write_task_work(struct softmix_write_task *task)
+{
+	unsigned int idx;
+
+	if (task->entry) {
+		/* Each task translates from its own copy of the mix frame. */
+		struct ast_frame mix_frame = task->run->mix_frame;
+
+		task->entry->out_frame = ast_translate(task->entry->trans_pvt, &mix_frame, 0);
+	}
+	for (idx = 0; idx < task->num_items; ++idx) {
+		softmix_write_item_exec(task->run, &task->items[idx]);
+	}
+}
+
+static int softmix_write_task_exec(void *data)
+{
+	struct softmix_write_task *task = data;
+	struct softmix_write_run *run = task->run;
+
+	softmix_write_task_work(task);
+
+	ast_mutex_lock(&run->lock);
+	if (!--run->pending) {
+		ast_cond_signal(&run->cond);
+	}
+	ast_mutex_unlock(&run->lock);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Run the queued tasks on the worker pool and wait for them.
+ *
+ * \details The mixing thread runs the last task itself.  If the tasks
+ * cannot be given to the pool the mixing thread runs all of them.
+ */
+static void softmix_parallel_write_run_tasks(struct softmix_parallel_write *parallel,
+	struct softmix_write_run *run)
+{
+	size_t count = AST_VECTOR_SIZE(&parallel->tasks);
+	size_t idx;
+
+	if (!count) {
+		return;
+	}
+
+	run->pending = count;
+	AST_VECTOR_RESET(&parallel->batch, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	for (idx = 0; idx + 1 < count; ++idx) {
+		struct ast_taskprocessor_task task = {
+			.task_exe = softmix_write_task_exec,
+			.datap = AST_VECTOR_GET_ADDR(&parallel->tasks, idx),
+		};
+
+		if (AST_VECTOR_APPEND(&parallel->batch, task)) {
+			break;
+		}
+	}
+
+	if (idx + 1 < count
+		|| ast_threadpool_push_batch(softmix_pool, AST_VECTOR_GET_ADDR(&parallel->batch, 0),
+			AST_VECTOR_SIZE(&parallel->batch))) {
+		/* Do it all ourselves. */
+		for (idx = 0; idx + 1 < count; ++idx) {
+			softmix_write_task_exec(AST_VECTOR_GET_ADDR(&parallel->tasks, idx));
+		}
+	}
+	softmix_write_task_exec(AST_VECTOR_GET_ADDR(&parallel->tasks, count - 1));
+
+	ast_mutex_lock(&run->lock);
+	while (run->pending) {
+		ast_cond_wait(&run->cond, &run->lock);
+	}
+	ast_mutex_unlock(&run->lock);
+	AST_VECTOR_RESET(&parallel->tasks, AST_VECTOR_ELEM_CLEANUP_NOOP);
+}
+
+/*!
+ * \internal
+ * \brief Write out the mix to the channels of a large bridge using the worker pool.
+ *
+ * \details The shared translations of the mix are done first, one task per
+ * format, so channels using the same codec still share one encode.  Then the
+ * channels are split into chunks that remove their own audio if talking,
+ * pick up the shared translation, and queue the frame.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the serial write out has to be used.
+ */
+static int softmix_parallel_write(struct ast_bridge *bridge,
+	struct softmix_parallel_write *parallel, struct softmix_translate_helper *trans_helper,
+	struct ast_format *slin, int16_t *buf, unsigned int datalen, unsigned int samples)
+{
+	struct ast_bridge_channel *bridge_channel;
+	struct softmix_translate_helper_entry *entry;
+	struct softmix_write_run run = {
+		.mix_frame = {
+			.frametype = AST_FRAME_VOICE,
+			.subclass.format = slin,
+			.data.ptr = buf,
+			.datalen = datalen,
+			.samples = samples,
+		},
+	};
+	size_t idx;
+
+	AST_VECTOR_RESET(&parallel->items, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	AST_VECTOR_RESET(&parallel->tasks, AST_VECTOR_ELEM_CLEANUP_NOOP);
+
+	/* Decide what every channel gets while holding only the bridge lock. */
+	AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+		struct softmix_channel *sc = bridge_channel->tech_pvt;
+		struct softmix_write_item item = { .bridge_channel = bridge_channel, };
+		int share;
+
+		if (!sc || bridge_channel->suspended) {
+			/* This channel failed to join successfully or is suspended. */
+			continue;
+		}
+
+		ast_mutex_lock(&sc->lock);
+		item.remove_own = sc->have_audio && sc->talking && !sc->binaural;
+		share = !item.remove_own && !sc->binaural;
+		ast_mutex_unlock(&sc->lock);
+
+		item.entry = softmix_translate_helper_request(trans_helper,
+			ast_channel_rawwriteformat(bridge_channel->chan), share);
+		if (AST_VECTOR_APPEND(&parallel->items, item)) {
+			return -1;
+		}
+	}
+
+	ast_mutex_init(&run.lock);
+	ast_cond_init(&run.cond, NULL);
+
+	/* First translate the mix once for each format shared by several channels. */
+	AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
+		struct softmix_write_task task = { .run = &run, .entry = entry, };
+
+		if (!entry->trans_pvt || !entry->num_shared || entry->out_frame) {
+			continue;
+		}
+		if (AST_VECTOR_APPEND(&parallel->tasks, task)) {
+			softmix_write_task_work(&task);
+		}
+	}
+	softmix_parallel_write_run_tasks(parallel, &run);
+
+	/* Then write out the channels. */
+	for (idx = 0; idx < AST_VECTOR_SIZE(&parallel->items); idx += SOFTMIX_PARALLEL_WRITE_CHUNK) {
+		struct softmix_write_task task = {
+			.run = &run,
+			.items = AST_VECTOR_GET_ADDR(&parallel->items, idx),
+			.num_items = MIN(SOFTMIX_PARALLEL_WRITE_CHUNK, AST_VECTOR_SIZE(&parallel->items) - idx),
+		};
+
+		if (AST_VECTOR_APPEND(&parallel->tasks, task)) {
+			softmix_write_task_work(&task);
+		}
+	}
+	softmix_parallel_write_run_tasks(parallel, &run);
+
+	ast_cond_destroy(&run.cond);
+	ast_mutex_destroy(&run.lock);
+	return 0;
+}
+
 static void set_softmix_bridge_data(int rate, int interval, struct ast_bridge_channel *bridge_channel, int reset, int set_binaural, int binaural_pos_id, int is_announcement)
 {
 	struct softmix_channel *sc = bridge_channel->tech_pvt;
@@ -681,6 +1056,7 @@ static int softmix_bridge_join(struct ast_bridge *bridge, struct ast_bridge_chan
 	if (!softmix_data) {
 		return -1;
 	}
+	softmix_data->sfu_forwarding_stale = 1;
 
 	/* Create a new softmix_channel structure and allocate various things on it */
 	if (!(sc = ast_calloc(1, sizeof(*sc)))) {
@@ -796,6 +1172,8 @@ static void softmix_bridge_leave(struct ast_bridge *bridge, struct ast_bridge_ch
 	if (bridge->softmix.video_mode.mode == AST_BRIDGE_VIDEO_MODE_SFU) {
 		sfu_topologies_on_leave(bridge_channel, &bridge->channels);
 	}
+	/* The leaving channel must not stay a destination. */
+	softmix_data->sfu_forwarding_stale = 1;
 
 	if (bridge->softmix.binaural_active) {
 		if (sc->binaural) {
@@ -854,6 +1232,119 @@ static void softmix_pass_video_top_priority(struct ast_bridge *bridge, struct as
  *
  * \return Nothing
  */
+/*!
+ * \internal
+ * \brief Empty the SFU forwarding table of a bridge
+ */
+static void sfu_forwarding_clear(struct softmix_bridge_data *softmix_data)
+{
+	size_t idx;
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&softmix_data->sfu_forwarding); ++idx) {
+		AST_VECTOR_FREE(&AST_VECTOR_GET_ADDR(&softmix_data->sfu_forwarding, idx)->channels);
+	}
+	AST_VECTOR_RESET(&softmix_data->sfu_forwarding, AST_VECTOR_ELEM_CLEANUP_NOOP);
+}
+
+/*!
+ * \internal
+ * \brief Build the SFU forwarding table from the stream maps of the channels
+ *
+ * \note On entry, bridge is already locked.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error, the table stays stale.
+ */
+static int sfu_forwarding_build(struct ast_bridge *bridge, struct softmix_bridge_data *softmix_data)
+{
+	struct ast_bridge_channel *participant;
+
+	sfu_forwarding_clear(softmix_data);
+
+	AST_LIST_TRAVERSE(&bridge->channels, participant, entry) {
+		int bridge_num;
+
+		ast_bridge_channel_lock(participant);
+		for (bridge_num = 0; bridge_num < AST_VECTOR_SIZE(&participant->stream_map.to_channel); ++bridge_num) {
+			struct softmix_sfu_destinations empty = { { 0, }, };
+
+			if (AST_VECTOR_GET(&participant->stream_map.to_channel, bridge_num) == -1) {
+				continue;
+			}
+			while (AST_VECTOR_SIZE(&softmix_data->sfu_forwarding) <= bridge_num) {
+				if (AST_VECTOR_APPEND(&softmix_data->sfu_forwarding, empty)) {
+					ast_bridge_channel_unlock(participant);
+					sfu_forwarding_clear(softmix_data);
+					return -1;
+				}
+			}
+			if (AST_VECTOR_APPEND(&AST_VECTOR_GET_ADDR(&softmix_data->sfu_forwarding, bridge_num)->channels,
+				participant)) {
+				ast_bridge_channel_unlock(participant);
+				sfu_forwarding_clear(softmix_data);
+				return -1;
+			}
+		}
+		ast_bridge_channel_unlock(participant);
+	}
+
+	softmix_data->sfu_forwarding_stale = 0;
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Forward a video frame to the channels mapping its bridge stream
+ *
+ * \details The destinations of each bridge stream only change when the
+ * stream maps do, so they are looked up once rather than queueing the frame
+ * to every channel just to have most of them drop it.
+ *
+ * \note On entry, bridge is already locked.
+ *
+ * \retval 0 if the frame was forwarded.
+ * \retval -1 if it must be given to everyone else instead.
+ */
+static int sfu_forward_video(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel,
+	struct ast_frame *frame)
+{
+	struct softmix_bridge_data *softmix_data = bridge->tech_pvt;
+	struct softmix_sfu_destinations *destinations;
+	struct ast_frame *shared;
+	size_t idx;
+
+	if (frame->stream_num < 0) {
+		return -1;
+	}
+	if (softmix_data->sfu_forwarding_stale && sfu_forwarding_build(bridge, softmix_data)) {
+		return -1;
+	}
+	if (AST_VECTOR_SIZE(&softmix_data->sfu_forwarding) <= frame->stream_num) {
+		/* No channel has a stream for this source. */
+		return 0;
+	}
+
+	destinations = AST_VECTOR_GET_ADDR(&softmix_data->sfu_forwarding, frame->stream_num);
+	if (!AST_VECTOR_SIZE(&destinations->channels)) {
+		return 0;
+	}
+	shared = ast_frame_share(frame);
+	if (!shared) {
+		return -1;
+	}
+	for (idx = 0; idx < AST_VECTOR_SIZE(&destinations->channels); ++idx) {
+		struct ast_bridge_channel *destination = AST_VECTOR_GET(&destinations->channels, idx);
+
+		struct softmix_channel *sc = destination->tech_pvt;
+
+		if (destination != bridge_channel && sc && !sc->video_paused) {
+			ast_bridge_channel_queue_shared_frame(destination, shared);
+		}
+	}
+	ast_frfree(shared);
+	return 0;
+}
+
 static void softmix_bridge_write_video(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
 {
 	struct softmix_channel *sc;
@@ -888,10 +1379,10 @@ static void softmix_bridge_write_video(struct ast_bridge *bridge, struct ast_bri
 		}
 		break;
 	case AST_BRIDGE_VIDEO_MODE_SFU:
-		/* Nothing special to do here, the bridge channel stream map will ensure the
-		 * video goes everywhere it needs to
-		 */
-		ast_bridge_queue_everyone_else(bridge, bridge_channel, frame);
+		/* The bridge channel stream maps decide where the video goes. */
+		if (sfu_forward_video(bridge, bridge_channel, frame)) {
+			ast_bridge_queue_everyone_else(bridge, bridge_channel, frame);
+		}
 		break;
 	}
 }
@@ -951,6 +1442,7 @@ static void softmix_bridge_write_voice(struct ast_bridge *bridge, struct ast_bri
 	if (sc->dsp) {
 		silent = ast_dsp_silence_with_energy(sc->dsp, frame, &totalsilence, &cur_energy);
 	}
+	sc->energy = (sc->energy * (SOFTMIX_ENERGY_WEIGHT - 1) + cur_energy) / SOFTMIX_ENERGY_WEIGHT;
 
 	if (bridge->softmix.video_mode.mode == AST_BRIDGE_VIDEO_MODE_TALKER_SRC) {
 		int cur_slot = sc->video_talker.energy_history_cur_slot;
@@ -976,6 +1468,7 @@ static void softmix_bridge_write_voice(struct ast_bridge *bridge, struct ast_bri
 			sc->talking = 0;
 			update_talking = 0;
 		}
+		sc->mixed = 0;
 	}
 
 	/* Before adding audio in, make sure we haven't fallen behind. If audio has fallen
@@ -1373,6 +1866,37 @@ static void remb_collect_report_all(struct ast_bridge *bridge, struct softmix_br
 	}
 }
 
+/*!
+ * \internal
+ * \brief Pause or resume the video sent to a receiver from its REMB bitrate
+ *
+ * \param bridge The bridge
+ * \param bridge_channel The receiver
+ * \param sc The softmix channel of the receiver
+ * \param bitrate The estimated maximum bitrate of the receiver per video source
+ *
+ * \note On entry, bridge is already locked.
+ */
+static void remb_update_pause(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel,
+	struct softmix_channel *sc, float bitrate)
+{
+	unsigned int min_bitrate = bridge->softmix.video_mode.mode_data.sfu_data.remb_min_bitrate;
+
+	if (!min_bitrate) {
+		sc->video_paused = 0;
+	} else if (!sc->video_paused && bitrate < min_bitrate) {
+		ast_debug(1, "Bridge %s: Pausing video to '%s', estimated %.0f bps per source\n",
+			bridge->uniqueid, ast_channel_name(bridge_channel->chan), bitrate);
+		sc->video_paused = 1;
+	} else if (sc->video_paused && bitrate >= (float) min_bitrate * SOFTMIX_REMB_RESUME_FACTOR) {
+		ast_debug(1, "Bridge %s: Resuming video to '%s', estimated %.0f bps per source\n",
+			bridge->uniqueid, ast_channel_name(bridge_channel->chan), bitrate);
+		sc->video_paused = 0;
+		/* The receiver needs a full frame to decode what follows. */
+		sc->video_resumed = 1;
+	}
+}
+
 static void remb_collect_report(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel,
 	struct softmix_bridge_data *softmix_data, struct softmix_channel *sc)
 {
@@ -1396,6 +1920,14 @@ static void remb_collect_report(struct ast_bridge *bridge, struct ast_bridge_cha
 		return;
 	}
 
+	/* A receiver sent no video does not drag the senders down with it. */
+	remb_update_pause(bridge, bridge_channel, sc, bitrate);
+	if (sc->video_paused) {
+		sc->remb.br_mantissa = 0;
+		sc->remb.br_exp = 0;
+		return;
+	}
+
 	/* If we are using the "all" variants then we should use the bridge bitrate to store information */
 	if (bridge->softmix.video_mode.mode_data.sfu_data.remb_behavior == AST_BRIDGE_VIDEO_SFU_REMB_AVERAGE_ALL ||
 		bridge->softmix.video_mode.mode_data.sfu_data.remb_behavior == AST_BRIDGE_VIDEO_SFU_REMB_LOWEST_ALL ||
@@ -1672,6 +2204,11 @@ static int softmix_mixing_array_init(struct softmix_mixing_array *mixing_array,
 		ast_log(LOG_NOTICE, "Failed to allocate softmix mixing structure.\n");
 		return -1;
 	}
+	if (!(mixing_array->channels = ast_calloc(mixing_array->max_num_entries,
+			sizeof(struct softmix_channel *)))) {
+		ast_log(LOG_NOTICE, "Failed to allocate softmix mixing structure.\n");
+		return -1;
+	}
 	if (binaural_active) {
 		if (!(mixing_array->chan_pairs = ast_calloc(mixing_array->max_num_entries,
 				sizeof(struct convolve_channel_pair *)))) {
@@ -1686,6 +2223,7 @@ static void softmix_mixing_array_destroy(struct softmix_mixing_array *mixing_arr
 		unsigned int binaural_active)
 {
 	ast_free(mixing_array->buffers);
+	ast_free(mixing_array->channels);
 	if (binaural_active) {
 		ast_free(mixing_array->chan_pairs);
 	}
@@ -1695,6 +2233,7 @@ static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array,
 		unsigned int num_entries, unsigned int binaural_active)
 {
 	int16_t **tmp;
+	struct softmix_channel **tmp_channels;
 
 	/* give it some room to grow since memory is cheap but allocations can be expensive */
 	mixing_array->max_num_entries = num_entries;
@@ -1703,6 +2242,12 @@ static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array,
 		return -1;
 	}
 	mixing_array->buffers = tmp;
+	if (!(tmp_channels = ast_realloc(mixing_array->channels,
+			(mixing_array->max_num_entries * sizeof(struct softmix_channel *))))) {
+		ast_log(LOG_NOTICE, "Failed to re-allocate softmix mixing structure.\n");
+		return -1;
+	}
+	mixing_array->channels = tmp_channels;
 
 	if (binaural_active) {
 		struct convolve_channel_pair **tmp2;
@@ -1716,6 +2261,63 @@ static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array,
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Only keep the loudest talkers in the mixing array.
+ *
+ * \details The talkers that were mixed the last time they had audio count
+ * as louder than they are, so a new talker must be clearly louder to take
+ * their place and the mix does not flap between talkers of similar volume.
+ * The audio of the talkers left out is not in the mix, so it must not be
+ * removed from what they hear either.
+ *
+ * \param mixing_array The audio read from the channels this interval.
+ * \param max_talkers How many talkers to keep.
+ */
+static void softmix_limit_talkers(struct softmix_mixing_array *mixing_array,
+	unsigned int max_talkers)
+{
+	unsigned int idx;
+	unsigned int kept;
+	int scores[mixing_array->used_entries ?: 1];
+
+	for (idx = 0; idx < mixing_array->used_entries; ++idx) {
+		struct softmix_channel *sc = mixing_array->channels[idx];
+
+		ast_mutex_lock(&sc->lock);
+		scores[idx] = sc->mixed ? sc->energy * SOFTMIX_TALKER_HYSTERESIS : sc->energy;
+		ast_mutex_unlock(&sc->lock);
+	}
+
+	/* Move the loudest talkers to the front. */
+	for (kept = 0; kept < max_talkers && kept < mixing_array->used_entries; ++kept) {
+		unsigned int loudest = kept;
+
+		for (idx = kept + 1; idx < mixing_array->used_entries; ++idx) {
+			if (scores[loudest] < scores[idx]) {
+				loudest = idx;
+			}
+		}
+		if (loudest != kept) {
+			SWAP(scores[kept], scores[loudest]);
+			SWAP(mixing_array->buffers[kept], mixing_array->buffers[loudest]);
+			SWAP(mixing_array->channels[kept], mixing_array->channels[loudest]);
+		}
+	}
+
+	for (idx = 0; idx < mixing_array->used_entries; ++idx) {
+		struct softmix_channel *sc = mixing_array->channels[idx];
+
+		ast_mutex_lock(&sc->lock);
+		sc->mixed = idx < kept;
+		if (!sc->mixed) {
+			sc->have_audio = 0;
+		}
+		ast_mutex_unlock(&sc->lock);
+	}
+	mixing_array->used_entries = kept;
+}
+
 /*!
  * \brief Mixing loop.
  *
@@ -1729,6 +2331,7 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	struct softmix_bridge_data *softmix_data = bridge->tech_pvt;
 	struct ast_timer *timer;
 	struct softmix_translate_helper trans_helper;
+	struct softmix_parallel_write parallel;
 	int16_t buf[MAX_DATALEN];
 #ifdef BINAURAL_RENDERING
 	int16_t bin_buf[MAX_DATALEN];
@@ -1738,12 +2341,12 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	int timingfd;
 	int update_all_rates = 0; /* set this when the internal sample rate has changed */
 	unsigned int idx;
-	unsigned int x;
 	int res = -1;
 
 	timer = softmix_data->timer;
 	timingfd = ast_timer_fd(timer);
 	softmix_translate_helper_init(&trans_helper, softmix_data->internal_rate);
+	memset(&parallel, 0, sizeof(parallel));
 	ast_timer_set_rate(timer, (1000 / softmix_data->internal_mixing_interval));
 
 	/* Give the mixing array room to grow, memory is cheap but allocations are expensive. */
@@ -1763,6 +2366,7 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		unsigned int softmix_samples = SOFTMIX_SAMPLES(softmix_data->internal_rate, softmix_data->internal_mixing_interval);
 		unsigned int softmix_datalen = SOFTMIX_DATALEN(softmix_data->internal_rate, softmix_data->internal_mixing_interval);
 		int remb_update = 0;
+		int parallel_written;
 
 		if (softmix_datalen > MAX_DATALEN) {
 			/* This should NEVER happen, but if it does we need to know about it. Almost
@@ -1813,6 +2417,7 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		/* Go through pulling audio from each factory that has it available */
 		AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
 			struct softmix_channel *sc = bridge_channel->tech_pvt;
+			int video_resumed;
 
 			if (!sc) {
 				/* This channel failed to join successfully. */
@@ -1838,6 +2443,7 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 			/* Try to get audio from the factory if available */
 			ast_mutex_lock(&sc->lock);
 			if ((mixing_array.buffers[mixing_array.used_entries] = softmix_process_read_audio(sc, softmix_samples))) {
+				mixing_array.channels[mixing_array.used_entries] = sc;
 #ifdef BINAURAL_RENDERING
 				add_binaural_mixing(bridge, softmix_data, softmix_samples, &mixing_array, sc,
 						ast_channel_name(bridge_channel->chan));
@@ -1847,21 +2453,45 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 			if (remb_update) {
 				remb_collect_report(bridge, bridge_channel, softmix_data, sc);
 			}
+			video_resumed = sc->video_resumed;
+			sc->video_resumed = 0;
 			ast_mutex_unlock(&sc->lock);
+
+			if (video_resumed) {
+				struct ast_frame vidupdate = {
+					.frametype = AST_FRAME_CONTROL,
+					.subclass.integer = AST_CONTROL_VIDUPDATE,
+				};
+
+				ast_bridge_queue_everyone_else(bridge, bridge_channel, &vidupdate);
+			}
+		}
+
+		if (bridge->softmix.max_mixed_talkers && !bridge->softmix.binaural_active) {
+			softmix_limit_talkers(&mixing_array, bridge->softmix.max_mixed_talkers);
 		}
 
 		/* mix it like crazy (non binaural channels)*/
 		memset(buf, 0, softmix_datalen);
 		for (idx = 0; idx < mixing_array.used_entries; ++idx) {
-			for (x = 0; x < softmix_samples; ++x) {
-				ast_slinear_saturated_add(buf + x, mixing_array.buffers[idx] + x);
-			}
+			softmix_mix->add(buf, mixing_array.buffers[idx], softmix_samples);
 		}
 
 #ifdef BINAURAL_RENDERING
 		binaural_mixing(bridge, softmix_data, &mixing_array, bin_buf, ann_buf);
 #endif
 
+		/*
+		 * Large bridges have the worker pool remove each channel's own
+		 * audio and queue the frames.  Otherwise the mixing thread does
+		 * it all in the loop below.
+		 */
+		parallel_written = softmix_pool
+			&& !bridge->softmix.binaural_active
+			&& bridge->num_channels >= SOFTMIX_PARALLEL_WRITE_CHANNELS
+			&& !softmix_parallel_write(bridge, &parallel, &trans_helper, cur_slin, buf,
+				softmix_datalen, softmix_samples);
+
 		/* Next step go through removing the channel's own audio and creating a good frame... */
 		AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
 			struct softmix_channel *sc = bridge_channel->tech_pvt;
@@ -1871,32 +2501,38 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 				continue;
 			}
 
-			ast_mutex_lock(&sc->lock);
+			if (parallel_written) {
+				/* The worker pool already queued the frame. */
+			} else if (softmix_write_shared_frame(&trans_helper, bridge_channel)) {
+				/* The channel was given the mix another one had translated. */
+			} else {
+				ast_mutex_lock(&sc->lock);
 
-			/* Make SLINEAR write frame from local buffer */
-			ao2_t_replace(sc->write_frame.subclass.format, cur_slin,
-				"Replace softmix channel slin format");
+				/* Make SLINEAR write frame from local buffer */
+				ao2_t_replace(sc->write_frame.subclass.format, cur_slin,
+					"Replace softmix channel slin format");
 #ifdef BINAURAL_RENDERING
-			if (bridge->softmix.binaural_active && softmix_data->convolve.binaural_active
-					&& sc->binaural) {
-				create_binaural_frame(bridge_channel, sc, bin_buf, ann_buf, softmix_datalen,
-						softmix_samples, buf);
-			} else
+				if (bridge->softmix.binaural_active && softmix_data->convolve.binaural_active
+						&& sc->binaural) {
+					create_binaural_frame(bridge_channel, sc, bin_buf, ann_buf, softmix_datalen,
+							softmix_samples, buf);
+				} else
 #endif
-			{
-				sc->write_frame.datalen = softmix_datalen;
-				sc->write_frame.samples = softmix_samples;
-				memcpy(sc->final_buf, buf, softmix_datalen);
-			}
-			/* process the softmix channel's new write audio */
-			softmix_process_write_audio(&trans_helper,
-					ast_channel_rawwriteformat(bridge_channel->chan), sc,
-					softmix_data->default_sample_size);
+				{
+					sc->write_frame.datalen = softmix_datalen;
+					sc->write_frame.samples = softmix_samples;
+					memcpy(sc->final_buf, buf, softmix_datalen);
+				}
+				/* process the softmix channel's new write audio */
+				softmix_process_write_audio(&trans_helper,
+						ast_channel_rawwriteformat(bridge_channel->chan), sc,
+						softmix_data->default_sample_size);
 
-			ast_mutex_unlock(&sc->lock);
+				ast_mutex_unlock(&sc->lock);
 
-			/* A frame is now ready for the channel. */
-			ast_bridge_channel_queue_frame(bridge_channel, &sc->write_frame);
+				/* A frame is now ready for the channel. */
+				ast_bridge_channel_queue_frame(bridge_channel, &sc->write_frame);
+			}
 
 			if (remb_update) {
 				remb_send_report(bridge_channel, softmix_data, sc);
@@ -1941,6 +2577,7 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	res = 0;
 
 softmix_cleanup:
+	softmix_parallel_write_destroy(&parallel);
 	softmix_translate_helper_destroy(&trans_helper);
 	softmix_mixing_array_destroy(&mixing_array, bridge->softmix.binaural_active);
 	return res;
@@ -1960,6 +2597,8 @@ static void *softmix_mixing_thread(void *data)
 	struct softmix_bridge_data *softmix_data = data;
 	struct ast_bridge *bridge = softmix_data->bridge;
 
+	ast_thread_bind_media_cpus();
+
 	ast_bridge_lock(bridge);
 	if (bridge->callid) {
 		ast_callid_threadassoc_add(bridge->callid);
@@ -2034,6 +2673,8 @@ static void softmix_bridge_data_destroy(struct softmix_bridge_data *softmix_data
 	ast_cond_destroy(&softmix_data->cond);
 	AST_VECTOR_RESET(&softmix_data->remb_collectors, ao2_cleanup);
 	AST_VECTOR_FREE(&softmix_data->remb_collectors);
+	sfu_forwarding_clear(softmix_data);
+	AST_VECTOR_FREE(&softmix_data->sfu_forwarding);
 	ast_free(softmix_data);
 }
 
@@ -2065,6 +2706,8 @@ static int softmix_bridge_create(struct ast_bridge *bridge)
 #endif
 
 	AST_VECTOR_INIT(&softmix_data->remb_collectors, 0);
+	AST_VECTOR_INIT(&softmix_data->sfu_forwarding, 0);
+	softmix_data->sfu_forwarding_stale = 1;
 
 	bridge->tech_pvt = softmix_data;
 
@@ -2247,6 +2890,8 @@ static void softmix_bridge_stream_topology_changed(struct ast_bridge *bridge, st
 	int nths[AST_MEDIA_TYPE_END] = {0};
 	int idx;
 
+	softmix_data->sfu_forwarding_stale = 1;
+
 	switch (bridge->softmix.video_mode.mode) {
 	case AST_BRIDGE_VIDEO_MODE_NONE:
 	case AST_BRIDGE_VIDEO_MODE_SINGLE_SRC:
@@ -2660,24 +3305,178 @@ end:
 	return res;
 }
 
+/*! \brief Samples in 20ms of 48kHz audio plus an odd tail for the vector loops */
+#define MIX_TEST_SAMPLES (960 + 7)
+/*! \brief Participants mixed by the benchmark */
+#define MIX_BENCH_PARTICIPANTS 100
+/*! \brief Mixing intervals run by the benchmark */
+#define MIX_BENCH_ITERATIONS 500
+
+static void mix_test_fill(int16_t *samples, unsigned int count, unsigned int seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		seed = seed * 1103515245 + 12345;
+		/* Use full scale often enough to exercise saturation. */
+		samples[i] = (seed >> 8) & 1 ? (int16_t) (seed >> 16) : (seed >> 9) & 1 ? 32767 : -32768;
+	}
+}
+
+AST_TEST_DEFINE(softmix_mix_kernels_check)
+{
+	const struct softmix_mix_kernels *scalar = softmix_mix_kernels_get(0);
+	const struct softmix_mix_kernels *kernels;
+	int16_t src[MIX_TEST_SAMPLES];
+	int16_t expected[MIX_TEST_SAMPLES];
+	int16_t actual[MIX_TEST_SAMPLES];
+	unsigned int idx;
+	unsigned int samples;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mix_kernels";
+		info->category = "/bridges/bridge_softmix/";
+		info->summary = "Test the mixing kernels";
+		info->description =
+			"Test that every mixing kernel supported by the CPU gives\n"
+			"exactly the same samples as the scalar kernel";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (idx = 1; (kernels = softmix_mix_kernels_get(idx)); ++idx) {
+		if (!kernels->supported()) {
+			ast_test_status_update(test, "Skipping unsupported %s kernels\n", kernels->name);
+			continue;
+		}
+
+		for (samples = 0; samples <= MIX_TEST_SAMPLES; samples += samples < 40 ? 1 : 97) {
+			mix_test_fill(src, samples, samples);
+			mix_test_fill(expected, samples, samples + 1);
+			memcpy(actual, expected, samples * sizeof(*actual));
+			scalar->add(expected, src, samples);
+			kernels->add(actual, src, samples);
+			if (memcmp(expected, actual, samples * sizeof(*actual))) {
+				ast_test_status_update(test, "%s add of %u samples does not match\n",
+					kernels->name, samples);
+				return AST_TEST_FAIL;
+			}
+
+			scalar->subtract(expected, src, samples);
+			kernels->subtract(actual, src, samples);
+			if (memcmp(expected, actual, samples * sizeof(*actual))) {
+				ast_test_status_update(test, "%s subtract of %u samples does not match\n",
+					kernels->name, samples);
+				return AST_TEST_FAIL;
+			}
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
+AST_TEST_DEFINE(softmix_mix_kernels_benchmark)
+{
+	const struct softmix_mix_kernels *kernels;
+	int16_t (*participants)[MIX_TEST_SAMPLES];
+	int16_t mix[MIX_TEST_SAMPLES];
+	int16_t out[MIX_TEST_SAMPLES];
+	unsigned int idx;
+	unsigned int iteration;
+	unsigned int party;
+	struct timeval start;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mix_kernels_benchmark";
+		info->category = "/bridges/bridge_softmix/";
+		info->summary = "Benchmark the mixing kernels";
+		info->description =
+			"Time mixing a 100 party 48kHz conference with every\n"
+			"mixing kernel supported by the CPU";
+		info->explicit_only = 1;
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	participants = ast_malloc(MIX_BENCH_PARTICIPANTS * sizeof(*participants));
+	if (!participants) {
+		return AST_TEST_FAIL;
+	}
+	for (party = 0; party < MIX_BENCH_PARTICIPANTS; ++party) {
+		mix_test_fill(participants[party], MIX_TEST_SAMPLES, party);
+	}
+
+	for (idx = 0; (kernels = softmix_mix_kernels_get(idx)); ++idx) {
+		if (!kernels->supported()) {
+			continue;
+		}
+
+		start = ast_tvnow();
+		for (iteration = 0; iteration < MIX_BENCH_ITERATIONS; ++iteration) {
+			memset(mix, 0, sizeof(mix));
+			for (party = 0; party < MIX_BENCH_PARTICIPANTS; ++party) {
+				kernels->add(mix, participants[party], MIX_TEST_SAMPLES);
+			}
+			for (party = 0; party < MIX_BENCH_PARTICIPANTS; ++party) {
+				memcpy(out, mix, sizeof(out));
+				kernels->subtract(out, participants[party], MIX_TEST_SAMPLES);
+			}
+		}
+		ast_test_status_update(test, "%s: %d mixing intervals of %d participants in %" PRIi64 "ms%s\n",
+			kernels->name, MIX_BENCH_ITERATIONS, MIX_BENCH_PARTICIPANTS,
+			ast_tvdiff_ms(ast_tvnow(), start), kernels == softmix_mix ? " (in use)" : "");
+	}
+
+	ast_free(participants);
+
+	return AST_TEST_PASS;
+}
+
 #endif
 
 static int unload_module(void)
 {
 	ast_bridge_technology_unregister(&softmix_bridge);
+	ast_threadpool_shutdown(softmix_pool);
+	softmix_pool = NULL;
 	AST_TEST_UNREGISTER(sfu_append_source_streams);
 	AST_TEST_UNREGISTER(sfu_remove_destination_streams);
+	AST_TEST_UNREGISTER(softmix_mix_kernels_check);
+	AST_TEST_UNREGISTER(softmix_mix_kernels_benchmark);
 	return 0;
 }
 
 static int load_module(void)
 {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	softmix_mix_kernels_init();
+
+	if (cpus > 1) {
+		struct ast_threadpool_options options = {
+			.version = AST_THREADPOOL_OPTIONS_VERSION,
+			.idle_timeout = SOFTMIX_POOL_IDLE_TIMEOUT,
+			.auto_increment = 1,
+			.initial_size = 0,
+			.max_size = cpus,
+		};
+
+		/* Without the pool large bridges are simply written out by their mixing thread. */
+		softmix_pool = ast_threadpool_create("softmix", NULL, &options);
+	}
+
 	if (ast_bridge_technology_register(&softmix_bridge)) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
 	}
 	AST_TEST_REGISTER(sfu_append_source_streams);
 	AST_TEST_REGISTER(sfu_remove_destination_streams);
+	AST_TEST_REGISTER(softmix_mix_kernels_check);
+	AST_TEST_REGISTER(softmix_mix_kernels_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -83,16 +83,20 @@ void random_binaural_pos_change(struct softmix_bridge_data *softmix_data)
 	}
 }
 
-int do_convolve(struct convolve_channel *chan, int16_t *in_samples,
-		unsigned int in_sample_size, unsigned int hrtf_length)
-{
 #ifdef BINAURAL_RENDERING
+/*!
+ * \internal
+ * \brief Transform the audio data to frequency space into the output buffer of a channel.
+ *
+ * \param chan The channel whose forward plan is executed.
+ * \param in_samples The audio data which will be convolved.
+ * \param hrtf_length The length of the head related transfer function.
+ */
+static void convolve_forward(struct convolve_channel *chan, int16_t *in_samples,
+		unsigned int hrtf_length)
+{
 	unsigned int i;
 
-	if (in_sample_size != CONVOLUTION_SAMPLE_SIZE) {
-		return -1;
-	}
-
 	/* FFT setting real part */
 	for (i = 0; i < CONVOLUTION_SAMPLE_SIZE; i++) {
 		chan->fftw_in[i] = in_samples[i] * (FLT_MAX / SHRT_MAX);
@@ -102,22 +106,38 @@ int do_convolve(struct convolve_channel *chan, int16_t *in_samples,
 		chan->fftw_in[i] = 0;
 	}
 	fftw_execute(chan->fftw_plan);
+}
+
+/*!
+ * \internal
+ * \brief Apply the head related transfer function of a channel to a spectrum.
+ *
+ * \param chan The channel that will contain the binaural audio data as result.
+ * \param spectrum The audio data in frequency space, which may belong to another
+ * channel as it is only read before the inverse transform.
+ * \param in_sample_size The size of the audio data.
+ * \param hrtf_length The length of the head related transfer function.
+ */
+static void convolve_spectrum(struct convolve_channel *chan, const double *spectrum,
+		unsigned int in_sample_size, unsigned int hrtf_length)
+{
+	unsigned int i;
 
 	/* Imaginary mulitplication (frequency space). */
 	/* First FFTW result has never an imaginary part. */
-	chan->fftw_in[0] = chan->fftw_out[0] * chan->hrtf[0];
+	chan->fftw_in[0] = spectrum[0] * chan->hrtf[0];
 	for (i = 1; i < (hrtf_length / 2); i++) {
 		/* Real part */
-		chan->fftw_in[i] = (chan->fftw_out[i] * chan->hrtf[i]) -
-				(chan->fftw_out[hrtf_length - i] * chan->hrtf[hrtf_length - i]);
+		chan->fftw_in[i] = (spectrum[i] * chan->hrtf[i]) -
+				(spectrum[hrtf_length - i] * chan->hrtf[hrtf_length - i]);
 		/* Imaginary part */
-		chan->fftw_in[hrtf_length - i] = (chan->fftw_out[i] * chan->hrtf[hrtf_length - i]) +
-				(chan->fftw_out[hrtf_length - i] * chan->hrtf[i]);
+		chan->fftw_in[hrtf_length - i] = (spectrum[i] * chan->hrtf[hrtf_length - i]) +
+				(spectrum[hrtf_length - i] * chan->hrtf[i]);
 	}
 
 	/* The last (if even) FFTW result has never an imaginary part. */
 	if (hrtf_length % 2 == 0) {
-		chan->fftw_in[hrtf_length / 2] = chan->fftw_out[hrtf_length / 2] *
+		chan->fftw_in[hrtf_length / 2] = spectrum[hrtf_length / 2] *
 				chan->hrtf[hrtf_length / 2];
 	}
 
@@ -138,6 +158,19 @@ int do_convolve(struct convolve_channel *chan, int16_t *in_samples,
 		chan->out_data[i] = chan->overlap_add[i] * (SHRT_MAX / FLT_MAX);
 		chan->overlap_add[i] = chan->fftw_out[i + in_sample_size];
 	}
+}
+#endif
+
+int do_convolve(struct convolve_channel *chan, int16_t *in_samples,
+		unsigned int in_sample_size, unsigned int hrtf_length)
+{
+#ifdef BINAURAL_RENDERING
+	if (in_sample_size != CONVOLUTION_SAMPLE_SIZE) {
+		return -1;
+	}
+
+	convolve_forward(chan, in_samples, hrtf_length);
+	convolve_spectrum(chan, chan->fftw_out, in_sample_size, hrtf_length);
 #endif
 	return 0;
 }
@@ -156,15 +189,23 @@ struct convolve_channel_pair *do_convolve_pair(struct convolve_data *data,
 	}
 
 	chan_pair = data->cchan_pair[pos_id];
-	if (do_convolve(&chan_pair->chan_left, in_samples, in_sample_size, data->hrtf_length)) {
+#ifdef BINAURAL_RENDERING
+	if (in_sample_size != CONVOLUTION_SAMPLE_SIZE) {
 		ast_log(LOG_ERROR, "Channel %s: Binaural processing failed.", channel_name);
 		return NULL;
 	}
 
-	if (do_convolve(&chan_pair->chan_right, in_samples, in_sample_size, data->hrtf_length)) {
-		ast_log(LOG_ERROR, "Channel %s: Binaural processing failed.", channel_name);
-		return NULL;
-	}
+	/*
+	 * Both ears hear the same audio, so it is transformed once. The right
+	 * channel reads the spectrum from the left one before the left inverse
+	 * transform overwrites it.
+	 */
+	convolve_forward(&chan_pair->chan_left, in_samples, data->hrtf_length);
+	convolve_spectrum(&chan_pair->chan_right, chan_pair->chan_left.fftw_out,
+			in_sample_size, data->hrtf_length);
+	convolve_spectrum(&chan_pair->chan_left, chan_pair->chan_left.fftw_out,
+			in_sample_size, data->hrtf_length);
+#endif
 
 	return chan_pair;
 }
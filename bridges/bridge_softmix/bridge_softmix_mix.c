@@ -0,0 +1,201 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Multi-party software based channel mixing (mixing kernels)
+ *
+ * \details The kernels produce exactly the same samples as mixing with
+ * ast_slinear_saturated_add() and ast_slinear_saturated_subtract().  The
+ * vector versions rely on the saturating 16 bit add and subtract
+ * instructions and are picked at runtime from what the CPU supports.
+ *
+ * \ingroup bridges
+ */
+
+/* Needed for the x86 intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
+#include "include/bridge_softmix_internal.h"
+
+#include "asterisk/utils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SOFTMIX_MIX_X86
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__ARM_NEON))
+#define SOFTMIX_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+static void softmix_mix_add_scalar(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; ++x) {
+		ast_slinear_saturated_add(dst + x, (int16_t *) src + x);
+	}
+}
+
+static void softmix_mix_subtract_scalar(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; ++x) {
+		ast_slinear_saturated_subtract(dst + x, (int16_t *) src + x);
+	}
+}
+
+static int softmix_mix_supported_scalar(void)
+{
+	return 1;
+}
+
+#ifdef SOFTMIX_MIX_X86
+__attribute__((target("sse2")))
+static void softmix_mix_add_sse2(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (dst + x));
+		__m128i b = _mm_loadu_si128((const __m128i *) (src + x));
+
+		_mm_storeu_si128((__m128i *) (dst + x), _mm_adds_epi16(a, b));
+	}
+	softmix_mix_add_scalar(dst + x, src + x, samples - x);
+}
+
+__attribute__((target("sse2")))
+static void softmix_mix_subtract_sse2(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (dst + x));
+		__m128i b = _mm_loadu_si128((const __m128i *) (src + x));
+
+		_mm_storeu_si128((__m128i *) (dst + x), _mm_subs_epi16(a, b));
+	}
+	softmix_mix_subtract_scalar(dst + x, src + x, samples - x);
+}
+
+static int softmix_mix_supported_sse2(void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+__attribute__((target("avx2")))
+static void softmix_mix_add_avx2(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (dst + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (src + x));
+
+		_mm256_storeu_si256((__m256i *) (dst + x), _mm256_adds_epi16(a, b));
+	}
+	softmix_mix_add_scalar(dst + x, src + x, samples - x);
+}
+
+__attribute__((target("avx2")))
+static void softmix_mix_subtract_avx2(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (dst + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (src + x));
+
+		_mm256_storeu_si256((__m256i *) (dst + x), _mm256_subs_epi16(a, b));
+	}
+	softmix_mix_subtract_scalar(dst + x, src + x, samples - x);
+}
+
+static int softmix_mix_supported_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif /* SOFTMIX_MIX_X86 */
+
+#ifdef SOFTMIX_MIX_NEON
+static void softmix_mix_add_neon(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		vst1q_s16(dst + x, vqaddq_s16(vld1q_s16(dst + x), vld1q_s16(src + x)));
+	}
+	softmix_mix_add_scalar(dst + x, src + x, samples - x);
+}
+
+static void softmix_mix_subtract_neon(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		vst1q_s16(dst + x, vqsubq_s16(vld1q_s16(dst + x), vld1q_s16(src + x)));
+	}
+	softmix_mix_subtract_scalar(dst + x, src + x, samples - x);
+}
+
+static int softmix_mix_supported_neon(void)
+{
+	/* NEON is known to be available at compile time. */
+	return 1;
+}
+#endif /* SOFTMIX_MIX_NEON */
+
+/*! \brief Known mixing kernels, from least to most preferred */
+static const struct softmix_mix_kernels kernels[] = {
+	{ "scalar", softmix_mix_add_scalar, softmix_mix_subtract_scalar, softmix_mix_supported_scalar, },
+#ifdef SOFTMIX_MIX_X86
+	{ "sse2", softmix_mix_add_sse2, softmix_mix_subtract_sse2, softmix_mix_supported_sse2, },
+	{ "avx2", softmix_mix_add_avx2, softmix_mix_subtract_avx2, softmix_mix_supported_avx2, },
+#endif
+#ifdef SOFTMIX_MIX_NEON
+	{ "neon", softmix_mix_add_neon, softmix_mix_subtract_neon, softmix_mix_supported_neon, },
+#endif
+};
+
+const struct softmix_mix_kernels *softmix_mix = &kernels[0];
+
+const struct softmix_mix_kernels *softmix_mix_kernels_get(unsigned int idx)
+{
+	if (idx >= ARRAY_LEN(kernels)) {
+		return NULL;
+	}
+
+	return &kernels[idx];
+}
+
+void softmix_mix_kernels_init(void)
+{
+	int idx;
+
+#ifdef SOFTMIX_MIX_X86
+	__builtin_cpu_init();
+#endif
+
+	for (idx = ARRAY_LEN(kernels) - 1; idx > 0; --idx) {
+		if (kernels[idx].supported()) {
+			break;
+		}
+	}
+	softmix_mix = &kernels[idx];
+
+	ast_debug(1, "Using %s softmix mixing kernels\n", softmix_mix->name);
+}
@@ -155,6 +155,14 @@ struct softmix_channel {
 	unsigned int binaural:1;
 	/*! TRUE if this is an announcement channel (data will not be convolved) */
 	unsigned int is_announcement:1;
+	/*! TRUE if the channel was one of the loudest talkers mixed last time it had audio */
+	unsigned int mixed:1;
+	/*! TRUE if the channel is sent no video, its REMB being below the minimum */
+	unsigned int video_paused:1;
+	/*! TRUE if the video sources must be asked for a full frame for the channel */
+	unsigned int video_resumed:1;
+	/*! Average energy of the audio recently written by the channel */
+	int energy;
 	/*! The position of the channel in the virtual room represented by an id
 	 *	This ID has to be set even if the channel has no binaural output!
 	 */
@@ -181,6 +189,11 @@ struct softmix_channel {
 	AST_VECTOR(, int) video_sources;
 };
 
+/*! \brief The channels a bridge stream is forwarded to in SFU mode */
+struct softmix_sfu_destinations {
+	AST_VECTOR(, struct ast_bridge_channel *) channels;
+};
+
 struct softmix_bridge_data {
 	struct ast_timer *timer;
 	/*!
@@ -216,6 +229,15 @@ struct softmix_bridge_data {
 	struct timeval last_remb_update;
 	/*! Per-bridge stream REMB collectors, which flow back to video source */
 	AST_VECTOR(, struct softmix_remb_collector *) remb_collectors;
+	/*!
+	 * \brief The channels each bridge stream is forwarded to in SFU mode.
+	 *
+	 * \note Rebuilt from the stream maps of the channels when stale,
+	 * protected by the bridge lock.
+	 */
+	AST_VECTOR(, struct softmix_sfu_destinations) sfu_forwarding;
+	/*! TRUE if the stream maps changed since sfu_forwarding was built */
+	unsigned int sfu_forwarding_stale:1;
 	/*! Per-bridge REMB bitrate */
 	float bitrate;
 };
@@ -224,6 +246,8 @@ struct softmix_mixing_array {
 	unsigned int max_num_entries;
 	unsigned int used_entries;
 	int16_t **buffers;
+	/*! The channel each of the buffers came from */
+	struct softmix_channel **channels;
 	/*! Stereo channel pairs used to store convolved binaural signals */
 	struct convolve_channel_pair **chan_pairs;
 };
@@ -441,4 +465,44 @@ void create_binaural_frame(struct ast_bridge_channel *bridge_channel,
 		struct softmix_channel *sc, int16_t *bin_buf, int16_t *ann_buf,
 		unsigned int softmix_datalen, unsigned int softmix_samples, int16_t *buf);
 
+/*!
+ * \brief Saturating mixing kernel
+ *
+ * \param dst The samples to mix into.
+ * \param src The samples to add to or subtract from dst.
+ * \param samples The number of samples.
+ */
+typedef void (*softmix_mix_fn)(int16_t *dst, const int16_t *src, unsigned int samples);
+
+/*! \brief A set of mixing kernels for one instruction set */
+struct softmix_mix_kernels {
+	/*! Name of the instruction set */
+	const char *name;
+	/*! Saturating add, like ast_slinear_saturated_add() */
+	softmix_mix_fn add;
+	/*! Saturating subtract, like ast_slinear_saturated_subtract() */
+	softmix_mix_fn subtract;
+	/*! TRUE if the CPU supports the instruction set */
+	int (*supported)(void);
+};
+
+/*! \brief Mixing kernels used by the mixing thread */
+extern const struct softmix_mix_kernels *softmix_mix;
+
+/*!
+ * \brief Pick the best mixing kernels the CPU supports.
+ */
+void softmix_mix_kernels_init(void);
+
+/*!
+ * \brief Get the known mixing kernels.
+ *
+ * \param idx Index of the kernels starting at 0.
+ *
+ * \return The kernels or NULL past the last one.
+ *
+ * \note The kernels may not be supported by the CPU.
+ */
+const struct softmix_mix_kernels *softmix_mix_kernels_get(unsigned int idx);
+
 #endif /* _ASTERISK_BRIDGE_SOFTMIX_INTERNAL_H */
@@ -51,8 +51,6 @@
 #include "asterisk/module.h"
 #include "asterisk/res_odbc.h"
 
-#define DATE_FORMAT "%Y-%m-%d %T"
-
 static const char name[] = "ODBC";
 static const char config_file[] = "cdr_odbc.conf";
 static char *dsn = NULL, *table = NULL;
@@ -68,18 +66,52 @@ enum {
 
 static struct ast_flags config = { 0 };
 
+/*! \brief A record as bound to the parameters of the INSERT */
+struct odbc_row {
+	struct ast_cdr cdr;
+	SQL_TIMESTAMP_STRUCT calldate;
+	double hrduration;
+	double hrbillsec;
+	char disposition[16];
+};
+
+/*! \brief The records inserted by one statement */
+struct odbc_rows {
+	struct odbc_row *rows;
+	size_t count;
+};
+
+static void odbc_row_init(struct odbc_row *row, struct ast_cdr *cdr)
+{
+	struct ast_tm tm;
+
+	row->cdr = *cdr;
+
+	ast_localtime(&cdr->start, &tm, ast_test_flag(&config, CONFIG_USEGMTIME) ? "GMT" : NULL);
+	row->calldate.year = tm.tm_year + 1900;
+	row->calldate.month = tm.tm_mon + 1;
+	row->calldate.day = tm.tm_mday;
+	row->calldate.hour = tm.tm_hour;
+	row->calldate.minute = tm.tm_min;
+	row->calldate.second = tm.tm_sec;
+
+	if (!ast_tvzero(cdr->answer)) {
+		row->hrbillsec = (double) ast_tvdiff_us(cdr->end, cdr->answer) / 1000000.0;
+	}
+	row->hrduration = (double) ast_tvdiff_us(cdr->end, cdr->start) / 1000000.0;
+
+	ast_copy_string(row->disposition, ast_cdr_disp2str(cdr->disposition), sizeof(row->disposition));
+}
+
 static SQLHSTMT execute_cb(struct odbc_obj *obj, void *data)
 {
-	struct ast_cdr *cdr = data;
+	struct odbc_rows *rows = data;
+	struct odbc_row *row = rows->rows;
 	SQLRETURN ODBC_res;
-	char sqlcmd[2048] = "", timestr[128], new_columns[120] = "", new_values[7] = "";
-	struct ast_tm tm;
+	char sqlcmd[2048] = "", new_columns[120] = "", new_values[7] = "";
 	SQLHSTMT stmt;
 	int i = 0;
 
-	ast_localtime(&cdr->start, &tm, ast_test_flag(&config, CONFIG_USEGMTIME) ? "GMT" : NULL);
-	ast_strftime(timestr, sizeof(timestr), DATE_FORMAT, &tm);
-
 	if (ast_test_flag(&config, CONFIG_NEWCDRCOLUMNS)) {
 		snprintf(new_columns, sizeof(new_columns), "%s", ",peeraccount,linkedid,sequence");
 		snprintf(new_values, sizeof(new_values), "%s", ",?,?,?");
@@ -89,12 +121,12 @@ static SQLHSTMT execute_cb(struct odbc_obj *obj, void *data)
 		snprintf(sqlcmd,sizeof(sqlcmd),"INSERT INTO %s "
 		"(calldate,clid,src,dst,dcontext,channel,dstchannel,lastapp,"
 		"lastdata,duration,billsec,disposition,amaflags,accountcode,uniqueid,userfield%s) "
-		"VALUES ({ts '%s'},?,?,?,?,?,?,?,?,?,?,?,?,?,?,?%s)", table, new_columns, timestr, new_values);
+		"VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?%s)", table, new_columns, new_values);
 	} else {
 		snprintf(sqlcmd,sizeof(sqlcmd),"INSERT INTO %s "
 		"(calldate,clid,src,dst,dcontext,channel,dstchannel,lastapp,lastdata,"
 		"duration,billsec,disposition,amaflags,accountcode%s) "
-		"VALUES ({ts '%s'},?,?,?,?,?,?,?,?,?,?,?,?,?%s)", table, new_columns, timestr, new_values);
+		"VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?%s)", table, new_columns, new_values);
 	}
 
 	ODBC_res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
@@ -105,52 +137,54 @@ static SQLHSTMT execute_cb(struct odbc_obj *obj, void *data)
 		return NULL;
 	}
 
-	SQLBindParameter(stmt, 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->clid), 0, cdr->clid, 0, NULL);
-	SQLBindParameter(stmt, 2, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->src), 0, cdr->src, 0, NULL);
-	SQLBindParameter(stmt, 3, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->dst), 0, cdr->dst, 0, NULL);
-	SQLBindParameter(stmt, 4, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->dcontext), 0, cdr->dcontext, 0, NULL);
-	SQLBindParameter(stmt, 5, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->channel), 0, cdr->channel, 0, NULL);
-	SQLBindParameter(stmt, 6, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->dstchannel), 0, cdr->dstchannel, 0, NULL);
-	SQLBindParameter(stmt, 7, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->lastapp), 0, cdr->lastapp, 0, NULL);
-	SQLBindParameter(stmt, 8, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->lastdata), 0, cdr->lastdata, 0, NULL);
-
-	if (ast_test_flag(&config, CONFIG_HRTIME)) {
-		double hrbillsec = 0.0;
-		double hrduration;
-
-		if (!ast_tvzero(cdr->answer)) {
-			hrbillsec = (double) ast_tvdiff_us(cdr->end, cdr->answer) / 1000000.0;
+	if (rows->count > 1) {
+		/* Each parameter is bound to the first row, the others follow it */
+		SQLSetStmtAttr(stmt, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER) sizeof(*row), 0);
+		ODBC_res = SQLSetStmtAttr(stmt, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER) rows->count, 0);
+		if ((ODBC_res != SQL_SUCCESS) && (ODBC_res != SQL_SUCCESS_WITH_INFO)) {
+			ast_log(LOG_WARNING, "cdr_odbc: Driver does not take arrays of parameters\n");
+			SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+			return NULL;
 		}
-		hrduration = (double) ast_tvdiff_us(cdr->end, cdr->start) / 1000000.0;
+	}
+
+	SQLBindParameter(stmt, 1, SQL_PARAM_INPUT, SQL_C_TYPE_TIMESTAMP, SQL_TYPE_TIMESTAMP, 19, 0, &row->calldate, 0, NULL);
+	SQLBindParameter(stmt, 2, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.clid), 0, row->cdr.clid, 0, NULL);
+	SQLBindParameter(stmt, 3, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.src), 0, row->cdr.src, 0, NULL);
+	SQLBindParameter(stmt, 4, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.dst), 0, row->cdr.dst, 0, NULL);
+	SQLBindParameter(stmt, 5, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.dcontext), 0, row->cdr.dcontext, 0, NULL);
+	SQLBindParameter(stmt, 6, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.channel), 0, row->cdr.channel, 0, NULL);
+	SQLBindParameter(stmt, 7, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.dstchannel), 0, row->cdr.dstchannel, 0, NULL);
+	SQLBindParameter(stmt, 8, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.lastapp), 0, row->cdr.lastapp, 0, NULL);
+	SQLBindParameter(stmt, 9, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.lastdata), 0, row->cdr.lastdata, 0, NULL);
 
-		SQLBindParameter(stmt, 9, SQL_PARAM_INPUT, SQL_C_DOUBLE, SQL_FLOAT, 0, 0, &hrduration, 0, NULL);
-		SQLBindParameter(stmt, 10, SQL_PARAM_INPUT, SQL_C_DOUBLE, SQL_FLOAT, 0, 0, &hrbillsec, 0, NULL);
+	if (ast_test_flag(&config, CONFIG_HRTIME)) {
+		SQLBindParameter(stmt, 10, SQL_PARAM_INPUT, SQL_C_DOUBLE, SQL_FLOAT, 0, 0, &row->hrduration, 0, NULL);
+		SQLBindParameter(stmt, 11, SQL_PARAM_INPUT, SQL_C_DOUBLE, SQL_FLOAT, 0, 0, &row->hrbillsec, 0, NULL);
 	} else {
-		SQLBindParameter(stmt, 9, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &cdr->duration, 0, NULL);
-		SQLBindParameter(stmt, 10, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &cdr->billsec, 0, NULL);
+		SQLBindParameter(stmt, 10, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &row->cdr.duration, 0, NULL);
+		SQLBindParameter(stmt, 11, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &row->cdr.billsec, 0, NULL);
 	}
 
 	if (ast_test_flag(&config, CONFIG_DISPOSITIONSTRING)) {
-		char *disposition;
-		disposition = ast_strdupa(ast_cdr_disp2str(cdr->disposition));
-		SQLBindParameter(stmt, 11, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, strlen(disposition) + 1, 0, disposition, 0, NULL);
+		SQLBindParameter(stmt, 12, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->disposition), 0, row->disposition, 0, NULL);
 	} else {
-		SQLBindParameter(stmt, 11, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &cdr->disposition, 0, NULL);
+		SQLBindParameter(stmt, 12, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &row->cdr.disposition, 0, NULL);
 	}
-	SQLBindParameter(stmt, 12, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &cdr->amaflags, 0, NULL);
-	SQLBindParameter(stmt, 13, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->accountcode), 0, cdr->accountcode, 0, NULL);
+	SQLBindParameter(stmt, 13, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &row->cdr.amaflags, 0, NULL);
+	SQLBindParameter(stmt, 14, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.accountcode), 0, row->cdr.accountcode, 0, NULL);
 
-	i = 14;
+	i = 15;
 	if (ast_test_flag(&config, CONFIG_LOGUNIQUEID)) {
-		SQLBindParameter(stmt, 14, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->uniqueid), 0, cdr->uniqueid, 0, NULL);
-		SQLBindParameter(stmt, 15, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->userfield), 0, cdr->userfield, 0, NULL);
-		i = 16;
+		SQLBindParameter(stmt, 15, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.uniqueid), 0, row->cdr.uniqueid, 0, NULL);
+		SQLBindParameter(stmt, 16, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.userfield), 0, row->cdr.userfield, 0, NULL);
+		i = 17;
 	}
 
 	if (ast_test_flag(&config, CONFIG_NEWCDRCOLUMNS)) {
-		SQLBindParameter(stmt, i, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->peeraccount), 0, cdr->peeraccount, 0, NULL);
-		SQLBindParameter(stmt, i + 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(cdr->linkedid), 0, cdr->linkedid, 0, NULL);
-		SQLBindParameter(stmt, i + 2, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &cdr->sequence, 0, NULL);
+		SQLBindParameter(stmt, i, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.peeraccount), 0, row->cdr.peeraccount, 0, NULL);
+		SQLBindParameter(stmt, i + 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, sizeof(row->cdr.linkedid), 0, row->cdr.linkedid, 0, NULL);
+		SQLBindParameter(stmt, i + 2, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &row->cdr.sequence, 0, NULL);
 	}
 
 	ODBC_res = ast_odbc_execute_sql(obj, stmt, sqlcmd);
@@ -164,32 +198,77 @@ static SQLHSTMT execute_cb(struct odbc_obj *obj, void *data)
 	return stmt;
 }
 
-
-static int odbc_log(struct ast_cdr *cdr)
+static int odbc_insert_rows(struct odbc_obj *obj, struct odbc_row *row, size_t count)
 {
-	struct odbc_obj *obj = ast_odbc_request_obj(dsn, 0);
+	struct odbc_rows rows = {
+		.rows = row,
+		.count = count,
+	};
 	SQLHSTMT stmt;
+	SQLLEN inserted = 0;
 
-	if (!obj) {
-		ast_log(LOG_ERROR, "Unable to retrieve database handle.  CDR failed.\n");
+	stmt = ast_odbc_direct_execute(obj, execute_cb, &rows);
+	if (!stmt) {
 		return -1;
 	}
 
-	stmt = ast_odbc_direct_execute(obj, execute_cb, cdr);
-	if (stmt) {
-		SQLLEN rows = 0;
+	SQLRowCount(stmt, &inserted);
+	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
 
-		SQLRowCount(stmt, &rows);
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	if (inserted == 0)
+		ast_log(LOG_WARNING, "CDR successfully ran, but inserted 0 rows?\n");
+	return 0;
+}
+
+/*!
+ * \brief Insert a batch of records
+ *
+ * The records are bound as an array of parameter sets, so they go in with a
+ * single statement.  Drivers without arrays of parameters get them one by one.
+ */
+static int odbc_log_batch(struct ast_cdr **cdrs, size_t count)
+{
+	struct odbc_obj *obj;
+	struct odbc_row *rows;
+	size_t idx;
+
+	rows = ast_calloc(count, sizeof(*rows));
+	if (!rows) {
+		return -1;
+	}
+	for (idx = 0; idx < count; ++idx) {
+		odbc_row_init(&rows[idx], cdrs[idx]);
+	}
 
-		if (rows == 0)
-			ast_log(LOG_WARNING, "CDR successfully ran, but inserted 0 rows?\n");
-	} else
-		ast_log(LOG_ERROR, "CDR direct execute failed\n");
+	obj = ast_odbc_request_obj(dsn, 0);
+	if (!obj) {
+		ast_log(LOG_ERROR, "Unable to retrieve database handle.  CDR failed.\n");
+		ast_free(rows);
+		return -1;
+	}
+
+	if (odbc_insert_rows(obj, rows, count)) {
+		if (count > 1) {
+			ast_log(LOG_WARNING, "Inserting the %zu records of the batch one by one\n", count);
+			for (idx = 0; idx < count; ++idx) {
+				if (odbc_insert_rows(obj, &rows[idx], 1)) {
+					ast_log(LOG_ERROR, "CDR direct execute failed\n");
+				}
+			}
+		} else {
+			ast_log(LOG_ERROR, "CDR direct execute failed\n");
+		}
+	}
 	ast_odbc_release_obj(obj);
+	ast_free(rows);
 	return 0;
 }
 
+static int odbc_log(struct ast_cdr *cdr)
+{
+	return odbc_log_batch(&cdr, 1);
+}
+
 static int odbc_load_module(int reload)
 {
 	int res = 0;
@@ -267,7 +346,7 @@ static int odbc_load_module(int reload)
 		}
 
 		if (!ast_test_flag(&config, CONFIG_REGISTERED)) {
-			res = ast_cdr_register(name, ast_module_info->description, odbc_log);
+			res = ast_cdr_register_batch(name, ast_module_info->description, odbc_log, odbc_log_batch);
 			if (res) {
 				ast_log(LOG_ERROR, "cdr_odbc: Unable to register ODBC CDR handling\n");
 			} else {
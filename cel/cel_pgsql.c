@@ -73,7 +73,7 @@ static char *schema;
 
 static int connected = 0;
 /* Optimization to reduce number of memory allocations */
-static int maxsize = 512, maxsize2 = 512;
+static int maxsize = 512;
 static int usegmtime = 0;
 
 /*! \brief show_user_def is off by default */
@@ -85,7 +85,6 @@ static unsigned char cel_show_user_def;
 AST_MUTEX_DEFINE_STATIC(pgsql_lock);
 
 static PGconn	*conn = NULL;
-static PGresult	*result = NULL;
 
 struct columns {
 	char *name;
@@ -98,24 +97,7 @@ struct columns {
 
 static AST_RWLIST_HEAD_STATIC(psql_columns, columns);
 
-#define LENGTHEN_BUF(size, var_sql) \
-	do { \
-		/* Lengthen buffer, if necessary */ \
-		if (ast_str_strlen(var_sql) + size + 1 > ast_str_size(var_sql)) { \
-			if (ast_str_make_space(&var_sql, ((ast_str_size(var_sql) + size + 3) / 512 + 1) * 512) != 0) { \
-				ast_log(LOG_ERROR, "Unable to allocate sufficient memory.  Insert CEL '%s:%s' failed.\n", pghostname, table); \
-				ast_free(sql); \
-				ast_free(sql2); \
-				AST_RWLIST_UNLOCK(&psql_columns); \
-				return; \
-			} \
-		} \
-	} while (0)
-
-#define LENGTHEN_BUF1(size) \
-	LENGTHEN_BUF(size, sql);
-#define LENGTHEN_BUF2(size) \
-	LENGTHEN_BUF(size, sql2);
+#define SEP (first ? "" : ",")
 
 static void pgsql_reconnect(void)
 {
@@ -145,260 +127,341 @@ static void pgsql_reconnect(void)
 	ast_free(conn_info);
 }
 
-
-static void pgsql_log(struct ast_event *event)
+/*! \brief Connect to the database if not connected yet, with pgsql_lock held */
+static void pgsql_connect(void)
 {
-	struct ast_tm tm;
-	char timestr[128];
 	char *pgerror;
-	struct ast_cel_event_record record = {
-		.version = AST_CEL_EVENT_RECORD_VERSION,
-	};
 
-	if (ast_cel_fill_record(event, &record)) {
+	if (connected || !pghostname || !pgdbuser || !pgpassword || !pgdbname) {
 		return;
 	}
 
-	ast_mutex_lock(&pgsql_lock);
+	pgsql_reconnect();
+	if (PQstatus(conn) != CONNECTION_BAD) {
+		connected = 1;
+	} else {
+		pgerror = PQerrorMessage(conn);
+		ast_log(LOG_ERROR, "cel_pgsql: Unable to connect to database server %s.  Calls will not be logged!\n", pghostname);
+		ast_log(LOG_ERROR, "cel_pgsql: Reason: %s\n", pgerror);
+		PQfinish(conn);
+		conn = NULL;
+	}
+}
 
-	ast_localtime(&record.event_time, &tm, usegmtime ? "GMT" : NULL);
-	ast_strftime(timestr, sizeof(timestr), DATE_FORMAT, &tm);
+/*!
+ * \brief Append the column list of the INSERT, with psql_columns locked
+ */
+static void pgsql_append_columns(struct ast_str **sql)
+{
+	struct columns *cur;
+	int first = 1;
 
-	if ((!connected) && pghostname && pgdbuser && pgpassword && pgdbname) {
-		pgsql_reconnect();
-		if (PQstatus(conn) != CONNECTION_BAD) {
-			connected = 1;
-		} else {
-			pgerror = PQerrorMessage(conn);
-			ast_log(LOG_ERROR, "cel_pgsql: Unable to connect to database server %s.  Calls will not be logged!\n", pghostname);
-			ast_log(LOG_ERROR, "cel_pgsql: Reason: %s\n", pgerror);
-			PQfinish(conn);
-			conn = NULL;
-		}
+	ast_str_append(sql, 0, "INSERT INTO %s (", table);
+	AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
+		ast_str_append(sql, 0, "%s\"%s\"", SEP, cur->name);
+		first = 0;
 	}
-	if (connected) {
-		struct columns *cur;
-		struct ast_str *sql = ast_str_create(maxsize), *sql2 = ast_str_create(maxsize2);
-		char buf[257];
-		char *escapebuf = NULL;
-		const char *value;
-		int first = 1;
-		size_t bufsize = 513;
-
-		escapebuf = ast_malloc(bufsize);
-		if (!escapebuf || !sql || !sql2) {
-			goto ast_log_cleanup;
-		}
+	ast_str_append(sql, 0, ") VALUES ");
+}
 
-		ast_str_set(&sql, 0, "INSERT INTO %s (", table);
-		ast_str_set(&sql2, 0, " VALUES (");
+/*!
+ * \brief Append the values of an event to the INSERT, with psql_columns locked
+ *
+ * \retval 0 on success
+ * \retval -1 on failure to allocate memory
+ */
+static int pgsql_append_values(struct ast_str **sql, struct ast_cel_event_record *record,
+	char **escapebuf, size_t *bufsize)
+{
+	struct ast_tm tm;
+	struct columns *cur;
+	char buf[257];
+	const char *value;
+	int first = 1;
+
+	ast_str_append(sql, 0, "(");
+	AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
+		if (strcmp(cur->name, "eventtime") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				ast_str_append(sql, 0, "%s%ld", SEP, (long) record->event_time.tv_sec);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				ast_str_append(sql, 0, "%s%f",
+					SEP,
+					(double) record->event_time.tv_sec +
+					(double) record->event_time.tv_usec / 1000000.0);
+			} else {
+				/* char, hopefully */
+				ast_localtime(&record->event_time, &tm, usegmtime ? "GMT" : NULL);
+				ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
+				ast_str_append(sql, 0, "%s'%s'", SEP, buf);
+			}
+		} else if (strcmp(cur->name, "eventtype") == 0) {
+			if (cur->type[0] == 'i') {
+				/* Get integer, no need to escape anything */
+				ast_str_append(sql, 0, "%s%d", SEP, (int) record->event_type);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				ast_str_append(sql, 0, "%s%f", SEP, (double) record->event_type);
+			} else {
+				/* Char field, probably */
+				const char *event_name;
 
-#define SEP (first ? "" : ",")
+				event_name = (!cel_show_user_def
+					&& record->event_type == AST_CEL_USER_DEFINED)
+					? record->user_defined_name : record->event_name;
+				ast_str_append(sql, 0, "%s'%s'", SEP, event_name);
+			}
+		} else if (strcmp(cur->name, "amaflags") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				/* Integer, no need to escape anything */
+				ast_str_append(sql, 0, "%s%u", SEP, record->amaflag);
+			} else {
+				/* Although this is a char field, there are no special characters in the values for these fields */
+				ast_str_append(sql, 0, "%s'%u'", SEP, record->amaflag);
+			}
+		} else {
+			/* Arbitrary field, could be anything */
+			if (strcmp(cur->name, "userdeftype") == 0) {
+				value = record->user_defined_name;
+			} else if (strcmp(cur->name, "cid_name") == 0) {
+				value = record->caller_id_name;
+			} else if (strcmp(cur->name, "cid_num") == 0) {
+				value = record->caller_id_num;
+			} else if (strcmp(cur->name, "cid_ani") == 0) {
+				value = record->caller_id_ani;
+			} else if (strcmp(cur->name, "cid_rdnis") == 0) {
+				value = record->caller_id_rdnis;
+			} else if (strcmp(cur->name, "cid_dnid") == 0) {
+				value = record->caller_id_dnid;
+			} else if (strcmp(cur->name, "exten") == 0) {
+				value = record->extension;
+			} else if (strcmp(cur->name, "context") == 0) {
+				value = record->context;
+			} else if (strcmp(cur->name, "channame") == 0) {
+				value = record->channel_name;
+			} else if (strcmp(cur->name, "appname") == 0) {
+				value = record->application_name;
+			} else if (strcmp(cur->name, "appdata") == 0) {
+				value = record->application_data;
+			} else if (strcmp(cur->name, "accountcode") == 0) {
+				value = record->account_code;
+			} else if (strcmp(cur->name, "peeraccount") == 0) {
+				value = record->peer_account;
+			} else if (strcmp(cur->name, "uniqueid") == 0) {
+				value = record->unique_id;
+			} else if (strcmp(cur->name, "linkedid") == 0) {
+				value = record->linked_id;
+			} else if (strcmp(cur->name, "userfield") == 0) {
+				value = record->user_field;
+			} else if (strcmp(cur->name, "peer") == 0) {
+				value = record->peer;
+			} else if (strcmp(cur->name, "extra") == 0) {
+				value = record->extra;
+			} else {
+				value = NULL;
+			}
 
-		AST_RWLIST_RDLOCK(&psql_columns);
-		AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
-			LENGTHEN_BUF1(strlen(cur->name) + 2);
-			ast_str_append(&sql, 0, "%s\"%s\"", SEP, cur->name);
-
-			if (strcmp(cur->name, "eventtime") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%ld", SEP, (long) record.event_time.tv_sec);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f",
-						SEP,
-						(double) record.event_time.tv_sec +
-						(double) record.event_time.tv_usec / 1000000.0);
-				} else {
-					/* char, hopefully */
-					LENGTHEN_BUF2(31);
-					ast_localtime(&record.event_time, &tm, usegmtime ? "GMT" : NULL);
-					ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
-					ast_str_append(&sql2, 0, "%s'%s'", SEP, buf);
-				}
-			} else if (strcmp(cur->name, "eventtype") == 0) {
-				if (cur->type[0] == 'i') {
-					/* Get integer, no need to escape anything */
-					LENGTHEN_BUF2(5);
-					ast_str_append(&sql2, 0, "%s%d", SEP, (int) record.event_type);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f", SEP, (double) record.event_type);
+			if (value == NULL) {
+				ast_str_append(sql, 0, "%sDEFAULT", SEP);
+			} else if (strncmp(cur->type, "int", 3) == 0) {
+				long long whatever;
+				if (sscanf(value, "%30lld", &whatever) == 1) {
+					ast_str_append(sql, 0, "%s%lld", SEP, whatever);
 				} else {
-					/* Char field, probably */
-					const char *event_name;
-
-					event_name = (!cel_show_user_def
-						&& record.event_type == AST_CEL_USER_DEFINED)
-						? record.user_defined_name : record.event_name;
-					LENGTHEN_BUF2(strlen(event_name) + 1);
-					ast_str_append(&sql2, 0, "%s'%s'", SEP, event_name);
+					ast_str_append(sql, 0, "%s0", SEP);
 				}
-			} else if (strcmp(cur->name, "amaflags") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					/* Integer, no need to escape anything */
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%u", SEP, record.amaflag);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				long double whatever;
+				if (sscanf(value, "%30Lf", &whatever) == 1) {
+					ast_str_append(sql, 0, "%s%30Lf", SEP, whatever);
 				} else {
-					/* Although this is a char field, there are no special characters in the values for these fields */
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s'%u'", SEP, record.amaflag);
+					ast_str_append(sql, 0, "%s0", SEP);
 				}
+				/* XXX Might want to handle dates, times, and other misc fields here XXX */
 			} else {
-				/* Arbitrary field, could be anything */
-				if (strcmp(cur->name, "userdeftype") == 0) {
-					value = record.user_defined_name;
-				} else if (strcmp(cur->name, "cid_name") == 0) {
-					value = record.caller_id_name;
-				} else if (strcmp(cur->name, "cid_num") == 0) {
-					value = record.caller_id_num;
-				} else if (strcmp(cur->name, "cid_ani") == 0) {
-					value = record.caller_id_ani;
-				} else if (strcmp(cur->name, "cid_rdnis") == 0) {
-					value = record.caller_id_rdnis;
-				} else if (strcmp(cur->name, "cid_dnid") == 0) {
-					value = record.caller_id_dnid;
-				} else if (strcmp(cur->name, "exten") == 0) {
-					value = record.extension;
-				} else if (strcmp(cur->name, "context") == 0) {
-					value = record.context;
-				} else if (strcmp(cur->name, "channame") == 0) {
-					value = record.channel_name;
-				} else if (strcmp(cur->name, "appname") == 0) {
-					value = record.application_name;
-				} else if (strcmp(cur->name, "appdata") == 0) {
-					value = record.application_data;
-				} else if (strcmp(cur->name, "accountcode") == 0) {
-					value = record.account_code;
-				} else if (strcmp(cur->name, "peeraccount") == 0) {
-					value = record.peer_account;
-				} else if (strcmp(cur->name, "uniqueid") == 0) {
-					value = record.unique_id;
-				} else if (strcmp(cur->name, "linkedid") == 0) {
-					value = record.linked_id;
-				} else if (strcmp(cur->name, "userfield") == 0) {
-					value = record.user_field;
-				} else if (strcmp(cur->name, "peer") == 0) {
-					value = record.peer;
-				} else if (strcmp(cur->name, "extra") == 0) {
-					value = record.extra;
-				} else {
-					value = NULL;
-				}
+				size_t required_size = strlen(value) * 2 + 1;
 
-				if (value == NULL) {
-					ast_str_append(&sql2, 0, "%sDEFAULT", SEP);
-				} else if (strncmp(cur->type, "int", 3) == 0) {
-					long long whatever;
-					if (value && sscanf(value, "%30lld", &whatever) == 1) {
-						LENGTHEN_BUF2(26);
-						ast_str_append(&sql2, 0, "%s%lld", SEP, whatever);
-					} else {
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s0", SEP);
-					}
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					long double whatever;
-					if (value && sscanf(value, "%30Lf", &whatever) == 1) {
-						LENGTHEN_BUF2(51);
-						ast_str_append(&sql2, 0, "%s%30Lf", SEP, whatever);
-					} else {
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s0", SEP);
-					}
-					/* XXX Might want to handle dates, times, and other misc fields here XXX */
-				} else {
-					if (value) {
-						size_t required_size = strlen(value) * 2 + 1;
-
-						/* If our argument size exceeds our buffer, grow it,
-						 * as PQescapeStringConn() expects the buffer to be
-						 * adequitely sized and does *NOT* do size checking.
-						 */
-						if (required_size > bufsize) {
-							char *tmpbuf = ast_realloc(escapebuf, required_size);
-
-							if (!tmpbuf) {
-								AST_RWLIST_UNLOCK(&psql_columns);
-								goto ast_log_cleanup;
-							}
-
-							escapebuf = tmpbuf;
-							bufsize = required_size;
-						}
-						PQescapeStringConn(conn, escapebuf, value, strlen(value), NULL);
-					} else {
-						escapebuf[0] = '\0';
+				/* If our argument size exceeds our buffer, grow it,
+				 * as PQescapeStringConn() expects the buffer to be
+				 * adequitely sized and does *NOT* do size checking.
+				 */
+				if (required_size > *bufsize) {
+					char *tmpbuf = ast_realloc(*escapebuf, required_size);
+
+					if (!tmpbuf) {
+						return -1;
 					}
-					LENGTHEN_BUF2(strlen(escapebuf) + 3);
-					ast_str_append(&sql2, 0, "%s'%s'", SEP, escapebuf);
+
+					*escapebuf = tmpbuf;
+					*bufsize = required_size;
 				}
+				PQescapeStringConn(conn, *escapebuf, value, strlen(value), NULL);
+				ast_str_append(sql, 0, "%s'%s'", SEP, *escapebuf);
 			}
-			first = 0;
 		}
-		AST_RWLIST_UNLOCK(&psql_columns);
-		LENGTHEN_BUF1(ast_str_strlen(sql2) + 2);
-		ast_str_append(&sql, 0, ")%s)", ast_str_buffer(sql2));
+		first = 0;
+	}
+	ast_str_append(sql, 0, ")");
+
+	return 0;
+}
 
-		ast_debug(3, "Inserting a CEL record: [%s].\n", ast_str_buffer(sql));
-		/* Test to be sure we're still connected... */
-		/* If we're connected, and connection is working, good. */
-		/* Otherwise, attempt reconnect.  If it fails... sorry... */
+/*!
+ * \brief Run an INSERT, reconnecting once if it fails, with pgsql_lock held
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int pgsql_exec(struct ast_str *sql)
+{
+	PGresult *result;
+	char *pgerror;
+	int res = -1;
+
+	ast_debug(3, "Inserting a CEL record: [%s].\n", ast_str_buffer(sql));
+	/* Test to be sure we're still connected... */
+	/* If we're connected, and connection is working, good. */
+	/* Otherwise, attempt reconnect.  If it fails... sorry... */
+	if (PQstatus(conn) == CONNECTION_OK) {
+		connected = 1;
+	} else {
+		ast_log(LOG_WARNING, "Connection was lost... attempting to reconnect.\n");
+		PQreset(conn);
 		if (PQstatus(conn) == CONNECTION_OK) {
+			ast_log(LOG_NOTICE, "Connection reestablished.\n");
 			connected = 1;
 		} else {
-			ast_log(LOG_WARNING, "Connection was lost... attempting to reconnect.\n");
-			PQreset(conn);
-			if (PQstatus(conn) == CONNECTION_OK) {
-				ast_log(LOG_NOTICE, "Connection reestablished.\n");
-				connected = 1;
-			} else {
-				pgerror = PQerrorMessage(conn);
-				ast_log(LOG_ERROR, "Unable to reconnect to database server %s. Calls will not be logged!\n", pghostname);
+			pgerror = PQerrorMessage(conn);
+			ast_log(LOG_ERROR, "Unable to reconnect to database server %s. Calls will not be logged!\n", pghostname);
+			ast_log(LOG_ERROR, "Reason: %s\n", pgerror);
+			PQfinish(conn);
+			conn = NULL;
+			connected = 0;
+			return -1;
+		}
+	}
+	result = PQexec(conn, ast_str_buffer(sql));
+	if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+		pgerror = PQresultErrorMessage(result);
+		ast_log(LOG_WARNING, "Failed to insert call detail record into database!\n");
+		ast_log(LOG_WARNING, "Reason: %s\n", pgerror);
+		ast_log(LOG_WARNING, "Connection may have been lost... attempting to reconnect.\n");
+		PQreset(conn);
+		if (PQstatus(conn) == CONNECTION_OK) {
+			ast_log(LOG_NOTICE, "Connection reestablished.\n");
+			connected = 1;
+			PQclear(result);
+			result = PQexec(conn, ast_str_buffer(sql));
+			if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+				pgerror = PQresultErrorMessage(result);
+				ast_log(LOG_ERROR, "HARD ERROR!  Attempted reconnection failed.  DROPPING CALL RECORD!\n");
 				ast_log(LOG_ERROR, "Reason: %s\n", pgerror);
-				PQfinish(conn);
-				conn = NULL;
-				connected = 0;
-				goto ast_log_cleanup;
+			} else {
+				res = 0;
 			}
 		}
-		result = PQexec(conn, ast_str_buffer(sql));
-		if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-			pgerror = PQresultErrorMessage(result);
-			ast_log(LOG_WARNING, "Failed to insert call detail record into database!\n");
-			ast_log(LOG_WARNING, "Reason: %s\n", pgerror);
-			ast_log(LOG_WARNING, "Connection may have been lost... attempting to reconnect.\n");
-			PQreset(conn);
-			if (PQstatus(conn) == CONNECTION_OK) {
-				ast_log(LOG_NOTICE, "Connection reestablished.\n");
-				connected = 1;
-				PQclear(result);
-				result = PQexec(conn, ast_str_buffer(sql));
-				if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-					pgerror = PQresultErrorMessage(result);
-					ast_log(LOG_ERROR, "HARD ERROR!  Attempted reconnection failed.  DROPPING CALL RECORD!\n");
-					ast_log(LOG_ERROR, "Reason: %s\n", pgerror);
-				}
+	} else {
+		res = 0;
+	}
+	PQclear(result);
+
+	/* Next time, just allocate buffers that are that big to start with. */
+	if (ast_str_strlen(sql) > maxsize) {
+		maxsize = ast_str_strlen(sql);
+	}
+
+	return res;
+}
+
+/*!
+ * \brief Insert a batch of events
+ *
+ * The events go in as one multi-row INSERT where the server takes them.  If
+ * that fails, they are inserted one by one so a single bad event does not
+ * lose the batch.
+ */
+static void pgsql_log_batch(struct ast_event **events, size_t count)
+{
+	struct ast_cel_event_record *records;
+	struct ast_str *sql = NULL;
+	char *escapebuf = NULL;
+	size_t bufsize = 513;
+	size_t filled = 0;
+	size_t idx;
+
+	records = ast_calloc(count, sizeof(*records));
+	if (!records) {
+		return;
+	}
+	for (idx = 0; idx < count; ++idx) {
+		records[filled].version = AST_CEL_EVENT_RECORD_VERSION;
+		if (!ast_cel_fill_record(events[idx], &records[filled])) {
+			++filled;
+		}
+	}
+	if (!filled) {
+		ast_free(records);
+		return;
+	}
+
+	ast_mutex_lock(&pgsql_lock);
+
+	pgsql_connect();
+	if (!connected) {
+		goto ast_log_cleanup;
+	}
+
+	sql = ast_str_create(maxsize);
+	escapebuf = ast_malloc(bufsize);
+	if (!escapebuf || !sql) {
+		goto ast_log_cleanup;
+	}
+
+	/* Multi-row VALUES is there as of PostgreSQL 8.2 */
+	if (filled > 1 && PQserverVersion(conn) >= 80200) {
+		AST_RWLIST_RDLOCK(&psql_columns);
+		pgsql_append_columns(&sql);
+		for (idx = 0; idx < filled; ++idx) {
+			if (idx) {
+				ast_str_append(&sql, 0, ",");
+			}
+			if (pgsql_append_values(&sql, &records[idx], &escapebuf, &bufsize)) {
+				AST_RWLIST_UNLOCK(&psql_columns);
+				goto ast_log_cleanup;
 			}
 		}
-		PQclear(result);
+		AST_RWLIST_UNLOCK(&psql_columns);
 
-		/* Next time, just allocate buffers that are that big to start with. */
-		if (ast_str_strlen(sql) > maxsize) {
-			maxsize = ast_str_strlen(sql);
+		if (!pgsql_exec(sql) || !connected) {
+			goto ast_log_cleanup;
 		}
-		if (ast_str_strlen(sql2) > maxsize2) {
-			maxsize2 = ast_str_strlen(sql2);
+		ast_log(LOG_WARNING, "Inserting the %zu events of the batch one by one\n", filled);
+	}
+
+	for (idx = 0; idx < filled && connected; ++idx) {
+		ast_str_reset(sql);
+		AST_RWLIST_RDLOCK(&psql_columns);
+		pgsql_append_columns(&sql);
+		if (pgsql_append_values(&sql, &records[idx], &escapebuf, &bufsize)) {
+			AST_RWLIST_UNLOCK(&psql_columns);
+			break;
 		}
+		AST_RWLIST_UNLOCK(&psql_columns);
 
-ast_log_cleanup:
-		ast_free(sql);
-		ast_free(sql2);
-		ast_free(escapebuf);
+		pgsql_exec(sql);
 	}
 
+ast_log_cleanup:
+	ast_free(sql);
+	ast_free(escapebuf);
+
 	ast_mutex_unlock(&pgsql_lock);
+
+	ast_free(records);
+}
+
+static void pgsql_log(struct ast_event *event)
+{
+	pgsql_log_batch(&event, 1);
 }
 
 static int my_unload_module(void)
@@ -685,7 +748,7 @@ static int my_load_module(int reload)
 	process_my_load_module(cfg);
 	ast_config_destroy(cfg);
 
-	if (ast_cel_backend_register(PGSQL_BACKEND_NAME, pgsql_log)) {
+	if (ast_cel_backend_register_batch(PGSQL_BACKEND_NAME, pgsql_log, pgsql_log_batch)) {
 		ast_log(LOG_WARNING, "Unable to subscribe to CEL events for pgsql\n");
 		return AST_MODULE_LOAD_DECLINE;
 	}
@@ -44,9 +44,15 @@
 
 #define FD_OUTPUT 1	/* A fd of -1 means an error, 0 is stdin */
 
+/*! The most audio gathered into a single write, in milliseconds */
+#define AGGREGATE_MAX_MS 1000
+
 struct audiosocket_instance {
 	int svc;	/* The file descriptor for the AudioSocket instance */
 	char id[38];	/* The UUID identifying this AudioSocket instance */
+	unsigned int aggregate_ms;	/* Audio gathered before writing it, 0 to write each frame */
+	unsigned int pending_ms;	/* Audio in the pending frames */
+	AST_VECTOR(, struct ast_frame *) pending;	/* Frames waiting to be written */
 } audiosocket_instance;
 
 /* Forward declarations */
@@ -82,17 +88,56 @@ static struct ast_frame *audiosocket_read(struct ast_channel *ast)
 	return ast_audiosocket_receive_frame(instance->svc);
 }
 
+/*! \brief Write the frames gathered on an instance in a single write */
+static int audiosocket_flush(struct audiosocket_instance *instance)
+{
+	int res;
+
+	if (!AST_VECTOR_SIZE(&instance->pending)) {
+		return 0;
+	}
+
+	res = ast_audiosocket_send_frames(instance->svc, AST_VECTOR_GET_ADDR(&instance->pending, 0),
+		AST_VECTOR_SIZE(&instance->pending));
+	AST_VECTOR_RESET(&instance->pending, ast_frfree);
+	instance->pending_ms = 0;
+
+	return res;
+}
+
 /*! \brief Function called when we should write a frame to the channel */
 static int audiosocket_write(struct ast_channel *ast, struct ast_frame *f)
 {
 	struct audiosocket_instance *instance;
+	struct ast_frame *dup;
 
 	/* The channel should always be present from the API */
 	instance = ast_channel_tech_pvt(ast);
 	if (instance == NULL || instance->svc < 1) {
 		return -1;
 	}
-	return ast_audiosocket_send_frame(instance->svc, f);
+
+	if (!instance->aggregate_ms || f->frametype != AST_FRAME_VOICE) {
+		/* Anything gathered goes first to keep the order */
+		if (audiosocket_flush(instance)) {
+			return -1;
+		}
+		return ast_audiosocket_send_frame(instance->svc, f);
+	}
+
+	dup = ast_frdup(f);
+	if (!dup || AST_VECTOR_APPEND(&instance->pending, dup)) {
+		ast_frfree(dup);
+		return -1;
+	}
+	instance->pending_ms += f->samples * 1000 / ast_format_get_sample_rate(f->subclass.format);
+
+	if (instance->pending_ms < instance->aggregate_ms
+		&& AST_VECTOR_SIZE(&instance->pending) < AST_AUDIOSOCKET_MAX_FRAMES) {
+		return 0;
+	}
+
+	return audiosocket_flush(instance);
 }
 
 /*! \brief Function called when we should actually call the destination */
@@ -113,10 +158,15 @@ static int audiosocket_hangup(struct ast_channel *ast)
 	/* The channel should always be present from the API */
 	instance = ast_channel_tech_pvt(ast);
 	if (instance != NULL && instance->svc > 0) {
+		audiosocket_flush(instance);
 		close(instance->svc);
 	}
 
 	ast_channel_tech_pvt_set(ast, NULL);
+	if (instance != NULL) {
+		AST_VECTOR_RESET(&instance->pending, ast_frfree);
+		AST_VECTOR_FREE(&instance->pending);
+	}
 	ast_free(instance);
 
 	return 0;
@@ -124,14 +174,17 @@ static int audiosocket_hangup(struct ast_channel *ast)
 
 enum {
 	OPT_AUDIOSOCKET_CODEC = (1 << 0),
+	OPT_AUDIOSOCKET_AGGREGATE = (1 << 1),
 };
 
 enum {
 	OPT_ARG_AUDIOSOCKET_CODEC = (1 << 0),
+	OPT_ARG_AUDIOSOCKET_AGGREGATE,
 	OPT_ARG_ARRAY_SIZE
 };
 
 AST_APP_OPTIONS(audiosocket_options, BEGIN_OPTIONS
+	AST_APP_OPTION_ARG('a', OPT_AUDIOSOCKET_AGGREGATE, OPT_ARG_AUDIOSOCKET_AGGREGATE),
 	AST_APP_OPTION_ARG('c', OPT_AUDIOSOCKET_CODEC, OPT_ARG_AUDIOSOCKET_CODEC),
 END_OPTIONS );
 
@@ -148,6 +201,7 @@ static struct ast_channel *audiosocket_request(const char *type,
 	struct ast_format *fmt = NULL;
 	uuid_t uu;
 	int fd;
+	unsigned int aggregate_ms = 0;
 	AST_DECLARE_APP_ARGS(args,
 		AST_APP_ARG(destination);
 		AST_APP_ARG(idStr);
@@ -207,6 +261,17 @@ static struct ast_channel *audiosocket_request(const char *type,
 		}
 	}
 
+	if (ast_test_flag(&opts, OPT_AUDIOSOCKET_AGGREGATE)
+		&& !ast_strlen_zero(opt_args[OPT_ARG_AUDIOSOCKET_AGGREGATE])) {
+		if (sscanf(opt_args[OPT_ARG_AUDIOSOCKET_AGGREGATE], "%30u", &aggregate_ms) != 1
+			|| aggregate_ms > AGGREGATE_MAX_MS) {
+			ast_log(LOG_ERROR, "Aggregation interval '%s' is invalid for AudioSocket connection to '%s', "
+				"it must be from 0 to %d milliseconds\n",
+				opt_args[OPT_ARG_AUDIOSOCKET_AGGREGATE], args.destination, AGGREGATE_MAX_MS);
+			goto failure;
+		}
+	}
+
 	caps = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
 	if (!caps) {
 		goto failure;
@@ -218,6 +283,7 @@ static struct ast_channel *audiosocket_request(const char *type,
 		goto failure;
 	}
 	ast_copy_string(instance->id, args.idStr, sizeof(instance->id));
+	instance->aggregate_ms = aggregate_ms;
 
 	if ((fd = ast_audiosocket_connect(args.destination, NULL)) < 0) {
 		goto failure;
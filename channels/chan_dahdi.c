@@ -8876,6 +8876,10 @@ static int my_dahdi_write(struct dahdi_pvt *p, unsigned char *buf, int len, int
 	int res;
 	int fd;
 	fd = p->subs[idx].dfd;
+	/*
+	 * DAHDI accepts at most one block per write() and has no interface to
+	 * move the audio of several channels at once, so longer frames are split.
+	 */
 	while (len) {
 		size = len;
 		if (size > (linear ? READ_SIZE * 2 : READ_SIZE))
@@ -8887,6 +8891,7 @@ static int my_dahdi_write(struct dahdi_pvt *p, unsigned char *buf, int len, int
 		}
 		len -= size;
 		buf += size;
+		sent += size;
 	}
 	return sent;
 }
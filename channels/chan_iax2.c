@@ -608,6 +608,19 @@ struct iax2_trunk_peer {
 	int trunkmaxmtu;
 	int trunkerror;
 	int calls;
+	/*! Buffer the timer transmits from, swapped with trunkdata so queueing is not held up by the send */
+	unsigned char *txdata;
+	unsigned int txdataalloc;
+	/*! When the first call chunk of the pending trunk frame was queued */
+	struct timeval firstqueued;
+	/* Trunk frame statistics */
+	unsigned int flushes;			/*!< Trunk frames sent */
+	unsigned int flushcalls;		/*!< Call chunks sent in trunk frames */
+	unsigned long flushbytes;		/*!< Bytes sent in trunk frames */
+	unsigned long latencysum;		/*!< Total time trunk frames were pending before being sent, in ms */
+	unsigned int maxlatency;		/*!< Longest time a trunk frame was pending before being sent, in ms */
+	/*! Next trunk peer the timer has a frame to transmit for */
+	struct iax2_trunk_peer *flushnext;
 	AST_LIST_ENTRY(iax2_trunk_peer) list;
 };
 
@@ -1082,18 +1095,18 @@ struct iax2_thread {
 	ast_cond_t cond;
 	ast_mutex_t init_lock;
 	ast_cond_t init_cond;
-	/*! if this thread is processing a full frame,
+	/*! if this thread is processing a full or mini frame,
 	  some information about that frame will be stored
-	  here, so we can avoid dispatching any more full
-	  frames for that callno to other threads */
+	  here, so we can avoid dispatching any more frames
+	  for that callno to other threads */
 	struct {
 		unsigned short callno;
 		struct ast_sockaddr addr;
 		unsigned char type;
 		unsigned char csub;
 	} ffinfo;
-	/*! Queued up full frames for processing.  If more full frames arrive for
-	 *  a call which this thread is already processing a full frame for, they
+	/*! Queued up frames for processing.  If more full or mini frames arrive
+	 *  for a call which this thread is already processing a frame for, they
 	 *  are queued up here. */
 	AST_LIST_HEAD_NOLOCK(, iax2_pkt_buf) full_frames;
 	unsigned char stop;
@@ -6301,6 +6314,10 @@ static int iax2_trunk_queue(struct chan_iax2_pvt *pvt, struct iax_frame *fr)
 			}
 		}
 
+		if (!tpeer->trunkdatalen) {
+			tpeer->firstqueued = ast_tvnow();
+		}
+
 		/* Append to meta frame */
 		ptr = tpeer->trunkdata + IAX2_TRUNK_PREFACE + tpeer->trunkdatalen;
 		if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS)) {
@@ -7549,6 +7566,41 @@ static int ast_cli_netstats(struct mansession *s, int fd, int limit_fmt)
 	return numchans;
 }
 
+/*! \brief Show how full the trunk frames sent to each trunk peer are, and how long call chunks wait in them */
+static void cli_trunk_netstats(int fd)
+{
+#define FORMAT "%-40.40s %8u %6u %6u %5u%% %6u %6u\n"
+	struct iax2_trunk_peer *tpeer;
+	int mtu = global_max_trunk_mtu > 0 ? global_max_trunk_mtu : MAX_TRUNK_MTU;
+	int numtrunks = 0;
+
+	AST_LIST_LOCK(&tpeers);
+	AST_LIST_TRAVERSE(&tpeers, tpeer, list) {
+		unsigned int bytes = 0, calls = 0, latency = 0;
+
+		if (!numtrunks++) {
+			ast_cli(fd, "\n%-40.40s %8s %6s %6s %6s %6s %6s\n",
+				"Trunk peer", "Frames", "Calls", "Bytes", "Fill", "AvgLat", "MaxLat");
+		}
+		ast_mutex_lock(&tpeer->lock);
+		if (tpeer->flushes) {
+			bytes = tpeer->flushbytes / tpeer->flushes;
+			calls = tpeer->flushcalls / tpeer->flushes;
+			latency = tpeer->latencysum / tpeer->flushes;
+		}
+		ast_cli(fd, FORMAT, ast_sockaddr_stringify(&tpeer->addr), tpeer->flushes,
+			calls, bytes, bytes * 100 / mtu, latency, tpeer->maxlatency);
+		ast_mutex_unlock(&tpeer->lock);
+	}
+	AST_LIST_UNLOCK(&tpeers);
+
+	if (numtrunks) {
+		ast_cli(fd, "%d active IAX trunk%s (Calls and Bytes per frame, Fill of an MTU of %d, latencies in ms)\n",
+			numtrunks, (numtrunks != 1) ? "s" : "", mtu);
+	}
+#undef FORMAT
+}
+
 static char *handle_cli_iax2_show_netstats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	int numchans = 0;
@@ -7558,7 +7610,9 @@ static char *handle_cli_iax2_show_netstats(struct ast_cli_entry *e, int cmd, str
 		e->command = "iax2 show netstats";
 		e->usage =
 			"Usage: iax2 show netstats\n"
-			"       Lists network status for all currently active IAX channels.\n";
+			"       Lists network status for all currently active IAX channels,\n"
+			"       followed by the size of the frames sent to each trunk peer and\n"
+			"       how long call chunks wait to be sent in them.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
@@ -7569,6 +7623,7 @@ static char *handle_cli_iax2_show_netstats(struct ast_cli_entry *e, int cmd, str
 	ast_cli(a->fd, "Channel               RTT  Jit  Del  Lost   %%  Drop  OOO  Kpkts  Jit  Del  Lost   %%  Drop  OOO  Kpkts FirstMsg    LastMsg\n");
 	numchans = ast_cli_netstats(NULL, a->fd, 1);
 	ast_cli(a->fd, "%d active IAX channel%s\n", numchans, (numchans != 1) ? "s" : "");
+	cli_trunk_netstats(a->fd);
 	return CLI_SUCCESS;
 }
 
@@ -9391,43 +9446,71 @@ static int iax2_poke_peer_s(const void *data)
 	return 0;
 }
 
-static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
+/*!
+ * \brief Fill in the headers of the pending trunk frame of a trunk peer
+ *
+ * \note The trunk peer must be locked.
+ *
+ * \return The number of call chunks in the frame, 0 if there is nothing to send
+ */
+static int prepare_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 {
-	int res = 0;
 	struct iax_frame *fr;
 	struct ast_iax2_meta_hdr *meta;
 	struct ast_iax2_meta_trunk_hdr *mth;
-	int calls = 0;
+	int calls;
+	int latency;
+
+	if (!tpeer->trunkdatalen) {
+		return 0;
+	}
 
 	/* Point to frame */
 	fr = (struct iax_frame *)tpeer->trunkdata;
 	/* Point to meta data */
 	meta = (struct ast_iax2_meta_hdr *)fr->afdata;
 	mth = (struct ast_iax2_meta_trunk_hdr *)meta->data;
-	if (tpeer->trunkdatalen) {
-		/* We're actually sending a frame, so fill the meta trunk header and meta header */
-		meta->zeros = 0;
-		meta->metacmd = IAX_META_TRUNK;
-		if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS))
-			meta->cmddata = IAX_META_TRUNK_MINI;
-		else
-			meta->cmddata = IAX_META_TRUNK_SUPERMINI;
-		mth->ts = htonl(calc_txpeerstamp(tpeer, trunkfreq, now));
-		/* And the rest of the ast_iax2 header */
-		fr->direction = DIRECTION_OUTGRESS;
-		fr->retrans = -1;
-		fr->transfer = 0;
-		/* Any appropriate call will do */
-		fr->data = fr->afdata;
-		fr->datalen = tpeer->trunkdatalen + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
-		res = transmit_trunk(fr, &tpeer->addr, tpeer->sockfd);
-		calls = tpeer->calls;
-#if 0
-		ast_debug(1, "Trunking %d call chunks in %d bytes to %s:%d, ts=%d\n", calls, fr->datalen, ast_inet_ntoa(tpeer->addr.sin_addr), ntohs(tpeer->addr.sin_port), ntohl(mth->ts));
-#endif
-		/* Reset transmit trunk side data */
-		tpeer->trunkdatalen = 0;
-		tpeer->calls = 0;
+	/* We're actually sending a frame, so fill the meta trunk header and meta header */
+	meta->zeros = 0;
+	meta->metacmd = IAX_META_TRUNK;
+	if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS))
+		meta->cmddata = IAX_META_TRUNK_MINI;
+	else
+		meta->cmddata = IAX_META_TRUNK_SUPERMINI;
+	mth->ts = htonl(calc_txpeerstamp(tpeer, trunkfreq, now));
+	/* And the rest of the ast_iax2 header */
+	fr->direction = DIRECTION_OUTGRESS;
+	fr->retrans = -1;
+	fr->transfer = 0;
+	/* Any appropriate call will do */
+	fr->data = fr->afdata;
+	fr->datalen = tpeer->trunkdatalen + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
+	calls = tpeer->calls;
+
+	latency = MAX(ast_tvdiff_ms(*now, tpeer->firstqueued), 0);
+	tpeer->flushes++;
+	tpeer->flushcalls += calls;
+	tpeer->flushbytes += fr->datalen;
+	tpeer->latencysum += latency;
+	if (latency > tpeer->maxlatency) {
+		tpeer->maxlatency = latency;
+	}
+
+	/* Reset transmit trunk side data */
+	tpeer->trunkdatalen = 0;
+	tpeer->calls = 0;
+
+	return calls;
+}
+
+static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
+{
+	int res = 0;
+	int calls;
+
+	calls = prepare_trunk(tpeer, now);
+	if (calls) {
+		res = transmit_trunk((struct iax_frame *)tpeer->trunkdata, &tpeer->addr, tpeer->sockfd);
 	}
 	if (res < 0)
 		return res;
@@ -9446,6 +9529,7 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 {
 	int res, processed = 0, totalcalls = 0;
 	struct iax2_trunk_peer *tpeer = NULL, *drop = NULL;
+	struct iax2_trunk_peer *flushes = NULL, **flushtail = &flushes;
 	struct timeval now = ast_tvnow();
 
 	if (iaxtrunkdebug) {
@@ -9473,7 +9557,21 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			AST_LIST_REMOVE_CURRENT(list);
 			drop = tpeer;
 		} else {
-			res = send_trunk(tpeer, &now);
+			res = prepare_trunk(tpeer, &now);
+			if (res) {
+				unsigned char *data = tpeer->trunkdata;
+				unsigned int alloc = tpeer->trunkdataalloc;
+
+				/* Hand the frame to the transmit buffer, so calls can queue
+				   into the other one while it is being sent */
+				tpeer->trunkdata = tpeer->txdata;
+				tpeer->trunkdataalloc = tpeer->txdataalloc;
+				tpeer->txdata = data;
+				tpeer->txdataalloc = alloc;
+				tpeer->flushnext = NULL;
+				*flushtail = tpeer;
+				flushtail = &tpeer->flushnext;
+			}
 			trunk_timed++;
 			if (iaxtrunkdebug) {
 				ast_verbose(" - Trunk peer (%s) has %d call chunk%s in transit, %u bytes backloged and has hit a high water mark of %u bytes\n",
@@ -9491,6 +9589,12 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 	AST_LIST_TRAVERSE_SAFE_END;
 	AST_LIST_UNLOCK(&tpeers);
 
+	/* Send the trunk frames without holding any lock.  The transmit buffers
+	   are only ever touched here, and trunk peers are only freed below. */
+	for (tpeer = flushes; tpeer; tpeer = tpeer->flushnext) {
+		transmit_trunk((struct iax_frame *)tpeer->txdata, &tpeer->addr, tpeer->sockfd);
+	}
+
 	if (drop) {
 		ast_mutex_lock(&drop->lock);
 		/*  Once we have this lock, we're sure nobody else is using it or could use it once we release it,
@@ -9500,6 +9604,8 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			ast_free(drop->trunkdata);
 			drop->trunkdata = NULL;
 		}
+		ast_free(drop->txdata);
+		drop->txdata = NULL;
 		ast_mutex_unlock(&drop->lock);
 		ast_mutex_destroy(&drop->lock);
 		ast_free(drop);
@@ -9719,15 +9825,17 @@ static void handle_deferred_full_frames(struct iax2_thread *thread)
 }
 
 /*!
- * \brief Queue the last read full frame for processing by a certain thread
+ * \brief Queue the last read full or mini frame for processing by a certain thread
  *
- * If there are already any full frames queued, they are sorted
- * by sequence number.
+ * If there are already any full frames queued, a full frame is sorted
+ * among them by sequence number. Mini frames are queued in the order
+ * they arrived.
  */
 static void defer_full_frame(struct iax2_thread *from_here, struct iax2_thread *to_here)
 {
 	struct iax2_pkt_buf *pkt_buf, *cur_pkt_buf;
 	struct ast_iax2_full_hdr *fh, *cur_fh;
+	int full;
 
 	if (!(pkt_buf = ast_calloc(1, sizeof(*pkt_buf) + from_here->buf_len)))
 		return;
@@ -9736,10 +9844,15 @@ static void defer_full_frame(struct iax2_thread *from_here, struct iax2_thread *
 	memcpy(pkt_buf->buf, from_here->buf, pkt_buf->len);
 
 	fh = (struct ast_iax2_full_hdr *) pkt_buf->buf;
+	full = ntohs(fh->scallno) & IAX_FLAG_FULL;
 	ast_mutex_lock(&to_here->lock);
 	AST_LIST_TRAVERSE_SAFE_BEGIN(&to_here->full_frames, cur_pkt_buf, entry) {
+		if (!full) {
+			cur_pkt_buf = NULL;
+			break;
+		}
 		cur_fh = (struct ast_iax2_full_hdr *) cur_pkt_buf->buf;
-		if (fh->oseqno < cur_fh->oseqno) {
+		if ((ntohs(cur_fh->scallno) & IAX_FLAG_FULL) && fh->oseqno < cur_fh->oseqno) {
 			AST_LIST_INSERT_BEFORE_CURRENT(pkt_buf, entry);
 			break;
 		}
@@ -9761,6 +9874,7 @@ static int socket_read(int *id, int fd, short events, void *cbdata)
 	time_t t;
 	static time_t last_errtime = 0;
 	struct ast_iax2_full_hdr *fh;
+	uint16_t callno = 0;
 
 	if (!(thread = find_idle_thread())) {
 		time(&t);
@@ -9790,13 +9904,16 @@ static int socket_read(int *id, int fd, short events, void *cbdata)
 		return 1;
 	}
 
-	/* Determine if this frame is a full frame; if so, and any thread is currently
-	   processing a full frame for the same callno from this peer, then drop this
-	   frame (and the peer will retransmit it) */
+	/* Determine if this frame is a full or mini frame; if so, and any thread is
+	   currently processing a frame for the same callno from this peer, then queue
+	   this frame up for that thread, rather than have another thread wait for the
+	   lock of the call. Meta and video frames start with a zero callno. */
 	fh = (struct ast_iax2_full_hdr *) thread->buf;
-	if (ntohs(fh->scallno) & IAX_FLAG_FULL) {
+	if (thread->buf_len >= sizeof(struct ast_iax2_mini_hdr)) {
+		callno = ntohs(fh->scallno) & ~IAX_FLAG_FULL;
+	}
+	if (callno) {
 		struct iax2_thread *cur = NULL;
-		uint16_t callno = ntohs(fh->scallno) & ~IAX_FLAG_FULL;
 
 		AST_LIST_LOCK(&active_list);
 		AST_LIST_TRAVERSE(&active_list, cur, list) {
@@ -9805,7 +9922,7 @@ static int socket_read(int *id, int fd, short events, void *cbdata)
 				break;
 		}
 		if (cur) {
-			/* we found another thread processing a full frame for this call,
+			/* we found another thread processing a frame for this call,
 			   so queue it up for processing later. */
 			defer_full_frame(thread, cur);
 			AST_LIST_UNLOCK(&active_list);
@@ -9816,8 +9933,13 @@ static int socket_read(int *id, int fd, short events, void *cbdata)
 			/* this thread is going to process this frame, so mark it */
 			thread->ffinfo.callno = callno;
 			ast_sockaddr_copy(&thread->ffinfo.addr, &thread->ioaddr);
-			thread->ffinfo.type = fh->type;
-			thread->ffinfo.csub = fh->csub;
+			if (ntohs(fh->scallno) & IAX_FLAG_FULL) {
+				thread->ffinfo.type = fh->type;
+				thread->ffinfo.csub = fh->csub;
+			} else {
+				thread->ffinfo.type = AST_FRAME_VOICE;
+				thread->ffinfo.csub = 0;
+			}
 			AST_LIST_INSERT_HEAD(&active_list, thread, list);
 		}
 		AST_LIST_UNLOCK(&active_list);
@@ -288,6 +288,8 @@
 #include "asterisk/http_websocket.h"
 #include "asterisk/format_cache.h"
 #include "asterisk/linkedlists.h"	/* for AST_LIST_NEXT */
+#include "asterisk/threadpool.h"
+#include "asterisk/taskprocessor.h"
 
 /*** DOCUMENTATION
 	<application name="SIPDtmfMode" language="en_US">
@@ -905,6 +907,10 @@ static enum channelreloadreason sip_reloadreason;       /*!< Reason for last rel
 struct ast_sched_context *sched;     /*!< The scheduling context */
 static struct io_context *io;           /*!< The IO context */
 static int *sipsock_read_id;            /*!< ID of IO entry for sipsock FD */
+static struct ast_threadpool *udp_pool;           /*!< Threads handling the packets read from sipsock */
+static struct ast_taskprocessor **udp_serializers; /*!< Serializers of udp_pool, chosen by Call-ID */
+static struct ast_serializer_shutdown_group *udp_shutdown_group; /*!< Waits for udp_serializers to finish */
+static int udp_serializer_count;        /*!< Number of udp_serializers, 0 to handle packets in the monitor */
 struct sip_pkt;
 static AST_LIST_HEAD_STATIC(domain_list, domain);    /*!< The SIP domain list */
 
@@ -21804,6 +21810,11 @@ static char *sip_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		ast_cli(a->fd, "  ** Additional Info:\n");
 		ast_cli(a->fd, "     [::] may include IPv4 in addition to IPv6, if such a feature is enabled in the OS.\n");
 	}
+	if (udp_serializer_count) {
+		ast_cli(a->fd, "  UDP Threads:            %d\n", udp_serializer_count);
+	} else {
+		ast_cli(a->fd, "  UDP Threads:            Monitor\n");
+	}
 	ast_cli(a->fd, "  TCP SIP Bindaddress:    %s\n",
 		sip_cfg.tcp_enabled != FALSE ?
 				ast_sockaddr_stringify(&sip_tcp_desc.local_address) :
@@ -29287,19 +29298,103 @@ static int handle_incoming(struct sip_pvt *p, struct sip_request *req, struct as
 	return res;
 }
 
+/*! \brief A UDP packet read by the monitor, to be handled by a serializer */
+struct sip_udp_packet {
+	/*! Who sent the packet */
+	struct ast_sockaddr addr;
+	/*! The contents of the packet */
+	char data[0];
+};
+
+/*! \brief Handle a packet read from the SIP UDP socket */
+static void sipsock_handle_packet(const char *data, struct ast_sockaddr *addr)
+{
+	struct sip_request req;
+
+	memset(&req, 0, sizeof(req));
+	if (!(req.data = ast_str_create(SIP_MIN_PACKET))) {
+		return;
+	}
+
+	if (ast_str_set(&req.data, 0, "%s", data) == AST_DYNSTR_BUILD_FAILED) {
+		deinit_req(&req);
+		return;
+	}
+
+	req.socket.fd = sipsock;
+	set_socket_transport(&req.socket, AST_TRANSPORT_UDP);
+	req.socket.tcptls_session	= NULL;
+	req.socket.port = htons(ast_sockaddr_port(&bindaddr));
+
+	handle_request_do(&req, addr);
+	deinit_req(&req);
+}
+
+/*! \brief Serializer task handling a packet read by the monitor */
+static int sipsock_packet_task(void *data)
+{
+	struct sip_udp_packet *packet = data;
+
+	sipsock_handle_packet(packet->data, &packet->addr);
+	ast_free(packet);
+
+	return 0;
+}
+
+/*!
+ * \brief Hash the Call-ID of a packet, without parsing it
+ *
+ * \note Packets without a Call-ID hash to 0, the dialog they are for is not
+ * found anyway.
+ */
+static unsigned int sip_packet_callid_hash(const char *data)
+{
+	const char *line = data;
+	const char *value;
+	unsigned int hash = 0;
+
+	while (line && *line && *line != '\r' && *line != '\n') {
+		value = NULL;
+		if (!strncasecmp(line, "Call-ID", 7)) {
+			value = line + 7;
+		} else if ((*line == 'i' || *line == 'I') && (line[1] == ':' || line[1] == ' ' || line[1] == '\t')) {
+			value = line + 1;
+		}
+		if (value) {
+			while (*value == ' ' || *value == '\t') {
+				value++;
+			}
+			if (*value == ':') {
+				for (value = ast_skip_blanks(value + 1); *value && !isspace(*value); value++) {
+					hash = hash * 31 + (unsigned char) *value;
+				}
+				return hash;
+			}
+		}
+		line = strchr(line, '\n');
+		if (line) {
+			line++;
+		}
+	}
+
+	return hash;
+}
+
 /*! \brief Read data from SIP UDP socket
 \note sipsock_read locks the owner channel while we are processing the SIP message
 \return 1 on error, 0 on success
 \note Successful messages is connected to SIP call and forwarded to handle_incoming()
+\note With udpthreads set, the message is handled by the serializer chosen by its
+	Call-ID instead, so the messages of a dialog are still handled in order
 */
 static int sipsock_read(int *id, int fd, short events, void *ignore)
 {
-	struct sip_request req;
 	struct ast_sockaddr addr;
+	struct sip_udp_packet *packet;
+	struct ast_taskprocessor *serializer;
 	int res;
 	static char readbuf[65535];
 
-	memset(&req, 0, sizeof(req));
 	res = ast_recvfrom(fd, readbuf, sizeof(readbuf) - 1, 0, &addr);
 	if (res < 0) {
 #if !defined(__FreeBSD__)
@@ -29314,23 +29409,98 @@ static int sipsock_read(int *id, int fd, short events, void *ignore)
 
 	readbuf[res] = '\0';
 
-	if (!(req.data = ast_str_create(SIP_MIN_PACKET))) {
+	if (!udp_serializer_count) {
+		sipsock_handle_packet(readbuf, &addr);
+		return 1;
+	}
+
+	if (!(packet = ast_malloc(sizeof(*packet) + res + 1))) {
 		return 1;
 	}
+	ast_sockaddr_copy(&packet->addr, &addr);
+	memcpy(packet->data, readbuf, res + 1);
+
+	serializer = udp_serializers[sip_packet_callid_hash(packet->data) % udp_serializer_count];
+	if (ast_taskprocessor_push(serializer, sipsock_packet_task, packet)) {
+		ast_free(packet);
+	}
 
-	if (ast_str_set(&req.data, 0, "%s", readbuf) == AST_DYNSTR_BUILD_FAILED) {
+	return 1;
+}
+
+/*! \brief Start the serializers handling UDP packets, as many as udpthreads */
+static int sip_udp_serializers_start(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = sip_cfg.udp_threads,
+		.max_size = sip_cfg.udp_threads,
+	};
+	char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	int count = sip_cfg.udp_threads;
+	int i;
+
+	if (!count) {
+		return 0;
+	}
+
+	udp_shutdown_group = ast_serializer_shutdown_group_alloc();
+	if (!udp_shutdown_group) {
+		return -1;
+	}
+	udp_pool = ast_threadpool_create("sip-udp", NULL, &options);
+	if (!udp_pool) {
 		return -1;
 	}
+	udp_serializers = ast_calloc(count + 1, sizeof(*udp_serializers));
+	if (!udp_serializers) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		snprintf(name, sizeof(name), "sip-udp-%d", i);
+		udp_serializers[i] = ast_threadpool_serializer_group(name, udp_pool, udp_shutdown_group);
+		if (!udp_serializers[i]) {
+			return -1;
+		}
+	}
+	udp_serializer_count = count;
 
-	req.socket.fd = sipsock;
-	set_socket_transport(&req.socket, AST_TRANSPORT_UDP);
-	req.socket.tcptls_session	= NULL;
-	req.socket.port = htons(ast_sockaddr_port(&bindaddr));
+	return 0;
+}
 
-	handle_request_do(&req, &addr);
-	deinit_req(&req);
+/*!
+ * \brief Stop the serializers handling UDP packets, once the monitor stopped
+ *
+ * Waits for the packets already queued to be handled, so nothing is left
+ * running when the module clears its state.
+ */
+static void sip_udp_serializers_stop(void)
+{
+	int remaining;
+	int i;
 
-	return 1;
+	udp_serializer_count = 0;
+	if (udp_serializers) {
+		/* The array ends with a NULL */
+		for (i = 0; udp_serializers[i]; i++) {
+			ast_taskprocessor_unreference(udp_serializers[i]);
+		}
+		ast_free(udp_serializers);
+		udp_serializers = NULL;
+	}
+
+	remaining = ast_serializer_shutdown_group_join(udp_shutdown_group, 10);
+	if (remaining) {
+		ast_log(LOG_WARNING, "Cleanup incomplete. Could not stop %d UDP serializers.\n",
+			remaining);
+	}
+	ao2_cleanup(udp_shutdown_group);
+	udp_shutdown_group = NULL;
+
+	ast_threadpool_shutdown(udp_pool);
+	udp_pool = NULL;
 }
 
 /*! \brief Handle incoming SIP message - request or response
@@ -32632,6 +32802,7 @@ static int reload_config(enum channelreloadreason reason)
 	sip_cfg.peer_rtupdate = TRUE;
 	global_dynamic_exclude_static = 0;	/* Exclude static peers */
 	sip_cfg.tcp_enabled = FALSE;
+	sip_cfg.udp_threads = 0;
 	sip_cfg.websocket_enabled = TRUE;
 	sip_cfg.websocket_write_timeout = AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT;
 
@@ -32802,6 +32973,13 @@ static int reload_config(enum channelreloadreason reason)
 					default_primary_transport = default_transports;
 				}
 			}
+		} else if (!strcasecmp(v->name, "udpthreads")) {
+			if (sscanf(v->value, "%30d", &sip_cfg.udp_threads) != 1
+				|| sip_cfg.udp_threads < 0 || sip_cfg.udp_threads > 64) {
+				ast_log(LOG_WARNING, "Invalid udpthreads '%s' at line %d, handling UDP packets in the monitor\n",
+					v->value, v->lineno);
+				sip_cfg.udp_threads = 0;
+			}
 		} else if (!strcasecmp(v->name, "tcpenable")) {
 			if (!ast_false(v->value)) {
 				ast_debug(2, "Enabling TCP socket for listening\n");
@@ -35474,7 +35652,7 @@ static int load_module(void)
 	subscription_mwi_list = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX,
 		AO2_CONTAINER_ALLOC_OPT_INSERT_BEGIN, NULL, NULL, "allocate subscription_mwi_list");
 
-	if (!(sched = ast_sched_context_create())) {
+	if (!(sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Unable to create scheduler context\n");
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
@@ -35595,6 +35773,11 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	if (sip_udp_serializers_start()) {
+		ast_log(LOG_WARNING, "Unable to start the threads handling UDP packets, handling them in the monitor\n");
+		sip_udp_serializers_stop();
+	}
+
 	/* And start the monitor for the first time */
 	restart_monitor();
 
@@ -35726,6 +35909,9 @@ static int unload_module(void)
 		ast_mutex_unlock(&monlock);
 	}
 
+	/* No packets are read once the monitor stopped */
+	sip_udp_serializers_stop();
+
 	/* Clear containers */
 	unlink_all_peers_from_tables();
 	cleanup_all_regs();
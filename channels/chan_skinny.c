@@ -1593,6 +1593,10 @@ struct skinny_device {
 	AST_LIST_HEAD(, skinny_serviceurl) serviceurls;
 	AST_LIST_HEAD(, skinny_addon) addons;
 	AST_LIST_ENTRY(skinny_device) list;
+	/*! Entry in the device_ids bucket of the device id */
+	AST_LIST_ENTRY(skinny_device) id_list;
+	/*! Set while the device is in device_ids */
+	unsigned int indexed:1;
 };
 
 static struct skinny_device_options {
@@ -1610,6 +1614,42 @@ static struct skinny_device_options *default_device = &default_device_struct;
 
 static AST_LIST_HEAD_STATIC(devices, skinny_device);
 
+#define DEVICE_ID_BUCKETS 257
+
+/*!
+ * \brief Configured devices hashed by device id, for registration lookups
+ * \note Protected by the devices list lock.
+ */
+static AST_LIST_HEAD_NOLOCK(, skinny_device) device_ids[DEVICE_ID_BUCKETS];
+
+/*! \brief The device_ids bucket of a device id */
+static int device_id_bucket(const char *id)
+{
+	return ast_str_case_hash(id) % DEVICE_ID_BUCKETS;
+}
+
+/*!
+ * \brief Add a configured device to device_ids
+ * \note The devices list must be locked.
+ */
+static void device_id_link(struct skinny_device *d)
+{
+	AST_LIST_INSERT_TAIL(&device_ids[device_id_bucket(d->id)], d, id_list);
+	d->indexed = 1;
+}
+
+/*!
+ * \brief Remove a device from device_ids
+ * \note The devices list must be locked.
+ */
+static void device_id_unlink(struct skinny_device *d)
+{
+	if (d->indexed) {
+		AST_LIST_REMOVE(&device_ids[device_id_bucket(d->id)], d, id_list);
+		d->indexed = 0;
+	}
+}
+
 struct skinnysession {
 	pthread_t t;
 	ast_mutex_t lock;
@@ -2272,7 +2312,7 @@ static int skinny_register(struct skinny_req *req, struct skinnysession *s)
 	}
 
 	AST_LIST_LOCK(&devices);
-	AST_LIST_TRAVERSE(&devices, d, list){
+	AST_LIST_TRAVERSE(&device_ids[device_id_bucket(req->data.reg.name)], d, id_list) {
 		struct ast_sockaddr addr;
 		ast_sockaddr_from_sin(&addr, &s->sin);
 		if (!strcasecmp(req->data.reg.name, d->id)
@@ -8391,7 +8431,7 @@ static struct skinny_device *config_device(const char *dname, struct ast_variabl
 
 	if (skinnyreload){
 		AST_LIST_LOCK(&devices);
-		AST_LIST_TRAVERSE(&devices, temp, list) {
+		AST_LIST_TRAVERSE(&device_ids[device_id_bucket(d->id)], temp, id_list) {
 			if (strcasecmp(d->id, temp->id) || !temp->prune || !temp->session) {
 				continue;
 			}
@@ -8432,6 +8472,10 @@ static struct skinny_device *config_device(const char *dname, struct ast_variabl
 		AST_LIST_UNLOCK(&devices);
 	}
 
+	AST_LIST_LOCK(&devices);
+	device_id_link(d);
+	AST_LIST_UNLOCK(&devices);
+
 	ast_mutex_unlock(&d->lock);
 
 	ast_verb(3, "%s config for device '%s'\n", update ? "Updated" : (skinnyreload ? "Reloaded" : "Created"), d->name);
@@ -8566,6 +8610,7 @@ static void delete_devices(void)
 
 	/* Delete all devices */
 	while ((d = AST_LIST_REMOVE_HEAD(&devices, list))) {
+		device_id_unlink(d);
 		/* Delete all lines for this device */
 		while ((l = AST_LIST_REMOVE_HEAD(&d->lines, list))) {
 			AST_LIST_REMOVE(&lines, l, all);
@@ -8644,6 +8689,7 @@ int skinny_reload(void)
 			ast_free(a);
 		}
 		AST_LIST_REMOVE_CURRENT(list);
+		device_id_unlink(d);
 		d = skinny_device_destroy(d);
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
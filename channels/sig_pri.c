@@ -178,6 +178,9 @@ static int pri_gendigittimeout = 8000;
 
 #define DCHAN_AVAILABLE	(DCHAN_NOTINALARM | DCHAN_UP)
 
+/*! Most D-channel events processed for each time the span lock is taken */
+#define SIG_PRI_EVENT_BATCH	8
+
 static int pri_active_dchan_index(struct sig_pri_span *pri);
 
 static const char *sig_pri_call_level2str(enum sig_pri_call_level level)
@@ -6238,6 +6241,49 @@ setup_exit:;
 	}
 }
 
+/*!
+ * \internal
+ * \brief Check if another frame is waiting on a D-channel.
+ *
+ * \param fd D-channel file descriptor.
+ *
+ * \retval non-zero if pri_check_event() would not block.
+ */
+static int sig_pri_dchan_pending(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN | POLLPRI, };
+
+	return poll(&pfd, 1, 0) > 0 && pfd.revents == POLLIN;
+}
+
+/*!
+ * \internal
+ * \brief Account for the span lock being held to process D-channel events.
+ *
+ * \param pri PRI span control structure.
+ * \param requested When the lock was requested.
+ * \param acquired When the lock was obtained.
+ * \param events How many events were processed while holding it.
+ *
+ * \note Assumes the pri->lock is already obtained.
+ */
+static void sig_pri_lock_stats_update(struct sig_pri_span *pri, struct timeval requested,
+	struct timeval acquired, unsigned int events)
+{
+	int64_t wait = ast_tvdiff_us(acquired, requested);
+	int64_t hold = ast_tvdiff_us(ast_tvnow(), acquired);
+
+	pri->lock_stats.events += events;
+	++pri->lock_stats.holds;
+	pri->lock_stats.hold_sum += hold;
+	if (pri->lock_stats.hold_max < hold) {
+		pri->lock_stats.hold_max = hold;
+	}
+	if (pri->lock_stats.wait_max < wait) {
+		pri->lock_stats.wait_max = wait;
+	}
+}
+
 static void *pri_dchannel(void *vpri)
 {
 	struct sig_pri_span *pri = vpri;
@@ -6246,6 +6292,8 @@ static void *pri_dchannel(void *vpri)
 	int res;
 	int x;
 	struct timeval tv, lowest, *next;
+	struct timeval requested, acquired;
+	unsigned int batched;
 	int doidling=0;
 	char *cc;
 	time_t t;
@@ -6420,7 +6468,10 @@ static void *pri_dchannel(void *vpri)
 		pthread_testcancel();
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 
+		requested = ast_tvnow();
 		ast_mutex_lock(&pri->lock);
+		acquired = ast_tvnow();
+		batched = 0;
 		if (!res) {
 			for (which = 0; which < SIG_PRI_NUM_DCHANS; which++) {
 				if (!pri->dchans[which])
@@ -6453,6 +6504,7 @@ static void *pri_dchannel(void *vpri)
 		} else if (errno != EINTR)
 			ast_log(LOG_WARNING, "pri_event returned error %d (%s)\n", errno, strerror(errno));
 
+next_event:
 		if (e) {
 			int chanpos = -1;
 			char cause_str[36];
@@ -7625,7 +7677,22 @@ static void *pri_dchannel(void *vpri)
 			/* If a callid was set, we need to remove it from thread storage. */
 			if (callid) {
 				ast_callid_threadassoc_remove();
+				callid = 0;
 			}
+
+			/*
+			 * During a call setup burst more frames are usually waiting.  Process
+			 * a few of them while still holding the lock rather than going
+			 * through the idle and restart checks for each one.
+			 */
+			++batched;
+			if (batched < SIG_PRI_EVENT_BATCH && sig_pri_dchan_pending(fds[which].fd)) {
+				e = pri_check_event(pri->dchans[which]);
+				if (e) {
+					goto next_event;
+				}
+			}
+			sig_pri_lock_stats_update(pri, requested, acquired, batched);
 		}
 		ast_mutex_unlock(&pri->lock);
 	}
@@ -7663,6 +7730,10 @@ int sig_pri_ami_show_spans(struct mansession *s, const char *show_cmd, struct si
 				"Active: %s\r\n"
 				"Alarm: %s\r\n"
 				"Up: %s\r\n"
+				"EventsProcessed: %u\r\n"
+				"LockHolds: %u\r\n"
+				"LockHoldMax: %" PRId64 "\r\n"
+				"LockWaitMax: %" PRId64 "\r\n"
 				"%s"
 				"\r\n",
 				show_cmd,
@@ -7672,6 +7743,10 @@ int sig_pri_ami_show_spans(struct mansession *s, const char *show_cmd, struct si
 				(pri->dchans[x] == pri->pri) ? "Yes" : "No",
 				(pri->dchanavail[x] & DCHAN_NOTINALARM) ? "No" : "Yes",
 				(pri->dchanavail[x] & DCHAN_UP) ? "Yes" : "No",
+				pri->lock_stats.events,
+				pri->lock_stats.holds,
+				pri->lock_stats.hold_max,
+				pri->lock_stats.wait_max,
 				action_id
 				);
 		}
@@ -9445,6 +9520,14 @@ void sig_pri_cli_show_span(int fd, int *dchannels, struct sig_pri_span *pri)
 #endif
 			ast_mutex_unlock(&pri->lock);
 			ast_cli(fd, "Overlap Recv: %s\n\n", (pri->overlapdial & DAHDI_OVERLAPDIAL_INCOMING)?"Yes":"No");
+			ast_mutex_lock(&pri->lock);
+			ast_cli(fd, "Events Processed: %u\n", pri->lock_stats.events);
+			ast_cli(fd, "Lock Holds: %u\n", pri->lock_stats.holds);
+			ast_cli(fd, "Lock Hold Average: %" PRId64 " us\n",
+				pri->lock_stats.holds ? pri->lock_stats.hold_sum / pri->lock_stats.holds : 0);
+			ast_cli(fd, "Lock Hold Max: %" PRId64 " us\n", pri->lock_stats.hold_max);
+			ast_cli(fd, "Lock Wait Max: %" PRId64 " us\n", pri->lock_stats.wait_max);
+			ast_mutex_unlock(&pri->lock);
 			ast_cli(fd, "\n");
 		}
 	}
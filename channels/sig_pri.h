@@ -616,6 +616,22 @@ struct sig_pri_span {
 	struct sig_pri_chan *pvts[SIG_PRI_MAX_CHANNELS];/*!< Member channel pvt structs */
 	pthread_t master;							/*!< Thread of master */
 	ast_mutex_t lock;							/*!< libpri access Mutex */
+	/*!
+	 * \brief How the D-channel thread held the span lock to process events.
+	 * \note Protected by lock.  Times are in microseconds.
+	 */
+	struct {
+		/*! D-channel events processed */
+		unsigned int events;
+		/*! Times the lock was held to process events */
+		unsigned int holds;
+		/*! Longest wait for the lock before processing events */
+		int64_t wait_max;
+		/*! Total time the lock was held to process events */
+		int64_t hold_sum;
+		/*! Longest time the lock was held to process events */
+		int64_t hold_max;
+	} lock_stats;
 	time_t lastreset;							/*!< time when unused channels were last reset */
 	/*!
 	 * \brief Congestion device state of the span.
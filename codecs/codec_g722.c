@@ -60,6 +60,8 @@ struct g722_encoder_pvt {
 
 struct g722_decoder_pvt {
 	g722_decode_state_t g722;
+	/*! Conceals the frames lost, from the audio decoded before them */
+	plc_state_t plc;
 };
 
 /*! \brief init a new instance of g722_encoder_pvt. */
@@ -109,8 +111,15 @@ static int g722tolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	/* g722_decode expects the samples to be in the invalid samples / 2 format */
 	in_samples = f->samples / 2;
 
-	out_samples = g722_decode(&tmp->g722, &pvt->outbuf.i16[pvt->samples * sizeof(int16_t)],
-		(uint8_t *) f->data.ptr, in_samples);
+	if (!f->datalen) {
+		/* A frame lost, which the jitterbuffer asks us to conceal */
+		out_samples = in_samples * (pvt->t->dst_codec.sample_rate / 8000);
+		plc_fillin(&tmp->plc, &pvt->outbuf.i16[pvt->samples * sizeof(int16_t)], out_samples);
+	} else {
+		out_samples = g722_decode(&tmp->g722, &pvt->outbuf.i16[pvt->samples * sizeof(int16_t)],
+			(uint8_t *) f->data.ptr, in_samples);
+		plc_rx(&tmp->plc, &pvt->outbuf.i16[pvt->samples * sizeof(int16_t)], out_samples);
+	}
 
 	pvt->samples += out_samples;
 
@@ -151,6 +160,7 @@ static struct ast_translator g722tolin = {
 	.framein = g722tolin_framein,
 	.sample = g722_sample,
 	.desc_size = sizeof(struct g722_decoder_pvt),
+	.native_plc = 1,
 	.buffer_samples = BUFFER_SAMPLES / sizeof(int16_t),
 	.buf_size = BUFFER_SAMPLES,
 };
@@ -193,6 +203,7 @@ static struct ast_translator g722tolin16 = {
 	.framein = g722tolin_framein,
 	.sample = g722_sample,
 	.desc_size = sizeof(struct g722_decoder_pvt),
+	.native_plc = 1,
 	.buffer_samples = BUFFER_SAMPLES / sizeof(int16_t),
 	.buf_size = BUFFER_SAMPLES,
 };
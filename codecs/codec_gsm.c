@@ -59,6 +59,7 @@
 struct gsm_translator_pvt {	/* both gsm2lin and lin2gsm */
 	gsm gsm;
 	int16_t buf[BUFFER_SAMPLES];	/* lin2gsm, temporary storage */
+	int start;			/* lin2gsm, first sample of buf not yet encoded */
 };
 
 static int gsm_new(struct ast_trans_pvt *pvt)
@@ -129,7 +130,12 @@ static int lintogsm_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 		ast_log(LOG_WARNING, "Out of buffer space\n");
 		return -1;
 	}
-	memcpy(tmp->buf + pvt->samples, f->data.ptr, f->datalen);
+	if (tmp->start + pvt->samples + f->samples > BUFFER_SAMPLES) {
+		/* Only now move what is left of the stream to the front */
+		memmove(tmp->buf, tmp->buf + tmp->start, pvt->samples * 2);
+		tmp->start = 0;
+	}
+	memcpy(tmp->buf + tmp->start + pvt->samples, f->data.ptr, f->datalen);
 	pvt->samples += f->samples;
 	return 0;
 }
@@ -146,7 +152,7 @@ static struct ast_frame *lintogsm_frameout(struct ast_trans_pvt *pvt)
 		struct ast_frame *current;
 
 		/* Encode a frame of data */
-		gsm_encode(tmp->gsm, tmp->buf + samples, (gsm_byte *) pvt->outbuf.c);
+		gsm_encode(tmp->gsm, tmp->buf + tmp->start + samples, (gsm_byte *) pvt->outbuf.c);
 		samples += GSM_SAMPLES;
 		pvt->samples -= GSM_SAMPLES;
 
@@ -161,10 +167,8 @@ static struct ast_frame *lintogsm_frameout(struct ast_trans_pvt *pvt)
 		last = current;
 	}
 
-	/* Move the data at the end of the buffer to the front */
-	if (samples) {
-		memmove(tmp->buf, tmp->buf + samples, pvt->samples * 2);
-	}
+	/* Encode in place; what is left is moved only when the buffer fills */
+	tmp->start = pvt->samples ? tmp->start + samples : 0;
 
 	return result;
 }
@@ -67,6 +67,8 @@ struct ilbc_coder_pvt {
 	iLBC_Dec_Inst_t dec;
 	/* Enough to store a full second */
 	int16_t buf[BUFFER_SAMPLES];
+	/* First sample of buf not yet encoded */
+	int start;
 	int16_t inited;
 };
 
@@ -154,7 +156,12 @@ static int lintoilbc_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	/* XXX We should look at how old the rest of our stream is, and if it
 	   is too old, then we should overwrite it entirely, otherwise we can
 	   get artifacts of earlier talk that do not belong */
-	memcpy(tmp->buf + pvt->samples, f->data.ptr, f->datalen);
+	if (tmp->start + pvt->samples + f->samples > BUFFER_SAMPLES) {
+		/* Only now move what is left of the stream to the front */
+		memmove(tmp->buf, tmp->buf + tmp->start, pvt->samples * 2);
+		tmp->start = 0;
+	}
+	memcpy(tmp->buf + tmp->start + pvt->samples, f->data.ptr, f->datalen);
 	pvt->samples += f->samples;
 	return 0;
 }
@@ -176,11 +183,12 @@ static struct ast_frame *lintoilbc_frameout(struct ast_trans_pvt *pvt)
 	while (pvt->samples >= samples_per_frame) {
 		struct ast_frame *current;
 		ilbc_block tmpf[samples_per_frame];
+		const int16_t *in = tmp->buf + tmp->start + samples;
 		int i;
 
 		/* Encode a frame of data */
 		for (i = 0; i < samples_per_frame; i++)
-			tmpf[i] = tmp->buf[samples + i];
+			tmpf[i] = in[i];
 		iLBC_encode((ilbc_bytes *) pvt->outbuf.BUF_TYPE, tmpf, &tmp->enc);
 
 		samples += samples_per_frame;
@@ -197,10 +205,8 @@ static struct ast_frame *lintoilbc_frameout(struct ast_trans_pvt *pvt)
 		last = current;
 	}
 
-	/* Move the data at the end of the buffer to the front */
-	if (samples) {
-		memmove(tmp->buf, tmp->buf + samples, pvt->samples * 2);
-	}
+	/* Encode in place; what is left is moved only when the buffer fills */
+	tmp->start = pvt->samples ? tmp->start + samples : 0;
 
 	return result;
 }
@@ -33,13 +33,35 @@
 #include "speex/speex_resampler.h"
 
 #include "asterisk/module.h"
+#include "asterisk/config.h"
+#include "asterisk/lock.h"
 #include "asterisk/translate.h"
 #include "asterisk/slin.h"
 
 #define OUTBUF_SAMPLES   11520
 
+/*! Default quality of the resamplers, 0 to 10 */
+#define DEFAULT_QUALITY 5
+
+/*! Resamplers kept for reuse for each pair of rates */
+#define STATE_CACHE_SIZE 8
+
+/*!
+ * \brief The resamplers no longer used by a translator, kept for reuse
+ *
+ * Initializing a resampler computes its filter, so a translator path
+ * built for a call takes a resampler of another one that was freed.
+ */
+struct resamp_cache {
+	ast_mutex_t lock;
+	int count;
+	SpeexResamplerState *states[STATE_CACHE_SIZE];
+};
+
 static struct ast_translator *translators;
+static struct resamp_cache *caches;
 static int trans_size;
+static int quality = DEFAULT_QUALITY;
 static struct ast_codec codec_list[] = {
 	{
 		.name = "slin",
@@ -90,11 +112,30 @@ static struct ast_codec codec_list[] = {
 
 static int resamp_new(struct ast_trans_pvt *pvt)
 {
+	struct resamp_cache *cache = &caches[pvt->t - translators];
+	SpeexResamplerState *resamp_pvt = NULL;
+	int state_quality;
 	int err;
 
-	if (!(pvt->pvt = speex_resampler_init(1, pvt->t->src_codec.sample_rate, pvt->t->dst_codec.sample_rate, 5, &err))) {
+	ast_mutex_lock(&cache->lock);
+	if (cache->count) {
+		resamp_pvt = cache->states[--cache->count];
+	}
+	ast_mutex_unlock(&cache->lock);
+
+	if (resamp_pvt) {
+		/* Reuse it unless the quality changed since it was made */
+		speex_resampler_get_quality(resamp_pvt, &state_quality);
+		if (state_quality != quality) {
+			speex_resampler_destroy(resamp_pvt);
+			resamp_pvt = NULL;
+		}
+	}
+
+	if (!resamp_pvt && !(resamp_pvt = speex_resampler_init(1, pvt->t->src_codec.sample_rate, pvt->t->dst_codec.sample_rate, quality, &err))) {
 		return -1;
 	}
+	pvt->pvt = resamp_pvt;
 
 	ast_assert(pvt->f.subclass.format == NULL);
 	pvt->f.subclass.format = ao2_bump(ast_format_cache_get_slin_by_rate(pvt->t->dst_codec.sample_rate));
@@ -104,9 +145,48 @@ static int resamp_new(struct ast_trans_pvt *pvt)
 
 static void resamp_destroy(struct ast_trans_pvt *pvt)
 {
+	struct resamp_cache *cache = &caches[pvt->t - translators];
 	SpeexResamplerState *resamp_pvt = pvt->pvt;
 
-	speex_resampler_destroy(resamp_pvt);
+	speex_resampler_reset_mem(resamp_pvt);
+
+	ast_mutex_lock(&cache->lock);
+	if (cache->count < STATE_CACHE_SIZE) {
+		cache->states[cache->count++] = resamp_pvt;
+		resamp_pvt = NULL;
+	}
+	ast_mutex_unlock(&cache->lock);
+
+	if (resamp_pvt) {
+		speex_resampler_destroy(resamp_pvt);
+	}
+}
+
+static int parse_config(int reload)
+{
+	struct ast_flags config_flags = { reload ? CONFIG_FLAG_FILEUNCHANGED : 0 };
+	struct ast_config *cfg = ast_config_load("codecs.conf", config_flags);
+	struct ast_variable *var;
+	int res;
+
+	if (cfg == CONFIG_STATUS_FILEMISSING || cfg == CONFIG_STATUS_FILEUNCHANGED || cfg == CONFIG_STATUS_FILEINVALID) {
+		return 0;
+	}
+
+	quality = DEFAULT_QUALITY;
+	for (var = ast_variable_browse(cfg, "resample"); var; var = var->next) {
+		if (!strcasecmp(var->name, "quality")) {
+			if (sscanf(var->value, "%30d", &res) == 1 && res > -1 && res < 11) {
+				ast_verb(3, "CODEC RESAMPLE: Setting Quality to %d\n", res);
+				quality = res;
+			} else {
+				ast_log(LOG_ERROR, "Error! Quality must be 0-10\n");
+			}
+		}
+	}
+	ast_config_destroy(cfg);
+
+	return 0;
 }
 
 static int resamp_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
@@ -143,9 +223,28 @@ static int unload_module(void)
 	}
 	ast_free(translators);
 
+	if (caches) {
+		for (idx = 0; idx < trans_size; idx++) {
+			while (caches[idx].count) {
+				speex_resampler_destroy(caches[idx].states[--caches[idx].count]);
+			}
+			ast_mutex_destroy(&caches[idx].lock);
+		}
+		ast_free(caches);
+		caches = NULL;
+	}
+
 	return res;
 }
 
+static int reload(void)
+{
+	if (parse_config(1)) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
 static int load_module(void)
 {
 	int res = 0;
@@ -155,6 +254,16 @@ static int load_module(void)
 	if (!(translators = ast_calloc(1, sizeof(struct ast_translator) * trans_size))) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
+	if (!(caches = ast_calloc(trans_size, sizeof(*caches)))) {
+		ast_free(translators);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	for (idx = 0; idx < trans_size; idx++) {
+		ast_mutex_init(&caches[idx].lock);
+	}
+	idx = 0;
+
+	parse_config(0);
 
 	for (x = 0; x < ARRAY_LEN(codec_list); x++) {
 		for (y = 0; y < ARRAY_LEN(codec_list); y++) {
@@ -186,4 +295,9 @@ static int load_module(void)
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
-AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "SLIN Resampling Codec");
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "SLIN Resampling Codec",
+	.support_level = AST_MODULE_SUPPORT_CORE,
+	.load = load_module,
+	.unload = unload_module,
+	.reload = reload,
+);
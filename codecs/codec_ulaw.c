@@ -52,8 +52,7 @@ static int ulawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->datalen += i * 2;	/* 2 bytes/sample */
 
 	/* convert and copy in outbuf */
-	while (i--)
-		*dst++ = AST_MULAW(*src++);
+	ast_ulaw_decode(dst, src, i);
 
 	return 0;
 }
@@ -62,14 +61,13 @@ static int ulawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 static int lintoulaw_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
 	int i = f->samples;
-	char *dst = pvt->outbuf.c + pvt->samples;
+	unsigned char *dst = pvt->outbuf.uc + pvt->samples;
 	int16_t *src = f->data.ptr;
 
 	pvt->samples += i;
 	pvt->datalen += i;	/* 1 byte/sample */
 
-	while (i--)
-		*dst++ = AST_LIN2MU(*src++);
+	ast_ulaw_encode(dst, src, i);
 
 	return 0;
 }
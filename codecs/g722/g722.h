@@ -141,6 +141,14 @@ g722_decode_state_t *g722_decode_init(g722_decode_state_t *s, int rate, int opti
 int g722_decode_release(g722_decode_state_t *s);
 int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[], int len);
 
+/*! Most sample pairs the QMF filter banks are applied to at once */
+#define G722_QMF_BLOCK 160
+
+/*! Apply the transmit QMF to pairs of samples, giving the low and high band of each */
+void g722_tx_qmf(int x[24], const int16_t amp[], int pairs, int xlow[], int xhigh[]);
+/*! Apply the receive QMF to the sums and differences of pairs of low and high band samples */
+void g722_rx_qmf(int x[24], const int in[], int pairs, int16_t amp[]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -235,28 +235,25 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
            1688,   1360,   1040,    728,
             432,    136,   -432,   -136
     };
-    static const int qmf_coeffs[12] =
-    {
-           3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-    };
 
     int dlowt;
     int rlow;
     int ihigh;
     int dhigh;
     int rhigh;
-    int xout1;
-    int xout2;
+    /* Sums and differences of the low and high band of a block of pairs, for the QMF */
+    int qmf_in[2*G722_QMF_BLOCK];
+    int qmf_len;
     int wd1;
     int wd2;
     int wd3;
     int code;
     int outlen;
-    int i;
     int j;
 
     outlen = 0;
     rhigh = 0;
+    qmf_len = 0;
     for (j = 0;  j < len;  )
     {
         if (s->packed)
@@ -374,24 +371,23 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
             }
             else
             {
-                /* Apply the receive QMF */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                s->x[22] = rlow + rhigh;
-                s->x[23] = rlow - rhigh;
-
-                xout1 = 0;
-                xout2 = 0;
-                for (i = 0;  i < 12;  i++)
+                /* Apply the receive QMF, a block of pairs at a time */
+                qmf_in[2*qmf_len] = rlow + rhigh;
+                qmf_in[2*qmf_len + 1] = rlow - rhigh;
+                if (++qmf_len == G722_QMF_BLOCK)
                 {
-                    xout2 += s->x[2*i]*qmf_coeffs[i];
-                    xout1 += s->x[2*i + 1]*qmf_coeffs[11 - i];
+                    g722_rx_qmf(s->x, qmf_in, qmf_len, amp + outlen);
+                    outlen += 2*qmf_len;
+                    qmf_len = 0;
                 }
-                amp[outlen++] = (int16_t) (xout1 >> 11);
-                amp[outlen++] = (int16_t) (xout2 >> 11);
             }
         }
     }
+    if (qmf_len)
+    {
+        g722_rx_qmf(s->x, qmf_in, qmf_len, amp + outlen);
+        outlen += 2*qmf_len;
+    }
     return outlen;
 }
 /*- End of function --------------------------------------------------------*/
@@ -232,10 +232,6 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
     {
         -7408,  -1616,   7408,   1616
     };
-    static const int qmf_coeffs[12] =
-    {
-           3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-    };
     static const int ihn[3] = {0, 1, 0};
     static const int ihp[3] = {0, 3, 2};
     static const int wh[3] = {0, -214, 798};
@@ -259,15 +255,19 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
     int xlow;
     int xhigh;
     int g722_bytes;
-    /* Even and odd tap accumulators */
-    int sumeven;
-    int sumodd;
     int ihigh;
     int ilow;
     int code;
+    /* Low and high band PCM of a block of pairs, from the QMF */
+    int qmf_low[G722_QMF_BLOCK];
+    int qmf_high[G722_QMF_BLOCK];
+    int qmf_pos;
+    int qmf_len;
 
     g722_bytes = 0;
     xhigh = 0;
+    qmf_pos = 0;
+    qmf_len = 0;
     for (j = 0;  j < len;  )
     {
         if (s->itu_test_mode)
@@ -283,23 +283,20 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
             }
             else
             {
-                /* Apply the transmit QMF */
-                /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
-
-                /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
+                /* Apply the transmit QMF, a block of pairs at a time */
+                if (qmf_pos == qmf_len)
                 {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
+                    qmf_len = (len - j)/2;
+                    if (qmf_len == 0)
+                        break;
+                    if (qmf_len > G722_QMF_BLOCK)
+                        qmf_len = G722_QMF_BLOCK;
+                    g722_tx_qmf(s->x, amp + j, qmf_len, qmf_low, qmf_high);
+                    qmf_pos = 0;
                 }
-                xlow = (sumeven + sumodd) >> 14;
-                xhigh = (sumeven - sumodd) >> 14;
+                xlow = qmf_low[qmf_pos];
+                xhigh = qmf_high[qmf_pos++];
+                j += 2;
             }
         }
         /* Block 1L, SUBTRA */
@@ -0,0 +1,162 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief The G.722 QMF filter banks, filtering blocks of samples at a time
+ *
+ * The 24 tap QMF of G.722 is applied to a block of sample pairs at once,
+ * rather than shuffling the signal history down for every pair. The taps
+ * are split into those on even and odd samples, so that the outputs of
+ * consecutive pairs are computed together in the lanes of a vector.
+ */
+
+#include <inttypes.h>
+#include <memory.h>
+
+#include "g722.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define G722_QMF_X86
+#include <immintrin.h>
+#endif
+
+static const int qmf_coeffs[12] =
+{
+       3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
+};
+
+/*! Sums of the taps on the even and on the odd samples, for a block of pairs */
+static void qmf_sums_scalar(const int even[], const int odd[], int pairs, int sumodd[], int sumeven[])
+{
+    int i;
+    int k;
+
+    for (k = 0;  k < pairs;  k++)
+    {
+        sumodd[k] = 0;
+        sumeven[k] = 0;
+        for (i = 0;  i < 12;  i++)
+        {
+            sumodd[k] += even[k + i]*qmf_coeffs[i];
+            sumeven[k] += odd[k + i]*qmf_coeffs[11 - i];
+        }
+    }
+}
+/*- End of function --------------------------------------------------------*/
+
+#ifdef G722_QMF_X86
+__attribute__((target("avx2")))
+static void qmf_sums_avx2(const int even[], const int odd[], int pairs, int sumodd[], int sumeven[])
+{
+    int i;
+    int k;
+
+    for (k = 0;  k + 8 <= pairs;  k += 8)
+    {
+        __m256i vodd = _mm256_setzero_si256();
+        __m256i veven = _mm256_setzero_si256();
+
+        for (i = 0;  i < 12;  i++)
+        {
+            vodd = _mm256_add_epi32(vodd, _mm256_mullo_epi32(
+                _mm256_loadu_si256((const __m256i *) (even + k + i)), _mm256_set1_epi32(qmf_coeffs[i])));
+            veven = _mm256_add_epi32(veven, _mm256_mullo_epi32(
+                _mm256_loadu_si256((const __m256i *) (odd + k + i)), _mm256_set1_epi32(qmf_coeffs[11 - i])));
+        }
+        _mm256_storeu_si256((__m256i *) (sumodd + k), vodd);
+        _mm256_storeu_si256((__m256i *) (sumeven + k), veven);
+    }
+    qmf_sums_scalar(even + k, odd + k, pairs - k, sumodd + k, sumeven + k);
+}
+/*- End of function --------------------------------------------------------*/
+#endif
+
+/*!
+ * Sum the taps on the even and odd samples of a block of new samples,
+ * which follow the history in even[11] and odd[11] onwards. The history
+ * is left holding the last 24 samples.
+ */
+static void qmf_sums(int x[24], int even[], int odd[], int pairs, int sumodd[], int sumeven[])
+{
+    int i;
+
+    for (i = 0;  i < 11;  i++)
+    {
+        even[i] = x[2*i + 2];
+        odd[i] = x[2*i + 3];
+    }
+
+#ifdef G722_QMF_X86
+    if (__builtin_cpu_supports("avx2"))
+        qmf_sums_avx2(even, odd, pairs, sumodd, sumeven);
+    else
+#endif
+        qmf_sums_scalar(even, odd, pairs, sumodd, sumeven);
+
+    for (i = 0;  i < 12;  i++)
+    {
+        x[2*i] = even[pairs - 1 + i];
+        x[2*i + 1] = odd[pairs - 1 + i];
+    }
+}
+/*- End of function --------------------------------------------------------*/
+
+void g722_tx_qmf(int x[24], const int16_t amp[], int pairs, int xlow[], int xhigh[])
+{
+    int even[11 + G722_QMF_BLOCK];
+    int odd[11 + G722_QMF_BLOCK];
+    int sumodd[G722_QMF_BLOCK];
+    int sumeven[G722_QMF_BLOCK];
+    int i;
+
+    for (i = 0;  i < pairs;  i++)
+    {
+        even[11 + i] = amp[2*i];
+        odd[11 + i] = amp[2*i + 1];
+    }
+    qmf_sums(x, even, odd, pairs, sumodd, sumeven);
+    /* Discard every other QMF output */
+    for (i = 0;  i < pairs;  i++)
+    {
+        xlow[i] = (sumeven[i] + sumodd[i]) >> 14;
+        xhigh[i] = (sumeven[i] - sumodd[i]) >> 14;
+    }
+}
+/*- End of function --------------------------------------------------------*/
+
+void g722_rx_qmf(int x[24], const int in[], int pairs, int16_t amp[])
+{
+    int even[11 + G722_QMF_BLOCK];
+    int odd[11 + G722_QMF_BLOCK];
+    int sumodd[G722_QMF_BLOCK];
+    int sumeven[G722_QMF_BLOCK];
+    int i;
+
+    for (i = 0;  i < pairs;  i++)
+    {
+        even[11 + i] = in[2*i];
+        odd[11 + i] = in[2*i + 1];
+    }
+    qmf_sums(x, even, odd, pairs, sumodd, sumeven);
+    for (i = 0;  i < pairs;  i++)
+    {
+        amp[2*i] = (int16_t) (sumeven[i] >> 11);
+        amp[2*i + 1] = (int16_t) (sumodd[i] >> 11);
+    }
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
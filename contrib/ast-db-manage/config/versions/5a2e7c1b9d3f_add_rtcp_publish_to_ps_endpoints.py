@@ -0,0 +1,34 @@
+"""add rtcp_publish to ps_endpoints
+
+Revision ID: 5a2e7c1b9d3f
+Revises: fbb7766f17bc
+Create Date: 2020-06-02 10:14:37.482913
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '5a2e7c1b9d3f'
+down_revision = 'fbb7766f17bc'
+
+from alembic import op
+import sqlalchemy as sa
+from sqlalchemy.dialects.postgresql import ENUM
+
+YESNO_NAME = 'yesno_values'
+YESNO_VALUES = ['yes', 'no']
+
+def upgrade():
+    ############################# Enums ##############################
+
+    # yesno_values have already been created, so use postgres enum object
+    # type to get around "already created" issue - works okay with mysql
+    yesno_values = ENUM(*YESNO_VALUES, name=YESNO_NAME, create_type=False)
+
+    op.add_column('ps_endpoints', sa.Column('rtcp_publish', yesno_values))
+
+def downgrade():
+    context = op.get_context()
+
+    if context.bind.dialect.name == 'mssql':
+        op.drop_constraint('ck_ps_endpoints_rtcp_publish_yesno_values', 'ps_endpoints')
+    op.drop_column('ps_endpoints', 'rtcp_publish')
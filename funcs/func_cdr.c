@@ -489,15 +489,10 @@ static int cdr_read(struct ast_channel *chan, const char *cmd, char *parse,
 	 */
 	if (ast_strlen_zero(ast_channel_name(chan))) {
 		cdr_read_callback(NULL, NULL, message);
-	} else {
-		RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
-
-		if (!router) {
-			ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
-				ast_channel_name(chan));
-			return -1;
-		}
-		stasis_message_router_publish_sync(router, message);
+	} else if (ast_cdr_message_publish_sync(chan, message)) {
+		ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
+			ast_channel_name(chan));
+		return -1;
 	}
 
 	return 0;
@@ -508,7 +503,6 @@ static int cdr_write(struct ast_channel *chan, const char *cmd, char *arguments,
 {
 	struct stasis_message *message;
 	struct cdr_func_payload *payload;
-	struct stasis_message_router *router;
 	AST_DECLARE_APP_ARGS(args,
 		AST_APP_ARG(variable);
 		AST_APP_ARG(options);
@@ -587,15 +581,12 @@ static int cdr_write(struct ast_channel *chan, const char *cmd, char *arguments,
 			ast_channel_name(chan));
 		return -1;
 	}
-	router = ast_cdr_message_router();
-	if (!router) {
+	if (ast_cdr_message_publish_sync(chan, message)) {
 		ast_log(LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
 			ast_channel_name(chan));
 		ao2_ref(message, -1);
 		return -1;
 	}
-	stasis_message_router_publish_sync(router, message);
-	ao2_ref(router, -1);
 	ao2_ref(message, -1);
 
 	return 0;
@@ -606,19 +597,12 @@ static int cdr_prop_write(struct ast_channel *chan, const char *cmd, char *parse
 {
 	RAII_VAR(struct stasis_message *, message, NULL, ao2_cleanup);
 	RAII_VAR(struct cdr_func_payload *, payload, NULL, ao2_cleanup);
-	RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
 
 	if (!chan) {
 		ast_log(LOG_WARNING, "No channel was provided to %s function.\n", cmd);
 		return -1;
 	}
 
-	if (!router) {
-		ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
-			ast_channel_name(chan));
-		return -1;
-	}
-
 	if (!cdr_prop_write_message_type()) {
 		ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: message type not available\n",
 			ast_channel_name(chan));
@@ -640,7 +624,11 @@ static int cdr_prop_write(struct ast_channel *chan, const char *cmd, char *parse
 			ast_channel_name(chan));
 		return -1;
 	}
-	stasis_message_router_publish_sync(router, message);
+	if (ast_cdr_message_publish_sync(chan, message)) {
+		ast_log(AST_LOG_WARNING, "Failed to manipulate CDR for channel %s: no message router\n",
+			ast_channel_name(chan));
+		return -1;
+	}
 
 	return 0;
 }
@@ -659,14 +647,11 @@ static struct ast_custom_function cdr_prop_function = {
 
 static int unload_module(void)
 {
-	RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
 	int res = 0;
 
-	if (router) {
-		stasis_message_router_remove(router, cdr_prop_write_message_type());
-		stasis_message_router_remove(router, cdr_write_message_type());
-		stasis_message_router_remove(router, cdr_read_message_type());
-	}
+	ast_cdr_message_router_remove(cdr_prop_write_message_type());
+	ast_cdr_message_router_remove(cdr_write_message_type());
+	ast_cdr_message_router_remove(cdr_read_message_type());
 	STASIS_MESSAGE_TYPE_CLEANUP(cdr_read_message_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(cdr_write_message_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(cdr_prop_write_message_type);
@@ -678,24 +663,19 @@ static int unload_module(void)
 
 static int load_module(void)
 {
-	RAII_VAR(struct stasis_message_router *, router, ast_cdr_message_router(), ao2_cleanup);
 	int res = 0;
 
-	if (!router) {
-		return AST_MODULE_LOAD_DECLINE;
-	}
-
 	res |= STASIS_MESSAGE_TYPE_INIT(cdr_read_message_type);
 	res |= STASIS_MESSAGE_TYPE_INIT(cdr_write_message_type);
 	res |= STASIS_MESSAGE_TYPE_INIT(cdr_prop_write_message_type);
 	res |= ast_custom_function_register(&cdr_function);
 	res |= ast_custom_function_register(&cdr_prop_function);
-	res |= stasis_message_router_add(router, cdr_prop_write_message_type(),
-	                                 cdr_prop_write_callback, NULL);
-	res |= stasis_message_router_add(router, cdr_write_message_type(),
-	                                 cdr_write_callback, NULL);
-	res |= stasis_message_router_add(router, cdr_read_message_type(),
-	                                 cdr_read_callback, NULL);
+	res |= ast_cdr_message_router_add(cdr_prop_write_message_type(),
+	                                  cdr_prop_write_callback, NULL);
+	res |= ast_cdr_message_router_add(cdr_write_message_type(),
+	                                  cdr_write_callback, NULL);
+	res |= ast_cdr_message_router_add(cdr_read_message_type(),
+	                                  cdr_read_callback, NULL);
 
 	if (res) {
 		unload_module();
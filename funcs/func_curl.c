@@ -49,6 +49,7 @@
 #include "asterisk/utils.h"
 #include "asterisk/threadstorage.h"
 #include "asterisk/test.h"
+#include "asterisk/res_curl.h"
 
 /*** DOCUMENTATION
 	<function name="CURL" language="en_US">
@@ -172,6 +173,18 @@
 						<para>Whether to verify the server certificate against
 						a list of known root certificate authorities (boolean).</para>
 					</enum>
+					<enum name="hostlimit">
+						<para>Maximum number of transfers made at once to the
+						host of the URL, counting those of every channel. Further
+						requests wait for one of them to finish. The default is 0,
+						which does not limit the transfers.</para>
+					</enum>
+					<enum name="hostlimitwait">
+						<para>Number of seconds a request may wait when
+						<literal>hostlimit</literal> transfers are already made to
+						the host. The request fails once this time has passed. The
+						default is 0, which fails the request without waiting.</para>
+					</enum>
 					<enum name="hashcompat">
 						<para>Assuming the responses will be in <literal>key1=value1&amp;key2=value2</literal>
 						format, reformat the response such that it can be used
@@ -204,6 +217,8 @@
 	((LIBCURL_VERSION_MAJOR > (a)) || ((LIBCURL_VERSION_MAJOR == (a)) && (LIBCURL_VERSION_MINOR > (b))) || ((LIBCURL_VERSION_MAJOR == (a)) && (LIBCURL_VERSION_MINOR == (b)) && (LIBCURL_VERSION_PATCH >= (c))))
 
 #define CURLOPT_SPECIAL_HASHCOMPAT ((CURLoption) -500)
+#define CURLOPT_SPECIAL_HOSTLIMIT ((CURLoption) -501)
+#define CURLOPT_SPECIAL_HOSTLIMITWAIT ((CURLoption) -502)
 
 static void curlds_free(void *data);
 
@@ -317,6 +332,12 @@ static int parse_curlopt_key(const char *name, CURLoption *key, enum optiontype
 	} else if (!strcasecmp(name, "hashcompat")) {
 		*key = CURLOPT_SPECIAL_HASHCOMPAT;
 		*ot = OT_ENUM;
+	} else if (!strcasecmp(name, "hostlimit")) {
+		*key = CURLOPT_SPECIAL_HOSTLIMIT;
+		*ot = OT_INTEGER;
+	} else if (!strcasecmp(name, "hostlimitwait")) {
+		*key = CURLOPT_SPECIAL_HOSTLIMITWAIT;
+		*ot = OT_INTEGER_MS;
 	} else {
 		return -1;
 	}
@@ -605,6 +626,9 @@ static int curl_instance_init(void *data)
 	curl_easy_setopt(*curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
 	curl_easy_setopt(*curl, CURLOPT_USERAGENT, global_useragent);
 
+	/* Reuse the connections opened by the handles of other threads */
+	ast_curl_share(*curl);
+
 	return 0;
 }
 
@@ -660,6 +684,8 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 	struct curl_slist *headers = NULL;
 	struct ast_datastore *store = NULL;
 	int hashcompat = 0;
+	long hostlimit = 0;
+	long hostlimitwait = 0;
 	AST_LIST_HEAD(global_curl_info, curl_settings) *list = NULL;
 	char curl_errbuf[CURL_ERROR_SIZE + 1]; /* add one to be safe */
 
@@ -685,6 +711,10 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 	AST_LIST_TRAVERSE(&global_curl_info, cur, list) {
 		if (cur->key == CURLOPT_SPECIAL_HASHCOMPAT) {
 			hashcompat = (long) cur->value;
+		} else if (cur->key == CURLOPT_SPECIAL_HOSTLIMIT) {
+			hostlimit = (long) cur->value;
+		} else if (cur->key == CURLOPT_SPECIAL_HOSTLIMITWAIT) {
+			hostlimitwait = (long) cur->value;
 		} else if (cur->key == CURLOPT_HTTPHEADER) {
 			headers = curl_slist_append(headers, (char*) cur->value);
 		} else {
@@ -703,6 +733,10 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 			AST_LIST_TRAVERSE(list, cur, list) {
 				if (cur->key == CURLOPT_SPECIAL_HASHCOMPAT) {
 					hashcompat = (long) cur->value;
+				} else if (cur->key == CURLOPT_SPECIAL_HOSTLIMIT) {
+					hostlimit = (long) cur->value;
+				} else if (cur->key == CURLOPT_SPECIAL_HOSTLIMITWAIT) {
+					hostlimitwait = (long) cur->value;
 				} else if (cur->key == CURLOPT_HTTPHEADER) {
 					headers = curl_slist_append(headers, (char*) cur->value);
 				} else {
@@ -728,8 +762,16 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 	curl_errbuf[0] = curl_errbuf[CURL_ERROR_SIZE] = '\0';
 	curl_easy_setopt(*curl, CURLOPT_ERRORBUFFER, curl_errbuf);
 
-	if (curl_easy_perform(*curl) != 0) {
-		ast_log(LOG_WARNING, "%s ('%s')\n", curl_errbuf, args->url);
+	if (hostlimit > 0 && ast_curl_host_acquire(args->url, hostlimit, hostlimitwait)) {
+		ast_log(LOG_WARNING, "%ld transfers are already made to the host of '%s', giving up\n",
+			hostlimit, args->url);
+	} else {
+		if (curl_easy_perform(*curl) != 0) {
+			ast_log(LOG_WARNING, "%s ('%s')\n", curl_errbuf, args->url);
+		}
+		if (hostlimit > 0) {
+			ast_curl_host_release(args->url);
+		}
 	}
 
 	/* Reset buffer to NULL so curl doesn't try to write to it when the
@@ -54,6 +54,10 @@
 					<option name="adaptive">
 						<para>Set an adaptive jitterbuffer on the channel.</para>
 					</option>
+					<option name="ring">
+						<para>Set an adaptive jitterbuffer on the channel that keeps
+						the frames in a ring indexed by their RTP sequence number.</para>
+					</option>
 					<option name="disabled">
 						<para>Remove a previously set jitterbuffer from the channel.</para>
 					</option>
@@ -74,7 +78,7 @@
 			<para><replaceable>resync_threshold</replaceable>: The length in milliseconds over
 			which a timestamp difference will result in resyncing the jitterbuffer.
 			Defaults to 1000ms.</para>
-			<para>target_extra: This option only affects the adaptive jitterbuffer. It represents
+			<para>target_extra: This option only affects the adaptive and ring jitterbuffers. It represents
 			the amount time in milliseconds by which the new jitter buffer will pad its size.
 			Defaults to 40ms.</para>
 			<para>sync_video: This option enables video synchronization with the audio stream. It can be
@@ -100,6 +104,9 @@
 			<example title="Adaptive with 200ms max size and video sync support" language="text">
 			exten => 1,1,Set(JITTERBUFFER(adaptive)=200,,,yes)
 			</example>
+			<example title="Ring with 200ms max size, 60ms target extra" language="text">
+			exten => 1,1,Set(JITTERBUFFER(ring)=200,,60)
+			</example>
 			<example title="Set a fixed jitterbuffer with defaults; then remove it" language="text">
 			exten => 1,1,Set(JITTERBUFFER(fixed)=default)
 			exten => 1,n,Set(JITTERBUFFER(disabled)=)
@@ -128,6 +135,7 @@ static int jb_helper(struct ast_channel *chan, const char *cmd, char *data, cons
 	if (!ast_strlen_zero(data)) {
 		if (strcasecmp(data, "fixed") &&
 				strcasecmp(data, "adaptive") &&
+				strcasecmp(data, "ring") &&
 				strcasecmp(data, "disabled")) {
 			ast_log(LOG_WARNING, "Unknown Jitterbuffer type %s. Failed to create jitterbuffer.\n", data);
 			return -1;
@@ -120,6 +120,8 @@ struct acf_odbc_query {
 	char *sql_insert;
 	unsigned int flags;
 	int rowlimit;
+	/*! Seconds the database may take to execute the query, 0 for no limit */
+	int timeout;
 	struct ast_custom_function *acf;
 };
 
@@ -252,6 +254,13 @@ static struct dsn *create_dsn(const char *name)
 	return dsn;
 }
 
+/*! \brief A query handed to execute() */
+struct execute_args {
+	const char *sql;
+	/*! Seconds the database may take to execute the query, 0 for no limit */
+	int timeout;
+};
+
 static SQLHSTMT silent_execute(struct odbc_obj *obj, void *data);
 
 /*!
@@ -266,6 +275,7 @@ static int connection_dead(struct odbc_obj *connection)
 	SQLINTEGER dead;
 	SQLRETURN res;
 	SQLHSTMT stmt;
+	struct execute_args probe = { .sql = "SELECT 1", };
 
 	if (!connection) {
 		return 1;
@@ -279,7 +289,7 @@ static int connection_dead(struct odbc_obj *connection)
 	/* If the Driver doesn't support SQL_ATTR_CONNECTION_DEAD do a direct
 	 * execute of a probing statement and see if that succeeds instead
 	 */
-	stmt = ast_odbc_direct_execute(connection, silent_execute, "SELECT 1");
+	stmt = ast_odbc_direct_execute(connection, silent_execute, &probe);
 	if (!stmt) {
 		return 1;
 	}
@@ -445,7 +455,7 @@ static void odbc_datastore_free(void *data)
  * \brief Common execution function for SQL queries.
  *
  * \param obj DB connection
- * \param data The query to execute
+ * \param data The struct execute_args of the query to execute
  * \param silent If true, do not print warnings on failure
  * \retval NULL Failed to execute query
  * \retval non-NULL The executed statement
@@ -453,7 +463,8 @@ static void odbc_datastore_free(void *data)
 static SQLHSTMT execute(struct odbc_obj *obj, void *data, int silent)
 {
 	int res;
-	char *sql = data;
+	struct execute_args *args = data;
+	const char *sql = args->sql;
 	SQLHSTMT stmt;
 
 	res = SQLAllocHandle (SQL_HANDLE_STMT, obj->con, &stmt);
@@ -462,6 +473,14 @@ static SQLHSTMT execute(struct odbc_obj *obj, void *data, int silent)
 		return NULL;
 	}
 
+	if (args->timeout > 0) {
+		/* Not every driver supports this, the query simply runs unbounded then */
+		res = SQLSetStmtAttr(stmt, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER) (SQLULEN) args->timeout, 0);
+		if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
+			ast_debug(1, "Driver does not support a query timeout, executing '%s' without one\n", sql);
+		}
+	}
+
 	res = ast_odbc_execute_sql(obj, stmt, sql);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO) && (res != SQL_NO_DATA)) {
 		if (res == SQL_ERROR && !silent) {
@@ -524,6 +543,7 @@ static int acf_odbc_write(struct ast_channel *chan, const char *cmd, char *s, co
 	struct ast_str *insertbuf = ast_str_thread_get(&sql2_buf, 16);
 	const char *status = "FAILURE";
 	struct dsn *dsn = NULL;
+	struct execute_args exec_args = { 0, };
 
 	if (!buf || !insertbuf) {
 		return -1;
@@ -595,6 +615,7 @@ static int acf_odbc_write(struct ast_channel *chan, const char *cmd, char *s, co
 	pbx_builtin_pushvar_helper(chan, "VALUE", value ? value : "");
 
 	ast_str_substitute_variables(&buf, 0, chan, query->sql_write);
+	exec_args.timeout = query->timeout;
 	if (query->sql_insert) {
 		ast_str_substitute_variables(&insertbuf, 0, chan, query->sql_insert);
 	}
@@ -635,7 +656,8 @@ static int acf_odbc_write(struct ast_channel *chan, const char *cmd, char *s, co
 				transactional = 0;
 			}
 
-			if (obj && (stmt = ast_odbc_direct_execute(obj, generic_execute, ast_str_buffer(buf)))) {
+			exec_args.sql = ast_str_buffer(buf);
+			if (obj && (stmt = ast_odbc_direct_execute(obj, generic_execute, &exec_args))) {
 				break;
 			}
 			if (!transactional) {
@@ -673,7 +695,8 @@ static int acf_odbc_write(struct ast_channel *chan, const char *cmd, char *s, co
 						transactional = 0;
 					}
 					if (obj) {
-						stmt = ast_odbc_direct_execute(obj, generic_execute, ast_str_buffer(insertbuf));
+						exec_args.sql = ast_str_buffer(insertbuf);
+						stmt = ast_odbc_direct_execute(obj, generic_execute, &exec_args);
 					}
 				}
 				if (stmt) {
@@ -729,6 +752,7 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	struct ast_str *sql = ast_str_thread_get(&sql_buf, 16);
 	const char *status = "FAILURE";
 	struct dsn *dsn = NULL;
+	struct execute_args exec_args = { 0, };
 
 	if (!sql || !colnames) {
 		if (chan) {
@@ -775,6 +799,8 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	}
 
 	ast_str_substitute_variables(&sql, 0, chan, query->sql_read);
+	exec_args.sql = ast_str_buffer(sql);
+	exec_args.timeout = query->timeout;
 
 	if (bogus_chan) {
 		chan = ast_channel_unref(chan);
@@ -824,7 +850,7 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 			if (!obj) {
 				continue;
 			}
-			stmt = ast_odbc_direct_execute(obj, generic_execute, ast_str_buffer(sql));
+			stmt = ast_odbc_direct_execute(obj, generic_execute, &exec_args);
 		}
 		if (stmt) {
 			break;
@@ -1290,6 +1316,12 @@ static int init_acf_query(struct ast_config *cfg, char *catg, struct acf_odbc_qu
 			sscanf(tmp, "%30d", &((*query)->rowlimit));
 	}
 
+	if ((tmp = ast_variable_retrieve(cfg, catg, "timeout"))
+		&& (sscanf(tmp, "%30d", &((*query)->timeout)) != 1 || (*query)->timeout < 0)) {
+		ast_log(LOG_WARNING, "Invalid timeout '%s' for query '%s', queries will not time out\n", tmp, catg);
+		(*query)->timeout = 0;
+	}
+
 	(*query)->acf = ast_calloc(1, sizeof(struct ast_custom_function));
 	if (!(*query)->acf) {
 		free_acf_query(*query);
@@ -1409,6 +1441,7 @@ static char *cli_odbc_read(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 	char *char_args, varname[10];
 	struct acf_odbc_query *query;
 	struct ast_channel *chan;
+	struct execute_args exec_args = { 0, };
 	int i;
 
 	switch (cmd) {
@@ -1490,6 +1523,8 @@ static char *cli_odbc_read(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 	}
 
 	ast_str_substitute_variables(&sql, 0, chan, query->sql_read);
+	exec_args.sql = ast_str_buffer(sql);
+	exec_args.timeout = query->timeout;
 	chan = ast_channel_unref(chan);
 
 	if (a->argc == 5 && !strcmp(a->argv[4], "exec")) {
@@ -1519,7 +1554,7 @@ static char *cli_odbc_read(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 			}
 			ast_debug(1, "Found handle %s\n", query->readhandle[dsn_num]);
 
-			if (!(stmt = ast_odbc_direct_execute(obj, generic_execute, ast_str_buffer(sql)))) {
+			if (!(stmt = ast_odbc_direct_execute(obj, generic_execute, &exec_args))) {
 				release_obj_or_dsn (&obj, &dsn);
 				continue;
 			}
@@ -1625,6 +1660,7 @@ static char *cli_odbc_write(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	char *char_args, *char_values, varname[10];
 	struct acf_odbc_query *query;
 	struct ast_channel *chan;
+	struct execute_args exec_args = { 0, };
 	int i;
 
 	switch (cmd) {
@@ -1719,6 +1755,8 @@ static char *cli_odbc_write(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	/* Additionally set the value as a whole (but push an empty string if value is NULL) */
 	pbx_builtin_pushvar_helper(chan, "VALUE", S_OR(a->argv[4], ""));
 	ast_str_substitute_variables(&sql, 0, chan, query->sql_write);
+	exec_args.sql = ast_str_buffer(sql);
+	exec_args.timeout = query->timeout;
 	ast_debug(1, "SQL is %s\n", ast_str_buffer(sql));
 
 	chan = ast_channel_unref(chan);
@@ -1739,7 +1777,7 @@ static char *cli_odbc_write(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 			if (!obj) {
 				continue;
 			}
-			if (!(stmt = ast_odbc_direct_execute(obj, generic_execute, ast_str_buffer(sql)))) {
+			if (!(stmt = ast_odbc_direct_execute(obj, generic_execute, &exec_args))) {
 				release_obj_or_dsn (&obj, &dsn);
 				continue;
 			}
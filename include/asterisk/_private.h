@@ -45,6 +45,9 @@ int ast_device_state_engine_init(void);	/*!< Provided by devicestate.c */
 int astobj2_init(void);			/*!< Provided by astobj2.c */
 int ast_named_locks_init(void);		/*!< Provided by named_locks.c */
 int ast_file_init(void);		/*!< Provided by file.c */
+int ast_frame_init(void);		/*!< Provided by frame.c */
+void ast_g711_init(void);		/*!< Provided by g711.c */
+const char *ast_g711_name(void);	/*!< Provided by g711.c */
 void ast_autoservice_init(void);	/*!< Provided by autoservice.c */
 int ast_tps_init(void); 		/*!< Provided by taskprocessor.c */
 int ast_timing_init(void);		/*!< Provided by timing.c */
@@ -56,6 +59,9 @@ int ast_msg_init(void);             /*!< Provided by message.c */
 void ast_msg_shutdown(void);        /*!< Provided by message.c */
 int aco_init(void);             /*!< Provided by config_options.c */
 int dns_core_init(void);        /*!< Provided by dns_core.c */
+int ast_originate_init(void);   /*!< Provided by originate.c */
+int ast_trace_span_init(void);  /*!< Provided by trace_span.c */
+int ast_frame_timing_init(void);  /*!< Provided by frame_timing.c */
 
 /*!
  * \brief Initialize malloc debug phase 1.
@@ -48,12 +48,16 @@ enum ast_acl_sense {
  * at least in the short term it is more convenient to make the whole
  * thing public and let users play with them.
  */
+struct ast_ha_tree;
+
 struct ast_ha {
 	/* Host access rule */
 	struct ast_sockaddr addr;
 	struct ast_sockaddr netmask;
 	enum ast_acl_sense sense;
 	struct ast_ha *next;
+	/*! The rules of the list compiled by ast_apply_ha, only set on the first one */
+	struct ast_ha_tree *tree;
 };
 
 #define ACL_NAME_LENGTH 80
@@ -83,4 +83,30 @@ static inline unsigned char AST_LIN2A(short sample)
 
 #define AST_ALAW(a) (__ast_alaw[(int)(a)])
 
+/*!
+ * \brief Convert a buffer of A-law samples to signed linear
+ * \since 18.0.0
+ *
+ * \details Produces the same samples as AST_ALAW(), using vector
+ * instructions when the CPU has them.
+ *
+ * \param dst Where to store the signed linear samples.
+ * \param src The A-law samples.
+ * \param samples The number of samples to convert.
+ */
+void ast_alaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples);
+
+/*!
+ * \brief Convert a buffer of signed linear samples to A-law
+ * \since 18.0.0
+ *
+ * \details Produces the same samples as AST_LIN2A(), using vector
+ * instructions when the CPU has them.
+ *
+ * \param dst Where to store the A-law samples.
+ * \param src The signed linear samples.
+ * \param samples The number of samples to convert.
+ */
+void ast_alaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples);
+
 #endif /* _ASTERISK_ALAW_H */
@@ -48,6 +48,22 @@ enum ast_json_encoding_format ast_ari_json_format(void);
 
 struct ast_ari_response;
 
+/*!
+ * \brief Encoder writing a JSON response body a piece at a time.
+ * \since 18.0.0
+ */
+struct ast_ari_json_stream;
+
+/*!
+ * \brief Callback type writing the body of a streamed response.
+ * \param stream Encoder to write the body with.
+ * \param data Data given to \ref ast_ari_response_ok_stream.
+ * \return 0 on success.
+ * \return Non-zero on error, the response becomes a 500.
+ * \since 18.0.0
+ */
+typedef int (*ast_ari_response_stream_fn)(struct ast_ari_json_stream *stream, void *data);
+
 /*!
  * \brief Callback type for RESTful method handlers.
  * \param ser TCP/TLS session object
@@ -102,6 +118,12 @@ struct ast_ari_response {
 	const char *response_text; /* Shouldn't http.c handle this? */
 	/*! Flag to indicate that no further response is needed */
 	unsigned int no_response:1;
+	/*! Writes the body of a 200 response instead of \a message, see \ref ast_ari_response_ok_stream */
+	ast_ari_response_stream_fn stream_fn;
+	/*! Data passed to \a stream_fn */
+	void *stream_data;
+	/*! Releases \a stream_data once the response is done with, may be NULL */
+	void (*stream_data_destroy)(void *data);
 };
 
 /*!
@@ -191,6 +213,45 @@ struct ast_json *ast_ari_websocket_session_read(
 int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 	struct ast_json *message);
 
+/*!
+ * \brief Send a message to an ARI WebSocket, skipping model validation.
+ *
+ * For events an application trimmed down with its event fields, which no
+ * longer match the documented models.
+ *
+ * \param session Session to write to.
+ * \param message Message to send.
+ * \return 0 on success.
+ * \return Non-zero on error.
+ *
+ * \since 18.0.0
+ */
+int ast_ari_websocket_session_write_unvalidated(struct ast_ari_websocket_session *session,
+	struct ast_json *message);
+
+/*!
+ * \brief Hold back the messages sent to an ARI WebSocket.
+ *
+ * The messages written until \ref ast_ari_websocket_session_uncork is called
+ * are sent to the socket together.
+ *
+ * \param session Session to cork.
+ *
+ * \since 18.0.0
+ */
+void ast_ari_websocket_session_cork(struct ast_ari_websocket_session *session);
+
+/*!
+ * \brief Send the messages held back on an ARI WebSocket.
+ *
+ * \param session Session to uncork.
+ * \return 0 on success.
+ * \return Non-zero on error.
+ *
+ * \since 18.0.0
+ */
+int ast_ari_websocket_session_uncork(struct ast_ari_websocket_session *session);
+
 /*!
  * \brief Get the Session ID for an ARI WebSocket.
  *
@@ -268,4 +329,64 @@ void ast_ari_response_created(struct ast_ari_response *response,
  */
 void ast_ari_response_alloc_failed(struct ast_ari_response *response);
 
+/*!
+ * \brief Fill in an \c OK (200) \a ast_ari_response whose body is written later.
+ *
+ * Rather than building a JSON tree of the whole response, \a stream_fn is
+ * called once the handler has returned and encodes the body piece by piece.
+ * Large lists are streamed this way so only one element at a time has to be
+ * held as JSON.
+ *
+ * \param response Response to fill in.
+ * \param stream_fn Callback writing the body.
+ * \param data Data passed to \a stream_fn.
+ * \param data_destroy Releases \a data once the response is done with, may be NULL.
+ *
+ * \since 18.0.0
+ */
+void ast_ari_response_ok_stream(struct ast_ari_response *response,
+	ast_ari_response_stream_fn stream_fn, void *data, void (*data_destroy)(void *data));
+
+/*!
+ * \brief Start a JSON array in a streamed response.
+ * \param stream Encoder to write to.
+ * \return 0 on success.
+ * \return Non-zero on error.
+ * \since 18.0.0
+ */
+int ast_ari_json_stream_array_start(struct ast_ari_json_stream *stream);
+
+/*!
+ * \brief Write an element of the JSON array started in a streamed response.
+ * \param stream Encoder to write to.
+ * \param element Element to write.  This reference is stolen, and the
+ *                element is released as soon as it is written.
+ * \return 0 on success.
+ * \return Non-zero on error.
+ * \since 18.0.0
+ */
+int ast_ari_json_stream_array_append(struct ast_ari_json_stream *stream, struct ast_json *element);
+
+/*!
+ * \brief End the JSON array started in a streamed response.
+ * \param stream Encoder to write to.
+ * \return 0 on success.
+ * \return Non-zero on error.
+ * \since 18.0.0
+ */
+int ast_ari_json_stream_array_end(struct ast_ari_json_stream *stream);
+
+/*!
+ * \brief Get the writer encoding a streamed response.
+ *
+ * Values can be encoded with the writer directly instead of being appended
+ * as \ref ast_json trees, in between ast_ari_json_stream_array_start() and
+ * ast_ari_json_stream_array_end().
+ *
+ * \param stream Encoder to write to.
+ * \return The writer.
+ * \since 18.0.0
+ */
+struct ast_json_writer *ast_ari_json_stream_writer(struct ast_ari_json_stream *stream);
+
 #endif /* _ASTERISK_ARI_H */
@@ -365,7 +365,13 @@ enum ao2_alloc_opts {
 	AO2_ALLOC_OPT_LOCK_MUTEX = (0 << 0),
 	/*! The ao2 object has a non-recursive read/write lock associated with it. */
 	AO2_ALLOC_OPT_LOCK_RWLOCK = (1 << 0),
-	/*! The ao2 object has no lock associated with it. */
+	/*!
+	 * The ao2 object has no lock associated with it.
+	 *
+	 * \note Objects which are immutable once published, such as stasis
+	 * message payloads, should use this to skip allocating and
+	 * initializing a lock they never take.
+	 */
 	AO2_ALLOC_OPT_LOCK_NOLOCK = (2 << 0),
 	/*! The ao2 object locking option field mask. */
 	AO2_ALLOC_OPT_LOCK_MASK = (3 << 0),
@@ -1213,6 +1219,22 @@ enum ao2_container_opts {
 	 * ao2_sort_fn.
 	 */
 	AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE = (3 << 1),
+	/*!
+	 * \brief Optimize the container for lookups that greatly outnumber changes.
+	 * \since 18.0.0
+	 *
+	 * \details ao2_find() with OBJ_SEARCH_OBJECT or OBJ_SEARCH_KEY
+	 * searches an immutable snapshot of the container without
+	 * locking the container.  Linking or unlinking an object
+	 * discards the snapshot and a later lookup builds a new one.
+	 * Changes to the container therefore become more expensive.
+	 *
+	 * \note Only hash containers support this option.
+	 *
+	 * \note The container sort_fn and cmp_fn must not require the
+	 * container to be locked.
+	 */
+	AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY = (1 << 3),
 };
 
 /*!
@@ -66,6 +66,8 @@ enum ast_audiohook_flags {
 	AST_AUDIOHOOK_COMPATIBLE    = (1 << 7), /*!< is the audiohook native slin compatible */
 
 	AST_AUDIOHOOK_SUBSTITUTE_SILENCE = (1 << 8), /*!< Substitute silence for missing audio */
+	AST_AUDIOHOOK_SKIP_READ     = (1 << 9), /*!< Spy audiohook is not fed the frames read */
+	AST_AUDIOHOOK_SKIP_WRITE    = (1 << 10), /*!< Spy audiohook is not fed the frames written */
 };
 
 enum ast_audiohook_init_flags {
@@ -165,6 +167,22 @@ struct ast_frame *ast_audiohook_read_frame(struct ast_audiohook *audiohook, size
  */
 struct ast_frame *ast_audiohook_read_frame_all(struct ast_audiohook *audiohook, size_t samples, struct ast_format *format, struct ast_frame **read_frame, struct ast_frame **write_frame);
 
+/*!
+ * \brief Reads the audio of both directions as the two channels of one frame
+ * \since 18.0.0
+ *
+ * The samples of the read direction and the write direction alternate in
+ * the frame, without being mixed, so they can be stored as the two tracks
+ * of a stereo recording.
+ *
+ * \param audiohook Audiohook structure
+ * \param samples Number of samples wanted of each direction
+ * \param format Signed linear format of the frame, it is not translated
+ *
+ * \return Returns frame on success, NULL on failure
+ */
+struct ast_frame *ast_audiohook_read_frame_interleaved(struct ast_audiohook *audiohook, size_t samples, struct ast_format *format);
+
 /*! \brief Attach audiohook to channel
  * \param chan Channel
  * \param audiohook Audiohook structure
@@ -149,6 +149,8 @@ struct ast_bridge_video_sfu_data {
 	unsigned int remb_send_interval;
 	/*! How the combined REMB report is generated */
 	enum ast_bridge_video_sfu_remb_behavior remb_behavior;
+	/*! The bitrate per video source below which a receiver stops being sent video, 0 for none */
+	unsigned int remb_min_bitrate;
 };
 
 /*! \brief Data structure that defines a video source mode */
@@ -308,6 +310,12 @@ struct ast_bridge_softmix {
 	 * \note If this value is 0, there is no maximum sample rate.
 	 */
 	unsigned int maximum_sample_rate;
+	/*!
+	 * \brief The most talkers softmix mixes at once, the loudest ones.
+	 *
+	 * \note If this value is 0, every talker is mixed.
+	 */
+	unsigned int max_mixed_talkers;
 };
 
 AST_LIST_HEAD_NOLOCK(ast_bridge_channels_list, ast_bridge_channel);
@@ -995,6 +1003,16 @@ void ast_bridge_set_mixing_interval(struct ast_bridge *bridge, unsigned int mixi
  */
 void ast_bridge_set_binaural_active(struct ast_bridge *bridge, unsigned int binaural_active);
 
+/*!
+ * \brief Limit the number of talkers mixed at once in multimix mode.
+ * \since 18.0.0
+ *
+ * \param bridge Bridge to change the limit on.
+ * \param max_mixed_talkers Only this many of the loudest talkers are mixed.
+ * If 0 is set every talker is mixed.
+ */
+void ast_bridge_set_max_mixed_talkers(struct ast_bridge *bridge, unsigned int max_mixed_talkers);
+
 /*!
  * \brief Set a bridge to feed a single video source to all participants.
  */
@@ -1039,6 +1057,21 @@ void ast_bridge_set_remb_send_interval(struct ast_bridge *bridge, unsigned int r
  */
 void ast_brige_set_remb_behavior(struct ast_bridge *bridge, enum ast_bridge_video_sfu_remb_behavior behavior);
 
+/*!
+ * \brief Set the bitrate below which a receiver stops being sent video on a bridge
+ * \since 18.0.0
+ *
+ * \param bridge Bridge to set the minimum REMB bitrate on
+ * \param remb_min_bitrate The estimated maximum bitrate per video source, in bits
+ * per second, below which a receiver is sent no video. 0 disables this.
+ *
+ * \details A receiver that cannot keep up has its video paused rather than its
+ * REMB reports forcing every sender down, until its estimate recovers.
+ *
+ * \note This can only be called when the bridge has been set to the SFU video mode.
+ */
+void ast_bridge_set_remb_min_bitrate(struct ast_bridge *bridge, unsigned int remb_min_bitrate);
+
 /*!
  * \brief Update information about talker energy for talker src video mode.
  */
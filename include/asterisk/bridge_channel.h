@@ -395,6 +395,22 @@ void ast_bridge_channel_update_accountcodes(struct ast_bridge_channel *joining,
  */
 int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr);
 
+/*!
+ * \brief Write a frame sharing its data to the specified bridge_channel.
+ * \since 18.0.0
+ *
+ * \param bridge_channel Channel to queue the frame.
+ * \param fr Frame to write, whose data should come from ast_frame_share().
+ *
+ * \details Like ast_bridge_channel_queue_frame() but the queued frame
+ * references the data of \a fr rather than copying it, for a frame
+ * written to many channels.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int ast_bridge_channel_queue_shared_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr);
+
 /*!
  * \brief Queue a control frame onto the bridge channel with data.
  * \since 12.0.0
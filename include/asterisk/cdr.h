@@ -27,6 +27,7 @@
 #define _ASTERISK_CDR_H
 
 #include "asterisk/channel.h"
+#include "asterisk/stasis.h"
 
 /*! \file
  *
@@ -457,6 +458,18 @@ int ast_cdr_serialize_variables(const char *channel_name, struct ast_str **buf,
  */
 typedef int (*ast_cdrbe)(struct ast_cdr *cdr);
 
+/*!
+ * \brief CDR backend callback receiving a batch of records
+ * \since 18.0.0
+ *
+ * \param cdrs The records, in the order they were finalized
+ * \param count The number of records
+ *
+ * \warning The same restriction on accessing channels as for \ref ast_cdrbe
+ * applies.
+ */
+typedef int (*ast_cdrbe_batch)(struct ast_cdr **cdrs, size_t count);
+
 /*! \brief Return TRUE if CDR subsystem is enabled */
 int ast_cdr_is_enabled(void);
 
@@ -477,11 +490,56 @@ struct stasis_message_router;
  * message router is bumped and must be released by the caller of
  * this function.
  *
+ * \note Deprecated. The router only forwards the messages to the shards
+ * running the CDR state machine, so routes added to it are not serialized
+ * with it. Use \ref ast_cdr_message_router_add and
+ * \ref ast_cdr_message_publish_sync instead.
+ *
  * \retval NULL if the CDR engine is disabled or unavailable
  * \retval the \ref stasis_message_router otherwise
  */
 struct stasis_message_router *ast_cdr_message_router(void);
 
+/*!
+ * \brief Add a route to the message routers of the CDR engine
+ * \since 18.0.0
+ *
+ * The callback is invoked on the thread handling the CDRs of the channel
+ * a message is published for with \ref ast_cdr_message_publish_sync.
+ *
+ * \param message_type The type of the messages to route
+ * \param callback Callback for the messages
+ * \param data Data pointer passed to the callback
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int ast_cdr_message_router_add(struct stasis_message_type *message_type,
+	stasis_subscription_cb callback, void *data);
+
+/*!
+ * \brief Remove a route added with \ref ast_cdr_message_router_add
+ * \since 18.0.0
+ *
+ * \param message_type The type of the messages routed
+ */
+void ast_cdr_message_router_remove(struct stasis_message_type *message_type);
+
+/*!
+ * \brief Publish a message regarding the CDRs of a channel and wait for it
+ * \since 18.0.0
+ *
+ * The message is handled after the channel messages published before it
+ * made it to the CDR engine.
+ *
+ * \param chan The channel the message regards
+ * \param message The message
+ *
+ * \retval 0 once the message was handled
+ * \retval -1 if the CDR engine is disabled or unavailable
+ */
+int ast_cdr_message_publish_sync(struct ast_channel *chan, struct stasis_message *message);
+
 /*!
  * \brief Duplicate a public CDR
  * \param cdr the record to duplicate
@@ -509,6 +567,24 @@ void ast_cdr_free(struct ast_cdr *cdr);
  */
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be);
 
+/*!
+ * \brief Register a CDR handling engine that can post batches of records
+ * \since 18.0.0
+ *
+ * \param name name associated with the particular CDR handler
+ * \param desc description of the CDR handler
+ * \param be function pointer to a CDR handler, used for records posted one by one
+ * \param be_batch function pointer to a CDR handler, used for the batches of
+ *        records posted in batch mode
+ *
+ * In batch mode each backend posts its batches from a queue of its own, so a
+ * backend that is slow to store records does not hold up the others.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error
+ */
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch be_batch);
+
 /*!
  * \brief Unregister a CDR handling engine
  * \param name name of CDR handler to unregister
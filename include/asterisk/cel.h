@@ -207,6 +207,9 @@ struct ast_cel_general_config {
 		AST_STRING_FIELD(date_format); /*!< The desired date format for logging */
 	);
 	int enable;			/*!< Whether CEL is enabled */
+	int batch;			/*!< Whether events are posted to the backends in batches */
+	unsigned int batch_size;	/*!< Events queued before a batch is posted */
+	unsigned int batch_time;	/*!< Most milliseconds an event waits for its batch */
 	int64_t events;			/*!< The events to be logged */
 	/*! The apps for which to log app start and end events. This is
 	 * ast_str_container_alloc()ed and filled with ao2-allocated
@@ -303,6 +306,31 @@ typedef void (*ast_cel_backend_cb)(struct ast_event *event);
  */
 int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback);
 
+/*!
+ * \brief CEL backend callback for a batch of events
+ *
+ * \param events The events, oldest first
+ * \param count The number of events
+ */
+typedef void (*ast_cel_backend_batch_cb)(struct ast_event **events, size_t count);
+
+/*!
+ * \brief Register a CEL backend able to write a batch of events at once
+ *
+ * In batch mode the events are passed to the batch callback instead of the
+ * per event one.
+ *
+ * \param name Name of backend to register
+ * \param backend_callback Callback for single events
+ * \param batch_callback Callback for batches of events
+ *
+ * \retval zero on success
+ * \retval non-zero on failure
+ * \since 18.0.0
+ */
+int ast_cel_backend_register_batch(const char *name, ast_cel_backend_cb backend_callback,
+	ast_cel_backend_batch_cb batch_callback);
+
 /*!
  * \brief Unregister a CEL backend
  *
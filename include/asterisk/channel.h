@@ -1201,6 +1201,38 @@ int ast_channel_datastore_remove(struct ast_channel *chan, struct ast_datastore
  */
 struct ast_datastore *ast_channel_datastore_find(struct ast_channel *chan, const struct ast_datastore_info *info, const char *uid);
 
+/*!
+ * \brief Allocate memory that lives as long as a channel
+ * \since 18.0.0
+ *
+ * The memory is carved out of blocks owned by the channel, and is
+ * freed all at once when the channel is destroyed.  It cannot be freed
+ * before that, so this is only for objects that last the whole call.
+ *
+ * \param chan The channel owning the memory
+ * \param size How many bytes to allocate
+ *
+ * \pre chan is locked
+ *
+ * \return zero filled memory aligned for any pointer, or NULL on failure
+ */
+void *ast_channel_arena_alloc(struct ast_channel *chan, size_t size);
+
+/*!
+ * \brief Copy a string into memory that lives as long as a channel
+ * \since 18.0.0
+ *
+ * \param chan The channel owning the copy
+ * \param str The string to copy
+ *
+ * \pre chan is locked
+ *
+ * \return the copy, or NULL on failure
+ *
+ * \see ast_channel_arena_alloc
+ */
+char *ast_channel_arena_strdup(struct ast_channel *chan, const char *str);
+
 /*!
  * \brief Create a channel structure
  * \since 1.8
@@ -1440,6 +1472,41 @@ struct ast_channel *ast_request(const char *type, struct ast_format_cap *request
  */
 struct ast_channel *ast_request_with_stream_topology(const char *type, struct ast_stream_topology *topology, const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *addr, int *cause);
 
+/*! \brief A channel to request with ast_request_multiple() */
+struct ast_request_item {
+	/*! Type of channel to request */
+	const char *type;
+	/*! Destination of the call */
+	const char *addr;
+	/*! Unique ID to create the channel with, may be NULL */
+	const struct ast_assigned_ids *assignedids;
+	/*! The requested channel, NULL on failure */
+	struct ast_channel *chan;
+	/*! Cause of failure */
+	int cause;
+};
+
+/*!
+ * \brief Requests several channels at once
+ * \since 18.0.0
+ *
+ * \param items The channels to request
+ * \param count Number of items
+ * \param request_cap Format capabilities for the requested channels, may be NULL
+ * \param topology Stream topology for the requested channels, may be NULL
+ * \param requestor channel asking for data
+ *
+ * \details
+ * Request a channel for each item as ast_request() would, setting its chan or
+ * failure cause.  The channel technology of each type is only looked up, and
+ * the capabilities or topology it is asked for only worked out, once for all
+ * the items of that type.
+ *
+ * \return The number of channels requested
+ */
+int ast_request_multiple(struct ast_request_item *items, size_t count, struct ast_format_cap *request_cap,
+	struct ast_stream_topology *topology, const struct ast_channel *requestor);
+
 enum ast_channel_requestor_relationship {
 	/*! The requestor is the future bridge peer of the channel. */
 	AST_CHANNEL_REQUESTOR_BRIDGE_PEER,
@@ -2807,6 +2874,24 @@ struct ast_namedgroups *ast_ref_namedgroups(struct ast_namedgroups *groups);
 /*! \brief Return TRUE if group a and b contain at least one common groupname */
 int ast_namedgroups_intersect(struct ast_namedgroups *a, struct ast_namedgroups *b);
 
+/*!
+ * \brief Find the channels in the call groups a channel can pick up
+ * \since 18.0.0
+ *
+ * \param pickupgroup The numbered pickup groups
+ * \param named_pickupgroups The named pickup groups, may be NULL
+ *
+ * \note The channels are found from an index of call groups, so only
+ *       channels in the groups are looked at.  Whether they can be picked
+ *       up still has to be checked with them locked.
+ *
+ * \retval NULL on error
+ * \return A container, without a lock, of the channels with a matching
+ *         call group or named call group, each once
+ */
+struct ao2_container *ast_channel_callgroups_find(ast_group_t pickupgroup,
+	struct ast_namedgroups *named_pickupgroups);
+
 /*! \brief Print named call groups and named pickup groups */
 char *ast_print_namedgroups(struct ast_str **buf, struct ast_namedgroups *groups);
 
@@ -36,5 +36,7 @@ void ast_channel_internal_set_stream_topology_change_source(
 	struct ast_channel *chan, void *change_source);
 void ast_channel_internal_swap_stream_topology(struct ast_channel *chan1,
 	struct ast_channel *chan2);
+void ast_channel_internal_callgroups_changed(struct ast_channel *chan,
+	ast_group_t old_callgroup, struct ast_namedgroups *old_named_callgroups);
 
 #endif /* ASTERISK_CHANNEL_INTERNAL_H */
@@ -27,6 +27,8 @@
 
 struct ast_var_t {
 	AST_LIST_ENTRY(ast_var_t) entries;
+	/*! Hash of the name without the initial underscores, see ast_var_name_hash() */
+	unsigned int hash;
 	char *value;
 	char name[0];
 };
@@ -41,6 +43,17 @@ struct ast_var_t *_ast_var_assign(const char *name, const char *value, const cha
 
 void ast_var_delete(struct ast_var_t *var);
 const char *ast_var_name(const struct ast_var_t *var);
+
+/*!
+ * \brief Hash a variable name the way it is stored in ast_var_t
+ * \since 18.0.0
+ *
+ * \param name The name, the initial underscores are ignored
+ *
+ * Comparing the hash first spares a string compare with most of the
+ * variables a lookup goes through.
+ */
+unsigned int ast_var_name_hash(const char *name);
 const char *ast_var_full_name(const struct ast_var_t *var);
 const char *ast_var_value(const struct ast_var_t *var);
 char *ast_var_find(const struct varshead *head, const char *name);
@@ -126,6 +126,17 @@ typedef int realtime_require(const char *database, const char *table, va_list ap
  */
 typedef int realtime_unload(const char *database, const char *table);
 
+/*!
+ * \brief Function pointer called to retrieve the entries of several values of one field at once
+ * \since 18.0.0
+ *
+ * \details
+ * The entries have \a field equal to one of \a values, as with a SQL
+ * "IN (...)" clause, and match \a fields as well, if any.
+ */
+typedef struct ast_config *realtime_multi_in_get(const char *database, const char *table,
+	const char *field, const char * const *values, size_t count, const struct ast_variable *fields);
+
 /*! \brief Configuration engine structure, used to define realtime drivers */
 struct ast_config_engine {
 	char *name;
@@ -138,6 +149,7 @@ struct ast_config_engine {
 	realtime_destroy *destroy_func;
 	realtime_require *require_func;
 	realtime_unload *unload_func;
+	realtime_multi_in_get *realtime_multi_in_func;
 	struct ast_config_engine *next;
 };
 
@@ -562,6 +574,40 @@ struct ast_config *ast_load_realtime_multientry_fields(const char *family, const
  */
 struct ast_config *ast_load_realtime_multientry(const char *family, ...) attribute_sentinel;
 
+/*!
+ * \brief Retrieve the realtime entries of several values of one field at once
+ * \since 18.0.0
+ *
+ * \param family which family/config to lookup
+ * \param field the field the values are of
+ * \param values the values of \a field to retrieve the entries of
+ * \param count the number of values
+ * \param fields list of other fields the entries must match, may be NULL
+ *
+ * \details
+ * This retrieves what ast_load_realtime_multientry_fields would for each of
+ * the values, with as few queries as the backend allows. Backends that
+ * cannot look up several values in one query are queried for each value.
+ *
+ * \return An ast_config with one or more results
+ * \retval NULL Error or no results returned
+ */
+struct ast_config *ast_load_realtime_multientry_in(const char *family, const char *field,
+	const char * const *values, size_t count, const struct ast_variable *fields);
+
+/*!
+ * \brief Forget the results of a realtime family kept by the realtime cache
+ * \since 18.0.0
+ *
+ * \param family which family/config to forget the results of, NULL for all
+ *
+ * \details
+ * Families listed in the [cache] section of extconfig.conf keep the results
+ * of lookups for a while. Changes made through the realtime API forget them
+ * already, this is for changes made to the storage by other means.
+ */
+void ast_realtime_cache_invalidate(const char *family);
+
 /*!
  * \brief Update realtime configuration
  *
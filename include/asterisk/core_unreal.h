@@ -96,6 +96,8 @@ struct ast_unreal_pvt {
 	unsigned int flags;                         /*!< Private option flags */
 	/*! Base name of the unreal channels.  exten@context or other name. */
 	char name[AST_MAX_EXTENSION + AST_MAX_CONTEXT + 2];
+	struct timeval created;                     /*!< When the unreal channels were allocated */
+	struct timeval optimized;                   /*!< When the unreal channels were optimized out */
 };
 
 #define AST_UNREAL_IS_OUTBOUND(a, b) ((a) == (b)->chan ? 1 : 0)
@@ -104,6 +106,7 @@ struct ast_unreal_pvt {
 #define AST_UNREAL_NO_OPTIMIZATION  (1 << 1) /*!< Do not optimize out the unreal channels */
 #define AST_UNREAL_MOH_INTERCEPT    (1 << 2) /*!< Intercept and act on hold/unhold control frames */
 #define AST_UNREAL_OPTIMIZE_BEGUN   (1 << 3) /*!< Indicates that an optimization attempt has been started */
+#define AST_UNREAL_OPTIMIZED        (1 << 4) /*!< The unreal channels were optimized out */
 
 /*!
  * \brief Send an unreal pvt in with no locks held and get all locks
@@ -170,4 +170,30 @@ size_t ast_data_buffer_count(const struct ast_data_buffer *buffer);
  */
 size_t ast_data_buffer_max(const struct ast_data_buffer *buffer);
 
+/*!
+ * \brief Allocate memory for a data buffer payload
+ *
+ * \param size The number of bytes needed
+ *
+ * \details The memory comes from the frame payload pool so payloads
+ * the size of media packets are recycled instead of going to the heap.
+ * Use ast_data_buffer_payload_free() as the free callback of the data
+ * buffer holding such payloads.
+ *
+ * \retval the payload memory on success
+ * \retval NULL on failure
+ *
+ * \since 18.0.0
+ */
+void *ast_data_buffer_payload_alloc(size_t size);
+
+/*!
+ * \brief Release memory allocated by ast_data_buffer_payload_alloc()
+ *
+ * \param payload The payload to release
+ *
+ * \since 18.0.0
+ */
+void ast_data_buffer_payload_free(void *payload);
+
 #endif /* _AST_DATA_BUFFER_H */
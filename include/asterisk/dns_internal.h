@@ -136,6 +136,8 @@ struct ast_dns_query {
 	int rr_type;
 	/*! \brief Resource record class */
 	int rr_class;
+	/*! \brief Whether the query is answered from the cache, not the resolver */
+	unsigned int cached;
 	/*! \brief The name of what is being resolved */
 	char name[0];
 };
@@ -297,4 +299,74 @@ int dns_parse_string(char *cur, uint8_t *size, char **val);
  */
 struct ast_dns_query *dns_query_alloc(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data);
 
+/*!
+ * \brief Start resolving a query, answering it from the cache if possible
+ *
+ * \param query The query, from \ref dns_query_alloc
+ *
+ * \retval 0 success, the callback of the query will be invoked
+ * \retval -1 failure
+ */
+int dns_query_resolve(struct ast_dns_query *query);
+
+/*!
+ * \brief Cancel a query started by \ref dns_query_resolve
+ *
+ * \param query The query
+ *
+ * \retval 0 success, the callback of the query will not be invoked
+ * \retval -1 failure, such as for a query answered from the cache
+ */
+int dns_query_cancel(struct ast_dns_query *query);
+
+/*!
+ * \brief Asynchronously resolve a DNS query, always asking the resolver
+ *
+ * This is \ref ast_dns_resolve_async without the cache, for queries which
+ * are themselves repeated by TTL.
+ *
+ * \param name The name of what to resolve
+ * \param rr_type Resource record type
+ * \param rr_class Resource record class
+ * \param callback The callback to invoke upon completion
+ * \param data User data to make available on the query
+ *
+ * \retval non-NULL success
+ * \retval NULL failure
+ */
+struct ast_dns_query_active *dns_resolve_async_uncached(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data);
+
+/*!
+ * \brief Initialize the cache of DNS answers
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int dns_cache_init(void);
+
+/*!
+ * \brief Answer a query from the cache of DNS answers
+ *
+ * A fresh answer is given as it is. An answer whose TTL ran out a short
+ * while ago is given while a query refreshing it is started.
+ *
+ * \param query The query
+ *
+ * \retval 0 success, the query is completed from the scheduler thread
+ * \retval -1 no answer is cached
+ */
+int dns_cache_resolve(struct ast_dns_query *query);
+
+/*!
+ * \brief Keep the answer of a query completed by a resolver in the cache
+ *
+ * \param query The query
+ */
+void dns_cache_store(const struct ast_dns_query *query);
+
+/*!
+ * \brief Forget every answer in the cache
+ */
+void dns_cache_flush(void);
+
 #endif /* _ASTERISK_DNS_INTERNAL_H */
@@ -106,4 +106,13 @@ typedef int (*record_fn)(void *record, char *buf);
 int ast_dns_test_generate_result(struct ast_dns_query *query, void *records, size_t num_records,
 		size_t record_size, record_fn generate, char *buffer);
 
+/*!
+ * \brief Make every answer in the DNS cache older
+ *
+ * This lets tests see answers run past their TTL without waiting for it.
+ *
+ * \param seconds How many seconds older the answers become
+ */
+void ast_dns_test_cache_age(int seconds);
+
 #endif /* DNS_TEST_H */
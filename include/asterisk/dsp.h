@@ -131,6 +131,36 @@ int ast_dsp_silence(struct ast_dsp *dsp, struct ast_frame *f, int *totalsilence)
  */
 int ast_dsp_silence_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *totalsilence, int *frames_energy);
 
+/*!
+ * \brief Compute the energy of an audio frame.
+ * \since 18.0.0
+ *
+ * \param f Signed linear, alaw or ulaw audio frame.
+ * \param frames_energy Variable to set to the average energy of the samples in the frame.
+ *
+ * \details This is the energy ast_dsp_silence_with_energy() reports.  Computing it
+ * once lets several detectors watching the same audio share it through
+ * ast_dsp_silence_energy().
+ *
+ * \retval 0 on success.
+ * \retval -1 if the frame is not audio in a supported format.
+ */
+int ast_dsp_frame_energy(const struct ast_frame *f, int *frames_energy);
+
+/*!
+ * \brief Process the audio frame for silence given its energy.
+ * \since 18.0.0
+ *
+ * \param dsp DSP processing audio media.
+ * \param f Audio frame to process.
+ * \param frames_energy Energy of the frame from ast_dsp_frame_energy().
+ * \param totalsilence Variable to set to the total accumulated silence in ms
+ * seen by the DSP since the last noise.
+ *
+ * \return Non-zero if the frame is silence.
+ */
+int ast_dsp_silence_energy(struct ast_dsp *dsp, struct ast_frame *f, int frames_energy, int *totalsilence);
+
 /*!
  * \brief Process the audio frame for noise.
  * \since 1.6.1
@@ -257,7 +257,9 @@ struct ast_applicationmap_item {
  *
  * This uses the value of the DYNAMIC_FEATURES channel variable to build a
  * custom applicationmap for this channel. The returned container has
- * applicationmap_items inside.
+ * applicationmap_items inside. It is shared by the channels with the same
+ * DYNAMIC_FEATURES until the configuration is reloaded, and must not be
+ * changed.
  *
  * \param chan The channel for which applicationmap is being retrieved.
  * \retval NULL An error occurred or the channel has no dynamic features.
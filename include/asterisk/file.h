@@ -76,6 +76,26 @@ typedef void (ast_waitstream_fr_cb)(struct ast_channel *chan, long ms, enum ast_
  */
 int ast_streamfile(struct ast_channel *c, const char *filename, const char *preflang);
 
+/*!
+ * \brief Streams a list of files back to back
+ * \since 18.0.0
+ *
+ * \param c channel to stream the files to
+ * \param filenames the names of the files, minus the extension
+ * \param count how many files are in the list
+ * \param preflang the preferred language of the files
+ *
+ * Like ast_streamfile(), but the files that follow the first one and exist in
+ * the format chosen for it are read as part of the same stream, so they are
+ * played without opening a stream or choosing a format for each of them.
+ * Seeking in the stream only applies to the first file.
+ *
+ * \return the number of files of the list in the stream, so the rest can be
+ *         streamed once it finishes
+ * \retval -1 if the first file could not be streamed
+ */
+int ast_streamfile_list(struct ast_channel *c, const char * const *filenames, int count, const char *preflang);
+
 /*!
  * \brief stream file until digit
  * If the file name is non-empty, try to play it.
@@ -110,6 +130,21 @@ int ast_stopstream(struct ast_channel *c);
  */
 int ast_fileexists(const char *filename, const char *fmt, const char *preflang);
 
+/*!
+ * \brief Read a file into the prompt cache ahead of it being played
+ * \since 18.0.0
+ *
+ * \param filename name of the file, minus the extension
+ * \param preflang the preferred language to find the file in
+ *
+ * Every format the file exists in is read, so that opening the file later
+ * does not wait on the disk.
+ *
+ * \retval 0 if the file is now in the prompt cache
+ * \retval -1 if the prompt cache is disabled, full, or the file does not exist
+ */
+int ast_file_prefetch(const char *filename, const char *preflang);
+
 /*!
  * \brief Renames a file
  * \param oldname the name of the file you wish to act upon (minus the extension)
@@ -188,6 +188,8 @@ struct ast_frame {
 	int seqno;
 	/*! Stream number the frame originated from */
 	int stream_num;
+	/*! Monotonic nanoseconds the media was received at, 0 if not stamped (see frame_timing.h) */
+	uint64_t ingress;
 };
 
 /*!
@@ -228,6 +230,8 @@ extern struct ast_frame ast_null_frame;
 #define AST_MALLOCD_DATA	(1 << 1)
 /*! Need the source be free'd? (haha!) */
 #define AST_MALLOCD_SRC		(1 << 2)
+/*! Was the data allocated by ast_frame_payload_alloc()?  (Set with AST_MALLOCD_DATA) */
+#define AST_MALLOCD_PAYLOAD	(1 << 3)
 
 /* MODEM subclasses */
 /*! T.38 Fax-over-IP */
@@ -571,6 +575,114 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 #define ast_frdup(fr) __ast_frdup(fr, __FILE__, __LINE__, __PRETTY_FUNCTION__)
 struct ast_frame *__ast_frdup(const struct ast_frame *fr, const char *file, int line, const char *func);
 
+/*!
+ * \brief Copy a frame sharing its payload buffer
+ * \since 18.0.0
+ *
+ * \param fr frame to share
+ *
+ * \details If the frame data is in a payload pool buffer, the new
+ * frame gets its own header but references the same data buffer.
+ * Otherwise the data is copied into a payload pool buffer that
+ * further calls can share.  This is meant for handing one frame to
+ * many consumers, such as a bridge writing a frame to every channel.
+ *
+ * \note The data of a shared frame is immutable.  Anything that modifies
+ * the data or the AST_FRIENDLY_OFFSET area in front of it must first
+ * call ast_frame_unshare().
+ *
+ * \return Returns a frame on success, NULL on error
+ */
+#define ast_frame_share(fr) __ast_frame_share(fr, __FILE__, __LINE__, __PRETTY_FUNCTION__)
+struct ast_frame *__ast_frame_share(const struct ast_frame *fr, const char *file, int line, const char *func);
+
+/*!
+ * \brief Determine if other frames share the frame's data buffer
+ * \since 18.0.0
+ *
+ * \param fr frame to check
+ *
+ * \retval 1 if the data is shared.
+ * \retval 0 if the data is private to the frame.
+ */
+int ast_frame_is_shared(const struct ast_frame *fr);
+
+/*!
+ * \brief Get the translation attached to shared frame data
+ * \since 18.0.0
+ *
+ * \param fr frame whose data may be shared
+ * \param format format the translation must be in
+ *
+ * \details Returns the result of translating the frame data as left by
+ * ast_frame_shared_translation_set() on any of the frames sharing it.
+ *
+ * \return A new frame sharing the translated data, free with ast_frfree()
+ * \retval NULL if no translation to \a format is attached.
+ */
+struct ast_frame *ast_frame_shared_translation_get(const struct ast_frame *fr, struct ast_format *format);
+
+/*!
+ * \brief Attach a translation of shared frame data for the other sharing frames
+ * \since 18.0.0
+ *
+ * \param fr frame whose data is shared
+ * \param translation single voice frame holding the translated data
+ *
+ * \details Translating the same data through the same stateless translation
+ * path always gives the same result.  When a bridge hands one frame to many
+ * channels with the same write format the first channel to translate it can
+ * attach the result so the others skip the translation.  Only one translation
+ * is kept per data buffer and it is released together with the buffer.
+ *
+ * \note The translation must only depend on the frame data.
+ *
+ * \retval 0 if the translation was attached.
+ * \retval -1 if the data is not shared or already has a translation.
+ */
+int ast_frame_shared_translation_set(const struct ast_frame *fr, const struct ast_frame *translation);
+
+/*!
+ * \brief Give a frame a private copy of shared data
+ * \since 18.0.0
+ *
+ * \param fr frame to make writable
+ *
+ * \details Does nothing if the data is not shared.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.  The frame is unchanged and still shared.
+ */
+#define ast_frame_unshare(fr) __ast_frame_unshare(fr, __FILE__, __LINE__, __PRETTY_FUNCTION__)
+int __ast_frame_unshare(struct ast_frame *fr, const char *file, int line, const char *func);
+
+/*!
+ * \brief Allocate a frame payload buffer.
+ * \since 18.0.0
+ *
+ * \param size Number of bytes needed.
+ *
+ * \details Buffers of up to 1920 bytes plus AST_FRIENDLY_OFFSET are
+ * taken from a per-thread pool of size classes matching the common
+ * signed linear frame sizes.  Larger buffers come from the heap.
+ *
+ * \retval buffer on success.  Release it with ast_frame_payload_free().
+ * \retval NULL on error.
+ */
+#define ast_frame_payload_alloc(size) __ast_frame_payload_alloc((size), __FILE__, __LINE__, __PRETTY_FUNCTION__)
+void *__ast_frame_payload_alloc(size_t size, const char *file, int line, const char *func);
+
+/*!
+ * \brief Release a buffer allocated by ast_frame_payload_alloc().
+ * \since 18.0.0
+ *
+ * \param payload Buffer to release.  (Tolerates NULL)
+ *
+ * \note The buffer may be released by a different thread than the
+ * one that allocated it.
+ */
+void ast_frame_payload_free(void *payload);
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples);
 
 /* Helpers for byteswapping native samples to/from
@@ -0,0 +1,140 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Timing of frames through the media path
+ *
+ * When enabled with 'core set frame timing on', media frames are stamped
+ * with the monotonic time they are read from RTP at, in the ingress of
+ * the frame. The stamp is carried through translation and bridging, and at
+ * each stage of the media path the time since ingress is added to a
+ * histogram of the stage for the bridge technology the frame is bridged
+ * with. The histograms are shown by 'core show frame timing' and exported
+ * by res_prometheus.
+ *
+ * Frames mixed by a bridge technology are new frames, which are not
+ * stamped, so for mixing technologies the last stage recorded is the
+ * frame reaching the mixer.
+ */
+
+#ifndef _ASTERISK_FRAME_TIMING_H
+#define _ASTERISK_FRAME_TIMING_H
+
+#include <inttypes.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+struct ast_frame;
+
+/*! \brief The stages of the media path a frame is timed at */
+enum ast_frame_timing_stage {
+	/*! The frame was returned by ast_read() */
+	AST_FRAME_TIMING_READ = 0,
+	/*! The frame was given to the bridge technology */
+	AST_FRAME_TIMING_BRIDGE,
+	/*! The frame was taken off the write queue of a bridge channel */
+	AST_FRAME_TIMING_QUEUE,
+	/*! The frame was given to ast_write() */
+	AST_FRAME_TIMING_WRITE,
+	/*! The frame was sent by the RTP engine */
+	AST_FRAME_TIMING_SEND,
+	/*! The number of stages, not a stage */
+	AST_FRAME_TIMING_STAGES,
+};
+
+/*! \brief The number of buckets of a histogram, the last of which has no upper bound */
+#define AST_FRAME_TIMING_BUCKETS 13
+
+/*! \brief A histogram of the time frames took to reach a stage */
+struct ast_frame_timing_histogram {
+	/*! \brief The bridge technology, or "none" for frames not bridged */
+	const char *technology;
+	/*! \brief The stage */
+	enum ast_frame_timing_stage stage;
+	/*! \brief Frames in each bucket, not cumulative */
+	uint64_t buckets[AST_FRAME_TIMING_BUCKETS];
+	/*! \brief Frames in all */
+	uint64_t count;
+	/*! \brief Sum of the times, in microseconds */
+	uint64_t sum;
+};
+
+/*! \brief Whether frames are timed, only to be read by the macros below */
+extern int ast_frame_timing_enabled;
+
+/*!
+ * \brief Stamp frames read from the network with their ingress
+ * \since 18.0.0
+ *
+ * \param f The frame, or list of frames, stamped. The ingress is cleared
+ *          while timing is disabled, so that reused frames are not left
+ *          with a stale stamp.
+ */
+void ast_frame_timing_stamp(struct ast_frame *f);
+
+/*!
+ * \brief Record the time a frame took to reach a stage
+ * \since 18.0.0
+ *
+ * \param stage The stage reached
+ * \param technology The bridge technology, or NULL for the last one the
+ *                   thread recorded with
+ * \param f The frame
+ */
+void ast_frame_timing_record(enum ast_frame_timing_stage stage, const char *technology, const struct ast_frame *f);
+
+/*!
+ * \brief The name of a stage
+ * \since 18.0.0
+ */
+const char *ast_frame_timing_stage_name(enum ast_frame_timing_stage stage);
+
+/*!
+ * \brief The upper bound of a bucket of the histograms
+ * \since 18.0.0
+ *
+ * \return The bound in microseconds, or 0 for the last bucket which has none
+ */
+unsigned int ast_frame_timing_bucket_bound(int bucket);
+
+/*!
+ * \brief Call a function with a copy of every histogram recorded into
+ * \since 18.0.0
+ *
+ * \param callback The function, which must not block
+ * \param data Passed to the function
+ */
+void ast_frame_timing_histograms(void (*callback)(const struct ast_frame_timing_histogram *histogram, void *data), void *data);
+
+/*!
+ * \brief Record the time a frame took to reach a stage, if it was stamped
+ * \since 18.0.0
+ */
+#define AST_FRAME_TIMING_RECORD(stage, technology, f) \
+	do { \
+		if (__builtin_expect(ast_frame_timing_enabled, 0) && (f)->ingress) { \
+			ast_frame_timing_record(stage, technology, f); \
+		} \
+	} while (0)
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_FRAME_TIMING_H */
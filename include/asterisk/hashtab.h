@@ -63,27 +63,39 @@ This implementation is pretty generic, because:
     table size for ints, is provided; the user can use these simple
     algorithms to generate a hash, or implement any other algorithms they
     wish.
- 6. Recently updated the hash routines to use Doubly-linked lists for buckets,
-    and added a doubly-linked list that threads thru every bucket in the table.
-    The list of all buckets is on the HashTab struct. The Traversal was modified
-    to go thru this list instead of searching the bucket array for buckets.
-    This also should make it safe to remove a bucket during the traversal.
-    Removal and destruction routines will work faster.
+ 6. The objects are kept in an array, in the order they were inserted, which
+    the traversal goes thru. The array is indexed by an open addressing table,
+    whose slots each keep 7 bits of the hash of their object, and the slots
+    are probed (SwissTable style) a group of 8 at a time. It is safe to remove
+    an object during the traversal.
+ 7. The index is resized a little at a time, by the insertions and removals
+    following the resize, rather than all at once.
 */
 
 struct ast_hashtab_bucket
 {
-	const void *object;                    /*!< whatever it is we are storing in this table */
-	struct ast_hashtab_bucket *next;       /*!< a DLL of buckets in hash collision */
-	struct ast_hashtab_bucket *prev;       /*!< a DLL of buckets in hash collision */
-	struct ast_hashtab_bucket *tnext;      /*!< a DLL of all the hash buckets for traversal */
-	struct ast_hashtab_bucket *tprev;      /*!< a DLL of all the hash buckets for traversal */
+	const void *object;                    /*!< whatever it is we are storing in this table, NULL once removed */
+	unsigned int hash;                     /*!< the hash of the object, not reduced to the table size */
+};
+
+/*! \brief an open addressing index into the objects of a hash table */
+struct ast_hashtab_index
+{
+	unsigned char *ctrl;                   /*!< a byte per slot: empty, deleted, or 7 bits of the hash of its object */
+	unsigned int *slots;                   /*!< the position in the object array each slot is for */
+	unsigned int capacity;                 /*!< the number of slots, a power of 2 */
+	unsigned int used;                     /*!< the number of slots not empty, deleted ones included */
 };
 
 struct ast_hashtab
 {
-	struct ast_hashtab_bucket **array;
-	struct ast_hashtab_bucket *tlist;		/*!< the head of a DLList of all the hashbuckets in the table (for traversal). */
+	struct ast_hashtab_bucket *array;      /*!< the objects, in the order they were inserted (for traversal). */
+	int array_size;                        /*!< the number of objects the array has room for */
+	int array_used;                        /*!< the number of objects put in the array, removed ones included */
+	struct ast_hashtab_index index;        /*!< the index objects are inserted into */
+	struct ast_hashtab_index old_index;    /*!< the index being moved into index during a resize */
+	unsigned int migrated;                 /*!< the slots of old_index moved so far */
+	int iterators;                         /*!< traversals going, during which the array is not squeezed */
 
 	int (*compare) (const void *a, const void *b);	/*!< a ptr to func that returns int, and take two void* ptrs, compares them,
 													 rets -1 if a < b; rets 0 if a==b; rets 1 if a>b */
@@ -91,9 +103,9 @@ struct ast_hashtab
 	int (*resize) (struct ast_hashtab *tab);	/*!< a function to decide whether this hashtable should be resized now */
 	unsigned int (*hash) (const void *obj);         /*!< a hash func ptr for this table. Given a raw ptr to an obj,
 													 it calcs a hash.*/
-	int hash_tab_size;                            /*!< the size of the bucket array */
+	int hash_tab_size;                            /*!< the number of slots of the index */
 	int hash_tab_elements;                        /*!< the number of objects currently stored in the table */
-	int largest_bucket_size;                      /*!< a stat on the health of the table */
+	int largest_bucket_size;                      /*!< a stat on the health of the table, the most groups probed to insert */
 	int resize_count;                             /*!< a count of the number of times this table has been
 													 resized */
 	int do_locking;                               /*!< if 1 use locks to guarantee safety of insertions/deletions */
@@ -105,7 +117,7 @@ struct ast_hashtab
 struct ast_hashtab_iter
 {
 	struct ast_hashtab *tab;
-	struct ast_hashtab_bucket *next;
+	int next;                              /*!< the position in the object array of the next object */
 };
 
 
@@ -295,7 +307,7 @@ int _ast_hashtab_insert_immediate(struct ast_hashtab *tab, const void *obj, cons
  * \brief Insert without checking, hashing or locking
  * \param tab
  * \param obj
- * \param h hashed index value
+ * \param h hash value of the object, as returned by ast_hashtab_lookup_bucket()
  *
  * \note Will force a resize if the resize func returns 1
  * \retval 1 on success
@@ -332,7 +344,7 @@ void * ast_hashtab_lookup_with_hash(struct ast_hashtab *tab, const void *obj, un
 
 /*!
  * \brief Similar to ast_hashtab_lookup but sets h to the key hash value if the lookup fails.
- * \note This has the modulus applied, and will not be useful for long term storage if the table is resizable.
+ * \note The modulus is not applied, so it stays valid if the table is resized.
 */
 void * ast_hashtab_lookup_bucket(struct ast_hashtab *tab, const void *obj, unsigned int *h);
 
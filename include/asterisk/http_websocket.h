@@ -284,6 +284,32 @@ AST_OPTIONAL_API(int, ast_websocket_write, (struct ast_websocket *session, enum
 AST_OPTIONAL_API(int, ast_websocket_write_string,
 		 (struct ast_websocket *ws, const char *buf),
 		 { errno = ENOSYS; return -1;});
+
+/*!
+ * \brief Hold back the frames written to a WebSocket session
+ *
+ * \param session Pointer to the WebSocket session
+ *
+ * Until \ref ast_websocket_uncork is called the frames written are gathered
+ * and sent to the socket together, once enough of them are pending to make
+ * the write worthwhile. Calls may be nested.
+ *
+ * \since 18.0.0
+ */
+AST_OPTIONAL_API(void, ast_websocket_cork, (struct ast_websocket *session), {return;});
+
+/*!
+ * \brief Send the frames held back since \ref ast_websocket_cork was called
+ *
+ * \param session Pointer to the WebSocket session
+ *
+ * \retval 0 if successfully written, or if still corked by an outer caller
+ * \retval -1 if error occurred
+ *
+ * \since 18.0.0
+ */
+AST_OPTIONAL_API(int, ast_websocket_uncork, (struct ast_websocket *session), { errno = ENOSYS; return -1;});
+
 /*!
  * \brief Close a WebSocket session by sending a message with the CLOSE opcode and an optional code
  *
@@ -140,6 +140,17 @@ int ast_iostream_get_fd(struct ast_iostream *stream);
  */
 int ast_iostream_wait_for_input(struct ast_iostream *stream, int timeout);
 
+/*!
+ * \brief Check whether input was already read from the file descriptor of an iostream
+ * \since 18.0.0
+ *
+ * \param stream A pointer to an iostream
+ *
+ * \retval non-zero if the stream can be read without the file descriptor
+ *         becoming readable.
+ */
+int ast_iostream_has_pending_input(struct ast_iostream *stream);
+
 /*!
  * \brief Make an iostream non-blocking.
  *
@@ -218,6 +229,23 @@ ssize_t ast_iostream_discard(struct ast_iostream *stream, size_t count);
  */
 ssize_t ast_iostream_write(struct ast_iostream *stream, const void *buffer, size_t count);
 
+/*!
+ * \brief Write part of a file to an iostream.
+ * \since 18.0.0
+ *
+ * \param stream A pointer to an iostream
+ * \param fd The file, which is read without moving its offset
+ * \param offset Where in the file to start from
+ * \param count The number of bytes of the file to write.
+ *
+ * The file is copied by the kernel with sendfile(2) where it can be, and
+ * otherwise read and written in large chunks, such as for TLS.
+ *
+ * \return The number of bytes written, which is less than \a count if the
+ *         file ends or the write timed out, or \c -1 on error.
+ */
+ssize_t ast_iostream_sendfile(struct ast_iostream *stream, int fd, off_t offset, size_t count);
+
 /*!
  * \brief Write a formatted string to an iostream.
  *
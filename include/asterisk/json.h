@@ -819,6 +819,170 @@ int ast_json_dump_file_format(struct ast_json *root, FILE *output, enum ast_json
  */
 int ast_json_dump_new_file_format(struct ast_json *root, const char *path, enum ast_json_encoding_format format);
 
+/*! \brief Most containers a \ref ast_json_writer can have open at once */
+#define AST_JSON_WRITER_MAX_DEPTH 64
+
+/*!
+ * \brief Streaming JSON encoder.
+ * \since 18.0.0
+ *
+ * Values are encoded straight into an \ref ast_str as they are written,
+ * rather than built as a tree of \ref ast_json values that is encoded and
+ * freed afterwards. The output is the same as ast_json_dump_str_format()
+ * gives for the equivalent tree.
+ *
+ * A failed write is remembered. Later writes do nothing, so a sequence of
+ * writes only needs checking once with ast_json_writer_finish().
+ */
+struct ast_json_writer {
+	/*! The buffer written to */
+	struct ast_str **dst;
+	/*! Encoding format */
+	enum ast_json_encoding_format format;
+	/*! Containers currently open */
+	unsigned int depth;
+	/*! A bit per open container, set once it holds a value */
+	uint64_t filled;
+	/*! A bit per open container, set for objects */
+	uint64_t objects;
+	/*! A key was written and its value comes next */
+	unsigned int after_key:1;
+	/*! A write failed */
+	unsigned int failed:1;
+};
+
+/*!
+ * \brief Start encoding at the end of an \ref ast_str.
+ * \since 18.0.0
+ *
+ * \param writer Writer to initialize.
+ * \param dst \ref ast_str to append to, grown as needed.
+ * \param format encoding format type.
+ */
+void ast_json_writer_init(struct ast_json_writer *writer, struct ast_str **dst,
+	enum ast_json_encoding_format format);
+
+/*!
+ * \brief Open an object.
+ * \since 18.0.0
+ *
+ * Each value written to the object must be preceded by its key.
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_object_start(struct ast_json_writer *writer);
+
+/*!
+ * \brief Close the innermost object.
+ * \since 18.0.0
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_object_end(struct ast_json_writer *writer);
+
+/*!
+ * \brief Open an array.
+ * \since 18.0.0
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_array_start(struct ast_json_writer *writer);
+
+/*!
+ * \brief Close the innermost array.
+ * \since 18.0.0
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_array_end(struct ast_json_writer *writer);
+
+/*!
+ * \brief Write the key of the next object member.
+ * \since 18.0.0
+ *
+ * \param writer The writer.
+ * \param key UTF-8 encoded key.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_key(struct ast_json_writer *writer, const char *key);
+
+/*!
+ * \brief Write a string value.
+ * \since 18.0.0
+ *
+ * \param writer The writer.
+ * \param value UTF-8 encoded string, or \c NULL to write null.
+ * \return 0 on success.
+ * \return -1 on error, including invalid UTF-8.
+ */
+int ast_json_writer_string(struct ast_json_writer *writer, const char *value);
+
+/*!
+ * \brief Write an integer value.
+ * \since 18.0.0
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_integer(struct ast_json_writer *writer, intmax_t value);
+
+/*!
+ * \brief Write true or false.
+ * \since 18.0.0
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_boolean(struct ast_json_writer *writer, int value);
+
+/*!
+ * \brief Write null.
+ * \since 18.0.0
+ *
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_null(struct ast_json_writer *writer);
+
+/*!
+ * \brief Write a timeval as an ISO 8601 string.
+ * \since 18.0.0
+ *
+ * \param writer The writer.
+ * \param tv \c timeval to encode.
+ * \param zone Text string of a standard system zoneinfo file.  If NULL, the system localtime will be used.
+ * \return 0 on success.
+ * \return -1 on error.
+ *
+ * \see ast_json_timeval()
+ */
+int ast_json_writer_timeval(struct ast_json_writer *writer, const struct timeval tv, const char *zone);
+
+/*!
+ * \brief Write an existing JSON value.
+ * \since 18.0.0
+ *
+ * \param writer The writer.
+ * \param value JSON value, which is not stolen.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_writer_value(struct ast_json_writer *writer, struct ast_json *value);
+
+/*!
+ * \brief Check a finished encoding.
+ * \since 18.0.0
+ *
+ * \return 0 if every write succeeded and every container was closed.
+ * \return -1 otherwise. The contents of the writer's \ref ast_str are undefined.
+ */
+int ast_json_writer_finish(struct ast_json_writer *writer);
+
 #define AST_JSON_ERROR_TEXT_LENGTH    160
 #define AST_JSON_ERROR_SOURCE_LENGTH   80
 
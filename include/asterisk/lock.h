@@ -237,6 +237,58 @@ int __ast_rwlock_trywrlock(const char *filename, int lineno, const char *func, a
 #define ast_rwlock_timedrdlock(a, b)       __ast_rwlock_timedrdlock(__FILE__, __LINE__, __PRETTY_FUNCTION__, a, #a, b)
 #define ast_rwlock_timedwrlock(a, b)       __ast_rwlock_timedwrlock(__FILE__, __LINE__, __PRETTY_FUNCTION__, a, #a, b)
 
+/*!
+ * \brief Contention sampled at one place a lock is taken
+ * \since 18.0.0
+ */
+struct ast_lock_profile_site {
+	/*! File taking the lock */
+	char file[64];
+	/*! Function taking the lock */
+	char func[64];
+	/*! The lock, as named where it is taken */
+	char name[64];
+	/*! Line taking the lock */
+	int line;
+	/*! Acquisitions sampled */
+	unsigned int samples;
+	/*! Acquisitions sampled that had to wait for the lock */
+	unsigned int contended;
+	/*! Time the sampled acquisitions waited, in microseconds */
+	uint64_t wait_us;
+	/*! Longest a sampled acquisition waited, in microseconds */
+	uint64_t max_wait_us;
+};
+
+/*!
+ * \brief Sample the contention of mutex and rwlock acquisitions
+ * \since 18.0.0
+ *
+ * \param rate Sample one acquisition in this many, or none if 0
+ *
+ * \note What was sampled before is forgotten.
+ */
+void ast_lock_profile_set_rate(unsigned int rate);
+
+/*!
+ * \brief Get how often lock acquisitions are sampled
+ * \since 18.0.0
+ *
+ * \return one acquisition in this many is sampled, 0 if none
+ */
+unsigned int ast_lock_profile_get_rate(void);
+
+/*!
+ * \brief Get the places that waited longest for locks
+ * \since 18.0.0
+ *
+ * \param sites Filled with the places, the longest total wait first
+ * \param count Most places to fill
+ *
+ * \return the number of places filled
+ */
+int ast_lock_profile_collect(struct ast_lock_profile_site *sites, int count);
+
 #define	ROFFSET	((lt->reentrancy > 0) ? (lt->reentrancy-1) : 0)
 
 #ifdef DEBUG_THREADS
@@ -683,6 +735,15 @@ static void  __attribute__((destructor)) fini_##rwlock(void) \
 #define ast_atomic_fetch_xor(ptr, val, memorder)  __atomic_fetch_xor((ptr), (val), (memorder))
 #define ast_atomic_xor_fetch(ptr, val, memorder)  __atomic_xor_fetch((ptr), (val), (memorder))
 
+/*! Atomic exchange, returns the previous value */
+#define ast_atomic_exchange_n(ptr, val, memorder)  __atomic_exchange_n((ptr), (val), (memorder))
+
+/*! Atomic load */
+#define ast_atomic_load_n(ptr, memorder)  __atomic_load_n((ptr), (memorder))
+
+/*! Atomic store */
+#define ast_atomic_store_n(ptr, val, memorder)  __atomic_store_n((ptr), (val), (memorder))
+
 #if 0
 /* Atomic compare and swap
  *
@@ -716,6 +777,20 @@ static void  __attribute__((destructor)) fini_##rwlock(void) \
 #define ast_atomic_fetch_xor(ptr, val, memorder)  __sync_fetch_and_xor((ptr), (val))
 #define ast_atomic_xor_fetch(ptr, val, memorder)  __sync_xor_and_fetch((ptr), (val))
 
+/*!
+ * Atomic exchange, returns the previous value
+ *
+ * __sync_lock_test_and_set() is only an acquire barrier so a full
+ * barrier is issued first.
+ */
+#define ast_atomic_exchange_n(ptr, val, memorder)  (__sync_synchronize(), __sync_lock_test_and_set((ptr), (val)))
+
+/*! Atomic load */
+#define ast_atomic_load_n(ptr, memorder)  (__sync_synchronize(), *(volatile __typeof__(*(ptr)) *)(ptr))
+
+/*! Atomic store */
+#define ast_atomic_store_n(ptr, val, memorder)  ((void) ast_atomic_exchange_n((ptr), (val), (memorder)))
+
 #if 0
 /* Atomic compare and swap
  *
@@ -98,6 +98,8 @@ struct ast_format_def {
  * together with buf_size and desc_size bytes of memory
  * to be used for private purposes (e.g. buffers etc.)
  */
+struct file_prompt;
+
 struct ast_filestream {
 	/*! Everybody reserves a block of AST_RESERVED_POINTERS pointers for us */
 	struct ast_format_def *fmt;	/* need to write to the lock and usecnt */
@@ -124,6 +126,12 @@ struct ast_filestream {
 	void *_private;	/*!< pointer to private buffer */
 	const char *orig_chan_name;
 	char *write_buffer;
+	/*! The contents of the file in the prompt cache, if read from there */
+	struct file_prompt *prompt;
+	/*! The file read after this one in the same stream, see ast_streamfile_list() */
+	struct ast_filestream *next;
+	/*! The file of the list being read, NULL while reading this one */
+	struct ast_filestream *current;
 };
 
 /*!
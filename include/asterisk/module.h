@@ -248,6 +248,14 @@ int ast_update_module_list_condition(int (*modentry)(const char *module, const c
  */
 int ast_module_check(const char *name);
 
+/*!
+ * \brief Get how long the load function of a module took
+ * \param name Module name, like "chan_sip.so"
+ * \return The time in microseconds, or -1 if the module is not running
+ * \since 18.0.0
+ */
+int64_t ast_module_load_time(const char *name);
+
 /*!
  * \brief Add a procedure to be run when modules have been updated.
  * \param updater The function to run when modules have been updated.
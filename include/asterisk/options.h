@@ -182,6 +182,20 @@ extern int option_verbose;
 extern int ast_option_maxfiles;		/*!< Max number of open file handles (files, sockets) */
 extern int option_debug;		/*!< Debugging */
 extern int ast_option_maxcalls;		/*!< Maximum number of simultaneous channels */
+/*! Upper limit of ast_option_channel_storage_shards */
+#define AST_MAX_CHANNEL_STORAGE_SHARDS 256
+extern unsigned int ast_option_channel_storage_shards;	/*!< Number of separately locked channel containers (channel.c) */
+/*! Limits of ast_option_pbx_stacksize in KB */
+#define AST_MIN_PBX_STACKSIZE 64
+#define AST_MAX_PBX_STACKSIZE 8192
+extern int ast_option_astdb_wal;		/*!< Whether astdb uses write-ahead logging (db.c) */
+extern int ast_option_config_snapshots;	/*!< Whether parsed configuration files are kept as snapshots (config.c) */
+extern unsigned int ast_option_tps_slow_task;	/*!< Taskprocessor tasks running longer than this many ms are logged, 0 to disable (taskprocessor.c) */
+extern unsigned int ast_option_prompt_cache_size;	/*!< MB of sound files kept in memory for playback, 0 to disable (file.c) */
+extern int ast_option_sound_variants;	/*!< Whether sound files played often are written in the formats they are played in (file.c) */
+extern int ast_option_say_playlist;	/*!< Whether the files played by ast_say_* are collected and played as one stream (say.c) */
+extern unsigned int ast_option_media_cache_size;	/*!< MB of local files the media cache keeps, 0 for no limit (media_cache.c) */
+extern unsigned int ast_option_pbx_stacksize;	/*!< Stack size of threads started by ast_pbx_start() in KB, 0 for the default (pbx.c) */
 extern unsigned int option_dtmfminduration;	/*!< Minimum duration of DTMF (channel.c) in ms */
 extern double ast_option_maxload;
 #if defined(HAVE_SYSINFO)
@@ -0,0 +1,60 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Origination executor
+ *
+ * Calls originated asynchronously, such as by AMI and ARI, are dialed by a
+ * shared pool of threads. The calls waiting for a thread are bounded, the
+ * calls dialed per second may be limited per destination, and calls are
+ * refused while the system is overloaded.
+ */
+
+#ifndef _ASTERISK_ORIGINATE_H
+#define _ASTERISK_ORIGINATE_H
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/*!
+ * \brief Queue a call to be originated by the executor
+ * \since 18.0.0
+ *
+ * \param destination The Tech/data dialed, which the calls per second are limited by
+ * \param task Dials the call, and owns the data once it is called
+ * \param data Passed to the task
+ *
+ * \retval 0 on success, the task will be called
+ * \retval -1 if the call is refused, the caller still owns the data
+ */
+int ast_originate_push(const char *destination, void (*task)(void *data), void *data);
+
+/*!
+ * \brief Note that the call originated by the current task was answered
+ * \since 18.0.0
+ *
+ * \details The time from the start of the task is recorded as the time to
+ * answer. Does nothing outside of a task of the executor.
+ */
+void ast_originate_answered(void);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_ORIGINATE_H */
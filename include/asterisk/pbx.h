@@ -125,6 +125,7 @@ struct ast_custom_function {
 		AST_STRING_FIELD(seealso);      /*!< See also */
 	);
 	enum ast_doc_src docsrc;		/*!< Where the documentation come from */
+	unsigned int docs_loaded:1;		/*!< Whether the XML documentation was looked up */
 	/*! Read function, if read is supported */
 	ast_acf_read_fn_t read;		/*!< Read function, if read is supported */
 	/*! Read function, if read is supported.  Note: only one of read or read2
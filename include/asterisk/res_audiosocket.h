@@ -36,6 +36,9 @@ extern "C" {
 #include "asterisk/frame.h"
 #include "asterisk/uuid.h"
 
+/*! \brief The most frames ast_audiosocket_send_frames() sends at once */
+#define AST_AUDIOSOCKET_MAX_FRAMES 64
+
 /*!
  * \brief Send the initial message to an AudioSocket server
  *
@@ -71,6 +74,22 @@ const int ast_audiosocket_init(const int svc, const char *id);
  */
 const int ast_audiosocket_send_frame(const int svc, const struct ast_frame *f);
 
+/*!
+ * \brief Send several Asterisk audio frames to an AudioSocket server at once
+ * \since 18.0.0
+ *
+ * \param svc The file descriptor of the network socket to the AudioSocket server.
+ * \param frames The Asterisk audio frames to send, in order.
+ * \param count The number of frames, at most \ref AST_AUDIOSOCKET_MAX_FRAMES.
+ *
+ * Each frame is still its own packet, but all the packets are given to the
+ * socket in a single write.
+ *
+ * \retval 0 on success
+ * \retval -1 on error
+ */
+const int ast_audiosocket_send_frames(const int svc, struct ast_frame * const *frames, int count);
+
 /*!
  * \brief Receive an Asterisk frame from an AudioSocket server
  *
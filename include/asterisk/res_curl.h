@@ -0,0 +1,62 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief cURL resource engine
+ */
+
+#ifndef _ASTERISK_RES_CURL_H
+#define _ASTERISK_RES_CURL_H
+
+#include <curl/curl.h>
+
+/*!
+ * \brief Share the DNS, TLS session and connection caches of res_curl
+ * \since 18.0.0
+ *
+ * Transfers made by any handle sharing the caches may reuse a connection
+ * opened by another one, rather than each thread keeping its own.
+ *
+ * \param curl The easy handle to share the caches with
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, the handle keeps its own caches
+ */
+int ast_curl_share(CURL *curl);
+
+/*!
+ * \brief Wait until fewer than a number of transfers are made to the host of a URL
+ * \since 18.0.0
+ *
+ * \param url The URL about to be transferred
+ * \param limit How many transfers may be made to the host at once
+ * \param timeout_ms How long to wait, in milliseconds
+ *
+ * \retval 0 on success, the transfer is counted until ast_curl_host_release
+ * \retval -1 if the wait timed out or the URL has no host
+ */
+int ast_curl_host_acquire(const char *url, unsigned int limit, int timeout_ms);
+
+/*!
+ * \brief Stop counting a transfer counted by ast_curl_host_acquire
+ * \since 18.0.0
+ *
+ * \param url The URL that was transferred
+ */
+void ast_curl_host_release(const char *url);
+
+#endif /* _ASTERISK_RES_CURL_H */
@@ -42,6 +42,8 @@ enum {
 	RES_ODBC_CONNECTED = (1 << 2),
 };
 
+struct odbc_statement;
+
 /*! \brief ODBC container */
 struct odbc_obj {
 	SQLHDBC  con;                   /*!< ODBC Connection Handle */
@@ -52,6 +54,8 @@ struct odbc_obj {
 	int lineno;
 #endif
 	char *sql_text;					/*!< The SQL text currently executing */
+	AST_LIST_HEAD_NOLOCK(, odbc_statement) statements;	/*!< Cached prepared statements, most recently used first */
+	unsigned int statement_cnt;			/*!< The number of cached prepared statements */
 	AST_LIST_ENTRY(odbc_obj) list;
 };
 
@@ -170,6 +174,37 @@ SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_c
  */
 int ast_odbc_prepare(struct odbc_obj *obj, SQLHSTMT *stmt, const char *sql);
 
+/*!
+ * \brief Get a statement prepared with a SQL query, reusing one the connection prepared before
+ * \since 18.0.0
+ *
+ * Each connection keeps the statements prepared with this, up to the
+ * statement_cache_size of its class, so executing the same SQL text with
+ * parameters bound again does not prepare it again.
+ *
+ * \param obj The ODBC object
+ * \param sql The SQL query
+ *
+ * \retval a prepared statement handle, without parameters bound
+ * \retval NULL on error
+ *
+ * \note The statement must be given back with ast_odbc_release_statement(), never freed
+ * with SQLFreeHandle.
+ */
+SQLHSTMT ast_odbc_prepare_cached(struct odbc_obj *obj, const char *sql);
+
+/*!
+ * \brief Release a statement once its results are no longer needed
+ * \since 18.0.0
+ *
+ * A statement from ast_odbc_prepare_cached() has its cursor closed and
+ * parameters reset and is kept for reuse, any other statement is freed.
+ *
+ * \param obj The ODBC object the statement was allocated on
+ * \param stmt The statement
+ */
+void ast_odbc_release_statement(struct odbc_obj *obj, SQLHSTMT stmt);
+
 /*! \brief Execute a nonprepared SQL query.
  * \param obj The ODBC object
  * \param sql The SQL query
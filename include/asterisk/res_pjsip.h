@@ -141,6 +141,17 @@ struct ast_sip_transport_state {
 	 * \since 17.0.0
 	 */
 	struct ast_sip_service_route_vector *service_routes;
+	/*!
+	 * The transports of the additional sockets receiving on the same
+	 * address, when the UDP transport has more than one
+	 * \since 18.0.0
+	 */
+	pjsip_transport **receivers;
+	/*!
+	 * The number of additional receiving transports
+	 * \since 18.0.0
+	 */
+	unsigned int receivers_count;
 };
 
 #define ast_sip_transport_is_nonlocal(transport_state, addr) \
@@ -233,8 +244,29 @@ struct ast_sip_transport {
 	int symmetric_transport;
 	/*! This is a flow to another target */
 	int flow;
+	/*! Number of sockets receiving on the address of a UDP transport */
+	unsigned int udp_sockets;
 };
 
+/*! The most sockets a UDP transport can receive on */
+#define AST_SIP_TRANSPORT_MAX_UDP_SOCKETS 32
+
+/*!
+ * \brief Determine if a pjsip transport belongs to a transport state
+ * \since 18.0.0
+ *
+ * A UDP transport receiving on several sockets has a pjsip transport for
+ * each of them.
+ *
+ * \param transport_state The transport state
+ * \param transport The pjsip transport
+ *
+ * \retval 0 if the transport does not belong to the transport state
+ * \retval non-zero if it does
+ */
+int ast_sip_transport_state_has_transport(const struct ast_sip_transport_state *transport_state,
+	const pjsip_transport *transport);
+
 #define SIP_SORCERY_DOMAIN_ALIAS_TYPE "domain_alias"
 
 /*!
@@ -750,6 +782,8 @@ struct ast_sip_endpoint_media_configuration {
 	unsigned int bundle;
 	/*! Enable webrtc settings and defaults */
 	unsigned int webrtc;
+	/*! Publish the RTCP reports sent and received to stasis */
+	unsigned int rtcp_publish;
 };
 
 /*!
@@ -1549,6 +1583,25 @@ struct ast_taskprocessor *ast_sip_create_serializer_group(const char *name, stru
  */
 struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdata);
 
+/*!
+ * \brief Find a header of an incoming message by name
+ * \since 18.0.0
+ *
+ * The distributor indexes the headers of each incoming message before
+ * handing it to a serializer, so this does not search through the headers
+ * as pjsip_msg_find_hdr_by_name() does.  Messages which were not indexed
+ * are searched instead.
+ *
+ * \param rdata The incoming message
+ * \param name The case-insensitive name of the header
+ * \param prev The header returned by the previous call to find the next
+ * header of the same name, or NULL to find the first
+ *
+ * \retval NULL if there is no (further) header of the name
+ * \retval The header
+ */
+pjsip_hdr *ast_sip_rdata_find_header(pjsip_rx_data *rdata, const pj_str_t *name, pjsip_hdr *prev);
+
 /*!
  * \brief Set a serializer on a SIP dialog so requests and responses are automatically serialized
  *
@@ -2795,6 +2848,15 @@ unsigned int ast_sip_get_use_callerid_contact(void);
  */
 unsigned int ast_sip_get_norefersub(void);
 
+/*!
+ * \brief Retrieve the global setting 'notification_coalesce_interval'.
+ * \since 18.0.0
+ *
+ * \return The least time (in milliseconds) between the NOTIFYs of a
+ * subscription not to a resource list, 0 if they are not coalesced
+ */
+unsigned int ast_sip_get_notification_coalesce_interval(void);
+
 /*!
  * \brief Retrieve the global setting 'ignore_uri_user_options'.
  * \since 13.12.0
@@ -3122,6 +3184,15 @@ void ast_sip_modify_id_header(pj_pool_t *pool, pjsip_fromto_hdr *id_hdr,
 void ast_sip_get_unidentified_request_thresholds(unsigned int *count, unsigned int *period,
 	unsigned int *prune_interval);
 
+/*!
+ * \brief Retrieve the global setting 'unidentified_request_reject'
+ * \since 18.0.0
+ *
+ * \retval non zero if requests from a source over the unidentified request
+ * rate are dropped before identifying their endpoint
+ */
+unsigned int ast_sip_get_unidentified_request_reject(void);
+
 /*!
  * \brief Get the transport name from an endpoint or request uri
  * \since 13.15.0
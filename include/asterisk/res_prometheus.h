@@ -71,6 +71,10 @@ struct prometheus_general_config {
 	unsigned int enabled;
 	/*! \brief Whether or not core metrics are enabled */
 	unsigned int core_metrics_enabled;
+	/*! \brief Whether or not metrics of each channel are enabled */
+	unsigned int channel_metrics_enabled;
+	/*! \brief Seconds the metrics of each channel are reused between scrapes */
+	unsigned int channel_metrics_interval;
 	AST_DECLARE_STRING_FIELDS(
 		/*! \brief The HTTP URI we register ourselves to */
 		AST_STRING_FIELD(uri);
@@ -50,6 +50,19 @@ struct ast_srtp_res {
 	int (*protect)(struct ast_srtp *srtp, void **buf, int *size, int rtcp);
 	/* Obtain a random cryptographic key */
 	int (*get_random)(unsigned char *key, size_t len);
+	/*!
+	 * \brief Protect RTP data within the buffer holding it
+	 * \since 18.0.0
+	 *
+	 * \details Unlike protect, which copies the data into a buffer of the
+	 * session, the data and authentication tag are written in place so a
+	 * caller can keep its packets together, e.g. to send them at once.
+	 *
+	 * \param capacity Size of the buffer, including the room behind the data
+	 *
+	 * \retval -1 with errno set to ENOBUFS if there is no room for the tag
+	 */
+	int (*protect_in_place)(struct ast_srtp *srtp, void *buf, int *size, size_t capacity, int rtcp);
 };
 
 /* Crypto suites */
@@ -128,6 +128,11 @@ enum ast_rtp_property {
 	AST_RTP_PROPERTY_RETRANS_SEND,
 	/*! Enable REMB sending and receiving passthrough support */
 	AST_RTP_PROPERTY_REMB,
+	/*!
+	 * \brief Do not publish the RTCP reports sent and received to stasis
+	 * \since 18.0.0
+	 */
+	AST_RTP_PROPERTY_RTCP_NO_PUBLISH,
 
 	/*!
 	 * \brief Maximum number of RTP properties supported
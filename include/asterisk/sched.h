@@ -152,10 +152,40 @@ extern "C" {
 /*!
  * \brief Create a scheduler context
  *
+ * The context keeps its scheduled entries in a binary heap.
+ *
  * \return Returns a malloc'd sched_context structure, NULL on failure
  */
 struct ast_sched_context *ast_sched_context_create(void);
 
+/*!
+ * \brief Ways a scheduler context can keep its scheduled entries
+ * \since 18.0.0
+ */
+enum ast_sched_backend {
+	/*! Binary heap.  Adding an entry is O(log n). */
+	AST_SCHED_BACKEND_HEAP = 0,
+	/*!
+	 * Hierarchical timing wheel with millisecond resolution.  Adding and
+	 * deleting an entry is O(1), which suits contexts holding many
+	 * thousands of timers such as retransmission and RTCP timers.
+	 */
+	AST_SCHED_BACKEND_WHEEL,
+};
+
+/*!
+ * \brief Create a scheduler context using a specific backend
+ * \since 18.0.0
+ *
+ * The backend only affects performance.  Entries are executed in the same
+ * order whichever backend is used.
+ *
+ * \param backend How to keep the scheduled entries
+ *
+ * \return Returns a malloc'd sched_context structure, NULL on failure
+ */
+struct ast_sched_context *ast_sched_context_create_backend(enum ast_sched_backend backend);
+
 /*!
  * \brief destroys a schedule context
  *
@@ -30,14 +30,14 @@
 extern "C" {
 #endif
 
-#define AST_SLINFACTORY_MAX_HOLD 1280
+/*! \brief Most samples a slinfactory holds, the oldest are dropped past it */
+#define AST_SLINFACTORY_MAX_SAMPLES 65536
 
 struct ast_slinfactory {
-	AST_LIST_HEAD_NOLOCK(, ast_frame) queue; /*!< A list of unaltered frames */
 	struct ast_trans_pvt *trans;             /*!< Translation path that converts fed frames into signed linear */
-	short hold[AST_SLINFACTORY_MAX_HOLD];    /*!< Hold for audio that no longer belongs to a frame (ie: if only some samples were taken from a frame) */
-	short *offset;                           /*!< Offset into the hold where audio begins */
-	size_t holdlen;                          /*!< Number of samples currently in the hold */
+	short *ring;                             /*!< Ring of the samples in the factory, grown as needed */
+	unsigned int ring_size;                  /*!< Number of samples the ring holds, a power of two */
+	unsigned int head;                       /*!< Index into the ring where audio begins */
 	unsigned int size;                       /*!< Number of samples currently in the factory */
 	struct ast_format *format;               /*!< Current format the translation path is converting from */
 	struct ast_format *output_format;        /*!< The output format desired */
@@ -81,7 +81,9 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf);
  * \param sf The slinfactory to feed into
  * \param f Frame containing audio to feed in
  *
- * \return Number of frames currently in factory
+ * The audio is copied into the factory, which does not keep the frame.
+ *
+ * \return Number of samples fed in
  */
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f);
 
@@ -323,6 +323,21 @@ struct ast_sorcery_wizard {
 
 	/* \brief Callback for whether or not the wizard believes the object is stale */
 	int (*is_stale)(const struct ast_sorcery *sorcery, void *data, void *object);
+
+	/*!
+	 * \brief Optional callback for whether a caching wizard knows an object does not exist
+	 * \since 18.0.0
+	 *
+	 * Invoked when the caching wizard did not return the object from retrieve_id. A
+	 * non-zero return stops the retrieval without asking the remaining wizards.
+	 */
+	int (*is_missing)(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
+
+	/*!
+	 * \brief Optional callback informing a caching wizard an object was not retrieved by id
+	 * \since 18.0.0
+	 */
+	void (*retrieve_id_missed)(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
 };
 
 /*! \brief Interface for a sorcery object type observer */
@@ -1037,6 +1052,36 @@ int __ast_sorcery_object_field_register(struct ast_sorcery *sorcery, const char
 #define ast_sorcery_object_field_register_custom_nodoc(sorcery, type, name, default_val, config_handler, sorcery_handler, multiple_handler, flags, ...) \
     __ast_sorcery_object_field_register(sorcery, type, name, default_val, OPT_CUSTOM_T, config_handler, sorcery_handler, multiple_handler, flags, 1, 0, VA_NARGS(__VA_ARGS__), __VA_ARGS__);
 
+/*!
+ * \brief Declare that objects are commonly retrieved by the value of a field
+ * \since 18.0.0
+ *
+ * Caching wizards may keep an index of the objects by the value of an indexed
+ * field, updated as objects are cached and removed, so retrieving objects by
+ * the field does not compare every cached object.
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param type Type of object
+ * \param name Name of a registered field
+ *
+ * \retval 0 success
+ * \retval -1 if the type or field is unknown
+ */
+int ast_sorcery_object_field_index(struct ast_sorcery *sorcery, const char *type, const char *name);
+
+/*!
+ * \brief Determine if a field of an object type is indexed
+ * \since 18.0.0
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param type Type of object
+ * \param name Name of the field
+ *
+ * \retval 1 if the field was declared with ast_sorcery_object_field_index
+ * \retval 0 if not
+ */
+int ast_sorcery_object_field_is_indexed(const struct ast_sorcery *sorcery, const char *type, const char *name);
+
 /*!
  * \brief Inform any wizards to load persistent objects
  *
@@ -1109,6 +1154,52 @@ struct ast_variable *ast_sorcery_objectset_create2(const struct ast_sorcery *sor
 #define ast_sorcery_objectset_create(sorcery, object) \
 	ast_sorcery_objectset_create2(sorcery, object, AST_HANDLER_PREFER_LIST)
 
+/*!
+ * \brief Opaque structure comparing objects against requested fields
+ * \since 18.0.0
+ */
+struct ast_sorcery_fields_matcher;
+
+/*!
+ * \brief Create a matcher comparing objects against requested fields
+ * \since 18.0.0
+ *
+ * The fields are resolved to the handlers of the object type once, so each
+ * comparison converts only the requested fields of an object rather than
+ * creating its whole object set.
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param type Type of the objects to compare
+ * \param fields The requested fields, as given to ast_sorcery_retrieve_by_fields
+ *
+ * \retval non-NULL success
+ * \retval NULL if the type is unknown or an error occurred
+ *
+ * \note The fields and sorcery structure must outlive the matcher.
+ */
+struct ast_sorcery_fields_matcher *ast_sorcery_fields_matcher_create(const struct ast_sorcery *sorcery,
+	const char *type, const struct ast_variable *fields);
+
+/*!
+ * \brief Compare an object against the fields of a matcher
+ * \since 18.0.0
+ *
+ * \param matcher The matcher
+ * \param object Pointer to a sorcery object of the matcher's type
+ *
+ * \retval 1 if the object matches, as ast_variable_lists_match would for its object set
+ * \retval 0 if it does not
+ */
+int ast_sorcery_fields_matcher_match(const struct ast_sorcery_fields_matcher *matcher, const void *object);
+
+/*!
+ * \brief Destroy a fields matcher
+ * \since 18.0.0
+ *
+ * \param matcher The matcher, may be NULL
+ */
+void ast_sorcery_fields_matcher_destroy(struct ast_sorcery_fields_matcher *matcher);
+
 /*!
  * \brief Create an object set in JSON format for an object
  *
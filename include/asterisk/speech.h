@@ -67,6 +67,12 @@ struct ast_speech {
 	enum ast_speech_results_type results_type;
 	/*! Pointer to the engine used by this speech structure */
 	struct ast_speech_engine *engine;
+	/*! Audio gathered to be written to the engine at once */
+	unsigned char *batch;
+	/*! Bytes of audio gathered */
+	size_t batch_len;
+	/*! Bytes of audio to gather before writing them, 0 to write each frame */
+	size_t batch_size;
 };
 
 /* Speech recognition engine structure */
@@ -102,6 +108,8 @@ struct ast_speech_engine {
 	/*! Accepted formats by the engine */
 	struct ast_format_cap *formats;
 	AST_LIST_ENTRY(ast_speech_engine) list;
+	/*! Milliseconds of audio to gather before each write, 0 to write each frame */
+	unsigned int write_batch_ms;
 };
 
 /* Result structure */
@@ -138,6 +146,21 @@ struct ast_speech *ast_speech_new(const char *engine_name, const struct ast_form
 int ast_speech_destroy(struct ast_speech *speech);
 /*! \brief Write audio to the speech engine */
 int ast_speech_write(struct ast_speech *speech, void *data, int len);
+/*!
+ * \brief Gather audio written to the speech engine, to write it at once
+ * \since 18.0.0
+ *
+ * \param speech The speech structure
+ * \param ms Milliseconds of audio to gather, 0 to write each frame as it comes
+ *
+ * Engines which send audio elsewhere, such as to a recognizer over the network,
+ * are written to less often. Gathered audio is written before DTMF is signalled,
+ * and dropped when recognition is started again.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int ast_speech_write_batch(struct ast_speech *speech, unsigned int ms);
 /*! \brief Signal to the engine that DTMF was received */
 int ast_speech_dtmf(struct ast_speech *speech, const char *dtmf);
 /*! \brief Change an engine specific attribute */
@@ -454,6 +454,11 @@ const struct timeval *stasis_message_timestamp(const struct stasis_message *msg)
  * May return \c NULL, to indicate no representation. The returned object should
  * be ast_json_unref()'ed.
  *
+ * The representation is built once per message and shared by every caller
+ * using the same \a sanitize.  Each caller gets its own copy of the top level
+ * object, to which it may add members, but nested values are shared and must
+ * not be modified.
+ *
  * \param msg Message to convert to JSON string.
  * \param sanitize Snapshot sanitization callback.
  *
@@ -469,6 +474,8 @@ struct ast_json *stasis_message_to_json(struct stasis_message *msg, struct stasi
  * May return \c NULL, to indicate no representation. The returned object should
  * be ao2_cleanup()'ed.
  *
+ * The representation is built once per message and shared by every caller.
+ *
  * \param msg Message to convert to AMI.
  * \return \c NULL on error.
  * \return \c NULL if AMI format is not supported.
@@ -491,6 +498,8 @@ int stasis_message_can_be_ami(struct stasis_message *msg);
  * May return \c NULL, to indicate no representation. The returned object should
  * be disposed of via \ref ast_event_destroy.
  *
+ * The representation is built once per message, each caller gets a copy.
+ *
  * \param msg Message to convert to AMI.
  * \return \c NULL on error.
  * \return \c NULL if AMI format is not supported.
@@ -881,6 +890,91 @@ int stasis_subscription_is_subscribed(const struct stasis_subscription *sub);
  */
 int stasis_subscription_final_message(struct stasis_subscription *sub, struct stasis_message *msg);
 
+/*!
+ * \brief Number of buckets in the dispatch latency histogram of a subscription
+ *
+ * The last bucket holds everything above the highest bound.
+ */
+#define STASIS_LATENCY_BUCKETS 6
+
+/*!
+ * \brief Upper bounds of the dispatch latency histogram buckets, in microseconds
+ */
+extern const long stasis_latency_bounds[STASIS_LATENCY_BUCKETS - 1];
+
+/*!
+ * \brief Sample the latency of one message out of this many
+ */
+#define STASIS_LATENCY_SAMPLE_RATE 16
+
+/*!
+ * \brief Production metrics of a topic
+ * \since 18.0.0
+ */
+struct stasis_topic_metrics {
+	/*! Name of the topic */
+	const char *name;
+	/*! Messages published or forwarded to the topic */
+	uint64_t published;
+	/*! Subscriptions made to the topic itself */
+	size_t subscriptions;
+};
+
+/*!
+ * \brief Production metrics of a subscription
+ *
+ * The latency of a message is the time from its creation until the
+ * subscriber callback returns.  It is sampled on one message out of
+ * every \c STASIS_LATENCY_SAMPLE_RATE messages dispatched.
+ *
+ * \since 18.0.0
+ */
+struct stasis_subscription_metrics {
+	/*! Unique ID of the subscription */
+	const char *uniqueid;
+	/*! Name of the topic subscribed to */
+	const char *topic;
+	/*! Messages dispatched to the subscriber */
+	uint64_t dispatched;
+	/*! Messages waiting in the mailbox of the subscriber */
+	long queued;
+	/*! Latency samples taken */
+	uint64_t samples;
+	/*! Sum of the latency samples, in microseconds */
+	long long latency_sum;
+	/*! Latency samples in each bucket, not cumulative */
+	uint64_t latency_buckets[STASIS_LATENCY_BUCKETS];
+};
+
+/*!
+ * \brief Callback for a topic with subscriptions of its own
+ */
+typedef void (*stasis_topic_metrics_cb)(const struct stasis_topic_metrics *metrics, void *data);
+
+/*!
+ * \brief Callback for a subscription
+ */
+typedef void (*stasis_subscription_metrics_cb)(const struct stasis_subscription_metrics *metrics, void *data);
+
+/*!
+ * \brief Collect the production metrics of topics and subscriptions
+ *
+ * Only topics with subscriptions of their own are reported.  Topics which
+ * are only forwarded into other topics, such as the topic of each channel,
+ * are left out.  Each subscription is reported once, right after its topic.
+ *
+ * \note The callbacks are invoked with the topic locked, so they must not
+ * call back into stasis.
+ *
+ * \param topic_cb Invoked for each topic
+ * \param subscription_cb Invoked for each subscription
+ * \param data Passed to the callbacks
+ *
+ * \since 18.0.0
+ */
+void stasis_metrics_collect(stasis_topic_metrics_cb topic_cb,
+	stasis_subscription_metrics_cb subscription_cb, void *data);
+
 /*! \addtogroup StasisTopicsAndMessages
  * @{
  */
@@ -1007,7 +1007,7 @@ struct ast_json *stasis_app_event_filter_to_json(struct stasis_app *app, struct
  * \brief Set the application's event type filter
  *
  * \param app The application
- * \param filter The allowed and/or disallowed event filter
+ * \param filter The allowed and/or disallowed event filter, and the event fields
  *
  * \return 0 if successfully set
  */
@@ -1028,6 +1028,23 @@ int stasis_app_event_filter_set(struct stasis_app *app, struct ast_json *filter)
  */
 int stasis_app_event_allowed(const char *app_name, struct ast_json *event);
 
+/*!
+ * \brief Trim the objects of an event down to the application's event fields.
+ *
+ * Each member of the event named in the application's "fields" filter keeps
+ * only the listed fields. Other members are passed along unchanged.
+ *
+ * \param app_name The application name
+ * \param event The event to project
+ *
+ * \return The event itself (with a new reference) if the application projects
+ *         nothing, otherwise a projected copy
+ * \retval NULL on error
+ *
+ * \since 18.0.0
+ */
+struct ast_json *stasis_app_event_project(const char *app_name, struct ast_json *event);
+
 /*! @} */
 
 #endif /* _ASTERISK_STASIS_APP_H */
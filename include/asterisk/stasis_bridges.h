@@ -227,6 +227,23 @@ void ast_bridge_publish_leave(struct ast_bridge *bridge, struct ast_channel *cha
 struct ast_json *ast_bridge_snapshot_to_json(const struct ast_bridge_snapshot *snapshot,
 	const struct stasis_message_sanitizer *sanitize);
 
+/*!
+ * \brief Encode a \ref ast_bridge_snapshot with a streaming JSON writer.
+ * \since 18.0.0
+ *
+ * Writes the same object ast_bridge_snapshot_to_json() builds, without
+ * building it.
+ *
+ * \param snapshot The bridge snapshot to encode
+ * \param sanitize The message sanitizer to use on the snapshot
+ * \param writer The writer, positioned where a value may be written
+ *
+ * \retval 0 on success
+ * \retval -1 on error
+ */
+int ast_bridge_snapshot_to_json_writer(const struct ast_bridge_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize, struct ast_json_writer *writer);
+
 /*!
  * \brief Pair showing a bridge snapshot and a specific channel snapshot belonging to the bridge
  */
@@ -680,6 +680,23 @@ void ast_channel_publish_dial_forward(struct ast_channel *caller,
 struct ast_json *ast_channel_snapshot_to_json(const struct ast_channel_snapshot *snapshot,
 	const struct stasis_message_sanitizer *sanitize);
 
+/*!
+ * \brief Encode a \ref ast_channel_snapshot with a streaming JSON writer.
+ * \since 18.0.0
+ *
+ * Writes the same object ast_channel_snapshot_to_json() builds, without
+ * building it.
+ *
+ * \param snapshot The snapshot to encode
+ * \param sanitize The message sanitizer to use on the snapshot
+ * \param writer The writer, positioned where a value may be written
+ *
+ * \retval 0 on success
+ * \retval -1 on error, or if nothing was written as the snapshot is sanitized away
+ */
+int ast_channel_snapshot_to_json_writer(const struct ast_channel_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize, struct ast_json_writer *writer);
+
 /*!
  * \brief Compares the context, exten and priority of two snapshots.
  * \since 12
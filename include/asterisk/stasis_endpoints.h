@@ -135,6 +135,9 @@ struct stasis_message_type *ast_endpoint_snapshot_type(void);
  * \return Snapshot of the endpoint.
  * \return \c NULL on error.
  * \since 12
+ *
+ * The snapshot is kept by the endpoint and shared until the endpoint
+ * changes, so it must not be modified.
  */
 struct ast_endpoint_snapshot *ast_endpoint_snapshot_create(
 	struct ast_endpoint *endpoint);
@@ -116,6 +116,18 @@ struct ast_taskprocessor_listener_callbacks {
 	 */
 	void (*shutdown)(struct ast_taskprocessor_listener *listener);
 	void (*dtor)(struct ast_taskprocessor_listener *listener);
+	/*!
+	 * \brief Indicates a batch of tasks was pushed to the processor
+	 * \since 18.0.0
+	 *
+	 * This is optional. If not provided, task_pushed is called once
+	 * for each task in the batch.
+	 *
+	 * \param listener The listener
+	 * \param was_empty If non-zero, the taskprocessor was empty prior to the tasks being pushed
+	 * \param count The number of tasks that were pushed
+	 */
+	void (*task_batch_pushed)(struct ast_taskprocessor_listener *listener, int was_empty, size_t count);
 };
 
 /*!
@@ -151,6 +163,25 @@ void *ast_taskprocessor_listener_get_user_data(const struct ast_taskprocessor_li
  */
 struct ast_taskprocessor_listener *ast_taskprocessor_listener_alloc(const struct ast_taskprocessor_listener_callbacks *callbacks, void *user_data);
 
+/*!
+ * \brief Mark a listener as the only consumer of its taskprocessor's tasks
+ * \since 18.0.0
+ *
+ * A listener that never calls ast_taskprocessor_execute() from more than one
+ * thread at a time can have its taskprocessor use a lock-free
+ * multi-producer/single-consumer task queue. Pushing a task into such a
+ * taskprocessor does not take the taskprocessor lock.
+ *
+ * Taskprocessors created with ast_taskprocessor_get() and threadpool
+ * serializers already use the lock-free queue.
+ *
+ * \note This must be called before the listener is used to create a
+ * taskprocessor.
+ *
+ * \param listener The taskprocessor listener
+ */
+void ast_taskprocessor_listener_set_single_consumer(struct ast_taskprocessor_listener *listener);
+
 /*!
  * \brief Get a reference to a taskprocessor with the specified name and create the taskprocessor if necessary
  *
@@ -216,6 +247,35 @@ void *ast_taskprocessor_unreference(struct ast_taskprocessor *tps);
 int ast_taskprocessor_push(struct ast_taskprocessor *tps, int (*task_exe)(void *datap), void *datap)
 	attribute_warn_unused_result;
 
+/*!
+ * \brief A task to be pushed with ast_taskprocessor_push_batch()
+ * \since 18.0.0
+ */
+struct ast_taskprocessor_task {
+	/*! The task handling function */
+	int (*task_exe)(void *datap);
+	/*! The data to be used by the task handling function */
+	void *datap;
+};
+
+/*!
+ * \brief Push several tasks into the specified taskprocessor queue at once
+ * \since 18.0.0
+ *
+ * The tasks are queued in array order using a single allocation, and
+ * the taskprocessor's listener is notified once for the whole batch.
+ * Either all of the tasks are queued or none of them are.
+ *
+ * \param tps The taskprocessor structure
+ * \param tasks The tasks to push into the taskprocessor queue
+ * \param count The number of tasks in the array
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_taskprocessor_push_batch(struct ast_taskprocessor *tps,
+	const struct ast_taskprocessor_task *tasks, size_t count)
+	attribute_warn_unused_result;
+
 /*! \brief Local data parameter */
 struct ast_taskprocessor_local {
 	/*! Local data, associated with the taskprocessor. */
@@ -341,6 +401,52 @@ const char *ast_taskprocessor_name(struct ast_taskprocessor *tps);
  */
 long ast_taskprocessor_size(struct ast_taskprocessor *tps);
 
+/*!
+ * \brief Number of buckets in the execution and queue wait time histograms
+ *
+ * Bucket i counts the tasks that took at most 2^i microseconds and more
+ * than the previous bucket.  The last bucket counts the tasks that took
+ * longer than 2^(AST_TASKPROCESSOR_HISTOGRAM_BUCKETS - 2) microseconds.
+ */
+#define AST_TASKPROCESSOR_HISTOGRAM_BUCKETS 24
+
+/*!
+ * \brief Statistics of a taskprocessor
+ * \since 18.0.0
+ */
+struct ast_taskprocessor_metrics {
+	/*! Name of the taskprocessor */
+	const char *name;
+	/*! Tasks executed */
+	unsigned long processed;
+	/*! Tasks currently queued */
+	long queued;
+	/*! Most tasks queued at once */
+	unsigned long max_queued;
+	/*! Tasks by execution time, not cumulative */
+	uint64_t execution[AST_TASKPROCESSOR_HISTOGRAM_BUCKETS];
+	/*! Tasks by time spent queued before executing, not cumulative */
+	uint64_t wait[AST_TASKPROCESSOR_HISTOGRAM_BUCKETS];
+	/*! Total execution time, in microseconds */
+	int64_t execution_sum;
+	/*! Total time spent queued, in microseconds */
+	int64_t wait_sum;
+};
+
+/*!
+ * \brief Callback for the statistics of a taskprocessor
+ */
+typedef void (*ast_taskprocessor_metrics_cb)(const struct ast_taskprocessor_metrics *metrics, void *data);
+
+/*!
+ * \brief Collect the statistics of every taskprocessor
+ * \since 18.0.0
+ *
+ * \param callback Invoked for each taskprocessor
+ * \param data Passed to the callback
+ */
+void ast_taskprocessor_metrics_collect(ast_taskprocessor_metrics_cb callback, void *data);
+
 /*!
  * \brief Get the current taskprocessor high water alert count.
  * \since 13.10.0
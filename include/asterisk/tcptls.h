@@ -82,6 +82,10 @@ enum ast_ssl_flags {
 	AST_SSL_DISABLE_TLSV11 = (1 << 8),
 	/*! Disable TLSv1.2 support */
 	AST_SSL_DISABLE_TLSV12 = (1 << 9),
+	/*! Don't issue session tickets when acting as server */
+	AST_SSL_DISABLE_TICKETS = (1 << 10),
+	/*! Let the kernel encrypt and decrypt records once the handshake is done */
+	AST_SSL_KTLS = (1 << 11),
 };
 
 struct ast_tls_config {
@@ -96,6 +100,29 @@ struct ast_tls_config {
 	char certhash[41];
 	char pvthash[41];
 	char cahash[41];
+	/*! Sessions kept for resumption when acting as server, 0 for the OpenSSL default */
+	unsigned int session_cache_size;
+	/*! Seconds a session may be resumed for, 0 for the OpenSSL default */
+	unsigned int session_timeout;
+	/*! Seconds before the session ticket key is replaced, 0 to keep it until reload */
+	unsigned int ticket_key_lifetime;
+};
+
+/*!
+ * \brief Counts and durations of the TLS handshakes made
+ * \since 18.0.0
+ */
+struct ast_tls_handshake_stats {
+	/*! Handshakes that established a new session */
+	unsigned long full;
+	/*! Handshakes that resumed a session */
+	unsigned long resumed;
+	/*! Handshakes that failed */
+	unsigned long failed;
+	/*! Time spent in handshakes that established a new session, in microseconds */
+	uint64_t full_us;
+	/*! Time spent in handshakes that resumed a session, in microseconds */
+	uint64_t resumed_us;
 };
 
 /*! \page AstTlsOverview TLS Implementation Overview
@@ -212,6 +239,14 @@ int ast_ssl_setup(struct ast_tls_config *cfg);
  */
 void ast_ssl_teardown(struct ast_tls_config *cfg);
 
+/*!
+ * \brief Get the counts and durations of the TLS handshakes made so far
+ * \since 18.0.0
+ *
+ * \param stats Filled in with the counts and durations
+ */
+void ast_tls_get_handshake_stats(struct ast_tls_handshake_stats *stats);
+
 /*!
  * \brief Used to parse conf files containing tls/ssl options.
  */
@@ -112,6 +112,42 @@
    'test generate results xml' will generate a test report in xml format
    'test generate results txt' will generate a test report in txt format
 \endcode
+
+\section BenchAPIUsage How to Use the Benchmark API
+
+   A benchmark is defined with the AST_BENCH_DEFINE macro, and registered
+   and unregistered with AST_BENCH_REGISTER and AST_BENCH_UNREGISTER, as a
+   test is. Its callback is given the same info, cmd and bench arguments.
+
+\code
+   AST_BENCH_DEFINE(sample_bench_cb)
+   {
+      switch (cmd) {
+      case BENCH_INIT:
+          info->name = "sample_bench";
+          info->category = "/main/bench/";
+          info->summary = "sample benchmark for example purpose";
+          info->description = "This demonstrates how to initialize a benchmark";
+          info->operations = 1000;    \ operations done by every BENCH_RUN
+          return 0;
+      case BENCH_SETUP:               \ make what BENCH_RUN uses, with ast_bench_set_data()
+          return 0;
+      case BENCH_RUN:                 \ timed, info->warmup times and then info->iterations times
+          return 0;
+      case BENCH_CLEANUP:             \ free what BENCH_SETUP made
+          return 0;
+      }
+      return 0;
+   }
+\endcode
+
+   CLI Examples:
+\code
+   'test bench show registered all'      will show every registered benchmark.
+   'test bench run all'                  will run every registered benchmark.
+   'test bench generate results json'    will write the last results as JSON
+   'test bench generate results junit'   will write the last results as JUnit XML
+\endcode
 */
 
 /*! Macros used for defining and registering a test */
@@ -121,11 +157,18 @@
 #define AST_TEST_REGISTER(cb) ast_test_register(cb)
 #define AST_TEST_UNREGISTER(cb) ast_test_unregister(cb)
 
+#define AST_BENCH_DEFINE(hdr) static int hdr(struct ast_bench_info *info, enum ast_bench_command cmd, struct ast_bench *bench)
+#define AST_BENCH_REGISTER(cb) ast_bench_register(cb)
+#define AST_BENCH_UNREGISTER(cb) ast_bench_unregister(cb)
+
 #else
 
 #define AST_TEST_DEFINE(hdr) static enum ast_test_result_state attribute_unused hdr(struct ast_test_info *info, enum ast_test_command cmd, struct ast_test *test)
 #define AST_TEST_REGISTER(cb)
 #define AST_TEST_UNREGISTER(cb)
+#define AST_BENCH_DEFINE(hdr) static int attribute_unused hdr(struct ast_bench_info *info, enum ast_bench_command cmd, struct ast_bench *bench)
+#define AST_BENCH_REGISTER(cb)
+#define AST_BENCH_UNREGISTER(cb)
 #define ast_test_status_update(a,b,c...)
 #define ast_test_debug(test, fmt, ...)	ast_cli		/* Dummy function that should not be called. */
 
@@ -251,6 +294,42 @@ struct ast_test_info {
 	unsigned int explicit_only;
 };
 
+enum ast_bench_command {
+	BENCH_INIT,
+	BENCH_SETUP,
+	BENCH_RUN,
+	BENCH_CLEANUP,
+};
+
+/*!
+ * \brief An Asterisk benchmark.
+ * \since 18.0.0
+ *
+ * This is an opaque type.
+ */
+struct ast_bench;
+
+/*!
+ * \brief Contains the initialization information of a benchmark
+ * \since 18.0.0
+ */
+struct ast_bench_info {
+	/*! \brief name of benchmark, unique to category */
+	const char *name;
+	/*! \brief benchmark category, with a leading and trailing forward slash ('/') */
+	const char *category;
+	/*! \brief Short summary of benchmark */
+	const char *summary;
+	/*! \brief More detailed description of benchmark */
+	const char *description;
+	/*! \brief Untimed iterations run before the timed ones, 10 if not set */
+	unsigned int warmup;
+	/*! \brief Timed iterations, 100 if not set */
+	unsigned int iterations;
+	/*! \brief Operations done by each iteration, for the time per operation, 1 if not set */
+	unsigned int operations;
+};
+
 #ifdef TEST_FRAMEWORK
 /*!
  * \brief Generic test callback function
@@ -342,6 +421,54 @@ int ast_test_register_init(const char *category, ast_test_init_cb_t *cb);
  */
 int ast_test_register_cleanup(const char *category, ast_test_cleanup_cb_t *cb);
 
+/*!
+ * \brief Generic benchmark callback function
+ * \since 18.0.0
+ *
+ * \param info The benchmark info object
+ * \param cmd What to perform in the benchmark
+ * \param bench The actual benchmark object being run
+ *
+ * \retval 0 success
+ * \retval -1 failure, which ends the benchmark as failed
+ */
+typedef int (ast_bench_cb_t)(struct ast_bench_info *info,
+	enum ast_bench_command cmd, struct ast_bench *bench);
+
+/*!
+ * \brief registers a benchmark with the test framework
+ * \since 18.0.0
+ *
+ * \param cb benchmark callback function (required)
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_bench_register(ast_bench_cb_t *cb);
+
+/*!
+ * \brief unregisters a benchmark with the test framework
+ * \since 18.0.0
+ *
+ * \param cb benchmark callback function (required)
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_bench_unregister(ast_bench_cb_t *cb);
+
+/*!
+ * \brief Keep data made by BENCH_SETUP for the runs and BENCH_CLEANUP
+ * \since 18.0.0
+ */
+void ast_bench_set_data(struct ast_bench *bench, void *data);
+
+/*!
+ * \brief Get the data kept with ast_bench_set_data()
+ * \since 18.0.0
+ */
+void *ast_bench_get_data(struct ast_bench *bench);
+
 
 /*!
  * \brief Unit test debug output.
@@ -122,6 +122,27 @@ struct ast_threadpool_options {
 	 * a thread completes
 	 */
 	void (*thread_end)(void);
+	/*!
+	 * \brief Use work-stealing task queues
+	 * \since 18.0.0
+	 *
+	 * By default all tasks pushed into the pool are placed in a single
+	 * shared taskprocessor queue. When this is non-zero the pool instead
+	 * keeps a separately locked task deque per worker thread (one per
+	 * thread up to max_size, or initial_size if the pool is unbounded).
+	 * Tasks pushed from one of the pool's own threads go to that thread's
+	 * deque, other tasks are spread round-robin. Workers run tasks from
+	 * their own deque and steal from the other deques when it is empty.
+	 *
+	 * Serializers created on the pool still execute their tasks in FIFO
+	 * order. The order in which independent tasks pushed directly to the
+	 * pool execute is not guaranteed.
+	 *
+	 * \note In this mode the listener's task_pushed callback is only
+	 * invoked when the pool needs to wake up or grow threads rather than
+	 * for every pushed task.
+	 */
+	int work_stealing;
 };
 
 /*!
@@ -189,6 +210,26 @@ void ast_threadpool_set_size(struct ast_threadpool *threadpool, unsigned int siz
 int ast_threadpool_push(struct ast_threadpool *pool, int (*task)(void *data), void *data)
 	attribute_warn_unused_result;
 
+struct ast_taskprocessor_task;
+
+/*!
+ * \brief Push several tasks to the threadpool at once
+ * \since 18.0.0
+ *
+ * The tasks are queued together and idle threads are woken up once for
+ * the whole batch rather than once per task. Either all of the tasks are
+ * queued or none of them are.
+ *
+ * \param pool The threadpool to add the tasks to
+ * \param tasks The tasks to add
+ * \param count The number of tasks in the array
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_threadpool_push_batch(struct ast_threadpool *pool,
+	const struct ast_taskprocessor_task *tasks, size_t count)
+	attribute_warn_unused_result;
+
 /*!
  * \brief Shut down a threadpool and destroy it
  *
@@ -293,9 +334,40 @@ struct ast_taskprocessor *ast_threadpool_serializer(const char *name, struct ast
 struct ast_taskprocessor *ast_threadpool_serializer_group(const char *name,
 	struct ast_threadpool *pool, struct ast_serializer_shutdown_group *shutdown_group);
 
+/*!
+ * \brief Start batching serializer scheduling on the calling thread
+ * \since 18.0.0
+ *
+ * A serializer that receives a task while it has nothing to do must push
+ * a task to its threadpool to start executing. Between this call and the
+ * matching ast_threadpool_serializer_batch_end() those threadpool pushes
+ * made from this thread are collected instead, and then pushed to each
+ * threadpool with ast_threadpool_push_batch(). This is useful when pushing
+ * tasks to many serializers at once, such as when fanning a message out to
+ * many subscribers.
+ *
+ * Batches may be nested. Only the outermost end pushes the collected
+ * serializers.
+ *
+ * \warning Tasks pushed to a serializer from this thread will not run until
+ * the batch ends, so never wait on their completion within a batch.
+ */
+void ast_threadpool_serializer_batch_begin(void);
+
+/*!
+ * \brief Finish batching serializer scheduling on the calling thread
+ * \since 18.0.0
+ *
+ * \see ast_threadpool_serializer_batch_begin()
+ */
+void ast_threadpool_serializer_batch_end(void);
+
 /*!
  * \brief Return the size of the threadpool's task queue
  * \since 13.7.0
+ *
+ * \note For a work-stealing pool this is the number of tasks queued
+ * across all of the worker deques.
  */
 long ast_threadpool_queue_size(struct ast_threadpool *pool);
 
@@ -0,0 +1,101 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Trace spans of the stages of calls
+ *
+ * When enabled with 'core set trace spans on', the time the stages of
+ * calls take is recorded, to the nanosecond, into a ring kept by every
+ * thread. The spans are written out with 'core trace spans export' in the
+ * Chrome trace event format, which trace viewers such as Perfetto and
+ * chrome://tracing load, so that the time a call takes to be set up can
+ * be broken down. Spans cost a single branch while disabled.
+ */
+
+#ifndef _ASTERISK_TRACE_SPAN_H
+#define _ASTERISK_TRACE_SPAN_H
+
+#include <inttypes.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/*! \brief Whether spans are recorded, only to be read by the macros below */
+extern int ast_trace_spans_enabled;
+
+/*!
+ * \brief Nanoseconds of the monotonic clock
+ * \since 18.0.0
+ */
+uint64_t ast_trace_span_now(void);
+
+/*!
+ * \brief Record a span into the ring of the thread
+ * \since 18.0.0
+ *
+ * \param name The stage, which must be a string constant
+ * \param id What the span is of, such as a channel unique id or a SIP Call-ID
+ * \param start When the span started, from ast_trace_span_now()
+ * \param end When the span ended, from ast_trace_span_now()
+ */
+void ast_trace_span_record(const char *name, const char *id, uint64_t start, uint64_t end);
+
+/*!
+ * \brief Start a span, holding its start time in a variable
+ * \since 18.0.0
+ *
+ * \param var The variable declared to hold the start time, 0 while disabled
+ */
+#define AST_TRACE_SPAN_BEGIN(var) \
+	uint64_t var = __builtin_expect(ast_trace_spans_enabled, 0) ? ast_trace_span_now() : 0
+
+/*!
+ * \brief End a span started with AST_TRACE_SPAN_BEGIN
+ * \since 18.0.0
+ *
+ * \param var The variable holding the start time
+ * \param name The stage, which must be a string constant
+ * \param id What the span is of
+ */
+#define AST_TRACE_SPAN_END(var, name, id) \
+	do { \
+		if (__builtin_expect(var != 0, 0)) { \
+			ast_trace_span_record(name, id, var, ast_trace_span_now()); \
+		} \
+	} while (0)
+
+/*!
+ * \brief Record an event, a span without a duration
+ * \since 18.0.0
+ *
+ * \param name The event, which must be a string constant
+ * \param id What the event is of
+ */
+#define AST_TRACE_SPAN_EVENT(name, id) \
+	do { \
+		if (__builtin_expect(ast_trace_spans_enabled, 0)) { \
+			uint64_t __now = ast_trace_span_now(); \
+			ast_trace_span_record(name, id, __now, __now); \
+		} \
+	} while (0)
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_TRACE_SPAN_H */
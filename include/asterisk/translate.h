@@ -169,6 +169,18 @@ struct ast_translator {
 
 	struct ast_frame * (*sample)(void);    /*!< Generate an example frame */
 
+	/*!\brief Submit frames, linked by frame_list, to an accelerator.
+	 * Set by translators handing translation off to hardware or to a
+	 * remote service, in place of framein. The frames remain the caller's.
+	 * The translated frames are handed back with ast_trans_complete(),
+	 * from any thread, and frameout then gives them out. Its work is not
+	 * done where it can be timed, so comp_cost is what the translator sets,
+	 * or else the lowest there is. It may fail newpvt when the accelerator
+	 * has no room left, for another translator between the same codecs to
+	 * be used instead.
+	 */
+	int (*submit)(struct ast_trans_pvt *pvt, struct ast_frame *frames);
+
 	/*!\brief size of outbuf, in samples. Leave it 0 if you want the framein
 	 * callback deal with the frame. Set it appropriately if you
 	 * want the code to checks if the incoming frame fits the
@@ -190,6 +202,8 @@ struct ast_translator {
 	int src_fmt_index;                     /*!< index of the source format in the matrix table */
 	int dst_fmt_index;                     /*!< index of the destination format in the matrix table */
 	AST_LIST_ENTRY(ast_translator) list;   /*!< link field */
+	struct ast_trans_pvt *pvt_pool;        /*!< Released descriptors kept for reuse, linked by next */
+	int pvt_pool_count;                    /*!< Number of descriptors in pvt_pool */
 };
 
 /*! \brief
@@ -236,6 +250,7 @@ struct ast_trans_pvt {
 	 * want to do forward-error correction (FEC). */
 	struct ast_format *explicit_dst;
 	int interleaved_stereo;     /*!< indicates if samples are in interleaved order, for stereo lin */
+	struct ast_trans_completed *completed; /*!< frames completed by an accelerator, not yet given out */
 };
 
 /*! \brief generic frameout function */
@@ -244,6 +259,21 @@ struct ast_frame *ast_trans_frameout(struct ast_trans_pvt *pvt,
 
 struct ast_trans_pvt;
 
+/*!
+ * \brief Hand back a frame translated by an accelerator
+ * \since 18.0.0
+ *
+ * \param pvt The translation the frame was submitted for
+ * \param f The translated frame, which is copied
+ *
+ * \note May be called from any thread, until the translator's destroy
+ * callback returns.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int ast_trans_complete(struct ast_trans_pvt *pvt, struct ast_frame *f);
+
 /*!
  * \brief Register a translator
  * This registers a codec translator with asterisk
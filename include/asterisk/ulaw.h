@@ -84,4 +84,30 @@ static inline unsigned char AST_LIN2MU(short sample)
 
 #define AST_MULAW(a) (__ast_mulaw[(a)])
 
+/*!
+ * \brief Convert a buffer of mu-law samples to signed linear
+ * \since 18.0.0
+ *
+ * \details Produces the same samples as AST_MULAW(), using vector
+ * instructions when the CPU has them.
+ *
+ * \param dst Where to store the signed linear samples.
+ * \param src The mu-law samples.
+ * \param samples The number of samples to convert.
+ */
+void ast_ulaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples);
+
+/*!
+ * \brief Convert a buffer of signed linear samples to mu-law
+ * \since 18.0.0
+ *
+ * \details Produces the same samples as AST_LIN2MU(), using vector
+ * instructions when the CPU has them.
+ *
+ * \param dst Where to store the mu-law samples.
+ * \param src The signed linear samples.
+ * \param samples The number of samples to convert.
+ */
+void ast_ulaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples);
+
 #endif /* _ASTERISK_ULAW_H */
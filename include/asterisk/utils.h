@@ -464,6 +464,34 @@ int ast_pthread_create_detached_stack(pthread_t *thread, pthread_attr_t *attr, v
 		AST_BACKGROUND_STACKSIZE,			\
 		__FILE__, __FUNCTION__, __LINE__, #c)
 
+/*!
+ * \brief Set the CPUs media threads are bound to
+ * \since 18.0.0
+ *
+ * \param cpus A list of CPUs and ranges of CPUs, such as "0-7,16-23", or
+ *             NULL or an empty string for media threads not to be bound
+ *
+ * \retval 0 on success
+ * \retval -1 if the list is invalid, or binding is not supported
+ */
+int ast_set_media_cpus(const char *cpus);
+
+/*!
+ * \brief The number of CPUs media threads are bound to, 0 if they are not
+ * \since 18.0.0
+ */
+int ast_media_cpus_count(void);
+
+/*!
+ * \brief Bind the calling thread to the CPUs of media threads, if set
+ * \since 18.0.0
+ *
+ * Called by threads carrying media, such as the threads running calls and
+ * mixing conferences, so they run on the CPUs, and so the NUMA node, set
+ * aside for media. Does nothing if no CPUs are set.
+ */
+void ast_thread_bind_media_cpus(void);
+
 /* End of thread management support */
 
 /*!
@@ -48,6 +48,231 @@
 #include "asterisk/utils.h"
 #include "asterisk/lock.h"
 #include "asterisk/srv.h"
+#include "asterisk/vector.h"
+
+/*! \brief Fewest rules in a list for ast_apply_ha to use a tree for them */
+#define HA_TREE_MIN_RULES 16
+
+/*! \brief A node of the tree of a list of rules */
+struct ha_tree_node {
+	/*! Index of the node for a next bit of 0 and of 1, 0 for none */
+	unsigned int child[2];
+	/*! Position in the list of the last rule for exactly this prefix, -1 for none */
+	int rule;
+	/*! The sense of that rule */
+	enum ast_acl_sense sense;
+};
+
+/*!
+ * \brief A list of rules compiled into binary tries of their prefixes
+ *
+ * Node 0 is the root for IPv4 rules, node 1 the root for IPv6 rules. An
+ * address matches the rules stored along its path from the root, of which
+ * the last one in the list decides, as when the list is walked.
+ */
+struct ast_ha_tree {
+	AST_VECTOR(, struct ha_tree_node) nodes;
+};
+
+/*! \brief Set as the tree of a list that is walked, which ast_apply_ha does not compile */
+static struct ast_ha_tree ha_tree_linear;
+
+/*! \brief Serializes compiling the tree of a list */
+AST_MUTEX_DEFINE_STATIC(ha_tree_lock);
+
+static void ha_tree_free(struct ast_ha_tree *tree)
+{
+	if (!tree || tree == &ha_tree_linear) {
+		return;
+	}
+
+	AST_VECTOR_FREE(&tree->nodes);
+	ast_free(tree);
+}
+
+/*!
+ * \brief Get the address bytes of an IPv4 or IPv6 address
+ *
+ * \return Number of bits in the address
+ */
+static int ha_tree_addr_bytes(const struct ast_sockaddr *addr, const unsigned char **bytes)
+{
+	if (ast_sockaddr_is_ipv4(addr)) {
+		*bytes = (const unsigned char *) &((const struct sockaddr_in *) &addr->ss)->sin_addr;
+		return 32;
+	}
+
+	*bytes = ((const struct sockaddr_in6 *) &addr->ss)->sin6_addr.s6_addr;
+	return 128;
+}
+
+#define HA_TREE_BIT(bytes, bit) (((bytes)[(bit) / 8] >> (7 - (bit) % 8)) & 1)
+
+/*!
+ * \brief Get the prefix length of a netmask
+ *
+ * \retval -1 if the netmask is not a prefix, as a netmask like 255.0.255.0 is not
+ */
+static int ha_tree_prefix_len(const unsigned char *mask, int bits)
+{
+	int len = 0;
+	int bit;
+
+	while (len < bits && HA_TREE_BIT(mask, len)) {
+		++len;
+	}
+	for (bit = len; bit < bits; ++bit) {
+		if (HA_TREE_BIT(mask, bit)) {
+			return -1;
+		}
+	}
+
+	return len;
+}
+
+/*!
+ * \brief Compile a list of rules into a tree
+ *
+ * \retval NULL if the list is short, or has rules a tree can not hold
+ */
+static struct ast_ha_tree *ha_tree_compile(const struct ast_ha *ha)
+{
+	const struct ha_tree_node root = { .rule = -1, };
+	const struct ast_ha *current_ha;
+	struct ast_ha_tree *tree;
+	int count = 0;
+	int rule;
+
+	for (current_ha = ha; current_ha; current_ha = current_ha->next) {
+		++count;
+	}
+	if (count < HA_TREE_MIN_RULES) {
+		return NULL;
+	}
+
+	tree = ast_calloc(1, sizeof(*tree));
+	if (!tree || AST_VECTOR_INIT(&tree->nodes, count * 8)
+		|| AST_VECTOR_APPEND(&tree->nodes, root) || AST_VECTOR_APPEND(&tree->nodes, root)) {
+		ha_tree_free(tree);
+		return NULL;
+	}
+
+	for (current_ha = ha, rule = 0; current_ha; current_ha = current_ha->next, ++rule) {
+		const unsigned char *addr;
+		const unsigned char *mask;
+		unsigned int node;
+		int bits;
+		int len;
+		int bit;
+
+		if (ast_sockaddr_port(&current_ha->addr)
+			|| ast_sockaddr_is_ipv4(&current_ha->addr) != ast_sockaddr_is_ipv4(&current_ha->netmask)) {
+			/* Matching ports is left to walking the list */
+			ha_tree_free(tree);
+			return NULL;
+		}
+
+		bits = ha_tree_addr_bytes(&current_ha->addr, &addr);
+		ha_tree_addr_bytes(&current_ha->netmask, &mask);
+		len = ha_tree_prefix_len(mask, bits);
+		if (len < 0) {
+			ha_tree_free(tree);
+			return NULL;
+		}
+
+		for (bit = len; bit < bits; ++bit) {
+			if (HA_TREE_BIT(addr, bit)) {
+				break;
+			}
+		}
+		if (bit < bits) {
+			/* Bits outside of the netmask are set, so the rule matches no address */
+			continue;
+		}
+
+		node = ast_sockaddr_is_ipv4(&current_ha->addr) ? 0 : 1;
+		for (bit = 0; bit < len; ++bit) {
+			int next = HA_TREE_BIT(addr, bit);
+
+			if (!AST_VECTOR_GET_ADDR(&tree->nodes, node)->child[next]) {
+				if (AST_VECTOR_APPEND(&tree->nodes, root)) {
+					ha_tree_free(tree);
+					return NULL;
+				}
+				AST_VECTOR_GET_ADDR(&tree->nodes, node)->child[next] = AST_VECTOR_SIZE(&tree->nodes) - 1;
+			}
+			node = AST_VECTOR_GET_ADDR(&tree->nodes, node)->child[next];
+		}
+		AST_VECTOR_GET_ADDR(&tree->nodes, node)->rule = rule;
+		AST_VECTOR_GET_ADDR(&tree->nodes, node)->sense = current_ha->sense;
+	}
+
+	return tree;
+}
+
+/*! \brief Get the tree of a list of rules, compiling it the first time */
+static struct ast_ha_tree *ha_tree_get(const struct ast_ha *ha)
+{
+	struct ast_ha_tree *tree;
+
+	tree = ast_atomic_load_n(&ha->tree, __ATOMIC_ACQUIRE);
+	if (!tree) {
+		ast_mutex_lock(&ha_tree_lock);
+		tree = ha->tree;
+		if (!tree) {
+			tree = ha_tree_compile(ha) ?: &ha_tree_linear;
+			ast_atomic_store_n(&((struct ast_ha *) ha)->tree, tree, __ATOMIC_RELEASE);
+		}
+		ast_mutex_unlock(&ha_tree_lock);
+	}
+
+	return tree == &ha_tree_linear ? NULL : tree;
+}
+
+static enum ast_acl_sense ha_tree_apply(const struct ast_ha_tree *tree, const struct ast_sockaddr *addr)
+{
+	enum ast_acl_sense res = AST_SENSE_ALLOW;
+	struct ast_sockaddr mapped_addr;
+	const struct ha_tree_node *node;
+	const unsigned char *bytes;
+	int best = -1;
+	int bits;
+	int bit;
+
+	if (ast_sockaddr_is_ipv4(addr)) {
+		node = AST_VECTOR_GET_ADDR(&tree->nodes, 0);
+	} else if (!ast_sockaddr_is_ipv6(addr)) {
+		return res;
+	} else if (!ast_sockaddr_is_ipv4_mapped(addr)) {
+		node = AST_VECTOR_GET_ADDR(&tree->nodes, 1);
+	} else if (ast_sockaddr_ipv4_mapped(addr, &mapped_addr)) {
+		/* IPv4 ACLs apply to IPv4-mapped addresses */
+		addr = &mapped_addr;
+		node = AST_VECTOR_GET_ADDR(&tree->nodes, 0);
+	} else {
+		return res;
+	}
+
+	bits = ha_tree_addr_bytes(addr, &bytes);
+	for (bit = 0; ; ++bit) {
+		unsigned int next;
+
+		if (node->rule > best) {
+			best = node->rule;
+			res = node->sense;
+		}
+		if (bit == bits) {
+			break;
+		}
+		next = node->child[HA_TREE_BIT(bytes, bit)];
+		if (!next) {
+			break;
+		}
+		node = AST_VECTOR_GET_ADDR(&tree->nodes, next);
+	}
+
+	return res;
+}
 
 #if (!defined(SOLARIS) && !defined(HAVE_GETIFADDRS))
 static int get_local_address(struct ast_sockaddr *ourip)
@@ -224,6 +449,7 @@ void ast_free_ha(struct ast_ha *ha)
 	while (ha) {
 		hal = ha;
 		ha = ha->next;
+		ha_tree_free(hal->tree);
 		ast_free(hal);
 	}
 }
@@ -696,6 +922,9 @@ static struct ast_ha *append_ha_core(const char *sense, const char *stuff, struc
 
 		if (prev) {
 			prev->next = ha;
+			/* The tree of the list no longer has all of its rules */
+			ha_tree_free(ret->tree);
+			ret->tree = NULL;
 		} else {
 			ret = ha;
 		}
@@ -809,6 +1038,12 @@ enum ast_acl_sense ast_apply_ha(const struct ast_ha *ha, const struct ast_sockad
 	/* Start optimistic */
 	enum ast_acl_sense res = AST_SENSE_ALLOW;
 	const struct ast_ha *current_ha;
+	const struct ast_ha_tree *tree;
+
+	/* A long list of prefixes is looked up in a tree rather than walked */
+	if (ha && (tree = ha_tree_get(ha))) {
+		return ha_tree_apply(tree, addr);
+	}
 
 	for (current_ha = ha; current_ha; current_ha = current_ha->next) {
 		struct ast_sockaddr result;
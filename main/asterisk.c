@@ -471,6 +471,22 @@ static char *handle_show_settings(struct ast_cli_entry *e, int cmd, struct ast_c
 		ast_cli(a->fd, "  Maximum calls:               %d (Current %d)\n", ast_option_maxcalls, ast_active_channels());
 	else
 		ast_cli(a->fd, "  Maximum calls:               Not set\n");
+	ast_cli(a->fd, "  Channel storage shards:      %u\n", ast_option_channel_storage_shards);
+	if (ast_option_tps_slow_task) {
+		ast_cli(a->fd, "  Slow taskprocessor task:     %u ms\n", ast_option_tps_slow_task);
+	} else {
+		ast_cli(a->fd, "  Slow taskprocessor task:     Not logged\n");
+	}
+	if (ast_option_pbx_stacksize) {
+		ast_cli(a->fd, "  PBX thread stack size:       %u KB\n", ast_option_pbx_stacksize);
+	} else {
+		ast_cli(a->fd, "  PBX thread stack size:       Default (%u KB)\n", (unsigned int) (AST_STACKSIZE / 1024));
+	}
+	if (ast_media_cpus_count()) {
+		ast_cli(a->fd, "  Media thread CPUs:           %d\n", ast_media_cpus_count());
+	} else {
+		ast_cli(a->fd, "  Media thread CPUs:           Not bound\n");
+	}
 
 	if (getrlimit(RLIMIT_NOFILE, &limits)) {
 		ast_cli(a->fd, "  Maximum open file handles:   Error because of %s\n", strerror(errno));
@@ -4064,6 +4080,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	check_init(ast_json_init(), "libjansson");
 	ast_ulaw_init();
 	ast_alaw_init();
+	ast_g711_init();
 	tdd_init();
 	callerid_init();
 	ast_builtins_init();
@@ -4085,6 +4102,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	check_init(ast_codec_init(), "Codecs");
 	check_init(ast_format_init(), "Formats");
 	check_init(ast_format_cache_init(), "Format Cache");
+	check_init(ast_frame_init(), "Frames");
 	check_init(ast_codec_builtin_init(), "Built-in Codecs");
 	check_init(ast_bucket_init(), "Bucket API");
 	check_init(ast_stasis_system_init(), "Stasis system-level information");
@@ -4147,6 +4165,9 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	check_init(load_pbx_app(), "PBX Application Support");
 	check_init(load_pbx_hangup_handler(), "PBX Hangup Handler Support");
 	check_init(ast_local_init(), "Local Proxy Channel Driver");
+	check_init(ast_originate_init(), "Origination Executor");
+	check_init(ast_trace_span_init(), "Trace Spans");
+	check_init(ast_frame_timing_init(), "Frame Timing");
 
 	/* We should avoid most config loads before this point as they can't use realtime. */
 	check_init(load_modules(), "Module");
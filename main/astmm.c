@@ -1554,59 +1554,437 @@ void load_astmm_phase_2(void)
 
 #else	/* !defined(__AST_DEBUG_MALLOC) */
 
+#if !defined(STANDALONE) && !defined(STANDALONE2)
+
+#include "asterisk/cli.h"
+#include "asterisk/lock.h"
+#include "asterisk/strings.h"
+
+/*!
+ * \brief Sampling allocation profiler
+ *
+ * Once enabled, the allocation made when another profile_rate bytes
+ * have been allocated is sampled.  Each sample stands for the bytes
+ * allocated since the previous one.  The samples not yet freed give an
+ * estimate of the memory held by each place that allocates, at the cost
+ * of one atomic add per allocation and one load per free.
+ */
+
+/*! Places allocating memory that can be profiled, a power of two */
+#define PROFILE_SITES 1024
+/*! Sampled allocations that can be live at once */
+#define PROFILE_RECORDS 16384
+/*! Buckets of the sampled allocations, hashed by address, a power of two */
+#define PROFILE_BUCKETS 65536
+/*! Places shown by 'memory show profile' unless told otherwise */
+#define PROFILE_SHOW_DEFAULT 20
+
+struct profile_site {
+	/*! The address of the file name, the key along with the line */
+	const char *key;
+	char file[64];
+	char func[64];
+	int line;
+	/*! Allocations sampled */
+	unsigned int samples;
+	/*! Sampled allocations not yet freed */
+	unsigned int live;
+	/*! Bytes the live samples stand for */
+	uint64_t live_bytes;
+};
+
+struct profile_record {
+	void *ptr;
+	/*! Bytes the sample stands for */
+	size_t bytes;
+	/*! Index of the site in profile_sites */
+	int site;
+	/*! Next record in the bucket or the free list, 0 for none */
+	int next;
+};
+
+/*! Sample an allocation in this many bytes, or none if 0 */
+static size_t profile_rate;
+/*! Bytes allocated while profiling */
+static size_t profile_allocated;
+/*! Protects the profile tables, which are allocated once and never freed */
+AST_MUTEX_DEFINE_STATIC_NOTRACKING(profile_lock);
+static struct profile_site *profile_sites;
+/*! Records of the sampled allocations, from index 1 */
+static struct profile_record *profile_records;
+/*! First record of each bucket, 0 if empty */
+static int *profile_buckets;
+/*! First record not in use, 0 if none */
+static int profile_free_record;
+
+static unsigned int profile_hash(const void *ptr)
+{
+	return ((uint32_t) (((uintptr_t) ptr >> 4) * 2654435761u)) >> 16;
+}
+
+static void profile_sample(void *ptr, size_t bytes, const char *file, int lineno, const char *func)
+{
+	unsigned int hash = (unsigned int) ((uintptr_t) file >> 3) * 31 + lineno;
+	struct profile_site *site = NULL;
+	unsigned int bucket;
+	int probe;
+	int record;
+
+	ast_mutex_lock(&profile_lock);
+	if (!profile_free_record) {
+		ast_mutex_unlock(&profile_lock);
+		return;
+	}
+
+	for (probe = 0; probe < PROFILE_SITES; ++probe) {
+		site = &profile_sites[(hash + probe) & (PROFILE_SITES - 1)];
+		if (!site->key) {
+			site->key = file;
+			site->line = lineno;
+			ast_copy_string(site->file, file, sizeof(site->file));
+			ast_copy_string(site->func, func, sizeof(site->func));
+			break;
+		} else if (site->key == file && site->line == lineno) {
+			break;
+		}
+	}
+	if (probe == PROFILE_SITES) {
+		ast_mutex_unlock(&profile_lock);
+		return;
+	}
+
+	++site->samples;
+	++site->live;
+	site->live_bytes += bytes;
+
+	record = profile_free_record;
+	profile_free_record = profile_records[record].next;
+	profile_records[record].ptr = ptr;
+	profile_records[record].bytes = bytes;
+	profile_records[record].site = site - profile_sites;
+
+	bucket = profile_hash(ptr);
+	profile_records[record].next = profile_buckets[bucket];
+	ast_atomic_store_n(&profile_buckets[bucket], record, __ATOMIC_RELAXED);
+	ast_mutex_unlock(&profile_lock);
+}
+
+#define profile_enabled() ast_atomic_load_n(&profile_rate, __ATOMIC_RELAXED)
+
+static inline void profile_alloc(void *ptr, size_t size, const char *file, int lineno, const char *func)
+{
+	size_t rate = profile_enabled();
+	size_t before;
+
+	if (!rate || !ptr) {
+		return;
+	}
+
+	before = ast_atomic_fetch_add(&profile_allocated, size, __ATOMIC_RELAXED);
+	if (before / rate != (before + size) / rate) {
+		profile_sample(ptr, MAX(size, rate), file, lineno, func);
+	}
+}
+
+static inline void profile_free(void *ptr)
+{
+	int *buckets = ast_atomic_load_n(&profile_buckets, __ATOMIC_RELAXED);
+	unsigned int bucket;
+	int *prev;
+	int record;
+
+	/* An allocation that was sampled was put in its bucket before it was handed out */
+	if (!buckets || !ptr
+		|| !ast_atomic_load_n(&buckets[(bucket = profile_hash(ptr))], __ATOMIC_RELAXED)) {
+		return;
+	}
+
+	ast_mutex_lock(&profile_lock);
+	for (prev = &profile_buckets[bucket]; (record = *prev); prev = &profile_records[record].next) {
+		struct profile_site *site;
+
+		if (profile_records[record].ptr != ptr) {
+			continue;
+		}
+
+		site = &profile_sites[profile_records[record].site];
+		--site->live;
+		site->live_bytes -= profile_records[record].bytes;
+
+		ast_atomic_store_n(prev, profile_records[record].next, __ATOMIC_RELAXED);
+		profile_records[record].next = profile_free_record;
+		profile_free_record = record;
+		break;
+	}
+	ast_mutex_unlock(&profile_lock);
+}
+
+/*!
+ * \internal
+ * \brief Start profiling anew, sampling an allocation in rate bytes
+ *
+ * \retval 0 on success
+ * \retval -1 if the profile tables could not be allocated
+ */
+static int profile_set_rate(size_t rate)
+{
+	int record;
+
+	ast_mutex_lock(&profile_lock);
+	if (!profile_sites) {
+		struct profile_site *sites = calloc(PROFILE_SITES, sizeof(*sites));
+		struct profile_record *records = calloc(PROFILE_RECORDS + 1, sizeof(*records));
+		int *buckets = calloc(PROFILE_BUCKETS, sizeof(*buckets));
+
+		if (!sites || !records || !buckets) {
+			free(sites);
+			free(records);
+			free(buckets);
+			ast_mutex_unlock(&profile_lock);
+			return -1;
+		}
+		profile_sites = sites;
+		profile_records = records;
+		ast_atomic_store_n(&profile_buckets, buckets, __ATOMIC_RELAXED);
+	} else {
+		memset(profile_sites, 0, sizeof(*profile_sites) * PROFILE_SITES);
+		memset(profile_buckets, 0, sizeof(*profile_buckets) * PROFILE_BUCKETS);
+	}
+
+	for (record = 1; record < PROFILE_RECORDS; ++record) {
+		profile_records[record].next = record + 1;
+	}
+	profile_records[PROFILE_RECORDS].next = 0;
+	profile_free_record = 1;
+
+	ast_atomic_store_n(&profile_allocated, 0, __ATOMIC_RELAXED);
+	ast_atomic_store_n(&profile_rate, rate, __ATOMIC_RELAXED);
+	ast_mutex_unlock(&profile_lock);
+
+	return 0;
+}
+
+static int profile_site_cmp(const void *a, const void *b)
+{
+	const struct profile_site *site_a = a;
+	const struct profile_site *site_b = b;
+
+	if (site_a->live_bytes != site_b->live_bytes) {
+		return site_a->live_bytes < site_b->live_bytes ? 1 : -1;
+	}
+	return site_b->samples - site_a->samples;
+}
+
+static char *handle_memory_profile(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int rate;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "memory profile";
+		e->usage =
+			"Usage: memory profile {off|<bytes>}\n"
+			"       Sample the allocation made each time another <bytes> were\n"
+			"       allocated, forgetting what was sampled before.  Use 'off'\n"
+			"       to stop.  65536 is a reasonable rate under load.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!strcasecmp(a->argv[2], "off")) {
+		rate = 0;
+	} else if (sscanf(a->argv[2], "%30u", &rate) != 1 || !rate) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (profile_set_rate(rate)) {
+		ast_cli(a->fd, "Unable to allocate the memory profile\n");
+		return CLI_FAILURE;
+	}
+
+	if (rate) {
+		ast_cli(a->fd, "Sampling an allocation in %u bytes\n", rate);
+	} else {
+		ast_cli(a->fd, "Memory profiling disabled\n");
+	}
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_memory_show_profile(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct profile_site *sites;
+	char location[160];
+	int limit = PROFILE_SHOW_DEFAULT;
+	int used = 0;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "memory show profile";
+		e->usage =
+			"Usage: memory show profile [<limit>]\n"
+			"       Show the places estimated to hold the most memory while\n"
+			"       memory profiling is enabled, at most <limit> of them\n"
+			"       (default 20).\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc == 4) {
+		if (sscanf(a->argv[3], "%30d", &limit) != 1 || limit <= 0) {
+			return CLI_SHOWUSAGE;
+		}
+	} else if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!profile_enabled()) {
+		ast_cli(a->fd, "Memory profiling is disabled, see 'memory profile'\n");
+		return CLI_SUCCESS;
+	}
+
+	sites = malloc(sizeof(*sites) * PROFILE_SITES);
+	if (!sites) {
+		return CLI_FAILURE;
+	}
+
+	ast_mutex_lock(&profile_lock);
+	for (i = 0; i < PROFILE_SITES; ++i) {
+		if (profile_sites[i].key) {
+			sites[used++] = profile_sites[i];
+		}
+	}
+	ast_mutex_unlock(&profile_lock);
+
+	qsort(sites, used, sizeof(*sites), profile_site_cmp);
+
+	ast_cli(a->fd, "%-14s %-10s %-10s %s\n", "Live(bytes)", "Live", "Samples", "Location");
+	for (i = 0; i < used && i < limit; ++i) {
+		snprintf(location, sizeof(location), "%s:%d %s()",
+			sites[i].file, sites[i].line, sites[i].func);
+		ast_cli(a->fd, "%-14" PRIu64 " %-10u %-10u %s\n",
+			sites[i].live_bytes, sites[i].live, sites[i].samples, location);
+	}
+	free(sites);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_memory_profile[] = {
+	AST_CLI_DEFINE(handle_memory_profile, "Enable or disable sampling memory allocations"),
+	AST_CLI_DEFINE(handle_memory_show_profile, "Show the places holding the most sampled memory"),
+};
+
+static void profile_shutdown(void)
+{
+	ast_cli_unregister_multiple(cli_memory_profile, ARRAY_LEN(cli_memory_profile));
+}
+
+#else	/* defined(STANDALONE) || defined(STANDALONE2) */
+#define profile_enabled() 0
+#define profile_alloc(ptr, size, file, lineno, func)
+#define profile_free(ptr)
+#endif	/* !defined(STANDALONE) && !defined(STANDALONE2) */
+
 void load_astmm_phase_1(void)
 {
 }
 
 void load_astmm_phase_2(void)
 {
+#if !defined(STANDALONE) && !defined(STANDALONE2)
+	ast_cli_register_multiple(cli_memory_profile, ARRAY_LEN(cli_memory_profile));
+	ast_register_cleanup(profile_shutdown);
+#endif
 }
 
 void *__ast_repl_calloc(size_t nmemb, size_t size, const char *file, int lineno, const char *func)
 {
+	void *p;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
 
-	return calloc(nmemb, size);
+	p = calloc(nmemb, size);
+	profile_alloc(p, nmemb * size, file, lineno, func);
+
+	return p;
 }
 
 static void *__ast_repl_calloc_cache(size_t nmemb, size_t size, const char *file, int lineno, const char *func)
 {
+	void *p;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
 
-	return calloc(nmemb, size);
+	p = calloc(nmemb, size);
+	profile_alloc(p, nmemb * size, file, lineno, func);
+
+	return p;
 }
 
 void *__ast_repl_malloc(size_t size, const char *file, int lineno, const char *func)
 {
+	void *p;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
 
-	return malloc(size);
+	p = malloc(size);
+	profile_alloc(p, size, file, lineno, func);
+
+	return p;
 }
 
 void __ast_free(void *ptr, const char *file, int lineno, const char *func)
 {
+	profile_free(ptr);
 	free(ptr);
 }
 
 void *__ast_repl_realloc(void *ptr, size_t size, const char *file, int lineno, const char *func)
 {
+	void *newp;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
 
-	return realloc(ptr, size);
+	/* Forgotten before the address can be handed out again */
+	profile_free(ptr);
+	newp = realloc(ptr, size);
+	profile_alloc(newp, size, file, lineno, func);
+
+	return newp;
 }
 
 char *__ast_repl_strdup(const char *s, const char *file, int lineno, const char *func)
 {
+	char *newstr;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
 
-	return strdup(s);
+	newstr = strdup(s);
+	if (profile_enabled()) {
+		profile_alloc(newstr, strlen(s) + 1, file, lineno, func);
+	}
+
+	return newstr;
 }
 
 char *__ast_repl_strndup(const char *s, size_t n, const char *file, int lineno, const char *func)
 {
+	char *newstr;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
 
-	return strndup(s, n);
+	newstr = strndup(s, n);
+	profile_alloc(newstr, n + 1, file, lineno, func);
+
+	return newstr;
 }
 
 int __ast_repl_asprintf(const char *file, int lineno, const char *func, char **strp, const char *format, ...)
@@ -1619,15 +1997,25 @@ int __ast_repl_asprintf(const char *file, int lineno, const char *func, char **s
 	va_start(ap, format);
 	res = vasprintf(strp, format, ap);
 	va_end(ap);
+	if (res >= 0) {
+		profile_alloc(*strp, res + 1, file, lineno, func);
+	}
 
 	return res;
 }
 
 int __ast_repl_vasprintf(char **strp, const char *format, va_list ap, const char *file, int lineno, const char *func)
 {
+	int res;
+
 	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, -1);
 
-	return vasprintf(strp, format, ap);
+	res = vasprintf(strp, format, ap);
+	if (res >= 0) {
+		profile_alloc(*strp, res + 1, file, lineno, func);
+	}
+
+	return res;
 }
 
 #endif	/* defined(__AST_DEBUG_MALLOC) */
@@ -54,6 +54,9 @@ int __container_unlink_node_debug(struct ao2_container_node *node, uint32_t flag
 
 	if (flags & AO2_UNLINK_NODE_DEC_COUNT) {
 		ast_atomic_fetchadd_int(&container->elements, -1);
+		if (container->v_table->changed) {
+			container->v_table->changed(container);
+		}
 #if defined(AO2_DEBUG)
 		{
 			int empty = container->nodes - container->elements;
@@ -143,6 +146,9 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 				ast_log(LOG_ERROR, "Container integrity failed after insert or replace.\n");
 			}
 #endif	/* defined(AO2_DEBUG) */
+			if (self->v_table->changed) {
+				self->v_table->changed(self);
+			}
 			res = 1;
 			break;
 		case AO2_CONTAINER_INSERT_NODE_REJECTED:
@@ -434,6 +440,13 @@ void *__ao2_find(struct ao2_container *c, const void *arg, enum search_flags fla
 		ast_assert(0);
 		return NULL;
 	}
+	if (c->v_table && c->v_table->unlocked_find) {
+		void *found;
+
+		if (!c->v_table->unlocked_find(c, flags, arged, &found, tag, file, line, func)) {
+			return found;
+		}
+	}
 	return __ao2_callback(c, flags, c->cmp_fn, arged, tag, file, line, func);
 }
 
@@ -233,6 +233,36 @@ typedef void (*ao2_link_node_stat_fn)(struct ao2_container *container, struct ao
  */
 typedef void (*ao2_unlink_node_stat_fn)(struct ao2_container *container, struct ao2_container_node *node);
 
+/*!
+ * \brief Find an object without traversing the locked container.
+ * \since 18.0.0
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags to control the search.
+ * \param arg Comparison callback arg parameter.
+ * \param found Where to put the found object (Reffed) or NULL.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \retval 0 if the search was done.
+ * \retval -1 if the container must be traversed instead.
+ */
+typedef int (*ao2_container_unlocked_find_fn)(struct ao2_container *self, enum search_flags flags, void *arg, void **found, const char *tag, const char *file, int line, const char *func);
+
+/*!
+ * \brief The objects held by this container changed.
+ * \since 18.0.0
+ *
+ * \param self Container to operate upon.
+ *
+ * \note The container is already locked for writing.
+ *
+ * \return Nothing
+ */
+typedef void (*ao2_container_changed_fn)(struct ao2_container *self);
+
 /*! Container virtual methods template. */
 struct ao2_container_methods {
 	/*! Destroy this container. */
@@ -251,6 +281,10 @@ struct ao2_container_methods {
 	ao2_container_find_cleanup_fn traverse_cleanup;
 	/*! Find the next iteration element in the container. */
 	ao2_iterator_next_fn iterator_next;
+	/*! Find an object without traversing the locked container. (Optional) */
+	ao2_container_unlocked_find_fn unlocked_find;
+	/*! Notify the container that its objects changed. (Optional) */
+	ao2_container_changed_fn changed;
 #if defined(AO2_DEBUG)
 	/*! Increment the container linked object statistic. */
 	ao2_link_node_stat_fn link_stat;
@@ -71,6 +71,8 @@ struct ao2_container_hash {
 	ao2_hash_fn *hash_fn;
 	/*! Number of hash buckets in this container. */
 	int n_buckets;
+	/*! Snapshot state if AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY. */
+	struct hash_read_mostly *read_mostly;
 	/*! Hash bucket array of n_buckets.  Variable size. */
 	struct hash_bucket buckets[0];
 };
@@ -99,6 +101,60 @@ struct hash_traversal_state_check {
 	char check[1 / (AO2_TRAVERSAL_STATE_SIZE / sizeof(struct hash_traversal_state))];
 };
 
+/*! Number of reader counters per epoch of a read-mostly container. */
+#define HASH_SNAPSHOT_STRIPES 8
+
+/*!
+ * \brief Snapshot rebuild ratio of a read-mostly container.
+ *
+ * \details The snapshot is rebuilt once the number of locked
+ * lookups since it was discarded reaches the number of objects
+ * divided by this ratio.  Bulk changes interleaved with lookups
+ * then do not rebuild the snapshot after every change.
+ */
+#define HASH_SNAPSHOT_REBUILD_RATIO 16
+
+/*! Immutable copy of the objects in a read-mostly hash container. */
+struct hash_snapshot {
+	/*! Index into objs of the first object of each bucket.  n_buckets + 1 entries. */
+	int *bucket_first;
+	/*! Number of objects in the snapshot. */
+	int elements;
+	/*! Objects in bucket order (Reffed).  Variable size. */
+	void *objs[0];
+};
+
+/*! Reader counter padded to keep it on its own cache line. */
+struct hash_snapshot_readers {
+	/*! Number of readers currently searching a snapshot. */
+	int count;
+	char pad[64 - sizeof(int)];
+};
+
+/*!
+ * \brief Snapshot state of a read-mostly hash container.
+ *
+ * \details Readers register in a reader counter of the current
+ * epoch before loading the snapshot pointer.  A writer discarding
+ * the snapshot switches the epoch and waits for the old epoch
+ * counters to drain before releasing the old snapshot.  New
+ * readers use the other epoch so the writer cannot be starved.
+ */
+struct hash_read_mostly {
+	/*! Published snapshot.  NULL if it needs to be rebuilt. */
+	struct hash_snapshot *snapshot;
+	/*! Epoch new readers register in. */
+	int epoch;
+	/*! Locked lookups since the snapshot was discarded. */
+	int misses;
+	/*! Number of times the snapshot was built. */
+	int rebuilds;
+	/*! Serializes snapshot rebuilds by readers. */
+	ast_mutex_t build_lock;
+	/*! Reader counters of each epoch. */
+	struct hash_snapshot_readers readers[2][HASH_SNAPSHOT_STRIPES];
+};
+
 /*!
  * \internal
  * \brief Create an empty copy of this container.
@@ -726,6 +782,288 @@ static void hash_ao2_unlink_node_stat(struct ao2_container *hash, struct ao2_con
 }
 #endif	/* defined(AO2_DEBUG) */
 
+/*!
+ * \internal
+ * \brief Release a read-mostly container snapshot.
+ * \since 18.0.0
+ *
+ * \param snapshot Snapshot to release.  (Tolerates NULL)
+ *
+ * \return Nothing
+ */
+static void hash_snapshot_free(struct hash_snapshot *snapshot)
+{
+	int idx;
+
+	if (!snapshot) {
+		return;
+	}
+
+	for (idx = 0; idx < snapshot->elements; ++idx) {
+		ao2_t_ref(snapshot->objs[idx], -1, "Release read-mostly snapshot");
+	}
+	ast_free(snapshot);
+}
+
+/*!
+ * \internal
+ * \brief Build a snapshot of the objects in a read-mostly container.
+ * \since 18.0.0
+ *
+ * \param self Container to operate upon.
+ *
+ * \note The container is already locked.
+ *
+ * \retval snapshot on success.
+ * \retval NULL on error.
+ */
+static struct hash_snapshot *hash_snapshot_alloc(struct ao2_container_hash *self)
+{
+	struct hash_snapshot *snapshot;
+	struct hash_bucket_node *node;
+	int elements;
+	int bucket;
+	int idx;
+
+	elements = self->common.elements;
+	snapshot = ast_malloc(sizeof(*snapshot) + elements * sizeof(void *)
+		+ (self->n_buckets + 1) * sizeof(int));
+	if (!snapshot) {
+		return NULL;
+	}
+	snapshot->bucket_first = (int *) &snapshot->objs[elements];
+
+	idx = 0;
+	for (bucket = 0; bucket < self->n_buckets; ++bucket) {
+		snapshot->bucket_first[bucket] = idx;
+		AST_DLLIST_TRAVERSE(&self->buckets[bucket].list, node, links) {
+			if (!node->common.obj || idx == elements) {
+				continue;
+			}
+			ao2_t_ref(node->common.obj, +1, "Add to read-mostly snapshot");
+			snapshot->objs[idx++] = node->common.obj;
+		}
+	}
+	snapshot->bucket_first[bucket] = idx;
+	snapshot->elements = idx;
+
+	return snapshot;
+}
+
+/*!
+ * \internal
+ * \brief Rebuild the snapshot of a read-mostly container if it is missing.
+ * \since 18.0.0
+ *
+ * \param self Container to operate upon.
+ *
+ * \return Nothing
+ */
+static void hash_snapshot_rebuild(struct ao2_container_hash *self)
+{
+	struct hash_read_mostly *read_mostly = self->read_mostly;
+
+	/* Holding the read lock keeps writers from changing the container. */
+	ao2_rdlock(self);
+	ast_mutex_lock(&read_mostly->build_lock);
+	if (!read_mostly->snapshot) {
+		struct hash_snapshot *snapshot;
+
+		snapshot = hash_snapshot_alloc(self);
+		if (snapshot) {
+			++read_mostly->rebuilds;
+			ast_atomic_store_n(&read_mostly->misses, 0, __ATOMIC_RELAXED);
+			ast_atomic_store_n(&read_mostly->snapshot, snapshot, __ATOMIC_SEQ_CST);
+		}
+	}
+	ast_mutex_unlock(&read_mostly->build_lock);
+	ao2_unlock(self);
+}
+
+/*!
+ * \internal
+ * \brief Pick the reader counter stripe of the calling thread.
+ * \since 18.0.0
+ *
+ * \return Stripe index.
+ */
+static unsigned int hash_snapshot_stripe(void)
+{
+	uintptr_t self = (uintptr_t) pthread_self();
+
+	return (unsigned int) ((self >> 12) ^ (self >> 20)) % HASH_SNAPSHOT_STRIPES;
+}
+
+/*!
+ * \internal
+ * \brief Find an object in the snapshot of a read-mostly container.
+ * \since 18.0.0
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags to control the search.
+ * \param arg Comparison callback arg parameter.
+ * \param found Where to put the found object (Reffed) or NULL.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \retval 0 if the search was done.
+ * \retval -1 if the container must be traversed instead.
+ */
+static int hash_ao2_unlocked_find(struct ao2_container_hash *self, enum search_flags flags,
+	void *arg, void **found, const char *tag, const char *file, int line, const char *func)
+{
+	struct hash_read_mostly *read_mostly = self->read_mostly;
+	struct hash_snapshot_readers *readers;
+	struct hash_snapshot *snapshot;
+	ao2_callback_fn *cmp_fn;
+	ao2_sort_fn *sort_fn;
+	unsigned int stripe;
+	int descending;
+	int epoch;
+	int bucket;
+	int first;
+	int last;
+	int idx;
+
+	if (flags & (OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NODATA)) {
+		return -1;
+	}
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+	case OBJ_SEARCH_KEY:
+		break;
+	default:
+		return -1;
+	}
+
+	if (!ast_atomic_load_n(&read_mostly->snapshot, __ATOMIC_ACQUIRE)) {
+		/*
+		 * We cannot lock the container with OBJ_NOLOCK because the
+		 * caller may already hold it.
+		 */
+		if ((flags & OBJ_NOLOCK)
+			|| ast_atomic_fetchadd_int(&read_mostly->misses, 1)
+				< self->common.elements / HASH_SNAPSHOT_REBUILD_RATIO) {
+			return -1;
+		}
+		hash_snapshot_rebuild(self);
+	}
+
+	bucket = abs(self->hash_fn(arg, flags & OBJ_SEARCH_MASK) % self->n_buckets);
+	sort_fn = self->common.sort_fn;
+	cmp_fn = self->common.cmp_fn;
+	switch (flags & OBJ_ORDER_MASK) {
+	case OBJ_ORDER_POST:
+	case OBJ_ORDER_DESCENDING:
+		descending = 1;
+		break;
+	default:
+		descending = 0;
+		break;
+	}
+
+	stripe = hash_snapshot_stripe();
+	for (;;) {
+		epoch = ast_atomic_load_n(&read_mostly->epoch, __ATOMIC_SEQ_CST);
+		readers = &read_mostly->readers[epoch][stripe];
+		ast_atomic_fetch_add(&readers->count, 1, __ATOMIC_SEQ_CST);
+		/*
+		 * A writer may have switched the epoch, and drained the one we
+		 * loaded, before we registered in it.  The next writer would then
+		 * not wait for us, so register in the current epoch instead.
+		 */
+		if (ast_atomic_load_n(&read_mostly->epoch, __ATOMIC_SEQ_CST) == epoch) {
+			break;
+		}
+		ast_atomic_fetch_sub(&readers->count, 1, __ATOMIC_SEQ_CST);
+	}
+	snapshot = ast_atomic_load_n(&read_mostly->snapshot, __ATOMIC_SEQ_CST);
+	if (!snapshot) {
+		/* A writer discarded the snapshot before we got to it. */
+		ast_atomic_fetch_sub(&readers->count, 1, __ATOMIC_SEQ_CST);
+		return -1;
+	}
+
+	*found = NULL;
+	first = snapshot->bucket_first[bucket];
+	last = snapshot->bucket_first[bucket + 1];
+	for (idx = 0; idx < last - first; ++idx) {
+		void *obj = snapshot->objs[descending ? last - 1 - idx : first + idx];
+		int match;
+
+		if (sort_fn) {
+			/* Filter the object through the sort_fn */
+			int cmp = sort_fn(obj, arg, flags & OBJ_SEARCH_MASK);
+
+			if (descending) {
+				cmp = -cmp;
+			}
+			if (cmp < 0) {
+				continue;
+			}
+			if (cmp > 0) {
+				/* No more objects in this bucket are possible to match. */
+				break;
+			}
+		}
+
+		match = cmp_fn ? cmp_fn(obj, arg, flags) & (CMP_MATCH | CMP_STOP) : CMP_MATCH;
+		if (match & CMP_MATCH) {
+			__ao2_ref(obj, +1, tag ?: "Traversal found object", file, line, func);
+			*found = obj;
+			break;
+		}
+		if (match & CMP_STOP) {
+			break;
+		}
+	}
+
+	ast_atomic_fetch_sub(&readers->count, 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Discard the snapshot of a read-mostly container.
+ * \since 18.0.0
+ *
+ * \param self Container to operate upon.
+ *
+ * \note The container is already locked for writing.
+ *
+ * \return Nothing
+ */
+static void hash_ao2_changed(struct ao2_container_hash *self)
+{
+	struct hash_read_mostly *read_mostly = self->read_mostly;
+	struct hash_snapshot *snapshot;
+	int epoch;
+	int stripe;
+
+	ast_atomic_store_n(&read_mostly->misses, 0, __ATOMIC_RELAXED);
+	snapshot = ast_atomic_exchange_n(&read_mostly->snapshot, NULL, __ATOMIC_SEQ_CST);
+	if (!snapshot) {
+		return;
+	}
+
+	/*
+	 * Move new readers to the other epoch and wait for the readers
+	 * that could have loaded the old snapshot to leave.  Writers are
+	 * serialized by the container lock.
+	 */
+	epoch = read_mostly->epoch;
+	ast_atomic_store_n(&read_mostly->epoch, !epoch, __ATOMIC_SEQ_CST);
+	for (stripe = 0; stripe < HASH_SNAPSHOT_STRIPES; ++stripe) {
+		while (ast_atomic_load_n(&read_mostly->readers[epoch][stripe].count, __ATOMIC_SEQ_CST)) {
+			sched_yield();
+		}
+	}
+
+	hash_snapshot_free(snapshot);
+}
+
 /*!
  * \internal
  *
@@ -748,6 +1086,14 @@ static void hash_ao2_destroy(struct ao2_container_hash *self)
 			break;
 		}
 	}
+
+	if (self->read_mostly) {
+		/* Nobody can be searching the snapshot anymore. */
+		hash_snapshot_free(self->read_mostly->snapshot);
+		ast_mutex_destroy(&self->read_mostly->build_lock);
+		ast_free(self->read_mostly);
+		self->read_mostly = NULL;
+	}
 }
 
 #if defined(AO2_DEBUG)
@@ -772,7 +1118,13 @@ static void hash_ao2_dump(struct ao2_container_hash *self, void *where, ao2_prnt
 	int suppressed_buckets = 0;
 	struct hash_bucket_node *node;
 
-	prnt(where, "Number of buckets: %d\n\n", self->n_buckets);
+	prnt(where, "Number of buckets: %d\n", self->n_buckets);
+	if (self->read_mostly) {
+		prnt(where, "Read-mostly snapshot: %s (rebuilt %d times)\n",
+			self->read_mostly->snapshot ? "current" : "stale",
+			self->read_mostly->rebuilds);
+	}
+	prnt(where, "\n");
 
 	prnt(where, FORMAT, "Bucket", "Node", "Prev", "Next", "Obj", "Key");
 	for (bucket = 0; bucket < self->n_buckets; ++bucket) {
@@ -1028,6 +1380,26 @@ static const struct ao2_container_methods v_table_hash = {
 #endif	/* defined(AO2_DEBUG) */
 };
 
+/*! Read-mostly hash container virtual method table. */
+static const struct ao2_container_methods v_table_hash_read_mostly = {
+	.alloc_empty_clone = (ao2_container_alloc_empty_clone_fn) hash_ao2_alloc_empty_clone,
+	.new_node = (ao2_container_new_node_fn) hash_ao2_new_node,
+	.insert = (ao2_container_insert_fn) hash_ao2_insert_node,
+	.traverse_first = (ao2_container_find_first_fn) hash_ao2_find_first,
+	.traverse_next = (ao2_container_find_next_fn) hash_ao2_find_next,
+	.iterator_next = (ao2_iterator_next_fn) hash_ao2_iterator_next,
+	.unlocked_find = (ao2_container_unlocked_find_fn) hash_ao2_unlocked_find,
+	.changed = (ao2_container_changed_fn) hash_ao2_changed,
+	.destroy = (ao2_container_destroy_fn) hash_ao2_destroy,
+#if defined(AO2_DEBUG)
+	.link_stat = hash_ao2_link_node_stat,
+	.unlink_stat = hash_ao2_unlink_node_stat,
+	.dump = (ao2_container_display) hash_ao2_dump,
+	.stats = (ao2_container_statistics) hash_ao2_stats,
+	.integrity = (ao2_container_integrity) hash_ao2_integrity,
+#endif	/* defined(AO2_DEBUG) */
+};
+
 /*!
  * \brief always zero hash function
  *
@@ -1073,6 +1445,16 @@ static struct ao2_container *hash_ao2_container_init(
 	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
 #endif	/* defined(AO2_DEBUG) */
 
+	if (options & AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY) {
+		self->read_mostly = ast_calloc(1, sizeof(*self->read_mostly));
+		if (!self->read_mostly) {
+			ao2_ref(self, -1);
+			return NULL;
+		}
+		ast_mutex_init(&self->read_mostly->build_lock);
+		self->common.v_table = &v_table_hash_read_mostly;
+	}
+
 	return (struct ao2_container *) self;
 }
 
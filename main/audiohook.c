@@ -52,6 +52,15 @@ struct ast_audiohook_translate {
 	struct ast_format *format;
 };
 
+/*! \brief Resamples the frames given to the spies, for the spies at another rate */
+struct ast_audiohook_resample {
+	struct ast_trans_pvt *trans_pvt;
+	/*! The format of the frames given to the spies */
+	struct ast_format *src_format;
+	/*! The format of the spies at another rate */
+	struct ast_format *dst_format;
+};
+
 struct ast_audiohook_list {
 	/* If all the audiohooks in this list are capable
 	 * of processing slinear at any sample rate, this
@@ -62,6 +71,7 @@ struct ast_audiohook_list {
 
 	struct ast_audiohook_translate in_translate[2];
 	struct ast_audiohook_translate out_translate[2];
+	struct ast_audiohook_resample spy_resample[2];
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) spy_list;
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) whisper_list;
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) manipulate_list;
@@ -250,21 +260,30 @@ static struct ast_frame *audiohook_read_frame_single(struct ast_audiohook *audio
 	return ast_frdup(&frame);
 }
 
-static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audiohook, size_t samples, struct ast_frame **read_reference, struct ast_frame **write_reference)
+/*!
+ * \internal
+ * \brief Read the audio of both directions, once either has enough of it
+ *
+ * \param audiohook Audiohook structure
+ * \param samples Number of samples wanted from each direction
+ * \param buf1 Buffer of samples for the read direction
+ * \param buf2 Buffer of samples for the write direction
+ * \param[out] read_buf buf1 if it was filled, else NULL
+ * \param[out] write_buf buf2 if it was filled, else NULL
+ *
+ * \retval 0 if the audio of a direction was read
+ * \retval -1 if it is not time to read yet
+ */
+static int audiohook_read_both(struct ast_audiohook *audiohook, size_t samples, short *buf1, short *buf2,
+	short **read_buf, short **write_buf)
 {
 	int count;
 	int usable_read;
 	int usable_write;
 	short adjust_value;
-	short buf1[samples];
-	short buf2[samples];
-	short *read_buf = NULL;
-	short *write_buf = NULL;
-	struct ast_frame frame = {
-		.frametype = AST_FRAME_VOICE,
-		.datalen = sizeof(buf1),
-		.samples = samples,
-	};
+
+	*read_buf = NULL;
+	*write_buf = NULL;
 
 	/* Make sure both factories have the required samples */
 	usable_read = (ast_slinfactory_available(&audiohook->read_factory) >= samples ? 1 : 0);
@@ -273,29 +292,29 @@ static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audioho
 	if (!usable_read && !usable_write) {
 		/* If both factories are unusable bail out */
 		ast_debug(1, "Read factory %p and write factory %p both fail to provide %zu samples\n", &audiohook->read_factory, &audiohook->write_factory, samples);
-		return NULL;
+		return -1;
 	}
 
 	/* If we want to provide only a read factory make sure we aren't waiting for other audio */
 	if (usable_read && !usable_write && (ast_tvdiff_ms(ast_tvnow(), audiohook->write_time) < (samples/8)*2)) {
 		ast_debug(3, "Write factory %p was pretty quick last time, waiting for them.\n", &audiohook->write_factory);
-		return NULL;
+		return -1;
 	}
 
 	/* If we want to provide only a write factory make sure we aren't waiting for other audio */
 	if (usable_write && !usable_read && (ast_tvdiff_ms(ast_tvnow(), audiohook->read_time) < (samples/8)*2)) {
 		ast_debug(3, "Read factory %p was pretty quick last time, waiting for them.\n", &audiohook->read_factory);
-		return NULL;
+		return -1;
 	}
 
 	/* Start with the read factory... if there are enough samples, read them in */
 	if (usable_read) {
 		if (ast_slinfactory_read(&audiohook->read_factory, buf1, samples)) {
-			read_buf = buf1;
+			*read_buf = buf1;
 
 			if ((ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_READ))) {
 				/* Clear the frame data if we are muting */
-				memset(buf1, 0, sizeof(buf1));
+				memset(buf1, 0, samples * sizeof(*buf1));
 			} else if (audiohook->options.read_volume) {
 				/* Adjust read volume if need be */
 				adjust_value = abs(audiohook->options.read_volume);
@@ -315,11 +334,11 @@ static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audioho
 	/* Move on to the write factory... if there are enough samples, read them in */
 	if (usable_write) {
 		if (ast_slinfactory_read(&audiohook->write_factory, buf2, samples)) {
-			write_buf = buf2;
+			*write_buf = buf2;
 
 			if ((ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_WRITE))) {
 				/* Clear the frame data if we are muting */
-				memset(buf2, 0, sizeof(buf2));
+				memset(buf2, 0, samples * sizeof(*buf2));
 			} else if (audiohook->options.write_volume) {
 				/* Adjust write volume if need be */
 				adjust_value = abs(audiohook->options.write_volume);
@@ -336,6 +355,26 @@ static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audioho
 		ast_debug(1, "Failed to get %d samples from write factory %p\n", (int)samples, &audiohook->write_factory);
 	}
 
+	return 0;
+}
+
+static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audiohook, size_t samples, struct ast_frame **read_reference, struct ast_frame **write_reference)
+{
+	int count;
+	short buf1[samples];
+	short buf2[samples];
+	short *read_buf;
+	short *write_buf;
+	struct ast_frame frame = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(buf1),
+		.samples = samples,
+	};
+
+	if (audiohook_read_both(audiohook, samples, buf1, buf2, &read_buf, &write_buf)) {
+		return NULL;
+	}
+
 	frame.subclass.format = ast_format_cache_get_slin_by_rate(audiohook->hook_internal_samp_rate);
 
 	/* Should we substitute silence if one side lacks audio? */
@@ -377,11 +416,14 @@ static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audioho
 	return ast_frdup(&frame);
 }
 
-static struct ast_frame *audiohook_read_frame_helper(struct ast_audiohook *audiohook, size_t samples, enum ast_audiohook_direction direction, struct ast_format *format, struct ast_frame **read_reference, struct ast_frame **write_reference)
+/*!
+ * \internal
+ * \brief Update the rate of the audiohook for a read in a format
+ *
+ * \return The number of samples to read at the rate of the audiohook
+ */
+static size_t audiohook_read_samples(struct ast_audiohook *audiohook, size_t samples, struct ast_format *format)
 {
-	struct ast_frame *read_frame = NULL, *final_frame = NULL;
-	struct ast_format *slin;
-
 	/*
 	 * Update the rate if compatibility mode is turned off or if it is
 	 * turned on and the format rate is higher than the current rate.
@@ -406,6 +448,16 @@ static struct ast_frame *audiohook_read_frame_helper(struct ast_audiohook *audio
 		samples = (audiohook->hook_internal_samp_rate / 1000) * (samples / (ast_format_get_sample_rate(format) / 1000));
 	}
 
+	return samples;
+}
+
+static struct ast_frame *audiohook_read_frame_helper(struct ast_audiohook *audiohook, size_t samples, enum ast_audiohook_direction direction, struct ast_format *format, struct ast_frame **read_reference, struct ast_frame **write_reference)
+{
+	struct ast_frame *read_frame = NULL, *final_frame = NULL;
+	struct ast_format *slin;
+
+	samples = audiohook_read_samples(audiohook, samples, format);
+
 	if (!(read_frame = (direction == AST_AUDIOHOOK_DIRECTION_BOTH ?
 		audiohook_read_frame_both(audiohook, samples, read_reference, write_reference) :
 		audiohook_read_frame_single(audiohook, samples, direction)))) {
@@ -465,6 +517,54 @@ struct ast_frame *ast_audiohook_read_frame_all(struct ast_audiohook *audiohook,
 	return audiohook_read_frame_helper(audiohook, samples, AST_AUDIOHOOK_DIRECTION_BOTH, format, read_frame, write_frame);
 }
 
+struct ast_frame *ast_audiohook_read_frame_interleaved(struct ast_audiohook *audiohook, size_t samples, struct ast_format *format)
+{
+	size_t count;
+	short *read_buf;
+	short *write_buf;
+	short *buf;
+	struct ast_frame frame = {
+		.frametype = AST_FRAME_VOICE,
+	};
+
+	samples = audiohook_read_samples(audiohook, samples, format);
+	frame.subclass.format = ast_format_cache_get_slin_by_rate(audiohook->hook_internal_samp_rate);
+	if (ast_format_cmp(format, frame.subclass.format) != AST_FORMAT_CMP_EQUAL) {
+		/* There are no translators for more than one channel */
+		return NULL;
+	}
+
+	{
+		short buf1[samples];
+		short buf2[samples];
+		short interleaved[samples * 2];
+
+		if (audiohook_read_both(audiohook, samples, buf1, buf2, &read_buf, &write_buf)) {
+			return NULL;
+		}
+
+		/* A direction lacking audio is silent, so both keep their place in time */
+		if (!read_buf) {
+			read_buf = memset(buf1, 0, sizeof(buf1));
+		}
+		if (!write_buf) {
+			write_buf = memset(buf2, 0, sizeof(buf2));
+		}
+
+		buf = interleaved;
+		for (count = 0; count < samples; count++) {
+			*buf++ = read_buf[count];
+			*buf++ = write_buf[count];
+		}
+
+		frame.data.ptr = interleaved;
+		frame.datalen = sizeof(interleaved);
+		frame.samples = samples;
+
+		return ast_frdup(&frame);
+	}
+}
+
 static void audiohook_list_set_samplerate_compatibility(struct ast_audiohook_list *audiohook_list)
 {
 	struct ast_audiohook *ah = NULL;
@@ -615,8 +715,13 @@ void ast_audiohook_detach_list(struct ast_audiohook_list *audiohook_list)
 		}
 		if (audiohook_list->out_translate[i].trans_pvt) {
 			ast_translator_free_path(audiohook_list->out_translate[i].trans_pvt);
-			ao2_cleanup(audiohook_list->in_translate[i].format);
+			ao2_cleanup(audiohook_list->out_translate[i].format);
 		}
+		if (audiohook_list->spy_resample[i].trans_pvt) {
+			ast_translator_free_path(audiohook_list->spy_resample[i].trans_pvt);
+		}
+		ao2_cleanup(audiohook_list->spy_resample[i].src_format);
+		ao2_cleanup(audiohook_list->spy_resample[i].dst_format);
 	}
 
 	/* Free ourselves */
@@ -890,6 +995,57 @@ static struct ast_frame *audiohook_list_translate_to_native(struct ast_audiohook
 	return outframe;
 }
 
+/*!
+ * \internal
+ * \brief Get the frame a spy is given, at the rate of the spy
+ *
+ * The frame is resampled once for all the spies at the same rate, rather
+ * than by the factory of each of them. Spies at a rate other than the first
+ * one found still resample in their factories.
+ *
+ * \param audiohook_list The list of audiohooks
+ * \param direction The direction of the frame
+ * \param slin_frame The signed linear frame of the list
+ * \param audiohook The spy
+ * \param[in,out] resampled The frame resampled so far by this pass over the spies
+ *
+ * \return The frame for the spy
+ */
+static struct ast_frame *audiohook_list_spy_frame(struct ast_audiohook_list *audiohook_list,
+	enum ast_audiohook_direction direction, struct ast_frame *slin_frame,
+	struct ast_audiohook *audiohook, struct ast_frame **resampled)
+{
+	struct ast_audiohook_resample *resample = (direction == AST_AUDIOHOOK_DIRECTION_READ ?
+		&audiohook_list->spy_resample[0] : &audiohook_list->spy_resample[1]);
+	struct ast_format *slin;
+
+	if (audiohook->hook_internal_samp_rate == ast_format_get_sample_rate(slin_frame->subclass.format)) {
+		return slin_frame;
+	}
+
+	slin = ast_format_cache_get_slin_by_rate(audiohook->hook_internal_samp_rate);
+	if (*resampled) {
+		return ast_format_cmp((*resampled)->subclass.format, slin) == AST_FORMAT_CMP_EQUAL ?
+			*resampled : slin_frame;
+	}
+
+	if (!resample->trans_pvt
+		|| ast_format_cmp(resample->src_format, slin_frame->subclass.format) != AST_FORMAT_CMP_EQUAL
+		|| ast_format_cmp(resample->dst_format, slin) != AST_FORMAT_CMP_EQUAL) {
+		if (resample->trans_pvt) {
+			ast_translator_free_path(resample->trans_pvt);
+		}
+		resample->trans_pvt = ast_translator_build_path(slin, slin_frame->subclass.format);
+		ao2_replace(resample->src_format, slin_frame->subclass.format);
+		ao2_replace(resample->dst_format, slin);
+	}
+	if (!resample->trans_pvt || !(*resampled = ast_translate(resample->trans_pvt, slin_frame, 0))) {
+		return slin_frame;
+	}
+
+	return *resampled;
+}
+
 /*!
  *\brief Set the audiohook's internal sample rate to the audiohook_list's rate,
  *       but only when native slin compatibility is turned on.
@@ -946,6 +1102,7 @@ static void audiohook_list_set_hook_rate(struct ast_audiohook_list *audiohook_li
 static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, struct ast_audiohook_list *audiohook_list, enum ast_audiohook_direction direction, struct ast_frame *frame)
 {
 	struct ast_frame *start_frame = frame, *middle_frame = frame, *end_frame = frame;
+	struct ast_frame *spy_frame = NULL;
 	struct ast_audiohook *audiohook = NULL;
 	int samples;
 	int middle_frame_manipulated = 0;
@@ -996,11 +1153,21 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 			}
 			continue;
 		}
+		if (ast_test_flag(audiohook, direction == AST_AUDIOHOOK_DIRECTION_READ
+				? AST_AUDIOHOOK_SKIP_READ : AST_AUDIOHOOK_SKIP_WRITE)) {
+			/* Nobody would ever read it back out */
+			ast_audiohook_unlock(audiohook);
+			continue;
+		}
 		audiohook_list_set_hook_rate(audiohook_list, audiohook, &internal_sample_rate);
-		ast_audiohook_write_frame(audiohook, direction, middle_frame);
+		ast_audiohook_write_frame(audiohook, direction,
+			audiohook_list_spy_frame(audiohook_list, direction, middle_frame, audiohook, &spy_frame));
 		ast_audiohook_unlock(audiohook);
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
+	if (spy_frame) {
+		ast_frfree(spy_frame);
+	}
 
 	/* If this frame is being written out to the channel then we need to use whisper sources */
 	if (!AST_LIST_EMPTY(&audiohook_list->whisper_list)) {
@@ -126,6 +126,44 @@ static AST_RWLIST_HEAD_STATIC(bridge_technologies, ast_bridge_technology);
 
 static unsigned int optimization_id;
 
+/*! Bridge technology switches made by smart_bridge_operation() */
+static struct {
+	/*! Technology switches completed */
+	unsigned int completed;
+	/*! Technology switches abandoned because the new technology failed */
+	unsigned int failed;
+	/*! Total time the bridges were locked switching technology in microseconds */
+	int64_t duration_sum;
+	/*! Longest time a bridge was locked switching technology in microseconds */
+	int64_t duration_max;
+} tech_switch_stats;
+
+AST_MUTEX_DEFINE_STATIC(tech_switch_stats_lock);
+
+/*!
+ * \internal
+ * \brief Account for a bridge technology switch.
+ *
+ * \param start When the switch started.
+ * \param failed Non-zero if the new technology could not be set up.
+ */
+static void tech_switch_stats_update(struct timeval start, int failed)
+{
+	int64_t duration = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_mutex_lock(&tech_switch_stats_lock);
+	if (failed) {
+		++tech_switch_stats.failed;
+	} else {
+		++tech_switch_stats.completed;
+	}
+	tech_switch_stats.duration_sum += duration;
+	if (tech_switch_stats.duration_max < duration) {
+		tech_switch_stats.duration_max = duration;
+	}
+	ast_mutex_unlock(&tech_switch_stats_lock);
+}
+
 /* Initial starting point for the bridge array of channels */
 #define BRIDGE_ARRAY_START 128
 
@@ -1002,6 +1040,7 @@ static int smart_bridge_operation(struct ast_bridge *bridge)
 	struct ast_bridge_technology *old_technology = bridge->technology;
 	struct ast_bridge_channel *bridge_channel;
 	struct ast_frame *deferred_action;
+	struct timeval start;
 	struct ast_bridge dummy_bridge = {
 		.technology = bridge->technology,
 		.tech_pvt = bridge->tech_pvt,
@@ -1084,6 +1123,7 @@ static int smart_bridge_operation(struct ast_bridge *bridge)
 	} else {
 		deferred_action = NULL;
 	}
+	start = ast_tvnow();
 
 	/*
 	 * We are now committed to changing the bridge technology.  We
@@ -1111,6 +1151,10 @@ static int smart_bridge_operation(struct ast_bridge *bridge)
 		bridge->tech_pvt = dummy_bridge.tech_pvt;
 		bridge->technology = dummy_bridge.technology;
 		ast_module_unref(new_technology->mod);
+		if (deferred_action) {
+			ast_frfree(deferred_action);
+		}
+		tech_switch_stats_update(start, 1);
 		return -1;
 	}
 
@@ -1188,6 +1232,11 @@ static int smart_bridge_operation(struct ast_bridge *bridge)
 		ast_module_unref(old_technology->mod);
 	}
 
+	tech_switch_stats_update(start, 0);
+	ast_debug(1, "Bridge %s: switched from %s technology to %s in %" PRId64 " us\n",
+		bridge->uniqueid, old_technology->name, new_technology->name,
+		ast_tvdiff_us(ast_tvnow(), start));
+
 	return 0;
 }
 
@@ -3763,6 +3812,13 @@ void ast_bridge_set_binaural_active(struct ast_bridge *bridge, unsigned int bina
 	ast_bridge_unlock(bridge);
 }
 
+void ast_bridge_set_max_mixed_talkers(struct ast_bridge *bridge, unsigned int max_mixed_talkers)
+{
+	ast_bridge_lock(bridge);
+	bridge->softmix.max_mixed_talkers = max_mixed_talkers;
+	ast_bridge_unlock(bridge);
+}
+
 void ast_bridge_set_internal_sample_rate(struct ast_bridge *bridge, unsigned int sample_rate)
 {
 	ast_bridge_lock(bridge);
@@ -3856,6 +3912,15 @@ void ast_brige_set_remb_behavior(struct ast_bridge *bridge, enum ast_bridge_vide
 	ast_bridge_unlock(bridge);
 }
 
+void ast_bridge_set_remb_min_bitrate(struct ast_bridge *bridge, unsigned int remb_min_bitrate)
+{
+	ast_assert(bridge->softmix.video_mode.mode == AST_BRIDGE_VIDEO_MODE_SFU);
+
+	ast_bridge_lock(bridge);
+	bridge->softmix.video_mode.mode_data.sfu_data.remb_min_bitrate = remb_min_bitrate;
+	ast_bridge_unlock(bridge);
+}
+
 void ast_bridge_update_talker_src_video_mode(struct ast_bridge *bridge, struct ast_channel *chan, int talker_energy, int is_keyframe)
 {
 	struct ast_bridge_video_talker_src_data *data;
@@ -5350,6 +5415,17 @@ static char *handle_bridge_technology_show(struct ast_cli_entry *e, int cmd, str
 			AST_CLI_YESNO(cur->suspended));
 	}
 	AST_RWLIST_UNLOCK(&bridge_technologies);
+
+	ast_mutex_lock(&tech_switch_stats_lock);
+	ast_cli(a->fd, "\nTechnology switches: %u completed, %u failed\n",
+		tech_switch_stats.completed, tech_switch_stats.failed);
+	if (tech_switch_stats.completed + tech_switch_stats.failed) {
+		ast_cli(a->fd, "Switch duration: %" PRId64 " us average, %" PRId64 " us longest\n",
+			tech_switch_stats.duration_sum
+				/ (tech_switch_stats.completed + tech_switch_stats.failed),
+			tech_switch_stats.duration_max);
+	}
+	ast_mutex_unlock(&tech_switch_stats_lock);
 	return CLI_SUCCESS;
 
 #undef FORMAT
@@ -57,6 +57,8 @@
 #include "asterisk/sem.h"
 #include "asterisk/stream.h"
 #include "asterisk/message.h"
+#include "asterisk/trace_span.h"
+#include "asterisk/frame_timing.h"
 
 /*!
  * \brief Used to queue an action frame onto a bridge channel and write an action frame into a bridge.
@@ -693,6 +695,7 @@ static int bridge_channel_write_frame(struct ast_bridge_channel *bridge_channel,
 		frame->stream_num = -1;
 	}
 
+	AST_FRAME_TIMING_RECORD(AST_FRAME_TIMING_BRIDGE, bridge_channel->bridge->technology->name, frame);
 	deferred = bridge_channel->bridge->technology->write(bridge_channel->bridge, bridge_channel, frame);
 	if (deferred) {
 		struct ast_frame *dup;
@@ -1026,7 +1029,15 @@ static void bridge_frame_free(struct ast_frame *frame)
 	ast_frfree(frame);
 }
 
-int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
+/*!
+ * \internal
+ * \brief Queue a frame to the bridge channel write queue.
+ *
+ * \param bridge_channel Channel to queue the frame.
+ * \param fr Frame to queue.
+ * \param share TRUE if the queued frame may share the data buffer of fr.
+ */
+static int bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr, int share)
 {
 	struct ast_frame *dup;
 
@@ -1043,7 +1054,7 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 		return 0;
 	}
 
-	dup = ast_frdup(fr);
+	dup = share ? ast_frame_share(fr) : ast_frdup(fr);
 	if (!dup) {
 		return -1;
 	}
@@ -1079,9 +1090,20 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 	return 0;
 }
 
+int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
+{
+	return bridge_channel_queue_frame(bridge_channel, fr, 0);
+}
+
+int ast_bridge_channel_queue_shared_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
+{
+	return bridge_channel_queue_frame(bridge_channel, fr, 1);
+}
+
 int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
 {
 	struct ast_bridge_channel *cur;
+	struct ast_frame *shared = NULL;
 	int not_written = -1;
 
 	if (frame->frametype == AST_FRAME_NULL) {
@@ -1089,14 +1111,26 @@ int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_
 		return 0;
 	}
 
+	if (bridge->num_channels - (bridge_channel ? 1 : 0) > 1) {
+		/*
+		 * Copy the frame data once and have every write queue
+		 * reference it.  If the copy fails each channel simply
+		 * gets its own copy.
+		 */
+		shared = ast_frame_share(frame);
+	}
+
 	AST_LIST_TRAVERSE(&bridge->channels, cur, entry) {
 		if (cur == bridge_channel) {
 			continue;
 		}
-		if (!ast_bridge_channel_queue_frame(cur, frame)) {
+		if (!bridge_channel_queue_frame(cur, shared ?: frame, shared ? 1 : 0)) {
 			not_written = 0;
 		}
 	}
+	if (shared) {
+		ast_frfree(shared);
+	}
 	return not_written;
 }
 
@@ -2436,6 +2470,8 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 		ast_sendtext_data(bridge_channel->chan, msg);
 		break;
 	default:
+		AST_FRAME_TIMING_RECORD(AST_FRAME_TIMING_QUEUE, NULL, fr);
+
 		/* Assume that there is no mapped stream for this */
 		num = -1;
 
@@ -2454,6 +2490,14 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 			}
 		}
 
+		/*
+		 * The channel may modify the frame data while writing it,
+		 * so it needs a private copy if other channels share it.
+		 */
+		if (ast_frame_unshare(fr)) {
+			break;
+		}
+
 		/* Write the frame to the channel. */
 		bridge_channel->activity = BRIDGE_CHANNEL_THREAD_SIMPLE;
 		ast_write_stream(bridge_channel->chan, num, fr);
@@ -2823,6 +2867,7 @@ int bridge_channel_internal_join(struct ast_bridge_channel *bridge_channel)
 	uint8_t indicate_src_change = 0;
 	struct ast_bridge_features *channel_features;
 	struct ast_channel *swap;
+	AST_TRACE_SPAN_BEGIN(span);
 
 	ast_debug(1, "Bridge %s: %p(%s) is joining\n",
 		bridge_channel->bridge->uniqueid,
@@ -2901,10 +2946,18 @@ int bridge_channel_internal_join(struct ast_bridge_channel *bridge_channel)
 		swap = NULL;
 
 		if (indicate_src_change) {
+			/*
+			 * An unreal channel tries to optimize out when told of the
+			 * source change, which it only may while we are writing a
+			 * simple frame to it.
+			 */
+			bridge_channel->activity = BRIDGE_CHANNEL_THREAD_SIMPLE;
 			ast_indicate(bridge_channel->chan, AST_CONTROL_SRCCHANGE);
+			bridge_channel->activity = BRIDGE_CHANNEL_THREAD_IDLE;
 		}
 
 		bridge_channel_event_join_leave(bridge_channel, AST_BRIDGE_HOOK_TYPE_JOIN);
+		AST_TRACE_SPAN_END(span, "bridge_join", ast_channel_uniqueid(bridge_channel->chan));
 
 		while (bridge_channel->state == BRIDGE_CHANNEL_STATE_WAIT) {
 			/* Wait for something to do. */
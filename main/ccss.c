@@ -1332,6 +1332,9 @@ static struct ast_cc_monitor_callbacks generic_monitor_cbs = {
 
 struct ao2_container *generic_monitors;
 
+/*! \brief Subscription to the state of all devices, shared by every generic monitor */
+static struct stasis_subscription *generic_monitor_devstate_sub;
+
 struct generic_monitor_instance {
 	int core_id;
 	int is_suspended;
@@ -1358,7 +1361,6 @@ struct generic_monitor_instance_list {
 	 * recalled
 	 */
 	int fit_for_recall;
-	struct stasis_subscription *sub;
 	AST_LIST_HEAD_NOLOCK(, generic_monitor_instance) list;
 };
 
@@ -1398,20 +1400,17 @@ static void generic_monitor_instance_list_destructor(void *obj)
 	struct generic_monitor_instance_list *generic_list = obj;
 	struct generic_monitor_instance *generic_instance;
 
-	generic_list->sub = stasis_unsubscribe(generic_list->sub);
 	while ((generic_instance = AST_LIST_REMOVE_HEAD(&generic_list->list, next))) {
 		ast_free(generic_instance);
 	}
 	ast_free((char *)generic_list->device_name);
 }
 
-static void generic_monitor_devstate_cb(void *userdata, struct stasis_subscription *sub, struct stasis_message *msg);
 static struct generic_monitor_instance_list *create_new_generic_list(struct ast_cc_monitor *monitor)
 {
 	struct generic_monitor_instance_list *generic_list = ao2_t_alloc(sizeof(*generic_list),
 			generic_monitor_instance_list_destructor, "allocate generic monitor instance list");
 	char * device_name;
-	struct stasis_topic *device_specific_topic;
 
 	if (!generic_list) {
 		return NULL;
@@ -1424,17 +1423,6 @@ static struct generic_monitor_instance_list *create_new_generic_list(struct ast_
 	ast_tech_to_upper(device_name);
 	generic_list->device_name = device_name;
 
-	device_specific_topic = ast_device_state_topic(device_name);
-	if (!device_specific_topic) {
-		return NULL;
-	}
-
-	if (!(generic_list->sub = stasis_subscribe(device_specific_topic, generic_monitor_devstate_cb, NULL))) {
-		cc_unref(generic_list, "Failed to subscribe to device state");
-		return NULL;
-	}
-	stasis_subscription_accept_message_type(generic_list->sub, ast_device_state_message_type());
-	stasis_subscription_set_filter(generic_list->sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 	generic_list->current_state = ast_device_state(monitor->interface->device_name);
 	ao2_t_link(generic_monitors, generic_list, "linking new generic monitor instance list");
 	return generic_list;
@@ -1489,6 +1477,8 @@ static void generic_monitor_devstate_cb(void *userdata, struct stasis_subscripti
 	 * no steenkin' locks!
 	 */
 	struct ast_device_state_message *dev_state;
+	struct generic_monitor_instance_list *generic_list;
+
 	if (ast_device_state_message_type() != stasis_message_type(msg)) {
 		return;
 	}
@@ -1499,6 +1489,19 @@ static void generic_monitor_devstate_cb(void *userdata, struct stasis_subscripti
 		return;
 	}
 
+	/* The state of every device comes through here, so only bother the core
+	 * with those of devices being monitored. The taskprocessor callback looks
+	 * the list up again as it may be gone by then.
+	 */
+	if (!ao2_container_count(generic_monitors)) {
+		return;
+	}
+	generic_list = find_generic_monitor_instance_list(dev_state->device);
+	if (!generic_list) {
+		return;
+	}
+	cc_unref(generic_list, "Device is monitored, done with generic list in devstate callback");
+
 	ao2_t_ref(dev_state, +1, "Bumping dev_state ref for cc_core_taskprocessor");
 	if (ast_taskprocessor_push(cc_core_taskprocessor, generic_monitor_devstate_tp_cb, dev_state)) {
 		ao2_cleanup(dev_state);
@@ -4622,6 +4625,7 @@ static struct ast_cli_entry cc_cli[] = {
 
 static int unload_module(void)
 {
+	generic_monitor_devstate_sub = stasis_unsubscribe_and_join(generic_monitor_devstate_sub);
 	ast_devstate_prov_del("ccss");
 	ast_cc_agent_unregister(&generic_agent_callbacks);
 	ast_cc_monitor_unregister(&generic_monitor_cbs);
@@ -4672,6 +4676,13 @@ static int load_module(void)
 	if (!(cc_core_taskprocessor = ast_taskprocessor_get("CCSS_core", TPS_REF_DEFAULT))) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
+	generic_monitor_devstate_sub = stasis_subscribe(ast_device_state_topic_all(),
+		generic_monitor_devstate_cb, NULL);
+	if (!generic_monitor_devstate_sub) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+	stasis_subscription_accept_message_type(generic_monitor_devstate_sub, ast_device_state_message_type());
+	stasis_subscription_set_filter(generic_monitor_devstate_sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 	if (!(cc_sched_context = ast_sched_context_create())) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
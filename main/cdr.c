@@ -166,10 +166,11 @@
 				<configOption name="scheduleronly">
 					<synopsis>Post batched CDRs on their own thread instead of the scheduler</synopsis>
 					<description><para>The CDR engine uses the internal asterisk scheduler to determine when to post
-					records.  Posting can either occur inside the scheduler thread, or a new
-					thread can be spawned for the submission of every batch.  For small batches,
-					it might be acceptable to just use the scheduler thread, so set this to <literal>yes</literal>.
-					For large batches, say anything over size=10, a new thread is recommended, so
+					records.  Posting can either occur inside the scheduler thread, or each backend
+					can post the batches from a queue of its own, so that a slow backend does not
+					delay the others.  For small batches, it might be acceptable to just use the
+					scheduler thread, so set this to <literal>yes</literal>.
+					For large batches, say anything over size=10, the queues are recommended, so
 					set this to <literal>no</literal>.</para>
 					</description>
 				</configOption>
@@ -200,6 +201,25 @@
 #define DEFAULT_BATCH_SCHEDULER_ONLY "0"
 #define DEFAULT_BATCH_SAFE_SHUTDOWN "1"
 
+/*!
+ * \brief Batches waiting on the queue of a backend past which a warning is logged
+ *
+ * The queue itself is unbounded. Batches are always queued, so they are
+ * posted in order and the scheduler thread does not wait on the backend.
+ */
+#define CDR_BACKEND_QUEUE_WARN 8
+
+/*!
+ * \brief Shards the CDR state machine is split across
+ *
+ * The messages regarding a channel are all handled by the shard its linkedid
+ * hashed to when it was created, each shard on a subscription of its own, so
+ * the channels of a call share a shard. A message that reaches into the CDRs
+ * of another shard waits for all of them to go idle and is handled by the
+ * dispatcher itself.
+ */
+#define CDR_SHARDS 8
+
 #define cdr_set_debug_mode(mod_cfg) \
 	do { \
 		cdr_debug_enabled = ast_test_flag(&(mod_cfg)->general->settings, CDR_DEBUG); \
@@ -322,6 +342,10 @@ struct cdr_beitem {
 	char name[20];
 	char desc[80];
 	ast_cdrbe be;
+	/*! Optional handler for a whole batch of records */
+	ast_cdrbe_batch be_batch;
+	/*! Queue the batches are posted to the backend from (backends only) */
+	struct ast_taskprocessor *queue;
 	AST_RWLIST_ENTRY(cdr_beitem) list;
 	int suspended:1;
 };
@@ -338,6 +362,14 @@ struct cdr_batch_item {
 	struct cdr_batch_item *next;
 };
 
+/*! \brief A submitted batch, shared by the backends posting it */
+struct cdr_post_batch {
+	/*! The records the backends are to store */
+	AST_VECTOR(, struct ast_cdr *) cdrs;
+	/*! The batch items owning the records */
+	struct cdr_batch_item *items;
+};
+
 /*! \brief The actual batch queue */
 static struct cdr_batch {
 	int size;
@@ -361,15 +393,34 @@ AST_MUTEX_DEFINE_STATIC(cdr_batch_lock);
 AST_MUTEX_DEFINE_STATIC(cdr_pending_lock);
 static ast_cond_t cdr_pending_cond;
 
-/*! \brief A container of the active master CDRs indexed by Party A channel uniqueid */
-static struct ao2_container *active_cdrs_master;
+/*! \brief Containers of the active master CDRs indexed by Party A channel uniqueid, sharded by it */
+static struct ao2_container *active_cdrs_master[CDR_SHARDS];
 
-/*! \brief A container of all active CDRs with a Party B indexed by Party B channel name */
-static struct ao2_container *active_cdrs_all;
+/*! \brief Containers of all active CDRs with a Party B indexed by Party B channel name, sharded by it */
+static struct ao2_container *active_cdrs_all[CDR_SHARDS];
 
-/*! \brief Message router for stasis messages regarding channel state */
+/*! \brief Message router forwarding the stasis messages regarding channel state to the shards */
 static struct stasis_message_router *stasis_router;
 
+/*! \brief The topics the messages of each shard are forwarded to */
+static struct stasis_topic *shard_topics[CDR_SHARDS];
+
+/*! \brief Message routers running the CDR state machine of each shard */
+static struct stasis_message_router *shard_routers[CDR_SHARDS];
+
+/*! \brief The shards the messages regarding a channel involve */
+struct cdr_channel_shards {
+	/*! The shard handling the CDRs of the channel */
+	int home;
+	/*! The shards with CDRs the channel may be the Party B of, only used by the dispatcher */
+	unsigned int party_b;
+	/*! The uniqueid of the channel */
+	char uniqueid[0];
+};
+
+/*! \brief Container of \ref cdr_channel_shards indexed by channel uniqueid */
+static struct ao2_container *channel_shards;
+
 /*! \brief Our subscription for bridges */
 static struct stasis_forward *bridge_subscription;
 
@@ -939,6 +990,46 @@ static int cdr_all_cmp_fn(void *obj, void *arg, int flags)
     return cmp ? 0 : CMP_MATCH;
 }
 
+/*!
+ * \internal
+ * \brief The shard of a channel uniqueid or name
+ */
+static int cdr_shard(const char *key)
+{
+	return ast_str_case_hash(key) % CDR_SHARDS;
+}
+
+/*! \brief The master CDR container with the channel uniqueid */
+#define cdr_master_container(uniqueid) active_cdrs_master[cdr_shard(uniqueid)]
+
+/*! \brief The all CDR container with the Party B channel name */
+#define cdr_all_container(party_b_name) active_cdrs_all[cdr_shard(party_b_name)]
+
+/*! \brief Hashing function for the shards of a channel */
+AO2_STRING_FIELD_HASH_FN(cdr_channel_shards, uniqueid)
+
+/*! \brief Comparison function for the shards of a channel */
+AO2_STRING_FIELD_CMP_FN(cdr_channel_shards, uniqueid)
+
+/*!
+ * \internal
+ * \brief The shard handling the CDRs of a channel
+ */
+static int cdr_channel_home(const char *uniqueid)
+{
+	struct cdr_channel_shards *shards;
+	int home;
+
+	shards = ao2_find(channel_shards, uniqueid, OBJ_SEARCH_KEY);
+	if (!shards) {
+		return cdr_shard(uniqueid);
+	}
+	home = shards->home;
+	ao2_ref(shards, -1);
+
+	return home;
+}
+
 /*!
  * \internal
  * \brief Relink the CDR because Party B's snapshot changed.
@@ -948,18 +1039,19 @@ static int cdr_all_cmp_fn(void *obj, void *arg, int flags)
  */
 static void cdr_all_relink(struct cdr_object *cdr)
 {
-	ao2_lock(active_cdrs_all);
+	if (cdr->party_b.snapshot
+		&& !strcasecmp(cdr->party_b_name, cdr->party_b.snapshot->base->name)) {
+		return;
+	}
+
+	/* The new name may hash to another shard */
+	ao2_unlink(cdr_all_container(cdr->party_b_name), cdr);
 	if (cdr->party_b.snapshot) {
-		if (strcasecmp(cdr->party_b_name, cdr->party_b.snapshot->base->name)) {
-			ao2_unlink_flags(active_cdrs_all, cdr, OBJ_NOLOCK);
-			ast_string_field_set(cdr, party_b_name, cdr->party_b.snapshot->base->name);
-			ao2_link_flags(active_cdrs_all, cdr, OBJ_NOLOCK);
-		}
+		ast_string_field_set(cdr, party_b_name, cdr->party_b.snapshot->base->name);
+		ao2_link(cdr_all_container(cdr->party_b_name), cdr);
 	} else {
-		ao2_unlink_flags(active_cdrs_all, cdr, OBJ_NOLOCK);
 		ast_string_field_set(cdr, party_b_name, "");
 	}
-	ao2_unlock(active_cdrs_all);
 }
 
 /*!
@@ -978,10 +1070,12 @@ static void cdr_all_unlink(struct cdr_object *cdr)
 
 	/* Hold a ref to the root CDR to ensure the list members don't go away on us. */
 	ao2_ref(cdr, +1);
-	ao2_lock(active_cdrs_all);
 	for (cur = cdr; cur; cur = next) {
 		next = cur->next;
-		ao2_unlink_flags(active_cdrs_all, cur, OBJ_NOLOCK);
+		if (ast_strlen_zero(cur->party_b_name)) {
+			continue;
+		}
+		ao2_unlink(cdr_all_container(cur->party_b_name), cur);
 		/*
 		 * It is safe to still use cur after unlinking because the
 		 * root CDR holds a ref to all the CDRs in the list and we
@@ -989,7 +1083,6 @@ static void cdr_all_unlink(struct cdr_object *cdr)
 		 */
 		ast_string_field_set(cur, party_b_name, "");
 	}
-	ao2_unlock(active_cdrs_all);
 	ao2_ref(cdr, -1);
 }
 
@@ -1753,7 +1846,7 @@ static enum process_bridge_enter_results single_state_process_bridge_enter(struc
 		struct cdr_object *cand_cdr_master;
 		struct cdr_object *cand_cdr;
 
-		cand_cdr_master = ao2_find(active_cdrs_master, channel_id, OBJ_SEARCH_KEY);
+		cand_cdr_master = ao2_find(cdr_master_container(channel_id), channel_id, OBJ_SEARCH_KEY);
 		if (!cand_cdr_master) {
 			continue;
 		}
@@ -1901,7 +1994,7 @@ static enum process_bridge_enter_results dial_state_process_bridge_enter(struct
 			struct cdr_object *cand_cdr_master;
 			struct cdr_object *cand_cdr;
 
-			cand_cdr_master = ao2_find(active_cdrs_master, channel_id, OBJ_SEARCH_KEY);
+			cand_cdr_master = ao2_find(cdr_master_container(channel_id), channel_id, OBJ_SEARCH_KEY);
 			if (!cand_cdr_master) {
 				continue;
 			}
@@ -2141,9 +2234,9 @@ static void handle_dial_message(void *data, struct stasis_subscription *sub, str
 
 	/* Figure out who is running this show */
 	if (caller) {
-		cdr = ao2_find(active_cdrs_master, caller->base->uniqueid, OBJ_SEARCH_KEY);
+		cdr = ao2_find(cdr_master_container(caller->base->uniqueid), caller->base->uniqueid, OBJ_SEARCH_KEY);
 	} else {
-		cdr = ao2_find(active_cdrs_master, peer->base->uniqueid, OBJ_SEARCH_KEY);
+		cdr = ao2_find(cdr_master_container(peer->base->uniqueid), peer->base->uniqueid, OBJ_SEARCH_KEY);
 	}
 	if (!cdr) {
 		ast_log(AST_LOG_WARNING, "No CDR for channel %s\n", caller ? caller->base->name : peer->base->name);
@@ -2268,6 +2361,22 @@ static int check_new_cdr_needed(struct ast_channel_snapshot *old_snapshot,
 	return 1;
 }
 
+/*!
+ * \internal
+ * \brief Check if a channel is the Party B of any CDR
+ */
+static int cdr_is_party_b(const char *name)
+{
+	struct cdr_object *cdr;
+
+	cdr = ao2_find(cdr_all_container(name), (char *) name, OBJ_SEARCH_KEY);
+	if (!cdr) {
+		return 0;
+	}
+	ao2_ref(cdr, -1);
+	return 1;
+}
+
 /*!
  * \brief Handler for channel snapshot update messages
  * \param data Passed on
@@ -2291,9 +2400,10 @@ static void handle_channel_snapshot_update_message(void *data, struct stasis_sub
 			return;
 		}
 		cdr->is_root = 1;
-		ao2_link(active_cdrs_master, cdr);
+		ao2_link(cdr_master_container(cdr->uniqueid), cdr);
 	} else {
-		cdr = ao2_find(active_cdrs_master, update->new_snapshot->base->uniqueid, OBJ_SEARCH_KEY);
+		cdr = ao2_find(cdr_master_container(update->new_snapshot->base->uniqueid),
+			update->new_snapshot->base->uniqueid, OBJ_SEARCH_KEY);
 	}
 
 	/* Handle Party A */
@@ -2323,29 +2433,37 @@ static void handle_channel_snapshot_update_message(void *data, struct stasis_sub
 		ao2_unlock(cdr);
 	}
 
-	if (ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
+	if (cdr && ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
 		ao2_lock(cdr);
 		CDR_DEBUG("%p - Beginning finalize/dispatch for %s\n", cdr, update->old_snapshot->base->name);
 		for (it_cdr = cdr; it_cdr; it_cdr = it_cdr->next) {
 			it_cdr->lastevent = *stasis_message_timestamp(message);
 			cdr_object_finalize(it_cdr);
 		}
-		cdr_object_dispatch(cdr);
 		ao2_unlock(cdr);
 
 		cdr_all_unlink(cdr);
-		ao2_unlink(active_cdrs_master, cdr);
+		ao2_unlink(cdr_master_container(cdr->uniqueid), cdr);
+	}
+
+	/* No one else can reach the records now, so the backends do not hold up the other shards */
+	if (cdr && ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
+		ao2_lock(cdr);
+		cdr_object_dispatch(cdr);
+		ao2_unlock(cdr);
 	}
 
 	/* Handle Party B */
-	if (update->new_snapshot) {
-		ao2_callback_data(active_cdrs_all, OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
+	if (cdr_is_party_b(update->new_snapshot->base->name)) {
+		ao2_callback_data(cdr_all_container(update->new_snapshot->base->name),
+			OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
 			cdr_object_update_party_b, (char *) update->new_snapshot->base->name, update->new_snapshot);
-	}
 
-	if (ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
-		ao2_callback_data(active_cdrs_all, OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
-			cdr_object_finalize_party_b, (char *) update->new_snapshot->base->name, update->new_snapshot);
+		if (ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
+			ao2_callback_data(cdr_all_container(update->new_snapshot->base->name),
+				OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
+				cdr_object_finalize_party_b, (char *) update->new_snapshot->base->name, update->new_snapshot);
+		}
 	}
 
 	ao2_cleanup(cdr);
@@ -2429,7 +2547,7 @@ static void handle_bridge_leave_message(void *data, struct stasis_subscription *
 		(unsigned int)leave_data.lastevent->tv_sec,
 		(unsigned int)leave_data.lastevent->tv_usec);
 
-	cdr = ao2_find(active_cdrs_master, channel->base->uniqueid, OBJ_SEARCH_KEY);
+	cdr = ao2_find(cdr_master_container(channel->base->uniqueid), channel->base->uniqueid, OBJ_SEARCH_KEY);
 	if (!cdr) {
 		ast_log(AST_LOG_WARNING, "No CDR for channel %s\n", channel->base->name);
 		ast_assert(0);
@@ -2455,7 +2573,8 @@ static void handle_bridge_leave_message(void *data, struct stasis_subscription *
 	/* Party B */
 	if (left_bridge
 		&& strcmp(bridge->subclass, "parking")) {
-		ao2_callback_data(active_cdrs_all, OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
+		ao2_callback_data(cdr_all_container(leave_data.channel->base->name),
+			OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
 			cdr_object_party_b_left_bridge_cb, (char *) leave_data.channel->base->name,
 			&leave_data);
 	}
@@ -2567,7 +2686,7 @@ static void handle_bridge_pairings(struct cdr_object *cdr, struct ast_bridge_sna
 	while ((channel_id = ao2_iterator_next(&it_channels))) {
 		struct cdr_object *cand_cdr;
 
-		cand_cdr = ao2_find(active_cdrs_master, channel_id, OBJ_SEARCH_KEY);
+		cand_cdr = ao2_find(cdr_master_container(channel_id), channel_id, OBJ_SEARCH_KEY);
 		if (cand_cdr) {
 			bridge_candidate_process(cdr, cand_cdr);
 			ao2_ref(cand_cdr, -1);
@@ -2726,7 +2845,7 @@ static void handle_bridge_enter_message(void *data, struct stasis_subscription *
 		(unsigned int)stasis_message_timestamp(message)->tv_sec,
 		(unsigned int)stasis_message_timestamp(message)->tv_usec);
 
-	cdr = ao2_find(active_cdrs_master, channel->base->uniqueid, OBJ_SEARCH_KEY);
+	cdr = ao2_find(cdr_master_container(channel->base->uniqueid), channel->base->uniqueid, OBJ_SEARCH_KEY);
 	if (!cdr) {
 		ast_log(AST_LOG_WARNING, "No CDR for channel %s\n", channel->base->name);
 		ast_assert(0);
@@ -2776,7 +2895,7 @@ static void handle_parked_call_message(void *data, struct stasis_subscription *s
 		(unsigned int)stasis_message_timestamp(message)->tv_sec,
 		(unsigned int)stasis_message_timestamp(message)->tv_usec);
 
-	cdr = ao2_find(active_cdrs_master, channel->base->uniqueid, OBJ_SEARCH_KEY);
+	cdr = ao2_find(cdr_master_container(channel->base->uniqueid), channel->base->uniqueid, OBJ_SEARCH_KEY);
 	if (!cdr) {
 		ast_log(AST_LOG_WARNING, "No CDR for channel %s\n", channel->base->name);
 		ast_assert(0);
@@ -2899,7 +3018,8 @@ int ast_cdr_backend_unsuspend(const char *name)
 	return success;
 }
 
-static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc, ast_cdrbe be)
+static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc,
+	ast_cdrbe be, ast_cdrbe_batch be_batch)
 {
 	struct cdr_beitem *i;
 	struct cdr_beitem *cur;
@@ -2920,14 +3040,27 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 	}
 
 	i->be = be;
+	i->be_batch = be_batch;
 	ast_copy_string(i->name, name, sizeof(i->name));
 	ast_copy_string(i->desc, desc, sizeof(i->desc));
 
+	if (generic_list == &be_list) {
+		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		snprintf(tps_name, sizeof(tps_name), "cdr-be/%s", i->name);
+		i->queue = ast_taskprocessor_get(tps_name, TPS_REF_DEFAULT);
+		if (!i->queue) {
+			ast_free(i);
+			return -1;
+		}
+	}
+
 	AST_RWLIST_WRLOCK(generic_list);
 	AST_RWLIST_TRAVERSE(generic_list, cur, list) {
 		if (!strcasecmp(name, cur->name)) {
 			ast_log(LOG_WARNING, "Already have a CDR backend called '%s'\n", name);
 			AST_RWLIST_UNLOCK(generic_list);
+			ast_taskprocessor_unreference(i->queue);
 			ast_free(i);
 
 			return -1;
@@ -2942,18 +3075,24 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register(&be_list, name, desc, be);
+	return cdr_generic_register(&be_list, name, desc, be, NULL);
+}
+
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch be_batch)
+{
+	return cdr_generic_register(&be_list, name, desc, be, be_batch);
 }
 
 int ast_cdr_modifier_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be);
+	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be, NULL);
 }
 
 static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *name)
 {
 	struct cdr_beitem *match = NULL;
 	int active_count;
+	int idx;
 
 	AST_RWLIST_WRLOCK(generic_list);
 	AST_RWLIST_TRAVERSE(generic_list, match, list) {
@@ -2967,7 +3106,9 @@ static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *
 		return 0;
 	}
 
-	active_count = ao2_container_count(active_cdrs_master);
+	for (active_count = 0, idx = 0; idx < CDR_SHARDS; ++idx) {
+		active_count += ao2_container_count(active_cdrs_master[idx]);
+	}
 
 	if (!match->suspended && active_count != 0) {
 		AST_RWLIST_UNLOCK(generic_list);
@@ -2979,6 +3120,9 @@ static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *
 	AST_RWLIST_REMOVE(generic_list, match, list);
 	AST_RWLIST_UNLOCK(generic_list);
 
+	/* Whatever was queued for the backend is posted before it goes */
+	ast_taskprocessor_unreference(match->queue);
+
 	ast_verb(2, "Unregistered '%s' CDR backend\n", name);
 	ast_free(match);
 
@@ -3181,6 +3325,7 @@ int ast_cdr_setvar(const char *channel_name, const char *name, const char *value
 	struct cdr_object *it_cdr;
 	struct ao2_iterator *it_cdrs;
 	char *arg = ast_strdupa(channel_name);
+	int shard;
 	int x;
 
 	for (x = 0; cdr_readonly_vars[x]; x++) {
@@ -3190,32 +3335,35 @@ int ast_cdr_setvar(const char *channel_name, const char *name, const char *value
 		}
 	}
 
-	it_cdrs = ao2_callback(active_cdrs_master, OBJ_MULTIPLE, cdr_object_select_all_by_name_cb, arg);
-	if (!it_cdrs) {
-		ast_log(AST_LOG_ERROR, "Unable to find CDR for channel %s\n", channel_name);
-		return -1;
-	}
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		it_cdrs = ao2_callback(active_cdrs_master[shard], OBJ_MULTIPLE,
+			cdr_object_select_all_by_name_cb, arg);
+		if (!it_cdrs) {
+			ast_log(AST_LOG_ERROR, "Unable to find CDR for channel %s\n", channel_name);
+			return -1;
+		}
 
-	for (; (cdr = ao2_iterator_next(it_cdrs)); ao2_unlock(cdr), ao2_cleanup(cdr)) {
-		ao2_lock(cdr);
-		for (it_cdr = cdr; it_cdr; it_cdr = it_cdr->next) {
-			struct varshead *headp = NULL;
+		for (; (cdr = ao2_iterator_next(it_cdrs)); ao2_unlock(cdr), ao2_cleanup(cdr)) {
+			ao2_lock(cdr);
+			for (it_cdr = cdr; it_cdr; it_cdr = it_cdr->next) {
+				struct varshead *headp = NULL;
 
-			if (it_cdr->fn_table == &finalized_state_fn_table && it_cdr->next != NULL) {
-				continue;
-			}
-			if (!strcasecmp(channel_name, it_cdr->party_a.snapshot->base->name)) {
-				headp = &it_cdr->party_a.variables;
-			} else if (it_cdr->party_b.snapshot
-				&& !strcasecmp(channel_name, it_cdr->party_b.snapshot->base->name)) {
-				headp = &it_cdr->party_b.variables;
-			}
-			if (headp) {
-				set_variable(headp, name, value);
+				if (it_cdr->fn_table == &finalized_state_fn_table && it_cdr->next != NULL) {
+					continue;
+				}
+				if (!strcasecmp(channel_name, it_cdr->party_a.snapshot->base->name)) {
+					headp = &it_cdr->party_a.variables;
+				} else if (it_cdr->party_b.snapshot
+					&& !strcasecmp(channel_name, it_cdr->party_b.snapshot->base->name)) {
+					headp = &it_cdr->party_b.variables;
+				}
+				if (headp) {
+					set_variable(headp, name, value);
+				}
 			}
 		}
+		ao2_iterator_destroy(it_cdrs);
 	}
-	ao2_iterator_destroy(it_cdrs);
 
 	return 0;
 }
@@ -3311,14 +3459,20 @@ static int cdr_object_format_property(struct cdr_object *cdr_obj, const char *na
  */
 static struct cdr_object *cdr_object_get_by_name(const char *name)
 {
+	struct cdr_object *cdr = NULL;
 	char *param;
+	int shard;
 
 	if (ast_strlen_zero(name)) {
 		return NULL;
 	}
 
+	/* The masters are sharded by uniqueid, so any of them may have the name */
 	param = ast_strdupa(name);
-	return ao2_callback(active_cdrs_master, 0, cdr_object_get_by_name_cb, param);
+	for (shard = 0; !cdr && shard < CDR_SHARDS; ++shard) {
+		cdr = ao2_callback(active_cdrs_master[shard], 0, cdr_object_get_by_name_cb, param);
+	}
+	return cdr;
 }
 
 int ast_cdr_getvar(const char *channel_name, const char *name, char *value, size_t length)
@@ -3498,13 +3652,43 @@ void ast_cdr_setuserfield(const char *channel_name, const char *userfield)
 	}
 
 	/* Handle Party B */
-	ao2_callback_data(active_cdrs_all, OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
+	ao2_callback_data(cdr_all_container(party_b_info.channel_name),
+		OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_KEY,
 		cdr_object_update_party_b_userfield_cb, (char *) party_b_info.channel_name,
 		&party_b_info);
 
 	ao2_cleanup(cdr);
 }
 
+/*!
+ * \internal
+ * \brief Apply the modifiers to a record and decide whether it is posted
+ *
+ * \retval 1 if the backends are to get the record
+ * \retval 0 if it is skipped
+ */
+static int cdr_prepare_post(struct module_config *mod_cfg, struct ast_cdr *cdr)
+{
+	struct cdr_beitem *i;
+
+	/* For people, who don't want to see unanswered single-channel events */
+	if (!ast_test_flag(&mod_cfg->general->settings, CDR_UNANSWERED) &&
+			cdr->disposition < AST_CDR_ANSWERED &&
+			(ast_strlen_zero(cdr->channel) || ast_strlen_zero(cdr->dstchannel))) {
+		ast_debug(1, "Skipping CDR for %s since we weren't answered\n", cdr->channel);
+		return 0;
+	}
+
+	/* Modify CDR's */
+	AST_RWLIST_RDLOCK(&mo_list);
+	AST_RWLIST_TRAVERSE(&mo_list, i, list) {
+		i->be(cdr);
+	}
+	AST_RWLIST_UNLOCK(&mo_list);
+
+	return !ast_test_flag(cdr, AST_CDR_FLAG_DISABLE);
+}
+
 static void post_cdr(struct ast_cdr *cdr)
 {
 	struct module_config *mod_cfg;
@@ -3516,22 +3700,7 @@ static void post_cdr(struct ast_cdr *cdr)
 	}
 
 	for (; cdr ; cdr = cdr->next) {
-		/* For people, who don't want to see unanswered single-channel events */
-		if (!ast_test_flag(&mod_cfg->general->settings, CDR_UNANSWERED) &&
-				cdr->disposition < AST_CDR_ANSWERED &&
-				(ast_strlen_zero(cdr->channel) || ast_strlen_zero(cdr->dstchannel))) {
-			ast_debug(1, "Skipping CDR for %s since we weren't answered\n", cdr->channel);
-			continue;
-		}
-
-		/* Modify CDR's */
-		AST_RWLIST_RDLOCK(&mo_list);
-		AST_RWLIST_TRAVERSE(&mo_list, i, list) {
-			i->be(cdr);
-		}
-		AST_RWLIST_UNLOCK(&mo_list);
-
-		if (ast_test_flag(cdr, AST_CDR_FLAG_DISABLE)) {
+		if (!cdr_prepare_post(mod_cfg, cdr)) {
 			continue;
 		}
 		AST_RWLIST_RDLOCK(&be_list);
@@ -3746,28 +3915,197 @@ static int init_batch(void)
 	return 0;
 }
 
-static void *do_batch_backend_process(void *data)
+static void batch_items_free(struct cdr_batch_item *batchitem)
 {
 	struct cdr_batch_item *processeditem;
-	struct cdr_batch_item *batchitem = data;
 
-	/* Push each CDR into storage mechanism(s) and free all the memory */
 	while (batchitem) {
-		post_cdr(batchitem->cdr);
 		ast_cdr_free(batchitem->cdr);
 		processeditem = batchitem;
 		batchitem = batchitem->next;
 		ast_free(processeditem);
 	}
+}
 
-	return NULL;
+static void cdr_post_batch_dtor(void *obj)
+{
+	struct cdr_post_batch *post_batch = obj;
+
+	AST_VECTOR_FREE(&post_batch->cdrs);
+	batch_items_free(post_batch->items);
+}
+
+/*!
+ * \internal
+ * \brief Take over the submitted batch items, keeping the records to be posted
+ */
+static struct cdr_post_batch *cdr_post_batch_alloc(struct cdr_batch_item *batchitems, int count)
+{
+	struct module_config *mod_cfg;
+	struct cdr_post_batch *post_batch;
+	struct cdr_batch_item *batchitem;
+	struct ast_cdr *cdr;
+
+	post_batch = ao2_alloc_options(sizeof(*post_batch), cdr_post_batch_dtor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!post_batch) {
+		batch_items_free(batchitems);
+		return NULL;
+	}
+	post_batch->items = batchitems;
+	if (AST_VECTOR_INIT(&post_batch->cdrs, count)) {
+		ao2_ref(post_batch, -1);
+		return NULL;
+	}
+
+	mod_cfg = ao2_global_obj_ref(module_configs);
+	if (!mod_cfg) {
+		return post_batch;
+	}
+	for (batchitem = batchitems; batchitem; batchitem = batchitem->next) {
+		for (cdr = batchitem->cdr; cdr; cdr = cdr->next) {
+			if (cdr_prepare_post(mod_cfg, cdr)
+				&& AST_VECTOR_APPEND(&post_batch->cdrs, cdr)) {
+				ast_log(LOG_ERROR, "Unable to post CDR for %s\n", cdr->channel);
+			}
+		}
+	}
+	ao2_ref(mod_cfg, -1);
+
+	return post_batch;
+}
+
+/*! \brief A batch waiting on the queue of a backend */
+struct cdr_backend_task {
+	ast_cdrbe be;
+	ast_cdrbe_batch be_batch;
+	struct cdr_post_batch *post_batch;
+};
+
+static void backend_post_batch(ast_cdrbe be, ast_cdrbe_batch be_batch,
+	struct cdr_post_batch *post_batch)
+{
+	int idx;
+
+	if (be_batch) {
+		be_batch(AST_VECTOR_GET_ADDR(&post_batch->cdrs, 0), AST_VECTOR_SIZE(&post_batch->cdrs));
+		return;
+	}
+	for (idx = 0; idx < AST_VECTOR_SIZE(&post_batch->cdrs); ++idx) {
+		be(AST_VECTOR_GET(&post_batch->cdrs, idx));
+	}
+}
+
+static int backend_post_batch_task(void *data)
+{
+	struct cdr_backend_task *task = data;
+
+	backend_post_batch(task->be, task->be_batch, task->post_batch);
+	ao2_ref(task->post_batch, -1);
+	ast_free(task);
+
+	return 0;
+}
+
+/*! \brief Signals that the batches queued on a backend before it were posted */
+struct cdr_backend_drain {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	int done;
+};
+
+static int cdr_backend_drain_task(void *data)
+{
+	struct cdr_backend_drain *drain = data;
+
+	ast_mutex_lock(&drain->lock);
+	drain->done = 1;
+	ast_cond_signal(&drain->cond);
+	ast_mutex_unlock(&drain->lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for the batches queued on a backend to be posted
+ */
+static void cdr_backend_drain(struct cdr_beitem *be)
+{
+	struct cdr_backend_drain drain = { .done = 0, };
+
+	ast_mutex_init(&drain.lock);
+	ast_cond_init(&drain.cond, NULL);
+
+	if (!ast_taskprocessor_push(be->queue, cdr_backend_drain_task, &drain)) {
+		ast_mutex_lock(&drain.lock);
+		while (!drain.done) {
+			ast_cond_wait(&drain.cond, &drain.lock);
+		}
+		ast_mutex_unlock(&drain.lock);
+	}
+
+	ast_mutex_destroy(&drain.lock);
+	ast_cond_destroy(&drain.cond);
+}
+
+/*!
+ * \internal
+ * \brief Post a batch to each backend
+ *
+ * \param post_batch The batch, of which the reference is stolen
+ * \param inline_post Post from this thread rather than the queues of the backends,
+ *        once the batches already on them are posted
+ */
+static void do_batch_backend_process(struct cdr_post_batch *post_batch, int inline_post)
+{
+	struct cdr_beitem *i;
+	struct cdr_backend_task *task;
+
+	if (!AST_VECTOR_SIZE(&post_batch->cdrs)) {
+		ao2_ref(post_batch, -1);
+		return;
+	}
+
+	AST_RWLIST_RDLOCK(&be_list);
+	AST_RWLIST_TRAVERSE(&be_list, i, list) {
+		if (i->suspended) {
+			continue;
+		}
+
+		if (!inline_post) {
+			if (ast_taskprocessor_size(i->queue) >= CDR_BACKEND_QUEUE_WARN) {
+				ast_log(LOG_WARNING, "CDR backend '%s' is falling behind, %ld batches are waiting\n",
+					i->name, ast_taskprocessor_size(i->queue));
+			}
+			if ((task = ast_malloc(sizeof(*task)))) {
+				task->be = i->be;
+				task->be_batch = i->be_batch;
+				task->post_batch = ao2_bump(post_batch);
+				if (!ast_taskprocessor_push(i->queue, backend_post_batch_task, task)) {
+					continue;
+				}
+				ao2_ref(post_batch, -1);
+				ast_free(task);
+			}
+		} else {
+			/* Batches queued before this one, as on shutdown, are posted first */
+			cdr_backend_drain(i);
+		}
+		backend_post_batch(i->be, i->be_batch, post_batch);
+	}
+	AST_RWLIST_UNLOCK(&be_list);
+
+	ao2_ref(post_batch, -1);
 }
 
 static void cdr_submit_batch(int do_shutdown)
 {
 	struct module_config *mod_cfg;
 	struct cdr_batch_item *oldbatchitems = NULL;
-	pthread_t batch_post_thread = AST_PTHREADT_NULL;
+	struct cdr_post_batch *post_batch;
+	int count;
+	int inline_post;
 
 	/* if there's no batch, or no CDRs in the batch, then there's nothing to do */
 	if (!batch || !batch->head) {
@@ -3777,26 +4115,24 @@ static void cdr_submit_batch(int do_shutdown)
 	/* move the old CDRs aside, and prepare a new CDR batch */
 	ast_mutex_lock(&cdr_batch_lock);
 	oldbatchitems = batch->head;
+	count = batch->size;
 	reset_batch();
 	ast_mutex_unlock(&cdr_batch_lock);
 
+	post_batch = cdr_post_batch_alloc(oldbatchitems, count);
+	if (!post_batch) {
+		return;
+	}
+
 	mod_cfg = ao2_global_obj_ref(module_configs);
 
-	/* if configured, spawn a new thread to post these CDRs,
+	/* if configured, have each backend post these CDRs from its own queue,
 	   also try to save as much as possible if we are shutting down safely */
-	if (!mod_cfg
+	inline_post = !mod_cfg
 		|| ast_test_flag(&mod_cfg->general->batch_settings.settings, BATCH_MODE_SCHEDULER_ONLY)
-		|| do_shutdown) {
-		ast_debug(1, "CDR single-threaded batch processing begins now\n");
-		do_batch_backend_process(oldbatchitems);
-	} else {
-		if (ast_pthread_create_detached_background(&batch_post_thread, NULL, do_batch_backend_process, oldbatchitems)) {
-			ast_log(LOG_WARNING, "CDR processing thread could not detach, now trying in this thread\n");
-			do_batch_backend_process(oldbatchitems);
-		} else {
-			ast_debug(1, "CDR multi-threaded batch processing begins now\n");
-		}
-	}
+		|| do_shutdown;
+	ast_debug(1, "CDR %s batch processing begins now\n", inline_post ? "single-threaded" : "multi-threaded");
+	do_batch_backend_process(post_batch, inline_post);
 
 	ao2_cleanup(mod_cfg);
 }
@@ -3972,18 +4308,22 @@ static char *cli_complete_show(struct ast_cli_args *a)
 	int wordlen = strlen(a->word);
 	struct ao2_iterator it_cdrs;
 	struct cdr_object *cdr;
-
-	it_cdrs = ao2_iterator_init(active_cdrs_master, 0);
-	while ((cdr = ao2_iterator_next(&it_cdrs))) {
-		if (!strncasecmp(a->word, cdr->party_a.snapshot->base->name, wordlen)) {
-			if (ast_cli_completion_add(ast_strdup(cdr->party_a.snapshot->base->name))) {
-				ao2_ref(cdr, -1);
-				break;
+	int shard;
+
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		it_cdrs = ao2_iterator_init(active_cdrs_master[shard], 0);
+		while ((cdr = ao2_iterator_next(&it_cdrs))) {
+			if (!strncasecmp(a->word, cdr->party_a.snapshot->base->name, wordlen)) {
+				if (ast_cli_completion_add(ast_strdup(cdr->party_a.snapshot->base->name))) {
+					ao2_ref(cdr, -1);
+					ao2_iterator_destroy(&it_cdrs);
+					return NULL;
+				}
 			}
+			ao2_ref(cdr, -1);
 		}
-		ao2_ref(cdr, -1);
+		ao2_iterator_destroy(&it_cdrs);
 	}
-	ao2_iterator_destroy(&it_cdrs);
 
 	return NULL;
 }
@@ -3995,6 +4335,7 @@ static void cli_show_channels(struct ast_cli_args *a)
 	char start_time_buffer[64];
 	char answer_time_buffer[64];
 	char end_time_buffer[64];
+	int shard;
 
 #define TITLE_STRING "%-25.25s %-25.25s %-15.15s %-8.8s %-8.8s %-8.8s %-8.8s %-8.8s\n"
 #define FORMAT_STRING "%-25.25s %-25.25s %-15.15s %-8.8s %-8.8s %-8.8s %-8.8ld %-8.8ld\n"
@@ -4004,50 +4345,52 @@ static void cli_show_channels(struct ast_cli_args *a)
 	ast_cli(a->fd, "--------------------------------------------------\n");
 	ast_cli(a->fd, TITLE_STRING, "Channel", "Dst. Channel", "LastApp", "Start", "Answer", "End", "Billsec", "Duration");
 
-	it_cdrs = ao2_iterator_init(active_cdrs_master, 0);
-	for (; (cdr = ao2_iterator_next(&it_cdrs)); ao2_cleanup(cdr)) {
-		struct cdr_object *it_cdr;
-		struct timeval start_time = { 0, };
-		struct timeval answer_time = { 0, };
-		struct timeval end_time = { 0, };
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		it_cdrs = ao2_iterator_init(active_cdrs_master[shard], 0);
+		for (; (cdr = ao2_iterator_next(&it_cdrs)); ao2_cleanup(cdr)) {
+			struct cdr_object *it_cdr;
+			struct timeval start_time = { 0, };
+			struct timeval answer_time = { 0, };
+			struct timeval end_time = { 0, };
 
-		SCOPED_AO2LOCK(lock, cdr);
+			SCOPED_AO2LOCK(lock, cdr);
 
-		/* Calculate the start, end, answer, billsec, and duration over the
-		 * life of all of the CDR entries
-		 */
-		for (it_cdr = cdr; it_cdr; it_cdr = it_cdr->next) {
-			if (snapshot_is_dialed(it_cdr->party_a.snapshot)) {
-				continue;
+			/* Calculate the start, end, answer, billsec, and duration over the
+			 * life of all of the CDR entries
+			 */
+			for (it_cdr = cdr; it_cdr; it_cdr = it_cdr->next) {
+				if (snapshot_is_dialed(it_cdr->party_a.snapshot)) {
+					continue;
+				}
+				if (ast_tvzero(start_time)) {
+					start_time = it_cdr->start;
+				}
+				if (!ast_tvzero(it_cdr->answer) && ast_tvzero(answer_time)) {
+					answer_time = it_cdr->answer;
+				}
 			}
+
+			/* If there was no start time, then all CDRs were for a dialed channel; skip */
 			if (ast_tvzero(start_time)) {
-				start_time = it_cdr->start;
-			}
-			if (!ast_tvzero(it_cdr->answer) && ast_tvzero(answer_time)) {
-				answer_time = it_cdr->answer;
+				continue;
 			}
+			it_cdr = cdr->last;
+
+			end_time = ast_tvzero(it_cdr->end) ? ast_tvnow() : it_cdr->end;
+			cdr_get_tv(start_time, "%T", start_time_buffer, sizeof(start_time_buffer));
+			cdr_get_tv(answer_time, "%T", answer_time_buffer, sizeof(answer_time_buffer));
+			cdr_get_tv(end_time, "%T", end_time_buffer, sizeof(end_time_buffer));
+			ast_cli(a->fd, FORMAT_STRING, it_cdr->party_a.snapshot->base->name,
+					it_cdr->party_b.snapshot ? it_cdr->party_b.snapshot->base->name : "<none>",
+					it_cdr->appl,
+					start_time_buffer,
+					answer_time_buffer,
+					end_time_buffer,
+					ast_tvzero(answer_time) ? 0 : (long)ast_tvdiff_ms(end_time, answer_time) / 1000,
+					(long)ast_tvdiff_ms(end_time, start_time) / 1000);
 		}
-
-		/* If there was no start time, then all CDRs were for a dialed channel; skip */
-		if (ast_tvzero(start_time)) {
-			continue;
-		}
-		it_cdr = cdr->last;
-
-		end_time = ast_tvzero(it_cdr->end) ? ast_tvnow() : it_cdr->end;
-		cdr_get_tv(start_time, "%T", start_time_buffer, sizeof(start_time_buffer));
-		cdr_get_tv(answer_time, "%T", answer_time_buffer, sizeof(answer_time_buffer));
-		cdr_get_tv(end_time, "%T", end_time_buffer, sizeof(end_time_buffer));
-		ast_cli(a->fd, FORMAT_STRING, it_cdr->party_a.snapshot->base->name,
-				it_cdr->party_b.snapshot ? it_cdr->party_b.snapshot->base->name : "<none>",
-				it_cdr->appl,
-				start_time_buffer,
-				answer_time_buffer,
-				end_time_buffer,
-				ast_tvzero(answer_time) ? 0 : (long)ast_tvdiff_ms(end_time, answer_time) / 1000,
-				(long)ast_tvdiff_ms(end_time, start_time) / 1000);
+		ao2_iterator_destroy(&it_cdrs);
 	}
-	ao2_iterator_destroy(&it_cdrs);
 #undef FORMAT_STRING
 #undef TITLE_STRING
 }
@@ -4185,7 +4528,7 @@ static char *handle_cli_status(struct ast_cli_entry *e, int cmd, struct ast_cli_
 			if (cdr_sched > -1)
 				nextbatchtime = ast_sched_when(sched, cdr_sched);
 			ast_cli(a->fd, "  Safe shutdown:              %s\n", ast_test_flag(&mod_cfg->general->batch_settings.settings, BATCH_MODE_SAFE_SHUTDOWN) ? "Enabled" : "Disabled");
-			ast_cli(a->fd, "  Threading model:            %s\n", ast_test_flag(&mod_cfg->general->batch_settings.settings, BATCH_MODE_SCHEDULER_ONLY) ? "Scheduler only" : "Scheduler plus separate threads");
+			ast_cli(a->fd, "  Threading model:            %s\n", ast_test_flag(&mod_cfg->general->batch_settings.settings, BATCH_MODE_SCHEDULER_ONLY) ? "Scheduler only" : "Scheduler plus backend queues");
 			ast_cli(a->fd, "  Current batch size:         %d record%s\n", cnt, ESS(cnt));
 			ast_cli(a->fd, "  Maximum batch size:         %u record%s\n", mod_cfg->general->batch_settings.size, ESS(mod_cfg->general->batch_settings.size));
 			ast_cli(a->fd, "  Maximum batch time:         %u second%s\n", mod_cfg->general->batch_settings.time, ESS(mod_cfg->general->batch_settings.time));
@@ -4298,6 +4641,237 @@ struct stasis_message_router *ast_cdr_message_router(void)
 	return stasis_router;
 }
 
+int ast_cdr_message_router_add(struct stasis_message_type *message_type,
+	stasis_subscription_cb callback, void *data)
+{
+	int res = 0;
+	int shard;
+
+	if (!shard_routers[0]) {
+		return -1;
+	}
+
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		res |= stasis_message_router_add(shard_routers[shard], message_type, callback, data);
+	}
+
+	return res;
+}
+
+void ast_cdr_message_router_remove(struct stasis_message_type *message_type)
+{
+	int shard;
+
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		if (shard_routers[shard]) {
+			stasis_message_router_remove(shard_routers[shard], message_type);
+		}
+	}
+}
+
+int ast_cdr_message_publish_sync(struct ast_channel *chan, struct stasis_message *message)
+{
+	struct stasis_message_router *router;
+
+	if (!stasis_router) {
+		return -1;
+	}
+
+	router = ao2_bump(shard_routers[cdr_channel_home(ast_channel_uniqueid(chan))]);
+
+	/*
+	 * The dispatcher has no route for the message, so this only waits for
+	 * what is already queued for the channel to make it to its shard.
+	 */
+	stasis_message_router_publish_sync(stasis_router, message);
+	stasis_message_router_publish_sync(router, message);
+	ao2_ref(router, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Get the shards of a channel, adding the channel if it is new
+ */
+static struct cdr_channel_shards *cdr_channel_shards_get(struct ast_channel_snapshot *snapshot)
+{
+	struct cdr_channel_shards *shards;
+
+	/* Only the dispatcher adds channels, so there is no one to race with */
+	shards = ao2_find(channel_shards, snapshot->base->uniqueid, OBJ_SEARCH_KEY);
+	if (shards) {
+		return shards;
+	}
+
+	shards = ao2_alloc_options(sizeof(*shards) + strlen(snapshot->base->uniqueid) + 1,
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!shards) {
+		return NULL;
+	}
+	/* The channels it dials and its Local channels have its linkedid */
+	shards->home = cdr_shard(snapshot->peer->linkedid);
+	strcpy(shards->uniqueid, snapshot->base->uniqueid); /* Safe */
+	ao2_link(channel_shards, shards);
+
+	return shards;
+}
+
+/*!
+ * \internal
+ * \brief Pair up the shards of a channel entering a bridge and of those in it
+ *
+ * \return The shards of the other channels in the bridge
+ */
+static unsigned int cdr_bridge_shards(struct cdr_channel_shards *shards, struct ast_bridge_snapshot *bridge)
+{
+	struct ao2_iterator it_channels;
+	char *channel_id;
+	unsigned int involved = 0;
+
+	it_channels = ao2_iterator_init(bridge->channels, 0);
+	while ((channel_id = ao2_iterator_next(&it_channels))) {
+		struct cdr_channel_shards *other;
+
+		other = strcmp(channel_id, shards->uniqueid)
+			? ao2_find(channel_shards, channel_id, OBJ_SEARCH_KEY) : NULL;
+		if (other) {
+			/* Either may end up the Party B of the other */
+			involved |= 1U << other->home;
+			other->party_b |= 1U << shards->home;
+			shards->party_b |= 1U << other->home;
+			ao2_ref(other, -1);
+		}
+		ao2_ref(channel_id, -1);
+	}
+	ao2_iterator_destroy(&it_channels);
+
+	return involved;
+}
+
+/*!
+ * \internal
+ * \brief Wait for the shards to handle everything forwarded to them
+ */
+static void cdr_shards_drain(void)
+{
+	void *payload;
+	struct stasis_message *message;
+	int shard;
+
+	payload = ao2_alloc(sizeof(*payload), NULL);
+	if (!payload) {
+		return;
+	}
+	message = stasis_message_create(cdr_sync_message_type(), payload);
+	ao2_ref(payload, -1);
+	if (!message) {
+		return;
+	}
+
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		stasis_message_router_publish_sync(shard_routers[shard], message);
+	}
+	ao2_ref(message, -1);
+}
+
+/*!
+ * \brief Forward a message to the shard of the channel it regards
+ *
+ * As the dispatcher sees the messages in order, it also keeps track of the
+ * shards a message needs. When that is more than the one of the channel, as
+ * when the channel is the Party B of a CDR on another shard or enters a bridge
+ * with channels of other calls, the shards are drained and the message is
+ * handled here, just like a single router would.
+ */
+static void cdr_dispatch_message(void *data, struct stasis_subscription *sub, struct stasis_message *message)
+{
+	struct stasis_message_type *type = stasis_message_type(message);
+	struct ast_channel_snapshot *snapshot = NULL;
+	struct cdr_channel_shards *shards = NULL;
+	stasis_subscription_cb handler = NULL;
+	unsigned int involved = 0;
+	int home;
+	int dead = 0;
+
+	if (type == ast_channel_snapshot_type()) {
+		struct ast_channel_snapshot_update *update = stasis_message_data(message);
+
+		snapshot = update->new_snapshot ?: update->old_snapshot;
+		shards = cdr_channel_shards_get(snapshot);
+		if (shards) {
+			involved = shards->party_b;
+		}
+		dead = ast_test_flag(&snapshot->flags, AST_FLAG_DEAD);
+		handler = handle_channel_snapshot_update_message;
+	} else if (type == ast_channel_dial_type()) {
+		struct ast_multi_channel_blob *payload = stasis_message_data(message);
+		struct ast_channel_snapshot *caller = ast_multi_channel_blob_get_channel(payload, "caller");
+		struct ast_channel_snapshot *peer = ast_multi_channel_blob_get_channel(payload, "peer");
+
+		snapshot = caller ?: peer;
+		if (!snapshot) {
+			return;
+		}
+		shards = cdr_channel_shards_get(snapshot);
+		if (shards && caller && peer) {
+			struct cdr_channel_shards *peer_shards = cdr_channel_shards_get(peer);
+
+			/* The peer becomes the Party B of the caller */
+			if (peer_shards) {
+				peer_shards->party_b |= 1U << shards->home;
+				ao2_ref(peer_shards, -1);
+			}
+		}
+		handler = handle_dial_message;
+	} else if (type == ast_channel_entered_bridge_type()) {
+		struct ast_bridge_blob *update = stasis_message_data(message);
+
+		snapshot = update->channel;
+		shards = cdr_channel_shards_get(snapshot);
+		if (shards && !filter_bridge_messages(update->bridge)) {
+			involved = cdr_bridge_shards(shards, update->bridge);
+		}
+		handler = handle_bridge_enter_message;
+	} else if (type == ast_channel_left_bridge_type()) {
+		struct ast_bridge_blob *update = stasis_message_data(message);
+
+		snapshot = update->channel;
+		shards = cdr_channel_shards_get(snapshot);
+		if (shards) {
+			involved = shards->party_b;
+		}
+		handler = handle_bridge_leave_message;
+	} else if (type == ast_parked_call_type()) {
+		struct ast_parked_call_payload *payload = stasis_message_data(message);
+
+		snapshot = payload->parkee;
+		if (!snapshot) {
+			return;
+		}
+		shards = cdr_channel_shards_get(snapshot);
+		handler = handle_parked_call_message;
+	}
+
+	if (!snapshot) {
+		return;
+	}
+
+	home = shards ? shards->home : cdr_shard(snapshot->base->uniqueid);
+	involved |= 1U << home;
+	if (!(involved & (involved - 1))) {
+		stasis_publish(shard_topics[home], message);
+	} else {
+		cdr_shards_drain();
+		handler(data, sub, message);
+	}
+
+	if (shards && dead) {
+		ao2_unlink(channel_shards, shards);
+	}
+	ao2_cleanup(shards);
+}
+
 /*!
  * \brief Destroy the active Stasis subscriptions
  */
@@ -4384,16 +4958,34 @@ static int process_config(int reload)
 
 static void cdr_engine_shutdown(void)
 {
+	char name[32];
+	int shard;
+
+	/* Everything the dispatcher forwards has to be handled by the shards */
 	stasis_message_router_unsubscribe_and_join(stasis_router);
 	stasis_router = NULL;
 
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		stasis_message_router_unsubscribe_and_join(shard_routers[shard]);
+		shard_routers[shard] = NULL;
+		ao2_cleanup(shard_topics[shard]);
+		shard_topics[shard] = NULL;
+	}
+
 	ao2_cleanup(cdr_topic);
 	cdr_topic = NULL;
 
+	ao2_cleanup(channel_shards);
+	channel_shards = NULL;
+
 	STASIS_MESSAGE_TYPE_CLEANUP(cdr_sync_message_type);
 
-	ao2_callback(active_cdrs_master, OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
-		cdr_object_dispatch_all_cb, NULL);
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		if (active_cdrs_master[shard]) {
+			ao2_callback(active_cdrs_master[shard], OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
+				cdr_object_dispatch_all_cb, NULL);
+		}
+	}
 	finalize_batch_mode();
 	ast_cli_unregister_multiple(cli_commands, ARRAY_LEN(cli_commands));
 	ast_sched_context_destroy(sched);
@@ -4404,13 +4996,17 @@ static void cdr_engine_shutdown(void)
 	aco_info_destroy(&cfg_info);
 	ao2_global_obj_release(module_configs);
 
-	ao2_container_unregister("cdrs_master");
-	ao2_cleanup(active_cdrs_master);
-	active_cdrs_master = NULL;
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		snprintf(name, sizeof(name), "cdrs_master/%d", shard);
+		ao2_container_unregister(name);
+		ao2_cleanup(active_cdrs_master[shard]);
+		active_cdrs_master[shard] = NULL;
 
-	ao2_container_unregister("cdrs_all");
-	ao2_cleanup(active_cdrs_all);
-	active_cdrs_all = NULL;
+		snprintf(name, sizeof(name), "cdrs_all/%d", shard);
+		ao2_container_unregister(name);
+		ao2_cleanup(active_cdrs_all[shard]);
+		active_cdrs_all[shard] = NULL;
+	}
 }
 
 static void cdr_enable_batch_mode(struct ast_cdr_config *config)
@@ -4519,8 +5115,59 @@ static int unload_module(void)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Create the topic and the message router of a shard
+ */
+static int cdr_shard_create(int shard)
+{
+	char name[32];
+	struct stasis_message_router *router;
+
+	snprintf(name, sizeof(name), "cdr:aggregator/%d", shard);
+	shard_topics[shard] = stasis_topic_create(name);
+	if (!shard_topics[shard]) {
+		return -1;
+	}
+
+	router = stasis_message_router_create(shard_topics[shard]);
+	if (!router) {
+		return -1;
+	}
+	shard_routers[shard] = router;
+	stasis_message_router_set_congestion_limits(router, -1,
+		10 * AST_TASKPROCESSOR_HIGH_WATER_LEVEL);
+
+	stasis_message_router_add(router, ast_channel_snapshot_type(), handle_channel_snapshot_update_message, NULL);
+	stasis_message_router_add(router, ast_channel_dial_type(), handle_dial_message, NULL);
+	stasis_message_router_add(router, ast_channel_entered_bridge_type(), handle_bridge_enter_message, NULL);
+	stasis_message_router_add(router, ast_channel_left_bridge_type(), handle_bridge_leave_message, NULL);
+	stasis_message_router_add(router, ast_parked_call_type(), handle_parked_call_message, NULL);
+	stasis_message_router_add(router, cdr_sync_message_type(), handle_cdr_sync_message, NULL);
+
+	active_cdrs_master[shard] = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		AST_NUM_CHANNEL_BUCKETS / CDR_SHARDS, cdr_master_hash_fn, NULL, cdr_master_cmp_fn);
+	if (!active_cdrs_master[shard]) {
+		return -1;
+	}
+	snprintf(name, sizeof(name), "cdrs_master/%d", shard);
+	ao2_container_register(name, active_cdrs_master[shard], cdr_master_print_fn);
+
+	active_cdrs_all[shard] = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		AST_NUM_CHANNEL_BUCKETS / CDR_SHARDS, cdr_all_hash_fn, NULL, cdr_all_cmp_fn);
+	if (!active_cdrs_all[shard]) {
+		return -1;
+	}
+	snprintf(name, sizeof(name), "cdrs_all/%d", shard);
+	ao2_container_register(name, active_cdrs_all[shard], cdr_all_print_fn);
+
+	return 0;
+}
+
 static int load_module(void)
 {
+	int shard;
+
 	if (process_config(0)) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
@@ -4541,26 +5188,24 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
-	stasis_message_router_add(stasis_router, ast_channel_snapshot_type(), handle_channel_snapshot_update_message, NULL);
-	stasis_message_router_add(stasis_router, ast_channel_dial_type(), handle_dial_message, NULL);
-	stasis_message_router_add(stasis_router, ast_channel_entered_bridge_type(), handle_bridge_enter_message, NULL);
-	stasis_message_router_add(stasis_router, ast_channel_left_bridge_type(), handle_bridge_leave_message, NULL);
-	stasis_message_router_add(stasis_router, ast_parked_call_type(), handle_parked_call_message, NULL);
-	stasis_message_router_add(stasis_router, cdr_sync_message_type(), handle_cdr_sync_message, NULL);
-
-	active_cdrs_master = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
-		AST_NUM_CHANNEL_BUCKETS, cdr_master_hash_fn, NULL, cdr_master_cmp_fn);
-	if (!active_cdrs_master) {
+	channel_shards = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		AST_NUM_CHANNEL_BUCKETS, cdr_channel_shards_hash_fn, NULL, cdr_channel_shards_cmp_fn);
+	if (!channel_shards) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
-	ao2_container_register("cdrs_master", active_cdrs_master, cdr_master_print_fn);
 
-	active_cdrs_all = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
-		AST_NUM_CHANNEL_BUCKETS, cdr_all_hash_fn, NULL, cdr_all_cmp_fn);
-	if (!active_cdrs_all) {
-		return AST_MODULE_LOAD_FAILURE;
+	for (shard = 0; shard < CDR_SHARDS; ++shard) {
+		if (cdr_shard_create(shard)) {
+			return AST_MODULE_LOAD_FAILURE;
+		}
 	}
-	ao2_container_register("cdrs_all", active_cdrs_all, cdr_all_print_fn);
+
+	stasis_message_router_add(stasis_router, ast_channel_snapshot_type(), cdr_dispatch_message, NULL);
+	stasis_message_router_add(stasis_router, ast_channel_dial_type(), cdr_dispatch_message, NULL);
+	stasis_message_router_add(stasis_router, ast_channel_entered_bridge_type(), cdr_dispatch_message, NULL);
+	stasis_message_router_add(stasis_router, ast_channel_left_bridge_type(), cdr_dispatch_message, NULL);
+	stasis_message_router_add(stasis_router, ast_parked_call_type(), cdr_dispatch_message, NULL);
+	stasis_message_router_add(stasis_router, cdr_sync_message_type(), handle_cdr_sync_message, NULL);
 
 	sched = ast_sched_context_create();
 	if (!sched) {
@@ -4603,7 +5248,13 @@ void ast_cdr_engine_term(void)
 
 		message = stasis_message_create(cdr_sync_message_type(), payload);
 		if (message) {
+			int shard;
+
+			/* Once forwarded, what is left is in the queues of the shards */
 			stasis_message_router_publish_sync(stasis_router, message);
+			for (shard = 0; shard < CDR_SHARDS; ++shard) {
+				stasis_message_router_publish_sync(shard_routers[shard], message);
+			}
 		}
 		ao2_cleanup(message);
 		ao2_cleanup(payload);
@@ -58,6 +58,7 @@
 #include "asterisk/pickup.h"
 #include "asterisk/core_local.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/vector.h"
 
 /*** DOCUMENTATION
 	<configInfo name="cel" language="en_US">
@@ -70,6 +71,19 @@
 				<configOption name="dateformat">
 					<synopsis>The format to be used for dates when logging</synopsis>
 				</configOption>
+				<configOption name="batch">
+					<synopsis>Post events to the backends in batches</synopsis>
+					<description><para>Events are queued and posted from a thread of their
+					own once <replaceable>batchsize</replaceable> of them are waiting or the
+					oldest has waited <replaceable>batchtime</replaceable>. Backends able to
+					write a batch at once get it in a single call.</para></description>
+				</configOption>
+				<configOption name="batchsize">
+					<synopsis>Events queued before a batch is posted</synopsis>
+				</configOption>
+				<configOption name="batchtime">
+					<synopsis>Most milliseconds an event waits for its batch to be posted</synopsis>
+				</configOption>
 				<configOption name="apps">
 					<synopsis>List of apps for CEL to track</synopsis>
 					<description><para>A case-insensitive, comma-separated list of applications
@@ -325,9 +339,45 @@ static const char * const cel_event_types[CEL_MAX_EVENT_IDS] = {
 
 struct cel_backend {
 	ast_cel_backend_cb callback; /*!< Callback for this backend */
+	ast_cel_backend_batch_cb batch_callback; /*!< Callback for batches, if supported */
 	char name[0];                /*!< Name of this backend */
 };
 
+AST_VECTOR(cel_events, struct ast_event *);
+
+/*! \brief Events waiting to be posted in batch mode, oldest first */
+static struct cel_events cel_batch;
+
+/*! \brief When the oldest event of the batch was queued */
+static struct timeval cel_batch_oldest;
+
+/*! \brief Statistics of batch mode, shown by "cel show status" */
+static struct {
+	/*! Batches posted */
+	unsigned int flushes;
+	/*! Most events waiting at once */
+	size_t max_queued;
+	/*! Milliseconds the oldest event of the last batch waited until posted */
+	int64_t last_latency;
+	/*! Most milliseconds the oldest event of a batch waited until posted */
+	int64_t max_latency;
+} cel_batch_stats;
+
+/*! \brief Protects the batch, its statistics and the shutdown flag */
+AST_MUTEX_DEFINE_STATIC(cel_batch_lock);
+
+/*! \brief Keeps the batches in order when posted from more than one thread */
+AST_MUTEX_DEFINE_STATIC(cel_batch_post_lock);
+
+/*! \brief Signaled when the batch thread may have something to do */
+static ast_cond_t cel_batch_cond;
+
+/*! \brief Thread posting the batches */
+static pthread_t cel_batch_thread = AST_PTHREADT_NULL;
+
+/*! \brief Set when the batch thread has to post what is left and exit */
+static int cel_batch_shutdown;
+
 /*! \brief Hashing function for cel_backend */
 AO2_STRING_FIELD_HASH_FN(cel_backend, name)
 
@@ -405,11 +455,25 @@ static char *handle_cli_status(struct ast_cli_entry *e, int cmd, struct ast_cli_
 
 		iter = ao2_iterator_init(backends, 0);
 		for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
-			ast_cli(a->fd, "CEL Event Subscriber: %s\n", backend->name);
+			ast_cli(a->fd, "CEL Event Subscriber: %s%s\n", backend->name,
+				backend->batch_callback ? " (batch)" : "");
 		}
 		ao2_iterator_destroy(&iter);
 	}
 
+	ast_cli(a->fd, "CEL Batch Mode: %s\n", cfg->general->batch ? "Enabled" : "Disabled");
+	if (cfg->general->batch) {
+		ast_cli(a->fd, "CEL Batch Size: %u events\n", cfg->general->batch_size);
+		ast_cli(a->fd, "CEL Batch Time: %u ms\n", cfg->general->batch_time);
+	}
+	ast_mutex_lock(&cel_batch_lock);
+	ast_cli(a->fd, "CEL Batch Queue Depth: %zu (max %zu)\n",
+		AST_VECTOR_SIZE(&cel_batch), cel_batch_stats.max_queued);
+	ast_cli(a->fd, "CEL Batches Posted: %u\n", cel_batch_stats.flushes);
+	ast_cli(a->fd, "CEL Batch Flush Latency: %" PRId64 " ms (max %" PRId64 " ms)\n",
+		cel_batch_stats.last_latency, cel_batch_stats.max_latency);
+	ast_mutex_unlock(&cel_batch_lock);
+
 	return CLI_SUCCESS;
 }
 
@@ -566,6 +630,184 @@ static int cel_backend_send_cb(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Post the events waiting in the batch to the backends
+ */
+static void cel_batch_post(void)
+{
+	RAII_VAR(struct ao2_container *, backends, ao2_global_obj_ref(cel_backends), ao2_cleanup);
+	struct cel_events events;
+	struct timeval oldest;
+	struct ao2_iterator iter;
+	struct cel_backend *backend;
+	int64_t latency;
+	size_t idx;
+
+	ast_mutex_lock(&cel_batch_post_lock);
+
+	/* Take the whole batch, so events can be queued again while it is posted */
+	ast_mutex_lock(&cel_batch_lock);
+	events = cel_batch;
+	memset(&cel_batch, 0, sizeof(cel_batch));
+	oldest = cel_batch_oldest;
+	ast_mutex_unlock(&cel_batch_lock);
+
+	if (!AST_VECTOR_SIZE(&events)) {
+		ast_mutex_unlock(&cel_batch_post_lock);
+		AST_VECTOR_FREE(&events);
+		return;
+	}
+
+	if (backends) {
+		iter = ao2_iterator_init(backends, 0);
+		for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
+			if (backend->batch_callback) {
+				backend->batch_callback(AST_VECTOR_GET_ADDR(&events, 0), AST_VECTOR_SIZE(&events));
+				continue;
+			}
+			for (idx = 0; idx < AST_VECTOR_SIZE(&events); idx++) {
+				backend->callback(AST_VECTOR_GET(&events, idx));
+			}
+		}
+		ao2_iterator_destroy(&iter);
+	}
+
+	latency = ast_tvdiff_ms(ast_tvnow(), oldest);
+	ast_mutex_lock(&cel_batch_lock);
+	cel_batch_stats.flushes++;
+	cel_batch_stats.last_latency = latency;
+	if (latency > cel_batch_stats.max_latency) {
+		cel_batch_stats.max_latency = latency;
+	}
+	ast_mutex_unlock(&cel_batch_lock);
+
+	ast_mutex_unlock(&cel_batch_post_lock);
+
+	AST_VECTOR_CALLBACK_VOID(&events, ast_event_destroy);
+	AST_VECTOR_FREE(&events);
+}
+
+/*!
+ * \internal
+ * \brief Queue an event to be posted with its batch
+ *
+ * \param ev The event, now owned by the batch
+ * \param cfg The configuration in use
+ *
+ * \retval 0 if queued
+ * \retval -1 if not, the caller still owns the event
+ */
+static int cel_batch_queue(struct ast_event *ev, struct ast_cel_general_config *cfg)
+{
+	ast_mutex_lock(&cel_batch_lock);
+	if (cel_batch_thread == AST_PTHREADT_NULL || AST_VECTOR_APPEND(&cel_batch, ev)) {
+		ast_mutex_unlock(&cel_batch_lock);
+		return -1;
+	}
+	if (AST_VECTOR_SIZE(&cel_batch) == 1) {
+		cel_batch_oldest = ast_tvnow();
+		/* The batch thread now has a deadline to wait for */
+		ast_cond_signal(&cel_batch_cond);
+	} else if (AST_VECTOR_SIZE(&cel_batch) == cfg->batch_size) {
+		ast_cond_signal(&cel_batch_cond);
+	}
+	if (AST_VECTOR_SIZE(&cel_batch) > cel_batch_stats.max_queued) {
+		cel_batch_stats.max_queued = AST_VECTOR_SIZE(&cel_batch);
+	}
+	ast_mutex_unlock(&cel_batch_lock);
+
+	return 0;
+}
+
+static void *do_cel_batch(void *data)
+{
+	ast_mutex_lock(&cel_batch_lock);
+	for (;;) {
+		struct cel_config *cfg;
+		struct timeval deadline;
+		struct timespec ts;
+		int wait;
+
+		if (!AST_VECTOR_SIZE(&cel_batch)) {
+			if (cel_batch_shutdown) {
+				break;
+			}
+			ast_cond_wait(&cel_batch_cond, &cel_batch_lock);
+			continue;
+		}
+
+		/* Without batch mode, what is left goes out right away */
+		cfg = ao2_global_obj_ref(cel_configs);
+		wait = !cel_batch_shutdown && cfg && cfg->general && cfg->general->batch
+			&& AST_VECTOR_SIZE(&cel_batch) < cfg->general->batch_size;
+		deadline = ast_tvadd(cel_batch_oldest,
+			ast_samp2tv(cfg && cfg->general ? cfg->general->batch_time : 0, 1000));
+		ao2_cleanup(cfg);
+
+		if (wait && ast_tvcmp(deadline, ast_tvnow()) > 0) {
+			ts.tv_sec = deadline.tv_sec;
+			ts.tv_nsec = deadline.tv_usec * 1000;
+			ast_cond_timedwait(&cel_batch_cond, &cel_batch_lock, &ts);
+			continue;
+		}
+
+		ast_mutex_unlock(&cel_batch_lock);
+		cel_batch_post();
+		ast_mutex_lock(&cel_batch_lock);
+	}
+	ast_mutex_unlock(&cel_batch_lock);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Start the thread posting the batches
+ */
+static int cel_batch_start(void)
+{
+	ast_cond_init(&cel_batch_cond, NULL);
+	cel_batch_shutdown = 0;
+	if (ast_pthread_create_background(&cel_batch_thread, NULL, do_cel_batch, NULL)) {
+		ast_log(LOG_ERROR, "Unable to start the CEL batch thread\n");
+		cel_batch_thread = AST_PTHREADT_NULL;
+		ast_cond_destroy(&cel_batch_cond);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Post what is left of the batch and stop its thread
+ */
+static void cel_batch_stop(void)
+{
+	pthread_t thread;
+
+	ast_mutex_lock(&cel_batch_lock);
+	thread = cel_batch_thread;
+	if (thread == AST_PTHREADT_NULL) {
+		ast_mutex_unlock(&cel_batch_lock);
+		return;
+	}
+	cel_batch_shutdown = 1;
+	ast_cond_signal(&cel_batch_cond);
+	ast_mutex_unlock(&cel_batch_lock);
+
+	pthread_join(thread, NULL);
+
+	ast_mutex_lock(&cel_batch_lock);
+	cel_batch_thread = AST_PTHREADT_NULL;
+	ast_mutex_unlock(&cel_batch_lock);
+	ast_cond_destroy(&cel_batch_cond);
+
+	/* Events queued while the thread was exiting */
+	cel_batch_post();
+}
+
 static int cel_report_event(struct ast_channel_snapshot *snapshot,
 		enum ast_cel_event_type event_type, const struct timeval *event_time,
 		const char *userdefevname, struct ast_json *extra,
@@ -602,6 +844,10 @@ static int cel_report_event(struct ast_channel_snapshot *snapshot,
 		return -1;
 	}
 
+	if (cfg->general->batch && !cel_batch_queue(ev, cfg->general)) {
+		return 0;
+	}
+
 	/* Distribute event to backends */
 	ao2_callback(backends, OBJ_MULTIPLE | OBJ_NODATA, cel_backend_send_cb, ev);
 	ast_event_destroy(ev);
@@ -1436,6 +1682,7 @@ static int unload_module(void)
 {
 	destroy_routes();
 	destroy_subscriptions();
+	cel_batch_stop();
 	STASIS_MESSAGE_TYPE_CLEANUP(cel_generic_type);
 
 	ast_cli_unregister(&cli_status);
@@ -1610,6 +1857,9 @@ static int load_module(void)
 
 	aco_option_register(&cel_cfg_info, "enable", ACO_EXACT, general_options, "no", OPT_BOOL_T, 1, FLDSET(struct ast_cel_general_config, enable));
 	aco_option_register(&cel_cfg_info, "dateformat", ACO_EXACT, general_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_cel_general_config, date_format));
+	aco_option_register(&cel_cfg_info, "batch", ACO_EXACT, general_options, "no", OPT_BOOL_T, 1, FLDSET(struct ast_cel_general_config, batch));
+	aco_option_register(&cel_cfg_info, "batchsize", ACO_EXACT, general_options, "100", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cel_general_config, batch_size), 1, 10000);
+	aco_option_register(&cel_cfg_info, "batchtime", ACO_EXACT, general_options, "1000", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cel_general_config, batch_time), 1, 300000);
 	aco_option_register_custom(&cel_cfg_info, "apps", ACO_EXACT, general_options, "", apps_handler, 0);
 	aco_option_register_custom(&cel_cfg_info, "events", ACO_EXACT, general_options, "", events_handler, 0);
 
@@ -1628,7 +1878,7 @@ static int load_module(void)
 		ao2_ref(cel_cfg, -1);
 	}
 
-	if (create_subscriptions()) {
+	if (create_subscriptions() || cel_batch_start()) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
@@ -1658,6 +1908,11 @@ static int reload_module(void)
 		destroy_routes();
 	}
 
+	/* The batch settings may have changed for what is queued */
+	ast_mutex_lock(&cel_batch_lock);
+	ast_cond_signal(&cel_batch_cond);
+	ast_mutex_unlock(&cel_batch_lock);
+
 	ast_verb(3, "CEL logging %sabled.\n", is_enabled ? "en" : "dis");
 
 	return 0;
@@ -1729,6 +1984,9 @@ int ast_cel_backend_unregister(const char *name)
 {
 	struct ao2_container *backends = ao2_global_obj_ref(cel_backends);
 
+	/* The backend still gets the events queued before it went away */
+	cel_batch_post();
+
 	if (backends) {
 		ao2_find(backends, name, OBJ_SEARCH_KEY | OBJ_NODATA | OBJ_UNLINK);
 		ao2_ref(backends, -1);
@@ -1738,6 +1996,12 @@ int ast_cel_backend_unregister(const char *name)
 }
 
 int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback)
+{
+	return ast_cel_backend_register_batch(name, backend_callback, NULL);
+}
+
+int ast_cel_backend_register_batch(const char *name, ast_cel_backend_cb backend_callback,
+	ast_cel_backend_batch_cb batch_callback)
 {
 	RAII_VAR(struct ao2_container *, backends, ao2_global_obj_ref(cel_backends), ao2_cleanup);
 	struct cel_backend *backend;
@@ -1754,6 +2018,7 @@ int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callba
 	}
 	strcpy(backend->name, name);/* Safe */
 	backend->callback = backend_callback;
+	backend->batch_callback = batch_callback;
 
 	ao2_link(backends, backend);
 	ao2_ref(backend, -1);
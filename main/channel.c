@@ -74,6 +74,7 @@
 #include "asterisk/max_forwards.h"
 #include "asterisk/stream.h"
 #include "asterisk/message.h"
+#include "asterisk/frame_timing.h"
 
 /*** DOCUMENTATION
  ***/
@@ -116,8 +117,86 @@ struct chanlist {
 /*! \brief the list of registered channel types */
 static AST_RWLIST_HEAD_STATIC(backends, chanlist);
 
-/*! \brief All active channels on the system */
-static struct ao2_container *channels;
+/*!
+ * \brief All active channels on the system
+ *
+ * The channels are split by name hash into separately locked shards so
+ * walking the channels only holds off creating, renaming and destroying
+ * channels of one shard at a time.  With a single shard this is the
+ * classic global channels container.
+ */
+static struct ao2_container **channel_shards;
+
+/*! \brief Number of channel storage shards */
+static unsigned int channel_shard_count;
+
+/*! \brief Index of the channel storage shard a channel name belongs in */
+static unsigned int channel_shard_index(const char *name)
+{
+	if (channel_shard_count == 1 || ast_strlen_zero(name)) {
+		return 0;
+	}
+
+	/* The low bits of the hash select the bucket within the shard */
+	return ((unsigned int) ast_str_case_hash(name) >> 13) % channel_shard_count;
+}
+
+/*!
+ * \brief Lock the channel storage shard a channel is kept in
+ *
+ * \note The channel cannot be renamed while its shard is locked.
+ *
+ * \return The locked shard
+ */
+static struct ao2_container *channel_shard_lock(struct ast_channel *chan)
+{
+	for (;;) {
+		struct ao2_container *shard = channel_shards[channel_shard_index(ast_channel_name(chan))];
+
+		ao2_lock(shard);
+		if (shard == channel_shards[channel_shard_index(ast_channel_name(chan))]) {
+			return shard;
+		}
+		/* Renamed before we got the lock */
+		ao2_unlock(shard);
+	}
+}
+
+/*! \brief Lock all channel storage shards */
+static void channel_shards_lock_all(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < channel_shard_count; ++i) {
+		ao2_lock(channel_shards[i]);
+	}
+}
+
+static void channel_shards_unlock_all(void)
+{
+	unsigned int i;
+
+	for (i = channel_shard_count; i--;) {
+		ao2_unlock(channel_shards[i]);
+	}
+}
+
+static void callgroup_members_remove(struct ast_channel *chan);
+static int callgroup_members_init(void);
+static void callgroup_members_shutdown(void);
+
+/*! \brief Unlink a channel from the channel storage. Safe even if already unlinked. */
+static void channel_shards_unlink(struct ast_channel *chan)
+{
+	struct ao2_container *shard;
+
+	callgroup_members_remove(chan);
+
+	shard = channel_shard_lock(chan);
+
+	ao2_unlink_flags(shard, chan, OBJ_NOLOCK);
+	ao2_unlock(shard);
+}
 
 /*! \brief map AST_CAUSE's to readable string representations
  *
@@ -488,13 +567,23 @@ static int ast_channel_softhangup_cb(void *obj, void *arg, int flags)
 
 void ast_softhangup_all(void)
 {
-	ao2_callback(channels, OBJ_NODATA | OBJ_MULTIPLE, ast_channel_softhangup_cb, NULL);
+	unsigned int i;
+
+	for (i = 0; i < channel_shard_count; ++i) {
+		ao2_callback(channel_shards[i], OBJ_NODATA | OBJ_MULTIPLE, ast_channel_softhangup_cb, NULL);
+	}
 }
 
 /*! \brief returns number of active/allocated channels */
 int ast_active_channels(void)
 {
-	return channels ? ao2_container_count(channels) : 0;
+	unsigned int i;
+	int count = 0;
+
+	for (i = 0; i < channel_shard_count; ++i) {
+		count += ao2_container_count(channel_shards[i]);
+	}
+	return count;
 }
 
 int ast_undestroyed_channels(void)
@@ -921,11 +1010,16 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	 */
 	ast_channel_lock(tmp);
 
-	ao2_lock(channels);
+	/* Assigned IDs must be checked against every shard at once. */
+	if (assignedids) {
+		channel_shards_lock_all();
+	} else {
+		ao2_lock(channel_shards[channel_shard_index(ast_channel_name(tmp))]);
+	}
 
 	if (assignedids && (does_id_conflict(assignedids->uniqueid) || does_id_conflict(assignedids->uniqueid2))) {
 		ast_channel_internal_errno_set(AST_CHANNEL_ERROR_ID_EXISTS);
-		ao2_unlock(channels);
+		channel_shards_unlock_all();
 		ast_channel_unlock(tmp);
 		/* See earlier channel creation abort comment above. */
 		return ast_channel_unref(tmp);
@@ -934,9 +1028,13 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	/* Finalize and link into the channels container. */
 	ast_channel_internal_finalize(tmp);
 	ast_atomic_fetchadd_int(&chancount, +1);
-	ao2_link_flags(channels, tmp, OBJ_NOLOCK);
+	ao2_link_flags(channel_shards[channel_shard_index(ast_channel_name(tmp))], tmp, OBJ_NOLOCK);
 
-	ao2_unlock(channels);
+	if (assignedids) {
+		channel_shards_unlock_all();
+	} else {
+		ao2_unlock(channel_shards[channel_shard_index(ast_channel_name(tmp))]);
+	}
 
 	if (endpoint) {
 		ast_endpoint_add_channel(endpoint, tmp);
@@ -1260,10 +1358,101 @@ void ast_channel_undefer_dtmf(struct ast_channel *chan)
 	}
 }
 
+/*! \brief Callback wrapper used when a search spans several channel storage shards */
+struct channel_shards_cb_data {
+	ao2_callback_data_fn *cb_fn;
+	void *data;
+	/*! Set once the callback asked to stop searching */
+	int stop;
+};
+
+static int channel_shards_cb(void *obj, void *arg, void *data, int flags)
+{
+	struct channel_shards_cb_data *cb_data = data;
+	int res = cb_data->cb_fn(obj, arg, cb_data->data, flags);
+
+	if (res & CMP_STOP) {
+		cb_data->stop = 1;
+	}
+	return res;
+}
+
+/*! \brief Collect the matches of an OBJ_MULTIPLE search over all shards into one iterator */
+static struct ao2_iterator *channel_shards_callback_multiple(ao2_callback_data_fn *cb_fn,
+	void *arg, void *data, int ao2_flags)
+{
+	struct channel_shards_cb_data cb_data = {
+		.cb_fn = cb_fn,
+		.data = data,
+	};
+	struct ao2_container *matches;
+	struct ao2_iterator *iter;
+	unsigned int i;
+
+	matches = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
+	if (!matches) {
+		return NULL;
+	}
+
+	for (i = 0; i < channel_shard_count && !cb_data.stop; ++i) {
+		struct ao2_iterator *shard_iter;
+		struct ast_channel *chan;
+
+		shard_iter = ao2_callback_data(channel_shards[i], ao2_flags, channel_shards_cb, arg, &cb_data);
+		if (!shard_iter) {
+			ao2_ref(matches, -1);
+			return NULL;
+		}
+		while ((chan = ao2_iterator_next(shard_iter))) {
+			ao2_link_flags(matches, chan, OBJ_NOLOCK);
+			ast_channel_unref(chan);
+		}
+		ao2_iterator_destroy(shard_iter);
+	}
+
+	iter = ast_malloc(sizeof(*iter));
+	if (iter) {
+		*iter = ao2_iterator_init(matches, AO2_ITERATOR_UNLINK | AO2_ITERATOR_MALLOCD);
+	}
+	ao2_ref(matches, -1);
+
+	return iter;
+}
+
 struct ast_channel *ast_channel_callback(ao2_callback_data_fn *cb_fn, void *arg,
 		void *data, int ao2_flags)
 {
-	return ao2_callback_data(channels, ao2_flags, cb_fn, arg, data);
+	struct channel_shards_cb_data cb_data = {
+		.cb_fn = cb_fn,
+		.data = data,
+	};
+	struct ast_channel *chan = NULL;
+	unsigned int i;
+
+	/* Key and object searches hash on the channel name, which picks the shard. */
+	switch (ao2_flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return ao2_callback_data(channel_shards[channel_shard_index(arg)], ao2_flags, cb_fn, arg, data);
+	case OBJ_SEARCH_OBJECT:
+		return ao2_callback_data(channel_shards[channel_shard_index(ast_channel_name(arg))],
+			ao2_flags, cb_fn, arg, data);
+	default:
+		break;
+	}
+
+	if (channel_shard_count == 1) {
+		return ao2_callback_data(channel_shards[0], ao2_flags, cb_fn, arg, data);
+	}
+
+	if ((ao2_flags & OBJ_MULTIPLE) && !(ao2_flags & OBJ_NODATA)) {
+		return (struct ast_channel *) channel_shards_callback_multiple(cb_fn, arg, data, ao2_flags);
+	}
+
+	for (i = 0; i < channel_shard_count && !chan && !cb_data.stop; ++i) {
+		chan = ao2_callback_data(channel_shards[i], ao2_flags, channel_shards_cb, arg, &cb_data);
+	}
+
+	return chan;
 }
 
 static int ast_channel_by_name_cb(void *obj, void *arg, void *data, int flags)
@@ -1340,6 +1529,8 @@ struct ast_channel_iterator {
 	 * allocated iterator)
 	 */
 	struct ao2_iterator *active_iterator;
+	/* next channel storage shard for simple_iterator to walk, 0 if it walks just one */
+	unsigned int next_shard;
 };
 
 struct ast_channel_iterator *ast_channel_iterator_destroy(struct ast_channel_iterator *i)
@@ -1398,15 +1589,25 @@ struct ast_channel_iterator *ast_channel_iterator_all_new(void)
 		return NULL;
 	}
 
-	i->simple_iterator = ao2_iterator_init(channels, 0);
+	i->simple_iterator = ao2_iterator_init(channel_shards[0], 0);
 	i->active_iterator = &i->simple_iterator;
+	i->next_shard = 1;
 
 	return i;
 }
 
 struct ast_channel *ast_channel_iterator_next(struct ast_channel_iterator *i)
 {
-	return ao2_iterator_next(i->active_iterator);
+	struct ast_channel *chan;
+
+	while (!(chan = ao2_iterator_next(i->active_iterator))
+		&& i->next_shard && i->next_shard < channel_shard_count) {
+		/* Move on to the next shard */
+		ao2_iterator_destroy(&i->simple_iterator);
+		i->simple_iterator = ao2_iterator_init(channel_shards[i->next_shard++], 0);
+	}
+
+	return chan;
 }
 
 /* Legacy function, not currently used for lookups, but we need a cmp_fn */
@@ -1559,7 +1760,7 @@ int ast_safe_sleep(struct ast_channel *chan, int ms)
 struct ast_channel *ast_channel_release(struct ast_channel *chan)
 {
 	/* Safe, even if already unlinked. */
-	ao2_unlink(channels, chan);
+	channel_shards_unlink(chan);
 	return ast_channel_unref(chan);
 }
 
@@ -2553,7 +2754,7 @@ void ast_hangup(struct ast_channel *chan)
 	 * longer be needed.
 	 */
 	ast_pbx_hangup_handler_run(chan);
-	ao2_unlink(channels, chan);
+	channel_shards_unlink(chan);
 	ast_channel_lock(chan);
 
 	destroy_hooks(chan);
@@ -4228,6 +4429,9 @@ static struct ast_frame *__ast_read(struct ast_channel *chan, int dropaudio, int
 	ast_channel_fin_set(chan, FRAMECOUNT_INC(ast_channel_fin(chan)));
 
 done:
+	if (f) {
+		AST_FRAME_TIMING_RECORD(AST_FRAME_TIMING_READ, NULL, f);
+	}
 	if (ast_channel_music_state(chan) && ast_channel_generator(chan) && ast_channel_generator(chan)->digit && f && f->frametype == AST_FRAME_DTMF_END)
 		ast_channel_generator(chan)->digit(chan, f->subclass.integer);
 
@@ -5068,6 +5272,8 @@ int ast_write_stream(struct ast_channel *chan, int stream_num, struct ast_frame
 		usleep(1);
 	}
 
+	AST_FRAME_TIMING_RECORD(AST_FRAME_TIMING_WRITE, NULL, fr);
+
 	/* Stop if we're a zombie or need a soft hangup */
 	if (ast_test_flag(ast_channel_flags(chan), AST_FLAG_ZOMBIE) || ast_check_hangup(chan)) {
 		goto done;
@@ -6180,17 +6386,20 @@ static int set_security_requirements(const struct ast_channel *requestor, struct
 	return 0;
 }
 
-static struct ast_channel *request_channel(const char *type, struct ast_format_cap *request_cap, struct ast_stream_topology *topology,
-	const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *addr, int *cause)
+/*! \brief What a channel technology is asked for, worked out once for any number of requests */
+struct request_prep {
+	/*! Topology passed to requester_with_stream_topology */
+	struct ast_stream_topology *topology;
+	/*! Topology converted from the requested capabilities, to free */
+	struct ast_stream_topology *converted_topology;
+	/*! Capabilities passed to requester */
+	struct ast_format_cap *joint_cap;
+};
+
+/*! \brief Find the registered channel technology of a type */
+static const struct ast_channel_tech *request_find_tech(const char *type, int *cause)
 {
 	struct chanlist *chan;
-	struct ast_channel *c = NULL;
-	int res;
-	int foo;
-
-	if (!cause)
-		cause = &foo;
-	*cause = AST_CAUSE_NOTDEFINED;
 
 	if (AST_RWLIST_RDLOCK(&backends)) {
 		ast_log(LOG_WARNING, "Unable to lock technology backend list\n");
@@ -6213,24 +6422,43 @@ static struct ast_channel *request_channel(const char *type, struct ast_format_c
 		return NULL;
 	}
 
-	/* Allow either format capabilities or stream topology to be provided and adapt */
-	if (chan->tech->requester_with_stream_topology) {
-		struct ast_stream_topology *tmp_converted_topology = NULL;
+	return chan->tech;
+}
+
+static void request_prep_cleanup(struct request_prep *prep)
+{
+	ast_stream_topology_free(prep->converted_topology);
+	prep->converted_topology = NULL;
+	ao2_cleanup(prep->joint_cap);
+	prep->joint_cap = NULL;
+}
 
+/*!
+ * \brief Work out what to ask a channel technology for
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, with the cause set
+ */
+static int request_prepare(const struct ast_channel_tech *tech, const char *type,
+	struct ast_format_cap *request_cap, struct ast_stream_topology *topology,
+	struct request_prep *prep, int *cause)
+{
+	int res;
+
+	memset(prep, 0, sizeof(*prep));
+
+	/* Allow either format capabilities or stream topology to be provided and adapt */
+	if (tech->requester_with_stream_topology) {
 		if (!topology && request_cap) {
 			/* Turn the requested capabilities into a stream topology */
-			topology = tmp_converted_topology = ast_stream_topology_create_from_format_cap(request_cap);
+			topology = prep->converted_topology = ast_stream_topology_create_from_format_cap(request_cap);
 		}
-
-		c = chan->tech->requester_with_stream_topology(type, topology, assignedids, requestor, addr, cause);
-
-		ast_stream_topology_free(tmp_converted_topology);
-	} else if (chan->tech->requester) {
+		prep->topology = topology;
+	} else if (tech->requester) {
 		struct ast_format_cap *tmp_converted_cap = NULL;
 		struct ast_format_cap *tmp_cap;
 		RAII_VAR(struct ast_format *, tmp_fmt, NULL, ao2_cleanup);
 		RAII_VAR(struct ast_format *, best_audio_fmt, NULL, ao2_cleanup);
-		struct ast_format_cap *joint_cap;
 
 		if (!request_cap && topology) {
 			/* Turn the request stream topology into capabilities */
@@ -6244,18 +6472,18 @@ static struct ast_channel *request_channel(const char *type, struct ast_format_c
 			/* We have audio - is it possible to connect the various calls to each other?
 				(Avoid this check for calls without audio, like text+video calls)
 			*/
-			res = ast_translator_best_choice(tmp_cap, chan->tech->capabilities, &tmp_fmt, &best_audio_fmt);
+			res = ast_translator_best_choice(tmp_cap, tech->capabilities, &tmp_fmt, &best_audio_fmt);
 			ao2_ref(tmp_cap, -1);
 			if (res < 0) {
 				struct ast_str *tech_codecs = ast_str_alloca(AST_FORMAT_CAP_NAMES_LEN);
 				struct ast_str *request_codecs = ast_str_alloca(AST_FORMAT_CAP_NAMES_LEN);
 
 				ast_log(LOG_WARNING, "No translator path exists for channel type %s (native %s) to %s\n", type,
-					ast_format_cap_get_names(chan->tech->capabilities, &tech_codecs),
+					ast_format_cap_get_names(tech->capabilities, &tech_codecs),
 					ast_format_cap_get_names(request_cap, &request_codecs));
 				*cause = AST_CAUSE_BEARERCAPABILITY_NOTAVAIL;
 				ao2_cleanup(tmp_converted_cap);
-				return NULL;
+				return -1;
 			}
 		}
 
@@ -6264,18 +6492,31 @@ static struct ast_channel *request_channel(const char *type, struct ast_format_c
 		 * to signal to the initiator which one of their codecs that was offered is
 		 * the one that was selected, particularly in a chain of Local channels.
 		 */
-		joint_cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
-		if (!joint_cap) {
+		prep->joint_cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+		if (!prep->joint_cap) {
 			ao2_cleanup(tmp_converted_cap);
-			return NULL;
+			return -1;
 		}
-		ast_format_cap_append_from_cap(joint_cap, request_cap, AST_MEDIA_TYPE_UNKNOWN);
-		ast_format_cap_remove_by_type(joint_cap, AST_MEDIA_TYPE_AUDIO);
-		ast_format_cap_append(joint_cap, best_audio_fmt, 0);
+		ast_format_cap_append_from_cap(prep->joint_cap, request_cap, AST_MEDIA_TYPE_UNKNOWN);
+		ast_format_cap_remove_by_type(prep->joint_cap, AST_MEDIA_TYPE_AUDIO);
+		ast_format_cap_append(prep->joint_cap, best_audio_fmt, 0);
 		ao2_cleanup(tmp_converted_cap);
+	}
+
+	return 0;
+}
+
+/*! \brief Request a channel from a channel technology, as worked out by request_prepare() */
+static struct ast_channel *request_prepared(const struct ast_channel_tech *tech, const char *type,
+	struct request_prep *prep, const struct ast_assigned_ids *assignedids,
+	const struct ast_channel *requestor, const char *addr, int *cause)
+{
+	struct ast_channel *c = NULL;
 
-		c = chan->tech->requester(type, joint_cap, assignedids, requestor, addr, cause);
-		ao2_ref(joint_cap, -1);
+	if (tech->requester_with_stream_topology) {
+		c = tech->requester_with_stream_topology(type, prep->topology, assignedids, requestor, addr, cause);
+	} else if (tech->requester) {
+		c = tech->requester(type, prep->joint_cap, assignedids, requestor, addr, cause);
 	}
 
 	if (!c) {
@@ -6308,6 +6549,87 @@ static struct ast_channel *request_channel(const char *type, struct ast_format_c
 	return c;
 }
 
+static struct ast_channel *request_channel(const char *type, struct ast_format_cap *request_cap, struct ast_stream_topology *topology,
+	const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *addr, int *cause)
+{
+	const struct ast_channel_tech *tech;
+	struct request_prep prep;
+	struct ast_channel *c;
+	int foo;
+
+	if (!cause)
+		cause = &foo;
+	*cause = AST_CAUSE_NOTDEFINED;
+
+	if (!(tech = request_find_tech(type, cause))) {
+		return NULL;
+	}
+
+	if (request_prepare(tech, type, request_cap, topology, &prep, cause)) {
+		return NULL;
+	}
+	c = request_prepared(tech, type, &prep, assignedids, requestor, addr, cause);
+	request_prep_cleanup(&prep);
+
+	return c;
+}
+
+int ast_request_multiple(struct ast_request_item *items, size_t count, struct ast_format_cap *request_cap,
+	struct ast_stream_topology *topology, const struct ast_channel *requestor)
+{
+	size_t i;
+	size_t j;
+	int requested = 0;
+
+	for (i = 0; i < count; i++) {
+		items[i].chan = NULL;
+		items[i].cause = AST_CAUSE_NOTDEFINED;
+	}
+
+	for (i = 0; i < count; i++) {
+		const struct ast_channel_tech *tech;
+		struct request_prep prep;
+		int cause = AST_CAUSE_NOTDEFINED;
+
+		for (j = 0; j < i; j++) {
+			if (!strcasecmp(items[j].type, items[i].type)) {
+				break;
+			}
+		}
+		if (j < i) {
+			/* Already requested along with an earlier item of the same type */
+			continue;
+		}
+
+		/* Look up the technology and work out what to ask of it once for all items of its type */
+		tech = request_find_tech(items[i].type, &cause);
+		if (tech && request_prepare(tech, items[i].type, request_cap, topology, &prep, &cause)) {
+			tech = NULL;
+		}
+
+		for (j = i; j < count; j++) {
+			if (strcasecmp(items[j].type, items[i].type)) {
+				continue;
+			}
+			if (!tech) {
+				items[j].cause = cause;
+				continue;
+			}
+			items[j].chan = request_prepared(tech, items[j].type, &prep, items[j].assignedids,
+				requestor, items[j].addr, &items[j].cause);
+			if (items[j].chan) {
+				requested++;
+			}
+		}
+
+		if (tech) {
+			request_prep_cleanup(&prep);
+		}
+	}
+
+	return requested;
+}
+
 struct ast_channel *ast_request(const char *type, struct ast_format_cap *request_cap, const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *addr, int *cause)
 {
 	return request_channel(type, request_cap, NULL, assignedids, requestor, addr, cause);
@@ -6691,14 +7013,39 @@ static void __ast_change_name_nolink(struct ast_channel *chan, const char *newna
 
 void ast_change_name(struct ast_channel *chan, const char *newname)
 {
+	unsigned int new_index = channel_shard_index(newname);
+	unsigned int old_index;
+
 	/* We must re-link, as the hash value will change here. */
-	ao2_lock(channels);
+	for (;;) {
+		old_index = channel_shard_index(ast_channel_name(chan));
+
+		/* Shards are always locked in index order */
+		ao2_lock(channel_shards[MIN(old_index, new_index)]);
+		if (old_index != new_index) {
+			ao2_lock(channel_shards[MAX(old_index, new_index)]);
+		}
+		if (old_index == channel_shard_index(ast_channel_name(chan))) {
+			break;
+		}
+
+		/* Renamed before we got the lock */
+		if (old_index != new_index) {
+			ao2_unlock(channel_shards[MAX(old_index, new_index)]);
+		}
+		ao2_unlock(channel_shards[MIN(old_index, new_index)]);
+	}
+
 	ast_channel_lock(chan);
-	ao2_unlink(channels, chan);
+	ao2_unlink_flags(channel_shards[old_index], chan, OBJ_NOLOCK);
 	__ast_change_name_nolink(chan, newname);
-	ao2_link(channels, chan);
+	ao2_link_flags(channel_shards[new_index], chan, OBJ_NOLOCK);
 	ast_channel_unlock(chan);
-	ao2_unlock(channels);
+
+	if (old_index != new_index) {
+		ao2_unlock(channel_shards[MAX(old_index, new_index)]);
+	}
+	ao2_unlock(channel_shards[MIN(old_index, new_index)]);
 }
 
 void ast_channel_inherit_variables(const struct ast_channel *parent, struct ast_channel *child)
@@ -6838,15 +7185,15 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	 * has restabilized the channels to hold off ast_hangup() and until
 	 * AST_FLAG_ZOMBIE can be set on the clonechan.
 	 */
-	ao2_lock(channels);
+	channel_shards_lock_all();
 
 	/* Bump the refs to ensure that they won't dissapear on us. */
 	ast_channel_ref(original);
 	ast_channel_ref(clonechan);
 
 	/* unlink from channels container as name (which is the hash value) will change */
-	ao2_unlink(channels, original);
-	ao2_unlink(channels, clonechan);
+	ao2_unlink_flags(channel_shards[channel_shard_index(ast_channel_name(original))], original, OBJ_NOLOCK);
+	ao2_unlink_flags(channel_shards[channel_shard_index(ast_channel_name(clonechan))], clonechan, OBJ_NOLOCK);
 
 	moh_is_playing = ast_test_flag(ast_channel_flags(original), AST_FLAG_MOH);
 	if (moh_is_playing) {
@@ -7257,9 +7604,9 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	ast_channel_unlock(original);
 	ast_channel_unlock(clonechan);
 
-	ao2_link(channels, clonechan);
-	ao2_link(channels, original);
-	ao2_unlock(channels);
+	ao2_link_flags(channel_shards[channel_shard_index(ast_channel_name(clonechan))], clonechan, OBJ_NOLOCK);
+	ao2_link_flags(channel_shards[channel_shard_index(ast_channel_name(original))], original, OBJ_NOLOCK);
+	channel_shards_unlock_all();
 
 	/* Release our held safety references. */
 	ast_channel_unref(original);
@@ -7930,28 +8277,74 @@ struct varshead *ast_channel_get_ari_vars(struct ast_channel *chan)
 	return channel_get_external_vars(&ari_vars, chan);
 }
 
+/*! \brief Name a channel storage shard is registered with */
+static void channel_shard_name(char *buf, size_t size, unsigned int index)
+{
+	if (channel_shard_count == 1) {
+		ast_copy_string(buf, "channels", size);
+	} else {
+		snprintf(buf, size, "channels-%u", index);
+	}
+}
+
 static void channels_shutdown(void)
 {
 	free_external_channelvars(&ami_vars);
 	free_external_channelvars(&ari_vars);
 
 	ast_cli_unregister_multiple(cli_channel, ARRAY_LEN(cli_channel));
-	if (channels) {
-		ao2_container_unregister("channels");
-		ao2_ref(channels, -1);
-		channels = NULL;
+	callgroup_members_shutdown();
+	if (channel_shards) {
+		unsigned int i;
+
+		for (i = 0; i < channel_shard_count; ++i) {
+			char name[32];
+
+			channel_shard_name(name, sizeof(name), i);
+			ao2_container_unregister(name);
+			ao2_cleanup(channel_shards[i]);
+		}
+		ast_free(channel_shards);
+		channel_shards = NULL;
+		channel_shard_count = 0;
 	}
 	ast_channel_unregister(&surrogate_tech);
 }
 
 int ast_channels_init(void)
 {
-	channels = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, AST_NUM_CHANNEL_BUCKETS,
-		ast_channel_hash_cb, NULL, ast_channel_cmp_cb);
-	if (!channels) {
+	unsigned int buckets;
+	unsigned int i;
+
+	channel_shard_count = MAX(ast_option_channel_storage_shards, 1);
+	channel_shards = ast_calloc(channel_shard_count, sizeof(*channel_shards));
+	if (!channel_shards) {
+		channel_shard_count = 0;
+		return -1;
+	}
+
+	/* Keep roughly the same total number of buckets.  An odd count spreads better. */
+	buckets = (AST_NUM_CHANNEL_BUCKETS / channel_shard_count) | 1;
+
+	for (i = 0; i < channel_shard_count; ++i) {
+		char name[32];
+
+		channel_shards[i] = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, buckets,
+			ast_channel_hash_cb, NULL, ast_channel_cmp_cb);
+		if (!channel_shards[i]) {
+			channels_shutdown();
+			return -1;
+		}
+		channel_shard_name(name, sizeof(name), i);
+		ao2_container_register(name, channel_shards[i], prnt_channel_key);
+	}
+	if (channel_shard_count > 1) {
+		ast_verb(2, "Channels are kept in %u storage shards\n", channel_shard_count);
+	}
+	if (callgroup_members_init()) {
+		channels_shutdown();
 		return -1;
 	}
-	ao2_container_register("channels", channels, prnt_channel_key);
 
 	ast_channel_register(&surrogate_tech);
 
@@ -8052,6 +8445,234 @@ int ast_namedgroups_intersect(struct ast_namedgroups *a, struct ast_namedgroups
 	return match != NULL;
 }
 
+/*! \brief Number of numbered call groups */
+#define CALLGROUP_COUNT (sizeof(ast_group_t) * 8)
+
+/*! \brief Buckets of the channels of a call group */
+#define CALLGROUP_CHANNEL_BUCKETS 31
+
+/*! \brief Buckets of the named call groups */
+#define NAMED_CALLGROUP_BUCKETS 61
+
+/*! \brief The channels in a named call group */
+struct named_callgroup_members {
+	/*! Pre-built hash of group name. (First, as in struct namedgroup_member.) */
+	unsigned int hash;
+	/*! The channels in the group */
+	struct ao2_container *channels;
+	/*! Group name. (End allocation of name string.) */
+	char name[1];
+};
+
+/*!
+ * \brief The channels in each call group, so that call pickup only looks
+ * at the channels it could pick up rather than at every channel.
+ *
+ * Channels are added as their call groups are set, and removed as their
+ * call groups change and as they are unlinked from the channel storage.
+ */
+static struct ao2_container *numbered_callgroup_members[CALLGROUP_COUNT];
+static struct ao2_container *named_callgroup_members;
+AST_MUTEX_DEFINE_STATIC(callgroup_members_lock);
+
+/*! \brief Channels are kept in call group members by address */
+static int callgroup_channel_hash_cb(const void *obj, const int flags)
+{
+	return (int) ((uintptr_t) obj >> 4);
+}
+
+/*! \brief Sorting channels by address lets the same channel be rejected */
+static int callgroup_channel_sort_cb(const void *obj_left, const void *obj_right, int flags)
+{
+	return obj_left < obj_right ? -1 : obj_left > obj_right;
+}
+
+static void named_callgroup_members_destructor(void *obj)
+{
+	struct named_callgroup_members *members = obj;
+
+	ao2_cleanup(members->channels);
+}
+
+static int named_callgroup_members_cmp_cb(void *obj, void *arg, int flags)
+{
+	const struct named_callgroup_members *members = obj;
+	const struct namedgroup_member *group = arg;
+
+	return strcmp(members->name, group->name) ? 0 : CMP_MATCH | CMP_STOP;
+}
+
+static int named_callgroup_members_hash_cb(const void *obj, const int flags)
+{
+	/* Both the members and the named groups searched with lead with the hash of the name. */
+	return *(const unsigned int *) obj;
+}
+
+static struct ao2_container *callgroup_channels_alloc(void)
+{
+	return ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, AO2_CONTAINER_ALLOC_OPT_DUPS_OBJ_REJECT,
+		CALLGROUP_CHANNEL_BUCKETS, callgroup_channel_hash_cb, callgroup_channel_sort_cb, NULL);
+}
+
+/*!
+ * \internal
+ * \brief Add a channel to, or remove it from, the members of its call groups
+ * \note The callgroup_members_lock must be held.
+ */
+static void callgroup_members_update(struct ast_channel *chan, ast_group_t callgroup,
+	struct ast_namedgroups *named_callgroups, int add)
+{
+	unsigned int group;
+
+	for (group = 0; callgroup && group < CALLGROUP_COUNT; ++group, callgroup >>= 1) {
+		if (!(callgroup & 1)) {
+			continue;
+		}
+		if (add) {
+			if (!numbered_callgroup_members[group]) {
+				numbered_callgroup_members[group] = callgroup_channels_alloc();
+			}
+			if (numbered_callgroup_members[group]) {
+				ao2_link_flags(numbered_callgroup_members[group], chan, OBJ_NOLOCK);
+			}
+		} else if (numbered_callgroup_members[group]) {
+			ao2_unlink_flags(numbered_callgroup_members[group], chan, OBJ_NOLOCK);
+		}
+	}
+
+	if (named_callgroups && named_callgroup_members) {
+		struct ao2_iterator it;
+		struct namedgroup_member *named;
+
+		it = ao2_iterator_init((struct ao2_container *) named_callgroups, 0);
+		while ((named = ao2_iterator_next(&it))) {
+			struct named_callgroup_members *members;
+
+			members = ao2_find(named_callgroup_members, named, OBJ_SEARCH_OBJECT | OBJ_NOLOCK);
+			if (add && !members) {
+				members = ao2_alloc_options(sizeof(*members) + strlen(named->name),
+					named_callgroup_members_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+				if (members) {
+					strcpy(members->name, named->name); /* Safe */
+					members->hash = named->hash;
+					members->channels = callgroup_channels_alloc();
+					if (members->channels) {
+						ao2_link_flags(named_callgroup_members, members, OBJ_NOLOCK);
+					} else {
+						ao2_ref(members, -1);
+						members = NULL;
+					}
+				}
+			}
+			if (members) {
+				if (add) {
+					ao2_link_flags(members->channels, chan, OBJ_NOLOCK);
+				} else {
+					ao2_unlink_flags(members->channels, chan, OBJ_NOLOCK);
+					if (!ao2_container_count(members->channels)) {
+						ao2_unlink_flags(named_callgroup_members, members, OBJ_NOLOCK);
+					}
+				}
+				ao2_ref(members, -1);
+			}
+			ao2_ref(named, -1);
+		}
+		ao2_iterator_destroy(&it);
+	}
+}
+
+void ast_channel_internal_callgroups_changed(struct ast_channel *chan,
+	ast_group_t old_callgroup, struct ast_namedgroups *old_named_callgroups)
+{
+	ast_mutex_lock(&callgroup_members_lock);
+	callgroup_members_update(chan, old_callgroup, old_named_callgroups, 0);
+	/* Zombies are on their way out of the channel storage. */
+	if (!ast_test_flag(ast_channel_flags(chan), AST_FLAG_ZOMBIE)) {
+		callgroup_members_update(chan, ast_channel_callgroup(chan), ast_channel_named_callgroups(chan), 1);
+	}
+	ast_mutex_unlock(&callgroup_members_lock);
+}
+
+/*! \brief Remove a channel from the members of its call groups */
+static void callgroup_members_remove(struct ast_channel *chan)
+{
+	ast_channel_lock(chan);
+	ast_mutex_lock(&callgroup_members_lock);
+	callgroup_members_update(chan, ast_channel_callgroup(chan), ast_channel_named_callgroups(chan), 0);
+	ast_mutex_unlock(&callgroup_members_lock);
+	ast_channel_unlock(chan);
+}
+
+static int callgroup_members_init(void)
+{
+	named_callgroup_members = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		NAMED_CALLGROUP_BUCKETS, named_callgroup_members_hash_cb, NULL, named_callgroup_members_cmp_cb);
+
+	return named_callgroup_members ? 0 : -1;
+}
+
+static void callgroup_members_shutdown(void)
+{
+	unsigned int group;
+
+	ast_mutex_lock(&callgroup_members_lock);
+	for (group = 0; group < CALLGROUP_COUNT; ++group) {
+		ao2_cleanup(numbered_callgroup_members[group]);
+		numbered_callgroup_members[group] = NULL;
+	}
+	ao2_cleanup(named_callgroup_members);
+	named_callgroup_members = NULL;
+	ast_mutex_unlock(&callgroup_members_lock);
+}
+
+static int callgroup_member_link(void *obj, void *arg, int flags)
+{
+	ao2_link(arg, obj);
+
+	return 0;
+}
+
+struct ao2_container *ast_channel_callgroups_find(ast_group_t pickupgroup,
+	struct ast_namedgroups *named_pickupgroups)
+{
+	struct ao2_container *members;
+	unsigned int group;
+
+	members = callgroup_channels_alloc();
+	if (!members) {
+		return NULL;
+	}
+
+	ast_mutex_lock(&callgroup_members_lock);
+	for (group = 0; pickupgroup && group < CALLGROUP_COUNT; ++group, pickupgroup >>= 1) {
+		if ((pickupgroup & 1) && numbered_callgroup_members[group]) {
+			ao2_callback(numbered_callgroup_members[group], OBJ_NODATA | OBJ_NOLOCK,
+				callgroup_member_link, members);
+		}
+	}
+
+	if (named_pickupgroups && named_callgroup_members) {
+		struct ao2_iterator it;
+		struct namedgroup_member *named;
+
+		it = ao2_iterator_init((struct ao2_container *) named_pickupgroups, 0);
+		while ((named = ao2_iterator_next(&it))) {
+			struct named_callgroup_members *found;
+
+			found = ao2_find(named_callgroup_members, named, OBJ_SEARCH_OBJECT | OBJ_NOLOCK);
+			if (found) {
+				ao2_callback(found->channels, OBJ_NODATA | OBJ_NOLOCK, callgroup_member_link, members);
+				ao2_ref(found, -1);
+			}
+			ao2_ref(named, -1);
+		}
+		ao2_iterator_destroy(&it);
+	}
+	ast_mutex_unlock(&callgroup_members_lock);
+
+	return members;
+}
+
 void ast_set_variables(struct ast_channel *chan, struct ast_variable *vars)
 {
 	struct ast_variable *cur;
@@ -10561,7 +11182,7 @@ int ast_channel_get_cc_agent_type(struct ast_channel *chan, char *agent_type, si
 
 void ast_channel_unlink(struct ast_channel *chan)
 {
-	ao2_unlink(channels, chan);
+	channel_shards_unlink(chan);
 }
 
 struct ast_bridge *ast_channel_get_bridge(const struct ast_channel *chan)
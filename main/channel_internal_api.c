@@ -222,8 +222,25 @@ struct ast_channel {
 	struct ast_stream *default_streams[AST_MEDIA_TYPE_END]; /*!< Default streams indexed by media type */
 	struct ast_channel_snapshot *snapshot; /*!< The current up to date snapshot of the channel */
 	struct ast_flags snapshot_segment_flags; /*!< Flags regarding the segments of the snapshot */
+	struct channel_arena_chunk *arena; /*!< Memory freed along with the channel */
 };
 
+/*! \brief A block of the memory handed out by ast_channel_arena_alloc() */
+struct channel_arena_chunk {
+	struct channel_arena_chunk *next;
+	/*! Bytes the chunk holds */
+	size_t size;
+	/*! Bytes already handed out */
+	size_t used;
+};
+
+/*! Alignment of the memory handed out by ast_channel_arena_alloc() */
+#define ARENA_ALIGN (2 * sizeof(void *))
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+/*! Bytes held by a chunk shared by small allocations */
+#define ARENA_CHUNK_SIZE 1024
+#define ARENA_CHUNK_DATA(chunk) ((char *) (chunk) + ARENA_ROUND(sizeof(struct channel_arena_chunk)))
+
 /*! \brief The monotonically increasing integer counter for channel uniqueids */
 static int uniqueint;
 
@@ -1071,7 +1088,12 @@ ast_group_t ast_channel_callgroup(const struct ast_channel *chan)
 }
 void ast_channel_callgroup_set(struct ast_channel *chan, ast_group_t value)
 {
+	ast_group_t old = chan->callgroup;
+
 	chan->callgroup = value;
+	if (old != value) {
+		ast_channel_internal_callgroups_changed(chan, old, chan->named_callgroups);
+	}
 }
 ast_group_t ast_channel_pickupgroup(const struct ast_channel *chan)
 {
@@ -1087,8 +1109,13 @@ struct ast_namedgroups *ast_channel_named_callgroups(const struct ast_channel *c
 }
 void ast_channel_named_callgroups_set(struct ast_channel *chan, struct ast_namedgroups *value)
 {
-	ast_unref_namedgroups(chan->named_callgroups);
+	struct ast_namedgroups *old = chan->named_callgroups;
+
 	chan->named_callgroups = ast_ref_namedgroups(value);
+	if (old != value) {
+		ast_channel_internal_callgroups_changed(chan, chan->callgroup, old);
+	}
+	ast_unref_namedgroups(old);
 }
 struct ast_namedgroups *ast_channel_named_pickupgroups(const struct ast_channel *chan)
 {
@@ -1131,13 +1158,42 @@ void ast_channel_internal_alertpipe_clear(struct ast_channel *chan)
 	ast_alertpipe_clear(chan->alertpipe);
 }
 
+/*!
+ * \brief Alertpipes of destroyed channels kept for new channels
+ *
+ * Creating and closing the alertpipe of every channel costs a system call
+ * or two each time, so a few are kept, emptied, to be handed out again.
+ */
+#define SPARE_ALERTPIPES 64
+
+static int spare_alertpipes[SPARE_ALERTPIPES][2];
+static int spare_alertpipe_count;
+AST_MUTEX_DEFINE_STATIC(spare_alertpipes_lock);
+
 void ast_channel_internal_alertpipe_close(struct ast_channel *chan)
 {
+	if (ast_alertpipe_readable(chan->alertpipe)
+		&& ast_alertpipe_flush(chan->alertpipe) == AST_ALERT_READ_SUCCESS) {
+		ast_mutex_lock(&spare_alertpipes_lock);
+		if (spare_alertpipe_count < SPARE_ALERTPIPES) {
+			memcpy(spare_alertpipes[spare_alertpipe_count++], chan->alertpipe, sizeof(chan->alertpipe));
+			ast_alertpipe_clear(chan->alertpipe);
+		}
+		ast_mutex_unlock(&spare_alertpipes_lock);
+	}
 	ast_alertpipe_close(chan->alertpipe);
 }
 
 int ast_channel_internal_alertpipe_init(struct ast_channel *chan)
 {
+	ast_mutex_lock(&spare_alertpipes_lock);
+	if (spare_alertpipe_count) {
+		memcpy(chan->alertpipe, spare_alertpipes[--spare_alertpipe_count], sizeof(chan->alertpipe));
+		ast_mutex_unlock(&spare_alertpipes_lock);
+		return 0;
+	}
+	ast_mutex_unlock(&spare_alertpipes_lock);
+
 	return ast_alertpipe_init(chan->alertpipe);
 }
 
@@ -1322,6 +1378,35 @@ static int pvt_cause_cmp_fn(void *obj, void *vstr, int flags)
 
 #define DIALED_CAUSES_BUCKETS 37
 
+/*! \brief Smallest and largest initial size of the string field pool of a channel */
+#define STRING_FIELD_POOL_MIN 128
+#define STRING_FIELD_POOL_MAX 4096
+
+/*!
+ * \brief Initial size of the string field pool of new channels
+ *
+ * Follows the space the string fields of destroyed channels took up, so
+ * that channels do not usually have to grow their pool. Updates racing
+ * each other only lose a sample.
+ */
+static unsigned int string_field_pool_size = STRING_FIELD_POOL_MIN;
+
+/*! \brief Feed the space the string fields of a destroyed channel took into the pool size */
+static void string_field_pool_size_update(struct ast_channel *chan)
+{
+	struct ast_string_field_pool *pool;
+	unsigned int used = 0;
+	unsigned int size = string_field_pool_size;
+
+	for (pool = chan->__field_mgr_pool; pool; pool = pool->prev) {
+		used += pool->used;
+	}
+
+	/* A moving average over the last eight or so channels */
+	size = (size * 7 + used) / 8;
+	string_field_pool_size = MIN(MAX(size, STRING_FIELD_POOL_MIN), STRING_FIELD_POOL_MAX);
+}
+
 struct ast_channel *__ast_channel_internal_alloc(void (*destructor)(void *obj), const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *file, int line, const char *function)
 {
 	struct ast_channel *tmp;
@@ -1333,7 +1418,7 @@ struct ast_channel *__ast_channel_internal_alloc(void (*destructor)(void *obj),
 		return NULL;
 	}
 
-	if ((ast_string_field_init(tmp, 128))) {
+	if ((ast_string_field_init(tmp, string_field_pool_size))) {
 		return ast_channel_unref(tmp);
 	}
 
@@ -1462,14 +1547,71 @@ void ast_channel_internal_set_fake_ids(struct ast_channel *chan, const char *uni
 	ast_copy_string(chan->linkedid.unique_id, linkedid, sizeof(chan->linkedid.unique_id));
 }
 
+void *ast_channel_arena_alloc(struct ast_channel *chan, size_t size)
+{
+	struct channel_arena_chunk *chunk;
+	void *ptr;
+
+	size = ARENA_ROUND(size);
+
+	if (size > ARENA_CHUNK_SIZE / 4) {
+		/* Large enough for a chunk of its own, so the shared one stays in use */
+		chunk = ast_calloc(1, ARENA_ROUND(sizeof(*chunk)) + size);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->size = chunk->used = size;
+		if (chan->arena) {
+			chunk->next = chan->arena->next;
+			chan->arena->next = chunk;
+		} else {
+			chan->arena = chunk;
+		}
+		return ARENA_CHUNK_DATA(chunk);
+	}
+
+	chunk = chan->arena;
+	if (!chunk || chunk->size - chunk->used < size) {
+		chunk = ast_calloc(1, ARENA_ROUND(sizeof(*chunk)) + ARENA_CHUNK_SIZE);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->size = ARENA_CHUNK_SIZE;
+		chunk->next = chan->arena;
+		chan->arena = chunk;
+	}
+
+	ptr = ARENA_CHUNK_DATA(chunk) + chunk->used;
+	chunk->used += size;
+
+	return ptr;
+}
+
+char *ast_channel_arena_strdup(struct ast_channel *chan, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *copy = ast_channel_arena_alloc(chan, len);
+
+	if (copy) {
+		memcpy(copy, str, len);
+	}
+
+	return copy;
+}
+
 void ast_channel_internal_cleanup(struct ast_channel *chan)
 {
+	struct channel_arena_chunk *chunk;
+
 	if (chan->dialed_causes) {
 		ao2_t_ref(chan->dialed_causes, -1,
 			"done with dialed causes since the channel is going away");
 		chan->dialed_causes = NULL;
 	}
 
+	if (chan->__field_mgr_pool) {
+		string_field_pool_size_update(chan);
+	}
 	ast_string_field_free_memory(chan);
 
 	chan->channel_forward = stasis_forward_cancel(chan->channel_forward);
@@ -1481,6 +1623,12 @@ void ast_channel_internal_cleanup(struct ast_channel *chan)
 	ast_channel_internal_set_stream_topology(chan, NULL);
 
 	AST_VECTOR_FREE(&chan->fds);
+
+	/* Last, as anything freed above may have been in the arena */
+	while ((chunk = chan->arena)) {
+		chan->arena = chunk->next;
+		ast_free(chunk);
+	}
 }
 
 void ast_channel_internal_finalize(struct ast_channel *chan)
@@ -45,6 +45,7 @@ struct ast_var_t *_ast_var_assign(const char *name, const char *value, const cha
 		return NULL;
 	}
 
+	var->hash = ast_var_name_hash(name);
 	ast_copy_string(var->name, name, name_len);
 	var->value = var->name + name_len;
 	ast_copy_string(var->value, value, value_len);
@@ -72,6 +73,17 @@ const char *ast_var_name(const struct ast_var_t *var)
 	return name;
 }
 
+unsigned int ast_var_name_hash(const char *name)
+{
+	/* Hash the name without the initial underscores */
+	if (name[0] == '_') {
+		name++;
+		if (name[0] == '_')
+			name++;
+	}
+	return ast_str_hash(name);
+}
+
 const char *ast_var_full_name(const struct ast_var_t *var)
 {
 	return (var ? var->name : NULL);
@@ -44,6 +44,7 @@
 #include <libgen.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <math.h>	/* HUGE_VAL */
 #include <regex.h>
@@ -1731,6 +1732,193 @@ static void config_cache_attribute(const char *configfile, enum config_cache_att
 	AST_LIST_UNLOCK(&cfmtime_head);
 }
 
+/*! \brief Magic starting each configuration snapshot */
+#define CONFIG_SNAPSHOT_MAGIC "AstCfgS1"
+
+/*! \brief Buckets for the configuration snapshots in memory */
+#define CONFIG_SNAPSHOT_BUCKETS 53
+
+/*!
+ * \brief Records of a configuration snapshot
+ *
+ * The files the configuration was read from come first, so a snapshot can
+ * be checked before anything is built from it.
+ */
+enum config_snapshot_record {
+	/*! A file read, or looked for and missing */
+	SNAPSHOT_FILE = 1,
+	/*! A directory searched by a wildcard pattern */
+	SNAPSHOT_DIR,
+	/*! A file included by another, for the file modtime cache */
+	SNAPSHOT_INCLUDED,
+	/*! A category */
+	SNAPSHOT_CATEGORY,
+	/*! A template the previous category inherited from */
+	SNAPSHOT_TEMPLATE,
+	/*! A variable of the previous category */
+	SNAPSHOT_VARIABLE,
+	/*! An #include of the configuration */
+	SNAPSHOT_INCLUDE,
+};
+
+/*! \brief Growable buffer a configuration snapshot is written to */
+struct config_snapshot_buf {
+	char *data;
+	size_t used;
+	size_t size;
+	/*! Set if growing the buffer failed */
+	int failed;
+};
+
+/*! \brief What a configuration being parsed was read from */
+struct config_snapshot_recorder {
+	/*! The file, directory and include records */
+	struct config_snapshot_buf deps;
+	/*! Set if the configuration cannot be kept, like when it runs #exec */
+	int uncacheable;
+};
+
+/*! \brief The recorder of the configuration the thread is parsing, if any */
+AST_THREADSTORAGE(config_snapshot_recorder);
+
+static void snapshot_put(struct config_snapshot_buf *buf, const void *data, size_t len)
+{
+	if (buf->failed) {
+		return;
+	}
+	if (buf->used + len > buf->size) {
+		size_t size = MAX(buf->size * 2, buf->used + len + 4096);
+		char *grown = ast_realloc(buf->data, size);
+
+		if (!grown) {
+			buf->failed = 1;
+			return;
+		}
+		buf->data = grown;
+		buf->size = size;
+	}
+	memcpy(buf->data + buf->used, data, len);
+	buf->used += len;
+}
+
+static void snapshot_put_int(struct config_snapshot_buf *buf, int64_t value)
+{
+	snapshot_put(buf, &value, sizeof(value));
+}
+
+static void snapshot_put_str(struct config_snapshot_buf *buf, const char *str)
+{
+	size_t len = strlen(str);
+
+	snapshot_put_int(buf, len);
+	snapshot_put(buf, str, len + 1);
+}
+
+/*!
+ * \internal
+ * \brief Get the recorder of the configuration being parsed
+ *
+ * \retval NULL if the configuration is not going to be kept as a snapshot.
+ */
+static struct config_snapshot_recorder *snapshot_recorder_get(void)
+{
+	struct config_snapshot_recorder **recorder;
+
+	recorder = ast_threadstorage_get(&config_snapshot_recorder, sizeof(*recorder));
+	if (!recorder || !*recorder || (*recorder)->uncacheable) {
+		return NULL;
+	}
+	return *recorder;
+}
+
+/*! \brief Keep the configuration being parsed from becoming a snapshot */
+static void snapshot_note_uncacheable(void)
+{
+	struct config_snapshot_recorder *recorder = snapshot_recorder_get();
+
+	if (recorder) {
+		recorder->uncacheable = 1;
+	}
+}
+
+static void snapshot_put_stat(struct config_snapshot_buf *buf, int type, const char *path,
+	struct stat *statbuf)
+{
+	struct cache_file_mtime cfm_buf;
+
+	snapshot_put_int(buf, type);
+	snapshot_put_str(buf, path);
+	if (!statbuf) {
+		snapshot_put_int(buf, -1);
+		snapshot_put_int(buf, 0);
+		snapshot_put_int(buf, 0);
+		return;
+	}
+	cfmstat_save(&cfm_buf, statbuf);
+	snapshot_put_int(buf, cfm_buf.stat_size);
+	snapshot_put_int(buf, cfm_buf.stat_mtime);
+	snapshot_put_int(buf, cfm_buf.stat_mtime_nsec);
+}
+
+/*!
+ * \internal
+ * \brief Note a file the configuration being parsed was looked for in
+ *
+ * \param fn The file
+ * \param statbuf What stat() returned for it, NULL if it is missing
+ */
+static void snapshot_note_file(const char *fn, struct stat *statbuf)
+{
+	struct config_snapshot_recorder *recorder = snapshot_recorder_get();
+
+	if (recorder) {
+		snapshot_put_stat(&recorder->deps, SNAPSHOT_FILE, fn, statbuf);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Note the directory a wildcard pattern of the configuration lists
+ *
+ * Adding or removing a matching file changes the modtime of the directory.
+ * Wildcards in the directory part itself cannot be followed that way.
+ */
+static void snapshot_note_pattern(const char *pattern)
+{
+	struct config_snapshot_recorder *recorder = snapshot_recorder_get();
+	char dir[PATH_MAX];
+	struct stat statbuf;
+	char *slash;
+
+	if (!recorder || !strpbrk(pattern, "*?[{")) {
+		return;
+	}
+
+	ast_copy_string(dir, pattern, sizeof(dir));
+	slash = strrchr(dir, '/');
+	if (slash) {
+		*slash = '\0';
+	}
+	if (!slash || strpbrk(dir, "*?[{")) {
+		recorder->uncacheable = 1;
+		return;
+	}
+
+	snapshot_put_stat(&recorder->deps, SNAPSHOT_DIR, dir, stat(dir, &statbuf) ? NULL : &statbuf);
+}
+
+/*! \brief Note a file included by another of the configuration being parsed */
+static void snapshot_note_included(const char *configfile, const char *include)
+{
+	struct config_snapshot_recorder *recorder = snapshot_recorder_get();
+
+	if (recorder) {
+		snapshot_put_int(&recorder->deps, SNAPSHOT_INCLUDED);
+		snapshot_put_str(&recorder->deps, configfile);
+		snapshot_put_str(&recorder->deps, include);
+	}
+}
+
 /*! \brief parse one line in the configuration.
  * \verbatim
  * We can have a category header	[foo](...)
@@ -1925,6 +2113,7 @@ static int process_text_line(struct ast_config *cfg, struct ast_category **cat,
 
 			if (!ast_test_flag(&flags, CONFIG_FLAG_NOCACHE))
 				config_cache_attribute(configfile, ATTRIBUTE_EXEC, NULL, who_asked);
+			snapshot_note_uncacheable();
 			snprintf(exec_file, sizeof(exec_file), "/var/tmp/exec.%d%d.%ld", (int)now.tv_sec, (int)now.tv_usec, (long)pthread_self());
 			if (snprintf(cmd, sizeof(cmd), "%s > %s 2>&1", cur, exec_file) >= sizeof(cmd)) {
 				ast_log(LOG_ERROR, "Failed to construct command string to execute %s.\n", cur);
@@ -1936,6 +2125,7 @@ static int process_text_line(struct ast_config *cfg, struct ast_category **cat,
 		} else {
 			if (!ast_test_flag(&flags, CONFIG_FLAG_NOCACHE))
 				config_cache_attribute(configfile, ATTRIBUTE_INCLUDE, cur, who_asked);
+			snapshot_note_included(configfile, cur);
 			exec_file[0] = '\0';
 		}
 		/* A #include */
@@ -2039,7 +2229,9 @@ set_new_variable:
 	return 0;
 }
 
-static struct ast_config *config_text_file_load(const char *database, const char *table, const char *filename, struct ast_config *cfg, struct ast_flags flags, const char *suggested_include_file, const char *who_asked)
+static struct ast_config *config_text_file_load(const char *database, const char *table, const char *filename, struct ast_config *cfg, struct ast_flags flags, const char *suggested_include_file, const char *who_asked);
+
+static struct ast_config *config_text_file_parse(const char *database, const char *table, const char *filename, struct ast_config *cfg, struct ast_flags flags, const char *suggested_include_file, const char *who_asked)
 {
 	char fn[256];
 #if defined(LOW_MEMORY)
@@ -2086,6 +2278,10 @@ static struct ast_config *config_text_file_load(const char *database, const char
 		}
 	}
 
+	if (cfg) {
+		snapshot_note_pattern(fn);
+	}
+
 	globbuf.gl_offs = 0;	/* initialize it to silence gcc */
 	glob_ret = glob(fn, MY_GLOB_FLAGS, NULL, &globbuf);
 	if (glob_ret == GLOB_NOSPACE) {
@@ -2124,11 +2320,17 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					if (!ast_test_flag(&flags, CONFIG_FLAG_NOCACHE)) {
 						config_cache_remove(fn, who_asked);
 					}
+					if (cfg) {
+						snapshot_note_file(fn, NULL);
+					}
 					continue;
 				}
 
 				if (!S_ISREG(statbuf.st_mode)) {
 					ast_log(LOG_WARNING, "'%s' is not a regular file, ignoring\n", fn);
+					if (cfg) {
+						snapshot_note_uncacheable();
+					}
 					if (!ast_test_flag(&flags, CONFIG_FLAG_NOCACHE)) {
 						config_cache_remove(fn, who_asked);
 					}
@@ -2187,6 +2389,8 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					continue;
 				}
 
+				snapshot_note_file(fn, &statbuf);
+
 				if (cfmtime) {
 					/* Forget about what we thought we knew about this file's includes. */
 					cfmtime->has_exec = 0;
@@ -2353,26 +2557,632 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					CB_RESET(comment_buffer, lline_buffer);
 				}
 
-				fclose(f);
-			} while (0);
-			if (comment) {
-				ast_log(LOG_WARNING,"Unterminated comment detected beginning on line %d\n", nest[comment - 1]);
-			}
-			if (cfg == NULL || cfg == CONFIG_STATUS_FILEUNCHANGED || cfg == CONFIG_STATUS_FILEINVALID) {
-				break;
-			}
-		}
-		globfree(&globbuf);
+				fclose(f);
+			} while (0);
+			if (comment) {
+				ast_log(LOG_WARNING,"Unterminated comment detected beginning on line %d\n", nest[comment - 1]);
+			}
+			if (cfg == NULL || cfg == CONFIG_STATUS_FILEUNCHANGED || cfg == CONFIG_STATUS_FILEINVALID) {
+				break;
+			}
+		}
+		globfree(&globbuf);
+	}
+
+	ast_free(comment_buffer);
+	ast_free(lline_buffer);
+
+	if (count == 0) {
+		return NULL;
+	}
+
+	return cfg;
+}
+
+/*! \brief A configuration as parsed, with the files it was read from */
+struct config_snapshot {
+	/*! The records, starting with the magic and the file name */
+	char *data;
+	/*! Length of the records */
+	size_t len;
+	/*! Set if the records are mapped from the snapshot file */
+	int mapped;
+	/*! The file name the configuration is loaded by */
+	char filename[0];
+};
+
+/*! \brief The configuration snapshots in memory, by file name */
+static struct ao2_container *config_snapshots;
+
+AO2_STRING_FIELD_HASH_FN(config_snapshot, filename);
+AO2_STRING_FIELD_CMP_FN(config_snapshot, filename);
+
+static void config_snapshot_destructor(void *obj)
+{
+	struct config_snapshot *snapshot = obj;
+
+	if (snapshot->mapped) {
+		munmap(snapshot->data, snapshot->len);
+	} else {
+		ast_free(snapshot->data);
+	}
+}
+
+static struct config_snapshot *config_snapshot_alloc(const char *fn)
+{
+	struct config_snapshot *snapshot;
+
+	snapshot = ao2_alloc_options(sizeof(*snapshot) + strlen(fn) + 1,
+		config_snapshot_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (snapshot) {
+		strcpy(snapshot->filename, fn); /* Safe */
+	}
+	return snapshot;
+}
+
+/*! \brief Position in the records of a configuration snapshot */
+struct config_snapshot_reader {
+	const char *pos;
+	const char *end;
+	/*! Set if the records are cut short or damaged */
+	int failed;
+};
+
+static int64_t snapshot_get_int(struct config_snapshot_reader *reader)
+{
+	int64_t value = 0;
+
+	if (reader->failed || reader->end - reader->pos < sizeof(value)) {
+		reader->failed = 1;
+		return 0;
+	}
+	memcpy(&value, reader->pos, sizeof(value));
+	reader->pos += sizeof(value);
+	return value;
+}
+
+static const char *snapshot_get_str(struct config_snapshot_reader *reader)
+{
+	int64_t len = snapshot_get_int(reader);
+	const char *str;
+
+	if (reader->failed || len < 0 || reader->end - reader->pos <= len || reader->pos[len]) {
+		reader->failed = 1;
+		return "";
+	}
+	str = reader->pos;
+	reader->pos += len + 1;
+	return str;
+}
+
+/*!
+ * \internal
+ * \brief Start reading the records of a snapshot, after its magic and file name
+ *
+ * \retval 0 on success
+ * \retval -1 if this is not a snapshot of the file
+ */
+static int snapshot_read_header(struct config_snapshot *snapshot, struct config_snapshot_reader *reader)
+{
+	reader->pos = snapshot->data;
+	reader->end = snapshot->data + snapshot->len;
+	reader->failed = 0;
+
+	if (snapshot->len < sizeof(CONFIG_SNAPSHOT_MAGIC) - 1
+		|| memcmp(snapshot->data, CONFIG_SNAPSHOT_MAGIC, sizeof(CONFIG_SNAPSHOT_MAGIC) - 1)) {
+		return -1;
+	}
+	reader->pos += sizeof(CONFIG_SNAPSHOT_MAGIC) - 1;
+
+	return strcmp(snapshot_get_str(reader), snapshot->filename) || reader->failed ? -1 : 0;
+}
+
+/*!
+ * \internal
+ * \brief Check that none of the files the snapshot was made from changed
+ *
+ * \retval non-zero if the snapshot can be used.
+ */
+static int config_snapshot_current(struct config_snapshot *snapshot)
+{
+	struct config_snapshot_reader reader;
+
+	if (snapshot_read_header(snapshot, &reader)) {
+		return 0;
+	}
+
+	while (reader.pos < reader.end) {
+		struct cache_file_mtime cfm_buf;
+		struct stat statbuf;
+		const char *path;
+		int64_t type;
+		int64_t size;
+		int64_t mtime;
+		int64_t mtime_nsec;
+
+		type = snapshot_get_int(&reader);
+		if (type != SNAPSHOT_FILE && type != SNAPSHOT_DIR) {
+			/* The files all come first */
+			break;
+		}
+		path = snapshot_get_str(&reader);
+		size = snapshot_get_int(&reader);
+		mtime = snapshot_get_int(&reader);
+		mtime_nsec = snapshot_get_int(&reader);
+		if (reader.failed) {
+			break;
+		}
+
+		if (stat(path, &statbuf)) {
+			if (size != -1) {
+				return 0;
+			}
+			continue;
+		}
+		if (size == -1 || (type == SNAPSHOT_FILE && !S_ISREG(statbuf.st_mode))) {
+			return 0;
+		}
+		cfmstat_save(&cfm_buf, &statbuf);
+		if (size != (int64_t) cfm_buf.stat_size
+			|| mtime != (int64_t) cfm_buf.stat_mtime
+			|| mtime_nsec != (int64_t) cfm_buf.stat_mtime_nsec) {
+			return 0;
+		}
+	}
+
+	return !reader.failed;
+}
+
+/*!
+ * \internal
+ * \brief Remember a file the configuration was read from in the file modtime cache
+ *
+ * This is what parsing the file would have left there.
+ */
+static void config_cache_restore(const char *fn, int64_t size, int64_t mtime, int64_t mtime_nsec,
+	const char *who_asked)
+{
+	struct cache_file_mtime *cfmtime;
+
+	AST_LIST_LOCK(&cfmtime_head);
+	AST_LIST_TRAVERSE(&cfmtime_head, cfmtime, list) {
+		if (!strcmp(cfmtime->filename, fn) && !strcmp(cfmtime->who_asked, who_asked)) {
+			break;
+		}
+	}
+	if (!cfmtime) {
+		cfmtime = cfmtime_new(fn, who_asked);
+		if (!cfmtime) {
+			AST_LIST_UNLOCK(&cfmtime_head);
+			return;
+		}
+		AST_LIST_INSERT_SORTALPHA(&cfmtime_head, cfmtime, list, filename);
+	}
+	cfmtime->has_exec = 0;
+	config_cache_flush_includes(cfmtime);
+	cfmtime->stat_size = size;
+	cfmtime->stat_mtime = mtime;
+	cfmtime->stat_mtime_nsec = mtime_nsec;
+	AST_LIST_UNLOCK(&cfmtime_head);
+}
+
+/*!
+ * \internal
+ * \brief Build the configuration kept in a snapshot
+ *
+ * \param snapshot The snapshot, checked to be current
+ * \param cfg The empty configuration to build it into
+ * \param who_asked Which module asked
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, cfg is left empty
+ */
+static int config_snapshot_build(struct config_snapshot *snapshot, struct ast_config *cfg,
+	const char *who_asked)
+{
+	struct config_snapshot_reader reader;
+	struct ast_config *built;
+	struct ast_category *cat = NULL;
+	struct ast_category_template_instance *x;
+	struct ast_config_include **include_tail;
+
+	if (snapshot_read_header(snapshot, &reader)) {
+		return -1;
+	}
+
+	built = ast_config_new();
+	if (!built) {
+		return -1;
+	}
+	built->include_level = cfg->include_level;
+	include_tail = &built->includes;
+
+	while (!reader.failed && reader.pos < reader.end) {
+		switch (snapshot_get_int(&reader)) {
+		case SNAPSHOT_FILE: {
+			const char *fn = snapshot_get_str(&reader);
+			int64_t size = snapshot_get_int(&reader);
+			int64_t mtime = snapshot_get_int(&reader);
+			int64_t mtime_nsec = snapshot_get_int(&reader);
+
+			if (reader.failed) {
+				break;
+			}
+			if (size < 0) {
+				config_cache_remove(fn, who_asked);
+			} else {
+				config_cache_restore(fn, size, mtime, mtime_nsec, who_asked);
+			}
+			break;
+		}
+		case SNAPSHOT_DIR:
+			snapshot_get_str(&reader);
+			snapshot_get_int(&reader);
+			snapshot_get_int(&reader);
+			snapshot_get_int(&reader);
+			break;
+		case SNAPSHOT_INCLUDED: {
+			const char *configfile = snapshot_get_str(&reader);
+			const char *include = snapshot_get_str(&reader);
+
+			if (!reader.failed) {
+				config_cache_attribute(configfile, ATTRIBUTE_INCLUDE, include, who_asked);
+			}
+			break;
+		}
+		case SNAPSHOT_CATEGORY: {
+			const char *name = snapshot_get_str(&reader);
+			const char *file = snapshot_get_str(&reader);
+			int lineno = snapshot_get_int(&reader);
+			int ignored = snapshot_get_int(&reader);
+			int include_level = snapshot_get_int(&reader);
+
+			if (reader.failed) {
+				break;
+			}
+			cat = ast_category_new(name, file, lineno);
+			if (!cat) {
+				reader.failed = 1;
+				break;
+			}
+			ast_category_append(built, cat);
+			cat->ignored = ignored;
+			cat->include_level = include_level;
+			break;
+		}
+		case SNAPSHOT_TEMPLATE: {
+			const char *name = snapshot_get_str(&reader);
+
+			if (reader.failed || !cat || !(x = ast_calloc(1, sizeof(*x)))) {
+				reader.failed = 1;
+				break;
+			}
+			/* Found once all categories are built, a '+' may have added it later */
+			ast_copy_string(x->name, name, sizeof(x->name));
+			AST_LIST_INSERT_TAIL(&cat->template_instances, x, next);
+			break;
+		}
+		case SNAPSHOT_VARIABLE: {
+			const char *name = snapshot_get_str(&reader);
+			const char *value = snapshot_get_str(&reader);
+			const char *file = snapshot_get_str(&reader);
+			struct ast_variable *var;
+
+			if (reader.failed || !cat || !(var = ast_variable_new(name, value, file))) {
+				reader.failed = 1;
+				break;
+			}
+			var->lineno = snapshot_get_int(&reader);
+			var->object = snapshot_get_int(&reader);
+			var->blanklines = snapshot_get_int(&reader);
+			var->inherited = snapshot_get_int(&reader);
+			ast_variable_append(cat, var);
+			break;
+		}
+		case SNAPSHOT_INCLUDE: {
+			const char *location_file = snapshot_get_str(&reader);
+			int location_lineno = snapshot_get_int(&reader);
+			const char *included_file = snapshot_get_str(&reader);
+			int inclusion_count = snapshot_get_int(&reader);
+			int output = snapshot_get_int(&reader);
+			struct ast_config_include *inc;
+
+			if (reader.failed || !(inc = ast_calloc(1, sizeof(*inc)))) {
+				reader.failed = 1;
+				break;
+			}
+			/* Appended, so the includes stay in the order they were recorded in */
+			*include_tail = inc;
+			include_tail = &inc->next;
+			inc->include_location_file = ast_strdup(location_file);
+			inc->include_location_lineno = location_lineno;
+			inc->included_file = ast_strdup(included_file);
+			inc->inclusion_count = inclusion_count;
+			inc->output = output;
+			if (!inc->include_location_file || !inc->included_file) {
+				reader.failed = 1;
+			}
+			break;
+		}
+		default:
+			reader.failed = 1;
+			break;
+		}
+	}
+
+	if (reader.failed) {
+		ast_config_destroy(built);
+		return -1;
+	}
+
+	for (cat = built->root; cat; cat = cat->next) {
+		AST_LIST_TRAVERSE(&cat->template_instances, x, next) {
+			x->inst = category_get_sep(built, x->name, "TEMPLATES=include", ',', 0);
+		}
+	}
+
+	cfg->root = built->root;
+	cfg->last = built->last;
+	cfg->current = built->last;
+	cfg->includes = built->includes;
+	built->root = built->last = NULL;
+	built->includes = NULL;
+	ast_config_destroy(built);
+
+	return 0;
+}
+
+/*! \brief Find where the snapshot of a configuration is kept on disk */
+static void config_snapshot_disk_path(const char *fn, char *path, size_t size)
+{
+	char md5[33];
+
+	ast_md5_hash(md5, fn);
+	snprintf(path, size, "%s/config_snapshots/%s", ast_config_AST_VAR_DIR, md5);
+}
+
+/*!
+ * \internal
+ * \brief Map the snapshot of a configuration kept on disk
+ *
+ * \retval NULL if there is none for the file.
+ */
+static struct config_snapshot *config_snapshot_read(const char *fn)
+{
+	struct config_snapshot *snapshot;
+	struct config_snapshot_reader reader;
+	char path[PATH_MAX];
+	struct stat statbuf;
+	void *data;
+	int fd;
+
+	config_snapshot_disk_path(fn, path, sizeof(path));
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &statbuf) || !statbuf.st_size) {
+		close(fd);
+		return NULL;
+	}
+	data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	snapshot = config_snapshot_alloc(fn);
+	if (!snapshot) {
+		munmap(data, statbuf.st_size);
+		return NULL;
+	}
+	snapshot->data = data;
+	snapshot->len = statbuf.st_size;
+	snapshot->mapped = 1;
+
+	if (snapshot_read_header(snapshot, &reader)) {
+		ao2_ref(snapshot, -1);
+		return NULL;
+	}
+
+	return snapshot;
+}
+
+/*!
+ * \internal
+ * \brief Write the snapshot of a configuration to disk
+ *
+ * It is written to a temporary file first, so it is never seen half written.
+ */
+static void config_snapshot_write(struct config_snapshot *snapshot)
+{
+	char dir[PATH_MAX];
+	char path[PATH_MAX];
+	char tmp[PATH_MAX + 16];
+	FILE *f;
+	int res;
+
+	snprintf(dir, sizeof(dir), "%s/config_snapshots", ast_config_AST_VAR_DIR);
+	if (ast_mkdir(dir, 0755)) {
+		return;
+	}
+	config_snapshot_disk_path(snapshot->filename, path, sizeof(path));
+	snprintf(tmp, sizeof(tmp), "%s.%d", path, ast_get_tid());
+
+	f = fopen(tmp, "w");
+	if (!f) {
+		ast_debug(1, "Unable to write the snapshot of '%s': %s\n", snapshot->filename, strerror(errno));
+		return;
+	}
+	res = fwrite(snapshot->data, 1, snapshot->len, f) != snapshot->len;
+	res |= fclose(f);
+	if (res || rename(tmp, path)) {
+		ast_debug(1, "Unable to write the snapshot of '%s': %s\n", snapshot->filename, strerror(errno));
+		unlink(tmp);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Keep a configuration just parsed as a snapshot
+ *
+ * \param fn The file name the configuration was loaded by
+ * \param cfg The configuration
+ * \param deps The files it was read from
+ */
+static void config_snapshot_store(const char *fn, struct ast_config *cfg, struct config_snapshot_buf *deps)
+{
+	struct config_snapshot_buf buf = { NULL, };
+	struct config_snapshot *snapshot;
+	struct ast_category *cat;
+	struct ast_category_template_instance *x;
+	struct ast_variable *var;
+	struct ast_config_include *inc;
+
+	if (deps->failed) {
+		return;
+	}
+
+	snapshot_put(&buf, CONFIG_SNAPSHOT_MAGIC, sizeof(CONFIG_SNAPSHOT_MAGIC) - 1);
+	snapshot_put_str(&buf, fn);
+	if (deps->used) {
+		snapshot_put(&buf, deps->data, deps->used);
+	}
+
+	for (cat = cfg->root; cat; cat = cat->next) {
+		snapshot_put_int(&buf, SNAPSHOT_CATEGORY);
+		snapshot_put_str(&buf, cat->name);
+		snapshot_put_str(&buf, cat->file);
+		snapshot_put_int(&buf, cat->lineno);
+		snapshot_put_int(&buf, cat->ignored);
+		snapshot_put_int(&buf, cat->include_level);
+		AST_LIST_TRAVERSE(&cat->template_instances, x, next) {
+			snapshot_put_int(&buf, SNAPSHOT_TEMPLATE);
+			snapshot_put_str(&buf, x->name);
+		}
+		for (var = cat->root; var; var = var->next) {
+			snapshot_put_int(&buf, SNAPSHOT_VARIABLE);
+			snapshot_put_str(&buf, var->name);
+			snapshot_put_str(&buf, var->value);
+			snapshot_put_str(&buf, var->file);
+			snapshot_put_int(&buf, var->lineno);
+			snapshot_put_int(&buf, var->object);
+			snapshot_put_int(&buf, var->blanklines);
+			snapshot_put_int(&buf, var->inherited);
+		}
+	}
+
+	for (inc = cfg->includes; inc; inc = inc->next) {
+		snapshot_put_int(&buf, SNAPSHOT_INCLUDE);
+		snapshot_put_str(&buf, inc->include_location_file);
+		snapshot_put_int(&buf, inc->include_location_lineno);
+		snapshot_put_str(&buf, inc->included_file);
+		snapshot_put_int(&buf, inc->inclusion_count);
+		snapshot_put_int(&buf, inc->output);
+	}
+
+	if (buf.failed || !(snapshot = config_snapshot_alloc(fn))) {
+		ast_free(buf.data);
+		return;
+	}
+	snapshot->data = buf.data;
+	snapshot->len = buf.used;
+
+	ao2_lock(config_snapshots);
+	ao2_find(config_snapshots, fn, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK);
+	ao2_link_flags(config_snapshots, snapshot, OBJ_NOLOCK);
+	ao2_unlock(config_snapshots);
+
+	config_snapshot_write(snapshot);
+	ao2_ref(snapshot, -1);
+}
+
+/*!
+ * \internal
+ * \brief Load a configuration from its snapshot, if none of its files changed
+ *
+ * \retval 0 if cfg was built from the snapshot
+ * \retval -1 if the configuration must be parsed
+ */
+static int config_snapshot_restore(const char *fn, struct ast_config *cfg, const char *who_asked)
+{
+	struct config_snapshot *snapshot;
+
+	snapshot = ao2_find(config_snapshots, fn, OBJ_SEARCH_KEY);
+	if (!snapshot) {
+		snapshot = config_snapshot_read(fn);
+		if (!snapshot) {
+			return -1;
+		}
+		ao2_link(config_snapshots, snapshot);
+	}
+
+	if (!config_snapshot_current(snapshot) || config_snapshot_build(snapshot, cfg, who_asked)) {
+		ao2_unlink(config_snapshots, snapshot);
+		ao2_ref(snapshot, -1);
+		return -1;
+	}
+	ao2_ref(snapshot, -1);
+
+	ast_debug(1, "Loaded %s from its snapshot\n", fn);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Whether a load of a configuration file can use and make snapshots
+ *
+ * Only whole configurations loaded into a new ast_config are kept.  Loads
+ * keeping comments are for rewriting the files and are always parsed.
+ */
+static int config_snapshot_usable(struct ast_config *cfg, struct ast_flags flags,
+	const char *suggested_include_file)
+{
+	return ast_option_config_snapshots
+		&& config_snapshots
+		&& cfg
+		&& cfg->include_level == 1
+		&& !cfg->root
+		&& !cfg->includes
+		&& ast_strlen_zero(suggested_include_file)
+		&& !ast_test_flag(&flags, CONFIG_FLAG_WITHCOMMENTS | CONFIG_FLAG_NOCACHE);
+}
+
+static struct ast_config *config_text_file_load(const char *database, const char *table, const char *filename, struct ast_config *cfg, struct ast_flags flags, const char *suggested_include_file, const char *who_asked)
+{
+	struct config_snapshot_recorder recorder = { { NULL, }, };
+	struct config_snapshot_recorder **current;
+	struct ast_config *result;
+	char fn[256];
+
+	if (!config_snapshot_usable(cfg, flags, suggested_include_file)
+		|| !(current = ast_threadstorage_get(&config_snapshot_recorder, sizeof(*current)))
+		|| *current) {
+		return config_text_file_parse(database, table, filename, cfg, flags, suggested_include_file, who_asked);
+	}
+
+	if (filename[0] == '/') {
+		ast_copy_string(fn, filename, sizeof(fn));
+	} else {
+		snprintf(fn, sizeof(fn), "%s/%s", ast_config_AST_CONFIG_DIR, filename);
+	}
+
+	/* Telling an unchanged file apart is left to the cache of modtimes */
+	if (!ast_test_flag(&flags, CONFIG_FLAG_FILEUNCHANGED)
+		&& !config_snapshot_restore(fn, cfg, who_asked)) {
+		return cfg;
 	}
 
-	ast_free(comment_buffer);
-	ast_free(lline_buffer);
+	*current = &recorder;
+	result = config_text_file_parse(database, table, filename, cfg, flags, suggested_include_file, who_asked);
+	*current = NULL;
 
-	if (count == 0) {
-		return NULL;
+	if (result == cfg && !recorder.uncacheable) {
+		config_snapshot_store(fn, cfg, &recorder.deps);
 	}
+	ast_free(recorder.deps.data);
 
-	return cfg;
+	return result;
 }
 
 
@@ -2853,6 +3663,277 @@ int ast_config_text_file_save2(const char *configfile, const struct ast_config *
 	return 0;
 }
 
+/*! \brief Number of buckets of the realtime cache */
+#define REALTIME_CACHE_BUCKETS 211
+
+/*! \brief Most results kept in the realtime cache */
+#define REALTIME_CACHE_MAX_ENTRIES 4096
+
+/*! \brief Most values of a field looked up in one query by ast_load_realtime_multientry_in */
+#define REALTIME_IN_MAX_VALUES 100
+
+/*! \brief Seconds the results of a realtime family are kept, from the [cache] section of extconfig.conf */
+static struct realtime_cache_ttl {
+	struct realtime_cache_ttl *next;
+	int ttl;
+	char family[0];
+} *realtime_cache_ttls = NULL;
+
+/*! \brief A result kept in the realtime cache */
+struct realtime_cache_entry {
+	/*! When the result is no longer given out */
+	struct timeval expires;
+	/*! The result of ast_load_realtime_all_fields, may be NULL */
+	struct ast_variable *var;
+	/*! The result of ast_load_realtime_multientry_fields, may be NULL */
+	struct ast_config *cfg;
+	/*! Stored in key[] at struct end */
+	const char *family;
+	/*! The kind of lookup, family and fields, each prefixed by its length */
+	char key[0];
+};
+
+static struct ao2_container *realtime_cache;
+
+/*! \brief Results given out of the realtime cache, and looked up anew */
+static int realtime_cache_hits;
+static int realtime_cache_misses;
+
+/*! \brief Bumped by each invalidation, a result looked up across one is not kept */
+static int realtime_cache_generation;
+
+AO2_STRING_FIELD_HASH_FN(realtime_cache_entry, key);
+AO2_STRING_FIELD_CMP_FN(realtime_cache_entry, key);
+
+static void realtime_cache_entry_destroy(void *obj)
+{
+	struct realtime_cache_entry *entry = obj;
+
+	ast_variables_destroy(entry->var);
+	if (entry->cfg) {
+		ast_config_destroy(entry->cfg);
+	}
+}
+
+/*! \note config_lock must be held */
+static void clear_realtime_cache_ttls(void)
+{
+	struct realtime_cache_ttl *ttl;
+
+	while (realtime_cache_ttls) {
+		ttl = realtime_cache_ttls;
+		realtime_cache_ttls = realtime_cache_ttls->next;
+		ast_free(ttl);
+	}
+}
+
+/*! \brief Seconds the results of a realtime family are kept, 0 if they are not */
+static int realtime_cache_ttl(const char *family)
+{
+	struct realtime_cache_ttl *ttl;
+	SCOPED_MUTEX(lock, &config_lock);
+
+	for (ttl = realtime_cache_ttls; ttl; ttl = ttl->next) {
+		if (!strcasecmp(family, ttl->family)) {
+			return ttl->ttl;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Build the key of a realtime lookup
+ *
+ * \param kind 's' for a single entry or 'm' for multiple entries
+ */
+static struct ast_str *realtime_cache_key(char kind, const char *family, const struct ast_variable *fields)
+{
+	struct ast_str *key = ast_str_create(128);
+	const struct ast_variable *field;
+
+	if (!key) {
+		return NULL;
+	}
+
+	/* Prefixing the lengths keeps values holding separators from colliding */
+	ast_str_set(&key, 0, "%c%zu:%s", kind, strlen(family), family);
+	for (field = fields; field; field = field->next) {
+		ast_str_append(&key, 0, "%zu:%s%zu:%s", strlen(field->name), field->name,
+			strlen(field->value), field->value);
+	}
+
+	return key;
+}
+
+/*!
+ * \brief Copy a multiple entry result of the realtime cache
+ */
+static struct ast_config *realtime_cache_config_copy(const struct ast_config *orig)
+{
+	struct ast_config *copy = ast_config_new();
+	struct ast_category *cat;
+
+	if (!copy) {
+		return NULL;
+	}
+
+	for (cat = orig->root; cat; cat = cat->next) {
+		struct ast_category *new_cat = ast_category_new(cat->name, cat->file, cat->lineno);
+
+		if (!new_cat) {
+			ast_config_destroy(copy);
+			return NULL;
+		}
+		ast_category_append(copy, new_cat);
+		if (cat->root) {
+			struct ast_variable *vars = ast_variables_dup(cat->root);
+
+			if (!vars) {
+				ast_config_destroy(copy);
+				return NULL;
+			}
+			ast_variable_append(new_cat, vars);
+		}
+	}
+
+	return copy;
+}
+
+/*!
+ * \brief Find a result in the realtime cache
+ *
+ * \param key The key of the lookup
+ * \param var Set to a copy of the single entry result
+ * \param cfg Set to a copy of the multiple entry result
+ *
+ * \retval 0 if the result was cached, which may be no result
+ * \retval -1 if it is to be looked up
+ */
+static int realtime_cache_find(const char *key, struct ast_variable **var, struct ast_config **cfg)
+{
+	struct realtime_cache_entry *entry;
+
+	if (!realtime_cache) {
+		return -1;
+	}
+
+	entry = ao2_find(realtime_cache, key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		ast_atomic_fetchadd_int(&realtime_cache_misses, 1);
+		return -1;
+	}
+
+	if (ast_tvcmp(ast_tvnow(), entry->expires) >= 0) {
+		ao2_unlink(realtime_cache, entry);
+		ao2_ref(entry, -1);
+		ast_atomic_fetchadd_int(&realtime_cache_misses, 1);
+		return -1;
+	}
+
+	if (var) {
+		*var = entry->var ? ast_variables_dup(entry->var) : NULL;
+		if (entry->var && !*var) {
+			ao2_ref(entry, -1);
+			return -1;
+		}
+	}
+	if (cfg) {
+		*cfg = entry->cfg ? realtime_cache_config_copy(entry->cfg) : NULL;
+		if (entry->cfg && !*cfg) {
+			ao2_ref(entry, -1);
+			return -1;
+		}
+	}
+	ao2_ref(entry, -1);
+
+	ast_atomic_fetchadd_int(&realtime_cache_hits, 1);
+
+	return 0;
+}
+
+/*! \brief Prune results no longer given out */
+static int realtime_cache_prune_cb(void *obj, void *arg, int flags)
+{
+	const struct realtime_cache_entry *entry = obj;
+	const struct timeval *now = arg;
+
+	return ast_tvcmp(*now, entry->expires) >= 0 ? CMP_MATCH : 0;
+}
+
+/*!
+ * \brief Keep a copy of the result of a realtime lookup, which may be no result
+ *
+ * \param generation realtime_cache_generation from before the lookup
+ */
+static void realtime_cache_store(const char *key, const char *family, int ttl, int generation,
+	const struct ast_variable *var, const struct ast_config *cfg)
+{
+	struct realtime_cache_entry *entry;
+	struct timeval now;
+	size_t key_len = strlen(key) + 1;
+
+	if (!realtime_cache) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + key_len + strlen(family) + 1,
+		realtime_cache_entry_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->key, key); /* SAFE */
+	entry->family = strcpy(entry->key + key_len, family); /* SAFE */
+
+	if ((var && !(entry->var = ast_variables_dup((struct ast_variable *) var)))
+		|| (cfg && !(entry->cfg = realtime_cache_config_copy(cfg)))) {
+		ao2_ref(entry, -1);
+		return;
+	}
+
+	now = ast_tvnow();
+	entry->expires = ast_tvadd(now, ast_tv(ttl, 0));
+
+	ao2_lock(realtime_cache);
+	ao2_find(realtime_cache, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	if (ao2_container_count(realtime_cache) >= REALTIME_CACHE_MAX_ENTRIES) {
+		ao2_callback(realtime_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK,
+			realtime_cache_prune_cb, &now);
+	}
+	/* An invalidation takes the container lock after bumping the generation */
+	if (ao2_container_count(realtime_cache) < REALTIME_CACHE_MAX_ENTRIES
+		&& generation == ast_atomic_fetchadd_int(&realtime_cache_generation, 0)) {
+		ao2_link_flags(realtime_cache, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(realtime_cache);
+
+	ao2_ref(entry, -1);
+}
+
+static int realtime_cache_family_cb(void *obj, void *arg, int flags)
+{
+	const struct realtime_cache_entry *entry = obj;
+
+	return !strcasecmp(entry->family, arg) ? CMP_MATCH : 0;
+}
+
+void ast_realtime_cache_invalidate(const char *family)
+{
+	if (!realtime_cache) {
+		return;
+	}
+
+	/* A lookup in progress may have found what is being changed */
+	ast_atomic_fetchadd_int(&realtime_cache_generation, 1);
+
+	if (family) {
+		ao2_callback(realtime_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA,
+			realtime_cache_family_cb, (void *) family);
+	} else {
+		ao2_callback(realtime_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA, NULL, NULL);
+	}
+}
+
 static void clear_config_maps(void)
 {
 	struct ast_config_map *map;
@@ -2913,6 +3994,8 @@ static int reload_module(void)
 	SCOPED_MUTEX(lock, &config_lock);
 
 	clear_config_maps();
+	clear_realtime_cache_ttls();
+	ast_realtime_cache_invalidate(NULL);
 
 	configtmp = ast_config_new();
 	if (!configtmp) {
@@ -2983,6 +4066,26 @@ static int reload_module(void)
 			ast_realtime_append_mapping(v->name, driver, database, table, pri);
 	}
 
+	for (v = ast_variable_browse(config, "cache"); v; v = v->next) {
+		struct realtime_cache_ttl *ttl;
+
+		if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_IN_RANGE, &pri, 0, 86400)) {
+			ast_log(LOG_WARNING, "extconfig.conf: cache time '%s' of '%s' ignored\n", v->value, v->name);
+			continue;
+		}
+
+		ttl = ast_calloc(1, sizeof(*ttl) + strlen(v->name) + 1);
+		if (!ttl) {
+			continue;
+		}
+		strcpy(ttl->family, v->name); /* SAFE */
+		ttl->ttl = pri;
+		ttl->next = realtime_cache_ttls;
+		realtime_cache_ttls = ttl;
+
+		ast_verb(2, "Caching the realtime results of %s for %d seconds\n", ttl->family, ttl->ttl);
+	}
+
 	ast_config_destroy(config);
 	return 0;
 }
@@ -2993,6 +4096,9 @@ int ast_config_engine_register(struct ast_config_engine *new)
 
 	SCOPED_MUTEX(lock, &config_lock);
 
+	/* Families of the engine were not found until now */
+	ast_realtime_cache_invalidate(NULL);
+
 	if (!config_engine_list) {
 		config_engine_list = new;
 	} else {
@@ -3139,6 +4245,11 @@ struct ast_config *ast_config_internal_load(const char *filename, struct ast_con
 		}
 	}
 
+	if (loader != &text_file_engine) {
+		/* Realtime contents change without any file changing */
+		snapshot_note_uncacheable();
+	}
+
 	result = loader->load_func(db, table, filename, cfg, flags, suggested_include_file, who_asked);
 
 	if (result && result != CONFIG_STATUS_FILEINVALID && result != CONFIG_STATUS_FILEUNCHANGED) {
@@ -3269,18 +4380,32 @@ struct ast_variable *ast_load_realtime_all_fields(const char *family, const stru
 	char db[256];
 	char table[256];
 	struct ast_variable *res=NULL;
+	RAII_VAR(struct ast_str *, key, NULL, ast_free);
+	int ttl;
+	int generation;
 	int i;
 
+	ttl = realtime_cache_ttl(family);
+	if (ttl > 0 && (key = realtime_cache_key('s', family, fields))
+		&& !realtime_cache_find(ast_str_buffer(key), &res, NULL)) {
+		return res;
+	}
+	generation = ast_atomic_fetchadd_int(&realtime_cache_generation, 0);
+
 	for (i = 1; ; i++) {
 		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
 			if (eng->realtime_func && (res = eng->realtime_func(db, table, fields))) {
-				return res;
+				break;
 			}
 		} else {
-			return NULL;
+			break;
 		}
 	}
 
+	if (key) {
+		realtime_cache_store(ast_str_buffer(key), family, ttl, generation, res, NULL);
+	}
+
 	return res;
 }
 
@@ -3420,6 +4545,10 @@ int ast_unload_realtime(const char *family)
 			break;
 		}
 	}
+
+	/* The backends forgot the family, and so does the cache */
+	ast_realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3429,8 +4558,18 @@ struct ast_config *ast_load_realtime_multientry_fields(const char *family, const
 	char db[256];
 	char table[256];
 	struct ast_config *res = NULL;
+	RAII_VAR(struct ast_str *, key, NULL, ast_free);
+	int ttl;
+	int generation;
 	int i;
 
+	ttl = realtime_cache_ttl(family);
+	if (ttl > 0 && (key = realtime_cache_key('m', family, fields))
+		&& !realtime_cache_find(ast_str_buffer(key), NULL, &res)) {
+		return res;
+	}
+	generation = ast_atomic_fetchadd_int(&realtime_cache_generation, 0);
+
 	for (i = 1; ; i++) {
 		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
 			if (eng->realtime_multi_func && (res = eng->realtime_multi_func(db, table, fields))) {
@@ -3446,6 +4585,10 @@ struct ast_config *ast_load_realtime_multientry_fields(const char *family, const
 		}
 	}
 
+	if (key) {
+		realtime_cache_store(ast_str_buffer(key), family, ttl, generation, NULL, res);
+	}
+
 	return res;
 }
 
@@ -3465,6 +4608,105 @@ struct ast_config *ast_load_realtime_multientry(const char *family, ...)
 	return ast_load_realtime_multientry_fields(family, fields);
 }
 
+/*! \brief Move the categories of a result to the end of another one */
+static void realtime_config_merge(struct ast_config **res, struct ast_config *part)
+{
+	struct ast_category *cat;
+
+	if (!part) {
+		return;
+	}
+	if (!*res) {
+		*res = part;
+		return;
+	}
+
+	while ((cat = part->root)) {
+		part->root = cat->next;
+		ast_category_append(*res, cat);
+	}
+	part->last = NULL;
+	part->current = NULL;
+	part->last_browse = NULL;
+	ast_config_destroy(part);
+}
+
+/*! \brief Look the values of a field up one at a time, for backends without "IN (...)" */
+static struct ast_config *realtime_multientry_each(const char *family, const char *field,
+	const char * const *values, size_t count, const struct ast_variable *fields)
+{
+	struct ast_config *res = NULL;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		struct ast_variable *lookup;
+
+		lookup = ast_variable_new(field, values[i], "");
+		if (!lookup) {
+			break;
+		}
+		lookup->next = (struct ast_variable *) fields;
+		realtime_config_merge(&res, ast_load_realtime_multientry_fields(family, lookup));
+		lookup->next = NULL;
+		ast_variables_destroy(lookup);
+	}
+
+	return res;
+}
+
+static struct ast_config *realtime_multientry_in(const char *family, const char *field,
+	const char * const *values, size_t count, const struct ast_variable *fields)
+{
+	struct ast_config_engine *eng;
+	char db[256];
+	char table[256];
+	struct ast_config *res = NULL;
+	int i;
+
+	for (i = 1; ; i++) {
+		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
+			if (!eng->realtime_multi_in_func) {
+				return realtime_multientry_each(family, field, values, count, fields);
+			}
+			if ((res = eng->realtime_multi_in_func(db, table, field, values, count, fields))) {
+				/* If we were returned an empty cfg, destroy it and return NULL */
+				if (!res->root) {
+					ast_config_destroy(res);
+					res = NULL;
+				}
+				break;
+			}
+		} else {
+			break;
+		}
+	}
+
+	return res;
+}
+
+struct ast_config *ast_load_realtime_multientry_in(const char *family, const char *field,
+	const char * const *values, size_t count, const struct ast_variable *fields)
+{
+	struct ast_config *res = NULL;
+	size_t done;
+
+	if (ast_strlen_zero(field)) {
+		return NULL;
+	}
+
+	/* Results kept by the cache are of lookups of one value */
+	if (realtime_cache_ttl(family) > 0) {
+		return realtime_multientry_each(family, field, values, count, fields);
+	}
+
+	for (done = 0; done < count; done += REALTIME_IN_MAX_VALUES) {
+		realtime_config_merge(&res, realtime_multientry_in(family, field, values + done,
+			MIN(count - done, REALTIME_IN_MAX_VALUES), fields));
+	}
+
+	return res;
+}
+
 int ast_update_realtime_fields(const char *family, const char *keyfield, const char *lookup, const struct ast_variable *fields)
 {
 	struct ast_config_engine *eng;
@@ -3483,6 +4725,9 @@ int ast_update_realtime_fields(const char *family, const char *keyfield, const c
 		}
 	}
 
+	/* Lookups may find what was changed */
+	ast_realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3519,6 +4764,9 @@ int ast_update2_realtime_fields(const char *family, const struct ast_variable *l
 		}
 	}
 
+	/* Lookups may find what was changed */
+	ast_realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3564,6 +4812,9 @@ int ast_store_realtime_fields(const char *family, const struct ast_variable *fie
 		}
 	}
 
+	/* Lookups may find what was changed */
+	ast_realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3600,6 +4851,9 @@ int ast_destroy_realtime_fields(const char *family, const char *keyfield, const
 		}
 	}
 
+	/* Lookups may find what was changed */
+	ast_realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -4039,10 +5293,45 @@ static char *handle_cli_config_list(struct ast_cli_entry *e, int cmd, struct ast
 	return CLI_SUCCESS;
 }
 
+static char *handle_cli_realtime_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct realtime_cache_ttl *ttl;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "realtime show cache";
+		e->usage =
+			"Usage: realtime show cache\n"
+			"	Shows the realtime families whose results are cached, and how\n"
+			"	often lookups were answered from the cache.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	{
+		SCOPED_MUTEX(lock, &config_lock);
+
+		if (!realtime_cache_ttls) {
+			ast_cli(a->fd, "No realtime families are cached.\n");
+		}
+		for (ttl = realtime_cache_ttls; ttl; ttl = ttl->next) {
+			ast_cli(a->fd, "%-30s %d seconds\n", ttl->family, ttl->ttl);
+		}
+	}
+
+	ast_cli(a->fd, "Results cached: %d\n", realtime_cache ? ao2_container_count(realtime_cache) : 0);
+	ast_cli(a->fd, "Lookups answered: %d\n", ast_atomic_fetchadd_int(&realtime_cache_hits, 0));
+	ast_cli(a->fd, "Lookups made: %d\n", ast_atomic_fetchadd_int(&realtime_cache_misses, 0));
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_config[] = {
 	AST_CLI_DEFINE(handle_cli_core_show_config_mappings, "Display config mappings (file names to config engines)"),
 	AST_CLI_DEFINE(handle_cli_config_reload, "Force a reload on modules using a particular configuration file"),
 	AST_CLI_DEFINE(handle_cli_config_list, "Show all files that have loaded a configuration file"),
+	AST_CLI_DEFINE(handle_cli_realtime_show_cache, "Show the realtime families whose results are cached"),
 };
 
 static void config_shutdown(void)
@@ -4058,13 +5347,24 @@ static void config_shutdown(void)
 	ast_cli_unregister_multiple(cli_config, ARRAY_LEN(cli_config));
 
 	clear_config_maps();
+	clear_realtime_cache_ttls();
+
+	ao2_cleanup(realtime_cache);
+	realtime_cache = NULL;
 
 	ao2_cleanup(cfg_hooks);
 	cfg_hooks = NULL;
+
+	ao2_cleanup(config_snapshots);
+	config_snapshots = NULL;
 }
 
 int register_config_cli(void)
 {
+	config_snapshots = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		CONFIG_SNAPSHOT_BUCKETS, config_snapshot_hash_fn, NULL, config_snapshot_cmp_fn);
+	realtime_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		REALTIME_CACHE_BUCKETS, realtime_cache_entry_hash_fn, NULL, realtime_cache_entry_cmp_fn);
 	ast_cli_register_multiple(cli_config, ARRAY_LEN(cli_config));
 	/* This is separate from the module load so cleanup can happen very late. */
 	ast_register_cleanup(config_shutdown);
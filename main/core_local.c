@@ -135,6 +135,19 @@ static const char tdesc[] = "Local Proxy Channel Driver";
 
 static struct ao2_container *locals;
 
+/*! Buckets of the time to optimize histogram, each twice as long as the last, from 1ms */
+#define LOCAL_OPTIMIZE_BUCKETS 16
+
+/*! \brief Outcome of the local channel pairs that have been destroyed */
+static struct {
+	/*! Pairs optimized out, by how long after their creation */
+	int optimized[LOCAL_OPTIMIZE_BUCKETS];
+	/*! Pairs that could have optimized out but never did */
+	int never_optimized;
+	/*! Pairs created with the /n option */
+	int no_optimization;
+} local_stats;
+
 static struct ast_channel *local_request(const char *type, struct ast_format_cap *cap, const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *data, int *cause);
 static int local_call(struct ast_channel *ast, const char *dest, int timeout);
 static int local_hangup(struct ast_channel *ast);
@@ -838,10 +851,35 @@ static int local_hangup(struct ast_channel *ast)
  *
  * \return Nothing
  */
+/*!
+ * \internal
+ * \brief Account for whether and how fast the pair being destroyed optimized out
+ */
+static void local_stats_update(struct local_pvt *doomed)
+{
+	int64_t ms;
+	int bucket;
+
+	if (ast_test_flag(&doomed->base, AST_UNREAL_OPTIMIZED)) {
+		ms = ast_tvdiff_ms(doomed->base.optimized, doomed->base.created);
+		bucket = 0;
+		while (bucket < LOCAL_OPTIMIZE_BUCKETS - 1 && ms >= (INT64_C(1) << bucket)) {
+			++bucket;
+		}
+		ast_atomic_fetchadd_int(&local_stats.optimized[bucket], +1);
+	} else if (ast_test_flag(&doomed->base, AST_UNREAL_NO_OPTIMIZATION)) {
+		ast_atomic_fetchadd_int(&local_stats.no_optimization, +1);
+	} else {
+		ast_atomic_fetchadd_int(&local_stats.never_optimized, +1);
+	}
+}
+
 static void local_pvt_destructor(void *vdoomed)
 {
 	struct local_pvt *doomed = vdoomed;
 
+	local_stats_update(doomed);
+
 	switch (doomed->type) {
 	case LOCAL_CALL_ACTION_DIALPLAN:
 		break;
@@ -976,8 +1014,49 @@ static char *locals_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *
 	return CLI_SUCCESS;
 }
 
+/*! \brief CLI command "local show optimizations" */
+static char *locals_show_optimizations(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int optimized = 0;
+	int bucket;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "local show optimizations";
+		e->usage =
+			"Usage: local show optimizations\n"
+			"       Shows how many of the local channel pairs destroyed so far\n"
+			"       optimized out, and how long after their creation they did.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	for (bucket = 0; bucket < LOCAL_OPTIMIZE_BUCKETS; ++bucket) {
+		optimized += local_stats.optimized[bucket];
+	}
+
+	ast_cli(a->fd, "Optimized out:            %d\n", optimized);
+	ast_cli(a->fd, "Never optimized out:      %d\n", local_stats.never_optimized);
+	ast_cli(a->fd, "Optimization disabled:    %d\n", local_stats.no_optimization);
+	ast_cli(a->fd, "\nTime to optimize out:\n");
+	for (bucket = 0; bucket < LOCAL_OPTIMIZE_BUCKETS - 1; ++bucket) {
+		ast_cli(a->fd, "  < %6lld ms:  %d\n", (long long) (INT64_C(1) << bucket),
+			local_stats.optimized[bucket]);
+	}
+	ast_cli(a->fd, "  >= %5lld ms:  %d\n", (long long) (INT64_C(1) << (bucket - 1)),
+		local_stats.optimized[bucket]);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_local[] = {
 	AST_CLI_DEFINE(locals_show, "List status of local channels"),
+	AST_CLI_DEFINE(locals_show_optimizations, "Show how local channels optimized out"),
 };
 
 static int manager_optimize_away(struct mansession *s, const struct message *m)
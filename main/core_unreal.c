@@ -306,6 +306,11 @@ static int got_optimized_out(struct ast_channel *ast, struct ast_unreal_pvt *p)
 		res = ast_bridge_unreal_optimize_out(p->chan, p->owner, p);
 	}
 
+	if (res && !ast_test_flag(p, AST_UNREAL_OPTIMIZED)) {
+		ast_set_flag(p, AST_UNREAL_OPTIMIZED);
+		p->optimized = ast_tvnow();
+	}
+
 	return res;
 }
 
@@ -583,6 +588,17 @@ int ast_unreal_indicate(struct ast_channel *ast, int condition, const void *data
 		unreal_queue_indicate(p, ast, condition, data, datalen);
 		res = -1;
 		break;
+	case AST_CONTROL_SRCCHANGE:
+		/*
+		 * The bridge indicates a source change when we enter it.  Try
+		 * to optimize out right away instead of on the first voice
+		 * frame, which may be a while coming.
+		 */
+		ao2_lock(p);
+		got_optimized_out(ast, p);
+		ao2_unlock(p);
+		res = unreal_queue_indicate(p, ast, condition, data, datalen);
+		break;
 	default:
 		res = unreal_queue_indicate(p, ast, condition, data, datalen);
 		break;
@@ -943,6 +959,7 @@ struct ast_unreal_pvt *ast_unreal_alloc(size_t size, ao2_destructor_fn destructo
 	ast_format_cap_append_from_cap(unreal->reqcap, cap, AST_MEDIA_TYPE_UNKNOWN);
 
 	memcpy(&unreal->jb_conf, &jb_conf, sizeof(unreal->jb_conf));
+	unreal->created = ast_tvnow();
 
 	return unreal;
 }
@@ -34,6 +34,7 @@
 #include "asterisk/logger.h"
 #include "asterisk/strings.h"
 #include "asterisk/data_buffer.h"
+#include "asterisk/frame.h"
 #include "asterisk/linkedlists.h"
 
 /*!
@@ -366,3 +367,13 @@ size_t ast_data_buffer_max(const struct ast_data_buffer *buffer)
 
 	return buffer->max;
 }
+
+void *ast_data_buffer_payload_alloc(size_t size)
+{
+	return ast_frame_payload_alloc(size);
+}
+
+void ast_data_buffer_payload_free(void *payload)
+{
+	ast_frame_payload_free(payload);
+}
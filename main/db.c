@@ -51,6 +51,9 @@
 #include "asterisk/cli.h"
 #include "asterisk/utils.h"
 #include "asterisk/manager.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/time.h"
+#include "asterisk/options.h"
 
 /*** DOCUMENTATION
 	<manager name="DBGet" language="en_US">
@@ -105,42 +108,70 @@
  ***/
 
 #define MAX_DB_FIELD 256
+#define PENDING_BUCKETS 127
 AST_MUTEX_DEFINE_STATIC(dblock);
-static ast_cond_t dbcond;
 static sqlite3 *astdb;
 static pthread_t syncthread;
+
+/*!
+ * \brief A key and its value
+ */
+struct db_record {
+	/*! The value, NULL if the key is being deleted */
+	const char *value;
+	/*! The full key */
+	char key[0];
+};
+
+/*!
+ * \brief Protects the in-memory copy of the database, the pending changes,
+ * the statistics and waking the sync thread.
+ *
+ * \note If dblock is also needed it must be locked first.
+ */
+AST_MUTEX_DEFINE_STATIC(pending_lock);
+static ast_cond_t dbcond;
+/*! Every key in the database with its current value, ordered by key */
+static struct ao2_container *records;
+/*! Changes waiting for the sync thread, by key */
+static struct ao2_container *pending;
+/*! Empty container swapped in when the pending changes are written */
+static struct ao2_container *pending_spare;
 static int doexit;
 static int dosync;
 
+/*! \brief Database statistics (Protected by pending_lock) */
+static struct {
+	/*! Keys read */
+	unsigned long reads;
+	/*! Keys read that did not exist */
+	unsigned long not_found;
+	/*! Trees read */
+	unsigned long tree_reads;
+	/*! Puts and deletes queued */
+	unsigned long writes;
+	/*! Queued writes replacing a write to the same key */
+	unsigned long coalesced;
+	/*! Batches written */
+	unsigned long batches;
+	/*! Changes written */
+	unsigned long written;
+	/*! Total and longest time to write and commit a batch, in microseconds */
+	int64_t batch_time;
+	int64_t batch_time_max;
+} db_stats;
+
 static void db_sync(void);
+static int db_execute_sql(const char *sql, int (*callback)(void *, int, char **, char **), void *arg);
 
 #define DEFINE_SQL_STATEMENT(stmt,sql) static sqlite3_stmt *stmt; \
 	const char stmt##_sql[] = sql;
 
 DEFINE_SQL_STATEMENT(put_stmt, "INSERT OR REPLACE INTO astdb (key, value) VALUES (?, ?)")
-DEFINE_SQL_STATEMENT(get_stmt, "SELECT value FROM astdb WHERE key=?")
 DEFINE_SQL_STATEMENT(del_stmt, "DELETE FROM astdb WHERE key=?")
-DEFINE_SQL_STATEMENT(deltree_stmt, "DELETE FROM astdb WHERE key || '/' LIKE ? || '/' || '%'")
-DEFINE_SQL_STATEMENT(deltree_all_stmt, "DELETE FROM astdb")
-DEFINE_SQL_STATEMENT(gettree_stmt, "SELECT key, value FROM astdb WHERE key || '/' LIKE ? || '/' || '%' ORDER BY key")
 DEFINE_SQL_STATEMENT(gettree_all_stmt, "SELECT key, value FROM astdb ORDER BY key")
-DEFINE_SQL_STATEMENT(showkey_stmt, "SELECT key, value FROM astdb WHERE key LIKE '%' || '/' || ? ORDER BY key")
 DEFINE_SQL_STATEMENT(create_astdb_stmt, "CREATE TABLE IF NOT EXISTS astdb(key VARCHAR(256), value VARCHAR(256), PRIMARY KEY(key))")
 
-/* This query begs an explanation:
- *
- * First, the parameter binding syntax used here is slightly different than the other
- * queries in that we use a numbered parameter so that we can bind once and get the same
- * value substituted multiple times within the executed query.
- *
- * Second, the key comparison is being used to find all keys that are lexicographically
- * greater than the provided key, but less than the provided key with a high (but
- * invalid) Unicode codepoint appended to it. This will give us all keys in the database
- * that have 'key' as a prefix and performs much better than the equivalent "LIKE key ||
- * '%'" operation.
- */
-DEFINE_SQL_STATEMENT(gettree_prefix_stmt, "SELECT key, value FROM astdb WHERE key > ?1 AND key <= ?1 || X'ffff'")
-
 static int init_stmt(sqlite3_stmt **stmt, const char *sql, size_t len)
 {
 	ast_mutex_lock(&dblock);
@@ -175,14 +206,8 @@ static int clean_stmt(sqlite3_stmt **stmt, const char *sql)
  */
 static void clean_statements(void)
 {
-	clean_stmt(&get_stmt, get_stmt_sql);
 	clean_stmt(&del_stmt, del_stmt_sql);
-	clean_stmt(&deltree_stmt, deltree_stmt_sql);
-	clean_stmt(&deltree_all_stmt, deltree_all_stmt_sql);
-	clean_stmt(&gettree_stmt, gettree_stmt_sql);
 	clean_stmt(&gettree_all_stmt, gettree_all_stmt_sql);
-	clean_stmt(&gettree_prefix_stmt, gettree_prefix_stmt_sql);
-	clean_stmt(&showkey_stmt, showkey_stmt_sql);
 	clean_stmt(&put_stmt, put_stmt_sql);
 	clean_stmt(&create_astdb_stmt, create_astdb_stmt_sql);
 }
@@ -191,14 +216,8 @@ static int init_statements(void)
 {
 	/* Don't initialize create_astdb_statement here as the astdb table needs to exist
 	 * brefore these statements can be initialized */
-	return init_stmt(&get_stmt, get_stmt_sql, sizeof(get_stmt_sql))
-	|| init_stmt(&del_stmt, del_stmt_sql, sizeof(del_stmt_sql))
-	|| init_stmt(&deltree_stmt, deltree_stmt_sql, sizeof(deltree_stmt_sql))
-	|| init_stmt(&deltree_all_stmt, deltree_all_stmt_sql, sizeof(deltree_all_stmt_sql))
-	|| init_stmt(&gettree_stmt, gettree_stmt_sql, sizeof(gettree_stmt_sql))
+	return init_stmt(&del_stmt, del_stmt_sql, sizeof(del_stmt_sql))
 	|| init_stmt(&gettree_all_stmt, gettree_all_stmt_sql, sizeof(gettree_all_stmt_sql))
-	|| init_stmt(&gettree_prefix_stmt, gettree_prefix_stmt_sql, sizeof(gettree_prefix_stmt_sql))
-	|| init_stmt(&showkey_stmt, showkey_stmt_sql, sizeof(showkey_stmt_sql))
 	|| init_stmt(&put_stmt, put_stmt_sql, sizeof(put_stmt_sql));
 }
 
@@ -236,6 +255,154 @@ static int db_create_astdb(void)
 	return res;
 }
 
+AO2_STRING_FIELD_HASH_FN(db_record, key);
+AO2_STRING_FIELD_CMP_FN(db_record, key);
+AO2_STRING_FIELD_SORT_FN(db_record, key);
+
+static struct ao2_container *db_pending_alloc(void)
+{
+	return ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, PENDING_BUCKETS,
+		db_record_hash_fn, NULL, db_record_cmp_fn);
+}
+
+static struct db_record *db_record_alloc(const char *fullkey, size_t fullkey_len, const char *value)
+{
+	struct db_record *record;
+	size_t value_len = value ? strlen(value) + 1 : 0;
+
+	record = ao2_alloc_options(sizeof(*record) + fullkey_len + 1 + value_len, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!record) {
+		return NULL;
+	}
+	memcpy(record->key, fullkey, fullkey_len + 1);
+	if (value) {
+		record->value = record->key + fullkey_len + 1;
+		memcpy((char *) record->value, value, value_len);
+	}
+
+	return record;
+}
+
+/*!
+ * \internal
+ * \brief Queue a change to a key for the sync thread
+ *
+ * \param record The key with its new value, or without a value to delete it.
+ *
+ * \note pending_lock must be held.
+ */
+static void db_pending_add(struct db_record *record)
+{
+	if (ao2_find(pending, record->key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA)) {
+		++db_stats.coalesced;
+	}
+	ao2_link(pending, record);
+	++db_stats.writes;
+
+	dosync = 1;
+	ast_cond_signal(&dbcond);
+}
+
+/*!
+ * \internal
+ * \brief Queue deleting a key
+ *
+ * \note pending_lock must be held.
+ */
+static int db_pending_del(const char *fullkey, size_t fullkey_len)
+{
+	struct db_record *record;
+
+	record = db_record_alloc(fullkey, fullkey_len, NULL);
+	if (!record) {
+		return -1;
+	}
+	db_pending_add(record);
+	ao2_ref(record, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Write the pending changes into the open transaction
+ *
+ * \note dblock must be held.
+ *
+ * \return Number of changes written
+ */
+static int db_pending_flush(void)
+{
+	struct ao2_container *batch;
+	struct ao2_iterator iter;
+	struct db_record *change;
+	int count = 0;
+
+	ast_mutex_lock(&pending_lock);
+	batch = pending;
+	pending = pending_spare;
+	pending_spare = NULL;
+	ast_mutex_unlock(&pending_lock);
+
+	iter = ao2_iterator_init(batch, AO2_ITERATOR_UNLINK);
+	for (; (change = ao2_iterator_next(&iter)); ao2_ref(change, -1)) {
+		sqlite3_stmt *stmt = change->value ? put_stmt : del_stmt;
+
+		++count;
+		if (sqlite3_bind_text(stmt, 1, change->key, -1, SQLITE_STATIC) != SQLITE_OK
+			|| (change->value
+				&& sqlite3_bind_text(stmt, 2, change->value, -1, SQLITE_STATIC) != SQLITE_OK)) {
+			ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
+		} else if (sqlite3_step(stmt) != SQLITE_DONE) {
+			ast_log(LOG_WARNING, "Couldn't write key '%s': %s\n", change->key, sqlite3_errmsg(astdb));
+		}
+		sqlite3_reset(stmt);
+	}
+	ao2_iterator_destroy(&iter);
+
+	ast_mutex_lock(&pending_lock);
+	pending_spare = batch;
+	ast_mutex_unlock(&pending_lock);
+
+	return count;
+}
+
+/*!
+ * \internal
+ * \brief Replace the in-memory copy of the database with what it contains
+ *
+ * \note dblock must be held and nothing must be pending.
+ */
+static int db_records_load(void)
+{
+	struct db_record *record;
+	int res = 0;
+
+	ast_mutex_lock(&pending_lock);
+	ao2_callback(records, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA, NULL, NULL);
+	while (sqlite3_step(gettree_all_stmt) == SQLITE_ROW) {
+		const char *key = (const char *) sqlite3_column_text(gettree_all_stmt, 0);
+		const char *value = (const char *) sqlite3_column_text(gettree_all_stmt, 1);
+
+		if (!key || !value) {
+			ast_log(LOG_WARNING, "Skipping invalid key!\n");
+			continue;
+		}
+		record = db_record_alloc(key, strlen(key), value);
+		if (!record) {
+			res = -1;
+			break;
+		}
+		ao2_link(records, record);
+		ao2_ref(record, -1);
+	}
+	sqlite3_reset(gettree_all_stmt);
+	ast_mutex_unlock(&pending_lock);
+
+	return res;
+}
+
 static int db_open(void)
 {
 	char *dbname;
@@ -274,6 +441,17 @@ static int db_open(void)
 		return -1;
 	}
 
+	if (ast_option_astdb_wal) {
+		/*
+		 * Commits only append to the write-ahead log and are no longer
+		 * waited for by the disk most of the time.
+		 */
+		if (db_execute_sql("PRAGMA journal_mode=WAL", NULL, NULL)
+			|| db_execute_sql("PRAGMA synchronous=NORMAL", NULL, NULL)) {
+			ast_log(LOG_WARNING, "Unable to use write-ahead logging for the Asterisk database\n");
+		}
+	}
+
 	ast_mutex_unlock(&dblock);
 
 	return 0;
@@ -326,9 +504,9 @@ static int ast_db_rollback_transaction(void)
 
 int ast_db_put(const char *family, const char *key, const char *value)
 {
+	struct db_record *record;
 	char fullkey[MAX_DB_FIELD];
 	size_t fullkey_len;
-	int res = 0;
 
 	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
 		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
@@ -337,23 +515,19 @@ int ast_db_put(const char *family, const char *key, const char *value)
 
 	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(put_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_bind_text(put_stmt, 2, value, -1, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind value to stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_step(put_stmt) != SQLITE_DONE) {
-		ast_log(LOG_WARNING, "Couldn't execute statement: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
+	record = db_record_alloc(fullkey, fullkey_len, value);
+	if (!record) {
+		return -1;
 	}
 
-	sqlite3_reset(put_stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	/* Written by the sync thread so disk I/O does not hold up the caller. */
+	ast_mutex_lock(&pending_lock);
+	ao2_link(records, record);
+	db_pending_add(record);
+	ast_mutex_unlock(&pending_lock);
+	ao2_ref(record, -1);
 
-	return res;
+	return 0;
 }
 
 /*!
@@ -372,7 +546,7 @@ int ast_db_put(const char *family, const char *key, const char *value)
  */
 static int db_get_common(const char *family, const char *key, char **buffer, int bufferlen)
 {
-	const unsigned char *result;
+	struct db_record *record;
 	char fullkey[MAX_DB_FIELD];
 	size_t fullkey_len;
 	int res = 0;
@@ -383,28 +557,27 @@ static int db_get_common(const char *family, const char *key, char **buffer, int
 	}
 
 	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
+	if (fullkey_len >= sizeof(fullkey)) {
+		return -1;
+	}
 
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(get_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_step(get_stmt) != SQLITE_ROW) {
+	ast_mutex_lock(&pending_lock);
+	++db_stats.reads;
+	record = ao2_find(records, fullkey, OBJ_SEARCH_KEY);
+	if (!record) {
+		++db_stats.not_found;
+		ast_mutex_unlock(&pending_lock);
 		ast_debug(1, "Unable to find key '%s' in family '%s'\n", key, family);
-		res = -1;
-	} else if (!(result = sqlite3_column_text(get_stmt, 0))) {
-		ast_log(LOG_WARNING, "Couldn't get value\n");
-		res = -1;
-	} else {
-		const char *value = (const char *) result;
+		return -1;
+	}
+	ast_mutex_unlock(&pending_lock);
 
-		if (bufferlen == -1) {
-			*buffer = ast_strdup(value);
-		} else {
-			ast_copy_string(*buffer, value, bufferlen);
-		}
+	if (bufferlen == -1) {
+		*buffer = ast_strdup(record->value);
+	} else {
+		ast_copy_string(*buffer, record->value, bufferlen);
 	}
-	sqlite3_reset(get_stmt);
-	ast_mutex_unlock(&dblock);
+	ao2_ref(record, -1);
 
 	return res;
 }
@@ -430,7 +603,7 @@ int ast_db_del(const char *family, const char *key)
 {
 	char fullkey[MAX_DB_FIELD];
 	size_t fullkey_len;
-	int res = 0;
+	int res;
 
 	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
 		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
@@ -439,26 +612,111 @@ int ast_db_del(const char *family, const char *key)
 
 	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(del_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_step(del_stmt) != SQLITE_DONE) {
-		ast_debug(1, "Unable to find key '%s' in family '%s'\n", key, family);
-		res = -1;
-	}
-	sqlite3_reset(del_stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	/* Deleted by the sync thread like a put. */
+	ast_mutex_lock(&pending_lock);
+	ao2_find(records, fullkey, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	res = db_pending_del(fullkey, fullkey_len);
+	ast_mutex_unlock(&pending_lock);
 
 	return res;
 }
 
+/*! \brief Where a tree of keys is collected */
+struct db_tree {
+	/*! Length of the prefix keys must start with */
+	size_t prefix_len;
+	/*! Set to match keys that extend the prefix, instead of keys in the keytree it names */
+	int by_prefix;
+	struct ast_db_entry *head;
+	struct ast_db_entry *tail;
+	int count;
+};
+
+/*!
+ * \internal
+ * \brief Whether a key starting with the tree's prefix belongs to the tree
+ */
+static int db_tree_match(const struct db_tree *tree, const char *key)
+{
+	if (tree->by_prefix) {
+		/* Keys greater than the prefix */
+		return key[tree->prefix_len] != '\0';
+	}
+
+	/* The prefix itself and the keys below it */
+	return !tree->prefix_len || key[tree->prefix_len] == '\0' || key[tree->prefix_len] == '/';
+}
+
+static int db_tree_collect_cb(void *obj, void *arg, void *data, int flags)
+{
+	struct db_record *record = obj;
+	struct db_tree *tree = data;
+	struct ast_db_entry *cur;
+	size_t key_len;
+	size_t value_len;
+
+	if (!db_tree_match(tree, record->key)) {
+		return 0;
+	}
+
+	key_len = strlen(record->key);
+	value_len = strlen(record->value);
+	cur = ast_malloc(sizeof(*cur) + key_len + value_len + 2);
+	if (!cur) {
+		return CMP_STOP;
+	}
+
+	cur->next = NULL;
+	cur->key = cur->data + value_len + 1;
+	memcpy(cur->data, record->value, value_len + 1);
+	memcpy(cur->key, record->key, key_len + 1);
+
+	if (tree->tail) {
+		tree->tail->next = cur;
+	} else {
+		tree->head = cur;
+	}
+	tree->tail = cur;
+	++tree->count;
+
+	return 0;
+}
+
+static int db_tree_delete_cb(void *obj, void *arg, void *data, int flags)
+{
+	struct db_record *record = obj;
+	struct db_tree *tree = data;
+
+	if (!db_tree_match(tree, record->key)
+		|| db_pending_del(record->key, strlen(record->key))) {
+		return 0;
+	}
+	++tree->count;
+
+	return CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Visit the keys in a tree in order
+ *
+ * \param prefix The keys to visit start with it, all keys if empty.
+ *
+ * \note pending_lock must be held.
+ */
+static void db_tree_visit(const char *prefix, struct db_tree *tree, ao2_callback_data_fn *cb_fn, int flags)
+{
+	tree->prefix_len = strlen(prefix);
+	if (tree->prefix_len) {
+		flags |= OBJ_SEARCH_PARTIAL_KEY;
+	}
+	ao2_callback_data(records, flags | OBJ_MULTIPLE | OBJ_NODATA, cb_fn, (void *) prefix, tree);
+}
+
 int ast_db_deltree(const char *family, const char *keytree)
 {
-	sqlite3_stmt *stmt = deltree_stmt;
+	struct db_tree tree = { 0, };
 	char prefix[MAX_DB_FIELD];
-	int res = 0;
 
 	if (!ast_strlen_zero(family)) {
 		if (!ast_strlen_zero(keytree)) {
@@ -470,70 +728,35 @@ int ast_db_deltree(const char *family, const char *keytree)
 		}
 	} else {
 		prefix[0] = '\0';
-		stmt = deltree_all_stmt;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_step(stmt) != SQLITE_DONE) {
-		ast_log(LOG_WARNING, "Couldn't execute stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	}
-	res = sqlite3_changes(astdb);
-	sqlite3_reset(stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	ast_mutex_lock(&pending_lock);
+	db_tree_visit(prefix, &tree, db_tree_delete_cb, OBJ_UNLINK);
+	ast_mutex_unlock(&pending_lock);
 
-	return res;
+	return tree.count;
 }
 
-static struct ast_db_entry *db_gettree_common(sqlite3_stmt *stmt)
+/*!
+ * \internal
+ * \brief Copy the keys and values of a tree from memory
+ */
+static struct ast_db_entry *db_gettree_common(const char *prefix, int by_prefix)
 {
-	struct ast_db_entry *head = NULL, *prev = NULL, *cur;
-
-	while (sqlite3_step(stmt) == SQLITE_ROW) {
-		const char *key, *value;
-		size_t key_len, value_len;
+	struct db_tree tree = { .by_prefix = by_prefix, };
 
-		key   = (const char *) sqlite3_column_text(stmt, 0);
-		value = (const char *) sqlite3_column_text(stmt, 1);
+	ast_mutex_lock(&pending_lock);
+	++db_stats.tree_reads;
+	db_tree_visit(prefix, &tree, db_tree_collect_cb, 0);
+	ast_mutex_unlock(&pending_lock);
 
-		if (!key || !value) {
-			break;
-		}
-
-		key_len = strlen(key);
-		value_len = strlen(value);
-
-		cur = ast_malloc(sizeof(*cur) + key_len + value_len + 2);
-		if (!cur) {
-			break;
-		}
-
-		cur->next = NULL;
-		cur->key = cur->data + value_len + 1;
-		memcpy(cur->data, value, value_len + 1);
-		memcpy(cur->key, key, key_len + 1);
-
-		if (prev) {
-			prev->next = cur;
-		} else {
-			head = cur;
-		}
-		prev = cur;
-	}
-
-	return head;
+	return tree.head;
 }
 
 struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 {
 	char prefix[MAX_DB_FIELD];
-	sqlite3_stmt *stmt = gettree_stmt;
 	size_t res = 0;
-	struct ast_db_entry *ret;
 
 	if (!ast_strlen_zero(family)) {
 		if (!ast_strlen_zero(keytree)) {
@@ -550,29 +773,15 @@ struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 		}
 	} else {
 		prefix[0] = '\0';
-		stmt = gettree_all_stmt;
-	}
-
-	ast_mutex_lock(&dblock);
-	if (res && (sqlite3_bind_text(stmt, 1, prefix, res, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
-		sqlite3_reset(stmt);
-		ast_mutex_unlock(&dblock);
-		return NULL;
 	}
 
-	ret = db_gettree_common(stmt);
-	sqlite3_reset(stmt);
-	ast_mutex_unlock(&dblock);
-
-	return ret;
+	return db_gettree_common(prefix, 0);
 }
 
 struct ast_db_entry *ast_db_gettree_by_prefix(const char *family, const char *key_prefix)
 {
 	char prefix[MAX_DB_FIELD];
 	size_t res;
-	struct ast_db_entry *ret;
 
 	res = snprintf(prefix, sizeof(prefix), "/%s/%s", family, key_prefix);
 	if (res >= sizeof(prefix)) {
@@ -580,19 +789,7 @@ struct ast_db_entry *ast_db_gettree_by_prefix(const char *family, const char *ke
 		return NULL;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(gettree_prefix_stmt, 1, prefix, res, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
-		sqlite3_reset(gettree_prefix_stmt);
-		ast_mutex_unlock(&dblock);
-		return NULL;
-	}
-
-	ret = db_gettree_common(gettree_prefix_stmt);
-	sqlite3_reset(gettree_prefix_stmt);
-	ast_mutex_unlock(&dblock);
-
-	return ret;
+	return db_gettree_common(prefix, 1);
 }
 
 void ast_db_freetree(struct ast_db_entry *dbe)
@@ -725,8 +922,9 @@ static char *handle_cli_database_deltree(struct ast_cli_entry *e, int cmd, struc
 static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	char prefix[MAX_DB_FIELD];
+	struct ast_db_entry *entries;
+	struct ast_db_entry *entry;
 	int counter = 0;
-	sqlite3_stmt *stmt = gettree_stmt;
 
 	switch (cmd) {
 	case CLI_INIT:
@@ -751,36 +949,16 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 	} else if (a->argc == 2) {
 		/* Neither */
 		prefix[0] = '\0';
-		stmt = gettree_all_stmt;
-
 	} else {
 		return CLI_SHOWUSAGE;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
-		sqlite3_reset(stmt);
-		ast_mutex_unlock(&dblock);
-		return NULL;
-	}
-
-	while (sqlite3_step(stmt) == SQLITE_ROW) {
-		const char *key_s, *value_s;
-		if (!(key_s = (const char *) sqlite3_column_text(stmt, 0))) {
-			ast_log(LOG_WARNING, "Skipping invalid key!\n");
-			continue;
-		}
-		if (!(value_s = (const char *) sqlite3_column_text(stmt, 1))) {
-			ast_log(LOG_WARNING, "Skipping invalid value!\n");
-			continue;
-		}
+	entries = db_gettree_common(prefix, 0);
+	for (entry = entries; entry; entry = entry->next) {
 		++counter;
-		ast_cli(a->fd, "%-50s: %-25s\n", key_s, value_s);
+		ast_cli(a->fd, "%-50s: %-25s\n", entry->key, entry->data);
 	}
-
-	sqlite3_reset(stmt);
-	ast_mutex_unlock(&dblock);
+	ast_db_freetree(entries);
 
 	ast_cli(a->fd, "%d results found.\n", counter);
 	return CLI_SUCCESS;
@@ -788,6 +966,10 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 
 static char *handle_cli_database_showkey(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
+	char suffix[MAX_DB_FIELD];
+	size_t suffix_len;
+	struct ao2_iterator iter;
+	struct db_record *record;
 	int counter = 0;
 
 	switch (cmd) {
@@ -805,27 +987,24 @@ static char *handle_cli_database_showkey(struct ast_cli_entry *e, int cmd, struc
 		return CLI_SHOWUSAGE;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (!ast_strlen_zero(a->argv[2]) && (sqlite3_bind_text(showkey_stmt, 1, a->argv[2], -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", a->argv[2], sqlite3_errmsg(astdb));
-		sqlite3_reset(showkey_stmt);
-		ast_mutex_unlock(&dblock);
-		return NULL;
+	suffix_len = snprintf(suffix, sizeof(suffix), "/%s", a->argv[2]);
+	if (suffix_len >= sizeof(suffix)) {
+		return CLI_SHOWUSAGE;
 	}
 
-	while (sqlite3_step(showkey_stmt) == SQLITE_ROW) {
-		const char *key_s, *value_s;
-		if (!(key_s = (const char *) sqlite3_column_text(showkey_stmt, 0))) {
-			break;
-		}
-		if (!(value_s = (const char *) sqlite3_column_text(showkey_stmt, 1))) {
-			break;
+	ast_mutex_lock(&pending_lock);
+	iter = ao2_iterator_init(records, 0);
+	for (; (record = ao2_iterator_next(&iter)); ao2_ref(record, -1)) {
+		size_t key_len = strlen(record->key);
+
+		if (key_len < suffix_len || strcasecmp(record->key + key_len - suffix_len, suffix)) {
+			continue;
 		}
 		++counter;
-		ast_cli(a->fd, "%-50s: %-25s\n", key_s, value_s);
+		ast_cli(a->fd, "%-50s: %-25s\n", record->key, record->value);
 	}
-	sqlite3_reset(showkey_stmt);
-	ast_mutex_unlock(&dblock);
+	ao2_iterator_destroy(&iter);
+	ast_mutex_unlock(&pending_lock);
 
 	ast_cli(a->fd, "%d results found.\n", counter);
 	return CLI_SUCCESS;
@@ -863,13 +1042,52 @@ static char *handle_cli_database_query(struct ast_cli_entry *e, int cmd, struct
 	}
 
 	ast_mutex_lock(&dblock);
+	db_pending_flush();
 	db_execute_sql(a->argv[2], display_results, a);
 	db_sync(); /* Go ahead and sync the db in case they write */
+	/* The query may have changed anything so start over from the database. */
+	db_records_load();
 	ast_mutex_unlock(&dblock);
 
 	return CLI_SUCCESS;
 }
 
+static char *handle_cli_database_stats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "database stats";
+		e->usage =
+			"Usage: database stats\n"
+			"       Shows how many keys the in-memory copy of the Asterisk\n"
+			"       database holds and has answered reads for, and how long\n"
+			"       writing the changes to the database took.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 2) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&pending_lock);
+	ast_cli(a->fd, "Keys in memory:    %d\n", ao2_container_count(records));
+	ast_cli(a->fd, "Key reads:         %lu\n", db_stats.reads);
+	ast_cli(a->fd, "  Not found:       %lu\n", db_stats.not_found);
+	ast_cli(a->fd, "Tree reads:        %lu\n", db_stats.tree_reads);
+	ast_cli(a->fd, "Writes queued:     %lu\n", db_stats.writes);
+	ast_cli(a->fd, "  Coalesced:       %lu\n", db_stats.coalesced);
+	ast_cli(a->fd, "  Pending now:     %d\n", ao2_container_count(pending));
+	ast_cli(a->fd, "Batches written:   %lu (%lu changes)\n", db_stats.batches, db_stats.written);
+	ast_cli(a->fd, "  Average time:    %" PRId64 " us\n",
+		db_stats.batches ? db_stats.batch_time / (int64_t) db_stats.batches : 0);
+	ast_cli(a->fd, "  Longest time:    %" PRId64 " us\n", db_stats.batch_time_max);
+	ast_mutex_unlock(&pending_lock);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_database[] = {
 	AST_CLI_DEFINE(handle_cli_database_show,    "Shows database contents"),
 	AST_CLI_DEFINE(handle_cli_database_showkey, "Shows database contents"),
@@ -878,6 +1096,7 @@ static struct ast_cli_entry cli_database[] = {
 	AST_CLI_DEFINE(handle_cli_database_del,     "Removes database key/value"),
 	AST_CLI_DEFINE(handle_cli_database_deltree, "Removes database keytree/values"),
 	AST_CLI_DEFINE(handle_cli_database_query,   "Run a user-specified query on the astdb"),
+	AST_CLI_DEFINE(handle_cli_database_stats,   "Shows astdb write-behind statistics"),
 };
 
 static int manager_dbput(struct mansession *s, const struct message *m)
@@ -1003,13 +1222,13 @@ static int manager_dbdeltree(struct mansession *s, const struct message *m)
 /*!
  * \internal
  * \brief Signal the astdb sync thread to do its thing.
- *
- * \note dblock is assumed to be held when calling this function.
  */
 static void db_sync(void)
 {
+	ast_mutex_lock(&pending_lock);
 	dosync = 1;
 	ast_cond_signal(&dbcond);
+	ast_mutex_unlock(&pending_lock);
 }
 
 /*!
@@ -1020,32 +1239,57 @@ static void db_sync(void)
  * By pushing it off to this thread to take care of, this I/O bound operation
  * will not block other threads from performing other critical processing.
  * If changes happen rapidly, this thread will also ensure that the sync
- * operations are rate limited.
+ * operations are rate limited, and writes all changes queued meanwhile
+ * in a single transaction.
  */
 static void *db_sync_thread(void *data)
 {
+	struct timeval start;
+	int64_t elapsed;
+	int written;
+	int exiting;
+
 	ast_mutex_lock(&dblock);
 	ast_db_begin_transaction();
+	ast_mutex_unlock(&dblock);
 	for (;;) {
 		/* If dosync is set, db_sync() was called during sleep(1),
 		 * and the pending transaction should be committed.
 		 * Otherwise, block until db_sync() is called.
 		 */
+		ast_mutex_lock(&pending_lock);
 		while (!dosync) {
-			ast_cond_wait(&dbcond, &dblock);
+			ast_cond_wait(&dbcond, &pending_lock);
 		}
 		dosync = 0;
+		exiting = doexit;
+		ast_mutex_unlock(&pending_lock);
+
+		start = ast_tvnow();
+		ast_mutex_lock(&dblock);
+		written = db_pending_flush();
 		if (ast_db_commit_transaction()) {
 			ast_db_rollback_transaction();
 		}
-		if (doexit) {
-			ast_mutex_unlock(&dblock);
-			break;
+		if (!exiting) {
+			ast_db_begin_transaction();
 		}
-		ast_db_begin_transaction();
 		ast_mutex_unlock(&dblock);
+		elapsed = ast_tvdiff_us(ast_tvnow(), start);
+
+		ast_mutex_lock(&pending_lock);
+		++db_stats.batches;
+		db_stats.written += written;
+		db_stats.batch_time += elapsed;
+		if (elapsed > db_stats.batch_time_max) {
+			db_stats.batch_time_max = elapsed;
+		}
+		ast_mutex_unlock(&pending_lock);
+
+		if (exiting) {
+			break;
+		}
 		sleep(1);
-		ast_mutex_lock(&dblock);
 	}
 
 	return NULL;
@@ -1063,15 +1307,29 @@ static void astdb_atexit(void)
 	ast_manager_unregister("DBDel");
 	ast_manager_unregister("DBDelTree");
 
-	/* Set doexit to 1 to kill thread. db_sync must be called with
-	 * mutex held. */
-	ast_mutex_lock(&dblock);
+	/* Set doexit to 1 to have the thread write what is pending and exit. */
+	ast_mutex_lock(&pending_lock);
 	doexit = 1;
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	dosync = 1;
+	ast_cond_signal(&dbcond);
+	ast_mutex_unlock(&pending_lock);
 
 	pthread_join(syncthread, NULL);
 	ast_mutex_lock(&dblock);
+	/* Changes queued while the thread was exiting */
+	if (ao2_container_count(pending)) {
+		ast_db_begin_transaction();
+		db_pending_flush();
+		if (ast_db_commit_transaction()) {
+			ast_db_rollback_transaction();
+		}
+	}
+	ao2_cleanup(pending);
+	pending = NULL;
+	ao2_cleanup(pending_spare);
+	pending_spare = NULL;
+	ao2_cleanup(records);
+	records = NULL;
 	clean_statements();
 	if (sqlite3_close(astdb) == SQLITE_OK) {
 		astdb = NULL;
@@ -1083,10 +1341,25 @@ int astdb_init(void)
 {
 	ast_cond_init(&dbcond, NULL);
 
+	records = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_NOLOCK,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, db_record_sort_fn, NULL);
+	pending = db_pending_alloc();
+	pending_spare = db_pending_alloc();
+	if (!records || !pending || !pending_spare) {
+		return -1;
+	}
+
 	if (db_init()) {
 		return -1;
 	}
 
+	ast_mutex_lock(&dblock);
+	if (db_records_load()) {
+		ast_mutex_unlock(&dblock);
+		return -1;
+	}
+	ast_mutex_unlock(&dblock);
+
 	if (ast_pthread_create_background(&syncthread, NULL, db_sync_thread, NULL)) {
 		return -1;
 	}
@@ -43,6 +43,7 @@
 #include "asterisk/causes.h"
 #include "asterisk/stasis_channels.h"
 #include "asterisk/max_forwards.h"
+#include "asterisk/alertpipe.h"
 
 /*! \brief Main dialing structure. Contains global options, channels being dialed, and more! */
 struct ast_dial {
@@ -68,6 +69,8 @@ struct ast_dial_channel {
 	void *options[AST_DIAL_OPTION_MAX];	/*!< Channel specific options */
 	int cause;				/*!< Cause code in case of failure */
 	unsigned int is_running_app:1;		/*!< Is this running an application? */
+	unsigned int event_pending;		/*!< A leg thread queued an event the monitoring thread has yet to handle */
+	unsigned int request_failed:1;		/*!< The channel failed to be requested with the others of the dial */
 	char *assignedid1;				/*!< UniqueID to assign channel */
 	char *assignedid2;				/*!< UniqueID to assign 2nd channel */
 	struct ast_channel *owner;		/*!< Asterisk channel */
@@ -328,24 +331,124 @@ int ast_dial_append_channel(struct ast_dial *dial, struct ast_channel *chan)
 	return dial_append_common(dial, channel, tech, device, NULL);
 }
 
+/*!
+ * \brief Work out the capabilities to request the dialed channels with
+ *
+ * \param chan Channel dialing, may be NULL
+ * \param cap Capabilities asked for, may be NULL
+ * \param cap_alloced Set to the capabilities to release once the request is made
+ */
+static struct ast_format_cap *dial_request_cap(struct ast_channel *chan, struct ast_format_cap *cap,
+	struct ast_format_cap **cap_alloced)
+{
+	struct ast_format_cap *requester_cap = NULL;
+
+	*cap_alloced = NULL;
+
+	if (cap && ast_format_cap_count(cap)) {
+		return cap;
+	}
+
+	if (chan) {
+		ast_channel_lock(chan);
+		requester_cap = ao2_bump(ast_channel_nativeformats(chan));
+		ast_channel_unlock(chan);
+	}
+	if (!requester_cap) {
+		requester_cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+		if (requester_cap) {
+			ast_format_cap_append_by_type(requester_cap, AST_MEDIA_TYPE_AUDIO);
+		}
+	}
+
+	return *cap_alloced = requester_cap;
+}
+
+/*!
+ * \brief Request the channels of a dial that do not exist yet, all at once
+ *
+ * The channels that could not be requested are left without an owner and
+ * with the cause of the failure.
+ */
+static void dial_request_channels(struct ast_dial *dial, struct ast_channel *chan, struct ast_format_cap *cap)
+{
+	struct ast_dial_channel *channel;
+	struct ast_request_item *items;
+	struct ast_assigned_ids *ids;
+	struct ast_dial_channel **channels;
+	struct ast_format_cap *cap_alloced;
+	struct ast_format_cap *cap_request;
+	int count = 0;
+	int i;
+
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		if (!channel->owner) {
+			count++;
+		}
+	}
+	if (count < 2) {
+		/* Nothing to share, begin_dial_prerun() requests it */
+		return;
+	}
+
+	items = ast_calloc(count, sizeof(*items));
+	ids = ast_calloc(count, sizeof(*ids));
+	channels = ast_calloc(count, sizeof(*channels));
+	if (!items || !ids || !channels) {
+		goto cleanup;
+	}
+
+	i = 0;
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		if (channel->owner) {
+			continue;
+		}
+		ids[i].uniqueid = channel->assignedid1;
+		ids[i].uniqueid2 = channel->assignedid2;
+		items[i].type = channel->tech;
+		items[i].addr = channel->device;
+		items[i].assignedids = &ids[i];
+		channels[i++] = channel;
+	}
+
+	cap_request = dial_request_cap(chan, cap, &cap_alloced);
+	ast_request_multiple(items, count, cap_request, NULL, chan);
+	ao2_cleanup(cap_alloced);
+
+	for (i = 0; i < count; i++) {
+		channels[i]->owner = items[i].chan;
+		channels[i]->cause = items[i].cause;
+		channels[i]->request_failed = !items[i].chan;
+	}
+
+cleanup:
+	ast_free(items);
+	ast_free(ids);
+	ast_free(channels);
+}
+
 /*! \brief Helper function that requests all channels */
 static int begin_dial_prerun(struct ast_dial_channel *channel, struct ast_channel *chan, struct ast_format_cap *cap, const char *predial_string)
 {
 	char numsubst[AST_MAX_EXTENSION];
-	struct ast_format_cap *cap_all_audio = NULL;
+	struct ast_format_cap *cap_alloced;
 	struct ast_format_cap *cap_request;
-	struct ast_format_cap *requester_cap = NULL;
 	struct ast_assigned_ids assignedids = {
 		.uniqueid = channel->assignedid1,
 		.uniqueid2 = channel->assignedid2,
 	};
 
+	if (channel->request_failed) {
+		/* Already requested along with the other channels of the dial */
+		channel->request_failed = 0;
+		return -1;
+	}
+
 	if (chan) {
 		int max_forwards;
 
 		ast_channel_lock(chan);
 		max_forwards = ast_max_forwards_get(chan);
-		requester_cap = ao2_bump(ast_channel_nativeformats(chan));
 		ast_channel_unlock(chan);
 
 		if (max_forwards <= 0) {
@@ -358,24 +461,14 @@ static int begin_dial_prerun(struct ast_dial_channel *channel, struct ast_channe
 		/* Copy device string over */
 		ast_copy_string(numsubst, channel->device, sizeof(numsubst));
 
-		if (cap && ast_format_cap_count(cap)) {
-			cap_request = cap;
-		} else if (requester_cap) {
-			cap_request = requester_cap;
-		} else {
-			cap_all_audio = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
-			ast_format_cap_append_by_type(cap_all_audio, AST_MEDIA_TYPE_AUDIO);
-			cap_request = cap_all_audio;
-		}
+		cap_request = dial_request_cap(chan, cap, &cap_alloced);
 
 		/* If we fail to create our owner channel bail out */
-		if (!(channel->owner = ast_request(channel->tech, cap_request, &assignedids, chan, numsubst, &channel->cause))) {
-			ao2_cleanup(cap_all_audio);
+		channel->owner = ast_request(channel->tech, cap_request, &assignedids, chan, numsubst, &channel->cause);
+		ao2_cleanup(cap_alloced);
+		if (!channel->owner) {
 			return -1;
 		}
-		cap_request = NULL;
-		ao2_cleanup(requester_cap);
-		ao2_cleanup(cap_all_audio);
 	}
 
 	if (chan) {
@@ -441,6 +534,7 @@ int ast_dial_prerun(struct ast_dial *dial, struct ast_channel *chan, struct ast_
 	char *predial_string = dial->options[AST_DIAL_OPTION_PREDIAL];
 
 	AST_LIST_LOCK(&dial->channels);
+	dial_request_channels(dial, chan, cap);
 	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
 		if ((res = begin_dial_prerun(channel, chan, cap, predial_string))) {
 			break;
@@ -496,6 +590,7 @@ static int begin_dial(struct ast_dial *dial, struct ast_channel *chan, int async
 
 	/* Iterate through channel list, requesting and calling each one */
 	AST_LIST_LOCK(&dial->channels);
+	dial_request_channels(dial, chan, NULL);
 	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
 		success += begin_dial_channel(channel, chan, async, predial_string, NULL);
 	}
@@ -774,6 +869,348 @@ const char *ast_hangup_cause_to_dial_status(int hangup_cause)
 	}
 }
 
+/*! \brief Most dialed channels whose frames are read by the thread monitoring the dial */
+#define DIAL_LEGS_PER_THREAD 16
+
+/*! \brief Event of a dialed channel, passed from a leg thread to the thread monitoring the dial */
+struct dial_leg_event {
+	/*! The dialed channel */
+	struct ast_dial_channel *channel;
+	/*! Control frame read from the channel, NULL if it hung up or was forwarded */
+	struct ast_frame *fr;
+	/*! The channel was call forwarded */
+	unsigned int forward:1;
+	AST_LIST_ENTRY(dial_leg_event) list;
+};
+
+struct dial_legs;
+
+/*! \brief Thread reading the frames of some of the dialed channels */
+struct dial_leg_thread {
+	struct dial_legs *legs;
+	pthread_t thread;
+	int alert_pipe[2];
+	/*! The thread is waiting on or reading its channels */
+	unsigned int busy:1;
+	int num_channels;
+	struct ast_dial_channel *channels[DIAL_LEGS_PER_THREAD];
+};
+
+/*!
+ * \brief Threads reading the frames of the dialed channels, when there are too many for one
+ *
+ * The leg threads drop the media read from the dialed channels, so only their
+ * control frames, hangups and call forwards reach the thread monitoring the
+ * dial.  A dialed channel is only ever hung up by the monitoring thread, while
+ * no leg thread is watching it.
+ */
+struct dial_legs {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! Alerted when an event is queued */
+	int alert_pipe[2];
+	AST_LIST_HEAD_NOLOCK(, dial_leg_event) events;
+	/*! The leg threads must keep off their channels */
+	unsigned int paused:1;
+	/*! The leg threads must exit */
+	unsigned int stop:1;
+	ast_callid callid;
+	int num_threads;
+	struct dial_leg_thread threads[0];
+};
+
+/*! \brief Read a frame from a dialed channel and queue it if it matters to the dial */
+static void dial_leg_read(struct dial_legs *legs, struct ast_dial_channel *channel)
+{
+	struct dial_leg_event *event;
+	struct ast_frame *fr = NULL;
+	struct ast_frame *isolated;
+	int forward = 0;
+	int pending = 1;
+
+	if (!ast_strlen_zero(ast_channel_call_forward(channel->owner))) {
+		forward = 1;
+	} else if ((fr = ast_read(channel->owner))) {
+		if (fr->frametype != AST_FRAME_CONTROL) {
+			/* Only the control frames of a dialed channel are of interest */
+			ast_frfree(fr);
+			return;
+		}
+		if ((isolated = ast_frisolate(fr)) != fr) {
+			ast_frfree(fr);
+		}
+		if (!(fr = isolated)) {
+			return;
+		}
+		switch (fr->subclass.integer) {
+		case AST_CONTROL_ANSWER:
+		case AST_CONTROL_BUSY:
+		case AST_CONTROL_CONGESTION:
+		case AST_CONTROL_INCOMPLETE:
+			/* These may end the dial attempt of the channel */
+			break;
+		default:
+			pending = 0;
+			break;
+		}
+	}
+
+	if (!(event = ast_calloc(1, sizeof(*event)))) {
+		if (fr) {
+			ast_frfree(fr);
+		}
+		return;
+	}
+	event->channel = channel;
+	event->fr = fr;
+	event->forward = forward;
+
+	ast_mutex_lock(&legs->lock);
+	if (pending) {
+		/* Stop watching the channel until the monitoring thread is done with it */
+		channel->event_pending = 1;
+	}
+	AST_LIST_INSERT_TAIL(&legs->events, event, list);
+	ast_mutex_unlock(&legs->lock);
+
+	ast_alertpipe_write(legs->alert_pipe);
+}
+
+/*! \brief Leg thread function */
+static void *dial_leg_thread_run(void *data)
+{
+	struct dial_leg_thread *thread = data;
+	struct dial_legs *legs = thread->legs;
+	struct ast_channel *cs[DIAL_LEGS_PER_THREAD];
+	struct ast_dial_channel *watched[DIAL_LEGS_PER_THREAD];
+	int alert_fd = ast_alertpipe_readfd(thread->alert_pipe);
+
+	if (legs->callid) {
+		ast_callid_threadassoc_add(legs->callid);
+	}
+
+	ast_mutex_lock(&legs->lock);
+	while (!legs->stop) {
+		struct ast_channel *who;
+		int pos = 0, outfd = -1, ms = -1, i;
+
+		if (legs->paused) {
+			ast_cond_wait(&legs->cond, &legs->lock);
+			continue;
+		}
+
+		for (i = 0; i < thread->num_channels; i++) {
+			if (thread->channels[i]->owner && !thread->channels[i]->event_pending) {
+				watched[pos] = thread->channels[i];
+				cs[pos++] = thread->channels[i]->owner;
+			}
+		}
+		thread->busy = 1;
+		ast_mutex_unlock(&legs->lock);
+
+		who = ast_waitfor_nandfds(cs, pos, &alert_fd, 1, NULL, &outfd, &ms);
+		if (outfd > -1) {
+			ast_alertpipe_read(thread->alert_pipe);
+		} else if (who) {
+			for (i = 0; i < pos; i++) {
+				if (cs[i] == who) {
+					dial_leg_read(legs, watched[i]);
+					break;
+				}
+			}
+		}
+
+		ast_mutex_lock(&legs->lock);
+		thread->busy = 0;
+		ast_cond_broadcast(&legs->cond);
+	}
+	ast_mutex_unlock(&legs->lock);
+
+	return NULL;
+}
+
+/*! \brief Wake up every leg thread */
+static void dial_legs_alert(struct dial_legs *legs)
+{
+	int i;
+
+	for (i = 0; i < legs->num_threads; i++) {
+		ast_alertpipe_write(legs->threads[i].alert_pipe);
+	}
+}
+
+/*! \brief Stop the leg threads and free them */
+static void dial_legs_stop(struct dial_legs *legs)
+{
+	struct dial_leg_event *event;
+	int i;
+
+	ast_mutex_lock(&legs->lock);
+	legs->stop = 1;
+	ast_cond_broadcast(&legs->cond);
+	ast_mutex_unlock(&legs->lock);
+	dial_legs_alert(legs);
+
+	for (i = 0; i < legs->num_threads; i++) {
+		if (legs->threads[i].thread != AST_PTHREADT_NULL) {
+			pthread_join(legs->threads[i].thread, NULL);
+		}
+		ast_alertpipe_close(legs->threads[i].alert_pipe);
+	}
+
+	while ((event = AST_LIST_REMOVE_HEAD(&legs->events, list))) {
+		if (event->fr) {
+			ast_frfree(event->fr);
+		}
+		ast_free(event);
+	}
+
+	ast_alertpipe_close(legs->alert_pipe);
+	ast_cond_destroy(&legs->cond);
+	ast_mutex_destroy(&legs->lock);
+	ast_free(legs);
+}
+
+/*!
+ * \brief Start threads reading the frames of the dialed channels, if there are many
+ *
+ * \return The leg threads, NULL if the thread monitoring the dial should read the frames itself
+ */
+static struct dial_legs *dial_legs_start(struct ast_dial *dial)
+{
+	struct dial_legs *legs;
+	struct ast_dial_channel *channel;
+	int count = 0;
+	int i;
+
+	AST_LIST_LOCK(&dial->channels);
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		if (channel->owner) {
+			count++;
+		}
+	}
+	AST_LIST_UNLOCK(&dial->channels);
+	if (count <= DIAL_LEGS_PER_THREAD) {
+		return NULL;
+	}
+
+	legs = ast_calloc(1, sizeof(*legs)
+		+ sizeof(legs->threads[0]) * ((count + DIAL_LEGS_PER_THREAD - 1) / DIAL_LEGS_PER_THREAD));
+	if (!legs) {
+		return NULL;
+	}
+	ast_mutex_init(&legs->lock);
+	ast_cond_init(&legs->cond, NULL);
+	AST_LIST_HEAD_INIT_NOLOCK(&legs->events);
+	legs->callid = ast_read_threadstorage_callid();
+	legs->num_threads = (count + DIAL_LEGS_PER_THREAD - 1) / DIAL_LEGS_PER_THREAD;
+	ast_alertpipe_clear(legs->alert_pipe);
+	for (i = 0; i < legs->num_threads; i++) {
+		legs->threads[i].legs = legs;
+		legs->threads[i].thread = AST_PTHREADT_NULL;
+		ast_alertpipe_clear(legs->threads[i].alert_pipe);
+	}
+
+	/* Deal the channels out to the threads */
+	i = 0;
+	AST_LIST_LOCK(&dial->channels);
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		if (channel->owner && i < count) {
+			struct dial_leg_thread *thread = &legs->threads[i++ / DIAL_LEGS_PER_THREAD];
+
+			thread->channels[thread->num_channels++] = channel;
+		}
+	}
+	AST_LIST_UNLOCK(&dial->channels);
+
+	if (ast_alertpipe_init(legs->alert_pipe)) {
+		dial_legs_stop(legs);
+		return NULL;
+	}
+	for (i = 0; i < legs->num_threads; i++) {
+		if (ast_alertpipe_init(legs->threads[i].alert_pipe)
+			|| ast_pthread_create(&legs->threads[i].thread, NULL, dial_leg_thread_run, &legs->threads[i])) {
+			legs->threads[i].thread = AST_PTHREADT_NULL;
+			dial_legs_stop(legs);
+			return NULL;
+		}
+	}
+
+	ast_debug(1, "Reading the frames of %d dialed channels in %d threads\n", count, legs->num_threads);
+
+	return legs;
+}
+
+/*! \brief Keep the leg threads off their channels until dial_legs_resume() */
+static void dial_legs_pause(struct dial_legs *legs)
+{
+	int i;
+
+	ast_mutex_lock(&legs->lock);
+	legs->paused = 1;
+	dial_legs_alert(legs);
+	for (i = 0; i < legs->num_threads; i++) {
+		while (legs->threads[i].busy) {
+			ast_cond_wait(&legs->cond, &legs->lock);
+		}
+	}
+	ast_mutex_unlock(&legs->lock);
+}
+
+/*! \brief Let the leg threads watch their channels again */
+static void dial_legs_resume(struct dial_legs *legs)
+{
+	ast_mutex_lock(&legs->lock);
+	legs->paused = 0;
+	ast_cond_broadcast(&legs->cond);
+	ast_mutex_unlock(&legs->lock);
+}
+
+/*! \brief Handle the events queued by the leg threads, until the dial is answered */
+static void dial_legs_handle_events(struct ast_dial *dial, struct dial_legs *legs, struct ast_channel *chan)
+{
+	struct dial_leg_event *event;
+
+	ast_alertpipe_flush(legs->alert_pipe);
+
+	while (dial->state != AST_DIAL_RESULT_ANSWERED) {
+		struct ast_dial_channel *channel;
+
+		ast_mutex_lock(&legs->lock);
+		event = AST_LIST_REMOVE_HEAD(&legs->events, list);
+		ast_mutex_unlock(&legs->lock);
+		if (!event) {
+			break;
+		}
+		channel = event->channel;
+
+		/* The channel may have timed out since the event was queued */
+		if (channel->owner) {
+			if (event->forward) {
+				handle_call_forward(dial, channel, chan);
+			} else if (!event->fr) {
+				ast_channel_publish_dial(chan, channel->owner, channel->device,
+					ast_hangup_cause_to_dial_status(ast_channel_hangupcause(channel->owner)));
+				ast_hangup(channel->owner);
+				channel->owner = NULL;
+			} else {
+				handle_frame(dial, channel, event->fr, chan);
+			}
+		}
+		if (event->fr) {
+			ast_frfree(event->fr);
+		}
+		ast_free(event);
+
+		if (channel->event_pending) {
+			ast_mutex_lock(&legs->lock);
+			channel->event_pending = 0;
+			ast_mutex_unlock(&legs->lock);
+			dial_legs_alert(legs);
+		}
+	}
+}
+
 /*! \brief Helper function that basically keeps tabs on dialing attempts */
 static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_channel *chan)
 {
@@ -782,6 +1219,8 @@ static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_chann
 	struct ast_dial_channel *channel = NULL;
 	struct answer_exec_struct *answer_exec = NULL;
 	struct timeval start;
+	struct dial_legs *legs;
+	int legs_fd = -1;
 
 	set_state(dial, AST_DIAL_RESULT_TRYING);
 
@@ -805,6 +1244,11 @@ static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_chann
 	/* We actually figured out the maximum timeout we can do as they were added, so we can directly access the info */
 	timeout = dial->actual_timeout;
 
+	/* Leave reading the frames of many dialed channels to other threads */
+	if ((legs = dial_legs_start(dial))) {
+		legs_fd = ast_alertpipe_readfd(legs->alert_pipe);
+	}
+
 	/* Go into an infinite loop while we are trying */
 	while ((dial->state != AST_DIAL_RESULT_UNANSWERED) && (dial->state != AST_DIAL_RESULT_ANSWERED) && (dial->state != AST_DIAL_RESULT_HANGUP) && (dial->state != AST_DIAL_RESULT_TIMEOUT)) {
 		int pos = 0, count = 0;
@@ -819,7 +1263,9 @@ static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_chann
 		AST_LIST_LOCK(&dial->channels);
 		AST_LIST_TRAVERSE(&dial->channels, channel, list) {
 			if (channel->owner) {
-				cs[pos++] = channel->owner;
+				if (!legs) {
+					cs[pos++] = channel->owner;
+				}
 				count++;
 			}
 		}
@@ -836,7 +1282,17 @@ static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_chann
 			break;
 
 		/* Wait for frames from channels */
-		who = ast_waitfor_n(cs, pos, &timeout);
+		if (legs) {
+			int outfd = -1;
+
+			who = ast_waitfor_nandfds(cs, pos, &legs_fd, 1, NULL, &outfd, &timeout);
+			if (dial->thread != AST_PTHREADT_STOP && outfd > -1) {
+				dial_legs_handle_events(dial, legs, chan);
+				continue;
+			}
+		} else {
+			who = ast_waitfor_n(cs, pos, &timeout);
+		}
 
 		/* Check to see if our thread is being canceled */
 		if (dial->thread == AST_PTHREADT_STOP)
@@ -844,7 +1300,13 @@ static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_chann
 
 		/* If the timeout no longer exists OR if we got no channel it basically means the timeout was tripped, so handle it */
 		if (!timeout || !who) {
+			if (legs) {
+				dial_legs_pause(legs);
+			}
 			timeout = handle_timeout_trip(dial, start);
+			if (legs) {
+				dial_legs_resume(legs);
+			}
 			continue;
 		}
 
@@ -878,6 +1340,13 @@ static enum ast_dial_result monitor_dial(struct ast_dial *dial, struct ast_chann
 		ast_frfree(fr);
 	}
 
+	if (legs) {
+		dial_legs_stop(legs);
+		if (dial->state == AST_DIAL_RESULT_ANSWERED) {
+			who = AST_LIST_FIRST(&dial->channels)->owner;
+		}
+	}
+
 	/* Do post-processing from loop */
 	if (dial->state == AST_DIAL_RESULT_ANSWERED) {
 		/* Hangup everything except that which answered */
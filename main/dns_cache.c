@@ -0,0 +1,394 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief DNS Answer Cache
+ *
+ * Answers given by a resolver are kept for their TTL, so that a query for
+ * the same name, type and class is completed without asking the resolver
+ * again. For a while after the TTL an answer is still given out, while a
+ * query refreshing it is made in the background. Names that do not exist,
+ * and queries without records, are remembered for a short time as well.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/astobj2.h"
+#include "asterisk/sched.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+#include "asterisk/vector.h"
+#include "asterisk/dns_core.h"
+#include "asterisk/dns_resolver.h"
+#include "asterisk/dns_internal.h"
+#include "asterisk/dns_test.h"
+
+#include <arpa/nameser.h>
+
+/*! \brief Number of buckets of the cache */
+#define DNS_CACHE_BUCKETS 211
+
+/*! \brief Most answers kept in the cache */
+#define DNS_CACHE_MAX_ENTRIES 4096
+
+/*! \brief Most seconds an answer is kept for, whatever its TTL */
+#define DNS_CACHE_MAX_TTL 3600
+
+/*! \brief Seconds a name that does not exist, or has no records of a type, is remembered */
+#define DNS_CACHE_NEGATIVE_TTL 30
+
+/*! \brief Seconds past its TTL an answer is given out while it is refreshed */
+#define DNS_CACHE_STALE_TTL 30
+
+/*! \brief A record of a cached answer */
+struct dns_cache_record {
+	/*! \brief Resource record type */
+	int rr_type;
+	/*! \brief Resource record class */
+	int rr_class;
+	/*! \brief Size of the data */
+	size_t size;
+	/*! \brief The raw record data */
+	char data[0];
+};
+
+/*! \brief An answer in the cache */
+struct dns_cache_entry {
+	/*! \brief Resource record type of the query */
+	int rr_type;
+	/*! \brief Resource record class of the query */
+	int rr_class;
+	/*! \brief Whether the answer is secure */
+	unsigned int secure;
+	/*! \brief The rcode of the answer */
+	unsigned int rcode;
+	/*! \brief Whether a query refreshing the answer is in progress */
+	int refreshing;
+	/*! \brief When the TTL of the answer runs out */
+	struct timeval expires;
+	/*! \brief The canonical name */
+	char *canonical;
+	/*! \brief The raw DNS answer */
+	char *answer;
+	/*! \brief The size of the raw DNS answer */
+	size_t answer_size;
+	/*! \brief The records of the answer */
+	AST_VECTOR(, struct dns_cache_record *) records;
+	/*! \brief The name that was resolved */
+	char name[0];
+};
+
+/*! \brief What a cached answer is looked up by */
+struct dns_cache_key {
+	const char *name;
+	int rr_type;
+	int rr_class;
+};
+
+static struct ao2_container *dns_cache;
+
+static void dns_cache_entry_destroy(void *obj)
+{
+	struct dns_cache_entry *entry = obj;
+
+	AST_VECTOR_CALLBACK_VOID(&entry->records, ast_free);
+	AST_VECTOR_FREE(&entry->records);
+	ast_free(entry->canonical);
+	ast_free(entry->answer);
+}
+
+static int dns_cache_hash_fn(const void *obj, const int flags)
+{
+	const struct dns_cache_key *key;
+	const struct dns_cache_entry *entry;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return ast_str_case_hash(key->name) ^ key->rr_type;
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		return ast_str_case_hash(entry->name) ^ entry->rr_type;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int dns_cache_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct dns_cache_entry *entry = obj;
+	const struct dns_cache_key *key;
+	const struct dns_cache_entry *right;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = arg;
+		return (entry->rr_type == key->rr_type && entry->rr_class == key->rr_class
+			&& !strcasecmp(entry->name, key->name)) ? CMP_MATCH : 0;
+	case OBJ_SEARCH_OBJECT:
+		right = arg;
+		return (entry->rr_type == right->rr_type && entry->rr_class == right->rr_class
+			&& !strcasecmp(entry->name, right->name)) ? CMP_MATCH : 0;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+/*! \brief Prune answers no longer given out, even while refreshed */
+static int dns_cache_prune_cb(void *obj, void *arg, int flags)
+{
+	const struct dns_cache_entry *entry = obj;
+	const struct timeval *now = arg;
+
+	return ast_tvdiff_ms(*now, entry->expires) >= DNS_CACHE_STALE_TTL * 1000 ? CMP_MATCH : 0;
+}
+
+void dns_cache_store(const struct ast_dns_query *query)
+{
+	const struct ast_dns_result *result = query->result;
+	const struct ast_dns_record *record;
+	struct dns_cache_entry *entry;
+	struct timeval now;
+	int ttl;
+
+	if (!dns_cache || !result || result->bogus) {
+		return;
+	}
+
+	if (result->rcode == NXDOMAIN
+		|| (result->rcode == NOERROR && AST_LIST_EMPTY(&result->records))) {
+		ttl = DNS_CACHE_NEGATIVE_TTL;
+	} else if (result->rcode == NOERROR) {
+		ttl = MIN(ast_dns_result_get_lowest_ttl(result), DNS_CACHE_MAX_TTL);
+	} else {
+		/* A failure of the resolver, which may not happen again */
+		return;
+	}
+	if (ttl <= 0) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(query->name) + 1,
+		dns_cache_entry_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->name, query->name); /* SAFE */
+	entry->rr_type = query->rr_type;
+	entry->rr_class = query->rr_class;
+	entry->secure = result->secure;
+	entry->rcode = result->rcode;
+	entry->canonical = ast_strdup(result->canonical);
+	entry->answer = ast_malloc(result->answer_size ?: 1);
+	if (AST_VECTOR_INIT(&entry->records, 4) || !entry->canonical || !entry->answer) {
+		ao2_ref(entry, -1);
+		return;
+	}
+	memcpy(entry->answer, result->answer, result->answer_size);
+	entry->answer_size = result->answer_size;
+
+	AST_LIST_TRAVERSE(&result->records, record, list) {
+		struct dns_cache_record *cached;
+
+		cached = ast_malloc(sizeof(*cached) + record->data_len);
+		if (!cached) {
+			ao2_ref(entry, -1);
+			return;
+		}
+		cached->rr_type = record->rr_type;
+		cached->rr_class = record->rr_class;
+		cached->size = record->data_len;
+		memcpy(cached->data, record->data_ptr, record->data_len);
+		if (AST_VECTOR_APPEND(&entry->records, cached)) {
+			ast_free(cached);
+			ao2_ref(entry, -1);
+			return;
+		}
+	}
+
+	now = ast_tvnow();
+	entry->expires = ast_tvadd(now, ast_tv(ttl, 0));
+
+	ao2_lock(dns_cache);
+	ao2_find(dns_cache, entry, OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	if (ao2_container_count(dns_cache) >= DNS_CACHE_MAX_ENTRIES) {
+		ao2_callback(dns_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK,
+			dns_cache_prune_cb, &now);
+	}
+	if (ao2_container_count(dns_cache) < DNS_CACHE_MAX_ENTRIES) {
+		ao2_link_flags(dns_cache, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(dns_cache);
+
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Completion of a query refreshing a stale answer, which stored it anew */
+static void dns_cache_refresh_callback(const struct ast_dns_query *query)
+{
+}
+
+/*! \brief Start a query refreshing a stale answer */
+static void dns_cache_refresh(struct dns_cache_entry *entry)
+{
+	struct ast_dns_query *query;
+
+	if (ast_atomic_exchange_n(&entry->refreshing, 1, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	query = dns_query_alloc(entry->name, entry->rr_type, entry->rr_class,
+		dns_cache_refresh_callback, NULL);
+	if (!query || query->resolver->resolve(query)) {
+		/* Try again the next time the answer is given out */
+		ast_atomic_store_n(&entry->refreshing, 0, __ATOMIC_SEQ_CST);
+	}
+	ao2_cleanup(query);
+}
+
+/*! \brief Scheduler callback completing a query answered from the cache */
+static int dns_cache_completed(const void *data)
+{
+	struct ast_dns_query *query = (struct ast_dns_query *) data;
+
+	ast_dns_resolver_completed(query);
+	ao2_ref(query, -1);
+
+	return 0;
+}
+
+int dns_cache_resolve(struct ast_dns_query *query)
+{
+	struct dns_cache_key key = {
+		.name = query->name,
+		.rr_type = query->rr_type,
+		.rr_class = query->rr_class,
+	};
+	struct dns_cache_entry *entry;
+	int64_t remaining;
+	int ttl;
+	int i;
+
+	if (!dns_cache) {
+		return -1;
+	}
+
+	entry = ao2_find(dns_cache, &key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return -1;
+	}
+
+	remaining = ast_tvdiff_ms(entry->expires, ast_tvnow());
+	if (remaining <= -DNS_CACHE_STALE_TTL * 1000) {
+		ao2_ref(entry, -1);
+		return -1;
+	} else if (remaining <= 0) {
+		dns_cache_refresh(entry);
+		ttl = 1;
+	} else {
+		ttl = (remaining + 999) / 1000;
+	}
+
+	if (ast_dns_resolver_set_result(query, entry->secure, 0, entry->rcode, entry->canonical,
+		entry->answer, entry->answer_size)) {
+		ao2_ref(entry, -1);
+		return -1;
+	}
+	for (i = 0; i < AST_VECTOR_SIZE(&entry->records); ++i) {
+		struct dns_cache_record *cached = AST_VECTOR_GET(&entry->records, i);
+
+		if (ast_dns_resolver_add_record(query, cached->rr_type, cached->rr_class, ttl,
+			cached->data, cached->size)) {
+			ao2_ref(entry, -1);
+			return -1;
+		}
+	}
+	ao2_ref(entry, -1);
+
+	/* Complete it as a resolver would, after the caller got the query back */
+	query->cached = 1;
+	if (ast_sched_add(ast_dns_get_sched(), 0, dns_cache_completed, ao2_bump(query)) < 0) {
+		query->cached = 0;
+		ao2_ref(query, -1);
+		return -1;
+	}
+
+	ast_debug(3, "Query '%p': Answered '%s' of class '%d' and type '%d' from the cache\n",
+		query, query->name, query->rr_class, query->rr_type);
+
+	return 0;
+}
+
+void dns_cache_flush(void)
+{
+	if (dns_cache) {
+		ao2_callback(dns_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA, NULL, NULL);
+	}
+}
+
+#ifdef TEST_FRAMEWORK
+
+/*! \brief Move the expiry of an answer back */
+static int dns_cache_age_cb(void *obj, void *arg, int flags)
+{
+	struct dns_cache_entry *entry = obj;
+	const int *seconds = arg;
+
+	entry->expires = ast_tvsub(entry->expires, ast_tv(*seconds, 0));
+
+	return 0;
+}
+
+void ast_dns_test_cache_age(int seconds)
+{
+	if (dns_cache) {
+		ao2_callback(dns_cache, OBJ_MULTIPLE | OBJ_NODATA, dns_cache_age_cb, &seconds);
+	}
+}
+
+#else /* TEST_FRAMEWORK */
+
+void ast_dns_test_cache_age(int seconds)
+{
+}
+
+#endif
+
+static void dns_cache_shutdown(void)
+{
+	ao2_cleanup(dns_cache);
+	dns_cache = NULL;
+}
+
+int dns_cache_init(void)
+{
+	dns_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, DNS_CACHE_BUCKETS,
+		dns_cache_hash_fn, NULL, dns_cache_cmp_fn);
+	if (!dns_cache) {
+		return -1;
+	}
+
+	ast_register_cleanup(dns_cache_shutdown);
+
+	return 0;
+}
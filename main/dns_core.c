@@ -244,9 +244,30 @@ struct ast_dns_query *dns_query_alloc(const char *name, int rr_type, int rr_clas
 	return query;
 }
 
-struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data)
+int dns_query_resolve(struct ast_dns_query *query)
+{
+	if (!dns_cache_resolve(query)) {
+		return 0;
+	}
+
+	return query->resolver->resolve(query);
+}
+
+int dns_query_cancel(struct ast_dns_query *query)
+{
+	if (query->cached) {
+		/* Already answered, the completion is only waiting on the scheduler */
+		return -1;
+	}
+
+	return query->resolver->cancel(query);
+}
+
+static struct ast_dns_query_active *dns_resolve_async(const char *name, int rr_type, int rr_class,
+	ast_dns_resolve_callback callback, void *data, int use_cache)
 {
 	struct ast_dns_query_active *active;
+	int res;
 
 	active = ao2_alloc_options(sizeof(*active), dns_query_active_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!active) {
@@ -259,7 +280,12 @@ struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type
 		return NULL;
 	}
 
-	if (active->query->resolver->resolve(active->query)) {
+	if (use_cache) {
+		res = dns_query_resolve(active->query);
+	} else {
+		res = active->query->resolver->resolve(active->query);
+	}
+	if (res) {
 		ast_log(LOG_ERROR, "Resolver '%s' returned an error when resolving '%s' of class '%d' and type '%d'\n",
 			active->query->resolver->name, name, rr_class, rr_type);
 		ao2_ref(active, -1);
@@ -269,9 +295,19 @@ struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type
 	return active;
 }
 
+struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data)
+{
+	return dns_resolve_async(name, rr_type, rr_class, callback, data, 1);
+}
+
+struct ast_dns_query_active *dns_resolve_async_uncached(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data)
+{
+	return dns_resolve_async(name, rr_type, rr_class, callback, data, 0);
+}
+
 int ast_dns_resolve_cancel(struct ast_dns_query_active *active)
 {
-	return active->query->resolver->cancel(active->query);
+	return dns_query_cancel(active->query);
 }
 
 /*! \brief Structure used for signaling back for synchronous resolution completion */
@@ -597,6 +633,11 @@ static void sort_result(int rr_type, struct ast_dns_result *result)
 
 void ast_dns_resolver_completed(struct ast_dns_query *query)
 {
+	if (!query->cached) {
+		/* Before the callback, which may take the result */
+		dns_cache_store(query);
+	}
+
 	sort_result(ast_dns_query_get_rr_type(query), query->result);
 
 	query->callback(query);
@@ -623,6 +664,10 @@ int dns_core_init(void)
 
 	ast_register_cleanup(dns_shutdown);
 
+	if (dns_cache_init()) {
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -671,6 +716,9 @@ int ast_dns_resolver_register(struct ast_dns_resolver *resolver)
 
 	AST_RWLIST_UNLOCK(&resolvers);
 
+	/* Answers may now be given by another resolver */
+	dns_cache_flush();
+
 	ast_verb(2, "Registered DNS resolver '%s' with priority '%d'\n", resolver->name, resolver->priority);
 
 	return 0;
@@ -694,6 +742,8 @@ void ast_dns_resolver_unregister(struct ast_dns_resolver *resolver)
 	AST_RWLIST_TRAVERSE_SAFE_END;
 	AST_RWLIST_UNLOCK(&resolvers);
 
+	dns_cache_flush();
+
 	ast_verb(2, "Unregistered DNS resolver '%s'\n", resolver->name);
 }
 
@@ -57,7 +57,7 @@ static int dns_query_recurring_scheduled_callback(const void *data)
 	ao2_lock(recurring);
 	recurring->timer = -1;
 	if (!recurring->cancelled) {
-		recurring->active = ast_dns_resolve_async(recurring->name, recurring->rr_type, recurring->rr_class, dns_query_recurring_resolution_callback,
+		recurring->active = dns_resolve_async_uncached(recurring->name, recurring->rr_type, recurring->rr_class, dns_query_recurring_resolution_callback,
 			recurring);
 	}
 	ao2_unlock(recurring);
@@ -126,7 +126,7 @@ struct ast_dns_query_recurring *ast_dns_resolve_recurring(const char *name, int
 	recurring->rr_class = rr_class;
 	strcpy(recurring->name, name); /* SAFE */
 
-	recurring->active = ast_dns_resolve_async(name, rr_type, rr_class, dns_query_recurring_resolution_callback, recurring);
+	recurring->active = dns_resolve_async_uncached(name, rr_type, rr_class, dns_query_recurring_resolution_callback, recurring);
 	if (!recurring->active) {
 		ao2_ref(recurring, -1);
 		return NULL;
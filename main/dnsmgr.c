@@ -58,6 +58,9 @@
 #include "asterisk/cli.h"
 #include "asterisk/manager.h"
 #include "asterisk/acl.h"
+#include "asterisk/dns_core.h"
+
+#include <arpa/nameser.h>
 
 static struct ast_sched_context *sched;
 static int refresh_sched = -1;
@@ -72,6 +75,8 @@ struct ast_dnsmgr_entry {
 	unsigned int family;
 	/*! Set to 1 if the entry changes */
 	unsigned int changed:1;
+	/*! Identifies the entry to the queries refreshing it */
+	unsigned int id;
 	/*! Data to pass back to update_func */
 	void *data;
 	/*! The callback function to execute on address update */
@@ -84,6 +89,15 @@ struct ast_dnsmgr_entry {
 
 static AST_RWLIST_HEAD_STATIC(entry_list, ast_dnsmgr_entry);
 
+/*! The id of the last entry created, protected by the entry_list lock */
+static unsigned int last_entry_id;
+
+/*! \brief A query refreshing an entry in the background */
+struct dnsmgr_query {
+	/*! The id of the entry, which may be released before the query completes */
+	unsigned int id;
+};
+
 AST_MUTEX_DEFINE_STATIC(refresh_lock);
 
 #define REFRESH_DEFAULT 300
@@ -122,6 +136,7 @@ struct ast_dnsmgr_entry *ast_dnsmgr_get_family(const char *name, struct ast_sock
 	entry->family = family;
 
 	AST_RWLIST_WRLOCK(&entry_list);
+	entry->id = ++last_entry_id;
 	AST_RWLIST_INSERT_HEAD(&entry_list, entry, list);
 	AST_RWLIST_UNLOCK(&entry_list);
 
@@ -198,6 +213,34 @@ int ast_dnsmgr_lookup_cb(const char *name, struct ast_sockaddr *result, struct a
 	return internal_dnsmgr_lookup(name, result, dnsmgr, service, func, data);
 }
 
+/*
+ * Apply the address a dnsmgr entry resolved to, with the entry locked
+ */
+static int dnsmgr_update(struct ast_dnsmgr_entry *entry, struct ast_sockaddr *tmp)
+{
+	int changed = 0;
+
+	if (!ast_sockaddr_port(tmp)) {
+		ast_sockaddr_set_port(tmp, ast_sockaddr_port(entry->result));
+	}
+	if (ast_sockaddr_cmp(tmp, entry->result)) {
+		const char *old_addr = ast_strdupa(ast_sockaddr_stringify(entry->result));
+		const char *new_addr = ast_strdupa(ast_sockaddr_stringify(tmp));
+
+		if (entry->update_func) {
+			entry->update_func(entry->result, tmp, entry->data);
+		} else {
+			ast_log(LOG_NOTICE, "dnssrv: host '%s' changed from %s to %s\n",
+					entry->name, old_addr, new_addr);
+
+			ast_sockaddr_copy(entry->result, tmp);
+			changed = entry->changed = 1;
+		}
+	}
+
+	return changed;
+}
+
 /*
  * Refresh a dnsmgr entry
  */
@@ -212,28 +255,106 @@ static int dnsmgr_refresh(struct ast_dnsmgr_entry *entry, int verbose)
 
 	tmp.ss.ss_family = entry->family;
 	if (!ast_get_ip_or_srv(&tmp, entry->name, entry->service)) {
-		if (!ast_sockaddr_port(&tmp)) {
-			ast_sockaddr_set_port(&tmp, ast_sockaddr_port(entry->result));
+		changed = dnsmgr_update(entry, &tmp);
+	}
+
+	ast_mutex_unlock(&entry->lock);
+
+	return changed;
+}
+
+static int dnsmgr_refresh_async(struct ast_dnsmgr_entry *entry, int rr_type);
+
+/*
+ * Completion of a query refreshing a dnsmgr entry in the background
+ */
+static void dnsmgr_resolved(const struct ast_dns_query *query)
+{
+	struct dnsmgr_query *dnsmgr_query = ast_dns_query_get_data(query);
+	const struct ast_dns_result *result = ast_dns_query_get_result(query);
+	const struct ast_dns_record *record;
+	struct ast_dnsmgr_entry *entry;
+
+	AST_RWLIST_RDLOCK(&entry_list);
+	AST_RWLIST_TRAVERSE(&entry_list, entry, list) {
+		if (entry->id == dnsmgr_query->id) {
+			break;
 		}
-		if (ast_sockaddr_cmp(&tmp, entry->result)) {
-			const char *old_addr = ast_strdupa(ast_sockaddr_stringify(entry->result));
-			const char *new_addr = ast_strdupa(ast_sockaddr_stringify(&tmp));
+	}
+	if (!entry) {
+		/* Released while the query was made */
+		AST_RWLIST_UNLOCK(&entry_list);
+		return;
+	}
 
-			if (entry->update_func) {
-				entry->update_func(entry->result, &tmp, entry->data);
-			} else {
-				ast_log(LOG_NOTICE, "dnssrv: host '%s' changed from %s to %s\n",
-						entry->name, old_addr, new_addr);
+	for (record = result ? ast_dns_result_get_records(result) : NULL; record;
+		record = ast_dns_record_get_next(record)) {
+		size_t data_size = ast_dns_record_get_data_size(record);
+		int rr_type = ast_dns_record_get_rr_type(record);
+		struct ast_sockaddr tmp = { .len = 0, };
 
-				ast_sockaddr_copy(entry->result, &tmp);
-				changed = entry->changed = 1;
-			}
+		if (rr_type == ns_t_aaaa && data_size == sizeof(struct in6_addr)) {
+			struct sockaddr_in6 sin6 = { .sin6_family = AF_INET6, };
+
+			memcpy(&sin6.sin6_addr, ast_dns_record_get_data(record), data_size);
+			memcpy(&tmp.ss, &sin6, sizeof(sin6));
+			tmp.len = sizeof(sin6);
+		} else if (rr_type == ns_t_a && data_size == sizeof(struct in_addr)) {
+			struct sockaddr_in sin4 = { .sin_family = AF_INET, };
+
+			memcpy(&sin4.sin_addr, ast_dns_record_get_data(record), data_size);
+			memcpy(&tmp.ss, &sin4, sizeof(sin4));
+			tmp.len = sizeof(sin4);
+		} else {
+			continue;
 		}
+
+		ast_mutex_lock(&entry->lock);
+		dnsmgr_update(entry, &tmp);
+		ast_mutex_unlock(&entry->lock);
+		AST_RWLIST_UNLOCK(&entry_list);
+		return;
 	}
 
-	ast_mutex_unlock(&entry->lock);
+	/* With no family asked for, an IPv6 address will do as well */
+	if (!entry->family && ast_dns_query_get_rr_type(query) == ns_t_a) {
+		dnsmgr_refresh_async(entry, ns_t_aaaa);
+	}
+	AST_RWLIST_UNLOCK(&entry_list);
+}
 
-	return changed;
+/*
+ * Refresh a dnsmgr entry without waiting on the resolver. Entries with an
+ * SRV service are refreshed by dnsmgr_refresh instead.
+ *
+ * \retval 0 the query was started
+ * \retval -1 the entry must be refreshed by dnsmgr_refresh
+ */
+static int dnsmgr_refresh_async(struct ast_dnsmgr_entry *entry, int rr_type)
+{
+	struct dnsmgr_query *query;
+	struct ast_dns_query_active *active;
+
+	if (entry->service) {
+		return -1;
+	}
+
+	query = ao2_alloc_options(sizeof(*query), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!query) {
+		return -1;
+	}
+	query->id = entry->id;
+
+	ast_debug(6, "refreshing '%s' in the background\n", entry->name);
+
+	active = ast_dns_resolve_async(entry->name, rr_type, ns_c_in, dnsmgr_resolved, query);
+	ao2_ref(query, -1);
+	if (!active) {
+		return -1;
+	}
+	ao2_ref(active, -1);
+
+	return 0;
 }
 
 int ast_dnsmgr_refresh(struct ast_dnsmgr_entry *entry)
@@ -289,7 +410,9 @@ static int refresh_list(const void *data)
 			continue;
 		}
 
-		dnsmgr_refresh(entry, info->verbose);
+		if (dnsmgr_refresh_async(entry, entry->family == AF_INET6 ? ns_t_aaaa : ns_t_a)) {
+			dnsmgr_refresh(entry, info->verbose);
+		}
 	}
 	AST_RWLIST_UNLOCK(info->entries);
 
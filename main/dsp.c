@@ -53,6 +53,8 @@
 	<support_level>core</support_level>
  ***/
 
+/* Needed for the x86 intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
 #include "asterisk.h"
 
 #include <math.h>
@@ -69,6 +71,11 @@
 #include "asterisk/config.h"
 #include "asterisk/test.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DSP_KERNELS_X86
+#include <immintrin.h>
+#endif
+
 /*! Number of goertzels for progress detect */
 enum gsamp_size {
 	GSAMP_SIZE_NA = 183,			/*!< North America - 350, 440, 480, 620, 950, 1400, 1800 Hz */
@@ -384,6 +391,183 @@ static inline void goertzel_reset(goertzel_state_t *s)
 	s->v2 = s->v3 = s->chunky = 0;
 }
 
+/*! \brief Most goertzel filters a bank can update at once */
+#define GOERTZEL_BANK_MAX	8
+
+/*!
+ * \brief Feed the same samples to a bank of goertzel filters
+ *
+ * \param bank Filters to update, up to GOERTZEL_BANK_MAX
+ * \param count Number of filters in the bank
+ * \param amp Samples to feed
+ * \param samples Number of samples
+ */
+typedef void (*goertzel_bank_fn)(goertzel_state_t *const *bank, int count, const int16_t *amp, int samples);
+
+/*!
+ * \brief Sum the magnitudes of signed linear samples
+ *
+ * \param amp Samples to sum
+ * \param samples Number of samples
+ *
+ * \return The sum of abs() of every sample
+ */
+typedef int (*dsp_energy_fn)(const int16_t *amp, int samples);
+
+/*! \brief A set of DSP kernel implementations */
+struct dsp_kernels {
+	const char *name;
+	goertzel_bank_fn goertzel_bank;
+	dsp_energy_fn energy;
+	int (*supported)(void);
+};
+
+static void goertzel_bank_samples_scalar(goertzel_state_t *const *bank, int count, const int16_t *amp, int samples)
+{
+	int i;
+	int j;
+
+	for (j = 0; j < samples; j++) {
+		for (i = 0; i < count; i++) {
+			goertzel_sample(bank[i], amp[j]);
+		}
+	}
+}
+
+static int dsp_energy_scalar(const int16_t *amp, int samples)
+{
+	int accum = 0;
+	int x;
+
+	for (x = 0; x < samples; x++) {
+		accum += abs(amp[x]);
+	}
+
+	return accum;
+}
+
+static int dsp_kernels_supported_scalar(void)
+{
+	return 1;
+}
+
+#ifdef DSP_KERNELS_X86
+/*!
+ * \brief Update up to eight goertzel filters in the lanes of one vector
+ *
+ * \details Every lane does exactly what goertzel_sample() does, including
+ * its own chunky scaling, so the results are the same.
+ */
+__attribute__((target("avx2")))
+static void goertzel_bank_samples_avx2(goertzel_state_t *const *bank, int count, const int16_t *amp, int samples)
+{
+	int32_t v2[GOERTZEL_BANK_MAX] = { 0, };
+	int32_t v3[GOERTZEL_BANK_MAX] = { 0, };
+	int32_t chunky[GOERTZEL_BANK_MAX] = { 0, };
+	int32_t fac[GOERTZEL_BANK_MAX] = { 0, };
+	__m256i vv2;
+	__m256i vv3;
+	__m256i vchunky;
+	__m256i vfac;
+	const __m256i limit = _mm256_set1_epi32(1 << 15);
+	const __m256i count_mask = _mm256_set1_epi32(31);
+	int i;
+	int j;
+
+	for (i = 0; i < count; i++) {
+		v2[i] = bank[i]->v2;
+		v3[i] = bank[i]->v3;
+		chunky[i] = bank[i]->chunky;
+		fac[i] = bank[i]->fac;
+	}
+	vv2 = _mm256_loadu_si256((const __m256i *) v2);
+	vv3 = _mm256_loadu_si256((const __m256i *) v3);
+	vchunky = _mm256_loadu_si256((const __m256i *) chunky);
+	vfac = _mm256_loadu_si256((const __m256i *) fac);
+
+	for (j = 0; j < samples; j++) {
+		__m256i v1 = vv2;
+		__m256i over;
+
+		vv2 = vv3;
+		vv3 = _mm256_srai_epi32(_mm256_mullo_epi32(vfac, vv2), 15);
+		/* Shift counts wrap like the scalar shift instruction does. */
+		vv3 = _mm256_add_epi32(_mm256_sub_epi32(vv3, v1),
+			_mm256_srav_epi32(_mm256_set1_epi32(amp[j]), _mm256_and_si256(vchunky, count_mask)));
+
+		/* Lanes whose result grew too large increase their chunky power. */
+		over = _mm256_cmpgt_epi32(_mm256_abs_epi32(vv3), limit);
+		vchunky = _mm256_sub_epi32(vchunky, over);
+		vv3 = _mm256_blendv_epi8(vv3, _mm256_srai_epi32(vv3, 1), over);
+		vv2 = _mm256_blendv_epi8(vv2, _mm256_srai_epi32(vv2, 1), over);
+	}
+
+	_mm256_storeu_si256((__m256i *) v2, vv2);
+	_mm256_storeu_si256((__m256i *) v3, vv3);
+	_mm256_storeu_si256((__m256i *) chunky, vchunky);
+	for (i = 0; i < count; i++) {
+		bank[i]->v2 = v2[i];
+		bank[i]->v3 = v3[i];
+		bank[i]->chunky = chunky[i];
+	}
+}
+
+__attribute__((target("avx2")))
+static int dsp_energy_avx2(const int16_t *amp, int samples)
+{
+	__m256i accum = _mm256_setzero_si256();
+	const __m256i low = _mm256_set1_epi32(0xffff);
+	__m128i sum;
+	int x;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		/* abs(-32768) is still 32768 when the result is taken as unsigned. */
+		__m256i mag = _mm256_abs_epi16(_mm256_loadu_si256((const __m256i *) (amp + x)));
+
+		accum = _mm256_add_epi32(accum, _mm256_add_epi32(
+			_mm256_and_si256(mag, low), _mm256_srli_epi32(mag, 16)));
+	}
+	sum = _mm_add_epi32(_mm256_castsi256_si128(accum), _mm256_extracti128_si256(accum, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(sum) + dsp_energy_scalar(amp + x, samples - x);
+}
+
+static int dsp_kernels_supported_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif /* DSP_KERNELS_X86 */
+
+/*! \brief Known DSP kernels, from least to most preferred */
+static const struct dsp_kernels kernels[] = {
+	{ "scalar", goertzel_bank_samples_scalar, dsp_energy_scalar, dsp_kernels_supported_scalar, },
+#ifdef DSP_KERNELS_X86
+	{ "avx2", goertzel_bank_samples_avx2, dsp_energy_avx2, dsp_kernels_supported_avx2, },
+#endif
+};
+
+static const struct dsp_kernels *dsp_kernels = &kernels[0];
+
+static void dsp_kernels_init(void)
+{
+	int idx;
+
+#ifdef DSP_KERNELS_X86
+	__builtin_cpu_init();
+#endif
+
+	for (idx = ARRAY_LEN(kernels) - 1; idx > 0; --idx) {
+		if (kernels[idx].supported()) {
+			break;
+		}
+	}
+	dsp_kernels = &kernels[idx];
+
+	ast_debug(1, "Using %s DSP kernels\n", dsp_kernels->name);
+}
+
 typedef struct {
 	int start;
 	int end;
@@ -693,6 +877,12 @@ static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp
 	int hit;
 	int limit;
 	fragment_t mute = {0, 0};
+	goertzel_state_t *const bank[] = {
+		&s->td.dtmf.row_out[0], &s->td.dtmf.row_out[1],
+		&s->td.dtmf.row_out[2], &s->td.dtmf.row_out[3],
+		&s->td.dtmf.col_out[0], &s->td.dtmf.col_out[1],
+		&s->td.dtmf.col_out[2], &s->td.dtmf.col_out[3],
+	};
 
 	if (squelch && s->td.dtmf.mute_samples > 0) {
 		mute.end = (s->td.dtmf.mute_samples < samples) ? s->td.dtmf.mute_samples : samples;
@@ -707,22 +897,12 @@ static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp
 		} else {
 			limit = samples;
 		}
-		/* The following unrolled loop takes only 35% (rough estimate) of the
-		   time of a rolled loop on the machine on which it was developed */
 		for (j = sample; j < limit; j++) {
 			samp = amp[j];
 			s->td.dtmf.energy += (int32_t) samp * (int32_t) samp;
-			/* With GCC 2.95, the following unrolled code seems to take about 35%
-			   (rough estimate) as long as a neat little 0-3 loop */
-			goertzel_sample(s->td.dtmf.row_out, samp);
-			goertzel_sample(s->td.dtmf.col_out, samp);
-			goertzel_sample(s->td.dtmf.row_out + 1, samp);
-			goertzel_sample(s->td.dtmf.col_out + 1, samp);
-			goertzel_sample(s->td.dtmf.row_out + 2, samp);
-			goertzel_sample(s->td.dtmf.col_out + 2, samp);
-			goertzel_sample(s->td.dtmf.row_out + 3, samp);
-			goertzel_sample(s->td.dtmf.col_out + 3, samp);
 		}
+		/* All eight row and column filters are updated in one pass */
+		dsp_kernels->goertzel_bank(bank, ARRAY_LEN(bank), amp + sample, limit - sample);
 		s->td.dtmf.current_sample += (limit - sample);
 		if (s->td.dtmf.current_sample < DTMF_GSIZE) {
 			continue;
@@ -894,12 +1074,14 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 	int best;
 	int second_best;
 	int i;
-	int j;
 	int sample;
-	short samp;
 	int hit;
 	int limit;
 	fragment_t mute = {0, 0};
+	goertzel_state_t *const bank[] = {
+		&s->td.mf.tone_out[0], &s->td.mf.tone_out[1], &s->td.mf.tone_out[2],
+		&s->td.mf.tone_out[3], &s->td.mf.tone_out[4], &s->td.mf.tone_out[5],
+	};
 
 	if (squelch && s->td.mf.mute_samples > 0) {
 		mute.end = (s->td.mf.mute_samples < samples) ? s->td.mf.mute_samples : samples;
@@ -915,19 +1097,7 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		} else {
 			limit = samples;
 		}
-		/* The following unrolled loop takes only 35% (rough estimate) of the
-		   time of a rolled loop on the machine on which it was developed */
-		for (j = sample; j < limit; j++) {
-			/* With GCC 2.95, the following unrolled code seems to take about 35%
-			   (rough estimate) as long as a neat little 0-3 loop */
-			samp = amp[j];
-			goertzel_sample(s->td.mf.tone_out, samp);
-			goertzel_sample(s->td.mf.tone_out + 1, samp);
-			goertzel_sample(s->td.mf.tone_out + 2, samp);
-			goertzel_sample(s->td.mf.tone_out + 3, samp);
-			goertzel_sample(s->td.mf.tone_out + 4, samp);
-			goertzel_sample(s->td.mf.tone_out + 5, samp);
-		}
+		dsp_kernels->goertzel_bank(bank, ARRAY_LEN(bank), amp + sample, limit - sample);
 		s->td.mf.current_sample += (limit - sample);
 		if (s->td.mf.current_sample < MF_GSIZE) {
 			continue;
@@ -1070,6 +1240,11 @@ static int __ast_dsp_call_progress(struct ast_dsp *dsp, short *s, int len)
 	int newstate = DSP_TONE_STATE_SILENCE;
 	int res = 0;
 	int freqcount = dsp->freqcount > FREQ_ARRAY_SIZE ? FREQ_ARRAY_SIZE : dsp->freqcount;
+	goertzel_state_t *bank[FREQ_ARRAY_SIZE];
+
+	for (y = 0; y < freqcount; y++) {
+		bank[y] = &dsp->freqs[y];
+	}
 
 	while (len) {
 		/* Take the lesser of the number of samples we need and what we have */
@@ -1080,10 +1255,8 @@ static int __ast_dsp_call_progress(struct ast_dsp *dsp, short *s, int len)
 		for (x = 0; x < pass; x++) {
 			samp = s[x];
 			dsp->genergy += (int32_t) samp * (int32_t) samp;
-			for (y = 0; y < freqcount; y++) {
-				goertzel_sample(&dsp->freqs[y], samp);
-			}
 		}
+		dsp_kernels->goertzel_bank(bank, freqcount, s, pass);
 		s += pass;
 		dsp->gsamps += pass;
 		len -= pass;
@@ -1216,20 +1389,23 @@ int ast_dsp_call_progress(struct ast_dsp *dsp, struct ast_frame *inf)
 	return __ast_dsp_call_progress(dsp, inf->data.ptr, inf->datalen / 2);
 }
 
-static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *totalsilence, int *totalnoise, int *frames_energy)
+/*!
+ * \internal
+ * \brief Track silence and noise given the average energy of some samples
+ *
+ * \param dsp DSP processing audio media.
+ * \param accum Average magnitude of the samples.
+ * \param len Number of samples.
+ * \param totalsilence Variable to set to the total accumulated silence in ms.
+ * \param totalnoise Variable to set to the total accumulated noise in ms.
+ * \param frames_energy Variable to set to \a accum.
+ *
+ * \return Non-zero if the samples are silence.
+ */
+static int dsp_silence_noise_update(struct ast_dsp *dsp, int accum, int len, int *totalsilence, int *totalnoise, int *frames_energy)
 {
-	int accum;
-	int x;
 	int res = 0;
 
-	if (!len) {
-		return 0;
-	}
-	accum = 0;
-	for (x = 0; x < len; x++) {
-		accum += abs(s[x]);
-	}
-	accum /= len;
 	if (accum < dsp->threshold) {
 		/* Silent */
 		dsp->totalsilence += len / (dsp->sample_rate / 1000);
@@ -1282,6 +1458,16 @@ static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *
 	return res;
 }
 
+static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *totalsilence, int *totalnoise, int *frames_energy)
+{
+	if (!len) {
+		return 0;
+	}
+
+	return dsp_silence_noise_update(dsp, dsp_kernels->energy(s, len) / len, len,
+		totalsilence, totalnoise, frames_energy);
+}
+
 int ast_dsp_busydetect(struct ast_dsp *dsp)
 {
 	int res = 0, x;
@@ -1420,12 +1606,53 @@ int ast_dsp_busydetect(struct ast_dsp *dsp)
 	return res;
 }
 
-static int ast_dsp_silence_noise_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *total, int *frames_energy, int noise)
+/*!
+ * \internal
+ * \brief Compute the average magnitude of the samples in a voice frame
+ *
+ * \param f Signed linear, ulaw or alaw voice frame.
+ * \param frames_energy Variable to set to the average magnitude.
+ * \param samples Variable to set to the number of samples in the frame.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the frame format is not supported.
+ */
+static int dsp_frame_energy(const struct ast_frame *f, int *frames_energy, int *samples)
 {
-	short *s;
+	const unsigned char *odata = f->data.ptr;
+	int accum = 0;
 	int len;
 	int x;
-	unsigned char *odata;
+
+	if (ast_format_cache_is_slinear(f->subclass.format)) {
+		len = f->datalen / 2;
+		if (len) {
+			accum = dsp_kernels->energy(f->data.ptr, len);
+		}
+	} else if (ast_format_cmp(f->subclass.format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL) {
+		/* Straight from the codes, there is no need to decode the frame first. */
+		len = f->datalen;
+		for (x = 0; x < len; x++) {
+			accum += abs(AST_MULAW(odata[x]));
+		}
+	} else if (ast_format_cmp(f->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) {
+		len = f->datalen;
+		for (x = 0; x < len; x++) {
+			accum += abs(AST_ALAW(odata[x]));
+		}
+	} else {
+		return -1;
+	}
+
+	*frames_energy = len ? accum / len : 0;
+	*samples = len;
+	return 0;
+}
+
+static int ast_dsp_silence_noise_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *total, int *frames_energy, int noise)
+{
+	int accum;
+	int len;
 
 	if (!f) {
 		return 0;
@@ -1436,33 +1663,46 @@ static int ast_dsp_silence_noise_with_energy(struct ast_dsp *dsp, struct ast_fra
 		return 0;
 	}
 
-	if (ast_format_cache_is_slinear(f->subclass.format)) {
-		s = f->data.ptr;
-		len = f->datalen/2;
-	} else {
-		odata = f->data.ptr;
-		len = f->datalen;
-		if (ast_format_cmp(f->subclass.format, ast_format_ulaw)) {
-			s = ast_alloca(len * 2);
-			for (x = 0; x < len; x++) {
-				s[x] = AST_MULAW(odata[x]);
-			}
-		} else if (ast_format_cmp(f->subclass.format, ast_format_alaw)) {
-			s = ast_alloca(len * 2);
-			for (x = 0; x < len; x++) {
-				s[x] = AST_ALAW(odata[x]);
-			}
-		} else {
-			ast_log(LOG_WARNING, "Can only calculate silence on signed-linear, alaw or ulaw frames :(\n");
-			return 0;
-		}
+	if (dsp_frame_energy(f, &accum, &len)) {
+		ast_log(LOG_WARNING, "Can only calculate silence on signed-linear, alaw or ulaw frames :(\n");
+		return 0;
+	}
+	if (!len) {
+		return 0;
 	}
 
 	if (noise) {
-		return __ast_dsp_silence_noise(dsp, s, len, NULL, total, frames_energy);
+		return dsp_silence_noise_update(dsp, accum, len, NULL, total, frames_energy);
 	} else {
-		return __ast_dsp_silence_noise(dsp, s, len, total, NULL, frames_energy);
+		return dsp_silence_noise_update(dsp, accum, len, total, NULL, frames_energy);
+	}
+}
+
+int ast_dsp_frame_energy(const struct ast_frame *f, int *frames_energy)
+{
+	int len;
+
+	if (!f || f->frametype != AST_FRAME_VOICE) {
+		return -1;
 	}
+
+	return dsp_frame_energy(f, frames_energy, &len);
+}
+
+int ast_dsp_silence_energy(struct ast_dsp *dsp, struct ast_frame *f, int frames_energy, int *totalsilence)
+{
+	int len;
+
+	if (!f || f->frametype != AST_FRAME_VOICE) {
+		return 0;
+	}
+
+	len = ast_format_cache_is_slinear(f->subclass.format) ? f->datalen / 2 : f->datalen;
+	if (!len) {
+		return 0;
+	}
+
+	return dsp_silence_noise_update(dsp, frames_energy, len, totalsilence, NULL, NULL);
 }
 
 int ast_dsp_silence_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *totalsilence, int *frames_energy)
@@ -2394,22 +2634,97 @@ AST_TEST_DEFINE(test_dsp_dtmf_detect)
 }
 #endif
 
+#ifdef TEST_FRAMEWORK
+#define TEST_KERNEL_SAMPLES	(DTMF_GSIZE * 4 + 3)
+
+AST_TEST_DEFINE(test_dsp_kernels)
+{
+	int16_t amp[TEST_KERNEL_SAMPLES];
+	goertzel_state_t expected[GOERTZEL_BANK_MAX];
+	goertzel_state_t actual[GOERTZEL_BANK_MAX];
+	goertzel_state_t *expected_bank[GOERTZEL_BANK_MAX];
+	goertzel_state_t *actual_bank[GOERTZEL_BANK_MAX];
+	enum ast_test_result_state result = AST_TEST_PASS;
+	int idx;
+	int i;
+	int len;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "kernels";
+		info->category = "/main/dsp/";
+		info->summary = "DSP kernels unit test";
+		info->description =
+			"Tests that every DSP kernel the CPU supports matches the scalar kernel.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* Full scale digit with a -32768 sample and an odd length tail */
+	test_dual_sample_gen(amp, ARRAY_LEN(amp), DEFAULT_SAMPLE_RATE,
+		dtmf_row[0], TONE_AMPLITUDE_MAX / 2, dtmf_col[2], TONE_AMPLITUDE_MAX / 2);
+	amp[1] = -32768;
+
+	for (idx = 1; idx < ARRAY_LEN(kernels); ++idx) {
+		if (!kernels[idx].supported()) {
+			continue;
+		}
+
+		for (len = ARRAY_LEN(amp) - 8; len <= ARRAY_LEN(amp); ++len) {
+			if (kernels[idx].energy(amp, len) != kernels[0].energy(amp, len)) {
+				ast_test_status_update(test, "%s energy of %d samples differs\n",
+					kernels[idx].name, len);
+				result = AST_TEST_FAIL;
+			}
+		}
+
+		for (i = 0; i < GOERTZEL_BANK_MAX; ++i) {
+			goertzel_init(&expected[i], i < 4 ? dtmf_row[i] : dtmf_col[i - 4], DEFAULT_SAMPLE_RATE);
+			actual[i] = expected[i];
+			expected_bank[i] = &expected[i];
+			actual_bank[i] = &actual[i];
+		}
+		/* Whole blocks and a block split across calls */
+		for (i = 0; i + DTMF_GSIZE <= ARRAY_LEN(amp); i += DTMF_GSIZE) {
+			kernels[0].goertzel_bank(expected_bank, GOERTZEL_BANK_MAX, amp + i, DTMF_GSIZE);
+			kernels[idx].goertzel_bank(actual_bank, GOERTZEL_BANK_MAX, amp + i, DTMF_GSIZE / 2);
+			kernels[idx].goertzel_bank(actual_bank, GOERTZEL_BANK_MAX,
+				amp + i + DTMF_GSIZE / 2, DTMF_GSIZE - DTMF_GSIZE / 2);
+		}
+		for (i = 0; i < GOERTZEL_BANK_MAX; ++i) {
+			if (memcmp(&expected[i], &actual[i], sizeof(expected[i]))) {
+				ast_test_status_update(test, "%s goertzel filter %d differs\n",
+					kernels[idx].name, i);
+				result = AST_TEST_FAIL;
+			}
+		}
+	}
+
+	return result;
+}
+#endif
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(test_dsp_fax_detect);
 	AST_TEST_UNREGISTER(test_dsp_dtmf_detect);
+	AST_TEST_UNREGISTER(test_dsp_kernels);
 
 	return 0;
 }
 
 static int load_module(void)
 {
+	dsp_kernels_init();
+
 	if (_dsp_init(0)) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
 	AST_TEST_REGISTER(test_dsp_fax_detect);
 	AST_TEST_REGISTER(test_dsp_dtmf_detect);
+	AST_TEST_REGISTER(test_dsp_kernels);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
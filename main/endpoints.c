@@ -74,6 +74,8 @@ struct ast_endpoint {
 	struct ao2_container *channel_ids;
 	/*! Forwarding subscription from an endpoint to its tech endpoint */
 	struct stasis_forward *tech_forward;
+	/*! Snapshot of the endpoint as it is now, NULL until one is next needed */
+	struct ast_endpoint_snapshot *snapshot;
 };
 
 AO2_STRING_FIELD_HASH_FN(ast_endpoint, id)
@@ -157,6 +159,9 @@ static void endpoint_dtor(void *obj)
 	ao2_cleanup(endpoint->channel_ids);
 	endpoint->channel_ids = NULL;
 
+	ao2_cleanup(endpoint->snapshot);
+	endpoint->snapshot = NULL;
+
 	ast_string_field_free_memory(endpoint);
 }
 
@@ -172,6 +177,8 @@ int ast_endpoint_add_channel(struct ast_endpoint *endpoint,
 
 	ao2_lock(endpoint);
 	ast_str_container_add(endpoint->channel_ids, ast_channel_uniqueid(chan));
+	ao2_cleanup(endpoint->snapshot);
+	endpoint->snapshot = NULL;
 	ao2_unlock(endpoint);
 
 	endpoint_publish_snapshot(endpoint);
@@ -186,6 +193,7 @@ static void endpoint_cache_clear(void *data,
 {
 	struct ast_endpoint *endpoint = data;
 	struct ast_channel_snapshot_update *update = stasis_message_data(message);
+	char *channel_id;
 
 	/* Only when the channel is dead do we remove it */
 	if (!ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
@@ -195,7 +203,16 @@ static void endpoint_cache_clear(void *data,
 	ast_assert(endpoint != NULL);
 
 	ao2_lock(endpoint);
-	ast_str_container_remove(endpoint->channel_ids, update->new_snapshot->base->uniqueid);
+	channel_id = ao2_find(endpoint->channel_ids, update->new_snapshot->base->uniqueid,
+		OBJ_SEARCH_KEY | OBJ_UNLINK);
+	if (!channel_id) {
+		/* Removed already, by an earlier update of the dead channel */
+		ao2_unlock(endpoint);
+		return;
+	}
+	ao2_ref(channel_id, -1);
+	ao2_cleanup(endpoint->snapshot);
+	endpoint->snapshot = NULL;
 	ao2_unlock(endpoint);
 	endpoint_publish_snapshot(endpoint);
 }
@@ -411,7 +428,13 @@ void ast_endpoint_set_state(struct ast_endpoint *endpoint,
 	ast_assert(!ast_strlen_zero(endpoint->resource));
 
 	ao2_lock(endpoint);
+	if (endpoint->state == state) {
+		ao2_unlock(endpoint);
+		return;
+	}
 	endpoint->state = state;
+	ao2_cleanup(endpoint->snapshot);
+	endpoint->snapshot = NULL;
 	ao2_unlock(endpoint);
 	endpoint_publish_snapshot(endpoint);
 }
@@ -423,7 +446,13 @@ void ast_endpoint_set_max_channels(struct ast_endpoint *endpoint,
 	ast_assert(!ast_strlen_zero(endpoint->resource));
 
 	ao2_lock(endpoint);
+	if (endpoint->max_channels == max_channels) {
+		ao2_unlock(endpoint);
+		return;
+	}
 	endpoint->max_channels = max_channels;
+	ao2_cleanup(endpoint->snapshot);
+	endpoint->snapshot = NULL;
 	ao2_unlock(endpoint);
 	endpoint_publish_snapshot(endpoint);
 }
@@ -454,6 +483,11 @@ struct ast_endpoint_snapshot *ast_endpoint_snapshot_create(
 	ast_assert(endpoint != NULL);
 	ast_assert(!ast_strlen_zero(endpoint->resource));
 
+	/* Snapshots are immutable, so the last one is shared until the endpoint changes */
+	if (endpoint->snapshot) {
+		return ao2_bump(endpoint->snapshot);
+	}
+
 	channel_count = ao2_container_count(endpoint->channel_ids);
 
 	snapshot = ao2_alloc_options(
@@ -481,6 +515,8 @@ struct ast_endpoint_snapshot *ast_endpoint_snapshot_create(
 	}
 	ao2_iterator_destroy(&i);
 
+	endpoint->snapshot = ao2_bump(snapshot);
+
 	return snapshot;
 }
 
@@ -575,8 +575,37 @@ struct features_config {
 	struct dummy_config *parkinglots;
 	struct ao2_container *applicationmap;
 	struct ao2_container *featuregroups;
+	/*! The applicationmaps built for values of DYNAMIC_FEATURES */
+	struct ao2_container *chan_applicationmaps;
 };
 
+/*! \brief Most values of DYNAMIC_FEATURES an applicationmap is kept for */
+#define MAX_CHAN_APPLICATIONMAPS 256
+
+/*!
+ * \brief The applicationmap of a value of DYNAMIC_FEATURES
+ *
+ * These are kept by the features_config they were built from, so that
+ * channels with the same dynamic features share one applicationmap, built
+ * once for each version of the configuration.
+ */
+struct chan_applicationmap {
+	/*! The applicationmap, NULL if none of the features exist */
+	struct ao2_container *applicationmap;
+	/*! The value of DYNAMIC_FEATURES */
+	char dynamic_features[0];
+};
+
+AO2_STRING_FIELD_HASH_FN(chan_applicationmap, dynamic_features)
+AO2_STRING_FIELD_CMP_FN(chan_applicationmap, dynamic_features)
+
+static void chan_applicationmap_destructor(void *obj)
+{
+	struct chan_applicationmap *entry = obj;
+
+	ao2_cleanup(entry->applicationmap);
+}
+
 static struct aco_type global_option = {
 	.type = ACO_GLOBAL,
 	.name = "globals",
@@ -642,6 +671,7 @@ static void features_config_destructor(void *obj)
 	ao2_cleanup(cfg->parkinglots);
 	ao2_cleanup(cfg->applicationmap);
 	ao2_cleanup(cfg->featuregroups);
+	ao2_cleanup(cfg->chan_applicationmaps);
 }
 
 static void featuremap_config_destructor(void *obj)
@@ -764,6 +794,12 @@ static struct features_config *__features_config_alloc(int allocate_applicationm
 		if (!cfg->featuregroups) {
 			return NULL;
 		}
+
+		cfg->chan_applicationmaps = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 31,
+			chan_applicationmap_hash_fn, NULL, chan_applicationmap_cmp_fn);
+		if (!cfg->chan_applicationmaps) {
+			return NULL;
+		}
 	}
 
 	ao2_ref(cfg, +1);
@@ -1322,30 +1358,17 @@ static int add_item(void *obj, void *arg, int flags)
 	return 0;
 }
 
-struct ao2_container *ast_get_chan_applicationmap(struct ast_channel *chan)
+/*!
+ * \internal
+ * \brief Build the applicationmap of the features and groups of a DYNAMIC_FEATURES value
+ */
+static struct ao2_container *build_chan_applicationmap(struct features_config *cfg,
+	struct ast_channel *chan, const char *dynamic_features)
 {
-	RAII_VAR(struct features_config *, cfg, ao2_global_obj_ref(globals), ao2_cleanup);
 	struct ao2_container *applicationmap;
-	char *group_names;
+	char *group_names = ast_strdupa(dynamic_features);
 	char *name;
 
-	if (!cfg) {
-		return NULL;
-	}
-
-	if (!chan) {
-		if (!cfg->applicationmap || ao2_container_count(cfg->applicationmap) == 0) {
-			return NULL;
-		}
-		ao2_ref(cfg->applicationmap, +1);
-		return cfg->applicationmap;
-	}
-
-	group_names = ast_strdupa(S_OR(pbx_builtin_getvar_helper(chan, "DYNAMIC_FEATURES"), ""));
-	if (ast_strlen_zero(group_names)) {
-		return NULL;
-	}
-
 	applicationmap = applicationmap_alloc(0);
 	if (!applicationmap) {
 		return NULL;
@@ -1379,6 +1402,58 @@ struct ao2_container *ast_get_chan_applicationmap(struct ast_channel *chan)
 	return applicationmap;
 }
 
+struct ao2_container *ast_get_chan_applicationmap(struct ast_channel *chan)
+{
+	RAII_VAR(struct features_config *, cfg, ao2_global_obj_ref(globals), ao2_cleanup);
+	struct chan_applicationmap *entry;
+	struct ao2_container *applicationmap;
+	const char *dynamic_features;
+
+	if (!cfg) {
+		return NULL;
+	}
+
+	if (!chan) {
+		if (!cfg->applicationmap || ao2_container_count(cfg->applicationmap) == 0) {
+			return NULL;
+		}
+		ao2_ref(cfg->applicationmap, +1);
+		return cfg->applicationmap;
+	}
+
+	dynamic_features = pbx_builtin_getvar_helper(chan, "DYNAMIC_FEATURES");
+	if (ast_strlen_zero(dynamic_features)) {
+		return NULL;
+	}
+
+	ao2_lock(cfg->chan_applicationmaps);
+	entry = ao2_find(cfg->chan_applicationmaps, dynamic_features, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!entry) {
+		applicationmap = build_chan_applicationmap(cfg, chan, dynamic_features);
+		if (ao2_container_count(cfg->chan_applicationmaps) >= MAX_CHAN_APPLICATIONMAPS) {
+			/* Too many values to keep, such as ones built from variables */
+			ao2_unlock(cfg->chan_applicationmaps);
+			return applicationmap;
+		}
+
+		entry = ao2_alloc_options(sizeof(*entry) + strlen(dynamic_features) + 1,
+			chan_applicationmap_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!entry) {
+			ao2_unlock(cfg->chan_applicationmaps);
+			return applicationmap;
+		}
+		strcpy(entry->dynamic_features, dynamic_features); /* Safe */
+		entry->applicationmap = applicationmap;
+		ao2_link_flags(cfg->chan_applicationmaps, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(cfg->chan_applicationmaps);
+
+	applicationmap = ao2_bump(entry->applicationmap);
+	ao2_ref(entry, -1);
+
+	return applicationmap;
+}
+
 static int applicationmap_handler(const struct aco_option *opt,
 		struct ast_variable *var, void *obj)
 {
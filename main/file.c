@@ -33,6 +33,10 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <math.h>
+#include <utime.h>
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
 
 #include "asterisk/_private.h"	/* declare ast_file_init() */
 #include "asterisk/paths.h"	/* use ast_config_AST_DATA_DIR */
@@ -53,6 +57,7 @@
 #include "asterisk/json.h"
 #include "asterisk/stasis_system.h"
 #include "asterisk/media_cache.h"
+#include "asterisk/taskprocessor.h"
 
 /*! \brief
  * The following variable controls the layout of localized sound files.
@@ -71,6 +76,135 @@ static AST_RWLIST_HEAD_STATIC(formats, ast_format_def);
 STASIS_MESSAGE_TYPE_DEFN(ast_format_register_type);
 STASIS_MESSAGE_TYPE_DEFN(ast_format_unregister_type);
 
+/*! Number of buckets of the prompt cache */
+#define PROMPT_BUCKETS 127
+
+/*! Larger files are always played from the disk */
+#define PROMPT_MAX_FILE_SIZE (4 * 1024 * 1024)
+
+/*!
+ * \brief The contents of a sound file kept in memory for playback
+ *
+ * The contents are read rather than mapped, as a file truncated while a
+ * stream reads from its mapping would crash Asterisk.
+ */
+struct file_prompt {
+	/*! What the file was when read, to notice it was replaced or changed */
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	char *data;
+	char path[0];
+};
+
+/*! \brief Files played that are kept in memory, by path */
+static struct ao2_container *prompts;
+
+/*! \brief Bytes of the files kept in prompts, protected by its lock */
+static size_t prompts_size;
+
+/*! \brief Playbacks of a file found in the prompt cache */
+static int prompt_hits;
+
+/*! \brief Playbacks of a file read into the prompt cache */
+static int prompt_misses;
+
+AO2_STRING_FIELD_HASH_FN(file_prompt, path);
+AO2_STRING_FIELD_CMP_FN(file_prompt, path);
+
+/*! Number of buckets of the index of the sounds directories */
+#define INDEX_DIR_BUCKETS 61
+
+/*! Number of buckets of the names of each indexed directory */
+#define INDEX_NAME_BUCKETS 127
+
+enum file_index_res {
+	/*! The path is not indexed, the file system has to be asked */
+	FILE_INDEX_UNKNOWN = -1,
+	FILE_INDEX_ABSENT = 0,
+	FILE_INDEX_PRESENT = 1,
+};
+
+/*! \brief A regular file or directory listed in an indexed directory */
+struct file_index_name {
+	int is_dir;
+	char name[0];
+};
+
+/*!
+ * \brief The listing of a directory of the sounds tree
+ *
+ * The directory is watched with inotify, and dropped from the index as
+ * soon as anything is added to or removed from it. It is listed again
+ * the next time it is looked up.
+ */
+struct file_index_dir {
+	/*! The inotify watch of the directory */
+	int wd;
+	/*! The file_index_name entries, never changed once listed */
+	struct ao2_container *names;
+	char path[0];
+};
+
+/*! \brief The listed directories of the sounds tree, by path */
+static struct ao2_container *index_dirs;
+
+/*! \brief The directory the index covers */
+static char *index_root;
+
+/*! \brief The inotify instance watching the listed directories, -1 if none */
+static int index_fd = -1;
+
+/*! Directory under astvarlibdir the variants of sound files are written to */
+#define VARIANT_DIR "sound_variants"
+
+/*! Playbacks needing a translation before the file is written in the format played */
+#define VARIANT_PLAYBACKS 3
+
+/*! Most files counted at once on their way to a variant */
+#define VARIANT_MAX_COUNTED 1024
+
+/*! Number of buckets of the files counted */
+#define VARIANT_BUCKETS 61
+
+/*!
+ * \brief A sound file played in a format it does not exist in
+ *
+ * The variant has the mtime of the file it was written from, and is
+ * ignored once the file has another one.
+ */
+struct file_variant {
+	/*! Playbacks of the file that needed a translation */
+	unsigned int playbacks;
+	/*! Set once the variant is being written */
+	unsigned int queued;
+	/*! The mtime of the file played */
+	time_t mtime;
+	/*! The file played, without extension */
+	char *source;
+	/*! The extension of the file played */
+	char *source_ext;
+	/*! The extension of the variant */
+	char *ext;
+	/*! The variant, without extension */
+	char path[0];
+};
+
+/*! \brief Files counted on their way to a variant, by the path of the variant */
+static struct ao2_container *variants;
+
+/*! \brief Writes the variants, created once one is first needed */
+static struct ast_taskprocessor *variants_tps;
+
+AO2_STRING_FIELD_HASH_FN(file_variant, path);
+AO2_STRING_FIELD_CMP_FN(file_variant, path);
+
+AO2_STRING_FIELD_HASH_FN(file_index_name, name);
+AO2_STRING_FIELD_CMP_FN(file_index_name, name);
+AO2_STRING_FIELD_HASH_FN(file_index_dir, path);
+AO2_STRING_FIELD_CMP_FN(file_index_dir, path);
+
 static struct ast_json *json_array_from_list(const char *list, const char *sep)
 {
 	RAII_VAR(struct ast_json *, array, ast_json_array_create(), ast_json_unref);
@@ -399,6 +533,7 @@ static void filestream_destructor(void *arg)
 	if (f->f) {
 		fclose(f->f);
 	}
+	ao2_cleanup(f->prompt);
 
 	if (f->realfilename && f->filename) {
 		pid = ast_safe_fork(0);
@@ -416,6 +551,7 @@ static void filestream_destructor(void *arg)
 	ast_free(f->realfilename);
 	if (f->vfs)
 		ast_closestream(f->vfs);
+	ao2_cleanup(f->next);
 	ast_free(f->write_buffer);
 	ast_free((void *)f->orig_chan_name);
 	ao2_cleanup(f->lastwriteformat);
@@ -490,12 +626,430 @@ static int open_wrapper(struct ast_filestream *s)
 	return fn_wrapper(s, NULL, WRAP_OPEN);
 }
 
+static void file_index_dir_destructor(void *obj)
+{
+	struct file_index_dir *dir = obj;
+
+	ao2_cleanup(dir->names);
+}
+
+static int file_index_dir_wd_cmp(void *obj, void *arg, int flags)
+{
+	struct file_index_dir *dir = obj;
+	int *wd = arg;
+
+	return dir->wd == *wd ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief Drop the directories that changed since they were listed
+ *
+ * \note Must be called with index_dirs locked
+ */
+static void file_index_drain(void)
+{
+#ifdef HAVE_INOTIFY
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	ssize_t len;
+	char *pos;
+
+	while ((len = read(index_fd, buf, sizeof(buf))) > 0) {
+		for (pos = buf; pos < buf + len; pos += sizeof(*event) + event->len) {
+			event = (const struct inotify_event *) pos;
+			if (event->mask & IN_Q_OVERFLOW) {
+				/* Changes were missed, nothing listed can be trusted */
+				ao2_callback(index_dirs, OBJ_NOLOCK | OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA,
+					NULL, NULL);
+				continue;
+			}
+			ao2_callback(index_dirs, OBJ_NOLOCK | OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA,
+				file_index_dir_wd_cmp, (void *) &event->wd);
+		}
+	}
+#endif
+}
+
+/*!
+ * \internal
+ * \brief List a directory and start watching it
+ *
+ * \note Must be called with index_dirs locked
+ */
+static struct file_index_dir *file_index_dir_list(const char *path)
+{
+#ifdef HAVE_INOTIFY
+	struct file_index_dir *dir;
+	DIR *dirp;
+	struct dirent *entry;
+	int wd;
+
+	/* Watched before listing, so nothing changing in between is missed */
+	wd = inotify_add_watch(index_fd, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM
+		| IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (wd < 0) {
+		return NULL;
+	}
+
+	dir = ao2_alloc_options(sizeof(*dir) + strlen(path) + 1, file_index_dir_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!dir) {
+		return NULL;
+	}
+	strcpy(dir->path, path); /* Safe */
+	dir->wd = wd;
+	dir->names = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, INDEX_NAME_BUCKETS,
+		file_index_name_hash_fn, NULL, file_index_name_cmp_fn);
+	dirp = dir->names ? opendir(path) : NULL;
+	if (!dirp) {
+		ao2_ref(dir, -1);
+		return NULL;
+	}
+
+	while ((entry = readdir(dirp))) {
+		struct file_index_name *name;
+		struct stat st;
+		int is_dir;
+
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+			continue;
+		}
+
+#ifdef _DIRENT_HAVE_D_TYPE
+		if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+			if (entry->d_type != DT_REG && entry->d_type != DT_DIR) {
+				continue;
+			}
+			is_dir = entry->d_type == DT_DIR;
+		} else
+#endif
+		{
+			char *full_path;
+
+			if (ast_asprintf(&full_path, "%s/%s", path, entry->d_name) < 0) {
+				break;
+			}
+			is_dir = stat(full_path, &st);
+			ast_free(full_path);
+			if (is_dir || (!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode))) {
+				continue;
+			}
+			is_dir = S_ISDIR(st.st_mode);
+		}
+
+		name = ao2_alloc_options(sizeof(*name) + strlen(entry->d_name) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!name) {
+			break;
+		}
+		strcpy(name->name, entry->d_name); /* Safe */
+		name->is_dir = is_dir;
+		ao2_link(dir->names, name);
+		ao2_ref(name, -1);
+	}
+	closedir(dirp);
+
+	if (entry) {
+		/* Out of memory, an incomplete listing cannot be used */
+		ao2_ref(dir, -1);
+		return NULL;
+	}
+
+	ao2_link_flags(index_dirs, dir, OBJ_NOLOCK);
+
+	return dir;
+#else
+	return NULL;
+#endif
+}
+
+/*! \brief The directory of a path, up to its last slash */
+#define file_index_parent(path, slash) ({ \
+	char *__parent = ast_alloca((slash) - (path) + 1); \
+	ast_copy_string(__parent, (path), (slash) - (path) + 1); \
+	__parent; \
+})
+
+/*!
+ * \internal
+ * \brief Find the listing of a directory of the sounds tree
+ *
+ * Directories are only listed once their parent lists them.
+ *
+ * \param path The directory
+ * \param[out] absent Set if the directory is known not to exist
+ *
+ * \note Must be called with index_dirs locked
+ */
+static struct file_index_dir *file_index_dir_find(const char *path, int *absent)
+{
+	struct file_index_dir *dir;
+	struct file_index_dir *parent;
+	struct file_index_name *name;
+	const char *slash;
+
+	dir = ao2_find(index_dirs, path, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (dir) {
+		return dir;
+	}
+
+	if (strcmp(path, index_root)) {
+		slash = strrchr(path, '/');
+		parent = file_index_dir_find(file_index_parent(path, slash), absent);
+		if (!parent) {
+			return NULL;
+		}
+		name = ao2_find(parent->names, slash + 1, OBJ_SEARCH_KEY);
+		ao2_ref(parent, -1);
+		if (!name || !name->is_dir) {
+			ao2_cleanup(name);
+			*absent = 1;
+			return NULL;
+		}
+		ao2_ref(name, -1);
+	}
+
+	return file_index_dir_list(path);
+}
+
+/*!
+ * \internal
+ * \brief Get the names listed in a directory of the sounds tree
+ *
+ * \return The file_index_name container, or NULL if not indexed or absent
+ */
+static struct ao2_container *file_index_names(const char *path, int *absent)
+{
+	size_t root_len;
+	struct file_index_dir *dir;
+	struct ao2_container *names;
+
+	*absent = 0;
+	if (index_fd < 0) {
+		return NULL;
+	}
+
+	/* Only canonical paths are indexed, "." and ".." are left to the file system */
+	root_len = strlen(index_root);
+	if (strncmp(path, index_root, root_len) || (path[root_len] && path[root_len] != '/')
+		|| strstr(path, "/.") || strstr(path, "//") || path[strlen(path) - 1] == '/') {
+		return NULL;
+	}
+
+	ao2_lock(index_dirs);
+	file_index_drain();
+	dir = file_index_dir_find(path, absent);
+	ao2_unlock(index_dirs);
+	if (!dir) {
+		return NULL;
+	}
+	names = ao2_bump(dir->names);
+	ao2_ref(dir, -1);
+
+	return names;
+}
+
+/*!
+ * \internal
+ * \brief Check in the index of the sounds tree if a regular file exists
+ */
+static enum file_index_res file_index_lookup(const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	struct ao2_container *names;
+	struct file_index_name *name;
+	int absent;
+
+	if (!slash) {
+		return FILE_INDEX_UNKNOWN;
+	}
+
+	names = file_index_names(file_index_parent(path, slash), &absent);
+	if (!names) {
+		return absent ? FILE_INDEX_ABSENT : FILE_INDEX_UNKNOWN;
+	}
+	name = ao2_find(names, slash + 1, OBJ_SEARCH_KEY);
+	ao2_ref(names, -1);
+	if (!name) {
+		return FILE_INDEX_ABSENT;
+	}
+	absent = name->is_dir;
+	ao2_ref(name, -1);
+
+	return absent ? FILE_INDEX_ABSENT : FILE_INDEX_PRESENT;
+}
+
+static void file_prompt_destructor(void *obj)
+{
+	struct file_prompt *prompt = obj;
+
+	ast_free(prompt->data);
+}
+
+static int file_prompt_is_stale(const struct file_prompt *prompt, const struct stat *st)
+{
+	return prompt->dev != st->st_dev || prompt->ino != st->st_ino
+		|| prompt->size != st->st_size || prompt->mtime != st->st_mtime;
+}
+
+/*!
+ * \internal
+ * \brief Read a file into memory if it fits in the prompt cache
+ */
+static struct file_prompt *file_prompt_read(const char *fn, const struct stat *st)
+{
+	struct file_prompt *prompt;
+	FILE *bfile;
+	int res;
+
+	ao2_lock(prompts);
+	res = prompts_size + st->st_size > (size_t) ast_option_prompt_cache_size * 1024 * 1024;
+	ao2_unlock(prompts);
+	if (res) {
+		return NULL;
+	}
+
+	prompt = ao2_alloc_options(sizeof(*prompt) + strlen(fn) + 1, file_prompt_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!prompt) {
+		return NULL;
+	}
+	strcpy(prompt->path, fn); /* Safe */
+	prompt->dev = st->st_dev;
+	prompt->ino = st->st_ino;
+	prompt->size = st->st_size;
+	prompt->mtime = st->st_mtime;
+
+	prompt->data = ast_malloc(prompt->size);
+	bfile = prompt->data ? fopen(fn, "r") : NULL;
+	if (!bfile) {
+		ao2_ref(prompt, -1);
+		return NULL;
+	}
+	res = fread(prompt->data, 1, prompt->size, bfile) != prompt->size;
+	fclose(bfile);
+	if (res) {
+		/* It changed while being read, it will be read again next time */
+		ao2_ref(prompt, -1);
+		return NULL;
+	}
+
+	return prompt;
+}
+
+/*!
+ * \internal
+ * \brief Stop keeping a file in the prompt cache
+ */
+static void file_prompt_forget(const char *fn)
+{
+	struct file_prompt *prompt;
+
+	if (!prompts) {
+		return;
+	}
+
+	ao2_lock(prompts);
+	prompt = ao2_find(prompts, fn, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (prompt) {
+		prompts_size -= prompt->size;
+		ao2_ref(prompt, -1);
+	}
+	ao2_unlock(prompts);
+}
+
+/*!
+ * \internal
+ * \brief Find a file in the prompt cache, reading it into the cache if missing
+ *
+ * \param fn The file
+ * \param st What stat() returned for it
+ *
+ * \return The reference to the cached contents, NULL if not cached
+ */
+static struct file_prompt *file_prompt_get(const char *fn, const struct stat *st)
+{
+	struct file_prompt *prompt;
+	struct file_prompt *existing;
+
+	if (!ast_option_prompt_cache_size || !prompts
+		|| !st->st_size || st->st_size > PROMPT_MAX_FILE_SIZE) {
+		return NULL;
+	}
+
+	ao2_lock(prompts);
+	prompt = ao2_find(prompts, fn, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (prompt && file_prompt_is_stale(prompt, st)) {
+		ao2_unlink_flags(prompts, prompt, OBJ_NOLOCK);
+		prompts_size -= prompt->size;
+		ao2_replace(prompt, NULL);
+	}
+	ao2_unlock(prompts);
+
+	if (prompt) {
+		ast_atomic_fetchadd_int(&prompt_hits, +1);
+	} else {
+		prompt = file_prompt_read(fn, st);
+		if (!prompt) {
+			return NULL;
+		}
+		ast_atomic_fetchadd_int(&prompt_misses, +1);
+
+		ao2_lock(prompts);
+		existing = ao2_find(prompts, fn, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (existing) {
+			/* Another playback read it at the same time */
+			ao2_replace(prompt, existing);
+			ao2_ref(existing, -1);
+		} else {
+			ao2_link_flags(prompts, prompt, OBJ_NOLOCK);
+			prompts_size += prompt->size;
+		}
+		ao2_unlock(prompts);
+	}
+
+	return prompt;
+}
+
+/*!
+ * \internal
+ * \brief Open a sound file to be played, from the prompt cache if enabled
+ *
+ * \param fn The file
+ * \param st What stat() returned for it
+ * \param[out] cached The reference to the cached contents the stream reads
+ *
+ * \return The stream to read the file from
+ */
+static FILE *file_prompt_open(const char *fn, const struct stat *st, struct file_prompt **cached)
+{
+	struct file_prompt *prompt;
+	FILE *bfile;
+
+	*cached = NULL;
+	prompt = file_prompt_get(fn, st);
+	if (!prompt) {
+		return fopen(fn, "r");
+	}
+
+	bfile = fmemopen(prompt->data, prompt->size, "r");
+	if (!bfile) {
+		ao2_ref(prompt, -1);
+		return fopen(fn, "r");
+	}
+	*cached = prompt;
+
+	return bfile;
+}
+
 enum file_action {
 	ACTION_EXISTS = 1, /* return matching format if file exists, 0 otherwise */
 	ACTION_DELETE,	/* delete file, return 0 on success, -1 on error */
 	ACTION_RENAME,	/* rename file. return 0 on success, -1 on error */
 	ACTION_OPEN,
-	ACTION_COPY	/* copy file. return 0 on success, -1 on error */
+	ACTION_COPY,	/* copy file. return 0 on success, -1 on error */
+	ACTION_PREFETCH	/* read file into the prompt cache. return 0 if any was, -1 otherwise */
 };
 
 /*!
@@ -533,11 +1087,15 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 		while ( (ext = strsep(&stringp, "|")) ) {
 			struct stat st;
 			char *fn = build_filename(filename, ext);
+			enum file_index_res indexed;
 
 			if (fn == NULL)
 				continue;
 
-			if ( stat(fn, &st) ) { /* file not existent */
+			/* Existence is answered by the index of the sounds tree when possible */
+			indexed = action == ACTION_EXISTS ? file_index_lookup(fn) : FILE_INDEX_UNKNOWN;
+			if (indexed == FILE_INDEX_ABSENT
+				|| (indexed == FILE_INDEX_UNKNOWN && stat(fn, &st))) { /* file not existent */
 				ast_free(fn);
 				continue;
 			}
@@ -548,6 +1106,7 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 				struct ast_channel *chan = (struct ast_channel *)arg2;
 				FILE *bfile;
 				struct ast_filestream *s;
+				struct file_prompt *prompt;
 
 				if ((ast_format_cmp(ast_channel_writeformat(chan), f->format) == AST_FORMAT_CMP_NOT_EQUAL) &&
 				     !(((ast_format_get_type(f->format) == AST_MEDIA_TYPE_AUDIO) && fmt) ||
@@ -555,16 +1114,18 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 					ast_free(fn);
 					continue;	/* not a supported format */
 				}
-				if ( (bfile = fopen(fn, "r")) == NULL) {
+				if ( (bfile = file_prompt_open(fn, &st, &prompt)) == NULL) {
 					ast_free(fn);
 					continue;	/* cannot open file */
 				}
 				s = get_filestream(f, bfile);
 				if (!s) {
 					fclose(bfile);
+					ao2_cleanup(prompt);
 					ast_free(fn);	/* cannot allocate descriptor */
 					continue;
 				}
+				s->prompt = prompt;
 				if (open_wrapper(s)) {
 					ast_free(fn);
 					ast_closestream(s);
@@ -604,7 +1165,18 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 				res = 1; /* file does exist and format it exists in is returned in arg2 */
 				break;
 
+			case ACTION_PREFETCH: {
+				struct file_prompt *prompt = file_prompt_get(fn, &st);
+
+				if (prompt) {
+					res = 0;
+					ao2_ref(prompt, -1);
+				}
+			    }
+				break;
+
 			case ACTION_DELETE:
+				file_prompt_forget(fn);
 				if ( (res = unlink(fn)) )
 					ast_log(LOG_WARNING, "unlink(%s) failed: %s\n", fn, strerror(errno));
 				break;
@@ -615,6 +1187,10 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 				if (!nfn)
 					ast_log(LOG_WARNING, "Out of memory\n");
 				else {
+					if (action == ACTION_RENAME) {
+						file_prompt_forget(fn);
+						file_prompt_forget(nfn);
+					}
 					res = action == ACTION_COPY ? copy(fn, nfn) : rename(fn, nfn);
 					if (res)
 						ast_log(LOG_WARNING, "%s(%s,%s) failed: %s\n",
@@ -750,6 +1326,257 @@ static int fileexists_core(const char *filename, const char *fmt, const char *pr
 	return 0;
 }
 
+static void file_variant_destructor(void *obj)
+{
+	struct file_variant *variant = obj;
+
+	ast_free(variant->source);
+	ast_free(variant->source_ext);
+	ast_free(variant->ext);
+}
+
+/*!
+ * \internal
+ * \brief Find the extension of a file existing in a format
+ *
+ * \param name The file, without extension
+ * \param format The format
+ * \param writable Only consider the file formats that can be written
+ * \param[out] ext The extension
+ * \param ext_len The size of ext
+ * \param[out] st What stat() returned for the file, NULL to not check it exists
+ *
+ * \retval 0 on success
+ * \retval -1 if the file does not exist in the format
+ */
+static int file_format_ext(const char *name, struct ast_format *format, int writable,
+	char *ext, size_t ext_len, struct stat *st)
+{
+	struct ast_format_def *f;
+	int res = -1;
+
+	AST_RWLIST_RDLOCK(&formats);
+	AST_RWLIST_TRAVERSE(&formats, f, list) {
+		char storage[strlen(f->exts) + 1];
+		char *stringp = storage;
+		char *cur;
+
+		if (ast_format_cmp(f->format, format) == AST_FORMAT_CMP_NOT_EQUAL
+			|| (writable && !f->write)) {
+			continue;
+		}
+
+		strcpy(storage, f->exts); /* Safe */
+		while (res && (cur = strsep(&stringp, "|"))) {
+			char *fn;
+
+			if (st) {
+				fn = build_filename(name, cur);
+				if (!fn || stat(fn, st)) {
+					ast_free(fn);
+					continue;
+				}
+				ast_free(fn);
+			}
+			ast_copy_string(ext, cur, ext_len);
+			res = 0;
+		}
+		if (!res) {
+			break;
+		}
+	}
+	AST_RWLIST_UNLOCK(&formats);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Write the variant of a sound file
+ */
+static int file_variant_write(void *data)
+{
+	struct file_variant *variant = data;
+	struct ast_filestream *source;
+	struct ast_filestream *out;
+	struct ast_frame *frame = NULL;
+	struct utimbuf times = { .actime = variant->mtime, .modtime = variant->mtime, };
+	char *dir = ast_strdupa(variant->path);
+	char *tmp = NULL;
+	char *tmp_fn = NULL;
+	char *fn = NULL;
+	int res = -1;
+
+	*strrchr(dir, '/') = '\0';
+	if (ast_mkdir(dir, 0777) || ast_asprintf(&tmp, "%s.tmp", variant->path) < 0) {
+		goto done;
+	}
+	tmp_fn = build_filename(tmp, variant->ext);
+	fn = build_filename(variant->path, variant->ext);
+	if (!tmp_fn || !fn) {
+		goto done;
+	}
+
+	source = ast_readfile(variant->source, variant->source_ext, NULL, O_RDONLY, 0, 0);
+	if (!source) {
+		goto done;
+	}
+	out = ast_writefile(tmp, variant->ext, NULL, O_CREAT | O_TRUNC | O_WRONLY, 0, AST_FILE_MODE);
+	if (!out) {
+		ast_closestream(source);
+		goto done;
+	}
+	/* Frames of the source are translated by the stream written */
+	while ((frame = ast_readframe(source))) {
+		if (ast_writestream(out, frame)) {
+			ast_frfree(frame);
+			break;
+		}
+		ast_frfree(frame);
+	}
+	ast_closestream(out);
+	ast_closestream(source);
+
+	if (!frame && !utime(tmp_fn, &times) && !rename(tmp_fn, fn)) {
+		ast_debug(1, "Wrote %s for the playbacks of %s.%s\n", fn, variant->source,
+			variant->source_ext);
+		res = 0;
+	} else {
+		ast_log(LOG_WARNING, "Unable to write %s from %s.%s\n", fn, variant->source,
+			variant->source_ext);
+		unlink(tmp_fn);
+	}
+
+done:
+	ast_free(fn);
+	ast_free(tmp_fn);
+	ast_free(tmp);
+	/* Playbacks are counted again if writing it failed */
+	ao2_unlink(variants, variant);
+	ao2_ref(variant, -1);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Count a playback needing a translation, queueing the variant once often enough
+ */
+static void file_variant_count(const char *path, const char *source, const char *source_ext,
+	const char *ext, time_t mtime)
+{
+	struct file_variant *variant;
+
+	ao2_lock(variants);
+	variant = ao2_find(variants, path, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!variant) {
+		if (ao2_container_count(variants) >= VARIANT_MAX_COUNTED) {
+			ao2_unlock(variants);
+			return;
+		}
+		variant = ao2_alloc_options(sizeof(*variant) + strlen(path) + 1, file_variant_destructor,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!variant) {
+			ao2_unlock(variants);
+			return;
+		}
+		strcpy(variant->path, path); /* Safe */
+		variant->source = ast_strdup(source);
+		variant->source_ext = ast_strdup(source_ext);
+		variant->ext = ast_strdup(ext);
+		if (!variant->source || !variant->source_ext || !variant->ext) {
+			ao2_unlock(variants);
+			ao2_ref(variant, -1);
+			return;
+		}
+		ao2_link_flags(variants, variant, OBJ_NOLOCK);
+	}
+
+	if (!variant->queued) {
+		variant->mtime = mtime;
+		if (++variant->playbacks >= VARIANT_PLAYBACKS) {
+			if (!variants_tps) {
+				variants_tps = ast_taskprocessor_get("file_variants", TPS_REF_DEFAULT);
+			}
+			variant->queued = 1;
+			if (!variants_tps
+				|| ast_taskprocessor_push(variants_tps, file_variant_write, ao2_bump(variant))) {
+				ao2_ref(variant, -1);
+				ao2_unlink_flags(variants, variant, OBJ_NOLOCK);
+			}
+		}
+	}
+	ao2_unlock(variants);
+	ao2_ref(variant, -1);
+}
+
+/*!
+ * \internal
+ * \brief Find a variant of a sound file in the format the channel writes
+ *
+ * Otherwise the playback is counted, and once the file was played often
+ * enough a variant is written in the background.
+ *
+ * \param chan The channel the file is played to
+ * \param name The file found, without extension
+ * \param file_fmt_cap The formats the file exists in
+ * \param[out] variant_fmt_cap The format the variant is in
+ *
+ * \return The variant to play instead, without extension, or NULL
+ */
+static char *file_variant_find(struct ast_channel *chan, const char *name,
+	struct ast_format_cap *file_fmt_cap, struct ast_format_cap *variant_fmt_cap)
+{
+	struct ast_format *native;
+	struct ast_format *best_native = NULL;
+	struct ast_format *best_source = NULL;
+	char ext[AST_MAX_EXTENSION];
+	char source_ext[AST_MAX_EXTENSION];
+	struct stat source_st;
+	struct stat st;
+	char *path = NULL;
+	char *fn;
+
+	if (!ast_option_sound_variants || is_absolute_path(name) || is_remote_path(name)) {
+		return NULL;
+	}
+
+	ast_channel_lock(chan);
+	native = ao2_bump(ast_channel_rawwriteformat(chan));
+	ast_channel_unlock(chan);
+	if (!native || ast_format_cap_iscompatible_format(file_fmt_cap, native) != AST_FORMAT_CMP_NOT_EQUAL
+		|| ast_format_cap_append(variant_fmt_cap, native, 0)) {
+		/* The file is played as is */
+		goto done;
+	}
+
+	if (ast_translator_best_choice(variant_fmt_cap, file_fmt_cap, &best_native, &best_source)
+		|| file_format_ext(name, best_source, 0, source_ext, sizeof(source_ext), &source_st)
+		|| file_format_ext(name, native, 1, ext, sizeof(ext), NULL)
+		|| ast_asprintf(&path, "%s/%s/%s", ast_config_AST_VAR_DIR, VARIANT_DIR, name) < 0) {
+		path = NULL;
+		goto done;
+	}
+
+	fn = build_filename(path, ext);
+	if (fn && !stat(fn, &st) && st.st_mtime == source_st.st_mtime) {
+		ast_free(fn);
+		goto done;
+	}
+	ast_free(fn);
+
+	file_variant_count(path, name, source_ext, ext, source_st.st_mtime);
+	ast_free(path);
+	path = NULL;
+
+done:
+	ao2_cleanup(best_native);
+	ao2_cleanup(best_source);
+	ao2_cleanup(native);
+
+	return path;
+}
+
 struct ast_filestream *ast_openstream(struct ast_channel *chan, const char *filename, const char *preflang)
 {
 	return ast_openstream_full(chan, filename, preflang, 0);
@@ -763,6 +1590,8 @@ struct ast_filestream *ast_openstream_full(struct ast_channel *chan, const char
 	 * and open the stream.
 	 */
 	struct ast_format_cap *file_fmt_cap;
+	struct ast_format_cap *variant_fmt_cap;
+	char *variant;
 	int res;
 	int buflen;
 	char *buf;
@@ -789,6 +1618,17 @@ struct ast_filestream *ast_openstream_full(struct ast_channel *chan, const char
 		return NULL;
 	}
 
+	/* Play a variant already in the format of the channel instead, if there is one */
+	variant_fmt_cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	variant = variant_fmt_cap ? file_variant_find(chan, buf, file_fmt_cap, variant_fmt_cap) : NULL;
+	if (variant) {
+		ast_debug(1, "Playing %s instead of %s\n", variant, buf);
+		ao2_replace(file_fmt_cap, variant_fmt_cap);
+		buf = ast_strdupa(variant);
+		ast_free(variant);
+	}
+	ao2_cleanup(variant_fmt_cap);
+
 	/* Set the channel to a format we can work with and save off the previous format. */
 	ast_channel_lock(chan);
 	ast_channel_set_oldwriteformat(chan, ast_channel_writeformat(chan));
@@ -872,13 +1712,19 @@ struct ast_filestream *ast_openvstream(struct ast_channel *chan, const char *fil
 static struct ast_frame *read_frame(struct ast_filestream *s, int *whennext)
 {
 	struct ast_frame *fr, *new_fr;
+	struct ast_filestream *cur;
 
 	if (!s || !s->fmt) {
 		return NULL;
 	}
 
-	if (!(fr = s->fmt->read(s, whennext))) {
-		return NULL;
+	/* Carry on with the next file of the list once one ends */
+	cur = s->current ? s->current : s;
+	while (!(fr = cur->fmt->read(cur, whennext))) {
+		if (!cur->next) {
+			return NULL;
+		}
+		cur = s->current = cur->next;
 	}
 
 	if (!(new_fr = ast_frisolate(fr))) {
@@ -1093,6 +1939,27 @@ int ast_fileexists(const char *filename, const char *fmt, const char *preflang)
 	return fileexists_core(filename, fmt, preflang, buf, buflen, NULL) ? 1 : 0;
 }
 
+int ast_file_prefetch(const char *filename, const char *preflang)
+{
+	char *buf;
+	int buflen;
+
+	if (!ast_option_prompt_cache_size || !prompts || is_remote_path(filename)) {
+		return -1;
+	}
+
+	if (preflang == NULL) {
+		preflang = "";
+	}
+	buflen = strlen(preflang) + strlen(filename) + 4;	/* room for everything */
+	buf = ast_alloca(buflen);
+	if (!fileexists_core(filename, NULL, preflang, buf, buflen, NULL)) {
+		return -1;
+	}
+
+	return filehelper(buf, NULL, NULL, ACTION_PREFETCH);
+}
+
 int ast_filedelete(const char *filename, const char *fmt)
 {
 	return filehelper(filename, NULL, fmt, ACTION_DELETE);
@@ -1108,13 +1975,59 @@ int ast_filecopy(const char *filename, const char *filename2, const char *fmt)
 	return filehelper(filename, filename2, fmt, ACTION_COPY);
 }
 
+static int __ast_file_read_dirs(const char *path, ast_file_on_file on_file,
+				void *obj, int max_depth);
+
+/*!
+ * \internal
+ * \brief Walk a directory of the sounds tree through its listing in the index
+ */
+static int file_index_read_dirs(const char *path, struct ao2_container *names,
+	ast_file_on_file on_file, void *obj, int max_depth)
+{
+	struct ao2_iterator iter;
+	struct file_index_name *name;
+	int res = 0;
+
+	--max_depth;
+
+	iter = ao2_iterator_init(names, 0);
+	while (!res && (name = ao2_iterator_next(&iter))) {
+		if (!name->is_dir) {
+			res = on_file(path, name->name, obj);
+		} else if (max_depth != 0) {
+			char *full_path;
+
+			if (ast_asprintf(&full_path, "%s/%s", path, name->name) < 0) {
+				res = -1;
+			} else {
+				res = __ast_file_read_dirs(full_path, on_file, obj, max_depth);
+				ast_free(full_path);
+			}
+		}
+		ao2_ref(name, -1);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return res;
+}
+
 static int __ast_file_read_dirs(const char *path, ast_file_on_file on_file,
 				void *obj, int max_depth)
 {
 	DIR *dir;
 	struct dirent *entry;
+	struct ao2_container *names;
+	int absent;
 	int res;
 
+	names = file_index_names(path, &absent);
+	if (names) {
+		res = file_index_read_dirs(path, names, on_file, obj, max_depth);
+		ao2_ref(names, -1);
+		return res;
+	}
+
 	if (!(dir = opendir(path))) {
 		ast_log(LOG_ERROR, "Error opening directory - %s: %s\n",
 			path, strerror(errno));
@@ -1245,12 +2158,90 @@ int ast_file_read_dirs(const char *dir_name, ast_file_on_file on_file, void *obj
 	return res;
 }
 
-int ast_streamfile(struct ast_channel *chan, const char *filename, const char *preflang)
+/*!
+ * \internal
+ * \brief Open a file in the format of a stream to read after it
+ *
+ * \retval 0 if the file was added to the list of the stream
+ * \retval -1 if it does not exist in the format of the stream
+ */
+static int filestream_append(struct ast_filestream *fs, const char *filename, const char *preflang)
 {
+	struct ast_filestream *s;
+	struct ast_filestream *tail;
+	struct file_prompt *prompt = NULL;
+	struct stat st;
+	FILE *bfile = NULL;
+	char *exts;
+	char *ext;
+	char *fn = NULL;
+	char *buf;
+	int buflen;
+
+	if (preflang == NULL) {
+		preflang = "";
+	}
+	buflen = strlen(preflang) + strlen(filename) + 4;
+	buf = ast_alloca(buflen);
+
+	/* Any extension of the format picks the format */
+	exts = ast_strdupa(fs->fmt->exts);
+	ext = strsep(&exts, "|");
+	if (!fileexists_core(filename, ext, preflang, buf, buflen, NULL)) {
+		return -1;
+	}
+
+	exts = ast_strdupa(fs->fmt->exts);
+	while ((ext = strsep(&exts, "|"))) {
+		fn = build_filename(buf, ext);
+		if (fn && !stat(fn, &st) && (bfile = file_prompt_open(fn, &st, &prompt))) {
+			break;
+		}
+		ast_free(fn);
+		fn = NULL;
+	}
+	if (!bfile) {
+		return -1;
+	}
+
+	s = get_filestream(fs->fmt, bfile);
+	if (!s) {
+		fclose(bfile);
+		ao2_cleanup(prompt);
+		ast_free(fn);
+		return -1;
+	}
+	s->prompt = prompt;
+	if (open_wrapper(s)) {
+		ast_closestream(s);
+		ast_free(fn);
+		return -1;
+	}
+	ast_free(fn);
+	s->lasttimeout = -1;
+
+	for (tail = fs; tail->next; tail = tail->next) {
+	}
+	tail->next = s;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Stream a file, reading the files following it in its format after it
+ *
+ * \return the number of files in the stream
+ * \retval -1 on failure
+ */
+static int streamfile_list(struct ast_channel *chan, const char * const *filenames, int count, const char *preflang)
+{
+	const char *filename = filenames[0];
 	struct ast_filestream *fs;
 	struct ast_filestream *vfs=NULL;
 	off_t pos;
 	int seekattempt;
+	int streamed = 1;
 	int res;
 
 	fs = ast_openstream(chan, filename, preflang);
@@ -1271,7 +2262,7 @@ int ast_streamfile(struct ast_channel *chan, const char *filename, const char *p
 	if (seekattempt) {
 		if (errno == EINVAL) {
 			/* Zero-length file, as opposed to a pipe */
-			return 0;
+			return streamed;
 		} else {
 			ast_seekstream(fs, 0, SEEK_SET);
 		}
@@ -1282,6 +2273,10 @@ int ast_streamfile(struct ast_channel *chan, const char *filename, const char *p
 	vfs = ast_openvstream(chan, filename, preflang);
 	if (vfs) {
 		ast_debug(1, "Ooh, found a video stream, too, format %s\n", ast_format_get_name(vfs->fmt->format));
+	} else {
+		while (streamed < count && !filestream_append(fs, filenames[streamed], preflang)) {
+			++streamed;
+		}
 	}
 
 	if (ast_test_flag(ast_channel_flags(chan), AST_FLAG_MASQ_NOSTREAM))
@@ -1298,10 +2293,27 @@ int ast_streamfile(struct ast_channel *chan, const char *filename, const char *p
 	if (VERBOSITY_ATLEAST(3)) {
 		ast_channel_lock(chan);
 		ast_verb(3, "<%s> Playing '%s.%s' (language '%s')\n", ast_channel_name(chan), filename, ast_format_get_name(ast_channel_writeformat(chan)), preflang ? preflang : "default");
+		if (streamed > 1) {
+			ast_verb(3, "<%s> Followed by %d more files\n", ast_channel_name(chan), streamed - 1);
+		}
 		ast_channel_unlock(chan);
 	}
 
-	return res;
+	return res ? -1 : streamed;
+}
+
+int ast_streamfile(struct ast_channel *chan, const char *filename, const char *preflang)
+{
+	return streamfile_list(chan, &filename, 1, preflang) < 0 ? -1 : 0;
+}
+
+int ast_streamfile_list(struct ast_channel *chan, const char * const *filenames, int count, const char *preflang)
+{
+	if (count < 1) {
+		return -1;
+	}
+
+	return streamfile_list(chan, filenames, count, preflang);
 }
 
 struct ast_filestream *ast_readfile(const char *filename, const char *type, const char *comment, int flags, int check, mode_t mode)
@@ -1932,6 +2944,45 @@ static char *handle_cli_core_show_file_formats(struct ast_cli_entry *e, int cmd,
 #undef FORMAT2
 }
 
+static char *handle_cli_core_show_file_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int files;
+	size_t size;
+	unsigned int hits = prompt_hits;
+	unsigned int misses = prompt_misses;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show file cache";
+		e->usage =
+			"Usage: core show file cache\n"
+			"       Displays how many sound files are played from memory.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!ast_option_prompt_cache_size) {
+		ast_cli(a->fd, "The prompt cache is disabled, see prompt_cache_size in asterisk.conf.\n");
+	}
+
+	ao2_lock(prompts);
+	files = ao2_container_count(prompts);
+	size = prompts_size;
+	ao2_unlock(prompts);
+
+	ast_cli(a->fd, "Files cached: %d (%zu of %u KB)\n", files, size / 1024,
+		ast_option_prompt_cache_size * 1024);
+	ast_cli(a->fd, "Hits: %u, misses: %u, ratio: %.1f%%\n", hits, misses,
+		hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+
+	return CLI_SUCCESS;
+}
+
 struct ast_format *ast_get_format_for_file_ext(const char *file_ext)
 {
 	struct ast_format_def *f;
@@ -1967,12 +3018,26 @@ int ast_get_extension_for_mime_type(const char *mime_type, char *buffer, size_t
 }
 
 static struct ast_cli_entry cli_file[] = {
-	AST_CLI_DEFINE(handle_cli_core_show_file_formats, "Displays file formats")
+	AST_CLI_DEFINE(handle_cli_core_show_file_formats, "Displays file formats"),
+	AST_CLI_DEFINE(handle_cli_core_show_file_cache, "Displays the prompt cache"),
 };
 
 static void file_shutdown(void)
 {
 	ast_cli_unregister_multiple(cli_file, ARRAY_LEN(cli_file));
+	ao2_cleanup(prompts);
+	prompts = NULL;
+	variants_tps = ast_taskprocessor_unreference(variants_tps);
+	ao2_cleanup(variants);
+	variants = NULL;
+	if (index_fd >= 0) {
+		close(index_fd);
+		index_fd = -1;
+	}
+	ao2_cleanup(index_dirs);
+	index_dirs = NULL;
+	ast_free(index_root);
+	index_root = NULL;
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_unregister_type);
 }
@@ -1981,6 +3046,25 @@ int ast_file_init(void)
 {
 	STASIS_MESSAGE_TYPE_INIT(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_INIT(ast_format_unregister_type);
+	prompts = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, PROMPT_BUCKETS,
+		file_prompt_hash_fn, NULL, file_prompt_cmp_fn);
+	variants = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, VARIANT_BUCKETS,
+		file_variant_hash_fn, NULL, file_variant_cmp_fn);
+	if (!prompts || !variants) {
+		return -1;
+	}
+	index_dirs = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, INDEX_DIR_BUCKETS,
+		file_index_dir_hash_fn, NULL, file_index_dir_cmp_fn);
+	if (!index_dirs || ast_asprintf(&index_root, "%s/sounds", ast_config_AST_DATA_DIR) < 0) {
+		return -1;
+	}
+#ifdef HAVE_INOTIFY
+	index_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (index_fd < 0) {
+		ast_log(LOG_NOTICE, "Unable to watch the sounds directory, looking up every file: %s\n",
+			strerror(errno));
+	}
+#endif
 	ast_cli_register_multiple(cli_file, ARRAY_LEN(cli_file));
 	ast_register_cleanup(file_shutdown);
 	return 0;
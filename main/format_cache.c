@@ -369,7 +369,8 @@ static void format_cache_shutdown(void)
 
 int ast_format_cache_init(void)
 {
-	formats = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, CACHE_BUCKETS,
+	formats = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, CACHE_BUCKETS,
 		format_hash_cb, NULL, format_cmp_cb);
 	if (!formats) {
 		return -1;
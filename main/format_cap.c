@@ -50,6 +50,12 @@ struct format_cap_framed {
 	AST_LIST_ENTRY(format_cap_framed) entry;
 };
 
+/*! \brief Codec identifiers kept in the bitmap of a capabilities structure */
+#define FORMAT_CAP_CODECS_BITMAP 256
+
+/*! \brief Words of the bitmap of a capabilities structure */
+#define FORMAT_CAP_CODECS_WORDS (FORMAT_CAP_CODECS_BITMAP / 64)
+
 /*! \brief Format capabilities structure, holds formats + preference order + etc */
 struct ast_format_cap {
 	/*! \brief Vector of formats, indexed using the codec identifier */
@@ -58,6 +64,10 @@ struct ast_format_cap {
 	AST_VECTOR(, struct format_cap_framed *) preference_order;
 	/*! \brief Global framing size, applies to all formats if no framing present on format */
 	unsigned int framing;
+	/*! \brief Bitmap of the codec identifiers of the formats, to tell quickly whether capabilities can match */
+	uint64_t codecs[FORMAT_CAP_CODECS_WORDS];
+	/*! \brief Number of formats whose codec identifier is beyond the bitmap */
+	unsigned int codecs_beyond;
 };
 
 /*! \brief Linked list for formats */
@@ -66,6 +76,68 @@ AST_LIST_HEAD_NOLOCK(format_cap_framed_list, format_cap_framed);
 /*! \brief Dummy empty list for when we are inserting a new list */
 static const struct format_cap_framed_list format_cap_framed_list_empty = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
 
+/*! \brief Note that the capabilities have, or no longer have, a format of a codec */
+static inline void format_cap_codec_set(struct ast_format_cap *cap, unsigned int id, int present)
+{
+	if (id >= FORMAT_CAP_CODECS_BITMAP) {
+		if (present) {
+			++cap->codecs_beyond;
+		} else {
+			--cap->codecs_beyond;
+		}
+	} else if (present) {
+		cap->codecs[id / 64] |= UINT64_C(1) << (id % 64);
+	} else {
+		cap->codecs[id / 64] &= ~(UINT64_C(1) << (id % 64));
+	}
+}
+
+/*! \brief Determine if the capabilities have a format of a codec */
+static inline int format_cap_codec_test(const struct ast_format_cap *cap, unsigned int id)
+{
+	if (id >= FORMAT_CAP_CODECS_BITMAP) {
+		return id < AST_VECTOR_SIZE(&cap->formats)
+			&& !AST_LIST_EMPTY(AST_VECTOR_GET_ADDR(&cap->formats, id));
+	}
+
+	return (cap->codecs[id / 64] >> (id % 64)) & 1;
+}
+
+/*!
+ * \brief Determine if two capabilities may have a compatible format
+ *
+ * \retval 0 if no codec is in both, so that no format is compatible
+ * \retval 1 if formats are to be compared
+ */
+static int format_cap_codecs_intersect(const struct ast_format_cap *cap1, const struct ast_format_cap *cap2)
+{
+	int word;
+
+	if (cap1->codecs_beyond && cap2->codecs_beyond) {
+		return 1;
+	}
+
+	for (word = 0; word < FORMAT_CAP_CODECS_WORDS; ++word) {
+		if (cap1->codecs[word] & cap2->codecs[word]) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Determine if two capabilities have formats of the same codecs
+ *
+ * \retval 0 if a codec is only in one of them
+ * \retval 1 if formats are to be compared
+ */
+static int format_cap_codecs_equal(const struct ast_format_cap *cap1, const struct ast_format_cap *cap2)
+{
+	return cap1->codecs_beyond == cap2->codecs_beyond
+		&& !memcmp(cap1->codecs, cap2->codecs, sizeof(cap1->codecs));
+}
+
 /*! \brief Destructor for format capabilities structure */
 static void format_cap_destroy(void *obj)
 {
@@ -168,6 +240,9 @@ static inline int format_cap_framed_init(struct format_cap_framed *framed, struc
 
 	/* Order doesn't matter for formats, so insert at the head for performance reasons */
 	ao2_ref(framed, +1);
+	if (AST_LIST_EMPTY(list)) {
+		format_cap_codec_set(cap, ast_format_get_codec_id(format), 1);
+	}
 	AST_LIST_INSERT_HEAD(list, framed, entry);
 
 	cap->framing = MIN(cap->framing, framing ? framing : ast_format_get_default_ms(format));
@@ -178,18 +253,7 @@ static inline int format_cap_framed_init(struct format_cap_framed *framed, struc
 /*! \internal \brief Determine if \c format is in \c cap */
 static int format_in_format_cap(struct ast_format_cap *cap, struct ast_format *format)
 {
-	struct format_cap_framed *framed;
-	int i;
-
-	for (i = 0; i < AST_VECTOR_SIZE(&cap->preference_order); i++) {
-		framed = AST_VECTOR_GET(&cap->preference_order, i);
-
-		if (ast_format_get_codec_id(format) == ast_format_get_codec_id(framed->format)) {
-			return 1;
-		}
-	}
-
-	return 0;
+	return format_cap_codec_test(cap, ast_format_get_codec_id(format));
 }
 
 int __ast_format_cap_append(struct ast_format_cap *cap, struct ast_format *format, unsigned int framing, const char *tag, const char *file, int line, const char *func)
@@ -290,6 +354,10 @@ static int format_cap_replace(struct ast_format_cap *cap, struct ast_format *for
 
 	ast_assert(format != NULL);
 
+	if (!format_cap_codec_test(cap, ast_format_get_codec_id(format))) {
+		return -1;
+	}
+
 	for (i = 0; i < AST_VECTOR_SIZE(&cap->preference_order); i++) {
 		framed = AST_VECTOR_GET(&cap->preference_order, i);
 
@@ -514,6 +582,9 @@ int ast_format_cap_remove(struct ast_format_cap *cap, struct ast_format *format)
 
 		AST_LIST_REMOVE_CURRENT(entry);
 		FORMAT_CAP_FRAMED_ELEM_CLEANUP(framed);
+		if (AST_LIST_EMPTY(list)) {
+			format_cap_codec_set(cap, ast_format_get_codec_id(format), 0);
+		}
 		break;
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
@@ -540,6 +611,9 @@ void ast_format_cap_remove_by_type(struct ast_format_cap *cap, enum ast_media_ty
 			AST_VECTOR_REMOVE_CMP_ORDERED(&cap->preference_order, framed->format,
 				FORMAT_CAP_FRAMED_ELEM_CMP, FORMAT_CAP_FRAMED_ELEM_CLEANUP);
 			ao2_ref(framed, -1);
+			if (AST_LIST_EMPTY(list)) {
+				format_cap_codec_set(cap, idx, 0);
+			}
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
 	}
@@ -632,10 +706,18 @@ int ast_format_cap_get_compatible(const struct ast_format_cap *cap1, const struc
 {
 	int idx, res = 0;
 
+	if (!format_cap_codecs_intersect(cap1, cap2)) {
+		return 0;
+	}
+
 	for (idx = 0; idx < AST_VECTOR_SIZE(&cap1->preference_order); ++idx) {
 		struct format_cap_framed *framed = AST_VECTOR_GET(&cap1->preference_order, idx);
 		struct ast_format *format;
 
+		if (!format_cap_codec_test(cap2, ast_format_get_codec_id(framed->format))) {
+			continue;
+		}
+
 		format = ast_format_cap_get_compatible_format(cap2, framed->format);
 		if (!format) {
 			continue;
@@ -656,9 +738,17 @@ int ast_format_cap_iscompatible(const struct ast_format_cap *cap1, const struct
 {
 	int idx;
 
+	if (!format_cap_codecs_intersect(cap1, cap2)) {
+		return 0;
+	}
+
 	for (idx = 0; idx < AST_VECTOR_SIZE(&cap1->preference_order); ++idx) {
 		struct format_cap_framed *framed = AST_VECTOR_GET(&cap1->preference_order, idx);
 
+		if (!format_cap_codec_test(cap2, ast_format_get_codec_id(framed->format))) {
+			continue;
+		}
+
 		if (ast_format_cap_iscompatible_format(cap2, framed->format) != AST_FORMAT_CMP_NOT_EQUAL) {
 			return 1;
 		}
@@ -688,10 +778,18 @@ static int internal_format_cap_identical(const struct ast_format_cap *cap1, cons
 
 int ast_format_cap_identical(const struct ast_format_cap *cap1, const struct ast_format_cap *cap2)
 {
+	if (cap1 == cap2) {
+		return 1;
+	}
+
 	if (AST_VECTOR_SIZE(&cap1->preference_order) != AST_VECTOR_SIZE(&cap2->preference_order)) {
 		return 0; /* if they are not the same size, they are not identical */
 	}
 
+	if (!format_cap_codecs_equal(cap1, cap2)) {
+		return 0; /* if they are not of the same codecs, they are not identical */
+	}
+
 	if (!internal_format_cap_identical(cap1, cap2)) {
 		return 0;
 	}
@@ -74,6 +74,222 @@ struct ast_frame_cache {
 };
 #endif
 
+/*!
+ * \brief Frame payload pool size classes
+ *
+ * Each class holds AST_FRIENDLY_OFFSET plus 20ms of signed linear
+ * audio at 8, 16, 32 and 48kHz, or 20ms of ulaw at 8kHz.
+ */
+static const size_t frame_payload_sizes[] = {
+	160 + AST_FRIENDLY_OFFSET,
+	320 + AST_FRIENDLY_OFFSET,
+	640 + AST_FRIENDLY_OFFSET,
+	1280 + AST_FRIENDLY_OFFSET,
+	1920 + AST_FRIENDLY_OFFSET,
+};
+
+#define FRAME_PAYLOAD_CLASSES	ARRAY_LEN(frame_payload_sizes)
+
+/*! \brief Size class of payload buffers too large for the pool */
+#define FRAME_PAYLOAD_HEAP	FRAME_PAYLOAD_CLASSES
+
+/*! \brief Header in front of every frame payload buffer */
+struct frame_payload {
+	/*! Next buffer in the per-thread cache */
+	struct frame_payload *next;
+	/*! Size class of the buffer or FRAME_PAYLOAD_HEAP */
+	unsigned int size_class;
+	/*! Number of frames sharing the buffer (See ast_frame_share()) */
+	volatile int refs;
+	/*! The data translated by one of the sharing frames (See ast_frame_shared_translation_set()) */
+	struct ast_frame *translation;
+	/*! The buffer handed out */
+	unsigned char buf[0] __attribute__((aligned(16)));
+};
+
+#if !defined(NO_FRAME_CACHE)
+/*!
+ * \brief Maximum number of payload buffers cached per size class and thread
+ *
+ * As with the frame header cache, the thread freeing a buffer keeps it
+ * so a thread that only frees frames stops caching at this limit.
+ */
+#define FRAME_PAYLOAD_CACHE_MAX	16
+
+/*! \brief Frame payload pool counters */
+struct frame_payload_stats {
+	/*! Allocations satisfied from the cache */
+	uint64_t hits[FRAME_PAYLOAD_CLASSES + 1];
+	/*! Allocations satisfied from the heap */
+	uint64_t misses[FRAME_PAYLOAD_CLASSES + 1];
+	/*! Releases kept in the cache */
+	uint64_t cached[FRAME_PAYLOAD_CLASSES + 1];
+	/*! Releases returned to the heap */
+	uint64_t released[FRAME_PAYLOAD_CLASSES + 1];
+};
+
+/*! \brief A per-thread cache of frame payload buffers */
+struct frame_payload_cache {
+	/*! Cached buffers of each size class */
+	struct frame_payload *head[FRAME_PAYLOAD_CLASSES];
+	/*! Number of cached buffers of each size class */
+	unsigned int count[FRAME_PAYLOAD_CLASSES];
+	/*! Counters of this thread */
+	struct frame_payload_stats stats;
+	AST_LIST_ENTRY(frame_payload_cache) list;
+};
+
+static int frame_payload_cache_init(void *data);
+static void frame_payload_cache_cleanup(void *data);
+
+AST_THREADSTORAGE_CUSTOM(frame_payload_cache, frame_payload_cache_init, frame_payload_cache_cleanup);
+
+/*! \brief Caches of all threads, for the counters */
+static AST_LIST_HEAD_STATIC(frame_payload_caches, frame_payload_cache);
+
+/*! \brief Counters of exited threads (Protected by the frame_payload_caches lock) */
+static struct frame_payload_stats frame_payload_retired;
+
+static void frame_payload_stats_add(struct frame_payload_stats *sum,
+	const struct frame_payload_stats *stats)
+{
+	int idx;
+
+	for (idx = 0; idx <= FRAME_PAYLOAD_CLASSES; ++idx) {
+		sum->hits[idx] += stats->hits[idx];
+		sum->misses[idx] += stats->misses[idx];
+		sum->cached[idx] += stats->cached[idx];
+		sum->released[idx] += stats->released[idx];
+	}
+}
+
+static int frame_payload_cache_init(void *data)
+{
+	struct frame_payload_cache *cache = data;
+
+	AST_LIST_LOCK(&frame_payload_caches);
+	AST_LIST_INSERT_TAIL(&frame_payload_caches, cache, list);
+	AST_LIST_UNLOCK(&frame_payload_caches);
+
+	return 0;
+}
+
+static void frame_payload_cache_cleanup(void *data)
+{
+	struct frame_payload_cache *cache = data;
+	struct frame_payload *payload;
+	int idx;
+
+	AST_LIST_LOCK(&frame_payload_caches);
+	AST_LIST_REMOVE(&frame_payload_caches, cache, list);
+	frame_payload_stats_add(&frame_payload_retired, &cache->stats);
+	AST_LIST_UNLOCK(&frame_payload_caches);
+
+	for (idx = 0; idx < FRAME_PAYLOAD_CLASSES; ++idx) {
+		while ((payload = cache->head[idx])) {
+			cache->head[idx] = payload->next;
+			ast_free(payload);
+		}
+	}
+
+	ast_free(cache);
+}
+#endif
+
+static unsigned int frame_payload_class(size_t size)
+{
+	unsigned int size_class;
+
+	for (size_class = 0; size_class < FRAME_PAYLOAD_CLASSES; ++size_class) {
+		if (size <= frame_payload_sizes[size_class]) {
+			break;
+		}
+	}
+	return size_class;
+}
+
+void *__ast_frame_payload_alloc(size_t size, const char *file, int line, const char *func)
+{
+	struct frame_payload *payload;
+	unsigned int size_class;
+
+#if !defined(NO_FRAME_CACHE)
+	struct frame_payload_cache *cache;
+#endif
+
+	size_class = frame_payload_class(size);
+
+#if !defined(NO_FRAME_CACHE)
+	if ((cache = ast_threadstorage_get(&frame_payload_cache, sizeof(*cache)))) {
+		if (size_class != FRAME_PAYLOAD_HEAP && (payload = cache->head[size_class])) {
+			cache->head[size_class] = payload->next;
+			cache->count[size_class]--;
+			cache->stats.hits[size_class]++;
+			payload->refs = 1;
+			payload->translation = NULL;
+			return payload->buf;
+		}
+		cache->stats.misses[size_class]++;
+	}
+#endif
+
+	payload = __ast_malloc(sizeof(*payload)
+		+ (size_class == FRAME_PAYLOAD_HEAP ? size : frame_payload_sizes[size_class]),
+		file, line, func);
+	if (!payload) {
+		return NULL;
+	}
+	payload->size_class = size_class;
+	payload->refs = 1;
+	payload->translation = NULL;
+
+	return payload->buf;
+}
+
+static struct frame_payload *frame_payload_from_buf(void *buf)
+{
+	return (struct frame_payload *) ((unsigned char *) buf - offsetof(struct frame_payload, buf));
+}
+
+void ast_frame_payload_free(void *buf)
+{
+	struct frame_payload *payload;
+
+#if !defined(NO_FRAME_CACHE)
+	struct frame_payload_cache *cache;
+#endif
+
+	if (!buf) {
+		return;
+	}
+	payload = frame_payload_from_buf(buf);
+	if (!ast_atomic_dec_and_test(&payload->refs)) {
+		/* Other frames still share the buffer. */
+		return;
+	}
+	if (payload->translation) {
+		ast_frfree(payload->translation);
+		payload->translation = NULL;
+	}
+
+#if !defined(NO_FRAME_CACHE)
+	if ((cache = ast_threadstorage_get(&frame_payload_cache, sizeof(*cache)))) {
+		if (payload->size_class != FRAME_PAYLOAD_HEAP
+			&& cache->count[payload->size_class] < FRAME_PAYLOAD_CACHE_MAX
+			&& ast_opt_cache_media_frames) {
+			payload->next = cache->head[payload->size_class];
+			cache->head[payload->size_class] = payload;
+			cache->count[payload->size_class]++;
+			cache->stats.cached[payload->size_class]++;
+			return;
+		}
+		cache->stats.released[payload->size_class]++;
+	}
+#endif
+
+	ast_free(payload);
+}
+
 struct ast_frame ast_null_frame = { AST_FRAME_NULL, };
 
 static struct ast_frame *ast_frame_header_new(const char *file, int line, const char *func)
@@ -122,6 +338,15 @@ static void __frame_free(struct ast_frame *fr, int cache)
 	if (!fr->mallocd)
 		return;
 
+	if (fr->mallocd & AST_MALLOCD_PAYLOAD) {
+		/* Return pooled data first so the header alone can be cached. */
+		if (fr->data.ptr) {
+			ast_frame_payload_free(fr->data.ptr - fr->offset);
+			fr->data.ptr = NULL;
+		}
+		fr->mallocd &= ~(AST_MALLOCD_DATA | AST_MALLOCD_PAYLOAD);
+	}
+
 #if !defined(NO_FRAME_CACHE)
 	if (fr->mallocd == AST_MALLOCD_HDR
 		&& cache
@@ -229,6 +454,7 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 			out->seqno = fr->seqno;
 		}
 		out->stream_num = fr->stream_num;
+		out->ingress = fr->ingress;
 	} else {
 		out = fr;
 	}
@@ -271,7 +497,7 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 		 * Duplicate the data buffer and put it into the isolated frame
 		 * which may also be the original frame.
 		 */
-		newdata = ast_malloc(fr->datalen + AST_FRIENDLY_OFFSET);
+		newdata = __ast_frame_payload_alloc(fr->datalen + AST_FRIENDLY_OFFSET, file, line, func);
 		if (!newdata) {
 			if (out != fr) {
 				ast_frame_free(out, 0);
@@ -282,23 +508,33 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 		out->offset = AST_FRIENDLY_OFFSET;
 		memcpy(newdata, fr->data.ptr, fr->datalen);
 		out->data.ptr = newdata;
-		out->mallocd |= AST_MALLOCD_DATA;
+		out->mallocd |= AST_MALLOCD_DATA | AST_MALLOCD_PAYLOAD;
 	} else if (out != fr) {
 		/* Steal the data buffer from the original frame. */
 		out->data = fr->data;
 		memset(&fr->data, 0, sizeof(fr->data));
-		fr->mallocd &= ~AST_MALLOCD_DATA;
-		out->mallocd |= AST_MALLOCD_DATA;
+		out->mallocd |= fr->mallocd & (AST_MALLOCD_DATA | AST_MALLOCD_PAYLOAD);
+		fr->mallocd &= ~(AST_MALLOCD_DATA | AST_MALLOCD_PAYLOAD);
 	}
 
 	return out;
 }
 
-struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int line, const char *func)
+/*!
+ * \internal
+ * \brief Copy a frame
+ *
+ * \param f Frame to copy.
+ * \param pooled Put any data in a payload pool buffer regardless of its size.
+ */
+static struct ast_frame *frame_dup(const struct ast_frame *f, int pooled,
+	const char *file, int line, const char *func)
 {
 	struct ast_frame *out = NULL;
 	int len, srclen = 0;
 	void *buf = NULL;
+	/* Where the data goes, AST_FRIENDLY_OFFSET into the data buffer */
+	void *data = NULL;
 
 #if !defined(NO_FRAME_CACHE)
 	struct ast_frame_cache *frames;
@@ -316,8 +552,29 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	if (srclen > 0)
 		len += srclen + 1;
 
+	if ((f->datalen || f->frametype == AST_FRAME_TEXT)
+		&& (pooled
 #if !defined(NO_FRAME_CACHE)
-	if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
+			|| len - sizeof(*out) <= frame_payload_sizes[FRAME_PAYLOAD_CLASSES - 1]
+#endif
+		)) {
+		/*
+		 * Take the header from the frame cache and put the data and
+		 * source in a payload pool buffer.  Both are then recycled
+		 * independent of the data size.
+		 */
+		if (!(buf = __ast_frame_payload_alloc(len - sizeof(*out), file, line, func))) {
+			return NULL;
+		}
+		if (!(out = ast_frame_header_new(file, line, func))) {
+			ast_frame_payload_free(buf);
+			return NULL;
+		}
+		out->mallocd = AST_MALLOCD_HDR | AST_MALLOCD_DATA | AST_MALLOCD_PAYLOAD;
+		data = buf + AST_FRIENDLY_OFFSET;
+	}
+#if !defined(NO_FRAME_CACHE)
+	if (!out && (frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
 		AST_LIST_TRAVERSE_SAFE_BEGIN(&frames->list, out, frame_list) {
 			if (out->mallocd_hdr_len >= len) {
 				size_t mallocd_len = out->mallocd_hdr_len;
@@ -334,12 +591,23 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	}
 #endif
 
-	if (!buf) {
+	if (!out) {
 		if (!(buf = __ast_calloc(1, len, file, line, func)))
 			return NULL;
 		out = buf;
 		out->mallocd_hdr_len = len;
 	}
+	if (!data) {
+		/* Even though this new frame was allocated from the heap, we can't mark it
+		 * with AST_MALLOCD_HDR, AST_MALLOCD_DATA and AST_MALLOCD_SRC, because that
+		 * would cause ast_frfree() to attempt to individually free each of those
+		 * under the assumption that they were separately allocated. Since this frame
+		 * was allocated in a single allocation, we'll only mark it as if the header
+		 * was heap-allocated; this will result in the entire frame being properly freed.
+		 */
+		out->mallocd = AST_MALLOCD_HDR;
+		data = buf + sizeof(*out) + AST_FRIENDLY_OFFSET;
+	}
 
 	out->frametype = f->frametype;
 	out->subclass = f->subclass;
@@ -350,18 +618,10 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	out->datalen = f->datalen;
 	out->samples = f->samples;
 	out->delivery = f->delivery;
-	/* Even though this new frame was allocated from the heap, we can't mark it
-	 * with AST_MALLOCD_HDR, AST_MALLOCD_DATA and AST_MALLOCD_SRC, because that
-	 * would cause ast_frfree() to attempt to individually free each of those
-	 * under the assumption that they were separately allocated. Since this frame
-	 * was allocated in a single allocation, we'll only mark it as if the header
-	 * was heap-allocated; this will result in the entire frame being properly freed.
-	 */
-	out->mallocd = AST_MALLOCD_HDR;
 	out->offset = AST_FRIENDLY_OFFSET;
 	/* Make sure that empty text frames have a valid data.ptr */
 	if (out->datalen || f->frametype == AST_FRAME_TEXT) {
-		out->data.ptr = buf + sizeof(*out) + AST_FRIENDLY_OFFSET;
+		out->data.ptr = data;
 		memcpy(out->data.ptr, f->data.ptr, out->datalen);
 	} else {
 		out->data.uint32 = f->data.uint32;
@@ -369,7 +629,7 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	if (srclen > 0) {
 		/* This may seem a little strange, but it's to avoid a gcc (4.2.4) compiler warning */
 		char *src;
-		out->src = buf + sizeof(*out) + AST_FRIENDLY_OFFSET + f->datalen;
+		out->src = data + f->datalen;
 		src = (char *) out->src;
 		/* Must have space since we allocated for it */
 		strcpy(src, f->src);
@@ -379,9 +639,168 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	out->len = f->len;
 	out->seqno = f->seqno;
 	out->stream_num = f->stream_num;
+	out->ingress = f->ingress;
 	return out;
 }
 
+struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int line, const char *func)
+{
+	return frame_dup(f, 0, file, line, func);
+}
+
+struct ast_frame *__ast_frame_share(const struct ast_frame *f, const char *file, int line, const char *func)
+{
+	struct ast_frame *out;
+	struct frame_payload *payload;
+
+	if (!(f->mallocd & AST_MALLOCD_PAYLOAD) || !f->data.ptr) {
+		/* Nothing to share yet.  Make a copy that can be shared. */
+		return frame_dup(f, 1, file, line, func);
+	}
+
+	if (!(out = ast_frame_header_new(file, line, func))) {
+		return NULL;
+	}
+	out->mallocd = AST_MALLOCD_HDR;
+
+	out->frametype = f->frametype;
+	out->subclass = f->subclass;
+	if ((f->frametype == AST_FRAME_VOICE) || (f->frametype == AST_FRAME_VIDEO) ||
+		(f->frametype == AST_FRAME_IMAGE)) {
+		ao2_bump(out->subclass.format);
+	}
+	if (f->src) {
+		if (f->src == (char *) f->data.ptr + f->datalen) {
+			/* The source string lives in the payload buffer as laid out by ast_frdup(). */
+			out->src = f->src;
+		} else if (!(out->src = ast_strdup(f->src))) {
+			ast_frame_free(out, 0);
+			return NULL;
+		} else {
+			out->mallocd |= AST_MALLOCD_SRC;
+		}
+	}
+
+	payload = frame_payload_from_buf(f->data.ptr - f->offset);
+	ast_atomic_fetchadd_int(&payload->refs, +1);
+	out->data.ptr = f->data.ptr;
+	out->offset = f->offset;
+	out->mallocd |= AST_MALLOCD_DATA | AST_MALLOCD_PAYLOAD;
+
+	out->datalen = f->datalen;
+	out->samples = f->samples;
+	out->delivery = f->delivery;
+	ast_copy_flags(out, f, AST_FLAGS_ALL);
+	out->ts = f->ts;
+	out->len = f->len;
+	out->seqno = f->seqno;
+	out->stream_num = f->stream_num;
+	out->ingress = f->ingress;
+	return out;
+}
+
+int ast_frame_is_shared(const struct ast_frame *f)
+{
+	if (!(f->mallocd & AST_MALLOCD_PAYLOAD) || !f->data.ptr) {
+		return 0;
+	}
+
+	return ast_atomic_load_n(&frame_payload_from_buf(f->data.ptr - f->offset)->refs,
+		__ATOMIC_ACQUIRE) > 1;
+}
+
+/*!
+ * \brief Serializes attaching translations to shared payload buffers
+ *
+ * \note Readers only need an atomic load since a translation is never
+ * replaced once attached.
+ */
+AST_MUTEX_DEFINE_STATIC(frame_translation_lock);
+
+struct ast_frame *ast_frame_shared_translation_get(const struct ast_frame *f, struct ast_format *format)
+{
+	struct ast_frame *translation;
+
+	if (!(f->mallocd & AST_MALLOCD_PAYLOAD) || !f->data.ptr) {
+		return NULL;
+	}
+
+	/* The translation lives as long as the payload we hold a reference to. */
+	translation = ast_atomic_load_n(&frame_payload_from_buf(f->data.ptr - f->offset)->translation,
+		__ATOMIC_ACQUIRE);
+	if (!translation
+		|| ast_format_cmp(translation->subclass.format, format) != AST_FORMAT_CMP_EQUAL) {
+		return NULL;
+	}
+
+	return ast_frame_share(translation);
+}
+
+int ast_frame_shared_translation_set(const struct ast_frame *f, const struct ast_frame *translation)
+{
+	struct frame_payload *payload;
+	struct ast_frame *shared;
+
+	if (!ast_frame_is_shared(f)
+		|| translation->frametype != AST_FRAME_VOICE
+		|| !translation->datalen
+		|| AST_LIST_NEXT(translation, frame_list)) {
+		return -1;
+	}
+
+	payload = frame_payload_from_buf(f->data.ptr - f->offset);
+	if (ast_atomic_load_n(&payload->translation, __ATOMIC_ACQUIRE)) {
+		/* Another frame got there first. */
+		return -1;
+	}
+
+	if (!(shared = ast_frame_share(translation))) {
+		return -1;
+	}
+
+	ast_mutex_lock(&frame_translation_lock);
+	if (payload->translation) {
+		ast_mutex_unlock(&frame_translation_lock);
+		ast_frfree(shared);
+		return -1;
+	}
+	ast_atomic_store_n(&payload->translation, shared, __ATOMIC_RELEASE);
+	ast_mutex_unlock(&frame_translation_lock);
+
+	return 0;
+}
+
+int __ast_frame_unshare(struct ast_frame *f, const char *file, int line, const char *func)
+{
+	unsigned char *old;
+	unsigned char *buf;
+	size_t len;
+	int src_in_buf;
+
+	if (!ast_frame_is_shared(f)) {
+		return 0;
+	}
+
+	old = (unsigned char *) f->data.ptr - f->offset;
+	len = f->offset + f->datalen;
+	src_in_buf = f->src && f->src == (char *) f->data.ptr + f->datalen;
+	if (src_in_buf) {
+		len += strlen(f->src) + 1;
+	}
+
+	if (!(buf = __ast_frame_payload_alloc(len, file, line, func))) {
+		return -1;
+	}
+	memcpy(buf, old, len);
+
+	f->data.ptr = buf + f->offset;
+	if (src_in_buf) {
+		f->src = (char *) f->data.ptr + f->datalen;
+	}
+	ast_frame_payload_free(old);
+	return 0;
+}
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples)
 {
 	int i;
@@ -739,3 +1158,81 @@ int ast_frame_clear(struct ast_frame *frame)
 	}
 	return 0;
 }
+
+#if !defined(NO_FRAME_CACHE)
+static char *handle_cli_show_frame_pool(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT  "%-8s %8s %12s %12s %12s %12s\n"
+#define FORMAT2 "%-8s %8u %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n"
+	struct frame_payload_stats totals;
+	unsigned int cached[FRAME_PAYLOAD_CLASSES + 1] = { 0, };
+	struct frame_payload_cache *cache;
+	int threads = 0;
+	int idx;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show frame pool";
+		e->usage =
+			"Usage: core show frame pool\n"
+			"       Displays the frame payload pool size classes and\n"
+			"       how often allocations were satisfied from it.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	AST_LIST_LOCK(&frame_payload_caches);
+	totals = frame_payload_retired;
+	AST_LIST_TRAVERSE(&frame_payload_caches, cache, list) {
+		frame_payload_stats_add(&totals, &cache->stats);
+		for (idx = 0; idx < FRAME_PAYLOAD_CLASSES; ++idx) {
+			cached[idx] += cache->count[idx];
+		}
+		++threads;
+	}
+	AST_LIST_UNLOCK(&frame_payload_caches);
+
+	ast_cli(a->fd, "Frame payload pool of %d threads%s\n\n", threads,
+		ast_opt_cache_media_frames ? "" : " (caching disabled)");
+	ast_cli(a->fd, FORMAT, "Size", "Cached", "Hits", "Misses", "Kept", "Released");
+	for (idx = 0; idx <= FRAME_PAYLOAD_CLASSES; ++idx) {
+		char size[16];
+
+		if (idx == FRAME_PAYLOAD_HEAP) {
+			ast_copy_string(size, "Larger", sizeof(size));
+		} else {
+			snprintf(size, sizeof(size), "%zu", frame_payload_sizes[idx]);
+		}
+		ast_cli(a->fd, FORMAT2, size, cached[idx], totals.hits[idx],
+			totals.misses[idx], totals.cached[idx], totals.released[idx]);
+	}
+
+	return CLI_SUCCESS;
+#undef FORMAT
+#undef FORMAT2
+}
+
+static struct ast_cli_entry frame_cli[] = {
+	AST_CLI_DEFINE(handle_cli_show_frame_pool, "Displays frame payload pool statistics"),
+};
+
+static void frame_shutdown(void)
+{
+	ast_cli_unregister_multiple(frame_cli, ARRAY_LEN(frame_cli));
+}
+#endif
+
+int ast_frame_init(void)
+{
+#if !defined(NO_FRAME_CACHE)
+	ast_cli_register_multiple(frame_cli, ARRAY_LEN(frame_cli));
+	ast_register_cleanup(frame_shutdown);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,333 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Timing of frames through the media path
+ *
+ * The histograms are kept per bridge technology. Stages of the media path
+ * which do not know the bridge a frame goes through, such as ast_write()
+ * and the RTP engine, use the technology the thread last recorded with.
+ * All of them run on the bridge channel thread of the channel, which
+ * records with the technology as it gives frames to the bridge.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <time.h>
+
+#include "asterisk/_private.h"
+#include "asterisk/cli.h"
+#include "asterisk/frame.h"
+#include "asterisk/frame_timing.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/lock.h"
+#include "asterisk/strings.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/utils.h"
+
+/*! \brief Longest bridge technology name kept for a thread */
+#define TECHNOLOGY_LEN 32
+
+/*! \brief The technology of frames not bridged */
+#define TECHNOLOGY_NONE "none"
+
+/*! \brief Frames taking longer than this are taken to have a bogus stamp */
+#define MAX_TRANSIT_USEC (10 * 1000000)
+
+/*! \brief Upper bounds of the buckets, in microseconds */
+static const unsigned int bucket_bounds[AST_FRAME_TIMING_BUCKETS - 1] = {
+	250, 500, 1000, 2000, 5000, 10000, 20000, 40000, 60000, 80000, 120000, 200000,
+};
+
+static const char *stage_names[AST_FRAME_TIMING_STAGES] = {
+	[AST_FRAME_TIMING_READ] = "read",
+	[AST_FRAME_TIMING_BRIDGE] = "bridge",
+	[AST_FRAME_TIMING_QUEUE] = "queue",
+	[AST_FRAME_TIMING_WRITE] = "write",
+	[AST_FRAME_TIMING_SEND] = "send",
+};
+
+/*! \brief The histograms of a bridge technology */
+struct frame_timing_technology {
+	struct ast_frame_timing_histogram stages[AST_FRAME_TIMING_STAGES];
+	AST_LIST_ENTRY(frame_timing_technology) list;
+	char name[0];
+};
+
+/*! \brief The histograms of every technology recorded with, never removed */
+static AST_LIST_HEAD_STATIC(technologies, frame_timing_technology);
+
+/*! \brief The technology a thread last recorded with */
+AST_THREADSTORAGE(frame_timing_thread);
+
+int ast_frame_timing_enabled;
+
+static uint64_t frame_timing_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void ast_frame_timing_stamp(struct ast_frame *f)
+{
+	uint64_t now = ast_frame_timing_enabled ? frame_timing_now() : 0;
+
+	for (; f; f = AST_LIST_NEXT(f, frame_list)) {
+		f->ingress = now;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find the histograms of a technology, or add them
+ * \note The technologies list must be locked.
+ */
+static struct frame_timing_technology *technology_get(const char *name)
+{
+	struct frame_timing_technology *technology;
+	int stage;
+
+	AST_LIST_TRAVERSE(&technologies, technology, list) {
+		if (!strcmp(technology->name, name)) {
+			return technology;
+		}
+	}
+
+	technology = ast_calloc(1, sizeof(*technology) + strlen(name) + 1);
+	if (!technology) {
+		return NULL;
+	}
+	strcpy(technology->name, name); /* Safe */
+	for (stage = 0; stage < AST_FRAME_TIMING_STAGES; ++stage) {
+		technology->stages[stage].technology = technology->name;
+		technology->stages[stage].stage = stage;
+	}
+	AST_LIST_INSERT_TAIL(&technologies, technology, list);
+
+	return technology;
+}
+
+void ast_frame_timing_record(enum ast_frame_timing_stage stage, const char *technology, const struct ast_frame *f)
+{
+	char *thread_technology;
+	struct frame_timing_technology *histograms;
+	struct ast_frame_timing_histogram *histogram;
+	uint64_t now;
+	uint64_t usec;
+	int bucket;
+
+	if (f->frametype != AST_FRAME_VOICE && f->frametype != AST_FRAME_VIDEO) {
+		return;
+	}
+
+	now = frame_timing_now();
+	if (now < f->ingress) {
+		return;
+	}
+	usec = (now - f->ingress) / 1000;
+	if (usec > MAX_TRANSIT_USEC) {
+		/* Not stamped here, but left over in memory never cleared. */
+		return;
+	}
+
+	thread_technology = ast_threadstorage_get(&frame_timing_thread, TECHNOLOGY_LEN);
+	if (thread_technology) {
+		if (technology) {
+			ast_copy_string(thread_technology, technology, TECHNOLOGY_LEN);
+		} else {
+			technology = thread_technology;
+		}
+	}
+	technology = S_OR(technology, TECHNOLOGY_NONE);
+
+	for (bucket = 0; bucket < ARRAY_LEN(bucket_bounds); ++bucket) {
+		if (usec <= bucket_bounds[bucket]) {
+			break;
+		}
+	}
+
+	AST_LIST_LOCK(&technologies);
+	histograms = technology_get(technology);
+	if (histograms) {
+		histogram = &histograms->stages[stage];
+		histogram->buckets[bucket]++;
+		histogram->count++;
+		histogram->sum += usec;
+	}
+	AST_LIST_UNLOCK(&technologies);
+}
+
+const char *ast_frame_timing_stage_name(enum ast_frame_timing_stage stage)
+{
+	return stage < AST_FRAME_TIMING_STAGES ? stage_names[stage] : "unknown";
+}
+
+unsigned int ast_frame_timing_bucket_bound(int bucket)
+{
+	return bucket >= 0 && bucket < ARRAY_LEN(bucket_bounds) ? bucket_bounds[bucket] : 0;
+}
+
+void ast_frame_timing_histograms(void (*callback)(const struct ast_frame_timing_histogram *histogram, void *data), void *data)
+{
+	struct frame_timing_technology *technology;
+	int stage;
+
+	AST_LIST_LOCK(&technologies);
+	AST_LIST_TRAVERSE(&technologies, technology, list) {
+		for (stage = 0; stage < AST_FRAME_TIMING_STAGES; ++stage) {
+			struct ast_frame_timing_histogram histogram = technology->stages[stage];
+
+			if (histogram.count) {
+				callback(&histogram, data);
+			}
+		}
+	}
+	AST_LIST_UNLOCK(&technologies);
+}
+
+/*!
+ * \internal
+ * \brief The upper bound of the bucket a percentile of a histogram falls in
+ *
+ * \return The bound in microseconds, or 0 if it falls in the last bucket
+ */
+static unsigned int histogram_percentile(const struct ast_frame_timing_histogram *histogram, unsigned int percent)
+{
+	uint64_t rank = (histogram->count * percent + 99) / 100;
+	uint64_t seen = 0;
+	int bucket;
+
+	for (bucket = 0; bucket < AST_FRAME_TIMING_BUCKETS; ++bucket) {
+		seen += histogram->buckets[bucket];
+		if (seen >= rank) {
+			break;
+		}
+	}
+
+	return ast_frame_timing_bucket_bound(bucket);
+}
+
+static void show_histogram(const struct ast_frame_timing_histogram *histogram, void *data)
+{
+	int fd = *(int *) data;
+	char percentiles[3][16];
+	unsigned int percents[3] = { 50, 90, 99 };
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(percents); ++i) {
+		unsigned int bound = histogram_percentile(histogram, percents[i]);
+
+		if (bound) {
+			snprintf(percentiles[i], sizeof(percentiles[i]), "<=%.2f", bound / 1000.0);
+		} else {
+			snprintf(percentiles[i], sizeof(percentiles[i]), ">%.2f",
+				bucket_bounds[ARRAY_LEN(bucket_bounds) - 1] / 1000.0);
+		}
+	}
+
+	ast_cli(fd, "%-20.20s %-8s %12" PRIu64 " %10.2f %10s %10s %10s\n",
+		histogram->technology, ast_frame_timing_stage_name(histogram->stage), histogram->count,
+		histogram->sum / 1000.0 / histogram->count, percentiles[0], percentiles[1], percentiles[2]);
+}
+
+static char *handle_cli_frame_timing_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int fd;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show frame timing";
+		e->usage =
+			"Usage: core show frame timing\n"
+			"       Shows the time media frames took from being read from RTP to\n"
+			"       each stage of the media path, in milliseconds, for each bridge\n"
+			"       technology. The percentiles are the upper bounds of the buckets\n"
+			"       they fall in.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	fd = a->fd;
+	ast_cli(a->fd, "Frame timing is %s\n\n", ast_frame_timing_enabled ? "enabled" : "disabled");
+	ast_cli(a->fd, "%-20s %-8s %12s %10s %10s %10s %10s\n",
+		"Technology", "Stage", "Frames", "Avg", "P50", "P90", "P99");
+	ast_frame_timing_histograms(show_histogram, &fd);
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_frame_timing_set(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core set frame timing {on|off}";
+		e->usage =
+			"Usage: core set frame timing {on|off}\n"
+			"       Enables or disables timing media frames through the media path.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_frame_timing_enabled = ast_true(a->argv[4]);
+	ast_cli(a->fd, "Frame timing %s\n", ast_frame_timing_enabled ? "enabled" : "disabled");
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_frame_timing[] = {
+	AST_CLI_DEFINE(handle_cli_frame_timing_show, "Show the timing of frames through the media path"),
+	AST_CLI_DEFINE(handle_cli_frame_timing_set, "Enable or disable timing of frames"),
+};
+
+static void frame_timing_shutdown(void)
+{
+	struct frame_timing_technology *technology;
+
+	ast_cli_unregister_multiple(cli_frame_timing, ARRAY_LEN(cli_frame_timing));
+	ast_frame_timing_enabled = 0;
+
+	AST_LIST_LOCK(&technologies);
+	while ((technology = AST_LIST_REMOVE_HEAD(&technologies, list))) {
+		ast_free(technology);
+	}
+	AST_LIST_UNLOCK(&technologies);
+}
+
+int ast_frame_timing_init(void)
+{
+	ast_cli_register_multiple(cli_frame_timing, ARRAY_LEN(cli_frame_timing));
+	ast_register_cleanup(frame_timing_shutdown);
+
+	return 0;
+}
@@ -0,0 +1,445 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief G.711 buffer conversion
+ *
+ * \details The vector versions compute the u-law and a-law codes rather
+ * than looking them up, and produce exactly what the AST_LIN2MU(),
+ * AST_MULAW(), AST_LIN2A() and AST_ALAW() tables do.  They are picked at
+ * runtime from what the CPU supports.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+/* Needed for the x86 intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/ulaw.h"
+#include "asterisk/alaw.h"
+#include "asterisk/logger.h"
+#include "asterisk/utils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(G711_NEW_ALGORITHM)
+#define G711_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*g711_decode_fn)(int16_t *dst, const unsigned char *src, unsigned int samples);
+typedef void (*g711_encode_fn)(unsigned char *dst, const int16_t *src, unsigned int samples);
+
+/*! \brief A set of G.711 conversion routines */
+struct g711_kernels {
+	const char *name;
+	g711_decode_fn ulaw_decode;
+	g711_encode_fn ulaw_encode;
+	g711_decode_fn alaw_decode;
+	g711_encode_fn alaw_encode;
+	int (*supported)(void);
+};
+
+static void ulaw_decode_table(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; ++x) {
+		dst[x] = AST_MULAW(src[x]);
+	}
+}
+
+static void ulaw_encode_table(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; ++x) {
+		dst[x] = AST_LIN2MU(src[x]);
+	}
+}
+
+static void alaw_decode_table(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; ++x) {
+		dst[x] = AST_ALAW(src[x]);
+	}
+}
+
+static void alaw_encode_table(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; ++x) {
+		dst[x] = AST_LIN2A(src[x]);
+	}
+}
+
+static int supported_table(void)
+{
+	return 1;
+}
+
+#ifdef G711_X86
+/*
+ * The encoding tables only keep the top 14 (u-law) or 13 (a-law) bits of
+ * a sample, and hold the code of the largest sample sharing those bits.
+ * So the vector encoders first set the discarded bits to match.
+ *
+ * For a magnitude of at least 128, the G.711 segment is the position of
+ * its leading one less 7, and the mantissa is the 4 bits below the leading
+ * one.  Both are read straight out of the magnitude converted to a float.
+ * Decoding builds that float and converts it back.
+ */
+
+/*! \brief Float exponent of 2^7, shifted to bit 4 of a code */
+#define G711_CODE_BIAS ((127 + 7) << 4)
+
+/*!
+ * \brief Get the segment (bits 6-4) and mantissa (bits 3-0) of each lane
+ *
+ * \note The magnitudes must be at least 128.
+ */
+__attribute__((target("sse2")))
+static inline __m128i g711_code_sse2(__m128i mag)
+{
+	__m128i lo = _mm_castps_si128(_mm_cvtepi32_ps(_mm_unpacklo_epi16(mag, _mm_setzero_si128())));
+	__m128i hi = _mm_castps_si128(_mm_cvtepi32_ps(_mm_unpackhi_epi16(mag, _mm_setzero_si128())));
+
+	lo = _mm_sub_epi32(_mm_srli_epi32(lo, 23 - 4), _mm_set1_epi32(G711_CODE_BIAS));
+	hi = _mm_sub_epi32(_mm_srli_epi32(hi, 23 - 4), _mm_set1_epi32(G711_CODE_BIAS));
+
+	return _mm_packs_epi32(lo, hi);
+}
+
+/*!
+ * \brief Get the magnitude in the middle of each lane's segment and mantissa
+ *
+ * \details That is (16.5 + mantissa) << (segment + 3).
+ */
+__attribute__((target("sse2")))
+static inline __m128i g711_linear_sse2(__m128i code)
+{
+	__m128i bias = _mm_set1_epi32((G711_CODE_BIAS << (23 - 4)) | (1 << 18));
+	__m128i lo = _mm_slli_epi32(_mm_unpacklo_epi16(code, _mm_setzero_si128()), 23 - 4);
+	__m128i hi = _mm_slli_epi32(_mm_unpackhi_epi16(code, _mm_setzero_si128()), 23 - 4);
+
+	lo = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_add_epi32(lo, bias)));
+	hi = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_add_epi32(hi, bias)));
+
+	return _mm_packs_epi32(lo, hi);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i ulaw_encode_sse2_8(__m128i x)
+{
+	__m128i sign;
+	__m128i mag;
+
+	x = _mm_or_si128(x, _mm_set1_epi16(0x3));
+	sign = _mm_srai_epi16(x, 15);
+	mag = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+	mag = _mm_min_epi16(mag, _mm_set1_epi16(32635));
+	mag = _mm_add_epi16(mag, _mm_set1_epi16(0x84));
+
+	return _mm_andnot_si128(_mm_or_si128(_mm_and_si128(sign, _mm_set1_epi16(0x80)),
+		g711_code_sse2(mag)), _mm_set1_epi16(0xff));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i ulaw_decode_sse2_8(__m128i u)
+{
+	__m128i sample;
+	__m128i sign;
+
+	u = _mm_xor_si128(u, _mm_set1_epi16(0xff));
+	sample = _mm_sub_epi16(g711_linear_sse2(_mm_and_si128(u, _mm_set1_epi16(0x7f))),
+		_mm_set1_epi16(0x84));
+	sign = _mm_cmpeq_epi16(_mm_and_si128(u, _mm_set1_epi16(0x80)), _mm_set1_epi16(0x80));
+
+	return _mm_sub_epi16(_mm_xor_si128(sample, sign), sign);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i alaw_encode_sse2_8(__m128i x)
+{
+	__m128i sign;
+	__m128i mag;
+	__m128i small;
+	__m128i code;
+
+	x = _mm_or_si128(x, _mm_set1_epi16(0x7));
+	sign = _mm_srai_epi16(x, 15);
+	mag = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+
+	/* Segment 0 is coded like segment 1 less 256 */
+	small = _mm_cmplt_epi16(mag, _mm_set1_epi16(0x100));
+	code = g711_code_sse2(_mm_or_si128(mag, _mm_and_si128(small, _mm_set1_epi16(0x100))));
+	code = _mm_sub_epi16(code, _mm_and_si128(small, _mm_set1_epi16(0x10)));
+
+	return _mm_xor_si128(code,
+		_mm_or_si128(_mm_andnot_si128(sign, _mm_set1_epi16(0x80)), _mm_set1_epi16(0x55)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i alaw_decode_sse2_8(__m128i a)
+{
+	__m128i code;
+	__m128i small;
+	__m128i sample;
+	__m128i negative;
+
+	a = _mm_xor_si128(a, _mm_set1_epi16(0x55));
+	code = _mm_and_si128(a, _mm_set1_epi16(0x7f));
+
+	/* Segment 0 is decoded like segment 1 less 256 */
+	small = _mm_cmplt_epi16(code, _mm_set1_epi16(0x10));
+	sample = g711_linear_sse2(_mm_or_si128(code, _mm_and_si128(small, _mm_set1_epi16(0x10))));
+	sample = _mm_sub_epi16(sample, _mm_and_si128(small, _mm_set1_epi16(0x100)));
+	negative = _mm_cmpeq_epi16(_mm_and_si128(a, _mm_set1_epi16(0x80)), _mm_setzero_si128());
+
+	return _mm_sub_epi16(_mm_xor_si128(sample, negative), negative);
+}
+
+#define G711_SSE2_CODEC(codec) \
+__attribute__((target("sse2"))) \
+static void codec##_decode_sse2(int16_t *dst, const unsigned char *src, unsigned int samples) \
+{ \
+	unsigned int x; \
+\
+	for (x = 0; x + 16 <= samples; x += 16) { \
+		__m128i in = _mm_loadu_si128((const __m128i *) (src + x)); \
+\
+		_mm_storeu_si128((__m128i *) (dst + x), \
+			codec##_decode_sse2_8(_mm_unpacklo_epi8(in, _mm_setzero_si128()))); \
+		_mm_storeu_si128((__m128i *) (dst + x + 8), \
+			codec##_decode_sse2_8(_mm_unpackhi_epi8(in, _mm_setzero_si128()))); \
+	} \
+	codec##_decode_table(dst + x, src + x, samples - x); \
+} \
+\
+__attribute__((target("sse2"))) \
+static void codec##_encode_sse2(unsigned char *dst, const int16_t *src, unsigned int samples) \
+{ \
+	unsigned int x; \
+\
+	for (x = 0; x + 16 <= samples; x += 16) { \
+		__m128i lo = codec##_encode_sse2_8(_mm_loadu_si128((const __m128i *) (src + x))); \
+		__m128i hi = codec##_encode_sse2_8(_mm_loadu_si128((const __m128i *) (src + x + 8))); \
+\
+		_mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(lo, hi)); \
+	} \
+	codec##_encode_table(dst + x, src + x, samples - x); \
+}
+
+G711_SSE2_CODEC(ulaw)
+G711_SSE2_CODEC(alaw)
+
+static int supported_sse2(void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+__attribute__((target("avx2")))
+static inline __m256i g711_code_avx2(__m256i mag)
+{
+	__m256i lo = _mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_unpacklo_epi16(mag, _mm256_setzero_si256())));
+	__m256i hi = _mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_unpackhi_epi16(mag, _mm256_setzero_si256())));
+
+	lo = _mm256_sub_epi32(_mm256_srli_epi32(lo, 23 - 4), _mm256_set1_epi32(G711_CODE_BIAS));
+	hi = _mm256_sub_epi32(_mm256_srli_epi32(hi, 23 - 4), _mm256_set1_epi32(G711_CODE_BIAS));
+
+	return _mm256_packs_epi32(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i g711_linear_avx2(__m256i code)
+{
+	__m256i bias = _mm256_set1_epi32((G711_CODE_BIAS << (23 - 4)) | (1 << 18));
+	__m256i lo = _mm256_slli_epi32(_mm256_unpacklo_epi16(code, _mm256_setzero_si256()), 23 - 4);
+	__m256i hi = _mm256_slli_epi32(_mm256_unpackhi_epi16(code, _mm256_setzero_si256()), 23 - 4);
+
+	lo = _mm256_cvttps_epi32(_mm256_castsi256_ps(_mm256_add_epi32(lo, bias)));
+	hi = _mm256_cvttps_epi32(_mm256_castsi256_ps(_mm256_add_epi32(hi, bias)));
+
+	return _mm256_packs_epi32(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ulaw_encode_avx2_16(__m256i x)
+{
+	__m256i sign;
+	__m256i mag;
+
+	x = _mm256_or_si256(x, _mm256_set1_epi16(0x3));
+	sign = _mm256_srai_epi16(x, 15);
+	mag = _mm256_sub_epi16(_mm256_xor_si256(x, sign), sign);
+	mag = _mm256_min_epi16(mag, _mm256_set1_epi16(32635));
+	mag = _mm256_add_epi16(mag, _mm256_set1_epi16(0x84));
+
+	return _mm256_andnot_si256(_mm256_or_si256(_mm256_and_si256(sign, _mm256_set1_epi16(0x80)),
+		g711_code_avx2(mag)), _mm256_set1_epi16(0xff));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ulaw_decode_avx2_16(__m256i u)
+{
+	__m256i sample;
+	__m256i sign;
+
+	u = _mm256_xor_si256(u, _mm256_set1_epi16(0xff));
+	sample = _mm256_sub_epi16(g711_linear_avx2(_mm256_and_si256(u, _mm256_set1_epi16(0x7f))),
+		_mm256_set1_epi16(0x84));
+	sign = _mm256_cmpeq_epi16(_mm256_and_si256(u, _mm256_set1_epi16(0x80)), _mm256_set1_epi16(0x80));
+
+	return _mm256_sub_epi16(_mm256_xor_si256(sample, sign), sign);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i alaw_encode_avx2_16(__m256i x)
+{
+	__m256i sign;
+	__m256i mag;
+	__m256i small;
+	__m256i code;
+
+	x = _mm256_or_si256(x, _mm256_set1_epi16(0x7));
+	sign = _mm256_srai_epi16(x, 15);
+	mag = _mm256_sub_epi16(_mm256_xor_si256(x, sign), sign);
+
+	small = _mm256_cmpgt_epi16(_mm256_set1_epi16(0x100), mag);
+	code = g711_code_avx2(_mm256_or_si256(mag, _mm256_and_si256(small, _mm256_set1_epi16(0x100))));
+	code = _mm256_sub_epi16(code, _mm256_and_si256(small, _mm256_set1_epi16(0x10)));
+
+	return _mm256_xor_si256(code,
+		_mm256_or_si256(_mm256_andnot_si256(sign, _mm256_set1_epi16(0x80)), _mm256_set1_epi16(0x55)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i alaw_decode_avx2_16(__m256i a)
+{
+	__m256i code;
+	__m256i small;
+	__m256i sample;
+	__m256i negative;
+
+	a = _mm256_xor_si256(a, _mm256_set1_epi16(0x55));
+	code = _mm256_and_si256(a, _mm256_set1_epi16(0x7f));
+
+	small = _mm256_cmpgt_epi16(_mm256_set1_epi16(0x10), code);
+	sample = g711_linear_avx2(_mm256_or_si256(code, _mm256_and_si256(small, _mm256_set1_epi16(0x10))));
+	sample = _mm256_sub_epi16(sample, _mm256_and_si256(small, _mm256_set1_epi16(0x100)));
+	negative = _mm256_cmpeq_epi16(_mm256_and_si256(a, _mm256_set1_epi16(0x80)), _mm256_setzero_si256());
+
+	return _mm256_sub_epi16(_mm256_xor_si256(sample, negative), negative);
+}
+
+#define G711_AVX2_CODEC(codec) \
+__attribute__((target("avx2"))) \
+static void codec##_decode_avx2(int16_t *dst, const unsigned char *src, unsigned int samples) \
+{ \
+	unsigned int x; \
+\
+	for (x = 0; x + 16 <= samples; x += 16) { \
+		__m256i in = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (src + x))); \
+\
+		_mm256_storeu_si256((__m256i *) (dst + x), codec##_decode_avx2_16(in)); \
+	} \
+	codec##_decode_table(dst + x, src + x, samples - x); \
+} \
+\
+__attribute__((target("avx2"))) \
+static void codec##_encode_avx2(unsigned char *dst, const int16_t *src, unsigned int samples) \
+{ \
+	unsigned int x; \
+\
+	for (x = 0; x + 32 <= samples; x += 32) { \
+		__m256i lo = codec##_encode_avx2_16(_mm256_loadu_si256((const __m256i *) (src + x))); \
+		__m256i hi = codec##_encode_avx2_16(_mm256_loadu_si256((const __m256i *) (src + x + 16))); \
+\
+		/* Packing works within 128 bit lanes, so put the quarters back in order */ \
+		_mm256_storeu_si256((__m256i *) (dst + x), \
+			_mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8)); \
+	} \
+	codec##_encode_table(dst + x, src + x, samples - x); \
+}
+
+G711_AVX2_CODEC(ulaw)
+G711_AVX2_CODEC(alaw)
+
+static int supported_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif /* G711_X86 */
+
+/*! \brief Known conversion routines, from least to most preferred */
+static const struct g711_kernels kernels[] = {
+	{ "table", ulaw_decode_table, ulaw_encode_table, alaw_decode_table, alaw_encode_table, supported_table, },
+#ifdef G711_X86
+	{ "sse2", ulaw_decode_sse2, ulaw_encode_sse2, alaw_decode_sse2, alaw_encode_sse2, supported_sse2, },
+	{ "avx2", ulaw_decode_avx2, ulaw_encode_avx2, alaw_decode_avx2, alaw_encode_avx2, supported_avx2, },
+#endif
+};
+
+static const struct g711_kernels *g711 = &kernels[0];
+
+void ast_ulaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	g711->ulaw_decode(dst, src, samples);
+}
+
+void ast_ulaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	g711->ulaw_encode(dst, src, samples);
+}
+
+void ast_alaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	g711->alaw_decode(dst, src, samples);
+}
+
+void ast_alaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	g711->alaw_encode(dst, src, samples);
+}
+
+const char *ast_g711_name(void)
+{
+	return g711->name;
+}
+
+void ast_g711_init(void)
+{
+	int idx;
+
+#ifdef G711_X86
+	__builtin_cpu_init();
+#endif
+
+	for (idx = ARRAY_LEN(kernels) - 1; idx > 0; --idx) {
+		if (kernels[idx].supported()) {
+			break;
+		}
+	}
+	g711 = &kernels[idx];
+
+	ast_debug(1, "Using %s G.711 conversion\n", g711->name);
+}
@@ -33,6 +33,7 @@
 #include "asterisk/lock.h"
 #include "asterisk/frame.h"
 #include "asterisk/channel.h"
+#include "asterisk/endian.h"
 #include "asterisk/cli.h"
 #include "asterisk/term.h"
 #include "asterisk/utils.h"
@@ -41,6 +42,39 @@
 #include "asterisk/hashtab.h"
 
 
+/*
+ * The objects are kept in an array, in the order they were inserted, which
+ * is what traversals go through. They are found through an open addressing
+ * index of the array, in the manner of the SwissTable: each slot of the
+ * index has a control byte holding 7 bits of the hash of its object, and
+ * the control bytes of a group of slots are matched against the hash being
+ * looked for all at once, as a 64 bit word. Only the objects of slots whose
+ * control bytes match are compared.
+ *
+ * When the index grows, the new index is filled from the old one a few
+ * slots at a time by the insertions and removals which follow, rather than
+ * all at once, and lookups look through both until the old one is empty.
+ */
+
+/*! \brief Slots of a group of the index, whose control bytes are matched at once */
+#define GROUP_SIZE 8
+
+/*! \brief The control byte of a slot never used */
+#define CTRL_EMPTY 0x80
+/*! \brief The control byte of a slot whose object was removed */
+#define CTRL_DELETED 0xfe
+
+/*! \brief Fewest slots of an index */
+#define MIN_CAPACITY 16
+
+/*! \brief Slots of the old index moved to the new one by each insertion or removal */
+#define MIGRATE_SLOTS 32
+
+typedef uint64_t group_t;
+
+#define GROUP_LSBS 0x0101010101010101ULL
+#define GROUP_MSBS 0x8080808080808080ULL
+
 static void _ast_hashtab_resize(struct ast_hashtab *tab, const char *file, int lineno, const char *func);
 #define ast_hashtab_resize(tab) \
 	_ast_hashtab_resize(tab, __FILE__, __LINE__, __PRETTY_FUNCTION__)
@@ -213,6 +247,272 @@ unsigned int ast_hashtab_hash_short(const short x)
 	return x;
 }
 
+
+/*! \brief Spread the bits of a hash, since the hash functions of tables may not */
+static unsigned int hash_mix(unsigned int h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/*! \brief The 7 bits of a mixed hash kept in the control byte of its slot */
+#define HASH_CTRL(m) ((unsigned char) ((m) >> 25))
+
+static group_t group_load(const unsigned char *ctrl)
+{
+	group_t group;
+
+	memcpy(&group, ctrl, sizeof(group));
+	return group;
+}
+
+/*!
+ * \brief The control bytes of a group matching 7 bits of a hash
+ * \note Bytes following a match may match falsely, so the objects must still be compared.
+ */
+static group_t group_match(group_t group, unsigned char ctrl)
+{
+	group_t x = group ^ (GROUP_LSBS * ctrl);
+
+	return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+/*! \brief The control bytes of a group which are empty */
+static group_t group_match_empty(group_t group)
+{
+	return group & (~group << 6) & GROUP_MSBS;
+}
+
+/*! \brief The control bytes of a group which are empty or deleted */
+static group_t group_match_free(group_t group)
+{
+	return group & GROUP_MSBS;
+}
+
+/*! \brief The first slot of a group in a match */
+static int group_first(group_t match)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	return __builtin_ctzll(match) >> 3;
+#else
+	return __builtin_clzll(match) >> 3;
+#endif
+}
+
+/*! \brief Remove a slot from a match */
+static group_t group_clear(group_t match, int slot)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	return match & ~((group_t) 0x80 << (slot * 8));
+#else
+	return match & ~((group_t) 0x80 << ((GROUP_SIZE - 1 - slot) * 8));
+#endif
+}
+
+static int index_alloc(struct ast_hashtab_index *index, unsigned int capacity, const char *file, int lineno, const char *func)
+{
+	index->ctrl = __ast_malloc(capacity, file, lineno, func);
+	index->slots = __ast_malloc(capacity * sizeof(*index->slots), file, lineno, func);
+	if (!index->ctrl || !index->slots) {
+		ast_free(index->ctrl);
+		ast_free(index->slots);
+		index->ctrl = NULL;
+		index->slots = NULL;
+		return -1;
+	}
+	memset(index->ctrl, CTRL_EMPTY, capacity);
+	index->capacity = capacity;
+	index->used = 0;
+
+	return 0;
+}
+
+static void index_free(struct ast_hashtab_index *index)
+{
+	ast_free(index->ctrl);
+	ast_free(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
+/*!
+ * \internal
+ * \brief Find the slot of an object in an index
+ *
+ * \param tab The table
+ * \param index The index of the table looked through
+ * \param obj The object looked for
+ * \param m The mixed hash of the object
+ * \param same Non-zero to find the object itself, rather than one comparing equal
+ *
+ * \retval -1 if the object is not in the index
+ * \return The slot
+ */
+static int index_find(struct ast_hashtab *tab, struct ast_hashtab_index *index, const void *obj, unsigned int m, int same)
+{
+	unsigned int groups = index->capacity / GROUP_SIZE;
+	unsigned int group_num;
+	unsigned int probe;
+	unsigned char ctrl = HASH_CTRL(m);
+
+	if (!groups) {
+		return -1;
+	}
+
+	group_num = m & (groups - 1);
+	for (probe = 0; probe < groups; ++probe) {
+		unsigned char *group_ctrl = index->ctrl + group_num * GROUP_SIZE;
+		group_t group = group_load(group_ctrl);
+		group_t match = group_match(group, ctrl);
+
+		while (match) {
+			int slot = group_first(match);
+
+			if (group_ctrl[slot] == ctrl) {
+				const void *candidate = tab->array[index->slots[group_num * GROUP_SIZE + slot]].object;
+
+				if (same ? candidate == obj : !(*tab->compare)(obj, candidate)) {
+					return group_num * GROUP_SIZE + slot;
+				}
+			}
+			match = group_clear(match, slot);
+		}
+		if (group_match_empty(group)) {
+			return -1;
+		}
+		/* Quadratic probing by groups, which visits every group of a power of 2 */
+		group_num = (group_num + probe + 1) & (groups - 1);
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Add an entry of the object array to an index
+ * \return The number of groups probed
+ */
+static int index_insert(struct ast_hashtab_index *index, unsigned int m, unsigned int entry)
+{
+	unsigned int groups = index->capacity / GROUP_SIZE;
+	unsigned int group_num = m & (groups - 1);
+	unsigned int probe;
+
+	for (probe = 0; probe < groups; ++probe) {
+		unsigned char *group_ctrl = index->ctrl + group_num * GROUP_SIZE;
+		group_t match = group_match_free(group_load(group_ctrl));
+
+		if (match) {
+			int slot = group_first(match);
+
+			if (group_ctrl[slot] == CTRL_EMPTY) {
+				index->used++;
+			}
+			group_ctrl[slot] = HASH_CTRL(m);
+			index->slots[group_num * GROUP_SIZE + slot] = entry;
+			return probe + 1;
+		}
+		group_num = (group_num + probe + 1) & (groups - 1);
+	}
+
+	/* The index is never let to fill up. */
+	ast_assert(0);
+	return probe;
+}
+
+/*! \internal \brief Remove a slot from an index */
+static void index_remove(struct ast_hashtab_index *index, int slot)
+{
+	unsigned char *group_ctrl = index->ctrl + slot - slot % GROUP_SIZE;
+
+	/* A lookup stops at the first group with an empty slot, so if this group
+	 * has one no lookup ever went past it, and the slot can be made empty. */
+	if (group_match_empty(group_load(group_ctrl))) {
+		index->ctrl[slot] = CTRL_EMPTY;
+		index->used--;
+	} else {
+		index->ctrl[slot] = CTRL_DELETED;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Move some slots of the old index of a table to its index
+ *
+ * \param tab The table
+ * \param slots How many slots of the old index to go through, or 0 for all of them
+ */
+static void index_migrate(struct ast_hashtab *tab, unsigned int slots)
+{
+	struct ast_hashtab_index *old = &tab->old_index;
+	unsigned int end;
+
+	if (!old->capacity) {
+		return;
+	}
+
+	end = slots ? MIN(tab->migrated + slots, old->capacity) : old->capacity;
+	for (; tab->migrated < end; tab->migrated++) {
+		unsigned int entry;
+		int probes;
+
+		if (old->ctrl[tab->migrated] & CTRL_EMPTY) {
+			continue;
+		}
+		entry = old->slots[tab->migrated];
+		probes = index_insert(&tab->index, hash_mix(tab->array[entry].hash), entry);
+		if (probes > tab->largest_bucket_size) {
+			tab->largest_bucket_size = probes;
+		}
+		/* Deleted rather than empty, so lookups of slots not yet moved still probe past it */
+		old->ctrl[tab->migrated] = CTRL_DELETED;
+	}
+
+	if (tab->migrated == old->capacity) {
+		index_free(old);
+		tab->migrated = 0;
+	}
+}
+
+/*! \internal \brief Rebuild the index of a table from its object array */
+static void index_rebuild(struct ast_hashtab *tab)
+{
+	int i;
+	int probes;
+
+	index_free(&tab->old_index);
+	tab->migrated = 0;
+	memset(tab->index.ctrl, CTRL_EMPTY, tab->index.capacity);
+	tab->index.used = 0;
+	tab->largest_bucket_size = 0;
+
+	for (i = 0; i < tab->array_used; ++i) {
+		if (!tab->array[i].object) {
+			continue;
+		}
+		probes = index_insert(&tab->index, hash_mix(tab->array[i].hash), i);
+		if (probes > tab->largest_bucket_size) {
+			tab->largest_bucket_size = probes;
+		}
+	}
+}
+
+/*! \internal \brief The smallest capacity of an index, a power of 2, of at least a size */
+static unsigned int index_capacity(unsigned int size)
+{
+	unsigned int capacity = MIN_CAPACITY;
+
+	while (capacity < size) {
+		capacity <<= 1;
+	}
+
+	return capacity;
+}
+
 struct ast_hashtab *_ast_hashtab_create(int initial_buckets,
 	int (*compare)(const void *a, const void *b),
 	int (*resize)(struct ast_hashtab *),
@@ -229,17 +529,12 @@ struct ast_hashtab *_ast_hashtab_create(int initial_buckets,
 		return NULL;
 	}
 
-	while (!ast_is_prime(initial_buckets)) /* make sure this is prime */
-		initial_buckets++;
-
-	ht->array = __ast_calloc(initial_buckets, sizeof(*(ht->array)),
-		file, lineno, function);
-	if (!ht->array) {
+	if (index_alloc(&ht->index, index_capacity(initial_buckets), file, lineno, function)) {
 		ast_free(ht);
 		return NULL;
 	}
 
-	ht->hash_tab_size = initial_buckets;
+	ht->hash_tab_size = ht->index.capacity;
 	ht->compare = compare;
 	ht->resize = resize;
 	ht->newsize = newsize;
@@ -261,21 +556,19 @@ struct ast_hashtab *_ast_hashtab_create(int initial_buckets,
 struct ast_hashtab *_ast_hashtab_dup(struct ast_hashtab *tab, void *(*obj_dup_func)(const void *obj), const char *file, int lineno, const char *func)
 {
 	struct ast_hashtab *ht;
-	unsigned int i;
+	int i;
 
 	ht = __ast_calloc(1, sizeof(*ht), file, lineno, func);
 	if (!ht) {
 		return NULL;
 	}
 
-	ht->array = __ast_calloc(tab->hash_tab_size, sizeof(*(ht->array)),
-		file, lineno, func);
-	if (!ht->array) {
+	if (index_alloc(&ht->index, tab->index.capacity, file, lineno, func)) {
 		ast_free(ht);
 		return NULL;
 	}
 
-	ht->hash_tab_size = tab->hash_tab_size;
+	ht->hash_tab_size = ht->index.capacity;
 	ht->compare = tab->compare;
 	ht->resize = tab->resize;
 	ht->newsize = tab->newsize;
@@ -285,53 +578,24 @@ struct ast_hashtab *_ast_hashtab_dup(struct ast_hashtab *tab, void *(*obj_dup_fu
 	if (ht->do_locking)
 		ast_rwlock_init(&ht->lock);
 
-	/* now, dup the objects in the buckets and get them into the table */
-	/* the fast way is to use the existing array index, and not have to hash
+	/* now, dup the objects and get them into the table */
+	/* the fast way is to use the hash kept with each object, and not have to hash
 	   the objects again */
-	for (i = 0; i < ht->hash_tab_size; i++) {
-		struct ast_hashtab_bucket *b = tab->array[i];
-		while (b) {
-			void *newobj = (*obj_dup_func)(b->object);
-			if (newobj) {
-				_ast_hashtab_insert_immediate_bucket(ht, newobj, i, file, lineno, func);
-			}
-			b = b->next;
+	for (i = 0; i < tab->array_used; i++) {
+		void *newobj;
+
+		if (!tab->array[i].object) {
+			continue;
+		}
+		newobj = (*obj_dup_func)(tab->array[i].object);
+		if (newobj) {
+			_ast_hashtab_insert_immediate_bucket(ht, newobj, tab->array[i].hash, file, lineno, func);
 		}
 	}
 
 	return ht;
 }
 
-static void tlist_del_item(struct ast_hashtab_bucket **head, struct ast_hashtab_bucket *item)
-{
-	/* item had better be in the list! or suffer the weirdness that occurs, later! */
-	if (*head == item) { /* first item in the list */
-		*head = item->tnext;
-		if (item->tnext)
-			item->tnext->tprev = NULL;
-	} else {
-		/* short circuit stuff */
-		item->tprev->tnext = item->tnext;
-		if (item->tnext)
-			item->tnext->tprev = item->tprev;
-	}
-}
-
-static void tlist_add_head(struct ast_hashtab_bucket **head, struct ast_hashtab_bucket *item)
-{
-	if (*head) {
-		item->tnext = *head;
-		item->tprev = NULL;
-		(*head)->tprev = item;
-		*head = item;
-	} else {
-		/* the list is empty */
-		*head = item;
-		item->tprev = NULL;
-		item->tnext = NULL;
-	}
-}
-
 /* user-controlled hashtab locking. Create a hashtab without locking, then call the
    following locking routines yourself to lock the table between threads. */
 
@@ -365,34 +629,23 @@ void ast_hashtab_destroy(struct ast_hashtab *tab, void (*objdestroyfunc)(void *o
 	/* this func will free the hash table and all its memory. It
 	   doesn't touch the objects stored in it */
 	if (tab) {
+		int i;
 
 		if (tab->do_locking)
 			ast_rwlock_wrlock(&tab->lock);
 
-		if (tab->array) {
-			/* go thru and destroy the buckets */
-			struct ast_hashtab_bucket *t;
-			int i;
-
-			while (tab->tlist) {
-				t = tab->tlist;
-				if (t->object && objdestroyfunc) {
-					/* I cast this because I'm not going to MOD it, I'm going to DESTROY
-					 * it.
-					 */
-					(*objdestroyfunc)((void *) t->object);
-				}
-
-				tlist_del_item(&(tab->tlist), tab->tlist);
-				ast_free(t);
-			}
-
-			for (i = 0; i < tab->hash_tab_size; i++) {
-				/* Not totally necessary, but best to destroy old pointers */
-				tab->array[i] = NULL;
+		for (i = 0; i < tab->array_used; i++) {
+			if (tab->array[i].object && objdestroyfunc) {
+				/* I cast this because I'm not going to MOD it, I'm going to DESTROY
+				 * it.
+				 */
+				(*objdestroyfunc)((void *) tab->array[i].object);
 			}
-			ast_free(tab->array);
 		}
+		ast_free(tab->array);
+		index_free(&tab->index);
+		index_free(&tab->old_index);
+
 		if (tab->do_locking) {
 			ast_rwlock_unlock(&tab->lock);
 			ast_rwlock_destroy(&tab->lock);
@@ -412,7 +665,7 @@ int _ast_hashtab_insert_immediate(struct ast_hashtab *tab, const void *obj, cons
 	if (tab->do_locking)
 		ast_rwlock_wrlock(&tab->lock);
 
-	h = (*tab->hash)(obj) % tab->hash_tab_size;
+	h = (*tab->hash)(obj);
 
 	res = _ast_hashtab_insert_immediate_bucket(tab, obj, h, file, lineno, func);
 
@@ -422,36 +675,84 @@ int _ast_hashtab_insert_immediate(struct ast_hashtab *tab, const void *obj, cons
 	return res;
 }
 
-int _ast_hashtab_insert_immediate_bucket(struct ast_hashtab *tab, const void *obj, unsigned int h, const char *file, int lineno, const char *func)
+/*!
+ * \internal
+ * \brief Make room for an object at the end of the object array of a table
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int array_make_room(struct ast_hashtab *tab, const char *file, int lineno, const char *func)
 {
-	int c;
-	struct ast_hashtab_bucket *b;
+	struct ast_hashtab_bucket *array;
+	int size;
+	int i;
+	int j;
 
-	if (!tab || !obj)
+	if (tab->array_used < tab->array_size) {
 		return 0;
+	}
+
+	if (!tab->iterators && tab->hash_tab_elements < tab->array_used / 2) {
+		/* Most of the array is removed objects, so squeeze them out. Nothing is
+		 * traversing the array, so the objects can move. */
+		for (i = j = 0; i < tab->array_used; i++) {
+			if (tab->array[i].object) {
+				tab->array[j++] = tab->array[i];
+			}
+		}
+		tab->array_used = j;
+		index_rebuild(tab);
+		return 0;
+	}
+
+	size = tab->array_size ? tab->array_size * 2 : MIN_CAPACITY;
+	array = __ast_realloc(tab->array, size * sizeof(*array), file, lineno, func);
+	if (!array) {
+		return -1;
+	}
+	tab->array = array;
+	tab->array_size = size;
 
-	for (c = 0, b = tab->array[h]; b; b= b->next)
-		c++;
+	return 0;
+}
 
-	if (c + 1 > tab->largest_bucket_size)
-		tab->largest_bucket_size = c + 1;
+int _ast_hashtab_insert_immediate_bucket(struct ast_hashtab *tab, const void *obj, unsigned int h, const char *file, int lineno, const char *func)
+{
+	int probes;
 
-	b = __ast_calloc(1, sizeof(*b), file, lineno, func);
-	if (!b) {
+	if (!tab || !obj)
 		return 0;
+
+	if (array_make_room(tab, file, lineno, func)) {
+		return 0;
+	}
+
+	/* Grow the index before it gets too full to probe quickly */
+	if ((tab->index.used + 1) * 8 > tab->index.capacity * 7) {
+		ast_hashtab_resize(tab);
+		if ((tab->index.used + 1) * 8 > tab->index.capacity * 7) {
+			/* Could not grow it, so squeeze out the deleted slots instead. */
+			index_rebuild(tab);
+			if (tab->index.used + 1 >= tab->index.capacity) {
+				return 0;
+			}
+		}
 	}
 
-	b->object = obj;
-	b->next = tab->array[h];
-	tab->array[h] = b;
+	tab->array[tab->array_used].object = obj;
+	tab->array[tab->array_used].hash = h;
 
-	if (b->next)
-		b->next->prev = b;
+	probes = index_insert(&tab->index, hash_mix(h), tab->array_used);
+	if (probes > tab->largest_bucket_size)
+		tab->largest_bucket_size = probes;
 
-	tlist_add_head(&(tab->tlist), b);
+	tab->array_used++;
 	tab->hash_tab_elements++;
 
-	if ((*tab->resize)(tab))
+	index_migrate(tab, MIGRATE_SLOTS);
+
+	if (!tab->old_index.capacity && (*tab->resize)(tab))
 		ast_hashtab_resize(tab);
 
 	return 1;
@@ -495,7 +796,7 @@ void *ast_hashtab_lookup(struct ast_hashtab *tab, const void *obj)
 	if (tab->do_locking)
 		ast_rwlock_rdlock(&tab->lock);
 
-	h = (*tab->hash)(obj) % tab->hash_tab_size;
+	h = (*tab->hash)(obj);
 
 	ret = ast_hashtab_lookup_internal(tab,obj,h);
 
@@ -509,7 +810,6 @@ void *ast_hashtab_lookup(struct ast_hashtab *tab, const void *obj)
 void *ast_hashtab_lookup_with_hash(struct ast_hashtab *tab, const void *obj, unsigned int hashval)
 {
 	/* lookup this object in the hash table. return a ptr if found, or NULL if not */
-	unsigned int h;
 	void *ret;
 
 	if (!tab || !obj)
@@ -518,9 +818,7 @@ void *ast_hashtab_lookup_with_hash(struct ast_hashtab *tab, const void *obj, uns
 	if (tab->do_locking)
 		ast_rwlock_rdlock(&tab->lock);
 
-	h = hashval % tab->hash_tab_size;
-
-	ret = ast_hashtab_lookup_internal(tab,obj,h);
+	ret = ast_hashtab_lookup_internal(tab,obj,hashval);
 
 	if (tab->do_locking)
 		ast_rwlock_unlock(&tab->lock);
@@ -537,7 +835,7 @@ void *ast_hashtab_lookup_bucket(struct ast_hashtab *tab, const void *obj, unsign
 	if (!tab || !obj)
 		return 0;
 
-	h = (*tab->hash)(obj) % tab->hash_tab_size;
+	h = (*tab->hash)(obj);
 
 	ret = ast_hashtab_lookup_internal(tab,obj,h);
 
@@ -548,13 +846,18 @@ void *ast_hashtab_lookup_bucket(struct ast_hashtab *tab, const void *obj, unsign
 
 static void *ast_hashtab_lookup_internal(struct ast_hashtab *tab, const void *obj, unsigned int h)
 {
-	struct ast_hashtab_bucket *b;
+	unsigned int m = hash_mix(h);
+	int slot;
 
-	for (b = tab->array[h]; b; b = b->next) {
-		if (!(*tab->compare)(obj,b->object)) {
-			/* I can't touch obj in this func, but the outside world is welcome to */
-			return (void*) b->object;
-		}
+	slot = index_find(tab, &tab->index, obj, m, 0);
+	if (slot >= 0) {
+		/* I can't touch obj in this func, but the outside world is welcome to */
+		return (void *) tab->array[tab->index.slots[slot]].object;
+	}
+
+	slot = index_find(tab, &tab->old_index, obj, m, 0);
+	if (slot >= 0) {
+		return (void *) tab->array[tab->old_index.slots[slot]].object;
 	}
 
 	return NULL;
@@ -579,7 +882,7 @@ int ast_hashtab_size(struct ast_hashtab *tab)
 	return tab->hash_tab_elements;
 }
 
-/* this function returns the size of the bucket array in the hashtab */
+/* this function returns the number of slots of the index of the hashtab */
 int ast_hashtab_capacity( struct ast_hashtab *tab)
 {
 	return tab->hash_tab_size;
@@ -591,47 +894,33 @@ int ast_hashtab_capacity( struct ast_hashtab *tab)
 static void _ast_hashtab_resize(struct ast_hashtab *tab, const char *file, int lineno, const char *func)
 {
 	/* this function is called either internally, when the resize func returns 1, or
-	   externally by the user to force a resize of the hash table */
-	int newsize = (*tab->newsize)(tab), i, c;
-	unsigned int h;
-	struct ast_hashtab_bucket *b,*bn;
-
-	/* Since we keep a DLL of all the buckets in tlist,
-	   all we have to do is free the array, malloc a new one,
-	   and then go thru the tlist array and reassign them into
-	   the bucket arrayj.
-	*/
-	for (i = 0; i < tab->hash_tab_size; i++) { /* don't absolutely have to do this, but
-											why leave ptrs laying around */
-		tab->array[i] = 0; /* erase old ptrs */
-	}
-	ast_free(tab->array);
-	tab->array = __ast_calloc(newsize, sizeof(*(tab->array)), file, lineno, func);
-	if (!tab->array) {
+	   when the index is getting full. The new index is filled from the old one
+	   a few slots at a time by the insertions and removals which follow. */
+	struct ast_hashtab_index index;
+	unsigned int newsize = (*tab->newsize)(tab);
+
+	/* Finish any resize still going first */
+	index_migrate(tab, 0);
+
+	/* Leave room for the objects to grow before the next resize */
+	newsize = index_capacity(MAX(newsize, (tab->hash_tab_elements + 1) * 2));
+	if (newsize <= tab->index.capacity && tab->index.used - tab->hash_tab_elements < tab->index.capacity / 4) {
+		/* The resize functions asked for no more room, and there are not many deleted slots to squeeze out. */
+		newsize = tab->index.capacity * 2;
+	}
+
+	if (index_alloc(&index, newsize, file, lineno, func)) {
 		return;
 	}
 
-	/* now sort the buckets into their rightful new slots */
+	tab->old_index = tab->index;
+	tab->index = index;
+	tab->migrated = 0;
 	tab->resize_count++;
 	tab->hash_tab_size = newsize;
 	tab->largest_bucket_size = 0;
 
-	for (b = tab->tlist; b; b = bn) {
-		b->prev = 0;
-		bn = b->tnext;
-		h = (*tab->hash)(b->object) % tab->hash_tab_size;
-		b->next = tab->array[h];
-		if (b->next)
-			b->next->prev = b;
-		tab->array[h] = b;
-	}
-	/* recalc the largest bucket size */
-	for (i = 0; i < tab->hash_tab_size; i++) {
-		for (c = 0, b = tab->array[i]; b; b = b->next)
-			c++;
-		if (c > tab->largest_bucket_size)
-			tab->largest_bucket_size = c;
-	}
+	index_migrate(tab, MIGRATE_SLOTS);
 }
 
 struct ast_hashtab_iter *_ast_hashtab_start_traversal(struct ast_hashtab *tab, const char *file, int lineno, const char *func)
@@ -644,10 +933,11 @@ struct ast_hashtab_iter *_ast_hashtab_start_traversal(struct ast_hashtab *tab, c
 		return NULL;
 	}
 
-	it->next = tab->tlist;
+	it->next = 0;
 	it->tab = tab;
 	if (tab->do_locking)
 		ast_rwlock_rdlock(&tab->lock);
+	ast_atomic_fetchadd_int(&tab->iterators, +1);
 
 	return it;
 }
@@ -663,10 +953,11 @@ struct ast_hashtab_iter *_ast_hashtab_start_write_traversal(struct ast_hashtab *
 		return NULL;
 	}
 
-	it->next = tab->tlist;
+	it->next = 0;
 	it->tab = tab;
 	if (tab->do_locking)
 		ast_rwlock_wrlock(&tab->lock);
+	ast_atomic_fetchadd_int(&tab->iterators, +1);
 
 	return it;
 }
@@ -675,6 +966,7 @@ void ast_hashtab_end_traversal(struct ast_hashtab_iter *it)
 {
 	if (!it)
 		return;
+	ast_atomic_fetchadd_int(&it->tab->iterators, -1);
 	if (it->tab->do_locking)
 		ast_rwlock_unlock(&it->tab->lock);
 	ast_free(it);
@@ -682,67 +974,60 @@ void ast_hashtab_end_traversal(struct ast_hashtab_iter *it)
 
 void *ast_hashtab_next(struct ast_hashtab_iter *it)
 {
-	/* returns the next object in the list, advances iter one step */
-	struct ast_hashtab_bucket *retval;
+	/* returns the next object in the array, advances iter one step */
+	if (!it)
+		return NULL;
 
-	if (it && it->next) { /* there's a next in the bucket list */
-		retval = it->next;
-		it->next = retval->tnext;
-		return (void *) retval->object;
+	while (it->next < it->tab->array_used) {
+		const void *obj = it->tab->array[it->next++].object;
+
+		if (obj) {
+			return (void *) obj;
+		}
 	}
 
 	return NULL;
 }
 
-static void *ast_hashtab_remove_object_internal(struct ast_hashtab *tab, struct ast_hashtab_bucket *b, int h)
+static void *ast_hashtab_remove_object_internal(struct ast_hashtab *tab, struct ast_hashtab_index *index, int slot)
 {
-	const void *obj2;
+	struct ast_hashtab_bucket *b = &tab->array[index->slots[slot]];
+	const void *obj2 = b->object;
 
-	if (b->prev)
-		b->prev->next = b->next;
-	else
-		tab->array[h] = b->next;
+	index_remove(index, slot);
 
-	if (b->next)
-		b->next->prev = b->prev;
+	/* The object is left out of the array, rather than moved, so that
+	   traversals going through the array do not miss any object. */
+	b->object = NULL;
+	tab->hash_tab_elements--;
 
-	tlist_del_item(&(tab->tlist), b);
+	index_migrate(tab, MIGRATE_SLOTS);
 
-	obj2 = b->object;
-	b->object = b->next = (void*)2;
-	ast_free(b); /* free up the hashbucket */
-	tab->hash_tab_elements--;
-#ifdef DEBUG
-	{
-		int c2;
-		struct ast_hashtab_bucket *b2;
-		/* do a little checking */
-		for (c2 = 0, b2 = tab->tlist; b2; b2 = b2->tnext) {
-			c2++;
-		}
-		if (c2 != tab->hash_tab_elements) {
-			printf("Hey! we didn't delete right! there are %d elements in the list, and we expected %d\n",
-				   c2, tab->hash_tab_elements);
-		}
-		for (c2 = 0, b2 = tab->tlist; b2; b2 = b2->tnext) {
-			unsigned int obj3 = (unsigned long) obj2;
-			unsigned int b3 = (unsigned long) b;
-			if (b2->object == obj2)
-				printf("Hey-- you've still got a bucket pointing at ht_element %x\n", obj3);
-			if (b2->next == b)
-				printf("Hey-- you've still got a bucket with next ptr pointing to deleted bucket %x\n", b3);
-			if (b2->prev == b)
-				printf("Hey-- you've still got a bucket with prev ptr pointing to deleted bucket %x\n", b3);
-			if (b2->tprev == b)
-				printf("Hey-- you've still got a bucket with tprev ptr pointing to deleted bucket %x\n", b3);
-			if (b2->tnext == b)
-				printf("Hey-- you've still got a bucket with tnext ptr pointing to deleted bucket %x\n", b3);
-		}
-	}
-#endif
 	return (void *) obj2; /* inside this code, the obj's are untouchable, but outside, they aren't */
 }
 
+/*!
+ * \internal
+ * \brief Remove an object from whichever index of a table it is in
+ */
+static void *ast_hashtab_remove_object_find(struct ast_hashtab *tab, void *obj, int same)
+{
+	unsigned int m = hash_mix((*tab->hash)(obj));
+	int slot;
+
+	slot = index_find(tab, &tab->index, obj, m, same);
+	if (slot >= 0) {
+		return ast_hashtab_remove_object_internal(tab, &tab->index, slot);
+	}
+
+	slot = index_find(tab, &tab->old_index, obj, m, same);
+	if (slot >= 0) {
+		return ast_hashtab_remove_object_internal(tab, &tab->old_index, slot);
+	}
+
+	return NULL;
+}
+
 void *ast_hashtab_remove_object_via_lookup(struct ast_hashtab *tab, void *obj)
 {
 	/* looks up the object; removes the corresponding bucket */
@@ -765,25 +1050,10 @@ void *ast_hashtab_remove_object_via_lookup(struct ast_hashtab *tab, void *obj)
 void *ast_hashtab_remove_object_via_lookup_nolock(struct ast_hashtab *tab, void *obj)
 {
 	/* looks up the object; removes the corresponding bucket */
-	unsigned int h;
-	struct ast_hashtab_bucket *b;
-
 	if (!tab || !obj)
 		return 0;
 
-	h = (*tab->hash)(obj) % tab->hash_tab_size;
-	for (b = tab->array[h]; b; b = b->next) {
-
-		if (!(*tab->compare)(obj, b->object)) {
-			const void *obj2;
-
-			obj2 = ast_hashtab_remove_object_internal(tab, b, h);
-
-			return (void *) obj2; /* inside this code, the obj's are untouchable, but outside, they aren't */
-		}
-	}
-
-	return 0;
+	return ast_hashtab_remove_object_find(tab, obj, 0);
 }
 
 void *ast_hashtab_remove_this_object(struct ast_hashtab *tab, void *obj)
@@ -809,25 +1079,10 @@ void *ast_hashtab_remove_this_object(struct ast_hashtab *tab, void *obj)
 
 void *ast_hashtab_remove_this_object_nolock(struct ast_hashtab *tab, void *obj)
 {
-	/* looks up the object by hash and then comparing pts in bucket list instead of
+	/* looks up the object by hash and then comparing ptrs instead of
 	   calling the compare routine; removes the bucket -- a slightly cheaper operation */
-	/* looks up the object; removes the corresponding bucket */
-	unsigned int h;
-	struct ast_hashtab_bucket *b;
-
 	if (!tab || !obj)
 		return 0;
 
-	h = (*tab->hash)(obj) % tab->hash_tab_size;
-	for (b = tab->array[h]; b; b = b->next) {
-
-		if (obj == b->object) {
-			const void *obj2;
-			obj2 = ast_hashtab_remove_object_internal(tab, b, h);
-
-			return (void *) obj2; /* inside this code, the obj's are untouchable, but outside, they aren't */
-		}
-	}
-
-	return 0;
+	return ast_hashtab_remove_object_find(tab, obj, 1);
 }
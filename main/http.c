@@ -64,6 +64,13 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/netsock2.h"
 #include "asterisk/json.h"
+#include "asterisk/alertpipe.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+/*! \brief Persistent connections can wait for their next request without a thread */
+#define HTTP_KEEP_ALIVE_POLL
+#endif
 
 #define MAX_PREFIX 80
 #define DEFAULT_PORT 8088
@@ -75,8 +82,14 @@
 #define MIN_INITIAL_REQUEST_TIMEOUT	10000
 /*! (ms) Idle time between HTTP requests */
 #define DEFAULT_SESSION_KEEP_ALIVE 15000
+/*! Most threads that can serve the requests of persistent connections */
+#define HTTP_KEEP_ALIVE_THREADS_MAX 256
+/*! Connections the keep-alive poll thread handles per wakeup */
+#define HTTP_KEEP_ALIVE_EVENTS 64
 /*! Max size for the http server name */
 #define	MAX_SERVER_NAME_LENGTH 128
+/*! Bodies longer than this are written after the header rather than formatted with it */
+#define HTTP_INLINE_BODY_MAX 4096
 /*! Max size for the http response header */
 #define	DEFAULT_RESPONSE_HEADER_LENGTH 512
 
@@ -107,10 +120,13 @@ static int session_limit = DEFAULT_SESSION_LIMIT;
 static int session_inactivity = DEFAULT_SESSION_INACTIVITY;
 static int session_keep_alive = DEFAULT_SESSION_KEEP_ALIVE;
 static int session_count = 0;
+/*! Threads serving the requests of persistent connections, 0 if they have a thread each */
+static unsigned int session_keep_alive_threads;
 
 static struct ast_tls_config http_tls_cfg;
 
 static void *httpd_helper_thread(void *arg);
+static void *httpd_upgrade_thread(void *data);
 
 /*!
  * we have up to two accepting threads, one for http, one for https
@@ -237,6 +253,79 @@ void ast_http_prefix(char *buf, int len)
 	}
 }
 
+static void http_send_file(struct ast_tcptls_session_instance *ser,
+	enum ast_http_method method, int status_code, const char *status_title,
+	struct ast_str *http_header, struct ast_str *out, int fd,
+	off_t offset, off_t length, unsigned int static_content);
+
+/*!
+ * \internal
+ * \brief Parse the value of a Range header for a file of \a size bytes
+ *
+ * Only a single range is served, a set of them or a range not understood
+ * is ignored, and the whole file is sent, as RFC 7233 allows.
+ *
+ * \retval 0 The range is in \a offset and \a length
+ * \retval 1 The range is to be ignored
+ * \retval -1 The range is not satisfiable
+ */
+static int http_parse_range(const char *value, off_t size, off_t *offset, off_t *length)
+{
+	const char *spec;
+	char *end;
+	long long first;
+	long long last;
+
+	if (strncasecmp(value, "bytes=", 6) || strchr(value, ',')) {
+		return 1;
+	}
+	spec = ast_skip_blanks(value + 6);
+
+	if (*spec == '-') {
+		/* The last bytes of the file */
+		if (!isdigit(spec[1])) {
+			return 1;
+		}
+		last = strtoll(spec + 1, &end, 10);
+		if (*ast_skip_blanks(end)) {
+			return 1;
+		}
+		if (!last || !size) {
+			return -1;
+		}
+		*length = MIN(last, size);
+		*offset = size - *length;
+		return 0;
+	}
+
+	if (!isdigit(*spec)) {
+		return 1;
+	}
+	first = strtoll(spec, &end, 10);
+	if (*end != '-') {
+		return 1;
+	}
+	spec = ast_skip_blanks(end + 1);
+	if (!*spec) {
+		last = size - 1;
+	} else {
+		if (!isdigit(*spec)) {
+			return 1;
+		}
+		last = strtoll(spec, &end, 10);
+		if (*ast_skip_blanks(end) || last < first) {
+			return 1;
+		}
+	}
+	if (first >= size) {
+		return -1;
+	}
+	*offset = first;
+	*length = MIN(last, size - 1) - first + 1;
+
+	return 0;
+}
+
 static int static_callback(struct ast_tcptls_session_instance *ser,
 	const struct ast_http_uri *urih, const char *uri,
 	enum ast_http_method method, struct ast_variable *get_vars,
@@ -255,6 +344,11 @@ static int static_callback(struct ast_tcptls_session_instance *ser,
 	char timebuf[80], etag[23];
 	struct ast_variable *v;
 	int not_modified = 0;
+	const char *range = NULL;
+	const char *if_range = NULL;
+	off_t offset = 0;
+	off_t length = -1;
+	int ranged = 1;
 
 	if (method != AST_HTTP_GET && method != AST_HTTP_HEAD) {
 		ast_http_error(ser, 501, "Not Implemented", "Attempt to use unimplemented / unsupported method");
@@ -327,10 +421,18 @@ static int static_callback(struct ast_tcptls_session_instance *ser,
 			if (!strcasecmp(v->value, etag)) {
 				not_modified = 1;
 			}
-			break;
+		} else if (!strcasecmp(v->name, "Range")) {
+			range = v->value;
+		} else if (!strcasecmp(v->name, "If-Range")) {
+			if_range = v->value;
 		}
 	}
 
+	/* A range of a file changed since is of no use, the whole file is sent */
+	if (range && !not_modified && (!if_range || !strcasecmp(if_range, etag))) {
+		ranged = http_parse_range(range, st.st_size, &offset, &length);
+	}
+
 	http_header = ast_str_create(255);
 	if (!http_header) {
 		ast_http_request_close_on_completion(ser);
@@ -341,7 +443,8 @@ static int static_callback(struct ast_tcptls_session_instance *ser,
 
 	ast_str_set(&http_header, 0, "Content-type: %s\r\n"
 		"ETag: %s\r\n"
-		"Last-Modified: %s\r\n",
+		"Last-Modified: %s\r\n"
+		"Accept-Ranges: bytes\r\n",
 		mtype,
 		etag,
 		timebuf);
@@ -349,6 +452,13 @@ static int static_callback(struct ast_tcptls_session_instance *ser,
 	/* ast_http_send() frees http_header, so we don't need to do it before returning */
 	if (not_modified) {
 		ast_http_send(ser, method, 304, "Not Modified", http_header, NULL, 0, 1);
+	} else if (ranged < 0) {
+		ast_str_append(&http_header, 0, "Content-Range: bytes */%jd\r\n", (intmax_t) st.st_size);
+		http_send_file(ser, method, 416, "Range Not Satisfiable", http_header, NULL, 0, 0, 0, 1);
+	} else if (!ranged) {
+		ast_str_append(&http_header, 0, "Content-Range: bytes %jd-%jd/%jd\r\n",
+			(intmax_t) offset, (intmax_t) (offset + length - 1), (intmax_t) st.st_size);
+		http_send_file(ser, method, 206, "Partial Content", http_header, NULL, fd, offset, length, 1);
 	} else {
 		ast_http_send(ser, method, 200, NULL, http_header, NULL, fd, 1); /* static content flag is set */
 	}
@@ -443,6 +553,8 @@ enum http_private_flags {
 	HTTP_FLAG_BODY_READ = (1 << 1),
 	/*! TRUE if the HTTP request must close when completed. */
 	HTTP_FLAG_CLOSE_ON_COMPLETION = (1 << 2),
+	/*! TRUE if the connection is served by the keep-alive workers. */
+	HTTP_FLAG_KEEP_ALIVE_WORKER = (1 << 3),
 };
 
 /*! HTTP tcptls worker_fn private data. */
@@ -453,20 +565,26 @@ struct http_worker_private_data {
 	struct ast_flags flags;
 };
 
-void ast_http_send(struct ast_tcptls_session_instance *ser,
+/*!
+ * \internal
+ * \brief Send a response, with \a length bytes of the file from \a offset
+ *
+ * \note A \a length of -1 sends the file from \a offset to its end.
+ */
+static void http_send_file(struct ast_tcptls_session_instance *ser,
 	enum ast_http_method method, int status_code, const char *status_title,
 	struct ast_str *http_header, struct ast_str *out, int fd,
-	unsigned int static_content)
+	off_t offset, off_t length, unsigned int static_content)
 {
 	struct timeval now = ast_tvnow();
 	struct ast_tm tm;
 	char timebuf[80];
-	char buf[256];
-	int len;
-	int content_length = 0;
+	off_t content_length = 0;
 	int close_connection;
 	struct ast_str *server_header_field = ast_str_create(MAX_SERVER_NAME_LENGTH);
 	int send_content;
+	int send_body;
+	int write_body;
 
 	if (!ser || !server_header_field) {
 		/* The connection is not open. */
@@ -513,11 +631,17 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	}
 
 	if (fd) {
-		content_length += lseek(fd, 0, SEEK_END);
-		lseek(fd, 0, SEEK_SET);
+		if (length < 0) {
+			length = MAX(lseek(fd, 0, SEEK_END) - offset, 0);
+		}
+		content_length += length;
 	}
 
 	send_content = method != AST_HTTP_HEAD || status_code >= 400;
+	send_body = send_content && out && ast_str_strlen(out);
+	/* A large body is written as is, formatting it along with the header
+	 * would copy all of it once more */
+	write_body = send_body && ast_str_strlen(out) > HTTP_INLINE_BODY_MAX;
 
 	/* send http header */
 	if (ast_iostream_printf(ser->stream,
@@ -527,7 +651,7 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 		"%s"
 		"%s"
 		"%s"
-		"Content-Length: %d\r\n"
+		"Content-Length: %jd\r\n"
 		"\r\n"
 		"%s",
 		status_code, status_title ? status_title : "OK",
@@ -536,20 +660,20 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 		close_connection ? "Connection: close\r\n" : "",
 		static_content ? "" : "Cache-Control: no-cache, no-store\r\n",
 		http_header ? ast_str_buffer(http_header) : "",
-		content_length,
-		send_content && out && ast_str_strlen(out) ? ast_str_buffer(out) : ""
+		(intmax_t) content_length,
+		send_body && !write_body ? ast_str_buffer(out) : ""
 		) <= 0) {
 		ast_debug(1, "ast_iostream_printf() failed: %s\n", strerror(errno));
 		close_connection = 1;
-	} else if (send_content && fd) {
-		/* send file content */
-		while ((len = read(fd, buf, sizeof(buf))) > 0) {
-			if (ast_iostream_write(ser->stream, buf, len) != len) {
-				ast_debug(1, "ast_iostream_write() failed: %s\n", strerror(errno));
-				close_connection = 1;
-				break;
-			}
-		}
+	} else if (write_body
+		&& ast_iostream_write(ser->stream, ast_str_buffer(out), ast_str_strlen(out)) != ast_str_strlen(out)) {
+		ast_debug(1, "ast_iostream_write() failed: %s\n", strerror(errno));
+		close_connection = 1;
+	} else if (send_content && fd && length
+		&& ast_iostream_sendfile(ser->stream, fd, offset, length) != length) {
+		/* The length was sent, so the connection is of no use if it fell short */
+		ast_debug(1, "ast_iostream_sendfile() failed: %s\n", strerror(errno));
+		close_connection = 1;
 	}
 
 	ast_free(http_header);
@@ -564,6 +688,15 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	}
 }
 
+void ast_http_send(struct ast_tcptls_session_instance *ser,
+	enum ast_http_method method, int status_code, const char *status_title,
+	struct ast_str *http_header, struct ast_str *out, int fd,
+	unsigned int static_content)
+{
+	http_send_file(ser, method, status_code, status_title, http_header, out, fd,
+		0, -1, static_content);
+}
+
 void ast_http_create_response(struct ast_tcptls_session_instance *ser, int status_code,
 	const char *status_title, struct ast_str *http_header_data, const char *text)
 {
@@ -1826,6 +1959,92 @@ static int http_request_headers_get(struct ast_tcptls_session_instance *ser, str
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Handle a HTTP request whose headers were read.
+ *
+ * \param ser HTTP TCP/TLS session object.
+ * \param uri The requested URI.
+ * \param http_method The request method.
+ * \param headers The request headers.
+ *
+ * \retval 0 Continue and process the next HTTP request.
+ * \retval -1 Fatal HTTP connection error.  Force the HTTP connection closed.
+ */
+static int httpd_handle_request(struct ast_tcptls_session_instance *ser, char *uri,
+	enum ast_http_method http_method, struct ast_variable *headers)
+{
+	struct http_worker_private_data *request = ser->private_data;
+	const char *transfer_encoding;
+	int res;
+
+	transfer_encoding = get_transfer_encoding(headers);
+	/* Transfer encoding defaults to identity */
+	if (!transfer_encoding) {
+		transfer_encoding = "identity";
+	}
+
+	/*
+	 * RFC 2616, section 3.6, we should respond with a 501 for any transfer-
+	 * codings we don't understand.
+	 */
+	if (strcasecmp(transfer_encoding, "identity") != 0 &&
+		strcasecmp(transfer_encoding, "chunked") != 0) {
+		/* Transfer encodings not supported */
+		ast_http_error(ser, 501, "Unimplemented", "Unsupported Transfer-Encoding.");
+		return -1;
+	}
+
+	if (http_request_tracking_setup(ser, headers)
+		|| handle_uri(ser, uri, http_method, headers)
+		|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)) {
+		res = -1;
+	} else {
+		res = 0;
+	}
+	return res;
+}
+
+/*! \brief A request of a persistent connection handed from a worker to a thread of its own */
+struct http_upgrade {
+	struct ast_tcptls_session_instance *ser;
+	enum ast_http_method method;
+	struct ast_variable *headers;
+	char uri[0];
+};
+
+/*!
+ * \internal
+ * \brief Give the connection a request to upgrade arrived on a thread of its own
+ *
+ * An upgraded connection, like a websocket, is served by the thread of the
+ * request for as long as it stays open, so it must not use a worker.
+ *
+ * \retval 0 on success, the headers and the reference of ser are taken.
+ * \retval -1 on failure.
+ */
+static int httpd_upgrade_start(struct ast_tcptls_session_instance *ser, const char *uri,
+	enum ast_http_method method, struct ast_variable *headers)
+{
+	struct http_upgrade *upgrade;
+	pthread_t thread;
+
+	upgrade = ast_calloc(1, sizeof(*upgrade) + strlen(uri) + 1);
+	if (!upgrade) {
+		return -1;
+	}
+	upgrade->ser = ser;
+	upgrade->method = method;
+	upgrade->headers = headers;
+	strcpy(upgrade->uri, uri); /* Safe */
+
+	if (ast_pthread_create_detached_background(&thread, NULL, httpd_upgrade_thread, upgrade)) {
+		ast_free(upgrade);
+		return -1;
+	}
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Process a HTTP request.
@@ -1835,16 +2054,15 @@ static int http_request_headers_get(struct ast_tcptls_session_instance *ser, str
  *
  * \retval 0 Continue and process the next HTTP request.
  * \retval -1 Fatal HTTP connection error.  Force the HTTP connection closed.
+ * \retval 1 The connection was handed to a thread of its own.
  */
 static int httpd_process_request(struct ast_tcptls_session_instance *ser)
 {
 	RAII_VAR(struct ast_variable *, headers, NULL, ast_variables_destroy);
 	char *uri;
 	char *method;
-	const char *transfer_encoding;
 	struct http_worker_private_data *request;
 	enum ast_http_method http_method = AST_HTTP_UNKNOWN;
-	int res;
 	ssize_t len;
 	char request_line[MAX_HTTP_LINE_LENGTH];
 
@@ -1907,31 +2125,444 @@ static int httpd_process_request(struct ast_tcptls_session_instance *ser)
 		return -1;
 	}
 
-	transfer_encoding = get_transfer_encoding(headers);
-	/* Transfer encoding defaults to identity */
-	if (!transfer_encoding) {
-		transfer_encoding = "identity";
+	if (ast_test_flag(&request->flags, HTTP_FLAG_KEEP_ALIVE_WORKER)
+		&& get_header(headers, "Upgrade")) {
+		if (httpd_upgrade_start(ser, uri, http_method, headers)) {
+			ast_http_error(ser, 500, "Server Error", "Internal Server Error");
+			return -1;
+		}
+		headers = NULL;
+		return 1;
 	}
 
-	/*
-	 * RFC 2616, section 3.6, we should respond with a 501 for any transfer-
-	 * codings we don't understand.
-	 */
-	if (strcasecmp(transfer_encoding, "identity") != 0 &&
-		strcasecmp(transfer_encoding, "chunked") != 0) {
-		/* Transfer encodings not supported */
-		ast_http_error(ser, 501, "Unimplemented", "Unsupported Transfer-Encoding.");
+	return httpd_handle_request(ser, uri, http_method, headers);
+}
+
+/*!
+ * \internal
+ * \brief Close a connection once no more requests are served on it
+ */
+static void httpd_session_done(struct ast_tcptls_session_instance *ser)
+{
+	ast_atomic_fetchadd_int(&session_count, -1);
+
+	ast_debug(1, "HTTP closing session.  Top level\n");
+	ast_tcptls_close_session_file(ser);
+
+	ao2_ref(ser, -1);
+}
+
+#ifdef HTTP_KEEP_ALIVE_POLL
+/*! \brief A persistent connection waiting for its next request */
+struct http_idle_session {
+	struct ast_tcptls_session_instance *ser;
+	/*! When the connection is closed if no request came */
+	struct timeval expires;
+	AST_LIST_ENTRY(http_idle_session) list;
+};
+
+/*!
+ * \brief Persistent connections waiting for their next request without a thread
+ *
+ * \details A thread waits on the connections with epoll, and a fixed number
+ * of workers serve the requests that arrive on them.
+ */
+static struct {
+	/*! epoll instance with the idle connections and the alert pipe */
+	int epfd;
+	/*! Wakes the poll thread up to exit or to wait for a new expiration */
+	int alert_pipe[2];
+	pthread_t poll_thread;
+	pthread_t *workers;
+	/*! Number of workers started */
+	unsigned int num_workers;
+	/*! Signalled when a connection is ready or the threads should exit */
+	ast_cond_t cond;
+	/*! Set when the threads should exit (Protected by keep_alive_lock) */
+	unsigned int stop;
+	/*! Number of connections in idle (Protected by keep_alive_lock) */
+	unsigned int num_idle;
+	/*! Connections waiting for a request, by expiration (Protected by keep_alive_lock) */
+	AST_LIST_HEAD_NOLOCK(, http_idle_session) idle;
+	/*! Connections a request arrived on (Protected by keep_alive_lock) */
+	AST_LIST_HEAD_NOLOCK(, http_idle_session) ready;
+} keep_alive = {
+	.epfd = -1,
+	.poll_thread = AST_PTHREADT_NULL,
+};
+
+AST_MUTEX_DEFINE_STATIC(keep_alive_lock);
+
+/*!
+ * \internal
+ * \brief Have a connection wait for its next request without a thread
+ *
+ * \param ser HTTP TCP/TLS session object, its reference is kept on success.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the caller keeps serving the connection.
+ */
+static int http_keep_alive_park(struct ast_tcptls_session_instance *ser)
+{
+	struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP, };
+	struct http_idle_session *idle;
+	int was_empty;
+
+	idle = ast_calloc(1, sizeof(*idle));
+	if (!idle) {
 		return -1;
 	}
+	idle->ser = ser;
+	idle->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(session_keep_alive, 1000));
+	event.data.ptr = idle;
 
-	if (http_request_tracking_setup(ser, headers)
-		|| handle_uri(ser, uri, http_method, headers)
-		|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)) {
-		res = -1;
+	ast_mutex_lock(&keep_alive_lock);
+	if (keep_alive.epfd < 0 || keep_alive.stop
+		|| epoll_ctl(keep_alive.epfd, EPOLL_CTL_ADD, ast_iostream_get_fd(ser->stream), &event)) {
+		ast_mutex_unlock(&keep_alive_lock);
+		ast_free(idle);
+		return -1;
+	}
+	was_empty = AST_LIST_EMPTY(&keep_alive.idle);
+	AST_LIST_INSERT_TAIL(&keep_alive.idle, idle, list);
+	++keep_alive.num_idle;
+	ast_mutex_unlock(&keep_alive_lock);
+
+	if (was_empty) {
+		/* The poll thread was not waiting for anything to expire */
+		ast_alertpipe_write(keep_alive.alert_pipe);
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Take a connection out of the epoll instance
+ *
+ * \note keep_alive_lock is assumed held.
+ */
+static void http_keep_alive_unpark(struct http_idle_session *idle)
+{
+	AST_LIST_REMOVE(&keep_alive.idle, idle, list);
+	--keep_alive.num_idle;
+	epoll_ctl(keep_alive.epfd, EPOLL_CTL_DEL, ast_iostream_get_fd(idle->ser->stream), NULL);
+}
+
+static void *http_keep_alive_poll(void *data)
+{
+	struct epoll_event events[HTTP_KEEP_ALIVE_EVENTS];
+	AST_LIST_HEAD_NOLOCK(, http_idle_session) expired;
+	struct http_idle_session *idle;
+	int timeout;
+	int count;
+	int i;
+
+	for (;;) {
+		struct timeval now = ast_tvnow();
+
+		AST_LIST_HEAD_INIT_NOLOCK(&expired);
+		timeout = -1;
+
+		ast_mutex_lock(&keep_alive_lock);
+		if (keep_alive.stop) {
+			ast_mutex_unlock(&keep_alive_lock);
+			break;
+		}
+		while ((idle = AST_LIST_FIRST(&keep_alive.idle))) {
+			timeout = ast_tvdiff_ms(idle->expires, now);
+			if (timeout > 0) {
+				break;
+			}
+			http_keep_alive_unpark(idle);
+			AST_LIST_INSERT_TAIL(&expired, idle, list);
+			timeout = -1;
+		}
+		ast_mutex_unlock(&keep_alive_lock);
+
+		while ((idle = AST_LIST_REMOVE_HEAD(&expired, list))) {
+			httpd_session_done(idle->ser);
+			ast_free(idle);
+		}
+
+		count = epoll_wait(keep_alive.epfd, events, ARRAY_LEN(events), timeout);
+		if (count < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_WARNING, "HTTP keep-alive wait failed: %s\n", strerror(errno));
+			}
+			continue;
+		}
+
+		/* Only this thread takes connections out of idle, so they are all still there. */
+		ast_mutex_lock(&keep_alive_lock);
+		for (i = 0; i < count; ++i) {
+			idle = events[i].data.ptr;
+			if (!idle) {
+				ast_alertpipe_read(keep_alive.alert_pipe);
+				continue;
+			}
+			http_keep_alive_unpark(idle);
+			AST_LIST_INSERT_TAIL(&keep_alive.ready, idle, list);
+			ast_cond_signal(&keep_alive.cond);
+		}
+		ast_mutex_unlock(&keep_alive_lock);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Serve the requests that arrived on a persistent connection
+ *
+ * \details The connection waits for the next one without a thread again
+ * afterwards, unless it is closed or handed to a thread of its own.
+ */
+static void http_keep_alive_serve(struct ast_tcptls_session_instance *ser)
+{
+	struct http_worker_private_data *request = ser->private_data;
+	int res;
+
+	ast_set_flag(&request->flags, HTTP_FLAG_KEEP_ALIVE_WORKER);
+	do {
+		/* The request already started to arrive */
+		ast_iostream_set_timeout_inactivity(ser->stream, session_inactivity);
+		res = httpd_process_request(ser);
+		if (res > 0) {
+			return;
+		}
+	} while (!res && ser->stream && session_keep_alive > 0
+		&& ast_iostream_has_pending_input(ser->stream));
+
+	if (!res && ser->stream && session_keep_alive > 0 && !http_keep_alive_park(ser)) {
+		return;
+	}
+	httpd_session_done(ser);
+}
+
+static void *http_keep_alive_worker(void *data)
+{
+	struct http_idle_session *idle;
+
+	ast_mutex_lock(&keep_alive_lock);
+	for (;;) {
+		while (!keep_alive.stop && AST_LIST_EMPTY(&keep_alive.ready)) {
+			ast_cond_wait(&keep_alive.cond, &keep_alive_lock);
+		}
+		if (keep_alive.stop) {
+			break;
+		}
+		idle = AST_LIST_REMOVE_HEAD(&keep_alive.ready, list);
+		ast_mutex_unlock(&keep_alive_lock);
+
+		http_keep_alive_serve(idle->ser);
+		ast_free(idle);
+
+		ast_mutex_lock(&keep_alive_lock);
+	}
+	ast_mutex_unlock(&keep_alive_lock);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Stop the keep-alive threads, closing the connections waiting for a request
+ */
+static void http_keep_alive_stop(void)
+{
+	AST_LIST_HEAD_NOLOCK(, http_idle_session) closing;
+	struct http_idle_session *idle;
+	unsigned int i;
+
+	if (keep_alive.epfd < 0) {
+		return;
+	}
+
+	ast_mutex_lock(&keep_alive_lock);
+	keep_alive.stop = 1;
+	ast_cond_broadcast(&keep_alive.cond);
+	ast_mutex_unlock(&keep_alive_lock);
+
+	if (keep_alive.poll_thread != AST_PTHREADT_NULL) {
+		ast_alertpipe_write(keep_alive.alert_pipe);
+		pthread_join(keep_alive.poll_thread, NULL);
+		keep_alive.poll_thread = AST_PTHREADT_NULL;
+	}
+	/* Requests being served finish, their connections are closed afterwards */
+	for (i = 0; i < keep_alive.num_workers; ++i) {
+		pthread_join(keep_alive.workers[i], NULL);
+	}
+	ast_free(keep_alive.workers);
+	keep_alive.workers = NULL;
+	keep_alive.num_workers = 0;
+
+	AST_LIST_HEAD_INIT_NOLOCK(&closing);
+	ast_mutex_lock(&keep_alive_lock);
+	while ((idle = AST_LIST_FIRST(&keep_alive.idle))) {
+		http_keep_alive_unpark(idle);
+		AST_LIST_INSERT_TAIL(&closing, idle, list);
+	}
+	AST_LIST_APPEND_LIST(&closing, &keep_alive.ready, list);
+	close(keep_alive.epfd);
+	keep_alive.epfd = -1;
+	keep_alive.stop = 0;
+	ast_mutex_unlock(&keep_alive_lock);
+
+	while ((idle = AST_LIST_REMOVE_HEAD(&closing, list))) {
+		httpd_session_done(idle->ser);
+		ast_free(idle);
+	}
+
+	ast_alertpipe_close(keep_alive.alert_pipe);
+	ast_cond_destroy(&keep_alive.cond);
+}
+
+/*!
+ * \internal
+ * \brief Start the keep-alive threads
+ *
+ * \param count Number of workers serving the requests
+ *
+ * \retval 0 on success.
+ * \retval -1 on failure, persistent connections keep their thread.
+ */
+static int http_keep_alive_start(unsigned int count)
+{
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL, };
+
+	if (ast_alertpipe_init(keep_alive.alert_pipe)) {
+		ast_log(LOG_ERROR, "Could not start the HTTP keep-alive threads\n");
+		return -1;
+	}
+	ast_cond_init(&keep_alive.cond, NULL);
+	keep_alive.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (keep_alive.epfd < 0) {
+		ast_alertpipe_close(keep_alive.alert_pipe);
+		ast_cond_destroy(&keep_alive.cond);
+		ast_log(LOG_ERROR, "Could not start the HTTP keep-alive threads\n");
+		return -1;
+	}
+
+	keep_alive.workers = ast_calloc(count, sizeof(*keep_alive.workers));
+	if (!keep_alive.workers
+		|| epoll_ctl(keep_alive.epfd, EPOLL_CTL_ADD, ast_alertpipe_readfd(keep_alive.alert_pipe), &event)
+		|| ast_pthread_create_background(&keep_alive.poll_thread, NULL, http_keep_alive_poll, NULL)) {
+		keep_alive.poll_thread = AST_PTHREADT_NULL;
+		http_keep_alive_stop();
+		ast_log(LOG_ERROR, "Could not start the HTTP keep-alive threads\n");
+		return -1;
+	}
+	for (; keep_alive.num_workers < count; ++keep_alive.num_workers) {
+		if (ast_pthread_create_background(&keep_alive.workers[keep_alive.num_workers], NULL,
+			http_keep_alive_worker, NULL)) {
+			http_keep_alive_stop();
+			ast_log(LOG_ERROR, "Could not start the HTTP keep-alive threads\n");
+			return -1;
+		}
+	}
+
+	ast_debug(1, "Started %u HTTP keep-alive workers\n", count);
+	return 0;
+}
+
+/*! \brief Number of threads serving the requests of persistent connections */
+static unsigned int http_keep_alive_threads(void)
+{
+	return keep_alive.num_workers;
+}
+
+/*! \brief Number of persistent connections waiting for a request */
+static unsigned int http_keep_alive_idle(void)
+{
+	unsigned int num_idle;
+
+	ast_mutex_lock(&keep_alive_lock);
+	num_idle = keep_alive.num_idle;
+	ast_mutex_unlock(&keep_alive_lock);
+
+	return num_idle;
+}
+#else
+static int http_keep_alive_park(struct ast_tcptls_session_instance *ser)
+{
+	return -1;
+}
+
+static void http_keep_alive_stop(void)
+{
+}
+
+static int http_keep_alive_start(unsigned int count)
+{
+	ast_log(LOG_WARNING, "Persistent HTTP connections always have a thread of their own on this platform\n");
+	return -1;
+}
+
+static unsigned int http_keep_alive_threads(void)
+{
+	return 0;
+}
+
+static unsigned int http_keep_alive_idle(void)
+{
+	return 0;
+}
+#endif
+
+/*!
+ * \internal
+ * \brief Serve the requests of a connection on a thread of its own
+ *
+ * \param ser HTTP TCP/TLS session object, its reference is given to the function.
+ * \param timeout The time to wait for the first request
+ */
+static void httpd_session_run(struct ast_tcptls_session_instance *ser, int timeout)
+{
+	for (;;) {
+		/* Wait for next potential HTTP request message. */
+		ast_iostream_set_timeout_idle_inactivity(ser->stream, timeout, session_inactivity);
+		if (httpd_process_request(ser)) {
+			/* Break the connection or the connection closed */
+			break;
+		}
+		if (!ser->stream) {
+			/* Web-socket or similar that took the connection */
+			break;
+		}
+
+		timeout = session_keep_alive;
+		if (timeout <= 0) {
+			/* Persistent connections not enabled. */
+			break;
+		}
+
+		if (!ast_iostream_has_pending_input(ser->stream) && !http_keep_alive_park(ser)) {
+			/* The next request is served by the keep-alive workers */
+			return;
+		}
+	}
+
+	httpd_session_done(ser);
+}
+
+static void *httpd_upgrade_thread(void *data)
+{
+	struct http_upgrade *upgrade = data;
+	struct ast_tcptls_session_instance *ser = upgrade->ser;
+	struct http_worker_private_data *request = ser->private_data;
+	int res;
+
+	ast_clear_flag(&request->flags, HTTP_FLAG_KEEP_ALIVE_WORKER);
+	res = httpd_handle_request(ser, upgrade->uri, upgrade->method, upgrade->headers);
+	ast_variables_destroy(upgrade->headers);
+	ast_free(upgrade);
+
+	if (res || !ser->stream || session_keep_alive <= 0) {
+		httpd_session_done(ser);
 	} else {
-		res = 0;
+		httpd_session_run(ser, session_keep_alive);
 	}
-	return res;
+	return NULL;
 }
 
 static void *httpd_helper_thread(void *data)
@@ -1985,32 +2616,11 @@ static void *httpd_helper_thread(void *data)
 	/* We can let the stream wait for data to arrive. */
 	ast_iostream_set_exclusive_input(ser->stream, 1);
 
-	for (;;) {
-		/* Wait for next potential HTTP request message. */
-		ast_iostream_set_timeout_idle_inactivity(ser->stream, timeout, session_inactivity);
-		if (httpd_process_request(ser)) {
-			/* Break the connection or the connection closed */
-			break;
-		}
-		if (!ser->stream) {
-			/* Web-socket or similar that took the connection */
-			break;
-		}
-
-		timeout = session_keep_alive;
-		if (timeout <= 0) {
-			/* Persistent connections not enabled. */
-			break;
-		}
-	}
+	httpd_session_run(ser, timeout);
+	return NULL;
 
 done:
-	ast_atomic_fetchadd_int(&session_count, -1);
-
-	ast_debug(1, "HTTP closing session.  Top level\n");
-	ast_tcptls_close_session_file(ser);
-
-	ao2_ref(ser, -1);
+	httpd_session_done(ser);
 	return NULL;
 }
 
@@ -2114,6 +2724,10 @@ static int __ast_http_load(int reload)
 	ast_free(http_tls_cfg.pvtfile);
 	http_tls_cfg.pvtfile = ast_strdup("");
 
+	http_tls_cfg.session_cache_size = 0;
+	http_tls_cfg.session_timeout = 0;
+	http_tls_cfg.ticket_key_lifetime = 0;
+
 	/* Apply modern intermediate settings according to the Mozilla OpSec team as of July 30th, 2015 but disable TLSv1 */
 	ast_set_flag(&http_tls_cfg.flags, AST_SSL_DISABLE_TLSV1 | AST_SSL_SERVER_CIPHER_ORDER);
 
@@ -2131,6 +2745,7 @@ static int __ast_http_load(int reload)
 	session_limit = DEFAULT_SESSION_LIMIT;
 	session_inactivity = DEFAULT_SESSION_INACTIVITY;
 	session_keep_alive = DEFAULT_SESSION_KEEP_ALIVE;
+	session_keep_alive_threads = 0;
 
 	snprintf(server_name, sizeof(server_name), "Asterisk/%s", ast_get_version());
 
@@ -2198,6 +2813,12 @@ static int __ast_http_load(int reload)
 				ast_log(LOG_WARNING, "Invalid %s '%s' at line %d of http.conf\n",
 					v->name, v->value, v->lineno);
 			}
+		} else if (!strcasecmp(v->name, "session_keep_alive_threads")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT | PARSE_IN_RANGE,
+				&session_keep_alive_threads, 0, 0, HTTP_KEEP_ALIVE_THREADS_MAX)) {
+				ast_log(LOG_WARNING, "Invalid %s '%s' at line %d of http.conf\n",
+					v->name, v->value, v->lineno);
+			}
 		} else {
 			ast_log(LOG_WARNING, "Ignoring unknown option '%s' in http.conf\n", v->name);
 		}
@@ -2211,6 +2832,14 @@ static int __ast_http_load(int reload)
 
 	ast_copy_string(http_server_name, server_name, sizeof(http_server_name));
 
+	if (session_keep_alive_threads != http_keep_alive_threads()) {
+		/* The connections waiting for a request are closed, their clients reconnect */
+		http_keep_alive_stop();
+		if (session_keep_alive_threads) {
+			http_keep_alive_start(session_keep_alive_threads);
+		}
+	}
+
 	if (num_addrs && enabled) {
 		int i;
 		for (i = 0; i < num_addrs; ++i) {
@@ -2307,6 +2936,11 @@ static char *handle_show_http(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 		}
 	}
 
+	if (http_keep_alive_threads()) {
+		ast_cli(a->fd, "Persistent connections waiting for a request: %u, served by %u threads\n\n",
+			http_keep_alive_idle(), http_keep_alive_threads());
+	}
+
 	ast_cli(a->fd, "Enabled URI's:\n");
 	AST_RWLIST_RDLOCK(&uris);
 	if (AST_RWLIST_EMPTY(&uris)) {
@@ -2347,6 +2981,7 @@ static int unload_module(void)
 	if (http_tls_cfg.enabled) {
 		ast_tcptls_server_stop(&https_desc);
 	}
+	http_keep_alive_stop();
 	ast_free(http_tls_cfg.certfile);
 	ast_free(http_tls_cfg.capath);
 	ast_free(http_tls_cfg.pvtfile);
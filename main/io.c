@@ -33,6 +33,7 @@
 #include <sys/ioctl.h>
 
 #include "asterisk/io.h"
+#include "asterisk/dlinkedlists.h"
 #include "asterisk/utils.h"
 #ifdef HAVE_SYSTEMD
 #include <systemd/sd-daemon.h>
@@ -48,6 +49,266 @@
 #define DEBUG(a)
 #endif
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+/*! \brief Wait on the descriptors with epoll, which costs no more for a wait with many of them */
+#define IO_EPOLL
+#endif
+
+#ifdef IO_EPOLL
+/*! \brief Most events taken from epoll by one wait, more are taken by the next */
+#define IO_EPOLL_EVENTS 256
+
+/*! \brief
+ * Kept for each file descriptor
+ */
+struct io_rec {
+	ast_io_cb callback;		/*!< What is to be called */
+	void *data;			/*!< Data to be passed */
+	int id;				/*!< ID number, handed out as a pointer to it */
+	int fd;				/*!< The file descriptor */
+	short events;			/*!< Events waited for */
+	unsigned int removed:1;		/*!< Removed while the callbacks were called */
+	AST_DLLIST_ENTRY(io_rec) list;
+};
+
+/*! \brief Global IO variables are now in a struct in order to be
+   made threadsafe */
+struct io_context {
+	int epfd;                     /*!< The epoll instance of the descriptors */
+	unsigned int fdcnt;           /*!< Records in use */
+	int next_id;                  /*!< ID of the next record added */
+	int waiting;                  /*!< Whether the callbacks are being called */
+	AST_DLLIST_HEAD_NOLOCK(, io_rec) recs;     /*!< Records in use */
+	AST_DLLIST_HEAD_NOLOCK(, io_rec) removed;  /*!< Records removed while waiting, freed after */
+};
+
+/*! \brief Create an I/O context */
+struct io_context *io_context_create(void)
+{
+	struct io_context *tmp;
+
+	if (!(tmp = ast_calloc(1, sizeof(*tmp))))
+		return NULL;
+
+	tmp->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (tmp->epfd < 0) {
+		ast_log(LOG_ERROR, "Unable to create epoll instance: %s\n", strerror(errno));
+		ast_free(tmp);
+		return NULL;
+	}
+	AST_DLLIST_HEAD_INIT_NOLOCK(&tmp->recs);
+	AST_DLLIST_HEAD_INIT_NOLOCK(&tmp->removed);
+
+	return tmp;
+}
+
+void io_context_destroy(struct io_context *ioc)
+{
+	struct io_rec *rec;
+
+	while ((rec = AST_DLLIST_REMOVE_HEAD(&ioc->recs, list))) {
+		ast_free(rec);
+	}
+	while ((rec = AST_DLLIST_REMOVE_HEAD(&ioc->removed, list))) {
+		ast_free(rec);
+	}
+	close(ioc->epfd);
+
+	ast_free(ioc);
+}
+
+/*!
+ * \brief The record of an ID handed out by ast_io_add()
+ *
+ * The ID is looked for rather than dereferenced, as callers may pass one
+ * already removed and freed.
+ */
+static struct io_rec *io_rec_find(struct io_context *ioc, int *id)
+{
+	struct io_rec *rec;
+
+	AST_DLLIST_TRAVERSE(&ioc->recs, rec, list) {
+		if (&rec->id == id) {
+			return rec;
+		}
+	}
+
+	return NULL;
+}
+
+/*! \brief Wait for the events of a record, the poll() and epoll events are the same on Linux */
+static int io_rec_ctl(struct io_context *ioc, int op, struct io_rec *rec)
+{
+	struct epoll_event event = { .events = rec->events, .data.ptr = rec, };
+
+	return epoll_ctl(ioc->epfd, op, rec->fd, &event);
+}
+
+/*! \brief
+ * Add a new I/O entry for this file descriptor
+ * with the given event mask, to call callback with
+ * data as an argument.
+ * \return Returns NULL on failure.
+ */
+int *ast_io_add(struct io_context *ioc, int fd, ast_io_cb callback, short events, void *data)
+{
+	struct io_rec *rec;
+
+	DEBUG(ast_debug(1, "ast_io_add()\n"));
+
+	if (!(rec = ast_calloc(1, sizeof(*rec))))
+		return NULL;
+
+	rec->callback = callback;
+	rec->data = data;
+	rec->fd = fd;
+	rec->events = events;
+	rec->id = ioc->next_id++;
+
+	if (io_rec_ctl(ioc, EPOLL_CTL_ADD, rec)) {
+		ast_log(LOG_WARNING, "Unable to wait on fd %d: %s\n", fd, strerror(errno));
+		ast_free(rec);
+		return NULL;
+	}
+
+	AST_DLLIST_INSERT_TAIL(&ioc->recs, rec, list);
+	ioc->fdcnt++;
+
+	return &rec->id;
+}
+
+int *ast_io_change(struct io_context *ioc, int *id, int fd, ast_io_cb callback, short events, void *data)
+{
+	struct io_rec *rec = io_rec_find(ioc, id);
+
+	if (!rec)
+		return NULL;
+
+	if (callback)
+		rec->callback = callback;
+	if (data)
+		rec->data = data;
+
+	if (fd > -1) {
+		/* The old descriptor may have been closed, which took it out of the
+		 * instance, and the new one may have the same number, so it is always
+		 * added again. */
+		epoll_ctl(ioc->epfd, EPOLL_CTL_DEL, rec->fd, NULL);
+		rec->fd = fd;
+		if (events)
+			rec->events = events;
+		if (io_rec_ctl(ioc, EPOLL_CTL_ADD, rec)) {
+			ast_log(LOG_WARNING, "Unable to wait on fd %d: %s\n", fd, strerror(errno));
+			return NULL;
+		}
+	} else if (events && events != rec->events) {
+		rec->events = events;
+		if (io_rec_ctl(ioc, EPOLL_CTL_MOD, rec)) {
+			ast_log(LOG_WARNING, "Unable to change events of fd %d: %s\n", rec->fd, strerror(errno));
+			return NULL;
+		}
+	}
+
+	return id;
+}
+
+int ast_io_remove(struct io_context *ioc, int *_id)
+{
+	struct io_rec *rec;
+
+	if (!_id) {
+		ast_log(LOG_WARNING, "Asked to remove NULL?\n");
+		return -1;
+	}
+
+	rec = io_rec_find(ioc, _id);
+	if (!rec) {
+		ast_log(LOG_NOTICE, "Unable to remove unknown id %p\n", _id);
+		return -1;
+	}
+
+	/* The descriptor must still be open, as one opened since with the same
+	 * number would be taken out of the instance in its place. */
+	epoll_ctl(ioc->epfd, EPOLL_CTL_DEL, rec->fd, NULL);
+	AST_DLLIST_REMOVE(&ioc->recs, rec, list);
+	ioc->fdcnt--;
+
+	if (ioc->waiting) {
+		/* An event of the record may still be waiting to be handled */
+		rec->removed = 1;
+		AST_DLLIST_INSERT_TAIL(&ioc->removed, rec, list);
+	} else {
+		ast_free(rec);
+	}
+
+	return 0;
+}
+
+/*! \brief
+ * Make the epoll call, and call
+ * the callbacks for anything that needs
+ * to be handled
+ */
+int ast_io_wait(struct io_context *ioc, int howlong)
+{
+	struct epoll_event events[IO_EPOLL_EVENTS];
+	struct io_rec *rec;
+	int res, x;
+
+	DEBUG(ast_debug(1, "ast_io_wait()\n"));
+
+	if ((res = epoll_wait(ioc->epfd, events, ARRAY_LEN(events), howlong)) <= 0) {
+		return res;
+	}
+
+	ioc->waiting = 1;
+	for (x = 0; x < res; x++) {
+		rec = events[x].data.ptr;
+		/* Yes, it is possible for an entry to be deleted and still have an
+		   event waiting if it occurs after the original calling id */
+		if (rec->removed || !rec->callback) {
+			continue;
+		}
+		if (!rec->callback(&rec->id, rec->fd, events[x].events, rec->data)) {
+			/* Time to delete them since they returned a 0 */
+			ast_io_remove(ioc, &rec->id);
+		}
+	}
+	ioc->waiting = 0;
+
+	while ((rec = AST_DLLIST_REMOVE_HEAD(&ioc->removed, list))) {
+		ast_free(rec);
+	}
+
+	return res;
+}
+
+void ast_io_dump(struct io_context *ioc)
+{
+	/*
+	 * Print some debugging information via
+	 * the logger interface
+	 */
+	struct io_rec *rec;
+
+	ast_debug(1, "Asterisk IO Dump: %u entries (epoll)\n", ioc->fdcnt);
+	ast_debug(1, "================================================\n");
+	ast_debug(1, "| ID    FD     Callback    Data        Events  |\n");
+	ast_debug(1, "+------+------+-----------+-----------+--------+\n");
+	AST_DLLIST_TRAVERSE(&ioc->recs, rec, list) {
+		ast_debug(1, "| %.4d | %.4d | %p | %p | %.6x |\n",
+				rec->id,
+				rec->fd,
+				rec->callback,
+				rec->data,
+				(unsigned)rec->events);
+	}
+	ast_debug(1, "================================================\n");
+}
+
+#else /* !IO_EPOLL */
+
 /*! \brief
  * Kept for each file descriptor
  */
@@ -331,6 +592,7 @@ void ast_io_dump(struct io_context *ioc)
 	}
 	ast_debug(1, "================================================\n");
 }
+#endif /* IO_EPOLL */
 
 /* Unrelated I/O functions */
 
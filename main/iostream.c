@@ -27,6 +27,9 @@
 #include <openssl/ssl.h>                /* for SSL_get_error, SSL_free, SSL_... */
 #endif
 #include <sys/socket.h>                 /* for shutdown, SHUT_RDWR */
+#ifdef __linux__
+#include <sys/sendfile.h>               /* for sendfile */
+#endif
 #include <sys/time.h>                   /* for timeval */
 
 #include "asterisk/astobj2.h"           /* for ao2_alloc_options, ao2_alloc_... */
@@ -100,6 +103,19 @@ int ast_iostream_wait_for_input(struct ast_iostream *stream, int timeout)
 	return ast_wait_for_input(stream->fd, timeout);
 }
 
+int ast_iostream_has_pending_input(struct ast_iostream *stream)
+{
+	if (stream->rbuflen) {
+		return 1;
+	}
+#if defined(DO_SSL)
+	if (stream->ssl && SSL_pending(stream->ssl)) {
+		return 1;
+	}
+#endif
+	return 0;
+}
+
 void ast_iostream_nonblock(struct ast_iostream *stream)
 {
 	ast_fd_set_flags(stream->fd, O_NONBLOCK);
@@ -488,6 +504,76 @@ ssize_t ast_iostream_write(struct ast_iostream *stream, const void *buffer, size
 	}
 }
 
+ssize_t ast_iostream_sendfile(struct ast_iostream *stream, int fd, off_t offset, size_t count)
+{
+	char buf[16384];
+	size_t written = 0;
+	ssize_t res;
+
+	if (!stream || stream->fd == -1) {
+		errno = EBADF;
+		return -1;
+	}
+
+#ifdef __linux__
+	if (!stream->ssl) {
+		struct timeval start;
+		int ms;
+
+		if (stream->start.tv_sec) {
+			start = stream->start;
+		} else {
+			start = ast_tvnow();
+		}
+
+		/* The kernel copies the file straight to the socket */
+		while (written < count) {
+			res = sendfile(stream->fd, fd, &offset, count - written);
+			if (0 < res) {
+				written += res;
+				continue;
+			}
+			if (!res) {
+				/* The file is shorter than it was said to be. */
+				break;
+			}
+			if (errno == EINVAL || errno == ENOSYS) {
+				/* Not a file sendfile() can copy from, copy it below. */
+				break;
+			}
+			if (errno != EINTR && errno != EAGAIN) {
+				ast_debug(1, "TCP socket error sending file: %s\n", strerror(errno));
+				return written ? written : -1;
+			}
+			ms = ast_remaining_ms(start, stream->timeout);
+			if (!ms) {
+				/* Report partial write. */
+				ast_debug(1, "TCP timeout sending file\n");
+				return written;
+			}
+			ast_wait_for_output(stream->fd, ms);
+		}
+		if (written == count || !res) {
+			return written;
+		}
+	}
+#endif
+
+	while (written < count) {
+		res = pread(fd, buf, MIN(sizeof(buf), count - written), offset);
+		if (res <= 0) {
+			break;
+		}
+		if (ast_iostream_write(stream, buf, res) != res) {
+			return -1;
+		}
+		offset += res;
+		written += res;
+	}
+
+	return written;
+}
+
 ssize_t ast_iostream_printf(struct ast_iostream *stream, const char *format, ...)
 {
 	char sbuf[512], *buf = sbuf;
@@ -502,6 +502,341 @@ int ast_json_dump_str_format(struct ast_json *root, struct ast_str **dst, enum a
 }
 
 
+static void writer_append(struct ast_json_writer *writer, const char *buffer, size_t size)
+{
+	if (!writer->failed && write_to_ast_str(buffer, size, writer->dst)) {
+		writer->failed = 1;
+	}
+}
+
+static void writer_newline(struct ast_json_writer *writer)
+{
+	static const char spaces[] = "                                ";
+	size_t indent = writer->depth * 2;
+
+	writer_append(writer, "\n", 1);
+	while (indent) {
+		size_t chunk = MIN(indent, sizeof(spaces) - 1);
+
+		writer_append(writer, spaces, chunk);
+		indent -= chunk;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Write what goes between the previous value and the next key or value
+ */
+static int writer_separate(struct ast_json_writer *writer, int is_key)
+{
+	uint64_t bit;
+	int in_object;
+
+	if (writer->failed) {
+		return -1;
+	}
+
+	if (!writer->depth) {
+		if (is_key) {
+			writer->failed = 1;
+			return -1;
+		}
+		return 0;
+	}
+
+	bit = UINT64_C(1) << (writer->depth - 1);
+	in_object = (writer->objects & bit) ? 1 : 0;
+	if (writer->after_key) {
+		if (is_key) {
+			writer->failed = 1;
+			return -1;
+		}
+		/* The value follows its key directly */
+		writer->after_key = 0;
+		return 0;
+	}
+	if (in_object != is_key) {
+		/* A key outside of an object, or an object member without one */
+		writer->failed = 1;
+		return -1;
+	}
+
+	if (writer->filled & bit) {
+		writer_append(writer, ",", 1);
+	}
+	writer->filled |= bit;
+	if (writer->format == AST_JSON_PRETTY) {
+		writer_newline(writer);
+	}
+
+	return writer->failed ? -1 : 0;
+}
+
+static void writer_quoted(struct ast_json_writer *writer, const char *value)
+{
+	const char *run = value;
+	const char *pos;
+
+	writer_append(writer, "\"", 1);
+	for (pos = value; *pos; ++pos) {
+		unsigned char c = *pos;
+		char escaped[8];
+
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		writer_append(writer, run, pos - run);
+		run = pos + 1;
+		switch (c) {
+		case '"':
+			writer_append(writer, "\\\"", 2);
+			break;
+		case '\\':
+			writer_append(writer, "\\\\", 2);
+			break;
+		case '\b':
+			writer_append(writer, "\\b", 2);
+			break;
+		case '\f':
+			writer_append(writer, "\\f", 2);
+			break;
+		case '\n':
+			writer_append(writer, "\\n", 2);
+			break;
+		case '\r':
+			writer_append(writer, "\\r", 2);
+			break;
+		case '\t':
+			writer_append(writer, "\\t", 2);
+			break;
+		default:
+			snprintf(escaped, sizeof(escaped), "\\u%04X", c);
+			writer_append(writer, escaped, 6);
+			break;
+		}
+	}
+	writer_append(writer, run, pos - run);
+	writer_append(writer, "\"", 1);
+}
+
+static int writer_open(struct ast_json_writer *writer, int is_object)
+{
+	uint64_t bit;
+
+	if (writer_separate(writer, 0)) {
+		return -1;
+	}
+	if (writer->depth == AST_JSON_WRITER_MAX_DEPTH) {
+		writer->failed = 1;
+		return -1;
+	}
+
+	bit = UINT64_C(1) << writer->depth;
+	writer->filled &= ~bit;
+	if (is_object) {
+		writer->objects |= bit;
+	} else {
+		writer->objects &= ~bit;
+	}
+	++writer->depth;
+	writer_append(writer, is_object ? "{" : "[", 1);
+
+	return writer->failed ? -1 : 0;
+}
+
+static int writer_close(struct ast_json_writer *writer, int is_object)
+{
+	uint64_t bit;
+
+	if (writer->failed) {
+		return -1;
+	}
+
+	if (!writer->depth || writer->after_key) {
+		writer->failed = 1;
+		return -1;
+	}
+	bit = UINT64_C(1) << (writer->depth - 1);
+	if (((writer->objects & bit) ? 1 : 0) != is_object) {
+		writer->failed = 1;
+		return -1;
+	}
+
+	--writer->depth;
+	if (writer->format == AST_JSON_PRETTY && (writer->filled & bit)) {
+		writer_newline(writer);
+	}
+	writer_append(writer, is_object ? "}" : "]", 1);
+
+	return writer->failed ? -1 : 0;
+}
+
+void ast_json_writer_init(struct ast_json_writer *writer, struct ast_str **dst,
+	enum ast_json_encoding_format format)
+{
+	memset(writer, 0, sizeof(*writer));
+	writer->dst = dst;
+	writer->format = format;
+}
+
+int ast_json_writer_object_start(struct ast_json_writer *writer)
+{
+	return writer_open(writer, 1);
+}
+
+int ast_json_writer_object_end(struct ast_json_writer *writer)
+{
+	return writer_close(writer, 1);
+}
+
+int ast_json_writer_array_start(struct ast_json_writer *writer)
+{
+	return writer_open(writer, 0);
+}
+
+int ast_json_writer_array_end(struct ast_json_writer *writer)
+{
+	return writer_close(writer, 0);
+}
+
+int ast_json_writer_key(struct ast_json_writer *writer, const char *key)
+{
+	if (!key || !ast_json_utf8_check(key)) {
+		writer->failed = 1;
+	}
+	if (writer_separate(writer, 1)) {
+		return -1;
+	}
+
+	writer_quoted(writer, key);
+	if (writer->format == AST_JSON_PRETTY) {
+		writer_append(writer, ": ", 2);
+	} else {
+		writer_append(writer, ":", 1);
+	}
+	writer->after_key = 1;
+
+	return writer->failed ? -1 : 0;
+}
+
+int ast_json_writer_string(struct ast_json_writer *writer, const char *value)
+{
+	if (!value) {
+		return ast_json_writer_null(writer);
+	}
+	if (!ast_json_utf8_check(value)) {
+		writer->failed = 1;
+	}
+	if (writer_separate(writer, 0)) {
+		return -1;
+	}
+
+	writer_quoted(writer, value);
+
+	return writer->failed ? -1 : 0;
+}
+
+int ast_json_writer_integer(struct ast_json_writer *writer, intmax_t value)
+{
+	char buf[32];
+
+	if (writer_separate(writer, 0)) {
+		return -1;
+	}
+
+	writer_append(writer, buf, snprintf(buf, sizeof(buf), "%jd", value));
+
+	return writer->failed ? -1 : 0;
+}
+
+int ast_json_writer_boolean(struct ast_json_writer *writer, int value)
+{
+	if (writer_separate(writer, 0)) {
+		return -1;
+	}
+
+	if (value) {
+		writer_append(writer, "true", 4);
+	} else {
+		writer_append(writer, "false", 5);
+	}
+
+	return writer->failed ? -1 : 0;
+}
+
+int ast_json_writer_null(struct ast_json_writer *writer)
+{
+	if (writer_separate(writer, 0)) {
+		return -1;
+	}
+
+	writer_append(writer, "null", 4);
+
+	return writer->failed ? -1 : 0;
+}
+
+int ast_json_writer_timeval(struct ast_json_writer *writer, const struct timeval tv, const char *zone)
+{
+	char buf[AST_ISO8601_LEN];
+	struct ast_tm tm = {};
+
+	ast_localtime(&tv, &tm, zone);
+
+	ast_strftime(buf, sizeof(buf), AST_ISO8601_FORMAT, &tm);
+
+	return ast_json_writer_string(writer, buf);
+}
+
+int ast_json_writer_value(struct ast_json_writer *writer, struct ast_json *value)
+{
+	json_t *json = (json_t *) value;
+
+	if (!json) {
+		writer->failed = 1;
+		return -1;
+	}
+
+	/* Pretty containers are walked so they are indented to where they are
+	 * written; anything else is encoded by jansson directly. */
+	if (writer->format == AST_JSON_PRETTY && json_is_object(json)) {
+		const char *key;
+		json_t *member;
+
+		ast_json_writer_object_start(writer);
+		json_object_foreach(json, key, member) {
+			ast_json_writer_key(writer, key);
+			ast_json_writer_value(writer, (struct ast_json *) member);
+		}
+		return ast_json_writer_object_end(writer);
+	} else if (writer->format == AST_JSON_PRETTY && json_is_array(json)) {
+		size_t idx;
+		json_t *element;
+
+		ast_json_writer_array_start(writer);
+		json_array_foreach(json, idx, element) {
+			ast_json_writer_value(writer, (struct ast_json *) element);
+		}
+		return ast_json_writer_array_end(writer);
+	}
+
+	if (writer_separate(writer, 0)) {
+		return -1;
+	}
+
+	if (json_dump_callback(json, write_to_ast_str, writer->dst, JSON_COMPACT | JSON_ENCODE_ANY)) {
+		writer->failed = 1;
+		return -1;
+	}
+
+	return 0;
+}
+
+int ast_json_writer_finish(struct ast_json_writer *writer)
+{
+	return writer->failed || writer->depth || writer->after_key ? -1 : 0;
+}
+
 int ast_json_dump_file_format(struct ast_json *root, FILE *output, enum ast_json_encoding_format format)
 {
 	if (!root || !output) {
@@ -49,6 +49,7 @@
 #include "asterisk/app.h"
 #include "asterisk/test.h"
 #include "asterisk/cli.h"
+#include "asterisk/threadpool.h"
 
 #include <dlfcn.h>
 
@@ -149,6 +150,9 @@ AST_VECTOR(module_vector, struct ast_module *);
 /* Built-in module registrations need special handling at startup */
 static unsigned int loader_ready;
 
+/*! Threads starting modules at once at startup, from modules.conf */
+static unsigned int loader_threads = 1;
+
 /*! String container for deferring output of startup errors. */
 static struct ast_vector_string startup_errors;
 static struct ast_str *startup_error_builder;
@@ -313,6 +317,8 @@ struct ast_module {
 	 * to this list with a reference.
 	 */
 	struct module_vector reffed_deps;
+	/*! How long the load function took, in microseconds */
+	int64_t load_usec;
 	struct {
 		/*! The module running and ready to accept requests. */
 		unsigned int running:1;
@@ -1677,6 +1683,7 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 {
 	char tmp[256];
 	enum ast_module_load_result res;
+	struct timeval start;
 
 	if (mod->flags.running) {
 		return AST_MODULE_LOAD_SUCCESS;
@@ -1688,6 +1695,8 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 		return mod->flags.required ? AST_MODULE_LOAD_FAILURE : AST_MODULE_LOAD_DECLINE;
 	}
 
+	/* Modules may be started by the loader threads, which do not hold the lock */
+	AST_DLLIST_LOCK(&module_list);
 	if (module_deps_reference(mod, NULL)) {
 		struct module_vector missing;
 		int i;
@@ -1701,14 +1710,18 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 				AST_VECTOR_GET(&missing, i)->info->name);
 		}
 		AST_VECTOR_FREE(&missing);
+		AST_DLLIST_UNLOCK(&module_list);
 
 		return AST_MODULE_LOAD_DECLINE;
 	}
+	AST_DLLIST_UNLOCK(&module_list);
 
 	if (!ast_fully_booted) {
 		ast_verb(1, "Loading %s.\n", mod->resource);
 	}
+	start = ast_tvnow();
 	res = mod->info->load();
+	mod->load_usec = ast_tvdiff_us(ast_tvnow(), start);
 
 	switch (res) {
 	case AST_MODULE_LOAD_SUCCESS:
@@ -1873,18 +1886,8 @@ static struct load_order_entry *add_to_load_order(const char *resource, struct l
 
 AST_LIST_HEAD_NOLOCK(load_retries, load_order_entry);
 
-static enum ast_module_load_result start_resource_attempt(struct ast_module *mod, int *count)
+static void start_resource_done(struct ast_module *mod, enum ast_module_load_result lres, int *count)
 {
-	enum ast_module_load_result lres;
-
-	/* Try to grab required references. */
-	if (module_deps_reference(mod, NULL)) {
-		/* We're likely to retry so not an error. */
-		ast_debug(1, "Module %s is missing dependencies\n", mod->resource);
-		return AST_MODULE_LOAD_SKIP;
-	}
-
-	lres = start_resource(mod);
 	ast_debug(3, "START: %-46s[%d] %d\n",
 		mod->resource,
 		ast_test_flag(mod->info, AST_MODFLAG_LOAD_ORDER) ? mod->info->load_pri : AST_MODPRI_DEFAULT,
@@ -1897,6 +1900,21 @@ static enum ast_module_load_result start_resource_attempt(struct ast_module *mod
 			mod->flags.required ? "required " : "",
 			mod->resource);
 	}
+}
+
+static enum ast_module_load_result start_resource_attempt(struct ast_module *mod, int *count)
+{
+	enum ast_module_load_result lres;
+
+	/* Try to grab required references. */
+	if (module_deps_reference(mod, NULL)) {
+		/* We're likely to retry so not an error. */
+		ast_debug(1, "Module %s is missing dependencies\n", mod->resource);
+		return AST_MODULE_LOAD_SKIP;
+	}
+
+	lres = start_resource(mod);
+	start_resource_done(mod, lres, count);
 
 	return lres;
 }
@@ -1964,17 +1982,200 @@ static int resource_list_recursive_decline(struct module_vector *resources, stru
 	return res;
 }
 
+/*! \brief A module started by a loader thread */
+struct module_start_task {
+	struct ast_module *mod;
+	enum ast_module_load_result lres;
+	struct module_start_pool *pool;
+	AST_LIST_ENTRY(module_start_task) entry;
+};
+
+AST_LIST_HEAD_NOLOCK(module_start_tasks, module_start_task);
+
+/*! \brief The loader threads starting modules at once */
+struct module_start_pool {
+	struct ast_threadpool *threadpool;
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! Modules started by the threads, protected by lock */
+	struct module_start_tasks done;
+	/*! Modules being started */
+	unsigned int in_flight;
+};
+
+static struct module_start_pool *module_start_pool_create(void)
+{
+	struct module_start_pool *pool;
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = loader_threads,
+		.max_size = loader_threads,
+	};
+
+	pool = ast_calloc(1, sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+
+	pool->threadpool = ast_threadpool_create("loader", NULL, &options);
+	if (!pool->threadpool) {
+		ast_free(pool);
+		return NULL;
+	}
+	ast_mutex_init(&pool->lock);
+	ast_cond_init(&pool->cond, NULL);
+
+	return pool;
+}
+
+static void module_start_pool_destroy(struct module_start_pool *pool)
+{
+	ast_threadpool_shutdown(pool->threadpool);
+	ast_mutex_destroy(&pool->lock);
+	ast_cond_destroy(&pool->cond);
+	ast_free(pool);
+}
+
+static int module_start_task_exec(void *data)
+{
+	struct module_start_task *task = data;
+	struct module_start_pool *pool = task->pool;
+
+	task->lres = start_resource(task->mod);
+
+	ast_mutex_lock(&pool->lock);
+	AST_LIST_INSERT_TAIL(&pool->done, task, entry);
+	ast_cond_signal(&pool->cond);
+	ast_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Start the modules at the front of the list on the loader threads
+ *
+ * The modules sharing the load priority of the first one are each started
+ * as soon as everything they depend on is running.  The modules of the next
+ * priority only start once all of these are done.
+ *
+ * \param res The result so far
+ *
+ * \return The result so far, -2 if a required module failed
+ *
+ * \note module_list must be locked.  It is unlocked while waiting for the
+ * threads.  Nothing is being started on return, what is left at the front
+ * of the list needs to be started by the caller.
+ */
+static int start_resource_list_parallel(struct module_start_pool *pool, struct module_vector *resources,
+	struct ast_str **printmissing, int *mod_count, int res)
+{
+	struct ast_module *group = NULL;
+
+	for (;;) {
+		struct module_start_tasks done;
+		struct module_start_task *task;
+		int i = 0;
+
+		if (!pool->in_flight) {
+			group = NULL;
+		}
+
+		while (res != -2 && i < AST_VECTOR_SIZE(resources)) {
+			struct ast_module *mod = AST_VECTOR_GET(resources, i);
+
+			if (!group) {
+				group = mod;
+			}
+			if (module_vector_cmp(mod, group)) {
+				/* The rest of the list has a later priority */
+				break;
+			}
+
+			/* Built-in and preloaded modules are started one at a time */
+			if (mod->flags.declined || mod->flags.builtin || mod->flags.preload
+				|| module_deps_reference(mod, NULL)) {
+				i++;
+				continue;
+			}
+
+			task = ast_calloc(1, sizeof(*task));
+			if (!task) {
+				break;
+			}
+			task->mod = mod;
+			task->pool = pool;
+			if (ast_threadpool_push(pool->threadpool, module_start_task_exec, task)) {
+				ast_free(task);
+				break;
+			}
+			AST_VECTOR_REMOVE_ORDERED(resources, i);
+			++pool->in_flight;
+		}
+
+		if (!pool->in_flight) {
+			return res;
+		}
+
+		/* The threads need the lock to start the modules */
+		AST_DLLIST_UNLOCK(&module_list);
+		ast_mutex_lock(&pool->lock);
+		while (AST_LIST_EMPTY(&pool->done)) {
+			ast_cond_wait(&pool->cond, &pool->lock);
+		}
+		done = pool->done;
+		AST_LIST_HEAD_INIT_NOLOCK(&pool->done);
+		ast_mutex_unlock(&pool->lock);
+		AST_DLLIST_LOCK(&module_list);
+
+		while ((task = AST_LIST_REMOVE_HEAD(&done, entry))) {
+			--pool->in_flight;
+			start_resource_done(task->mod, task->lres, mod_count);
+
+			if (task->lres == AST_MODULE_LOAD_FAILURE) {
+				res = -2;
+			} else if (res != -2 && task->lres == AST_MODULE_LOAD_DECLINE) {
+				res = resource_list_recursive_decline(resources, task->mod, printmissing);
+			} else if (res != -2 && task->lres != AST_MODULE_LOAD_SUCCESS) {
+				/* Dependencies were met before the module was handed to a thread. */
+				module_load_error("%s load function returned an invalid result. "
+					"This is a bug in the module.\n", ast_module_name(task->mod));
+				res = resource_list_recursive_decline(resources, task->mod, printmissing);
+			}
+			ast_free(task);
+		}
+	}
+}
+
 static int start_resource_list(struct module_vector *resources, int *mod_count)
 {
 	struct module_vector missingdeps;
 	int res = 0;
 	struct ast_str *printmissing = NULL;
+	struct module_start_pool *pool = NULL;
+
+	if (loader_threads > 1) {
+		pool = module_start_pool_create();
+		if (!pool) {
+			ast_log(LOG_WARNING, "Failed to create the loader threads, starting modules one at a time.\n");
+		}
+	}
 
 	AST_VECTOR_INIT(&missingdeps, 0);
 	while (res != -2 && AST_VECTOR_SIZE(resources)) {
-		struct ast_module *mod = AST_VECTOR_REMOVE(resources, 0, 1);
+		struct ast_module *mod;
 		enum ast_module_load_result lres;
 
+		if (pool) {
+			res = start_resource_list_parallel(pool, resources, &printmissing, mod_count, res);
+			if (res == -2 || !AST_VECTOR_SIZE(resources)) {
+				break;
+			}
+		}
+
+		mod = AST_VECTOR_REMOVE(resources, 0, 1);
 		if (mod->flags.declined) {
 			ast_debug(1, "%s is already declined, skipping\n", ast_module_name(mod));
 			continue;
@@ -2087,6 +2288,9 @@ retry_load:
 	}
 
 exitpoint:
+	if (pool) {
+		module_start_pool_destroy(pool);
+	}
 	ast_free(printmissing);
 	AST_VECTOR_FREE(&missingdeps);
 
@@ -2245,6 +2449,12 @@ static int loader_config_init(struct load_order *load_order)
 			required = 1;
 		} else if (!strcasecmp(v->name, "noload") || !strcasecmp(v->name, "autoload")) {
 			continue;
+		} else if (!strcasecmp(v->name, "loadthreads")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE, &loader_threads, 1, 64)) {
+				ast_log(LOG_WARNING, "Invalid loadthreads value '%s', starting modules one at a time.\n", v->value);
+				loader_threads = 1;
+			}
+			continue;
 		} else {
 			ast_log(LOG_ERROR, "Unknown configuration option '%s'", v->name);
 			goto done;
@@ -2528,6 +2738,25 @@ int ast_update_module_list_condition(int (*modentry)(const char *module, const c
 	return conditions_met;
 }
 
+int64_t ast_module_load_time(const char *name)
+{
+	struct ast_module *cur;
+	int64_t usec = -1;
+
+	if (ast_strlen_zero(name)) {
+		return -1;
+	}
+
+	AST_DLLIST_LOCK(&module_list);
+	cur = find_resource(name, 0);
+	if (cur && cur->flags.running) {
+		usec = cur->load_usec;
+	}
+	AST_DLLIST_UNLOCK(&module_list);
+
+	return usec;
+}
+
 /*! \brief Check if module exists */
 int ast_module_check(const char *name)
 {
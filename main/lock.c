@@ -53,6 +53,120 @@ static void __attribute__((constructor)) __mtx_init(void)
 #undef pthread_cond_wait
 #undef pthread_cond_timedwait
 
+/*! Places a lock is taken that can be profiled, a power of two */
+#define LOCK_PROFILE_SITES 1024
+
+/*! \brief A place a lock is taken, keyed by the address of its file name */
+struct lock_profile_entry {
+	const char *key;
+	struct ast_lock_profile_site site;
+};
+
+/*! Sample one lock acquisition in this many, or none if 0 */
+static unsigned int lock_profile_rate;
+/*! Acquisitions made since profiling was enabled */
+static unsigned int lock_profile_count;
+/*! Protects lock_profile_entries.  Not an ast_mutex_t, so not profiled itself. */
+static pthread_mutex_t lock_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct lock_profile_entry lock_profile_entries[LOCK_PROFILE_SITES];
+
+#if !defined(DETECT_DEADLOCKS) || !defined(DEBUG_THREADS)
+static inline int lock_profile_sample(void)
+{
+	unsigned int rate = ast_atomic_load_n(&lock_profile_rate, __ATOMIC_RELAXED);
+
+	return rate && !(ast_atomic_fetch_add(&lock_profile_count, 1, __ATOMIC_RELAXED) % rate);
+}
+
+static void lock_profile_record(const char *filename, int lineno, const char *func,
+	const char *name, const struct timeval *start)
+{
+	unsigned int hash = (unsigned int) ((uintptr_t) filename >> 3) * 31 + lineno;
+	int64_t wait_us = start ? ast_tvdiff_us(ast_tvnow(), *start) : 0;
+	int probe;
+
+	pthread_mutex_lock(&lock_profile_lock);
+	for (probe = 0; probe < LOCK_PROFILE_SITES; ++probe) {
+		struct lock_profile_entry *entry =
+			&lock_profile_entries[(hash + probe) & (LOCK_PROFILE_SITES - 1)];
+
+		if (!entry->key) {
+			entry->key = filename;
+			entry->site.line = lineno;
+			ast_copy_string(entry->site.file, filename, sizeof(entry->site.file));
+			ast_copy_string(entry->site.func, func, sizeof(entry->site.func));
+			ast_copy_string(entry->site.name, name, sizeof(entry->site.name));
+		} else if (entry->key != filename || entry->site.line != lineno) {
+			continue;
+		}
+
+		++entry->site.samples;
+		if (start) {
+			++entry->site.contended;
+			entry->site.wait_us += wait_us;
+			if (wait_us > entry->site.max_wait_us) {
+				entry->site.max_wait_us = wait_us;
+			}
+		}
+		break;
+	}
+	pthread_mutex_unlock(&lock_profile_lock);
+}
+#endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
+
+void ast_lock_profile_set_rate(unsigned int rate)
+{
+	pthread_mutex_lock(&lock_profile_lock);
+	memset(lock_profile_entries, 0, sizeof(lock_profile_entries));
+	ast_atomic_store_n(&lock_profile_rate, rate, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&lock_profile_lock);
+}
+
+unsigned int ast_lock_profile_get_rate(void)
+{
+	return ast_atomic_load_n(&lock_profile_rate, __ATOMIC_RELAXED);
+}
+
+static int lock_profile_cmp(const void *a, const void *b)
+{
+	const struct ast_lock_profile_site *site_a = a;
+	const struct ast_lock_profile_site *site_b = b;
+
+	if (site_a->wait_us != site_b->wait_us) {
+		return site_a->wait_us < site_b->wait_us ? 1 : -1;
+	}
+	return site_b->contended - site_a->contended;
+}
+
+int ast_lock_profile_collect(struct ast_lock_profile_site *sites, int count)
+{
+	struct ast_lock_profile_site *all;
+	int used = 0;
+	int i;
+
+	all = ast_std_malloc(sizeof(*all) * LOCK_PROFILE_SITES);
+	if (!all) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&lock_profile_lock);
+	for (i = 0; i < LOCK_PROFILE_SITES; ++i) {
+		if (lock_profile_entries[i].key) {
+			all[used++] = lock_profile_entries[i].site;
+		}
+	}
+	pthread_mutex_unlock(&lock_profile_lock);
+
+	qsort(all, used, sizeof(*all), lock_profile_cmp);
+	if (count > used) {
+		count = used;
+	}
+	memcpy(sites, all, sizeof(*all) * count);
+	ast_std_free(all);
+
+	return count;
+}
+
 #if defined(DEBUG_THREADS)
 #define log_mutex_error(canlog, ...) \
 	do { \
@@ -317,13 +431,24 @@ int __ast_pthread_mutex_lock(const char *filename, int lineno, const char *func,
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
+	if (lock_profile_sample()) {
+		if ((res = pthread_mutex_trylock(&t->mutex)) == EBUSY) {
+			struct timeval start = ast_tvnow();
+
+			res = pthread_mutex_lock(&t->mutex);
+			lock_profile_record(filename, lineno, func, mutex_name, &start);
+		} else {
+			lock_profile_record(filename, lineno, func, mutex_name, NULL);
+		}
+	} else {
 #ifdef	HAVE_MTX_PROFILE
-	ast_mark(mtx_prof, 1);
-	res = pthread_mutex_trylock(&t->mutex);
-	ast_mark(mtx_prof, 0);
-	if (res)
+		ast_mark(mtx_prof, 1);
+		res = pthread_mutex_trylock(&t->mutex);
+		ast_mark(mtx_prof, 0);
+		if (res)
 #endif
-	res = pthread_mutex_lock(&t->mutex);
+		res = pthread_mutex_lock(&t->mutex);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
 #ifdef DEBUG_THREADS
@@ -876,7 +1001,18 @@ int __ast_rwlock_rdlock(const char *filename, int line, const char *func, ast_rw
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
-	res = pthread_rwlock_rdlock(&t->lock);
+	if (lock_profile_sample()) {
+		if ((res = pthread_rwlock_tryrdlock(&t->lock)) == EBUSY) {
+			struct timeval start = ast_tvnow();
+
+			res = pthread_rwlock_rdlock(&t->lock);
+			lock_profile_record(filename, line, func, name, &start);
+		} else {
+			lock_profile_record(filename, line, func, name, NULL);
+		}
+	} else {
+		res = pthread_rwlock_rdlock(&t->lock);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
 #ifdef DEBUG_THREADS
@@ -974,7 +1110,18 @@ int __ast_rwlock_wrlock(const char *filename, int line, const char *func, ast_rw
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
-	res = pthread_rwlock_wrlock(&t->lock);
+	if (lock_profile_sample()) {
+		if ((res = pthread_rwlock_trywrlock(&t->lock)) == EBUSY) {
+			struct timeval start = ast_tvnow();
+
+			res = pthread_rwlock_wrlock(&t->lock);
+			lock_profile_record(filename, line, func, name, &start);
+		} else {
+			lock_profile_record(filename, line, func, name, NULL);
+		}
+	} else {
+		res = pthread_rwlock_wrlock(&t->lock);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
 #ifdef DEBUG_THREADS
@@ -46,6 +46,7 @@
 #include <signal.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 
 #include "asterisk/_private.h"
@@ -87,9 +88,11 @@ static int display_callids;
 
 AST_THREADSTORAGE(unique_callid);
 
-static int logger_queue_size;
 static int logger_queue_limit = 1000;
-static int logger_messages_discarded;
+/*! Messages discarded since logging last resumed */
+static unsigned int logger_messages_discarded;
+/*! Messages discarded since startup */
+static unsigned int logger_messages_discarded_total;
 static unsigned int high_water_alert;
 
 static enum rotatestrategy {
@@ -111,6 +114,7 @@ AST_THREADSTORAGE_RAW(in_safe_log);
 
 struct logchannel;
 struct logmsg;
+struct logbinary;
 
 struct logformatter {
 	/* The name of the log formatter */
@@ -140,6 +144,8 @@ struct logchannel {
 	enum logtypes type;
 	/*! logfile logging file pointer */
 	FILE *fileptr;
+	/*! Mapped file of a channel using the binary formatter */
+	struct logbinary *binary;
 	/*! Filename */
 	char filename[PATH_MAX];
 	/*! field for linking to list */
@@ -159,6 +165,9 @@ enum logmsgtypes {
 	LOGMSG_VERBOSE,
 };
 
+/*! Longest message kept in the record itself, longer ones are allocated */
+#define LOGMSG_MESSAGE_SIZE 512
+
 struct logmsg {
 	enum logmsgtypes type;
 	int level;
@@ -166,25 +175,52 @@ struct logmsg {
 	int line;
 	int lwp;
 	ast_callid callid;
-	AST_DECLARE_STRING_FIELDS(
-		AST_STRING_FIELD(date);
-		AST_STRING_FIELD(file);
-		AST_STRING_FIELD(function);
-		AST_STRING_FIELD(message);
-		AST_STRING_FIELD(level_name);
-	);
-	AST_LIST_ENTRY(logmsg) list;
+	struct timeval tv;
+	char date[128];
+	char file[128];
+	char function[128];
+	char level_name[64];
+	/*! Points at message_buf unless the message did not fit in it */
+	char *message;
+	char message_buf[LOGMSG_MESSAGE_SIZE];
 };
 
-static void logmsg_free(struct logmsg *msg)
+static void logmsg_cleanup(struct logmsg *msg)
 {
-	ast_string_field_free_memory(msg);
-	ast_free(msg);
+	if (msg->message != msg->message_buf) {
+		ast_free(msg->message);
+	}
+	msg->message = NULL;
 }
 
-static AST_LIST_HEAD_STATIC(logmsgs, logmsg);
+/*! \brief A record of the logger ring */
+struct logger_ring_slot {
+	/*!
+	 * Equal to the position the slot is written at next while free, and
+	 * one past that once the message is there to be read.
+	 */
+	unsigned int seq;
+	struct logmsg msg;
+};
+
+/*!
+ * \brief The messages waiting for the logger thread
+ *
+ * The slots are allocated once, when the logger is initialized.  Any thread
+ * claims a slot by advancing head while only the logger thread advances
+ * tail, so neither takes a lock unless the logger thread has to be woken.
+ */
+static struct {
+	struct logger_ring_slot *slots;
+	unsigned int mask;
+	unsigned int head;
+	unsigned int tail;
+} logger_ring;
+
+AST_MUTEX_DEFINE_STATIC(logmutex);
 static pthread_t logthread = AST_PTHREADT_NULL;
 static ast_cond_t logcond;
+static int logger_thread_sleeping;
 static int close_logger_thread = 0;
 
 static FILE *qlog;
@@ -423,6 +459,528 @@ static struct logformatter logformatter_default = {
 	.format_log = format_log_default,
 };
 
+/*!
+ * \brief Format a message for the binary formatter
+ *
+ * Binary channels write records of their own, see logger_binary_write().
+ */
+static int format_log_binary(struct logchannel *channel, struct logmsg *msg, char *buf, size_t size)
+{
+	return -1;
+}
+
+static struct logformatter logformatter_binary = {
+	.name = "binary",
+	.format_log = format_log_binary,
+};
+
+/*! \brief Start of a binary log, which also tells its byte order */
+#define LOGGER_BINARY_MAGIC "AstBLog1"
+
+/*! \brief Binary logs are extended this much at a time */
+#define LOGGER_BINARY_GROW (1024 * 1024)
+
+/*! \brief Records are padded to a multiple of 8 bytes */
+#define LOGGER_BINARY_PAD(size) (((size) + 7) & ~((size_t) 7))
+
+#define LOGGER_BINARY_SITE_BUCKETS 563
+
+/*!
+ * \brief Header of a binary log
+ *
+ * All the fields of a binary log are in the byte order of the system
+ * that wrote it.
+ */
+struct logger_binary_header {
+	char magic[8];
+	/*! Bytes of the file used by the header and the records */
+	uint64_t used;
+};
+
+enum logger_binary_types {
+	/*! Defines a call site */
+	LOGGER_BINARY_SITE = 1,
+	/*! A message logged from a call site defined earlier */
+	LOGGER_BINARY_MESSAGE,
+};
+
+struct logger_binary_record {
+	uint32_t type;
+	/*! Size of the whole record */
+	uint32_t size;
+};
+
+/*!
+ * \brief Record written the first time a call site logs to the file
+ *
+ * The file, function and level name follow, each terminated.
+ */
+struct logger_binary_site {
+	struct logger_binary_record record;
+	uint32_t id;
+	int32_t line;
+	int32_t level;
+	uint32_t reserved;
+	char strings[0];
+};
+
+/*! \brief Record of a message, its terminated text follows */
+struct logger_binary_message {
+	struct logger_binary_record record;
+	uint32_t site;
+	int32_t lwp;
+	uint32_t callid;
+	uint32_t usec;
+	int64_t sec;
+	char message[0];
+};
+
+/*! \brief A call site already defined in a binary log */
+struct logbinary_site {
+	uint32_t id;
+	int line;
+	int level;
+	const char *function;
+	char file[0];
+};
+
+struct logbinary {
+	int fd;
+	/*! The whole file, mapped */
+	char *map;
+	size_t mapped;
+	/*! Bytes used, also kept in the header */
+	size_t used;
+	/*! Call sites defined so far, keyed by struct logmsg */
+	struct ao2_container *sites;
+	uint32_t next_site;
+};
+
+static int logbinary_site_hash_fn(const void *obj, const int flags)
+{
+	const struct logbinary_site *site;
+	const struct logmsg *msg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		msg = obj;
+		return ast_str_hash(msg->file) + msg->line;
+	case OBJ_SEARCH_OBJECT:
+		site = obj;
+		return ast_str_hash(site->file) + site->line;
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int logbinary_site_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct logbinary_site *site = obj;
+	const struct logmsg *msg;
+	const struct logbinary_site *other;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		msg = arg;
+		if (site->line != msg->line || site->level != msg->level
+			|| strcmp(site->file, msg->file) || strcmp(site->function, msg->function)) {
+			return 0;
+		}
+		break;
+	case OBJ_SEARCH_OBJECT:
+		other = arg;
+		if (site->line != other->line || site->level != other->level
+			|| strcmp(site->file, other->file) || strcmp(site->function, other->function)) {
+			return 0;
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	return CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Map a binary log, extended to at least size bytes
+ *
+ * \note The file is extended by writing to it rather than truncating it, so
+ * a full disk fails here instead of raising SIGBUS on a store to the map.
+ */
+static int logger_binary_map(struct logbinary *binary, size_t size)
+{
+	static const char zeros[4096];
+	struct stat st;
+	off_t pos;
+
+	if (binary->map) {
+		munmap(binary->map, binary->mapped);
+		binary->map = NULL;
+		binary->mapped = 0;
+	}
+
+	if (fstat(binary->fd, &st)) {
+		return -1;
+	}
+	for (pos = st.st_size; pos < size; pos += sizeof(zeros)) {
+		if (pwrite(binary->fd, zeros, MIN(sizeof(zeros), size - pos), pos) < 0) {
+			return -1;
+		}
+	}
+	size = MAX(size, st.st_size);
+
+	binary->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, binary->fd, 0);
+	if (binary->map == MAP_FAILED) {
+		binary->map = NULL;
+		return -1;
+	}
+	binary->mapped = size;
+
+	return 0;
+}
+
+static void logger_binary_close(struct logbinary *binary)
+{
+	if (binary->map) {
+		munmap(binary->map, binary->mapped);
+	}
+	if (binary->fd >= 0) {
+		/* Drop what was reserved past the last record */
+		if (binary->used && ftruncate(binary->fd, binary->used)) {
+			fprintf(stderr, "Logger Warning: Unable to trim binary log: %s\n", strerror(errno));
+		}
+		close(binary->fd);
+	}
+	ao2_cleanup(binary->sites);
+	ast_free(binary);
+}
+
+/*!
+ * \internal
+ * \brief Open the binary log of a channel, appending to it if it exists
+ */
+static struct logbinary *logger_binary_open(const char *filename)
+{
+	struct logbinary *binary;
+	struct logger_binary_header *header;
+	struct stat st;
+
+	binary = ast_calloc(1, sizeof(*binary));
+	if (!binary) {
+		return NULL;
+	}
+	binary->fd = open(filename, O_RDWR | O_CREAT, 0666);
+	binary->sites = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		LOGGER_BINARY_SITE_BUCKETS, logbinary_site_hash_fn, NULL, logbinary_site_cmp_fn);
+	if (binary->fd < 0 || !binary->sites || fstat(binary->fd, &st)) {
+		goto error;
+	}
+
+	if (!st.st_size) {
+		if (logger_binary_map(binary, LOGGER_BINARY_GROW)) {
+			goto error;
+		}
+		header = (struct logger_binary_header *) binary->map;
+		memcpy(header->magic, LOGGER_BINARY_MAGIC, sizeof(header->magic));
+		binary->used = header->used = sizeof(*header);
+		return binary;
+	}
+
+	if (st.st_size < sizeof(*header) || logger_binary_map(binary, st.st_size)) {
+		errno = EINVAL;
+		goto error;
+	}
+	header = (struct logger_binary_header *) binary->map;
+	if (memcmp(header->magic, LOGGER_BINARY_MAGIC, sizeof(header->magic))
+		|| header->used < sizeof(*header) || header->used > st.st_size) {
+		/* Not a binary log, or one written on a system of the other byte order */
+		errno = EINVAL;
+		goto error;
+	}
+	binary->used = header->used;
+
+	return binary;
+
+error:
+	{
+		int error = errno;
+
+		logger_binary_close(binary);
+		errno = error;
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Get room for a record at the end of a binary log
+ *
+ * \return The record, set to zero up to its size
+ */
+static void *logger_binary_reserve(struct logbinary *binary, size_t size)
+{
+	void *record;
+
+	if (binary->used + size > binary->mapped
+		&& logger_binary_map(binary, binary->used + size + LOGGER_BINARY_GROW)) {
+		return NULL;
+	}
+
+	record = binary->map + binary->used;
+	memset(record, 0, size);
+
+	return record;
+}
+
+/*! \brief Account for a record filled in after logger_binary_reserve() */
+static void logger_binary_commit(struct logbinary *binary, size_t size)
+{
+	binary->used += size;
+	((struct logger_binary_header *) binary->map)->used = binary->used;
+}
+
+/*!
+ * \internal
+ * \brief Find the call site of a message, defining it in the log the first time
+ */
+static struct logbinary_site *logger_binary_site_get(struct logbinary *binary, struct logmsg *msg)
+{
+	struct logbinary_site *site;
+	struct logger_binary_site *record;
+	size_t file_len = strlen(msg->file) + 1;
+	size_t function_len = strlen(msg->function) + 1;
+	size_t level_name_len = strlen(msg->level_name) + 1;
+	size_t size;
+
+	site = ao2_find(binary->sites, msg, OBJ_SEARCH_KEY);
+	if (site) {
+		return site;
+	}
+
+	site = ao2_alloc_options(sizeof(*site) + file_len + function_len, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!site) {
+		return NULL;
+	}
+	memcpy(site->file, msg->file, file_len);
+	site->function = site->file + file_len;
+	memcpy(site->file + file_len, msg->function, function_len);
+	site->line = msg->line;
+	site->level = msg->level;
+
+	size = LOGGER_BINARY_PAD(sizeof(*record) + file_len + function_len + level_name_len);
+	record = logger_binary_reserve(binary, size);
+	if (!record) {
+		ao2_ref(site, -1);
+		return NULL;
+	}
+	site->id = binary->next_site++;
+
+	record->record.type = LOGGER_BINARY_SITE;
+	record->record.size = size;
+	record->id = site->id;
+	record->line = site->line;
+	record->level = site->level;
+	memcpy(record->strings, msg->file, file_len);
+	memcpy(record->strings + file_len, msg->function, function_len);
+	memcpy(record->strings + file_len + function_len, msg->level_name, level_name_len);
+	logger_binary_commit(binary, size);
+
+	ao2_link(binary->sites, site);
+
+	return site;
+}
+
+/*!
+ * \internal
+ * \brief Append a message to the binary log of a channel
+ *
+ * Only the call site id and the text of the message are written, the
+ * location and date are rendered once the log is decoded.
+ */
+static int logger_binary_write(struct logchannel *chan, struct logmsg *msg)
+{
+	struct logbinary_site *site;
+	struct logger_binary_message *record;
+	size_t len = strlen(msg->message) + 1;
+	size_t size = LOGGER_BINARY_PAD(sizeof(*record) + len);
+
+	site = logger_binary_site_get(chan->binary, msg);
+	if (!site) {
+		return -1;
+	}
+
+	record = logger_binary_reserve(chan->binary, size);
+	if (!record) {
+		ao2_ref(site, -1);
+		return -1;
+	}
+	record->record.type = LOGGER_BINARY_MESSAGE;
+	record->record.size = size;
+	record->site = site->id;
+	record->lwp = msg->lwp;
+	record->callid = msg->callid;
+	record->sec = msg->tv.tv_sec;
+	record->usec = msg->tv.tv_usec;
+	memcpy(record->message, msg->message, len);
+	logger_binary_commit(chan->binary, size);
+	ao2_ref(site, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Get a terminated string of a record
+ *
+ * \param[in,out] pos Where the string starts, moved past it
+ * \param end End of the record
+ *
+ * \retval NULL if the record ends first
+ */
+static const char *logger_binary_string(const char **pos, const char *end)
+{
+	const char *str = *pos;
+	const char *nul;
+
+	if (str >= end || !(nul = memchr(str, '\0', end - str))) {
+		return NULL;
+	}
+	*pos = nul + 1;
+
+	return str;
+}
+
+AST_VECTOR(logger_binary_sites, const struct logger_binary_site *);
+
+/*!
+ * \internal
+ * \brief Render a binary log the way a file channel would have
+ *
+ * \param filename The binary log
+ * \param fd CLI file descriptor to report to and to output to without out
+ * \param out File to output to, or NULL
+ *
+ * \retval Messages decoded, or -1 on error
+ */
+static int logger_binary_decode(const char *filename, int fd, FILE *out)
+{
+	struct logger_binary_sites sites;
+	const struct logger_binary_header *header;
+	const char *map;
+	struct stat st;
+	size_t used;
+	size_t pos;
+	int messages = 0;
+	int logfd;
+
+	logfd = open(filename, O_RDONLY);
+	if (logfd < 0) {
+		ast_cli(fd, "Unable to open '%s': %s\n", filename, strerror(errno));
+		return -1;
+	}
+	if (fstat(logfd, &st) || st.st_size < sizeof(*header)) {
+		ast_cli(fd, "'%s' is not a binary log\n", filename);
+		close(logfd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, logfd, 0);
+	close(logfd);
+	if (map == MAP_FAILED) {
+		ast_cli(fd, "Unable to map '%s': %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	header = (const struct logger_binary_header *) map;
+	if (memcmp(header->magic, LOGGER_BINARY_MAGIC, sizeof(header->magic))
+		|| header->used < sizeof(*header)) {
+		ast_cli(fd, "'%s' is not a binary log written on this system\n", filename);
+		munmap((void *) map, st.st_size);
+		return -1;
+	}
+	/* The log may still be written to, only decode what was there when mapped */
+	used = MIN(header->used, st.st_size);
+
+	if (AST_VECTOR_INIT(&sites, 64)) {
+		munmap((void *) map, st.st_size);
+		return -1;
+	}
+
+	for (pos = sizeof(*header); pos + sizeof(struct logger_binary_record) <= used;) {
+		const struct logger_binary_record *record = (const void *) (map + pos);
+		const char *end = map + pos + record->size;
+
+		if (record->size < sizeof(*record) || record->size != LOGGER_BINARY_PAD(record->size)
+			|| pos + record->size > used) {
+			ast_cli(fd, "'%s' is corrupt at offset %zu\n", filename, pos);
+			break;
+		}
+		pos += record->size;
+
+		if (record->type == LOGGER_BINARY_SITE && record->size >= sizeof(struct logger_binary_site)) {
+			const struct logger_binary_site *site = (const void *) record;
+
+			/* Ids are given in order, starting over each time the log is reopened */
+			if (site->id <= AST_VECTOR_SIZE(&sites)) {
+				AST_VECTOR_REPLACE(&sites, site->id, site);
+			}
+		} else if (record->type == LOGGER_BINARY_MESSAGE
+			&& record->size >= sizeof(struct logger_binary_message)) {
+			const struct logger_binary_message *message = (const void *) record;
+			const struct logger_binary_site *site = NULL;
+			const char *strings;
+			const char *file = NULL;
+			const char *level_name = NULL;
+			const char *text;
+			char call_identifier_str[13];
+			char date[256];
+			char buf[BUFSIZ];
+			struct timeval tv = { .tv_sec = message->sec, .tv_usec = message->usec };
+			struct ast_tm tm;
+
+			if (message->site < AST_VECTOR_SIZE(&sites)) {
+				site = AST_VECTOR_GET(&sites, message->site);
+			}
+			if (site) {
+				strings = site->strings;
+				file = logger_binary_string(&strings, (const char *) site + site->record.size);
+				if (logger_binary_string(&strings, (const char *) site + site->record.size)) {
+					level_name = logger_binary_string(&strings, (const char *) site + site->record.size);
+				}
+			}
+			strings = message->message;
+			text = logger_binary_string(&strings, end);
+
+			if (message->callid) {
+				ast_callid_strnprint(call_identifier_str, sizeof(call_identifier_str), message->callid);
+			} else {
+				call_identifier_str[0] = '\0';
+			}
+			ast_localtime(&tv, &tm, NULL);
+			ast_strftime(date, sizeof(date), dateformat, &tm);
+
+			snprintf(buf, sizeof(buf), "[%s] %s[%d]%s %s: %s",
+				date, S_OR(level_name, "UNKNOWN"), message->lwp, call_identifier_str,
+				S_OR(file, "unknown"), S_OR(text, ""));
+			term_strip(buf, buf, sizeof(buf));
+			if (out) {
+				fputs(buf, out);
+			} else {
+				ast_cli(fd, "%s", buf);
+			}
+			++messages;
+		}
+	}
+
+	AST_VECTOR_FREE(&sites);
+	munmap((void *) map, st.st_size);
+
+	return messages;
+}
+
 static void make_components(struct logchannel *chan)
 {
 	char *w;
@@ -447,6 +1005,8 @@ static void make_components(struct logchannel *chan)
 
 			if (!strcasecmp(formatter_name, "json")) {
 				memcpy(&chan->formatter, &logformatter_json, sizeof(chan->formatter));
+			} else if (!strcasecmp(formatter_name, "binary") && chan->type == LOGTYPE_FILE) {
+				memcpy(&chan->formatter, &logformatter_binary, sizeof(chan->formatter));
 			} else if (!strcasecmp(formatter_name, "default")) {
 				memcpy(&chan->formatter, &logformatter_default, sizeof(chan->formatter));
 			} else {
@@ -598,6 +1158,25 @@ static struct logchannel *make_logchannel(const char *channel, const char *compo
 
 		chan->type = LOGTYPE_SYSLOG;
 		openlog("asterisk", LOG_PID, chan->facility);
+	} else {
+		chan->type = LOGTYPE_FILE;
+	}
+	make_components(chan);
+
+	if (chan->type != LOGTYPE_FILE) {
+		return chan;
+	}
+
+	if (chan->formatter.format_log == format_log_binary) {
+		if (!(chan->binary = logger_binary_open(chan->filename))) {
+			ast_console_puts_mutable("ERROR: Unable to open binary log file '", __LOG_ERROR);
+			ast_console_puts_mutable(chan->filename, __LOG_ERROR);
+			ast_console_puts_mutable("': ", __LOG_ERROR);
+			ast_console_puts_mutable(strerror(errno), __LOG_ERROR);
+			ast_console_puts_mutable("'\n", __LOG_ERROR);
+			ast_free(chan);
+			return NULL;
+		}
 	} else {
 		if (!(chan->fileptr = fopen(chan->filename, "a"))) {
 			/* Can't do real logging here since we're called with a lock
@@ -619,9 +1198,7 @@ static struct logchannel *make_logchannel(const char *channel, const char *compo
 				ast_build_machine, ast_build_os, ast_build_date);
 			fflush(chan->fileptr);
 		}
-		chan->type = LOGTYPE_FILE;
 	}
-	make_components(chan);
 
 	return chan;
 }
@@ -1108,6 +1685,14 @@ static int reload_logger(int rotate, const char *altconf)
 			if (rotate || rotate_this) {
 				rotate_file(f->filename);
 			}
+		} else if (f->binary) {
+			int rotate_this = rotatestrategy != NONE && f->binary->used > 0x40000000;
+
+			logger_binary_close(f->binary);
+			f->binary = NULL;
+			if (rotate || rotate_this) {
+				rotate_file(f->filename);
+			}
 		}
 	}
 
@@ -1149,6 +1734,60 @@ static char *handle_logger_reload(struct ast_cli_entry *e, int cmd, struct ast_c
 	return CLI_SUCCESS;
 }
 
+static char *handle_logger_decode(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	char filename[PATH_MAX];
+	char outname[PATH_MAX];
+	FILE *out = NULL;
+	int messages;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "logger decode";
+		e->usage =
+			"Usage: logger decode <binary log> [<output file>]\n"
+			"       Renders a log written by a channel using the binary formatter, as a\n"
+			"       file channel would have, to the console or to the output file.\n"
+			"       Relative paths are taken from the log directory.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc < 3 || a->argc > 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (a->argv[2][0] == '/') {
+		ast_copy_string(filename, a->argv[2], sizeof(filename));
+	} else {
+		snprintf(filename, sizeof(filename), "%s/%s", ast_config_AST_LOG_DIR, a->argv[2]);
+	}
+
+	if (a->argc == 4) {
+		if (a->argv[3][0] == '/') {
+			ast_copy_string(outname, a->argv[3], sizeof(outname));
+		} else {
+			snprintf(outname, sizeof(outname), "%s/%s", ast_config_AST_LOG_DIR, a->argv[3]);
+		}
+		if (!(out = fopen(outname, "w"))) {
+			ast_cli(a->fd, "Unable to create '%s': %s\n", outname, strerror(errno));
+			return CLI_FAILURE;
+		}
+	}
+
+	messages = logger_binary_decode(filename, a->fd, out);
+	if (out) {
+		fclose(out);
+		if (messages >= 0) {
+			ast_cli(a->fd, "Decoded %d message%s from '%s' to '%s'\n",
+				messages, ESS(messages), filename, outname);
+		}
+	}
+
+	return messages < 0 ? CLI_FAILURE : CLI_SUCCESS;
+}
+
 static char *handle_logger_rotate(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	switch (cmd) {
@@ -1198,6 +1837,13 @@ int ast_logger_rotate_channel(const char *log_channel)
 				rotate_file(f->filename);
 				success = AST_LOGGER_SUCCESS;
 			}
+		} else if (f->binary) {
+			logger_binary_close(f->binary);
+			f->binary = NULL;
+			if (strcmp(filename, f->filename) == 0) {
+				rotate_file(f->filename);
+				success = AST_LOGGER_SUCCESS;
+			}
 		}
 	}
 
@@ -1307,7 +1953,10 @@ static char *handle_logger_show_channels(struct ast_cli_entry *e, int cmd, struc
 	case CLI_GENERATE:
 		return NULL;
 	}
-	ast_cli(a->fd, "Logger queue limit: %d\n\n", logger_queue_limit);
+	ast_cli(a->fd, "Logger queue limit: %d (%u slots)\n", logger_queue_limit,
+		logger_ring.slots ? logger_ring.mask + 1 : 0);
+	ast_cli(a->fd, "Logger messages discarded: %u\n\n",
+		ast_atomic_load_n(&logger_messages_discarded_total, __ATOMIC_RELAXED));
 	ast_cli(a->fd, FORMATL, "Channel", "Type", "Formatter", "Status");
 	ast_cli(a->fd, "Configuration\n");
 	ast_cli(a->fd, FORMATL, "-------", "----", "---------", "------");
@@ -1418,6 +2067,10 @@ int ast_logger_remove_channel(const char *log_channel)
 		fclose(chan->fileptr);
 		chan->fileptr = NULL;
 	}
+	if (chan->binary) {
+		logger_binary_close(chan->binary);
+		chan->binary = NULL;
+	}
 	ast_free(chan);
 	chan = NULL;
 
@@ -1477,6 +2130,7 @@ static struct ast_cli_entry cli_logger[] = {
 	AST_CLI_DEFINE(handle_logger_show_channels, "List configured log channels"),
 	AST_CLI_DEFINE(handle_logger_reload, "Reopens the log files"),
 	AST_CLI_DEFINE(handle_logger_rotate, "Rotates and reopens the log files"),
+	AST_CLI_DEFINE(handle_logger_decode, "Renders a binary log file"),
 	AST_CLI_DEFINE(handle_logger_set_level, "Enables/Disables a specific logging level for this console"),
 	AST_CLI_DEFINE(handle_logger_add_channel, "Adds a new logging channel"),
 	AST_CLI_DEFINE(handle_logger_remove_channel, "Removes a logging channel"),
@@ -1544,6 +2198,17 @@ static void logger_print_normal(struct logmsg *logmsg)
 				{
 					int res = 0;
 
+					if (chan->binary) {
+						if (logger_binary_write(chan, logmsg)) {
+							fprintf(stderr, "Logger Warning: Unable to write to binary log file '%s': %s (disabled)\n",
+								chan->filename, strerror(errno));
+							manager_event(EVENT_FLAG_SYSTEM, "LogChannel", "Channel: %s\r\nEnabled: No\r\nReason: %d - %s\r\n",
+								chan->filename, errno, strerror(errno));
+							chan->disabled = 1;
+						}
+						continue;
+					}
+
 					if (!chan->fileptr) {
 						continue;
 					}
@@ -1596,36 +2261,55 @@ static void logger_print_normal(struct logmsg *logmsg)
 	return;
 }
 
-static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message_ap(int level,
-	int sublevel, const char *file, int line, const char *function, ast_callid callid,
-	const char *fmt, va_list ap)
+/*!
+ * \internal
+ * \brief Format the text of a message in the buffer of the calling thread
+ *
+ * \retval NULL on failure
+ */
+static struct ast_str * __attribute__((format(printf, 1, 0))) format_log_text_ap(const char *fmt,
+	va_list ap)
 {
-	struct logmsg *logmsg = NULL;
-	struct ast_str *buf = NULL;
-	struct ast_tm tm;
-	struct timeval now = ast_tvnow();
-	int res = 0;
-	char datestring[256];
+	struct ast_str *buf;
 
 	if (!(buf = ast_str_thread_get(&log_buf, LOG_BUF_INIT_SIZE))) {
 		return NULL;
 	}
 
 	/* Build string */
-	res = ast_str_set_va(&buf, BUFSIZ, fmt, ap);
-
-	/* If the build failed, then abort and free this structure */
-	if (res == AST_DYNSTR_BUILD_FAILED) {
+	if (ast_str_set_va(&buf, BUFSIZ, fmt, ap) == AST_DYNSTR_BUILD_FAILED) {
 		return NULL;
 	}
 
-	/* Create a new logging message */
-	if (!(logmsg = ast_calloc_with_stringfields(1, struct logmsg, res + 128))) {
-		return NULL;
-	}
+	return buf;
+}
+
+/*!
+ * \internal
+ * \brief Fill in a log record
+ *
+ * \note This cannot fail, as the record may be a slot of the ring that is
+ * already claimed.  A long message is truncated if it cannot be allocated.
+ */
+static void logmsg_init(struct logmsg *logmsg, int level, int sublevel, const char *file,
+	int line, const char *function, ast_callid callid, const char *message, size_t len)
+{
+	struct ast_tm tm;
+	struct timeval now = ast_tvnow();
 
 	/* Copy string over */
-	ast_string_field_set(logmsg, message, ast_str_buffer(buf));
+	logmsg->message = logmsg->message_buf;
+	if (len >= sizeof(logmsg->message_buf)) {
+		char *long_message = ast_malloc(len + 1);
+
+		if (long_message) {
+			logmsg->message = long_message;
+		} else {
+			len = sizeof(logmsg->message_buf) - 1;
+		}
+	}
+	memcpy(logmsg->message, message, len);
+	logmsg->message[len] = '\0';
 
 	/* Set type */
 	if (level == __LOG_VERBOSE) {
@@ -1634,85 +2318,192 @@ static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message_
 		logmsg->type = LOGMSG_NORMAL;
 	}
 
-	if (display_callids && callid) {
-		logmsg->callid = callid;
-	}
+	logmsg->callid = display_callids ? callid : 0;
 
 	/* Create our date/time */
+	logmsg->tv = now;
 	ast_localtime(&now, &tm, NULL);
-	ast_strftime(datestring, sizeof(datestring), dateformat, &tm);
-	ast_string_field_set(logmsg, date, datestring);
+	ast_strftime(logmsg->date, sizeof(logmsg->date), dateformat, &tm);
 
 	/* Copy over data */
 	logmsg->level = level;
 	logmsg->sublevel = sublevel;
 	logmsg->line = line;
-	ast_string_field_set(logmsg, level_name, levels[level]);
-	ast_string_field_set(logmsg, file, file);
-	ast_string_field_set(logmsg, function, function);
+	ast_copy_string(logmsg->level_name, S_OR(levels[level], ""), sizeof(logmsg->level_name));
+	ast_copy_string(logmsg->file, S_OR(file, ""), sizeof(logmsg->file));
+	ast_copy_string(logmsg->function, S_OR(function, ""), sizeof(logmsg->function));
 	logmsg->lwp = ast_get_tid();
-
-	return logmsg;
 }
 
-static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message(int level,
-	int sublevel, const char *file, int line, const char *function, ast_callid callid,
-	const char *fmt, ...)
+/*! \brief Print a notice of the logger itself, from the logger thread */
+static void __attribute__((format(printf, 1, 2))) logger_print_notice(const char *fmt, ...)
 {
-	struct logmsg *logmsg;
+	struct logmsg logmsg;
+	struct ast_str *buf;
 	va_list ap;
 
 	va_start(ap, fmt);
-	logmsg = format_log_message_ap(level, sublevel, file, line, function, callid, fmt, ap);
+	buf = format_log_text_ap(fmt, ap);
 	va_end(ap);
+	if (!buf) {
+		return;
+	}
 
-	return logmsg;
+	logmsg_init(&logmsg, __LOG_WARNING, 0, "logger", 0, "***", 0,
+		ast_str_buffer(buf), ast_str_strlen(buf));
+	logger_print_normal(&logmsg);
+	logmsg_cleanup(&logmsg);
+}
+
+/*!
+ * \internal
+ * \brief Allocate the slots of the ring
+ *
+ * \param limit Messages the ring has to hold, rounded up to a power of 2
+ */
+static int logger_ring_alloc(int limit)
+{
+	unsigned int size = 1;
+	unsigned int idx;
+
+	while (size < (unsigned int) limit) {
+		size <<= 1;
+	}
+
+	logger_ring.slots = ast_calloc(size, sizeof(*logger_ring.slots));
+	if (!logger_ring.slots) {
+		return -1;
+	}
+	for (idx = 0; idx < size; ++idx) {
+		logger_ring.slots[idx].seq = idx;
+	}
+	logger_ring.mask = size - 1;
+	logger_ring.head = 0;
+	logger_ring.tail = 0;
+
+	return 0;
+}
+
+/*! \brief Advance the head of the ring from pos, if no other thread did first */
+static int logger_ring_claim(unsigned int pos)
+{
+#if defined(HAVE_C_ATOMICS)
+	return __atomic_compare_exchange_n(&logger_ring.head, &pos, pos + 1, 1,
+		__ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#else
+	return __sync_bool_compare_and_swap(&logger_ring.head, pos, pos + 1);
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Claim the next free slot of the ring
+ *
+ * \retval NULL if the ring is full or logger_queue_limit is reached
+ */
+static struct logger_ring_slot *logger_ring_reserve(void)
+{
+	unsigned int pos = ast_atomic_load_n(&logger_ring.head, __ATOMIC_RELAXED);
+
+	for (;;) {
+		struct logger_ring_slot *slot = &logger_ring.slots[pos & logger_ring.mask];
+		int diff = (int) (ast_atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+		if (diff < 0 || (int) (pos - ast_atomic_load_n(&logger_ring.tail, __ATOMIC_ACQUIRE))
+			>= logger_queue_limit) {
+			return NULL;
+		}
+		if (!diff && logger_ring_claim(pos)) {
+			return slot;
+		}
+
+		/* Another thread got the slot first */
+		pos = ast_atomic_load_n(&logger_ring.head, __ATOMIC_RELAXED);
+	}
+}
+
+/*! \brief Hand a claimed slot to the logger thread */
+static void logger_ring_publish(struct logger_ring_slot *slot)
+{
+	ast_atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_SEQ_CST);
+
+	/* Paired with the logger thread checking the ring after saying it sleeps */
+	if (ast_atomic_load_n(&logger_thread_sleeping, __ATOMIC_SEQ_CST)) {
+		ast_mutex_lock(&logmutex);
+		ast_cond_signal(&logcond);
+		ast_mutex_unlock(&logmutex);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the oldest message of the ring, from the logger thread
+ *
+ * \retval NULL if there is none yet
+ */
+static struct logger_ring_slot *logger_ring_peek(void)
+{
+	struct logger_ring_slot *slot = &logger_ring.slots[logger_ring.tail & logger_ring.mask];
+
+	if (ast_atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != logger_ring.tail + 1) {
+		return NULL;
+	}
+
+	return slot;
+}
+
+/*! \brief Free the slot returned by logger_ring_peek() */
+static void logger_ring_release(struct logger_ring_slot *slot)
+{
+	ast_atomic_store_n(&slot->seq, logger_ring.tail + logger_ring.mask + 1, __ATOMIC_RELEASE);
+	ast_atomic_store_n(&logger_ring.tail, logger_ring.tail + 1, __ATOMIC_RELEASE);
 }
 
 /*! \brief Actual logging thread */
 static void *logger_thread(void *data)
 {
-	struct logmsg *next = NULL, *msg = NULL;
+	struct logger_ring_slot *slot;
+	int alerted = 0;
 
 	for (;;) {
-		/* We lock the message list, and see if any message exists... if not we wait on the condition to be signalled */
-		AST_LIST_LOCK(&logmsgs);
-		if (AST_LIST_EMPTY(&logmsgs)) {
-			if (close_logger_thread) {
-				AST_LIST_UNLOCK(&logmsgs);
-				break;
-			} else {
-				ast_cond_wait(&logcond, &logmsgs.lock);
-			}
+		if (!alerted && ast_atomic_load_n(&high_water_alert, __ATOMIC_RELAXED)) {
+			logger_print_notice("Log queue threshold (%d) exceeded.  Discarding new messages.\n",
+				logger_queue_limit);
+			alerted = 1;
 		}
 
-		if (high_water_alert) {
-			msg = format_log_message(__LOG_WARNING, 0, "logger", 0, "***", 0,
-				"Logging resumed.  %d message%s discarded.\n",
-				logger_messages_discarded, logger_messages_discarded == 1 ? "" : "s");
-			if (msg) {
-				AST_LIST_INSERT_TAIL(&logmsgs, msg, list);
-			}
-			high_water_alert = 0;
-			logger_messages_discarded = 0;
+		/* Process each message in the order added */
+		slot = logger_ring_peek();
+		if (slot) {
+			logger_print_normal(&slot->msg);
+			logmsg_cleanup(&slot->msg);
+			logger_ring_release(slot);
+			continue;
 		}
 
-		next = AST_LIST_FIRST(&logmsgs);
-		AST_LIST_HEAD_INIT_NOLOCK(&logmsgs);
-		logger_queue_size = 0;
-		AST_LIST_UNLOCK(&logmsgs);
-
-		/* Otherwise go through and process each message in the order added */
-		while ((msg = next)) {
-			/* Get the next entry now so that we can free our current structure later */
-			next = AST_LIST_NEXT(msg, list);
+		if (alerted) {
+			unsigned int discarded;
 
-			/* Depending on the type, send it to the proper function */
-			logger_print_normal(msg);
+			ast_atomic_store_n(&high_water_alert, 0, __ATOMIC_SEQ_CST);
+			discarded = ast_atomic_exchange_n(&logger_messages_discarded, 0, __ATOMIC_SEQ_CST);
+			logger_print_notice("Logging resumed.  %u message%s discarded.\n",
+				discarded, ESS(discarded));
+			alerted = 0;
+			continue;
+		}
 
-			/* Free the data since we are done */
-			logmsg_free(msg);
+		/* The ring is empty, wait to be signalled once producers see we sleep */
+		ast_mutex_lock(&logmutex);
+		ast_atomic_store_n(&logger_thread_sleeping, 1, __ATOMIC_SEQ_CST);
+		if (!logger_ring_peek() && !ast_atomic_load_n(&high_water_alert, __ATOMIC_RELAXED)) {
+			if (close_logger_thread) {
+				ast_mutex_unlock(&logmutex);
+				break;
+			}
+			ast_cond_wait(&logcond, &logmutex);
 		}
+		ast_atomic_store_n(&logger_thread_sleeping, 0, __ATOMIC_SEQ_CST);
+		ast_mutex_unlock(&logmutex);
 	}
 
 	return NULL;
@@ -1779,25 +2570,62 @@ void logger_queue_start(void)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Read logger_queue_limit ahead of the rest of logger.conf
+ *
+ * \return The limit the ring has to hold
+ */
+static int logger_queue_limit_preload(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	const char *s;
+	int limit = logger_queue_limit;
+
+	cfg = ast_config_load2("logger.conf", "logger", config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return limit;
+	}
+
+	/* Invalid values are reported once the channels are set up */
+	if ((s = ast_variable_retrieve(cfg, "general", "logger_queue_limit"))
+		&& sscanf(s, "%30d", &limit) == 1 && limit < 10) {
+		limit = 10;
+	}
+	ast_config_destroy(cfg);
+
+	return limit;
+}
+
 int init_logger(void)
 {
 	int res;
 	/* auto rotate if sig SIGXFSZ comes a-knockin */
 	sigaction(SIGXFSZ, &handle_SIGXFSZ, NULL);
 
-	/* Re-initialize the logmsgs mutex.  The recursive mutex can be accessed prior
+	/* Re-initialize the logger mutex.  The recursive mutex can be accessed prior
  	 * to Asterisk being forked into the background, which can cause the thread
  	 * ID tracked by the underlying pthread mutex to be different than the ID of
  	 * the thread that unlocks the mutex.  Since init_logger is called after the
  	 * fork, it is safe to initialize the mutex here for future accesses.
  	 */
-	ast_mutex_destroy(&logmsgs.lock);
-	ast_mutex_init(&logmsgs.lock);
+	ast_mutex_destroy(&logmutex);
+	ast_mutex_init(&logmutex);
 	ast_cond_init(&logcond, NULL);
 
+	/* The ring is sized once, before the logger thread can use it */
+	logger_ring_alloc(logger_queue_limit_preload());
+	if (!logger_ring.slots) {
+		ast_cond_destroy(&logcond);
+		return -1;
+	}
+
 	/* start logger thread */
 	if (ast_pthread_create(&logthread, NULL, logger_thread, NULL) < 0) {
 		ast_cond_destroy(&logcond);
+		ast_free(logger_ring.slots);
+		logger_ring.slots = NULL;
 		return -1;
 	}
 
@@ -1828,10 +2656,10 @@ void close_logger(void)
 	logger_initialized = 0;
 
 	/* Stop logger thread */
-	AST_LIST_LOCK(&logmsgs);
+	ast_mutex_lock(&logmutex);
 	close_logger_thread = 1;
 	ast_cond_signal(&logcond);
-	AST_LIST_UNLOCK(&logmsgs);
+	ast_mutex_unlock(&logmutex);
 
 	if (logthread != AST_PTHREADT_NULL) {
 		pthread_join(logthread, NULL);
@@ -1849,6 +2677,10 @@ void close_logger(void)
 			fclose(f->fileptr);
 			f->fileptr = NULL;
 		}
+		if (f->binary) {
+			logger_binary_close(f->binary);
+			f->binary = NULL;
+		}
 		ast_free(f);
 	}
 
@@ -1962,48 +2794,46 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 	const char *file, int line, const char *function, ast_callid callid,
 	const char *fmt, va_list ap)
 {
-	struct logmsg *logmsg = NULL;
+	struct logger_ring_slot *slot;
+	struct ast_str *buf;
 
 	if (level == __LOG_VERBOSE && ast_opt_remote && ast_opt_exec) {
 		return;
 	}
 
-	AST_LIST_LOCK(&logmsgs);
-	if (logger_queue_size >= logger_queue_limit && !close_logger_thread) {
-		logger_messages_discarded++;
-		if (!high_water_alert && !close_logger_thread) {
-			logmsg = format_log_message(__LOG_WARNING, 0, "logger", 0, "***", 0,
-				"Log queue threshold (%d) exceeded.  Discarding new messages.\n", logger_queue_limit);
-			AST_LIST_INSERT_TAIL(&logmsgs, logmsg, list);
-			high_water_alert = 1;
-			ast_cond_signal(&logcond);
-		}
-		AST_LIST_UNLOCK(&logmsgs);
+	/* The text is formatted before claiming a slot, so the logger thread never waits on it */
+	buf = format_log_text_ap(fmt, ap);
+	if (!buf) {
 		return;
 	}
-	AST_LIST_UNLOCK(&logmsgs);
 
-	logmsg = format_log_message_ap(level, sublevel, file, line, function, callid, fmt, ap);
-	if (!logmsg) {
+	/* If the logger thread is not active, print it right away */
+	if (logthread == AST_PTHREADT_NULL) {
+		struct logmsg logmsg;
+
+		logmsg_init(&logmsg, level, sublevel, file, line, function, callid,
+			ast_str_buffer(buf), ast_str_strlen(buf));
+		logger_print_normal(&logmsg);
+		logmsg_cleanup(&logmsg);
 		return;
 	}
 
-	/* If the logger thread is active, append it to the tail end of the list - otherwise skip that step */
-	if (logthread != AST_PTHREADT_NULL) {
-		AST_LIST_LOCK(&logmsgs);
-		if (close_logger_thread) {
-			/* Logger is either closing or closed.  We cannot log this message. */
-			logmsg_free(logmsg);
-		} else {
-			AST_LIST_INSERT_TAIL(&logmsgs, logmsg, list);
-			logger_queue_size++;
-			ast_cond_signal(&logcond);
-		}
-		AST_LIST_UNLOCK(&logmsgs);
-	} else {
-		logger_print_normal(logmsg);
-		logmsg_free(logmsg);
+	if (close_logger_thread) {
+		/* Logger is either closing or closed.  We cannot log this message. */
+		return;
+	}
+
+	slot = logger_ring_reserve();
+	if (!slot) {
+		ast_atomic_fetch_add(&logger_messages_discarded, 1, __ATOMIC_RELAXED);
+		ast_atomic_fetch_add(&logger_messages_discarded_total, 1, __ATOMIC_RELAXED);
+		ast_atomic_store_n(&high_water_alert, 1, __ATOMIC_RELAXED);
+		return;
 	}
+
+	logmsg_init(&slot->msg, level, sublevel, file, line, function, callid,
+		ast_str_buffer(buf), ast_str_strlen(buf));
+	logger_ring_publish(slot);
 }
 
 void ast_log(int level, const char *file, int line, const char *function, const char *fmt, ...)
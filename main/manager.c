@@ -100,6 +100,7 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/translate.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/originate.h"
 
 /*** DOCUMENTATION
 	<manager name="Ping" language="en_US">
@@ -166,6 +167,21 @@
 			<parameter name="Secret">
 				<para>Secret to login with as specified in manager.conf.</para>
 			</parameter>
+			<parameter name="EventFormat">
+				<para>How events are sent on this connection.</para>
+				<enumlist>
+					<enum name="text">
+						<para>As <literal>Key: Value</literal> lines. This is the default.</para>
+					</enum>
+					<enum name="json">
+						<para>As JSON objects, each preceded by a line holding its length
+						in bytes. Events raised within <literal>eventbatchwindow</literal>
+						in <filename>manager.conf</filename> are sent in one write.
+						Responses are still sent as <literal>Key: Value</literal> lines.
+						Not supported for HTTP sessions.</para>
+					</enum>
+				</enumlist>
+			</parameter>
 		</syntax>
 		<description>
 			<para>Login Manager.</para>
@@ -1429,35 +1445,65 @@ enum add_filter_result {
 	FILTER_COMPILE_FAIL,
 };
 
+/*! \brief How an event filter is matched */
+enum event_filter_type {
+	/*! A regular expression, run with regexec() */
+	FILTER_TYPE_REGEX,
+	/*! A pattern without special characters, found with strstr() */
+	FILTER_TYPE_STRING,
+	/*! A plain "Event: <name>" pattern, usually compared at the start of the event */
+	FILTER_TYPE_EVENT,
+};
+
 /*!
- * Linked list of events.
- * Global events are appended to the list by append_event().
- * The usecount is the number of stored pointers to the element,
- * excluding the list pointers. So an element that is only in
- * the list has a usecount of 0, not 1.
- *
- * Clients have a pointer to the last event processed, and for each
- * of these clients we track the usecount of the elements.
- * If we have a pointer to an entry in the list, it is safe to navigate
- * it forward because elements will not be deleted, but only appended.
- * The worst that can happen is seeing the pointer still NULL.
- *
- * When the usecount of an element drops to 0, and the element is the
- * first in the list, we can remove it. Removal is done within the
- * main thread, which is woken up for the purpose.
+ * \brief An event filter compiled by manager_add_filter()
+ */
+struct event_filter_entry {
+	enum event_filter_type type;
+	/*! The compiled pattern, only for FILTER_TYPE_REGEX */
+	regex_t regex_filter;
+	size_t string_filter_len;
+	/*! The pattern as given */
+	char string_filter[0];
+};
+
+/*!
+ * \brief An event waiting to be sent to the sessions.
  *
- * For simplicity of implementation, we make sure the list is never empty.
+ * Each event is rendered once and a reference to it is queued to every
+ * session that may want it, see session_eventq_push().  It is freed when
+ * the last session has sent or dropped it.
  */
 struct eventqent {
-	int usecount;		/*!< # of clients who still need the event */
 	int category;
 	unsigned int seq;	/*!< sequence number */
 	struct timeval tv;  /*!< When event was allocated */
-	AST_RWLIST_ENTRY(eventqent) eq_next;
-	char eventdata[1];	/*!< really variable size, allocated by append_event() */
+	/*! Set if "Event: " can only be found at the start of the event */
+	unsigned int event_header_only:1;
+	/*! The event as a JSON object, if a session wanted that when it was raised */
+	char *json;
+	char eventdata[1];	/*!< really variable size, allocated by alloc_event() */
+};
+
+/*! \brief What to do with a new event when the event queue of a session is full */
+enum eventq_full_action {
+	/*! Drop the oldest event in the queue to make room */
+	EVENTQ_FULL_DROP_OLDEST,
+	/*! Disconnect the session, HTTP sessions drop the oldest event instead */
+	EVENTQ_FULL_DISCONNECT,
+};
+
+/*! \brief How events are sent to a session */
+enum event_format {
+	/*! As "Key: Value" lines */
+	EVENT_FORMAT_TEXT,
+	/*! As length prefixed JSON objects, written in batches */
+	EVENT_FORMAT_JSON,
 };
 
-static AST_RWLIST_HEAD_STATIC(all_events, eventqent);
+#define DEFAULT_EVENTQ_LIMIT	4096
+/*! Slots the event queue of a session starts with */
+#define EVENTQ_INITIAL_SIZE	64
 
 static int displayconnects = 1;
 static int allowmultiplelogin = 1;
@@ -1470,6 +1516,12 @@ static int webmanager_enabled = 0;
 static int manager_debug = 0;	/*!< enable some debugging code in the manager */
 static int authtimeout;
 static int authlimit;
+static unsigned int eventq_limit = DEFAULT_EVENTQ_LIMIT;
+static enum eventq_full_action eventq_full = EVENTQ_FULL_DROP_OLDEST;
+/*! Milliseconds events for JSON sessions are held back to be written together */
+static int eventbatchwindow;
+/*! Sessions logged in with EventFormat: json */
+static int json_event_sessions;
 static char *manager_channelvars;
 
 #define DEFAULT_REALM		"asterisk"
@@ -1592,14 +1644,24 @@ struct mansession_session {
 	struct ao2_container *blackfilters;	/*!< Manager event filters - black list */
 	struct ast_variable *chanvars;  /*!< Channel variables to set for originate */
 	int send_events;	/*!<  XXX what ? */
-	struct eventqent *last_ev;	/*!< last event processed. */
+	struct eventqent **eventq;	/*!< Ring of events waiting to be sent (Protected by notify_lock) */
+	unsigned int eventq_size;	/*!< Slots in eventq */
+	unsigned int eventq_head;	/*!< Slot of the oldest event in eventq */
+	unsigned int eventq_count;	/*!< Events in eventq */
+	unsigned int eventq_dropped;	/*!< Events dropped because eventq was full */
+	int eventq_overflow;	/*!< Set when eventq overflowed and the session must be disconnected */
+	enum event_format event_format;	/*!< How events are sent */
 	int writetimeout;	/*!< Timeout for ast_carefulwrite() */
 	time_t authstart;
 	int pending_event;         /*!< Pending events indicator in case when waiting_thread is NULL */
+	unsigned int filter_examined;	/*!< Events run through the event filters */
+	unsigned int filter_matched;	/*!< Events that passed the event filters */
+	int64_t filter_time;	/*!< Time spent running the event filters, in microseconds */
+	int filter_wakeups_skipped;	/*!< Events not queued to the session because it would drop them */
 	time_t noncetime;	/*!< Timer for nonce value expiration */
 	unsigned long oldnonce;	/*!< Stale nonce value */
 	unsigned long nc;	/*!< incremental  nonce counter */
-	ast_mutex_t notify_lock; /*!< Lock for notifying this session of events */
+	ast_mutex_t notify_lock; /*!< Lock for notifying this session of events and for its event queue */
 	AST_LIST_HEAD_NOLOCK(mansession_datastores, ast_datastore) datastores; /*!< Data stores on the session */
 	AST_LIST_ENTRY(mansession_session) list;
 };
@@ -1677,7 +1739,8 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions(
 	...);
 static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters);
 
-static int match_filter(struct mansession *s, char *eventdata);
+static int match_filter(struct mansession *s, const struct eventqent *eqe);
+static char *event_to_json(const char *eventdata);
 
 /*!
  * @{ \brief Define AMI message types.
@@ -1948,56 +2011,141 @@ int check_webmanager_enabled(void)
 	return (webmanager_enabled && manager_enabled);
 }
 
+static const char *eventq_full2str(enum eventq_full_action action)
+{
+	switch (action) {
+	case EVENTQ_FULL_DROP_OLDEST:
+		return "dropoldest";
+	case EVENTQ_FULL_DISCONNECT:
+		return "disconnect";
+	}
+
+	return "unknown";
+}
+
 /*!
- * Grab a reference to the last event, update usecount as needed.
- * Can handle a NULL pointer.
+ * \internal
+ * \brief Give the event queue of a session more slots, up to eventq_limit
+ *
+ * \note The session notify_lock must be held.
  */
-static struct eventqent *grab_last(void)
+static void session_eventq_grow(struct mansession_session *session)
 {
-	struct eventqent *ret;
+	struct eventqent **eventq;
+	unsigned int size;
+	unsigned int i;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	ret = AST_RWLIST_LAST(&all_events);
-	/* the list is never empty now, but may become so when
-	 * we optimize it in the future, so be prepared.
-	 */
-	if (ret) {
-		ast_atomic_fetchadd_int(&ret->usecount, 1);
+	size = session->eventq_size ? session->eventq_size * 2 : EVENTQ_INITIAL_SIZE;
+	if (size > eventq_limit) {
+		size = eventq_limit;
 	}
-	AST_RWLIST_UNLOCK(&all_events);
-	return ret;
+
+	eventq = ast_malloc(sizeof(*eventq) * size);
+	if (!eventq) {
+		return;
+	}
+	for (i = 0; i < session->eventq_count; ++i) {
+		eventq[i] = session->eventq[(session->eventq_head + i) % session->eventq_size];
+	}
+	ast_free(session->eventq);
+	session->eventq = eventq;
+	session->eventq_size = size;
+	session->eventq_head = 0;
 }
 
 /*!
- * Purge unused events. Remove elements from the head
- * as long as their usecount is 0 and there is a next element.
+ * \internal
+ * \brief Queue an event to a session
+ *
+ * \note The session notify_lock must be held.
  */
-static void purge_events(void)
+static void session_eventq_push(struct mansession_session *session, struct eventqent *eqe)
 {
-	struct eventqent *ev;
-	struct timeval now = ast_tvnow();
+	if (session->eventq_overflow) {
+		/* Waiting to be disconnected */
+		return;
+	}
 
-	AST_RWLIST_WRLOCK(&all_events);
-	while ( (ev = AST_RWLIST_FIRST(&all_events)) &&
-	    ev->usecount == 0 && AST_RWLIST_NEXT(ev, eq_next)) {
-		AST_RWLIST_REMOVE_HEAD(&all_events, eq_next);
-		ast_free(ev);
+	if (session->eventq_count == session->eventq_size && session->eventq_size < eventq_limit) {
+		session_eventq_grow(session);
 	}
 
-	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&all_events, ev, eq_next) {
-		/* Never release the last event */
-		if (!AST_RWLIST_NEXT(ev, eq_next)) {
-			break;
+	if (session->eventq_count >= eventq_limit || session->eventq_count == session->eventq_size) {
+		if (!session->eventq_dropped) {
+			ast_log(LOG_WARNING, "Event queue of manager session '%s' from %s is full\n",
+				session->username, ast_sockaddr_stringify_addr(&session->addr));
 		}
+		++session->eventq_dropped;
 
-		/* 2.5 times whatever the HTTP timeout is (maximum 2.5 hours) is the maximum time that we will definitely cache an event */
-		if (ev->usecount == 0 && ast_tvdiff_sec(now, ev->tv) > (httptimeout > 3600 ? 3600 : httptimeout) * 2.5) {
-			AST_RWLIST_REMOVE_CURRENT(eq_next);
-			ast_free(ev);
+		if (!session->eventq_count) {
+			/* There was no memory for a queue at all. */
+			return;
 		}
+		if (eventq_full == EVENTQ_FULL_DISCONNECT && !session->managerid) {
+			/* The session is disconnected once it sees the flag. */
+			session->eventq_overflow = 1;
+			return;
+		}
+
+		/* Make room by dropping the oldest event */
+		ao2_ref(session->eventq[session->eventq_head], -1);
+		session->eventq_head = (session->eventq_head + 1) % session->eventq_size;
+		--session->eventq_count;
 	}
-	AST_RWLIST_TRAVERSE_SAFE_END;
-	AST_RWLIST_UNLOCK(&all_events);
+
+	ao2_ref(eqe, +1);
+	session->eventq[(session->eventq_head + session->eventq_count) % session->eventq_size] = eqe;
+	++session->eventq_count;
+}
+
+/*!
+ * \internal
+ * \brief Take the oldest event queued to a session
+ *
+ * \return The event, which must be unreferenced, or NULL if there is none.
+ */
+static struct eventqent *session_eventq_pop(struct mansession_session *session)
+{
+	struct eventqent *eqe = NULL;
+
+	ast_mutex_lock(&session->notify_lock);
+	if (session->eventq_count) {
+		eqe = session->eventq[session->eventq_head];
+		session->eventq_head = (session->eventq_head + 1) % session->eventq_size;
+		--session->eventq_count;
+	}
+	ast_mutex_unlock(&session->notify_lock);
+
+	return eqe;
+}
+
+/*!
+ * \internal
+ * \brief How much longer events are held back to be sent in one batch
+ *
+ * \retval -1 No events are being held back
+ * \retval 0 The queued events should be sent now
+ * \return Milliseconds until they should be sent
+ */
+static int session_eventq_batch_wait(struct mansession_session *session)
+{
+	int wait = -1;
+
+	if (session->event_format != EVENT_FORMAT_JSON || !eventbatchwindow) {
+		return -1;
+	}
+
+	ast_mutex_lock(&session->notify_lock);
+	if (session->eventq_count) {
+		wait = eventbatchwindow
+			- ast_tvdiff_ms(ast_tvnow(), session->eventq[session->eventq_head]->tv);
+		if (wait < 0) {
+			wait = 0;
+		}
+	}
+	ast_mutex_unlock(&session->notify_lock);
+
+	return wait;
 }
 
 /*!
@@ -2183,15 +2331,18 @@ static struct mansession_session *unref_mansession(struct mansession_session *s)
 
 static void event_filter_destructor(void *obj)
 {
-	regex_t *regex_filter = obj;
-	regfree(regex_filter);
+	struct event_filter_entry *entry = obj;
+
+	if (entry->type == FILTER_TYPE_REGEX) {
+		regfree(&entry->regex_filter);
+	}
 }
 
 static void session_destructor(void *obj)
 {
 	struct mansession_session *session = obj;
-	struct eventqent *eqe = session->last_ev;
 	struct ast_datastore *datastore;
+	unsigned int i;
 
 	/* Get rid of each of the data stores on the session */
 	while ((datastore = AST_LIST_REMOVE_HEAD(&session->datastores, entry))) {
@@ -2199,9 +2350,14 @@ static void session_destructor(void *obj)
 		ast_datastore_free(datastore);
 	}
 
-	if (eqe) {
-		ast_atomic_fetchadd_int(&eqe->usecount, -1);
+	for (i = 0; i < session->eventq_count; ++i) {
+		ao2_ref(session->eventq[(session->eventq_head + i) % session->eventq_size], -1);
 	}
+	ast_free(session->eventq);
+	if (session->event_format == EVENT_FORMAT_JSON) {
+		ast_atomic_fetchadd_int(&json_event_sessions, -1);
+	}
+
 	if (session->chanvars) {
 		ast_variables_destroy(session->chanvars);
 	}
@@ -2646,8 +2802,8 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 	struct ao2_container *sessions;
 	struct mansession_session *session;
 	time_t now = time(NULL);
-#define HSMCONN_FORMAT1 "  %-15.15s  %-55.55s  %-10.10s  %-10.10s  %-8.8s  %-8.8s  %-5.5s  %-5.5s\n"
-#define HSMCONN_FORMAT2 "  %-15.15s  %-55.55s  %-10d  %-10d  %-8d  %-8d  %-5.5d  %-5.5d\n"
+#define HSMCONN_FORMAT1 "  %-15.15s  %-55.55s  %-10.10s  %-10.10s  %-8.8s  %-8.8s  %-5.5s  %-5.5s  %-6.6s  %-8.8s\n"
+#define HSMCONN_FORMAT2 "  %-15.15s  %-55.55s  %-10d  %-10d  %-8d  %-8d  %-5.5d  %-5.5d  %-6u  %-8u\n"
 	int count = 0;
 	struct ao2_iterator i;
 
@@ -2663,13 +2819,21 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 		return NULL;
 	}
 
-	ast_cli(a->fd, HSMCONN_FORMAT1, "Username", "IP Address", "Start", "Elapsed", "FileDes", "HttpCnt", "Read", "Write");
+	ast_cli(a->fd, HSMCONN_FORMAT1, "Username", "IP Address", "Start", "Elapsed", "FileDes", "HttpCnt", "Read", "Write", "Queued", "Dropped");
 
 	sessions = ao2_global_obj_ref(mgr_sessions);
 	if (sessions) {
 		i = ao2_iterator_init(sessions, 0);
 		ao2_ref(sessions, -1);
 		while ((session = ao2_iterator_next(&i))) {
+			unsigned int queued;
+			unsigned int dropped;
+
+			ast_mutex_lock(&session->notify_lock);
+			queued = session->eventq_count;
+			dropped = session->eventq_dropped;
+			ast_mutex_unlock(&session->notify_lock);
+
 			ao2_lock(session);
 			ast_cli(a->fd, HSMCONN_FORMAT2, session->username,
 				ast_sockaddr_stringify_addr(&session->addr),
@@ -2678,7 +2842,60 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 				session->stream ? ast_iostream_get_fd(session->stream) : -1,
 				session->inuse,
 				session->readperm,
-				session->writeperm);
+				session->writeperm,
+				queued,
+				dropped);
+			count++;
+			ao2_unlock(session);
+			unref_mansession(session);
+		}
+		ao2_iterator_destroy(&i);
+	}
+	ast_cli(a->fd, "%d users connected.\n", count);
+
+	return CLI_SUCCESS;
+}
+
+/*! \brief CLI command manager show filters */
+static char *handle_showmanfilters(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ao2_container *sessions;
+	struct mansession_session *session;
+#define HSMFILT_FORMAT1 "  %-15.15s  %-39.39s  %-7.7s  %-7.7s  %-10.10s  %-10.10s  %-10.10s  %-8.8s\n"
+#define HSMFILT_FORMAT2 "  %-15.15s  %-39.39s  %-7d  %-7d  %-10u  %-10u  %-10d  %-8" PRId64 "\n"
+	int count = 0;
+	struct ao2_iterator i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "manager show filters";
+		e->usage =
+			"Usage: manager show filters\n"
+			"	Prints the event filters of the connected manager sessions and\n"
+			"how much work they do: the events examined and passed, the events\n"
+			"not queued to the session because it would drop them, and the\n"
+			"average time spent filtering an event in microseconds.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	ast_cli(a->fd, HSMFILT_FORMAT1, "Username", "IP Address", "Include", "Exclude", "Examined", "Passed", "Skipped", "Avg(us)");
+
+	sessions = ao2_global_obj_ref(mgr_sessions);
+	if (sessions) {
+		i = ao2_iterator_init(sessions, 0);
+		ao2_ref(sessions, -1);
+		while ((session = ao2_iterator_next(&i))) {
+			ao2_lock(session);
+			ast_cli(a->fd, HSMFILT_FORMAT2, session->username,
+				ast_sockaddr_stringify_addr(&session->addr),
+				ao2_container_count(session->whitefilters),
+				ao2_container_count(session->blackfilters),
+				session->filter_examined,
+				session->filter_matched,
+				session->filter_wakeups_skipped,
+				session->filter_examined ? session->filter_time / session->filter_examined : 0);
 			count++;
 			ao2_unlock(session);
 			unref_mansession(session);
@@ -2694,25 +2911,43 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 /* Should change to "manager show connected" */
 static char *handle_showmaneventq(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
+	struct ao2_container *sessions;
+	struct mansession_session *session;
+	struct ao2_iterator i;
 	struct eventqent *s;
+	unsigned int x;
+
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "manager show eventq";
 		e->usage =
 			"Usage: manager show eventq\n"
-			"	Prints a listing of all events pending in the Asterisk manger\n"
-			"event queue.\n";
+			"	Prints a listing of all events pending in the event queue\n"
+			"of each Asterisk manager session.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
 	}
-	AST_RWLIST_RDLOCK(&all_events);
-	AST_RWLIST_TRAVERSE(&all_events, s, eq_next) {
-		ast_cli(a->fd, "Usecount: %d\n", s->usecount);
-		ast_cli(a->fd, "Category: %d\n", s->category);
-		ast_cli(a->fd, "Event:\n%s", s->eventdata);
+
+	sessions = ao2_global_obj_ref(mgr_sessions);
+	if (!sessions) {
+		return CLI_SUCCESS;
+	}
+	i = ao2_iterator_init(sessions, 0);
+	ao2_ref(sessions, -1);
+	while ((session = ao2_iterator_next(&i))) {
+		ast_mutex_lock(&session->notify_lock);
+		for (x = 0; x < session->eventq_count; ++x) {
+			s = session->eventq[(session->eventq_head + x) % session->eventq_size];
+			ast_cli(a->fd, "Session: %s@%s\n", session->username,
+				ast_sockaddr_stringify_addr(&session->addr));
+			ast_cli(a->fd, "Category: %d\n", s->category);
+			ast_cli(a->fd, "Event:\n%s", s->eventdata);
+		}
+		ast_mutex_unlock(&session->notify_lock);
+		unref_mansession(session);
 	}
-	AST_RWLIST_UNLOCK(&all_events);
+	ao2_iterator_destroy(&i);
 
 	return CLI_SUCCESS;
 }
@@ -2739,19 +2974,6 @@ static char *handle_manager_reload(struct ast_cli_entry *e, int cmd, struct ast_
 	return CLI_SUCCESS;
 }
 
-static struct eventqent *advance_event(struct eventqent *e)
-{
-	struct eventqent *next;
-
-	AST_RWLIST_RDLOCK(&all_events);
-	if ((next = AST_RWLIST_NEXT(e, eq_next))) {
-		ast_atomic_fetchadd_int(&next->usecount, 1);
-		ast_atomic_fetchadd_int(&e->usecount, -1);
-	}
-	AST_RWLIST_UNLOCK(&all_events);
-	return next;
-}
-
 #define	GET_HEADER_FIRST_MATCH	0
 #define	GET_HEADER_LAST_MATCH	1
 #define	GET_HEADER_SKIP_EMPTY	2
@@ -3497,7 +3719,7 @@ static int authenticate(struct mansession *s, const struct message *m)
 	const char *password = astman_get_header(m, "Secret");
 	int error = -1;
 	struct ast_manager_user *user = NULL;
-	regex_t *regex_filter;
+	struct event_filter_entry *regex_filter;
 	struct ao2_iterator filter_iter;
 
 	if (ast_strlen_zero(username)) {	/* missing username */
@@ -4251,9 +4473,6 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 
 	for (x = 0; x < timeout || timeout < 0; x++) {
 		ao2_lock(s->session);
-		if (AST_RWLIST_NEXT(s->session->last_ev, eq_next)) {
-			needexit = 1;
-		}
 		if (s->session->needdestroy) {
 			needexit = 1;
 		}
@@ -4263,6 +4482,9 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 		 * HTTP session. XXX this needs to be improved.
 		 */
 		ast_mutex_lock(&s->session->notify_lock);
+		if (s->session->eventq_count) {
+			needexit = 1;
+		}
 		if (s->session->waiting_thread != pthread_self()) {
 			needexit = 1;
 		}
@@ -4282,20 +4504,20 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 
 	ast_mutex_lock(&s->session->notify_lock);
 	if (s->session->waiting_thread == pthread_self()) {
-		struct eventqent *eqe = s->session->last_ev;
+		struct eventqent *eqe;
 
 		s->session->waiting_thread = AST_PTHREADT_NULL;
 		ast_mutex_unlock(&s->session->notify_lock);
 
 		ao2_lock(s->session);
 		astman_send_response(s, m, "Success", "Waiting for Event completed.");
-		while ((eqe = advance_event(eqe))) {
+		while ((eqe = session_eventq_pop(s->session))) {
 			if (((s->session->readperm & eqe->category) == eqe->category)
 				&& ((s->session->send_events & eqe->category) == eqe->category)
-				&& match_filter(s, eqe->eventdata)) {
+				&& match_filter(s, eqe)) {
 				astman_append(s, "%s", eqe->eventdata);
 			}
-			s->session->last_ev = eqe;
+			ao2_ref(eqe, -1);
 		}
 		astman_append(s,
 			"Event: WaitEventComplete\r\n"
@@ -4381,6 +4603,7 @@ static int action_logoff(struct mansession *s, const struct message *m)
 
 static int action_login(struct mansession *s, const struct message *m)
 {
+	const char *event_format = astman_get_header(m, "EventFormat");
 
 	/* still authenticated - don't process again */
 	if (s->session->authenticated) {
@@ -4388,6 +4611,12 @@ static int action_login(struct mansession *s, const struct message *m)
 		return 0;
 	}
 
+	if (!ast_strlen_zero(event_format) && strcasecmp(event_format, "text")
+		&& (strcasecmp(event_format, "json") || s->session->managerid)) {
+		astman_send_error(s, m, "Unsupported EventFormat");
+		return 0;
+	}
+
 	if (authenticate(s, m)) {
 		sleep(1);
 		astman_send_error(s, m, "Authentication failed");
@@ -4399,6 +4628,10 @@ static int action_login(struct mansession *s, const struct message *m)
 		ast_verb(2, "%sManager '%s' logged on from %s\n", (s->session->managerid ? "HTTP " : ""), s->session->username, ast_sockaddr_stringify_addr(&s->session->addr));
 	}
 	astman_send_ack(s, m, "Authentication accepted");
+	if (!strcasecmp(event_format, "json")) {
+		ast_atomic_fetchadd_int(&json_event_sessions, 1);
+		s->session->event_format = EVENT_FORMAT_JSON;
+	}
 	if ((s->session->send_events & EVENT_FLAG_SYSTEM)
 		&& (s->session->readperm & EVENT_FLAG_SYSTEM)
 		&& ast_test_flag(&ast_options, AST_OPT_FLAG_FULLY_BOOTED)) {
@@ -4419,11 +4652,27 @@ static int action_login(struct mansession *s, const struct message *m)
 			lastreloaded = tmp.tv_sec;
 		}
 
-		astman_append(s, "Event: FullyBooted\r\n"
-			"Privilege: %s\r\n"
-			"Uptime: %ld\r\n"
-			"LastReload: %ld\r\n"
-			"Status: Fully Booted\r\n\r\n", cat_str, uptime, lastreloaded);
+		if (s->session->event_format == EVENT_FORMAT_JSON) {
+			char event[256];
+			char *json;
+
+			snprintf(event, sizeof(event), "Event: FullyBooted\r\n"
+				"Privilege: %s\r\n"
+				"Uptime: %ld\r\n"
+				"LastReload: %ld\r\n"
+				"Status: Fully Booted\r\n\r\n", cat_str, uptime, lastreloaded);
+			json = event_to_json(event);
+			if (json) {
+				astman_append(s, "%zu\r\n%s", strlen(json), json);
+				ast_json_free(json);
+			}
+		} else {
+			astman_append(s, "Event: FullyBooted\r\n"
+				"Privilege: %s\r\n"
+				"Uptime: %ld\r\n"
+				"LastReload: %ld\r\n"
+				"Status: Fully Booted\r\n\r\n", cat_str, uptime, lastreloaded);
+		}
 	}
 	return 0;
 }
@@ -5330,7 +5579,7 @@ static void destroy_fast_originate_helper(struct fast_originate_helper *doomed)
 	ast_free(doomed);
 }
 
-static void *fast_originate(void *data)
+static void fast_originate(void *data)
 {
 	struct fast_originate_helper *in = data;
 	int res;
@@ -5358,6 +5607,10 @@ static void *fast_originate(void *data)
 			in->vars, in->account, &chan, in->early_media, &assignedids);
 	}
 
+	if (!res) {
+		ast_originate_answered();
+	}
+
 	if (!chan) {
 		snprintf(requested_channel, AST_CHANNEL_NAME, "%s/%s", in->tech, in->data);
 	}
@@ -5407,7 +5660,6 @@ static void *fast_originate(void *data)
 		ast_channel_unref(chan);
 	}
 	destroy_fast_originate_helper(in);
-	return NULL;
 }
 
 static int aocmessage_get_unit_entry(const struct message *m, struct ast_aoc_unit_entry *entry, unsigned int entry_num)
@@ -5669,7 +5921,7 @@ static int action_originate(struct mansession *s, const struct message *m)
 	char tmp[256];
 	char tmp2[256];
 	struct ast_format_cap *cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
-	pthread_t th;
+	char destination[256];
 	int bridge_early = 0;
 
 	if (!cap) {
@@ -5816,7 +6068,8 @@ static int action_originate(struct mansession *s, const struct message *m)
 			fast->timeout = to;
 			fast->early_media = bridge_early;
 			fast->priority = pi;
-			if (ast_pthread_create_detached(&th, NULL, fast_originate, fast)) {
+			snprintf(destination, sizeof(destination), "%s/%s", tech, data);
+			if (ast_originate_push(destination, fast_originate, fast)) {
 				destroy_fast_originate_helper(fast);
 				res = -1;
 			} else {
@@ -5995,13 +6248,58 @@ static int action_timeout(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+/*! \brief What the filter callbacks are matching */
+struct event_filter_check {
+	const char *eventdata;
+	/*! Set if "Event: " can only be found at the start of eventdata */
+	int event_header_only;
+	/*! Set to give up instead of running regular expressions */
+	int no_regex;
+	/*! Set when a regular expression was skipped */
+	int unknown;
+};
+
+/*!
+ * \internal
+ * \brief Whether an event filter matches an event
+ *
+ * \retval 1 The filter matches
+ * \retval 0 The filter does not match
+ * \retval -1 The filter is a regular expression and check->no_regex is set
+ */
+static int event_filter_match(const struct event_filter_entry *entry, struct event_filter_check *check)
+{
+	switch (entry->type) {
+	case FILTER_TYPE_EVENT:
+		if (check->event_header_only) {
+			/* Nothing but the Event header itself can match. */
+			return !strncmp(check->eventdata, entry->string_filter, entry->string_filter_len);
+		}
+		/* Fall through */
+	case FILTER_TYPE_STRING:
+		return strstr(check->eventdata, entry->string_filter) != NULL;
+	case FILTER_TYPE_REGEX:
+		if (check->no_regex) {
+			check->unknown = 1;
+			return -1;
+		}
+		return !regexec(&entry->regex_filter, check->eventdata, 0, NULL, 0);
+	}
+
+	return 0;
+}
+
 static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 {
-	regex_t *regex_filter = obj;
-	const char *eventdata = arg;
+	struct event_filter_entry *entry = obj;
+	struct event_filter_check *check = arg;
 	int *result = data;
+	int res = event_filter_match(entry, check);
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
+	if (res < 0) {
+		return CMP_STOP;
+	}
+	if (res) {
 		*result = 1;
 		return (CMP_MATCH | CMP_STOP);
 	}
@@ -6011,11 +6309,15 @@ static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 
 static int blackfilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 {
-	regex_t *regex_filter = obj;
-	const char *eventdata = arg;
+	struct event_filter_entry *entry = obj;
+	struct event_filter_check *check = arg;
 	int *result = data;
+	int res = event_filter_match(entry, check);
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
+	if (res < 0) {
+		return CMP_STOP;
+	}
+	if (res) {
 		*result = 0;
 		return (CMP_MATCH | CMP_STOP);
 	}
@@ -6080,13 +6382,10 @@ static int action_filter(struct mansession *s, const struct message *m)
  *
  */
 static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters) {
-	regex_t *new_filter = ao2_t_alloc(sizeof(*new_filter), event_filter_destructor, "event_filter allocation");
+	struct event_filter_entry *new_filter;
+	size_t pattern_len;
 	int is_blackfilter;
 
-	if (!new_filter) {
-		return FILTER_ALLOC_FAILED;
-	}
-
 	if (filter_pattern[0] == '!') {
 		is_blackfilter = 1;
 		filter_pattern++;
@@ -6094,9 +6393,31 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 		is_blackfilter = 0;
 	}
 
-	if (regcomp(new_filter, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
+	pattern_len = strlen(filter_pattern);
+	new_filter = ao2_t_alloc(sizeof(*new_filter) + pattern_len + 1, event_filter_destructor, "event_filter allocation");
+	if (!new_filter) {
+		return FILTER_ALLOC_FAILED;
+	}
+	memcpy(new_filter->string_filter, filter_pattern, pattern_len + 1);
+	new_filter->string_filter_len = pattern_len;
+
+	/*
+	 * Without special characters a regular expression only matches
+	 * itself, so it can be found without running it.
+	 */
+	if (pattern_len && !filter_pattern[strcspn(filter_pattern, ".[]()*+?{}|^$\\")]) {
+		new_filter->type = FILTER_TYPE_STRING;
+		if (!strncmp(filter_pattern, "Event: ", 7) && pattern_len > 7
+			&& !filter_pattern[strcspn(filter_pattern, "\r\n")]) {
+			new_filter->type = FILTER_TYPE_EVENT;
+		}
+	} else if (regcomp(&new_filter->regex_filter, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
+		/* Do not free a regex that was never compiled. */
+		new_filter->type = FILTER_TYPE_STRING;
 		ao2_t_ref(new_filter, -1, "failed to make regex");
 		return FILTER_COMPILE_FAIL;
+	} else {
+		new_filter->type = FILTER_TYPE_REGEX;
 	}
 
 	if (is_blackfilter) {
@@ -6110,35 +6431,151 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 	return FILTER_SUCCESS;
 }
 
-static int match_filter(struct mansession *s, char *eventdata)
+/*!
+ * \internal
+ * \brief Run the event filters of a session
+ *
+ * \param no_regex Set to give up rather than run regular expressions.
+ *
+ * \retval 1 The event passes the filters
+ * \retval 0 The event is filtered out
+ * \retval -1 Only a regular expression can tell and no_regex is set
+ */
+static int session_filter_event(struct mansession_session *session, const char *eventdata,
+	int event_header_only, int no_regex)
 {
+	struct event_filter_check check = {
+		.eventdata = eventdata,
+		.event_header_only = event_header_only,
+		.no_regex = no_regex,
+	};
 	int result = 0;
 
-	if (manager_debug) {
-		ast_verbose("<-- Examining AMI event: -->\n%s\n", eventdata);
-	} else {
-		ast_debug(3, "Examining AMI event:\n%s\n", eventdata);
-	}
-	if (!ao2_container_count(s->session->whitefilters) && !ao2_container_count(s->session->blackfilters)) {
+	if (!ao2_container_count(session->whitefilters) && !ao2_container_count(session->blackfilters)) {
 		return 1; /* no filtering means match all */
-	} else if (ao2_container_count(s->session->whitefilters) && !ao2_container_count(s->session->blackfilters)) {
+	} else if (ao2_container_count(session->whitefilters) && !ao2_container_count(session->blackfilters)) {
 		/* white filters only: implied black all filter processed first, then white filters */
-		ao2_t_callback_data(s->session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
-	} else if (!ao2_container_count(s->session->whitefilters) && ao2_container_count(s->session->blackfilters)) {
+		ao2_t_callback_data(session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, &check, &result, "find filter in session filter container");
+	} else if (!ao2_container_count(session->whitefilters) && ao2_container_count(session->blackfilters)) {
 		/* black filters only: implied white all filter processed first, then black filters */
-		ao2_t_callback_data(s->session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+		ao2_t_callback_data(session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, &check, &result, "find filter in session filter container");
 	} else {
 		/* white and black filters: implied black all filter processed first, then white filters, and lastly black filters */
-		ao2_t_callback_data(s->session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+		ao2_t_callback_data(session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, &check, &result, "find filter in session filter container");
 		if (result) {
 			result = 0;
-			ao2_t_callback_data(s->session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+			ao2_t_callback_data(session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, &check, &result, "find filter in session filter container");
 		}
 	}
 
+	return check.unknown ? -1 : result;
+}
+
+/*!
+ * \note The session must be locked.
+ */
+static int match_filter(struct mansession *s, const struct eventqent *eqe)
+{
+	struct timeval start;
+	int result;
+
+	if (manager_debug) {
+		ast_verbose("<-- Examining AMI event: -->\n%s\n", eqe->eventdata);
+	} else {
+		ast_debug(3, "Examining AMI event:\n%s\n", eqe->eventdata);
+	}
+
+	start = ast_tvnow();
+	result = session_filter_event(s->session, eqe->eventdata, eqe->event_header_only, 0);
+	s->session->filter_time += ast_tvdiff_us(ast_tvnow(), start);
+	++s->session->filter_examined;
+	if (result) {
+		++s->session->filter_matched;
+	}
+
 	return result;
 }
 
+AST_THREADSTORAGE(event_batch_buf);
+#define EVENT_BATCH_BUF_INITSIZE   1024
+
+/*!
+ * \internal
+ * \brief Convert the "Key: Value" lines of an event to a JSON object
+ *
+ * A key appearing more than once becomes an array of its values.
+ *
+ * \return The encoded object, to be freed with ast_json_free(), or NULL
+ */
+static char *event_to_json(const char *eventdata)
+{
+	struct ast_json *obj;
+	char *copy;
+	char *next;
+	char *line;
+	char *json;
+
+	obj = ast_json_object_create();
+	copy = ast_strdup(eventdata);
+	if (!obj || !copy) {
+		ast_json_unref(obj);
+		ast_free(copy);
+		return NULL;
+	}
+
+	next = copy;
+	while ((line = strsep(&next, "\n"))) {
+		struct ast_json *existing;
+		struct ast_json *value;
+		char *val;
+
+		val = strchr(line, ':');
+		if (!val) {
+			continue;
+		}
+		*val++ = '\0';
+		val = ast_strip(val);
+		line = ast_strip(line);
+
+		value = ast_json_string_create(val);
+		existing = ast_json_object_get(obj, line);
+		if (existing && ast_json_typeof(existing) == AST_JSON_ARRAY) {
+			ast_json_array_append(existing, value);
+		} else if (existing) {
+			struct ast_json *values = ast_json_array_create();
+
+			ast_json_array_append(values, ast_json_ref(existing));
+			ast_json_array_append(values, value);
+			ast_json_object_set(obj, line, values);
+		} else {
+			ast_json_object_set(obj, line, value);
+		}
+	}
+	ast_free(copy);
+
+	json = ast_json_dump_string(obj);
+	ast_json_unref(obj);
+
+	return json;
+}
+
+/*!
+ * \internal
+ * \brief Append an event to a batch as a length prefixed JSON object
+ */
+static void append_event_frame(struct ast_str **batch, const struct eventqent *eqe)
+{
+	char *json = eqe->json ? eqe->json : event_to_json(eqe->eventdata);
+
+	if (!json) {
+		return;
+	}
+	ast_str_append(batch, 0, "%zu\r\n%s", strlen(json), json);
+	if (json != eqe->json) {
+		ast_json_free(json);
+	}
+}
+
 /*!
  * Send any applicable events to the client listening on this socket.
  * Wait only for a finite time on each event, and drop all events whether
@@ -6146,13 +6583,28 @@ static int match_filter(struct mansession *s, char *eventdata)
  */
 static int process_events(struct mansession *s)
 {
+	struct ast_str *batch = NULL;
 	int ret = 0;
 
+	if (session_eventq_batch_wait(s->session) > 0) {
+		/* get_input() comes back when the batch is due. */
+		return 0;
+	}
+
 	ao2_lock(s->session);
 	if (s->session->stream != NULL) {
-		struct eventqent *eqe = s->session->last_ev;
+		struct eventqent *eqe;
+
+		if (s->session->event_format == EVENT_FORMAT_JSON) {
+			batch = ast_str_thread_get(&event_batch_buf, EVENT_BATCH_BUF_INITSIZE);
+			if (!batch) {
+				ao2_unlock(s->session);
+				return -1;
+			}
+			ast_str_reset(batch);
+		}
 
-		while ((eqe = advance_event(eqe))) {
+		while ((eqe = session_eventq_pop(s->session))) {
 			if (eqe->category == EVENT_FLAG_SHUTDOWN) {
 				ast_debug(3, "Received CloseSession event\n");
 				ret = -1;
@@ -6160,12 +6612,22 @@ static int process_events(struct mansession *s)
 			if (!ret && s->session->authenticated &&
 			    (s->session->readperm & eqe->category) == eqe->category &&
 			    (s->session->send_events & eqe->category) == eqe->category) {
-					if (match_filter(s, eqe->eventdata)) {
-						if (send_string(s, eqe->eventdata) < 0)
+					if (match_filter(s, eqe)) {
+						if (batch) {
+							append_event_frame(&batch, eqe);
+						} else if (send_string(s, eqe->eventdata) < 0)
 							ret = -1;	/* don't send more */
 					}
 			}
-			s->session->last_ev = eqe;
+			ao2_ref(eqe, -1);
+		}
+		if (batch && ast_str_strlen(batch) && send_string(s, ast_str_buffer(batch)) < 0) {
+			ret = -1;
+		}
+		if (s->session->eventq_overflow) {
+			ast_log(LOG_WARNING, "Disconnecting manager session '%s' from %s, it fell %u events behind\n",
+				s->session->username, ast_sockaddr_stringify_addr(&s->session->addr), eventq_limit);
+			ret = -1;
 		}
 	}
 	ao2_unlock(s->session);
@@ -6702,6 +7164,12 @@ static int get_input(struct mansession *s, char *output)
 				/* we have timed out */
 				return 0;
 			}
+		} else {
+			/* Come back when the events held back for a batch are due. */
+			timeout = session_eventq_batch_wait(s->session);
+			if (!timeout) {
+				return 0;
+			}
 		}
 
 		ast_mutex_lock(&s->session->notify_lock);
@@ -6887,8 +7355,6 @@ static void *session_do(void *data)
 	ast_iostream_nonblock(ser->stream);
 
 	ao2_lock(session);
-	/* Hook to the tail of the event queue */
-	session->last_ev = grab_last();
 
 	ast_mutex_init(&s.lock);
 
@@ -6981,32 +7447,36 @@ static void purge_sessions(int n_max)
 	ao2_iterator_destroy(&i);
 }
 
+static void event_destructor(void *obj)
+{
+	struct eventqent *eqe = obj;
+
+	ast_json_free(eqe->json);
+}
+
 /*! \brief
- * events are appended to a queue from where they
- * can be dispatched to clients.
+ * events are allocated once and queued to each session
+ * from where they can be dispatched to clients.
  */
-static int append_event(const char *str, int category)
+static struct eventqent *alloc_event(const char *str, int event_header_only, int category)
 {
-	struct eventqent *tmp = ast_malloc(sizeof(*tmp) + strlen(str));
+	struct eventqent *tmp;
 	static int seq;	/* sequence number */
 
+	tmp = ao2_alloc_options(sizeof(*tmp) + strlen(str), event_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!tmp) {
-		return -1;
+		return NULL;
 	}
 
-	/* need to init all fields, because ast_malloc() does not */
-	tmp->usecount = 0;
 	tmp->category = category;
 	tmp->seq = ast_atomic_fetchadd_int(&seq, 1);
 	tmp->tv = ast_tvnow();
-	AST_RWLIST_NEXT(tmp, eq_next) = NULL;
 	strcpy(tmp->eventdata, str);
+	tmp->event_header_only = event_header_only;
+	/* Converted once for all of the JSON sessions */
+	tmp->json = json_event_sessions ? event_to_json(str) : NULL;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	AST_RWLIST_INSERT_TAIL(&all_events, tmp, eq_next);
-	AST_RWLIST_UNLOCK(&all_events);
-
-	return 0;
+	return tmp;
 }
 
 static void append_channel_vars(struct ast_str **pbuf, struct ast_channel *chan)
@@ -7045,6 +7515,8 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 	const char *cat_str;
 	struct timeval now;
 	struct ast_str *buf;
+	struct eventqent *eqe;
+	int event_header_only;
 	int i;
 
 	buf = ast_str_thread_get(&manager_event_buf, MANAGER_EVENT_BUF_INITSIZE);
@@ -7089,16 +7561,39 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 
 	ast_str_append(&buf, 0, "\r\n");
 
-	append_event(ast_str_buffer(buf), category);
+	/* Worked out once here for the event filters of every session */
+	event_header_only = !strstr(ast_str_buffer(buf) + 1, "Event: ");
+	eqe = alloc_event(ast_str_buffer(buf), event_header_only, category);
 
-	/* Wake up any sleeping sessions */
-	if (sessions) {
+	/* Queue the event and wake up any sleeping sessions */
+	if (sessions && eqe) {
 		struct ao2_iterator iter;
 		struct mansession_session *session;
 
 		iter = ao2_iterator_init(sessions, 0);
 		while ((session = ao2_iterator_next(&iter))) {
+			/*
+			 * Leave out the sessions that are not allowed or do not
+			 * want the event and those whose filters are certain to
+			 * drop it.  They are not woken up for it either.
+			 */
+			if (category != EVENT_FLAG_SHUTDOWN
+				&& ((session->readperm & category) != category
+					|| (session->send_events & category) != category
+					|| !session_filter_event(session, ast_str_buffer(buf), event_header_only, 1))) {
+				ast_atomic_fetchadd_int(&session->filter_wakeups_skipped, 1);
+				unref_mansession(session);
+				continue;
+			}
 			ast_mutex_lock(&session->notify_lock);
+			session_eventq_push(session, eqe);
+			if (session->event_format == EVENT_FORMAT_JSON && eventbatchwindow
+				&& session->eventq_count > 1) {
+				/* Already woken up for the first event of the batch */
+				ast_mutex_unlock(&session->notify_lock);
+				unref_mansession(session);
+				continue;
+			}
 			if (session->waiting_thread != AST_PTHREADT_NULL) {
 				pthread_kill(session->waiting_thread, SIGURG);
 			} else {
@@ -7114,6 +7609,7 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 		}
 		ao2_iterator_destroy(&iter);
 	}
+	ao2_cleanup(eqe);
 
 	if (category != EVENT_FLAG_SHUTDOWN && !AST_RWLIST_EMPTY(&manager_hooks)) {
 		struct manager_custom_hook *hook;
@@ -7871,7 +8367,6 @@ static int generic_http_callback(struct ast_tcptls_session_instance *ser,
 		 */
 		while ((session->managerid = ast_random() ^ (unsigned long) session) == 0) {
 		}
-		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
 	}
 	ao2_unlock(session);
@@ -8180,7 +8675,6 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 
 		ast_copy_string(session->username, u_username, sizeof(session->username));
 		session->managerid = nonce;
-		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
 
 		session->readperm = u_readperm;
@@ -8556,7 +9050,6 @@ static int webregged = 0;
 static void purge_old_stuff(void *data)
 {
 	purge_sessions(1);
-	purge_events();
 }
 
 static struct ast_tls_config ami_tls_cfg;
@@ -8613,6 +9106,9 @@ static char *handle_manager_show_settings(struct ast_cli_entry *e, int cmd, stru
 	ast_cli(a->fd, FORMAT, "Allow multiple login:", AST_CLI_YESNO(allowmultiplelogin));
 	ast_cli(a->fd, FORMAT, "Display connects:", AST_CLI_YESNO(displayconnects));
 	ast_cli(a->fd, FORMAT, "Timestamp events:", AST_CLI_YESNO(timestampevents));
+	ast_cli(a->fd, FORMAT2, "Event queue limit:", eventq_limit);
+	ast_cli(a->fd, FORMAT, "Event queue full:", eventq_full2str(eventq_full));
+	ast_cli(a->fd, FORMAT2, "Event batch window (ms):", eventbatchwindow);
 	ast_cli(a->fd, FORMAT, "Channel vars:", S_OR(manager_channelvars, ""));
 	ast_cli(a->fd, FORMAT, "Debug:", AST_CLI_YESNO(manager_debug));
 #undef FORMAT
@@ -8814,6 +9310,7 @@ static struct ast_cli_entry cli_manager[] = {
 	AST_CLI_DEFINE(handle_showmancmd, "Show a manager interface command"),
 	AST_CLI_DEFINE(handle_showmancmds, "List manager interface commands"),
 	AST_CLI_DEFINE(handle_showmanconn, "List connected manager interface users"),
+	AST_CLI_DEFINE(handle_showmanfilters, "List the event filter statistics of connected manager users"),
 	AST_CLI_DEFINE(handle_showmaneventq, "List manager interface queued events"),
 	AST_CLI_DEFINE(handle_showmanagers, "List configured manager users"),
 	AST_CLI_DEFINE(handle_showmanager, "Display information on a specific manager user"),
@@ -9041,6 +9538,9 @@ static void manager_set_defaults(void)
 	broken_events_action = 0;
 	authtimeout = 30;
 	authlimit = 50;
+	eventq_limit = DEFAULT_EVENTQ_LIMIT;
+	eventq_full = EVENTQ_FULL_DROP_OLDEST;
+	eventbatchwindow = 0;
 	manager_debug = 0;		/* Debug disabled by default */
 
 	/* default values */
@@ -9142,11 +9642,6 @@ static int __init_manager(int reload, int by_external_config)
 		__ast_custom_function_register(&managerclient_function, NULL);
 		ast_extension_state_add(NULL, NULL, manager_state_cb, NULL);
 
-		/* Append placeholder event so master_eventq never runs dry */
-		if (append_event("Event: Placeholder\r\n\r\n", 0)) {
-			return -1;
-		}
-
 #ifdef AST_XML_DOCS
 		temp_event_docs = ast_xmldoc_build_documentation("managerEvent");
 		if (temp_event_docs) {
@@ -9257,6 +9752,24 @@ static int __init_manager(int reload, int by_external_config)
 			} else {
 				authlimit = limit;
 			}
+		} else if (!strcasecmp(var->name, "eventqueuelimit")) {
+			if (ast_parse_arg(val, PARSE_UINT32 | PARSE_IN_RANGE, &eventq_limit, 1, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid eventqueuelimit value '%s', using default value\n", val);
+				eventq_limit = DEFAULT_EVENTQ_LIMIT;
+			}
+		} else if (!strcasecmp(var->name, "eventqueuefull")) {
+			if (!strcasecmp(val, "dropoldest")) {
+				eventq_full = EVENTQ_FULL_DROP_OLDEST;
+			} else if (!strcasecmp(val, "disconnect")) {
+				eventq_full = EVENTQ_FULL_DISCONNECT;
+			} else {
+				ast_log(LOG_WARNING, "Invalid eventqueuefull value '%s', using default value\n", val);
+			}
+		} else if (!strcasecmp(var->name, "eventbatchwindow")) {
+			if (ast_parse_arg(val, PARSE_INT32 | PARSE_IN_RANGE, &eventbatchwindow, 0, 1000)) {
+				ast_log(LOG_WARNING, "Invalid eventbatchwindow value '%s', using default value\n", val);
+				eventbatchwindow = 0;
+			}
 		} else if (!strcasecmp(var->name, "channelvars")) {
 			load_channelvars(var);
 		} else {
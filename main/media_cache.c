@@ -37,6 +37,7 @@
 #include "asterisk/cli.h"
 #include "asterisk/file.h"
 #include "asterisk/media_cache.h"
+#include "asterisk/options.h"
 
 /*! The name of the AstDB family holding items in the cache. */
 #define AST_DB_FAMILY "MediaCache"
@@ -50,6 +51,57 @@
 /*! Our one and only container holding media items */
 static struct ao2_container *media_cache;
 
+/*! \brief How much an item in the media cache is used, to evict the least recently used */
+struct media_cache_usage {
+	/*! Size of the local file in bytes */
+	off_t size;
+	/*! Position of the last retrieval of the item among all retrievals */
+	unsigned long last_used;
+	/*! The URI of the item */
+	char uri[0];
+};
+
+/*! \brief A retrieval from a backend that other requesters of the same URI wait for */
+struct media_cache_fetch {
+	AST_LIST_ENTRY(media_cache_fetch) list;
+	/*! Signaled once the retrieval is done */
+	ast_cond_t cond;
+	/*! Whether the retrieval is done */
+	int done;
+	/*! The URI being retrieved */
+	char uri[0];
+};
+
+/*!
+ * \brief The use of the items in \ref media_cache
+ *
+ * This and everything below is protected by the lock of \ref media_cache.
+ */
+static struct ao2_container *media_usage;
+
+/*! Retrievals from backends in progress */
+static AST_LIST_HEAD_NOLOCK_STATIC(media_fetches, media_cache_fetch);
+
+/*! Total size of the local files of the items in the cache */
+static off_t media_cache_bytes;
+
+/*! Retrievals made, to order the items by their last use */
+static unsigned long media_cache_uses;
+
+/*! \brief Counters shown by 'media cache show stats' */
+static struct {
+	/*! Retrievals answered from the cache */
+	unsigned long hits;
+	/*! Retrievals that went to a backend */
+	unsigned long misses;
+	/*! Retrievals that waited for another one of the same URI */
+	unsigned long joined;
+	/*! Items evicted to keep the cache under its size limit */
+	unsigned long evictions;
+	/*! Bytes of the evicted items */
+	uintmax_t evicted_bytes;
+} media_cache_stats;
+
 int ast_media_cache_exists(const char *uri)
 {
 	struct ast_bucket_file *bucket_file;
@@ -124,6 +176,146 @@ static void media_cache_item_del_from_astdb(struct ast_bucket_file *bucket_file)
 	ast_free(hash_value);
 }
 
+AO2_STRING_FIELD_HASH_FN(media_cache_usage, uri);
+AO2_STRING_FIELD_CMP_FN(media_cache_usage, uri);
+
+/*!
+ * \internal
+ * \brief Record the retrieval of an item stored in a local file
+ * \note The lock of \ref media_cache must be held
+ */
+static void media_cache_usage_set(const char *uri, const char *path)
+{
+	struct media_cache_usage *usage;
+	struct stat st;
+
+	usage = ao2_find(media_usage, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!usage) {
+		usage = ao2_alloc_options(sizeof(*usage) + strlen(uri) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!usage) {
+			return;
+		}
+		strcpy(usage->uri, uri); /* Safe */
+		ao2_link_flags(media_usage, usage, OBJ_NOLOCK);
+	} else {
+		media_cache_bytes -= usage->size;
+	}
+
+	usage->size = stat(path, &st) ? 0 : st.st_size;
+	usage->last_used = ++media_cache_uses;
+	media_cache_bytes += usage->size;
+	ao2_ref(usage, -1);
+}
+
+/*!
+ * \internal
+ * \brief Record the retrieval of an item already in the cache
+ * \note The lock of \ref media_cache must be held
+ */
+static void media_cache_usage_touch(const char *uri)
+{
+	struct media_cache_usage *usage;
+
+	usage = ao2_find(media_usage, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (usage) {
+		usage->last_used = ++media_cache_uses;
+		ao2_ref(usage, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Forget the use of an item removed from the cache
+ * \note The lock of \ref media_cache must be held
+ */
+static void media_cache_usage_remove(const char *uri)
+{
+	struct media_cache_usage *usage;
+
+	usage = ao2_find(media_usage, uri, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (usage) {
+		media_cache_bytes -= usage->size;
+		ao2_ref(usage, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Evict the least recently used items until the cache fits in media_cache_size
+ * \param keep The URI of an item that is not evicted, or NULL
+ * \note The lock of \ref media_cache must be held
+ */
+static void media_cache_evict(const char *keep)
+{
+	off_t limit = (off_t) ast_option_media_cache_size * 1024 * 1024;
+
+	if (!limit) {
+		return;
+	}
+
+	while (media_cache_bytes > limit) {
+		struct ao2_iterator it_usage;
+		struct media_cache_usage *usage;
+		struct media_cache_usage *oldest = NULL;
+		struct ast_bucket_file *bucket_file;
+
+		it_usage = ao2_iterator_init(media_usage, AO2_ITERATOR_DONTLOCK);
+		while ((usage = ao2_iterator_next(&it_usage))) {
+			if ((keep && !strcmp(usage->uri, keep))
+				|| (oldest && oldest->last_used <= usage->last_used)) {
+				ao2_ref(usage, -1);
+				continue;
+			}
+			ao2_cleanup(oldest);
+			oldest = usage;
+		}
+		ao2_iterator_destroy(&it_usage);
+
+		if (!oldest) {
+			break;
+		}
+
+		ast_debug(3, "Evicting '%s' from the media cache\n", oldest->uri);
+		bucket_file = ao2_find(media_cache, oldest->uri, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+		if (bucket_file) {
+			ast_bucket_file_delete(bucket_file);
+			media_cache_item_del_from_astdb(bucket_file);
+			ao2_ref(bucket_file, -1);
+		}
+		++media_cache_stats.evictions;
+		media_cache_stats.evicted_bytes += oldest->size;
+		media_cache_usage_remove(oldest->uri);
+		ao2_ref(oldest, -1);
+	}
+}
+
+static void media_cache_fetch_destroy(void *obj)
+{
+	struct media_cache_fetch *fetch = obj;
+
+	ast_cond_destroy(&fetch->cond);
+}
+
+/*!
+ * \internal
+ * \brief Find the retrieval in progress of a URI
+ * \note The lock of \ref media_cache must be held
+ */
+static struct media_cache_fetch *media_cache_fetch_find(const char *uri)
+{
+	struct media_cache_fetch *fetch;
+
+	AST_LIST_TRAVERSE(&media_fetches, fetch, list) {
+		if (!strcmp(fetch->uri, uri)) {
+			ao2_ref(fetch, +1);
+			break;
+		}
+	}
+
+	return fetch;
+}
+
 /*!
  * \internal
  * \brief Normalize the value of a Content-Type header
@@ -197,56 +389,106 @@ int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	char *file_path, size_t len)
 {
 	struct ast_bucket_file *bucket_file;
+	struct media_cache_fetch *fetch;
 	char *ext;
-	SCOPED_AO2LOCK(media_lock, media_cache);
 
 	if (ast_strlen_zero(uri)) {
 		return -1;
 	}
 
-	/* First, retrieve from the ao2 cache here. If we find a bucket_file
-	 * matching the requested URI, ask the appropriate backend if it is
-	 * stale. If not; return it.
-	 */
-	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
-	if (bucket_file) {
-		if (!ast_bucket_file_is_stale(bucket_file)
-			&& ast_file_is_readable(bucket_file->path)) {
-			ast_copy_string(file_path, bucket_file->path, len);
-			if ((ext = strrchr(file_path, '.'))) {
-				*ext = '\0';
+	ao2_lock(media_cache);
+
+	for (;;) {
+		/* First, retrieve from the ao2 cache here. If we find a bucket_file
+		 * matching the requested URI, ask the appropriate backend if it is
+		 * stale. If not; return it.
+		 */
+		bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (bucket_file) {
+			if (!ast_bucket_file_is_stale(bucket_file)
+				&& ast_file_is_readable(bucket_file->path)) {
+				ast_copy_string(file_path, bucket_file->path, len);
+				if ((ext = strrchr(file_path, '.'))) {
+					*ext = '\0';
+				}
+				ao2_ref(bucket_file, -1);
+				media_cache_usage_touch(uri);
+				++media_cache_stats.hits;
+				ao2_unlock(media_cache);
+
+				ast_debug(5, "Returning media at local file: %s\n", file_path);
+				return 0;
 			}
+
+			/* Stale! Remove the item completely, as we're going to replace it next */
+			ao2_unlink_flags(media_cache, bucket_file, OBJ_NOLOCK);
+			ast_bucket_file_delete(bucket_file);
 			ao2_ref(bucket_file, -1);
+			media_cache_usage_remove(uri);
+		}
 
-			ast_debug(5, "Returning media at local file: %s\n", file_path);
-			return 0;
+		/* If another thread is already retrieving the URI, wait for it
+		 * rather than retrieving it a second time, then look again.
+		 */
+		fetch = media_cache_fetch_find(uri);
+		if (!fetch) {
+			break;
 		}
 
-		/* Stale! Remove the item completely, as we're going to replace it next */
-		ao2_unlink_flags(media_cache, bucket_file, OBJ_NOLOCK);
-		ast_bucket_file_delete(bucket_file);
-		ao2_ref(bucket_file, -1);
+		++media_cache_stats.joined;
+		while (!fetch->done) {
+			ast_cond_wait(&fetch->cond, ao2_object_get_lockaddr(media_cache));
+		}
+		ao2_ref(fetch, -1);
 	}
 
+	fetch = ao2_alloc_options(sizeof(*fetch) + strlen(uri) + 1, media_cache_fetch_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!fetch) {
+		ao2_unlock(media_cache);
+		return -1;
+	}
+	ast_cond_init(&fetch->cond, NULL);
+	strcpy(fetch->uri, uri); /* Safe */
+	AST_LIST_INSERT_TAIL(&media_fetches, fetch, list);
+	++media_cache_stats.misses;
+
 	/* Either this is new or the resource is stale; do a full retrieve
-	 * from the appropriate bucket_file backend
+	 * from the appropriate bucket_file backend. Other URIs may be
+	 * retrieved from the cache meanwhile.
 	 */
+	ao2_unlock(media_cache);
 	bucket_file = ast_bucket_file_retrieve(uri);
+	if (bucket_file) {
+		/* We can manipulate the 'immutable' bucket_file here, as we haven't
+		 * let anyone know of its existence yet
+		 */
+		bucket_file_update_path(bucket_file, preferred_file_name);
+		media_cache_item_sync_to_astdb(bucket_file);
+	}
+	ao2_lock(media_cache);
+
+	AST_LIST_REMOVE(&media_fetches, fetch, list);
+	fetch->done = 1;
+	ast_cond_broadcast(&fetch->cond);
+	ao2_ref(fetch, -1);
+
 	if (!bucket_file) {
+		ao2_unlock(media_cache);
 		ast_debug(2, "Failed to obtain media at '%s'\n", uri);
 		return -1;
 	}
 
-	/* We can manipulate the 'immutable' bucket_file here, as we haven't
-	 * let anyone know of its existence yet
-	 */
-	bucket_file_update_path(bucket_file, preferred_file_name);
-	media_cache_item_sync_to_astdb(bucket_file);
 	ast_copy_string(file_path, bucket_file->path, len);
 	if ((ext = strrchr(file_path, '.'))) {
 		*ext = '\0';
 	}
+	/* Replace anything created for the URI while it was being retrieved */
+	ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
 	ao2_link_flags(media_cache, bucket_file, OBJ_NOLOCK);
+	media_cache_usage_set(uri, bucket_file->path);
+	media_cache_evict(uri);
+	ao2_unlock(media_cache);
 	ao2_ref(bucket_file, -1);
 
 	ast_debug(5, "Returning media at local file: %s\n", file_path);
@@ -356,6 +598,8 @@ int ast_media_cache_create_or_update(const char *uri, const char *file_path,
 	media_cache_item_sync_to_astdb(bucket_file);
 
 	ao2_link_flags(media_cache, bucket_file, OBJ_NOLOCK);
+	media_cache_usage_set(uri, bucket_file->path);
+	media_cache_evict(uri);
 	ao2_ref(bucket_file, -1);
 	return 0;
 }
@@ -369,10 +613,14 @@ int ast_media_cache_delete(const char *uri)
 		return -1;
 	}
 
-	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_UNLINK);
+	ao2_lock(media_cache);
+	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
 	if (!bucket_file) {
+		ao2_unlock(media_cache);
 		return -1;
 	}
+	media_cache_usage_remove(uri);
+	ao2_unlock(media_cache);
 
 	res = ast_bucket_file_delete(bucket_file);
 	media_cache_item_del_from_astdb(bucket_file);
@@ -446,7 +694,10 @@ static int media_cache_item_populate_from_astdb(const char *uri, const char *has
 		return -1;
 	}
 
-	ao2_link(media_cache, bucket_file);
+	ao2_lock(media_cache);
+	ao2_link_flags(media_cache, bucket_file, OBJ_NOLOCK);
+	media_cache_usage_set(uri, bucket_file->path);
+	ao2_unlock(media_cache);
 	ao2_ref(bucket_file, -1);
 
 	return 0;
@@ -468,6 +719,10 @@ static void media_cache_populate_from_astdb(void)
 		}
 	}
 	ast_db_freetree(db_tree);
+
+	ao2_lock(media_cache);
+	media_cache_evict(NULL);
+	ao2_unlock(media_cache);
 }
 
 /*!
@@ -510,6 +765,54 @@ static char *media_cache_handle_show_all(struct ast_cli_entry *e, int cmd, struc
 	return CLI_SUCCESS;
 }
 
+static char *media_cache_handle_show_stats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT_ROW "%-20s: %s\n"
+	char buf[64];
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "media cache show stats";
+		e->usage =
+			"Usage: media cache show stats\n"
+			"       Display how the media cache has been used, and which items it\n"
+			"       evicted to stay under the media_cache_size set in asterisk.conf.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ao2_lock(media_cache);
+	snprintf(buf, sizeof(buf), "%d", ao2_container_count(media_cache));
+	ast_cli(a->fd, FORMAT_ROW, "Items", buf);
+	snprintf(buf, sizeof(buf), "%jd bytes", (intmax_t) media_cache_bytes);
+	ast_cli(a->fd, FORMAT_ROW, "Size", buf);
+	if (ast_option_media_cache_size) {
+		snprintf(buf, sizeof(buf), "%u MB", ast_option_media_cache_size);
+	} else {
+		ast_copy_string(buf, "None", sizeof(buf));
+	}
+	ast_cli(a->fd, FORMAT_ROW, "Size Limit", buf);
+	snprintf(buf, sizeof(buf), "%lu", media_cache_stats.hits);
+	ast_cli(a->fd, FORMAT_ROW, "Hits", buf);
+	snprintf(buf, sizeof(buf), "%lu", media_cache_stats.misses);
+	ast_cli(a->fd, FORMAT_ROW, "Misses", buf);
+	snprintf(buf, sizeof(buf), "%lu", media_cache_stats.joined);
+	ast_cli(a->fd, FORMAT_ROW, "Joined Retrievals", buf);
+	snprintf(buf, sizeof(buf), "%lu", media_cache_stats.evictions);
+	ast_cli(a->fd, FORMAT_ROW, "Evictions", buf);
+	snprintf(buf, sizeof(buf), "%ju bytes", media_cache_stats.evicted_bytes);
+	ast_cli(a->fd, FORMAT_ROW, "Evicted", buf);
+	ao2_unlock(media_cache);
+
+#undef FORMAT_ROW
+	return CLI_SUCCESS;
+}
+
 /*!
  * \internal
  * \brief CLI tab completion function for URIs
@@ -666,6 +969,7 @@ static char *media_cache_handle_create_item(struct ast_cli_entry *e, int cmd, st
 
 static struct ast_cli_entry cli_media_cache[] = {
 	AST_CLI_DEFINE(media_cache_handle_show_all, "Show all items in the media cache"),
+	AST_CLI_DEFINE(media_cache_handle_show_stats, "Show the use of the media cache"),
 	AST_CLI_DEFINE(media_cache_handle_show_item, "Show a single item in the media cache"),
 	AST_CLI_DEFINE(media_cache_handle_delete_item, "Remove an item from the media cache"),
 	AST_CLI_DEFINE(media_cache_handle_refresh_item, "Refresh an item in the media cache"),
@@ -680,6 +984,8 @@ static void media_cache_shutdown(void)
 {
 	ao2_cleanup(media_cache);
 	media_cache = NULL;
+	ao2_cleanup(media_usage);
+	media_usage = NULL;
 
 	ast_cli_unregister_multiple(cli_media_cache, ARRAY_LEN(cli_media_cache));
 }
@@ -694,6 +1000,12 @@ int ast_media_cache_init(void)
 		return -1;
 	}
 
+	media_usage = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, AO2_BUCKETS,
+		media_cache_usage_hash_fn, NULL, media_cache_usage_cmp_fn);
+	if (!media_usage) {
+		return -1;
+	}
+
 	if (ast_cli_register_multiple(cli_media_cache, ARRAY_LEN(cli_media_cache))) {
 		return -1;
 	}
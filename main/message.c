@@ -37,6 +37,7 @@
 #include "asterisk/manager.h"
 #include "asterisk/strings.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
 #include "asterisk/vector.h"
 #include "asterisk/app.h"
 #include "asterisk/taskprocessor.h"
@@ -235,7 +236,36 @@ static ast_rwlock_t msg_handlers_lock;
 /*! \brief Vector of received message handlers */
 AST_VECTOR(, const struct ast_msg_handler *) msg_handlers;
 
-static struct ast_taskprocessor *msg_q_tp;
+/*!
+ * \brief Number of taskprocessors messages are routed through
+ *
+ * Messages are spread over them by destination, so messages to the same
+ * destination are routed in the order they were queued in, while messages
+ * to different destinations are routed by several threads at once.
+ */
+#define MSG_Q_TP_COUNT 8
+
+static struct ast_taskprocessor *msg_q_tps[MSG_Q_TP_COUNT];
+
+/*! \brief Number of buckets of the stats of destinations */
+#define MSG_STATS_BUCKETS 53
+
+/*! \brief What was done with the messages of a destination */
+struct msg_destination_stats {
+	/*! Messages in all */
+	unsigned int count;
+	/*! Messages which failed to be routed or sent */
+	unsigned int failed;
+	/*! When the first message was seen */
+	struct timeval first;
+	/*! When the last message was seen */
+	struct timeval last;
+	/*! The destination, the context routed to or the technology sent with */
+	char name[0];
+};
+
+/*! \brief The stats of every destination */
+static struct ao2_container *msg_stats;
 
 static const char app_msg_send[] = "MessageSend";
 
@@ -671,6 +701,116 @@ void ast_msg_var_iterator_destroy(struct ast_msg_var_iterator *iter)
 	}
 }
 
+AO2_STRING_FIELD_HASH_FN(msg_destination_stats, name);
+AO2_STRING_FIELD_CMP_FN(msg_destination_stats, name);
+
+/*!
+ * \internal
+ * \brief Count a message towards the stats of a destination
+ *
+ * \param kind What was done with the message, "route" or "send"
+ * \param destination The context or technology of the message
+ * \param failed Whether it failed
+ */
+static void msg_stats_record(const char *kind, const char *destination, int failed)
+{
+	struct msg_destination_stats *stats;
+	char *name;
+
+	if (!msg_stats) {
+		return;
+	}
+
+	if (ast_asprintf(&name, "%s:%s", kind, S_OR(destination, "<none>")) < 0) {
+		return;
+	}
+
+	ao2_lock(msg_stats);
+	stats = ao2_find(msg_stats, name, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!stats) {
+		stats = ao2_alloc_options(sizeof(*stats) + strlen(name) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (stats) {
+			strcpy(stats->name, name); /* Safe */
+			stats->first = ast_tvnow();
+			ao2_link_flags(msg_stats, stats, OBJ_NOLOCK);
+		}
+	}
+	if (stats) {
+		stats->count++;
+		stats->failed += failed ? 1 : 0;
+		stats->last = ast_tvnow();
+		ao2_ref(stats, -1);
+	}
+	ao2_unlock(msg_stats);
+
+	ast_free(name);
+}
+
+static char *handle_cli_msg_show_stats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ao2_iterator iter;
+	struct msg_destination_stats *stats;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "messaging show stats";
+		e->usage =
+			"Usage: messaging show stats\n"
+			"       Shows the messages routed to each dialplan context, and sent\n"
+			"       with each message technology, with the rate they came at.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "%-40s %10s %10s %10s\n", "Destination", "Messages", "Failed", "Msgs/sec");
+	ao2_lock(msg_stats);
+	iter = ao2_iterator_init(msg_stats, AO2_ITERATOR_DONTLOCK);
+	for (; (stats = ao2_iterator_next(&iter)); ao2_ref(stats, -1)) {
+		int64_t elapsed = ast_tvdiff_ms(stats->last, stats->first);
+
+		ast_cli(a->fd, "%-40.40s %10u %10u %10.2f\n", stats->name, stats->count, stats->failed,
+			elapsed > 0 ? (stats->count - 1) * 1000.0 / elapsed : 0.0);
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_unlock(msg_stats);
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_msg_reset_stats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "messaging reset stats";
+		e->usage =
+			"Usage: messaging reset stats\n"
+			"       Clears the stats of messages shown by 'messaging show stats'.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ao2_callback(msg_stats, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	ast_cli(a->fd, "Message stats reset\n");
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry msg_cli[] = {
+	AST_CLI_DEFINE(handle_cli_msg_show_stats, "Show the stats of messages by destination"),
+	AST_CLI_DEFINE(handle_cli_msg_reset_stats, "Reset the stats of messages"),
+};
+
 static struct ast_channel *create_msg_q_chan(void)
 {
 	struct ast_channel *chan;
@@ -883,6 +1023,7 @@ static int msg_q_cb(void *data)
 		ast_log(LOG_WARNING, "No handler processed message from %s to %s\n",
 			S_OR(msg->from, "<unknown>"), S_OR(msg->to, "<unknown>"));
 	}
+	msg_stats_record("route", msg->context, res);
 
 	ao2_ref(msg, -1);
 
@@ -912,8 +1053,10 @@ int ast_msg_has_destination(const struct ast_msg *msg)
 
 int ast_msg_queue(struct ast_msg *msg)
 {
+	unsigned int tp = (unsigned int) ast_str_hash(S_OR(msg->to, "")) % MSG_Q_TP_COUNT;
 	int res;
-	res = ast_taskprocessor_push(msg_q_tp, msg_q_cb, msg);
+
+	res = ast_taskprocessor_push(msg_q_tps[tp], msg_q_cb, msg);
 	if (res == -1) {
 		ao2_ref(msg, -1);
 	}
@@ -1239,6 +1382,7 @@ static int msg_send_exec(struct ast_channel *chan, const char *data)
 	ao2_lock(msg);
 	res = msg_tech->msg_send(msg, S_OR(args.to, ""), S_OR(args.from, ""));
 	ao2_unlock(msg);
+	msg_stats_record("send", tech_name, res);
 
 	pbx_builtin_setvar_helper(chan, "MESSAGE_SEND_STATUS", res ? "FAILURE" : "SUCCESS");
 
@@ -1298,6 +1442,7 @@ static int action_messagesend(struct mansession *s, const struct message *m)
 	ast_msg_set_body(msg, "%s", body);
 
 	res = msg_tech->msg_send(msg, S_OR(to, ""), S_OR(from, ""));
+	msg_stats_record("send", tech_name, res);
 
 	ast_rwlock_unlock(&msg_techs_lock);
 
@@ -1336,6 +1481,7 @@ int ast_msg_send(struct ast_msg *msg, const char *to, const char *from)
 	}
 
 	res = msg_tech->msg_send(msg, S_OR(to, ""), S_OR(from, ""));
+	msg_stats_record("send", tech_name, res);
 
 	ast_rwlock_unlock(&msg_techs_lock);
 
@@ -1608,8 +1754,12 @@ int ast_msg_handler_unregister(const struct ast_msg_handler *handler)
 
 void ast_msg_shutdown(void)
 {
-	if (msg_q_tp) {
-		msg_q_tp = ast_taskprocessor_unreference(msg_q_tp);
+	int i;
+
+	for (i = 0; i < MSG_Q_TP_COUNT; i++) {
+		if (msg_q_tps[i]) {
+			msg_q_tps[i] = ast_taskprocessor_unreference(msg_q_tps[i]);
+		}
 	}
 }
 
@@ -1617,7 +1767,7 @@ void ast_msg_shutdown(void)
  * \internal
  * \brief Clean up other resources on Asterisk shutdown
  *
- * \note This does not include the msg_q_tp object, which must be disposed
+ * \note This does not include the msg_q_tps objects, which must be disposed
  * of prior to Asterisk checking for channel destruction in its shutdown
  * sequence.  The atexit handlers are executed after this occurs.
  */
@@ -1629,6 +1779,10 @@ static void message_shutdown(void)
 	ast_custom_function_unregister(&msg_data_function);
 	ast_unregister_application(app_msg_send);
 	ast_manager_unregister("MessageSend");
+	ast_cli_unregister_multiple(msg_cli, ARRAY_LEN(msg_cli));
+
+	ao2_cleanup(msg_stats);
+	msg_stats = NULL;
 
 	AST_VECTOR_FREE(&msg_techs);
 	ast_rwlock_destroy(&msg_techs_lock);
@@ -1650,9 +1804,21 @@ static void message_shutdown(void)
 int ast_msg_init(void)
 {
 	int res;
+	int i;
+
+	for (i = 0; i < MSG_Q_TP_COUNT; i++) {
+		char tp_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		snprintf(tp_name, sizeof(tp_name), "ast_msg_queue-%d", i);
+		msg_q_tps[i] = ast_taskprocessor_get(tp_name, TPS_REF_DEFAULT);
+		if (!msg_q_tps[i]) {
+			return -1;
+		}
+	}
 
-	msg_q_tp = ast_taskprocessor_get("ast_msg_queue", TPS_REF_DEFAULT);
-	if (!msg_q_tp) {
+	msg_stats = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, MSG_STATS_BUCKETS,
+		msg_destination_stats_hash_fn, NULL, msg_destination_stats_cmp_fn);
+	if (!msg_stats) {
 		return -1;
 	}
 
@@ -1672,6 +1838,7 @@ int ast_msg_init(void)
 	res |= __ast_custom_function_register(&msg_data_function, NULL);
 	res |= ast_register_application2(app_msg_send, msg_send_exec, NULL, NULL, NULL);
 	res |= ast_manager_register_xml_core("MessageSend", EVENT_FLAG_MESSAGE, action_messagesend);
+	res |= ast_cli_register_multiple(msg_cli, ARRAY_LEN(msg_cli));
 
 	ast_register_cleanup(message_shutdown);
 
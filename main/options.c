@@ -77,6 +77,24 @@ double ast_option_maxload;
 int ast_option_maxcalls;
 /*! Max number of open file handles (files, sockets) */
 int ast_option_maxfiles;
+/*! Number of separately locked containers the channels are kept in */
+unsigned int ast_option_channel_storage_shards = 1;
+/*! Stack size of the threads running dialplan in KB, 0 for the default */
+unsigned int ast_option_pbx_stacksize;
+/*! Whether astdb uses write-ahead logging */
+int ast_option_astdb_wal;
+/*! Whether parsed configuration files are kept as snapshots */
+int ast_option_config_snapshots;
+/*! Taskprocessor tasks running longer than this many ms are logged, 0 to disable */
+unsigned int ast_option_tps_slow_task;
+/*! MB of sound files kept in memory for playback, 0 to disable */
+unsigned int ast_option_prompt_cache_size;
+/*! Whether sound files played often are written in the formats they are played in */
+int ast_option_sound_variants;
+/*! Whether the files played by ast_say_* are collected and played as one stream */
+int ast_option_say_playlist;
+/*! MB of local files the media cache keeps, 0 for no limit */
+unsigned int ast_option_media_cache_size;
 /*! Minimum duration of DTMF. */
 unsigned int option_dtmfminduration = AST_MIN_DTMF_DURATION;
 #if defined(HAVE_SYSINFO)
@@ -225,6 +243,8 @@ void load_asterisk_conf(void)
 #endif
 
 	ast_set_default_eid(&ast_eid_default);
+	/* Media threads are not bound unless media_cpus is still set */
+	ast_set_media_cpus(NULL);
 
 	cfg = ast_config_load2(ast_config_AST_CONFIG_FILE, "" /* core, can't reload */, config_flags);
 
@@ -381,6 +401,52 @@ void load_asterisk_conf(void)
 			} else if ((sscanf(v->value, "%30lf", &ast_option_maxload) != 1) || (ast_option_maxload < 0.0)) {
 				ast_option_maxload = 0.0;
 			}
+		} else if (!strcasecmp(v->name, "channel_storage_shards")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE,
+				&ast_option_channel_storage_shards, 1, AST_MAX_CHANNEL_STORAGE_SHARDS)) {
+				ast_log(LOG_WARNING, "'%s' is not a valid setting for the channel_storage_shards option, "
+					"defaulting to 1\n", v->value);
+				ast_option_channel_storage_shards = 1;
+			}
+		} else if (!strcasecmp(v->name, "astdb_wal")) {
+			ast_option_astdb_wal = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "config_snapshots")) {
+			ast_option_config_snapshots = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "media_cpus")) {
+			if (ast_set_media_cpus(v->value)) {
+				ast_log(LOG_WARNING, "'%s' is not a valid setting for the media_cpus option, "
+					"media threads are not bound\n", v->value);
+				ast_set_media_cpus(NULL);
+			}
+		} else if (!strcasecmp(v->name, "pbx_stacksize")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE,
+				&ast_option_pbx_stacksize, AST_MIN_PBX_STACKSIZE, AST_MAX_PBX_STACKSIZE)) {
+				ast_log(LOG_WARNING, "'%s' is not a valid setting for the pbx_stacksize option, "
+					"using the default stack size\n", v->value);
+				ast_option_pbx_stacksize = 0;
+			}
+		} else if (!strcasecmp(v->name, "taskprocessor_slow_task")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32, &ast_option_tps_slow_task)) {
+				ast_log(LOG_WARNING, "'%s' is not a valid setting for the taskprocessor_slow_task option, "
+					"slow tasks will not be logged\n", v->value);
+				ast_option_tps_slow_task = 0;
+			}
+		} else if (!strcasecmp(v->name, "sound_variants")) {
+			ast_option_sound_variants = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "say_playlist")) {
+			ast_option_say_playlist = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "media_cache_size")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32, &ast_option_media_cache_size)) {
+				ast_log(LOG_WARNING, "'%s' is not a valid setting for the media_cache_size option, "
+					"the media cache will not be limited\n", v->value);
+				ast_option_media_cache_size = 0;
+			}
+		} else if (!strcasecmp(v->name, "prompt_cache_size")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32, &ast_option_prompt_cache_size)) {
+				ast_log(LOG_WARNING, "'%s' is not a valid setting for the prompt_cache_size option, "
+					"sound files will not be cached\n", v->value);
+				ast_option_prompt_cache_size = 0;
+			}
 		/* Set the maximum amount of open files */
 		} else if (!strcasecmp(v->name, "maxfiles")) {
 			ast_option_maxfiles = atoi(v->value);
@@ -0,0 +1,526 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Origination executor
+ *
+ * Calls originated asynchronously are dialed by a pool of threads, rather
+ * than by a thread each. A call over the rate of its destination waits on
+ * a scheduler until it may be dialed. A call is refused while as many are
+ * waiting as allowed, or while a taskprocessor is in high water alert.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/cli.h"
+#include "asterisk/config.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/lock.h"
+#include "asterisk/originate.h"
+#include "asterisk/sched.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/utils.h"
+
+/*! \brief Default number of calls dialed at once */
+#define DEFAULT_MAXCALLS 200
+
+/*! \brief Default number of calls waiting to be dialed */
+#define DEFAULT_MAXQUEUED 1000
+
+/*! \brief A limit of the calls dialed per second */
+struct originate_rate {
+	AST_LIST_ENTRY(originate_rate) list;
+	/*! Calls dialed per second */
+	double rate;
+	/*! Calls that may be dialed now */
+	double tokens;
+	/*! When the tokens were last added */
+	struct timeval updated;
+	/*! The Tech/name of the destinations the limit is of */
+	char name[0];
+};
+
+/*! \brief A call waiting to be dialed */
+struct originate_task {
+	void (*task)(void *data);
+	void *data;
+	/*! When the call was queued */
+	struct timeval queued;
+	/*! The Tech/data dialed */
+	char destination[0];
+};
+
+/*! \brief Statistics of the executor */
+struct originate_stats {
+	/*! Calls queued */
+	unsigned long queued;
+	/*! Calls refused */
+	unsigned long refused;
+	/*! Calls delayed for the rate of their destination */
+	unsigned long paced;
+	/*! Calls dialed */
+	unsigned long dialed;
+	/*! Calls answered */
+	unsigned long answered;
+	/*! Sum of the times calls waited to be dialed, in ms */
+	int64_t wait_sum;
+	/*! Longest time a call waited to be dialed, in ms */
+	int64_t wait_max;
+	/*! Sum of the times calls took to answer, in ms */
+	int64_t answer_sum;
+	/*! Longest time a call took to answer, in ms */
+	int64_t answer_max;
+};
+
+static struct ast_threadpool *originate_pool;
+
+static struct ast_sched_context *originate_sched;
+
+/*! \brief Most calls waiting to be dialed */
+static int originate_maxqueued = DEFAULT_MAXQUEUED;
+
+/*! \brief Calls waiting to be dialed */
+static int originate_waiting;
+
+AST_MUTEX_DEFINE_STATIC(originate_lock);
+
+/*! \brief The limit of all the calls dialed (Protected by originate_lock) */
+static struct originate_rate *rate_all;
+
+/*! \brief The limits of some destinations (Protected by originate_lock) */
+static AST_LIST_HEAD_NOLOCK_STATIC(originate_rates, originate_rate);
+
+/*! \brief Protected by originate_lock */
+static struct originate_stats stats;
+
+/*! \brief When the task of the current thread started */
+AST_THREADSTORAGE(originate_started);
+
+/*!
+ * \brief Determine if a limit is of a destination
+ *
+ * \details A limit named Tech/name is of the destinations on the technology
+ * that are name, begin with "name/" or end with "@name".
+ */
+static int originate_rate_matches(const struct originate_rate *rate, const char *destination)
+{
+	const char *trunk = strchr(rate->name, '/');
+	const char *data = strchr(destination, '/');
+	size_t trunk_len;
+	size_t data_len;
+
+	if (!trunk || !data || trunk - rate->name != data - destination
+		|| strncasecmp(rate->name, destination, data - destination)) {
+		return 0;
+	}
+
+	++trunk;
+	++data;
+	trunk_len = strlen(trunk);
+	data_len = strlen(data);
+	if (!strncmp(data, trunk, trunk_len) && (data[trunk_len] == '\0' || data[trunk_len] == '/')) {
+		return 1;
+	}
+
+	return data_len > trunk_len && data[data_len - trunk_len - 1] == '@'
+		&& !strcmp(data + data_len - trunk_len, trunk);
+}
+
+/*!
+ * \brief Milliseconds until a limit allows a call, adding the tokens since it was updated
+ *
+ * \note originate_lock must be held
+ */
+static int originate_rate_wait(struct originate_rate *rate, struct timeval now)
+{
+	double burst = MAX(rate->rate, 1.0);
+
+	rate->tokens += ast_tvdiff_us(now, rate->updated) / 1000000.0 * rate->rate;
+	if (rate->tokens > burst) {
+		rate->tokens = burst;
+	}
+	rate->updated = now;
+
+	if (rate->tokens >= 1.0) {
+		return 0;
+	}
+
+	return (int) ((1.0 - rate->tokens) * 1000.0 / rate->rate) + 1;
+}
+
+/*!
+ * \brief Take a call from the limits of its destination, or tell how long until they allow it
+ *
+ * \retval 0 if the call may be dialed now
+ * \retval >0 the milliseconds until it is to be asked again
+ */
+static int originate_rate_take(const char *destination)
+{
+	struct timeval now = ast_tvnow();
+	struct originate_rate *rate;
+	int wait = 0;
+
+	ast_mutex_lock(&originate_lock);
+	if (rate_all) {
+		wait = originate_rate_wait(rate_all, now);
+	}
+	AST_LIST_TRAVERSE(&originate_rates, rate, list) {
+		if (originate_rate_matches(rate, destination)) {
+			wait = MAX(wait, originate_rate_wait(rate, now));
+		}
+	}
+
+	if (!wait) {
+		if (rate_all) {
+			rate_all->tokens -= 1.0;
+		}
+		AST_LIST_TRAVERSE(&originate_rates, rate, list) {
+			if (originate_rate_matches(rate, destination)) {
+				rate->tokens -= 1.0;
+			}
+		}
+	}
+	ast_mutex_unlock(&originate_lock);
+
+	return wait;
+}
+
+static int originate_run(void *data)
+{
+	struct originate_task *task = data;
+	struct timeval *started = ast_threadstorage_get(&originate_started, sizeof(*started));
+	struct timeval now = ast_tvnow();
+	int64_t wait = ast_tvdiff_ms(now, task->queued);
+
+	ast_atomic_fetchadd_int(&originate_waiting, -1);
+
+	ast_mutex_lock(&originate_lock);
+	++stats.dialed;
+	stats.wait_sum += wait;
+	stats.wait_max = MAX(stats.wait_max, wait);
+	ast_mutex_unlock(&originate_lock);
+
+	if (started) {
+		*started = now;
+	}
+	task->task(task->data);
+	if (started) {
+		*started = ast_tv(0, 0);
+	}
+
+	ast_free(task);
+
+	return 0;
+}
+
+static int originate_dispatch(const void *data);
+
+/*! \brief Dial a call if its destination allows it, or wait until it does */
+static void originate_pace(struct originate_task *task)
+{
+	int wait = originate_rate_take(task->destination);
+
+	if (wait) {
+		if (ast_sched_add(originate_sched, wait, originate_dispatch, task) >= 0) {
+			return;
+		}
+		ast_log(LOG_WARNING, "Unable to delay the call to %s, dialing it now\n",
+			task->destination);
+	}
+
+	if (ast_threadpool_push(originate_pool, originate_run, task)) {
+		/* The task owns its data, and can only be run here */
+		ast_log(LOG_WARNING, "Unable to queue the call to %s, dialing it from the scheduler\n",
+			task->destination);
+		originate_run(task);
+	}
+}
+
+static int originate_dispatch(const void *data)
+{
+	originate_pace((struct originate_task *) data);
+
+	return 0;
+}
+
+int ast_originate_push(const char *destination, void (*task)(void *data), void *data)
+{
+	struct originate_task *queued;
+	int wait;
+
+	if (!originate_pool) {
+		return -1;
+	}
+
+	if (ast_taskprocessor_alert_get()) {
+		ast_log(LOG_WARNING, "Refusing call to %s, the system is overloaded\n", destination);
+		goto refused;
+	}
+
+	if (ast_atomic_fetchadd_int(&originate_waiting, +1) >= originate_maxqueued
+		&& originate_maxqueued) {
+		ast_atomic_fetchadd_int(&originate_waiting, -1);
+		ast_log(LOG_WARNING, "Refusing call to %s, %d calls are waiting to be dialed\n",
+			destination, originate_maxqueued);
+		goto refused;
+	}
+
+	queued = ast_malloc(sizeof(*queued) + strlen(destination) + 1);
+	if (!queued) {
+		ast_atomic_fetchadd_int(&originate_waiting, -1);
+		return -1;
+	}
+	queued->task = task;
+	queued->data = data;
+	queued->queued = ast_tvnow();
+	strcpy(queued->destination, destination); /* SAFE */
+
+	wait = originate_rate_take(destination);
+
+	ast_mutex_lock(&originate_lock);
+	++stats.queued;
+	if (wait) {
+		++stats.paced;
+	}
+	ast_mutex_unlock(&originate_lock);
+
+	if (!wait) {
+		if (!ast_threadpool_push(originate_pool, originate_run, queued)) {
+			return 0;
+		}
+	} else if (ast_sched_add(originate_sched, wait, originate_dispatch, queued) >= 0) {
+		return 0;
+	}
+
+	ast_atomic_fetchadd_int(&originate_waiting, -1);
+	ast_free(queued);
+	return -1;
+
+refused:
+	ast_mutex_lock(&originate_lock);
+	++stats.refused;
+	ast_mutex_unlock(&originate_lock);
+	return -1;
+}
+
+void ast_originate_answered(void)
+{
+	struct timeval *started = ast_threadstorage_get(&originate_started, sizeof(*started));
+	int64_t answer;
+
+	if (!started || ast_tvzero(*started)) {
+		return;
+	}
+
+	answer = ast_tvdiff_ms(ast_tvnow(), *started);
+	*started = ast_tv(0, 0);
+
+	ast_mutex_lock(&originate_lock);
+	++stats.answered;
+	stats.answer_sum += answer;
+	stats.answer_max = MAX(stats.answer_max, answer);
+	ast_mutex_unlock(&originate_lock);
+}
+
+static char *handle_show_originations(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct originate_stats current;
+	struct originate_rate *rate;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show originations";
+		e->usage =
+			"Usage: core show originations\n"
+			"       Shows the statistics of the calls originated by the executor.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&originate_lock);
+	current = stats;
+	ast_mutex_unlock(&originate_lock);
+
+	ast_cli(a->fd, "Waiting:         %d (at most %d)\n",
+		ast_atomic_fetchadd_int(&originate_waiting, 0), originate_maxqueued);
+	ast_cli(a->fd, "Queued:          %lu\n", current.queued);
+	ast_cli(a->fd, "Refused:         %lu\n", current.refused);
+	ast_cli(a->fd, "Paced:           %lu\n", current.paced);
+	ast_cli(a->fd, "Dialed:          %lu\n", current.dialed);
+	ast_cli(a->fd, "Answered:        %lu\n", current.answered);
+	ast_cli(a->fd, "Queue wait:      %" PRId64 " ms average, %" PRId64 " ms longest\n",
+		current.dialed ? current.wait_sum / (int64_t) current.dialed : 0, current.wait_max);
+	ast_cli(a->fd, "Time to answer:  %" PRId64 " ms average, %" PRId64 " ms longest\n",
+		current.answered ? current.answer_sum / (int64_t) current.answered : 0,
+		current.answer_max);
+
+	ast_mutex_lock(&originate_lock);
+	if (rate_all) {
+		ast_cli(a->fd, "Rate:            %g calls/s\n", rate_all->rate);
+	}
+	AST_LIST_TRAVERSE(&originate_rates, rate, list) {
+		ast_cli(a->fd, "Rate of %-8s %g calls/s\n", rate->name, rate->rate);
+	}
+	ast_mutex_unlock(&originate_lock);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_originate[] = {
+	AST_CLI_DEFINE(handle_show_originations, "Show the statistics of originated calls"),
+};
+
+static struct originate_rate *originate_rate_alloc(const char *name, const char *value)
+{
+	struct originate_rate *rate;
+	double cps;
+
+	if (sscanf(value, "%30lf", &cps) != 1 || cps <= 0.0) {
+		ast_log(LOG_WARNING, "Invalid rate of calls '%s' for '%s' in originate.conf\n", value, name);
+		return NULL;
+	}
+
+	rate = ast_calloc(1, sizeof(*rate) + strlen(name) + 1);
+	if (!rate) {
+		return NULL;
+	}
+	strcpy(rate->name, name); /* SAFE */
+	rate->rate = cps;
+	rate->tokens = MAX(cps, 1.0);
+	rate->updated = ast_tvnow();
+
+	return rate;
+}
+
+/*!
+ * \brief Load originate.conf, which is optional
+ *
+ * \return The number of calls dialed at once, 0 for no limit
+ */
+static int originate_load_config(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	struct ast_variable *v;
+	int maxcalls = DEFAULT_MAXCALLS;
+
+	cfg = ast_config_load2("originate.conf", "originate", config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return maxcalls;
+	}
+
+	ast_mutex_lock(&originate_lock);
+	for (v = ast_variable_browse(cfg, "general"); v; v = v->next) {
+		if (!strcasecmp(v->name, "maxcalls")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_IN_RANGE, &maxcalls, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid maxcalls '%s' in originate.conf\n", v->value);
+				maxcalls = DEFAULT_MAXCALLS;
+			}
+		} else if (!strcasecmp(v->name, "maxqueued")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_IN_RANGE, &originate_maxqueued, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid maxqueued '%s' in originate.conf\n", v->value);
+				originate_maxqueued = DEFAULT_MAXQUEUED;
+			}
+		} else if (!strcasecmp(v->name, "cps")) {
+			ast_free(rate_all);
+			rate_all = strcmp(v->value, "0") ? originate_rate_alloc("all", v->value) : NULL;
+		} else {
+			ast_log(LOG_WARNING, "Unknown option '%s' in originate.conf\n", v->name);
+		}
+	}
+	for (v = ast_variable_browse(cfg, "cps"); v; v = v->next) {
+		struct originate_rate *rate;
+
+		if (!strchr(v->name, '/')) {
+			ast_log(LOG_WARNING, "Rate of calls '%s' in originate.conf is not of a Tech/name\n", v->name);
+			continue;
+		}
+		rate = originate_rate_alloc(v->name, v->value);
+		if (rate) {
+			AST_LIST_INSERT_TAIL(&originate_rates, rate, list);
+		}
+	}
+	ast_mutex_unlock(&originate_lock);
+
+	ast_config_destroy(cfg);
+
+	return maxcalls;
+}
+
+static void originate_shutdown(void)
+{
+	struct originate_rate *rate;
+
+	ast_cli_unregister_multiple(cli_originate, ARRAY_LEN(cli_originate));
+
+	ast_sched_context_destroy(originate_sched);
+	originate_sched = NULL;
+
+	ast_threadpool_shutdown(originate_pool);
+	originate_pool = NULL;
+
+	ast_mutex_lock(&originate_lock);
+	ast_free(rate_all);
+	rate_all = NULL;
+	while ((rate = AST_LIST_REMOVE_HEAD(&originate_rates, list))) {
+		ast_free(rate);
+	}
+	ast_mutex_unlock(&originate_lock);
+}
+
+int ast_originate_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 5,
+		.initial_size = 0,
+	};
+
+	options.max_size = originate_load_config();
+
+	originate_pool = ast_threadpool_create("originate", NULL, &options);
+	if (!originate_pool) {
+		return -1;
+	}
+
+	originate_sched = ast_sched_context_create();
+	if (!originate_sched || ast_sched_start_thread(originate_sched)) {
+		ast_sched_context_destroy(originate_sched);
+		originate_sched = NULL;
+		ast_threadpool_shutdown(originate_pool);
+		originate_pool = NULL;
+		return -1;
+	}
+
+	ast_cli_register_multiple(cli_originate, ARRAY_LEN(cli_originate));
+	ast_register_cleanup(originate_shutdown);
+
+	return 0;
+}
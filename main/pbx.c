@@ -71,6 +71,7 @@
 #include "asterisk/stasis_channels.h"
 #include "asterisk/dial.h"
 #include "asterisk/vector.h"
+#include "asterisk/trace_span.h"
 #include "pbx_private.h"
 
 /*!
@@ -343,6 +344,8 @@ struct ast_hint {
 	char exten_name[AST_MAX_EXTENSION];/*!< Extension of destroyed hint extension. */
 
 	AST_VECTOR(, char *) devices; /*!< Devices associated with the hint */
+
+	int dirty;			/*!< Nonzero while waiting in hints_dirty, protected by hints_dirty_lock */
 };
 
 STASIS_MESSAGE_TYPE_DEFN_LOCAL(hint_change_message_type);
@@ -766,6 +769,36 @@ static char *overrideswitch = NULL;
 
 /*! \brief Subscription for device state change events */
 static struct stasis_subscription *device_state_sub;
+
+/*!
+ * \brief Serializes the handling of hint changes and of the hints whose devices changed
+ *
+ * Device state changes only mark their hints dirty.  The dirty hints are
+ * recomputed once the task queued by the first of them runs, so a burst of
+ * changes to the devices of a hint is seen by its watchers as one.
+ */
+static struct ast_taskprocessor *hint_tps;
+
+/*! \brief Hints whose devices changed state since they were last recomputed */
+static AST_VECTOR(, struct ast_hint *) hints_dirty;
+AST_MUTEX_DEFINE_STATIC(hints_dirty_lock);
+
+/*! \brief Nonzero when a task to recompute the dirty hints is queued, protected by hints_dirty_lock */
+static int hints_dirty_queued;
+
+/*! \brief Counters of the device state changes seen by hints */
+static struct {
+	/*! Device state changes of devices in hints */
+	unsigned int changes;
+	/*! Hints marked dirty */
+	unsigned int marked;
+	/*! Hints which were already dirty when their devices changed again */
+	unsigned int coalesced;
+	/*! Hints recomputed */
+	unsigned int recomputed;
+	/*! Times the dirty hints were recomputed */
+	unsigned int batches;
+} hint_stats;
 /*! \brief Subscription for presence state change events */
 static struct stasis_subscription *presence_state_sub;
 
@@ -2482,10 +2515,87 @@ static int matchcid(const char *cidpattern, const char *callerid)
 	return ast_extension_match(cidpattern, callerid);
 }
 
-struct ast_exten *pbx_find_extension(struct ast_channel *chan,
+/*! \brief Number of dialplan lookup results remembered */
+#define EXTENSION_CACHE_SIZE 1024
+
+/*!
+ * \brief A remembered result of a dialplan lookup
+ *
+ * \details Only lookups whose result depends on nothing but the dialplan are
+ * remembered: no switch, override switch or include with a time restriction
+ * was consulted.  The entry is valid while the dialplan version it was made
+ * with is current.
+ */
+struct extension_cache_entry {
+	/*! Dialplan version the entry was made with, 0 if unused */
+	unsigned int version;
+	int priority;
+	enum ext_match_t action;
+	/*! The lookup status */
+	int status;
+	/*! The extension found, NULL if none */
+	struct ast_exten *found;
+	/*! The included context it was found in, NULL for the context looked in */
+	const char *foundcontext;
+	char context[AST_MAX_CONTEXT];
+	char exten[AST_MAX_EXTENSION];
+	char callerid[AST_MAX_EXTENSION];
+};
+
+AST_MUTEX_DEFINE_STATIC(extension_cache_lock);
+static struct extension_cache_entry extension_cache[EXTENSION_CACHE_SIZE];
+
+/*! \brief Incremented after every dialplan change to invalidate the cache */
+static unsigned int dialplan_version = 1;
+
+/*!
+ * \internal
+ * \brief Invalidate remembered dialplan lookups
+ *
+ * \note Must be called once a change to the dialplan is complete.
+ */
+static void extension_cache_invalidate(void)
+{
+	if (ast_atomic_fetchadd_int((int *) &dialplan_version, +1) == -1) {
+		/* Skip the version of unused entries when wrapping. */
+		ast_atomic_fetchadd_int((int *) &dialplan_version, +1);
+	}
+}
+
+static struct extension_cache_entry *extension_cache_slot(const char *context,
+	const char *exten, int priority, const char *callerid, enum ext_match_t action)
+{
+	int hash;
+
+	hash = ast_str_hash_add(exten, ast_str_hash(context));
+	hash = ast_str_hash_add(S_OR(callerid, ""), hash);
+	hash = hash * 31 + priority * 7 + action;
+
+	return &extension_cache[abs(hash) % EXTENSION_CACHE_SIZE];
+}
+
+static int extension_cache_match(const struct extension_cache_entry *entry,
+	unsigned int version, const char *context, const char *exten, int priority,
+	const char *callerid, enum ext_match_t action)
+{
+	return entry->version == version
+		&& entry->priority == priority
+		&& entry->action == action
+		&& !strcmp(entry->exten, exten)
+		&& !strcmp(entry->context, context)
+		&& !strcmp(entry->callerid, S_OR(callerid, ""));
+}
+
+/*!
+ * \internal
+ * \brief Search a context and what it includes for an extension
+ *
+ * \param cacheable Cleared if the result depends on more than the dialplan.
+ */
+static struct ast_exten *pbx_find_extension_walk(struct ast_channel *chan,
 	struct ast_context *bypass, struct pbx_find_info *q,
 	const char *context, const char *exten, int priority,
-	const char *label, const char *callerid, enum ext_match_t action)
+	const char *label, const char *callerid, enum ext_match_t action, int *cacheable)
 {
 	int x, res;
 	struct ast_context *tmp = NULL;
@@ -2713,6 +2823,9 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	}
 
 	/* Check alternative switches */
+	if (ast_context_switches_count(tmp)) {
+		*cacheable = 0;
+	}
 	for (idx = 0; idx < ast_context_switches_count(tmp); idx++) {
 		const struct ast_sw *sw = ast_context_switches_get(tmp, idx);
 		struct ast_switch *asw = pbx_findswitch(ast_get_switch_name(sw));
@@ -2766,8 +2879,11 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	for (idx = 0; idx < ast_context_includes_count(tmp); idx++) {
 		const struct ast_include *i = ast_context_includes_get(tmp, idx);
 
+		if (include_has_time(i)) {
+			*cacheable = 0;
+		}
 		if (include_valid(i)) {
-			if ((e = pbx_find_extension(chan, bypass, q, include_rname(i), exten, priority, label, callerid, action))) {
+			if ((e = pbx_find_extension_walk(chan, bypass, q, include_rname(i), exten, priority, label, callerid, action, cacheable))) {
 #ifdef NEED_DEBUG_HERE
 				ast_log(LOG_NOTICE,"Returning recursive match of %s\n", e->exten);
 #endif
@@ -2780,6 +2896,67 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	return NULL;
 }
 
+struct ast_exten *pbx_find_extension(struct ast_channel *chan,
+	struct ast_context *bypass, struct pbx_find_info *q,
+	const char *context, const char *exten, int priority,
+	const char *label, const char *callerid, enum ext_match_t action)
+{
+	struct extension_cache_entry *entry;
+	struct ast_exten *e;
+	unsigned int version;
+	int cacheable;
+
+	/*
+	 * Only complete lookups of a context by name are remembered, and only
+	 * if the keys fit in an entry.
+	 */
+	if (q->stacklen || bypass || label || !ast_strlen_zero(overrideswitch)
+		|| strlen(context) >= AST_MAX_CONTEXT
+		|| strlen(exten) >= AST_MAX_EXTENSION
+		|| strlen(S_OR(callerid, "")) >= AST_MAX_EXTENSION) {
+		cacheable = 0;
+		return pbx_find_extension_walk(chan, bypass, q, context, exten, priority,
+			label, callerid, action, &cacheable);
+	}
+
+	/* Taken before searching so a change made meanwhile invalidates the result. */
+	version = ast_atomic_fetchadd_int((int *) &dialplan_version, 0);
+	entry = extension_cache_slot(context, exten, priority, callerid, action);
+
+	ast_mutex_lock(&extension_cache_lock);
+	if (extension_cache_match(entry, version, context, exten, priority, callerid, action)) {
+		q->status = entry->status;
+		q->swo = NULL;
+		q->data = NULL;
+		q->foundcontext = entry->found ? S_OR(entry->foundcontext, context) : NULL;
+		e = entry->found;
+		ast_mutex_unlock(&extension_cache_lock);
+		return e;
+	}
+	ast_mutex_unlock(&extension_cache_lock);
+
+	cacheable = 1;
+	e = pbx_find_extension_walk(chan, bypass, q, context, exten, priority,
+		label, callerid, action, &cacheable);
+	if (!cacheable) {
+		return e;
+	}
+
+	ast_mutex_lock(&extension_cache_lock);
+	entry->version = version;
+	entry->priority = priority;
+	entry->action = action;
+	entry->status = q->status;
+	entry->found = e;
+	entry->foundcontext = q->foundcontext != context ? q->foundcontext : NULL;
+	ast_copy_string(entry->context, context, sizeof(entry->context));
+	ast_copy_string(entry->exten, exten, sizeof(entry->exten));
+	ast_copy_string(entry->callerid, S_OR(callerid, ""), sizeof(entry->callerid));
+	ast_mutex_unlock(&extension_cache_lock);
+
+	return e;
+}
+
 static void exception_store_free(void *data)
 {
 	struct pbx_exception *exception = data;
@@ -2944,7 +3121,13 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 					COLORIZE(COLOR_BRMAGENTA, 0, passdata),
 					"in new stack");
 			}
-			return pbx_exec(c, app, passdata);	/* 0 on success, -1 on failure */
+			{
+				AST_TRACE_SPAN_BEGIN(span);
+				int exec_res = pbx_exec(c, app, passdata);	/* 0 on success, -1 on failure */
+
+				AST_TRACE_SPAN_END(span, "dialplan_priority", ast_channel_uniqueid(c));
+				return exec_res;
+			}
 		}
 	} else if (q.swo) {	/* not found here, but in another switch */
 		if (found)
@@ -3574,23 +3757,91 @@ static int handle_hint_change_message_type(struct stasis_message *msg, enum ast_
 	return 1;
 }
 
-static void device_state_cb(void *unused, struct stasis_subscription *sub, struct stasis_message *msg)
+/*!
+ * \internal
+ * \brief Recompute the state of the dirty hints and notify their watchers
+ */
+static int hints_dirty_recompute(void *data)
 {
-	struct ast_device_state_message *dev_state;
 	struct ast_str *hint_app;
-	struct ast_hintdevice *device;
-	struct ast_hintdevice *cmpdevice;
-	struct ao2_iterator *dev_iter;
-	struct ao2_iterator auto_iter;
-	struct ast_autohint *autohint;
-	char *virtual_device;
-	char *type;
-	char *device_name;
+	struct ast_hint *hint;
+	int idx;
+	AST_VECTOR(, struct ast_hint *) batch;
 
-	if (handle_hint_change_message_type(msg, AST_HINT_UPDATE_DEVICE)) {
+	ast_mutex_lock(&hints_dirty_lock);
+	batch.elems = hints_dirty.elems;
+	batch.max = hints_dirty.max;
+	batch.current = hints_dirty.current;
+	AST_VECTOR_INIT(&hints_dirty, 0);
+	hints_dirty_queued = 0;
+	for (idx = 0; idx < AST_VECTOR_SIZE(&batch); ++idx) {
+		AST_VECTOR_GET(&batch, idx)->dirty = 0;
+	}
+	ast_mutex_unlock(&hints_dirty_lock);
+
+	hint_app = ast_str_create(1024);
+
+	ast_mutex_lock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
+	for (idx = 0; idx < AST_VECTOR_SIZE(&batch); ++idx) {
+		hint = AST_VECTOR_GET(&batch, idx);
+		if (hint_app) {
+			device_state_notify_callbacks(hint, &hint_app);
+		}
+		ao2_ref(hint, -1);
+	}
+	ast_mutex_unlock(&context_merge_lock);
+
+	ast_atomic_fetchadd_int((int *) &hint_stats.recomputed, AST_VECTOR_SIZE(&batch));
+	ast_atomic_fetchadd_int((int *) &hint_stats.batches, 1);
+
+	AST_VECTOR_FREE(&batch);
+	ast_free(hint_app);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Mark a hint for recomputation as one of its devices changed state
+ */
+static void hint_mark_dirty(struct ast_hint *hint)
+{
+	ast_mutex_lock(&hints_dirty_lock);
+	if (hint->dirty) {
+		ast_mutex_unlock(&hints_dirty_lock);
+		ast_atomic_fetchadd_int((int *) &hint_stats.coalesced, 1);
 		return;
 	}
 
+	if (AST_VECTOR_APPEND(&hints_dirty, ao2_bump(hint))) {
+		ast_mutex_unlock(&hints_dirty_lock);
+		ao2_ref(hint, -1);
+		return;
+	}
+	hint->dirty = 1;
+
+	/* If this fails the next change tries again */
+	if (!hints_dirty_queued && !ast_taskprocessor_push(hint_tps, hints_dirty_recompute, NULL)) {
+		hints_dirty_queued = 1;
+	}
+	ast_mutex_unlock(&hints_dirty_lock);
+
+	ast_atomic_fetchadd_int((int *) &hint_stats.marked, 1);
+}
+
+/*!
+ * \internal
+ * \brief Handle a hint change or removal, in order with the dirty hints
+ */
+static int hint_message_task(void *data)
+{
+	struct stasis_message *msg = data;
+
+	if (handle_hint_change_message_type(msg, AST_HINT_UPDATE_DEVICE)) {
+		ao2_ref(msg, -1);
+		return 0;
+	}
+
 	if (hint_remove_message_type() == stasis_message_type(msg)) {
 		/* The extension has already been destroyed */
 		struct ast_state_cb *state_cb;
@@ -3612,6 +3863,29 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 			        NULL);
 		}
 		ao2_iterator_destroy(&cb_iter);
+	}
+
+	ao2_ref(msg, -1);
+	return 0;
+}
+
+static void device_state_cb(void *unused, struct stasis_subscription *sub, struct stasis_message *msg)
+{
+	struct ast_device_state_message *dev_state;
+	struct ast_hintdevice *device;
+	struct ast_hintdevice *cmpdevice;
+	struct ao2_iterator *dev_iter;
+	struct ao2_iterator auto_iter;
+	struct ast_autohint *autohint;
+	char *virtual_device;
+	char *type;
+	char *device_name;
+
+	if (hint_change_message_type() == stasis_message_type(msg)
+		|| hint_remove_message_type() == stasis_message_type(msg)) {
+		if (ast_taskprocessor_push(hint_tps, hint_message_task, ao2_bump(msg))) {
+			ao2_ref(msg, -1);
+		}
 		return;
 	}
 
@@ -3630,17 +3904,12 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		return;
 	}
 
-	hint_app = ast_str_create(1024);
-	if (!hint_app) {
-		return;
-	}
-
 	cmpdevice = ast_alloca(sizeof(*cmpdevice) + strlen(dev_state->device));
 	strcpy(cmpdevice->hintdevice, dev_state->device);
 
 	ast_mutex_lock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
 
-	/* Initially we find all hints for the device and notify them */
+	/* Initially we find all hints for the device and mark them for recomputation */
 	dev_iter = ao2_t_callback(hintdevices,
 		OBJ_SEARCH_OBJECT | OBJ_MULTIPLE,
 		hintdevice_cmp_multiple,
@@ -3649,7 +3918,8 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	if (dev_iter) {
 		for (; (device = ao2_iterator_next(dev_iter)); ao2_t_ref(device, -1, "Next device")) {
 			if (device->hint) {
-				device_state_notify_callbacks(device->hint, &hint_app);
+				ast_atomic_fetchadd_int((int *) &hint_stats.changes, 1);
+				hint_mark_dirty(device->hint);
 			}
 		}
 		ao2_iterator_destroy(dev_iter);
@@ -3694,7 +3964,6 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 
 end:
 	ast_mutex_unlock(&context_merge_lock);
-	ast_free(hint_app);
 	return;
 }
 
@@ -4692,6 +4961,7 @@ static void *pbx_thread(void *data)
 	 */
 	struct ast_channel *c = data;
 
+	ast_thread_bind_media_cpus();
 	__ast_pbx_run(c, NULL);
 	decrease_call_count();
 
@@ -4718,7 +4988,8 @@ enum ast_pbx_result ast_pbx_start(struct ast_channel *c)
 		return AST_PBX_CALL_LIMIT;
 
 	/* Start a new thread, and get something handling this channel. */
-	if (ast_pthread_create_detached(&t, NULL, pbx_thread, c)) {
+	if (ast_pthread_create_detached_stack(&t, NULL, pbx_thread, c,
+		(size_t) ast_option_pbx_stacksize * 1024, __FILE__, __FUNCTION__, __LINE__, "pbx_thread")) {
 		ast_log(LOG_WARNING, "Failed to create new channel thread\n");
 		decrease_call_count();
 		return AST_PBX_FAILED;
@@ -4773,6 +5044,7 @@ int pbx_set_extenpatternmatchnew(int newval)
 {
 	int oldval = extenpatternmatchnew;
 	extenpatternmatchnew = newval;
+	extension_cache_invalidate();
 	return oldval;
 }
 
@@ -4877,6 +5149,7 @@ int ast_context_remove_include2(struct ast_context *con, const char *include, co
 	}
 
 	ast_unlock_context(con);
+	extension_cache_invalidate();
 
 	return ret;
 }
@@ -4935,6 +5208,7 @@ int ast_context_remove_switch2(struct ast_context *con, const char *sw, const ch
 	}
 
 	ast_unlock_context(con);
+	extension_cache_invalidate();
 
 	return ret;
 }
@@ -5140,6 +5414,9 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 	}
 	if (!already_locked)
 		ast_unlock_context(con);
+	if (found) {
+		extension_cache_invalidate();
+	}
 	return found ? 0 : -1;
 }
 
@@ -5252,6 +5529,10 @@ static char *handle_show_hints(struct ast_cli_entry *e, int cmd, struct ast_cli_
 
 	ast_cli(a->fd, "----------------\n");
 	ast_cli(a->fd, "- %d hints registered\n", num);
+	ast_cli(a->fd, "- %u device state changes marked %u hints dirty, %u coalesced\n",
+		hint_stats.changes, hint_stats.marked, hint_stats.coalesced);
+	ast_cli(a->fd, "- %u hints recomputed in %u batches\n",
+		hint_stats.recomputed, hint_stats.batches);
 	return CLI_SUCCESS;
 }
 
@@ -6248,6 +6529,7 @@ struct ast_context *ast_context_find_or_create(struct ast_context **extcontexts,
 		tmp->next = *local_contexts;
 		*local_contexts = tmp;
 		ast_hashtab_insert_safe(contexts_table, tmp); /*put this context into the tree */
+		extension_cache_invalidate();
 		ast_unlock_contexts();
 	} else {
 		tmp->next = *local_contexts;
@@ -6473,6 +6755,7 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	struct ao2_iterator i;
 	int ctx_count = 0;
 	struct timeval begintime;
+	struct timeval lockedtime;
 	struct timeval writelocktime;
 	struct timeval endlocktime;
 	struct timeval enddeltime;
@@ -6490,8 +6773,25 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	 */
 
 	begintime = ast_tvnow();
+
+	/*
+	 * Nothing else can see the new contexts yet, so build their
+	 * pattern trees before blocking dialplan lookups.  Extensions
+	 * merged in below are added to the trees as they are inserted,
+	 * and the first lookup no longer builds them under the
+	 * contexts lock.
+	 */
+	iter = ast_hashtab_start_traversal(exttable);
+	while ((tmp = ast_hashtab_next(iter))) {
+		if (!tmp->pattern_tree && tmp->root_table) {
+			create_match_char_tree(tmp);
+		}
+	}
+	ast_hashtab_end_traversal(iter);
+
 	ast_mutex_lock(&context_merge_lock);/* Serialize ast_merge_contexts_and_delete */
 	ast_wrlock_contexts();
+	lockedtime = ast_tvnow();
 
 	if (!contexts_table) {
 		/* Create any autohint contexts */
@@ -6567,6 +6867,7 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	/* move in the new table and list */
 	contexts_table = exttable;
 	contexts = *extcontexts;
+	extension_cache_invalidate();
 
 	/*
 	 * Restore the watchers for hints that can be found; notify
@@ -6668,7 +6969,11 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	}
 	enddeltime = ast_tvnow();
 
-	ft = ast_tvdiff_us(writelocktime, begintime);
+	ft = ast_tvdiff_us(lockedtime, begintime);
+	ft /= 1000000.0;
+	ast_verb(3,"Time to build pattern trees and wait for the dialplan lock: %8.6f sec\n", ft);
+
+	ft = ast_tvdiff_us(writelocktime, lockedtime);
 	ft /= 1000000.0;
 	ast_verb(3,"Time to scan old dialplan and merge leftovers back into the new: %8.6f sec\n", ft);
 
@@ -6680,6 +6985,10 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	ft /= 1000000.0;
 	ast_verb(3,"Time to delete the old dialplan: %8.6f sec\n", ft);
 
+	ft = ast_tvdiff_us(endlocktime, lockedtime);
+	ft /= 1000000.0;
+	ast_verb(3,"Time the dialplan was locked: %8.6f sec\n", ft);
+
 	ft = ast_tvdiff_us(enddeltime, begintime);
 	ft /= 1000000.0;
 	ast_verb(3,"Total time merge_contexts_delete: %8.6f sec\n", ft);
@@ -6747,6 +7056,7 @@ int ast_context_add_include2(struct ast_context *con, const char *value,
 		ast_get_include_name(new_include), ast_get_context_name(con));
 
 	ast_unlock_context(con);
+	extension_cache_invalidate();
 
 	return 0;
 }
@@ -6814,6 +7124,7 @@ int ast_context_add_switch2(struct ast_context *con, const char *value,
 		ast_get_switch_name(new_sw), ast_get_switch_data(new_sw), ast_get_context_name(con));
 
 	ast_unlock_context(con);
+	extension_cache_invalidate();
 
 	return 0;
 }
@@ -7501,6 +7812,7 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 		if (lock_context) {
 			ast_unlock_context(con);
 		}
+		extension_cache_invalidate();
 		if (res < 0) {
 			errno = EEXIST;
 			return -1;
@@ -7546,6 +7858,7 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 		if (lock_context) {
 			ast_unlock_context(con);
 		}
+		extension_cache_invalidate();
 		if (tmp->priority == PRIORITY_HINT) {
 			ast_add_hint(tmp);
 		}
@@ -8132,7 +8445,8 @@ void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *context
 			if (tmp->root_table) { /* it is entirely possible that the context is EMPTY */
 				exten_iter = ast_hashtab_start_traversal(tmp->root_table);
 				while ((exten_item=ast_hashtab_next(exten_iter))) {
-					int end_traversal = 1;
+					struct ast_hashtab *peer_table;
+					int peer_table_destroyed = 0;
 
 					/*
 					 * If the extension could not be removed from the root_table due to
@@ -8143,10 +8457,13 @@ void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *context
 						continue;
 					}
 
-					prio_iter = ast_hashtab_start_traversal(exten_item->peer_table);
+					peer_table = exten_item->peer_table;
+					prio_iter = ast_hashtab_start_traversal(peer_table);
 					while ((prio_item=ast_hashtab_next(prio_iter))) {
 						char extension[AST_MAX_EXTENSION];
 						char cidmatch[AST_MAX_EXTENSION];
+						int last_priority;
+
 						if (!prio_item->registrar || strcmp(prio_item->registrar, registrar) != 0) {
 							continue;
 						}
@@ -8156,20 +8473,24 @@ void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *context
 						if (prio_item->cidmatch) {
 							ast_copy_string(cidmatch, prio_item->cidmatch, sizeof(cidmatch));
 						}
-						end_traversal &= ast_context_remove_extension_callerid2(tmp, extension, prio_item->priority, cidmatch, prio_item->matchcid, NULL, 1);
+						last_priority = ast_hashtab_size(peer_table) == 1;
+						if (!ast_context_remove_extension_callerid2(tmp, extension, prio_item->priority, cidmatch, prio_item->matchcid, NULL, 1)
+							&& last_priority) {
+							peer_table_destroyed = 1;
+							break;
+						}
 					}
 					/* Explanation:
-					 * ast_context_remove_extension_callerid2 will destroy the extension that it comes across. This
-					 * destruction includes destroying the exten's peer_table, which we are currently traversing. If
-					 * ast_context_remove_extension_callerid2 ever should return '0' then this means we have destroyed
-					 * the hashtable which we are traversing, and thus calling ast_hashtab_end_traversal will result
-					 * in reading invalid memory. Thus, if we detect that we destroyed the hashtable, then we will simply
-					 * free the iterator
+					 * ast_context_remove_extension_callerid2 will destroy the extension that it comes across. The
+					 * peer_table we are traversing moves on to the next priority, and is only destroyed with the
+					 * last one. Calling ast_hashtab_end_traversal, or going on with the traversal, would then read
+					 * invalid memory, so the iterator is simply freed. Otherwise the traversal must be ended, as the
+					 * table only compacts its object array while nothing traverses it.
 					 */
-					if (end_traversal) {
-						ast_hashtab_end_traversal(prio_iter);
-					} else {
+					if (peer_table_destroyed) {
 						ast_free(prio_iter);
+					} else {
+						ast_hashtab_end_traversal(prio_iter);
 					}
 				}
 				ast_hashtab_end_traversal(exten_iter);
@@ -8239,6 +8560,7 @@ void ast_context_destroy(struct ast_context *con, const char *registrar)
 {
 	ast_wrlock_contexts();
 	__ast_context_destroy(contexts, contexts_table, con,registrar);
+	extension_cache_invalidate();
 	ast_unlock_contexts();
 }
 
@@ -8427,6 +8749,9 @@ static void unload_pbx(void)
 {
 	presence_state_sub = stasis_unsubscribe_and_join(presence_state_sub);
 	device_state_sub = stasis_unsubscribe_and_join(device_state_sub);
+	hint_tps = ast_taskprocessor_unreference(hint_tps);
+	AST_VECTOR_CALLBACK_VOID(&hints_dirty, ao2_ref, -1);
+	AST_VECTOR_FREE(&hints_dirty);
 
 	ast_manager_unregister("ShowDialPlan");
 	ast_manager_unregister("ExtensionStateList");
@@ -8457,6 +8782,10 @@ int load_pbx(void)
 		return -1;
 	}
 
+	if (!(hint_tps = ast_taskprocessor_get("pbx-hints", TPS_REF_DEFAULT))) {
+		return -1;
+	}
+
 	if (!(device_state_sub = stasis_subscribe(ast_device_state_topic_all(), device_state_cb, NULL))) {
 		return -1;
 	}
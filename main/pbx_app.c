@@ -53,6 +53,7 @@ struct ast_app {
 	);
 #ifdef AST_XML_DOCS
 	enum ast_doc_src docsrc;		/*!< Where the documentation come from. */
+	unsigned int docs_loaded:1;		/*!< Whether the XML documentation was looked up */
 #endif
 	AST_RWLIST_ENTRY(ast_app) list;		/*!< Next app in list */
 	struct ast_module *module;		/*!< Module this app belongs to */
@@ -99,15 +100,69 @@ struct ast_app *pbx_findapp(const char *app)
 	return ret;
 }
 
+#ifdef AST_XML_DOCS
+/*! \brief Held while looking up the XML documentation of applications */
+AST_MUTEX_DEFINE_STATIC(app_docs_lock);
+#endif
+
+/*!
+ * \internal
+ * \brief Look up the XML documentation of an application, on first use
+ *
+ * Most registered applications never have their documentation shown, so
+ * it is not built from the XML documentation as they are registered.
+ */
+static void app_load_docs(struct ast_app *tmp)
+{
+#ifdef AST_XML_DOCS
+	char *tmpxml;
+
+	if (tmp->docsrc != AST_XML_DOC) {
+		return;
+	}
+
+	ast_mutex_lock(&app_docs_lock);
+	if (tmp->docs_loaded) {
+		ast_mutex_unlock(&app_docs_lock);
+		return;
+	}
+
+	/* load synopsis */
+	tmpxml = ast_xmldoc_build_synopsis("application", tmp->name, ast_module_name(tmp->module));
+	ast_string_field_set(tmp, synopsis, tmpxml);
+	ast_free(tmpxml);
+
+	/* load description */
+	tmpxml = ast_xmldoc_build_description("application", tmp->name, ast_module_name(tmp->module));
+	ast_string_field_set(tmp, description, tmpxml);
+	ast_free(tmpxml);
+
+	/* load syntax */
+	tmpxml = ast_xmldoc_build_syntax("application", tmp->name, ast_module_name(tmp->module));
+	ast_string_field_set(tmp, syntax, tmpxml);
+	ast_free(tmpxml);
+
+	/* load arguments */
+	tmpxml = ast_xmldoc_build_arguments("application", tmp->name, ast_module_name(tmp->module));
+	ast_string_field_set(tmp, arguments, tmpxml);
+	ast_free(tmpxml);
+
+	/* load seealso */
+	tmpxml = ast_xmldoc_build_seealso("application", tmp->name, ast_module_name(tmp->module));
+	ast_string_field_set(tmp, seealso, tmpxml);
+	ast_free(tmpxml);
+
+	tmp->docs_loaded = 1;
+	ast_mutex_unlock(&app_docs_lock);
+#endif
+}
+
 /*! \brief Dynamically register a new dial plan application */
 int ast_register_application2(const char *app, int (*execute)(struct ast_channel *, const char *), const char *synopsis, const char *description, void *mod)
 {
 	struct ast_app *tmp;
 	struct ast_app *cur;
 	int length;
-#ifdef AST_XML_DOCS
-	char *tmpxml;
-#endif
 
 	AST_RWLIST_WRLOCK(&apps);
 	cur = pbx_findapp_nolock(app);
@@ -135,32 +190,8 @@ int ast_register_application2(const char *app, int (*execute)(struct ast_channel
 	tmp->module = mod;
 
 #ifdef AST_XML_DOCS
-	/* Try to lookup the docs in our XML documentation database */
+	/* The docs are looked up in our XML documentation database when first shown */
 	if (ast_strlen_zero(synopsis) && ast_strlen_zero(description)) {
-		/* load synopsis */
-		tmpxml = ast_xmldoc_build_synopsis("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, synopsis, tmpxml);
-		ast_free(tmpxml);
-
-		/* load description */
-		tmpxml = ast_xmldoc_build_description("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, description, tmpxml);
-		ast_free(tmpxml);
-
-		/* load syntax */
-		tmpxml = ast_xmldoc_build_syntax("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, syntax, tmpxml);
-		ast_free(tmpxml);
-
-		/* load arguments */
-		tmpxml = ast_xmldoc_build_arguments("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, arguments, tmpxml);
-		ast_free(tmpxml);
-
-		/* load seealso */
-		tmpxml = ast_xmldoc_build_seealso("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, seealso, tmpxml);
-		ast_free(tmpxml);
 		tmp->docsrc = AST_XML_DOC;
 	} else {
 #endif
@@ -193,6 +224,8 @@ static void print_app_docs(struct ast_app *aa, int fd)
 {
 #ifdef AST_XML_DOCS
 	char *synopsis = NULL, *description = NULL, *arguments = NULL, *seealso = NULL;
+
+	app_load_docs(aa);
 	if (aa->docsrc == AST_XML_DOC) {
 		synopsis = ast_xmldoc_printable(S_OR(aa->synopsis, "Not available"), 1);
 		description = ast_xmldoc_printable(S_OR(aa->description, "Not available"), 1);
@@ -352,6 +385,7 @@ static char *handle_show_applications(struct ast_cli_entry *e, int cmd, struct a
 	AST_RWLIST_TRAVERSE(&apps, aa, list) {
 		int printapp = 0;
 		total_apps++;
+		app_load_docs(aa);
 		if (like) {
 			if (strcasestr(aa->name, a->argv[4])) {
 				printapp = 1;
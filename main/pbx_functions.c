@@ -58,6 +58,8 @@ static int live_dangerously;
  */
 static AST_RWLIST_HEAD_STATIC(acf_root, ast_custom_function);
 
+static void acf_load_docs(struct ast_custom_function *acf);
+
 static char *handle_show_functions(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	struct ast_custom_function *acf;
@@ -89,6 +91,7 @@ static char *handle_show_functions(struct ast_cli_entry *e, int cmd, struct ast_
 	AST_RWLIST_TRAVERSE(&acf_root, acf, acflist) {
 		if (!like || strstr(acf->name, a->argv[4])) {
 			count_acf++;
+			acf_load_docs(acf);
 			ast_cli(a->fd, "%-20.20s  %-35.35s  %s\n",
 				S_OR(acf->name, ""),
 				S_OR(acf->syntax, ""),
@@ -169,6 +172,7 @@ static char *handle_show_function(struct ast_cli_entry *e, int cmd, struct ast_c
 
 		return CLI_FAILURE;
 	}
+	acf_load_docs(acf);
 
 	syntax_size = strlen(S_OR(acf->syntax, "Not Available")) + AST_TERM_MAX_ESCAPE_CHARS;
 	syntax = ast_malloc(syntax_size);
@@ -318,8 +322,8 @@ static int write_escalates(const struct ast_custom_function *acf)
 }
 
 /*! \internal
- *  \brief Retrieve the XML documentation of a specified ast_custom_function,
- *         and populate ast_custom_function string fields.
+ *  \brief Prepare a specified ast_custom_function for its XML documentation,
+ *         which is looked up by acf_load_docs() when first shown.
  *  \param acf ast_custom_function structure with empty 'desc' and 'synopsis'
  *             but with a function 'name'.
  *  \retval -1 On error.
@@ -328,8 +332,6 @@ static int write_escalates(const struct ast_custom_function *acf)
 static int acf_retrieve_docs(struct ast_custom_function *acf)
 {
 #ifdef AST_XML_DOCS
-	char *tmpxml;
-
 	/* Let's try to find it in the Documentation XML */
 	if (!ast_strlen_zero(acf->desc) || !ast_strlen_zero(acf->synopsis)) {
 		return 0;
@@ -339,6 +341,38 @@ static int acf_retrieve_docs(struct ast_custom_function *acf)
 		return -1;
 	}
 
+	acf->docs_loaded = 0;
+	acf->docsrc = AST_XML_DOC;
+#endif
+
+	return 0;
+}
+
+#ifdef AST_XML_DOCS
+/*! \brief Held while looking up the XML documentation of functions */
+AST_MUTEX_DEFINE_STATIC(acf_docs_lock);
+#endif
+
+/*! \internal
+ *  \brief Retrieve the XML documentation of a specified ast_custom_function,
+ *         and populate ast_custom_function string fields, on first use.
+ *  \param acf ast_custom_function structure prepared by acf_retrieve_docs().
+ */
+static void acf_load_docs(struct ast_custom_function *acf)
+{
+#ifdef AST_XML_DOCS
+	char *tmpxml;
+
+	if (acf->docsrc != AST_XML_DOC) {
+		return;
+	}
+
+	ast_mutex_lock(&acf_docs_lock);
+	if (acf->docs_loaded) {
+		ast_mutex_unlock(&acf_docs_lock);
+		return;
+	}
+
 	/* load synopsis */
 	tmpxml = ast_xmldoc_build_synopsis("function", acf->name, ast_module_name(acf->mod));
 	ast_string_field_set(acf, synopsis, tmpxml);
@@ -364,10 +398,9 @@ static int acf_retrieve_docs(struct ast_custom_function *acf)
 	ast_string_field_set(acf, seealso, tmpxml);
 	ast_free(tmpxml);
 
-	acf->docsrc = AST_XML_DOC;
+	acf->docs_loaded = 1;
+	ast_mutex_unlock(&acf_docs_lock);
 #endif
-
-	return 0;
 }
 
 int __ast_custom_function_register(struct ast_custom_function *acf, struct ast_module *mod)
@@ -47,6 +47,8 @@ struct ast_include *include_alloc(const char *value, const char *registrar);
 /*! Free an ast_include and associated data. */
 void include_free(struct ast_include *inc);
 int include_valid(const struct ast_include *inc);
+/*! Whether an include is only valid at some times. */
+int include_has_time(const struct ast_include *inc);
 const char *include_rname(const struct ast_include *inc);
 
 /*! pbx_sw.c */
@@ -257,6 +257,7 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 	int i, need_substring;
 	struct varshead *places[2] = { headp, &globals };	/* list of places where we may look */
 	char workspace[20];
+	unsigned int hash = 0;
 
 	if (c) {
 		ast_channel_lock(c);
@@ -357,6 +358,9 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 		}
 	}
 	/* if not found, look into chanvars or global vars */
+	if (s == &not_found) {
+		hash = ast_var_name_hash(var);
+	}
 	for (i = 0; s == &not_found && i < ARRAY_LEN(places); i++) {
 		struct ast_var_t *variables;
 		if (!places[i])
@@ -364,7 +368,7 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
 		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(ast_var_name(variables), var)) {
+			if (variables->hash == hash && !strcmp(ast_var_name(variables), var)) {
 				s = ast_var_value(variables);
 				break;
 			}
@@ -397,12 +401,27 @@ void ast_str_substitute_variables_full(struct ast_str **buf, ssize_t maxlen, str
 {
 	/* Substitutes variables into buf, based on string templ */
 	const char *whereweare;
-	struct ast_str *substr1 = ast_str_create(16);
+	const char *tmp;
+	struct ast_str *substr1;
 	struct ast_str *substr2 = NULL;
-	struct ast_str *substr3 = ast_str_create(16);
+	struct ast_str *substr3;
 
 	ast_str_reset(*buf);
 
+	if (ast_strlen_zero(templ)
+		|| (!(tmp = strchr(templ, '$'))) || (!strstr(tmp, "${") && !strstr(tmp, "$["))) {
+		/* no variables to substitute, copy on through */
+		if (!ast_strlen_zero(templ)) {
+			ast_str_append_substr(buf, maxlen, templ, strlen(templ));
+		}
+		if (used) {
+			*used = ast_str_strlen(*buf);
+		}
+		return;
+	}
+
+	substr1 = ast_str_create(16);
+	substr3 = ast_str_create(16);
 	if (!substr1 || !substr3) {
 		if (used) {
 			*used = ast_str_strlen(*buf);
@@ -689,7 +708,7 @@ void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead
 			int offset2;
 			int isfunction;
 			char *cp4;
-			char workspace[VAR_BUF_SIZE] = "";
+			char workspace[VAR_BUF_SIZE];
 
 			/* We have a variable.  Find the start and end, and determine
 			   if we are going to have to recursively call ourselves on the
@@ -725,6 +744,9 @@ void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead
 			/* Skip totally over variable string */
 			whereweare = vare;
 
+			/* Not zero filled, this is done for every variable substituted. */
+			workspace[0] = '\0';
+
 			/* Store variable name expression to lookup (and truncate). */
 			ast_copy_string(var, vars, len + 1);
 
@@ -1005,10 +1027,13 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 	const char *ret = NULL;
 	int i;
 	struct varshead *places[2] = { NULL, &globals };
+	unsigned int hash;
 
 	if (!name)
 		return NULL;
 
+	hash = ast_var_name_hash(name);
+
 	if (chan) {
 		ast_channel_lock(chan);
 		places[0] = ast_channel_varshead(chan);
@@ -1020,7 +1045,7 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
 		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(name, ast_var_name(variables))) {
+			if (variables->hash == hash && !strcmp(name, ast_var_name(variables))) {
 				ret = ast_var_value(variables);
 				break;
 			}
@@ -1077,6 +1102,7 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 	const char *nametail = name;
 	/*! True if the old value was not an empty string. */
 	int old_value_existed = 0;
+	unsigned int hash;
 
 	if (name[strlen(name) - 1] == ')') {
 		char *function = ast_strdupa(name);
@@ -1099,8 +1125,9 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 			nametail++;
 	}
 
+	hash = ast_var_name_hash(nametail);
 	AST_LIST_TRAVERSE_SAFE_BEGIN(headp, newvariable, entries) {
-		if (strcmp(ast_var_name(newvariable), nametail) == 0) {
+		if (newvariable->hash == hash && strcmp(ast_var_name(newvariable), nametail) == 0) {
 			/* there is already such a variable, delete it */
 			AST_LIST_REMOVE_CURRENT(entries);
 			old_value_existed = !ast_strlen_zero(ast_var_value(newvariable));
@@ -132,16 +132,32 @@ static int find_channel_by_group(void *obj, void *arg, void *data, int flags)
 
 struct ast_channel *ast_pickup_find_by_group(struct ast_channel *chan)
 {
+	struct ao2_container *members;/*!< Channels in the groups chan can pickup. */
 	struct ao2_container *candidates;/*!< Candidate channels found to pickup. */
 	struct ast_channel *target;/*!< Potential pickup target */
+	struct ast_namedgroups *named_pickupgroups;
+	ast_group_t pickupgroup;
 
 	candidates = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
 	if (!candidates) {
 		return NULL;
 	}
 
+	/* Find the channels in the groups from the call group index, rather than every channel. */
+	ast_channel_lock(chan);
+	pickupgroup = ast_channel_pickupgroup(chan);
+	named_pickupgroups = ast_ref_namedgroups(ast_channel_named_pickupgroups(chan));
+	ast_channel_unlock(chan);
+	members = ast_channel_callgroups_find(pickupgroup, named_pickupgroups);
+	ast_unref_namedgroups(named_pickupgroups);
+	if (!members) {
+		ao2_ref(candidates, -1);
+		return NULL;
+	}
+
 	/* Find all candidate targets by group. */
-	ast_channel_callback(find_channel_by_group, chan, candidates, 0);
+	ao2_callback_data(members, OBJ_NODATA, find_channel_by_group, chan, candidates);
+	ao2_ref(members, -1);
 
 	/* Find the oldest pickup target candidate */
 	target = NULL;
@@ -34,6 +34,8 @@
 	<support_level>core</support_level>
  ***/
 
+/* Needed for the x86 intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
 #include "asterisk.h"
 
 #include <math.h>
@@ -42,6 +44,11 @@
 #include "asterisk/module.h"
 #include "asterisk/plc.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PLC_X86
+#include <immintrin.h>
+#endif
+
 #if !defined(FALSE)
 #define FALSE 0
 #endif
@@ -105,6 +112,50 @@ static void normalise_history(plc_state_t *s)
 
 /*- End of function --------------------------------------------------------*/
 
+#ifdef PLC_X86
+/*!
+ * \brief amdf_pitch() eight samples at a time
+ *
+ * \details The differences are summed as 32 bit integers, as the scalar
+ * version does, so the pitch found is the same.
+ */
+__attribute__((target("avx2")))
+static int amdf_pitch_avx2(int min_pitch, int max_pitch, int16_t amp[], int len)
+{
+	int vector_len = len & ~7;
+	int i;
+	int j;
+	int acc;
+	int min_acc;
+	int pitch;
+
+	pitch = min_pitch;
+	min_acc = INT_MAX;
+	for (i = max_pitch; i <= min_pitch; i++) {
+		__m256i vacc = _mm256_setzero_si256();
+		__m128i sum;
+
+		for (j = 0; j < vector_len; j += 8) {
+			__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (amp + i + j)));
+			__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (amp + j)));
+
+			vacc = _mm256_add_epi32(vacc, _mm256_abs_epi32(_mm256_sub_epi32(a, b)));
+		}
+		sum = _mm_add_epi32(_mm256_castsi256_si128(vacc), _mm256_extracti128_si256(vacc, 1));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		acc = _mm_cvtsi128_si32(sum);
+		for (j = vector_len; j < len; j++)
+			acc += abs(amp[i + j] - amp[j]);
+		if (acc < min_acc) {
+			min_acc = acc;
+			pitch = i;
+		}
+	}
+	return pitch;
+}
+#endif /* PLC_X86 */
+
 static int __inline__ amdf_pitch(int min_pitch, int max_pitch, int16_t amp[], int len)
 {
 	int i;
@@ -113,6 +164,12 @@ static int __inline__ amdf_pitch(int min_pitch, int max_pitch, int16_t amp[], in
 	int min_acc;
 	int pitch;
 
+#ifdef PLC_X86
+	if (__builtin_cpu_supports("avx2")) {
+		return amdf_pitch_avx2(min_pitch, max_pitch, amp, len);
+	}
+#endif
+
 	pitch = min_pitch;
 	min_acc = INT_MAX;
 	for (i = max_pitch; i <= min_pitch; i++) {
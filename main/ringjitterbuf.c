@@ -0,0 +1,441 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Adaptive jitterbuffer keeping frames in a ring indexed by sequence number.
+ *
+ * Frames are stored in the slot their sequence number maps to, so putting and
+ * getting a frame takes the same time however many frames are held. A frame
+ * is played at its timestamp plus the current playout delay. That delay
+ * follows a target made of the high percentile of the measured delays, which
+ * is updated with each frame instead of being computed over a history.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <limits.h>
+
+#include "asterisk/utils.h"
+#include "ringjitterbuf.h"
+
+/*! Shortest frame the ring is sized for, in ms */
+#define RING_JB_MIN_FRAME_MS 10
+/*! Fewest and most slots in the ring */
+#define RING_JB_MIN_SLOTS 16
+#define RING_JB_MAX_SLOTS 4096
+/*! Delays are estimated in 1/32 ms, see delay_update() */
+#define RING_JB_DELAY_SCALE 32
+/*! Least time between growing the playout delay by a frame, in ms */
+#define RING_JB_GROW_DELAY 40
+/*! Least time between shrinking the playout delay by a frame, in ms */
+#define RING_JB_SHRINK_DELAY 500
+
+struct ring_jb_slot
+{
+	struct ring_jb_frame frame;
+	int used;
+};
+
+/*! \brief private ring_jb structure */
+struct ring_jb
+{
+	struct ring_jb_conf conf;
+	/*! Slots in the ring less one, the ring size being a power of two */
+	int mask;
+	/*! Frames held */
+	unsigned int frames;
+	/*! Set once a frame was put, the timing below being meaningless until then */
+	int anchored;
+	int force_resynch;
+	/*! Set while waiting for a talkspurt, which starts at the target delay */
+	int silent;
+	/*! Added to sequence numbers and timestamps, to carry on after a resynch */
+	uint16_t seq_offset;
+	long ts_offset;
+	/*! Sequence number of the next frame to play */
+	uint16_t head;
+	/*! Sequence number following, and timestamp ending, the latest frame put */
+	uint16_t tail;
+	long tail_ts;
+	/*! Playout delay added to the timestamp of a frame */
+	long current;
+	/*! Time the next frame plays at */
+	long next;
+	long last_ms;
+	long last_adjustment;
+	long contig_interp;
+	/*! Estimated low and high percentiles of the delay, in 1/32 ms */
+	long delay_low;
+	long delay_high;
+	struct ring_jb_slot slots[0];
+};
+
+
+struct ring_jb *ring_jb_new(struct ring_jb_conf *conf)
+{
+	struct ring_jb *jb;
+	unsigned int slots = RING_JB_MIN_SLOTS;
+	long size = conf->max_jitterbuf > 0 ? conf->max_jitterbuf : RING_JB_SIZE_DEFAULT;
+
+	while (slots < RING_JB_MAX_SLOTS && slots <= size / RING_JB_MIN_FRAME_MS) {
+		slots <<= 1;
+	}
+
+	if (!(jb = ast_calloc(1, sizeof(*jb) + slots * sizeof(jb->slots[0])))) {
+		return NULL;
+	}
+
+	/* First copy our config */
+	memcpy(&jb->conf, conf, sizeof(struct ring_jb_conf));
+	conf = &jb->conf;
+
+	/* validate the configuration */
+	if (conf->max_jitterbuf < 1) {
+		conf->max_jitterbuf = RING_JB_SIZE_DEFAULT;
+	}
+
+	if (conf->resync_threshold < 1) {
+		conf->resync_threshold = RING_JB_RESYNCH_THRESHOLD_DEFAULT;
+	}
+
+	jb->mask = slots - 1;
+
+	return jb;
+}
+
+
+void ring_jb_destroy(struct ring_jb *jb)
+{
+	/* jitterbuf MUST be empty before it can be destroyed */
+	ast_assert(jb->frames == 0);
+
+	ast_free(jb);
+}
+
+
+void ring_jb_reset(struct ring_jb *jb)
+{
+	ast_assert(jb->frames == 0);
+
+	jb->anchored = 0;
+	jb->force_resynch = 0;
+}
+
+
+/*!
+ * \internal
+ * \brief Update the delay percentiles with the delay of a frame
+ *
+ * The high estimate rises by nearly a ms for each delay above it and falls by
+ * 1/32 ms for each one below, so it settles on the delay exceeded by 1 frame
+ * in 32. The low estimate mirrors it. Delays far off an estimate pull it a
+ * quarter of the way, so that a burst of jitter is caught up with in a few
+ * frames while a single spike decays slowly.
+ */
+static void delay_update(struct ring_jb *jb, long delay)
+{
+	long sample = delay * RING_JB_DELAY_SCALE;
+
+	if (sample > jb->delay_high) {
+		jb->delay_high += MAX(RING_JB_DELAY_SCALE - 1, (sample - jb->delay_high) / 4);
+	} else {
+		jb->delay_high -= 1;
+	}
+
+	if (sample < jb->delay_low) {
+		jb->delay_low -= MAX(RING_JB_DELAY_SCALE - 1, (jb->delay_low - sample) / 4);
+	} else {
+		jb->delay_low += 1;
+	}
+
+	if (jb->delay_low > jb->delay_high) {
+		jb->delay_low = jb->delay_high;
+	}
+}
+
+/*! \internal \brief The playout delay the jb is heading for */
+static long target_delay(struct ring_jb *jb)
+{
+	long low = jb->delay_low / RING_JB_DELAY_SCALE;
+	long target = jb->delay_high / RING_JB_DELAY_SCALE + jb->conf.target_extra;
+
+	if (target - low > jb->conf.max_jitterbuf) {
+		target = low + jb->conf.max_jitterbuf;
+	}
+
+	return target;
+}
+
+/*!
+ * \internal
+ * \brief Start over from a frame, as if the jb had been empty all along
+ *
+ * The next frame played is the first of a talkspurt, the sequence carrying on
+ * from the frame played last.
+ */
+static void anchor_jb(struct ring_jb *jb, int seqno, long ts, long now)
+{
+	if (!jb->anchored) {
+		jb->head = seqno;
+	}
+	jb->seq_offset = jb->head - (uint16_t) seqno;
+	jb->ts_offset = 0;
+	jb->tail = jb->head;
+	jb->tail_ts = ts;
+	jb->delay_low = jb->delay_high = (now - ts) * RING_JB_DELAY_SCALE;
+	jb->silent = 1;
+	jb->anchored = 1;
+}
+
+/*!
+ * \internal
+ * \brief Carry on with a frame right after the latest frame held
+ *
+ * The frames held are kept, the new sequence and timestamps being shifted to
+ * follow theirs.
+ */
+static void reseat_jb(struct ring_jb *jb, int seqno, long ts, long now)
+{
+	jb->seq_offset = jb->tail - (uint16_t) seqno;
+	jb->ts_offset = jb->tail_ts - ts;
+	jb->delay_low = jb->delay_high = (now - jb->tail_ts) * RING_JB_DELAY_SCALE;
+}
+
+int ring_jb_put(struct ring_jb *jb, void *data, long ms, long ts, int seqno, long now)
+{
+	struct ring_jb_slot *slot;
+	uint16_t seq;
+	int diff;
+	long delay;
+
+	if (!jb->anchored || (jb->force_resynch && !jb->frames)) {
+		anchor_jb(jb, seqno, ts, now);
+	} else if (jb->force_resynch) {
+		reseat_jb(jb, seqno, ts, now);
+	}
+	jb->force_resynch = 0;
+
+	seq = seqno + jb->seq_offset;
+	diff = (int16_t) (uint16_t) (seq - jb->head);
+	delay = now - (ts + jb->ts_offset);
+
+	if (labs(delay - jb->delay_low / RING_JB_DELAY_SCALE) > jb->conf.resync_threshold) {
+		/* the timestamps jumped */
+		if (jb->frames) {
+			reseat_jb(jb, seqno, ts, now);
+		} else {
+			anchor_jb(jb, seqno, ts, now);
+		}
+	} else if (!jb->frames && (diff > jb->mask || diff < -jb->mask)) {
+		/* the sequence jumped, with no frame held to keep apart from */
+		anchor_jb(jb, seqno, ts, now);
+	}
+
+	seq = seqno + jb->seq_offset;
+	diff = (int16_t) (uint16_t) (seq - jb->head);
+	ts += jb->ts_offset;
+
+	delay_update(jb, now - ts);
+
+	if (diff < 0 || diff > jb->mask) {
+		/* already played past, or no room left */
+		return RING_JB_DROP;
+	}
+
+	slot = &jb->slots[seq & jb->mask];
+	if (slot->used) {
+		/* duplicate */
+		return RING_JB_DROP;
+	}
+
+	slot->frame.data = data;
+	slot->frame.ts = ts;
+	slot->frame.ms = ms;
+	slot->used = 1;
+	++jb->frames;
+
+	if ((int16_t) (uint16_t) (seq - jb->tail) >= 0) {
+		jb->tail = seq + 1;
+		jb->tail_ts = ts + ms;
+	}
+
+	return RING_JB_OK;
+}
+
+
+/*! \internal \brief The first slot holding a frame at or after the head, if any */
+static struct ring_jb_slot *first_held(struct ring_jb *jb, uint16_t *seq)
+{
+	uint16_t pos;
+
+	if (!jb->frames) {
+		return NULL;
+	}
+
+	/* the frames held are all within the ring from the head */
+	for (pos = jb->head; !jb->slots[pos & jb->mask].used; ++pos) {
+	}
+	if (seq) {
+		*seq = pos;
+	}
+
+	return &jb->slots[pos & jb->mask];
+}
+
+/*! \internal \brief Take the frame at the head out of the ring */
+static void pop_head(struct ring_jb *jb, struct ring_jb_frame *frame)
+{
+	struct ring_jb_slot *slot = &jb->slots[jb->head & jb->mask];
+
+	*frame = slot->frame;
+	slot->used = 0;
+	--jb->frames;
+	++jb->head;
+}
+
+/*! \internal \brief Take the frame at the head out of the ring to play it */
+static void play_head(struct ring_jb *jb, struct ring_jb_frame *frame)
+{
+	pop_head(jb, frame);
+	jb->next = frame->ts + jb->current + frame->ms;
+	jb->last_ms = frame->ms;
+	jb->contig_interp = 0;
+}
+
+int ring_jb_get(struct ring_jb *jb, struct ring_jb_frame *frame, long now, long interpl)
+{
+	struct ring_jb_slot *slot;
+	long target;
+	long diff;
+
+	if (!jb->anchored) {
+		return RING_JB_NOFRAME;
+	}
+
+	target = target_delay(jb);
+
+	if (jb->silent) {
+		if (!(slot = first_held(jb, &jb->head)) || slot->frame.ts + target > now) {
+			return RING_JB_NOFRAME;
+		}
+
+		/* a talkspurt starts at the target delay right away */
+		jb->current = target;
+		jb->silent = 0;
+		jb->last_adjustment = now;
+		play_head(jb, frame);
+
+		return RING_JB_OK;
+	}
+
+	slot = &jb->slots[jb->head & jb->mask];
+
+	/* the time it would play at was filled by concealment already */
+	if (slot->used && slot->frame.ts + jb->current < jb->next - jb->last_ms) {
+		pop_head(jb, frame);
+
+		return RING_JB_DROP;
+	}
+
+	if (slot->used && slot->frame.ts + jb->current <= jb->next) {
+		diff = target - jb->current;
+
+		/* grow by playing a concealment frame before it, once half a frame short */
+		if (diff > interpl / 2 && jb->last_adjustment + RING_JB_GROW_DELAY < now) {
+			jb->current += interpl;
+			jb->next += interpl;
+			jb->last_adjustment = now;
+
+			return RING_JB_INTERP;
+		}
+
+		/* shrink by skipping it */
+		if (diff < -slot->frame.ms && jb->last_adjustment + RING_JB_SHRINK_DELAY < now) {
+			jb->current -= slot->frame.ms;
+			jb->last_adjustment = now;
+			play_head(jb, frame);
+
+			return RING_JB_DROP;
+		}
+
+		play_head(jb, frame);
+
+		return RING_JB_OK;
+	}
+
+	/*
+	 * Nothing to play now. If a later frame is held this one is lost, or
+	 * will arrive too late to play, so its turn is given to concealment.
+	 */
+	if (!slot->used && jb->frames) {
+		++jb->head;
+	}
+	jb->next += interpl;
+	jb->last_ms = interpl;
+	if (jb->conf.max_contig_interp && ++jb->contig_interp >= jb->conf.max_contig_interp) {
+		jb->silent = 1;
+	}
+
+	return RING_JB_INTERP;
+}
+
+
+long ring_jb_next(struct ring_jb *jb)
+{
+	struct ring_jb_slot *slot;
+
+	if (!jb->anchored) {
+		return LONG_MAX;
+	}
+
+	if (jb->silent) {
+		if (!(slot = first_held(jb, NULL))) {
+			return LONG_MAX;
+		}
+		return slot->frame.ts + target_delay(jb);
+	}
+
+	return jb->next;
+}
+
+
+int ring_jb_remove(struct ring_jb *jb, struct ring_jb_frame *frameout)
+{
+	if (!first_held(jb, &jb->head)) {
+		return RING_JB_NOFRAME;
+	}
+
+	pop_head(jb, frameout);
+
+	return RING_JB_OK;
+}
+
+
+void ring_jb_set_force_resynch(struct ring_jb *jb)
+{
+	jb->force_resynch = 1;
+}
+
+
+int ring_jb_is_late(struct ring_jb *jb, long ts)
+{
+	return jb->anchored && !jb->silent && ts + jb->ts_offset + jb->current < jb->next;
+}
@@ -0,0 +1,109 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Adaptive jitterbuffer keeping frames in a ring indexed by sequence number.
+ *
+ */
+
+#ifndef _RINGJITTERBUF_H_
+#define _RINGJITTERBUF_H_
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+
+/* return codes */
+enum {
+	RING_JB_OK,
+	RING_JB_DROP,
+	RING_JB_INTERP,
+	RING_JB_NOFRAME
+};
+
+
+/* defaults */
+#define RING_JB_SIZE_DEFAULT 200
+#define RING_JB_RESYNCH_THRESHOLD_DEFAULT 1000
+
+
+/* jb configuration properties */
+struct ring_jb_conf
+{
+	/*! Most the playout delay may exceed the least delay seen, in ms */
+	long max_jitterbuf;
+	/*! Jump in the frame timestamps over which the jb resynchronizes, in ms */
+	long resync_threshold;
+	/*! Concealment frames played in a row before waiting for a talkspurt, 0 for no limit */
+	long max_contig_interp;
+	/*! Padding added to the measured jitter, in ms */
+	long target_extra;
+};
+
+
+struct ring_jb_frame
+{
+	void *data;
+	long ts;
+	long ms;
+};
+
+
+struct ring_jb;
+
+
+/* jb interface */
+
+struct ring_jb *ring_jb_new(struct ring_jb_conf *conf);
+
+void ring_jb_destroy(struct ring_jb *jb);
+
+/*!
+ * \brief Put a frame in the jb
+ *
+ * \param jb The jb
+ * \param data The frame
+ * \param ms Length of the frame
+ * \param ts Timestamp of the frame
+ * \param seqno Sequence number of the frame, of which the lower 16 bits are used
+ * \param now The current time
+ *
+ * \retval RING_JB_OK if the frame is now owned by the jb
+ * \retval RING_JB_DROP if it came too late, twice or with no room left
+ */
+int ring_jb_put(struct ring_jb *jb, void *data, long ms, long ts, int seqno, long now);
+
+int ring_jb_get(struct ring_jb *jb, struct ring_jb_frame *frame, long now, long interpl);
+
+long ring_jb_next(struct ring_jb *jb);
+
+int ring_jb_remove(struct ring_jb *jb, struct ring_jb_frame *frameout);
+
+void ring_jb_set_force_resynch(struct ring_jb *jb);
+
+/*! \brief Forget the timing of an empty jb, as if no frame was put yet */
+void ring_jb_reset(struct ring_jb *jb);
+
+/*! \brief Checks if the given time stamp is late */
+int ring_jb_is_late(struct ring_jb *jb, long ts);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _RINGJITTERBUF_H_ */
@@ -155,6 +155,7 @@
 #include "asterisk/format.h"            /* for ast_format_cmp, etc */
 #include "asterisk/format_cache.h"      /* for ast_format_adpcm, etc */
 #include "asterisk/format_cap.h"        /* for ast_format_cap_alloc, etc */
+#include "asterisk/frame_timing.h"      /* for ast_frame_timing_stamp, etc */
 #include "asterisk/json.h"              /* for ast_json_ref, etc */
 #include "asterisk/linkedlists.h"       /* for ast_rtp_engine::<anonymous>, etc */
 #include "asterisk/lock.h"              /* for ast_rwlock_unlock, etc */
@@ -572,6 +573,7 @@ int ast_rtp_instance_write(struct ast_rtp_instance *instance, struct ast_frame *
 	ao2_lock(instance);
 	res = instance->engine->write(instance, frame);
 	ao2_unlock(instance);
+	AST_FRAME_TIMING_RECORD(AST_FRAME_TIMING_SEND, NULL, frame);
 	return res;
 }
 
@@ -582,6 +584,7 @@ struct ast_frame *ast_rtp_instance_read(struct ast_rtp_instance *instance, int r
 	ao2_lock(instance);
 	frame = instance->engine->read(instance, rtcp);
 	ao2_unlock(instance);
+	ast_frame_timing_stamp(frame);
 	return frame;
 }
 
@@ -3490,7 +3493,7 @@ void ast_rtp_publish_rtcp_message(struct ast_rtp_instance *rtp,
 	RAII_VAR(struct rtcp_message_payload *, payload, NULL, ao2_cleanup);
 	RAII_VAR(struct stasis_message *, message, NULL, ao2_cleanup);
 
-	if (!message_type) {
+	if (!message_type || ast_rtp_instance_get_prop(rtp, AST_RTP_PROPERTY_RTCP_NO_PUBLISH)) {
 		return;
 	}
 
@@ -54,10 +54,211 @@
 #include "asterisk/utils.h"
 #include "asterisk/app.h"
 #include "asterisk/test.h"
+#include "asterisk/options.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/vector.h"
 
 /* Forward declaration */
 static int wait_file(struct ast_channel *chan, const char *ints, const char *file, const char *lang);
 
+/*! \brief A file collected to be played by \ref say_playlist */
+struct say_fragment {
+	/*! The preferred language of the file */
+	char *lang;
+	/*! The name of the file */
+	char file[0];
+};
+
+/*!
+ * \brief The files the sayers play, collected by the outermost ast_say_* call
+ *
+ * When the say_playlist option is set, the files of a number, date or string
+ * are collected rather than each of them being streamed and waited on in turn,
+ * and once the sayer is done they are played by ast_streamfile_list().
+ */
+struct say_playlist {
+	/*! The channel the files are played to */
+	struct ast_channel *chan;
+	AST_VECTOR(, struct say_fragment *) fragments;
+};
+
+/*! \brief The playlist being collected by the thread */
+struct say_playlist_state {
+	struct say_playlist *playlist;
+};
+
+AST_THREADSTORAGE(say_playlist_state_buf);
+
+/*!
+ * \internal
+ * \brief Get the playlist being collected for a channel, if any
+ */
+static struct say_playlist *say_playlist_get(struct ast_channel *chan)
+{
+	struct say_playlist_state *state;
+
+	state = ast_threadstorage_get(&say_playlist_state_buf, sizeof(*state));
+	if (!state || !state->playlist || state->playlist->chan != chan) {
+		return NULL;
+	}
+
+	return state->playlist;
+}
+
+/*!
+ * \internal
+ * \brief Start collecting the files of an ast_say_* call
+ *
+ * \return the playlist to pass to say_playlist_finish()
+ * \retval NULL if the files are streamed one by one, or collected by an outer call
+ */
+static struct say_playlist *say_playlist_start(struct ast_channel *chan)
+{
+	struct say_playlist_state *state;
+	struct say_playlist *playlist;
+
+	if (!ast_option_say_playlist) {
+		return NULL;
+	}
+
+	state = ast_threadstorage_get(&say_playlist_state_buf, sizeof(*state));
+	if (!state || state->playlist) {
+		return NULL;
+	}
+
+	playlist = ast_calloc(1, sizeof(*playlist));
+	if (!playlist) {
+		return NULL;
+	}
+	if (AST_VECTOR_INIT(&playlist->fragments, 16)) {
+		ast_free(playlist);
+		return NULL;
+	}
+	playlist->chan = chan;
+	state->playlist = playlist;
+
+	return playlist;
+}
+
+/*!
+ * \internal
+ * \brief Play the files of an ast_say_* call once it collected them
+ *
+ * \param playlist The playlist started, or NULL
+ * \param res What the sayer returned
+ *
+ * \return like ast_waitstream(), or \c res if the files were played without interruption
+ */
+static int say_playlist_finish(struct say_playlist *playlist, int res, const char *ints, int audiofd, int ctrlfd)
+{
+	struct say_playlist_state *state;
+	const char **files;
+	int count;
+	int i;
+	int played = 0;
+	int streamed;
+	int lang_count;
+	int wait_res = 0;
+
+	if (!playlist) {
+		return res;
+	}
+
+	state = ast_threadstorage_get(&say_playlist_state_buf, sizeof(*state));
+	if (state) {
+		state->playlist = NULL;
+	}
+
+	count = AST_VECTOR_SIZE(&playlist->fragments);
+	files = ast_alloca(sizeof(*files) * (count + 1));
+	for (i = 0; i < count; ++i) {
+		files[i] = AST_VECTOR_GET(&playlist->fragments, i)->file;
+	}
+
+	while (!wait_res && played < count) {
+		const char *lang = AST_VECTOR_GET(&playlist->fragments, played)->lang;
+
+		/* The files of a list are all looked up in one language */
+		for (lang_count = 1; played + lang_count < count; ++lang_count) {
+			if (strcmp(AST_VECTOR_GET(&playlist->fragments, played + lang_count)->lang, lang)) {
+				break;
+			}
+		}
+
+		streamed = ast_streamfile_list(playlist->chan, files + played, lang_count, lang);
+		if (streamed < 0) {
+			++played;
+			continue;
+		}
+		if (audiofd > -1 && ctrlfd > -1) {
+			wait_res = ast_waitstream_full(playlist->chan, ints, audiofd, ctrlfd);
+		} else {
+			wait_res = ast_waitstream(playlist->chan, ints);
+		}
+		ast_stopstream(playlist->chan);
+		played += streamed;
+	}
+
+	AST_VECTOR_CALLBACK_VOID(&playlist->fragments, ast_free);
+	AST_VECTOR_FREE(&playlist->fragments);
+	ast_free(playlist);
+
+	return wait_res ? wait_res : res;
+}
+
+/*!
+ * \internal
+ * \brief Stream a file for a sayer, or add it to the playlist being collected
+ */
+static int say_streamfile(struct ast_channel *chan, const char *file, const char *lang)
+{
+	struct say_playlist *playlist = say_playlist_get(chan);
+	struct say_fragment *fragment;
+
+	if (!playlist) {
+		return ast_streamfile(chan, file, lang);
+	}
+
+	/* Fail like ast_streamfile() would, as some sayers try another file then */
+	if (ast_fileexists(file, NULL, lang) <= 0) {
+		ast_log(LOG_WARNING, "File %s does not exist in any format\n", file);
+		return -1;
+	}
+
+	lang = S_OR(lang, "");
+	fragment = ast_malloc(sizeof(*fragment) + strlen(file) + strlen(lang) + 2);
+	if (!fragment) {
+		return -1;
+	}
+	strcpy(fragment->file, file); /* Safe */
+	fragment->lang = fragment->file + strlen(file) + 1;
+	strcpy(fragment->lang, lang); /* Safe */
+	if (AST_VECTOR_APPEND(&playlist->fragments, fragment)) {
+		ast_free(fragment);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for the file streamed by a sayer, unless it was only collected
+ */
+static int say_waitstream(struct ast_channel *chan, const char *breakon)
+{
+	return say_playlist_get(chan) ? 0 : ast_waitstream(chan, breakon);
+}
+
+/*!
+ * \internal
+ * \brief Wait for the file streamed by a sayer with file descriptors, unless it was only collected
+ */
+static int say_waitstream_full(struct ast_channel *chan, const char *breakon, int audiofd, int monfd)
+{
+	return say_playlist_get(chan) ? 0 : ast_waitstream_full(chan, breakon, audiofd, monfd);
+}
+
 
 static int say_character_str_full(struct ast_channel *chan, const char *str, const char *ints, const char *lang, enum ast_say_case_sensitivity sensitivity, int audiofd, int ctrlfd)
 {
@@ -154,12 +355,12 @@ static int say_character_str_full(struct ast_channel *chan, const char *str, con
 		}
 		if ((fn && ast_fileexists(fn, NULL, lang) > 0) ||
 			(snprintf(asciibuf + 13, sizeof(asciibuf) - 13, "%d", str[num]) > 0 && ast_fileexists(asciibuf, NULL, lang) > 0 && (fn = asciibuf))) {
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -237,12 +438,12 @@ static int say_phonetic_str_full(struct ast_channel *chan, const char *str, cons
 			fn = fnbuf;
 		}
 		if (fn && ast_fileexists(fn, NULL, lang) > 0) {
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -287,12 +488,12 @@ static int say_digit_str_full(struct ast_channel *chan, const char *str, const c
 			break;
 		}
 		if (fn && ast_fileexists(fn, NULL, lang) > 0) {
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -466,11 +667,11 @@ static int ast_say_datetime_from_now_he(struct ast_channel *chan, time_t t, cons
 static int wait_file(struct ast_channel *chan, const char *ints, const char *file, const char *lang)
 {
 	int res;
-	if ((res = ast_streamfile(chan, file, lang))) {
+	if ((res = say_streamfile(chan, file, lang))) {
 		ast_log(LOG_WARNING, "Unable to play message %s\n", file);
 	}
 	if (!res) {
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	}
 	return res;
 }
@@ -588,11 +789,11 @@ static int ast_say_number_full_en(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -711,11 +912,11 @@ static int ast_say_number_full_cs(struct ast_channel *chan, int num, const char
 			num -= left * (exp10_int(length-1));
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1)) {
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				} else {
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				}
 			}
 			ast_stopstream(chan);
@@ -820,11 +1021,11 @@ static int ast_say_number_full_da(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -950,19 +1151,19 @@ static int ast_say_number_full_de(struct ast_channel *chan, int num, const char
 			res = -1;
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 			if (!res) {
-				if (strlen(fna) != 0 && !ast_streamfile(chan, fna, language)) {
+				if (strlen(fna) != 0 && !say_streamfile(chan, fna, language)) {
 					if ((audiofd > -1) && (ctrlfd > -1))
-						res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+						res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 					else
-						res = ast_waitstream(chan, ints);
+						res = say_waitstream(chan, ints);
 				}
 				ast_stopstream(chan);
 				strcpy(fna, "");
@@ -1036,11 +1237,11 @@ static int ast_say_number_full_en_GB(struct ast_channel *chan, int num, const ch
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -1141,11 +1342,11 @@ static int ast_say_number_full_es(struct ast_channel *chan, int num, const char
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 
@@ -1233,11 +1434,11 @@ static int ast_say_number_full_fr(struct ast_channel *chan, int num, const char
 			res = -1;
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -1404,11 +1605,11 @@ static int ast_say_number_full_he(struct ast_channel *chan, int num, const char
 		}
 		tmpnum = 0;
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1)) {
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				} else {
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				}
 			}
 			ast_stopstream(chan);
@@ -1487,11 +1688,11 @@ static int ast_say_number_full_hu(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if(!ast_streamfile(chan, fn, language)) {
+			if(!say_streamfile(chan, fn, language)) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -1609,11 +1810,11 @@ static int ast_say_number_full_is(struct ast_channel *chan, int num, const char
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -1763,11 +1964,11 @@ static int ast_say_number_full_it(struct ast_channel *chan, int num, const char
 				}
 			}
 			if (!res) {
-				if (!ast_streamfile(chan, fn, language)) {
+				if (!say_streamfile(chan, fn, language)) {
 					if ((audiofd > -1) && (ctrlfd > -1))
-						res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+						res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 					else
-						res = ast_waitstream(chan, ints);
+						res = say_waitstream(chan, ints);
 				}
 				ast_stopstream(chan);
 			}
@@ -1854,11 +2055,11 @@ static int ast_say_number_full_nl(struct ast_channel *chan, int num, const char
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -1946,11 +2147,11 @@ static int ast_say_number_full_no(struct ast_channel *chan, int num, const char
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -1993,11 +2194,11 @@ static void pl_odtworz_plik(struct ast_channel *chan, const char *language, int
 	char file_name[255] = "digits/";
 	strcat(file_name, fn);
 	ast_debug(1, "Trying to play: %s\n", file_name);
-	if (!ast_streamfile(chan, file_name, language)) {
+	if (!say_streamfile(chan, file_name, language)) {
 		if ((audiofd > -1) && (ctrlfd > -1))
-			ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+			say_waitstream_full(chan, ints, audiofd, ctrlfd);
 		else
-			ast_waitstream(chan, ints);
+			say_waitstream(chan, ints);
 	}
 	ast_stopstream(chan);
 }
@@ -2337,11 +2538,11 @@ static int ast_say_number_full_pt(struct ast_channel *chan, int num, const char
 			res = -1;
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -2422,11 +2623,11 @@ static int ast_say_number_full_se(struct ast_channel *chan, int num, const char
 			return -1;
 		}
 
-		if (!ast_streamfile(chan, fn, language)) {
+		if (!say_streamfile(chan, fn, language)) {
 			if ((audiofd > -1) && (ctrlfd > -1)) {
-				res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+				res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 			} else {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 			if (res) {
@@ -2536,11 +2737,11 @@ static int ast_say_number_full_zh(struct ast_channel *chan, int num, const char
 				}
 			}
 			if (!res) {
-				if (!ast_streamfile(chan, fn, language)) {
+				if (!say_streamfile(chan, fn, language)) {
 					if ((audiofd > -1) && (ctrlfd > -1))
-						res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+						res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 					else
-						res = ast_waitstream(chan, ints);
+						res = say_waitstream(chan, ints);
 				}
 				ast_stopstream(chan);
 			}
@@ -2597,11 +2798,11 @@ static int ast_say_number_full_ur(struct ast_channel *chan, int num, const char
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1)) {
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				} else {
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				}
 			}
 			ast_stopstream(chan);
@@ -2704,11 +2905,11 @@ static int ast_say_number_full_ru(struct ast_channel *chan, int num, const char
 			res = -1;
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -2774,11 +2975,11 @@ static int ast_say_number_full_th(struct ast_channel *chan, int num, const char
 			ast_copy_string(fn, "digits/larn", sizeof(fn));
 		}
 		if (!res) {
-			if(!ast_streamfile(chan, fn, language)) {
+			if(!say_streamfile(chan, fn, language)) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -2869,11 +3070,11 @@ static int ast_say_number_full_vi(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -2989,11 +3190,11 @@ static int ast_say_enumeration_full_en(struct ast_channel *chan, int num, const
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1)) {
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				} else {
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				}
 			}
 			ast_stopstream(chan);
@@ -3008,11 +3209,11 @@ static int ast_say_enumeration_full_vi(struct ast_channel *chan, int num, const
 	char fn[256] = "";
 	ast_copy_string(fn, "digits/h", sizeof(fn));
 	if (!res) {
-		if (!ast_streamfile(chan, fn, language)) {
+		if (!say_streamfile(chan, fn, language)) {
 			if ((audiofd > -1) && (ctrlfd > -1)) {
-				res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+				res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 			} else {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 		}
 		ast_stopstream(chan);
@@ -3161,19 +3362,19 @@ static int ast_say_enumeration_full_da(struct ast_channel *chan, int num, const
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 			if (!res) {
-				if (strlen(fna) != 0 && !ast_streamfile(chan, fna, language)) {
+				if (strlen(fna) != 0 && !say_streamfile(chan, fna, language)) {
 					if ((audiofd > -1) && (ctrlfd > -1)) {
-						res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+						res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 					} else {
-						res = ast_waitstream(chan, ints);
+						res = say_waitstream(chan, ints);
 					}
 				}
 				ast_stopstream(chan);
@@ -3324,19 +3525,19 @@ static int ast_say_enumeration_full_de(struct ast_channel *chan, int num, const
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 			if (!res) {
-				if (strlen(fna) != 0 && !ast_streamfile(chan, fna, language)) {
+				if (strlen(fna) != 0 && !say_streamfile(chan, fna, language)) {
 					if ((audiofd > -1) && (ctrlfd > -1)) {
-						res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+						res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 					} else {
-						res = ast_waitstream(chan, ints);
+						res = say_waitstream(chan, ints);
 					}
 				}
 				ast_stopstream(chan);
@@ -3422,11 +3623,11 @@ static int ast_say_enumeration_full_he(struct ast_channel *chan, int num, const
 			res = -1;
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1)) {
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				} else {
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				}
 			}
 			ast_stopstream(chan);
@@ -3588,19 +3789,19 @@ static int ast_say_enumeration_full_is(struct ast_channel *chan, int num, const
 		}
 
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 			if (!res) {
-				if (strlen(fna) != 0 && !ast_streamfile(chan, fna, language)) {
+				if (strlen(fna) != 0 && !say_streamfile(chan, fna, language)) {
 					if ((audiofd > -1) && (ctrlfd > -1)) {
-						res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+						res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 					} else {
-						res = ast_waitstream(chan, ints);
+						res = say_waitstream(chan, ints);
 					}
 				}
 				ast_stopstream(chan);
@@ -3655,20 +3856,20 @@ int ast_say_date_en(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	return res;
@@ -3684,19 +3885,19 @@ int ast_say_date_da(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_enumeration(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		/* Year */
@@ -3733,19 +3934,19 @@ int ast_say_date_de(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_enumeration(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		/* Year */
@@ -3785,22 +3986,22 @@ int ast_say_date_hu(struct ast_channel *chan, time_t t, const char *ints, const
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		ast_say_number(chan, tm.tm_mday , ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	return res;
 }
@@ -3815,19 +4016,19 @@ int ast_say_date_fr(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
@@ -3844,20 +4045,20 @@ int ast_say_date_nl(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	return res;
@@ -3873,27 +4074,27 @@ int ast_say_date_th(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		ast_copy_string(fn, "digits/tee", sizeof(fn));
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		ast_copy_string(fn, "digits/duan", sizeof(fn));
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res){
 		ast_copy_string(fn, "digits/posor", sizeof(fn));
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	}
 	return res;
@@ -3936,23 +4137,23 @@ int ast_say_date_he(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 	if (!res) {
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, "m");
 	}
 	if (!res) {
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, "m");
@@ -3970,19 +4171,19 @@ int ast_say_date_is(struct ast_channel *chan, time_t t, const char *ints, const
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_enumeration(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		/* Year */
@@ -6907,26 +7108,26 @@ int ast_say_time_en(struct ast_channel *chan, time_t t, const char *ints, const
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else if (tm.tm_min) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/oh", lang);
+			res = say_streamfile(chan, "digits/oh", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		if (!res)
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/oclock", lang);
+			res = say_streamfile(chan, "digits/oclock", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -6941,9 +7142,9 @@ int ast_say_time_de(struct ast_channel *chan, time_t t, const char *ints, const
 	if (!res)
 		res = ast_say_number(chan, tm.tm_hour, ints, lang, "n");
 	if (!res)
-		res = ast_streamfile(chan, "digits/oclock", lang);
+		res = say_streamfile(chan, "digits/oclock", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 	    if (tm.tm_min > 0)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, "f");
@@ -6961,14 +7162,14 @@ int ast_say_time_hu(struct ast_channel *chan, time_t t, const char *ints, const
 	if (!res)
 		res = ast_say_number(chan, tm.tm_hour, ints, lang, "n");
 	if (!res)
-		res = ast_streamfile(chan, "digits/oclock", lang);
+		res = say_streamfile(chan, "digits/oclock", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 	    if (tm.tm_min > 0) {
 			res = ast_say_number(chan, tm.tm_min, ints, lang, "f");
 			if (!res)
-				res = ast_streamfile(chan, "minute", lang);
+				res = say_streamfile(chan, "minute", lang);
 		}
 	return res;
 }
@@ -6984,7 +7185,7 @@ int ast_say_time_fr(struct ast_channel *chan, time_t t, const char *ints, const
 
 	res = ast_say_number(chan, tm.tm_hour, ints, lang, "f");
 	if (!res)
-		res = ast_streamfile(chan, "digits/oclock", lang);
+		res = say_streamfile(chan, "digits/oclock", lang);
 	if (tm.tm_min) {
 		if (!res)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
@@ -7003,9 +7204,9 @@ int ast_say_time_nl(struct ast_channel *chan, time_t t, const char *ints, const
 	if (!res)
 		res = ast_say_number(chan, tm.tm_hour, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/nl-uur", lang);
+		res = say_streamfile(chan, "digits/nl-uur", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 	    if (tm.tm_min > 0)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, NULL);
@@ -7109,25 +7310,25 @@ int ast_say_time_zh(struct ast_channel *chan, time_t t, const char *ints, const
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, hour, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/oclock", lang);
+		res = say_streamfile(chan, "digits/oclock", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "minute", lang);
+		res = say_streamfile(chan, "minute", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -7155,15 +7356,15 @@ int ast_say_time_he(struct ast_channel *chan, time_t t, const char *ints, const
 			res = ast_say_number_full_he(chan, 0, ints, lang, "f", -1, -1);
 		}
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		if (!res)
 			res = ast_say_number_full_he(chan, tm.tm_min, ints, lang, "f", -1, -1);
 	} else {
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -7214,15 +7415,15 @@ int ast_say_datetime_en(struct ast_channel *chan, time_t t, const char *ints, co
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char *) NULL);
@@ -7244,26 +7445,26 @@ int ast_say_datetime_en(struct ast_channel *chan, time_t t, const char *ints, co
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else if (tm.tm_min) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/oh", lang);
+			res = say_streamfile(chan, "digits/oh", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		if (!res)
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/oclock", lang);
+			res = say_streamfile(chan, "digits/oclock", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	return res;
@@ -7313,27 +7514,27 @@ int ast_say_datetime_fr(struct ast_channel *chan, time_t t, const char *ints, co
 
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 
 	if (!res)
 		res = ast_say_number(chan, tm.tm_hour, ints, lang, "f");
 	if (!res)
-			res = ast_streamfile(chan, "digits/oclock", lang);
+			res = say_streamfile(chan, "digits/oclock", lang);
 	if (tm.tm_min > 0) {
 		if (!res)
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	return res;
@@ -7349,9 +7550,9 @@ int ast_say_datetime_nl(struct ast_channel *chan, time_t t, const char *ints, co
 	ast_localtime(&when, &tm, NULL);
 	res = ast_say_date(chan, t, ints, lang);
 	if (!res) {
-		res = ast_streamfile(chan, "digits/nl-om", lang);
+		res = say_streamfile(chan, "digits/nl-om", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		ast_say_time(chan, t, ints, lang);
@@ -7370,15 +7571,15 @@ int ast_say_datetime_pt(struct ast_channel *chan, time_t t, const char *ints, co
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char *) NULL);
@@ -7400,26 +7601,26 @@ int ast_say_datetime_pt(struct ast_channel *chan, time_t t, const char *ints, co
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else if (tm.tm_min) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/oh", lang);
+			res = say_streamfile(chan, "digits/oh", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		if (!res)
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/oclock", lang);
+			res = say_streamfile(chan, "digits/oclock", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	return res;
@@ -7450,19 +7651,19 @@ int ast_say_datetime_th(struct ast_channel *chan, time_t t, const char *ints, co
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res){
 		ast_copy_string(fn, "digits/posor", sizeof(fn));
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		res = ast_say_number(chan, tm.tm_year + 1900 + 543, ints, lang, (char *) NULL);
 	}
 	if (!res)
@@ -7473,7 +7674,7 @@ int ast_say_datetime_th(struct ast_channel *chan, time_t t, const char *ints, co
 		hour = 24;
 	if (!res){
 		ast_copy_string(fn, "digits/wela", sizeof(fn));
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 	}
 	if (!res)
 		res = ast_say_number(chan, hour, ints, lang, (char *) NULL);
@@ -7496,17 +7697,17 @@ int ast_say_datetime_zh(struct ast_channel *chan, time_t t, const char *ints, co
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char *) NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 
 	hour = tm.tm_hour;
@@ -7520,25 +7721,25 @@ int ast_say_datetime_zh(struct ast_channel *chan, time_t t, const char *ints, co
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, hour, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/oclock", lang);
+		res = say_streamfile(chan, "digits/oclock", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "minute", lang);
+		res = say_streamfile(chan, "minute", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -7554,16 +7755,16 @@ int ast_say_datetime_he(struct ast_channel *chan, time_t t, const char *ints, co
 	ast_localtime(&when, &tm, NULL);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 	if (!res) {
@@ -7589,18 +7790,18 @@ int ast_say_datetime_he(struct ast_channel *chan, time_t t, const char *ints, co
 			res = ast_say_number(chan, 0, ints, lang, "f");
 		}
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 		if (!res) {
 			res = ast_say_number(chan, tm.tm_min, ints, lang, "f");
 		}
 	} else {
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 	if (!res) {
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	}
 	if (!res) {
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, "f");
@@ -7643,9 +7844,9 @@ int ast_say_datetime_from_now_en(struct ast_channel *chan, time_t t, const char
 		/* Day of month and month */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res)
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 		}
 		if (!res)
 			res = ast_say_number(chan, tm.tm_mday, ints, lang, (char *) NULL);
@@ -7654,9 +7855,9 @@ int ast_say_datetime_from_now_en(struct ast_channel *chan, time_t t, const char
 		/* Just what day of the week */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res)
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 		}
 	} /* Otherwise, it was today */
 	if (!res)
@@ -7681,9 +7882,9 @@ int ast_say_datetime_from_now_fr(struct ast_channel *chan, time_t t, const char
 		/* Day of month and month */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res)
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 		}
 		if (!res)
 			res = ast_say_number(chan, tm.tm_mday, ints, lang, (char *) NULL);
@@ -7692,9 +7893,9 @@ int ast_say_datetime_from_now_fr(struct ast_channel *chan, time_t t, const char
 		/* Just what day of the week */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res)
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 		}
 	} /* Otherwise, it was today */
 	if (!res)
@@ -7769,9 +7970,9 @@ int ast_say_datetime_from_now_he(struct ast_channel *chan, time_t t, const char
 		/* Day of month and month */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res)
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 		}
 		if (!res) {
 			res = ast_say_number(chan, tm.tm_mday, ints, lang, "f");
@@ -7780,9 +7981,9 @@ int ast_say_datetime_from_now_he(struct ast_channel *chan, time_t t, const char
 		/* Just what day of the week */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res) {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 		}
 	}							/* Otherwise, it was today */
@@ -7813,9 +8014,9 @@ static int gr_say_number_female(int num, struct ast_channel *chan, const char *i
 		tmp = (num/10) * 10;
 		left = num - tmp;
 		snprintf(fn, sizeof(fn), "digits/%d", tmp);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		if (left)
 			gr_say_number_female(left, chan, ints, lang);
 
@@ -7851,9 +8052,9 @@ static int ast_say_number_full_gr(struct ast_channel *chan, int num, const char
 
 	if (!num) {
 		ast_copy_string(fn, "digits/0", sizeof(fn));
-		res = ast_streamfile(chan, fn, ast_channel_language(chan));
+		res = say_streamfile(chan, fn, ast_channel_language(chan));
 		if (!res)
-			return  ast_waitstream(chan, ints);
+			return  say_waitstream(chan, ints);
 	}
 
 	while (!res && num ) {
@@ -7898,11 +8099,11 @@ static int ast_say_number_full_gr(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -7964,11 +8165,11 @@ static int ast_say_number_full_ja(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
+			if (!say_streamfile(chan, fn, language)) {
 				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+					res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 				else
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			ast_stopstream(chan);
 		}
@@ -7999,9 +8200,9 @@ static int ast_say_date_gr(struct ast_channel *chan, time_t t, const char *ints,
 	/* W E E K - D A Y */
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	/* D A Y */
 	if (!res) {
@@ -8010,9 +8211,9 @@ static int ast_say_date_gr(struct ast_channel *chan, time_t t, const char *ints,
 	/* M O N T H */
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	/* Y E A R */
 	if (!res)
@@ -8034,24 +8235,24 @@ int ast_say_date_ja(struct ast_channel *chan, time_t t, const char *ints, const
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	if (!res)
-		res = ast_streamfile(chan, "digits/nen", lang);
+		res = say_streamfile(chan, "digits/nen", lang);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/nichi", lang);
+		res = say_streamfile(chan, "digits/nichi", lang);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	return res;
 }
@@ -8089,26 +8290,26 @@ static int ast_say_time_gr(struct ast_channel *chan, time_t t, const char *ints,
 	res = gr_say_number_female(hour, chan, ints, lang);
 	if (tm.tm_min) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/kai", lang);
+			res = say_streamfile(chan, "digits/kai", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		if (!res)
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/hwra", lang);
+			res = say_streamfile(chan, "digits/hwra", lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -8135,26 +8336,26 @@ static int ast_say_time_ja(struct ast_channel *chan, time_t t, const char *ints,
 
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (hour == 9 || hour == 21) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/9_2", lang);
+			res = say_streamfile(chan, "digits/9_2", lang);
 	} else {
 		if (!res)
 			res = ast_say_number(chan, hour, ints, lang, (char *) NULL);
 	}
 	if (!res)
-		res = ast_streamfile(chan, "digits/ji", lang);
+		res = say_streamfile(chan, "digits/ji", lang);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/fun", lang);
+		res = say_streamfile(chan, "digits/fun", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -8173,9 +8374,9 @@ static int ast_say_datetime_gr(struct ast_channel *chan, time_t t, const char *i
 	/* W E E K - D A Y */
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	/* D A Y */
 	if (!res) {
@@ -8184,9 +8385,9 @@ static int ast_say_datetime_gr(struct ast_channel *chan, time_t t, const char *i
 	/* M O N T H */
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 
 	res = ast_say_time_gr(chan, t, ints, lang);
@@ -8207,22 +8408,22 @@ int ast_say_datetime_ja(struct ast_channel *chan, time_t t, const char *ints, co
 	if (!res)
 		res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/nen", lang);
+		res = say_streamfile(chan, "digits/nen", lang);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 	if (!res)
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/nichi", lang);
+		res = say_streamfile(chan, "digits/nichi", lang);
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 	}
 
 	hour = tm.tm_hour;
@@ -8236,26 +8437,26 @@ int ast_say_datetime_ja(struct ast_channel *chan, time_t t, const char *ints, co
 	}
 	if (pm) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/p-m", lang);
+			res = say_streamfile(chan, "digits/p-m", lang);
 	} else {
 		if (!res)
-			res = ast_streamfile(chan, "digits/a-m", lang);
+			res = say_streamfile(chan, "digits/a-m", lang);
 	}
 	if (hour == 9 || hour == 21) {
 		if (!res)
-			res = ast_streamfile(chan, "digits/9_2", lang);
+			res = say_streamfile(chan, "digits/9_2", lang);
 	} else {
 		if (!res)
 			res = ast_say_number(chan, hour, ints, lang, (char *) NULL);
 	}
 	if (!res)
-		res = ast_streamfile(chan, "digits/ji", lang);
+		res = say_streamfile(chan, "digits/ji", lang);
 	if (!res)
 		res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 	if (!res)
-		res = ast_streamfile(chan, "digits/fun", lang);
+		res = say_streamfile(chan, "digits/fun", lang);
 	if (!res)
-		res = ast_waitstream(chan, ints);
+		res = say_waitstream(chan, ints);
 	return res;
 }
 
@@ -8327,16 +8528,16 @@ static int ast_say_date_with_format_gr(struct ast_channel *chan, time_t t, const
 			/* Minute */
 			if (tm.tm_min) {
 				if (!res)
-					res = ast_streamfile(chan, "digits/kai", lang);
+					res = say_streamfile(chan, "digits/kai", lang);
 				if (!res)
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				if (!res)
 					res = ast_say_number_full_gr(chan, tm.tm_min, ints, lang, -1, -1);
 			} else {
 				if (!res)
-					res = ast_streamfile(chan, "digits/oclock", lang);
+					res = say_streamfile(chan, "digits/oclock", lang);
 				if (!res)
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 			}
 			break;
 		case 'P':
@@ -9100,11 +9301,11 @@ static int ast_say_number_full_ka(struct ast_channel *chan, int num, const char
 		strncat(new_string, remaining, len);  /* we can't sprintf() it, it's not null-terminated. */
 /*		new_string[len + strlen("digits/")] = '\0'; */
 
-		if (!ast_streamfile(chan, new_string, language)) {
+		if (!say_streamfile(chan, new_string, language)) {
 			if ((audiofd  > -1) && (ctrlfd > -1)) {
-				res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+				res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 			} else {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 		}
 		ast_stopstream(chan);
@@ -9124,11 +9325,11 @@ static int ast_say_number_full_ka(struct ast_channel *chan, int num, const char
 		char* new_string = ast_malloc(strlen(remaining) + 1 + strlen("digits/"));
 		sprintf(new_string, "digits/%s", remaining);
 
-		if (!ast_streamfile(chan, new_string, language)) {
+		if (!say_streamfile(chan, new_string, language)) {
 			if ((audiofd  > -1) && (ctrlfd > -1)) {
-				res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+				res = say_waitstream_full(chan, ints, audiofd, ctrlfd);
 			} else {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 		}
 		ast_stopstream(chan);
@@ -9168,24 +9369,24 @@ static int ast_say_date_ka(struct ast_channel *chan, time_t t, const char *ints,
 
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/tslis %d", tm.tm_wday);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 
 	if (!res) {
 		res = ast_say_number(chan, tm.tm_mday, ints, lang, (char * ) NULL);
 /*		if (!res)
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 */
 	}
 
 	if (!res) {
 		snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-		res = ast_streamfile(chan, fn, lang);
+		res = say_streamfile(chan, fn, lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 	return res;
@@ -9207,9 +9408,9 @@ static int ast_say_time_ka(struct ast_channel *chan, time_t t, const char *ints,
 
 	res = ast_say_number(chan, tm.tm_hour, ints, lang, (char*)NULL);
 	if (!res) {
-		res = ast_streamfile(chan, "digits/saati_da", lang);
+		res = say_streamfile(chan, "digits/saati_da", lang);
 		if (!res) {
-			res = ast_waitstream(chan, ints);
+			res = say_waitstream(chan, ints);
 		}
 	}
 
@@ -9218,9 +9419,9 @@ static int ast_say_time_ka(struct ast_channel *chan, time_t t, const char *ints,
 			res = ast_say_number(chan, tm.tm_min, ints, lang, (char*)NULL);
 
 			if (!res) {
-				res = ast_streamfile(chan, "digits/tsuti", lang);
+				res = say_streamfile(chan, "digits/tsuti", lang);
 				if (!res) {
-					res = ast_waitstream(chan, ints);
+					res = say_waitstream(chan, ints);
 				}
 			}
 		}
@@ -9269,9 +9470,9 @@ static int ast_say_datetime_from_now_ka(struct ast_channel *chan, time_t t, cons
 		}
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/mon-%d", tm.tm_mon);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res) {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 		}
 
@@ -9279,9 +9480,9 @@ static int ast_say_datetime_from_now_ka(struct ast_channel *chan, time_t t, cons
 		/* Just what day of the week */
 		if (!res) {
 			snprintf(fn, sizeof(fn), "digits/day-%d", tm.tm_wday);
-			res = ast_streamfile(chan, fn, lang);
+			res = say_streamfile(chan, fn, lang);
 			if (!res) {
-				res = ast_waitstream(chan, ints);
+				res = say_waitstream(chan, ints);
 			}
 		}
 	} /* Otherwise, it was today */
@@ -9404,19 +9605,93 @@ int ast_say_counted_adjective(struct ast_channel *chan, int num, const char adje
 
 
 
+/*
+ * The entry points of the sayers, collecting the files they play into
+ * a playlist when the say_playlist option is set.
+ */
+static int say_number_full_playlist(struct ast_channel *chan, int num, const char *ints, const char *language, const char *options, int audiofd, int ctrlfd)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_number_full(chan, num, ints, language, options, audiofd, ctrlfd), ints, audiofd, ctrlfd);
+}
+
+static int say_enumeration_full_playlist(struct ast_channel *chan, int num, const char *ints, const char *language, const char *options, int audiofd, int ctrlfd)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_enumeration_full(chan, num, ints, language, options, audiofd, ctrlfd), ints, audiofd, ctrlfd);
+}
+
+static int say_digit_str_full_playlist(struct ast_channel *chan, const char *str, const char *ints, const char *lang, int audiofd, int ctrlfd)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_digit_str_full(chan, str, ints, lang, audiofd, ctrlfd), ints, audiofd, ctrlfd);
+}
+
+static int say_character_str_full_playlist(struct ast_channel *chan, const char *str, const char *ints, const char *lang, enum ast_say_case_sensitivity sensitivity, int audiofd, int ctrlfd)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_character_str_full(chan, str, ints, lang, sensitivity, audiofd, ctrlfd), ints, audiofd, ctrlfd);
+}
+
+static int say_phonetic_str_full_playlist(struct ast_channel *chan, const char *str, const char *ints, const char *lang, int audiofd, int ctrlfd)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_phonetic_str_full(chan, str, ints, lang, audiofd, ctrlfd), ints, audiofd, ctrlfd);
+}
+
+static int say_datetime_playlist(struct ast_channel *chan, time_t t, const char *ints, const char *lang)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_datetime(chan, t, ints, lang), ints, -1, -1);
+}
+
+static int say_time_playlist(struct ast_channel *chan, time_t t, const char *ints, const char *lang)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_time(chan, t, ints, lang), ints, -1, -1);
+}
+
+static int say_date_playlist(struct ast_channel *chan, time_t t, const char *ints, const char *lang)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_date(chan, t, ints, lang), ints, -1, -1);
+}
+
+static int say_datetime_from_now_playlist(struct ast_channel *chan, time_t t, const char *ints, const char *lang)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_datetime_from_now(chan, t, ints, lang), ints, -1, -1);
+}
+
+static int say_date_with_format_playlist(struct ast_channel *chan, time_t t, const char *ints, const char *lang, const char *format, const char *tzone)
+{
+	struct say_playlist *playlist = say_playlist_start(chan);
+
+	return say_playlist_finish(playlist, say_date_with_format(chan, t, ints, lang, format, tzone), ints, -1, -1);
+}
+
 /*! \brief
  * remap the 'say' functions to use those in this file
  */
 static void __attribute__((constructor)) __say_init(void)
 {
-	ast_say_number_full = say_number_full;
-	ast_say_enumeration_full = say_enumeration_full;
-	ast_say_digit_str_full = say_digit_str_full;
-	ast_say_character_str_full = say_character_str_full;
-	ast_say_phonetic_str_full = say_phonetic_str_full;
-	ast_say_datetime = say_datetime;
-	ast_say_time = say_time;
-	ast_say_date = say_date;
-	ast_say_datetime_from_now = say_datetime_from_now;
-	ast_say_date_with_format = say_date_with_format;
+	ast_say_number_full = say_number_full_playlist;
+	ast_say_enumeration_full = say_enumeration_full_playlist;
+	ast_say_digit_str_full = say_digit_str_full_playlist;
+	ast_say_character_str_full = say_character_str_full_playlist;
+	ast_say_phonetic_str_full = say_phonetic_str_full_playlist;
+	ast_say_datetime = say_datetime_playlist;
+	ast_say_time = say_time_playlist;
+	ast_say_date = say_date_playlist;
+	ast_say_datetime_from_now = say_datetime_from_now_playlist;
+	ast_say_date_with_format = say_date_with_format_playlist;
 }
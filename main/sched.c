@@ -44,6 +44,8 @@
 #include "asterisk/utils.h"
 #include "asterisk/heap.h"
 #include "asterisk/threadstorage.h"
+#include "asterisk/dlinkedlists.h"
+#include "asterisk/vector.h"
 
 /*!
  * \brief Max num of schedule structs
@@ -55,8 +57,18 @@
  */
 #define SCHED_MAX_CACHE 128
 
+#define ID_QUEUE_INCREMENT 16
+
 AST_THREADSTORAGE(last_del_id);
 
+/*! \brief Number of bits of a tick used to index each timing wheel level */
+#define SCHED_WHEEL_BITS 8
+/*! \brief Number of slots in each timing wheel level */
+#define SCHED_WHEEL_SLOTS (1 << SCHED_WHEEL_BITS)
+#define SCHED_WHEEL_MASK (SCHED_WHEEL_SLOTS - 1)
+/*! \brief Number of timing wheel levels.  Together they span 2^32 ms (about 49 days). */
+#define SCHED_WHEEL_LEVELS 4
+
 /*!
  * \brief Scheduler ID holder
  *
@@ -91,6 +103,14 @@ struct sched {
 	const void *data;             /*!< Data */
 	ast_sched_cb callback;        /*!< Callback */
 	ssize_t __heap_index;
+	/*! Timing wheel slot linkage */
+	AST_DLLIST_ENTRY(sched) wheel_list;
+	/*! Timing wheel tick the entry is due at */
+	int64_t wheel_tick;
+	/*! Timing wheel level of the entry's slot, SCHED_WHEEL_LEVELS if in the overflow list */
+	unsigned short wheel_level;
+	/*! Timing wheel slot index within the level */
+	unsigned short wheel_index;
 	/*!
 	 * Used to synchronize between thread running a task and thread
 	 * attempting to delete a task
@@ -100,6 +120,35 @@ struct sched {
 	unsigned int deleted:1;
 };
 
+AST_DLLIST_HEAD_NOLOCK(sched_wheel_slot, sched);
+
+/*!
+ * \brief Hierarchical timing wheel
+ *
+ * Time is divided into millisecond ticks.  An entry due at a tick after
+ * the current one is kept at the lowest level where the two ticks only
+ * differ in that level's bits, in the slot indexed by those bits of the
+ * entry's tick.  Entries due at or before the current tick are kept in the
+ * current level 0 slot.  Level 0 slots are kept in expiration order and
+ * higher level slots are cascaded down once the current tick reaches them,
+ * so adding and deleting entries does not depend on how many there are.
+ */
+struct sched_wheel {
+	/*! Time of tick 0 */
+	struct timeval epoch;
+	/*! The tick the wheel has been advanced to */
+	int64_t current;
+	/*! Number of entries in the wheel */
+	size_t count;
+	/*! The earliest entry, NULL if it needs to be looked up */
+	struct sched *next;
+	/*! Bitmap of the non-empty slots of each level */
+	uint64_t occupied[SCHED_WHEEL_LEVELS][SCHED_WHEEL_SLOTS / 64];
+	struct sched_wheel_slot slots[SCHED_WHEEL_LEVELS][SCHED_WHEEL_SLOTS];
+	/*! Entries too far in the future for the wheel */
+	struct sched_wheel_slot overflow;
+};
+
 struct sched_thread {
 	pthread_t thread;
 	ast_cond_t cond;
@@ -113,6 +162,10 @@ struct ast_sched_context {
 	/*! Next tie breaker in case events expire at the same time. */
 	unsigned int tie_breaker;
 	struct ast_heap *sched_heap;
+	/*! Used instead of sched_heap when the context uses a timing wheel */
+	struct sched_wheel *sched_wheel;
+	/*! Scheduled entries indexed by their ID - 1, NULL if not scheduled */
+	AST_VECTOR(, struct sched *) sched_by_id;
 	struct sched_thread *sched_thread;
 	/*! The scheduled task that is currently executing */
 	struct sched *currently_executing;
@@ -233,7 +286,260 @@ static int sched_time_cmp(void *va, void *vb)
 	return cmp;
 }
 
+/*! \brief Convert a time to a timing wheel tick */
+static int64_t sched_wheel_tick(const struct sched_wheel *wheel, struct timeval tv)
+{
+	return (((int64_t) tv.tv_sec - wheel->epoch.tv_sec) * 1000000
+		+ (tv.tv_usec - wheel->epoch.tv_usec)) / 1000;
+}
+
+/*!
+ * \brief Find the first non-empty slot of a timing wheel level
+ *
+ * \param occupied The level's bitmap of non-empty slots
+ * \param from The slot index to start looking from
+ *
+ * \return The slot index or -1 if there is none
+ */
+static int sched_wheel_next_slot(const uint64_t *occupied, int from)
+{
+	int word;
+
+	for (word = from / 64; word < SCHED_WHEEL_SLOTS / 64; ++word) {
+		uint64_t bits = occupied[word];
+
+		if (word == from / 64) {
+			bits &= ~0ULL << (from % 64);
+		}
+		if (bits) {
+			return word * 64 + ffsll(bits) - 1;
+		}
+	}
+
+	return -1;
+}
+
+static struct sched_wheel_slot *sched_wheel_slot_of(struct sched_wheel *wheel, struct sched *s)
+{
+	if (s->wheel_level == SCHED_WHEEL_LEVELS) {
+		return &wheel->overflow;
+	}
+	return &wheel->slots[s->wheel_level][s->wheel_index];
+}
+
+/*! \brief Link an entry into the slot its tick belongs in */
+static void sched_wheel_insert(struct sched_wheel *wheel, struct sched *s)
+{
+	uint64_t differ = (uint64_t) s->wheel_tick ^ (uint64_t) wheel->current;
+	struct sched_wheel_slot *slot;
+	struct sched *prev;
+	int level;
+
+	if (s->wheel_tick <= wheel->current) {
+		level = 0;
+		s->wheel_index = wheel->current & SCHED_WHEEL_MASK;
+	} else {
+		for (level = 0; level < SCHED_WHEEL_LEVELS; ++level) {
+			if (!(differ >> (SCHED_WHEEL_BITS * (level + 1)))) {
+				break;
+			}
+		}
+		s->wheel_index = ((uint64_t) s->wheel_tick >> (SCHED_WHEEL_BITS * level)) & SCHED_WHEEL_MASK;
+	}
+	s->wheel_level = level;
+
+	slot = sched_wheel_slot_of(wheel, s);
+	if (level) {
+		AST_DLLIST_INSERT_TAIL(slot, s, wheel_list);
+		if (level < SCHED_WHEEL_LEVELS) {
+			wheel->occupied[level][s->wheel_index / 64] |= 1ULL << (s->wheel_index % 64);
+		}
+		return;
+	}
+
+	/* Level 0 slots are kept in expiration order.  New entries usually go last. */
+	for (prev = AST_DLLIST_LAST(slot); prev; prev = AST_DLLIST_PREV(prev, wheel_list)) {
+		if (sched_time_cmp(s, prev) < 0) {
+			break;
+		}
+	}
+	if (prev) {
+		AST_DLLIST_INSERT_AFTER(slot, prev, s, wheel_list);
+	} else {
+		AST_DLLIST_INSERT_HEAD(slot, s, wheel_list);
+	}
+	wheel->occupied[0][s->wheel_index / 64] |= 1ULL << (s->wheel_index % 64);
+}
+
+/*! \brief Unlink an entry from its slot */
+static void sched_wheel_unlink(struct sched_wheel *wheel, struct sched *s)
+{
+	struct sched_wheel_slot *slot = sched_wheel_slot_of(wheel, s);
+
+	AST_DLLIST_REMOVE(slot, s, wheel_list);
+	if (s->wheel_level < SCHED_WHEEL_LEVELS && AST_DLLIST_EMPTY(slot)) {
+		wheel->occupied[s->wheel_level][s->wheel_index / 64] &= ~(1ULL << (s->wheel_index % 64));
+	}
+}
+
+/*! \brief Re-link all entries of a slot relative to the current tick */
+static void sched_wheel_cascade(struct sched_wheel *wheel, struct sched_wheel_slot *slot)
+{
+	struct sched_wheel_slot entries = *slot;
+	struct sched *s;
+
+	AST_DLLIST_HEAD_INIT_NOLOCK(slot);
+	while ((s = AST_DLLIST_REMOVE_HEAD(&entries, wheel_list))) {
+		if (s->wheel_level < SCHED_WHEEL_LEVELS) {
+			wheel->occupied[s->wheel_level][s->wheel_index / 64] &= ~(1ULL << (s->wheel_index % 64));
+		}
+		sched_wheel_insert(wheel, s);
+	}
+}
+
+static struct sched *sched_wheel_slot_min(struct sched_wheel_slot *slot)
+{
+	struct sched *s;
+	struct sched *min = NULL;
+
+	AST_DLLIST_TRAVERSE(slot, s, wheel_list) {
+		if (!min || sched_time_cmp(s, min) > 0) {
+			min = s;
+		}
+	}
+
+	return min;
+}
+
+static void sched_wheel_push(struct sched_wheel *wheel, struct sched *s)
+{
+	if (!wheel->count++) {
+		/* Nothing depends on the current tick so bring it up to date */
+		wheel->current = sched_wheel_tick(wheel, ast_tvnow());
+	}
+	s->wheel_tick = sched_wheel_tick(wheel, s->when);
+	sched_wheel_insert(wheel, s);
+
+	if (wheel->next && sched_time_cmp(s, wheel->next) > 0) {
+		wheel->next = s;
+	}
+}
+
+static void sched_wheel_remove(struct sched_wheel *wheel, struct sched *s)
+{
+	sched_wheel_unlink(wheel, s);
+	--wheel->count;
+	if (wheel->next == s) {
+		wheel->next = NULL;
+	}
+}
+
+/*!
+ * \brief Find the earliest entry of a timing wheel
+ *
+ * \param wheel The timing wheel
+ * \param now The current tick.  The wheel is advanced up to it as needed.
+ */
+static struct sched *sched_wheel_peek(struct sched_wheel *wheel, int64_t now)
+{
+	if (wheel->next || !wheel->count) {
+		return wheel->next;
+	}
+
+	for (;;) {
+		uint64_t current = wheel->current;
+		int level;
+		int index;
+		int shift = 0;
+		int64_t base;
+
+		index = sched_wheel_next_slot(wheel->occupied[0], current & SCHED_WHEEL_MASK);
+		if (index >= 0) {
+			base = (current & ~(uint64_t) SCHED_WHEEL_MASK) | index;
+			if (base <= now) {
+				/* The slots in between are empty */
+				wheel->current = base;
+			}
+			wheel->next = AST_DLLIST_FIRST(&wheel->slots[0][index]);
+			return wheel->next;
+		}
+
+		for (level = 1; level < SCHED_WHEEL_LEVELS; ++level) {
+			shift = SCHED_WHEEL_BITS * level;
+			index = sched_wheel_next_slot(wheel->occupied[level],
+				((current >> shift) & SCHED_WHEEL_MASK) + 1);
+			if (index >= 0) {
+				break;
+			}
+		}
+
+		if (level < SCHED_WHEEL_LEVELS) {
+			base = (current >> (shift + SCHED_WHEEL_BITS) << (shift + SCHED_WHEEL_BITS))
+				| ((uint64_t) index << shift);
+			if (base > now) {
+				/* Not due yet so leave the slot for later */
+				wheel->next = sched_wheel_slot_min(&wheel->slots[level][index]);
+				return wheel->next;
+			}
+			wheel->current = base;
+			sched_wheel_cascade(wheel, &wheel->slots[level][index]);
+			continue;
+		}
+
+		/* Only entries too far in the future for the wheel remain */
+		wheel->next = sched_wheel_slot_min(&wheel->overflow);
+		base = MIN(now, wheel->next->wheel_tick);
+		if (base <= wheel->current) {
+			return wheel->next;
+		}
+		wheel->current = base;
+		sched_wheel_cascade(wheel, &wheel->overflow);
+		wheel->next = NULL;
+	}
+}
+
+static size_t sched_queue_size(struct ast_sched_context *con)
+{
+	return con->sched_wheel ? con->sched_wheel->count : ast_heap_size(con->sched_heap);
+}
+
+/*! \brief Add an entry to the context's schedule queue */
+static void sched_queue_push(struct ast_sched_context *con, struct sched *s)
+{
+	if (con->sched_wheel) {
+		sched_wheel_push(con->sched_wheel, s);
+	} else {
+		ast_heap_push(con->sched_heap, s);
+	}
+	*AST_VECTOR_GET_ADDR(&con->sched_by_id, s->sched_id->id - 1) = s;
+}
+
+/*! \brief Get the entry of the context's schedule queue that expires first */
+static struct sched *sched_queue_peek(struct ast_sched_context *con, struct timeval now)
+{
+	if (con->sched_wheel) {
+		return sched_wheel_peek(con->sched_wheel, sched_wheel_tick(con->sched_wheel, now));
+	}
+	return ast_heap_peek(con->sched_heap, 1);
+}
+
+/*! \brief Remove an entry from the context's schedule queue */
+static void sched_queue_remove(struct ast_sched_context *con, struct sched *s)
+{
+	*AST_VECTOR_GET_ADDR(&con->sched_by_id, s->sched_id->id - 1) = NULL;
+	if (con->sched_wheel) {
+		sched_wheel_remove(con->sched_wheel, s);
+	} else if (!ast_heap_remove(con->sched_heap, s)) {
+		ast_log(LOG_WARNING,"sched entry %d not in the sched heap?\n", s->sched_id->id);
+	}
+}
+
 struct ast_sched_context *ast_sched_context_create(void)
+{
+	return ast_sched_context_create_backend(AST_SCHED_BACKEND_HEAP);
+}
+
+struct ast_sched_context *ast_sched_context_create_backend(enum ast_sched_backend backend)
 {
 	struct ast_sched_context *tmp;
 
@@ -246,12 +552,29 @@ struct ast_sched_context *ast_sched_context_create(void)
 
 	AST_LIST_HEAD_INIT_NOLOCK(&tmp->id_queue);
 
-	if (!(tmp->sched_heap = ast_heap_create(8, sched_time_cmp,
-			offsetof(struct sched, __heap_index)))) {
+	if (AST_VECTOR_INIT(&tmp->sched_by_id, ID_QUEUE_INCREMENT)) {
 		ast_sched_context_destroy(tmp);
 		return NULL;
 	}
 
+	switch (backend) {
+	case AST_SCHED_BACKEND_WHEEL:
+		if (!(tmp->sched_wheel = ast_calloc(1, sizeof(*tmp->sched_wheel)))) {
+			ast_sched_context_destroy(tmp);
+			return NULL;
+		}
+		tmp->sched_wheel->epoch = ast_tvnow();
+		break;
+	case AST_SCHED_BACKEND_HEAP:
+	default:
+		if (!(tmp->sched_heap = ast_heap_create(8, sched_time_cmp,
+				offsetof(struct sched, __heap_index)))) {
+			ast_sched_context_destroy(tmp);
+			return NULL;
+		}
+		break;
+	}
+
 	return tmp;
 }
 
@@ -290,6 +613,20 @@ void ast_sched_context_destroy(struct ast_sched_context *con)
 		con->sched_heap = NULL;
 	}
 
+	if (con->sched_wheel) {
+		size_t i;
+
+		for (i = 0; i < AST_VECTOR_SIZE(&con->sched_by_id); ++i) {
+			s = AST_VECTOR_GET(&con->sched_by_id, i);
+			if (s) {
+				sched_free(s);
+			}
+		}
+		ast_free(con->sched_wheel);
+		con->sched_wheel = NULL;
+	}
+	AST_VECTOR_FREE(&con->sched_by_id);
+
 	while ((sid = AST_LIST_REMOVE_HEAD(&con->id_queue, list))) {
 		ast_free(sid);
 	}
@@ -300,8 +637,6 @@ void ast_sched_context_destroy(struct ast_sched_context *con)
 	ast_free(con);
 }
 
-#define ID_QUEUE_INCREMENT 16
-
 /*!
  * \brief Add new scheduler IDs to the queue.
  *
@@ -330,6 +665,10 @@ static int add_ids(struct ast_sched_context *con)
 		if (!new_id) {
 			break;
 		}
+		if (AST_VECTOR_APPEND(&con->sched_by_id, NULL)) {
+			ast_free(new_id);
+			break;
+		}
 
 		/*
 		 * According to the API doxygen a sched ID of 0 is valid.
@@ -406,17 +745,17 @@ static struct sched *sched_alloc(struct ast_sched_context *con)
 
 void ast_sched_clean_by_callback(struct ast_sched_context *con, ast_sched_cb match, ast_sched_cb cleanup_cb)
 {
-	int i = 1;
+	size_t i;
 	struct sched *current;
 
 	ast_mutex_lock(&con->lock);
-	while ((current = ast_heap_peek(con->sched_heap, i))) {
-		if (current->callback != match) {
-			i++;
+	for (i = 0; i < AST_VECTOR_SIZE(&con->sched_by_id); ++i) {
+		current = AST_VECTOR_GET(&con->sched_by_id, i);
+		if (!current || current->callback != match) {
 			continue;
 		}
 
-		ast_heap_remove(con->sched_heap, current);
+		sched_queue_remove(con, current);
 
 		cleanup_cb(current->data);
 		sched_release(con, current);
@@ -432,12 +771,14 @@ int ast_sched_wait(struct ast_sched_context *con)
 {
 	int ms;
 	struct sched *s;
+	struct timeval now;
 
 	DEBUG(ast_debug(1, "ast_sched_wait()\n"));
 
 	ast_mutex_lock(&con->lock);
-	if ((s = ast_heap_peek(con->sched_heap, 1))) {
-		ms = ast_tvdiff_ms(s->when, ast_tvnow());
+	now = ast_tvnow();
+	if ((s = sched_queue_peek(con, now))) {
+		ms = ast_tvdiff_ms(s->when, now);
 		if (ms < 0) {
 			ms = 0;
 		}
@@ -459,9 +800,9 @@ static void schedule(struct ast_sched_context *con, struct sched *s)
 {
 	size_t size;
 
-	size = ast_heap_size(con->sched_heap);
+	size = sched_queue_size(con);
 
-	/* Record the largest the scheduler heap became for reporting purposes. */
+	/* Record the largest the scheduler queue became for reporting purposes. */
 	if (con->highwater <= size) {
 		con->highwater = size + 1;
 	}
@@ -478,7 +819,7 @@ static void schedule(struct ast_sched_context *con, struct sched *s)
 	}
 	s->tie_breaker = con->tie_breaker;
 
-	ast_heap_push(con->sched_heap, s);
+	sched_queue_push(con, s);
 }
 
 /*! \brief
@@ -569,19 +910,11 @@ int ast_sched_add(struct ast_sched_context *con, int when, ast_sched_cb callback
 
 static struct sched *sched_find(struct ast_sched_context *con, int id)
 {
-	int x;
-	size_t heap_size;
-
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		struct sched *cur = ast_heap_peek(con->sched_heap, x);
-
-		if (cur->sched_id->id == id) {
-			return cur;
-		}
+	if (id <= 0 || id > AST_VECTOR_SIZE(&con->sched_by_id)) {
+		return NULL;
 	}
 
-	return NULL;
+	return AST_VECTOR_GET(&con->sched_by_id, id - 1);
 }
 
 const void *ast_sched_find_data(struct ast_sched_context *con, int id)
@@ -622,9 +955,7 @@ int ast_sched_del(struct ast_sched_context *con, int id)
 
 	s = sched_find(con, id);
 	if (s) {
-		if (!ast_heap_remove(con->sched_heap, s)) {
-			ast_log(LOG_WARNING,"sched entry %d not in the sched heap?\n", s->sched_id->id);
-		}
+		sched_queue_remove(con, s);
 		sched_release(con, s);
 	} else if (con->currently_executing && (id == con->currently_executing->sched_id->id)) {
 		if (con->executing_thread_id == pthread_self()) {
@@ -673,19 +1004,21 @@ int ast_sched_del(struct ast_sched_context *con, int id)
 
 void ast_sched_report(struct ast_sched_context *con, struct ast_str **buf, struct ast_cb_names *cbnames)
 {
-	int i, x;
+	int i;
 	struct sched *cur;
 	int countlist[cbnames->numassocs + 1];
-	size_t heap_size;
+	size_t x;
 
 	memset(countlist, 0, sizeof(countlist));
-	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, ast_heap_size(con->sched_heap));
+	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, sched_queue_size(con));
 
 	ast_mutex_lock(&con->lock);
 
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		cur = ast_heap_peek(con->sched_heap, x);
+	for (x = 0; x < AST_VECTOR_SIZE(&con->sched_by_id); x++) {
+		cur = AST_VECTOR_GET(&con->sched_by_id, x);
+		if (!cur) {
+			continue;
+		}
 		/* match the callback to the cblist */
 		for (i = 0; i < cbnames->numassocs; i++) {
 			if (cur->callback == cbnames->cblist[i]) {
@@ -713,8 +1046,7 @@ void ast_sched_dump(struct ast_sched_context *con)
 {
 	struct sched *q;
 	struct timeval when;
-	int x;
-	size_t heap_size;
+	size_t x;
 
 	if (!DEBUG_ATLEAST(1)) {
 		return;
@@ -723,20 +1055,22 @@ void ast_sched_dump(struct ast_sched_context *con)
 	when = ast_tvnow();
 #ifdef SCHED_MAX_CACHE
 	ast_log(LOG_DEBUG, "Asterisk Schedule Dump (%zu in Q, %u Total, %u Cache, %u high-water)\n",
-		ast_heap_size(con->sched_heap), con->eventcnt - 1, con->schedccnt, con->highwater);
+		sched_queue_size(con), con->eventcnt - 1, con->schedccnt, con->highwater);
 #else
 	ast_log(LOG_DEBUG, "Asterisk Schedule Dump (%zu in Q, %u Total, %u high-water)\n",
-		ast_heap_size(con->sched_heap), con->eventcnt - 1, con->highwater);
+		sched_queue_size(con), con->eventcnt - 1, con->highwater);
 #endif
 
 	ast_log(LOG_DEBUG, "=============================================================\n");
 	ast_log(LOG_DEBUG, "|ID    Callback          Data              Time  (sec:ms)   |\n");
 	ast_log(LOG_DEBUG, "+-----+-----------------+-----------------+-----------------+\n");
 	ast_mutex_lock(&con->lock);
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
+	for (x = 0; x < AST_VECTOR_SIZE(&con->sched_by_id); x++) {
 		struct timeval delta;
-		q = ast_heap_peek(con->sched_heap, x);
+		q = AST_VECTOR_GET(&con->sched_by_id, x);
+		if (!q) {
+			continue;
+		}
 		delta = ast_tvsub(q->when, when);
 		ast_log(LOG_DEBUG, "|%.4d | %-15p | %-15p | %.6ld : %.6ld |\n",
 			q->sched_id->id,
@@ -764,7 +1098,7 @@ int ast_sched_runq(struct ast_sched_context *con)
 	ast_mutex_lock(&con->lock);
 
 	when = ast_tvadd(ast_tvnow(), ast_tv(0, 1000));
-	for (numevents = 0; (current = ast_heap_peek(con->sched_heap, 1)); numevents++) {
+	for (numevents = 0; (current = sched_queue_peek(con, when)); numevents++) {
 		/* schedule all events which are going to expire within 1ms.
 		 * We only care about millisecond accuracy anyway, so this will
 		 * help us get more than one event at one time if they are very
@@ -774,7 +1108,7 @@ int ast_sched_runq(struct ast_sched_context *con)
 			break;
 		}
 
-		current = ast_heap_pop(con->sched_heap);
+		sched_queue_remove(con, current);
 
 		/*
 		 * At this point, the schedule queue is still intact.  We
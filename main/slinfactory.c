@@ -36,17 +36,18 @@
 #include "asterisk/translate.h"
 #include "asterisk/astobj2.h"
 
+/*! \brief Samples the ring of a slinfactory starts out holding */
+#define SLINFACTORY_MIN_RING 1024
+
 void ast_slinfactory_init(struct ast_slinfactory *sf)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	sf->output_format = ao2_bump(ast_format_slin);
 }
 
 int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_format *slin_out)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	if (!ast_format_cache_is_slinear(slin_out)) {
 		return -1;
 	}
@@ -57,16 +58,14 @@ int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_form
 
 void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 {
-	struct ast_frame *f;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((f = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-		ast_frfree(f);
-	}
+	ast_free(sf->ring);
+	sf->ring = NULL;
+	sf->ring_size = sf->head = sf->size = 0;
 
 	ao2_cleanup(sf->output_format);
 	sf->output_format = NULL;
@@ -74,10 +73,84 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 	sf->format = NULL;
 }
 
+/*!
+ * \internal
+ * \brief Make room in the ring for a number of samples
+ *
+ * \details The ring is doubled until they fit, up to AST_SLINFACTORY_MAX_SAMPLES,
+ * past which the oldest samples are dropped.
+ */
+static void slinfactory_reserve(struct ast_slinfactory *sf, unsigned int samples)
+{
+	unsigned int needed = sf->size + samples;
+	unsigned int ring_size = sf->ring_size ?: SLINFACTORY_MIN_RING;
+	short *ring;
+
+	while (ring_size < needed && ring_size < AST_SLINFACTORY_MAX_SAMPLES) {
+		ring_size <<= 1;
+	}
+
+	if (ring_size != sf->ring_size && (ring = ast_malloc(ring_size * sizeof(*ring)))) {
+		unsigned int first = MIN(sf->size, sf->ring_size - sf->head);
+
+		if (sf->size) {
+			memcpy(ring, sf->ring + sf->head, first * sizeof(*ring));
+			memcpy(ring + first, sf->ring, (sf->size - first) * sizeof(*ring));
+		}
+		ast_free(sf->ring);
+		sf->ring = ring;
+		sf->ring_size = ring_size;
+		sf->head = 0;
+	}
+
+	if (needed > sf->ring_size) {
+		unsigned int dropped = MIN(needed - sf->ring_size, sf->size);
+
+		sf->head = (sf->head + dropped) & (sf->ring_size - 1);
+		sf->size -= dropped;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Copy the samples of a frame to the end of the ring
+ *
+ * \return Number of samples copied
+ */
+static unsigned int slinfactory_write(struct ast_slinfactory *sf, const struct ast_frame *f)
+{
+	const short *data = f->data.ptr;
+	unsigned int samples = MIN(f->samples, f->datalen / sizeof(*data));
+	unsigned int tail;
+	unsigned int first;
+
+	if (!data || !samples) {
+		return 0;
+	}
+
+	slinfactory_reserve(sf, samples);
+	if (!sf->ring) {
+		return 0;
+	}
+	if (samples > sf->ring_size) {
+		/* Only the newest samples fit */
+		data += samples - sf->ring_size;
+		samples = sf->ring_size;
+	}
+
+	tail = (sf->head + sf->size) & (sf->ring_size - 1);
+	first = MIN(samples, sf->ring_size - tail);
+	memcpy(sf->ring + tail, data, first * sizeof(*data));
+	memcpy(sf->ring, data + first, (samples - first) * sizeof(*data));
+	sf->size += samples;
+
+	return samples;
+}
+
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 {
-	struct ast_frame *begin_frame = f, *duped_frame = NULL, *frame_ptr;
-	unsigned int x = 0;
+	struct ast_frame *begin_frame, *frame_ptr;
+	unsigned int fed = 0;
 
 	/* In some cases, we can be passed a frame which has no data in it, but
 	 * which has a positive number of samples defined. Once such situation is
@@ -111,88 +184,41 @@ int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 			return 0;
 		}
 
-		if (!(duped_frame = ast_frisolate(begin_frame))) {
-			return 0;
-		}
-
-		if (duped_frame != begin_frame) {
-			ast_frfree(begin_frame);
+		/* if the frame was translated, the translator may have returned multiple
+		   frames, so process each of them
+		*/
+		for (frame_ptr = begin_frame; frame_ptr; frame_ptr = AST_LIST_NEXT(frame_ptr, frame_list)) {
+			fed += slinfactory_write(sf, frame_ptr);
 		}
+		ast_frfree(begin_frame);
 	} else {
 		if (sf->trans) {
 			ast_translator_free_path(sf->trans);
 			sf->trans = NULL;
 		}
-		if (!(duped_frame = ast_frdup(f)))
-			return 0;
-	}
-
-	AST_LIST_TRAVERSE(&sf->queue, frame_ptr, frame_list) {
-		x++;
-	}
-
-	/* if the frame was translated, the translator may have returned multiple
-	   frames, so process each of them
-	*/
-	for (begin_frame = duped_frame; begin_frame; begin_frame = AST_LIST_NEXT(begin_frame, frame_list)) {
-		AST_LIST_INSERT_TAIL(&sf->queue, begin_frame, frame_list);
-		sf->size += begin_frame->samples;
+		fed = slinfactory_write(sf, f);
 	}
 
-	return x;
+	return fed;
 }
 
 int ast_slinfactory_read(struct ast_slinfactory *sf, short *buf, size_t samples)
 {
-	struct ast_frame *frame_ptr;
-	unsigned int sofar = 0, ineed, remain;
-	short *frame_data, *offset = buf;
-
-	while (sofar < samples) {
-		ineed = samples - sofar;
-
-		if (sf->holdlen) {
-			if (sf->holdlen <= ineed) {
-				memcpy(offset, sf->offset, sf->holdlen * sizeof(*offset));
-				sofar += sf->holdlen;
-				offset += sf->holdlen;
-				sf->holdlen = 0;
-				sf->offset = sf->hold;
-			} else {
-				remain = sf->holdlen - ineed;
-				memcpy(offset, sf->offset, ineed * sizeof(*offset));
-				sofar += ineed;
-				sf->offset += ineed;
-				sf->holdlen = remain;
-			}
-			continue;
-		}
+	unsigned int sofar = MIN(samples, sf->size);
+	unsigned int first;
 
-		if ((frame_ptr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-			frame_data = frame_ptr->data.ptr;
-
-			if (frame_ptr->samples <= ineed) {
-				memcpy(offset, frame_data, frame_ptr->samples * sizeof(*offset));
-				sofar += frame_ptr->samples;
-				offset += frame_ptr->samples;
-			} else {
-				remain = frame_ptr->samples - ineed;
-				memcpy(offset, frame_data, ineed * sizeof(*offset));
-				sofar += ineed;
-				frame_data += ineed;
-				if (remain > (AST_SLINFACTORY_MAX_HOLD - sf->holdlen)) {
-					remain = AST_SLINFACTORY_MAX_HOLD - sf->holdlen;
-				}
-				memcpy(sf->hold, frame_data, remain * sizeof(*offset));
-				sf->holdlen = remain;
-			}
-			ast_frfree(frame_ptr);
-		} else {
-			break;
-		}
+	if (!sofar) {
+		return 0;
 	}
 
+	first = MIN(sofar, sf->ring_size - sf->head);
+	memcpy(buf, sf->ring + sf->head, first * sizeof(*buf));
+	memcpy(buf + first, sf->ring, (sofar - first) * sizeof(*buf));
+
 	sf->size -= sofar;
+	/* Start over at the front once empty, so reads stay contiguous */
+	sf->head = sf->size ? (sf->head + sofar) & (sf->ring_size - 1) : 0;
+
 	return sofar;
 }
 
@@ -203,18 +229,13 @@ unsigned int ast_slinfactory_available(const struct ast_slinfactory *sf)
 
 void ast_slinfactory_flush(struct ast_slinfactory *sf)
 {
-	struct ast_frame *fr = NULL;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((fr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list)))
-		ast_frfree(fr);
-
-	sf->size = sf->holdlen = 0;
-	sf->offset = sf->hold;
+	/* The ring is kept for the audio fed next */
+	sf->size = sf->head = 0;
 
 	return;
 }
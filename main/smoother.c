@@ -38,7 +38,11 @@
 #include "asterisk/codec.h"
 #include "asterisk/smoother.h"
 
-#define SMOOTHER_SIZE 8000
+/*! \brief Size of the ring of data, a power of two */
+#define SMOOTHER_SIZE 8192
+
+/*! \brief The data in the ring, after the room for the offset of a frame read from its start */
+#define SMOOTHER_RING(s) ((s)->ring + AST_FRIENDLY_OFFSET)
 
 struct ast_smoother {
 	int size;
@@ -48,12 +52,31 @@ struct ast_smoother {
 	unsigned int opt_needs_swap:1;
 	struct ast_frame f;
 	struct timeval delivery;
-	char data[SMOOTHER_SIZE];
+	/*! Ring of the data, frames are read from in place where contiguous */
+	char ring[AST_FRIENDLY_OFFSET + SMOOTHER_SIZE];
+	/*! Where a frame wrapped around the ring is copied to */
 	char framedata[SMOOTHER_SIZE + AST_FRIENDLY_OFFSET];
 	struct ast_frame *opt;
 	int len;
+	/*! Index in the ring of the first byte of data */
+	int head;
 };
 
+/*! \brief Copy data to the end of the ring, which has room for it */
+static void smoother_ring_write(struct ast_smoother *s, const char *data, int len, int swap)
+{
+	int tail = (s->head + s->len) & (SMOOTHER_SIZE - 1);
+	int first = MIN(len, SMOOTHER_SIZE - tail);
+
+	if (swap) {
+		ast_swapcopy_samples(SMOOTHER_RING(s) + tail, data, first / 2);
+		ast_swapcopy_samples(SMOOTHER_RING(s), data + first, (len - first) / 2);
+	} else {
+		memcpy(SMOOTHER_RING(s) + tail, data, first);
+		memcpy(SMOOTHER_RING(s), data + first, len - first);
+	}
+}
+
 static int smoother_frame_feed(struct ast_smoother *s, struct ast_frame *f, int swap)
 {
 	if (s->flags & AST_SMOOTHER_FLAG_G729) {
@@ -62,11 +85,7 @@ static int smoother_frame_feed(struct ast_smoother *s, struct ast_frame *f, int
 			return 0;
 		}
 	}
-	if (swap) {
-		ast_swapcopy_samples(s->data + s->len, f->data.ptr, f->samples);
-	} else {
-		memcpy(s->data + s->len, f->data.ptr, f->datalen);
-	}
+	smoother_ring_write(s, f->data.ptr, f->datalen, swap);
 	/* If either side is empty, reset the delivery time */
 	if (!s->len || ast_tvzero(f->delivery) || ast_tvzero(s->delivery)) {	/* XXX really ? */
 		s->delivery = f->delivery;
@@ -193,20 +212,33 @@ struct ast_frame *ast_smoother_read(struct ast_smoother *s)
 	/* Make frame */
 	s->f.frametype = AST_FRAME_VOICE;
 	s->f.subclass.format = s->format;
-	s->f.data.ptr = s->framedata + AST_FRIENDLY_OFFSET;
 	s->f.offset = AST_FRIENDLY_OFFSET;
 	s->f.datalen = len;
 	/* Samples will be improper given VAD, but with VAD the concept really doesn't even exist */
 	s->f.samples = len * s->samplesperbyte;	/* XXX rounding */
 	s->f.delivery = s->delivery;
-	/* Fill Data */
-	memcpy(s->f.data.ptr, s->data, len);
+	/*
+	 * Point into the ring if the data is contiguous, and the room for the
+	 * offset before it holds no data.  It stays put until the next feed.
+	 */
+	if (s->head + len <= SMOOTHER_SIZE
+		&& SMOOTHER_SIZE - s->len >= MIN(AST_FRIENDLY_OFFSET, s->head)) {
+		s->f.data.ptr = SMOOTHER_RING(s) + s->head;
+	} else {
+		int first = MIN(len, SMOOTHER_SIZE - s->head);
+
+		s->f.data.ptr = s->framedata + AST_FRIENDLY_OFFSET;
+		memcpy(s->f.data.ptr, SMOOTHER_RING(s) + s->head, first);
+		memcpy((char *) s->f.data.ptr + first, SMOOTHER_RING(s), len - first);
+	}
+	s->head = (s->head + len) & (SMOOTHER_SIZE - 1);
 	s->len -= len;
-	/* Move remaining data to the front if applicable */
-	if (s->len) {
+	if (!s->len) {
+		/* Start over at the front, so the next frame is contiguous */
+		s->head = 0;
+	} else {
 		/* In principle this should all be fine because if we are sending
 		   G.729 VAD, the next timestamp will take over anyawy */
-		memmove(s->data, s->data + len, s->len);
 		if (!ast_tvzero(s->delivery)) {
 			/* If we have delivery time, increment it, otherwise, leave it at 0 */
 			s->delivery = ast_tvadd(s->delivery, ast_samp2tv(s->f.samples,
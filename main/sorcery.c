@@ -212,6 +212,9 @@ struct ast_sorcery_object_field {
 	/*! \brief Callback function for translation of multiple values */
 	sorcery_fields_handler multiple_handler;
 
+	/*! \brief Set if objects are commonly retrieved by the value of the field */
+	unsigned int indexed:1;
+
 	/*! \brief Position of the field */
 	intptr_t args[];
 };
@@ -1236,6 +1239,45 @@ int __ast_sorcery_object_field_register(struct ast_sorcery *sorcery, const char
 	return 0;
 }
 
+int ast_sorcery_object_field_index(struct ast_sorcery *sorcery, const char *type, const char *name)
+{
+	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
+	struct ast_sorcery_object_field *object_field;
+
+	if (!object_type) {
+		return -1;
+	}
+
+	object_field = ao2_find(object_type->fields, name, OBJ_SEARCH_KEY);
+	if (!object_field) {
+		return -1;
+	}
+	object_field->indexed = 1;
+	ao2_ref(object_field, -1);
+
+	return 0;
+}
+
+int ast_sorcery_object_field_is_indexed(const struct ast_sorcery *sorcery, const char *type, const char *name)
+{
+	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
+	struct ast_sorcery_object_field *object_field;
+	int indexed;
+
+	if (!object_type) {
+		return 0;
+	}
+
+	object_field = ao2_find(object_type->fields, name, OBJ_SEARCH_KEY);
+	if (!object_field) {
+		return 0;
+	}
+	indexed = object_field->indexed;
+	ao2_ref(object_field, -1);
+
+	return indexed;
+}
+
 /*! \brief Retrieves whether or not the type is reloadable */
 static int sorcery_reloadable(const struct ast_sorcery *sorcery, const char *type)
 {
@@ -1515,6 +1557,123 @@ struct ast_variable *ast_sorcery_objectset_create2(const struct ast_sorcery *sor
 	return head;
 }
 
+/*! \brief A condition of a fields matcher */
+struct sorcery_fields_condition {
+	/*! \brief The requested field, named "name" or "name operator" */
+	const struct ast_variable *field;
+	/*! \brief The operator of the field, NULL for the default comparison */
+	const char *op;
+	/*! \brief The object field whose handler provides the value */
+	struct ast_sorcery_object_field *object_field;
+};
+
+/*! \brief Structure for a fields matcher */
+struct ast_sorcery_fields_matcher {
+	/*! \brief Pointer to the sorcery structure */
+	const struct ast_sorcery *sorcery;
+	/*! \brief The requested fields */
+	const struct ast_variable *fields;
+	/*! \brief Whether the whole object set is needed to compare the fields */
+	unsigned int objectset:1;
+	/*! \brief Number of conditions */
+	size_t count;
+	/*! \brief The fields resolved to the object fields providing them */
+	struct sorcery_fields_condition conditions[0];
+};
+
+struct ast_sorcery_fields_matcher *ast_sorcery_fields_matcher_create(const struct ast_sorcery *sorcery,
+	const char *type, const struct ast_variable *fields)
+{
+	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
+	struct ast_sorcery_fields_matcher *matcher;
+	const struct ast_variable *field;
+	size_t count = 0;
+
+	if (!object_type) {
+		return NULL;
+	}
+
+	for (field = fields; field; field = field->next) {
+		++count;
+	}
+
+	matcher = ast_calloc(1, sizeof(*matcher) + count * sizeof(matcher->conditions[0]));
+	if (!matcher) {
+		return NULL;
+	}
+	matcher->sorcery = sorcery;
+	matcher->fields = fields;
+	matcher->count = count;
+
+	for (count = 0, field = fields; field; field = field->next, ++count) {
+		struct sorcery_fields_condition *condition = &matcher->conditions[count];
+		const char *space = strrchr(field->name, ' ');
+		char *name = ast_strdupa(field->name);
+
+		if (space) {
+			name[space - field->name] = '\0';
+			condition->op = space + 1;
+		}
+		condition->field = field;
+
+		/* Only a field with a single value can be converted by itself, anything
+		 * else is compared against the whole object set as it always was. */
+		condition->object_field = ao2_find(object_type->fields, name, OBJ_SEARCH_KEY);
+		if (!condition->object_field || !condition->object_field->handler
+			|| condition->object_field->multiple_handler) {
+			matcher->objectset = 1;
+		}
+	}
+
+	return matcher;
+}
+
+int ast_sorcery_fields_matcher_match(const struct ast_sorcery_fields_matcher *matcher, const void *object)
+{
+	size_t idx;
+
+	if (matcher->objectset) {
+		struct ast_variable *objset = ast_sorcery_objectset_create(matcher->sorcery, object);
+		int res = objset && ast_variable_lists_match(objset, matcher->fields, 0);
+
+		ast_variables_destroy(objset);
+		return res;
+	}
+
+	for (idx = 0; idx < matcher->count; ++idx) {
+		const struct sorcery_fields_condition *condition = &matcher->conditions[idx];
+		char *buf = NULL;
+		int res;
+
+		if (condition->object_field->handler(object, condition->object_field->args, &buf)) {
+			ast_free(buf);
+			return 0;
+		}
+
+		res = ast_strings_match(S_OR(buf, ""), condition->op, condition->field->value);
+		ast_free(buf);
+		if (!res) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+void ast_sorcery_fields_matcher_destroy(struct ast_sorcery_fields_matcher *matcher)
+{
+	size_t idx;
+
+	if (!matcher) {
+		return;
+	}
+
+	for (idx = 0; idx < matcher->count; ++idx) {
+		ao2_cleanup(matcher->conditions[idx].object_field);
+	}
+	ast_free(matcher);
+}
+
 struct ast_json *ast_sorcery_objectset_json_create(const struct ast_sorcery *sorcery, const void *object)
 {
 	const struct ast_sorcery_object_details *details = object;
@@ -1803,12 +1962,24 @@ static int sorcery_cache_create(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*! \brief Internal function used to inform caching wizards an object was not retrieved */
+static void sorcery_cache_missed(const struct ast_sorcery_object_wizard *object_wizard,
+	const struct ast_sorcery *sorcery, const char *type, const char *id)
+{
+	if (!object_wizard->caching || !object_wizard->wizard->callbacks.retrieve_id_missed) {
+		return;
+	}
+
+	object_wizard->wizard->callbacks.retrieve_id_missed(sorcery, object_wizard->data, type, id);
+}
+
 void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *type, const char *id)
 {
 	struct ast_sorcery_object_type *object_type;
 	void *object = NULL;
 	int i;
 	unsigned int cached = 0;
+	int missing = 0;
 
 	if (ast_strlen_zero(id)) {
 		return NULL;
@@ -1826,6 +1997,12 @@ void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *
 
 		if (wizard->wizard->callbacks.retrieve_id &&
 			!(object = wizard->wizard->callbacks.retrieve_id(sorcery, wizard->data, object_type->name, id))) {
+			/* A cache may know the object does not exist, sparing the other wizards */
+			if (wizard->caching && wizard->wizard->callbacks.is_missing
+				&& wizard->wizard->callbacks.is_missing(sorcery, wizard->data, object_type->name, id)) {
+				missing = 1;
+				break;
+			}
 			continue;
 		}
 
@@ -1840,6 +2017,10 @@ void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *
 		};
 
 		AST_VECTOR_CALLBACK(&object_type->wizards, sorcery_cache_create, NULL, &sdetails, 0);
+	} else if (!object && !missing) {
+		/* Missing according to a cache is not news, so its expiration stays */
+		AST_VECTOR_CALLBACK_VOID(&object_type->wizards, sorcery_cache_missed, sorcery,
+			object_type->name, id);
 	}
 	AST_VECTOR_RW_UNLOCK(&object_type->wizards);
 
@@ -364,10 +364,27 @@ struct stasis_topic_statistics {
 };
 #endif
 
+AST_VECTOR(stasis_subscription_vector, struct stasis_subscription *);
+
+/*! \internal \brief The subscribers of a topic that accept a message type */
+struct topic_type_subscribers {
+	/*! The subscribers, borrowed from the topic */
+	struct stasis_subscription_vector subscribers;
+	/*! Set if all of them have a mailbox */
+	int all_mailboxes;
+};
+
 /*! \internal */
 struct stasis_topic {
 	/*! Variable length array of the subscribers */
-	AST_VECTOR(, struct stasis_subscription *) subscribers;
+	struct stasis_subscription_vector subscribers;
+
+	/*!
+	 * The subscribers accepting each message type, by type id. Built
+	 * when a type is first published and dropped whenever the
+	 * subscribers or their filters change.
+	 */
+	AST_VECTOR(, struct topic_type_subscribers *) type_subscribers;
 
 	/*! Topics forwarding into this topic */
 	AST_VECTOR(, struct stasis_topic *) upstream_topics;
@@ -376,6 +393,9 @@ struct stasis_topic {
 	struct stasis_topic_statistics *statistics;
 #endif
 
+	/*! Messages published or forwarded to this topic, see stasis_metrics_collect() */
+	uint64_t published;
+
 	/*! Unique incrementing integer for subscriber ids */
 	int subscriber_id;
 
@@ -418,6 +438,45 @@ static int topic_add_subscription(struct stasis_topic *topic,
 
 static int topic_remove_subscription(struct stasis_topic *topic, struct stasis_subscription *sub);
 
+static void topic_type_subscribers_free(struct topic_type_subscribers *entry)
+{
+	if (entry) {
+		AST_VECTOR_FREE(&entry->subscribers);
+		ast_free(entry);
+	}
+}
+
+/*!
+ * \internal \brief Forget which subscribers accept which message types
+ * \note The topic must be locked.
+ */
+static void topic_type_subscribers_reset(struct stasis_topic *topic)
+{
+	AST_VECTOR_RESET(&topic->type_subscribers, topic_type_subscribers_free);
+}
+
+/*!
+ * \internal \brief A subscriber of a topic changed its filters
+ *
+ * The subscriber is also subscribed to the topics forwarding into the
+ * topic, so those forget about it too.
+ *
+ * \note The topic must be locked.
+ */
+static void topic_filters_changed(struct stasis_topic *topic)
+{
+	size_t idx;
+
+	topic_type_subscribers_reset(topic);
+	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->upstream_topics); ++idx) {
+		struct stasis_topic *upstream = AST_VECTOR_GET(&topic->upstream_topics, idx);
+
+		ao2_lock(upstream);
+		topic_filters_changed(upstream);
+		ao2_unlock(upstream);
+	}
+}
+
 /*! \brief Lock two topics. */
 #define topic_lock_both(topic1, topic2) \
 	do { \
@@ -443,6 +502,8 @@ static void topic_dtor(void *obj)
 
 	AST_VECTOR_FREE(&topic->subscribers);
 	AST_VECTOR_FREE(&topic->upstream_topics);
+	AST_VECTOR_CALLBACK_VOID(&topic->type_subscribers, topic_type_subscribers_free);
+	AST_VECTOR_FREE(&topic->type_subscribers);
 	ast_debug(1, "Topic '%s': %p destroyed\n", topic->name, topic);
 
 #ifdef AST_DEVMODE
@@ -585,6 +646,7 @@ struct stasis_topic *stasis_topic_create_with_detail(
 
 	res |= AST_VECTOR_INIT(&topic->subscribers, INITIAL_SUBSCRIBERS_MAX);
 	res |= AST_VECTOR_INIT(&topic->upstream_topics, 0);
+	res |= AST_VECTOR_INIT(&topic->type_subscribers, 0);
 	if (res) {
 		ao2_ref(topic, -1);
 		return NULL;
@@ -699,12 +761,45 @@ struct stasis_subscription {
 	/*! The message filter currently in use */
 	enum stasis_subscription_message_filter filter;
 
+	/*! Messages dispatched to the callback, see stasis_metrics_collect() */
+	uint64_t dispatched;
+	/*! Latency samples taken */
+	uint64_t latency_samples;
+	/*! Sum of the latency samples, in microseconds */
+	int64_t latency_sum;
+	/*! Latency samples in each bucket */
+	uint64_t latency_buckets[STASIS_LATENCY_BUCKETS];
+
 #ifdef AST_DEVMODE
 	/*! Statistics information */
 	struct stasis_subscription_statistics *statistics;
 #endif
 };
 
+const long stasis_latency_bounds[STASIS_LATENCY_BUCKETS - 1] = {
+	100, 1000, 10000, 100000, 1000000,
+};
+
+/*!
+ * \internal
+ * \brief Account for the latency of a message dispatched to a subscription
+ */
+static void subscription_latency_sample(struct stasis_subscription *sub,
+	struct stasis_message *message)
+{
+	int64_t latency = ast_tvdiff_us(ast_tvnow(), *stasis_message_timestamp(message));
+	int bucket;
+
+	for (bucket = 0; bucket < STASIS_LATENCY_BUCKETS - 1; ++bucket) {
+		if (latency <= stasis_latency_bounds[bucket]) {
+			break;
+		}
+	}
+	ast_atomic_fetch_add(&sub->latency_buckets[bucket], 1, __ATOMIC_RELAXED);
+	ast_atomic_fetch_add(&sub->latency_sum, latency, __ATOMIC_RELAXED);
+	ast_atomic_fetch_add(&sub->latency_samples, 1, __ATOMIC_RELAXED);
+}
+
 static void subscription_dtor(void *obj)
 {
 	struct stasis_subscription *sub = obj;
@@ -751,6 +846,7 @@ static void subscription_invoke(struct stasis_subscription *sub,
 {
 	unsigned int final = stasis_subscription_final_message(sub, message);
 	int message_type_id = stasis_message_type_id(stasis_subscription_change_type());
+	int sample = !(ast_atomic_fetch_add(&sub->dispatched, 1, __ATOMIC_RELAXED) % STASIS_LATENCY_SAMPLE_RATE);
 #ifdef AST_DEVMODE
 	struct timeval start;
 	long elapsed;
@@ -776,6 +872,10 @@ static void subscription_invoke(struct stasis_subscription *sub,
 		sub->callback(sub->data, sub, message);
 	}
 
+	if (sample) {
+		subscription_latency_sample(sub, message);
+	}
+
 	/* Notify that the final message has been processed */
 	if (final) {
 		ao2_lock(sub);
@@ -798,6 +898,86 @@ static void subscription_invoke(struct stasis_subscription *sub,
 #endif
 }
 
+/*!
+ * \internal
+ * \brief Report the metrics of a topic and of its own subscriptions
+ */
+static void topic_metrics_collect(struct stasis_topic *topic,
+	stasis_topic_metrics_cb topic_cb,
+	stasis_subscription_metrics_cb subscription_cb, void *data)
+{
+	struct stasis_topic_metrics metrics = {
+		.name = topic->name,
+	};
+	size_t idx;
+
+	ao2_lock(topic);
+	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->subscribers); ++idx) {
+		if (AST_VECTOR_GET(&topic->subscribers, idx)->topic == topic) {
+			++metrics.subscriptions;
+		}
+	}
+	if (!metrics.subscriptions) {
+		/* Only forwarded into other topics, which account for its messages */
+		ao2_unlock(topic);
+		return;
+	}
+	metrics.published = topic->published;
+	if (topic_cb) {
+		topic_cb(&metrics, data);
+	}
+
+	for (idx = 0; subscription_cb && idx < AST_VECTOR_SIZE(&topic->subscribers); ++idx) {
+		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, idx);
+		struct stasis_subscription_metrics sub_metrics = {
+			.uniqueid = sub->uniqueid,
+			.topic = topic->name,
+			.dispatched = sub->dispatched,
+			.queued = sub->mailbox ? ast_taskprocessor_size(sub->mailbox) : 0,
+			.samples = sub->latency_samples,
+			.latency_sum = sub->latency_sum,
+		};
+		int bucket;
+
+		if (sub->topic != topic) {
+			continue;
+		}
+		for (bucket = 0; bucket < STASIS_LATENCY_BUCKETS; ++bucket) {
+			sub_metrics.latency_buckets[bucket] = sub->latency_buckets[bucket];
+		}
+		subscription_cb(&sub_metrics, data);
+	}
+	ao2_unlock(topic);
+}
+
+void stasis_metrics_collect(stasis_topic_metrics_cb topic_cb,
+	stasis_subscription_metrics_cb subscription_cb, void *data)
+{
+	struct ao2_container *tmp_container;
+	struct ao2_iterator iter;
+	struct topic_proxy *proxy;
+
+	tmp_container = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		topic_proxy_sort_fn, NULL);
+	if (!tmp_container || ao2_container_dup(tmp_container, topic_all, OBJ_SEARCH_OBJECT)) {
+		ao2_cleanup(tmp_container);
+		return;
+	}
+
+	iter = ao2_iterator_init(tmp_container, AO2_ITERATOR_UNLINK);
+	while ((proxy = ao2_iterator_next(&iter))) {
+		struct stasis_topic *topic = ao2_weakproxy_get_object(proxy, 0);
+
+		if (topic) {
+			topic_metrics_collect(topic, topic_cb, subscription_cb, data);
+			ao2_ref(topic, -1);
+		}
+		ao2_ref(proxy, -1);
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_cleanup(tmp_container);
+}
+
 static void send_subscription_subscribe(struct stasis_topic *topic, struct stasis_subscription *sub);
 static void send_subscription_unsubscribe(struct stasis_topic *topic, struct stasis_subscription *sub);
 
@@ -1029,7 +1209,10 @@ int stasis_subscription_accept_message_type(struct stasis_subscription *subscrip
 		/* Filtering is unreliable as this message type is not yet initialized
 		 * so force all messages through.
 		 */
+		ao2_lock(subscription->topic);
 		subscription->filter = STASIS_SUBSCRIPTION_FILTER_FORCED_NONE;
+		topic_filters_changed(subscription->topic);
+		ao2_unlock(subscription->topic);
 		return 0;
 	}
 
@@ -1040,6 +1223,7 @@ int stasis_subscription_accept_message_type(struct stasis_subscription *subscrip
 		 */
 		subscription->filter = STASIS_SUBSCRIPTION_FILTER_FORCED_NONE;
 	}
+	topic_filters_changed(subscription->topic);
 	ao2_unlock(subscription->topic);
 
 	return 0;
@@ -1064,6 +1248,7 @@ int stasis_subscription_decline_message_type(struct stasis_subscription *subscri
 		/* The memory is already allocated so this can't fail */
 		AST_VECTOR_REPLACE(&subscription->accepted_message_types, stasis_message_type_id(type), 0);
 	}
+	topic_filters_changed(subscription->topic);
 	ao2_unlock(subscription->topic);
 
 	return 0;
@@ -1080,6 +1265,7 @@ int stasis_subscription_set_filter(struct stasis_subscription *subscription,
 	if (subscription->filter != STASIS_SUBSCRIPTION_FILTER_FORCED_NONE) {
 		subscription->filter = filter;
 	}
+	topic_filters_changed(subscription->topic);
 	ao2_unlock(subscription->topic);
 
 	return 0;
@@ -1092,6 +1278,7 @@ void stasis_subscription_accept_formatters(struct stasis_subscription *subscript
 
 	ao2_lock(subscription->topic);
 	subscription->accepted_formatters = formatters;
+	topic_filters_changed(subscription->topic);
 	ao2_unlock(subscription->topic);
 
 	return;
@@ -1205,6 +1392,7 @@ static int topic_add_subscription(struct stasis_topic *topic, struct stasis_subs
 	 * If we bumped the refcount here, the owner would have to unsubscribe
 	 * and cleanup, which is a bit awkward. */
 	AST_VECTOR_APPEND(&topic->subscribers, sub);
+	topic_type_subscribers_reset(topic);
 
 	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->upstream_topics); ++idx) {
 		topic_add_subscription(
@@ -1233,6 +1421,7 @@ static int topic_remove_subscription(struct stasis_topic *topic, struct stasis_s
 	}
 	res = AST_VECTOR_REMOVE_ELEM_UNORDERED(&topic->subscribers, sub,
 		AST_VECTOR_ELEM_CLEANUP_NOOP);
+	topic_type_subscribers_reset(topic);
 
 #ifdef AST_DEVMODE
 	if (!res) {
@@ -1296,73 +1485,119 @@ static int dispatch_exec_sync(struct ast_taskprocessor_local *local)
 }
 
 /*!
- * \internal \brief Dispatch a message to a subscriber
- * \param sub The subscriber to dispatch to
- * \param message The message to send
- * \param synchronous If non-zero, synchronize on the subscriber receiving
- * the message
- * \retval 0 if message was not dispatched
- * \retval 1 if message was dispatched
+ * \internal
+ * \brief Whether the filters of a subscription accept a message type
+ *
+ * \note The topic of the subscription must be locked.
  */
-static unsigned int dispatch_message(struct stasis_subscription *sub,
-	struct stasis_message *message,
-	int synchronous)
+static int subscription_accepts_type(const struct stasis_subscription *sub,
+	struct stasis_message_type *message_type)
 {
-	int is_final = stasis_subscription_final_message(sub, message);
+	int type_id = stasis_message_type_id(message_type);
+	int type_filter_specified = sub->filter & STASIS_SUBSCRIPTION_FILTER_SELECTIVE;
+	int formatter_filter_specified = sub->accepted_formatters != STASIS_SUBSCRIPTION_FORMATTER_NONE;
+
+	/* Accept if no filters of either type were specified */
+	if (!type_filter_specified && !formatter_filter_specified) {
+		return 1;
+	}
 
 	/*
-	 * The 'do while' gives us an easy way to skip remaining logic once
-	 * we determine the message should be accepted.
-	 * The code looks more verbose than it needs to be but it optimizes
-	 * down very nicely.  It's just easier to understand and debug this way.
+	 * Since the type and formatter filters are OR'd, we can skip
+	 * the formatter check if the type check passes.
 	 */
-	do {
-		struct stasis_message_type *message_type = stasis_message_type(message);
-		int type_id = stasis_message_type_id(message_type);
-		int type_filter_specified = 0;
-		int formatter_filter_specified = 0;
-		int type_filter_passed = 0;
-		int formatter_filter_passed = 0;
-
-		/* We always accept final messages so only run the filter logic if not final */
-		if (is_final) {
-			break;
-		}
+	if (type_filter_specified
+		&& type_id < AST_VECTOR_SIZE(&sub->accepted_message_types)
+		&& AST_VECTOR_GET(&sub->accepted_message_types, type_id)) {
+		return 1;
+	}
 
-		type_filter_specified = sub->filter & STASIS_SUBSCRIPTION_FILTER_SELECTIVE;
-		formatter_filter_specified = sub->accepted_formatters != STASIS_SUBSCRIPTION_FORMATTER_NONE;
+	return formatter_filter_specified
+		&& (sub->accepted_formatters & stasis_message_type_available_formatters(message_type));
+}
 
-		/* Accept if no filters of either type were specified */
-		if (!type_filter_specified && !formatter_filter_specified) {
-			break;
+/*!
+ * \internal
+ * \brief Get the subscribers of a topic accepting a message type
+ *
+ * The list is built on first use and kept until the subscribers or their
+ * filters change.
+ *
+ * \note The topic must be locked.
+ *
+ * \retval NULL if the list could not be built
+ */
+static struct topic_type_subscribers *topic_type_subscribers_get(struct stasis_topic *topic,
+	struct stasis_message_type *message_type)
+{
+	int type_id = stasis_message_type_id(message_type);
+	struct topic_type_subscribers *entry;
+	size_t idx;
+
+	if (type_id < 0) {
+		return NULL;
+	}
+	if (type_id < AST_VECTOR_SIZE(&topic->type_subscribers)) {
+		entry = AST_VECTOR_GET(&topic->type_subscribers, type_id);
+		if (entry) {
+			return entry;
 		}
+	}
 
-		type_filter_passed = type_filter_specified
-			&& type_id < AST_VECTOR_SIZE(&sub->accepted_message_types)
-			&& AST_VECTOR_GET(&sub->accepted_message_types, type_id);
+	entry = ast_calloc(1, sizeof(*entry));
+	if (!entry) {
+		return NULL;
+	}
+	if (AST_VECTOR_INIT(&entry->subscribers, AST_VECTOR_SIZE(&topic->subscribers))) {
+		ast_free(entry);
+		return NULL;
+	}
+	entry->all_mailboxes = 1;
 
-		/*
-		 * Since the type and formatter filters are OR'd, we can skip
-		 * the formatter check if the type check passes.
-		 */
-		if (type_filter_passed) {
-			break;
+	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->subscribers); ++idx) {
+		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, idx);
+
+		if (!subscription_accepts_type(sub, message_type)) {
+			continue;
+		}
+		if (AST_VECTOR_APPEND(&entry->subscribers, sub)) {
+			topic_type_subscribers_free(entry);
+			return NULL;
 		}
+		if (!sub->mailbox) {
+			entry->all_mailboxes = 0;
+		}
+	}
 
-		formatter_filter_passed = formatter_filter_specified
-			&& (sub->accepted_formatters & stasis_message_type_available_formatters(message_type));
+	if (AST_VECTOR_REPLACE(&topic->type_subscribers, type_id, entry)) {
+		topic_type_subscribers_free(entry);
+		return NULL;
+	}
 
-		if (formatter_filter_passed) {
-			break;
-		}
+	return entry;
+}
 
+/*!
+ * \internal \brief Dispatch a message to a subscriber
+ * \param sub The subscriber to dispatch to
+ * \param message The message to send
+ * \param synchronous If non-zero, synchronize on the subscriber receiving
+ * the message
+ * \retval 0 if message was not dispatched
+ * \retval 1 if message was dispatched
+ */
+static unsigned int dispatch_message(struct stasis_subscription *sub,
+	struct stasis_message *message,
+	int synchronous)
+{
+	/* We always accept final messages so only run the filter logic if not final */
+	if (!stasis_subscription_final_message(sub, message)
+		&& !subscription_accepts_type(sub, stasis_message_type(message))) {
 #ifdef AST_DEVMODE
 		ast_atomic_fetchadd_int(&sub->statistics->messages_dropped, +1);
 #endif
-
 		return 0;
-
-	} while (0);
+	}
 
 #ifdef AST_DEVMODE
 	ast_atomic_fetchadd_int(&sub->statistics->messages_passed, +1);
@@ -1427,6 +1662,9 @@ static void publish_msg(struct stasis_topic *topic,
 {
 	size_t i;
 	unsigned int dispatched = 0;
+	int batch = 0;
+	struct topic_type_subscribers *interested = NULL;
+	struct stasis_subscription_vector *subscribers;
 #ifdef AST_DEVMODE
 	int message_type_id = stasis_message_type_id(stasis_message_type(message));
 	struct stasis_message_type_statistics *statistics;
@@ -1437,6 +1675,8 @@ static void publish_msg(struct stasis_topic *topic,
 	ast_assert(topic != NULL);
 	ast_assert(message != NULL);
 
+	ast_atomic_fetch_add(&topic->published, 1, __ATOMIC_RELAXED);
+
 #ifdef AST_DEVMODE
 	ast_mutex_lock(&message_type_statistics_lock);
 	if (message_type_id >= AST_VECTOR_SIZE(&message_type_statistics)) {
@@ -1473,13 +1713,72 @@ static void publish_msg(struct stasis_topic *topic,
 	start = ast_tvnow();
 #endif
 	ao2_lock(topic);
+	/* The subscribers of the topics it is forwarded to count it once for their topic */
 	for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
-		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
+		struct stasis_topic *to = AST_VECTOR_GET(&topic->subscribers, i)->topic;
+		size_t seen = i;
+
+		if (to == topic) {
+			continue;
+		}
+		while (seen-- > 0 && AST_VECTOR_GET(&topic->subscribers, seen)->topic != to) {
+		}
+		if (seen == (size_t) -1) {
+			ast_atomic_fetch_add(&to->published, 1, __ATOMIC_RELAXED);
+		}
+	}
+	/*
+	 * Only the subscribers accepting the message type are visited, except
+	 * for subscription changes which may be the final message of any of
+	 * them.
+	 */
+	if (stasis_message_type(message) != stasis_subscription_change_type()) {
+		interested = topic_type_subscribers_get(topic, stasis_message_type(message));
+	}
+	subscribers = interested ? &interested->subscribers : &topic->subscribers;
+	if (!sync_sub) {
+		/*
+		 * Scheduling of pooled subscriber mailboxes can be batched as long
+		 * as no subscriber gets invoked directly on this thread, since such
+		 * a subscriber could wait on one of the deferred mailboxes.
+		 */
+		if (interested) {
+			batch = interested->all_mailboxes;
+		} else {
+			batch = 1;
+			for (i = 0; i < AST_VECTOR_SIZE(subscribers); ++i) {
+				if (!AST_VECTOR_GET(subscribers, i)->mailbox) {
+					batch = 0;
+					break;
+				}
+			}
+		}
+	}
+	if (batch) {
+		ast_threadpool_serializer_batch_begin();
+	}
+	for (i = 0; i < AST_VECTOR_SIZE(subscribers); ++i) {
+		struct stasis_subscription *sub = AST_VECTOR_GET(subscribers, i);
 
 		ast_assert(sub != NULL);
 
 		dispatched += dispatch_message(sub, message, (sub == sync_sub));
 	}
+#ifdef AST_DEVMODE
+	if (interested) {
+		/* Account for the subscribers that were skipped */
+		for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
+			struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
+
+			if (!subscription_accepts_type(sub, stasis_message_type(message))) {
+				ast_atomic_fetchadd_int(&sub->statistics->messages_dropped, +1);
+			}
+		}
+	}
+#endif
+	if (batch) {
+		ast_threadpool_serializer_batch_end();
+	}
 	ao2_unlock(topic);
 
 #ifdef AST_DEVMODE
@@ -1971,7 +2270,7 @@ struct ast_multi_object_blob *ast_multi_object_blob_create(struct ast_json *blob
 
 	ast_assert(blob != NULL);
 
-	multi = ao2_alloc(sizeof(*multi), multi_object_blob_dtor);
+	multi = ao2_alloc_options(sizeof(*multi), multi_object_blob_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!multi) {
 		return NULL;
 	}
@@ -419,7 +419,7 @@ static struct ast_bridge_merge_message *bridge_merge_message_create(struct ast_b
 {
 	struct ast_bridge_merge_message *msg;
 
-	msg = ao2_alloc(sizeof(*msg), bridge_merge_message_dtor);
+	msg = ao2_alloc_options(sizeof(*msg), bridge_merge_message_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!msg) {
 		return NULL;
 	}
@@ -510,7 +510,7 @@ struct stasis_message *ast_bridge_blob_create(
 		return NULL;
 	}
 
-	obj = ao2_alloc(sizeof(*obj), bridge_blob_dtor);
+	obj = ao2_alloc_options(sizeof(*obj), bridge_blob_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!obj) {
 		return NULL;
 	}
@@ -556,7 +556,7 @@ struct stasis_message *ast_bridge_blob_create_from_snapshots(
 		return NULL;
 	}
 
-	obj = ao2_alloc(sizeof(*obj), bridge_blob_dtor);
+	obj = ao2_alloc_options(sizeof(*obj), bridge_blob_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!obj) {
 		return NULL;
 	}
@@ -748,6 +748,60 @@ struct ast_json *ast_bridge_snapshot_to_json(
 	return json_bridge;
 }
 
+int ast_bridge_snapshot_to_json_writer(
+	const struct ast_bridge_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize,
+	struct ast_json_writer *writer)
+{
+	char *item;
+	struct ao2_iterator it;
+
+	if (snapshot == NULL) {
+		return -1;
+	}
+
+	/* The same members in the same order as ast_bridge_snapshot_to_json() */
+	ast_json_writer_object_start(writer);
+	ast_json_writer_key(writer, "id");
+	ast_json_writer_string(writer, snapshot->uniqueid);
+	ast_json_writer_key(writer, "technology");
+	ast_json_writer_string(writer, snapshot->technology);
+	ast_json_writer_key(writer, "bridge_type");
+	ast_json_writer_string(writer, capability2str(snapshot->capabilities));
+	ast_json_writer_key(writer, "bridge_class");
+	ast_json_writer_string(writer, snapshot->subclass);
+	ast_json_writer_key(writer, "creator");
+	ast_json_writer_string(writer, snapshot->creator);
+	ast_json_writer_key(writer, "name");
+	ast_json_writer_string(writer, snapshot->name);
+
+	ast_json_writer_key(writer, "channels");
+	ast_json_writer_array_start(writer);
+	for (it = ao2_iterator_init(snapshot->channels, 0);
+		(item = ao2_iterator_next(&it)); ao2_cleanup(item)) {
+		if (sanitize && sanitize->channel_id && sanitize->channel_id(item)) {
+			continue;
+		}
+
+		ast_json_writer_string(writer, item);
+	}
+	ao2_iterator_destroy(&it);
+	ast_json_writer_array_end(writer);
+
+	ast_json_writer_key(writer, "creationtime");
+	ast_json_writer_timeval(writer, snapshot->creationtime, NULL);
+	ast_json_writer_key(writer, "video_mode");
+	ast_json_writer_string(writer, ast_bridge_video_mode_to_string(snapshot->video_mode));
+
+	if (snapshot->video_mode != AST_BRIDGE_VIDEO_MODE_NONE
+		&& !ast_strlen_zero(snapshot->video_source_id)) {
+		ast_json_writer_key(writer, "video_source_id");
+		ast_json_writer_string(writer, snapshot->video_source_id);
+	}
+
+	return ast_json_writer_object_end(writer);
+}
+
 /*!
  * \internal
  * \brief Allocate the fields of an \ref ast_bridge_channel_snapshot_pair.
@@ -931,7 +985,7 @@ struct ast_blind_transfer_message *ast_blind_transfer_message_create(int is_exte
 {
 	struct ast_blind_transfer_message *msg;
 
-	msg = ao2_alloc(sizeof(*msg), blind_transfer_dtor);
+	msg = ao2_alloc_options(sizeof(*msg), blind_transfer_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!msg) {
 		return NULL;
 	}
@@ -1230,7 +1284,8 @@ struct ast_attended_transfer_message *ast_attended_transfer_message_create(int i
 {
 	struct ast_attended_transfer_message *transfer_msg;
 
-	transfer_msg = ao2_alloc(sizeof(*transfer_msg), attended_transfer_dtor);
+	transfer_msg = ao2_alloc_options(sizeof(*transfer_msg), attended_transfer_dtor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!transfer_msg) {
 		return NULL;
 	}
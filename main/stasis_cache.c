@@ -36,15 +36,25 @@
 #include "asterisk/utils.h"
 #include "asterisk/vector.h"
 
+/*!
+ * \brief The number of partitions of the entries of a cache
+ *
+ * Each partition is a container with its own lock, picked by the hash of
+ * the key of an entry, so that a dump of the cache only holds up updates
+ * of the partition it is walking.
+ */
 #ifdef LOW_MEMORY
+#define NUM_CACHE_PARTITIONS 1
 #define NUM_CACHE_BUCKETS 17
 #else
-#define NUM_CACHE_BUCKETS 563
+#define NUM_CACHE_PARTITIONS 16
+/*! The number of buckets of each partition */
+#define NUM_CACHE_BUCKETS 37
 #endif
 
 /*! \internal */
 struct stasis_cache {
-	struct ao2_container *entries;
+	struct ao2_container *entries[NUM_CACHE_PARTITIONS];
 	snapshot_get_id id_fn;
 	cache_aggregate_calc_fn aggregate_calc_fn;
 	cache_aggregate_publish_fn aggregate_publish_fn;
@@ -62,6 +72,7 @@ struct stasis_caching_topic {
 static void stasis_caching_topic_dtor(void *obj)
 {
 	struct stasis_caching_topic *caching_topic = obj;
+	int i;
 
 	/* Caching topics contain subscriptions, and must be manually
 	 * unsubscribed. */
@@ -70,7 +81,13 @@ static void stasis_caching_topic_dtor(void *obj)
 	 * be bad. */
 	ast_assert(stasis_subscription_is_done(caching_topic->sub));
 
-	ao2_container_unregister(stasis_topic_name(caching_topic->topic));
+	for (i = 0; i < NUM_CACHE_PARTITIONS; ++i) {
+		char partition_name[256];
+
+		snprintf(partition_name, sizeof(partition_name), "%s/%d",
+			stasis_topic_name(caching_topic->topic), i);
+		ao2_container_unregister(partition_name);
+	}
 
 	ao2_cleanup(caching_topic->sub);
 	caching_topic->sub = NULL;
@@ -209,6 +226,26 @@ static void cache_entry_compute_hash(struct cache_entry_key *key)
 	key->hash += ast_hashtab_hash_string(key->id);
 }
 
+/*!
+ * \internal
+ * \brief Set up the key of an entry, to find it with
+ */
+static void cache_entry_key_init(struct cache_entry_key *key, struct stasis_message_type *type, const char *id)
+{
+	key->type = type;
+	key->id = id;
+	cache_entry_compute_hash(key);
+}
+
+/*!
+ * \internal
+ * \brief The partition of the entries of a cache an entry is kept in
+ */
+static struct ao2_container *cache_partition(struct stasis_cache *cache, const struct cache_entry_key *key)
+{
+	return cache->entries[key->hash % NUM_CACHE_PARTITIONS];
+}
+
 static struct stasis_cache_entry *cache_entry_create(struct stasis_message_type *type, const char *id, struct stasis_message *snapshot)
 {
 	struct stasis_cache_entry *entry;
@@ -326,9 +363,12 @@ static int cache_entry_cmp(void *obj, void *arg, int flags)
 static void cache_dtor(void *obj)
 {
 	struct stasis_cache *cache = obj;
+	int i;
 
-	ao2_cleanup(cache->entries);
-	cache->entries = NULL;
+	for (i = 0; i < NUM_CACHE_PARTITIONS; ++i) {
+		ao2_cleanup(cache->entries[i]);
+		cache->entries[i] = NULL;
+	}
 }
 
 struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
@@ -336,6 +376,7 @@ struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
 	cache_aggregate_publish_fn aggregate_publish_fn)
 {
 	struct stasis_cache *cache;
+	int i;
 
 	cache = ao2_alloc_options(sizeof(*cache), cache_dtor,
 		AO2_ALLOC_OPT_LOCK_NOLOCK);
@@ -343,11 +384,13 @@ struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
 		return NULL;
 	}
 
-	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
-		NUM_CACHE_BUCKETS, cache_entry_hash, NULL, cache_entry_cmp);
-	if (!cache->entries) {
-		ao2_cleanup(cache);
-		return NULL;
+	for (i = 0; i < NUM_CACHE_PARTITIONS; ++i) {
+		cache->entries[i] = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+			NUM_CACHE_BUCKETS, cache_entry_hash, NULL, cache_entry_cmp);
+		if (!cache->entries[i]) {
+			ao2_cleanup(cache);
+			return NULL;
+		}
 	}
 
 	cache->id_fn = id_fn;
@@ -384,29 +427,24 @@ struct stasis_message *stasis_cache_entry_get_remote(struct stasis_cache_entry *
  * \internal
  * \brief Find the cache entry in the cache entries container.
  *
- * \param entries Container of cached entries.
- * \param type Type of message to retrieve the cache entry.
- * \param id Identity of the snapshot to retrieve the cache entry.
+ * \param entries Partition of cached entries the key falls in.
+ * \param search_key Type and identity of the snapshot to retrieve the cache entry.
  *
  * \note The entries container is already locked.
  *
  * \retval Cache-entry on success.
  * \retval NULL Not in cache.
  */
-static struct stasis_cache_entry *cache_find(struct ao2_container *entries, struct stasis_message_type *type, const char *id)
+static struct stasis_cache_entry *cache_find(struct ao2_container *entries, const struct cache_entry_key *search_key)
 {
-	struct cache_entry_key search_key;
 	struct stasis_cache_entry *entry;
 
-	search_key.type = type;
-	search_key.id = id;
-	cache_entry_compute_hash(&search_key);
-	entry = ao2_find(entries, &search_key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	entry = ao2_find(entries, search_key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
 
 	/* Ensure that what we looked for is what we found. */
 	ast_assert(!entry
 		|| (!strcmp(stasis_message_type_name(entry->key.type),
-			stasis_message_type_name(type)) && !strcmp(entry->key.id, id)));
+			stasis_message_type_name(search_key->type)) && !strcmp(entry->key.id, search_key->id)));
 	return entry;
 }
 
@@ -508,23 +546,28 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 {
 	struct stasis_cache_entry *cached_entry;
 	struct cache_put_snapshots snapshots;
+	struct cache_entry_key search_key;
+	struct ao2_container *entries;
 
-	ast_assert(cache->entries != NULL);
+	ast_assert(cache->entries[0] != NULL);
 	ast_assert(eid != NULL);/* Aggregate snapshots not allowed to be put directly. */
 	ast_assert(new_snapshot == NULL ||
 		type == stasis_message_type(new_snapshot));
 
 	memset(&snapshots, 0, sizeof(snapshots));
 
-	ao2_wrlock(cache->entries);
+	cache_entry_key_init(&search_key, type, id);
+	entries = cache_partition(cache, &search_key);
+
+	ao2_wrlock(entries);
 
-	cached_entry = cache_find(cache->entries, type, id);
+	cached_entry = cache_find(entries, &search_key);
 
 	/* Update the eid snapshot. */
 	if (!new_snapshot) {
 		/* Remove snapshot from cache */
 		if (cached_entry) {
-			snapshots.old = cache_remove(cache->entries, cached_entry, eid);
+			snapshots.old = cache_remove(entries, cached_entry, eid);
 		}
 	} else if (cached_entry) {
 		/* Update snapshot in cache */
@@ -533,7 +576,7 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 		/* Insert into the cache */
 		cached_entry = cache_entry_create(type, id, new_snapshot);
 		if (cached_entry) {
-			ao2_link_flags(cache->entries, cached_entry, OBJ_NOLOCK);
+			ao2_link_flags(entries, cached_entry, OBJ_NOLOCK);
 		}
 	}
 
@@ -544,7 +587,7 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 		cached_entry->aggregate = ao2_bump(snapshots.aggregate_new);
 	}
 
-	ao2_unlock(cache->entries);
+	ao2_unlock(entries);
 
 	ao2_cleanup(cached_entry);
 	return snapshots;
@@ -588,9 +631,11 @@ struct ao2_container *stasis_cache_get_all(struct stasis_cache *cache, struct st
 {
 	struct stasis_cache_entry *cached_entry;
 	struct ao2_container *found;
+	struct cache_entry_key search_key;
+	struct ao2_container *entries;
 
 	ast_assert(cache != NULL);
-	ast_assert(cache->entries != NULL);
+	ast_assert(cache->entries[0] != NULL);
 	ast_assert(id != NULL);
 
 	if (!type) {
@@ -602,15 +647,18 @@ struct ao2_container *stasis_cache_get_all(struct stasis_cache *cache, struct st
 		return NULL;
 	}
 
-	ao2_rdlock(cache->entries);
+	cache_entry_key_init(&search_key, type, id);
+	entries = cache_partition(cache, &search_key);
+
+	ao2_rdlock(entries);
 
-	cached_entry = cache_find(cache->entries, type, id);
+	cached_entry = cache_find(entries, &search_key);
 	if (cached_entry && cache_entry_dump(found, cached_entry)) {
 		ao2_cleanup(found);
 		found = NULL;
 	}
 
-	ao2_unlock(cache->entries);
+	ao2_unlock(entries);
 
 	ao2_cleanup(cached_entry);
 	return found;
@@ -660,24 +708,29 @@ struct stasis_message *stasis_cache_get_by_eid(struct stasis_cache *cache, struc
 {
 	struct stasis_cache_entry *cached_entry;
 	struct stasis_message *snapshot = NULL;
+	struct cache_entry_key search_key;
+	struct ao2_container *entries;
 
 	ast_assert(cache != NULL);
-	ast_assert(cache->entries != NULL);
+	ast_assert(cache->entries[0] != NULL);
 	ast_assert(id != NULL);
 
 	if (!type) {
 		return NULL;
 	}
 
-	ao2_rdlock(cache->entries);
+	cache_entry_key_init(&search_key, type, id);
+	entries = cache_partition(cache, &search_key);
+
+	ao2_rdlock(entries);
 
-	cached_entry = cache_find(cache->entries, type, id);
+	cached_entry = cache_find(entries, &search_key);
 	if (cached_entry) {
 		snapshot = cache_entry_by_eid(cached_entry, eid);
 		ao2_bump(snapshot);
 	}
 
-	ao2_unlock(cache->entries);
+	ao2_unlock(entries);
 
 	ao2_cleanup(cached_entry);
 	return snapshot;
@@ -718,9 +771,10 @@ static int cache_dump_by_eid_cb(void *obj, void *arg, int flags)
 struct ao2_container *stasis_cache_dump_by_eid(struct stasis_cache *cache, struct stasis_message_type *type, const struct ast_eid *eid)
 {
 	struct cache_dump_data cache_dump;
+	int i;
 
 	ast_assert(cache != NULL);
-	ast_assert(cache->entries != NULL);
+	ast_assert(cache->entries[0] != NULL);
 
 	cache_dump.eid = eid;
 	cache_dump.type = type;
@@ -729,7 +783,9 @@ struct ao2_container *stasis_cache_dump_by_eid(struct stasis_cache *cache, struc
 		return NULL;
 	}
 
-	ao2_callback(cache->entries, OBJ_MULTIPLE | OBJ_NODATA, cache_dump_by_eid_cb, &cache_dump);
+	for (i = 0; i < NUM_CACHE_PARTITIONS && cache_dump.container; ++i) {
+		ao2_callback(cache->entries[i], OBJ_MULTIPLE | OBJ_NODATA, cache_dump_by_eid_cb, &cache_dump);
+	}
 	return cache_dump.container;
 }
 
@@ -757,9 +813,10 @@ static int cache_dump_all_cb(void *obj, void *arg, int flags)
 struct ao2_container *stasis_cache_dump_all(struct stasis_cache *cache, struct stasis_message_type *type)
 {
 	struct cache_dump_data cache_dump;
+	int i;
 
 	ast_assert(cache != NULL);
-	ast_assert(cache->entries != NULL);
+	ast_assert(cache->entries[0] != NULL);
 
 	cache_dump.eid = NULL;
 	cache_dump.type = type;
@@ -768,7 +825,9 @@ struct ao2_container *stasis_cache_dump_all(struct stasis_cache *cache, struct s
 		return NULL;
 	}
 
-	ao2_callback(cache->entries, OBJ_MULTIPLE | OBJ_NODATA, cache_dump_all_cb, &cache_dump);
+	for (i = 0; i < NUM_CACHE_PARTITIONS && cache_dump.container; ++i) {
+		ao2_callback(cache->entries[i], OBJ_MULTIPLE | OBJ_NODATA, cache_dump_all_cb, &cache_dump);
+	}
 	return cache_dump.container;
 }
 
@@ -864,14 +923,19 @@ static void caching_topic_exec(void *data, struct stasis_subscription *sub,
 		 */
 		if (strcmp(change->description, "Unsubscribe") == 0) {
 			struct stasis_cache_entry *cached_sub;
+			struct cache_entry_key search_key;
+			struct ao2_container *entries;
 
-			ao2_wrlock(caching_topic->cache->entries);
-			cached_sub = cache_find(caching_topic->cache->entries, stasis_subscription_change_type(), change->uniqueid);
+			cache_entry_key_init(&search_key, stasis_subscription_change_type(), change->uniqueid);
+			entries = cache_partition(caching_topic->cache, &search_key);
+
+			ao2_wrlock(entries);
+			cached_sub = cache_find(entries, &search_key);
 			if (cached_sub) {
-				ao2_cleanup(cache_remove(caching_topic->cache->entries, cached_sub, stasis_message_eid(message)));
+				ao2_cleanup(cache_remove(entries, cached_sub, stasis_message_eid(message)));
 				ao2_cleanup(cached_sub);
 			}
-			ao2_unlock(caching_topic->cache->entries);
+			ao2_unlock(entries);
 			ao2_cleanup(caching_topic_needs_unref);
 			return;
 		}
@@ -976,12 +1040,18 @@ struct stasis_caching_topic *stasis_caching_topic_create(struct stasis_topic *or
 	ao2_ref(cache, +1);
 	caching_topic->cache = cache;
 	if (!cache->registered) {
-		if (ao2_container_register(new_name, cache->entries, print_cache_entry)) {
-			ast_log(LOG_ERROR, "Stasis cache container '%p' for '%s' did not register\n",
-				cache->entries, new_name);
-		} else {
-			cache->registered = 1;
+		int i;
+
+		for (i = 0; i < NUM_CACHE_PARTITIONS; ++i) {
+			char partition_name[256];
+
+			snprintf(partition_name, sizeof(partition_name), "%s/%d", new_name, i);
+			if (ao2_container_register(partition_name, cache->entries[i], print_cache_entry)) {
+				ast_log(LOG_ERROR, "Stasis cache container '%p' for '%s' did not register\n",
+					cache->entries[i], partition_name);
+			}
 		}
+		cache->registered = 1;
 	}
 	ast_free(new_name);
 
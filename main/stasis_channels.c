@@ -355,6 +355,40 @@ static struct ast_channel_snapshot_caller *channel_snapshot_caller_create(struct
 	return snapshot;
 }
 
+/*!
+ * \internal
+ * \brief Determine if the caller segment of a snapshot still matches its channel
+ */
+static int channel_snapshot_caller_matches(struct ast_channel *chan,
+	const struct ast_channel_snapshot_caller *snapshot)
+{
+	struct ast_party_caller *caller = ast_channel_caller(chan);
+	struct ast_party_redirecting *redirecting = ast_channel_redirecting(chan);
+	struct ast_party_dialed *dialed = ast_channel_dialed(chan);
+
+	return snapshot->pres == ast_party_id_presentation(&caller->id)
+		&& !strcmp(snapshot->number, S_COR(caller->id.number.valid, caller->id.number.str, ""))
+		&& !strcmp(snapshot->name, S_COR(caller->id.name.valid, caller->id.name.str, ""))
+		&& !strcmp(snapshot->subaddr, S_COR(caller->id.subaddress.valid, caller->id.subaddress.str, ""))
+		&& !strcmp(snapshot->ani, S_COR(caller->ani.number.valid, caller->ani.number.str, ""))
+		&& !strcmp(snapshot->rdnis, S_COR(redirecting->from.number.valid, redirecting->from.number.str, ""))
+		&& !strcmp(snapshot->dnid, S_OR(dialed->number.str, ""))
+		&& !strcmp(snapshot->dialed_subaddr, S_COR(dialed->subaddress.valid, dialed->subaddress.str, ""));
+}
+
+/*!
+ * \internal
+ * \brief Determine if the connected segment of a snapshot still matches its channel
+ */
+static int channel_snapshot_connected_matches(struct ast_channel *chan,
+	const struct ast_channel_snapshot_connected *snapshot)
+{
+	struct ast_party_connected_line *connected = ast_channel_connected(chan);
+
+	return !strcmp(snapshot->number, S_COR(connected->id.number.valid, connected->id.number.str, ""))
+		&& !strcmp(snapshot->name, S_COR(connected->id.name.valid, connected->id.name.str, ""));
+}
+
 static struct ast_channel_snapshot_connected *channel_snapshot_connected_create(struct ast_channel *chan)
 {
 	const char *name = S_COR(ast_channel_connected(chan)->id.name.valid, ast_channel_connected(chan)->id.name.str, "");
@@ -496,18 +530,27 @@ struct ast_channel_snapshot *ast_channel_snapshot_create(struct ast_channel *cha
 	/* Unfortunately both caller and connected information do not have an enforced contract with
 	 * the channel API. This has allowed consumers to directly get the caller or connected structure
 	 * and manipulate it. Until such time as there is an enforced contract (which is being tracked under
-	 * ASTERISK-28164) they are each regenerated every time a channel snapshot is created.
+	 * ASTERISK-28164) they are each compared against the old snapshot every time a channel snapshot
+	 * is created, which is still far cheaper than regenerating them.
 	 */
-	snapshot->caller = channel_snapshot_caller_create(chan);
-	if (!snapshot->caller) {
-		ao2_ref(snapshot, -1);
-		return NULL;
+	if (old_snapshot && channel_snapshot_caller_matches(chan, old_snapshot->caller)) {
+		snapshot->caller = ao2_bump(old_snapshot->caller);
+	} else {
+		snapshot->caller = channel_snapshot_caller_create(chan);
+		if (!snapshot->caller) {
+			ao2_ref(snapshot, -1);
+			return NULL;
+		}
 	}
 
-	snapshot->connected = channel_snapshot_connected_create(chan);
-	if (!snapshot->connected) {
-		ao2_ref(snapshot, -1);
-		return NULL;
+	if (old_snapshot && channel_snapshot_connected_matches(chan, old_snapshot->connected)) {
+		snapshot->connected = ao2_bump(old_snapshot->connected);
+	} else {
+		snapshot->connected = channel_snapshot_connected_create(chan);
+		if (!snapshot->connected) {
+			ao2_ref(snapshot, -1);
+			return NULL;
+		}
 	}
 
 	if (ast_test_flag(ast_channel_snapshot_segment_flags(chan), AST_CHANNEL_SNAPSHOT_INVALIDATE_BRIDGE)) {
@@ -749,7 +792,7 @@ static struct stasis_message *create_channel_blob_message(struct ast_channel_sna
 	struct stasis_message *msg;
 	struct ast_channel_blob *obj;
 
-	obj = ao2_alloc(sizeof(*obj), channel_blob_dtor);
+	obj = ao2_alloc_options(sizeof(*obj), channel_blob_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!obj) {
 		return NULL;
 	}
@@ -884,7 +927,7 @@ struct ast_multi_channel_blob *ast_multi_channel_blob_create(struct ast_json *bl
 
 	ast_assert(blob != NULL);
 
-	obj = ao2_alloc(sizeof(*obj), multi_channel_blob_dtor);
+	obj = ao2_alloc_options(sizeof(*obj), multi_channel_blob_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!obj) {
 		return NULL;
 	}
@@ -1294,6 +1337,87 @@ struct ast_json *ast_channel_snapshot_to_json(
 	return json_chan;
 }
 
+int ast_channel_snapshot_to_json_writer(
+	const struct ast_channel_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize,
+	struct ast_json_writer *writer)
+{
+	if (snapshot == NULL
+		|| (sanitize
+			&& sanitize->channel_snapshot
+			&& sanitize->channel_snapshot(snapshot))) {
+		return -1;
+	}
+
+	/* The same members in the same order as ast_channel_snapshot_to_json() */
+	ast_json_writer_object_start(writer);
+	ast_json_writer_key(writer, "id");
+	ast_json_writer_string(writer, snapshot->base->uniqueid);
+	ast_json_writer_key(writer, "name");
+	ast_json_writer_string(writer, snapshot->base->name);
+	ast_json_writer_key(writer, "state");
+	ast_json_writer_string(writer, ast_state2str(snapshot->state));
+
+	ast_json_writer_key(writer, "caller");
+	ast_json_writer_object_start(writer);
+	ast_json_writer_key(writer, "name");
+	ast_json_writer_string(writer, AST_JSON_UTF8_VALIDATE(snapshot->caller->name));
+	ast_json_writer_key(writer, "number");
+	ast_json_writer_string(writer, AST_JSON_UTF8_VALIDATE(snapshot->caller->number));
+	ast_json_writer_object_end(writer);
+
+	ast_json_writer_key(writer, "connected");
+	ast_json_writer_object_start(writer);
+	ast_json_writer_key(writer, "name");
+	ast_json_writer_string(writer, AST_JSON_UTF8_VALIDATE(snapshot->connected->name));
+	ast_json_writer_key(writer, "number");
+	ast_json_writer_string(writer, AST_JSON_UTF8_VALIDATE(snapshot->connected->number));
+	ast_json_writer_object_end(writer);
+
+	ast_json_writer_key(writer, "accountcode");
+	ast_json_writer_string(writer, snapshot->base->accountcode);
+
+	ast_json_writer_key(writer, "dialplan");
+	ast_json_writer_object_start(writer);
+	ast_json_writer_key(writer, "context");
+	ast_json_writer_string(writer, snapshot->dialplan->context);
+	ast_json_writer_key(writer, "exten");
+	ast_json_writer_string(writer, snapshot->dialplan->exten);
+	ast_json_writer_key(writer, "priority");
+	if (snapshot->dialplan->priority != -1) {
+		ast_json_writer_integer(writer, snapshot->dialplan->priority);
+	} else {
+		ast_json_writer_null(writer);
+	}
+	ast_json_writer_key(writer, "app_name");
+	ast_json_writer_string(writer, snapshot->dialplan->appl);
+	ast_json_writer_key(writer, "app_data");
+	ast_json_writer_string(writer, snapshot->dialplan->data);
+	ast_json_writer_object_end(writer);
+
+	ast_json_writer_key(writer, "creationtime");
+	ast_json_writer_timeval(writer, snapshot->base->creationtime, NULL);
+	ast_json_writer_key(writer, "language");
+	ast_json_writer_string(writer, snapshot->base->language);
+
+	if (snapshot->ari_vars && !AST_LIST_EMPTY(snapshot->ari_vars)) {
+		struct ast_var_t *var;
+
+		ast_json_writer_key(writer, "channelvars");
+		ast_json_writer_object_start(writer);
+		AST_LIST_TRAVERSE(snapshot->ari_vars, var, entries) {
+			/* Values that are not valid UTF-8 are left out, as in ast_json_channel_vars() */
+			if (ast_json_utf8_check(var->value)) {
+				ast_json_writer_key(writer, var->name);
+				ast_json_writer_string(writer, var->value);
+			}
+		}
+		ast_json_writer_object_end(writer);
+	}
+
+	return ast_json_writer_object_end(writer);
+}
+
 int ast_channel_snapshot_cep_equal(
 	const struct ast_channel_snapshot *old_snapshot,
 	const struct ast_channel_snapshot *new_snapshot)
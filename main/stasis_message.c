@@ -33,6 +33,10 @@
 #include "asterisk/stasis.h"
 #include "asterisk/utils.h"
 #include "asterisk/hashtab.h"
+#include "asterisk/json.h"
+#include "asterisk/manager.h"
+#include "asterisk/event.h"
+#include "asterisk/lock.h"
 
 /*! \internal */
 struct stasis_message_type {
@@ -117,6 +121,30 @@ enum stasis_subscription_message_formatters stasis_message_type_available_format
 	return type->available_formatters;
 }
 
+/*! \internal \brief The memoized representations of a message */
+enum message_memo_format {
+	MESSAGE_MEMO_JSON,
+	MESSAGE_MEMO_AMI,
+	MESSAGE_MEMO_EVENT,
+	MESSAGE_MEMO_MAX,
+};
+
+/*! \internal \brief A representation of a message, computed once */
+struct message_memo {
+	/*! The sanitizer the JSON was built with */
+	const struct stasis_message_sanitizer *sanitize;
+	/*! The representation, NULL if the message has none */
+	void *value;
+};
+
+/*!
+ * \brief Guards installing the memos of every message.
+ *
+ * Representations are built without holding it, so it is only ever held
+ * long enough to store a pointer.
+ */
+AST_MUTEX_DEFINE_STATIC(memo_lock);
+
 /*! \internal */
 struct stasis_message {
 	/*! Time the message was created */
@@ -129,11 +157,27 @@ struct stasis_message {
 	void *data;
 	/*! Where this message originated. */
 	struct ast_eid eid;
+	/*! Representations already built for the consumers, see memo_get() */
+	struct message_memo *memo[MESSAGE_MEMO_MAX];
 };
 
 static void stasis_message_dtor(void *obj)
 {
 	struct stasis_message *message = obj;
+
+	if (message->memo[MESSAGE_MEMO_JSON]) {
+		ast_json_unref(message->memo[MESSAGE_MEMO_JSON]->value);
+	}
+	if (message->memo[MESSAGE_MEMO_AMI]) {
+		ao2_cleanup(message->memo[MESSAGE_MEMO_AMI]->value);
+	}
+	if (message->memo[MESSAGE_MEMO_EVENT]) {
+		ast_free(message->memo[MESSAGE_MEMO_EVENT]->value);
+	}
+	ast_free(message->memo[MESSAGE_MEMO_JSON]);
+	ast_free(message->memo[MESSAGE_MEMO_AMI]);
+	ast_free(message->memo[MESSAGE_MEMO_EVENT]);
+
 	ao2_cleanup(message->data);
 }
 
@@ -221,21 +265,165 @@ const struct timeval *stasis_message_timestamp(const struct stasis_message *msg)
 		msg->type->vtable->fn(__VA_ARGS__);		\
 	})
 
-struct ast_manager_event_blob *stasis_message_to_ami(struct stasis_message *msg)
+static struct ast_manager_event_blob *message_to_ami(struct stasis_message *msg)
 {
 	return INVOKE_VIRTUAL(to_ami, msg);
 }
 
+static struct ast_json *message_to_json(struct stasis_message *msg,
+	struct stasis_message_sanitizer *sanitize)
+{
+	return INVOKE_VIRTUAL(to_json, msg, sanitize);
+}
+
+static struct ast_event *message_to_event(struct stasis_message *msg)
+{
+	return INVOKE_VIRTUAL(to_event, msg);
+}
+
+/*!
+ * \internal
+ * \brief Get an already built representation of a message
+ *
+ * \retval NULL if it has not been built yet
+ */
+static struct message_memo *memo_get(struct stasis_message *msg,
+	enum message_memo_format format)
+{
+	return ast_atomic_load_n(&msg->memo[format], __ATOMIC_ACQUIRE);
+}
+
+/*!
+ * \internal
+ * \brief Remember the representation of a message
+ *
+ * Consumers on other threads may have built it at the same time, in which
+ * case the first one stored wins.
+ *
+ * \retval NULL if the representation could not be remembered, the caller
+ * keeps ownership of \a value
+ * \return the memo, which owns \a value unless it was built by another thread
+ */
+static struct message_memo *memo_set(struct stasis_message *msg,
+	enum message_memo_format format,
+	const struct stasis_message_sanitizer *sanitize, void *value)
+{
+	struct message_memo *memo;
+
+	memo = ast_malloc(sizeof(*memo));
+	if (!memo) {
+		return NULL;
+	}
+	memo->sanitize = sanitize;
+	memo->value = value;
+
+	ast_mutex_lock(&memo_lock);
+	if (msg->memo[format]) {
+		ast_free(memo);
+		memo = msg->memo[format];
+	} else {
+		ast_atomic_store_n(&msg->memo[format], memo, __ATOMIC_RELEASE);
+	}
+	ast_mutex_unlock(&memo_lock);
+
+	return memo;
+}
+
+struct ast_manager_event_blob *stasis_message_to_ami(struct stasis_message *msg)
+{
+	struct message_memo *memo;
+	struct ast_manager_event_blob *ami;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	memo = memo_get(msg, MESSAGE_MEMO_AMI);
+	if (memo) {
+		return ao2_bump(memo->value);
+	}
+
+	ami = message_to_ami(msg);
+	memo = memo_set(msg, MESSAGE_MEMO_AMI, NULL, ami);
+	if (!memo) {
+		return ami;
+	}
+	if (memo->value != ami) {
+		ao2_cleanup(ami);
+	}
+
+	return ao2_bump(memo->value);
+}
+
 struct ast_json *stasis_message_to_json(
 	struct stasis_message *msg,
 	struct stasis_message_sanitizer *sanitize)
 {
-	return INVOKE_VIRTUAL(to_json, msg, sanitize);
+	struct message_memo *memo;
+	struct ast_json *json;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	memo = memo_get(msg, MESSAGE_MEMO_JSON);
+	if (memo && memo->sanitize != sanitize) {
+		/* Only one sanitizer is remembered, in practice there is just the one */
+		return message_to_json(msg, sanitize);
+	}
+
+	if (!memo) {
+		json = message_to_json(msg, sanitize);
+		memo = memo_set(msg, MESSAGE_MEMO_JSON, sanitize, json);
+		if (!memo) {
+			return json;
+		}
+		if (memo->value != json) {
+			ast_json_unref(json);
+			if (memo->sanitize != sanitize) {
+				return message_to_json(msg, sanitize);
+			}
+		}
+	}
+
+	/*
+	 * Consumers add their own members to the object they get, so each one
+	 * gets its own copy of the top level.
+	 */
+	return memo->value ? ast_json_copy(memo->value) : NULL;
 }
 
 struct ast_event *stasis_message_to_event(struct stasis_message *msg)
 {
-	return INVOKE_VIRTUAL(to_event, msg);
+	struct message_memo *memo;
+	struct ast_event *event;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	memo = memo_get(msg, MESSAGE_MEMO_EVENT);
+	if (!memo) {
+		event = message_to_event(msg);
+		memo = memo_set(msg, MESSAGE_MEMO_EVENT, NULL, event);
+		if (!memo) {
+			return event;
+		}
+		if (memo->value != event) {
+			ast_event_destroy(event);
+		}
+	}
+
+	/* The event is owned by the caller, so hand out a copy of it */
+	if (!memo->value) {
+		return NULL;
+	}
+	event = ast_malloc(ast_event_get_size(memo->value));
+	if (event) {
+		memcpy(event, memo->value, ast_event_get_size(memo->value));
+	}
+
+	return event;
 }
 
 #define HAS_VIRTUAL(fn, msg)					\
@@ -407,6 +407,10 @@ int ast_stream_topology_equal(const struct ast_stream_topology *left,
 	ast_assert(left != NULL);
 	ast_assert(right != NULL);
 
+	if (left == right) {
+		return 1;
+	}
+
 	if (ast_stream_topology_get_count(left) != ast_stream_topology_get_count(right)) {
 		return 0;
 	}
@@ -415,6 +419,10 @@ int ast_stream_topology_equal(const struct ast_stream_topology *left,
 		const struct ast_stream *left_stream = ast_stream_topology_get_stream(left, index);
 		const struct ast_stream *right_stream = ast_stream_topology_get_stream(right, index);
 
+		if (left_stream == right_stream) {
+			continue;
+		}
+
 		if (ast_stream_get_type(left_stream) != ast_stream_get_type(right_stream)) {
 			return 0;
 		}
@@ -423,7 +431,14 @@ int ast_stream_topology_equal(const struct ast_stream_topology *left,
 			return 0;
 		}
 
-		if (!ast_stream_get_formats(left_stream) && ast_stream_get_formats(right_stream) &&
+		if (strcmp(ast_stream_get_name(left_stream), ast_stream_get_name(right_stream))) {
+			return 0;
+		}
+
+		if (ast_stream_get_formats(left_stream) == ast_stream_get_formats(right_stream)) {
+			/* Cloned streams share their format capabilities, no need to look inside */
+			continue;
+		} else if (!ast_stream_get_formats(left_stream) && ast_stream_get_formats(right_stream) &&
 			ast_format_cap_count(ast_stream_get_formats(right_stream))) {
 			/* A NULL format capabilities and an empty format capabilities are the same, as they have
 			 * no formats inside. If one does though... they are not equal.
@@ -437,10 +452,6 @@ int ast_stream_topology_equal(const struct ast_stream_topology *left,
 			/* But if both are actually present we need to do an actual identical check. */
 			return 0;
 		}
-
-		if (strcmp(ast_stream_get_name(left_stream), ast_stream_get_name(right_stream))) {
-			return 0;
-		}
 	}
 
 	return 1;
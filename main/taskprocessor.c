@@ -29,6 +29,8 @@
 
 #include "asterisk.h"
 
+#include <sched.h>
+
 #include "asterisk/_private.h"
 #include "asterisk/module.h"
 #include "asterisk/time.h"
@@ -36,6 +38,8 @@
 #include "asterisk/cli.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/sem.h"
+#include "asterisk/backtrace.h"
+#include "asterisk/options.h"
 
 /*!
  * \brief tps_task structure is queued to a taskprocessor
@@ -54,15 +58,61 @@ struct tps_task {
 	void *datap;
 	/*! \brief AST_LIST_ENTRY overhead */
 	AST_LIST_ENTRY(tps_task) list;
+	/*! \brief The allocation this task is part of if it was pushed in a batch */
+	struct tps_task_block *block;
+	/*! \brief When the task was queued */
+	struct timeval queued;
 	unsigned int wants_local:1;
 };
 
+/*!
+ * \brief A single allocation holding a batch of tasks
+ *
+ * The block is freed once every task in it has been freed.
+ */
+struct tps_task_block {
+	/*! \brief Number of tasks in the block not yet freed */
+	int remaining;
+	/*! \brief The tasks */
+	struct tps_task tasks[0];
+};
+
+/*!
+ * \brief Intrusive lock-free multi-producer/single-consumer task queue
+ *
+ * Producers only need a single atomic exchange to link a task in, so
+ * pushing never takes the taskprocessor lock. The queue always contains
+ * at least one node; the embedded stub is used as a placeholder when
+ * all of the real tasks have been consumed. Tasks are linked through
+ * the same list entry used by the locked queue.
+ */
+struct tps_mpsc_queue {
+	/*! \brief The most recently pushed node, shared by the producers */
+	struct tps_task *head;
+	/*! \brief The oldest node, only accessed by the consumer */
+	struct tps_task *tail;
+	/*! \brief Placeholder node */
+	struct tps_task stub;
+};
+
 /*! \brief tps_taskprocessor_stats maintain statistics for a taskprocessor. */
 struct tps_taskprocessor_stats {
 	/*! \brief This is the maximum number of tasks queued at any one time */
 	unsigned long max_qsize;
 	/*! \brief This is the current number of tasks processed */
 	unsigned long _tasks_processed_count;
+	/*! \brief Tasks by execution time, see tps_histogram_bucket() */
+	uint64_t execution_histogram[AST_TASKPROCESSOR_HISTOGRAM_BUCKETS];
+	/*! \brief Tasks by time spent queued, see tps_histogram_bucket() */
+	uint64_t wait_histogram[AST_TASKPROCESSOR_HISTOGRAM_BUCKETS];
+	/*! \brief Total execution time, in microseconds */
+	int64_t execution_sum;
+	/*! \brief Total time spent queued, in microseconds */
+	int64_t wait_sum;
+	/*! \brief When a slow task was last logged */
+	time_t slow_task_logged;
+	/*! \brief Slow tasks not logged since then */
+	unsigned int slow_task_suppressed;
 };
 
 /*! \brief A ast_taskprocessor structure is a singleton by name */
@@ -78,6 +128,12 @@ struct ast_taskprocessor {
 	long tps_queue_high;
 	/*! \brief Taskprocessor queue */
 	AST_LIST_HEAD_NOLOCK(tps_queue, tps_task) tps_queue;
+	/*! \brief Lock-free taskprocessor queue used by single consumer taskprocessors */
+	struct tps_mpsc_queue mpsc_queue;
+	/*! \brief Tasks pushed to the lock-free queue that have not finished executing */
+	int mpsc_pending;
+	/*! \brief Non-zero if the tasks are in mpsc_queue rather than tps_queue */
+	int single_consumer;
 	struct ast_taskprocessor_listener *listener;
 	/*! Current thread executing the tasks */
 	pthread_t thread;
@@ -114,6 +170,8 @@ struct ast_taskprocessor_listener {
 	struct ast_taskprocessor *tps;
 	/*! Data private to the listener */
 	void *user_data;
+	/*! Non-zero if tasks are only ever executed by one thread at a time */
+	int single_consumer;
 };
 
 /*!
@@ -339,6 +397,7 @@ static struct tps_task *tps_task_alloc(int (*task_exe)(void *datap), void *datap
 
 	t->callback.execute = task_exe;
 	t->datap = datap;
+	t->queued = ast_tvnow();
 
 	return t;
 }
@@ -360,6 +419,7 @@ static struct tps_task *tps_task_alloc_local(int (*task_exe)(struct ast_taskproc
 	t->callback.execute_local = task_exe;
 	t->datap = datap;
 	t->wants_local = 1;
+	t->queued = ast_tvnow();
 
 	return t;
 }
@@ -367,10 +427,125 @@ static struct tps_task *tps_task_alloc_local(int (*task_exe)(struct ast_taskproc
 /* release task resources */
 static void *tps_task_free(struct tps_task *task)
 {
+	if (task->block) {
+		/* Tasks in a block may be executed by different threads */
+		if (ast_atomic_dec_and_test(&task->block->remaining)) {
+			ast_free(task->block);
+		}
+		return NULL;
+	}
 	ast_free(task);
 	return NULL;
 }
 
+/* allocate resources for a batch of tasks */
+static struct tps_task_block *tps_task_block_alloc(const struct ast_taskprocessor_task *tasks, size_t count)
+{
+	struct tps_task_block *block;
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		if (!tasks[i].task_exe) {
+			ast_log(LOG_ERROR, "task_exe is NULL!\n");
+			return NULL;
+		}
+	}
+
+	block = ast_calloc(1, sizeof(*block) + count * sizeof(block->tasks[0]));
+	if (!block) {
+		ast_log(LOG_ERROR, "failed to allocate task batch!\n");
+		return NULL;
+	}
+
+	block->remaining = count;
+	block->tasks[0].queued = ast_tvnow();
+	for (i = 0; i < count; ++i) {
+		block->tasks[i].callback.execute = tasks[i].task_exe;
+		block->tasks[i].datap = tasks[i].datap;
+		block->tasks[i].block = block;
+		block->tasks[i].queued = block->tasks[0].queued;
+		block->tasks[i].list.next = i + 1 < count ? &block->tasks[i + 1] : NULL;
+	}
+
+	return block;
+}
+
+static void tps_mpsc_queue_init(struct tps_mpsc_queue *queue)
+{
+	queue->stub.list.next = NULL;
+	queue->head = &queue->stub;
+	queue->tail = &queue->stub;
+}
+
+/*!
+ * \brief Link a chain of tasks into the lock-free queue. Safe to call from any thread.
+ *
+ * \param queue The queue
+ * \param first The first task of the chain
+ * \param last The last task of the chain. Its next pointer must be NULL.
+ */
+static void tps_mpsc_queue_push_chain(struct tps_mpsc_queue *queue, struct tps_task *first,
+	struct tps_task *last)
+{
+	struct tps_task *prev;
+
+	prev = ast_atomic_exchange_n(&queue->head, last, __ATOMIC_ACQ_REL);
+	/*
+	 * Until this store happens the tasks are not reachable by the consumer.
+	 * tps_mpsc_queue_pop() returns NULL in that window.
+	 */
+	ast_atomic_store_n(&prev->list.next, first, __ATOMIC_RELEASE);
+}
+
+/*! \brief Link a task into the lock-free queue. Safe to call from any thread. */
+static void tps_mpsc_queue_push(struct tps_mpsc_queue *queue, struct tps_task *task)
+{
+	task->list.next = NULL;
+	tps_mpsc_queue_push_chain(queue, task, task);
+}
+
+/*!
+ * \brief Remove the oldest task from the lock-free queue
+ *
+ * \note Only one thread may call this at a time.
+ *
+ * \retval NULL if the queue is empty or the next task is still being linked in
+ */
+static struct tps_task *tps_mpsc_queue_pop(struct tps_mpsc_queue *queue)
+{
+	struct tps_task *tail = queue->tail;
+	struct tps_task *next = ast_atomic_load_n(&tail->list.next, __ATOMIC_ACQUIRE);
+
+	if (tail == &queue->stub) {
+		if (!next) {
+			return NULL;
+		}
+		queue->tail = next;
+		tail = next;
+		next = ast_atomic_load_n(&tail->list.next, __ATOMIC_ACQUIRE);
+	}
+
+	if (next) {
+		queue->tail = next;
+		return tail;
+	}
+
+	if (tail != ast_atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)) {
+		/* A producer is part way through linking in a task */
+		return NULL;
+	}
+
+	/* tail is the last task so put the stub back behind it to take its place */
+	tps_mpsc_queue_push(queue, &queue->stub);
+	next = ast_atomic_load_n(&tail->list.next, __ATOMIC_ACQUIRE);
+	if (next) {
+		queue->tail = next;
+		return tail;
+	}
+
+	return NULL;
+}
+
 /* Taskprocessor tab completion.
  *
  * The caller of this function is responsible for argument
@@ -871,6 +1046,9 @@ static void tps_taskprocessor_dtor(void *tps)
 	while ((task = AST_LIST_REMOVE_HEAD(&t->tps_queue, list))) {
 		tps_task_free(task);
 	}
+	while ((task = tps_mpsc_queue_pop(&t->mpsc_queue))) {
+		tps_task_free(task);
+	}
 	t->tps_queue_size = 0;
 
 	if (t->high_water_alert) {
@@ -897,11 +1075,73 @@ static struct tps_task *tps_taskprocessor_pop(struct ast_taskprocessor *tps)
 	return task;
 }
 
+/*!
+ * \internal
+ * \brief pop the front task of a single consumer taskprocessor and return it
+ *
+ * \note The caller must be the taskprocessor's only consumer and must not
+ * hold the taskprocessor lock.
+ */
+static struct tps_task *tps_taskprocessor_pop_lockless(struct ast_taskprocessor *tps)
+{
+	struct tps_task *task;
+
+	while (!(task = tps_mpsc_queue_pop(&tps->mpsc_queue))) {
+		if (!ast_atomic_load_n(&tps->tps_queue_size, __ATOMIC_ACQUIRE)) {
+			return NULL;
+		}
+		/* A queued task is still being linked in by its producer. */
+		sched_yield();
+	}
+
+	if (ast_atomic_sub_fetch(&tps->tps_queue_size, 1, __ATOMIC_RELAXED) <= tps->tps_queue_low
+		&& tps->high_water_alert) {
+		ao2_lock(tps);
+		if (tps->high_water_alert && tps->tps_queue_size <= tps->tps_queue_low) {
+			tps->high_water_alert = 0;
+			tps_alert_add(tps, -1);
+		}
+		ao2_unlock(tps);
+	}
+
+	return task;
+}
+
 long ast_taskprocessor_size(struct ast_taskprocessor *tps)
 {
 	return (tps) ? tps->tps_queue_size : -1;
 }
 
+void ast_taskprocessor_metrics_collect(ast_taskprocessor_metrics_cb callback, void *data)
+{
+	struct ao2_iterator iter;
+	struct ast_taskprocessor *tps;
+
+	iter = ao2_iterator_init(tps_singletons, 0);
+	while ((tps = ao2_iterator_next(&iter))) {
+		struct ast_taskprocessor_metrics metrics = {
+			.name = tps->name,
+		};
+		int bucket;
+
+		ao2_lock(tps);
+		metrics.processed = tps->stats._tasks_processed_count;
+		metrics.max_queued = tps->stats.max_qsize;
+		ao2_unlock(tps);
+		metrics.queued = ast_taskprocessor_size(tps);
+		for (bucket = 0; bucket < AST_TASKPROCESSOR_HISTOGRAM_BUCKETS; ++bucket) {
+			metrics.execution[bucket] = tps->stats.execution_histogram[bucket];
+			metrics.wait[bucket] = tps->stats.wait_histogram[bucket];
+		}
+		metrics.execution_sum = tps->stats.execution_sum;
+		metrics.wait_sum = tps->stats.wait_sum;
+
+		callback(&metrics, data);
+		ao2_ref(tps, -1);
+	}
+	ao2_iterator_destroy(&iter);
+}
+
 /* taskprocessor name accessor */
 const char *ast_taskprocessor_name(struct ast_taskprocessor *tps)
 {
@@ -941,6 +1181,12 @@ struct ast_taskprocessor_listener *ast_taskprocessor_listener_alloc(const struct
 	return listener;
 }
 
+void ast_taskprocessor_listener_set_single_consumer(struct ast_taskprocessor_listener *listener)
+{
+	ast_assert(listener->tps == NULL);
+	listener->single_consumer = 1;
+}
+
 struct ast_taskprocessor *ast_taskprocessor_listener_get_tps(const struct ast_taskprocessor_listener *listener)
 {
 	ao2_ref(listener->tps, +1);
@@ -1012,6 +1258,9 @@ static struct ast_taskprocessor *__allocate_taskprocessor(const char *name, stru
 
 	p->thread = AST_PTHREADT_NULL;
 
+	tps_mpsc_queue_init(&p->mpsc_queue);
+	p->single_consumer = listener->single_consumer;
+
 	ao2_ref(p, +1);
 	listener->tps = p;
 
@@ -1071,6 +1320,8 @@ struct ast_taskprocessor *ast_taskprocessor_get(const char *name, enum ast_tps_o
 		default_listener_pvt_destroy(pvt);
 		return NULL;
 	}
+	/* The default listener executes every task from its one thread */
+	ast_taskprocessor_listener_set_single_consumer(listener);
 
 	p = __allocate_taskprocessor(name, listener);
 	ao2_unlock(tps_singletons);
@@ -1135,25 +1386,89 @@ void *ast_taskprocessor_unreference(struct ast_taskprocessor *tps)
 	return NULL;
 }
 
-/* push the task into the taskprocessor queue */
-static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
+/*!
+ * \internal
+ * \brief Let the listener know tasks were pushed
+ *
+ * \param tps The taskprocessor
+ * \param was_empty Non-zero if the taskprocessor was empty before the push
+ * \param count The number of tasks pushed
+ */
+static void taskprocessor_notify_pushed(struct ast_taskprocessor *tps, int was_empty, size_t count)
 {
-	int previous_size;
+	if (count > 1 && tps->listener->callbacks->task_batch_pushed) {
+		tps->listener->callbacks->task_batch_pushed(tps->listener, was_empty, count);
+		return;
+	}
+
+	tps->listener->callbacks->task_pushed(tps->listener, was_empty);
+	while (--count) {
+		tps->listener->callbacks->task_pushed(tps->listener, 0);
+	}
+}
+
+/*!
+ * \internal
+ * \brief push tasks into a single consumer taskprocessor's queue
+ *
+ * The taskprocessor lock is only taken when a high water alert is raised.
+ */
+static int taskprocessor_push_lockless(struct ast_taskprocessor *tps, struct tps_task *first,
+	struct tps_task *last, size_t count)
+{
+	long size;
 	int was_empty;
 
-	if (!tps) {
-		ast_log(LOG_ERROR, "tps is NULL!\n");
-		return -1;
+	/*
+	 * The size is raised before the task is linked in so the consumer never
+	 * sees it drop below zero. A consumer that sees a non-zero size but no
+	 * task waits for the task to arrive.
+	 */
+	size = ast_atomic_add_fetch(&tps->tps_queue_size, count, __ATOMIC_RELAXED);
+	tps_mpsc_queue_push_chain(&tps->mpsc_queue, first, last);
+
+	if (tps->tps_queue_high <= size && !tps->high_water_alert) {
+		ao2_lock(tps);
+		if (!tps->high_water_alert && tps->tps_queue_high <= tps->tps_queue_size) {
+			ast_log(LOG_WARNING, "The '%s' task processor queue reached %ld scheduled tasks%s.\n",
+				tps->name, tps->tps_queue_size, tps->high_water_warned ? " again" : "");
+			tps->high_water_warned = 1;
+			tps->high_water_alert = 1;
+			tps_alert_add(tps, +1);
+		}
+		ao2_unlock(tps);
 	}
 
-	if (!t) {
-		ast_log(LOG_ERROR, "t is NULL!\n");
-		return -1;
+	/* The currently executing task counts as still pending */
+	was_empty = ast_atomic_fetchadd_int(&tps->mpsc_pending, count) == 0;
+	taskprocessor_notify_pushed(tps, was_empty, count);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief push a chain of tasks into the taskprocessor queue
+ *
+ * \param tps The taskprocessor
+ * \param first The first task of the chain
+ * \param last The last task of the chain. Its next pointer must be NULL.
+ * \param count The number of tasks in the chain
+ */
+static int taskprocessor_push_chain(struct ast_taskprocessor *tps, struct tps_task *first,
+	struct tps_task *last, size_t count)
+{
+	AST_LIST_HEAD_NOLOCK(, tps_task) chain = { .first = first, .last = last };
+	int previous_size;
+	int was_empty;
+
+	if (tps->single_consumer) {
+		return taskprocessor_push_lockless(tps, first, last, count);
 	}
 
 	ao2_lock(tps);
-	AST_LIST_INSERT_TAIL(&tps->tps_queue, t, list);
-	previous_size = tps->tps_queue_size++;
+	AST_LIST_APPEND_LIST(&tps->tps_queue, &chain, list);
+	previous_size = tps->tps_queue_size;
+	tps->tps_queue_size += count;
 
 	if (tps->tps_queue_high <= tps->tps_queue_size) {
 		if (!tps->high_water_alert) {
@@ -1168,10 +1483,49 @@ static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
 	/* The currently executing task counts as still in queue */
 	was_empty = tps->executing ? 0 : previous_size == 0;
 	ao2_unlock(tps);
-	tps->listener->callbacks->task_pushed(tps->listener, was_empty);
+	taskprocessor_notify_pushed(tps, was_empty, count);
 	return 0;
 }
 
+/* push the task into the taskprocessor queue */
+static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
+{
+	if (!tps) {
+		ast_log(LOG_ERROR, "tps is NULL!\n");
+		return -1;
+	}
+
+	if (!t) {
+		ast_log(LOG_ERROR, "t is NULL!\n");
+		return -1;
+	}
+
+	t->list.next = NULL;
+	return taskprocessor_push_chain(tps, t, t, 1);
+}
+
+int ast_taskprocessor_push_batch(struct ast_taskprocessor *tps,
+	const struct ast_taskprocessor_task *tasks, size_t count)
+{
+	struct tps_task_block *block;
+
+	if (!tps) {
+		ast_log(LOG_ERROR, "tps is NULL!\n");
+		return -1;
+	}
+
+	if (!count) {
+		return 0;
+	}
+
+	block = tps_task_block_alloc(tasks, count);
+	if (!block) {
+		return -1;
+	}
+
+	return taskprocessor_push_chain(tps, &block->tasks[0], &block->tasks[count - 1], count);
+}
+
 int ast_taskprocessor_push(struct ast_taskprocessor *tps, int (*task_exe)(void *datap), void *datap)
 {
 	return taskprocessor_push(tps, tps_task_alloc(task_exe, datap));
@@ -1209,12 +1563,145 @@ int ast_taskprocessor_is_suspended(struct ast_taskprocessor *tps)
 	return tps ? tps->suspended : -1;
 }
 
+/*!
+ * \internal
+ * \brief Find the histogram bucket of a duration
+ *
+ * Bucket i counts the durations of at most 2^i microseconds that did not fit
+ * the previous bucket.  The last bucket counts everything longer.
+ */
+static int tps_histogram_bucket(int64_t usec)
+{
+	int bucket = 0;
+
+	while (bucket < AST_TASKPROCESSOR_HISTOGRAM_BUCKETS - 1 && usec > (INT64_C(1) << bucket)) {
+		++bucket;
+	}
+
+	return bucket;
+}
+
+/*!
+ * \internal
+ * \brief Log a task that ran for longer than the taskprocessor_slow_task option
+ *
+ * At most one task is logged per taskprocessor each second.
+ */
+static void tps_slow_task_log(struct ast_taskprocessor *tps, void *callback, int64_t usec)
+{
+	struct ast_vector_string *symbols;
+	time_t now = time(NULL);
+
+	if (tps->stats.slow_task_logged == now) {
+		++tps->stats.slow_task_suppressed;
+		return;
+	}
+	tps->stats.slow_task_logged = now;
+
+	symbols = ast_bt_get_symbols(&callback, 1);
+	ast_log(LOG_WARNING, "Task %s (%p) on taskprocessor '%s' ran for %" PRId64 " ms (%u more slow tasks not logged)\n",
+		symbols && AST_VECTOR_SIZE(symbols) ? AST_VECTOR_GET(symbols, 0) : "<unknown>",
+		callback, tps->name, usec / 1000, tps->stats.slow_task_suppressed);
+	ast_bt_free_symbols(symbols);
+	tps->stats.slow_task_suppressed = 0;
+}
+
+/*!
+ * \internal
+ * \brief Execute a task, accounting for the time it waited and ran
+ */
+static void tps_task_execute(struct ast_taskprocessor *tps, struct tps_task *t,
+	struct ast_taskprocessor_local *local)
+{
+	void *callback = t->wants_local ? (void *) t->callback.execute_local : (void *) t->callback.execute;
+	struct timeval start = ast_tvnow();
+	int64_t wait = ast_tvdiff_us(start, t->queued);
+	int64_t execution;
+
+	if (t->wants_local) {
+		t->callback.execute_local(local);
+	} else {
+		t->callback.execute(t->datap);
+	}
+	tps_task_free(t);
+
+	execution = ast_tvdiff_us(ast_tvnow(), start);
+	ast_atomic_fetch_add(&tps->stats.wait_histogram[tps_histogram_bucket(wait)], 1, __ATOMIC_RELAXED);
+	ast_atomic_fetch_add(&tps->stats.execution_histogram[tps_histogram_bucket(execution)], 1, __ATOMIC_RELAXED);
+	ast_atomic_fetch_add(&tps->stats.wait_sum, wait, __ATOMIC_RELAXED);
+	ast_atomic_fetch_add(&tps->stats.execution_sum, execution, __ATOMIC_RELAXED);
+
+	if (ast_option_tps_slow_task && execution >= (int64_t) ast_option_tps_slow_task * 1000) {
+		tps_slow_task_log(tps, callback, execution);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Execute a task of a single consumer taskprocessor
+ *
+ * The taskprocessor lock is still used to publish the executing thread
+ * and update the statistics, but it is never contended by producers.
+ */
+static int taskprocessor_execute_lockless(struct ast_taskprocessor *tps)
+{
+	struct ast_taskprocessor_local local;
+	struct tps_task *t;
+	long size;
+
+	t = tps_taskprocessor_pop_lockless(tps);
+	if (!t) {
+		return 0;
+	}
+
+	ao2_lock(tps);
+	tps->thread = pthread_self();
+	tps->executing = 1;
+
+	if (t->wants_local) {
+		local.local_data = tps->local_data;
+		local.data = t->datap;
+	}
+	ao2_unlock(tps);
+
+	tps_task_execute(tps, t, &local);
+
+	ao2_lock(tps);
+	tps->thread = AST_PTHREADT_NULL;
+	tps->executing = 0;
+	/*
+	 * The task only stops counting as pending once this is decremented. A
+	 * producer that pushes after it reaches zero reports was_empty so the
+	 * listener knows to schedule execution again.
+	 */
+	size = ast_atomic_fetchadd_int(&tps->mpsc_pending, -1) - 1;
+
+	/* Update the stats */
+	++tps->stats._tasks_processed_count;
+
+	/* Include the task we just executed as part of the queue size. */
+	if (size >= tps->stats.max_qsize) {
+		tps->stats.max_qsize = size + 1;
+	}
+	ao2_unlock(tps);
+
+	/* If we executed a task, check for the transition to empty */
+	if (size == 0 && tps->listener->callbacks->emptied) {
+		tps->listener->callbacks->emptied(tps->listener);
+	}
+	return size > 0;
+}
+
 int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 {
 	struct ast_taskprocessor_local local;
 	struct tps_task *t;
 	long size;
 
+	if (tps->single_consumer) {
+		return taskprocessor_execute_lockless(tps);
+	}
+
 	ao2_lock(tps);
 	t = tps_taskprocessor_pop(tps);
 	if (!t) {
@@ -1231,12 +1718,7 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	}
 	ao2_unlock(tps);
 
-	if (t->wants_local) {
-		t->callback.execute_local(&local);
-	} else {
-		t->callback.execute(t->datap);
-	}
-	tps_task_free(t);
+	tps_task_execute(tps, t, &local);
 
 	ao2_lock(tps);
 	tps->thread = AST_PTHREADT_NULL;
@@ -1323,6 +1805,10 @@ static void tps_reset_stats(struct ast_taskprocessor *tps)
 	ao2_lock(tps);
 	tps->stats._tasks_processed_count = 0;
 	tps->stats.max_qsize = 0;
+	memset(tps->stats.execution_histogram, 0, sizeof(tps->stats.execution_histogram));
+	memset(tps->stats.wait_histogram, 0, sizeof(tps->stats.wait_histogram));
+	tps->stats.execution_sum = 0;
+	tps->stats.wait_sum = 0;
 	ao2_unlock(tps);
 }
 
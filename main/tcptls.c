@@ -37,6 +37,8 @@
 #ifdef DO_SSL
 #include <openssl/asn1.h>               /* for ASN1_STRING_to_UTF8 */
 #include <openssl/crypto.h>             /* for OPENSSL_free */
+#include <openssl/evp.h>                /* for EVP_EncryptInit_ex, EVP_aes_128_cbc */
+#include <openssl/hmac.h>               /* for HMAC_Init_ex */
 #include <openssl/opensslconf.h>        /* for OPENSSL_NO_SSL3_METHOD, OPENS... */
 #include <openssl/opensslv.h>           /* for OPENSSL_VERSION_NUMBER */
 #include <openssl/safestack.h>          /* for STACK_OF */
@@ -48,6 +50,7 @@
 #include <openssl/dh.h>                 /* for DH_free */
 #include <openssl/pem.h>                /* for PEM_read_bio_DHparams */
 #endif /* OPENSSL_NO_DH */
+#include <openssl/rand.h>               /* for RAND_bytes */
 #ifndef OPENSSL_NO_EC
 #include <openssl/ec.h>                 /* for EC_KEY_free, EC_KEY_new_by_cu... */
 #endif /* OPENSSL_NO_EC */
@@ -68,6 +71,40 @@
 #include "asterisk/pbx.h"               /* for ast_thread_inhibit_escalations */
 #include "asterisk/utils.h"             /* for ast_true, ast_free, ast_wait_... */
 
+/*! \brief Counts and durations of the TLS handshakes made */
+static struct ast_tls_handshake_stats handshake_stats;
+
+#ifdef DO_SSL
+/*! \brief A key session tickets are encrypted and authenticated with */
+struct tls_ticket_key {
+	unsigned char name[16];
+	unsigned char aes_key[16];
+	unsigned char hmac_key[16];
+	/*! When the key started being used to issue tickets */
+	time_t created;
+};
+
+/*!
+ * \brief The session ticket keys of an SSL_CTX
+ *
+ * New tickets are issued with the current key, which is replaced once its
+ * lifetime is over.  Tickets of the previous key are still accepted, for
+ * another lifetime, and replaced by a ticket of the current key.
+ */
+struct tls_ticket_keys {
+	ast_mutex_t lock;
+	/*! Seconds before the current key is replaced */
+	unsigned int lifetime;
+	struct tls_ticket_key current;
+	struct tls_ticket_key previous;
+	int has_previous;
+};
+
+/*! \brief Index of the ticket keys in the ex_data of an SSL_CTX */
+static int ticket_keys_index = -1;
+AST_MUTEX_DEFINE_STATIC(ticket_keys_index_lock);
+#endif /* DO_SSL */
+
 static void session_instance_destructor(void *obj)
 {
 	struct ast_tcptls_session_instance *i = obj;
@@ -151,18 +188,33 @@ static void *handle_tcptls_connection(void *data)
 
 	if (tcptls_session->parent->tls_cfg) {
 #ifdef DO_SSL
+		struct timeval start = ast_tvnow();
+		int64_t elapsed;
+
 		if (ast_iostream_start_tls(&tcptls_session->stream, tcptls_session->parent->tls_cfg->ssl_ctx, tcptls_session->client) < 0) {
 			SSL *ssl = ast_iostream_get_ssl(tcptls_session->stream);
 			if (ssl) {
 				ast_log(LOG_ERROR, "Unable to set up ssl connection with peer '%s'\n",
 					ast_sockaddr_stringify(&tcptls_session->remote_address));
 			}
+			ast_atomic_fetch_add(&handshake_stats.failed, 1, __ATOMIC_RELAXED);
 			ast_tcptls_close_session_file(tcptls_session);
 			ao2_ref(tcptls_session, -1);
 			return NULL;
 		}
 
 		ssl = ast_iostream_get_ssl(tcptls_session->stream);
+		elapsed = ast_tvdiff_us(ast_tvnow(), start);
+		if (SSL_session_reused(ssl)) {
+			ast_atomic_fetch_add(&handshake_stats.resumed, 1, __ATOMIC_RELAXED);
+			ast_atomic_fetch_add(&handshake_stats.resumed_us, elapsed, __ATOMIC_RELAXED);
+		} else {
+			ast_atomic_fetch_add(&handshake_stats.full, 1, __ATOMIC_RELAXED);
+			ast_atomic_fetch_add(&handshake_stats.full_us, elapsed, __ATOMIC_RELAXED);
+		}
+		ast_debug(3, "TLS handshake with peer '%s' %s a session in %" PRId64 " us\n",
+			ast_sockaddr_stringify(&tcptls_session->remote_address),
+			SSL_session_reused(ssl) ? "resumed" : "established", elapsed);
 		if ((tcptls_session->client && !ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_DONT_VERIFY_SERVER))
 			|| (!tcptls_session->client && ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_VERIFY_CLIENT))) {
 			X509 *peer;
@@ -354,6 +406,132 @@ static void __ssl_setup_certs(struct ast_tls_config *cfg, const size_t cert_file
 }
 #endif
 
+#ifdef DO_SSL
+static void tls_ticket_keys_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx,
+	long argl, void *argp)
+{
+	struct tls_ticket_keys *keys = ptr;
+
+	if (keys) {
+		ast_mutex_destroy(&keys->lock);
+		ast_free(keys);
+	}
+}
+
+static int tls_ticket_key_generate(struct tls_ticket_key *key)
+{
+	if (RAND_bytes(key->name, sizeof(key->name)) != 1
+		|| RAND_bytes(key->aes_key, sizeof(key->aes_key)) != 1
+		|| RAND_bytes(key->hmac_key, sizeof(key->hmac_key)) != 1) {
+		return -1;
+	}
+	key->created = time(NULL);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Encrypt a new session ticket, or find the key of one being resumed
+ *
+ * \retval 1 for a ticket of the current key
+ * \retval 2 for a ticket of the previous key, which is renewed
+ * \retval 0 for a ticket of no known key, for a full handshake
+ * \retval -1 on failure
+ */
+static int tls_ticket_key_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv,
+	EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int enc)
+{
+	struct tls_ticket_keys *keys = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ticket_keys_index);
+	struct tls_ticket_key key;
+	int res = 1;
+
+	if (!keys) {
+		return -1;
+	}
+
+	ast_mutex_lock(&keys->lock);
+	if (time(NULL) - keys->current.created >= (time_t) keys->lifetime) {
+		struct tls_ticket_key next;
+
+		if (!tls_ticket_key_generate(&next)) {
+			keys->previous = keys->current;
+			keys->has_previous = 1;
+			keys->current = next;
+		}
+	}
+	if (enc) {
+		key = keys->current;
+	} else if (!memcmp(key_name, keys->current.name, sizeof(keys->current.name))) {
+		key = keys->current;
+	} else if (keys->has_previous
+		&& !memcmp(key_name, keys->previous.name, sizeof(keys->previous.name))) {
+		key = keys->previous;
+		res = 2;
+	} else {
+		res = 0;
+	}
+	ast_mutex_unlock(&keys->lock);
+
+	if (!res) {
+		return 0;
+	}
+
+	if (enc) {
+		memcpy(key_name, key.name, sizeof(key.name));
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_128_cbc())) != 1
+			|| !EVP_EncryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key.aes_key, iv)) {
+			return -1;
+		}
+	} else if (!EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key.aes_key, iv)) {
+		return -1;
+	}
+	if (!HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), NULL)) {
+		return -1;
+	}
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Replace session ticket keys of an SSL_CTX once their lifetime is over
+ */
+static void tls_ticket_keys_setup(struct ast_tls_config *cfg)
+{
+	struct tls_ticket_keys *keys;
+
+	ast_mutex_lock(&ticket_keys_index_lock);
+	if (ticket_keys_index < 0) {
+		ticket_keys_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, tls_ticket_keys_free);
+	}
+	ast_mutex_unlock(&ticket_keys_index_lock);
+	if (ticket_keys_index < 0) {
+		ast_log(LOG_WARNING, "Unable to store TLS session ticket keys, keeping one until reload\n");
+		return;
+	}
+
+	keys = ast_calloc(1, sizeof(*keys));
+	if (!keys) {
+		return;
+	}
+	if (tls_ticket_key_generate(&keys->current)) {
+		ast_log(LOG_WARNING, "Unable to generate a TLS session ticket key, keeping one until reload\n");
+		ast_free(keys);
+		return;
+	}
+	ast_mutex_init(&keys->lock);
+	keys->lifetime = cfg->ticket_key_lifetime;
+
+	if (!SSL_CTX_set_ex_data(cfg->ssl_ctx, ticket_keys_index, keys)) {
+		ast_mutex_destroy(&keys->lock);
+		ast_free(keys);
+		return;
+	}
+	SSL_CTX_set_tlsext_ticket_key_cb(cfg->ssl_ctx, tls_ticket_key_cb);
+}
+#endif /* DO_SSL */
+
 static int __ssl_setup(struct ast_tls_config *cfg, int client)
 {
 #ifndef DO_SSL
@@ -427,6 +605,18 @@ static int __ssl_setup(struct ast_tls_config *cfg, int client)
 	if (ast_test_flag(&cfg->flags, AST_SSL_DISABLE_TLSV1)) {
 		ssl_opts |= SSL_OP_NO_TLSv1;
 	}
+
+	if (ast_test_flag(&cfg->flags, AST_SSL_DISABLE_TICKETS)) {
+		ssl_opts |= SSL_OP_NO_TICKET;
+	}
+
+	if (ast_test_flag(&cfg->flags, AST_SSL_KTLS)) {
+#ifdef SSL_OP_ENABLE_KTLS
+		ssl_opts |= SSL_OP_ENABLE_KTLS;
+#else
+		ast_log(LOG_WARNING, "Your version of OpenSSL does not support kernel TLS, ignoring tlsktls\n");
+#endif
+	}
 #if defined(SSL_OP_NO_TLSv1_1) && defined(SSL_OP_NO_TLSv1_2)
 	if (ast_test_flag(&cfg->flags, AST_SSL_DISABLE_TLSV11)) {
 		ssl_opts |= SSL_OP_NO_TLSv1_1;
@@ -445,6 +635,21 @@ static int __ssl_setup(struct ast_tls_config *cfg, int client)
 		ast_test_flag(&cfg->flags, AST_SSL_VERIFY_CLIENT) ? SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_NONE,
 		NULL);
 
+	if (!client) {
+		/* Without a session id context, sessions of verified clients can't be resumed */
+		SSL_CTX_set_session_id_context(cfg->ssl_ctx, (const unsigned char *) "asterisk", 8);
+		SSL_CTX_set_session_cache_mode(cfg->ssl_ctx, SSL_SESS_CACHE_SERVER);
+		if (cfg->session_cache_size) {
+			SSL_CTX_sess_set_cache_size(cfg->ssl_ctx, cfg->session_cache_size);
+		}
+		if (cfg->session_timeout) {
+			SSL_CTX_set_timeout(cfg->ssl_ctx, cfg->session_timeout);
+		}
+		if (cfg->ticket_key_lifetime && !ast_test_flag(&cfg->flags, AST_SSL_DISABLE_TICKETS)) {
+			tls_ticket_keys_setup(cfg);
+		}
+	}
+
 	if (!ast_strlen_zero(cfg->certfile)) {
 		char *tmpprivate = ast_strlen_zero(cfg->pvtfile) ? cfg->certfile : cfg->pvtfile;
 		if (SSL_CTX_use_certificate_chain_file(cfg->ssl_ctx, cfg->certfile) == 0) {
@@ -712,6 +917,10 @@ void ast_tcptls_server_start(struct ast_tcptls_session_args *desc)
 			tls_changed = 1;
 		} else if (memcmp(&desc->tls_cfg->flags, &desc->old_tls_cfg->flags, sizeof(desc->tls_cfg->flags))) {
 			tls_changed = 1;
+		} else if (desc->tls_cfg->session_cache_size != desc->old_tls_cfg->session_cache_size
+			|| desc->tls_cfg->session_timeout != desc->old_tls_cfg->session_timeout
+			|| desc->tls_cfg->ticket_key_lifetime != desc->old_tls_cfg->ticket_key_lifetime) {
+			tls_changed = 1;
 		}
 
 		if (tls_changed) {
@@ -804,6 +1013,9 @@ systemd_socket_activation:
 		memcpy(desc->old_tls_cfg->pvthash, desc->tls_cfg->pvthash, 41);
 		memcpy(desc->old_tls_cfg->cahash, desc->tls_cfg->cahash, 41);
 		memcpy(&desc->old_tls_cfg->flags, &desc->tls_cfg->flags, sizeof(desc->old_tls_cfg->flags));
+		desc->old_tls_cfg->session_cache_size = desc->tls_cfg->session_cache_size;
+		desc->old_tls_cfg->session_timeout = desc->tls_cfg->session_timeout;
+		desc->old_tls_cfg->ticket_key_lifetime = desc->tls_cfg->ticket_key_lifetime;
 	}
 
 	return;
@@ -849,6 +1061,15 @@ void ast_tcptls_server_stop(struct ast_tcptls_session_args *desc)
 	ast_debug(2, "Stopped server :: %s\n", desc->name);
 }
 
+void ast_tls_get_handshake_stats(struct ast_tls_handshake_stats *stats)
+{
+	stats->full = ast_atomic_load_n(&handshake_stats.full, __ATOMIC_RELAXED);
+	stats->resumed = ast_atomic_load_n(&handshake_stats.resumed, __ATOMIC_RELAXED);
+	stats->failed = ast_atomic_load_n(&handshake_stats.failed, __ATOMIC_RELAXED);
+	stats->full_us = ast_atomic_load_n(&handshake_stats.full_us, __ATOMIC_RELAXED);
+	stats->resumed_us = ast_atomic_load_n(&handshake_stats.resumed_us, __ATOMIC_RELAXED);
+}
+
 int ast_tls_read_conf(struct ast_tls_config *tls_cfg, struct ast_tcptls_session_args *tls_desc, const char *varname, const char *value)
 {
 	if (!strcasecmp(varname, "tlsenable") || !strcasecmp(varname, "sslenable")) {
@@ -897,6 +1118,22 @@ int ast_tls_read_conf(struct ast_tls_config *tls_cfg, struct ast_tcptls_session_
 		ast_set2_flag(&tls_cfg->flags, ast_true(value), AST_SSL_DISABLE_TLSV11);
 	} else if (!strcasecmp(varname, "tlsdisablev12")) {
 		ast_set2_flag(&tls_cfg->flags, ast_true(value), AST_SSL_DISABLE_TLSV12);
+	} else if (!strcasecmp(varname, "tlsdisabletickets")) {
+		ast_set2_flag(&tls_cfg->flags, ast_true(value), AST_SSL_DISABLE_TICKETS);
+	} else if (!strcasecmp(varname, "tlsktls")) {
+		ast_set2_flag(&tls_cfg->flags, ast_true(value), AST_SSL_KTLS);
+	} else if (!strcasecmp(varname, "tlssessioncachesize")) {
+		if (ast_parse_arg(value, PARSE_UINT32, &tls_cfg->session_cache_size)) {
+			ast_log(LOG_ERROR, "Invalid %s '%s'\n", varname, value);
+		}
+	} else if (!strcasecmp(varname, "tlssessiontimeout")) {
+		if (ast_parse_arg(value, PARSE_UINT32, &tls_cfg->session_timeout)) {
+			ast_log(LOG_ERROR, "Invalid %s '%s'\n", varname, value);
+		}
+	} else if (!strcasecmp(varname, "tlsticketkeylifetime")) {
+		if (ast_parse_arg(value, PARSE_UINT32, &tls_cfg->ticket_key_lifetime)) {
+			ast_log(LOG_ERROR, "Invalid %s '%s'\n", varname, value);
+		}
 	} else {
 		return -1;
 	}
@@ -31,6 +31,9 @@
 
 #include "asterisk.h"
 
+#include <inttypes.h>
+#include <time.h>
+
 #include "asterisk/_private.h"
 
 #ifdef TEST_FRAMEWORK
@@ -1059,11 +1062,538 @@ static char *test_cli_generate_results(struct ast_cli_entry *e, int cmd, struct
 	return CLI_SUCCESS;
 }
 
+/*! holds all the information pertaining to a single defined benchmark */
+struct ast_bench {
+	struct ast_bench_info info;         /*!< holds benchmark callback information */
+	ast_bench_cb_t *cb;                 /*!< benchmark callback function */
+	void *data;                         /*!< data of the benchmark, from BENCH_SETUP */
+	enum ast_test_result_state state;   /*!< state of the last run */
+	unsigned int runs;                  /*!< timed iterations of the last run */
+	/* Nanoseconds per operation of the last run */
+	uint64_t min;
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t max;
+	AST_LIST_ENTRY(ast_bench) entry;
+};
+
+/*! List of registered benchmark definitions, sorted by category and name */
+static AST_LIST_HEAD_STATIC(benches, ast_bench);
+
+int ast_bench_register(ast_bench_cb_t *cb)
+{
+	struct ast_bench *bench;
+	struct ast_bench *cur;
+
+	if (!cb) {
+		ast_log(LOG_ERROR, "Attempted to register benchmark without all required information\n");
+		return -1;
+	}
+
+	bench = ast_calloc(1, sizeof(*bench));
+	if (!bench) {
+		return -1;
+	}
+	bench->cb = cb;
+	bench->cb(&bench->info, BENCH_INIT, bench);
+
+	if (ast_strlen_zero(bench->info.name) || ast_strlen_zero(bench->info.category)
+		|| ast_strlen_zero(bench->info.summary) || ast_strlen_zero(bench->info.description)) {
+		ast_log(LOG_ERROR, "Benchmark %s%s is missing a name, category, summary or description, registration refused.\n",
+			S_OR(bench->info.category, ""), S_OR(bench->info.name, ""));
+		ast_free(bench);
+		return -1;
+	}
+	if (!bench->info.warmup) {
+		bench->info.warmup = 10;
+	}
+	if (!bench->info.iterations) {
+		bench->info.iterations = 100;
+	}
+	if (!bench->info.operations) {
+		bench->info.operations = 1;
+	}
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&benches, cur, entry) {
+		int i = strcmp(bench->info.category, cur->info.category);
+
+		if (i < 0 || (!i && strcmp(bench->info.name, cur->info.name) < 0)) {
+			AST_LIST_INSERT_BEFORE_CURRENT(bench, entry);
+			bench = NULL;
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	if (bench) {
+		AST_LIST_INSERT_TAIL(&benches, bench, entry);
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	return 0;
+}
+
+int ast_bench_unregister(ast_bench_cb_t *cb)
+{
+	struct ast_bench *bench;
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&benches, bench, entry) {
+		if (bench->cb == cb) {
+			AST_LIST_REMOVE_CURRENT(entry);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_UNLOCK(&benches);
+
+	if (!bench) {
+		return -1;
+	}
+	ast_free(bench);
+
+	return 0;
+}
+
+void ast_bench_set_data(struct ast_bench *bench, void *data)
+{
+	bench->data = data;
+}
+
+void *ast_bench_get_data(struct ast_bench *bench)
+{
+	return bench->data;
+}
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	uint64_t left = *(const uint64_t *) a;
+	uint64_t right = *(const uint64_t *) b;
+
+	return left < right ? -1 : left > right;
+}
+
+/*! \brief Nearest rank percentile of sorted times */
+static uint64_t bench_percentile(const uint64_t *sorted, unsigned int count, unsigned int percent)
+{
+	unsigned int rank = (percent * count + 99) / 100;
+
+	return sorted[rank ? rank - 1 : 0];
+}
+
+/*!
+ * \internal
+ * \brief runs a single benchmark, storing the results in the benchmark
+ */
+static void bench_execute(struct ast_bench *bench)
+{
+	uint64_t *times;
+	uint64_t total = 0;
+	unsigned int i;
+
+	bench->state = AST_TEST_FAIL;
+	bench->runs = 0;
+	bench->data = NULL;
+
+	times = ast_malloc(bench->info.iterations * sizeof(*times));
+	if (!times) {
+		return;
+	}
+
+	if (bench->cb(&bench->info, BENCH_SETUP, bench)) {
+		ast_free(times);
+		return;
+	}
+
+	for (i = 0; i < bench->info.warmup; ++i) {
+		if (bench->cb(&bench->info, BENCH_RUN, bench)) {
+			goto cleanup;
+		}
+	}
+
+	for (i = 0; i < bench->info.iterations; ++i) {
+		uint64_t begin = bench_now_ns();
+
+		if (bench->cb(&bench->info, BENCH_RUN, bench)) {
+			goto cleanup;
+		}
+		times[i] = (bench_now_ns() - begin) / bench->info.operations;
+		total += times[i];
+	}
+
+	qsort(times, bench->info.iterations, sizeof(*times), bench_cmp);
+	bench->runs = bench->info.iterations;
+	bench->min = times[0];
+	bench->mean = total / bench->runs;
+	bench->p50 = bench_percentile(times, bench->runs, 50);
+	bench->p90 = bench_percentile(times, bench->runs, 90);
+	bench->p99 = bench_percentile(times, bench->runs, 99);
+	bench->max = times[bench->runs - 1];
+	bench->state = AST_TEST_PASS;
+
+cleanup:
+	if (bench->cb(&bench->info, BENCH_CLEANUP, bench)) {
+		bench->state = AST_TEST_FAIL;
+	}
+	bench->data = NULL;
+	ast_free(times);
+}
+
+static char *complete_bench_category(const char *word)
+{
+	int wordlen = strlen(word);
+	struct ast_bench *bench;
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		if (!strncasecmp(word, bench->info.category, wordlen)) {
+			if (ast_cli_completion_add(ast_strdup(bench->info.category))) {
+				break;
+			}
+		}
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	return NULL;
+}
+
+static char *complete_bench_name(const char *word, const char *category)
+{
+	int wordlen = strlen(word);
+	struct ast_bench *bench;
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		if (!test_cat_cmp(bench->info.category, category) && !strncasecmp(word, bench->info.name, wordlen)) {
+			if (ast_cli_completion_add(ast_strdup(bench->info.name))) {
+				break;
+			}
+		}
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	return NULL;
+}
+
+/*! \brief Whether a benchmark is picked by 'all', 'category X' or 'category X name Y' arguments */
+static int bench_matches(struct ast_bench *bench, const char *category, const char *name)
+{
+	if (ast_strlen_zero(category)) {
+		return 1;
+	}
+	if (test_cat_cmp(bench->info.category, category)) {
+		return 0;
+	}
+	return ast_strlen_zero(name) || !strcmp(bench->info.name, name);
+}
+
+static char *bench_cli_show_registered(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT_BENCH "%-25.25s %-30.30s %-40.40s %-13.13s\n"
+	static const char * const option1[] = { "all", "category", NULL };
+	static const char * const option2[] = { "name", NULL };
+	struct ast_bench *bench;
+	int count = 0;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test bench show registered";
+		e->usage =
+			"Usage: 'test bench show registered' can be used in three ways.\n"
+			"       1. 'test bench show registered all' shows all registered benchmarks\n"
+			"       2. 'test bench show registered category [category]' shows all benchmarks\n"
+			"          in the given category.\n"
+			"       3. 'test bench show registered category [category] name [name]' shows\n"
+			"          the benchmark in a given category matching a given name\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 4) {
+			return ast_cli_complete(a->word, option1, -1);
+		}
+		if (a->pos == 5 && !strcasecmp(a->argv[4], "category")) {
+			return complete_bench_category(a->word);
+		}
+		if (a->pos == 6) {
+			return ast_cli_complete(a->word, option2, -1);
+		}
+		if (a->pos == 7) {
+			return complete_bench_name(a->word, a->argv[5]);
+		}
+		return NULL;
+	case CLI_HANDLER:
+		if ((a->argc != 5 && a->argc != 6 && a->argc != 8) ||
+			((a->argc == 5) && strcasecmp(a->argv[4], "all")) ||
+			((a->argc >= 6) && strcasecmp(a->argv[4], "category")) ||
+			((a->argc == 8) && strcasecmp(a->argv[6], "name"))) {
+			return CLI_SHOWUSAGE;
+		}
+		ast_cli(a->fd, FORMAT_BENCH, "Category", "Name", "Summary", "Last Result");
+		ast_cli(a->fd, FORMAT_BENCH, "--------", "----", "-------", "-----------");
+		AST_LIST_LOCK(&benches);
+		AST_LIST_TRAVERSE(&benches, bench, entry) {
+			if (bench_matches(bench, a->argc > 5 ? a->argv[5] : NULL, a->argc > 7 ? a->argv[7] : NULL)) {
+				ast_cli(a->fd, FORMAT_BENCH, bench->info.category, bench->info.name,
+					bench->info.summary, test_result2str[bench->state]);
+				count++;
+			}
+		}
+		AST_LIST_UNLOCK(&benches);
+		ast_cli(a->fd, FORMAT_BENCH, "--------", "----", "-------", "-----------");
+		ast_cli(a->fd, "\n%d Registered Benchmarks Matched\n", count);
+	default:
+		return NULL;
+	}
+
+	return CLI_SUCCESS;
+#undef FORMAT_BENCH
+}
+
+static char *bench_cli_run(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT_RUN "%-25.25s %-30.30s %10s %10s %10s %10s %10s %s\n"
+#define FORMAT_RUN_NS "%-25.25s %-30.30s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %s\n"
+	static const char * const option1[] = { "all", "category", NULL };
+	static const char * const option2[] = { "name", NULL };
+	char result_buf[32];
+	struct ast_bench *bench;
+	int count = 0;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test bench run";
+		e->usage =
+			"Usage: 'test bench run' can be used in three ways.\n"
+			"       1. 'test bench run all' runs all registered benchmarks\n"
+			"       2. 'test bench run category [category]' runs all benchmarks in the\n"
+			"          given category.\n"
+			"       3. 'test bench run category [category] name [name]' runs the\n"
+			"          benchmark in a given category matching a given name\n"
+			"       Times are in nanoseconds per operation.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 3) {
+			return ast_cli_complete(a->word, option1, -1);
+		}
+		if (a->pos == 4 && !strcasecmp(a->argv[3], "category")) {
+			return complete_bench_category(a->word);
+		}
+		if (a->pos == 5) {
+			return ast_cli_complete(a->word, option2, -1);
+		}
+		if (a->pos == 6) {
+			return complete_bench_name(a->word, a->argv[4]);
+		}
+		return NULL;
+	case CLI_HANDLER:
+		if ((a->argc != 4 && a->argc != 5 && a->argc != 7) ||
+			((a->argc == 4) && strcasecmp(a->argv[3], "all")) ||
+			((a->argc >= 5) && strcasecmp(a->argv[3], "category")) ||
+			((a->argc == 7) && strcasecmp(a->argv[5], "name"))) {
+			return CLI_SHOWUSAGE;
+		}
+		ast_cli(a->fd, FORMAT_RUN, "Category", "Name", "Min", "Mean", "P50", "P99", "Max", "Result");
+		AST_LIST_LOCK(&benches);
+		AST_LIST_TRAVERSE(&benches, bench, entry) {
+			if (!bench_matches(bench, a->argc > 4 ? a->argv[4] : NULL, a->argc > 6 ? a->argv[6] : NULL)) {
+				continue;
+			}
+			bench_execute(bench);
+			term_color(result_buf, test_result2str[bench->state],
+				(bench->state == AST_TEST_FAIL) ? COLOR_RED : COLOR_GREEN,
+				0, sizeof(result_buf));
+			ast_cli(a->fd, FORMAT_RUN_NS, bench->info.category, bench->info.name,
+				bench->min, bench->mean, bench->p50, bench->p99, bench->max, result_buf);
+			count++;
+		}
+		AST_LIST_UNLOCK(&benches);
+		if (!count) {
+			ast_cli(a->fd, "--- No Benchmarks Found! ---\n");
+		}
+		ast_cli(a->fd, "\n%d Benchmark(s) Run\n", count);
+	default:
+		return NULL;
+	}
+
+	return CLI_SUCCESS;
+#undef FORMAT_RUN
+#undef FORMAT_RUN_NS
+}
+
+/*! \brief Write the results of the benchmarks run as JSON */
+static int bench_generate_json(const char *path)
+{
+	struct ast_json *results;
+	struct ast_json *list;
+	struct ast_bench *bench;
+	int res = 0;
+
+	list = ast_json_array_create();
+	results = ast_json_pack("{s: s, s: o}", "version", ast_get_version(), "benchmarks", list);
+	if (!results) {
+		return -1;
+	}
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		if (bench->state == AST_TEST_NOT_RUN) {
+			continue;
+		}
+		res |= ast_json_array_append(list, ast_json_pack(
+			"{s: s, s: s, s: s, s: I, s: I, s: I, s: I, s: I, s: I, s: I, s: I, s: I}",
+			"category", bench->info.category,
+			"name", bench->info.name,
+			"result", test_result2str[bench->state],
+			"iterations", (ast_json_int_t) bench->runs,
+			"operations", (ast_json_int_t) bench->info.operations,
+			"warmup", (ast_json_int_t) bench->info.warmup,
+			"min_ns", (ast_json_int_t) bench->min,
+			"mean_ns", (ast_json_int_t) bench->mean,
+			"p50_ns", (ast_json_int_t) bench->p50,
+			"p90_ns", (ast_json_int_t) bench->p90,
+			"p99_ns", (ast_json_int_t) bench->p99,
+			"max_ns", (ast_json_int_t) bench->max));
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	if (!res) {
+		res = ast_json_dump_new_file_format(results, path, AST_JSON_PRETTY);
+	}
+	ast_json_unref(results);
+
+	return res;
+}
+
+/*! \brief Write the results of the benchmarks run as JUnit XML, the mean as the time */
+static int bench_generate_junit(const char *path)
+{
+	struct ast_bench *bench;
+	FILE *f;
+
+	if (!(f = fopen(path, "w"))) {
+		ast_log(LOG_WARNING, "Could not open file %s for xml benchmark results\n", path);
+		return -1;
+	}
+
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	fprintf(f, "<testsuites>\n");
+	fprintf(f, "\t<testsuite errors=\"0\" name=\"AsteriskBenchmarks\">\n");
+	fprintf(f, "\t\t<properties>\n");
+	fprintf(f, "\t\t\t<property name=\"version\" value=\"%s\"/>\n", ast_get_version());
+	fprintf(f, "\t\t</properties>\n");
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		if (bench->state == AST_TEST_NOT_RUN) {
+			continue;
+		}
+		fprintf(f, "\t\t<testcase time=\"%.9f\" classname=\"%s\" name=\"%s\">\n",
+			bench->mean / 1000000000.0, bench->info.category, bench->info.name);
+		fprintf(f, "\t\t\t<properties>\n");
+		fprintf(f, "\t\t\t\t<property name=\"iterations\" value=\"%u\"/>\n", bench->runs);
+		fprintf(f, "\t\t\t\t<property name=\"operations\" value=\"%u\"/>\n", bench->info.operations);
+		fprintf(f, "\t\t\t\t<property name=\"min_ns\" value=\"%" PRIu64 "\"/>\n", bench->min);
+		fprintf(f, "\t\t\t\t<property name=\"p50_ns\" value=\"%" PRIu64 "\"/>\n", bench->p50);
+		fprintf(f, "\t\t\t\t<property name=\"p90_ns\" value=\"%" PRIu64 "\"/>\n", bench->p90);
+		fprintf(f, "\t\t\t\t<property name=\"p99_ns\" value=\"%" PRIu64 "\"/>\n", bench->p99);
+		fprintf(f, "\t\t\t\t<property name=\"max_ns\" value=\"%" PRIu64 "\"/>\n", bench->max);
+		fprintf(f, "\t\t\t</properties>\n");
+		if (bench->state == AST_TEST_FAIL) {
+			fprintf(f, "\t\t\t<failure/>\n");
+		}
+		fprintf(f, "\t\t</testcase>\n");
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	fprintf(f, "\t</testsuite>\n");
+	fprintf(f, "</testsuites>\n");
+	fclose(f);
+
+	return 0;
+}
+
+static char *bench_cli_generate_results(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	static const char * const option[] = { "json", "junit", NULL };
+	const char *file = NULL;
+	int isjson;
+	int res;
+	struct ast_str *buf = NULL;
+	struct timeval time = ast_tvnow();
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test bench generate results";
+		e->usage =
+			"Usage: 'test bench generate results'\n"
+			"       Generates the results of the benchmarks last run, in either json or\n"
+			"       junit xml format. An optional file path may be provided to specify\n"
+			"       the location of the file\n"
+			"       \nExample usage:\n"
+			"       'test bench generate results json' this writes to a default file\n"
+			"       'test bench generate results junit /path/to/file.xml' writes to specified file\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 4) {
+			return ast_cli_complete(a->word, option, -1);
+		}
+		return NULL;
+	case CLI_HANDLER:
+		if (a->argc < 5 || a->argc > 6) {
+			return CLI_SHOWUSAGE;
+		} else if (!strcasecmp(a->argv[4], "json")) {
+			isjson = 1;
+		} else if (!strcasecmp(a->argv[4], "junit")) {
+			isjson = 0;
+		} else {
+			return CLI_SHOWUSAGE;
+		}
+
+		if (a->argc == 6) {
+			file = a->argv[5];
+		} else {
+			if (!(buf = ast_str_create(256))) {
+				return NULL;
+			}
+			ast_str_set(&buf, 0, "%s/asterisk_bench_results-%ld.%s", ast_config_AST_LOG_DIR,
+				(long) time.tv_sec, isjson ? "json" : "xml");
+
+			file = ast_str_buffer(buf);
+		}
+
+		res = isjson ? bench_generate_json(file) : bench_generate_junit(file);
+		if (!res) {
+			ast_cli(a->fd, "Results Generated Successfully: %s\n", file);
+		} else {
+			ast_cli(a->fd, "Results Could Not Be Generated: %s\n", file);
+		}
+
+		ast_free(buf);
+	default:
+		return NULL;
+	}
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry test_cli[] = {
 	AST_CLI_DEFINE(test_cli_show_registered,           "show registered tests"),
 	AST_CLI_DEFINE(test_cli_execute_registered,        "execute registered tests"),
 	AST_CLI_DEFINE(test_cli_show_results,              "show last test results"),
 	AST_CLI_DEFINE(test_cli_generate_results,          "generate test results to file"),
+	AST_CLI_DEFINE(bench_cli_show_registered,          "show registered benchmarks"),
+	AST_CLI_DEFINE(bench_cli_run,                      "run registered benchmarks"),
+	AST_CLI_DEFINE(bench_cli_generate_results,         "generate benchmark results to file"),
 };
 
 struct stasis_topic *ast_test_suite_topic(void)
@@ -23,10 +23,39 @@
 #include "asterisk/taskprocessor.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/utils.h"
+#include "asterisk/dlinkedlists.h"
+#include "asterisk/vector.h"
 
 /* Needs to stay prime if increased */
 #define THREAD_BUCKETS 89
 
+/*!
+ * \brief A task queued in a work-stealing threadpool
+ */
+struct ws_task {
+	/*! The task to execute */
+	int (*execute)(void *data);
+	/*! The data to pass to the task */
+	void *data;
+	/*! Links to the neighboring tasks in the deque */
+	AST_DLLIST_ENTRY(ws_task) list;
+};
+
+/*!
+ * \brief A per-thread task deque used by work-stealing threadpools
+ *
+ * The owning workers take tasks from the head of the deque while
+ * idle workers stealing from it take tasks from the tail.
+ */
+struct ws_deque {
+	/*! Lock protecting the tasks in the deque */
+	ast_mutex_t lock;
+	/*! Number of tasks in the deque */
+	int size;
+	/*! The queued tasks */
+	AST_DLLIST_HEAD_NOLOCK(, ws_task) tasks;
+};
+
 /*!
  * \brief An opaque threadpool structure
  *
@@ -98,6 +127,22 @@ struct ast_threadpool {
 	int shutting_down;
 	/*! Threadpool-specific options */
 	struct ast_threadpool_options options;
+	/*!
+	 * \brief Per-thread task deques
+	 *
+	 * Only allocated when the work_stealing option is set. In that
+	 * case tasks pushed into the pool are queued here rather than in
+	 * the main taskprocessor.
+	 */
+	struct ws_deque *deques;
+	/*! The number of deques */
+	unsigned int num_deques;
+	/*! Round-robin position for tasks pushed from outside of the pool */
+	int next_deque;
+	/*! Round-robin position of the deque the next thread of the pool owns */
+	int next_home;
+	/*! The number of tasks queued across all of the deques */
+	int ws_size;
 };
 
 /*!
@@ -157,6 +202,8 @@ struct worker_thread {
 	int wake_up;
 	/*! Options for this threadpool */
 	struct ast_threadpool_options options;
+	/*! Index of the deque this thread owns in a work-stealing threadpool */
+	unsigned int home;
 };
 
 /* Worker thread forward declarations. See definitions for documentation */
@@ -170,6 +217,8 @@ static int worker_thread_start(struct worker_thread *worker);
 static int worker_idle(struct worker_thread *worker);
 static int worker_set_state(struct worker_thread *worker, enum worker_state state);
 static void worker_shutdown(struct worker_thread *worker);
+static int activate_thread(void *obj, void *arg, int flags);
+static void threadpool_emptied(struct ast_threadpool *pool);
 
 /*!
  * \brief Notify the threadpool listener that the state has changed.
@@ -239,6 +288,16 @@ static int queued_active_thread_idle(void *data)
 	ao2_link(pair->pool->idle_threads, pair->worker);
 	ao2_unlink(pair->pool->active_threads, pair->worker);
 
+	/*
+	 * A work-stealing pool only wakes threads when it sees no idle
+	 * threads are available. Tasks pushed while this worker was on its
+	 * way to becoming idle would otherwise sit in the deques.
+	 */
+	if (pair->pool->deques && ast_atomic_fetchadd_int(&pair->pool->ws_size, 0) > 0) {
+		ao2_callback(pair->pool->idle_threads, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA,
+				activate_thread, pair->pool);
+	}
+
 	threadpool_send_state_changed(pair->pool);
 
 	thread_worker_pair_free(pair);
@@ -349,18 +408,119 @@ static void threadpool_idle_thread_dead(struct ast_threadpool *pool,
 	}
 }
 
+/*!
+ * \brief Take the oldest task from a work-stealing deque
+ *
+ * \param deque The deque owned by the calling worker
+ * \retval NULL The deque is empty
+ * \retval non-NULL The task to run
+ */
+static struct ws_task *ws_deque_pop(struct ws_deque *deque)
+{
+	struct ws_task *task;
+
+	if (!ast_atomic_fetchadd_int(&deque->size, 0)) {
+		return NULL;
+	}
+
+	ast_mutex_lock(&deque->lock);
+	task = AST_DLLIST_REMOVE_HEAD(&deque->tasks, list);
+	if (task) {
+		--deque->size;
+	}
+	ast_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/*!
+ * \brief Steal the newest task from another worker's deque
+ *
+ * Stealing from the tail keeps thieves away from the end of the deque
+ * that its owners are working through.
+ *
+ * \param deque The deque to steal from
+ * \retval NULL The deque is empty
+ * \retval non-NULL The task to run
+ */
+static struct ws_task *ws_deque_steal(struct ws_deque *deque)
+{
+	struct ws_task *task;
+
+	if (!ast_atomic_fetchadd_int(&deque->size, 0)) {
+		return NULL;
+	}
+
+	ast_mutex_lock(&deque->lock);
+	task = AST_DLLIST_REMOVE_TAIL(&deque->tasks, list);
+	if (task) {
+		--deque->size;
+	}
+	ast_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/*!
+ * \brief Execute a task in a work-stealing threadpool
+ *
+ * The worker's own deque is checked first. If it is empty the other
+ * deques are visited in turn and a task is stolen from the first one
+ * that has any.
+ *
+ * \param worker The worker executing the task
+ * \retval 0 Either the pool has been shut down or there are no tasks.
+ * \retval 1 A task was executed and more may remain in the pool.
+ */
+static int threadpool_ws_execute(struct worker_thread *worker)
+{
+	struct ast_threadpool *pool = worker->pool;
+	struct ws_task *task;
+	unsigned int i;
+	int emptied;
+
+	/* Shutdown is also noticed by the worker's state change so a stale read is harmless */
+	if (pool->shutting_down) {
+		return 0;
+	}
+
+	task = ws_deque_pop(&pool->deques[worker->home]);
+	for (i = 1; !task && i < pool->num_deques; ++i) {
+		task = ws_deque_steal(&pool->deques[(worker->home + i) % pool->num_deques]);
+	}
+	if (!task) {
+		return 0;
+	}
+
+	emptied = ast_atomic_dec_and_test(&pool->ws_size);
+
+	task->execute(task->data);
+	ast_free(task);
+
+	if (emptied) {
+		threadpool_emptied(pool);
+	}
+	return 1;
+}
+
 /*!
  * \brief Execute a task in the threadpool
  *
  * This is the function that worker threads call in order to execute tasks
  * in the threadpool
  *
- * \param pool The pool to which the tasks belong.
+ * \param worker The worker thread executing the task.
  * \retval 0 Either the pool has been shut down or there are no tasks.
  * \retval 1 There are still tasks remaining in the pool.
  */
-static int threadpool_execute(struct ast_threadpool *pool)
+static int threadpool_execute(struct worker_thread *worker)
 {
+	struct ast_threadpool *pool = worker->pool;
+
+	if (pool->deques) {
+		return threadpool_ws_execute(worker);
+	}
+
 	ao2_lock(pool);
 	if (!pool->shutting_down) {
 		ao2_unlock(pool);
@@ -370,6 +530,8 @@ static int threadpool_execute(struct ast_threadpool *pool)
 	return 0;
 }
 
+static int execute_tasks(void *data);
+
 /*!
  * \brief Destroy a threadpool's components.
  *
@@ -386,7 +548,28 @@ static int threadpool_execute(struct ast_threadpool *pool)
 static void threadpool_destructor(void *obj)
 {
 	struct ast_threadpool *pool = obj;
+	unsigned int i;
+
 	ao2_cleanup(pool->listener);
+
+	if (pool->deques) {
+		/*
+		 * Like the taskprocessor, tasks still queued at this point are discarded,
+		 * but the reference a serializer execution holds is released.
+		 */
+		for (i = 0; i < pool->num_deques; ++i) {
+			struct ws_task *task;
+
+			while ((task = AST_DLLIST_REMOVE_HEAD(&pool->deques[i].tasks, list))) {
+				if (task->execute == execute_tasks) {
+					ast_taskprocessor_unreference(task->data);
+				}
+				ast_free(task);
+			}
+			ast_mutex_destroy(&pool->deques[i].lock);
+		}
+		ast_free(pool->deques);
+	}
 }
 
 /*
@@ -437,6 +620,20 @@ static struct ast_threadpool *threadpool_alloc(const char *name, const struct as
 	}
 	pool->options = *options;
 
+	if (options->work_stealing) {
+		unsigned int i;
+
+		pool->num_deques = MAX(options->max_size > 0 ? options->max_size : options->initial_size, 1);
+		pool->deques = ast_calloc(pool->num_deques, sizeof(*pool->deques));
+		if (!pool->deques) {
+			return NULL;
+		}
+		for (i = 0; i < pool->num_deques; ++i) {
+			ast_mutex_init(&pool->deques[i].lock);
+			AST_DLLIST_HEAD_INIT_NOLOCK(&pool->deques[i].tasks);
+		}
+	}
+
 	ao2_ref(pool, +1);
 	return pool;
 }
@@ -454,17 +651,20 @@ struct task_pushed_data {
 	struct ast_threadpool *pool;
 	/*! Indicator of whether the pool had no tasks prior to the new task being added */
 	int was_empty;
+	/*! The number of tasks pushed */
+	size_t count;
 };
 
 /*!
  * \brief Allocate and initialize a task_pushed_data
  * \param pool The threadpool to set in the task_pushed_data
  * \param was_empty The was_empty value to set in the task_pushed_data
+ * \param count The count value to set in the task_pushed_data
  * \retval NULL Unable to allocate task_pushed_data
  * \retval non-NULL The newly-allocated task_pushed_data
  */
 static struct task_pushed_data *task_pushed_data_alloc(struct ast_threadpool *pool,
-		int was_empty)
+		int was_empty, size_t count)
 {
 	struct task_pushed_data *tpd = ast_malloc(sizeof(*tpd));
 
@@ -473,6 +673,7 @@ static struct task_pushed_data *task_pushed_data_alloc(struct ast_threadpool *po
 	}
 	tpd->pool = pool;
 	tpd->was_empty = was_empty;
+	tpd->count = count;
 	return tpd;
 }
 
@@ -556,8 +757,11 @@ static void grow(struct ast_threadpool *pool, int delta)
  * \brief Queued task called when tasks are pushed into the threadpool
  *
  * This function first calls into the threadpool's listener to let it know
- * that a task has been pushed. It then wakes up all idle threads and moves
- * them into the active thread container.
+ * that tasks have been pushed, once for each of them. It then wakes up all
+ * idle threads and moves them into the active thread container.
+ *
+ * A batch of tasks grows the pool as much as pushing each of them would have:
+ * the idle threads take the first task, and every other task grows the pool.
  * \param data A task_pushed_data
  * \return 0
  */
@@ -566,12 +770,17 @@ static int queued_task_pushed(void *data)
 	struct task_pushed_data *tpd = data;
 	struct ast_threadpool *pool = tpd->pool;
 	int was_empty = tpd->was_empty;
+	size_t count = tpd->count;
 	unsigned int existing_active;
+	size_t grow_count;
+	size_t i;
 
 	ast_free(tpd);
 
 	if (pool->listener && pool->listener->callbacks->task_pushed) {
-		pool->listener->callbacks->task_pushed(pool, pool->listener, was_empty);
+		for (i = 0; i < count; ++i) {
+			pool->listener->callbacks->task_pushed(pool, pool->listener, was_empty && !i);
+		}
 	}
 
 	existing_active = ao2_container_count(pool->active_threads);
@@ -588,7 +797,12 @@ static int queued_task_pushed(void *data)
 		if (!pool->options.auto_increment) {
 			return 0;
 		}
-		grow(pool, pool->options.auto_increment);
+		grow_count = count;
+	} else {
+		grow_count = count - 1;
+	}
+	if (grow_count && pool->options.auto_increment) {
+		grow(pool, MIN(grow_count * pool->options.auto_increment, INT_MAX));
 		/* An optional second pass transitions any newly added threads. */
 		ao2_callback(pool->idle_threads, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA,
 				activate_thread, pool);
@@ -598,6 +812,8 @@ static int queued_task_pushed(void *data)
 	return 0;
 }
 
+static void threadpool_task_pushed(struct ast_threadpool *pool, int was_empty, size_t count);
+
 /*!
  * \brief Taskprocessor listener callback called when a task is added
  *
@@ -610,7 +826,33 @@ static int queued_task_pushed(void *data)
 static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listener,
 		int was_empty)
 {
-	struct ast_threadpool *pool = ast_taskprocessor_listener_get_user_data(listener);
+	threadpool_task_pushed(ast_taskprocessor_listener_get_user_data(listener), was_empty, 1);
+}
+
+/*!
+ * \brief Taskprocessor listener callback called when a batch of tasks is added
+ *
+ * Only a single control task is queued for the whole batch, which notifies
+ * the threadpool listener and grows the pool for each of the tasks.
+ * \param listener The taskprocessor listener. The threadpool is the listener's private data
+ * \param was_empty True if the taskprocessor was empty prior to the tasks being pushed
+ * \param count The number of tasks pushed
+ */
+static void threadpool_tps_task_batch_pushed(struct ast_taskprocessor_listener *listener,
+		int was_empty, size_t count)
+{
+	threadpool_task_pushed(ast_taskprocessor_listener_get_user_data(listener), was_empty, count);
+}
+
+/*!
+ * \brief Queue a task pushed notification on the control taskprocessor
+ *
+ * \param pool The threadpool that had a task pushed
+ * \param was_empty True if the pool had no tasks prior to the tasks being pushed
+ * \param count The number of tasks pushed
+ */
+static void threadpool_task_pushed(struct ast_threadpool *pool, int was_empty, size_t count)
+{
 	struct task_pushed_data *tpd;
 	SCOPED_AO2LOCK(lock, pool);
 
@@ -618,7 +860,7 @@ static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listen
 		return;
 	}
 
-	tpd = task_pushed_data_alloc(pool, was_empty);
+	tpd = task_pushed_data_alloc(pool, was_empty, count);
 	if (!tpd) {
 		return;
 	}
@@ -653,7 +895,16 @@ static int queued_emptied(void *data)
  */
 static void threadpool_tps_emptied(struct ast_taskprocessor_listener *listener)
 {
-	struct ast_threadpool *pool = ast_taskprocessor_listener_get_user_data(listener);
+	threadpool_emptied(ast_taskprocessor_listener_get_user_data(listener));
+}
+
+/*!
+ * \brief Queue an emptied notification on the control taskprocessor
+ *
+ * \param pool The threadpool that has become empty
+ */
+static void threadpool_emptied(struct ast_threadpool *pool)
+{
 	SCOPED_AO2LOCK(lock, pool);
 
 	if (pool->shutting_down) {
@@ -697,6 +948,7 @@ static struct ast_taskprocessor_listener_callbacks threadpool_tps_listener_callb
 	.task_pushed = threadpool_tps_task_pushed,
 	.emptied = threadpool_tps_emptied,
 	.shutdown = threadpool_tps_shutdown,
+	.task_batch_pushed = threadpool_tps_task_batch_pushed,
 };
 
 /*!
@@ -953,13 +1205,106 @@ struct ast_threadpool *ast_threadpool_create(const char *name,
 	return pool;
 }
 
+AST_THREADSTORAGE_RAW(current_worker);
+
+/*!
+ * \brief Push tasks into a work-stealing threadpool
+ *
+ * The pool lock is only needed when threads have to be woken up or
+ * added, so the common case of pushing into a busy pool only touches
+ * the lock of the chosen deques.
+ */
+static int threadpool_ws_push_batch(struct ast_threadpool *pool,
+		const struct ast_taskprocessor_task *tasks, size_t count)
+{
+	struct worker_thread *worker = ast_threadstorage_get_ptr(&current_worker);
+	struct ws_task *task;
+	AST_DLLIST_HEAD_NOLOCK(, ws_task) batch = AST_DLLIST_HEAD_NOLOCK_INIT_VALUE;
+	int previous;
+	size_t i;
+
+	if (pool->shutting_down) {
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i) {
+		task = ast_malloc(sizeof(*task));
+		if (!task) {
+			while ((task = AST_DLLIST_REMOVE_HEAD(&batch, list))) {
+				ast_free(task);
+			}
+			return -1;
+		}
+		task->execute = tasks[i].task_exe;
+		task->data = tasks[i].datap;
+		AST_DLLIST_INSERT_TAIL(&batch, task, list);
+	}
+
+	/* Counted before they can be popped, so the size never goes below 0 */
+	previous = ast_atomic_fetchadd_int(&pool->ws_size, count);
+
+	while ((task = AST_DLLIST_REMOVE_HEAD(&batch, list))) {
+		struct ws_deque *deque;
+
+		if (worker && worker->pool == pool) {
+			deque = &pool->deques[worker->home];
+		} else {
+			deque = &pool->deques[(unsigned int) ast_atomic_fetchadd_int(&pool->next_deque, 1)
+				% pool->num_deques];
+		}
+
+		ast_mutex_lock(&deque->lock);
+		AST_DLLIST_INSERT_TAIL(&deque->tasks, task, list);
+		++deque->size;
+		ast_mutex_unlock(&deque->lock);
+	}
+
+	if (!previous
+		|| ao2_container_count(pool->idle_threads)
+		|| (pool->options.auto_increment
+			&& previous >= ao2_container_count(pool->active_threads))) {
+		threadpool_task_pushed(pool, !previous, count);
+	}
+
+	return 0;
+}
+
 int ast_threadpool_push(struct ast_threadpool *pool, int (*task)(void *data), void *data)
 {
-	SCOPED_AO2LOCK(lock, pool);
+	int res = -1;
+
+	if (pool->deques) {
+		struct ast_taskprocessor_task ws_task = {
+			.task_exe = task,
+			.datap = data,
+		};
+
+		return threadpool_ws_push_batch(pool, &ws_task, 1);
+	}
+
+	ao2_lock(pool);
 	if (!pool->shutting_down) {
-		return ast_taskprocessor_push(pool->tps, task, data);
+		res = ast_taskprocessor_push(pool->tps, task, data);
 	}
-	return -1;
+	ao2_unlock(pool);
+	return res;
+}
+
+int ast_threadpool_push_batch(struct ast_threadpool *pool,
+		const struct ast_taskprocessor_task *tasks, size_t count)
+{
+	int res = -1;
+
+	if (pool->deques) {
+		return count ? threadpool_ws_push_batch(pool, tasks, count) : 0;
+	}
+
+	ao2_lock(pool);
+	if (!pool->shutting_down) {
+		res = ast_taskprocessor_push_batch(pool->tps, tasks, count);
+	}
+	ao2_unlock(pool);
+	return res;
 }
 
 void ast_threadpool_shutdown(struct ast_threadpool *pool)
@@ -1050,6 +1395,8 @@ static void *worker_start(void *arg)
 		worker->options.thread_start();
 	}
 
+	ast_threadstorage_set_ptr(&current_worker, worker);
+
 	ast_mutex_lock(&worker->lock);
 	while (worker_idle(worker)) {
 		ast_mutex_unlock(&worker->lock);
@@ -1075,6 +1422,8 @@ static void *worker_start(void *arg)
 		threadpool_zombie_thread_dead(worker->pool, worker);
 	}
 
+	ast_threadstorage_set_ptr(&current_worker, NULL);
+
 	if (worker->options.thread_end) {
 		worker->options.thread_end();
 	}
@@ -1103,6 +1452,9 @@ static struct worker_thread *worker_thread_alloc(struct ast_threadpool *pool)
 	worker->thread = AST_PTHREADT_NULL;
 	worker->state = ALIVE;
 	worker->options = pool->options;
+	if (pool->deques) {
+		worker->home = (unsigned int) ast_atomic_fetchadd_int(&pool->next_home, 1) % pool->num_deques;
+	}
 	return worker;
 }
 
@@ -1134,7 +1486,7 @@ static void worker_active(struct worker_thread *worker)
 	 * optimize the code away.
 	 */
 	do {
-		alive = threadpool_execute(worker->pool);
+		alive = threadpool_execute(worker);
 	} while (alive);
 }
 
@@ -1346,6 +1698,24 @@ static struct serializer *serializer_create(struct ast_threadpool *pool,
 
 AST_THREADSTORAGE_RAW(current_serializer);
 
+/*! A serializer waiting for its execution to be pushed to its threadpool */
+struct deferred_serializer {
+	/*! The threadpool the serializer executes in */
+	struct ast_threadpool *pool;
+	/*! The serializer. Its reference is owned by the execution task. */
+	struct ast_taskprocessor *tps;
+};
+
+/*! Serializer executions deferred by ast_threadpool_serializer_batch_begin() */
+struct serializer_batch {
+	/*! Nesting depth of the batch */
+	unsigned int depth;
+	/*! Serializers needing execution, in the order their tasks were pushed */
+	AST_VECTOR(, struct deferred_serializer) deferred;
+};
+
+AST_THREADSTORAGE_RAW(current_serializer_batch);
+
 static int execute_tasks(void *data)
 {
 	struct ast_taskprocessor *tps = data;
@@ -1365,6 +1735,18 @@ static void serializer_task_pushed(struct ast_taskprocessor_listener *listener,
 	if (was_empty) {
 		struct serializer *ser = ast_taskprocessor_listener_get_user_data(listener);
 		struct ast_taskprocessor *tps = ast_taskprocessor_listener_get_tps(listener);
+		struct serializer_batch *batch = ast_threadstorage_get_ptr(&current_serializer_batch);
+
+		if (batch) {
+			struct deferred_serializer deferred = {
+				.pool = ser->pool,
+				.tps = tps,
+			};
+
+			if (!AST_VECTOR_APPEND(&batch->deferred, deferred)) {
+				return;
+			}
+		}
 
 		if (ast_threadpool_push(ser->pool, execute_tasks, tps)) {
 			ast_taskprocessor_unreference(tps);
@@ -1372,6 +1754,76 @@ static void serializer_task_pushed(struct ast_taskprocessor_listener *listener,
 	}
 }
 
+static void serializer_task_batch_pushed(struct ast_taskprocessor_listener *listener,
+	int was_empty, size_t count)
+{
+	/* Only the transition from empty matters to a serializer */
+	serializer_task_pushed(listener, was_empty);
+}
+
+void ast_threadpool_serializer_batch_begin(void)
+{
+	struct serializer_batch *batch = ast_threadstorage_get_ptr(&current_serializer_batch);
+
+	if (!batch) {
+		batch = ast_calloc(1, sizeof(*batch));
+		if (!batch) {
+			/* Serializers will simply be scheduled individually */
+			return;
+		}
+		ast_threadstorage_set_ptr(&current_serializer_batch, batch);
+	}
+	++batch->depth;
+}
+
+void ast_threadpool_serializer_batch_end(void)
+{
+	struct serializer_batch *batch = ast_threadstorage_get_ptr(&current_serializer_batch);
+	struct ast_taskprocessor_task *tasks;
+	size_t start;
+	size_t i;
+
+	if (!batch || --batch->depth) {
+		return;
+	}
+	ast_threadstorage_set_ptr(&current_serializer_batch, NULL);
+
+	tasks = ast_malloc(AST_VECTOR_SIZE(&batch->deferred) * sizeof(*tasks));
+
+	/* Push each run of serializers sharing a threadpool as one batch */
+	for (start = 0; start < AST_VECTOR_SIZE(&batch->deferred); start = i) {
+		struct ast_threadpool *pool = AST_VECTOR_GET_ADDR(&batch->deferred, start)->pool;
+		size_t count = 0;
+
+		for (i = start; i < AST_VECTOR_SIZE(&batch->deferred)
+			&& AST_VECTOR_GET_ADDR(&batch->deferred, i)->pool == pool; ++i) {
+			struct ast_taskprocessor *tps = AST_VECTOR_GET_ADDR(&batch->deferred, i)->tps;
+
+			if (!tasks) {
+				if (ast_threadpool_push(pool, execute_tasks, tps)) {
+					ast_taskprocessor_unreference(tps);
+				}
+				continue;
+			}
+			tasks[count].task_exe = execute_tasks;
+			tasks[count].datap = tps;
+			++count;
+		}
+
+		if (count && ast_threadpool_push_batch(pool, tasks, count)) {
+			size_t j;
+
+			for (j = 0; j < count; ++j) {
+				ast_taskprocessor_unreference(tasks[j].datap);
+			}
+		}
+	}
+
+	ast_free(tasks);
+	AST_VECTOR_FREE(&batch->deferred);
+	ast_free(batch);
+}
+
 static int serializer_start(struct ast_taskprocessor_listener *listener)
 {
 	/* No-op */
@@ -1392,6 +1844,7 @@ static struct ast_taskprocessor_listener_callbacks serializer_tps_listener_callb
 	.task_pushed = serializer_task_pushed,
 	.start = serializer_start,
 	.shutdown = serializer_shutdown,
+	.task_batch_pushed = serializer_task_batch_pushed,
 };
 
 struct ast_taskprocessor *ast_threadpool_serializer_get_current(void)
@@ -1416,6 +1869,8 @@ struct ast_taskprocessor *ast_threadpool_serializer_group(const char *name,
 		ao2_ref(ser, -1);
 		return NULL;
 	}
+	/* Only one execute_tasks() is ever queued in the pool for a serializer */
+	ast_taskprocessor_listener_set_single_consumer(listener);
 
 	tps = ast_taskprocessor_create_with_listener(name, listener);
 	if (!tps) {
@@ -1436,5 +1891,8 @@ struct ast_taskprocessor *ast_threadpool_serializer(const char *name, struct ast
 
 long ast_threadpool_queue_size(struct ast_threadpool *pool)
 {
+	if (pool->deques) {
+		return ast_atomic_fetchadd_int(&pool->ws_size, 0);
+	}
 	return ast_taskprocessor_size(pool->tps);
 }
@@ -0,0 +1,279 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Trace spans of the stages of calls
+ *
+ * Every thread recording spans is given a ring of them. The ring of a
+ * thread that exits is kept, with its spans, for the next thread to take
+ * over, so that the spans of threads which only lived for a call are still
+ * there to be exported.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <time.h>
+
+#include "asterisk/_private.h"
+#include "asterisk/cli.h"
+#include "asterisk/json.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/lock.h"
+#include "asterisk/strings.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/trace_span.h"
+#include "asterisk/utils.h"
+
+/*! \brief Spans kept by each thread */
+#define SPAN_RING_SIZE 1024
+
+/*! \brief Longest id of a span kept, longer ones are truncated */
+#define SPAN_ID_LEN 64
+
+/*! \brief A recorded span */
+struct trace_span {
+	/*! \brief The stage, a string constant */
+	const char *name;
+	/*! \brief Nanoseconds the span started at */
+	uint64_t start;
+	/*! \brief Nanoseconds the span ended at */
+	uint64_t end;
+	/*! \brief What the span is of */
+	char id[SPAN_ID_LEN];
+};
+
+/*! \brief The spans of a thread */
+struct trace_span_ring {
+	/*! \brief Held by the thread while recording, and while exporting */
+	ast_mutex_t lock;
+	/*! \brief The thread recording into the ring */
+	int tid;
+	/*! \brief Whether a thread is recording into the ring */
+	int in_use;
+	/*! \brief Spans recorded in all, the next one goes at count % SPAN_RING_SIZE */
+	unsigned int count;
+	struct trace_span spans[SPAN_RING_SIZE];
+	AST_LIST_ENTRY(trace_span_ring) list;
+};
+
+/*! \brief Every ring, in use by a thread or not */
+static AST_LIST_HEAD_STATIC(span_rings, trace_span_ring);
+
+int ast_trace_spans_enabled;
+
+/*! \brief Take a ring no thread uses, or make a new one */
+static int span_thread_init(void *data)
+{
+	struct trace_span_ring **thread_ring = data;
+	struct trace_span_ring *ring;
+
+	AST_LIST_LOCK(&span_rings);
+	AST_LIST_TRAVERSE(&span_rings, ring, list) {
+		if (!ring->in_use) {
+			break;
+		}
+	}
+	if (!ring) {
+		ring = ast_calloc(1, sizeof(*ring));
+		if (!ring) {
+			AST_LIST_UNLOCK(&span_rings);
+			return -1;
+		}
+		ast_mutex_init(&ring->lock);
+		AST_LIST_INSERT_TAIL(&span_rings, ring, list);
+	}
+	ring->in_use = 1;
+	ring->tid = ast_get_tid();
+	AST_LIST_UNLOCK(&span_rings);
+
+	*thread_ring = ring;
+
+	return 0;
+}
+
+/*! \brief Leave the ring of an exiting thread to the next thread */
+static void span_thread_cleanup(void *data)
+{
+	struct trace_span_ring **thread_ring = data;
+
+	if (*thread_ring) {
+		AST_LIST_LOCK(&span_rings);
+		(*thread_ring)->in_use = 0;
+		AST_LIST_UNLOCK(&span_rings);
+	}
+	ast_free(data);
+}
+
+AST_THREADSTORAGE_CUSTOM(span_thread, span_thread_init, span_thread_cleanup);
+
+uint64_t ast_trace_span_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void ast_trace_span_record(const char *name, const char *id, uint64_t start, uint64_t end)
+{
+	struct trace_span_ring **thread_ring = ast_threadstorage_get(&span_thread, sizeof(*thread_ring));
+	struct trace_span_ring *ring;
+	struct trace_span *span;
+
+	if (!thread_ring) {
+		return;
+	}
+	ring = *thread_ring;
+
+	ast_mutex_lock(&ring->lock);
+	span = &ring->spans[ring->count++ % SPAN_RING_SIZE];
+	span->name = name;
+	span->start = start;
+	span->end = end;
+	ast_copy_string(span->id, S_OR(id, ""), sizeof(span->id));
+	ast_mutex_unlock(&ring->lock);
+}
+
+/*!
+ * \brief Write out the spans of every ring in the Chrome trace event format
+ *
+ * \return The number of spans written, or -1 on error
+ */
+static int trace_spans_export(const char *path)
+{
+	struct ast_json *events = ast_json_array_create();
+	struct ast_json *trace;
+	struct trace_span_ring *ring;
+	int pid = getpid();
+	int written = 0;
+	int res = 0;
+
+	trace = ast_json_pack("{s: o, s: s}", "traceEvents", events, "displayTimeUnit", "ns");
+	if (!trace) {
+		return -1;
+	}
+
+	AST_LIST_LOCK(&span_rings);
+	AST_LIST_TRAVERSE(&span_rings, ring, list) {
+		unsigned int i;
+		unsigned int first;
+
+		ast_mutex_lock(&ring->lock);
+		first = ring->count > SPAN_RING_SIZE ? ring->count - SPAN_RING_SIZE : 0;
+		for (i = first; i < ring->count && !res; ++i) {
+			struct trace_span *span = &ring->spans[i % SPAN_RING_SIZE];
+
+			/* Timestamps of the format are in microseconds */
+			res = ast_json_array_append(events, ast_json_pack("{s: s, s: s, s: s, s: f, s: f, s: i, s: i, s: {s: s}}",
+				"name", span->name,
+				"cat", "call",
+				"ph", span->end == span->start ? "i" : "X",
+				"ts", span->start / 1000.0,
+				"dur", (span->end - span->start) / 1000.0,
+				"pid", pid,
+				"tid", ring->tid,
+				"args", "id", span->id));
+			written++;
+		}
+		ast_mutex_unlock(&ring->lock);
+	}
+	AST_LIST_UNLOCK(&span_rings);
+
+	if (!res) {
+		res = ast_json_dump_new_file(trace, path);
+	}
+	ast_json_unref(trace);
+
+	return res ? -1 : written;
+}
+
+static char *handle_cli_trace_spans_set(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core set trace spans {on|off}";
+		e->usage =
+			"Usage: core set trace spans {on|off}\n"
+			"       Enables or disables recording the spans of the stages of calls.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_trace_spans_enabled = ast_true(a->argv[4]);
+	ast_cli(a->fd, "Trace spans %s\n", ast_trace_spans_enabled ? "enabled" : "disabled");
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_trace_spans_export(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int written;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core trace spans export";
+		e->usage =
+			"Usage: core trace spans export <file>\n"
+			"       Writes the spans recorded to the file, in the Chrome trace event\n"
+			"       format loaded by trace viewers such as Perfetto and chrome://tracing.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 5) {
+		return CLI_SHOWUSAGE;
+	}
+
+	written = trace_spans_export(a->argv[4]);
+	if (written < 0) {
+		ast_cli(a->fd, "Unable to write the trace spans to %s\n", a->argv[4]);
+		return CLI_FAILURE;
+	}
+	ast_cli(a->fd, "Wrote %d trace spans to %s\n", written, a->argv[4]);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_trace_spans[] = {
+	AST_CLI_DEFINE(handle_cli_trace_spans_set, "Enable or disable trace spans"),
+	AST_CLI_DEFINE(handle_cli_trace_spans_export, "Export the trace spans recorded"),
+};
+
+static void trace_span_shutdown(void)
+{
+	ast_cli_unregister_multiple(cli_trace_spans, ARRAY_LEN(cli_trace_spans));
+	ast_trace_spans_enabled = 0;
+}
+
+int ast_trace_span_init(void)
+{
+	ast_cli_register_multiple(cli_trace_spans, ARRAY_LEN(cli_trace_spans));
+	ast_register_cleanup(trace_span_shutdown);
+
+	return 0;
+}
@@ -33,6 +33,7 @@
 #include <sys/resource.h>
 #include <math.h>
 
+#include "asterisk/_private.h"
 #include "asterisk/lock.h"
 #include "asterisk/channel.h"
 #include "asterisk/translate.h"
@@ -43,6 +44,7 @@
 #include "asterisk/term.h"
 #include "asterisk/format.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/astobj2.h"
 
 /*! \todo
  * TODO: sample frames for each supported input format.
@@ -82,9 +84,27 @@ static struct translator_path **__matrix;
  */
 static unsigned int *__indextable;
 
-/*! protects the __indextable for resizing */
+/*!
+ * \brief table for converting codec id values to index values.
+ *
+ * Holds the index plus one, so zero means the codec is not indexed.
+ *
+ * \note this table is protected by the table_lock.
+ */
+static int *__codecindex;
+
+/*! the number of codec ids the __codecindex can hold */
+static unsigned int codecindex_size;
+
+/*! protects the __indextable and __codecindex for resizing */
 static ast_rwlock_t tablelock;
 
+/*! the most released translator descriptors kept for reuse by a translator */
+#define MAX_POOLED_PVTS 32
+
+/*! protects the pools of released translator descriptors */
+AST_MUTEX_DEFINE_STATIC(pvt_pool_lock);
+
 /* index size starts at this*/
 #define INIT_INDEX 32
 /* index size grows by this as necessary */
@@ -103,18 +123,14 @@ static void matrix_rebuild(int samples);
  */
 static int codec_to_index(unsigned int id)
 {
-	int x;
+	int x = -1; /* not found */
 
 	ast_rwlock_rdlock(&tablelock);
-	for (x = 0; x < cur_max_index; x++) {
-		if (__indextable[x] == id) {
-			/* format already exists in index2format table */
-			ast_rwlock_unlock(&tablelock);
-			return x;
-		}
+	if (id < codecindex_size) {
+		x = __codecindex[id] - 1;
 	}
 	ast_rwlock_unlock(&tablelock);
-	return -1; /* not found */
+	return x;
 }
 
 /*!
@@ -156,8 +172,21 @@ static int add_codec2index(struct ast_codec *codec)
 		ast_rwlock_unlock(&tablelock);
 		return -1; /* hit max length */
 	}
+	if (codec->id >= codecindex_size) {
+		unsigned int new_size = codec->id + GROW_INDEX;
+		int *tmp_codecindex = ast_realloc(__codecindex, sizeof(int) * new_size);
+
+		if (!tmp_codecindex) {
+			ast_rwlock_unlock(&tablelock);
+			return -1;
+		}
+		memset(tmp_codecindex + codecindex_size, 0, sizeof(int) * (new_size - codecindex_size));
+		__codecindex = tmp_codecindex;
+		codecindex_size = new_size;
+	}
 	__indextable[cur_max_index] = codec->id;
 	cur_max_index++;
+	__codecindex[codec->id] = cur_max_index;
 	ast_rwlock_unlock(&tablelock);
 
 	return 0;
@@ -288,6 +317,101 @@ static struct translator_path *matrix_get(unsigned int x, unsigned int y)
  * wrappers around the translator routines.
  */
 
+/*!
+ * \internal
+ * \brief Get the size of the descriptor allocation for a translator
+ */
+static int pvt_size(struct ast_translator *t)
+{
+	/*
+	 * compute the required size adding private descriptor,
+	 * buffer, AST_FRIENDLY_OFFSET.
+	 */
+	int len = sizeof(struct ast_trans_pvt) + t->desc_size;
+
+	if (t->buf_size) {
+		len += AST_FRIENDLY_OFFSET + t->buf_size;
+	}
+	return len;
+}
+
+/*!
+ * \internal
+ * \brief Take a released descriptor allocation from a translator's pool
+ *
+ * \return zeroed allocation, or NULL if the pool is empty
+ */
+static struct ast_trans_pvt *pvt_pool_get(struct ast_translator *t)
+{
+	struct ast_trans_pvt *pvt;
+
+	ast_mutex_lock(&pvt_pool_lock);
+	pvt = t->pvt_pool;
+	if (pvt) {
+		t->pvt_pool = pvt->next;
+		--t->pvt_pool_count;
+	}
+	ast_mutex_unlock(&pvt_pool_lock);
+
+	if (pvt) {
+		memset(pvt, 0, pvt_size(t));
+	}
+	return pvt;
+}
+
+/*!
+ * \internal
+ * \brief Keep a released descriptor allocation for reuse by its translator
+ *
+ * \note Only translators without a destroy callback hold no other
+ * resources in their descriptors, so only those are pooled.
+ *
+ * \retval 0 if the allocation was pooled
+ * \retval -1 if it must be freed
+ */
+static int pvt_pool_put(struct ast_trans_pvt *pvt)
+{
+	struct ast_translator *t = pvt->t;
+	int res = -1;
+
+	if (t->destroy) {
+		return -1;
+	}
+
+	ast_mutex_lock(&pvt_pool_lock);
+	if (t->pvt_pool_count < MAX_POOLED_PVTS) {
+		pvt->next = t->pvt_pool;
+		t->pvt_pool = pvt;
+		++t->pvt_pool_count;
+		res = 0;
+	}
+	ast_mutex_unlock(&pvt_pool_lock);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Free the released descriptor allocations pooled by a translator
+ */
+static void pvt_pool_drain(struct ast_translator *t)
+{
+	struct ast_trans_pvt *pvt;
+
+	ast_mutex_lock(&pvt_pool_lock);
+	pvt = t->pvt_pool;
+	t->pvt_pool = NULL;
+	t->pvt_pool_count = 0;
+	ast_mutex_unlock(&pvt_pool_lock);
+
+	while (pvt) {
+		struct ast_trans_pvt *next = pvt->next;
+
+		ast_free(pvt);
+		pvt = next;
+	}
+}
+
 static void destroy(struct ast_trans_pvt *pvt)
 {
 	struct ast_translator *t = pvt->t;
@@ -300,10 +424,62 @@ static void destroy(struct ast_trans_pvt *pvt)
 		ao2_ref(pvt->explicit_dst, -1);
 		pvt->explicit_dst = NULL;
 	}
-	ast_free(pvt);
+	ao2_cleanup(pvt->completed);
+	pvt->completed = NULL;
+	if (pvt_pool_put(pvt)) {
+		ast_free(pvt);
+	}
 	ast_module_unref(t->module);
 }
 
+/*! \brief Frames translated by an accelerator, waiting to be given out */
+struct ast_trans_completed {
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+};
+
+static void completed_destroy(void *obj)
+{
+	struct ast_trans_completed *completed = obj;
+	struct ast_frame *f;
+
+	while ((f = AST_LIST_REMOVE_HEAD(&completed->frames, frame_list))) {
+		ast_frfree(f);
+	}
+}
+
+int ast_trans_complete(struct ast_trans_pvt *pvt, struct ast_frame *f)
+{
+	struct ast_frame *dup;
+
+	if (!pvt->completed) {
+		return -1;
+	}
+
+	dup = ast_frdup(f);
+	if (!dup) {
+		return -1;
+	}
+
+	ao2_lock(pvt->completed);
+	AST_LIST_INSERT_TAIL(&pvt->completed->frames, dup, frame_list);
+	ao2_unlock(pvt->completed);
+
+	return 0;
+}
+
+/*! \brief frameout of accelerated translators, giving out all completed frames */
+static struct ast_frame *completed_frameout(struct ast_trans_pvt *pvt)
+{
+	struct ast_frame *result;
+
+	ao2_lock(pvt->completed);
+	result = AST_LIST_FIRST(&pvt->completed->frames);
+	AST_LIST_HEAD_INIT_NOLOCK(&pvt->completed->frames);
+	ao2_unlock(pvt->completed);
+
+	return result;
+}
+
 /*!
  * \brief Allocate the descriptor, required outbuf space,
  * and possibly desc.
@@ -311,19 +487,14 @@ static void destroy(struct ast_trans_pvt *pvt)
 static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format *explicit_dst)
 {
 	struct ast_trans_pvt *pvt;
-	int len;
 	char *ofs;
 
-	/*
-	 * compute the required size adding private descriptor,
-	 * buffer, AST_FRIENDLY_OFFSET.
-	 */
-	len = sizeof(*pvt) + t->desc_size;
-	if (t->buf_size)
-		len += AST_FRIENDLY_OFFSET + t->buf_size;
-	pvt = ast_calloc(1, len);
+	pvt = pvt_pool_get(t);
 	if (!pvt) {
-		return NULL;
+		pvt = ast_calloc(1, pvt_size(t));
+		if (!pvt) {
+			return NULL;
+		}
 	}
 	pvt->t = t;
 	ofs = (char *)(pvt + 1);	/* pointer to data space */
@@ -341,10 +512,21 @@ static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format
 	 */
 	pvt->explicit_dst = ao2_bump(explicit_dst);
 
+	if (t->submit) {
+		pvt->completed = ao2_alloc(sizeof(*pvt->completed), completed_destroy);
+		if (!pvt->completed) {
+			ao2_cleanup(pvt->explicit_dst);
+			ast_free(pvt);
+			return NULL;
+		}
+	}
+
 	ast_module_ref(t->module);
 
 	/* call local init routine, if present */
 	if (t->newpvt && t->newpvt(pvt)) {
+		ao2_cleanup(pvt->completed);
+		ao2_cleanup(pvt->explicit_dst);
 		ast_free(pvt);
 		ast_module_unref(t->module);
 		return NULL;
@@ -424,6 +606,24 @@ static int framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	return pvt->t->framein(pvt, f);
 }
 
+/*! \brief Hand a list of frames to the accelerator of a translator at once */
+static int submit(struct ast_trans_pvt *pvt, struct ast_frame *frames)
+{
+	struct ast_frame *last = frames;
+
+	while (AST_LIST_NEXT(last, frame_list)) {
+		last = AST_LIST_NEXT(last, frame_list);
+	}
+
+	/* Copy the last in jb timing info to the pvt */
+	ast_copy_flags(&pvt->f, last, AST_FRFLAG_HAS_TIMING_INFO);
+	pvt->f.ts = last->ts;
+	pvt->f.len = last->len;
+	pvt->f.seqno = last->seqno;
+
+	return pvt->t->submit(pvt, frames);
+}
+
 /*! \brief generic frameout routine.
  * If samples and datalen are 0, take whatever is in pvt
  * and reset them, otherwise take the values in the caller and
@@ -505,7 +705,21 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 		if ((t->dst_codec.sample_rate == ast_format_get_sample_rate(dst)) && (t->dst_codec.type == ast_format_get_type(dst))) {
 			explicit_dst = dst;
 		}
-		if (!(cur = newpvt(t, explicit_dst))) {
+		cur = newpvt(t, explicit_dst);
+		if (!cur && t->submit) {
+			struct ast_translator *u;
+
+			/* The accelerator has no room left, use any other translator for the step */
+			AST_RWLIST_TRAVERSE(&translators, u, list) {
+				if (u != t && u->active && u->src_fmt_index == t->src_fmt_index
+					&& u->dst_fmt_index == t->dst_fmt_index
+					&& (cur = newpvt(u, explicit_dst))) {
+					ast_debug(1, "Translator '%s' unavailable, using '%s'\n", t->name, u->name);
+					break;
+				}
+			}
+		}
+		if (!cur) {
 			ast_log(LOG_WARNING, "Failed to build translator step from %s to %s\n",
 				ast_format_get_name(src), ast_format_get_name(dst));
 			ast_translator_free_path(head);
@@ -556,15 +770,47 @@ static struct ast_frame *generate_interpolated_slin(struct ast_trans_pvt *p, str
 }
 
 /*! \brief do the actual translation */
+/*!
+ * \internal
+ * \brief Determine if the output of a translation path only depends on its input
+ *
+ * \details Translators without a private descriptor or callbacks to set one up
+ * convert each frame on its own, so the same input always gives the same output.
+ */
+static int translator_path_is_stateless(const struct ast_trans_pvt *path)
+{
+	for (; path; path = path->next) {
+		const struct ast_translator *t = path->t;
+
+		if (t->newpvt || t->destroy || t->feedback || t->desc_size || t->native_plc) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*! \internal \brief Get the format a translation path produces */
+static struct ast_format *translator_path_dst(const struct ast_trans_pvt *path)
+{
+	while (path->next) {
+		path = path->next;
+	}
+
+	return path->f.subclass.format;
+}
+
 struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f, int consume)
 {
 	struct ast_trans_pvt *p = path;
-	struct ast_frame *out;
+	struct ast_frame *out = NULL;
 	struct timeval delivery;
+	uint64_t ingress;
 	int has_timing_info;
 	long ts;
 	long len;
 	int seqno;
+	int shared;
 
 	if (f->frametype == AST_FRAME_RTCP) {
 		/* Just pass the feedback to the right callback, if it exists.
@@ -605,17 +851,31 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 			 f->samples, ast_format_get_sample_rate(f->subclass.format)));
 	}
 	delivery = f->delivery;
-	for (out = f; out && p ; p = p->next) {
+	ingress = f->ingress;
+	shared = f->frametype == AST_FRAME_VOICE && f->datalen
+		&& ast_frame_is_shared(f) && translator_path_is_stateless(path);
+	if (shared && (out = ast_frame_shared_translation_get(f, translator_path_dst(path)))) {
+		/* Another channel already translated the same data the same way. */
+		p = NULL;
+	}
+	for (out = out ?: f; out && p ; p = p->next) {
 		struct ast_frame *current = out;
 
-		do {
-			framein(p, current);
-			current = AST_LIST_NEXT(current, frame_list);
-		} while (current);
+		if (p->t->submit) {
+			submit(p, current);
+		} else {
+			do {
+				framein(p, current);
+				current = AST_LIST_NEXT(current, frame_list);
+			} while (current);
+		}
 		if (out != f) {
 			ast_frfree(out);
 		}
 		out = p->t->frameout(p);
+		if (out && !p->next && shared) {
+			ast_frame_shared_translation_set(f, out);
+		}
 	}
 
 	if (!out) {
@@ -623,6 +883,13 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 	}
 
 	if (out) {
+		struct ast_frame *stamped;
+
+		/* Frames out of the path carry on the media they were made from */
+		for (stamped = out; stamped; stamped = AST_LIST_NEXT(stamped, frame_list)) {
+			stamped->ingress = ingress;
+		}
+
 		/* we have a frame, play with times */
 		if (!ast_tvzero(delivery)) {
 			struct ast_frame *current = out;
@@ -695,6 +962,14 @@ static void generate_computational_cost(struct ast_translator *t, int seconds)
 	}
 
 	/* If they don't make samples, give them a terrible score */
+	if (t->submit) {
+		/* Accelerated, the work is not done here to be timed */
+		if (!t->comp_cost) {
+			t->comp_cost = 1;
+		}
+		return;
+	}
+
 	if (!t->sample) {
 		ast_debug(3, "Translator '%s' does not produce sample frames.\n", t->name);
 		t->comp_cost = 999999;
@@ -973,7 +1248,8 @@ static void handle_cli_recalc(struct ast_cli_args *a)
 		ast_cli(a->fd, "         Maximum limit of recalc exceeded by %d, truncating value to %d\n", time - MAX_RECALC, MAX_RECALC);
 		time = MAX_RECALC;
 	}
-	ast_cli(a->fd, "         Recalculating Codec Translation (number of sample seconds: %d)\n\n", time);
+	ast_cli(a->fd, "         Recalculating Codec Translation (number of sample seconds: %d)\n", time);
+	ast_cli(a->fd, "         Using %s G.711 conversion\n\n", ast_g711_name());
 	AST_RWLIST_WRLOCK(&translators);
 	matrix_rebuild(time);
 	AST_RWLIST_UNLOCK(&translators);
@@ -1285,7 +1561,9 @@ int __ast_register_translator(struct ast_translator *t, struct ast_module *mod)
 		t->buf_size = ((t->buf_size + align - 1) / align) * align;
 	}
 
-	if (t->frameout == NULL) {
+	if (t->submit) {
+		t->frameout = completed_frameout;
+	} else if (t->frameout == NULL) {
 		t->frameout = default_frameout;
 	}
 
@@ -1349,6 +1627,10 @@ int ast_unregister_translator(struct ast_translator *t)
 
 	AST_RWLIST_UNLOCK(&translators);
 
+	if (found) {
+		pvt_pool_drain(t);
+	}
+
 	return (u ? 0 : -1);
 }
 
@@ -1605,6 +1887,9 @@ static void translate_shutdown(void)
 	__matrix = NULL;
 	ast_free(__indextable);
 	__indextable = NULL;
+	ast_free(__codecindex);
+	__codecindex = NULL;
+	codecindex_size = 0;
 	ast_rwlock_unlock(&tablelock);
 	ast_rwlock_destroy(&tablelock);
 }
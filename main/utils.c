@@ -34,6 +34,9 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 #if defined(__APPLE__)
 #include <mach/mach.h>
 #elif defined(HAVE_SYS_THR_H)
@@ -1193,6 +1196,106 @@ static struct ast_cli_entry utils_cli[] = {
 #endif /* ! LOW_MEMORY */
 #endif /* DEBUG_THREADS */
 
+#if !defined(LOW_MEMORY)
+/*! Places shown by 'core show lock profile' unless told otherwise */
+#define LOCK_PROFILE_SHOW_DEFAULT 20
+
+static char *handle_set_lock_profile(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int rate;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core set lock profile";
+		e->usage =
+			"Usage: core set lock profile {off|<rate>}\n"
+			"       Sample the contention of one mutex or rwlock acquisition in\n"
+			"<rate>, and forget what was sampled before.  Use 'off' to stop.\n";
+		return NULL;
+
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 5) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!strcasecmp(a->argv[4], "off")) {
+		rate = 0;
+	} else if (sscanf(a->argv[4], "%30u", &rate) != 1 || !rate) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_lock_profile_set_rate(rate);
+	if (rate) {
+		ast_cli(a->fd, "Sampling one lock acquisition in %u\n", rate);
+	} else {
+		ast_cli(a->fd, "Lock profiling disabled\n");
+	}
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_show_lock_profile(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_lock_profile_site *sites;
+	char location[160];
+	int limit = LOCK_PROFILE_SHOW_DEFAULT;
+	int count;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show lock profile";
+		e->usage =
+			"Usage: core show lock profile [<limit>]\n"
+			"       Show the places that waited longest for locks while lock\n"
+			"profiling is enabled, at most <limit> of them (default 20).\n";
+		return NULL;
+
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc == 5) {
+		if (sscanf(a->argv[4], "%30d", &limit) != 1 || limit <= 0) {
+			return CLI_SHOWUSAGE;
+		}
+	} else if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!ast_lock_profile_get_rate()) {
+		ast_cli(a->fd, "Lock profiling is disabled, see 'core set lock profile'\n");
+	}
+
+	sites = ast_malloc(sizeof(*sites) * limit);
+	if (!sites) {
+		return CLI_FAILURE;
+	}
+	count = ast_lock_profile_collect(sites, limit);
+
+	ast_cli(a->fd, "%-10s %-10s %-12s %-12s %-50s %s\n",
+		"Samples", "Contended", "Wait(us)", "MaxWait(us)", "Location", "Lock");
+	for (i = 0; i < count; ++i) {
+		snprintf(location, sizeof(location), "%s:%d %s()",
+			sites[i].file, sites[i].line, sites[i].func);
+		ast_cli(a->fd, "%-10u %-10u %-12" PRIu64 " %-12" PRIu64 " %-50s %s\n",
+			sites[i].samples, sites[i].contended, sites[i].wait_us,
+			sites[i].max_wait_us, location, sites[i].name);
+	}
+	ast_free(sites);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry lock_profile_cli[] = {
+	AST_CLI_DEFINE(handle_set_lock_profile, "Enable or disable lock contention sampling"),
+	AST_CLI_DEFINE(handle_show_lock_profile, "Show the places waiting longest for locks"),
+};
+#endif /* ! LOW_MEMORY */
+
 #if !defined(LOW_MEMORY)
 /*
  * support for 'show threads'. The start routine is wrapped by
@@ -1337,6 +1440,84 @@ int ast_pthread_create_detached_stack(pthread_t *thread, pthread_attr_t *attr, v
 	return res;
 }
 
+#if defined(__linux__)
+/*! \brief The CPUs media threads are bound to */
+static cpu_set_t media_cpus;
+/*! \brief The number of CPUs media threads are bound to, 0 when not bound */
+static int media_cpus_count;
+#endif
+
+int ast_set_media_cpus(const char *cpus)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	char *list;
+	char *range;
+
+	if (ast_strlen_zero(cpus)) {
+		media_cpus_count = 0;
+		return 0;
+	}
+
+	CPU_ZERO(&set);
+	list = ast_strdupa(cpus);
+	while ((range = strsep(&list, ","))) {
+		unsigned int first;
+		unsigned int last;
+		int end = 0;
+
+		range = ast_strip(range);
+		if (sscanf(range, "%u-%u%n", &first, &last, &end) == 2 && !range[end]) {
+			/* A range of CPUs */
+		} else if (sscanf(range, "%u%n", &first, &end) == 1 && !range[end]) {
+			last = first;
+		} else {
+			return -1;
+		}
+		if (first > last || last >= CPU_SETSIZE) {
+			return -1;
+		}
+		for (; first <= last; ++first) {
+			CPU_SET(first, &set);
+		}
+	}
+
+	media_cpus = set;
+	media_cpus_count = CPU_COUNT(&set);
+	return 0;
+#else
+	return ast_strlen_zero(cpus) ? 0 : -1;
+#endif
+}
+
+int ast_media_cpus_count(void)
+{
+#if defined(__linux__)
+	return media_cpus_count;
+#else
+	return 0;
+#endif
+}
+
+void ast_thread_bind_media_cpus(void)
+{
+#if defined(__linux__)
+	static int warned;
+	int res;
+
+	if (!media_cpus_count) {
+		return;
+	}
+
+	res = pthread_setaffinity_np(pthread_self(), sizeof(media_cpus), &media_cpus);
+	if (res && !warned) {
+		/* Once is enough, every call would fail the same way */
+		warned = 1;
+		ast_log(LOG_WARNING, "Unable to bind media thread to the media_cpus: %s\n", strerror(res));
+	}
+#endif
+}
+
 int ast_wait_for_input(int fd, int ms)
 {
 	struct pollfd pfd[1];
@@ -2185,6 +2366,9 @@ static void utils_shutdown(void)
 #if defined(DEBUG_THREADS) && !defined(LOW_MEMORY)
 	ast_cli_unregister_multiple(utils_cli, ARRAY_LEN(utils_cli));
 #endif
+#if !defined(LOW_MEMORY)
+	ast_cli_unregister_multiple(lock_profile_cli, ARRAY_LEN(lock_profile_cli));
+#endif
 }
 
 int ast_utils_init(void)
@@ -2195,6 +2379,9 @@ int ast_utils_init(void)
 #if !defined(LOW_MEMORY)
 	ast_cli_register_multiple(utils_cli, ARRAY_LEN(utils_cli));
 #endif
+#endif
+#if !defined(LOW_MEMORY)
+	ast_cli_register_multiple(lock_profile_cli, ARRAY_LEN(lock_profile_cli));
 #endif
 	ast_register_cleanup(utils_shutdown);
 	return 0;
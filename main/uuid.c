@@ -31,6 +31,7 @@
 #include "asterisk/strings.h"
 #include "asterisk/logger.h"
 #include "asterisk/lock.h"
+#include "asterisk/threadstorage.h"
 
 AST_MUTEX_DEFINE_STATIC(uuid_lock);
 
@@ -40,6 +41,141 @@ struct ast_uuid {
 	uuid_t uu;
 };
 
+/*! \brief ChaCha20 blocks generated by a thread before its key is read again */
+#define UUID_RESEED_BLOCKS (1 << 16)
+
+/*!
+ * \brief The random number generator of a thread
+ *
+ * Random UUIDs are taken from the ChaCha20 keystream of a key read from
+ * /dev/urandom by each thread, so that generating them needs neither a
+ * lock nor a system call. Each block of the keystream makes four UUIDs.
+ */
+struct uuid_generator {
+	uint32_t key[8];
+	uint64_t counter;
+	/*! \brief The keystream block UUIDs are taken from */
+	unsigned char block[64];
+	/*! \brief Bytes of the block already used */
+	unsigned int used;
+	/*! \brief Whether the key was read, else libuuid is used */
+	unsigned int seeded:1;
+};
+
+AST_THREADSTORAGE(uuid_generator_storage);
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define CHACHA_QUARTERROUND(x, a, b, c, d) \
+	do { \
+		x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 16); \
+		x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 12); \
+		x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 8); \
+		x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 7); \
+	} while (0)
+
+/*!
+ * \internal
+ * \brief Read a new key for the generator of a thread
+ *
+ * \retval 0 on success
+ * \retval -1 if /dev/urandom could not be read
+ */
+static int uuid_generator_seed(struct uuid_generator *generator)
+{
+	int fd;
+	ssize_t res;
+
+	fd = open("/dev/urandom", O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	res = read(fd, generator->key, sizeof(generator->key));
+	close(fd);
+	if (res != sizeof(generator->key)) {
+		return -1;
+	}
+
+	generator->counter = 0;
+	generator->used = sizeof(generator->block);
+	generator->seeded = 1;
+
+	return 0;
+}
+
+/*! \internal \brief Make the next block of the keystream of a generator */
+static void uuid_generator_block(struct uuid_generator *generator)
+{
+	static const uint32_t sigma[4] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+	uint32_t input[16];
+	uint32_t x[16];
+	int i;
+
+	memcpy(input, sigma, sizeof(sigma));
+	memcpy(input + 4, generator->key, sizeof(generator->key));
+	input[12] = (uint32_t) generator->counter;
+	input[13] = (uint32_t) (generator->counter >> 32);
+	input[14] = 0;
+	input[15] = 0;
+	memcpy(x, input, sizeof(x));
+
+	for (i = 0; i < 10; ++i) {
+		CHACHA_QUARTERROUND(x, 0, 4, 8, 12);
+		CHACHA_QUARTERROUND(x, 1, 5, 9, 13);
+		CHACHA_QUARTERROUND(x, 2, 6, 10, 14);
+		CHACHA_QUARTERROUND(x, 3, 7, 11, 15);
+		CHACHA_QUARTERROUND(x, 0, 5, 10, 15);
+		CHACHA_QUARTERROUND(x, 1, 6, 11, 12);
+		CHACHA_QUARTERROUND(x, 2, 7, 8, 13);
+		CHACHA_QUARTERROUND(x, 3, 4, 9, 14);
+	}
+	for (i = 0; i < 16; ++i) {
+		x[i] += input[i];
+	}
+
+	/* The byte order does not matter for random bytes */
+	memcpy(generator->block, x, sizeof(generator->block));
+	generator->used = 0;
+	generator->counter++;
+}
+
+/*!
+ * \internal
+ * \brief Generate a random UUID from the generator of the thread
+ *
+ * \retval 0 on success
+ * \retval -1 if the thread has no generator
+ */
+static int uuid_generator_random(struct ast_uuid *uuid)
+{
+	struct uuid_generator *generator;
+
+	generator = ast_threadstorage_get(&uuid_generator_storage, sizeof(*generator));
+	if (!generator) {
+		return -1;
+	}
+
+	if (!generator->seeded || generator->counter >= UUID_RESEED_BLOCKS) {
+		if (uuid_generator_seed(generator)) {
+			return -1;
+		}
+	}
+	if (generator->used + sizeof(uuid->uu) > sizeof(generator->block)) {
+		uuid_generator_block(generator);
+	}
+
+	memcpy(uuid->uu, generator->block + generator->used, sizeof(uuid->uu));
+	/* Don't leave the bytes used around to be read back */
+	memset(generator->block + generator->used, 0, sizeof(uuid->uu));
+	generator->used += sizeof(uuid->uu);
+
+	/* Version 4, variant RFC 4122, as section 4.4 of RFC 4122 has them. */
+	uuid->uu[6] = (uuid->uu[6] & 0x0f) | 0x40;
+	uuid->uu[8] = (uuid->uu[8] & 0x3f) | 0x80;
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Generate a UUID.
@@ -107,7 +243,14 @@ static void generate_uuid(struct ast_uuid *uuid)
 	 *
 	 * Given these drawbacks, we stick to only using random UUIDs. The chance of /dev/random
 	 * or /dev/urandom not existing on systems in this age is next to none.
+	 *
+	 * The random UUIDs are made by the generator of the thread, seeded from
+	 * /dev/urandom, since libuuid reads /dev/urandom for every UUID. libuuid
+	 * is only used when there is no /dev/urandom to seed it from.
 	 */
+	if (has_dev_urandom && !uuid_generator_random(uuid)) {
+		return;
+	}
 
 	/* XXX Currently, we only protect this call if the user has no /dev/urandom on their system.
 	 * If it turns out that there are issues with UUID generation despite the presence of
@@ -135,9 +278,22 @@ struct ast_uuid *ast_uuid_generate(void)
 
 char *ast_uuid_to_str(struct ast_uuid *uuid, char *buf, size_t size)
 {
+	static const char hex[] = "0123456789abcdef";
+	char *pos = buf;
+	int i;
+
 	ast_assert(size >= AST_UUID_STR_LEN);
-	uuid_unparse(uuid->uu, buf);
-	return ast_str_to_lower(buf);
+
+	for (i = 0; i < sizeof(uuid->uu); ++i) {
+		if (i == 4 || i == 6 || i == 8 || i == 10) {
+			*pos++ = '-';
+		}
+		*pos++ = hex[uuid->uu[i] >> 4];
+		*pos++ = hex[uuid->uu[i] & 0x0f];
+	}
+	*pos = '\0';
+
+	return buf;
 }
 
 char *ast_uuid_generate_str(char *buf, size_t size)
@@ -37,6 +37,7 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/xmldoc.h"
 #include "asterisk/cli.h"
+#include "asterisk/vector.h"
 
 #ifdef AST_XML_DOCS
 
@@ -50,13 +51,32 @@ static const int xmldoc_text_columns = 79;
 /*! \brief XML documentation language. */
 static char documentation_language[6];
 
+/*! \brief Buckets of the index of a documentation tree */
+#define XMLDOC_INDEX_BUCKETS 2053
+
 /*! \brief XML documentation tree */
 struct documentation_tree {
 	char *filename;					/*!< XML document filename. */
 	struct ast_xml_doc *doc;			/*!< Open document pointer. */
+	struct ao2_container *index;			/*!< The items of the document by type and name. */
 	AST_RWLIST_ENTRY(documentation_tree) entry;
 };
 
+/*!
+ * \brief The items of a documentation tree of a type and name
+ *
+ * Looking an item up by walking the document reads the name attribute of
+ * every item in it, which made registering the thousands of documented
+ * applications, functions and manager actions take a walk of the whole
+ * document each.
+ */
+struct documentation_index_entry {
+	/*! The items, which are not empty, in document order */
+	AST_VECTOR(, struct ast_xml_node *) nodes;
+	/*! The type and name, as type/name */
+	char key[0];
+};
+
 static char *xmldoc_get_syntax_cmd(struct ast_xml_node *fixnode, const char *name, int printname);
 static int xmldoc_parse_enumlist(struct ast_xml_node *fixnode, const char *tabs, struct ast_str **buffer);
 static void xmldoc_parse_parameter(struct ast_xml_node *fixnode, const char *tabs, struct ast_str **buffer);
@@ -437,22 +457,26 @@ static struct ast_xml_node *xmldoc_get_node(const char *type, const char *name,
 	struct ast_xml_node *first_match = NULL;
 	struct ast_xml_node *lang_match = NULL;
 	struct documentation_tree *doctree;
+	char *key;
+
+	if (ast_asprintf(&key, "%s/%s", type, name) < 0) {
+		return NULL;
+	}
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		struct documentation_index_entry *index_entry;
+		int i;
+
 		/* the core xml documents have priority over thirdparty document. */
-		node = ast_xml_get_root(doctree->doc);
-		if (!node) {
-			break;
+		index_entry = ao2_find(doctree->index, key, OBJ_SEARCH_KEY);
+		if (!index_entry) {
+			continue;
 		}
 
-		node = ast_xml_node_get_children(node);
-		while ((node = ast_xml_find_element(node, type, "name", name))) {
-			if (!ast_xml_node_get_children(node)) {
-				/* ignore empty nodes */
-				node = ast_xml_node_get_next(node);
-				continue;
-			}
+		node = NULL;
+		for (i = 0; i < AST_VECTOR_SIZE(&index_entry->nodes); ++i) {
+			node = AST_VECTOR_GET(&index_entry->nodes, i);
 
 			if (!first_match) {
 				first_match = node;
@@ -475,8 +499,9 @@ static struct ast_xml_node *xmldoc_get_node(const char *type, const char *name,
 				}
 			}
 
-			node = ast_xml_node_get_next(node);
+			node = NULL;
 		}
+		ao2_ref(index_entry, -1);
 
 		/* if we matched lang and module return this match */
 		if (node) {
@@ -498,6 +523,7 @@ static struct ast_xml_node *xmldoc_get_node(const char *type, const char *name,
 		}
 	}
 	AST_RWLIST_UNLOCK(&xmldoc_tree);
+	ast_free(key);
 
 	return node;
 }
@@ -2858,6 +2884,115 @@ static char *handle_dump_docs(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 
 static struct ast_cli_entry cli_dump_xmldocs = AST_CLI_DEFINE(handle_dump_docs, "Dump the XML docs to the specified file");
 
+static void documentation_index_entry_destructor(void *obj)
+{
+	struct documentation_index_entry *index_entry = obj;
+
+	AST_VECTOR_FREE(&index_entry->nodes);
+}
+
+static int documentation_index_entry_hash(const void *obj, const int flags)
+{
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		key = ((const struct documentation_index_entry *) obj)->key;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return ast_str_hash(key);
+}
+
+static int documentation_index_entry_cmp(void *obj, void *arg, int flags)
+{
+	struct documentation_index_entry *left = obj;
+	const char *right_key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		right_key = arg;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		right_key = ((struct documentation_index_entry *) arg)->key;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return strcmp(left->key, right_key) ? 0 : CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Index the items of a documentation tree by type and name
+ *
+ * \retval NULL on error
+ * \return The index
+ */
+static struct ao2_container *xmldoc_build_index(struct ast_xml_node *root_node)
+{
+	struct ao2_container *index;
+	struct ast_xml_node *node;
+
+	index = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, XMLDOC_INDEX_BUCKETS,
+		documentation_index_entry_hash, NULL, documentation_index_entry_cmp);
+	if (!index) {
+		return NULL;
+	}
+
+	for (node = ast_xml_node_get_children(root_node); node; node = ast_xml_node_get_next(node)) {
+		struct documentation_index_entry *index_entry;
+		const char *name;
+		char *key;
+
+		if (!ast_xml_node_get_children(node)) {
+			/* Empty nodes, and anything but elements, are never looked up */
+			continue;
+		}
+		name = ast_xml_get_attribute(node, "name");
+		if (!name) {
+			continue;
+		}
+		if (ast_asprintf(&key, "%s/%s", ast_xml_node_get_name(node), name) < 0) {
+			ast_xml_free_attr(name);
+			ao2_ref(index, -1);
+			return NULL;
+		}
+		ast_xml_free_attr(name);
+
+		index_entry = ao2_find(index, key, OBJ_SEARCH_KEY);
+		if (!index_entry) {
+			index_entry = ao2_alloc_options(sizeof(*index_entry) + strlen(key) + 1,
+				documentation_index_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+			if (!index_entry || AST_VECTOR_INIT(&index_entry->nodes, 1)) {
+				ao2_cleanup(index_entry);
+				ast_free(key);
+				ao2_ref(index, -1);
+				return NULL;
+			}
+			strcpy(index_entry->key, key); /* Safe */
+			ao2_link(index, index_entry);
+		}
+		ast_free(key);
+		if (AST_VECTOR_APPEND(&index_entry->nodes, node)) {
+			ao2_ref(index_entry, -1);
+			ao2_ref(index, -1);
+			return NULL;
+		}
+		ao2_ref(index_entry, -1);
+	}
+
+	return index;
+}
+
 /*! \brief Close and unload XML documentation. */
 static void xmldoc_unload_documentation(void)
 {
@@ -2868,6 +3003,7 @@ static void xmldoc_unload_documentation(void)
 	AST_RWLIST_WRLOCK(&xmldoc_tree);
 	while ((doctree = AST_RWLIST_REMOVE_HEAD(&xmldoc_tree, entry))) {
 		ast_free(doctree->filename);
+		ao2_cleanup(doctree->index);
 		ast_xml_close(doctree->doc);
 		ast_free(doctree);
 	}
@@ -2980,6 +3116,13 @@ int ast_xmldoc_load_documentation(void)
 			ast_xml_close(tmpdoc);
 			continue;
 		}
+		doc_tree->index = xmldoc_build_index(root_node);
+		if (!doc_tree->index) {
+			ast_log(LOG_ERROR, "Unable to index documentation at '%s'\n", globbuf.gl_pathv[i]);
+			ast_free(doc_tree);
+			ast_xml_close(tmpdoc);
+			continue;
+		}
 		doc_tree->doc = tmpdoc;
 		doc_tree->filename = ast_strdup(globbuf.gl_pathv[i]);
 		AST_RWLIST_INSERT_TAIL(&xmldoc_tree, doc_tree, entry);
@@ -194,6 +194,7 @@ static int authdebug = 0;
 static int dundi_ttl = DUNDI_DEFAULT_TTL;
 static int dundi_key_ttl = DUNDI_DEFAULT_KEY_EXPIRE;
 static int dundi_cache_time = DUNDI_DEFAULT_CACHE_TIME;
+static int dundi_cache_persist = 1;
 static int global_autokilltimeout = 0;
 static dundi_eid global_eid;
 static int default_expiration = 60;
@@ -861,6 +862,168 @@ static int dundi_answer_entity(struct dundi_transaction *trans, struct dundi_ies
 	return 0;
 }
 
+/*! \brief An answer or hint of the cache, under the key it has in AstDB */
+struct dundi_cache_entry {
+	/*! When the entry expires */
+	time_t expiry;
+	/*! The value as stored in AstDB, starting with the expiry */
+	char *data;
+	char key[0];
+};
+
+/*! \brief The cache, in memory, of the answers and hints learned */
+static struct ao2_container *dundi_cache;
+
+AO2_STRING_FIELD_HASH_FN(dundi_cache_entry, key)
+AO2_STRING_FIELD_CMP_FN(dundi_cache_entry, key)
+
+/*! \brief Put an entry into the cache in memory only */
+static void cache_link(const char *key, const char *data)
+{
+	struct dundi_cache_entry *entry;
+	size_t keylen = strlen(key) + 1;
+	time_t expiry;
+
+	if (ast_get_time_t(data, &expiry, 0, NULL)) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + keylen + strlen(data) + 1, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	entry->expiry = expiry;
+	strcpy(entry->key, key); /* Safe */
+	entry->data = entry->key + keylen;
+	strcpy(entry->data, data); /* Safe */
+
+	ao2_lock(dundi_cache);
+	ao2_find(dundi_cache, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(dundi_cache, entry, OBJ_NOLOCK);
+	ao2_unlock(dundi_cache);
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Put an entry into the cache, and into AstDB when persisting it */
+static void cache_put(const char *key, const char *data)
+{
+	cache_link(key, data);
+	if (dundi_cache_persist) {
+		ast_db_put("dundi/cache", key, data);
+	}
+}
+
+/*! \brief Copy the value of an entry of the cache, 0 if there is one */
+static int cache_get(const char *key, char *data, size_t len)
+{
+	struct dundi_cache_entry *entry;
+
+	entry = ao2_find(dundi_cache, key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return -1;
+	}
+	ast_copy_string(data, entry->data, len);
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+static void cache_del(const char *key)
+{
+	ao2_find(dundi_cache, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	if (dundi_cache_persist) {
+		ast_db_del("dundi/cache", key);
+	}
+}
+
+/*! \brief Remove every entry of the cache, along with any kept in AstDB */
+static void cache_flush(void)
+{
+	ao2_callback(dundi_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	ast_db_deltree("dundi/cache", NULL);
+}
+
+static int cache_expired_cb(void *obj, void *arg, int flags)
+{
+	struct dundi_cache_entry *entry = obj;
+	time_t *now = arg;
+
+	return entry->expiry < *now ? CMP_MATCH : 0;
+}
+
+/*! \brief Remove the entries of the cache which have expired */
+static void cache_expire(time_t now)
+{
+	struct ao2_iterator *expired;
+	struct dundi_cache_entry *entry;
+
+	expired = ao2_callback(dundi_cache, OBJ_UNLINK | OBJ_MULTIPLE, cache_expired_cb, &now);
+	if (!expired) {
+		return;
+	}
+	while ((entry = ao2_iterator_next(expired))) {
+		ast_debug(1, "clearing expired DUNDI cache entry: %s\n", entry->key);
+		if (dundi_cache_persist) {
+			ast_db_del("dundi/cache", entry->key);
+		}
+		ao2_ref(entry, -1);
+	}
+	ao2_iterator_destroy(expired);
+}
+
+/*!
+ * \brief Copy the entries of the cache with keys starting with a prefix
+ *
+ * The entries are returned as ast_db_gettree() would return them, with keys
+ * under /dundi/cache/, to be freed with ast_db_freetree().
+ */
+static struct ast_db_entry *cache_gettree(const char *prefix)
+{
+	struct ao2_iterator i;
+	struct dundi_cache_entry *entry;
+	struct ast_db_entry *tree = NULL;
+	size_t prefixlen = strlen(prefix);
+
+	i = ao2_iterator_init(dundi_cache, 0);
+	while ((entry = ao2_iterator_next(&i))) {
+		struct ast_db_entry *copy;
+		size_t datalen = strlen(entry->data) + 1;
+
+		if (!strncmp(entry->key, prefix, prefixlen)
+			&& (copy = ast_malloc(sizeof(*copy) + datalen + sizeof("/dundi/cache/") + strlen(entry->key)))) {
+			strcpy(copy->data, entry->data); /* Safe */
+			copy->key = copy->data + datalen;
+			sprintf(copy->key, "/dundi/cache/%s", entry->key); /* Safe */
+			copy->next = tree;
+			tree = copy;
+		}
+		ao2_ref(entry, -1);
+	}
+	ao2_iterator_destroy(&i);
+
+	return tree;
+}
+
+/*! \brief Load into memory the entries of the cache persisted in AstDB */
+static void cache_load(void)
+{
+	struct ast_db_entry *db_entry, *db_tree;
+	int striplen = sizeof("/dundi/cache");
+	time_t now;
+
+	time(&now);
+	db_tree = ast_db_gettree("dundi/cache", NULL);
+	for (db_entry = db_tree; db_entry; db_entry = db_entry->next) {
+		time_t expiry;
+
+		if (!ast_get_time_t(db_entry->data, &expiry, 0, NULL) && expiry >= now) {
+			cache_link(db_entry->key + striplen, db_entry->data);
+		}
+	}
+	ast_db_freetree(db_tree);
+}
+
 static int cache_save_hint(dundi_eid *eidpeer, struct dundi_request *req, struct dundi_hint *hint, int expiration)
 {
 	int unaffected;
@@ -889,9 +1052,9 @@ static int cache_save_hint(dundi_eid *eidpeer, struct dundi_request *req, struct
 	timeout += expiration;
 	snprintf(data, sizeof(data), "%ld|", (long)(timeout));
 
-	ast_db_put("dundi/cache", key1, data);
+	cache_put(key1, data);
 	ast_debug(1, "Caching hint at '%s'\n", key1);
-	ast_db_put("dundi/cache", key2, data);
+	cache_put(key2, data);
 	ast_debug(1, "Caching hint at '%s'\n", key2);
 	return 0;
 }
@@ -932,8 +1095,8 @@ static int cache_save(dundi_eid *eidpeer, struct dundi_request *req, int start,
 			req->dr[x].flags, req->dr[x].weight, req->dr[x].techint, req->dr[x].dest,
 			dundi_eid_to_str_short(eidpeer_str, sizeof(eidpeer_str), &req->dr[x].eid));
 	}
-	ast_db_put("dundi/cache", key1, data);
-	ast_db_put("dundi/cache", key2, data);
+	cache_put(key1, data);
+	cache_put(key2, data);
 	return 0;
 }
 
@@ -1179,7 +1342,7 @@ static int cache_lookup_internal(time_t now, struct dundi_request *req, char *ke
 	char fs[256];
 
 	/* Build request string */
-	if (!ast_db_get("dundi/cache", key, data, sizeof(data))) {
+	if (!cache_get(key, data, sizeof(data))) {
 		time_t timeout;
 		ptr = data;
 		if (!ast_get_time_t(ptr, &timeout, 0, &length)) {
@@ -1231,9 +1394,9 @@ static int cache_lookup_internal(time_t now, struct dundi_request *req, char *ke
 					*lowexpiration = expiration;
 				return 1;
 			} else
-				ast_db_del("dundi/cache", key);
+				cache_del(key);
 		} else
-			ast_db_del("dundi/cache", key);
+			cache_del(key);
 	}
 
 	return 0;
@@ -2227,27 +2390,10 @@ static void *network_thread(void *ignore)
 
 static void *process_clearcache(void *ignore)
 {
-	struct ast_db_entry *db_entry, *db_tree;
-	int striplen = sizeof("/dundi/cache");
-	time_t now;
-
 	while (!dundi_shutdown) {
 		pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
-		time(&now);
-
-		db_entry = db_tree = ast_db_gettree("dundi/cache", NULL);
-		for (; db_entry; db_entry = db_entry->next) {
-			time_t expiry;
-
-			if (!ast_get_time_t(db_entry->data, &expiry, 0, NULL)) {
-				if (expiry < now) {
-					ast_debug(1, "clearing expired DUNDI cache entry: %s\n", db_entry->key);
-					ast_db_del("dundi/cache", db_entry->key + striplen);
-				}
-			}
-		}
-		ast_db_freetree(db_tree);
+		cache_expire(time(NULL));
 
 		pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 		pthread_testcancel();
@@ -2394,7 +2540,7 @@ static char *dundi_flush(struct ast_cli_entry *e, int cmd, struct ast_cli_args *
 		}
 		AST_LIST_UNLOCK(&peers);
 	} else {
-		ast_db_deltree("dundi/cache", NULL);
+		cache_flush();
 		ast_cli(a->fd, "DUNDi Cache Flushed\n");
 	}
 	return CLI_SUCCESS;
@@ -2983,7 +3129,7 @@ static char *dundi_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	}
 
 	time(&now);
-	db_tree = ast_db_gettree("dundi/cache", NULL);
+	db_tree = cache_gettree("");
 	ast_cli(a->fd, FORMAT2, "Number", "Context", "Expiration", "From", "Weight", "Destination (Flags)");
 	for (db_entry = db_tree; db_entry; db_entry = db_entry->next) {
 		char *rest;
@@ -3076,7 +3222,7 @@ static char *dundi_show_hints(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	}
 
 	time(&now);
-	db_tree = ast_db_gettree("dundi/cache/hint", NULL);
+	db_tree = cache_gettree("hint/");
 	ast_cli(a->fd, FORMAT2, "Prefix", "Context", "Expiration", "From");
 
 	for (db_entry = db_tree; db_entry; db_entry = db_entry->next) {
@@ -4956,6 +5102,7 @@ static int set_config(char *config_file, struct ast_sockaddr *sin, int reload, s
 
 	dundi_ttl = DUNDI_DEFAULT_TTL;
 	dundi_cache_time = DUNDI_DEFAULT_CACHE_TIME;
+	dundi_cache_persist = 1;
 	any_peer = NULL;
 
 	AST_LIST_LOCK(&peers);
@@ -5034,6 +5181,8 @@ static int set_config(char *config_file, struct ast_sockaddr *sin, int reload, s
 				ast_log(LOG_WARNING, "'%s' is not a valid cache time at line %d. Using default value '%d'.\n",
 					v->value, v->lineno, DUNDI_DEFAULT_CACHE_TIME);
 			}
+		} else if (!strcasecmp(v->name, "cachepersist")) {
+			dundi_cache_persist = ast_true(v->value);
 		}
 		v = v->next;
 	}
@@ -5150,6 +5299,9 @@ static int unload_module(void)
 		sched = NULL;
 	}
 
+	ao2_cleanup(dundi_cache);
+	dundi_cache = NULL;
+
 	return 0;
 }
 
@@ -5178,8 +5330,10 @@ static int load_module(void)
 	/* Make a UDP socket */
 	io = io_context_create();
 	sched = ast_sched_context_create();
+	dundi_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 563,
+		dundi_cache_entry_hash_fn, NULL, dundi_cache_entry_cmp_fn);
 
-	if (!io || !sched) {
+	if (!io || !sched || !dundi_cache) {
 		goto declined;
 	}
 
@@ -5190,6 +5344,10 @@ static int load_module(void)
 		goto declined;
 	}
 
+	if (dundi_cache_persist) {
+		cache_load();
+	}
+
 	if (!ast_sockaddr_isnull(&sin2)) {
 		if ((ast_sockaddr_is_ipv4(&sin) == ast_sockaddr_is_ipv4(&sin2)) || (ast_sockaddr_is_ipv6(&sin) == ast_sockaddr_is_ipv6(&sin2))) {
 			ast_log(LOG_ERROR, "bindaddr & bindaddr2 should be different IP protocols.\n");
@@ -53,6 +53,9 @@
 #include "asterisk/options.h"
 #include "asterisk/format.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/config.h"
+#include "asterisk/sched.h"
+#include "asterisk/threadpool.h"
 
 /*
  * pbx_spool is similar in spirit to qcall, but with substantially enhanced functionality...
@@ -74,6 +77,36 @@ enum {
 static char qdir[255];
 static char qdonedir[255];
 
+/*! \brief Default number of calls attempted at once */
+#define DEFAULT_MAXCALLS 100
+
+/*! \brief The threads attempting the calls, as many as maxcalls */
+static struct ast_threadpool *attempt_pool;
+
+/*! \brief Delays the attempts over a rate, and the retries of calls */
+static struct ast_sched_context *sched;
+
+/*! \brief A limit of the calls attempted per second */
+struct spool_rate {
+	AST_LIST_ENTRY(spool_rate) list;
+	/*! Calls attempted per second */
+	double rate;
+	/*! Calls that may be attempted now */
+	double tokens;
+	/*! When the tokens were last added */
+	struct timeval updated;
+	/*! A context, or a technology and a trunk, the limit is of */
+	char name[0];
+};
+
+AST_MUTEX_DEFINE_STATIC(rates_lock);
+
+/*! \brief The limit of all the calls attempted (Protected by rates_lock) */
+static struct spool_rate *rate_all;
+
+/*! \brief The limits of some calls (Protected by rates_lock) */
+static AST_LIST_HEAD_NOLOCK_STATIC(rates, spool_rate);
+
 struct outgoing {
 	int retries;                              /*!< Current number of retries */
 	int maxretries;                           /*!< Maximum number of retries permitted */
@@ -293,6 +326,26 @@ static void parse_line(char *line, unsigned int lineno, struct outgoing *o)
 
 #define LINE_BUFFER_SIZE 1024
 
+/*! \brief Set the attempt a call is on, before it is counted */
+static void set_attempt_variable(struct outgoing *o)
+{
+	struct ast_variable *var;
+	struct ast_variable **prev = &o->vars;
+	char buf[32];
+
+	for (var = o->vars; var; prev = &var->next, var = var->next) {
+		if (!strcmp(var->name, "AST_OUTGOING_ATTEMPT")) {
+			*prev = var->next;
+			var->next = NULL;
+			ast_variables_destroy(var);
+			break;
+		}
+	}
+
+	snprintf(buf, sizeof(buf), "%d", o->retries + 1);
+	append_variable(o, "AST_OUTGOING_ATTEMPT", buf);
+}
+
 static int apply_outgoing(struct outgoing *o, FILE *f)
 {
 	char buf[LINE_BUFFER_SIZE];
@@ -329,9 +382,7 @@ static int apply_outgoing(struct outgoing *o, FILE *f)
 		return -1;
 	}
 
-	if (snprintf(buf, sizeof(buf), "%d", o->retries + 1) < sizeof(buf)) {
-		append_variable(o, "AST_OUTGOING_ATTEMPT", buf);
-	}
+	set_attempt_variable(o);
 
 	return 0;
 }
@@ -428,7 +479,37 @@ static int remove_from_queue(struct outgoing *o, const char *status)
 	return 0;
 }
 
-static void *attempt_thread(void *data)
+static void launch_service(struct outgoing *o);
+
+#ifdef HAVE_INOTIFY
+/*!
+ * \brief Attempt a call again, without reading its call file anew
+ *
+ * \note Files are only queued again when they are created, so that the
+ * call is not also found in the directory.
+ */
+static int retry_service(const void *data)
+{
+	struct outgoing *o = (struct outgoing *) data;
+	struct stat st;
+
+	if (stat(o->fn, &st)) {
+		/* The call file was removed, and the call with it */
+		ast_debug(1, "Not retrying %s: %s\n", o->fn, strerror(errno));
+		free_outgoing(o);
+		return 0;
+	}
+
+	set_attempt_variable(o);
+	o->retries++;
+	safe_append(o, time(NULL), "StartRetry");
+	launch_service(o);
+
+	return 0;
+}
+#endif
+
+static int attempt_thread(void *data)
 {
 	struct outgoing *o = data;
 	int res, reason;
@@ -455,6 +536,12 @@ static void *attempt_thread(void *data)
 		} else {
 			/* Notate that the call is still active */
 			safe_append(o, time(NULL), "EndRetry");
+#ifdef HAVE_INOTIFY
+			/* The parsed call is kept until the retry */
+			if (ast_sched_add(sched, o->retrytime * 1000, retry_service, o) >= 0) {
+				return 0;
+			}
+#endif
 #if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
 			queue_file(o->fn, time(NULL) + o->retrytime);
 #endif
@@ -464,16 +551,125 @@ static void *attempt_thread(void *data)
 		remove_from_queue(o, "Completed");
 	}
 	free_outgoing(o);
-	return NULL;
+	return 0;
+}
+
+/*!
+ * \brief Determine if a limit is of a call
+ *
+ * \details A limit named Tech/name is of the calls on the technology whose
+ * destination is name, begins with "name/" or ends with "@name". Any other
+ * limit is of the calls to its context.
+ */
+static int spool_rate_matches(const struct spool_rate *rate, const struct outgoing *o)
+{
+	const char *trunk = strchr(rate->name, '/');
+	size_t tech_len;
+	size_t trunk_len;
+	size_t dest_len;
+
+	if (!trunk) {
+		return !ast_strlen_zero(o->exten) && !strcasecmp(rate->name, o->context);
+	}
+
+	tech_len = trunk - rate->name;
+	if (strlen(o->tech) != tech_len || strncasecmp(rate->name, o->tech, tech_len)) {
+		return 0;
+	}
+
+	++trunk;
+	trunk_len = strlen(trunk);
+	dest_len = strlen(o->dest);
+	if (!strncmp(o->dest, trunk, trunk_len)
+		&& (o->dest[trunk_len] == '\0' || o->dest[trunk_len] == '/')) {
+		return 1;
+	}
+
+	return dest_len > trunk_len && o->dest[dest_len - trunk_len - 1] == '@'
+		&& !strcmp(o->dest + dest_len - trunk_len, trunk);
+}
+
+/*!
+ * \brief Milliseconds until a limit allows a call, adding the tokens since it was updated
+ *
+ * \note rates_lock must be held
+ */
+static int spool_rate_wait(struct spool_rate *rate, struct timeval now)
+{
+	double burst = MAX(rate->rate, 1.0);
+
+	rate->tokens += ast_tvdiff_us(now, rate->updated) / 1000000.0 * rate->rate;
+	if (rate->tokens > burst) {
+		rate->tokens = burst;
+	}
+	rate->updated = now;
+
+	if (rate->tokens >= 1.0) {
+		return 0;
+	}
+
+	return (int) ((1.0 - rate->tokens) * 1000.0 / rate->rate) + 1;
+}
+
+/*!
+ * \brief Take the call from the limits it is under, or tell how long until they allow it
+ *
+ * \retval 0 if the call may be attempted now
+ * \retval >0 the milliseconds until it is to be asked again
+ */
+static int spool_rate_take(const struct outgoing *o)
+{
+	struct timeval now = ast_tvnow();
+	struct spool_rate *rate;
+	int wait = 0;
+
+	ast_mutex_lock(&rates_lock);
+	if (rate_all) {
+		wait = spool_rate_wait(rate_all, now);
+	}
+	AST_LIST_TRAVERSE(&rates, rate, list) {
+		if (spool_rate_matches(rate, o)) {
+			wait = MAX(wait, spool_rate_wait(rate, now));
+		}
+	}
+
+	if (!wait) {
+		if (rate_all) {
+			rate_all->tokens -= 1.0;
+		}
+		AST_LIST_TRAVERSE(&rates, rate, list) {
+			if (spool_rate_matches(rate, o)) {
+				rate->tokens -= 1.0;
+			}
+		}
+	}
+	ast_mutex_unlock(&rates_lock);
+
+	return wait;
+}
+
+static int launch_delayed(const void *data)
+{
+	launch_service((struct outgoing *) data);
+
+	return 0;
 }
 
 static void launch_service(struct outgoing *o)
 {
-	pthread_t t;
-	int ret;
+	int wait = spool_rate_take(o);
 
-	if ((ret = ast_pthread_create_detached(&t, NULL, attempt_thread, o))) {
-		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
+	if (wait) {
+		ast_debug(2, "Delaying %s/%s by %d ms for the rate of calls\n", o->tech, o->dest, wait);
+		if (ast_sched_add(sched, wait, launch_delayed, o) < 0) {
+			ast_log(LOG_WARNING, "Unable to delay call to %s/%s\n", o->tech, o->dest);
+			free_outgoing(o);
+		}
+		return;
+	}
+
+	if (ast_threadpool_push(attempt_pool, attempt_thread, o)) {
+		ast_log(LOG_WARNING, "Unable to attempt call to %s/%s\n", o->tech, o->dest);
 		free_outgoing(o);
 	}
 }
@@ -938,6 +1134,73 @@ static void *scan_thread(void *unused)
 }
 #endif
 
+static struct spool_rate *spool_rate_alloc(const char *name, const char *value)
+{
+	struct spool_rate *rate;
+	double cps;
+
+	if (sscanf(value, "%30lf", &cps) != 1 || cps <= 0.0) {
+		ast_log(LOG_WARNING, "Invalid rate of calls '%s' for '%s' in pbx_spool.conf\n", value, name);
+		return NULL;
+	}
+
+	rate = ast_calloc(1, sizeof(*rate) + strlen(name) + 1);
+	if (!rate) {
+		return NULL;
+	}
+	strcpy(rate->name, name); /* SAFE */
+	rate->rate = cps;
+	rate->tokens = MAX(cps, 1.0);
+	rate->updated = ast_tvnow();
+
+	return rate;
+}
+
+/*!
+ * \brief Load pbx_spool.conf, which is optional
+ *
+ * \return The number of calls attempted at once, 0 for no limit
+ */
+static int load_config(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	struct ast_variable *v;
+	int maxcalls = DEFAULT_MAXCALLS;
+
+	cfg = ast_config_load("pbx_spool.conf", config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return maxcalls;
+	}
+
+	ast_mutex_lock(&rates_lock);
+	for (v = ast_variable_browse(cfg, "general"); v; v = v->next) {
+		if (!strcasecmp(v->name, "maxcalls")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_IN_RANGE, &maxcalls, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid maxcalls '%s' in pbx_spool.conf\n", v->value);
+				maxcalls = DEFAULT_MAXCALLS;
+			}
+		} else if (!strcasecmp(v->name, "cps")) {
+			ast_free(rate_all);
+			rate_all = strcmp(v->value, "0") ? spool_rate_alloc("all", v->value) : NULL;
+		} else {
+			ast_log(LOG_WARNING, "Unknown option '%s' in pbx_spool.conf\n", v->name);
+		}
+	}
+	for (v = ast_variable_browse(cfg, "cps"); v; v = v->next) {
+		struct spool_rate *rate = spool_rate_alloc(v->name, v->value);
+
+		if (rate) {
+			AST_LIST_INSERT_TAIL(&rates, rate, list);
+		}
+	}
+	ast_mutex_unlock(&rates_lock);
+
+	ast_config_destroy(cfg);
+
+	return maxcalls;
+}
+
 static int unload_module(void)
 {
 	return -1;
@@ -945,6 +1208,12 @@ static int unload_module(void)
 
 static int load_module(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+	};
 	pthread_t thread;
 	int ret;
 	snprintf(qdir, sizeof(qdir), "%s/%s", ast_config_AST_SPOOL_DIR, "outgoing");
@@ -954,6 +1223,20 @@ static int load_module(void)
 	}
 	snprintf(qdonedir, sizeof(qdir), "%s/%s", ast_config_AST_SPOOL_DIR, "outgoing_done");
 
+	options.max_size = load_config();
+
+	attempt_pool = ast_threadpool_create("pbx_spool", NULL, &options);
+	if (!attempt_pool) {
+		ast_log(LOG_WARNING, "Unable to create the pool of threads attempting calls\n");
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	sched = ast_sched_context_create();
+	if (!sched || ast_sched_start_thread(sched)) {
+		ast_log(LOG_WARNING, "Unable to start the scheduler of calls\n");
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if ((ret = ast_pthread_create_detached_background(&thread, NULL, scan_thread, NULL))) {
 		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
 		return AST_MODULE_LOAD_FAILURE;
@@ -7404,6 +7404,15 @@ int ast_ari_validate_application(struct ast_json *json)
 				res = 0;
 			}
 		} else
+		if (strcmp("event_fields", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			prop_is_valid = ast_ari_validate_object(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI Application field event_fields failed validation\n");
+				res = 0;
+			}
+		} else
 		if (strcmp("events_allowed", ast_json_object_iter_key(iter)) == 0) {
 			int prop_is_valid;
 			has_events_allowed = 1;
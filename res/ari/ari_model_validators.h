@@ -1910,6 +1910,7 @@ ari_validator ast_ari_validate_application_fn(void);
  * - channel_ids: List[string] (required)
  * - device_names: List[string] (required)
  * - endpoint_ids: List[string] (required)
+ * - event_fields: object
  * - events_allowed: List[object] (required)
  * - events_disallowed: List[object] (required)
  * - name: string (required)
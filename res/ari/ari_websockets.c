@@ -158,8 +158,6 @@ struct ast_json *ast_ari_websocket_session_read(
 int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 	struct ast_json *message)
 {
-	RAII_VAR(char *, str, NULL, ast_json_free);
-
 #ifdef AST_DEVMODE
 	if (!session->validator(message)) {
 		ast_log(LOG_ERROR, "Outgoing message failed validation\n");
@@ -167,6 +165,14 @@ int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 	}
 #endif
 
+	return ast_ari_websocket_session_write_unvalidated(session, message);
+}
+
+int ast_ari_websocket_session_write_unvalidated(struct ast_ari_websocket_session *session,
+	struct ast_json *message)
+{
+	RAII_VAR(char *, str, NULL, ast_json_free);
+
 	str = ast_json_dump_string_format(message, ast_ari_json_format());
 
 	if (str == NULL) {
@@ -182,6 +188,21 @@ int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 	return 0;
 }
 
+void ast_ari_websocket_session_cork(struct ast_ari_websocket_session *session)
+{
+	ast_websocket_cork(session->ws_session);
+}
+
+int ast_ari_websocket_session_uncork(struct ast_ari_websocket_session *session)
+{
+	if (ast_websocket_uncork(session->ws_session)) {
+		ast_log(LOG_NOTICE, "Problem occurred during websocket write to %s, websocket closed\n",
+			ast_sockaddr_stringify(ast_ari_websocket_session_get_remote_addr(session)));
+		return -1;
+	}
+	return 0;
+}
+
 struct ast_sockaddr *ast_ari_websocket_session_get_remote_addr(
 	struct ast_ari_websocket_session *session)
 {
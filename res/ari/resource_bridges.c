@@ -882,44 +882,45 @@ void ast_ari_bridges_destroy(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
-void ast_ari_bridges_list(struct ast_variable *headers,
-	struct ast_ari_bridges_list_args *args,
-	struct ast_ari_response *response)
+static int bridges_list_stream(struct ast_ari_json_stream *stream, void *data)
 {
-	RAII_VAR(struct ao2_container *, bridges, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	struct ao2_container *bridges = data;
 	struct ao2_iterator i;
 	struct ast_bridge *bridge;
+	int res = 0;
 
-	bridges = ast_bridges();
-	if (!bridges) {
-		ast_ari_response_alloc_failed(response);
-		return;
-	}
-
-	json = ast_json_array_create();
-	if (!json) {
-		ast_ari_response_alloc_failed(response);
-		return;
+	if (ast_ari_json_stream_array_start(stream)) {
+		return -1;
 	}
 
 	i = ao2_iterator_init(bridges, 0);
-	while ((bridge = ao2_iterator_next(&i))) {
+	while (!res && (bridge = ao2_iterator_next(&i))) {
 		struct ast_bridge_snapshot *snapshot = ast_bridge_get_snapshot(bridge);
-		/* ast_bridge_snapshot_to_json will return NULL if snapshot is NULL */
-		struct ast_json *json_bridge = ast_bridge_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
 
+		/* ast_bridge_snapshot_to_json_writer will fail if snapshot is NULL */
+		res = ast_bridge_snapshot_to_json_writer(snapshot, stasis_app_get_sanitizer(),
+			ast_ari_json_stream_writer(stream));
 		ao2_ref(bridge, -1);
 		ao2_cleanup(snapshot);
-		if (!json_bridge || ast_json_array_append(json, json_bridge)) {
-			ao2_iterator_destroy(&i);
-			ast_ari_response_alloc_failed(response);
-			return;
-		}
 	}
 	ao2_iterator_destroy(&i);
 
-	ast_ari_response_ok(response, ast_json_ref(json));
+	return res ? -1 : ast_ari_json_stream_array_end(stream);
+}
+
+void ast_ari_bridges_list(struct ast_variable *headers,
+	struct ast_ari_bridges_list_args *args,
+	struct ast_ari_response *response)
+{
+	struct ao2_container *bridges;
+
+	bridges = ast_bridges();
+	if (!bridges) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	ast_ari_response_ok_stream(response, bridges_list_stream, bridges, __ao2_cleanup);
 }
 
 void ast_ari_bridges_create(struct ast_variable *headers,
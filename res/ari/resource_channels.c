@@ -42,6 +42,7 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/core_local.h"
 #include "asterisk/dial.h"
+#include "asterisk/originate.h"
 #include "asterisk/max_forwards.h"
 #include "asterisk/rtp_engine.h"
 #include "resource_channels.h"
@@ -953,48 +954,46 @@ void ast_ari_channels_hangup(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
-void ast_ari_channels_list(struct ast_variable *headers,
-	struct ast_ari_channels_list_args *args,
-	struct ast_ari_response *response)
+/*! \brief Streams the channels of GET /channels one snapshot at a time */
+static int channels_list_stream(struct ast_ari_json_stream *stream, void *data)
 {
-	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	struct ao2_container *snapshots = data;
 	struct ao2_iterator i;
-	void *obj;
+	struct ast_channel_snapshot *snapshot;
 	struct stasis_message_sanitizer *sanitize = stasis_app_get_sanitizer();
+	int res = 0;
 
-	snapshots = ast_channel_cache_all();
-
-	json = ast_json_array_create();
-	if (!json) {
-		ast_ari_response_alloc_failed(response);
-		return;
+	if (ast_ari_json_stream_array_start(stream)) {
+		return -1;
 	}
 
 	i = ao2_iterator_init(snapshots, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		struct ast_channel_snapshot *snapshot = obj;
-		int r;
-
-		if (sanitize && sanitize->channel_snapshot
-			&& sanitize->channel_snapshot(snapshot)) {
-			ao2_ref(snapshot, -1);
-			continue;
-		}
-
-		r = ast_json_array_append(
-			json, ast_channel_snapshot_to_json(snapshot, NULL));
-		if (r != 0) {
-			ast_ari_response_alloc_failed(response);
-			ao2_iterator_destroy(&i);
-			ao2_ref(snapshot, -1);
-			return;
+	while (!res && (snapshot = ao2_iterator_next(&i))) {
+		if (!sanitize || !sanitize->channel_snapshot
+			|| !sanitize->channel_snapshot(snapshot)) {
+			res = ast_channel_snapshot_to_json_writer(snapshot, NULL,
+				ast_ari_json_stream_writer(stream));
 		}
 		ao2_ref(snapshot, -1);
 	}
 	ao2_iterator_destroy(&i);
 
-	ast_ari_response_ok(response, ast_json_ref(json));
+	return res ? -1 : ast_ari_json_stream_array_end(stream);
+}
+
+void ast_ari_channels_list(struct ast_variable *headers,
+	struct ast_ari_channels_list_args *args,
+	struct ast_ari_response *response)
+{
+	struct ao2_container *snapshots;
+
+	snapshots = ast_channel_cache_all();
+	if (!snapshots) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	ast_ari_response_ok_stream(response, channels_list_stream, snapshots, __ao2_cleanup);
 }
 
 /*! \brief Structure used for origination */
@@ -1010,7 +1009,7 @@ struct ari_origination {
 };
 
 /*! \brief Thread which dials and executes upon answer */
-static void *ari_originate_dial(void *data)
+static void ari_originate_dial(void *data)
 {
 	struct ast_dial *dial = data;
 	struct ari_origination *origination = ast_dial_get_user_data(dial);
@@ -1020,6 +1019,7 @@ static void *ari_originate_dial(void *data)
 	if (res != AST_DIAL_RESULT_ANSWERED) {
 		goto end;
 	}
+	ast_originate_answered();
 
 	if (!ast_strlen_zero(origination->appdata)) {
 		struct ast_app *app = pbx_findapp("Stasis");
@@ -1057,7 +1057,6 @@ static void *ari_originate_dial(void *data)
 end:
 	ast_dial_destroy(dial);
 	ast_free(origination);
-	return NULL;
 }
 
 static struct ast_channel *ari_channels_handle_originate_with_id(const char *args_endpoint,
@@ -1091,7 +1090,6 @@ static struct ast_channel *ari_channels_handle_originate_with_id(const char *arg
 		.uniqueid2 = args_other_channel_id,
 	};
 	struct ari_origination *origination;
-	pthread_t thread;
 	struct ast_format_cap *format_cap = NULL;
 
 	if ((assignedids.uniqueid && AST_MAX_PUBLIC_UNIQUEID < strlen(assignedids.uniqueid))
@@ -1347,8 +1345,9 @@ static struct ast_channel *ari_channels_handle_originate_with_id(const char *arg
 	 */
 	ast_channel_ref(chan);
 
-	if (ast_pthread_create_detached(&thread, NULL, ari_originate_dial, dial)) {
-		ast_ari_response_alloc_failed(response);
+	if (ast_originate_push(args_endpoint, ari_originate_dial, dial)) {
+		ast_ari_response_error(response, 503, "Service Unavailable",
+			"Too many channels are being originated");
 		ast_dial_destroy(dial);
 		ast_free(origination);
 	} else {
@@ -34,15 +34,37 @@
 #include "asterisk/channel.h"
 #include "asterisk/message.h"
 
+/*! \brief Streams the endpoints of GET /endpoints one snapshot at a time */
+static int endpoints_list_stream(struct ast_ari_json_stream *stream, void *data)
+{
+	struct ao2_container *snapshots = data;
+	struct ao2_iterator i;
+	struct stasis_message *msg;
+	int res = 0;
+
+	if (ast_ari_json_stream_array_start(stream)) {
+		return -1;
+	}
+
+	i = ao2_iterator_init(snapshots, 0);
+	while (!res && (msg = ao2_iterator_next(&i))) {
+		struct ast_endpoint_snapshot *snapshot = stasis_message_data(msg);
+
+		res = ast_ari_json_stream_array_append(stream,
+			ast_endpoint_snapshot_to_json(snapshot, stasis_app_get_sanitizer()));
+		ao2_ref(msg, -1);
+	}
+	ao2_iterator_destroy(&i);
+
+	return res ? -1 : ast_ari_json_stream_array_end(stream);
+}
+
 void ast_ari_endpoints_list(struct ast_variable *headers,
 	struct ast_ari_endpoints_list_args *args,
 	struct ast_ari_response *response)
 {
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
-	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
-	struct ao2_iterator i;
-	void *obj;
+	struct ao2_container *snapshots;
 
 	cache = ast_endpoint_cache();
 	if (!cache) {
@@ -59,27 +81,7 @@ void ast_ari_endpoints_list(struct ast_variable *headers,
 		return;
 	}
 
-	json = ast_json_array_create();
-	if (!json) {
-		ast_ari_response_alloc_failed(response);
-		return;
-	}
-
-	i = ao2_iterator_init(snapshots, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
-		struct ast_endpoint_snapshot *snapshot = stasis_message_data(msg);
-		struct ast_json *json_endpoint = ast_endpoint_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
-
-		if (!json_endpoint || ast_json_array_append(json, json_endpoint)) {
-			ao2_iterator_destroy(&i);
-			ast_ari_response_alloc_failed(response);
-			return;
-		}
-	}
-	ao2_iterator_destroy(&i);
-
-	ast_ari_response_ok(response, ast_json_ref(json));
+	ast_ari_response_ok_stream(response, endpoints_list_stream, snapshots, __ao2_cleanup);
 }
 
 void ast_ari_endpoints_list_by_tech(struct ast_variable *headers,
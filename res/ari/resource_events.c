@@ -122,8 +122,19 @@ static void stasis_app_message_handler(
 				msg_type,
 				msg_application);
 	} else if (stasis_app_event_allowed(app_name, message)) {
+		struct ast_json *projected = stasis_app_event_project(app_name, message);
+
+		if (!projected) {
+			ast_log(LOG_WARNING,
+				"Failed to dispatch '%s' message from Stasis app '%s'; could not project message\n",
+				msg_type,
+				msg_application);
+			ao2_unlock(session);
+			return;
+		}
+
 		if (app_debug_enabled) {
-			char *str = ast_json_dump_string_format(message, ast_ari_json_format());
+			char *str = ast_json_dump_string_format(projected, ast_ari_json_format());
 
 			ast_verbose("<--- Sending ARI event to %s --->\n%s\n",
 				ast_sockaddr_stringify(ast_ari_websocket_session_get_remote_addr(session->ws_session)),
@@ -132,7 +143,13 @@ static void stasis_app_message_handler(
 		}
 
 		/* We are ready to publish the message */
-		ast_ari_websocket_session_write(session->ws_session, message);
+		if (projected == message) {
+			ast_ari_websocket_session_write(session->ws_session, message);
+		} else {
+			/* Trimmed objects no longer match their models */
+			ast_ari_websocket_session_write_unvalidated(session->ws_session, projected);
+		}
+		ast_json_unref(projected);
 	}
 
 	ao2_unlock(session);
@@ -277,11 +294,14 @@ static void event_session_update_websocket(
 
 	session->ws_session = ws_session;
 
+	/* The backlog is sent in as few writes as possible */
+	ast_ari_websocket_session_cork(session->ws_session);
 	for (i = 0; i < AST_VECTOR_SIZE(&session->message_queue); i++) {
 		struct ast_json *msg = AST_VECTOR_GET(&session->message_queue, i);
 		ast_ari_websocket_session_write(session->ws_session, msg);
 		ast_json_unref(msg);
 	}
+	ast_ari_websocket_session_uncork(session->ws_session);
 
 	AST_VECTOR_RESET(&session->message_queue, AST_VECTOR_ELEM_CLEANUP_NOOP);
 	ao2_unlock(session);
@@ -24,6 +24,8 @@
  */
 #include "asterisk.h"
 
+#include <strings.h>
+
 #include "asterisk/logger.h"
 #include "res_parking.h"
 #include "asterisk/astobj2.h"
@@ -82,10 +84,27 @@ struct parking_limits_pvt {
 	struct parked_user *user;
 };
 
+/*!
+ * \internal
+ * \brief Unlink a parked user from its parking lot, freeing its space if it was still linked
+ */
+static void parking_lot_unlink_parked_user(struct parking_lot *lot, struct parked_user *pu)
+{
+	struct parked_user *unlinked;
+
+	ao2_lock(lot);
+	unlinked = ao2_callback(lot->parked_users, OBJ_UNLINK, ao2_match_by_addr, pu);
+	if (unlinked) {
+		parking_lot_space_set(lot, unlinked->parking_space, 0);
+		ao2_ref(unlinked, -1);
+	}
+	ao2_unlock(lot);
+}
+
 int unpark_parked_user(struct parked_user *pu)
 {
 	if (pu->lot) {
-		ao2_unlink(pu->lot->parked_users, pu);
+		parking_lot_unlink_parked_user(pu->lot, pu);
 		parking_lot_remove_if_unused(pu->lot);
 		return 0;
 	}
@@ -93,6 +112,97 @@ int unpark_parked_user(struct parked_user *pu)
 	return -1;
 }
 
+#define SPACES_WORD_BITS (sizeof(unsigned int) * 8)
+
+int parking_lot_spaces_update(struct parking_lot *lot)
+{
+	unsigned int *spaces_used;
+	int count = lot->cfg->parking_stop - lot->cfg->parking_start + 1;
+	struct ao2_iterator i;
+	struct parked_user *user;
+
+	if (count < 1) {
+		count = 0;
+	}
+
+	spaces_used = ast_calloc(count / SPACES_WORD_BITS + 1, sizeof(*spaces_used));
+	if (!spaces_used) {
+		return -1;
+	}
+
+	ao2_lock(lot);
+	ast_free(lot->spaces_used);
+	lot->spaces_used = spaces_used;
+	lot->spaces_start = lot->cfg->parking_start;
+	lot->spaces_count = count;
+
+	i = ao2_iterator_init(lot->parked_users, 0);
+	for (; (user = ao2_iterator_next(&i)); ao2_ref(user, -1)) {
+		parking_lot_space_set(lot, user->parking_space, 1);
+	}
+	ao2_iterator_destroy(&i);
+	ao2_unlock(lot);
+
+	return 0;
+}
+
+void parking_lot_space_set(struct parking_lot *lot, int space, int in_use)
+{
+	unsigned int bit;
+
+	if (!lot->spaces_used || space < lot->spaces_start || space - lot->spaces_start >= lot->spaces_count) {
+		return;
+	}
+
+	bit = space - lot->spaces_start;
+	if (in_use) {
+		lot->spaces_used[bit / SPACES_WORD_BITS] |= 1U << (bit % SPACES_WORD_BITS);
+	} else {
+		lot->spaces_used[bit / SPACES_WORD_BITS] &= ~(1U << (bit % SPACES_WORD_BITS));
+	}
+}
+
+int parking_lot_space_in_use(struct parking_lot *lot, int space)
+{
+	unsigned int bit;
+
+	if (!lot->spaces_used || space < lot->spaces_start || space - lot->spaces_start >= lot->spaces_count) {
+		/* Not tracked, so it has to be looked up */
+		return 1;
+	}
+
+	bit = space - lot->spaces_start;
+	return lot->spaces_used[bit / SPACES_WORD_BITS] & (1U << (bit % SPACES_WORD_BITS));
+}
+
+/*!
+ * \internal
+ * \brief Find the first space not in use from a space up to the last space of the bitmap
+ *
+ * \retval -1 if every space from there up is in use
+ * \return The space
+ */
+static int parking_lot_find_free_space(struct parking_lot *lot, int from)
+{
+	unsigned int bit = from - lot->spaces_start;
+	unsigned int word;
+	unsigned int free_bits;
+
+	for (word = bit / SPACES_WORD_BITS; word * SPACES_WORD_BITS < lot->spaces_count; ++word) {
+		free_bits = ~lot->spaces_used[word];
+		if (word == bit / SPACES_WORD_BITS) {
+			/* Skip the spaces below the one to start from */
+			free_bits &= ~0U << (bit % SPACES_WORD_BITS);
+		}
+		if (free_bits) {
+			bit = word * SPACES_WORD_BITS + ffs(free_bits) - 1;
+			return bit < lot->spaces_count ? lot->spaces_start + bit : -1;
+		}
+	}
+
+	return -1;
+}
+
 int parking_lot_get_space(struct parking_lot *lot, int target_override)
 {
 	int original_target;
@@ -101,6 +211,28 @@ int parking_lot_get_space(struct parking_lot *lot, int target_override)
 	struct parked_user *user;
 	int wrap;
 
+	if (lot->spaces_used && lot->spaces_start == lot->cfg->parking_start
+		&& lot->spaces_count == lot->cfg->parking_stop - lot->cfg->parking_start + 1) {
+		int space;
+
+		if (target_override >= lot->cfg->parking_start && target_override <= lot->cfg->parking_stop) {
+			original_target = target_override;
+		} else if (lot->cfg->parkfindnext && lot->next_space >= lot->cfg->parking_start
+			&& lot->next_space <= lot->cfg->parking_stop) {
+			original_target = lot->next_space;
+		} else {
+			original_target = lot->cfg->parking_start;
+		}
+
+		space = parking_lot_find_free_space(lot, original_target);
+		if (space == -1 && original_target != lot->cfg->parking_start) {
+			/* Wrap around to the lowest space free */
+			space = parking_lot_find_free_space(lot, lot->cfg->parking_start);
+		}
+		return space;
+	}
+
+	/* The spaces in use are not tracked for the configuration, so look through the parked users. */
 	if (lot->cfg->parkfindnext) {
 		/* Use next_space if the lot already has next_space set; otherwise use lot start. */
 		original_target = lot->next_space ? lot->next_space : lot->cfg->parking_start;
@@ -167,6 +299,10 @@ struct parked_user *parking_lot_inspect_parked_user(struct parking_lot *lot, int
 {
 	struct parked_user *user;
 
+	if (target >= 0 && !parking_lot_space_in_use(lot, target)) {
+		return NULL;
+	}
+
 	if (target < 0) {
 		user = ao2_callback(lot->parked_users, 0, NULL, NULL);
 	} else {
@@ -184,6 +320,10 @@ struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, in
 {
 	RAII_VAR(struct parked_user *, user, NULL, ao2_cleanup);
 
+	if (target >= 0 && !parking_lot_space_in_use(lot, target)) {
+		return NULL;
+	}
+
 	if (target < 0) {
 		user = ao2_callback(lot->parked_users, 0, NULL, NULL);
 	} else {
@@ -201,10 +341,11 @@ struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, in
 		return NULL;
 	}
 
-	ao2_unlink(lot->parked_users, user);
 	user->resolution = PARK_ANSWERED;
 	ao2_unlock(user);
 
+	parking_lot_unlink_parked_user(lot, user);
+
 	parking_lot_remove_if_unused(user->lot);
 
 	/* Bump the ref count by 1 since the RAII_VAR will eat the reference otherwise */
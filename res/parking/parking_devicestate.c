@@ -58,6 +58,10 @@ static int parking_lot_search_context_extension_inuse(void *obj, void *arg, int
 		return 0;
 	}
 
+	if (!parking_lot_space_in_use(lot, search->exten)) {
+		return 0;
+	}
+
 	user = ao2_callback(lot->parked_users, 0, retrieve_parked_user_targeted, &search->exten);
 	if (!user) {
 		return 0;
@@ -93,6 +93,9 @@ struct parking_lot {
 	int next_space;                           /*!< When using parkfindnext, which space we should start searching from next time we park */
 	struct ast_bridge *parking_bridge;        /*!< Bridged where parked calls will rest until they are answered or otherwise leave */
 	struct ao2_container *parked_users;       /*!< List of parked users rigidly ordered by their parking space */
+	unsigned int *spaces_used;                /*!< Bitmap of the spaces with a parked user, from spaces_start */
+	int spaces_start;                         /*!< First space of the spaces_used bitmap */
+	int spaces_count;                         /*!< Number of spaces in the spaces_used bitmap */
 	struct parking_lot_cfg *cfg;              /*!< Reference to configuration object for the parking lot */
 	enum parking_lot_modes mode;              /*!< Whether a parking lot is operational, being reconfigured, primed for deletion, or dynamically created. */
 	int disable_mark;                         /*!< On reload, disable this parking lot if it doesn't receive a new configuration. */
@@ -198,6 +201,44 @@ struct ast_bridge *parking_lot_get_bridge(struct parking_lot *lot);
  */
 int parking_lot_get_space(struct parking_lot *lot, int target_override);
 
+/*!
+ * \since 18.0.0
+ * \brief Size the bitmap of spaces in use to the configured spaces of a parking lot
+ *
+ * \param lot The parking lot, whose configuration has been set
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ *
+ * \note The bitmap is rebuilt from the parked users, so calls parked in spaces
+ *       outside of a new configuration are not tracked by it any more.
+ */
+int parking_lot_spaces_update(struct parking_lot *lot);
+
+/*!
+ * \since 18.0.0
+ * \brief Mark a parking space of a parking lot as in use or not
+ *
+ * \param lot The parking lot
+ * \param space The parking space
+ * \param in_use Non-zero if a parked user has been added to the space
+ *
+ * \note lot should be locked before this is called.
+ */
+void parking_lot_space_set(struct parking_lot *lot, int space, int in_use);
+
+/*!
+ * \since 18.0.0
+ * \brief Determine if a parking space of a parking lot may have a parked user
+ *
+ * \param lot The parking lot
+ * \param space The parking space
+ *
+ * \retval 0 if there is no parked user in the space
+ * \retval non-zero if there may be one, which must still be looked up
+ */
+int parking_lot_space_in_use(struct parking_lot *lot, int space);
+
 /*!
  * \brief Determine if there is a parked user in a parking space and return it if there is.
  *
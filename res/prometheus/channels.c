@@ -123,19 +123,83 @@ static struct prometheus_metric global_channel_metrics[] = {
 
 /*!
  * \internal
- * \brief Callback invoked when Prometheus scrapes the server
+ * \brief The metrics of each channel as last gathered, reused for channel_metrics_interval
+ *
+ * \note Only used by scrapes, which the core module serializes
+ */
+static struct ast_str *channel_metrics_cache;
+
+/*! \internal \brief When channel_metrics_cache was gathered */
+static struct timeval channel_metrics_cached;
+
+/*!
+ * \internal
+ * \brief Gather the metrics of each channel
  *
+ * \param channels The channel snapshots
+ * \param num_channels Number of snapshots in channels
+ * \param eid_str The entity ID label value
  * \param response The response to populate with formatted metrics
  */
-static void channels_scrape_cb(struct ast_str **response)
+static void channel_metrics_to_string(struct ao2_container *channels, int num_channels,
+	const char *eid_str, struct ast_str **response)
 {
-	struct ao2_container *channels;
 	struct ao2_iterator it_chans;
 	struct ast_channel_snapshot *snapshot;
 	struct prometheus_metric *channel_metrics;
+	int i, j;
+
+	channel_metrics = ast_calloc(ARRAY_LEN(channel_metric_defs) * num_channels, sizeof(*channel_metrics));
+	if (!channel_metrics) {
+		return;
+	}
+
+	it_chans = ao2_iterator_init(channels, 0);
+	for (i = 0; (snapshot = ao2_iterator_next(&it_chans)); ao2_ref(snapshot, -1), i++) {
+		for (j = 0; j < ARRAY_LEN(channel_metric_defs); j++) {
+			int index = i * ARRAY_LEN(channel_metric_defs) + j;
+
+			channel_metrics[index].type = PROMETHEUS_METRIC_GAUGE;
+			ast_copy_string(channel_metrics[index].name, channel_metric_defs[j].name, sizeof(channel_metrics[index].name));
+			channel_metrics[index].help = channel_metric_defs[j].help;
+			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 0, "eid", eid_str);
+			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 1, "name", (snapshot->base->name));
+			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 2, "id", (snapshot->base->uniqueid));
+			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 3, "type", (snapshot->base->type));
+			if (snapshot->peer) {
+				PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 4, "linkedid", (snapshot->peer->linkedid));
+			}
+			channel_metric_defs[j].get_value(&channel_metrics[index], snapshot);
+
+			if (i > 0) {
+				AST_LIST_INSERT_TAIL(&channel_metrics[j].children, &channel_metrics[index], entry);
+			}
+		}
+	}
+	ao2_iterator_destroy(&it_chans);
+
+	for (j = 0; j < ARRAY_LEN(channel_metric_defs); j++) {
+		prometheus_metric_to_string(&channel_metrics[j], response);
+	}
+
+	ast_free(channel_metrics);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void channels_scrape_cb(struct ast_str **response)
+{
+	struct prometheus_general_config *config;
+	struct ao2_container *channels;
 	char eid_str[32];
 	int num_channels;
-	int i, j;
+	int enabled;
+	unsigned int interval;
+	int i;
 	struct prometheus_metric channel_count = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
 		PROMETHEUS_METRIC_GAUGE,
 		"asterisk_channels_count",
@@ -160,47 +224,39 @@ static void channels_scrape_cb(struct ast_str **response)
 		prometheus_metric_to_string(&global_channel_metrics[i], response);
 	}
 
-	if (num_channels == 0) {
+	config = prometheus_general_config_get();
+	enabled = config ? config->channel_metrics_enabled : 1;
+	interval = config ? config->channel_metrics_interval : 0;
+	ao2_cleanup(config);
+
+	if (!enabled || num_channels == 0) {
 		ao2_ref(channels, -1);
 		return;
 	}
 
 	/* Channel dependent values */
-	channel_metrics = ast_calloc(ARRAY_LEN(channel_metric_defs) * num_channels, sizeof(*channel_metrics));
-	if (!channel_metrics) {
+	if (!interval) {
+		channel_metrics_to_string(channels, num_channels, eid_str, response);
 		ao2_ref(channels, -1);
 		return;
 	}
 
-	it_chans = ao2_iterator_init(channels, 0);
-	for (i = 0; (snapshot = ao2_iterator_next(&it_chans)); ao2_ref(snapshot, -1), i++) {
-		for (j = 0; j < ARRAY_LEN(channel_metric_defs); j++) {
-			int index = i * ARRAY_LEN(channel_metric_defs) + j;
-
-			channel_metrics[index].type = PROMETHEUS_METRIC_GAUGE;
-			ast_copy_string(channel_metrics[index].name, channel_metric_defs[j].name, sizeof(channel_metrics[index].name));
-			channel_metrics[index].help = channel_metric_defs[j].help;
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 0, "eid", eid_str);
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 1, "name", (snapshot->base->name));
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 2, "id", (snapshot->base->uniqueid));
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 3, "type", (snapshot->base->type));
-			if (snapshot->peer) {
-				PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 4, "linkedid", (snapshot->peer->linkedid));
-			}
-			channel_metric_defs[j].get_value(&channel_metrics[index], snapshot);
-
-			if (i > 0) {
-				AST_LIST_INSERT_TAIL(&channel_metrics[j].children, &channel_metrics[index], entry);
-			}
+	if (!channel_metrics_cache
+		|| ast_tvdiff_ms(ast_tvnow(), channel_metrics_cached) >= interval * 1000) {
+		if (!channel_metrics_cache) {
+			channel_metrics_cache = ast_str_create(4096);
+		} else {
+			ast_str_reset(channel_metrics_cache);
+		}
+		if (channel_metrics_cache) {
+			channel_metrics_to_string(channels, num_channels, eid_str, &channel_metrics_cache);
+			channel_metrics_cached = ast_tvnow();
 		}
 	}
-	ao2_iterator_destroy(&it_chans);
-
-	for (j = 0; j < ARRAY_LEN(channel_metric_defs); j++) {
-		prometheus_metric_to_string(&channel_metrics[j], response);
+	if (channel_metrics_cache) {
+		ast_str_append(response, 0, "%s", ast_str_buffer(channel_metrics_cache));
 	}
 
-	ast_free(channel_metrics);
 	ao2_ref(channels, -1);
 }
 
@@ -216,6 +272,20 @@ struct prometheus_callback channels_callback = {
 static void channel_metrics_unload_cb(void)
 {
 	prometheus_callback_unregister(&channels_callback);
+	ast_free(channel_metrics_cache);
+	channel_metrics_cache = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is reloaded
+ */
+static int channel_metrics_reload_cb(struct prometheus_general_config *config)
+{
+	/* Gather them anew on the next scrape, as configured now */
+	channel_metrics_cached = ast_tv(0, 0);
+
+	return 0;
 }
 
 /*!
@@ -224,6 +294,7 @@ static void channel_metrics_unload_cb(void)
  */
 static struct prometheus_metrics_provider provider = {
 	.name = "channels",
+	.reload_cb = channel_metrics_reload_cb,
 	.unload_cb = channel_metrics_unload_cb,
 };
 
@@ -0,0 +1,121 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Frame Timing Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/frame_timing.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define FRAME_TRANSIT_HELP "Time media frames took from being read from RTP to a stage of the media path (in seconds)."
+
+/*! \internal \brief State of a scrape, passed to the histogram callback */
+struct frame_timing_scrape {
+	struct ast_str *transit;
+	const char *eid_str;
+};
+
+static void frame_timing_histogram_cb(const struct ast_frame_timing_histogram *histogram, void *data)
+{
+	struct frame_timing_scrape *scrape = data;
+	uint64_t cumulative = 0;
+	int bucket;
+
+	for (bucket = 0; bucket < AST_FRAME_TIMING_BUCKETS - 1; ++bucket) {
+		cumulative += histogram->buckets[bucket];
+		ast_str_append(&scrape->transit, 0,
+			"asterisk_frame_transit_seconds_bucket{eid=\"%s\",technology=\"%s\",stage=\"%s\",le=\"%f\"} %" PRIu64 "\n",
+			scrape->eid_str, histogram->technology, ast_frame_timing_stage_name(histogram->stage),
+			ast_frame_timing_bucket_bound(bucket) / 1000000.0, cumulative);
+	}
+	ast_str_append(&scrape->transit, 0,
+		"asterisk_frame_transit_seconds_bucket{eid=\"%s\",technology=\"%s\",stage=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+		scrape->eid_str, histogram->technology, ast_frame_timing_stage_name(histogram->stage),
+		histogram->count);
+	ast_str_append(&scrape->transit, 0,
+		"asterisk_frame_transit_seconds_sum{eid=\"%s\",technology=\"%s\",stage=\"%s\"} %f\n",
+		scrape->eid_str, histogram->technology, ast_frame_timing_stage_name(histogram->stage),
+		histogram->sum / 1000000.0);
+	ast_str_append(&scrape->transit, 0,
+		"asterisk_frame_transit_seconds_count{eid=\"%s\",technology=\"%s\",stage=\"%s\"} %" PRIu64 "\n",
+		scrape->eid_str, histogram->technology, ast_frame_timing_stage_name(histogram->stage),
+		histogram->count);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void frame_timing_scrape_cb(struct ast_str **response)
+{
+	struct frame_timing_scrape scrape;
+	char eid_str[32];
+
+	scrape.transit = ast_str_create(4096);
+	if (!scrape.transit) {
+		return;
+	}
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+	scrape.eid_str = eid_str;
+
+	ast_frame_timing_histograms(frame_timing_histogram_cb, &scrape);
+
+	prometheus_metric_family_to_string(response, "asterisk_frame_transit_seconds",
+		"histogram", FRAME_TRANSIT_HELP, scrape.transit);
+
+	ast_free(scrape.transit);
+}
+
+struct prometheus_callback frame_timing_callback = {
+	.name = "frame timing callback",
+	.callback_fn = frame_timing_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void frame_timing_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&frame_timing_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "frame_timing",
+	.unload_cb = frame_timing_metrics_unload_cb,
+};
+
+int frame_timing_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&frame_timing_callback);
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Lock Contention Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/lock.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define LOCK_SAMPLES_HELP "Lock acquisitions sampled at the location."
+
+#define LOCK_CONTENDED_HELP "Sampled lock acquisitions at the location that had to wait."
+
+#define LOCK_WAIT_HELP "Time sampled lock acquisitions at the location waited (in seconds)."
+
+/*!
+ * \internal
+ * \brief Most locations exported, those waiting longest
+ */
+#define LOCK_SITES_EXPORTED 50
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void locks_scrape_cb(struct ast_str **response)
+{
+	struct ast_lock_profile_site sites[LOCK_SITES_EXPORTED];
+	struct ast_str *samples = NULL;
+	struct ast_str *contended = NULL;
+	struct ast_str *wait = NULL;
+	char eid_str[32];
+	int count;
+	int i;
+
+	if (!ast_lock_profile_get_rate()) {
+		return;
+	}
+
+	count = ast_lock_profile_collect(sites, ARRAY_LEN(sites));
+	if (!count) {
+		return;
+	}
+
+	samples = ast_str_create(4096);
+	contended = ast_str_create(4096);
+	wait = ast_str_create(4096);
+	if (!samples || !contended || !wait) {
+		goto cleanup;
+	}
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+
+	for (i = 0; i < count; ++i) {
+		ast_str_append(&samples, 0,
+			"asterisk_lock_samples{eid=\"%s\",location=\"%s:%d\",lock=\"%s\"} %u\n",
+			eid_str, sites[i].file, sites[i].line, sites[i].name, sites[i].samples);
+		ast_str_append(&contended, 0,
+			"asterisk_lock_contended{eid=\"%s\",location=\"%s:%d\",lock=\"%s\"} %u\n",
+			eid_str, sites[i].file, sites[i].line, sites[i].name, sites[i].contended);
+		ast_str_append(&wait, 0,
+			"asterisk_lock_wait_seconds{eid=\"%s\",location=\"%s:%d\",lock=\"%s\"} %f\n",
+			eid_str, sites[i].file, sites[i].line, sites[i].name, sites[i].wait_us / 1000000.0);
+	}
+
+	prometheus_metric_family_to_string(response, "asterisk_lock_samples",
+		"counter", LOCK_SAMPLES_HELP, samples);
+	prometheus_metric_family_to_string(response, "asterisk_lock_contended",
+		"counter", LOCK_CONTENDED_HELP, contended);
+	prometheus_metric_family_to_string(response, "asterisk_lock_wait_seconds",
+		"counter", LOCK_WAIT_HELP, wait);
+
+cleanup:
+	ast_free(samples);
+	ast_free(contended);
+	ast_free(wait);
+}
+
+struct prometheus_callback locks_callback = {
+	.name = "locks callback",
+	.callback_fn = locks_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void lock_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&locks_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "locks",
+	.unload_cb = lock_metrics_unload_cb,
+};
+
+int lock_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&locks_callback);
+
+	return 0;
+}
@@ -59,6 +59,22 @@ struct timeval prometheus_last_scrape_time_get(void);
  */
 struct ast_str *prometheus_scrape_to_string(void);
 
+/*!
+ * \brief Write out a metric family whose samples were formatted by the caller
+ *
+ * \details
+ * This is for metrics, such as histograms, that do not fit a
+ * \ref prometheus_metric.  Nothing is written if there are no samples.
+ *
+ * \param response The response to append to
+ * \param name Name of the metric family
+ * \param type The Prometheus type of the family, such as "histogram"
+ * \param help Help text of the family
+ * \param samples The formatted samples
+ */
+void prometheus_metric_family_to_string(struct ast_str **response, const char *name,
+	const char *type, const char *help, struct ast_str *samples);
+
 /*!
  * \brief Initialize CLI command
  *
@@ -99,4 +115,44 @@ int bridge_metrics_init(void);
  */
 int pjsip_outbound_registration_metrics_init(void);
 
+/*!
+ * \brief Initialize taskprocessor metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int taskprocessor_metrics_init(void);
+
+/*!
+ * \brief Initialize stasis metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int stasis_metrics_init(void);
+
+/*!
+ * \brief Initialize lock contention metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int lock_metrics_init(void);
+
+/*!
+ * \brief Initialize frame timing metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int frame_timing_metrics_init(void);
+
+/*!
+ * \brief Initialize TLS handshake metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int tls_metrics_init(void);
+
 #endif /* #define PROMETHEUS_INTERNAL_H__ */
@@ -0,0 +1,171 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Stasis Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/stasis.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define TOPIC_PUBLISHED_HELP "Messages published to the topic."
+
+#define TOPIC_SUBSCRIPTIONS_HELP "Subscriptions made to the topic."
+
+#define SUBSCRIPTION_DISPATCHED_HELP "Messages dispatched to the subscriber."
+
+#define SUBSCRIPTION_QUEUED_HELP "Messages waiting in the mailbox of the subscriber."
+
+#define SUBSCRIPTION_LATENCY_HELP "Sampled time from the creation of a message until the subscriber handled it (in seconds)."
+
+/*!
+ * \internal
+ * \brief The samples of each metric family, written out after collection
+ */
+struct stasis_scrape {
+	/*! The entity ID label value */
+	char eid_str[32];
+	struct ast_str *published;
+	struct ast_str *subscriptions;
+	struct ast_str *dispatched;
+	struct ast_str *queued;
+	struct ast_str *latency;
+};
+
+static void topic_metrics_cb(const struct stasis_topic_metrics *metrics, void *data)
+{
+	struct stasis_scrape *scrape = data;
+
+	ast_str_append(&scrape->published, 0,
+		"asterisk_stasis_topic_messages_published{eid=\"%s\",topic=\"%s\"} %" PRIu64 "\n",
+		scrape->eid_str, metrics->name, metrics->published);
+	ast_str_append(&scrape->subscriptions, 0,
+		"asterisk_stasis_topic_subscriptions{eid=\"%s\",topic=\"%s\"} %zu\n",
+		scrape->eid_str, metrics->name, metrics->subscriptions);
+}
+
+static void subscription_metrics_cb(const struct stasis_subscription_metrics *metrics, void *data)
+{
+	struct stasis_scrape *scrape = data;
+	uint64_t cumulative = 0;
+	int bucket;
+
+	ast_str_append(&scrape->dispatched, 0,
+		"asterisk_stasis_subscription_messages_dispatched{eid=\"%s\",topic=\"%s\",subscription=\"%s\"} %" PRIu64 "\n",
+		scrape->eid_str, metrics->topic, metrics->uniqueid, metrics->dispatched);
+	ast_str_append(&scrape->queued, 0,
+		"asterisk_stasis_subscription_messages_queued{eid=\"%s\",topic=\"%s\",subscription=\"%s\"} %ld\n",
+		scrape->eid_str, metrics->topic, metrics->uniqueid, metrics->queued);
+
+	for (bucket = 0; bucket < STASIS_LATENCY_BUCKETS; ++bucket) {
+		cumulative += metrics->latency_buckets[bucket];
+		if (bucket < STASIS_LATENCY_BUCKETS - 1) {
+			ast_str_append(&scrape->latency, 0,
+				"asterisk_stasis_subscription_latency_seconds_bucket{eid=\"%s\",topic=\"%s\",subscription=\"%s\",le=\"%g\"} %" PRIu64 "\n",
+				scrape->eid_str, metrics->topic, metrics->uniqueid,
+				stasis_latency_bounds[bucket] / 1000000.0, cumulative);
+		} else {
+			ast_str_append(&scrape->latency, 0,
+				"asterisk_stasis_subscription_latency_seconds_bucket{eid=\"%s\",topic=\"%s\",subscription=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+				scrape->eid_str, metrics->topic, metrics->uniqueid, cumulative);
+		}
+	}
+	ast_str_append(&scrape->latency, 0,
+		"asterisk_stasis_subscription_latency_seconds_sum{eid=\"%s\",topic=\"%s\",subscription=\"%s\"} %f\n",
+		scrape->eid_str, metrics->topic, metrics->uniqueid, metrics->latency_sum / 1000000.0);
+	ast_str_append(&scrape->latency, 0,
+		"asterisk_stasis_subscription_latency_seconds_count{eid=\"%s\",topic=\"%s\",subscription=\"%s\"} %" PRIu64 "\n",
+		scrape->eid_str, metrics->topic, metrics->uniqueid, metrics->samples);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void stasis_scrape_cb(struct ast_str **response)
+{
+	struct stasis_scrape scrape = {
+		.published = ast_str_create(1024),
+		.subscriptions = ast_str_create(1024),
+		.dispatched = ast_str_create(1024),
+		.queued = ast_str_create(1024),
+		.latency = ast_str_create(4096),
+	};
+
+	if (!scrape.published || !scrape.subscriptions || !scrape.dispatched
+		|| !scrape.queued || !scrape.latency) {
+		goto cleanup;
+	}
+
+	ast_eid_to_str(scrape.eid_str, sizeof(scrape.eid_str), &ast_eid_default);
+
+	stasis_metrics_collect(topic_metrics_cb, subscription_metrics_cb, &scrape);
+
+	prometheus_metric_family_to_string(response, "asterisk_stasis_topic_messages_published",
+		"counter", TOPIC_PUBLISHED_HELP, scrape.published);
+	prometheus_metric_family_to_string(response, "asterisk_stasis_topic_subscriptions",
+		"gauge", TOPIC_SUBSCRIPTIONS_HELP, scrape.subscriptions);
+	prometheus_metric_family_to_string(response, "asterisk_stasis_subscription_messages_dispatched",
+		"counter", SUBSCRIPTION_DISPATCHED_HELP, scrape.dispatched);
+	prometheus_metric_family_to_string(response, "asterisk_stasis_subscription_messages_queued",
+		"gauge", SUBSCRIPTION_QUEUED_HELP, scrape.queued);
+	prometheus_metric_family_to_string(response, "asterisk_stasis_subscription_latency_seconds",
+		"histogram", SUBSCRIPTION_LATENCY_HELP, scrape.latency);
+
+cleanup:
+	ast_free(scrape.published);
+	ast_free(scrape.subscriptions);
+	ast_free(scrape.dispatched);
+	ast_free(scrape.queued);
+	ast_free(scrape.latency);
+}
+
+struct prometheus_callback stasis_callback = {
+	.name = "stasis callback",
+	.callback_fn = stasis_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void stasis_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&stasis_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "stasis",
+	.unload_cb = stasis_metrics_unload_cb,
+};
+
+int stasis_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&stasis_callback);
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Taskprocessor Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/taskprocessor.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define TASKS_PROCESSED_HELP "Tasks executed by the taskprocessor."
+
+#define TASKS_QUEUED_HELP "Tasks waiting in the taskprocessor queue."
+
+#define TASKS_MAX_QUEUED_HELP "Most tasks waiting in the taskprocessor queue at once."
+
+#define EXECUTION_HELP "Time spent executing tasks (in seconds)."
+
+#define WAIT_HELP "Time tasks spent queued before executing (in seconds)."
+
+/*!
+ * \internal
+ * \brief Only every other histogram bucket is exported, a factor of 4 apart
+ */
+#define BUCKET_STRIDE 2
+
+/*!
+ * \internal
+ * \brief The samples of each metric family, written out after collection
+ */
+struct taskprocessor_scrape {
+	/*! The entity ID label value */
+	char eid_str[32];
+	struct ast_str *processed;
+	struct ast_str *queued;
+	struct ast_str *max_queued;
+	struct ast_str *execution;
+	struct ast_str *wait;
+};
+
+/*!
+ * \internal
+ * \brief Format the samples of a taskprocessor histogram
+ */
+static void histogram_to_string(struct ast_str **samples, const char *name,
+	const char *eid_str, const char *taskprocessor, const uint64_t *buckets, int64_t sum)
+{
+	uint64_t cumulative = 0;
+	int bucket;
+
+	for (bucket = 0; bucket < AST_TASKPROCESSOR_HISTOGRAM_BUCKETS - 1; ++bucket) {
+		cumulative += buckets[bucket];
+		if (bucket % BUCKET_STRIDE) {
+			continue;
+		}
+		ast_str_append(samples, 0, "%s_bucket{eid=\"%s\",taskprocessor=\"%s\",le=\"%g\"} %" PRIu64 "\n",
+			name, eid_str, taskprocessor, (double) (INT64_C(1) << bucket) / 1000000.0, cumulative);
+	}
+	cumulative += buckets[bucket];
+	ast_str_append(samples, 0, "%s_bucket{eid=\"%s\",taskprocessor=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+		name, eid_str, taskprocessor, cumulative);
+	ast_str_append(samples, 0, "%s_sum{eid=\"%s\",taskprocessor=\"%s\"} %f\n",
+		name, eid_str, taskprocessor, sum / 1000000.0);
+	ast_str_append(samples, 0, "%s_count{eid=\"%s\",taskprocessor=\"%s\"} %" PRIu64 "\n",
+		name, eid_str, taskprocessor, cumulative);
+}
+
+static void taskprocessor_metrics_cb(const struct ast_taskprocessor_metrics *metrics, void *data)
+{
+	struct taskprocessor_scrape *scrape = data;
+
+	ast_str_append(&scrape->processed, 0,
+		"asterisk_taskprocessor_tasks_processed{eid=\"%s\",taskprocessor=\"%s\"} %lu\n",
+		scrape->eid_str, metrics->name, metrics->processed);
+	ast_str_append(&scrape->queued, 0,
+		"asterisk_taskprocessor_tasks_queued{eid=\"%s\",taskprocessor=\"%s\"} %ld\n",
+		scrape->eid_str, metrics->name, metrics->queued);
+	ast_str_append(&scrape->max_queued, 0,
+		"asterisk_taskprocessor_tasks_max_queued{eid=\"%s\",taskprocessor=\"%s\"} %lu\n",
+		scrape->eid_str, metrics->name, metrics->max_queued);
+	histogram_to_string(&scrape->execution, "asterisk_taskprocessor_execution_seconds",
+		scrape->eid_str, metrics->name, metrics->execution, metrics->execution_sum);
+	histogram_to_string(&scrape->wait, "asterisk_taskprocessor_wait_seconds",
+		scrape->eid_str, metrics->name, metrics->wait, metrics->wait_sum);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void taskprocessors_scrape_cb(struct ast_str **response)
+{
+	struct taskprocessor_scrape scrape = {
+		.processed = ast_str_create(4096),
+		.queued = ast_str_create(4096),
+		.max_queued = ast_str_create(4096),
+		.execution = ast_str_create(16384),
+		.wait = ast_str_create(16384),
+	};
+
+	if (!scrape.processed || !scrape.queued || !scrape.max_queued
+		|| !scrape.execution || !scrape.wait) {
+		goto cleanup;
+	}
+
+	ast_eid_to_str(scrape.eid_str, sizeof(scrape.eid_str), &ast_eid_default);
+
+	ast_taskprocessor_metrics_collect(taskprocessor_metrics_cb, &scrape);
+
+	prometheus_metric_family_to_string(response, "asterisk_taskprocessor_tasks_processed",
+		"counter", TASKS_PROCESSED_HELP, scrape.processed);
+	prometheus_metric_family_to_string(response, "asterisk_taskprocessor_tasks_queued",
+		"gauge", TASKS_QUEUED_HELP, scrape.queued);
+	prometheus_metric_family_to_string(response, "asterisk_taskprocessor_tasks_max_queued",
+		"gauge", TASKS_MAX_QUEUED_HELP, scrape.max_queued);
+	prometheus_metric_family_to_string(response, "asterisk_taskprocessor_execution_seconds",
+		"histogram", EXECUTION_HELP, scrape.execution);
+	prometheus_metric_family_to_string(response, "asterisk_taskprocessor_wait_seconds",
+		"histogram", WAIT_HELP, scrape.wait);
+
+cleanup:
+	ast_free(scrape.processed);
+	ast_free(scrape.queued);
+	ast_free(scrape.max_queued);
+	ast_free(scrape.execution);
+	ast_free(scrape.wait);
+}
+
+struct prometheus_callback taskprocessors_callback = {
+	.name = "taskprocessors callback",
+	.callback_fn = taskprocessors_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void taskprocessor_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&taskprocessors_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "taskprocessors",
+	.unload_cb = taskprocessor_metrics_unload_cb,
+};
+
+int taskprocessor_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&taskprocessors_callback);
+
+	return 0;
+}
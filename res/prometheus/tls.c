@@ -0,0 +1,115 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus TLS Handshake Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/tcptls.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define HANDSHAKES_HELP "TLS handshakes made, by whether a session was resumed."
+
+#define HANDSHAKES_FAILED_HELP "TLS handshakes that failed."
+
+#define HANDSHAKE_SECONDS_HELP "Time spent in TLS handshakes, by whether a session was resumed (in seconds)."
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void tls_scrape_cb(struct ast_str **response)
+{
+	struct ast_tls_handshake_stats stats;
+	struct ast_str *handshakes = NULL;
+	struct ast_str *failed = NULL;
+	struct ast_str *seconds = NULL;
+	char eid_str[32];
+
+	handshakes = ast_str_create(256);
+	failed = ast_str_create(128);
+	seconds = ast_str_create(256);
+	if (!handshakes || !failed || !seconds) {
+		goto cleanup;
+	}
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+	ast_tls_get_handshake_stats(&stats);
+
+	ast_str_append(&handshakes, 0,
+		"asterisk_tls_handshakes{eid=\"%s\",resumed=\"no\"} %lu\n", eid_str, stats.full);
+	ast_str_append(&handshakes, 0,
+		"asterisk_tls_handshakes{eid=\"%s\",resumed=\"yes\"} %lu\n", eid_str, stats.resumed);
+	ast_str_append(&failed, 0,
+		"asterisk_tls_handshakes_failed{eid=\"%s\"} %lu\n", eid_str, stats.failed);
+	ast_str_append(&seconds, 0,
+		"asterisk_tls_handshake_seconds{eid=\"%s\",resumed=\"no\"} %f\n",
+		eid_str, stats.full_us / 1000000.0);
+	ast_str_append(&seconds, 0,
+		"asterisk_tls_handshake_seconds{eid=\"%s\",resumed=\"yes\"} %f\n",
+		eid_str, stats.resumed_us / 1000000.0);
+
+	prometheus_metric_family_to_string(response, "asterisk_tls_handshakes",
+		"counter", HANDSHAKES_HELP, handshakes);
+	prometheus_metric_family_to_string(response, "asterisk_tls_handshakes_failed",
+		"counter", HANDSHAKES_FAILED_HELP, failed);
+	prometheus_metric_family_to_string(response, "asterisk_tls_handshake_seconds",
+		"counter", HANDSHAKE_SECONDS_HELP, seconds);
+
+cleanup:
+	ast_free(handshakes);
+	ast_free(failed);
+	ast_free(seconds);
+}
+
+struct prometheus_callback tls_callback = {
+	.name = "tls callback",
+	.callback_fn = tls_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void tls_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&tls_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "tls",
+	.unload_cb = tls_metrics_unload_cb,
+};
+
+int tls_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&tls_callback);
+
+	return 0;
+}
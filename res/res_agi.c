@@ -2056,6 +2056,8 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 	char *host, *script;
 	int num_addrs = 0, i = 0;
 	struct ast_sockaddr *addrs;
+	struct timeval start = ast_tvnow();
+	int arg = 1;
 
 	/* agiurl is "agi://host.domain[:port][/script/name]" */
 	host = ast_strdupa(agiurl + 6);	/* Remove agi:// */
@@ -2104,6 +2106,13 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 		return AGI_RESULT_FAILURE;
 	}
 
+	/* Set TCP_NODELAY on the socket to disable Nagle's algorithm.  The
+	 * environment and each command are written in small pieces, and
+	 * must not wait for the server to acknowledge the previous one. */
+	if (setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *) &arg, sizeof(arg)) < 0) {
+		ast_log(LOG_WARNING, "Failed to set TCP_NODELAY on FastAGI connection: %s\n", strerror(errno));
+	}
+
 	if (ast_agi_send(s, NULL, "agi_network: yes\n") < 0) {
 		if (errno != EINTR) {
 			ast_log(LOG_WARNING, "Connect to '%s' failed: %s\n", agiurl, strerror(errno));
@@ -2118,7 +2127,7 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 		ast_agi_send(s, NULL, "agi_network_script: %s\n", script);
 	}
 
-	ast_debug(4, "Wow, connected!\n");
+	ast_debug(4, "Connected to '%s' in %" PRIi64 " ms\n", agiurl, ast_tvdiff_ms(ast_tvnow(), start));
 	fds[0] = s;
 	fds[1] = s;
 	return AGI_RESULT_SUCCESS_FAST;
@@ -168,6 +168,45 @@ static ast_mutex_t root_handler_lock;
 /*! Handler for root RESTful resource. */
 static struct stasis_rest_handlers *root_handler;
 
+/*! \brief A path segment of the compiled route table */
+struct ari_route;
+
+/*! \brief An explicit path segment leading on from a route */
+struct ari_route_child {
+	/*! Path segment matched exactly */
+	const char *path_segment;
+	/*! Route the segment leads to */
+	struct ari_route *route;
+};
+
+/*! \brief A node of the compiled route table */
+struct ari_route {
+	/*! Handler of the path up to this node */
+	struct stasis_rest_handlers *handler;
+	/*! Route taken when no explicit segment matches, may be NULL */
+	struct ari_route *wildcard;
+	/*! Number of explicit segments */
+	size_t num_children;
+	/*! Explicit segments, sorted for a binary search */
+	struct ari_route_child children[];
+};
+
+/*!
+ * \brief Route table compiled from \ref root_handler.
+ *
+ * Rebuilt along with \ref root_handler whenever a resource is added or
+ * removed, so requests are routed without walking each handler's children.
+ */
+struct ari_routes {
+	/*! The root handler the table was compiled from */
+	struct stasis_rest_handlers *root_handler;
+	/*! Route for the root handler */
+	struct ari_route *root;
+};
+
+/*! Compiled routes of \ref root_handler, protected by \ref root_handler_lock. */
+static struct ari_routes *routes;
+
 /*! Pre-defined message for allocation failures. */
 static struct ast_json *oom_json;
 
@@ -176,9 +215,124 @@ struct ast_json *ast_ari_oom_json(void)
 	return oom_json;
 }
 
+static int ari_route_child_cmp(const void *key, const void *member)
+{
+	const struct ari_route_child *left = key;
+	const struct ari_route_child *right = member;
+
+	return strcmp(left->path_segment, right->path_segment);
+}
+
+static void ari_route_free(struct ari_route *route)
+{
+	size_t i;
+
+	if (!route) {
+		return;
+	}
+
+	for (i = 0; i < route->num_children; ++i) {
+		ari_route_free(route->children[i].route);
+	}
+	ari_route_free(route->wildcard);
+	ast_free(route);
+}
+
+static struct ari_route *ari_route_compile(struct stasis_rest_handlers *handler)
+{
+	struct ari_route *route;
+	size_t i;
+
+	route = ast_calloc(1, sizeof(*route) + handler->num_children * sizeof(route->children[0]));
+	if (!route) {
+		return NULL;
+	}
+	route->handler = handler;
+
+	for (i = 0; i < handler->num_children; ++i) {
+		struct stasis_rest_handlers *child = handler->children[i];
+		size_t j;
+
+		if (child->is_wildcard) {
+			/* Only one wildcard is ever tried */
+			if (!route->wildcard) {
+				route->wildcard = ari_route_compile(child);
+				if (!route->wildcard) {
+					ari_route_free(route);
+					return NULL;
+				}
+			}
+			continue;
+		}
+
+		/* The first handler of a segment is the one matched */
+		for (j = 0; j < route->num_children; ++j) {
+			if (!strcmp(route->children[j].path_segment, child->path_segment)) {
+				break;
+			}
+		}
+		if (j < route->num_children) {
+			continue;
+		}
+
+		route->children[route->num_children].path_segment = child->path_segment;
+		route->children[route->num_children].route = ari_route_compile(child);
+		if (!route->children[route->num_children++].route) {
+			ari_route_free(route);
+			return NULL;
+		}
+	}
+
+	qsort(route->children, route->num_children, sizeof(route->children[0]), ari_route_child_cmp);
+
+	return route;
+}
+
+static void ari_routes_dtor(void *obj)
+{
+	struct ari_routes *compiled = obj;
+
+	ari_route_free(compiled->root);
+	ao2_cleanup(compiled->root_handler);
+}
+
+/*!
+ * \internal
+ * \brief Compile the route table of a root handler
+ *
+ * \return The route table, or NULL on allocation failure
+ */
+static struct ari_routes *ari_routes_compile(struct stasis_rest_handlers *handler)
+{
+	struct ari_routes *compiled;
+
+	compiled = ao2_alloc_options(sizeof(*compiled), ari_routes_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!compiled) {
+		return NULL;
+	}
+
+	compiled->root = ari_route_compile(handler);
+	if (!compiled->root) {
+		ao2_ref(compiled, -1);
+		return NULL;
+	}
+	ao2_ref(handler, +1);
+	compiled->root_handler = handler;
+
+	return compiled;
+}
+
+static struct ari_routes *get_routes(void)
+{
+	SCOPED_MUTEX(lock, &root_handler_lock);
+	ao2_bump(routes);
+	return routes;
+}
+
 int ast_ari_add_handler(struct stasis_rest_handlers *handler)
 {
 	RAII_VAR(struct stasis_rest_handlers *, new_handler, NULL, ao2_cleanup);
+	struct ari_routes *new_routes;
 	size_t old_size, new_size;
 
 	SCOPED_MUTEX(lock, &root_handler_lock);
@@ -193,6 +347,13 @@ int ast_ari_add_handler(struct stasis_rest_handlers *handler)
 	memcpy(new_handler, root_handler, old_size);
 	new_handler->children[new_handler->num_children++] = handler;
 
+	new_routes = ari_routes_compile(new_handler);
+	if (!new_routes) {
+		return -1;
+	}
+	ao2_cleanup(routes);
+	routes = new_routes;
+
 	ao2_cleanup(root_handler);
 	ao2_ref(new_handler, +1);
 	root_handler = new_handler;
@@ -227,6 +388,11 @@ int ast_ari_remove_handler(struct stasis_rest_handlers *handler)
 	}
 	new_handler->num_children = j;
 
+	/* The old routes must not outlive the removed handler. Without routes
+	 * requests fail until the next handler is added. */
+	ao2_cleanup(routes);
+	routes = ari_routes_compile(new_handler);
+
 	/* Replace the old root_handler with the new. */
 	ao2_cleanup(root_handler);
 	root_handler = new_handler;
@@ -302,6 +468,63 @@ void ast_ari_response_alloc_failed(struct ast_ari_response *response)
 	response->response_text = "Internal Server Error";
 }
 
+void ast_ari_response_ok_stream(struct ast_ari_response *response,
+	ast_ari_response_stream_fn stream_fn, void *data, void (*data_destroy)(void *data))
+{
+	/* The generated handlers validate the message of a list response before
+	 * the body is streamed, an empty array satisfies them. */
+	response->message = ast_json_array_create();
+	response->response_code = 200;
+	response->response_text = "OK";
+	response->stream_fn = stream_fn;
+	response->stream_data = data;
+	response->stream_data_destroy = data_destroy;
+}
+
+/*! \brief Encoder writing a streamed response body */
+struct ast_ari_json_stream {
+	/*! Writer encoding the response body */
+	struct ast_json_writer writer;
+};
+
+int ast_ari_json_stream_array_start(struct ast_ari_json_stream *stream)
+{
+	return ast_json_writer_array_start(&stream->writer);
+}
+
+int ast_ari_json_stream_array_append(struct ast_ari_json_stream *stream, struct ast_json *element)
+{
+	int res = -1;
+
+	if (element) {
+		res = ast_json_writer_value(&stream->writer, element);
+	}
+	ast_json_unref(element);
+
+	return res;
+}
+
+int ast_ari_json_stream_array_end(struct ast_ari_json_stream *stream)
+{
+	ast_json_writer_array_end(&stream->writer);
+	return ast_json_writer_finish(&stream->writer);
+}
+
+struct ast_json_writer *ast_ari_json_stream_writer(struct ast_ari_json_stream *stream)
+{
+	return &stream->writer;
+}
+
+static void response_stream_release(struct ast_ari_response *response)
+{
+	if (response->stream_data_destroy) {
+		response->stream_data_destroy(response->stream_data);
+	}
+	response->stream_fn = NULL;
+	response->stream_data = NULL;
+	response->stream_data_destroy = NULL;
+}
+
 void ast_ari_response_created(struct ast_ari_response *response,
 	const char *url, struct ast_json *message)
 {
@@ -493,64 +716,61 @@ void ast_ari_invoke(struct ast_tcptls_session_instance *ser,
 	struct ast_variable *get_params, struct ast_variable *headers,
 	struct ast_json *body, struct ast_ari_response *response)
 {
-	RAII_VAR(struct stasis_rest_handlers *, root, NULL, ao2_cleanup);
+	RAII_VAR(struct ari_routes *, compiled, NULL, ao2_cleanup);
+	struct ari_route *route;
 	struct stasis_rest_handlers *handler;
-	struct stasis_rest_handlers *wildcard_handler = NULL;
 	RAII_VAR(struct ast_variable *, path_vars, NULL, ast_variables_destroy);
 	char *path = ast_strdupa(uri);
 	char *path_segment;
 	stasis_rest_callback callback;
 
-	root = handler = get_root_handler();
-	ast_assert(root != NULL);
+	compiled = get_routes();
+	if (!compiled) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+	route = compiled->root;
 
 	ast_debug(3, "Finding handler for %s\n", path);
 
 	while ((path_segment = strsep(&path, "/")) && (strlen(path_segment) > 0)) {
-		struct stasis_rest_handlers *found_handler = NULL;
-		int i;
+		struct ari_route_child key = { .path_segment = path_segment, };
+		struct ari_route_child *found;
 
 		ast_uri_decode(path_segment, ast_uri_http_legacy);
 		ast_debug(3, "  Finding handler for %s\n", path_segment);
 
-		for (i = 0; found_handler == NULL && i < handler->num_children; ++i) {
-			struct stasis_rest_handlers *child = handler->children[i];
-
-			if (child->is_wildcard) {
-				/* Record the path variable */
-				struct ast_variable *path_var = ast_variable_new(child->path_segment, path_segment, __FILE__);
-				path_var->next = path_vars;
-				path_vars = path_var;
-				wildcard_handler = child;
-				ast_debug(3, "        Checking %s %s:  Matched wildcard.\n", handler->path_segment, child->path_segment);
-
-			} else if (strcmp(child->path_segment, path_segment) == 0) {
-				found_handler = child;
-				ast_debug(3, "        Checking %s %s:  Explicit match with %s\n", handler->path_segment, child->path_segment, path_segment);
-			} else {
-				ast_debug(3, "        Checking %s %s:  Didn't match %s\n", handler->path_segment, child->path_segment, path_segment);
+		found = bsearch(&key, route->children, route->num_children,
+			sizeof(route->children[0]), ari_route_child_cmp);
+		if (found) {
+			ast_debug(3, "        Checking %s %s:  Explicit match with %s\n",
+				route->handler->path_segment, found->path_segment, path_segment);
+			route = found->route;
+		} else if (route->wildcard) {
+			/* Record the path variable */
+			struct ast_variable *path_var = ast_variable_new(
+				route->wildcard->handler->path_segment, path_segment, __FILE__);
+
+			if (!path_var) {
+				ast_ari_response_alloc_failed(response);
+				return;
 			}
-		}
-
-		if (!found_handler && wildcard_handler) {
+			path_var->next = path_vars;
+			path_vars = path_var;
 			ast_debug(3, "  No explicit handler found for %s.  Using wildcard %s.\n",
-				path_segment, wildcard_handler->path_segment);
-			found_handler = wildcard_handler;
-			wildcard_handler = NULL;
-		}
-
-		if (found_handler == NULL) {
+				path_segment, route->wildcard->handler->path_segment);
+			route = route->wildcard;
+		} else {
 			/* resource not found */
 			ast_debug(3, "  Handler not found for %s\n", path_segment);
 			ast_ari_response_error(
 				response, 404, "Not Found",
 				"Resource not found");
 			return;
-		} else {
-			handler = found_handler;
 		}
 	}
 
+	handler = route->handler;
 	ast_assert(handler != NULL);
 	if (method == AST_HTTP_OPTIONS) {
 		handle_options(handler, headers, response);
@@ -1062,6 +1282,7 @@ static int ast_ari_callback(struct ast_tcptls_session_instance *ser,
 	if (response.no_response) {
 		/* The handler indicates no further response is necessary.
 		 * Probably because it already handled it */
+		response_stream_release(&response);
 		ast_free(response.headers);
 		return 0;
 	}
@@ -1077,7 +1298,20 @@ request_failed:
 	/* response.message could be NULL, in which case the empty response_body
 	 * is correct
 	 */
-	if (response.message && !ast_json_is_null(response.message)) {
+	if (response.stream_fn && response.response_code == 200) {
+		struct ast_ari_json_stream stream;
+
+		ast_json_writer_init(&stream.writer, &response_body, conf->general->format);
+		/* The body is encoded an element at a time, never as a whole tree */
+		ast_str_append(&response.headers, 0,
+			       "Content-type: application/json\r\n");
+		if (response.stream_fn(&stream, response.stream_data)) {
+			response.response_code = 500;
+			response.response_text = "Internal Server Error";
+			ast_str_set(&response_body, 0, "%s", "");
+			ast_str_set(&response.headers, 0, "%s", "");
+		}
+	} else if (response.message && !ast_json_is_null(response.message)) {
 		ast_str_append(&response.headers, 0,
 			       "Content-type: application/json\r\n");
 		if (ast_json_dump_str_format(response.message, &response_body,
@@ -1103,6 +1337,7 @@ request_failed:
 	/* ast_http_send takes ownership, so we don't have to free them */
 	response_body = NULL;
 
+	response_stream_release(&response);
 	ast_json_unref(response.message);
 	if (response.fd >= 0) {
 		close(response.fd);
@@ -1131,6 +1366,8 @@ static int unload_module(void)
 
 	ast_ari_config_destroy();
 
+	ao2_cleanup(routes);
+	routes = NULL;
 	ao2_cleanup(root_handler);
 	root_handler = NULL;
 	ast_mutex_destroy(&root_handler_lock);
@@ -1152,6 +1389,13 @@ static int load_module(void)
 	if (!root_handler) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
+	if (!routes) {
+		routes = ari_routes_compile(root_handler);
+	}
+	if (!routes) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
 
 	/* oom_json may have been built during a declined load */
 	if (!oom_json) {
@@ -239,6 +239,7 @@ static void ast_ari_channels_originate_cb(
 	case 501: /* Not Implemented */
 	case 400: /* Invalid parameters for originating a channel. */
 	case 409: /* Channel with given unique ID already exists. */
+	case 503: /* Too many channels are being originated. */
 		is_valid = 1;
 		break;
 	default:
@@ -570,6 +571,7 @@ static void ast_ari_channels_originate_with_id_cb(
 	case 501: /* Not Implemented */
 	case 400: /* Invalid parameters for originating a channel. */
 	case 409: /* Channel with given unique ID already exists. */
+	case 503: /* Too many channels are being originated. */
 		is_valid = 1;
 		break;
 	default:
@@ -31,6 +31,7 @@
 #include "asterisk.h"
 #include "errno.h"
 #include <uuid/uuid.h>
+#include <sys/uio.h>
 
 #include "asterisk/file.h"
 #include "asterisk/res_audiosocket.h"
@@ -228,6 +229,37 @@ const int ast_audiosocket_send_frame(const int svc, const struct ast_frame *f)
 	return ret;
 }
 
+const int ast_audiosocket_send_frames(const int svc, struct ast_frame * const *frames, int count)
+{
+	uint8_t kind = 0x10;	/* always 16-bit, 8kHz signed linear mono, for now */
+	uint8_t headers[AST_AUDIOSOCKET_MAX_FRAMES][3];
+	struct iovec iov[AST_AUDIOSOCKET_MAX_FRAMES * 2];
+	ssize_t total = 0;
+	int i;
+
+	if (count < 1 || count > AST_AUDIOSOCKET_MAX_FRAMES) {
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		headers[i][0] = kind;
+		headers[i][1] = frames[i]->datalen >> 8;
+		headers[i][2] = frames[i]->datalen & 0xff;
+		iov[i * 2].iov_base = headers[i];
+		iov[i * 2].iov_len = sizeof(headers[i]);
+		iov[i * 2 + 1].iov_base = frames[i]->data.ptr;
+		iov[i * 2 + 1].iov_len = frames[i]->datalen;
+		total += sizeof(headers[i]) + frames[i]->datalen;
+	}
+
+	if (writev(svc, iov, count * 2) != total) {
+		ast_log(LOG_WARNING, "Failed to write data to AudioSocket\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 struct ast_frame *ast_audiosocket_receive_frame(const int svc)
 {
 
@@ -100,27 +100,17 @@ static inline int is_text(const struct odbc_cache_columns *column)
 
 static SQLHSTMT custom_prepare(struct odbc_obj *obj, void *data)
 {
-	int res, x = 1, count = 0;
+	int x = 1, count = 0;
 	struct custom_prepare_struct *cps = data;
 	const struct ast_variable *field;
 	char encodebuf[1024];
 	SQLHSTMT stmt;
 
-	res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
-	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
-		ast_log(LOG_WARNING, "SQL Alloc Handle failed!\n");
-		return NULL;
-	}
-
 	ast_debug(1, "Skip: %llu; SQL: %s\n", cps->skip, cps->sql);
 
-	res = ast_odbc_prepare(obj, stmt, cps->sql);
-	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
-		if (res == SQL_ERROR) {
-			ast_odbc_print_errors(SQL_HANDLE_STMT, stmt, "SQL Prepare");
-		}
-		ast_log(LOG_WARNING, "SQL Prepare failed! [%s]\n", cps->sql);
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	/* The generated SQL only depends on the fields requested, the values are bound */
+	stmt = ast_odbc_prepare_cached(obj, cps->sql);
+	if (!stmt) {
 		return NULL;
 	}
 
@@ -227,20 +217,20 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 	res = SQLNumResultCols(stmt, &colcount);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Column Count error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_statement(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 
 	res = SQLFetch(stmt);
 	if (res == SQL_NO_DATA) {
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_statement(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Fetch error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_statement(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -253,6 +243,7 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 			ast_log(LOG_WARNING, "SQL Describe Column error! [%s]\n", ast_str_buffer(sql));
 			if (var)
 				ast_variables_destroy(var);
+			ast_odbc_release_statement(obj, stmt);
 			ast_odbc_release_obj(obj);
 			return NULL;
 		}
@@ -282,6 +273,7 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 			ast_log(LOG_WARNING, "SQL Get Data error! [%s]\n", ast_str_buffer(sql));
 			if (var)
 				ast_variables_destroy(var);
+			ast_odbc_release_statement(obj, stmt);
 			ast_odbc_release_obj(obj);
 			return NULL;
 		}
@@ -320,7 +312,7 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 		}
 	}
 
-	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_statement(obj, stmt);
 	ast_odbc_release_obj(obj);
 	return var;
 }
@@ -339,7 +331,12 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
  * \retval var on success
  * \retval NULL on failure
  */
-static struct ast_config *realtime_multi_odbc(const char *database, const char *table, const struct ast_variable *fields)
+/*!
+ * \brief Retrieve the rows matching fields, and with in_field IN in_values if in_count
+ */
+static struct ast_config *realtime_multi_odbc_query(const char *database, const char *table,
+	const char *in_field, const char * const *in_values, size_t in_count,
+	const struct ast_variable *fields)
 {
 	struct odbc_obj *obj;
 	SQLHSTMT stmt;
@@ -365,25 +362,62 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	SQLSMALLINT nullable;
 	SQLLEN indicator;
 	struct custom_prepare_struct cps = { .fields = fields, };
+	struct ast_variable *in_vars = NULL;
+	struct ast_variable *in_last = NULL;
+	size_t i;
 
-	if (!table || !field || !sql || !rowdata) {
+	if (!table || (!field && !in_count) || !sql || !rowdata) {
 		return NULL;
 	}
 
+	/* The values are bound first, followed by the other fields */
+	for (i = 0; i < in_count; i++) {
+		struct ast_variable *in_var = ast_variable_new(in_field, in_values[i], "");
+
+		if (!in_var) {
+			ast_variables_destroy(in_vars);
+			return NULL;
+		}
+		if (in_last) {
+			in_last->next = in_var;
+		} else {
+			in_vars = in_var;
+		}
+		in_last = in_var;
+	}
+	if (in_last) {
+		in_last->next = (struct ast_variable *) fields;
+		cps.fields = in_vars;
+	}
+
 	obj = ast_odbc_request_obj2(database, connected_flag);
 	if (!obj) {
+		if (in_last) {
+			in_last->next = NULL;
+			ast_variables_destroy(in_vars);
+		}
 		return NULL;
 	}
 
-	initfield = ast_strdupa(field->name);
-	if ((op = strchr(initfield, ' '))) {
-		*op = '\0';
-	}
+	if (in_count) {
+		initfield = in_field;
+		ast_str_set(&sql, 0, "SELECT * FROM %s WHERE %s IN (", table, in_field);
+		for (i = 0; i < in_count; i++) {
+			ast_str_append(&sql, 0, "%s?", i ? ", " : "");
+		}
+		ast_str_append(&sql, 0, ")");
+	} else {
+		initfield = ast_strdupa(field->name);
+		if ((op = strchr(initfield, ' '))) {
+			*op = '\0';
+		}
 
-	op = !strchr(field->name, ' ') ? " =" : "";
-	ast_str_set(&sql, 0, "SELECT * FROM %s WHERE %s%s ?%s", table, field->name, op,
-		strcasestr(field->name, "LIKE") && !ast_odbc_backslash_is_escape(obj) ? " ESCAPE '\\\\'" : "");
-	while ((field = field->next)) {
+		op = !strchr(field->name, ' ') ? " =" : "";
+		ast_str_set(&sql, 0, "SELECT * FROM %s WHERE %s%s ?%s", table, field->name, op,
+			strcasestr(field->name, "LIKE") && !ast_odbc_backslash_is_escape(obj) ? " ESCAPE '\\\\'" : "");
+		field = field->next;
+	}
+	for (; field; field = field->next) {
 		op = !strchr(field->name, ' ') ? " =" : "";
 		ast_str_append(&sql, 0, " AND %s%s ?%s", field->name, op,
 			strcasestr(field->name, "LIKE") && !ast_odbc_backslash_is_escape(obj) ? " ESCAPE '\\\\'" : "");
@@ -393,11 +427,19 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	cps.sql = ast_str_buffer(sql);
 
 	if (ast_string_field_init(&cps, 256)) {
+		if (in_last) {
+			in_last->next = NULL;
+			ast_variables_destroy(in_vars);
+		}
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 	stmt = ast_odbc_prepare_and_execute(obj, custom_prepare, &cps);
 	ast_string_field_free_memory(&cps);
+	if (in_last) {
+		in_last->next = NULL;
+		ast_variables_destroy(in_vars);
+	}
 
 	if (!stmt) {
 		ast_odbc_release_obj(obj);
@@ -407,7 +449,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	res = SQLNumResultCols(stmt, &colcount);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Column Count error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_statement(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -415,7 +457,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	cfg = ast_config_new();
 	if (!cfg) {
 		ast_log(LOG_WARNING, "Out of memory!\n");
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_statement(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -493,11 +535,26 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 next_sql_fetch:;
 	}
 
-	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_statement(obj, stmt);
 	ast_odbc_release_obj(obj);
 	return cfg;
 }
 
+static struct ast_config *realtime_multi_odbc(const char *database, const char *table, const struct ast_variable *fields)
+{
+	return realtime_multi_odbc_query(database, table, NULL, NULL, 0, fields);
+}
+
+static struct ast_config *realtime_multi_in_odbc(const char *database, const char *table,
+	const char *field, const char * const *values, size_t count, const struct ast_variable *fields)
+{
+	if (!count) {
+		return NULL;
+	}
+
+	return realtime_multi_odbc_query(database, table, field, values, count, fields);
+}
+
 /*!
  * \brief Excute an UPDATE query
  * \param database
@@ -578,7 +635,7 @@ static int update_odbc(const char *database, const char *table, const char *keyf
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_statement(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -792,7 +849,7 @@ static int store_odbc(const char *database, const char *table, const struct ast_
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_statement(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -862,7 +919,7 @@ static int destroy_odbc(const char *database, const char *table, const char *key
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_statement(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -1246,6 +1303,7 @@ static struct ast_config_engine odbc_engine = {
 	.update2_func = update2_odbc,
 	.require_func = require_odbc,
 	.unload_func = unload_odbc,
+	.realtime_multi_in_func = realtime_multi_in_odbc,
 };
 
 static int unload_module (void)
@@ -523,7 +523,12 @@ static struct ast_variable *realtime_pgsql(const char *database, const char *tab
 	return var;
 }
 
-static struct ast_config *realtime_multi_pgsql(const char *database, const char *table, const struct ast_variable *fields)
+/*!
+ * \brief Retrieve the rows matching fields, and with in_field IN in_values if in_count
+ */
+static struct ast_config *realtime_multi_pgsql_query(const char *database, const char *table,
+	const char *in_field, const char * const *in_values, size_t in_count,
+	const struct ast_variable *fields)
 {
 	RAII_VAR(PGresult *, result, NULL, PQclear);
 	int num_rows = 0, pgresult;
@@ -564,7 +569,7 @@ static struct ast_config *realtime_multi_pgsql(const char *database, const char
 	}
 
 	/* Get the first parameter and first value in our list of passed paramater/value pairs */
-	if (!field) {
+	if (!field && !in_count) {
 		ast_log(LOG_WARNING,
 				"PostgreSQL RealTime: Realtime retrieval requires at least 1 parameter and 1 value to search on.\n");
 		if (pgsqlConn) {
@@ -576,34 +581,54 @@ static struct ast_config *realtime_multi_pgsql(const char *database, const char
 		return NULL;
 	}
 
-	initfield = ast_strdupa(field->name);
-	if ((op = strchr(initfield, ' '))) {
-		*op = '\0';
-	}
-
-	/* Create the first part of the query using the first parameter/value pairs we just extracted
-	   If there is only 1 set, then we have our query. Otherwise, loop thru the list and concat */
+	if (in_count) {
+		size_t i;
 
-	if (!strchr(field->name, ' ')) {
-		op = " =";
-		escape = "";
+		/* All the values are looked up in one query, the rows ordered by them */
+		initfield = in_field;
+		ast_str_set(&sql, 0, "SELECT * FROM %s WHERE %s IN (", table, in_field);
+		for (i = 0; i < in_count; i++) {
+			ESCAPE_STRING(escapebuf, in_values[i]);
+			if (pgresult) {
+				ast_log(LOG_ERROR, "PostgreSQL RealTime: detected invalid input: '%s'\n", in_values[i]);
+				ast_mutex_unlock(&pgsql_lock);
+				ast_config_destroy(cfg);
+				return NULL;
+			}
+			ast_str_append(&sql, 0, "%s'%s'", i ? ", " : "", ast_str_buffer(escapebuf));
+		}
+		ast_str_append(&sql, 0, ")");
 	} else {
-		op = "";
-		if (IS_SQL_LIKE_CLAUSE(field->name)) {
-			escape = ESCAPE_CLAUSE;
+		initfield = ast_strdupa(field->name);
+		if ((op = strchr(initfield, ' '))) {
+			*op = '\0';
 		}
-	}
 
-	ESCAPE_STRING(escapebuf, field->value);
-	if (pgresult) {
-		ast_log(LOG_ERROR, "PostgreSQL RealTime: detected invalid input: '%s'\n", field->value);
-		ast_mutex_unlock(&pgsql_lock);
-		ast_config_destroy(cfg);
-		return NULL;
-	}
+		/* Create the first part of the query using the first parameter/value pairs we just extracted
+		   If there is only 1 set, then we have our query. Otherwise, loop thru the list and concat */
 
-	ast_str_set(&sql, 0, "SELECT * FROM %s WHERE %s%s '%s'%s", table, field->name, op, ast_str_buffer(escapebuf), escape);
-	while ((field = field->next)) {
+		if (!strchr(field->name, ' ')) {
+			op = " =";
+			escape = "";
+		} else {
+			op = "";
+			if (IS_SQL_LIKE_CLAUSE(field->name)) {
+				escape = ESCAPE_CLAUSE;
+			}
+		}
+
+		ESCAPE_STRING(escapebuf, field->value);
+		if (pgresult) {
+			ast_log(LOG_ERROR, "PostgreSQL RealTime: detected invalid input: '%s'\n", field->value);
+			ast_mutex_unlock(&pgsql_lock);
+			ast_config_destroy(cfg);
+			return NULL;
+		}
+
+		ast_str_set(&sql, 0, "SELECT * FROM %s WHERE %s%s '%s'%s", table, field->name, op, ast_str_buffer(escapebuf), escape);
+		field = field->next;
+	}
+	for (; field; field = field->next) {
 		escape = "";
 		if (!strchr(field->name, ' ')) {
 			op = " =";
@@ -700,6 +725,21 @@ static struct ast_config *realtime_multi_pgsql(const char *database, const char
 	return cfg;
 }
 
+static struct ast_config *realtime_multi_pgsql(const char *database, const char *table, const struct ast_variable *fields)
+{
+	return realtime_multi_pgsql_query(database, table, NULL, NULL, 0, fields);
+}
+
+static struct ast_config *realtime_multi_in_pgsql(const char *database, const char *table,
+	const char *field, const char * const *values, size_t count, const struct ast_variable *fields)
+{
+	if (!count) {
+		return NULL;
+	}
+
+	return realtime_multi_pgsql_query(database, table, field, values, count, fields);
+}
+
 static int update_pgsql(const char *database, const char *tablename, const char *keyfield,
 						const char *lookup, const struct ast_variable *fields)
 {
@@ -1386,6 +1426,7 @@ static struct ast_config_engine pgsql_engine = {
 	.update2_func = update2_pgsql,
 	.require_func = require_pgsql,
 	.unload_func = unload_pgsql,
+	.realtime_multi_in_func = realtime_multi_in_pgsql,
 };
 
 static int load_module(void)
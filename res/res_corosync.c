@@ -46,6 +46,8 @@
 #include "asterisk/stasis.h"
 #include "asterisk/stasis_message_router.h"
 #include "asterisk/stasis_system.h"
+#include "asterisk/utils.h"
+#include "asterisk/vector.h"
 
 AST_RWLOCK_DEFINE_STATIC(event_types_lock);
 
@@ -287,6 +289,639 @@ static corosync_cfg_callbacks_t cfg_callbacks = {
 	.corosync_cfg_shutdown_callback = cfg_shutdown_cb,
 };
 
+/*! \brief How this server replicates state to the cluster */
+enum corosync_replication {
+	/*! Each event on its own, and a dump of the full state when a node joins */
+	COROSYNC_REPLICATION_LEGACY,
+	/*! Events in batches, and only the changes a node missed when it joins */
+	COROSYNC_REPLICATION_BATCHED,
+};
+
+#define DEFAULT_BATCH_INTERVAL 50
+
+/*! \brief The replication settings (Protected by batch_lock) */
+static struct {
+	enum corosync_replication mode;
+	/*! Most milliseconds an event waits in a batch */
+	unsigned int batch_interval;
+} replication = {
+	.mode = COROSYNC_REPLICATION_LEGACY,
+	.batch_interval = DEFAULT_BATCH_INTERVAL,
+};
+
+/*!
+ * \brief Type of the frames replicating state
+ *
+ * \details No event has this type, so that servers without batched
+ * replication ignore frames.
+ */
+#define COROSYNC_FRAME_TYPE 0xffff
+
+/*! \brief Version of the frame format */
+#define COROSYNC_FRAME_VERSION 1
+
+/*! \brief Most bytes of events carried by a frame */
+#define COROSYNC_FRAME_MAX_PAYLOAD 65000
+
+enum corosync_frame_kind {
+	/*! Events as they were published, the last of them being state_version */
+	COROSYNC_FRAME_BATCH = 1,
+	/*! The state version of the sender, sent when a node joins */
+	COROSYNC_FRAME_DIGEST,
+	/*! Asks the target for the events it published after from_version */
+	COROSYNC_FRAME_PULL,
+	/*! The events the sender published after from_version, answering a pull */
+	COROSYNC_FRAME_SYNC,
+};
+
+/*! \brief The last frame answering a pull */
+#define COROSYNC_FRAME_FLAG_LAST (1 << 0)
+
+/*!
+ * \brief The header of a frame, in network byte order
+ *
+ * \details It starts like an \ref ast_event holding only an EID information
+ * element, which is what servers without frames check before ignoring an
+ * event of an unknown type.
+ */
+struct corosync_frame {
+	uint16_t type;
+	/*! Length of the part of the header that looks like an event */
+	uint16_t event_len;
+	uint16_t eid_ie_type;
+	uint16_t eid_ie_len;
+	/*! The server that sent the frame */
+	struct ast_eid eid;
+	uint8_t version;
+	uint8_t kind;
+	uint8_t flags;
+	uint8_t reserved;
+	/*! Number of events in the payload */
+	uint16_t count;
+	uint16_t reserved2;
+	/*! Changes with each start of the sender, versions starting again from 0 */
+	uint32_t incarnation;
+	uint64_t state_version;
+	uint64_t from_version;
+	/*! The server a pull is for */
+	struct ast_eid target;
+	/*! When the frame was sent, for the replication lag */
+	uint32_t sent_sec;
+	uint32_t sent_usec;
+	unsigned char payload[0];
+} __attribute__((packed));
+
+/*! \brief An event this server published, by the state it changed */
+struct corosync_state {
+	/*! The state version of the change */
+	uint64_t version;
+	struct ast_event *event;
+	char key[0];
+};
+
+/*! \brief The state of a server as replicated to this one */
+struct corosync_peer {
+	struct ast_eid eid;
+	uint32_t incarnation;
+	/*! Changes up to this state version were received */
+	uint64_t version;
+	/*! A pull for the missing changes is in progress */
+	unsigned int pulling:1;
+	unsigned long frames;
+	unsigned long events;
+	/*! Milliseconds between sending and receiving the last frame */
+	int64_t last_lag;
+	int64_t max_lag;
+};
+
+AST_MUTEX_DEFINE_STATIC(batch_lock);
+
+/*! \brief The events waiting to be sent, and the state they changed (Protected by batch_lock) */
+static struct {
+	/*! The state versions of the events published */
+	uint64_t version;
+	uint32_t incarnation;
+	/*! The last event changing each state, by key */
+	struct ao2_container *states;
+	unsigned char frame[sizeof(struct corosync_frame) + COROSYNC_FRAME_MAX_PAYLOAD];
+	size_t len;
+	unsigned int count;
+	/*! When the first event in the batch was queued */
+	struct timeval first;
+	unsigned long frames_sent;
+	unsigned long events_sent;
+	unsigned long pulls_answered;
+} batch;
+
+AST_MUTEX_DEFINE_STATIC(peers_lock);
+
+/*! \brief The servers we received frames from (Protected by peers_lock) */
+static AST_VECTOR(, struct corosync_peer) peers;
+
+AO2_STRING_FIELD_HASH_FN(corosync_state, key);
+AO2_STRING_FIELD_CMP_FN(corosync_state, key);
+
+static void corosync_state_dtor(void *obj)
+{
+	struct corosync_state *state = obj;
+
+	ast_event_destroy(state->event);
+}
+
+/*!
+ * \brief Build the key of the state an event changes
+ *
+ * \retval 0 on success
+ * \retval -1 if the event changes no state
+ */
+static int corosync_state_key(const struct ast_event *event, char *buf, size_t len)
+{
+	const char *id;
+
+	switch (ast_event_get_type(event)) {
+	case AST_EVENT_DEVICE_STATE_CHANGE:
+		id = ast_event_get_ie_str(event, AST_EVENT_IE_DEVICE);
+		if (ast_strlen_zero(id)) {
+			return -1;
+		}
+		snprintf(buf, len, "device_state/%s", id);
+		return 0;
+	case AST_EVENT_MWI:
+		id = ast_event_get_ie_str(event, AST_EVENT_IE_MAILBOX);
+		if (ast_strlen_zero(id)) {
+			return -1;
+		}
+		snprintf(buf, len, "mwi/%s@%s", id, S_OR(ast_event_get_ie_str(event, AST_EVENT_IE_CONTEXT), ""));
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/*!
+ * \brief Fill the header of a frame in and send it
+ *
+ * \note batch_lock must be held
+ */
+static void frame_send(struct corosync_frame *frame, enum corosync_frame_kind kind,
+	size_t payload_len)
+{
+	struct timeval now = ast_tvnow();
+	struct iovec iov;
+	cs_error_t cs_err;
+
+	frame->type = htons(COROSYNC_FRAME_TYPE);
+	frame->event_len = htons(offsetof(struct corosync_frame, version));
+	frame->eid_ie_type = htons(AST_EVENT_IE_EID);
+	frame->eid_ie_len = htons(sizeof(frame->eid));
+	frame->eid = ast_eid_default;
+	frame->version = COROSYNC_FRAME_VERSION;
+	frame->kind = kind;
+	frame->incarnation = htonl(batch.incarnation);
+	frame->sent_sec = htonl(now.tv_sec);
+	frame->sent_usec = htonl(now.tv_usec);
+
+	iov.iov_base = frame;
+	iov.iov_len = sizeof(*frame) + payload_len;
+
+	if ((cs_err = cpg_mcast_joined(cpg_handle, CPG_TYPE_FIFO, &iov, 1)) != CS_OK) {
+		ast_log(LOG_WARNING, "CPG mcast failed (%u) for a frame of %u events\n",
+			cs_err, (unsigned int) ntohs(frame->count));
+		return;
+	}
+	++batch.frames_sent;
+	batch.events_sent += ntohs(frame->count);
+}
+
+/*!
+ * \brief Send the events waiting in the batch
+ *
+ * \note batch_lock must be held
+ */
+static void batch_flush(void)
+{
+	struct corosync_frame *frame = (struct corosync_frame *) batch.frame;
+
+	if (!batch.count) {
+		return;
+	}
+
+	memset(frame, 0, sizeof(*frame));
+	frame->count = htons(batch.count);
+	frame->state_version = htonll(batch.version);
+	frame_send(frame, COROSYNC_FRAME_BATCH, batch.len);
+
+	batch.len = 0;
+	batch.count = 0;
+}
+
+/*!
+ * \brief Wake the dispatch thread up, to wait for a batch to be sent
+ */
+static void dispatch_thread_wake(void)
+{
+	char meepmeep = 'x';
+
+	if (dispatch_thread.alert_pipe[1] != -1
+		&& write(dispatch_thread.alert_pipe[1], &meepmeep, 1) == -1) {
+		ast_debug(1, "Failed to wake the corosync dispatch thread: %s\n", strerror(errno));
+	}
+}
+
+/*!
+ * \brief Store an event changing a state of this server, without sending it
+ *
+ * \param event The event, which is kept
+ *
+ * \retval 0 on success
+ * \retval -1 if the event is not replicated in batches
+ *
+ * \note batch_lock must be held
+ */
+static int state_store(struct ast_event *event)
+{
+	struct corosync_state *state;
+	char key[256];
+
+	if (corosync_state_key(event, key, sizeof(key))) {
+		return -1;
+	}
+
+	state = ao2_alloc_options(sizeof(*state) + strlen(key) + 1, corosync_state_dtor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!state) {
+		return -1;
+	}
+	strcpy(state->key, key); /* SAFE */
+	state->event = event;
+	state->version = ++batch.version;
+
+	ao2_find(batch.states, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	ao2_link(batch.states, state);
+	ao2_ref(state, -1);
+
+	return 0;
+}
+
+/*!
+ * \brief Queue an event changing a state of this server in the batch
+ *
+ * \param event The event, which is kept on success
+ *
+ * \retval 0 on success
+ * \retval -1 if the event is not replicated in batches
+ */
+static int batch_queue(struct ast_event *event)
+{
+	size_t size = ast_event_get_size(event);
+	int wake = 0;
+
+	ast_mutex_lock(&batch_lock);
+	if (replication.mode != COROSYNC_REPLICATION_BATCHED || !batch.states
+		|| size > COROSYNC_FRAME_MAX_PAYLOAD) {
+		ast_mutex_unlock(&batch_lock);
+		return -1;
+	}
+
+	if (batch.len + size > COROSYNC_FRAME_MAX_PAYLOAD) {
+		batch_flush();
+	}
+
+	if (state_store(event)) {
+		ast_mutex_unlock(&batch_lock);
+		return -1;
+	}
+
+	memcpy(batch.frame + sizeof(struct corosync_frame) + batch.len, event, size);
+	batch.len += size;
+	if (!batch.count++) {
+		batch.first = ast_tvnow();
+		wake = 1;
+	}
+
+	if (!replication.batch_interval) {
+		batch_flush();
+		wake = 0;
+	}
+	ast_mutex_unlock(&batch_lock);
+
+	if (wake) {
+		dispatch_thread_wake();
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Milliseconds until the batch is to be sent, -1 with no batch
+ */
+static int batch_timeout(void)
+{
+	int64_t timeout = -1;
+
+	ast_mutex_lock(&batch_lock);
+	if (batch.count) {
+		timeout = replication.batch_interval - ast_tvdiff_ms(ast_tvnow(), batch.first);
+		if (timeout < 0) {
+			timeout = 0;
+		}
+	}
+	ast_mutex_unlock(&batch_lock);
+
+	return timeout;
+}
+
+/*!
+ * \brief Send the batch if it waited long enough
+ */
+static void batch_check(void)
+{
+	ast_mutex_lock(&batch_lock);
+	if (batch.count && ast_tvdiff_ms(ast_tvnow(), batch.first) >= replication.batch_interval) {
+		batch_flush();
+	}
+	ast_mutex_unlock(&batch_lock);
+}
+
+/*!
+ * \brief Tell the cluster the state version of this server, when a node joins
+ */
+static void digest_send(void)
+{
+	struct corosync_frame frame;
+
+	ast_mutex_lock(&batch_lock);
+	batch_flush();
+	memset(&frame, 0, sizeof(frame));
+	frame.state_version = htonll(batch.version);
+	frame_send(&frame, COROSYNC_FRAME_DIGEST, 0);
+	ast_mutex_unlock(&batch_lock);
+}
+
+/*!
+ * \brief Ask a server for the events it published after a state version
+ */
+static void pull_send(const struct ast_eid *target, uint64_t from)
+{
+	struct corosync_frame frame;
+	char eid[32];
+
+	memset(&frame, 0, sizeof(frame));
+	frame.target = *target;
+	frame.from_version = htonll(from);
+
+	ast_mutex_lock(&batch_lock);
+	frame_send(&frame, COROSYNC_FRAME_PULL, 0);
+	ast_mutex_unlock(&batch_lock);
+
+	ast_eid_to_str(eid, sizeof(eid), (struct ast_eid *) target);
+	ast_debug(1, "Pulling the events of %s after version %" PRIu64 "\n", eid, from);
+}
+
+/*!
+ * \brief Send the events that changed states after a state version
+ *
+ * \note batch_lock must be held
+ */
+static void sync_send(uint64_t from)
+{
+	struct corosync_frame *frame = (struct corosync_frame *) batch.frame;
+	struct ao2_iterator iter;
+	struct corosync_state *state;
+	size_t len = 0;
+	unsigned int count = 0;
+
+	/* Versions up to the answer's are then all in it or already sent */
+	batch_flush();
+
+	memset(frame, 0, sizeof(*frame));
+	frame->from_version = htonll(from);
+	frame->state_version = htonll(batch.version);
+
+	iter = ao2_iterator_init(batch.states, 0);
+	for (; (state = ao2_iterator_next(&iter)); ao2_ref(state, -1)) {
+		size_t size = ast_event_get_size(state->event);
+
+		if (state->version <= from) {
+			continue;
+		}
+		if (len + size > COROSYNC_FRAME_MAX_PAYLOAD) {
+			frame->count = htons(count);
+			frame_send(frame, COROSYNC_FRAME_SYNC, len);
+			len = 0;
+			count = 0;
+		}
+		memcpy(frame->payload + len, state->event, size);
+		len += size;
+		++count;
+	}
+	ao2_iterator_destroy(&iter);
+
+	frame->count = htons(count);
+	frame->flags = COROSYNC_FRAME_FLAG_LAST;
+	frame_send(frame, COROSYNC_FRAME_SYNC, len);
+	++batch.pulls_answered;
+}
+
+/*!
+ * \brief Find the replicated state of a server, adding it if new
+ *
+ * \note peers_lock must be held
+ */
+static struct corosync_peer *peer_get(const struct ast_eid *eid)
+{
+	struct corosync_peer peer = { .eid = *eid, };
+	size_t i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&peers); ++i) {
+		if (!ast_eid_cmp(&AST_VECTOR_GET_ADDR(&peers, i)->eid, eid)) {
+			return AST_VECTOR_GET_ADDR(&peers, i);
+		}
+	}
+
+	if (AST_VECTOR_APPEND(&peers, peer)) {
+		return NULL;
+	}
+	return AST_VECTOR_GET_ADDR(&peers, AST_VECTOR_SIZE(&peers) - 1);
+}
+
+/*!
+ * \brief Publish an event of another server to stasis, if subscribed to
+ */
+static void deliver_event(const struct ast_event *msg, size_t msg_len)
+{
+	struct ast_event *event;
+	void (*publish_handler)(struct ast_event *) = NULL;
+	enum ast_event_type event_type;
+
+	event_type = ast_event_get_type(msg);
+	if (event_type > AST_EVENT_TOTAL) {
+		/* Egads, we don't support this */
+		return;
+	}
+
+	ast_rwlock_rdlock(&event_types_lock);
+	publish_handler = event_types[event_type].publish_to_stasis;
+	if (!event_types[event_type].subscribe || !publish_handler) {
+		/* We are not configured to subscribe to these events or
+		   we have no way to publish it internally. */
+		ast_rwlock_unlock(&event_types_lock);
+		return;
+	}
+	ast_rwlock_unlock(&event_types_lock);
+
+	if (!(event = ast_malloc(msg_len))) {
+		return;
+	}
+
+	memcpy(event, msg, msg_len);
+
+	if (event_type == AST_EVENT_PING) {
+		const struct ast_eid *eid;
+		char buf[128] = "";
+
+		eid = ast_event_get_ie_raw(event, AST_EVENT_IE_EID);
+		ast_eid_to_str(buf, sizeof(buf), (struct ast_eid *) eid);
+		ast_log(LOG_NOTICE, "Got event PING from server with EID: '%s'\n", buf);
+	}
+	ast_debug(5, "Publishing event %s (%u) to stasis\n",
+		ast_event_get_type_name(event), event_type);
+	publish_handler(event);
+}
+
+/*!
+ * \brief Apply the events in a frame, to the length the frame claims
+ */
+static void frame_deliver(const struct corosync_frame *frame, size_t payload_len)
+{
+	const unsigned char *pos = frame->payload;
+	unsigned int count = ntohs(frame->count);
+
+	while (count-- && payload_len >= ast_event_minimum_length()) {
+		size_t size = ast_event_get_size((const struct ast_event *) pos);
+
+		if (size < ast_event_minimum_length() || size > payload_len) {
+			ast_debug(1, "Ignoring the rest of a frame with an event of %u bytes\n",
+				(unsigned int) size);
+			return;
+		}
+		deliver_event((const struct ast_event *) pos, size);
+		pos += size;
+		payload_len -= size;
+	}
+}
+
+/*!
+ * \brief Handle a frame replicating the state of another server
+ */
+static void frame_receive(const void *msg, size_t msg_len)
+{
+	const struct corosync_frame *frame = msg;
+	struct corosync_peer *peer;
+	struct timeval sent;
+	uint32_t incarnation;
+	uint64_t state_version;
+	uint64_t from_version;
+	unsigned int count;
+	int64_t lag;
+	int pull = 0;
+	uint64_t pull_from = 0;
+
+	if (msg_len < sizeof(*frame) || frame->version != COROSYNC_FRAME_VERSION) {
+		ast_debug(1, "Ignoring frame of %u bytes and version %u\n",
+			(unsigned int) msg_len, (unsigned int) frame->version);
+		return;
+	}
+
+	if (frame->kind == COROSYNC_FRAME_PULL) {
+		if (!ast_eid_cmp(&ast_eid_default, &frame->target)) {
+			ast_mutex_lock(&batch_lock);
+			if (batch.states) {
+				sync_send(ntohll(frame->from_version));
+			}
+			ast_mutex_unlock(&batch_lock);
+		}
+		return;
+	}
+
+	incarnation = ntohl(frame->incarnation);
+	state_version = ntohll(frame->state_version);
+	from_version = ntohll(frame->from_version);
+	count = ntohs(frame->count);
+	sent = ast_tv(ntohl(frame->sent_sec), ntohl(frame->sent_usec));
+	lag = ast_tvdiff_ms(ast_tvnow(), sent);
+
+	ast_mutex_lock(&peers_lock);
+	peer = peer_get(&frame->eid);
+	if (!peer) {
+		ast_mutex_unlock(&peers_lock);
+		return;
+	}
+
+	++peer->frames;
+	peer->events += count;
+	peer->last_lag = lag;
+	if (lag > peer->max_lag) {
+		peer->max_lag = lag;
+	}
+
+	if (peer->incarnation != incarnation) {
+		/* The server started again, and everything it had is to be pulled anew */
+		peer->incarnation = incarnation;
+		peer->version = 0;
+		peer->pulling = 0;
+	}
+
+	switch (frame->kind) {
+	case COROSYNC_FRAME_BATCH:
+		if (peer->pulling) {
+			/* Versions up to where the answer stops are in it */
+			break;
+		}
+		if (state_version - count != peer->version) {
+			/* Some changes of the server were missed */
+			pull = 1;
+			pull_from = peer->version;
+			break;
+		}
+		peer->version = state_version;
+		break;
+	case COROSYNC_FRAME_DIGEST:
+		if (state_version != peer->version) {
+			pull = 1;
+			pull_from = state_version < peer->version ? 0 : peer->version;
+		}
+		break;
+	case COROSYNC_FRAME_SYNC:
+		if (!peer->pulling || from_version > peer->version) {
+			/* Answering another server, whose changes we had already */
+			count = 0;
+			break;
+		}
+		if (frame->flags & COROSYNC_FRAME_FLAG_LAST) {
+			peer->version = state_version;
+			peer->pulling = 0;
+		}
+		break;
+	default:
+		count = 0;
+		break;
+	}
+
+	if (pull) {
+		peer->pulling = 1;
+	}
+	ast_mutex_unlock(&peers_lock);
+
+	if (count) {
+		frame_deliver(frame, msg_len - sizeof(*frame));
+	}
+
+	if (pull) {
+		pull_send(&frame->eid, pull_from);
+	}
+}
+
 /*! \brief Publish cluster discovery to \ref stasis */
 static void publish_cluster_discovery_to_stasis_full(struct corosync_node *node, int joined)
 {
@@ -472,10 +1107,6 @@ static void cfg_shutdown_cb(corosync_cfg_handle_t cfg_handle,
 static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_name,
 		uint32_t nodeid, uint32_t pid, void *msg, size_t msg_len)
 {
-	struct ast_event *event;
-	void (*publish_handler)(struct ast_event *) = NULL;
-	enum ast_event_type event_type;
-
 	if (msg_len < ast_event_minimum_length()) {
 		ast_debug(1, "Ignoring event that's too small. %u < %u\n",
 			(unsigned int) msg_len,
@@ -488,39 +1119,12 @@ static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_nam
 		return;
 	}
 
-	event_type = ast_event_get_type(msg);
-	if (event_type > AST_EVENT_TOTAL) {
-		/* Egads, we don't support this */
-		return;
-	}
-
-	ast_rwlock_rdlock(&event_types_lock);
-	publish_handler = event_types[event_type].publish_to_stasis;
-	if (!event_types[event_type].subscribe || !publish_handler) {
-		/* We are not configured to subscribe to these events or
-		   we have no way to publish it internally. */
-		ast_rwlock_unlock(&event_types_lock);
-		return;
-	}
-	ast_rwlock_unlock(&event_types_lock);
-
-	if (!(event = ast_malloc(msg_len))) {
+	if (ast_event_get_type(msg) == COROSYNC_FRAME_TYPE) {
+		frame_receive(msg, msg_len);
 		return;
 	}
 
-	memcpy(event, msg, msg_len);
-
-	if (event_type == AST_EVENT_PING) {
-		const struct ast_eid *eid;
-		char buf[128] = "";
-
-		eid = ast_event_get_ie_raw(event, AST_EVENT_IE_EID);
-		ast_eid_to_str(buf, sizeof(buf), (struct ast_eid *) eid);
-		ast_log(LOG_NOTICE, "Got event PING from server with EID: '%s'\n", buf);
-	}
-	ast_debug(5, "Publishing event %s (%u) to stasis\n",
-		ast_event_get_type_name(event), event_type);
-	publish_handler(event);
+	deliver_event(msg, msg_len);
 }
 
 static void publish_event_to_corosync(struct ast_event *event)
@@ -566,6 +1170,10 @@ static void publish_to_corosync(struct stasis_message *message)
 		ast_log(LOG_NOTICE, "Sending event PING from this server with EID: '%s'\n", buf);
 	}
 
+	if (!batch_queue(event)) {
+		return;
+	}
+
 	publish_event_to_corosync(event);
 }
 
@@ -618,6 +1226,15 @@ static void cpg_confchg_cb(cpg_handle_t handle, const struct cpg_name *group_nam
 		return;
 	}
 
+	ast_mutex_lock(&batch_lock);
+	if (replication.mode == COROSYNC_REPLICATION_BATCHED) {
+		ast_mutex_unlock(&batch_lock);
+		/* They pull what they miss, rather than being sent everything */
+		digest_send();
+		return;
+	}
+	ast_mutex_unlock(&batch_lock);
+
 	for (i = 0; i < ARRAY_LEN(event_types); i++) {
 		struct ao2_container *messages;
 
@@ -713,12 +1330,23 @@ static void *dispatch_thread_handler(void *data)
 		pfd[1].revents = 0;
 		pfd[2].revents = 0;
 
-		res = ast_poll(pfd, ARRAY_LEN(pfd), -1);
+		res = ast_poll(pfd, ARRAY_LEN(pfd), batch_timeout());
 		if (res == -1 && errno != EINTR && errno != EAGAIN) {
 			ast_log(LOG_ERROR, "poll() error: %s (%d)\n", strerror(errno), errno);
 			continue;
 		}
 
+		if (pfd[2].revents & POLLIN) {
+			char buf[64];
+
+			/* Woken up to wait for a batch, or to stop */
+			if (read(dispatch_thread.alert_pipe[0], buf, sizeof(buf)) == -1) {
+				ast_debug(1, "Failed to read the alert pipe: %s\n", strerror(errno));
+			}
+		}
+
+		batch_check();
+
 		if (pfd[0].revents & POLLIN) {
 			if ((cs_err = cpg_dispatch(cpg_handle, CS_DISPATCH_ALL)) != CS_OK) {
 				ast_log(LOG_WARNING, "Failed CPG dispatch: %u\n", cs_err);
@@ -944,10 +1572,74 @@ static char *corosync_show_config(struct ast_cli_entry *e, int cmd, struct ast_c
 	return CLI_SUCCESS;
 }
 
+static char *corosync_show_replication(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	char eid[32];
+	unsigned int mode;
+	unsigned int interval;
+	uint64_t version;
+	unsigned long frames_sent;
+	unsigned long events_sent;
+	unsigned long pulls_answered;
+	size_t i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "corosync show replication";
+		e->usage =
+			"Usage: corosync show replication\n"
+			"       Show the state versions replicated from and to the cluster,\n"
+			"       and how long the frames replicating them took to arrive\n";
+		return NULL;
+
+	case CLI_GENERATE:
+		return NULL;	/* no completion */
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&batch_lock);
+	mode = replication.mode;
+	interval = replication.batch_interval;
+	version = batch.version;
+	frames_sent = batch.frames_sent;
+	events_sent = batch.events_sent;
+	pulls_answered = batch.pulls_answered;
+	ast_mutex_unlock(&batch_lock);
+
+	ast_eid_to_str(eid, sizeof(eid), &ast_eid_default);
+	ast_cli(a->fd, "Replication: %s\n", mode == COROSYNC_REPLICATION_BATCHED ? "batched" : "legacy");
+	ast_cli(a->fd, "Batch interval: %u ms\n", interval);
+	ast_cli(a->fd, "Local state (%s): version %" PRIu64 ", %lu frames and %lu events sent, %lu pulls answered\n\n",
+		eid, version, frames_sent, events_sent, pulls_answered);
+
+#define FORMAT "%-18s %10s %18s %8s %10s %10s %10s %10s\n"
+#define FORMAT2 "%-18s %10u %18" PRIu64 " %8s %10lu %10lu %10" PRId64 " %10" PRId64 "\n"
+	ast_cli(a->fd, FORMAT, "Server", "Start", "Version", "Pulling", "Frames", "Events", "Lag (ms)", "Max (ms)");
+
+	ast_mutex_lock(&peers_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&peers); ++i) {
+		struct corosync_peer *peer = AST_VECTOR_GET_ADDR(&peers, i);
+
+		ast_eid_to_str(eid, sizeof(eid), &peer->eid);
+		ast_cli(a->fd, FORMAT2, eid, peer->incarnation, peer->version,
+			peer->pulling ? "yes" : "no", peer->frames, peer->events,
+			peer->last_lag, peer->max_lag);
+	}
+	ast_mutex_unlock(&peers_lock);
+#undef FORMAT
+#undef FORMAT2
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry corosync_cli[] = {
 	AST_CLI_DEFINE(corosync_show_config, "Show configuration"),
 	AST_CLI_DEFINE(corosync_show_members, "Show cluster members"),
 	AST_CLI_DEFINE(corosync_ping, "Send a test ping to the cluster"),
+	AST_CLI_DEFINE(corosync_show_replication, "Show state replication"),
 };
 
 enum {
@@ -992,15 +1684,34 @@ static int load_general_config(struct ast_config *cfg)
 		event_types[i].subscribe = event_types[i].subscribe_default;
 	}
 
+	ast_mutex_lock(&batch_lock);
+	replication.mode = COROSYNC_REPLICATION_LEGACY;
+	replication.batch_interval = DEFAULT_BATCH_INTERVAL;
+
 	for (v = ast_variable_browse(cfg, "general"); v && !res; v = v->next) {
 		if (!strcasecmp(v->name, "publish_event")) {
 			res = set_event(v->value, PUBLISH);
 		} else if (!strcasecmp(v->name, "subscribe_event")) {
 			res = set_event(v->value, SUBSCRIBE);
+		} else if (!strcasecmp(v->name, "replication")) {
+			if (!strcasecmp(v->value, "legacy")) {
+				replication.mode = COROSYNC_REPLICATION_LEGACY;
+			} else if (!strcasecmp(v->value, "batched")) {
+				replication.mode = COROSYNC_REPLICATION_BATCHED;
+			} else {
+				ast_log(LOG_WARNING, "Invalid replication '%s', using legacy\n", v->value);
+			}
+		} else if (!strcasecmp(v->name, "batch_interval")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE | PARSE_DEFAULT,
+				&replication.batch_interval, DEFAULT_BATCH_INTERVAL, 0, 1000)) {
+				ast_log(LOG_WARNING, "Invalid batch_interval '%s', using %d\n",
+					v->value, DEFAULT_BATCH_INTERVAL);
+			}
 		} else {
 			ast_log(LOG_WARNING, "Unknown option '%s'\n", v->name);
 		}
 	}
+	ast_mutex_unlock(&batch_lock);
 
 	for (i = 0; i < ARRAY_LEN(event_types); i++) {
 		if (event_types[i].publish && !event_types[i].sub) {
@@ -1049,6 +1760,78 @@ static int load_config(unsigned int reload)
 	return res;
 }
 
+static int seed_cache_cb(void *obj, void *arg, int flags)
+{
+	struct stasis_message *message = obj;
+	struct ast_event *event;
+
+	event = stasis_message_to_event(message);
+	if (event && state_store(event)) {
+		ast_event_destroy(event);
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Start keeping the state of this server for batched replication
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int batch_start(void)
+{
+	struct ao2_container *dumps[ARRAY_LEN(event_types)] = { NULL, };
+	unsigned int i;
+
+	/* What this server published before the module was loaded */
+	ast_rwlock_rdlock(&event_types_lock);
+	for (i = 0; i < ARRAY_LEN(event_types); i++) {
+		if (event_types[i].publish && event_types[i].cache_fn
+			&& event_types[i].message_type_fn) {
+			dumps[i] = stasis_cache_dump_by_eid(event_types[i].cache_fn(),
+				event_types[i].message_type_fn(), &ast_eid_default);
+		}
+	}
+	ast_rwlock_unlock(&event_types_lock);
+
+	ast_mutex_lock(&batch_lock);
+	if (replication.mode == COROSYNC_REPLICATION_BATCHED) {
+		batch.states = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, 1021,
+			corosync_state_hash_fn, NULL, corosync_state_cmp_fn);
+		batch.version = 0;
+		batch.incarnation = ast_random();
+		batch.len = 0;
+		batch.count = 0;
+	}
+	for (i = 0; i < ARRAY_LEN(dumps); i++) {
+		if (dumps[i]) {
+			if (batch.states) {
+				ao2_callback(dumps[i], OBJ_NODATA, seed_cache_cb, NULL);
+			}
+			ao2_ref(dumps[i], -1);
+		}
+	}
+	ast_mutex_unlock(&batch_lock);
+
+	return replication.mode == COROSYNC_REPLICATION_BATCHED && !batch.states ? -1 : 0;
+}
+
+static void batch_stop(void)
+{
+	ast_mutex_lock(&batch_lock);
+	ao2_cleanup(batch.states);
+	batch.states = NULL;
+	batch.len = 0;
+	batch.count = 0;
+	ast_mutex_unlock(&batch_lock);
+
+	ast_mutex_lock(&peers_lock);
+	AST_VECTOR_FREE(&peers);
+	AST_VECTOR_INIT(&peers, 0);
+	ast_mutex_unlock(&peers_lock);
+}
+
 static void cleanup_module(void)
 {
 	cs_error_t cs_err;
@@ -1111,6 +1894,8 @@ static void cleanup_module(void)
 	}
 	cfg_handle = 0;
 
+	batch_stop();
+
 	ao2_cleanup(nodes);
 	nodes = NULL;
 }
@@ -1153,6 +1938,11 @@ static int load_module(void)
 		goto failed;
 	}
 
+	if (batch_start()) {
+		ast_log(LOG_ERROR, "Failed to start batched replication\n");
+		goto failed;
+	}
+
 	if ((cs_err = corosync_cfg_initialize(&cfg_handle, &cfg_callbacks)) != CS_OK) {
 		ast_log(LOG_ERROR, "Failed to initialize cfg: (%d)\n", (int) cs_err);
 		goto failed;
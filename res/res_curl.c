@@ -45,9 +45,199 @@
 #include <curl/curl.h>
 
 #include "asterisk/module.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/lock.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_curl.h"
+
+/*! \brief The caches shared by the handles of every user of res_curl */
+static CURLSH *share;
+
+/*! \brief A lock for each kind of data in the shared caches */
+static ast_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+/*! \brief The transfers being made to a host */
+struct curl_host {
+	AST_LIST_ENTRY(curl_host) list;
+	/*! Transfers counted by ast_curl_host_acquire */
+	unsigned int transfers;
+	char name[0];
+};
+
+/*! \brief Hosts with at least one transfer counted */
+static AST_LIST_HEAD_NOLOCK_STATIC(hosts, curl_host);
+
+AST_MUTEX_DEFINE_STATIC(hosts_lock);
+
+/*! \brief Signalled whenever a transfer stops being counted */
+static ast_cond_t hosts_cond;
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+	ast_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+	ast_mutex_unlock(&share_locks[data]);
+}
+
+int ast_curl_share(CURL *curl)
+{
+	if (!share) {
+		return -1;
+	}
+
+	return curl_easy_setopt(curl, CURLOPT_SHARE, share) == CURLE_OK ? 0 : -1;
+}
+
+/*! \brief Copy the host, and port if any, of a URL */
+static int url_host(const char *url, char *host, size_t size)
+{
+	const char *start = strstr(url, "://");
+	const char *at;
+	size_t len;
+
+	start = start ? start + 3 : url;
+	len = strcspn(start, "/?#");
+
+	/* The credentials are not part of the host */
+	at = memchr(start, '@', len);
+	if (at) {
+		len -= at + 1 - start;
+		start = at + 1;
+	}
+
+	if (!len || len >= size) {
+		return -1;
+	}
+	memcpy(host, start, len);
+	host[len] = '\0';
+
+	return 0;
+}
+
+/*! \note Must be called with hosts_lock held */
+static struct curl_host *host_find(const char *name)
+{
+	struct curl_host *host;
+
+	AST_LIST_TRAVERSE(&hosts, host, list) {
+		if (!strcasecmp(host->name, name)) {
+			break;
+		}
+	}
+
+	return host;
+}
+
+int ast_curl_host_acquire(const char *url, unsigned int limit, int timeout_ms)
+{
+	char name[256];
+	struct curl_host *host;
+	struct timeval deadline = ast_tvadd(ast_tvnow(), ast_samp2tv(timeout_ms, 1000));
+	struct timespec end = {
+		.tv_sec = deadline.tv_sec,
+		.tv_nsec = deadline.tv_usec * 1000,
+	};
+
+	if (url_host(url, name, sizeof(name))) {
+		return -1;
+	}
+
+	ast_mutex_lock(&hosts_lock);
+	while ((host = host_find(name)) && host->transfers >= limit) {
+		if (ast_cond_timedwait(&hosts_cond, &hosts_lock, &end) == ETIMEDOUT) {
+			ast_mutex_unlock(&hosts_lock);
+			return -1;
+		}
+	}
+
+	if (!host) {
+		host = ast_calloc(1, sizeof(*host) + strlen(name) + 1);
+		if (!host) {
+			ast_mutex_unlock(&hosts_lock);
+			return -1;
+		}
+		strcpy(host->name, name); /* Safe */
+		AST_LIST_INSERT_HEAD(&hosts, host, list);
+	}
+	++host->transfers;
+	ast_mutex_unlock(&hosts_lock);
+
+	return 0;
+}
+
+void ast_curl_host_release(const char *url)
+{
+	char name[256];
+	struct curl_host *host;
+
+	if (url_host(url, name, sizeof(name))) {
+		return;
+	}
+
+	ast_mutex_lock(&hosts_lock);
+	host = host_find(name);
+	if (host && !--host->transfers) {
+		AST_LIST_REMOVE(&hosts, host, list);
+		ast_free(host);
+	}
+	ast_cond_broadcast(&hosts_cond);
+	ast_mutex_unlock(&hosts_lock);
+}
+
+static void share_cleanup(void)
+{
+	int i;
+
+	if (!share) {
+		return;
+	}
+
+	if (curl_share_cleanup(share) != CURLSHE_OK) {
+		/* Handles that still use the caches would otherwise be left without locks */
+		ast_log(LOG_WARNING, "cURL handles still share the caches of res_curl, they are not freed\n");
+		share = NULL;
+		return;
+	}
+	share = NULL;
+
+	for (i = 0; i < ARRAY_LEN(share_locks); ++i) {
+		ast_mutex_destroy(&share_locks[i]);
+	}
+}
+
+static void share_init(void)
+{
+	int i;
+
+	share = curl_share_init();
+	if (!share) {
+		ast_log(LOG_WARNING, "Unable to share the cURL caches, each handle keeps its own\n");
+		return;
+	}
+
+	for (i = 0; i < ARRAY_LEN(share_locks); ++i) {
+		ast_mutex_init(&share_locks[i]);
+	}
+
+	curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+	curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	/* Connections can only be shared since cURL 7.57.0 */
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
 
 static int unload_module(void)
 {
+	share_cleanup();
+	ast_cond_destroy(&hosts_cond);
+
 	curl_global_cleanup();
 
 	return 0;
@@ -62,10 +252,13 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	ast_cond_init(&hosts_cond, NULL);
+	share_init();
+
 	return res;
 }
 
-AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_LOAD_ORDER, "cURL Resource Module",
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_GLOBAL_SYMBOLS | AST_MODFLAG_LOAD_ORDER, "cURL Resource Module",
 	.support_level = AST_MODULE_SUPPORT_CORE,
 	.load = load_module,
 	.unload = unload_module,
@@ -62,6 +62,8 @@
 #include "asterisk/res_fax.h"
 #include "asterisk/channel.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/alaw.h"
+#include "asterisk/ulaw.h"
 
 #define SPANDSP_EXPOSE_INTERNAL_STRUCTURES
 #include <spandsp.h>
@@ -673,8 +675,12 @@ static void spandsp_v21_tone(void *data, int code, int level, int delay)
 static int spandsp_v21_detect(struct ast_fax_session *s, const struct ast_frame *f)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
-	int16_t *slndata;
-	g711_state_t *decoder;
+	int16_t slndata[320];
+	const unsigned char *g711data;
+	int alaw;
+	int done;
+	int len;
+	int x;
 
 	if (p->v21_detected) {
 		return 0;
@@ -694,18 +700,18 @@ static int spandsp_v21_detect(struct ast_fax_session *s, const struct ast_frame
 	/* alaw/ulaw frame must be converted to slinear before passing to spandsp */
 	} else if (ast_format_cmp(f->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL ||
 	           ast_format_cmp(f->subclass.format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL) {
-		if (!(slndata = ast_malloc(sizeof(*slndata) * f->samples))) {
-			return -1;
-		}
-		decoder = g711_init(NULL, (ast_format_cmp(f->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL ? G711_ALAW : G711_ULAW));
-		g711_decode(decoder, slndata, f->data.ptr, f->samples);
+		/* Decoded with the tables of the core into a buffer on the stack,
+		 * as this is done for every frame until the preamble is detected */
+		alaw = ast_format_cmp(f->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL;
+		g711data = f->data.ptr;
 		ast_debug(5, "spandsp transcoding frame from %s to slinear for v21 detection\n", ast_format_get_name(f->subclass.format));
-		modem_connect_tones_rx(p->tone_state, slndata, f->samples);
-		g711_release(decoder);
-#if SPANDSP_RELEASE_DATE >= 20090220
-		g711_free(decoder);
-#endif
-		ast_free(slndata);
+		for (done = 0; done < f->samples; done += len) {
+			len = MIN(f->samples - done, ARRAY_LEN(slndata));
+			for (x = 0; x < len; x++) {
+				slndata[x] = alaw ? AST_ALAW(g711data[done + x]) : AST_MULAW(g711data[done + x]);
+			}
+			modem_connect_tones_rx(p->tone_state, slndata, len);
+		}
 
 	/* frame in other formats cannot be passed to spandsp, it could cause segfault */
 	} else {
@@ -78,6 +78,23 @@
 				<configOption name="capture_id" default="0">
 					<synopsis>The ID for this capture agent.</synopsis>
 				</configOption>
+				<configOption name="queue_size" default="1000">
+					<synopsis>The most packets waiting to be sent to Homer.</synopsis>
+					<description>
+						<para>Packets captured while this many are waiting to be
+						sent are dropped and counted, rather than delaying the
+						threads that captured them. The counts are shown by
+						<literal>hep show status</literal>.</para>
+					</description>
+				</configOption>
+				<configOption name="sample_rate" default="100">
+					<synopsis>The percentage of calls to capture packets of.</synopsis>
+					<description>
+						<para>Whether the packets of a call are captured is decided
+						by a hash of their UUID, so that every packet of a captured
+						call is sent. Must be between 0 and 100.</para>
+					</description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -89,6 +106,8 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/config_options.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/cli.h"
+#include "asterisk/vector.h"
 #include "asterisk/res_hep.h"
 
 #include <netinet/ip.h>
@@ -236,6 +255,8 @@ struct hep_generic {
 struct hepv3_global_config {
 	unsigned int enabled;                    /*!< Whether or not sending is enabled */
 	unsigned int capture_id;                 /*!< Capture ID for this agent */
+	unsigned int queue_size;                 /*!< Most packets waiting to be sent */
+	unsigned int sample_rate;                /*!< Percentage of calls captured */
 	enum hep_uuid_type uuid_type;            /*!< The preferred type of the UUID */
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(capture_address);   /*!< Address to send to */
@@ -277,6 +298,31 @@ static AO2_GLOBAL_OBJ_STATIC(global_data);
 
 static struct ast_taskprocessor *hep_queue_tp;
 
+AST_VECTOR(hep_captures, struct hepv3_capture_info *);
+
+/*! \brief Protects \ref pending_captures and \ref send_pushed */
+AST_MUTEX_DEFINE_STATIC(pending_lock);
+
+/*! \brief Packets waiting to be sent, at most queue_size */
+static struct hep_captures pending_captures;
+
+/*! \brief Packets being sent, swapped with \ref pending_captures by \ref hep_queue_tp */
+static struct hep_captures sending_captures;
+
+/*! \brief Whether a task sending \ref pending_captures is queued */
+static int send_pushed;
+
+/*! \brief Buffer the packets are built in, only used by \ref hep_queue_tp */
+static void *send_buffer;
+static size_t send_buffer_size;
+
+/*! \brief Packets sent successfully */
+static unsigned int packets_sent;
+/*! \brief Packets dropped because queue_size were waiting */
+static unsigned int packets_dropped;
+/*! \brief Packets not captured because of sample_rate */
+static unsigned int packets_unsampled;
+
 static void *module_config_alloc(void);
 static int hepv3_config_pre_apply(void);
 static void hepv3_config_post_apply(void);
@@ -448,12 +494,10 @@ struct hepv3_capture_info *hepv3_create_capture_info(const void *payload, size_t
 	return info;
 }
 
-/*! \brief Callback function for the \ref hep_queue_tp taskprocessor */
-static int hep_queue_cb(void *data)
+/*! \brief Build and send a packet to the HEPv3 server */
+static int hep_send_capture(struct module_config *config, struct hepv3_runtime_data *hepv3_data,
+	struct hepv3_capture_info *capture_info)
 {
-	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
-	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
-	RAII_VAR(struct hepv3_capture_info *, capture_info, data, ao2_cleanup);
 	struct hep_generic hg_pkt;
 	unsigned int packet_len = 0, sock_buffer_len;
 	struct hep_chunk_ip4 ipv4_src, ipv4_dst;
@@ -462,8 +506,8 @@ static int hep_queue_cb(void *data)
 	void *sock_buffer;
 	int res;
 
-	if (!capture_info || !config || !hepv3_data) {
-		return 0;
+	if (!capture_info->uuid) {
+		return -1;
 	}
 
 	if (ast_sockaddr_is_ipv4(&capture_info->src_addr) != ast_sockaddr_is_ipv4(&capture_info->dst_addr)) {
@@ -519,11 +563,16 @@ static int hep_queue_cb(void *data)
 	packet_len += (sizeof(payload) + capture_info->len);
 	hg_pkt.header.length = htons(packet_len);
 
-	/* Build the buffer to send */
-	sock_buffer = ast_malloc(packet_len);
-	if (!sock_buffer) {
-		return -1;
+	/* Build the buffer to send, reused by every packet of the taskprocessor */
+	if (send_buffer_size < packet_len) {
+		sock_buffer = ast_realloc(send_buffer, packet_len);
+		if (!sock_buffer) {
+			return -1;
+		}
+		send_buffer = sock_buffer;
+		send_buffer_size = packet_len;
 	}
+	sock_buffer = send_buffer;
 
 	/* Copy in the header */
 	memcpy(sock_buffer, &hg_pkt, sizeof(hg_pkt));
@@ -572,30 +621,129 @@ static int hep_queue_cb(void *data)
 		ast_log(AST_LOG_WARNING, "Failed to send complete packet to HEPv3 server: %d of %u sent\n",
 			res, sock_buffer_len);
 		res = -1;
+	} else {
+		ast_atomic_fetchadd_int((int *) &packets_sent, 1);
 	}
 
-	ast_free(sock_buffer);
 	return res;
 }
 
+/*!
+ * \brief Callback function for the \ref hep_queue_tp taskprocessor
+ *
+ * Sends every packet captured since the last time, so that a burst of
+ * captures costs a single task.
+ */
+static int hep_queue_cb(void *data)
+{
+	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
+	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
+	struct hep_captures swap;
+	int i;
+
+	ast_mutex_lock(&pending_lock);
+	swap = pending_captures;
+	pending_captures = sending_captures;
+	sending_captures = swap;
+	send_pushed = 0;
+	ast_mutex_unlock(&pending_lock);
+
+	for (i = 0; i < AST_VECTOR_SIZE(&sending_captures); ++i) {
+		struct hepv3_capture_info *capture_info = AST_VECTOR_GET(&sending_captures, i);
+
+		if (config && hepv3_data) {
+			hep_send_capture(config, hepv3_data, capture_info);
+		}
+		ao2_ref(capture_info, -1);
+	}
+	AST_VECTOR_RESET(&sending_captures, AST_VECTOR_ELEM_CLEANUP_NOOP);
+
+	return 0;
+}
+
+/*! \brief Whether the call a packet belongs to is captured, by sample_rate */
+static int hep_is_sampled(const struct hepv3_capture_info *capture_info, unsigned int sample_rate)
+{
+	if (sample_rate >= 100) {
+		return 1;
+	}
+
+	return capture_info->uuid
+		&& (unsigned int) ast_str_hash(capture_info->uuid) % 100 < sample_rate;
+}
+
 int hepv3_send_packet(struct hepv3_capture_info *capture_info)
 {
 	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
-	int res;
+	int res = 0;
 
 	if (!config || !config->general->enabled) {
 		ao2_ref(capture_info, -1);
 		return 0;
 	}
 
-	res = ast_taskprocessor_push(hep_queue_tp, hep_queue_cb, capture_info);
-	if (res == -1) {
+	if (!hep_is_sampled(capture_info, config->general->sample_rate)) {
+		ast_atomic_fetchadd_int((int *) &packets_unsampled, 1);
 		ao2_ref(capture_info, -1);
+		return 0;
 	}
 
-	return res;
+	ast_mutex_lock(&pending_lock);
+	if (AST_VECTOR_SIZE(&pending_captures) >= config->general->queue_size
+		|| AST_VECTOR_APPEND(&pending_captures, capture_info)) {
+		ast_mutex_unlock(&pending_lock);
+		ast_atomic_fetchadd_int((int *) &packets_dropped, 1);
+		ao2_ref(capture_info, -1);
+		return -1;
+	}
+	if (!send_pushed) {
+		res = ast_taskprocessor_push(hep_queue_tp, hep_queue_cb, NULL);
+		/* If the push failed the packet waits for the next one */
+		send_pushed = !res;
+	}
+	ast_mutex_unlock(&pending_lock);
+
+	return 0;
 }
 
+static char *handle_hep_show_status(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
+	size_t waiting;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "hep show status";
+		e->usage =
+			"Usage: hep show status\n"
+			"       Show how many packets were sent to the HEPv3 server, and\n"
+			"       how many were dropped or not captured.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&pending_lock);
+	waiting = AST_VECTOR_SIZE(&pending_captures);
+	ast_mutex_unlock(&pending_lock);
+
+	ast_cli(a->fd, "Enabled:   %s\n", AST_CLI_YESNO(config && config->general->enabled));
+	ast_cli(a->fd, "Waiting:   %zu of %u\n", waiting, config ? config->general->queue_size : 0);
+	ast_cli(a->fd, "Sent:      %u\n", packets_sent);
+	ast_cli(a->fd, "Dropped:   %u\n", packets_dropped);
+	ast_cli(a->fd, "Unsampled: %u\n", packets_unsampled);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_hep[] = {
+	AST_CLI_DEFINE(handle_hep_show_status, "Show the status of HEPv3 packet capture"),
+};
+
 /*!
  * \brief Pre-apply callback for the config framework.
  *
@@ -654,8 +802,18 @@ static int reload_module(void)
  */
 static int unload_module(void)
 {
+	ast_cli_unregister_multiple(cli_hep, ARRAY_LEN(cli_hep));
 	hep_queue_tp = ast_taskprocessor_unreference(hep_queue_tp);
 
+	AST_VECTOR_RESET(&pending_captures, ao2_cleanup);
+	AST_VECTOR_FREE(&pending_captures);
+	AST_VECTOR_RESET(&sending_captures, ao2_cleanup);
+	AST_VECTOR_FREE(&sending_captures);
+	send_pushed = 0;
+	ast_free(send_buffer);
+	send_buffer = NULL;
+	send_buffer_size = 0;
+
 	ao2_global_obj_release(global_config);
 	ao2_global_obj_release(global_data);
 	aco_info_destroy(&cfg_info);
@@ -672,6 +830,10 @@ static int load_module(void)
 		goto error;
 	}
 
+	if (AST_VECTOR_INIT(&pending_captures, 64) || AST_VECTOR_INIT(&sending_captures, 64)) {
+		goto error;
+	}
+
 	hep_queue_tp = ast_taskprocessor_get("hep_queue_tp", TPS_REF_DEFAULT);
 	if (!hep_queue_tp) {
 		goto error;
@@ -682,14 +844,21 @@ static int load_module(void)
 	aco_option_register(&cfg_info, "capture_password", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct hepv3_global_config, capture_password));
 	aco_option_register(&cfg_info, "capture_id", ACO_EXACT, global_options, "0", OPT_UINT_T, 0, STRFLDSET(struct hepv3_global_config, capture_id));
 	aco_option_register_custom(&cfg_info, "uuid_type", ACO_EXACT, global_options, "call-id", uuid_type_handler, 0);
+	aco_option_register(&cfg_info, "queue_size", ACO_EXACT, global_options, "1000", OPT_UINT_T, 0, FLDSET(struct hepv3_global_config, queue_size));
+	aco_option_register(&cfg_info, "sample_rate", ACO_EXACT, global_options, "100", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct hepv3_global_config, sample_rate), 0, 100);
 
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		goto error;
 	}
 
+	ast_cli_register_multiple(cli_hep, ARRAY_LEN(cli_hep));
+
 	return AST_MODULE_LOAD_SUCCESS;
 
 error:
+	hep_queue_tp = ast_taskprocessor_unreference(hep_queue_tp);
+	AST_VECTOR_FREE(&pending_captures);
+	AST_VECTOR_FREE(&sending_captures);
 	aco_info_destroy(&cfg_info);
 	return AST_MODULE_LOAD_DECLINE;
 }
@@ -44,12 +44,17 @@
 
 #define MAX_HEADER_LENGTH 1023
 
+/*! Times an interrupted download is resumed from where it stopped */
+#define MAX_RESUME_ATTEMPTS 3
+
 /*! \brief Data passed to cURL callbacks */
 struct curl_bucket_file_data {
 	/*! The \c ast_bucket_file object that caused the operation */
 	struct ast_bucket_file *bucket_file;
 	/*! File to write data to */
 	FILE *out_file;
+	/*! Whether the server accepts byte range requests */
+	int accept_ranges;
 };
 
 /*!
@@ -81,6 +86,12 @@ static size_t curl_header_callback(char *buffer, size_t size, size_t nitems, voi
 	}
 	*value++ = '\0';
 
+	if (!strcasecmp(header, "Accept-Ranges")) {
+		value = ast_trim_blanks(ast_skip_blanks(value));
+		cb_data->accept_ranges = !strcasecmp(value, "bytes");
+		return realsize;
+	}
+
 	if (strcasecmp(header, "ETag")
 		&& strcasecmp(header, "Cache-Control")
 		&& strcasecmp(header, "Last-Modified")
@@ -224,16 +235,22 @@ static CURL *get_curl_instance(struct curl_bucket_file_data *cb_data)
 /*!
  * \brief Execute the CURL
  */
-static long execute_curl_instance(CURL *curl)
+static long execute_curl_instance(CURL *curl, CURLcode *res)
 {
 	char curl_errbuf[CURL_ERROR_SIZE + 1];
 	long http_code;
+	CURLcode curl_res;
 
 	curl_errbuf[CURL_ERROR_SIZE] = '\0';
 	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curl_errbuf);
 
-	if (curl_easy_perform(curl)) {
+	curl_res = curl_easy_perform(curl);
+	if (res) {
+		*res = curl_res;
+	}
+	if (curl_res) {
 		ast_log(LOG_WARNING, "%s\n", curl_errbuf);
+		curl_easy_cleanup(curl);
 		return -1;
 	}
 
@@ -244,8 +261,27 @@ static long execute_curl_instance(CURL *curl)
 	return http_code;
 }
 
+/*!
+ * \internal \brief Whether a download that failed may be resumed with a range request
+ */
+static int curl_res_is_resumable(CURLcode res)
+{
+	switch (res) {
+	case CURLE_PARTIAL_FILE:
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_RECV_ERROR:
+	case CURLE_GOT_NOTHING:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 /*!
  * \internal \brief CURL the URI specified by the bucket_file and store it in the provided path
+ *
+ * If the transfer is interrupted after some of the body was received and the
+ * server accepts byte ranges, the rest is requested rather than the whole file.
  */
 static int bucket_file_run_curl(struct ast_bucket_file *bucket_file)
 {
@@ -253,6 +289,9 @@ static int bucket_file_run_curl(struct ast_bucket_file *bucket_file)
 		.bucket_file = bucket_file,
 	};
 	long http_code;
+	long offset = 0;
+	int attempts = 0;
+	CURLcode res;
 	CURL *curl;
 
 	cb_data.out_file = fopen(bucket_file->path, "wb");
@@ -262,16 +301,36 @@ static int bucket_file_run_curl(struct ast_bucket_file *bucket_file)
 		return -1;
 	}
 
-	curl = get_curl_instance(&cb_data);
-	if (!curl) {
-		fclose(cb_data.out_file);
-		return -1;
-	}
+	for (;;) {
+		curl = get_curl_instance(&cb_data);
+		if (!curl) {
+			fclose(cb_data.out_file);
+			return -1;
+		}
 
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_body_callback);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&cb_data);
+		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_body_callback);
+		curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&cb_data);
+		if (offset) {
+			curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) offset);
+		}
+
+		http_code = execute_curl_instance(curl, &res);
+		if (http_code != -1 || !cb_data.accept_ranges || !curl_res_is_resumable(res)
+			|| ++attempts > MAX_RESUME_ATTEMPTS) {
+			break;
+		}
 
-	http_code = execute_curl_instance(curl);
+		/* Only resume when the last attempt added to the file */
+		fflush(cb_data.out_file);
+		if (ftell(cb_data.out_file) <= offset) {
+			break;
+		}
+		offset = ftell(cb_data.out_file);
+		cb_data.accept_ranges = 0;
+
+		ast_debug(3, "Resuming the download of '%s' from byte %ld\n",
+			ast_sorcery_object_get_id(bucket_file), offset);
+	}
 
 	fclose(cb_data.out_file);
 
@@ -317,7 +376,7 @@ static int bucket_http_wizard_is_stale(const struct ast_sorcery *sorcery, void *
 	curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
 	ao2_ref(metadata, -1);
 
-	http_code = execute_curl_instance(curl);
+	http_code = execute_curl_instance(curl, NULL);
 
 	curl_slist_free_all(header_list);
 
@@ -24,11 +24,16 @@
  */
 
 /*** MODULEINFO
+	<use type="external">zlib</use>
 	<support_level>core</support_level>
  ***/
 
 #include "asterisk.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "asterisk/module.h"
 #include "asterisk/http.h"
 #include "asterisk/astobj2.h"
@@ -84,6 +89,20 @@
 #define MAX_WS_HDR_SZ 14
 #define MIN_WS_HDR_SZ 2
 
+/*! \brief Bytes of corked frames gathered before they are written anyway, about one TLS record */
+#define WEBSOCKET_CORK_SIZE 16384
+
+/*! \brief Largest write buffer kept for a session between writes */
+#define WEBSOCKET_OUT_KEEP_SIZE (4 * MAXIMUM_FRAME_SIZE)
+
+#ifdef HAVE_ZLIB
+/*! \brief Messages shorter than this are sent without permessage-deflate */
+#define WEBSOCKET_DEFLATE_MIN_SIZE 128
+
+/*! \brief Largest payload a compressed message may inflate to before the session is closed */
+#define WEBSOCKET_INFLATE_CEILING (8 * MAXIMUM_FRAME_SIZE)
+#endif
+
 /*! \brief Structure definition for session */
 struct ast_websocket {
 	struct ast_iostream *stream;        /*!< iostream of the connection */
@@ -91,7 +110,14 @@ struct ast_websocket {
 	struct ast_sockaddr local_address;  /*!< Our local address */
 	enum ast_websocket_opcode opcode;   /*!< Cached opcode for multi-frame messages */
 	size_t payload_len;                 /*!< Length of the payload */
+	size_t payload_size;                /*!< Allocated size of the payload, kept between reads */
 	char *payload;                      /*!< Pointer to the payload */
+	char *frame;                        /*!< Payload of control and compressed frames, kept between reads */
+	size_t frame_size;                  /*!< Allocated size of the frame payload */
+	char *out;                          /*!< Frames written but not yet sent */
+	size_t out_len;                     /*!< Length of the frames not yet sent */
+	size_t out_size;                    /*!< Allocated size of the unsent frames buffer */
+	unsigned int corked;                /*!< Nesting of ast_websocket_cork calls holding back writes */
 	size_t reconstruct;                 /*!< Number of bytes before a reconstructed payload will be returned and a new one started */
 	int timeout;                        /*!< The timeout for operations on the socket */
 	unsigned int secure:1;              /*!< Bit to indicate that the transport is secure */
@@ -100,6 +126,15 @@ struct ast_websocket {
 	struct websocket_client *client;    /*!< Client object when connected as a client websocket */
 	char session_id[AST_UUID_STR_LEN];  /*!< The identifier for the websocket session */
 	uint16_t close_status_code;         /*!< Status code sent in a CLOSE frame upon shutdown */
+#ifdef HAVE_ZLIB
+	z_stream deflate;                   /*!< Compressor of outgoing messages, kept across messages */
+	z_stream inflate;                   /*!< Decompressor of incoming messages, kept across messages */
+	char *deflated;                     /*!< Payload of the last compressed outgoing message */
+	size_t deflated_size;               /*!< Allocated size of the compressed outgoing payload */
+	unsigned int deflate_enabled:1;     /*!< Bit to indicate that permessage-deflate was negotiated */
+	unsigned int deflate_reset:1;       /*!< Bit to indicate the compressor starts over for each message */
+	unsigned int inflating:1;           /*!< Bit to indicate that the message being read is compressed */
+#endif
 };
 
 /*! \brief Hashing function for protocols */
@@ -185,6 +220,79 @@ static void session_destroy_fn(void *obj)
 
 	ao2_cleanup(session->client);
 	ast_free(session->payload);
+	ast_free(session->frame);
+	ast_free(session->out);
+#ifdef HAVE_ZLIB
+	if (session->deflate_enabled) {
+		deflateEnd(&session->deflate);
+		inflateEnd(&session->inflate);
+	}
+	ast_free(session->deflated);
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Make room for at least the given number of bytes in a session buffer
+ *
+ * Buffers grow geometrically so a buffer reused across frames is seldom reallocated.
+ *
+ * \retval 0 on success
+ * \retval -1 on allocation failure, the buffer is left as it was
+ */
+static int websocket_buf_reserve(char **buf, size_t *size, size_t needed)
+{
+	size_t new_size;
+	char *new_buf;
+
+	if (needed <= *size) {
+		return 0;
+	}
+
+	new_size = MAX(needed, MAX(*size * 2, 256));
+	new_buf = ast_realloc(*buf, new_size);
+	if (!new_buf) {
+		return -1;
+	}
+	*buf = new_buf;
+	*size = new_size;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Send the frames gathered in the write buffer
+ *
+ * \note The session must be locked.
+ *
+ * \retval 0 on success
+ * \retval -1 if the frames could not be written
+ */
+static int websocket_flush(struct ast_websocket *session)
+{
+	size_t len = session->out_len;
+	int res = 0;
+
+	if (!len) {
+		return 0;
+	}
+	session->out_len = 0;
+
+	ast_iostream_set_timeout_sequence(session->stream, ast_tvnow(), session->timeout);
+	if (ast_iostream_write(session->stream, session->out, len) != len) {
+		res = -1;
+	}
+	ast_iostream_set_timeout_disable(session->stream);
+
+	/* Do not hold on to what an unusually large message needed */
+	if (session->out_size > WEBSOCKET_OUT_KEEP_SIZE) {
+		ast_free(session->out);
+		session->out = NULL;
+		session->out_size = 0;
+	}
+
+	return res;
 }
 
 struct ast_websocket_protocol *AST_OPTIONAL_API_NAME(ast_websocket_sub_protocol_alloc)(const char *name)
@@ -288,6 +396,8 @@ int AST_OPTIONAL_API_NAME(ast_websocket_close)(struct ast_websocket *session, ui
 {
 	enum ast_websocket_opcode opcode = AST_WEBSOCKET_OPCODE_CLOSE;
 	char frame[4] = { 0, }; /* The header is 2 bytes and the reason code takes up another 2 bytes */
+	char *data = frame;
+	size_t len = sizeof(frame);
 	int res;
 
 	if (session->close_sent) {
@@ -304,14 +414,24 @@ int AST_OPTIONAL_API_NAME(ast_websocket_close)(struct ast_websocket *session, ui
 	session->close_sent = 1;
 
 	ao2_lock(session);
+
+	/* Frames still held back by a cork go out ahead of the close */
+	if (session->out_len
+		&& !websocket_buf_reserve(&session->out, &session->out_size, session->out_len + sizeof(frame))) {
+		memcpy(session->out + session->out_len, frame, sizeof(frame));
+		data = session->out;
+		len = session->out_len + sizeof(frame);
+	}
+	session->out_len = 0;
+
 	ast_iostream_set_timeout_inactivity(session->stream, session->timeout);
-	res = ast_iostream_write(session->stream, frame, sizeof(frame));
+	res = ast_iostream_write(session->stream, data, len);
 	ast_iostream_set_timeout_disable(session->stream);
 
 	/* If an error occurred when trying to close this connection explicitly terminate it now.
 	 * Doing so will cause the thread polling on it to wake up and terminate.
 	 */
-	if (res != sizeof(frame)) {
+	if (res != len) {
 		ast_iostream_close(session->stream);
 		session->stream = NULL;
 		ast_verb(2, "WebSocket connection %s '%s' forcefully closed due to fatal write error\n",
@@ -319,7 +439,7 @@ int AST_OPTIONAL_API_NAME(ast_websocket_close)(struct ast_websocket *session, ui
 	}
 
 	ao2_unlock(session);
-	return res == sizeof(frame);
+	return res == len;
 }
 
 static const char *opcode_map[] = {
@@ -341,17 +461,211 @@ static const char *websocket_opcode2str(enum ast_websocket_opcode opcode)
 	}
 }
 
+#ifdef HAVE_ZLIB
+/*!
+ * \internal
+ * \brief Compress the payload of an outgoing message
+ *
+ * The compressed payload, without the trailing empty block, is left in
+ * session->deflated.
+ *
+ * \note The session must be locked.
+ *
+ * \return The length of the compressed payload
+ * \retval -1 on failure
+ */
+static int64_t websocket_deflate(struct ast_websocket *session, char *payload, uint64_t payload_size)
+{
+	z_stream *strm = &session->deflate;
+	size_t bound;
+
+	/* The sync flush adds at most an empty stored block to the bound */
+	bound = deflateBound(strm, payload_size) + 16;
+	if (websocket_buf_reserve(&session->deflated, &session->deflated_size, bound)) {
+		return -1;
+	}
+
+	strm->next_in = (Bytef *) payload;
+	strm->avail_in = payload_size;
+	strm->next_out = (Bytef *) session->deflated;
+	strm->avail_out = session->deflated_size;
+	if (deflate(strm, Z_SYNC_FLUSH) != Z_OK || strm->avail_in || !strm->avail_out) {
+		return -1;
+	}
+
+	if (session->deflate_reset) {
+		deflateReset(strm);
+	}
+
+	/* RFC 7692 7.2.1: the 0x00 0x00 0xff 0xff ending the sync flush is not sent */
+	return session->deflated_size - strm->avail_out - 4;
+}
+
+/*!
+ * \internal
+ * \brief Decompress a frame of an incoming message onto the session payload
+ *
+ * \retval 0 on success
+ * \retval -1 if the data is not valid deflate data
+ * \retval 1 if the message inflates past WEBSOCKET_INFLATE_CEILING
+ */
+static int websocket_inflate(struct ast_websocket *session, char *data, size_t len, int fin)
+{
+	static unsigned char tail[] = { 0x00, 0x00, 0xff, 0xff };
+	z_stream *strm = &session->inflate;
+	int pass;
+
+	/* The final frame of a message is followed by the empty block its sender left off */
+	for (pass = 0; pass < (fin ? 2 : 1); ++pass) {
+		strm->next_in = pass ? tail : (Bytef *) data;
+		strm->avail_in = pass ? sizeof(tail) : len;
+
+		for (;;) {
+			int res;
+
+			if (session->payload_len >= WEBSOCKET_INFLATE_CEILING) {
+				return 1;
+			}
+			if (websocket_buf_reserve(&session->payload, &session->payload_size,
+				session->payload_len + MAX(strm->avail_in * 2, 4096))) {
+				return -1;
+			}
+
+			strm->next_out = (Bytef *) session->payload + session->payload_len;
+			strm->avail_out = session->payload_size - session->payload_len;
+			res = inflate(strm, Z_SYNC_FLUSH);
+			session->payload_len = (char *) strm->next_out - session->payload;
+
+			if (res == Z_STREAM_END) {
+				/* A final deflate block, anything after it starts a new stream */
+				inflateReset(strm);
+			} else if (res == Z_BUF_ERROR) {
+				break;
+			} else if (res != Z_OK) {
+				return -1;
+			}
+
+			if (!strm->avail_in && strm->avail_out) {
+				break;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Negotiate permessage-deflate (RFC 7692) from the extensions offered by a client
+ *
+ * \param session The session being established
+ * \param extensions The Sec-WebSocket-Extensions header value of the request
+ * \param response Filled in with the Sec-WebSocket-Extensions header line of the response
+ * \param response_size The size of the response buffer
+ */
+static void websocket_deflate_negotiate(struct ast_websocket *session, const char *extensions,
+	char *response, size_t response_size)
+{
+	char *offers = ast_strdupa(extensions);
+	char *offer;
+
+	/* Take the first permessage-deflate offer whose parameters can be honored */
+	while ((offer = strsep(&offers, ","))) {
+		char *param;
+		int window_bits = 15;
+		int window_bits_requested = 0;
+		int no_context_takeover = 0;
+		int acceptable = 1;
+
+		if (strcasecmp(ast_strip(strsep(&offer, ";")), "permessage-deflate")) {
+			continue;
+		}
+
+		while (acceptable && (param = strsep(&offer, ";"))) {
+			char *value = param;
+
+			param = ast_strip(strsep(&value, "="));
+			if (value) {
+				value = ast_strip_quoted(ast_strip(value), "\"", "\"");
+			}
+
+			if (!strcasecmp(param, "server_no_context_takeover")) {
+				no_context_takeover = 1;
+			} else if (!strcasecmp(param, "server_max_window_bits")) {
+				/* zlib cannot produce raw deflate data with a window of 8 bits */
+				window_bits_requested = 1;
+				acceptable = value && sscanf(value, "%30d", &window_bits) == 1
+					&& window_bits >= 9 && window_bits <= 15;
+			} else if (!strcasecmp(param, "client_max_window_bits")
+				|| !strcasecmp(param, "client_no_context_takeover")) {
+				/* Whatever the client compresses with can be inflated with the largest window */
+			} else {
+				acceptable = 0;
+			}
+		}
+		if (!acceptable) {
+			continue;
+		}
+
+		if (deflateInit2(&session->deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -window_bits,
+			8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			return;
+		}
+		if (inflateInit2(&session->inflate, -15) != Z_OK) {
+			deflateEnd(&session->deflate);
+			return;
+		}
+		session->deflate_enabled = 1;
+		session->deflate_reset = no_context_takeover;
+
+		if (window_bits_requested) {
+			snprintf(response, response_size,
+				"Sec-WebSocket-Extensions: permessage-deflate%s; server_max_window_bits=%d\r\n",
+				no_context_takeover ? "; server_no_context_takeover" : "", window_bits);
+		} else {
+			snprintf(response, response_size,
+				"Sec-WebSocket-Extensions: permessage-deflate%s\r\n",
+				no_context_takeover ? "; server_no_context_takeover" : "");
+		}
+		return;
+	}
+}
+#endif
+
 /*! \brief Write function for websocket traffic */
 int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
 {
 	size_t header_size = 2; /* The minimum size of a websocket frame is 2 bytes */
 	char *frame;
+	char flags = 0x80; /* FIN, messages are never fragmented when written */
 	uint64_t length;
-	uint64_t frame_size;
 
 	ast_debug(3, "Writing websocket %s frame, length %" PRIu64 "\n",
 			websocket_opcode2str(opcode), payload_size);
 
+	ao2_lock(session);
+	if (session->closing) {
+		ao2_unlock(session);
+		return -1;
+	}
+
+#ifdef HAVE_ZLIB
+	if (session->deflate_enabled && payload_size >= WEBSOCKET_DEFLATE_MIN_SIZE
+		&& (opcode == AST_WEBSOCKET_OPCODE_TEXT || opcode == AST_WEBSOCKET_OPCODE_BINARY)) {
+		int64_t deflated_size = websocket_deflate(session, payload, payload_size);
+
+		if (deflated_size < 0) {
+			ao2_unlock(session);
+			ast_debug(1, "Closing WS with 1011 because a message could not be compressed\n");
+			ast_websocket_close(session, 1011);
+			return -1;
+		}
+		payload = session->deflated;
+		payload_size = deflated_size;
+		flags |= 0x40; /* RSV1 marks a compressed message */
+	}
+#endif
+
 	if (payload_size < 126) {
 		length = payload_size;
 	} else if (payload_size < (1 << 16)) {
@@ -364,12 +678,17 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 		header_size += 8;
 	}
 
-	frame_size = header_size + payload_size;
-
-	frame = ast_alloca(frame_size + 1);
-	memset(frame, 0, frame_size + 1);
+	/* The frame is built behind any held back by a cork, so they all go out in one write */
+	if (websocket_buf_reserve(&session->out, &session->out_size,
+		session->out_len + header_size + payload_size)) {
+		ao2_unlock(session);
+		ast_debug(1, "Closing WS with 1011 because we can't fulfill a write request\n");
+		ast_websocket_close(session, 1011);
+		return -1;
+	}
+	frame = session->out + session->out_len;
 
-	frame[0] = opcode | 0x80;
+	frame[0] = opcode | flags;
 	frame[1] = length;
 
 	/* Use the additional available bytes to store the length */
@@ -379,24 +698,58 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 		put_unaligned_uint64(&frame[2], htonll(payload_size));
 	}
 
-	memcpy(&frame[header_size], payload, payload_size);
+	if (payload_size) {
+		memcpy(&frame[header_size], payload, payload_size);
+	}
+	session->out_len += header_size + payload_size;
+
+	if (session->corked && session->out_len < WEBSOCKET_CORK_SIZE) {
+		ao2_unlock(session);
+		return 0;
+	}
+
+	if (websocket_flush(session)) {
+		ao2_unlock(session);
+		/* 1011 - server terminating connection due to not being able to fulfill the request */
+		ast_debug(1, "Closing WS with 1011 because we can't fulfill a write request\n");
+		ast_websocket_close(session, 1011);
+		return -1;
+	}
+
+	ao2_unlock(session);
+
+	return 0;
+}
+
+void AST_OPTIONAL_API_NAME(ast_websocket_cork)(struct ast_websocket *session)
+{
+	ao2_lock(session);
+	++session->corked;
+	ao2_unlock(session);
+}
 
+int AST_OPTIONAL_API_NAME(ast_websocket_uncork)(struct ast_websocket *session)
+{
 	ao2_lock(session);
+	if (!session->corked || --session->corked || !session->out_len) {
+		ao2_unlock(session);
+		return 0;
+	}
+
 	if (session->closing) {
+		/* The connection went away underneath the held back frames */
+		session->out_len = 0;
 		ao2_unlock(session);
 		return -1;
 	}
 
-	ast_iostream_set_timeout_sequence(session->stream, ast_tvnow(), session->timeout);
-	if (ast_iostream_write(session->stream, frame, frame_size) != frame_size) {
+	if (websocket_flush(session)) {
 		ao2_unlock(session);
-		/* 1011 - server terminating connection due to not being able to fulfill the request */
 		ast_debug(1, "Closing WS with 1011 because we can't fulfill a write request\n");
 		ast_websocket_close(session, 1011);
 		return -1;
 	}
 
-	ast_iostream_set_timeout_disable(session->stream);
 	ao2_unlock(session);
 
 	return 0;
@@ -565,10 +918,11 @@ static inline int ws_safe_read(struct ast_websocket *session, char *buf, size_t
 
 int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, char **payload, uint64_t *payload_len, enum ast_websocket_opcode *opcode, int *fragmented)
 {
-	char buf[MAXIMUM_FRAME_SIZE] = "";
+	char buf[MAX_WS_HDR_SZ];
 	int fin = 0;
 	int mask_present = 0;
-	char *mask = NULL, *new_payload = NULL;
+	int compressed = 0;
+	char *mask = NULL;
 	size_t options_len = 0, frame_size = 0;
 
 	*payload = NULL;
@@ -585,9 +939,20 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 	*payload_len = buf[1] & 0x7f;
 	if (*opcode == AST_WEBSOCKET_OPCODE_TEXT || *opcode == AST_WEBSOCKET_OPCODE_BINARY || *opcode == AST_WEBSOCKET_OPCODE_CONTINUATION ||
 	    *opcode == AST_WEBSOCKET_OPCODE_PING || *opcode == AST_WEBSOCKET_OPCODE_PONG  || *opcode == AST_WEBSOCKET_OPCODE_CLOSE) {
+		int data = *opcode == AST_WEBSOCKET_OPCODE_TEXT || *opcode == AST_WEBSOCKET_OPCODE_BINARY
+			|| *opcode == AST_WEBSOCKET_OPCODE_CONTINUATION;
+
 		fin = (buf[0] >> 7) & 1;
 		mask_present = (buf[1] >> 7) & 1;
 
+#ifdef HAVE_ZLIB
+		/* RSV1 on the first frame marks the whole message as compressed */
+		if (*opcode == AST_WEBSOCKET_OPCODE_TEXT || *opcode == AST_WEBSOCKET_OPCODE_BINARY) {
+			session->inflating = session->deflate_enabled && ((buf[0] >> 6) & 1);
+		}
+		compressed = data && session->inflating;
+#endif
+
 		/* Based on the mask flag and payload length, determine how much more we need to read before start parsing the rest of the header */
 		options_len += mask_present ? 4 : 0;
 		options_len += (*payload_len == 126) ? 2 : (*payload_len == 127) ? 8 : 0;
@@ -612,8 +977,6 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 			mask = &buf[2];
 		}
 
-		/* Now read the rest of the payload */
-		*payload = &buf[frame_size]; /* payload will start here, at the end of the options, if any */
 		frame_size = frame_size + (*payload_len); /* final frame size is header + optional headers + payload data */
 		if (frame_size > MAXIMUM_FRAME_SIZE) {
 			ast_log(LOG_WARNING, "Cannot fit huge websocket frame of %zu bytes\n", frame_size);
@@ -622,6 +985,28 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 			return -1;
 		}
 
+		/* Plain data is read straight onto the end of the payload being reconstructed,
+		 * anything else into the frame buffer. Both are kept for the next frame. */
+		if (data && !compressed) {
+			if (websocket_buf_reserve(&session->payload, &session->payload_size, session->payload_len + *payload_len)) {
+				ast_log(LOG_WARNING, "Failed allocation: %p, %zu, %"PRIu64"\n",
+					session->payload, session->payload_len, *payload_len);
+				*payload_len = 0;
+				ast_websocket_close(session, 1009);
+				return -1;
+			}
+			*payload = session->payload + session->payload_len;
+		} else {
+			if (websocket_buf_reserve(&session->frame, &session->frame_size, *payload_len)) {
+				ast_log(LOG_WARNING, "Failed allocation: %p, %zu, %"PRIu64"\n",
+					session->frame, session->frame_size, *payload_len);
+				*payload_len = 0;
+				ast_websocket_close(session, 1009);
+				return -1;
+			}
+			*payload = session->frame;
+		}
+
 		if (*payload_len) {
 			if (ws_safe_read(session, *payload, *payload_len, opcode)) {
 				return -1;
@@ -662,22 +1047,24 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 		}
 
 		/* Below this point we are handling TEXT, BINARY or CONTINUATION opcodes */
-		if (*payload_len) {
-			if (!(new_payload = ast_realloc(session->payload, (session->payload_len + *payload_len)))) {
-				ast_log(LOG_WARNING, "Failed allocation: %p, %zu, %"PRIu64"\n",
-					session->payload, session->payload_len, *payload_len);
+#ifdef HAVE_ZLIB
+		if (compressed) {
+			int res = websocket_inflate(session, *payload, *payload_len, fin);
+
+			if (res) {
+				ast_log(LOG_WARNING, "WebSocket compressed message from '%s' %s\n",
+					ast_sockaddr_stringify(&session->remote_address),
+					res > 0 ? "inflates too large" : "could not be decompressed");
 				*payload_len = 0;
-				ast_websocket_close(session, 1009);
+				ast_websocket_close(session, res > 0 ? 1009 : 1007);
 				return -1;
 			}
-
-			session->payload = new_payload;
-			memcpy((session->payload + session->payload_len), (*payload), (*payload_len));
-			session->payload_len += *payload_len;
-		} else if (!session->payload_len && session->payload) {
-			ast_free(session->payload);
-			session->payload = NULL;
-		}
+			if (fin) {
+				session->inflating = 0;
+			}
+		} else
+#endif
+		session->payload_len += *payload_len;
 
 		if (!fin && session->reconstruct && (session->payload_len < session->reconstruct)) {
 			/* If this is not a final message we need to defer returning it until later */
@@ -698,7 +1085,7 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 				}
 			}
 			*payload_len = session->payload_len;
-			*payload = session->payload;
+			*payload = session->payload_len ? session->payload : NULL;
 			session->payload_len = 0;
 		}
 	} else {
@@ -756,6 +1143,8 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 {
 	struct ast_variable *v;
 	const char *upgrade = NULL, *key = NULL, *key1 = NULL, *key2 = NULL, *protos = NULL;
+	const char *extensions = NULL;
+	char extensions_header[128] = "";
 	char *requested_protocols = NULL, *protocol = NULL;
 	int version = 0, flags = 1;
 	struct ast_websocket_protocol *protocol_handler = NULL;
@@ -784,6 +1173,8 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 			key2 = v->value;
 		} else if (!strcasecmp(v->name, "Sec-WebSocket-Protocol")) {
 			protos = v->value;
+		} else if (!strcasecmp(v->name, "Sec-WebSocket-Extensions")) {
+			extensions = v->value;
 		} else if (!strcasecmp(v->name, "Sec-WebSocket-Version")) {
 			if (sscanf(v->value, "%30d", &version) != 1) {
 				version = 0;
@@ -877,6 +1268,12 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 			return 0;
 		}
 
+#ifdef HAVE_ZLIB
+		if (!ast_strlen_zero(extensions)) {
+			websocket_deflate_negotiate(session, extensions, extensions_header, sizeof(extensions_header));
+		}
+#endif
+
 		/* RFC 6455, Section 4.1:
 		 *
 		 * 6. If the response includes a |Sec-WebSocket-Protocol| header
@@ -892,18 +1289,22 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 				"Upgrade: %s\r\n"
 				"Connection: Upgrade\r\n"
 				"Sec-WebSocket-Accept: %s\r\n"
-				"Sec-WebSocket-Protocol: %s\r\n\r\n",
+				"Sec-WebSocket-Protocol: %s\r\n"
+				"%s\r\n",
 				upgrade,
 				websocket_combine_key(key, base64, sizeof(base64)),
-				protocol);
+				protocol,
+				extensions_header);
 		} else {
 			ast_iostream_printf(ser->stream,
 				"HTTP/1.1 101 Switching Protocols\r\n"
 				"Upgrade: %s\r\n"
 				"Connection: Upgrade\r\n"
-				"Sec-WebSocket-Accept: %s\r\n\r\n",
+				"Sec-WebSocket-Accept: %s\r\n"
+				"%s\r\n",
 				upgrade,
-				websocket_combine_key(key, base64, sizeof(base64)));
+				websocket_combine_key(key, base64, sizeof(base64)),
+				extensions_header);
 		}
 	} else {
 
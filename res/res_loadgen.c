@@ -0,0 +1,593 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Synthetic call load generator
+ *
+ * Calls are placed to a dial string, such as a Local channel into a
+ * context scripting the media with Playback, Echo, bridges or ConfBridge,
+ * or a PJSIP endpoint looping back to this system. They are placed at a
+ * rate of calls per second, up to a number of calls at once, and each is
+ * held for a time while signed linear audio is sent to it and the audio
+ * coming back is timed. The time calls take to be answered, the jitter of
+ * the frames received, and the CPU time the process uses per call, are
+ * reported for capacity planning.
+ */
+
+/*** MODULEINFO
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "asterisk/module.h"
+#include "asterisk/channel.h"
+#include "asterisk/cli.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/format_cap.h"
+#include "asterisk/frame.h"
+#include "asterisk/lock.h"
+#include "asterisk/sched.h"
+#include "asterisk/strings.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
+
+/*! \brief Samples of the signed linear frames sent, 20 ms */
+#define LOADGEN_FRAME_SAMPLES 160
+
+/*! \brief Milliseconds between the frames sent */
+#define LOADGEN_FRAME_MS 20
+
+/*! \brief Milliseconds a call is given to be answered */
+#define LOADGEN_ANSWER_TIMEOUT 30000
+
+/*! \brief A run of the load generator */
+struct loadgen_run {
+	/*! The dial string, Tech/resource */
+	char *dialstring;
+	/*! Calls placed per second */
+	unsigned int cps;
+	/*! Most calls up at once */
+	unsigned int concurrent;
+	/*! Seconds each answered call is held for */
+	unsigned int hold;
+	/*! Calls to place in all, 0 for no limit */
+	unsigned int total;
+	/*! Scheduler id of placing the next call */
+	int sched_id;
+	/*! Whether the run is being stopped */
+	int stopping;
+	/*! When the run started */
+	struct timeval start;
+	/*! CPU time of the process when the run started, in microseconds */
+	int64_t start_cpu;
+	/*! CPU time of the process when the run ended, in microseconds */
+	int64_t end_cpu;
+	/*! Milliseconds calls were up for in all */
+	int64_t call_ms;
+
+	/* Counters of calls */
+	unsigned int placed;
+	unsigned int active;
+	unsigned int answered;
+	unsigned int failed;
+	unsigned int completed;
+
+	/* Milliseconds calls took to be answered */
+	int64_t setup_total;
+	int64_t setup_min;
+	int64_t setup_max;
+
+	/* Jitter of the frames received, in microseconds, as of RFC 3550 */
+	int64_t jitter_total;
+	unsigned int jitter_calls;
+	int64_t jitter_max;
+};
+
+/*! \brief The calls of the current or last run, under lock */
+static struct loadgen_run *run;
+AST_MUTEX_DEFINE_STATIC(run_lock);
+
+/*! \brief Signalled when a call of a run ends */
+static ast_cond_t run_cond;
+
+static struct ast_sched_context *sched;
+
+static int64_t loadgen_cpu_usec(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+		+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void loadgen_run_free(struct loadgen_run *r)
+{
+	if (r) {
+		ast_free(r->dialstring);
+		ast_free(r);
+	}
+}
+
+/*! \brief The results of a call, added to the run */
+struct loadgen_call_result {
+	int answered;
+	int64_t setup_ms;
+	int64_t call_ms;
+	int64_t jitter;
+	int has_jitter;
+};
+
+static void loadgen_call_done(struct loadgen_run *r, const struct loadgen_call_result *result)
+{
+	ast_mutex_lock(&run_lock);
+	if (result->answered) {
+		r->answered++;
+		r->setup_total += result->setup_ms;
+		if (r->answered == 1 || result->setup_ms < r->setup_min) {
+			r->setup_min = result->setup_ms;
+		}
+		r->setup_max = MAX(r->setup_max, result->setup_ms);
+		r->call_ms += result->call_ms;
+		if (result->has_jitter) {
+			r->jitter_calls++;
+			r->jitter_total += result->jitter;
+			r->jitter_max = MAX(r->jitter_max, result->jitter);
+		}
+	} else {
+		r->failed++;
+	}
+	r->completed++;
+	r->active--;
+	if (!r->active && (r->stopping || (r->total && r->placed >= r->total))) {
+		r->end_cpu = loadgen_cpu_usec();
+	}
+	ast_cond_broadcast(&run_cond);
+	ast_mutex_unlock(&run_lock);
+}
+
+/*!
+ * \brief Wait for a call to be answered
+ *
+ * \retval 0 answered
+ * \retval -1 not answered
+ */
+static int loadgen_wait_answer(struct ast_channel *chan)
+{
+	struct timeval start = ast_tvnow();
+
+	while (ast_tvdiff_ms(ast_tvnow(), start) < LOADGEN_ANSWER_TIMEOUT) {
+		struct ast_frame *f;
+		int res = ast_waitfor(chan, 100);
+
+		if (res < 0) {
+			return -1;
+		} else if (!res) {
+			continue;
+		}
+		if (!(f = ast_read(chan))) {
+			return -1;
+		}
+		if (f->frametype == AST_FRAME_CONTROL) {
+			switch (f->subclass.integer) {
+			case AST_CONTROL_ANSWER:
+				ast_frfree(f);
+				return 0;
+			case AST_CONTROL_BUSY:
+			case AST_CONTROL_CONGESTION:
+			case AST_CONTROL_HANGUP:
+				ast_frfree(f);
+				return -1;
+			default:
+				break;
+			}
+		}
+		ast_frfree(f);
+	}
+
+	return -1;
+}
+
+/*!
+ * \brief Hold an answered call, sending audio and timing the audio received
+ *
+ * \retval 0 held for the whole time
+ * \retval -1 hung up early
+ */
+static int loadgen_hold(struct loadgen_run *r, struct ast_channel *chan, struct loadgen_call_result *result)
+{
+	int16_t samples[LOADGEN_FRAME_SAMPLES];
+	struct ast_frame out = {
+		.frametype = AST_FRAME_VOICE,
+		.samples = LOADGEN_FRAME_SAMPLES,
+		.datalen = sizeof(samples),
+		.data.ptr = samples,
+		.src = "loadgen",
+	};
+	struct timeval start = ast_tvnow();
+	struct timeval next = start;
+	struct timeval first_rx = { 0, };
+	int64_t rx_samples = 0;
+	int64_t last_transit = 0;
+	int64_t jitter = 0;
+	int rx_frames = 0;
+	int rate = 8000;
+	int i;
+
+	out.subclass.format = ast_format_slin;
+	for (i = 0; i < LOADGEN_FRAME_SAMPLES; ++i) {
+		/* A 500 Hz square wave, for echo cancellers and silence detection to leave alone */
+		samples[i] = (i / 8) % 2 ? 2000 : -2000;
+	}
+
+	while (ast_tvdiff_ms(ast_tvnow(), start) < r->hold * 1000 && !r->stopping) {
+		int64_t wait = ast_tvdiff_ms(next, ast_tvnow());
+		struct ast_frame *f;
+		int res;
+
+		if (wait <= 0) {
+			if (ast_write(chan, &out)) {
+				return -1;
+			}
+			next = ast_tvadd(next, ast_tv(0, LOADGEN_FRAME_MS * 1000));
+			continue;
+		}
+
+		res = ast_waitfor(chan, wait);
+		if (res < 0) {
+			return -1;
+		} else if (!res) {
+			continue;
+		}
+		if (!(f = ast_read(chan))) {
+			return -1;
+		}
+		if (f->frametype == AST_FRAME_VOICE && f->samples) {
+			struct timeval now = ast_tvnow();
+			int64_t transit;
+
+			if (!rx_frames++) {
+				first_rx = now;
+				rate = ast_format_get_sample_rate(f->subclass.format) ?: 8000;
+			}
+			/* How late the frame arrived, against the audio received before it */
+			transit = ast_tvdiff_us(now, first_rx) - rx_samples * 1000000 / rate;
+			if (rx_frames > 1) {
+				int64_t d = transit - last_transit;
+
+				jitter += ((d < 0 ? -d : d) - jitter) / 16;
+			}
+			last_transit = transit;
+			rx_samples += f->samples;
+		} else if (f->frametype == AST_FRAME_CONTROL && f->subclass.integer == AST_CONTROL_HANGUP) {
+			ast_frfree(f);
+			return -1;
+		}
+		ast_frfree(f);
+	}
+
+	if (rx_frames > 1) {
+		result->jitter = jitter;
+		result->has_jitter = 1;
+	}
+
+	return 0;
+}
+
+/*! \brief Thread placing and holding a single call */
+static void *loadgen_call(void *data)
+{
+	struct loadgen_run *r = data;
+	struct loadgen_call_result result = { 0, };
+	struct ast_format_cap *cap;
+	struct ast_channel *chan = NULL;
+	char *tech = ast_strdupa(r->dialstring);
+	char *resource;
+	struct timeval start = ast_tvnow();
+	int cause;
+
+	resource = strchr(tech, '/');
+	*resource++ = '\0';
+
+	cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (cap) {
+		ast_format_cap_append(cap, ast_format_slin, 0);
+		chan = ast_request(tech, cap, NULL, NULL, resource, &cause);
+		ao2_ref(cap, -1);
+	}
+	if (chan && (ast_set_write_format(chan, ast_format_slin) || ast_set_read_format(chan, ast_format_slin))) {
+		ast_hangup(chan);
+		chan = NULL;
+	}
+
+	if (chan && !ast_call(chan, resource, 0) && !loadgen_wait_answer(chan)) {
+		struct timeval answered = ast_tvnow();
+
+		result.answered = 1;
+		result.setup_ms = ast_tvdiff_ms(answered, start);
+		loadgen_hold(r, chan, &result);
+		result.call_ms = ast_tvdiff_ms(ast_tvnow(), answered);
+	}
+
+	if (chan) {
+		ast_hangup(chan);
+	}
+
+	loadgen_call_done(r, &result);
+
+	return NULL;
+}
+
+/*! \brief Scheduler callback placing a call of the run, at its rate */
+static int loadgen_place(const void *data)
+{
+	struct loadgen_run *r = (struct loadgen_run *) data;
+	pthread_t thread;
+	int reschedule;
+
+	ast_mutex_lock(&run_lock);
+	if (!r->stopping && r->active < r->concurrent && (!r->total || r->placed < r->total)) {
+		r->placed++;
+		r->active++;
+		if (ast_pthread_create_detached(&thread, NULL, loadgen_call, r)) {
+			r->placed--;
+			r->active--;
+			r->failed++;
+		}
+	}
+	reschedule = !r->stopping && (!r->total || r->placed < r->total);
+	if (!reschedule) {
+		r->sched_id = -1;
+		if (!r->active) {
+			r->end_cpu = loadgen_cpu_usec();
+		}
+	}
+	ast_mutex_unlock(&run_lock);
+
+	return reschedule;
+}
+
+/*! \brief Stop the current run, waiting for its calls to be hung up */
+static void loadgen_stop(void)
+{
+	ast_mutex_lock(&run_lock);
+	if (!run) {
+		ast_mutex_unlock(&run_lock);
+		return;
+	}
+	run->stopping = 1;
+	ast_mutex_unlock(&run_lock);
+
+	AST_SCHED_DEL(sched, run->sched_id);
+
+	ast_mutex_lock(&run_lock);
+	run->sched_id = -1;
+	while (run->active) {
+		ast_cond_wait(&run_cond, &run_lock);
+	}
+	if (!run->end_cpu) {
+		run->end_cpu = loadgen_cpu_usec();
+	}
+	ast_mutex_unlock(&run_lock);
+}
+
+static char *handle_cli_loadgen_start(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct loadgen_run *r;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "loadgen start";
+		e->usage =
+			"Usage: loadgen start <Tech/resource> [cps <n>] [concurrent <n>] [hold <seconds>] [calls <n>]\n"
+			"       Places calls to the dial string, cps calls a second (default 1), with\n"
+			"       at most concurrent calls up at once (default 10). Each answered call\n"
+			"       is held for hold seconds (default 30) while audio is sent to it. If\n"
+			"       calls is given, the run ends after that many calls, otherwise it goes\n"
+			"       on until 'loadgen stop'. For example:\n"
+			"       loadgen start Local/echo@loadgen cps 5 concurrent 200 hold 60\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc < 3 || !(a->argc % 2) || !strchr(a->argv[2], '/')) {
+		return CLI_SHOWUSAGE;
+	}
+
+	r = ast_calloc(1, sizeof(*r));
+	if (!r || !(r->dialstring = ast_strdup(a->argv[2]))) {
+		loadgen_run_free(r);
+		return CLI_FAILURE;
+	}
+	r->cps = 1;
+	r->concurrent = 10;
+	r->hold = 30;
+	r->sched_id = -1;
+
+	for (i = 3; i < a->argc; i += 2) {
+		unsigned int *value;
+
+		if (!strcasecmp(a->argv[i], "cps")) {
+			value = &r->cps;
+		} else if (!strcasecmp(a->argv[i], "concurrent")) {
+			value = &r->concurrent;
+		} else if (!strcasecmp(a->argv[i], "hold")) {
+			value = &r->hold;
+		} else if (!strcasecmp(a->argv[i], "calls")) {
+			value = &r->total;
+		} else {
+			loadgen_run_free(r);
+			return CLI_SHOWUSAGE;
+		}
+		if (sscanf(a->argv[i + 1], "%30u", value) != 1) {
+			loadgen_run_free(r);
+			return CLI_SHOWUSAGE;
+		}
+	}
+	if (!r->cps || !r->concurrent) {
+		loadgen_run_free(r);
+		return CLI_SHOWUSAGE;
+	}
+
+	loadgen_stop();
+
+	ast_mutex_lock(&run_lock);
+	loadgen_run_free(run);
+	run = r;
+	r->start = ast_tvnow();
+	r->start_cpu = loadgen_cpu_usec();
+	r->sched_id = ast_sched_add(sched, 1000 / r->cps ?: 1, loadgen_place, r);
+	ast_mutex_unlock(&run_lock);
+
+	if (r->sched_id < 0) {
+		ast_cli(a->fd, "Unable to start the load generator\n");
+		return CLI_FAILURE;
+	}
+
+	ast_cli(a->fd, "Placing calls to %s, %u a second, at most %u at once, each held for %u seconds\n",
+		r->dialstring, r->cps, r->concurrent, r->hold);
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_loadgen_stop(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "loadgen stop";
+		e->usage =
+			"Usage: loadgen stop\n"
+			"       Stops placing calls, and hangs up the calls of the load generator.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 2) {
+		return CLI_SHOWUSAGE;
+	}
+
+	loadgen_stop();
+	ast_cli(a->fd, "Load generator stopped\n");
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_loadgen_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int64_t cpu;
+	int64_t elapsed;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "loadgen show stats";
+		e->usage =
+			"Usage: loadgen show stats\n"
+			"       Shows the call setup latency, frame jitter and CPU per call of the\n"
+			"       current or last run of the load generator.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&run_lock);
+	if (!run) {
+		ast_mutex_unlock(&run_lock);
+		ast_cli(a->fd, "The load generator has not been started\n");
+		return CLI_SUCCESS;
+	}
+
+	cpu = (run->end_cpu ?: loadgen_cpu_usec()) - run->start_cpu;
+	elapsed = ast_tvdiff_ms(ast_tvnow(), run->start);
+
+	ast_cli(a->fd, "Dial string:         %s\n", run->dialstring);
+	ast_cli(a->fd, "State:               %s\n", run->active || run->sched_id >= 0 ? "Running" : "Stopped");
+	ast_cli(a->fd, "Elapsed:             %" PRId64 " s\n", elapsed / 1000);
+	ast_cli(a->fd, "Calls placed:        %u\n", run->placed);
+	ast_cli(a->fd, "Calls active:        %u\n", run->active);
+	ast_cli(a->fd, "Calls answered:      %u\n", run->answered);
+	ast_cli(a->fd, "Calls failed:        %u\n", run->failed);
+	if (run->answered) {
+		ast_cli(a->fd, "Setup latency:       min %" PRId64 " ms, avg %" PRId64 " ms, max %" PRId64 " ms\n",
+			run->setup_min, run->setup_total / run->answered, run->setup_max);
+	}
+	if (run->jitter_calls) {
+		ast_cli(a->fd, "Receive jitter:      avg %" PRId64 " us, max %" PRId64 " us\n",
+			run->jitter_total / run->jitter_calls, run->jitter_max);
+	}
+	ast_cli(a->fd, "CPU time:            %" PRId64 " ms\n", cpu / 1000);
+	if (run->completed) {
+		ast_cli(a->fd, "CPU per call:        %" PRId64 " ms\n", cpu / 1000 / run->completed);
+	}
+	if (run->call_ms >= 1000) {
+		ast_cli(a->fd, "CPU per call second: %" PRId64 " us\n", cpu / (run->call_ms / 1000));
+	}
+	ast_mutex_unlock(&run_lock);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_loadgen[] = {
+	AST_CLI_DEFINE(handle_cli_loadgen_start, "Start placing calls to generate load"),
+	AST_CLI_DEFINE(handle_cli_loadgen_stop, "Stop the load generator"),
+	AST_CLI_DEFINE(handle_cli_loadgen_show, "Show the statistics of the load generator"),
+};
+
+static int unload_module(void)
+{
+	ast_cli_unregister_multiple(cli_loadgen, ARRAY_LEN(cli_loadgen));
+	loadgen_stop();
+	ast_sched_context_destroy(sched);
+	sched = NULL;
+	loadgen_run_free(run);
+	run = NULL;
+	ast_cond_destroy(&run_cond);
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	ast_cond_init(&run_cond, NULL);
+
+	sched = ast_sched_context_create();
+	if (!sched || ast_sched_start_thread(sched)) {
+		if (sched) {
+			ast_sched_context_destroy(sched);
+			sched = NULL;
+		}
+		ast_cond_destroy(&run_cond);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	ast_cli_register_multiple(cli_loadgen, ARRAY_LEN(cli_loadgen));
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD_EXTENDED(ASTERISK_GPL_KEY, "Synthetic Call Load Generator");
@@ -152,6 +152,7 @@ struct moh_files_state {
 #define MOH_CACHERTCLASSES	(1 << 5)	/*!< Should we use a separate instance of MOH for each user or not */
 #define MOH_ANNOUNCEMENT	(1 << 6)	/*!< Do we play announcement files between songs on this channel? */
 #define MOH_PREFERCHANNELCLASS	(1 << 7)	/*!< Should queue moh override channel moh */
+#define MOH_BROADCAST		(1 << 8)	/*!< Do the channels of a files class hear what a single reader plays? */
 
 /* Custom astobj2 flag */
 #define MOH_NOTDELETED          (1 << 30)       /*!< Find only records that aren't deleted? */
@@ -191,7 +192,11 @@ struct mohclass {
 	/*! Created on the fly, from RT engine */
 	unsigned int realtime:1;
 	unsigned int delete:1;
+	/*! Set to stop the reader of a broadcast class */
+	int broadcast_stop;
 	AST_LIST_HEAD_NOLOCK(, mohdata) members;
+	/*! The formats the listeners of a broadcast class write */
+	AST_LIST_HEAD_NOLOCK(, moh_broadcast_output) outputs;
 	AST_LIST_ENTRY(mohclass) list;
 };
 
@@ -203,6 +208,44 @@ struct mohdata {
 	AST_LIST_ENTRY(mohdata) list;
 };
 
+/*! Frames of a broadcast class read per second */
+#define MOH_BROADCAST_RATE 50
+
+/*! Frames kept for the listeners of a broadcast class to catch up with */
+#define MOH_BROADCAST_FRAMES 16
+
+/*!
+ * \brief The frames a broadcast class plays, in a format some of its listeners write
+ *
+ * The reader translates each frame once per output, rather than once per
+ * listener.
+ */
+struct moh_broadcast_output {
+	/*! The format of the frames */
+	struct ast_format *format;
+	/*! The format the path translates from */
+	struct ast_format *src_format;
+	/*! Translation path from src_format, only used by the reader */
+	struct ast_trans_pvt *path;
+	/*! Listeners writing the format, protected by the class lock */
+	unsigned int listeners;
+	/*! Sequence number of the latest frame */
+	unsigned int seq;
+	/*! The latest frames, by sequence number */
+	struct ast_frame *frames[MOH_BROADCAST_FRAMES];
+	AST_LIST_ENTRY(moh_broadcast_output) list;
+};
+
+/*! \brief A channel listening to a broadcast class */
+struct moh_broadcast_listener {
+	struct mohclass *class;
+	/*! The frames the channel writes */
+	struct moh_broadcast_output *output;
+	struct ast_format *origwfmt;
+	/*! Sequence number of the latest frame written */
+	unsigned int seq;
+};
+
 static struct ao2_container *mohclasses;
 
 #define LOCAL_MPG_123 "/usr/local/bin/mpg123"
@@ -1074,6 +1117,374 @@ static struct ast_generator mohgen = {
 	.digit    = moh_handle_digit,
 };
 
+static void moh_broadcast_output_destructor(void *obj)
+{
+	struct moh_broadcast_output *output = obj;
+	int i;
+
+	for (i = 0; i < MOH_BROADCAST_FRAMES; ++i) {
+		if (output->frames[i]) {
+			ast_frfree(output->frames[i]);
+		}
+	}
+	if (output->path) {
+		ast_translator_free_path(output->path);
+	}
+	ao2_cleanup(output->src_format);
+	ao2_cleanup(output->format);
+}
+
+/*!
+ * \internal
+ * \brief Open a file of a files class, in any format it exists in
+ *
+ * \param filepath The file, without extension
+ */
+static struct ast_filestream *moh_broadcast_readfile(const char *filepath)
+{
+	char *dir_path = ast_strdupa(filepath);
+	char *name = strrchr(dir_path, '/');
+	struct ast_filestream *fs = NULL;
+	struct dirent *de;
+	size_t name_len;
+	DIR *dir;
+
+	if (!name) {
+		return NULL;
+	}
+	*name++ = '\0';
+	name_len = strlen(name);
+
+	dir = opendir(dir_path);
+	if (!dir) {
+		return NULL;
+	}
+	while (!fs && (de = readdir(dir))) {
+		const char *ext = de->d_name + name_len + 1;
+
+		if (strncmp(de->d_name, name, name_len) || de->d_name[name_len] != '.'
+			|| !ast_get_format_for_file_ext(ext)) {
+			continue;
+		}
+		fs = ast_readfile(filepath, ext, NULL, O_RDONLY, 0, 0);
+	}
+	closedir(dir);
+
+	return fs;
+}
+
+/*!
+ * \internal
+ * \brief Open the next file a broadcast class plays
+ *
+ * \param class The class
+ * \param[in,out] pos The position of the file played last
+ */
+static struct ast_filestream *moh_broadcast_next(struct mohclass *class, int *pos)
+{
+	char filepath[PATH_MAX];
+	size_t file_count;
+	size_t tries;
+
+	for (tries = 0; ; ++tries) {
+		struct ast_filestream *fs;
+
+		ao2_lock(class);
+		file_count = AST_VECTOR_SIZE(&class->files);
+		if (tries >= file_count) {
+			ao2_unlock(class);
+			return NULL;
+		}
+		if (ast_test_flag(class, MOH_SORTMODE) == MOH_RANDOMIZE) {
+			*pos = ast_random() % file_count;
+		} else {
+			*pos = (*pos + 1) % file_count;
+		}
+		ast_copy_string(filepath, AST_VECTOR_GET(&class->files, *pos), sizeof(filepath));
+		ao2_unlock(class);
+
+		fs = moh_broadcast_readfile(filepath);
+		if (fs) {
+			ast_debug(1, "MOH class '%s' broadcasting file %d '%s'\n", class->name, *pos, filepath);
+			return fs;
+		}
+		ast_log(LOG_WARNING, "Unable to open file '%s'\n", filepath);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Keep a frame read by a broadcast class in each of its outputs
+ */
+static void moh_broadcast_frame(struct mohclass *class, struct ast_frame *f)
+{
+	struct moh_broadcast_output *output;
+
+	ao2_lock(class);
+	AST_LIST_TRAVERSE(&class->outputs, output, list) {
+		struct ast_frame *out = f;
+		struct ast_frame *cur;
+
+		if (ast_format_cmp(output->format, f->subclass.format) == AST_FORMAT_CMP_NOT_EQUAL) {
+			if (!output->src_format
+				|| ast_format_cmp(output->src_format, f->subclass.format) == AST_FORMAT_CMP_NOT_EQUAL) {
+				if (output->path) {
+					ast_translator_free_path(output->path);
+				}
+				ao2_replace(output->src_format, f->subclass.format);
+				output->path = ast_translator_build_path(output->format, f->subclass.format);
+			}
+			if (!output->path || !(out = ast_translate(output->path, f, 0))) {
+				continue;
+			}
+		}
+
+		ao2_lock(output);
+		for (cur = out; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			struct ast_frame *dup = ast_frdup(cur);
+			struct ast_frame **slot;
+
+			if (!dup) {
+				break;
+			}
+			slot = &output->frames[++output->seq % MOH_BROADCAST_FRAMES];
+			if (*slot) {
+				ast_frfree(*slot);
+			}
+			*slot = dup;
+		}
+		ao2_unlock(output);
+
+		if (out != f) {
+			ast_frfree(out);
+		}
+	}
+	ao2_unlock(class);
+}
+
+/*!
+ * \internal
+ * \brief The reader of a broadcast class
+ *
+ * A single file stream is read for all the channels listening to the
+ * class, at the pace of the class timer.
+ */
+static void *moh_broadcast_thread(void *data)
+{
+	struct mohclass *class = data;
+	struct pollfd pfd = { .fd = ast_timer_fd(class->timer), .events = POLLIN | POLLPRI, };
+	struct ast_filestream *fs = NULL;
+	/* Microseconds of audio owed to the listeners */
+	int64_t owed = 0;
+	int pos = -1;
+
+	if (ast_test_flag(class, MOH_RANDOMIZE) && AST_VECTOR_SIZE(&class->files)) {
+		pos = ast_random() % AST_VECTOR_SIZE(&class->files);
+	}
+
+	while (!class->broadcast_stop) {
+		int listening;
+
+		if (ast_poll(&pfd, 1, 100) <= 0) {
+			continue;
+		}
+		if (ast_timer_ack(class->timer, 1) < 0) {
+			ast_log(LOG_ERROR, "Failed to acknowledge timer for MOH class '%s'\n", class->name);
+			break;
+		}
+
+		ao2_lock(class);
+		listening = !AST_LIST_EMPTY(&class->outputs);
+		ao2_unlock(class);
+		if (!listening) {
+			/* The class resumes where it was once someone listens again */
+			owed = 0;
+			continue;
+		}
+
+		owed += 1000000 / MOH_BROADCAST_RATE;
+		while (owed > 0) {
+			struct ast_frame *f = fs ? ast_readframe(fs) : NULL;
+
+			if (!f) {
+				if (fs) {
+					ast_closestream(fs);
+				}
+				fs = moh_broadcast_next(class, &pos);
+				f = fs ? ast_readframe(fs) : NULL;
+				if (!f) {
+					owed = 0;
+					break;
+				}
+			}
+
+			owed -= (int64_t) f->samples * 1000000 / ast_format_get_sample_rate(f->subclass.format);
+			moh_broadcast_frame(class, f);
+			ast_frfree(f);
+		}
+	}
+
+	if (fs) {
+		ast_closestream(fs);
+	}
+
+	return NULL;
+}
+
+static void moh_broadcast_release(struct ast_channel *chan, void *data)
+{
+	struct moh_broadcast_listener *listener = data;
+	struct mohclass *class = listener->class;
+	struct ast_format *oldwfmt = listener->origwfmt;
+
+	if (listener->output) {
+		ao2_lock(class);
+		if (!--listener->output->listeners) {
+			AST_LIST_REMOVE(&class->outputs, listener->output, list);
+			ao2_ref(listener->output, -1);
+		}
+		ao2_unlock(class);
+		ao2_ref(listener->output, -1);
+	}
+
+	listener->class = mohclass_unref(class, "unreffing listener class upon deactivation of generator");
+	ast_free(listener);
+
+	if (chan) {
+		struct moh_files_state *state;
+
+		state = ast_channel_music_state(chan);
+		if (state && state->class) {
+			state->class = mohclass_unref(state->class, "Unreffing channel's music class upon deactivation of generator");
+		}
+		if (oldwfmt && ast_set_write_format(chan, oldwfmt)) {
+			ast_log(LOG_WARNING, "Unable to restore channel '%s' to format %s\n",
+					ast_channel_name(chan), ast_format_get_name(oldwfmt));
+		}
+
+		moh_post_stop(chan);
+	}
+
+	ao2_cleanup(oldwfmt);
+}
+
+static void *moh_broadcast_alloc(struct ast_channel *chan, void *params)
+{
+	struct mohclass *class = params;
+	struct moh_broadcast_listener *listener;
+	struct moh_broadcast_output *output;
+	struct moh_files_state *state;
+	struct ast_format *format;
+
+	/* Initiating music_state for current channel. Channel should know name of moh class */
+	state = ast_channel_music_state(chan);
+	if (!state && (state = ast_calloc(1, sizeof(*state)))) {
+		ast_channel_music_state_set(chan, state);
+		ast_module_ref(ast_module_info->self);
+	} else {
+		if (!state) {
+			return NULL;
+		}
+		if (state->class) {
+			mohclass_unref(state->class, "Uh Oh. Restarting MOH with an active class");
+			ast_log(LOG_WARNING, "Uh Oh. Restarting MOH with an active class\n");
+		}
+		ao2_cleanup(state->origwfmt);
+		ao2_cleanup(state->mohwfmt);
+		memset(state, 0, sizeof(*state));
+	}
+
+	listener = ast_calloc(1, sizeof(*listener));
+	if (!listener) {
+		return NULL;
+	}
+	listener->class = mohclass_ref(class, "Reffing music class for broadcast listener");
+
+	ast_channel_lock(chan);
+	format = ao2_bump(ast_channel_rawwriteformat(chan));
+	listener->origwfmt = ao2_bump(ast_channel_writeformat(chan));
+	ast_channel_unlock(chan);
+
+	/* Channels writing the same format share the frames translated for it */
+	ao2_lock(class);
+	AST_LIST_TRAVERSE(&class->outputs, output, list) {
+		if (ast_format_cmp(output->format, format) != AST_FORMAT_CMP_NOT_EQUAL) {
+			break;
+		}
+	}
+	if (!output) {
+		output = ao2_alloc(sizeof(*output), moh_broadcast_output_destructor);
+		if (output) {
+			output->format = ao2_bump(format);
+			AST_LIST_INSERT_TAIL(&class->outputs, output, list);
+		}
+	}
+	if (output) {
+		++output->listeners;
+		listener->output = ao2_bump(output);
+		ao2_lock(output);
+		listener->seq = output->seq;
+		ao2_unlock(output);
+	}
+	ao2_unlock(class);
+
+	/* The frames are written as they are, without translating them again */
+	if (!listener->output || ast_set_write_format(chan, format)) {
+		ast_log(LOG_WARNING, "Unable to set channel '%s' to format '%s'\n", ast_channel_name(chan),
+			ast_format_get_name(format));
+		moh_broadcast_release(NULL, listener);
+		ao2_ref(format, -1);
+		return NULL;
+	}
+	ao2_ref(format, -1);
+
+	state->class = mohclass_ref(class, "Placing reference into state container");
+	moh_post_start(chan, class->name);
+
+	return listener;
+}
+
+static int moh_broadcast_generate(struct ast_channel *chan, void *data, int len, int samples)
+{
+	struct moh_broadcast_listener *listener = data;
+	struct moh_broadcast_output *output = listener->output;
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+	struct ast_frame *f;
+	int res = 0;
+
+	AST_LIST_HEAD_INIT_NOLOCK(&frames);
+
+	ao2_lock(output);
+	if (output->seq - listener->seq > MOH_BROADCAST_FRAMES) {
+		/* The frames the channel did not keep up with are no longer kept */
+		listener->seq = output->seq - MOH_BROADCAST_FRAMES;
+	}
+	while (listener->seq != output->seq) {
+		f = ast_frdup(output->frames[++listener->seq % MOH_BROADCAST_FRAMES]);
+		if (f) {
+			AST_LIST_INSERT_TAIL(&frames, f, frame_list);
+		}
+	}
+	ao2_unlock(output);
+
+	while ((f = AST_LIST_REMOVE_HEAD(&frames, frame_list))) {
+		if (!res && ast_write(chan, f) < 0) {
+			ast_log(LOG_WARNING, "Failed to write frame to '%s': %s\n", ast_channel_name(chan), strerror(errno));
+			res = -1;
+		}
+		ast_frfree(f);
+	}
+
+	return res;
+}
+
+static struct ast_generator moh_broadcast_gen = {
+	.alloc    = moh_broadcast_alloc,
+	.release  = moh_broadcast_release,
+	.generate = moh_broadcast_generate,
+	.digit    = moh_handle_digit,
+};
+
 static void moh_parse_options(struct ast_variable *var, struct mohclass *mohclass)
 {
 	for (; var; var = var->next) {
@@ -1119,6 +1530,8 @@ static void moh_parse_options(struct ast_variable *var, struct mohclass *mohclas
 			} else if (!strcasecmp(var->value, "randstart")) {
 				ast_set_flag(mohclass, MOH_RANDSTART);
 			}
+		} else if (!strcasecmp(var->name, "broadcast")) {
+			ast_set2_flag(mohclass, ast_true(var->value), MOH_BROADCAST);
 		} else if (!strcasecmp(var->name, "format")) {
 			ao2_cleanup(mohclass->format);
 			mohclass->format = ast_format_cache_get(var->value);
@@ -1243,6 +1656,20 @@ static int init_files_class(struct mohclass *class)
 		return -1;
 	}
 
+	if (ast_test_flag(class, MOH_BROADCAST)) {
+		if (!(class->timer = ast_timer_open())) {
+			ast_log(LOG_WARNING, "Unable to create timer: %s\n", strerror(errno));
+			return -1;
+		}
+		if (ast_timer_set_rate(class->timer, MOH_BROADCAST_RATE)
+			|| ast_pthread_create_background(&class->thread, NULL, moh_broadcast_thread, class)) {
+			ast_log(LOG_WARNING, "Unable to start broadcasting moh class:%s\n", class->name);
+			ast_timer_close(class->timer);
+			class->timer = NULL;
+			return -1;
+		}
+	}
+
 	return 0;
 }
 
@@ -1725,7 +2152,10 @@ static int local_ast_moh_start(struct ast_channel *chan, const char *mclass, con
 	}
 
 	if (!state || !state->class || strcmp(mohclass->name, state->class->name)) {
-		if (AST_VECTOR_SIZE(&mohclass->files)) {
+		if (ast_test_flag(mohclass, MOH_BROADCAST) && mohclass->timer) {
+			/* Only registered files classes are broadcast, by the reader started for them */
+			res = ast_activate_generator(chan, &moh_broadcast_gen, mohclass);
+		} else if (AST_VECTOR_SIZE(&mohclass->files)) {
 			res = ast_activate_generator(chan, &moh_file_stream, mohclass);
 		} else {
 			res = ast_activate_generator(chan, &mohgen, mohclass);
@@ -1772,6 +2202,13 @@ static void moh_class_destructor(void *obj)
 	}
 	ao2_unlock(class);
 
+	/* The reader of a broadcast class is not cancelled, it stops by itself */
+	if (ast_test_flag(class, MOH_BROADCAST) && class->timer) {
+		class->broadcast_stop = 1;
+		pthread_join(class->thread, NULL);
+		class->thread = AST_PTHREADT_NULL;
+	}
+
 	/* Kill the thread first, so it cannot restart the child process while the
 	 * class is being destroyed */
 	if (class->thread != AST_PTHREADT_NULL && class->thread != 0) {
@@ -2040,6 +2477,19 @@ static char *handle_cli_moh_show_classes(struct ast_cli_entry *e, int cmd, struc
 		if (strcasecmp(class->mode, "files")) {
 			ast_cli(a->fd, "\tFormat: %s\n", ast_format_get_name(class->format));
 		}
+		if (ast_test_flag(class, MOH_BROADCAST) && class->timer) {
+			struct moh_broadcast_output *output;
+			unsigned int listeners = 0;
+			int formats = 0;
+
+			ao2_lock(class);
+			AST_LIST_TRAVERSE(&class->outputs, output, list) {
+				listeners += output->listeners;
+				++formats;
+			}
+			ao2_unlock(class);
+			ast_cli(a->fd, "\tBroadcast: %u listeners in %d formats\n", listeners, formats);
+		}
 	}
 	ao2_iterator_destroy(&i);
 
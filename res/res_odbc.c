@@ -100,6 +100,31 @@ struct odbc_class
 	char *sql_text;
 	/*! Slow query limit (in milliseconds) */
 	unsigned int slowquerylimit;
+	/*! Most prepared statements cached by each connection */
+	unsigned int statement_cache_size;
+	/*! The number of connections handed out and not yet released */
+	size_t connections_in_use;
+	/*! The number of connections requested */
+	unsigned int connection_requests;
+	/*! The total time spent getting connections (in microseconds) */
+	long long connection_wait_total;
+	/*! The longest time spent getting a connection (in microseconds) */
+	long long connection_wait_longest;
+	/*! The number of cached statements reused */
+	int statement_cache_hits;
+	/*! The number of statements prepared as no cached one could be reused */
+	int statement_cache_misses;
+};
+
+/*! \brief A prepared statement cached by a connection */
+struct odbc_statement {
+	AST_LIST_ENTRY(odbc_statement) list;
+	/*! The prepared statement handle */
+	SQLHSTMT stmt;
+	/*! Set while the statement is handed out */
+	unsigned int in_use:1;
+	/*! The SQL query the statement was prepared with */
+	char sql[0];
 };
 
 static struct ao2_container *class_container;
@@ -194,7 +219,12 @@ static void odbc_class_destructor(void *data)
 static void odbc_obj_destructor(void *data)
 {
 	struct odbc_obj *obj = data;
+	struct odbc_statement *statement;
 
+	while ((statement = AST_LIST_REMOVE_HEAD(&obj->statements, list))) {
+		SQLFreeHandle(SQL_HANDLE_STMT, statement->stmt);
+		ast_free(statement);
+	}
 	odbc_obj_disconnect(obj);
 }
 
@@ -404,6 +434,27 @@ SQLHSTMT ast_odbc_direct_execute(struct odbc_obj *obj, SQLHSTMT (*exec_cb)(struc
 	return stmt;
 }
 
+/*!
+ * \internal
+ * \brief Free a statement that failed, removing it from the statement cache
+ */
+static void odbc_statement_discard(struct odbc_obj *obj, SQLHSTMT stmt)
+{
+	struct odbc_statement *statement;
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&obj->statements, statement, list) {
+		if (statement->stmt == stmt) {
+			AST_LIST_REMOVE_CURRENT(list);
+			--obj->statement_cnt;
+			ast_free(statement);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
+	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+}
+
 SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_cb)(struct odbc_obj *obj, void *data), void *data)
 {
 	struct timeval start;
@@ -431,7 +482,7 @@ SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_c
 		}
 
 		ast_log(LOG_WARNING, "SQL Execute error %d!\n", res);
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		odbc_statement_discard(obj, stmt);
 		stmt = NULL;
 	} else if (obj->parent->logging) {
 		long execution_time = ast_tvdiff_ms(ast_tvnow(), start);
@@ -475,6 +526,94 @@ int ast_odbc_prepare(struct odbc_obj *obj, SQLHSTMT *stmt, const char *sql)
 	return SQLPrepare(stmt, (unsigned char *)sql, SQL_NTS);
 }
 
+SQLHSTMT ast_odbc_prepare_cached(struct odbc_obj *obj, const char *sql)
+{
+	struct odbc_statement *statement;
+	struct odbc_statement *evict = NULL;
+	SQLHSTMT stmt;
+	int res;
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&obj->statements, statement, list) {
+		if (statement->in_use) {
+			continue;
+		}
+		if (!strcmp(statement->sql, sql)) {
+			/* Most recently used first, so the least recently used is evicted */
+			AST_LIST_REMOVE_CURRENT(list);
+			break;
+		}
+		evict = statement;
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
+	if (statement) {
+		AST_LIST_INSERT_HEAD(&obj->statements, statement, list);
+		statement->in_use = 1;
+		if (obj->parent->logging) {
+			ast_free(obj->sql_text);
+			obj->sql_text = ast_strdup(sql);
+		}
+		ast_atomic_fetchadd_int(&obj->parent->statement_cache_hits, +1);
+		return statement->stmt;
+	}
+	ast_atomic_fetchadd_int(&obj->parent->statement_cache_misses, +1);
+
+	res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
+	if (!SQL_SUCCEEDED(res)) {
+		ast_log(LOG_WARNING, "SQL Alloc Handle failed on class '%s'!\n", obj->parent->name);
+		return NULL;
+	}
+
+	res = ast_odbc_prepare(obj, stmt, sql);
+	if (!SQL_SUCCEEDED(res)) {
+		if (res == SQL_ERROR) {
+			ast_odbc_print_errors(SQL_HANDLE_STMT, stmt, "SQL Prepare");
+		}
+		ast_log(LOG_WARNING, "SQL Prepare failed! [%s]\n", sql);
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return NULL;
+	}
+
+	if (obj->statement_cnt >= obj->parent->statement_cache_size && evict) {
+		AST_LIST_REMOVE(&obj->statements, evict, list);
+		--obj->statement_cnt;
+		SQLFreeHandle(SQL_HANDLE_STMT, evict->stmt);
+		ast_free(evict);
+	}
+
+	/* If every cached statement is in use this one is freed once released */
+	if (obj->statement_cnt < obj->parent->statement_cache_size
+		&& (statement = ast_malloc(sizeof(*statement) + strlen(sql) + 1))) {
+		statement->stmt = stmt;
+		statement->in_use = 1;
+		strcpy(statement->sql, sql); /* Safe */
+		AST_LIST_INSERT_HEAD(&obj->statements, statement, list);
+		++obj->statement_cnt;
+	}
+
+	return stmt;
+}
+
+void ast_odbc_release_statement(struct odbc_obj *obj, SQLHSTMT stmt)
+{
+	struct odbc_statement *statement;
+
+	AST_LIST_TRAVERSE(&obj->statements, statement, list) {
+		if (statement->stmt == stmt) {
+			break;
+		}
+	}
+
+	if (!statement) {
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return;
+	}
+
+	SQLFreeStmt(stmt, SQL_CLOSE);
+	SQLFreeStmt(stmt, SQL_RESET_PARAMS);
+	statement->in_use = 0;
+}
+
 SQLRETURN ast_odbc_execute_sql(struct odbc_obj *obj, SQLHSTMT *stmt, const char *sql)
 {
 	if (obj->parent->logging) {
@@ -569,6 +708,7 @@ static int load_odbc_config(void)
 	char *cat;
 	const char *dsn, *username, *password, *sanitysql;
 	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections, logging, slowquerylimit;
+	int statementcachesize;
 	struct timeval ncache = { 0, 0 };
 	int preconnect = 0, res = 0;
 	struct ast_flags config_flags = { 0 };
@@ -598,6 +738,7 @@ static int load_odbc_config(void)
 			maxconnections = 1;
 			logging = 0;
 			slowquerylimit = 5000;
+			statementcachesize = 16;
 			for (v = ast_variable_browse(config, cat); v; v = v->next) {
 				if (!strcasecmp(v->name, "pooling") ||
 						!strncasecmp(v->name, "share", 5) ||
@@ -653,6 +794,11 @@ static int load_odbc_config(void)
 						ast_log(LOG_WARNING, "slow_query_limit must be a positive integer\n");
 						slowquerylimit = 5000;
 					}
+				} else if (!strcasecmp(v->name, "statement_cache_size")) {
+					if (sscanf(v->value, "%30d", &statementcachesize) != 1 || statementcachesize < 0) {
+						ast_log(LOG_WARNING, "statement_cache_size must be a non-negative integer\n");
+						statementcachesize = 16;
+					}
 				}
 			}
 
@@ -681,6 +827,7 @@ static int load_odbc_config(void)
 				new->maxconnections = maxconnections;
 				new->logging = logging;
 				new->slowquerylimit = slowquerylimit;
+				new->statement_cache_size = statementcachesize;
 
 				if (cat)
 					ast_copy_string(new->name, cat, sizeof(new->name));
@@ -767,6 +914,21 @@ static char *handle_cli_odbc_show(struct ast_cli_entry *e, int cmd, struct ast_c
 			}
 
 			ast_cli(a->fd, "    Number of active connections: %zd (out of %d)\n", class->connection_cnt, class->maxconnections);
+			ast_mutex_lock(&class->lock);
+			ast_cli(a->fd, "    Number of connections in use: %zd\n", class->connections_in_use);
+			if (class->connection_requests) {
+				ast_cli(a->fd, "    Connection wait time: %lld microseconds average, %lld longest (%u requests)\n",
+					class->connection_wait_total / class->connection_requests,
+					class->connection_wait_longest, class->connection_requests);
+			}
+			ast_mutex_unlock(&class->lock);
+			if (class->statement_cache_hits + class->statement_cache_misses) {
+				ast_cli(a->fd, "    Statement cache: %d hits, %d misses (%.1f%% hit ratio, size %u)\n",
+					class->statement_cache_hits, class->statement_cache_misses,
+					100.0 * class->statement_cache_hits
+						/ (class->statement_cache_hits + class->statement_cache_misses),
+					class->statement_cache_size);
+			}
 			ast_cli(a->fd, "    Logging: %s\n", class->logging ? "Enabled" : "Disabled");
 			if (class->logging) {
 				ast_cli(a->fd, "    Number of prepares executed: %d\n", class->prepares_executed);
@@ -833,6 +995,7 @@ void ast_odbc_release_obj(struct odbc_obj *obj)
 
 	ast_mutex_lock(&class->lock);
 	AST_LIST_INSERT_HEAD(&class->connections, obj, list);
+	--class->connections_in_use;
 	ast_cond_signal(&class->cond);
 	ast_mutex_unlock(&class->lock);
 
@@ -918,6 +1081,8 @@ struct odbc_obj *_ast_odbc_request_obj2(const char *name, struct ast_flags flags
 {
 	struct odbc_obj *obj = NULL;
 	struct odbc_class *class;
+	struct timeval start = ast_tvnow();
+	long long waited;
 
 	if (!(class = ao2_callback(class_container, 0, aoro2_class_cb, (char *) name))) {
 		ast_debug(1, "Class '%s' not found!\n", name);
@@ -975,6 +1140,16 @@ struct odbc_obj *_ast_odbc_request_obj2(const char *name, struct ast_flags flags
 		}
 	}
 
+	if (obj) {
+		waited = ast_tvdiff_us(ast_tvnow(), start);
+		++class->connections_in_use;
+		++class->connection_requests;
+		class->connection_wait_total += waited;
+		if (waited > class->connection_wait_longest) {
+			class->connection_wait_longest = waited;
+		}
+	}
+
 	ast_mutex_unlock(&class->lock);
 	ao2_ref(class, -1);
 
@@ -262,6 +262,27 @@ static int parking_lot_sort_fn(const void *obj_left, const void *obj_right, int
 	return cmp;
 }
 
+/*! Buckets of the parking lot container, which may hold many dynamic lots */
+#define PARKING_LOT_BUCKETS 61
+
+static int parking_lot_hash_fn(const void *obj, const int flags)
+{
+	const struct parking_lot *lot;
+	const char *key;
+
+	switch (flags & (OBJ_POINTER | OBJ_KEY | OBJ_PARTIAL_KEY)) {
+	case OBJ_KEY:
+		key = obj;
+		return ast_str_hash(key);
+	case OBJ_PARTIAL_KEY:
+		ast_assert(0);
+		return 0;
+	default:
+		lot = obj;
+		return ast_str_hash(lot->name);
+	}
+}
+
 /*! All parking lots that are currently alive in some fashion can be obtained from here */
 static struct ao2_container *parking_lot_container;
 
@@ -631,6 +652,7 @@ static void parking_lot_destructor(void *obj)
 	}
 	ao2_cleanup(lot->parked_users);
 	ao2_cleanup(lot->cfg);
+	ast_free(lot->spaces_used);
 	ast_string_field_free_memory(lot);
 }
 
@@ -901,6 +923,11 @@ struct parking_lot *parking_lot_build_or_update(struct parking_lot_cfg *lot_cfg,
 
 	ao2_cleanup(replaced_cfg);
 
+	/* Spaces are looked for through the parked users until they are tracked for the configuration. */
+	if (parking_lot_spaces_update(lot)) {
+		ast_log(LOG_WARNING, "Could not track the spaces in use of parking lot '%s'\n", lot->name);
+	}
+
 	/* Set the operating mode to normal since the parking lot has a configuration. */
 	lot->disable_mark = 0;
 	lot->mode = dynamic ? PARKINGLOT_DYNAMIC : PARKINGLOT_NORMAL;
@@ -1207,8 +1234,10 @@ static int unload_module(void)
 
 static int load_module(void)
 {
-	parking_lot_container = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX,
+	parking_lot_container = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
 		AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT,
+		PARKING_LOT_BUCKETS,
+		parking_lot_hash_fn,
 		parking_lot_sort_fn,
 		NULL);
 	if (!parking_lot_container) {
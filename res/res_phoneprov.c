@@ -48,6 +48,7 @@
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <net/if.h>
 #ifdef SOLARIS
 #include <sys/sockio.h>
@@ -330,6 +331,9 @@ struct http_route {
 	struct user *user;	/*!< The user that has variables to substitute into the file
 						 * NULL in the case of a static route */
 	struct phone_profile *profile;
+	struct ast_str *rendered;	/*!< The file as last rendered for the user, NULL until requested */
+	time_t mtime;	/*!< Modification time of the template when rendered */
+	off_t size;	/*!< Size of the template when rendered */
 };
 struct ao2_container *http_routes;
 SIMPLE_HASH_FN(http_route_hash_fn, http_route, uri)
@@ -490,6 +494,7 @@ static void route_destructor(void *obj)
 {
 	struct http_route *route = obj;
 
+	ast_free(route->rendered);
 	ast_string_field_free_memory(route);
 }
 
@@ -865,14 +870,80 @@ static int build_user_routes(struct user *user)
 	return 0;
 }
 
+/*!
+ * \brief Render the template of a dynamic route into route->rendered
+ * \note The route must be locked.
+ */
+static int render_route(struct ast_tcptls_session_instance *ser, struct http_route *route, const char *path)
+{
+	struct ast_str *tmp;
+	char *file = NULL;
+	char *server;
+	int len;
+
+	len = load_file(path, &file);
+	if (len < 0) {
+		ast_log(LOG_WARNING, "Could not load file: %s (%d)\n", path, len);
+		if (file) {
+			ast_free(file);
+		}
+
+		return -1;
+	}
+
+	if (!file) {
+		return -1;
+	}
+
+	if (!(tmp = ast_str_create(len))) {
+		ast_free(file);
+
+		return -1;
+	}
+
+	/* Unless we are overridden by serveriface or serveraddr, we set the SERVER variable to
+	 * the IP address we are listening on that the phone contacted for this config file */
+
+	server = ast_var_find(AST_LIST_FIRST(&route->user->extensions)->headp,
+		variable_lookup[AST_PHONEPROV_STD_SERVER]);
+
+	if (!server) {
+		union {
+			struct sockaddr sa;
+			struct sockaddr_in sa_in;
+		} name;
+		socklen_t namelen = sizeof(name.sa);
+		int res;
+
+		if ((res = getsockname(ast_iostream_get_fd(ser->stream), &name.sa, &namelen))) {
+			ast_log(LOG_WARNING, "Could not get server IP, breakage likely.\n");
+		} else {
+			struct extension *exten_iter;
+			const char *newserver = ast_inet_ntoa(name.sa_in.sin_addr);
+
+			AST_LIST_TRAVERSE(&route->user->extensions, exten_iter, entry) {
+				AST_VAR_LIST_INSERT_TAIL(exten_iter->headp,
+					ast_var_assign(variable_lookup[AST_PHONEPROV_STD_SERVER], newserver));
+			}
+		}
+	}
+
+	ast_str_substitute_variables_varshead(&tmp, 0, AST_LIST_FIRST(&route->user->extensions)->headp, file);
+
+	ast_free(file);
+
+	ast_free(route->rendered);
+	route->rendered = tmp;
+
+	return 0;
+}
+
 /*! \brief Callback that is executed everytime an http request is received by this module */
 static int phoneprov_callback(struct ast_tcptls_session_instance *ser, const struct ast_http_uri *urih, const char *uri, enum ast_http_method method, struct ast_variable *get_vars, struct ast_variable *headers)
 {
 	struct http_route *route;
 	struct ast_str *result;
 	char path[PATH_MAX];
-	char *file = NULL;
-	char *server;
 	int len;
 	int fd;
 	struct ast_str *http_header;
@@ -913,77 +984,39 @@ static int phoneprov_callback(struct ast_tcptls_session_instance *ser, const str
 		route = unref_route(route);
 		return 0;
 	} else { /* Dynamic file */
-		struct ast_str *tmp;
+		struct stat st;
 
-		len = load_file(path, &file);
-		if (len < 0) {
-			ast_log(LOG_WARNING, "Could not load file: %s (%d)\n", path, len);
-			if (file) {
-				ast_free(file);
-			}
-
-			goto out500;
-		}
-
-		if (!file) {
+		ao2_lock(route);
+		if (stat(path, &st)) {
+			ast_log(LOG_WARNING, "Could not load file: %s (%s)\n", path, strerror(errno));
+			ao2_unlock(route);
 			goto out500;
 		}
 
-		if (!(tmp = ast_str_create(len))) {
-			if (file) {
-				ast_free(file);
+		/* The output is the same for every request of the route, until the
+		 * template changes or the user is rebuilt along with its routes */
+		if (!route->rendered || route->mtime != st.st_mtime || route->size != st.st_size) {
+			if (render_route(ser, route, path)) {
+				ao2_unlock(route);
+				goto out500;
 			}
-
-			goto out500;
+			route->mtime = st.st_mtime;
+			route->size = st.st_size;
 		}
 
-		/* Unless we are overridden by serveriface or serveraddr, we set the SERVER variable to
-		 * the IP address we are listening on that the phone contacted for this config file */
-
-		server = ast_var_find(AST_LIST_FIRST(&route->user->extensions)->headp,
-			variable_lookup[AST_PHONEPROV_STD_SERVER]);
-
-		if (!server) {
-			union {
-				struct sockaddr sa;
-				struct sockaddr_in sa_in;
-			} name;
-			socklen_t namelen = sizeof(name.sa);
-			int res;
-
-			if ((res = getsockname(ast_iostream_get_fd(ser->stream), &name.sa, &namelen))) {
-				ast_log(LOG_WARNING, "Could not get server IP, breakage likely.\n");
-			} else {
-				struct extension *exten_iter;
-				const char *newserver = ast_inet_ntoa(name.sa_in.sin_addr);
-
-				AST_LIST_TRAVERSE(&route->user->extensions, exten_iter, entry) {
-					AST_VAR_LIST_INSERT_TAIL(exten_iter->headp,
-						ast_var_assign(variable_lookup[AST_PHONEPROV_STD_SERVER], newserver));
-				}
-			}
+		if (!(result = ast_str_create(ast_str_strlen(route->rendered) + 1))) {
+			ast_log(LOG_ERROR, "Could not create result string!\n");
+			ao2_unlock(route);
+			goto out500;
 		}
-
-		ast_str_substitute_variables_varshead(&tmp, 0, AST_LIST_FIRST(&route->user->extensions)->headp, file);
-
-		ast_free(file);
+		ast_str_append(&result, 0, "%s", ast_str_buffer(route->rendered));
+		ao2_unlock(route);
 
 		http_header = ast_str_create(80);
 		ast_str_set(&http_header, 0, "Content-type: %s\r\n",
 			route->file->mime_type);
 
-		if (!(result = ast_str_create(512))) {
-			ast_log(LOG_ERROR, "Could not create result string!\n");
-			if (tmp) {
-				ast_free(tmp);
-			}
-			ast_free(http_header);
-			goto out500;
-		}
-		ast_str_append(&result, 0, "%s", ast_str_buffer(tmp));
-
 		ast_http_send(ser, method, 200, NULL, http_header, result, 0, 0);
-		ast_free(tmp);
 
 		route = unref_route(route);
 
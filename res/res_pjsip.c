@@ -1082,6 +1082,15 @@
 						<para>dtls_setup=actpass</para>
 					</description>
 				</configOption>
+				<configOption name="rtcp_publish" default="yes">
+					<synopsis>Publish the RTCP reports of the media streams</synopsis>
+					<description><para>
+						When disabled, the RTCP reports sent and received on the media streams
+						of this endpoint are not published, so no RTCPSent or RTCPReceived
+						event is raised for them. The reports are still exchanged with the
+						remote party.
+					</para></description>
+				</configOption>
 				<configOption name="incoming_mwi_mailbox">
 					<synopsis>Mailbox name to use when incoming MWI NOTIFYs are received</synopsis>
 					<description><para>
@@ -1245,6 +1254,20 @@
 				<configOption name="async_operations" default="1">
 					<synopsis>Number of simultaneous Asynchronous Operations</synopsis>
 				</configOption>
+				<configOption name="udp_sockets" default="1">
+					<synopsis>Number of sockets receiving on the address of the transport (UDP ONLY)</synopsis>
+					<description>
+						<para>When greater than 1, this many UDP sockets are bound to the
+						address of the transport with <literal>SO_REUSEPORT</literal>.
+						The operating system spreads the incoming messages over them by
+						their source address, and as many threads handle the SIP events
+						so messages from several peers are received and parsed at the
+						same time.  Messages of a dialog are still handled in order
+						regardless of the socket they arrive on.</para>
+						<para>The value can be at most 32.  It is ignored where
+						<literal>SO_REUSEPORT</literal> is not supported.</para>
+					</description>
+				</configOption>
 				<configOption name="bind">
 					<synopsis>IP Address and optional port to bind to for this transport</synopsis>
 				</configOption>
@@ -1791,6 +1814,21 @@
 					<synopsis>The interval at which unidentified requests are older than
 					twice the unidentified_request_period are pruned.</synopsis>
 				</configOption>
+				<configOption name="unidentified_request_reject" default="no">
+					<synopsis>Drop the requests of a source sending unidentified requests too fast.</synopsis>
+					<description><para>
+					Each source IP address may send <literal>unidentified_request_count</literal>
+					unidentified requests per <literal>unidentified_request_period</literal>, and
+					any number of requests for which an endpoint is identified. When enabled,
+					requests outside of a dialog from a source over that rate are dropped
+					without a response, before trying to identify their endpoint, until the
+					rate allows another. The rate is kept in a table of fixed size, so that
+					a flood from many addresses uses no more memory.
+					</para><para>
+					Unlike the security events, this does not depend on
+					<literal>auth_username</literal> being in <literal>endpoint_identifier_order</literal>.
+					</para></description>
+				</configOption>
 				<configOption name="type">
 					<synopsis>Must be of type 'global' UNLESS the object name is 'global'.</synopsis>
 				</configOption>
@@ -1942,6 +1980,20 @@
 				<configOption name="norefersub" default="yes">
 					<synopsis>Advertise support for RFC4488 REFER subscription suppression</synopsis>
 				</configOption>
+				<configOption name="notification_coalesce_interval" default="0">
+					<synopsis>The least time (in milliseconds) between the NOTIFYs of a subscription</synopsis>
+					<description><para>
+						When the state of a subscribed resource changes again less than this
+						long after a NOTIFY was sent, the next NOTIFY is held back until the
+						interval has passed and then reports only the latest state.  This keeps
+						flapping states, such as those of a busy extension watched by many
+						subscribers, from producing a NOTIFY for every change.  The first change
+						after a quiet period is still sent at once.  It does not apply to
+						subscriptions to resource lists, which use the
+						<literal>notification_batch_interval</literal> of the list instead.
+						A value of 0 sends a NOTIFY for every change.
+					</para></description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -4766,6 +4818,11 @@ pj_pool_t *memory_pool;
 pj_thread_t *monitor_thread;
 static int monitor_continue;
 
+/*! Threads handling events in addition to the monitor thread */
+static pj_thread_t *monitor_threads[AST_SIP_TRANSPORT_MAX_UDP_SOCKETS - 1];
+static unsigned int monitor_threads_count;
+AST_MUTEX_DEFINE_STATIC(monitor_threads_lock);
+
 static void *monitor_thread_exec(void *endpt)
 {
 	while (monitor_continue) {
@@ -4777,8 +4834,17 @@ static void *monitor_thread_exec(void *endpt)
 
 static void stop_monitor_thread(void)
 {
+	unsigned int i;
+
 	monitor_continue = 0;
 	pj_thread_join(monitor_thread);
+
+	ast_mutex_lock(&monitor_threads_lock);
+	for (i = 0; i < monitor_threads_count; ++i) {
+		pj_thread_join(monitor_threads[i]);
+	}
+	monitor_threads_count = 0;
+	ast_mutex_unlock(&monitor_threads_lock);
 }
 
 AST_THREADSTORAGE(pj_thread_storage);
@@ -4810,6 +4876,39 @@ static void sip_thread_start(void)
 	}
 }
 
+static void *extra_monitor_thread_exec(void *endpt)
+{
+	uint32_t *servant_id;
+
+	servant_id = ast_threadstorage_get(&servant_id_storage, sizeof(*servant_id));
+	if (servant_id) {
+		*servant_id = SIP_SERVANT_ID;
+	}
+
+	return monitor_thread_exec(endpt);
+}
+
+int ast_sip_monitor_threads_ensure(unsigned int count)
+{
+	int res = 0;
+
+	ast_mutex_lock(&monitor_threads_lock);
+	while (monitor_continue && monitor_threads_count + 1 < count
+		&& monitor_threads_count < ARRAY_LEN(monitor_threads)) {
+		if (pj_thread_create(memory_pool, "SIP", (pj_thread_proc *) &extra_monitor_thread_exec,
+			NULL, PJ_THREAD_DEFAULT_STACK_SIZE * 2, 0,
+			&monitor_threads[monitor_threads_count]) != PJ_SUCCESS) {
+			ast_log(LOG_ERROR, "Failed to start additional SIP monitor thread\n");
+			res = -1;
+			break;
+		}
+		++monitor_threads_count;
+	}
+	ast_mutex_unlock(&monitor_threads_lock);
+
+	return res;
+}
+
 int ast_sip_thread_is_servant(void)
 {
 	uint32_t *servant_id;
@@ -53,6 +53,8 @@
 #define DEFAULT_SEND_CONTACT_STATUS_ON_UPDATE_REGISTRATION 0
 #define DEFAULT_TASKPROCESSOR_OVERLOAD_TRIGGER TASKPROCESSOR_OVERLOAD_TRIGGER_GLOBAL
 #define DEFAULT_NOREFERSUB 1
+#define DEFAULT_NOTIFICATION_COALESCE_INTERVAL 0
+#define DEFAULT_UNIDENTIFIED_REQUEST_REJECT 0
 
 /*!
  * \brief Cached global config object
@@ -98,6 +100,8 @@ struct global_config {
 	unsigned int unidentified_request_period;
 	/*! Interval at which expired unidentifed requests will be pruned */
 	unsigned int unidentified_request_prune_interval;
+	/*! Nonzero to drop requests from sources over the unidentified request rate */
+	unsigned int unidentified_request_reject;
 	struct {
 		/*! Taskprocessor high water alert trigger level */
 		unsigned int tps_queue_high;
@@ -116,6 +120,8 @@ struct global_config {
 	enum ast_sip_taskprocessor_overload_trigger overload_trigger;
 	/*! Nonzero if norefersub is to be sent in Supported header */
 	unsigned int norefersub;
+	/*! The least time between the NOTIFYs of a subscription not to a list */
+	unsigned int notification_coalesce_interval;
 };
 
 static void global_destructor(void *obj)
@@ -519,6 +525,36 @@ unsigned int ast_sip_get_norefersub(void)
 	return norefersub;
 }
 
+unsigned int ast_sip_get_unidentified_request_reject(void)
+{
+	unsigned int reject;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_UNIDENTIFIED_REQUEST_REJECT;
+	}
+
+	reject = cfg->unidentified_request_reject;
+	ao2_ref(cfg, -1);
+	return reject;
+}
+
+unsigned int ast_sip_get_notification_coalesce_interval(void)
+{
+	unsigned int interval;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_NOTIFICATION_COALESCE_INTERVAL;
+	}
+
+	interval = cfg->notification_coalesce_interval;
+	ao2_ref(cfg, -1);
+	return interval;
+}
+
 static int overload_trigger_handler(const struct aco_option *opt,
 	struct ast_variable *var, void *obj)
 {
@@ -699,6 +735,9 @@ int ast_sip_initialize_sorcery_global(void)
 	ast_sorcery_object_field_register(sorcery, "global", "unidentified_request_prune_interval",
 		__stringify(DEFAULT_UNIDENTIFIED_REQUEST_PRUNE_INTERVAL),
 		OPT_UINT_T, 0, FLDSET(struct global_config, unidentified_request_prune_interval));
+	ast_sorcery_object_field_register(sorcery, "global", "unidentified_request_reject",
+		DEFAULT_UNIDENTIFIED_REQUEST_REJECT ? "yes" : "no",
+		OPT_YESNO_T, 1, FLDSET(struct global_config, unidentified_request_reject));
 	ast_sorcery_object_field_register(sorcery, "global", "default_realm", DEFAULT_REALM,
 		OPT_STRINGFIELD_T, 0, STRFLDSET(struct global_config, default_realm));
 	ast_sorcery_object_field_register(sorcery, "global", "mwi_tps_queue_high",
@@ -725,6 +764,9 @@ int ast_sip_initialize_sorcery_global(void)
 	ast_sorcery_object_field_register(sorcery, "global", "norefersub",
 		DEFAULT_NOREFERSUB ? "yes" : "no",
 		OPT_YESNO_T, 1, FLDSET(struct global_config, norefersub));
+	ast_sorcery_object_field_register(sorcery, "global", "notification_coalesce_interval",
+		__stringify(DEFAULT_NOTIFICATION_COALESCE_INTERVAL),
+		OPT_UINT_T, 0, FLDSET(struct global_config, notification_coalesce_interval));
 
 	if (ast_sorcery_instance_observer_add(sorcery, &observer_callbacks_global)) {
 		return -1;
@@ -412,6 +412,39 @@ static void *sip_transport_alloc(const char *name)
 	return transport;
 }
 
+/*!
+ * \internal
+ * \brief Shut down the additional receiving transports of a UDP transport
+ */
+static void transport_udp_receivers_shutdown(struct ast_sip_transport_state *state)
+{
+	unsigned int i;
+
+	for (i = 0; i < state->receivers_count; ++i) {
+		pjsip_transport_shutdown(state->receivers[i]);
+	}
+	ast_free(state->receivers);
+	state->receivers = NULL;
+	state->receivers_count = 0;
+}
+
+int ast_sip_transport_state_has_transport(const struct ast_sip_transport_state *transport_state,
+	const pjsip_transport *transport)
+{
+	unsigned int i;
+
+	if (transport_state->transport == transport) {
+		return 1;
+	}
+	for (i = 0; i < transport_state->receivers_count; ++i) {
+		if (transport_state->receivers[i] == transport) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static int destroy_sip_transport_state(void *data)
 {
 	struct ast_sip_transport_state *transport_state = data;
@@ -428,6 +461,7 @@ static int destroy_sip_transport_state(void *data)
 	if (transport_state->transport) {
 		pjsip_transport_shutdown(transport_state->transport);
 	}
+	transport_udp_receivers_shutdown(transport_state);
 
 	return 0;
 }
@@ -628,6 +662,91 @@ static void states_cleanup(void *states)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Start a UDP transport receiving on several sockets bound to its address
+ *
+ * The first socket becomes the transport of the state, the others its
+ * receivers.  They all publish the same address, so it does not matter
+ * which one a message is received on or sent from.
+ */
+static pj_status_t transport_udp_sockets_start(struct ast_sip_transport *transport,
+	struct ast_sip_transport_state *state)
+{
+#ifdef SO_REUSEPORT
+	int af = state->host.addr.sa_family;
+	pjsip_transport_type_e type = af == pj_AF_INET6() ? PJSIP_TRANSPORT_UDP6 : PJSIP_TRANSPORT_UDP;
+	char host[PJ_INET6_ADDRSTRLEN];
+	pjsip_host_port addr_name = { { NULL, 0 }, 0 };
+	pj_status_t res = PJ_SUCCESS;
+	unsigned int i;
+
+	state->receivers = ast_calloc(transport->udp_sockets - 1, sizeof(*state->receivers));
+	if (!state->receivers) {
+		return PJ_ENOMEM;
+	}
+
+	for (i = 0; i < transport->udp_sockets; ++i) {
+		pjsip_transport **dest = i ? &state->receivers[i - 1] : &state->transport;
+		pj_sock_t sock;
+		int on = 1;
+
+		res = pj_sock_socket(af, pj_SOCK_DGRAM(), 0, &sock);
+		if (res != PJ_SUCCESS) {
+			break;
+		}
+
+		res = pj_sock_setsockopt(sock, pj_SOL_SOCKET(), SO_REUSEPORT, &on, sizeof(on));
+		if (res == PJ_SUCCESS) {
+			res = pj_sock_bind(sock, &state->host, pj_sockaddr_get_len(&state->host));
+		}
+		if (res == PJ_SUCCESS && !i) {
+			pj_sockaddr bound;
+			int len = sizeof(bound);
+
+			/* Publish the address as pjsip_udp_transport_start() would */
+			res = pj_sock_getsockname(sock, &bound, &len);
+			if (res == PJ_SUCCESS && !pj_sockaddr_has_addr(&bound)) {
+				pj_sockaddr hostip;
+
+				res = pj_gethostip(af, &hostip);
+				if (res == PJ_SUCCESS) {
+					pj_sockaddr_copy_addr(&bound, &hostip);
+				}
+			}
+			if (res == PJ_SUCCESS) {
+				pj_sockaddr_print(&bound, host, sizeof(host), 0);
+				addr_name.host = pj_str(host);
+				addr_name.port = pj_sockaddr_get_port(&bound);
+			}
+		}
+		if (res == PJ_SUCCESS) {
+			res = pjsip_udp_transport_attach2(ast_sip_get_pjsip_endpoint(), type, sock,
+				&addr_name, transport->async_operations, dest);
+		}
+		if (res != PJ_SUCCESS) {
+			pj_sock_close(sock);
+			break;
+		}
+		if (i) {
+			++state->receivers_count;
+		}
+	}
+
+	if (res != PJ_SUCCESS) {
+		if (state->transport) {
+			pjsip_transport_shutdown(state->transport);
+			state->transport = NULL;
+		}
+		transport_udp_receivers_shutdown(state);
+	}
+
+	return res;
+#else
+	return PJ_ENOTSUP;
+#endif
+}
+
 /*! \brief Apply handler for transports */
 static int transport_apply(const struct ast_sorcery *sorcery, void *obj)
 {
@@ -740,15 +859,30 @@ static int transport_apply(const struct ast_sorcery *sorcery, void *obj)
 		temp_state->state->flow = 1;
 		res = PJ_SUCCESS;
 	} else if (transport->type == AST_TRANSPORT_UDP) {
+		unsigned int receiver;
+
+#ifndef SO_REUSEPORT
+		if (transport->udp_sockets > 1) {
+			ast_log(LOG_WARNING, "Transport '%s' can only receive on one socket as SO_REUSEPORT is not supported\n",
+				transport_id);
+			transport->udp_sockets = 1;
+		}
+#endif
 
 		for (i = 0; i < BIND_TRIES && res != PJ_SUCCESS; i++) {
 			if (perm_state && perm_state->state && perm_state->state->transport) {
 				pjsip_udp_transport_pause(perm_state->state->transport,
 					PJSIP_UDP_TRANSPORT_DESTROY_SOCKET);
+				for (receiver = 0; receiver < perm_state->state->receivers_count; ++receiver) {
+					pjsip_udp_transport_pause(perm_state->state->receivers[receiver],
+						PJSIP_UDP_TRANSPORT_DESTROY_SOCKET);
+				}
 				usleep(BIND_DELAY_US);
 			}
 
-			if (temp_state->state->host.addr.sa_family == pj_AF_INET()) {
+			if (transport->udp_sockets > 1) {
+				res = transport_udp_sockets_start(transport, temp_state->state);
+			} else if (temp_state->state->host.addr.sa_family == pj_AF_INET()) {
 				res = pjsip_udp_transport_start(ast_sip_get_pjsip_endpoint(),
 					&temp_state->state->host.ipv4, NULL, transport->async_operations,
 					&temp_state->state->transport);
@@ -759,21 +893,29 @@ static int transport_apply(const struct ast_sorcery *sorcery, void *obj)
 			}
 		}
 
-		if (res == PJ_SUCCESS) {
-			temp_state->state->transport->info = pj_pool_alloc(temp_state->state->transport->pool,
-				(AST_SIP_X_AST_TXP_LEN + strlen(transport_id) + 2));
+		for (receiver = 0; res == PJ_SUCCESS && receiver <= temp_state->state->receivers_count; ++receiver) {
+			pjsip_transport *udp = receiver ? temp_state->state->receivers[receiver - 1]
+				: temp_state->state->transport;
 
-			sprintf(temp_state->state->transport->info, "%s:%s", AST_SIP_X_AST_TXP, transport_id);
+			udp->info = pj_pool_alloc(udp->pool, (AST_SIP_X_AST_TXP_LEN + strlen(transport_id) + 2));
+
+			sprintf(udp->info, "%s:%s", AST_SIP_X_AST_TXP, transport_id);
 
 			if (transport->tos || transport->cos) {
 				pj_sock_t sock;
 				pj_qos_params qos_params;
-				sock = pjsip_udp_transport_get_socket(temp_state->state->transport);
+				sock = pjsip_udp_transport_get_socket(udp);
 				pj_sock_get_qos_params(sock, &qos_params);
 				set_qos(transport, &qos_params);
 				pj_sock_set_qos_params(sock, &qos_params);
 			}
 		}
+
+		if (res == PJ_SUCCESS && temp_state->state->receivers_count
+			&& ast_sip_monitor_threads_ensure(temp_state->state->receivers_count + 1)) {
+			ast_log(LOG_WARNING, "Transport '%s' has fewer threads than sockets receiving\n",
+				transport_id);
+		}
 	} else if (transport->type == AST_TRANSPORT_TCP) {
 		pjsip_tcp_transport_cfg cfg;
 		static int option = 1;
@@ -1616,6 +1758,7 @@ int ast_sip_initialize_sorcery_transport(void)
 	ast_sorcery_object_field_register_custom(sorcery, "transport", "protocol", "udp", transport_protocol_handler, transport_protocol_to_str, NULL, 0, 0);
 	ast_sorcery_object_field_register_custom(sorcery, "transport", "bind", "", transport_bind_handler, transport_bind_to_str, NULL, 0, 0);
 	ast_sorcery_object_field_register(sorcery, "transport", "async_operations", "1", OPT_UINT_T, 0, FLDSET(struct ast_sip_transport, async_operations));
+	ast_sorcery_object_field_register(sorcery, "transport", "udp_sockets", "1", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_sip_transport, udp_sockets), 1, AST_SIP_TRANSPORT_MAX_UDP_SOCKETS);
 
 	ast_sorcery_object_field_register_custom(sorcery, "transport", "ca_list_file", "", transport_tls_file_handler, ca_list_file_to_str, NULL, 0, 0);
 	ast_sorcery_object_field_register_custom(sorcery, "transport", "ca_list_path", "", transport_tls_file_handler, ca_list_path_to_str, NULL, 0, 0);
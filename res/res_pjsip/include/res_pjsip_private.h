@@ -175,6 +175,20 @@ int ast_sip_initialize_sorcery_global(void);
  */
 int ast_sip_destroy_sorcery_global(void);
 
+/*!
+ * \internal
+ * \brief Make sure enough threads are handling pjsip events
+ * \since 18.0.0
+ *
+ * Threads are only ever added, they all stop when res_pjsip is unloaded.
+ *
+ * \param count How many threads there should be at least
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int ast_sip_monitor_threads_ensure(unsigned int count);
+
 /*!
  * \internal
  * \brief Initialize global headers support
@@ -26,6 +26,7 @@
 #include "asterisk/taskprocessor.h"
 #include "asterisk/threadpool.h"
 #include "asterisk/res_pjsip_cli.h"
+#include "asterisk/trace_span.h"
 
 static int distribute(void *data);
 static pj_bool_t distributor(pjsip_rx_data *rdata);
@@ -44,12 +45,18 @@ struct ast_sched_context *prune_context;
 /* From the auth/realm realtime column size */
 #define MAX_REALM_LENGTH 40
 
-#define DEFAULT_SUSPECTS_BUCKETS 53
+#define DEFAULT_SUSPECTS_BUCKETS 1021
+
+/*! Rows of the unidentified request rate table, each hashing a source differently */
+#define UNIDENTIFIED_RATE_ROWS 2
+/*! Cells in each row of the unidentified request rate table */
+#define UNIDENTIFIED_RATE_CELLS 8192
 
 static struct ao2_container *unidentified_requests;
 static unsigned int unidentified_count;
 static unsigned int unidentified_period;
 static unsigned int unidentified_prune_interval;
+static unsigned int unidentified_reject;
 static int using_auth_username;
 static enum ast_sip_taskprocessor_overload_trigger overload_trigger;
 
@@ -59,11 +66,91 @@ struct unidentified_request{
 	char src_name[];
 };
 
+/*!
+ * \brief A bucket of the unidentified requests of the sources hashing to it
+ *
+ * The level is how many requests are in the bucket, which drains at
+ * unidentified_count per unidentified_period.  A source whose buckets in
+ * every row are full is over the rate, while a source sharing only some of
+ * its buckets with one over the rate is not.
+ */
+struct unidentified_rate_cell {
+	/*! Requests in the bucket */
+	double level;
+	/*! When the bucket last drained, in ms */
+	int64_t updated;
+};
+
+static struct unidentified_rate_cell unidentified_rate[UNIDENTIFIED_RATE_ROWS][UNIDENTIFIED_RATE_CELLS];
+static unsigned int unidentified_rate_seed[UNIDENTIFIED_RATE_ROWS];
+AST_MUTEX_DEFINE_STATIC(unidentified_rate_lock);
+
 /*! Number of serializers in pool if one not otherwise known.  (Best if prime number) */
 #define DISTRIBUTOR_POOL_SIZE		31
 
+/*! Most serializers the pool grows to under load. */
+#define DISTRIBUTOR_POOL_MAX		128
+
+/*! Points each serializer owns on the hash ring. */
+#define DISTRIBUTOR_RING_VNODES		64
+
+/*!
+ * \brief Queued tasks on the chosen serializer that grow the pool.
+ *
+ * Well below the taskprocessor high water alert, so the pool grows before
+ * the overload alert starts deferring new requests.
+ */
+#define DISTRIBUTOR_GROW_LEVEL		(AST_TASKPROCESSOR_HIGH_WATER_LEVEL / 10)
+
+/*! A serializer's point on the hash ring. */
+struct distributor_vnode {
+	/*! Hash values up to and including this point map to the serializer */
+	unsigned int point;
+	/*! Index of the serializer in the pool */
+	unsigned int serializer;
+};
+
+/*!
+ * \brief Consistent hash ring of the distributor pool serializers.
+ *
+ * Only the handovers of a ring change once it is published.  Growing the
+ * pool publishes a new ring with one more serializer, which takes over only
+ * the part of the hash space covered by its own points.  Each serializer
+ * losing some of it keeps its part until the requests it already has queued
+ * are done, so the requests of a dialog stay in order.
+ */
+struct distributor_ring {
+	/*! Number of serializers in the pool */
+	unsigned int size;
+	/*! Serializers yet to hand their hash values over to the newest one */
+	int handovers;
+	/*! Serializers of the pool, in the order they were created */
+	struct ast_taskprocessor *serializers[DISTRIBUTOR_POOL_MAX];
+	/*! Whether each serializer still has hash values to hand over */
+	int handover[DISTRIBUTOR_POOL_MAX];
+	/*! Points of the serializers, sorted */
+	struct distributor_vnode vnodes[DISTRIBUTOR_POOL_MAX * DISTRIBUTOR_RING_VNODES];
+};
+
+/*! A serializer handing its hash values over to the newest one. */
+struct distributor_handover {
+	/*! The ring the newest serializer was added by */
+	struct distributor_ring *ring;
+	/*! Index of the serializer in the pool */
+	unsigned int serializer;
+};
+
 /*! Pool of serializers to use if not supplied. */
-static struct ast_taskprocessor *distributor_pool[DISTRIBUTOR_POOL_SIZE];
+static AO2_GLOBAL_OBJ_STATIC(distributor_pool);
+
+/*! Requests distributed to each serializer of the pool. */
+static unsigned int distributor_requests[DISTRIBUTOR_POOL_MAX];
+
+/*! Serializes growing the pool. */
+AST_MUTEX_DEFINE_STATIC(distributor_grow_lock);
+
+/*! When the pool last grew. */
+static time_t distributor_grown;
 
 /*!
  * \internal
@@ -445,11 +532,266 @@ static int pjstr_hash(pj_str_t *str)
 	return pjstr_hash_add(str, 5381);
 }
 
+/*!
+ * \internal
+ * \brief Spread the bits of a hash value over the hash ring.
+ *
+ * The MurmurHash3 finalizer.
+ */
+static unsigned int distributor_ring_mix(unsigned int hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/*!
+ * \internal
+ * \brief Find the vnode a hash value maps to.
+ *
+ * \return Index of the first vnode at or after the hash, wrapping around.
+ */
+static unsigned int distributor_ring_find(const struct distributor_ring *ring, unsigned int hash)
+{
+	unsigned int low = 0;
+	unsigned int high = ring->size * DISTRIBUTOR_RING_VNODES;
+
+	while (low < high) {
+		unsigned int mid = low + (high - low) / 2;
+
+		if (ring->vnodes[mid].point < hash) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low < ring->size * DISTRIBUTOR_RING_VNODES ? low : 0;
+}
+
+/*!
+ * \internal
+ * \brief Find the serializer a vnode of the newest serializer took hash values from.
+ *
+ * \return Index of the serializer of the next vnode not of the newest one.
+ */
+static unsigned int distributor_ring_prev_owner(const struct distributor_ring *ring, unsigned int vnode)
+{
+	unsigned int vnodes = ring->size * DISTRIBUTOR_RING_VNODES;
+
+	while (ring->vnodes[vnode].serializer == ring->size - 1) {
+		vnode = (vnode + 1) % vnodes;
+	}
+	return ring->vnodes[vnode].serializer;
+}
+
+static int distributor_vnode_cmp(const void *left, const void *right)
+{
+	const struct distributor_vnode *vnode_left = left;
+	const struct distributor_vnode *vnode_right = right;
+
+	if (vnode_left->point != vnode_right->point) {
+		return vnode_left->point < vnode_right->point ? -1 : 1;
+	}
+	return vnode_left->serializer < vnode_right->serializer ? -1 : 1;
+}
+
+static void distributor_ring_dtor(void *obj)
+{
+	struct distributor_ring *ring = obj;
+	unsigned int idx;
+
+	for (idx = 0; idx < ring->size; ++idx) {
+		ast_taskprocessor_unreference(ring->serializers[idx]);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Create a hash ring of the distributor pool.
+ *
+ * \param prev Ring whose serializers are kept. (NULL if none)
+ * \param size Number of serializers in the new ring.
+ *
+ * \retval ring on success.
+ * \retval NULL on error.
+ */
+static struct distributor_ring *distributor_ring_alloc(const struct distributor_ring *prev,
+	unsigned int size)
+{
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	struct distributor_ring *ring;
+	unsigned int idx;
+	unsigned int vnode;
+
+	ring = ao2_alloc_options(sizeof(*ring), distributor_ring_dtor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!ring) {
+		return NULL;
+	}
+
+	for (; prev && ring->size < prev->size; ++ring->size) {
+		ring->serializers[ring->size] = ao2_bump(prev->serializers[ring->size]);
+	}
+	for (; ring->size < size; ++ring->size) {
+		/* Create name with seq number appended. */
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/distributor");
+
+		ring->serializers[ring->size] = ast_sip_create_serializer(tps_name);
+		if (!ring->serializers[ring->size]) {
+			ao2_ref(ring, -1);
+			return NULL;
+		}
+	}
+
+	/* The points of a serializer only depend on its name so they never move */
+	for (idx = 0; idx < ring->size; ++idx) {
+		unsigned int hash = ast_str_hash(ast_taskprocessor_name(ring->serializers[idx]));
+
+		for (vnode = 0; vnode < DISTRIBUTOR_RING_VNODES; ++vnode) {
+			struct distributor_vnode *point = &ring->vnodes[idx * DISTRIBUTOR_RING_VNODES + vnode];
+
+			point->point = distributor_ring_mix(hash + vnode * 0x9e3779b9);
+			point->serializer = idx;
+		}
+	}
+	qsort(ring->vnodes, ring->size * DISTRIBUTOR_RING_VNODES, sizeof(ring->vnodes[0]),
+		distributor_vnode_cmp);
+
+	if (!prev || ring->size == 1) {
+		return ring;
+	}
+
+	/* The serializers the newest one takes hash values from */
+	for (idx = 0; idx < ring->size * DISTRIBUTOR_RING_VNODES; ++idx) {
+		if (ring->vnodes[idx].serializer == ring->size - 1) {
+			unsigned int owner = distributor_ring_prev_owner(ring, idx);
+
+			if (!ring->handover[owner]) {
+				ring->handover[owner] = 1;
+				++ring->handovers;
+			}
+		}
+	}
+
+	return ring;
+}
+
+/*!
+ * \internal
+ * \brief Hand the hash values of a serializer over once it caught up.
+ *
+ * Runs on the serializer losing the hash values.  The requests queued before
+ * it are done, but if more came in meanwhile it goes to the back again.
+ */
+static int distributor_handover_task(void *data)
+{
+	struct distributor_handover *handover = data;
+	struct distributor_ring *ring = handover->ring;
+
+	if (ast_taskprocessor_size(ring->serializers[handover->serializer])
+		&& !ast_sip_push_task(ring->serializers[handover->serializer],
+			distributor_handover_task, handover)) {
+		return 0;
+	}
+
+	ring->handover[handover->serializer] = 0;
+	ast_atomic_fetchadd_int(&ring->handovers, -1);
+	ao2_ref(ring, -1);
+	ast_free(handover);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Start handing the hash values of the serializers over to the newest one.
+ */
+static void distributor_ring_handover(struct distributor_ring *ring)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < ring->size - 1; ++idx) {
+		struct distributor_handover *handover;
+
+		if (!ring->handover[idx]) {
+			continue;
+		}
+
+		handover = ast_malloc(sizeof(*handover));
+		if (handover) {
+			handover->ring = ao2_bump(ring);
+			handover->serializer = idx;
+			if (!ast_sip_push_task(ring->serializers[idx], distributor_handover_task, handover)) {
+				continue;
+			}
+			ao2_ref(ring, -1);
+			ast_free(handover);
+		}
+
+		/* Nothing to wait for it with, so hand over right away */
+		ring->handover[idx] = 0;
+		ast_atomic_fetchadd_int(&ring->handovers, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Add a serializer to the distributor pool.
+ *
+ * Called when a serializer of the pool has a backlog.  The pool grows by at
+ * most one serializer a second, until DISTRIBUTOR_POOL_MAX, and not before
+ * the last one has been handed its hash values.  From then on the
+ * taskprocessor overload alert is left to push back on new requests.
+ *
+ * \param ring The ring the backlogged serializer was picked from.
+ */
+static void distributor_pool_grow(struct distributor_ring *ring)
+{
+	struct distributor_ring *current;
+	struct distributor_ring *grown;
+	time_t now;
+
+	if (ring->size == DISTRIBUTOR_POOL_MAX) {
+		return;
+	}
+
+	/* Do not hold up the transport thread if another one is already at it. */
+	if (ast_mutex_trylock(&distributor_grow_lock)) {
+		return;
+	}
+
+	now = time(NULL);
+	current = ao2_global_obj_ref(distributor_pool);
+	if (current != ring || now == distributor_grown || current->handovers) {
+		ao2_cleanup(current);
+		ast_mutex_unlock(&distributor_grow_lock);
+		return;
+	}
+
+	grown = distributor_ring_alloc(current, current->size + 1);
+	if (grown) {
+		ao2_global_obj_replace_unref(distributor_pool, grown);
+		distributor_ring_handover(grown);
+		distributor_grown = now;
+		ast_verb(3, "Grew the PJSIP distributor pool to %u serializers, adding %s\n",
+			grown->size, ast_taskprocessor_name(grown->serializers[grown->size - 1]));
+		ao2_ref(grown, -1);
+	}
+	ao2_ref(current, -1);
+
+	ast_mutex_unlock(&distributor_grow_lock);
+}
+
 struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdata)
 {
 	int hash;
 	pj_str_t *remote_tag;
+	struct distributor_ring *ring;
 	struct ast_taskprocessor *serializer;
+	unsigned int vnode;
+	unsigned int idx;
 
 	if (!rdata->msg_info.msg) {
 		return NULL;
@@ -466,14 +808,140 @@ struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdat
 	hash = pjstr_hash_add(remote_tag, hash);
 	hash = ast_str_hash_restrict(hash);
 
-	serializer = ao2_bump(distributor_pool[hash % ARRAY_LEN(distributor_pool)]);
-	if (serializer) {
-		ast_debug(3, "Calculated serializer %s to use for %s\n",
-			ast_taskprocessor_name(serializer), pjsip_rx_data_get_info(rdata));
+	ring = ao2_global_obj_ref(distributor_pool);
+	if (!ring) {
+		return NULL;
 	}
+
+	vnode = distributor_ring_find(ring, distributor_ring_mix(hash));
+	idx = ring->vnodes[vnode].serializer;
+	if (idx == ring->size - 1 && ring->handovers) {
+		unsigned int owner = distributor_ring_prev_owner(ring, vnode);
+
+		/* Earlier requests of the dialog may still be queued on the previous owner */
+		if (ring->handover[owner]) {
+			idx = owner;
+		}
+	}
+	serializer = ao2_bump(ring->serializers[idx]);
+	ast_atomic_fetchadd_int((int *) &distributor_requests[idx], +1);
+	ast_debug(3, "Calculated serializer %s to use for %s\n",
+		ast_taskprocessor_name(serializer), pjsip_rx_data_get_info(rdata));
+
+	if (ast_taskprocessor_size(serializer) >= DISTRIBUTOR_GROW_LEVEL) {
+		distributor_pool_grow(ring);
+	}
+	ao2_ref(ring, -1);
+
 	return serializer;
 }
 
+/*! Number of buckets in the header index of a request */
+#define HEADER_INDEX_BUCKETS 32
+
+/*! \brief A header in the header index */
+struct header_index_entry {
+	/*! The header itself */
+	pjsip_hdr *hdr;
+	/*! The following header of the same name */
+	struct header_index_entry *next;
+	/*! The first header of the next name in the bucket */
+	struct header_index_entry *bucket_next;
+};
+
+/*!
+ * \brief The headers of a message by name
+ *
+ * The index is allocated from the pool of the cloned rdata it is built for
+ * so it goes away with it.
+ */
+struct header_index {
+	struct header_index_entry *buckets[HEADER_INDEX_BUCKETS];
+};
+
+/*! Reserves the slot in the rdata mod_data[] holding the header index */
+static pjsip_module header_index_mod = {
+	.name = {"Header Index", 12},
+	.priority = PJSIP_MOD_PRIORITY_TSX_LAYER - 7,
+};
+
+static unsigned int header_index_hash(const pj_str_t *name)
+{
+	unsigned int hash = 0;
+	pj_ssize_t idx;
+
+	for (idx = 0; idx < name->slen; ++idx) {
+		hash = hash * 31 + tolower((unsigned char) name->ptr[idx]);
+	}
+
+	return hash % HEADER_INDEX_BUCKETS;
+}
+
+/*!
+ * \internal
+ * \brief Index the headers of a cloned incoming message
+ *
+ * \param rdata The cloned message
+ */
+static void header_index_build(pjsip_rx_data *rdata)
+{
+	struct header_index *hdr_index;
+	pjsip_hdr *hdr;
+
+	hdr_index = PJ_POOL_ZALLOC_T(rdata->tp_info.pool, struct header_index);
+	if (!hdr_index) {
+		return;
+	}
+
+	for (hdr = rdata->msg_info.msg->hdr.next; hdr != &rdata->msg_info.msg->hdr; hdr = hdr->next) {
+		struct header_index_entry **pos;
+		struct header_index_entry *entry;
+
+		entry = PJ_POOL_ZALLOC_T(rdata->tp_info.pool, struct header_index_entry);
+		if (!entry) {
+			return;
+		}
+		entry->hdr = hdr;
+
+		for (pos = &hdr_index->buckets[header_index_hash(&hdr->name)]; *pos; pos = &(*pos)->bucket_next) {
+			if (!pj_stricmp(&(*pos)->hdr->name, &hdr->name)) {
+				break;
+			}
+		}
+		if (*pos) {
+			/* Keep the headers of the same name in message order */
+			for (pos = &(*pos)->next; *pos; pos = &(*pos)->next) {
+			}
+		}
+		*pos = entry;
+	}
+
+	rdata->endpt_info.mod_data[header_index_mod.id] = hdr_index;
+}
+
+pjsip_hdr *ast_sip_rdata_find_header(pjsip_rx_data *rdata, const pj_str_t *name, pjsip_hdr *prev)
+{
+	struct header_index *hdr_index = rdata->endpt_info.mod_data[header_index_mod.id];
+	struct header_index_entry *entry;
+
+	if (!hdr_index) {
+		return pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, name, prev ? prev->next : NULL);
+	}
+
+	for (entry = hdr_index->buckets[header_index_hash(name)]; entry; entry = entry->bucket_next) {
+		if (!pj_stricmp(&entry->hdr->name, name)) {
+			break;
+		}
+	}
+	if (prev) {
+		for (; entry && entry->hdr != prev; entry = entry->next) {
+		}
+		entry = entry ? entry->next : NULL;
+	}
+
+	return entry ? entry->hdr : NULL;
+}
+
 static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata);
 
 static pjsip_module endpoint_mod = {
@@ -482,12 +950,24 @@ static pjsip_module endpoint_mod = {
 	.on_rx_request = endpoint_lookup,
 };
 
+/*! \brief The Call-ID of a message, as the id of its trace spans */
+static const char *span_call_id(pjsip_rx_data *rdata, char *buf, size_t size)
+{
+	if (rdata->msg_info.cid) {
+		ast_copy_pj_str(buf, &rdata->msg_info.cid->id, size);
+	} else {
+		buf[0] = '\0';
+	}
+	return buf;
+}
+
 static pj_bool_t distributor(pjsip_rx_data *rdata)
 {
 	pjsip_dialog *dlg;
 	struct distributor_dialog_data *dist = NULL;
 	struct ast_taskprocessor *serializer = NULL;
 	pjsip_rx_data *clone;
+	char call_id[64];
 
 	if (!ast_test_flag(&ast_options, AST_OPT_FLAG_FULLY_BOOTED)) {
 		/*
@@ -497,6 +977,8 @@ static pj_bool_t distributor(pjsip_rx_data *rdata)
 		return PJ_TRUE;
 	}
 
+	AST_TRACE_SPAN_EVENT("pjsip_distributor_receipt", span_call_id(rdata, call_id, sizeof(call_id)));
+
 	dlg = find_dialog(rdata);
 	if (dlg) {
 		ast_debug(3, "Searching for serializer associated with dialog %s for %s\n",
@@ -574,6 +1056,9 @@ static pj_bool_t distributor(pjsip_rx_data *rdata)
 		return PJ_TRUE;
 	}
 
+	/* Done here once rather than each time a module looks for a header */
+	header_index_build(clone);
+
 	if (dist) {
 		ao2_lock(dist);
 		clone->endpt_info.mod_data[endpoint_mod.id] = ao2_bump(dist->endpoint);
@@ -715,11 +1200,99 @@ static void apply_acls(pjsip_rx_data *rdata)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Drain the bucket of a source in a row of the rate table
+ *
+ * \note unidentified_rate_lock must be held
+ */
+static struct unidentified_rate_cell *unidentified_rate_cell(const char *src_name, int row, int64_t now)
+{
+	struct unidentified_rate_cell *cell;
+	unsigned int hash = ast_str_hash_add(src_name, (int) unidentified_rate_seed[row]);
+
+	cell = &unidentified_rate[row][hash % UNIDENTIFIED_RATE_CELLS];
+	if (cell->level > 0 && now > cell->updated) {
+		cell->level -= (double) (now - cell->updated) * unidentified_count
+			/ (unidentified_period * 1000.0);
+		if (cell->level < 0) {
+			cell->level = 0;
+		}
+	}
+	cell->updated = now;
+
+	return cell;
+}
+
+static int64_t unidentified_rate_now(void)
+{
+	struct timeval now = ast_tvnow();
+
+	return (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+/*!
+ * \internal
+ * \brief Count an unidentified request of a source in the rate table
+ */
+static void unidentified_rate_charge(const char *src_name)
+{
+	int64_t now;
+	int row;
+
+	if (!unidentified_count || !unidentified_period) {
+		return;
+	}
+
+	now = unidentified_rate_now();
+	ast_mutex_lock(&unidentified_rate_lock);
+	for (row = 0; row < UNIDENTIFIED_RATE_ROWS; ++row) {
+		struct unidentified_rate_cell *cell = unidentified_rate_cell(src_name, row, now);
+
+		if (cell->level < unidentified_count) {
+			cell->level += 1;
+		}
+	}
+	ast_mutex_unlock(&unidentified_rate_lock);
+}
+
+/*!
+ * \internal
+ * \brief Check if a source sent too many unidentified requests to be let in
+ *
+ * \retval 1 if every bucket of the source is full
+ * \retval 0 otherwise
+ */
+static int unidentified_rate_exceeded(const char *src_name)
+{
+	int64_t now;
+	int exceeded = 1;
+	int row;
+
+	if (!unidentified_count || !unidentified_period) {
+		return 0;
+	}
+
+	now = unidentified_rate_now();
+	ast_mutex_lock(&unidentified_rate_lock);
+	for (row = 0; row < UNIDENTIFIED_RATE_ROWS; ++row) {
+		if (unidentified_rate_cell(src_name, row, now)->level <= unidentified_count - 1) {
+			exceeded = 0;
+			break;
+		}
+	}
+	ast_mutex_unlock(&unidentified_rate_lock);
+
+	return exceeded;
+}
+
 static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 {
 	struct ast_sip_endpoint *endpoint;
 	struct unidentified_request *unid;
 	int is_ack = rdata->msg_info.msg->line.req.method.id == PJSIP_ACK_METHOD;
+	char call_id[64];
+	AST_TRACE_SPAN_BEGIN(span);
 
 	endpoint = rdata->endpt_info.mod_data[endpoint_mod.id];
 	if (endpoint) {
@@ -738,7 +1311,14 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
+	if (unidentified_reject && !is_ack && unidentified_rate_exceeded(rdata->pkt_info.src_name)) {
+		ast_debug(3, "Dropping %s from '%s', over the unidentified request rate\n",
+			pjsip_rx_data_get_info(rdata), rdata->pkt_info.src_name);
+		return PJ_TRUE;
+	}
+
 	endpoint = ast_sip_identify_endpoint(rdata);
+	AST_TRACE_SPAN_END(span, "pjsip_endpoint_identification", span_call_id(rdata, call_id, sizeof(call_id)));
 	if (endpoint) {
 		unid = ao2_find(unidentified_requests, rdata->pkt_info.src_name, OBJ_SEARCH_KEY);
 		if (unid) {
@@ -768,6 +1348,8 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 			ast_copy_pj_str(name, &sip_from->user, sizeof(name));
 		}
 
+		unidentified_rate_charge(rdata->pkt_info.src_name);
+
 		unid = ao2_find(unidentified_requests, rdata->pkt_info.src_name, OBJ_SEARCH_KEY);
 		if (unid) {
 			check_endpoint(rdata, unid, name);
@@ -1124,11 +1706,68 @@ static int cli_unid_print_body(void *obj, void *arg, int flags)
 	return 0;
 }
 
+static char *cli_show_distributor(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT "%-32s %12s %8s %7s\n"
+	struct distributor_ring *ring;
+	unsigned int shares[DISTRIBUTOR_POOL_MAX] = { 0, };
+	unsigned int vnodes;
+	unsigned int idx;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjsip show distributor";
+		e->usage =
+			"Usage: pjsip show distributor\n"
+			"       Show the load on the serializers of the PJSIP distributor pool\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ring = ao2_global_obj_ref(distributor_pool);
+	if (!ring) {
+		return CLI_SUCCESS;
+	}
+
+	/* Each point owns the hash values from the point before it on the ring */
+	vnodes = ring->size * DISTRIBUTOR_RING_VNODES;
+	for (idx = 0; idx < vnodes; ++idx) {
+		shares[ring->vnodes[idx].serializer] += ring->vnodes[idx].point
+			- ring->vnodes[idx ? idx - 1 : vnodes - 1].point;
+	}
+
+	ast_cli(a->fd, FORMAT, "Serializer", "Requests", "Queued", "Share");
+	for (idx = 0; idx < ring->size; ++idx) {
+		char requests[16];
+		char queued[16];
+		char share[16];
+
+		snprintf(requests, sizeof(requests), "%u", distributor_requests[idx]);
+		snprintf(queued, sizeof(queued), "%ld", ast_taskprocessor_size(ring->serializers[idx]));
+		snprintf(share, sizeof(share), "%.1f%%", shares[idx] * 100.0 / 4294967296.0);
+		ast_cli(a->fd, FORMAT, ast_taskprocessor_name(ring->serializers[idx]),
+			requests, queued, share);
+	}
+	ast_cli(a->fd, "\n%u of at most %d serializers in the pool.\n",
+		ring->size, DISTRIBUTOR_POOL_MAX);
+
+	ao2_ref(ring, -1);
+
+	return CLI_SUCCESS;
+#undef FORMAT
+}
+
 static struct ast_cli_entry cli_commands[] = {
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Unidentified Requests",
 		.command = "pjsip show unidentified_requests",
 		.usage = "Usage: pjsip show unidentified_requests\n"
 				"       Show the PJSIP Unidentified Requests\n"),
+	AST_CLI_DEFINE(cli_show_distributor, "Show PJSIP distributor pool load"),
 };
 
 struct ast_sip_cli_formatter_entry *unid_formatter;
@@ -1199,6 +1838,7 @@ static void global_loaded(const char *object_type)
 	ao2_cleanup(fake_auth);
 
 	ast_sip_get_unidentified_request_thresholds(&unidentified_count, &unidentified_period, &unidentified_prune_interval);
+	unidentified_reject = ast_sip_get_unidentified_request_reject();
 
 	overload_trigger = ast_sip_get_taskprocessor_overload_trigger();
 
@@ -1224,12 +1864,7 @@ static struct ast_sorcery_observer global_observer = {
  */
 static void distributor_pool_shutdown(void)
 {
-	int idx;
-
-	for (idx = 0; idx < ARRAY_LEN(distributor_pool); ++idx) {
-		ast_taskprocessor_unreference(distributor_pool[idx]);
-		distributor_pool[idx] = NULL;
-	}
+	ao2_global_obj_release(distributor_pool);
 }
 
 /*!
@@ -1242,23 +1877,27 @@ static void distributor_pool_shutdown(void)
  */
 static int distributor_pool_setup(void)
 {
-	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
-	int idx;
+	struct distributor_ring *ring;
 
-	for (idx = 0; idx < ARRAY_LEN(distributor_pool); ++idx) {
-		/* Create name with seq number appended. */
-		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/distributor");
-
-		distributor_pool[idx] = ast_sip_create_serializer(tps_name);
-		if (!distributor_pool[idx]) {
-			return -1;
-		}
+	ring = distributor_ring_alloc(NULL, DISTRIBUTOR_POOL_SIZE);
+	if (!ring) {
+		return -1;
 	}
+	ao2_global_obj_replace_unref(distributor_pool, ring);
+	ao2_ref(ring, -1);
+	memset(distributor_requests, 0, sizeof(distributor_requests));
+	distributor_grown = 0;
 	return 0;
 }
 
 int ast_sip_initialize_distributor(void)
 {
+	int i;
+
+	for (i = 0; i < UNIDENTIFIED_RATE_ROWS; ++i) {
+		unidentified_rate_seed[i] = ast_random();
+	}
+
 	unidentified_requests = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
 		DEFAULT_SUSPECTS_BUCKETS, suspects_hash, NULL, suspects_compare);
 	if (!unidentified_requests) {
@@ -1301,6 +1940,10 @@ int ast_sip_initialize_distributor(void)
 		ast_sip_destroy_distributor();
 		return -1;
 	}
+	if (ast_sip_register_service(&header_index_mod)) {
+		ast_sip_destroy_distributor();
+		return -1;
+	}
 	if (ast_sip_register_service(&endpoint_mod)) {
 		ast_sip_destroy_distributor();
 		return -1;
@@ -1338,6 +1981,7 @@ void ast_sip_destroy_distributor(void)
 
 	ast_sip_unregister_service(&auth_mod);
 	ast_sip_unregister_service(&endpoint_mod);
+	ast_sip_unregister_service(&header_index_mod);
 	ast_sip_unregister_service(&distributor_mod);
 
 	ao2_global_obj_release(artificial_auth);
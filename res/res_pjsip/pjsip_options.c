@@ -34,6 +34,8 @@
 #include "include/res_pjsip_private.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/threadpool.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/sched.h"
 
 /*
  * This implementation for OPTIONS support is based around the idea
@@ -52,6 +54,13 @@
  * scheduled. Contacts can be added or deleted as appropriate with no
  * requirement to reschedule.
  *
+ * AORs are not scheduled individually either. A single timer wheel
+ * ticking every QUALIFY_WHEEL_TICK milliseconds holds every qualified
+ * AOR in the slot of the tick it is next due on. Each tick hands the
+ * AORs in its slot to their serializers as one batch, so the qualifies
+ * stay spread out at the resolution of the wheel instead of each AOR
+ * having its own scheduler entry.
+ *
  * The next level object up is the AOR itself. The result of a contact
  * status change is fed into it and the result composited with all
  * other contacts. This may result in the AOR itself changing state
@@ -122,6 +131,15 @@
 /*! \brief These are the number of buckets (per endpoint state compositor) to use to store AOR statuses */
 #define AOR_STATUS_BUCKETS 3
 
+/*! \brief Milliseconds between ticks of the qualify timer wheel */
+#define QUALIFY_WHEEL_TICK 100
+
+/*! \brief Slots of the qualify timer wheel, one per tick */
+#define QUALIFY_WHEEL_SLOTS 1024
+
+/*! \brief Seconds the reported qualify rate is averaged over */
+#define QUALIFY_RATE_WINDOW 60
+
 /*! \brief Maximum wait time to join the below shutdown group */
 #define MAX_UNLOAD_TIMEOUT_TIME		10	/* Seconds */
 
@@ -162,8 +180,12 @@ struct sip_options_endpoint_state_compositor {
  * \brief Structure which contains an AOR and contacts for qualifying purposes
  */
 struct sip_options_aor {
-	/*! \brief The scheduler task for this AOR */
-	struct ast_sip_sched_task *sched_task;
+	/*! \brief Next AOR in the same qualify wheel slot, protected by the wheel lock */
+	AST_LIST_ENTRY(sip_options_aor) wheel_next;
+	/*! \brief The wheel tick this AOR is next qualified on, 0 if not on the wheel */
+	unsigned int wheel_due;
+	/*! \brief Ticks between qualifies of this AOR */
+	unsigned int wheel_period;
 	/*! \brief The serializer for this AOR */
 	struct ast_taskprocessor *serializer;
 	/*! \brief All contacts associated with this AOR */
@@ -212,6 +234,46 @@ static struct ao2_container *sip_options_endpoint_state_compositors;
  */
 static struct ast_taskprocessor *management_serializer;
 
+/*! \brief Upper bounds of the qualify round trip time buckets, in milliseconds */
+static const int qualify_rtt_bounds[] = { 10, 50, 100, 250, 500, 1000, 2000 };
+
+/*! \brief Protects the qualify wheel and the wheel fields of the AORs on it */
+AST_MUTEX_DEFINE_STATIC(qualify_wheel_lock);
+
+/*!
+ * \internal
+ * \brief Timer wheel scheduling the qualifying of all AORs
+ */
+static struct {
+	/*! \brief AORs due on each tick, a ref is held to each */
+	AST_LIST_HEAD_NOLOCK(, sip_options_aor) slots[QUALIFY_WHEEL_SLOTS];
+	/*! \brief The last tick processed */
+	unsigned int now;
+	/*! \brief When tick 0 was */
+	struct timeval start;
+	/*! \brief Number of AORs on the wheel */
+	unsigned int scheduled;
+	/*! \brief Scheduler driving the ticks */
+	struct ast_sched_context *sched;
+} qualify_wheel;
+
+/*!
+ * \internal
+ * \brief Qualify statistics, updated atomically
+ */
+static struct {
+	/*! \brief OPTIONS requests sent */
+	int sent;
+	/*! \brief OPTIONS requests answered */
+	int answered;
+	/*! \brief OPTIONS requests that timed out or failed to be delivered */
+	int unanswered;
+	/*! \brief Answered requests by round trip time, per qualify_rtt_bounds */
+	int rtt[ARRAY_LEN(qualify_rtt_bounds) + 1];
+	/*! \brief Requests sent at the start of each of the last seconds, by wheel ticks */
+	int sent_history[QUALIFY_RATE_WINDOW];
+} qualify_stats;
+
 static pj_status_t send_options_response(pjsip_rx_data *rdata, int code)
 {
 	pjsip_endpoint *endpt = ast_sip_get_pjsip_endpoint();
@@ -710,6 +772,20 @@ static int sip_options_contact_status_notify_task(void *obj)
 			: 0;
 	ao2_link(sip_options_contact_statuses, cs_new);
 
+	if (cs_new->status == AVAILABLE) {
+		int bucket;
+
+		for (bucket = 0; bucket < ARRAY_LEN(qualify_rtt_bounds); ++bucket) {
+			if (cs_new->rtt <= qualify_rtt_bounds[bucket] * 1000) {
+				break;
+			}
+		}
+		ast_atomic_fetchadd_int(&qualify_stats.rtt[bucket], +1);
+		ast_atomic_fetchadd_int(&qualify_stats.answered, +1);
+	} else {
+		ast_atomic_fetchadd_int(&qualify_stats.unanswered, +1);
+	}
+
 	/*
 	 * If the status has changed then notify the endpoint state compositors
 	 * and publish our events.
@@ -911,7 +987,9 @@ static int sip_options_qualify_contact(void *obj, void *arg, int flags)
 		ast_log(LOG_ERROR, "Unable to send request to qualify contact %s on AOR %s\n",
 			contact->uri, aor_options->name);
 		ao2_ref(contact_callback_data, -1);
+		return 0;
 	}
+	ast_atomic_fetchadd_int(&qualify_stats.sent, +1);
 
 	return 0;
 }
@@ -930,8 +1008,171 @@ static int sip_options_qualify_aor(void *obj)
 	ao2_callback(aor_options->contacts, OBJ_NODATA, sip_options_qualify_contact,
 		(struct sip_options_aor *) aor_options);
 
-	/* Always reschedule to the frequency we should go */
-	return aor_options->qualify_frequency * 1000;
+	return 0;
+}
+
+/*!
+ * \brief Task to qualify contacts of an AOR that came due on the qualify wheel
+ * \note Run by aor_options->serializer
+ */
+static int sip_options_qualify_aor_task(void *obj)
+{
+	struct sip_options_aor *aor_options = obj;
+
+	/* The AOR may have stopped qualifying while this was queued */
+	if (aor_options->qualify_frequency) {
+		sip_options_qualify_aor(aor_options);
+	}
+	ao2_ref(aor_options, -1);
+
+	return 0;
+}
+
+/*!
+ * \brief Take an AOR off the qualify wheel
+ * \pre The wheel lock must be held.
+ */
+static void sip_options_wheel_remove(struct sip_options_aor *aor_options)
+{
+	AST_LIST_REMOVE(&qualify_wheel.slots[aor_options->wheel_due % QUALIFY_WHEEL_SLOTS],
+		aor_options, wheel_next);
+	aor_options->wheel_due = 0;
+}
+
+/*!
+ * \brief Put an AOR on the qualify wheel
+ * \pre The wheel lock must be held and the AOR not be on the wheel.
+ */
+static void sip_options_wheel_insert(struct sip_options_aor *aor_options, unsigned int ticks)
+{
+	aor_options->wheel_due = qualify_wheel.now + MAX(ticks, 1);
+	if (!aor_options->wheel_due) {
+		/* 0 is kept for not being on the wheel */
+		++aor_options->wheel_due;
+	}
+	AST_LIST_INSERT_TAIL(&qualify_wheel.slots[aor_options->wheel_due % QUALIFY_WHEEL_SLOTS],
+		aor_options, wheel_next);
+}
+
+/*!
+ * \brief Schedule periodic qualifying of an AOR, replacing any current schedule
+ * \note Run by aor_options->serializer
+ *
+ * \param aor_options The AOR to qualify every qualify_frequency seconds.
+ * \param delay Milliseconds until it is first qualified.
+ */
+static void sip_options_wheel_schedule(struct sip_options_aor *aor_options, int delay)
+{
+	ast_mutex_lock(&qualify_wheel_lock);
+	if (aor_options->wheel_due) {
+		sip_options_wheel_remove(aor_options);
+	} else {
+		ao2_ref(aor_options, +1);
+		++qualify_wheel.scheduled;
+	}
+	aor_options->wheel_period = MAX(aor_options->qualify_frequency * 1000 / QUALIFY_WHEEL_TICK, 1);
+	sip_options_wheel_insert(aor_options, delay / QUALIFY_WHEEL_TICK);
+	ast_mutex_unlock(&qualify_wheel_lock);
+}
+
+/*!
+ * \brief Stop periodic qualifying of an AOR
+ * \note Run by aor_options->serializer
+ */
+static void sip_options_wheel_cancel(struct sip_options_aor *aor_options)
+{
+	int scheduled;
+
+	ast_mutex_lock(&qualify_wheel_lock);
+	scheduled = aor_options->wheel_due != 0;
+	if (scheduled) {
+		sip_options_wheel_remove(aor_options);
+		--qualify_wheel.scheduled;
+	}
+	ast_mutex_unlock(&qualify_wheel_lock);
+
+	if (scheduled) {
+		ao2_ref(aor_options, -1);
+	}
+}
+
+/*!
+ * \brief Determine if an AOR is on the qualify wheel
+ * \note Run by aor_options->serializer
+ */
+static int sip_options_wheel_scheduled(struct sip_options_aor *aor_options)
+{
+	int scheduled;
+
+	ast_mutex_lock(&qualify_wheel_lock);
+	scheduled = aor_options->wheel_due != 0;
+	ast_mutex_unlock(&qualify_wheel_lock);
+
+	return scheduled;
+}
+
+/*!
+ * \brief Advance the qualify wheel up to the current time
+ * \note Run by the qualify_wheel scheduler thread
+ *
+ * The AORs due are put back in the slot of their next tick before
+ * their qualify task is queued, so how long the qualify takes does not
+ * make the schedule drift.
+ */
+static int sip_options_wheel_tick(const void *data)
+{
+	AST_VECTOR(, struct sip_options_aor *) due;
+	unsigned int target;
+	int idx;
+
+	if (AST_VECTOR_INIT(&due, 32)) {
+		return QUALIFY_WHEEL_TICK;
+	}
+
+	ast_mutex_lock(&qualify_wheel_lock);
+	target = ast_tvdiff_ms(ast_tvnow(), qualify_wheel.start) / QUALIFY_WHEEL_TICK;
+	while (qualify_wheel.now != target) {
+		AST_LIST_HEAD_NOLOCK(, sip_options_aor) requeue = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+		struct sip_options_aor *aor_options;
+
+		++qualify_wheel.now;
+		if (!(qualify_wheel.now % (1000 / QUALIFY_WHEEL_TICK))) {
+			qualify_stats.sent_history[qualify_wheel.now / (1000 / QUALIFY_WHEEL_TICK)
+				% QUALIFY_RATE_WINDOW] = ast_atomic_fetchadd_int(&qualify_stats.sent, 0);
+		}
+
+		AST_LIST_TRAVERSE_SAFE_BEGIN(&qualify_wheel.slots[qualify_wheel.now % QUALIFY_WHEEL_SLOTS],
+			aor_options, wheel_next) {
+			/* Others in the slot are due on a later turn of the wheel */
+			if (aor_options->wheel_due != qualify_wheel.now) {
+				continue;
+			}
+			AST_LIST_REMOVE_CURRENT(wheel_next);
+			AST_LIST_INSERT_TAIL(&requeue, aor_options, wheel_next);
+		}
+		AST_LIST_TRAVERSE_SAFE_END;
+
+		while ((aor_options = AST_LIST_REMOVE_HEAD(&requeue, wheel_next))) {
+			sip_options_wheel_insert(aor_options, aor_options->wheel_period);
+			if (AST_VECTOR_APPEND(&due, aor_options)) {
+				continue;
+			}
+			ao2_ref(aor_options, +1);
+		}
+	}
+	ast_mutex_unlock(&qualify_wheel_lock);
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&due); ++idx) {
+		struct sip_options_aor *aor_options = AST_VECTOR_GET(&due, idx);
+
+		if (ast_sip_push_task(aor_options->serializer, sip_options_qualify_aor_task,
+			aor_options)) {
+			ao2_ref(aor_options, -1);
+		}
+	}
+	AST_VECTOR_FREE(&due);
+
+	return QUALIFY_WHEEL_TICK;
 }
 
 /*! \brief Forward declaration of this helpful function */
@@ -1243,6 +1484,7 @@ static void sip_options_apply_aor_configuration(struct sip_options_aor *aor_opti
 	struct ao2_container *existing_contacts;
 	struct ast_sip_contact *contact;
 	struct ao2_iterator iter;
+	int scheduled;
 
 	ast_debug(3, "Configuring AOR '%s' with current state of configuration and world\n",
 		aor_options->name);
@@ -1348,27 +1590,18 @@ static void sip_options_apply_aor_configuration(struct sip_options_aor *aor_opti
 	 * 2. Contacts were added when previously there were none
 	 * 3. There are no contacts but previously there were some
 	 */
+	scheduled = sip_options_wheel_scheduled(aor_options);
 	if (aor_options->qualify_frequency != aor->qualify_frequency
-		|| (!aor_options->sched_task && ao2_container_count(aor_options->contacts))
-		|| (aor_options->sched_task && !ao2_container_count(aor_options->contacts))) {
-		if (aor_options->sched_task) {
-			ast_sip_sched_task_cancel(aor_options->sched_task);
-			ao2_ref(aor_options->sched_task, -1);
-			aor_options->sched_task = NULL;
-		}
+		|| (!scheduled && ao2_container_count(aor_options->contacts))
+		|| (scheduled && !ao2_container_count(aor_options->contacts))) {
+		sip_options_wheel_cancel(aor_options);
 
 		/* If there is still a qualify frequency then schedule this */
 		aor_options->qualify_frequency = aor->qualify_frequency;
 		if (aor_options->qualify_frequency
 			&& ao2_container_count(aor_options->contacts)) {
-			aor_options->sched_task = ast_sip_schedule_task(aor_options->serializer,
-				sip_options_determine_initial_qualify_time(aor_options->qualify_frequency),
-				sip_options_qualify_aor, ast_taskprocessor_name(aor_options->serializer),
-				aor_options, AST_SIP_SCHED_TASK_VARIABLE | AST_SIP_SCHED_TASK_DATA_AO2);
-			if (!aor_options->sched_task) {
-				ast_log(LOG_ERROR, "Unable to schedule qualify for contacts of AOR '%s'\n",
-					aor_options->name);
-			}
+			sip_options_wheel_schedule(aor_options,
+				sip_options_determine_initial_qualify_time(aor_options->qualify_frequency));
 		}
 	}
 
@@ -1688,11 +1921,7 @@ static int sip_options_aor_remove_task(void *obj)
 
 	sip_options_notify_endpoint_state_compositors(aor_options, REMOVED);
 
-	if (aor_options->sched_task) {
-		ast_sip_sched_task_cancel(aor_options->sched_task);
-		ao2_ref(aor_options->sched_task, -1);
-		aor_options->sched_task = NULL;
-	}
+	sip_options_wheel_cancel(aor_options);
 
 	return 0;
 }
@@ -2112,20 +2341,7 @@ static int sip_options_contact_add_task(void *obj)
 		 * since they pretty much just registered they should be
 		 * reachable.
 		 */
-		if (task_data->aor_options->sched_task) {
-			ast_sip_sched_task_cancel(task_data->aor_options->sched_task);
-			ao2_ref(task_data->aor_options->sched_task, -1);
-			task_data->aor_options->sched_task = NULL;
-		}
-		task_data->aor_options->sched_task = ast_sip_schedule_task(
-			task_data->aor_options->serializer, 1, sip_options_qualify_aor,
-			ast_taskprocessor_name(task_data->aor_options->serializer),
-			task_data->aor_options,
-			AST_SIP_SCHED_TASK_VARIABLE | AST_SIP_SCHED_TASK_DATA_AO2);
-		if (!task_data->aor_options->sched_task) {
-			ast_log(LOG_ERROR, "Unable to schedule qualify for contacts of AOR '%s'\n",
-				task_data->aor_options->name);
-		}
+		sip_options_wheel_schedule(task_data->aor_options, 0);
 	} else {
 		/*
 		 * If this was the first contact added to a non-qualified AOR then
@@ -2283,11 +2499,7 @@ static int sip_options_contact_delete_task(void *obj)
 		if (!ao2_container_count(task_data->aor_options->contacts)) {
 			ast_debug(3, "Terminating scheduled callback on AOR '%s' as there are no contacts to qualify\n",
 				task_data->aor_options->name);
-			if (task_data->aor_options->sched_task) {
-				ast_sip_sched_task_cancel(task_data->aor_options->sched_task);
-				ao2_ref(task_data->aor_options->sched_task, -1);
-				task_data->aor_options->sched_task = NULL;
-			}
+			sip_options_wheel_cancel(task_data->aor_options);
 		}
 	} else {
 		task_data->aor_options->available =
@@ -2703,10 +2915,61 @@ static int ami_sip_qualify(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+static char *cli_show_qualify_statistics(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int scheduled;
+	unsigned int seconds;
+	int sent;
+	int window;
+	int bucket;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjsip show qualify statistics";
+		e->usage =
+			"Usage: pjsip show qualify statistics\n"
+			"       Show the rate of PJSIP qualify requests and their round trip times.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&qualify_wheel_lock);
+	scheduled = qualify_wheel.scheduled;
+	seconds = qualify_wheel.now / (1000 / QUALIFY_WHEEL_TICK);
+	sent = ast_atomic_fetchadd_int(&qualify_stats.sent, 0);
+	window = MIN(seconds, QUALIFY_RATE_WINDOW - 1);
+	ast_mutex_unlock(&qualify_wheel_lock);
+
+	ast_cli(a->fd, "  AORs scheduled       : %u\n", scheduled);
+	ast_cli(a->fd, "  Qualifies sent       : %d\n", sent);
+	if (window) {
+		ast_cli(a->fd, "  Qualify rate         : %.1f/sec over the last %d sec\n",
+			(sent - qualify_stats.sent_history[(seconds - window) % QUALIFY_RATE_WINDOW])
+				/ (double) window, window);
+	}
+	ast_cli(a->fd, "  Answered             : %d\n", qualify_stats.answered);
+	ast_cli(a->fd, "  Unanswered           : %d\n", qualify_stats.unanswered);
+	ast_cli(a->fd, "  Round trip times\n");
+	for (bucket = 0; bucket < ARRAY_LEN(qualify_rtt_bounds); ++bucket) {
+		ast_cli(a->fd, "    <= %4d ms         : %d\n", qualify_rtt_bounds[bucket],
+			qualify_stats.rtt[bucket]);
+	}
+	ast_cli(a->fd, "     > %4d ms         : %d\n", qualify_rtt_bounds[bucket - 1],
+		qualify_stats.rtt[bucket]);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_options[] = {
 	AST_CLI_DEFINE(cli_qualify, "Send an OPTIONS request to a PJSIP endpoint"),
 	AST_CLI_DEFINE(cli_show_qualify_endpoint, "Show the current qualify options for all Aors on the PJSIP endpoint"),
 	AST_CLI_DEFINE(cli_show_qualify_aor, "Show the PJSIP Aor current qualify options"),
+	AST_CLI_DEFINE(cli_show_qualify_statistics, "Show the PJSIP qualify rate and round trip times"),
 	AST_CLI_DEFINE(cli_reload_qualify_endpoint, "Synchronize the qualify options for all Aors on the PJSIP endpoint"),
 	AST_CLI_DEFINE(cli_reload_qualify_aor, "Synchronize the PJSIP Aor qualify options"),
 };
@@ -2795,11 +3058,7 @@ static int sip_options_cleanup_aor_task(void *obj)
 	ast_debug(2, "Cleaning up AOR '%s' for shutdown\n", aor_options->name);
 
 	aor_options->qualify_frequency = 0;
-	if (aor_options->sched_task) {
-		ast_sip_sched_task_cancel(aor_options->sched_task);
-		ao2_ref(aor_options->sched_task, -1);
-		aor_options->sched_task = NULL;
-	}
+	sip_options_wheel_cancel(aor_options);
 	AST_VECTOR_RESET(&aor_options->compositors, ao2_cleanup);
 
 	return 0;
@@ -2846,6 +3105,11 @@ void ast_res_pjsip_cleanup_options_handling(void)
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "endpoint",
 		&endpoint_observer_callbacks);
 
+	if (qualify_wheel.sched) {
+		ast_sched_context_destroy(qualify_wheel.sched);
+		qualify_wheel.sched = NULL;
+	}
+
 	mgmt_serializer = management_serializer;
 	management_serializer = NULL;
 	if (mgmt_serializer) {
@@ -2950,6 +3214,18 @@ int ast_res_pjsip_init_options_handling(int reload)
 		return -1;
 	}
 
+	memset(&qualify_stats, 0, sizeof(qualify_stats));
+	qualify_wheel.start = ast_tvnow();
+	qualify_wheel.now = 0;
+	qualify_wheel.sched = ast_sched_context_create();
+	if (!qualify_wheel.sched
+		|| ast_sched_start_thread(qualify_wheel.sched)
+		|| ast_sched_add_variable(qualify_wheel.sched, QUALIFY_WHEEL_TICK,
+			sip_options_wheel_tick, NULL, 1) < 0) {
+		ast_res_pjsip_cleanup_options_handling();
+		return -1;
+	}
+
 	mgmt_serializer = ast_sip_create_serializer("pjsip/options/manage");
 	if (!mgmt_serializer) {
 		ast_res_pjsip_cleanup_options_handling();
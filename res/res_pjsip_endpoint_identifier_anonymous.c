@@ -47,7 +47,7 @@ static int find_transport_state_in_use(void *obj, void *arg, int flags)
 	struct ast_sip_transport_state *transport_state = obj;
 	pjsip_rx_data *rdata = arg;
 
-	if (transport_state->transport == rdata->tp_info.transport
+	if (ast_sip_transport_state_has_transport(transport_state, rdata->tp_info.transport)
 		|| (transport_state->factory
 			&& !pj_strcmp(&transport_state->factory->addr_name.host, &rdata->tp_info.transport->local_name.host)
 			&& transport_state->factory->addr_name.port == rdata->tp_info.transport->local_name.port)) {
@@ -191,9 +191,8 @@ static int header_identify_match_check(void *obj, void *arg, int flags)
 
 	/* Check all headers of the given name for a match. */
 	header_present = 0;
-	for (header = NULL;
-		(header = pjsip_msg_find_hdr_by_name(rdata->msg_info.msg, &pj_header_name, header));
-		header = header->next) {
+	header = NULL;
+	while ((header = ast_sip_rdata_find_header(rdata, &pj_header_name, header))) {
 		char *pos;
 		int len;
 		char buf[PATH_MAX];
@@ -849,6 +848,8 @@ static int load_module(void)
 	ast_sorcery_object_field_register_custom(ast_sip_get_sorcery(), "identify", "match", "", ip_identify_match_handler, match_to_str, match_to_var_list, 0, 0);
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "match_header", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ip_identify_match, match_header));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "srv_lookups", "yes", OPT_BOOL_T, 1, FLDSET(struct ip_identify_match, srv_lookups));
+	/* The identifies of an endpoint are looked up by it when showing the endpoint */
+	ast_sorcery_object_field_index(ast_sip_get_sorcery(), "identify", "endpoint");
 	ast_sorcery_load_object(ast_sip_get_sorcery(), "identify");
 
 	ast_sip_register_endpoint_identifier_with_name(&ip_identifier, "ip");
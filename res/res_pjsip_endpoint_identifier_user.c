@@ -44,11 +44,13 @@ static int get_from_header(pjsip_rx_data *rdata, char *username, size_t username
 }
 
 static pjsip_authorization_hdr *get_auth_header(pjsip_rx_data *rdata, char *username,
-	size_t username_size, char *realm, size_t realm_size, pjsip_authorization_hdr *start)
+	size_t username_size, char *realm, size_t realm_size, pjsip_authorization_hdr *prev)
 {
+	static const pj_str_t authorization = { "Authorization", 13 };
 	pjsip_authorization_hdr *header;
 
-	header = pjsip_msg_find_hdr(rdata->msg_info.msg, PJSIP_H_AUTHORIZATION, start);
+	header = (pjsip_authorization_hdr *) ast_sip_rdata_find_header(rdata, &authorization,
+		(pjsip_hdr *) prev);
 
 	if (!header || pj_stricmp2(&header->scheme, "digest")) {
 		return NULL;
@@ -65,7 +67,7 @@ static int find_transport_state_in_use(void *obj, void *arg, int flags)
 	struct ast_sip_transport_state *transport_state = obj;
 	pjsip_rx_data *rdata = arg;
 
-	if (transport_state->transport == rdata->tp_info.transport
+	if (ast_sip_transport_state_has_transport(transport_state, rdata->tp_info.transport)
 		|| (transport_state->factory
 			&& !pj_strcmp(&transport_state->factory->addr_name.host, &rdata->tp_info.transport->local_name.host)
 			&& transport_state->factory->addr_name.port == rdata->tp_info.transport->local_name.port)) {
@@ -169,7 +171,7 @@ static struct ast_sip_endpoint *auth_username_identify(pjsip_rx_data *rdata)
 	pjsip_authorization_hdr *auth_header = NULL;
 
 	while ((auth_header = get_auth_header(rdata, username, sizeof(username), realm, sizeof(realm),
-		auth_header ? auth_header->next : NULL))) {
+		auth_header))) {
 		ast_debug(3, "Attempting identify by Authorization username '%s' realm '%s'\n", username,
 			realm);
 
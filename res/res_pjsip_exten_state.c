@@ -231,21 +231,84 @@ static struct exten_state_subscription *exten_state_subscription_alloc(
 	return exten_state_sub;
 }
 
+/*!
+ * \brief A copy of a change of extension state, shared by the watchers notified of it
+ */
+struct exten_state_change {
+	enum ast_extension_states exten_state;
+	enum ast_presence_state presence_state;
+	char *presence_subtype;
+	char *presence_message;
+	struct ao2_container *device_state_info;
+};
+
+/*!
+ * \brief The change last copied
+ *
+ * The watchers of a hint are called one after the other with the same
+ * change, so it is copied once for all of them rather than once each.
+ */
+static struct exten_state_change *last_change;
+
+AST_MUTEX_DEFINE_STATIC(last_change_lock);
+
 struct notify_task_data {
 	struct ast_sip_exten_state_data exten_state_data;
 	struct exten_state_subscription *exten_state_sub;
+	struct exten_state_change *change;
 	int terminate;
 };
 
+static void exten_state_change_destructor(void *obj)
+{
+	struct exten_state_change *change = obj;
+
+	ao2_cleanup(change->device_state_info);
+	ast_free(change->presence_subtype);
+	ast_free(change->presence_message);
+}
+
+/*!
+ * \internal
+ * \brief Get a copy of a change of extension state, the last copied if it is alike
+ */
+static struct exten_state_change *exten_state_change_get(struct ast_state_cb_info *info)
+{
+	struct exten_state_change *change;
+
+	ast_mutex_lock(&last_change_lock);
+	change = last_change;
+	if (change && change->exten_state == info->exten_state
+		&& change->presence_state == info->presence_state
+		&& change->device_state_info == info->device_state_info
+		&& !strcmp(S_OR(change->presence_subtype, ""), S_OR(info->presence_subtype, ""))
+		&& !strcmp(S_OR(change->presence_message, ""), S_OR(info->presence_message, ""))) {
+		ao2_ref(change, +1);
+		ast_mutex_unlock(&last_change_lock);
+		return change;
+	}
+
+	change = ao2_alloc_options(sizeof(*change), exten_state_change_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (change) {
+		change->exten_state = info->exten_state;
+		change->presence_state = info->presence_state;
+		change->presence_subtype = ast_strdup(info->presence_subtype);
+		change->presence_message = ast_strdup(info->presence_message);
+		change->device_state_info = ao2_bump(info->device_state_info);
+		ao2_replace(last_change, change);
+	}
+	ast_mutex_unlock(&last_change_lock);
+
+	return change;
+}
+
 static void notify_task_data_destructor(void *obj)
 {
 	struct notify_task_data *task_data = obj;
 
 	ao2_ref(task_data->exten_state_sub, -1);
-	ao2_cleanup(task_data->exten_state_data.device_state_info);
-	ast_free(task_data->exten_state_data.presence_subtype);
-	ast_free(task_data->exten_state_data.presence_message);
-	ast_free(task_data->exten_state_data.user_agent);
+	ao2_cleanup(task_data->change);
 }
 
 static struct notify_task_data *alloc_notify_task_data(const char *exten,
@@ -253,7 +316,8 @@ static struct notify_task_data *alloc_notify_task_data(const char *exten,
 	struct ast_state_cb_info *info)
 {
 	struct notify_task_data *task_data =
-		ao2_alloc(sizeof(*task_data), notify_task_data_destructor);
+		ao2_alloc_options(sizeof(*task_data), notify_task_data_destructor,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
 
 	if (!task_data) {
 		ast_log(LOG_WARNING, "Unable to create notify task data\n");
@@ -265,13 +329,20 @@ static struct notify_task_data *alloc_notify_task_data(const char *exten,
 	task_data->exten_state_sub->last_presence_state = info->presence_state;
 	ao2_ref(task_data->exten_state_sub, +1);
 
+	task_data->change = exten_state_change_get(info);
+	if (!task_data->change) {
+		ast_log(LOG_WARNING, "Unable to create notify task data\n");
+		ao2_ref(task_data, -1);
+		return NULL;
+	}
+
 	task_data->exten_state_data.exten = exten_state_sub->exten;
 	task_data->exten_state_data.exten_state = info->exten_state;
 	task_data->exten_state_data.presence_state = info->presence_state;
-	task_data->exten_state_data.presence_subtype = ast_strdup(info->presence_subtype);
-	task_data->exten_state_data.presence_message = ast_strdup(info->presence_message);
-	task_data->exten_state_data.user_agent = ast_strdup(exten_state_sub->user_agent);
-	task_data->exten_state_data.device_state_info = ao2_bump(info->device_state_info);
+	task_data->exten_state_data.presence_subtype = task_data->change->presence_subtype;
+	task_data->exten_state_data.presence_message = task_data->change->presence_message;
+	task_data->exten_state_data.user_agent = exten_state_sub->user_agent;
+	task_data->exten_state_data.device_state_info = task_data->change->device_state_info;
 	task_data->exten_state_data.sub = exten_state_sub->sip_sub;
 	task_data->exten_state_data.datastores = ast_sip_subscription_get_datastores(exten_state_sub->sip_sub);
 
@@ -951,6 +1022,11 @@ static int unload_module(void)
 	ast_taskprocessor_unreference(publish_exten_state_serializer);
 	publish_exten_state_serializer = NULL;
 
+	ast_mutex_lock(&last_change_lock);
+	ao2_cleanup(last_change);
+	last_change = NULL;
+	ast_mutex_unlock(&last_change_lock);
+
 	ao2_cleanup(publishers);
 	publishers = NULL;
 
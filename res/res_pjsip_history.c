@@ -46,6 +46,9 @@
 
 #define HISTORY_INITIAL_SIZE 256
 
+/*! \brief Entries kept in the history, the oldest are dropped for newer ones */
+#define HISTORY_RING_SIZE 16384
+
 /*! \brief Pool factory used by pjlib to allocate memory. */
 static pj_caching_pool cachingpool;
 
@@ -67,17 +70,28 @@ struct pjsip_history_entry {
 	pj_sockaddr_in src;
 	/*! \brief Destination address */
 	pj_sockaddr_in dst;
-	/*! \brief Memory pool used to allocate \c msg */
+	/*! \brief Memory pool used to allocate \c msg, once the entry is parsed */
 	pj_pool_t *pool;
-	/*! \brief The actual SIP message */
+	/*! \brief The SIP message parsed from \c packet, NULL until the entry is queried */
 	pjsip_msg *msg;
+	/*! \brief Length of \c packet */
+	size_t len;
+	/*! \brief The packet as transmitted/received, nul terminated */
+	char packet[0];
 };
 
-/*! \brief Mutex that protects \ref vector_history */
+/*! \brief Mutex that protects \ref history_ring */
 AST_MUTEX_DEFINE_STATIC(history_lock);
 
-/*! \brief The one and only history that we've captured */
-static AST_VECTOR(vector_history_t, struct pjsip_history_entry *) vector_history;
+/*!
+ * \brief The one and only history that we've captured
+ *
+ * The entry numbered n is kept at n % HISTORY_RING_SIZE, until it is
+ * replaced by the entry numbered n + HISTORY_RING_SIZE.
+ */
+static struct pjsip_history_entry *history_ring[HISTORY_RING_SIZE];
+
+AST_VECTOR(vector_history_t, struct pjsip_history_entry *);
 
 struct expression_token;
 
@@ -492,7 +506,7 @@ static void *entry_get_addr(struct pjsip_history_entry *entry)
 /*! \brief Callback to retrieve the entry's SIP request method type */
 static void *entry_get_sip_msg_request_method(struct pjsip_history_entry *entry)
 {
-	if (entry->msg->type != PJSIP_REQUEST_MSG) {
+	if (!entry->msg || entry->msg->type != PJSIP_REQUEST_MSG) {
 		return NULL;
 	}
 
@@ -504,7 +518,14 @@ static void *entry_get_sip_msg_call_id(struct pjsip_history_entry *entry)
 {
 	pjsip_cid_hdr *cid_hdr;
 
+	if (!entry->msg) {
+		return NULL;
+	}
+
 	cid_hdr = PJSIP_MSG_CID_HDR(entry->msg);
+	if (!cid_hdr) {
+		return NULL;
+	}
 
 	return &cid_hdr->id;
 }
@@ -620,16 +641,20 @@ static void pjsip_history_entry_dtor(void *obj)
 /*!
  * \brief Create a \c pjsip_history_entry AO2 object
  *
- * \param msg The PJSIP message that this history entry wraps
+ * Only the packet is copied. It is parsed when the history is queried,
+ * so that capturing costs the SIP threads as little as possible.
+ *
+ * \param packet The packet that this history entry holds
+ * \param len The length of the packet
  *
  * \retval An AO2 \c pjsip_history_entry object on success
  * \retval NULL on failure
  */
-static struct pjsip_history_entry *pjsip_history_entry_alloc(pjsip_msg *msg)
+static struct pjsip_history_entry *pjsip_history_entry_alloc(const char *packet, size_t len)
 {
 	struct pjsip_history_entry *entry;
 
-	entry = ao2_alloc_options(sizeof(*entry), pjsip_history_entry_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	entry = ao2_alloc_options(sizeof(*entry) + len + 1, pjsip_history_entry_dtor, AO2_ALLOC_OPT_LOCK_MUTEX);
 	if (!entry) {
 		return NULL;
 	}
@@ -637,24 +662,108 @@ static struct pjsip_history_entry *pjsip_history_entry_alloc(pjsip_msg *msg)
 	entry->timestamp = ast_tvnow();
 	entry->timestamp.tv_usec = 0;
 
-	entry->pool = pj_pool_create(&cachingpool.factory, NULL, PJSIP_POOL_RDATA_LEN,
-	                             PJSIP_POOL_RDATA_INC, NULL);
-	if (!entry->pool) {
-		ao2_ref(entry, -1);
+	memcpy(entry->packet, packet, len);
+	entry->packet[len] = '\0';
+	entry->len = len;
+
+	return entry;
+}
+
+/*!
+ * \brief Put an entry into its place in \ref history_ring
+ *
+ * The reference of the caller is taken, and that of the entry replaced is released.
+ */
+static void history_store(struct pjsip_history_entry *entry)
+{
+	struct pjsip_history_entry **slot = &history_ring[entry->number % HISTORY_RING_SIZE];
+	struct pjsip_history_entry *old;
+
+	ast_mutex_lock(&history_lock);
+	old = *slot;
+	if (old && old->number > entry->number) {
+		/* A newer packet took the place while this one was being captured */
+		old = entry;
+	} else {
+		*slot = entry;
+	}
+	ast_mutex_unlock(&history_lock);
+
+	ao2_cleanup(old);
+}
+
+/*!
+ * \brief Take the entries of the history, oldest first
+ *
+ * \retval NULL on error
+ * \retval A vector holding a reference to each entry on success
+ */
+static struct vector_history_t *history_snapshot(void)
+{
+	struct vector_history_t *output;
+	int first;
+	int last;
+	int number;
+
+	output = ast_malloc(sizeof(*output));
+	if (!output) {
 		return NULL;
 	}
 
-	entry->msg = pjsip_msg_clone(entry->pool, msg);
-	if (!entry->msg) {
-		ao2_ref(entry, -1);
+	if (AST_VECTOR_INIT(output, HISTORY_INITIAL_SIZE)) {
+		ast_free(output);
 		return NULL;
 	}
 
-	return entry;
+	ast_mutex_lock(&history_lock);
+	last = packet_number;
+	first = last > HISTORY_RING_SIZE ? last - HISTORY_RING_SIZE : 0;
+	for (number = first; number < last; number++) {
+		struct pjsip_history_entry *entry = history_ring[number % HISTORY_RING_SIZE];
+
+		if (!entry || entry->number != number) {
+			continue;
+		}
+
+		ao2_bump(entry);
+		if (AST_VECTOR_APPEND(output, entry)) {
+			ao2_cleanup(entry);
+		}
+	}
+	ast_mutex_unlock(&history_lock);
+
+	return output;
+}
+
+/*!
+ * \brief Parse the packets of the entries of a history vector
+ *
+ * This must be called from a registered PJSIP thread
+ */
+static int parse_history_entries(void *obj)
+{
+	struct vector_history_t *vec = obj;
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(vec); i++) {
+		struct pjsip_history_entry *entry = AST_VECTOR_GET(vec, i);
+
+		ao2_lock(entry);
+		if (!entry->pool) {
+			entry->pool = pj_pool_create(&cachingpool.factory, NULL, PJSIP_POOL_RDATA_LEN,
+			                             PJSIP_POOL_RDATA_INC, NULL);
+			if (entry->pool) {
+				entry->msg = pjsip_parse_msg(entry->pool, entry->packet, entry->len, NULL);
+			}
+		}
+		ao2_unlock(entry);
+	}
+
+	return 0;
 }
 
 /*! \brief Format single line history entry */
-static void sprint_list_entry(struct pjsip_history_entry *entry, char *line, int len)
+static void sprint_list_entry(struct pjsip_history_entry *entry, pjsip_msg *msg, char *line, int len)
 {
 	char addr[64];
 
@@ -664,17 +773,24 @@ static void sprint_list_entry(struct pjsip_history_entry *entry, char *line, int
 		pj_sockaddr_print(&entry->src, addr, sizeof(addr), 3);
 	}
 
-	if (entry->msg->type == PJSIP_REQUEST_MSG) {
+	if (!msg) {
+		snprintf(line, len, "%-5.5d %-10.10ld %-5.5s %-24.24s <unparsable %zu byte packet>",
+			entry->number,
+			entry->timestamp.tv_sec,
+			entry->transmitted ? "* ==>" : "* <==",
+			addr,
+			entry->len);
+	} else if (msg->type == PJSIP_REQUEST_MSG) {
 		char uri[128];
 
-		pjsip_uri_print(PJSIP_URI_IN_REQ_URI, entry->msg->line.req.uri, uri, sizeof(uri));
+		pjsip_uri_print(PJSIP_URI_IN_REQ_URI, msg->line.req.uri, uri, sizeof(uri));
 		snprintf(line, len, "%-5.5d %-10.10ld %-5.5s %-24.24s %.*s %s SIP/2.0",
 			entry->number,
 			entry->timestamp.tv_sec,
 			entry->transmitted ? "* ==>" : "* <==",
 			addr,
-			(int)pj_strlen(&entry->msg->line.req.method.name),
-			pj_strbuf(&entry->msg->line.req.method.name),
+			(int)pj_strlen(&msg->line.req.method.name),
+			pj_strbuf(&msg->line.req.method.name),
 			uri);
 	} else {
 		snprintf(line, len, "%-5.5d %-10.10ld %-5.5s %-24.24s SIP/2.0 %u %.*s",
@@ -682,9 +798,9 @@ static void sprint_list_entry(struct pjsip_history_entry *entry, char *line, int
 			entry->timestamp.tv_sec,
 			entry->transmitted ? "* ==>" : "* <==",
 			addr,
-			entry->msg->line.status.code,
-			(int)pj_strlen(&entry->msg->line.status.reason),
-			pj_strbuf(&entry->msg->line.status.reason));
+			msg->line.status.code,
+			(int)pj_strlen(&msg->line.status.reason),
+			pj_strbuf(&msg->line.status.reason));
 	}
 }
 
@@ -697,7 +813,7 @@ static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
 		return PJ_SUCCESS;
 	}
 
-	entry = pjsip_history_entry_alloc(tdata->msg);
+	entry = pjsip_history_entry_alloc(tdata->buf.start, tdata->buf.cur - tdata->buf.start);
 	if (!entry) {
 		return PJ_SUCCESS;
 	}
@@ -705,20 +821,15 @@ static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
 	pj_sockaddr_cp(&entry->src, &tdata->tp_info.transport->local_addr);
 	pj_sockaddr_cp(&entry->dst, &tdata->tp_info.dst_addr);
 
-	ast_mutex_lock(&history_lock);
-	if (AST_VECTOR_APPEND(&vector_history, entry)) {
-		ao2_ref(entry, -1);
-		entry = NULL;
-	}
-	ast_mutex_unlock(&history_lock);
-
-	if (log_level != -1 && entry) {
+	if (log_level != -1) {
 		char line[256];
 
-		sprint_list_entry(entry, line, sizeof(line));
+		sprint_list_entry(entry, tdata->msg, line, sizeof(line));
 		ast_log_dynamic_level(log_level, "%s\n", line);
 	}
 
+	history_store(entry);
+
 	return PJ_SUCCESS;
 }
 
@@ -735,7 +846,7 @@ static pj_bool_t history_on_rx_msg(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
-	entry = pjsip_history_entry_alloc(rdata->msg_info.msg);
+	entry = pjsip_history_entry_alloc(rdata->pkt_info.packet, rdata->msg_info.len);
 	if (!entry) {
 		return PJ_FALSE;
 	}
@@ -748,20 +859,15 @@ static pj_bool_t history_on_rx_msg(pjsip_rx_data *rdata)
 		pj_sockaddr_cp(&entry->src, &rdata->pkt_info.src_addr);
 	}
 
-	ast_mutex_lock(&history_lock);
-	if (AST_VECTOR_APPEND(&vector_history, entry)) {
-		ao2_ref(entry, -1);
-		entry = NULL;
-	}
-	ast_mutex_unlock(&history_lock);
-
-	if (log_level != -1 && entry) {
+	if (log_level != -1) {
 		char line[256];
 
-		sprint_list_entry(entry, line, sizeof(line));
+		sprint_list_entry(entry, rdata->msg_info.msg, line, sizeof(line));
 		ast_log_dynamic_level(log_level, "%s\n", line);
 	}
 
+	history_store(entry);
+
 	return PJ_FALSE;
 }
 
@@ -772,14 +878,19 @@ static void clear_history_entry_cb(struct pjsip_history_entry *entry)
 }
 
 /*!
- * \brief Remove all entries from \ref vector_history
+ * \brief Remove all entries from \ref history_ring
  *
  * This must be called from a registered PJSIP thread
  */
 static int clear_history_entries(void *obj)
 {
+	int i;
+
 	ast_mutex_lock(&history_lock);
-	AST_VECTOR_RESET(&vector_history, clear_history_entry_cb);
+	for (i = 0; i < HISTORY_RING_SIZE; i++) {
+		ao2_cleanup(history_ring[i]);
+		history_ring[i] = NULL;
+	}
 	packet_number = 0;
 	ast_mutex_unlock(&history_lock);
 
@@ -1090,11 +1201,12 @@ error:
  * \brief Create a filtered history based on a user provided expression
  *
  * \param a The CLI arguments containing the expression
+ * \param history The parsed entries of the history
  *
  * \retval NULL on error
  * \retval A vector containing the filtered history on success
  */
-static struct vector_history_t *filter_history(struct ast_cli_args *a)
+static struct vector_history_t *filter_history(struct ast_cli_args *a, struct vector_history_t *history)
 {
 	struct vector_history_t *output;
 	struct expression_token *queue;
@@ -1116,15 +1228,13 @@ static struct vector_history_t *filter_history(struct ast_cli_args *a)
 		return NULL;
 	}
 
-	ast_mutex_lock(&history_lock);
-	for (i = 0; i < AST_VECTOR_SIZE(&vector_history); i++) {
-		struct pjsip_history_entry *entry = AST_VECTOR_GET(&vector_history, i);
+	for (i = 0; i < AST_VECTOR_SIZE(history); i++) {
+		struct pjsip_history_entry *entry = AST_VECTOR_GET(history, i);
 		int res;
 
 		res = evaluate_history_entry(entry, queue);
 		if (res == -1) {
 			/* Error in expression evaluation; bail */
-			ast_mutex_unlock(&history_lock);
 			AST_VECTOR_RESET(output, clear_history_entry_cb);
 			AST_VECTOR_FREE(output);
 			ast_free(output);
@@ -1139,7 +1249,6 @@ static struct vector_history_t *filter_history(struct ast_cli_args *a)
 			}
 		}
 	}
-	ast_mutex_unlock(&history_lock);
 
 	expression_token_free(queue);
 
@@ -1150,18 +1259,6 @@ static struct vector_history_t *filter_history(struct ast_cli_args *a)
 static void display_single_entry(struct ast_cli_args *a, struct pjsip_history_entry *entry)
 {
 	char addr[64];
-	char *buf;
-
-	buf = ast_calloc(1, PJSIP_MAX_PKT_LEN * sizeof(char));
-	if (!buf) {
-		return;
-	}
-
-	if (pjsip_msg_print(entry->msg, buf, PJSIP_MAX_PKT_LEN) == -1) {
-		ast_log(LOG_WARNING, "Unable to print SIP message %d: packet too large!\n", entry->number);
-		ast_free(buf);
-		return;
-	}
 
 	if (entry->transmitted) {
 		pj_sockaddr_print(&entry->dst, addr, sizeof(addr), 3);
@@ -1174,9 +1271,7 @@ static void display_single_entry(struct ast_cli_args *a, struct pjsip_history_en
 		entry->transmitted ? "Sent to" : "Received from",
 		addr,
 		entry->timestamp.tv_sec);
-	ast_cli(a->fd, "%s\n", buf);
-
-	ast_free(buf);
+	ast_cli(a->fd, "%s\n", entry->packet);
 }
 
 /*! \brief Print a list of the entries to the CLI */
@@ -1196,7 +1291,7 @@ static void display_entry_list(struct ast_cli_args *a, struct vector_history_t *
 		char line[256];
 
 		entry = AST_VECTOR_GET(vec, i);
-		sprint_list_entry(entry, line, sizeof(line));
+		sprint_list_entry(entry, entry->msg, line, sizeof(line));
 
 		ast_cli(a->fd, "%s\n", line);
 	}
@@ -1216,7 +1311,8 @@ static int safe_vector_cleanup(void *obj)
 
 static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
-	struct vector_history_t *vec = &vector_history;
+	struct vector_history_t *history = NULL;
+	struct vector_history_t *vec = NULL;
 	struct pjsip_history_entry *entry = NULL;
 
 	if (cmd == CLI_INIT) {
@@ -1257,52 +1353,56 @@ static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli
 				return CLI_FAILURE;
 			}
 
-			/* Get the entry at the provided position */
-			ast_mutex_lock(&history_lock);
-			if (num >= AST_VECTOR_SIZE(&vector_history) || num < 0) {
-				ast_cli(a->fd, "Entry '%d' does not exist\n", num);
+			/* Get the entry with the provided number */
+			if (num >= 0) {
+				ast_mutex_lock(&history_lock);
+				entry = history_ring[num % HISTORY_RING_SIZE];
+				entry = entry && entry->number == num ? ao2_bump(entry) : NULL;
 				ast_mutex_unlock(&history_lock);
-				return CLI_FAILURE;
 			}
-			entry = ao2_bump(AST_VECTOR_GET(&vector_history, num));
-			ast_mutex_unlock(&history_lock);
-		} else if (!strcasecmp(a->argv[3], "where")) {
-			vec = filter_history(a);
-			if (!vec) {
+			if (!entry) {
+				ast_cli(a->fd, "Entry '%d' does not exist\n", num);
 				return CLI_FAILURE;
 			}
-		} else {
+		} else if (strcasecmp(a->argv[3], "where")) {
 			return CLI_SHOWUSAGE;
 		}
 	}
 
-	if (AST_VECTOR_SIZE(vec) == 1) {
-		if (vec == &vector_history) {
-			ast_mutex_lock(&history_lock);
+	if (!entry) {
+		history = history_snapshot();
+		if (!history) {
+			return CLI_FAILURE;
+		}
+		ast_sip_push_task_wait_servant(NULL, parse_history_entries, history);
+
+		if (a->argc > 3) {
+			vec = filter_history(a, history);
+			if (!vec) {
+				ast_sip_push_task(NULL, safe_vector_cleanup, history);
+				return CLI_FAILURE;
+			}
+		} else {
+			vec = history;
 		}
-		entry = ao2_bump(AST_VECTOR_GET(vec, 0));
-		if (vec == &vector_history) {
-			ast_mutex_unlock(&history_lock);
+
+		if (AST_VECTOR_SIZE(vec) == 1) {
+			entry = ao2_bump(AST_VECTOR_GET(vec, 0));
 		}
 	}
 
 	if (entry) {
 		display_single_entry(a, entry);
 	} else {
-		if (vec == &vector_history) {
-			ast_mutex_lock(&history_lock);
-		}
-
 		display_entry_list(a, vec);
-
-		if (vec == &vector_history) {
-			ast_mutex_unlock(&history_lock);
-		}
 	}
 
-	if (vec != &vector_history) {
+	if (vec && vec != history) {
 		ast_sip_push_task(NULL, safe_vector_cleanup, vec);
 	}
+	if (history) {
+		ast_sip_push_task(NULL, safe_vector_cleanup, history);
+	}
 	ao2_cleanup(entry);
 
 	return CLI_SUCCESS;
@@ -1322,8 +1422,9 @@ static char *pjsip_set_history(struct ast_cli_entry *e, int cmd, struct ast_cli_
 			"       the already received packets. Clearing the history will wipe\n"
 			"       the received packets from memory.\n\n"
 			"       As the PJSIP history is maintained in memory, and includes\n"
-			"       all received/transmitted requests and responses, it should\n"
-			"       only be enabled for debugging purposes, and cleared when done.\n";
+			"       the last 16384 received/transmitted requests and responses,\n"
+			"       it should only be enabled for debugging purposes, and cleared\n"
+			"       when done.\n";
 		return NULL;
 	} else if (cmd == CLI_GENERATE) {
 		return NULL;
@@ -1373,8 +1474,6 @@ static int load_module(void)
 
 	ast_pjproject_caching_pool_init(&cachingpool, &pj_pool_factory_default_policy, 0);
 
-	AST_VECTOR_INIT(&vector_history, HISTORY_INITIAL_SIZE);
-
 	ast_sip_register_service(&logging_module);
 	ast_cli_register_multiple(cli_pjsip, ARRAY_LEN(cli_pjsip));
 
@@ -1387,7 +1486,6 @@ static int unload_module(void)
 	ast_sip_unregister_service(&logging_module);
 
 	ast_sip_push_task_wait_servant(NULL, clear_history_entries, NULL);
-	AST_VECTOR_FREE(&vector_history);
 
 	ast_pjproject_caching_pool_destroy(&cachingpool);
 
@@ -127,6 +127,8 @@ struct mwi_subscription {
 	unsigned int is_solicited;
 	/*! True if this subscription is to be terminated */
 	unsigned int terminate;
+	/*! True while a NOTIFY is queued and not yet sent */
+	int notify_pending;
 	/*! Identifier for the subscription.
 	 * The identifier is the same as the corresponding endpoint's stasis ID.
 	 * Used as a hash key
@@ -1119,6 +1121,8 @@ static int serialized_notify(void *userdata)
 {
 	struct mwi_subscription *mwi_sub = userdata;
 
+	/* A change from now on needs another NOTIFY, and reads the counts anew */
+	ast_atomic_store_n(&mwi_sub->notify_pending, 0, __ATOMIC_SEQ_CST);
 	send_mwi_notify(mwi_sub);
 	ao2_ref(mwi_sub, -1);
 	return 0;
@@ -1146,7 +1150,17 @@ static int send_notify(void *obj, void *arg, int flags)
 		? ast_sip_subscription_get_serializer(mwi_sub->sip_sub)
 		: ast_serializer_pool_get(mwi_serializer_pool);
 
+	/*
+	 * The queued NOTIFY reads the message counts only when it is sent, so
+	 * it already carries this change.  A storm of changes to the mailboxes
+	 * then results in few NOTIFYs rather than one per change.
+	 */
+	if (ast_atomic_exchange_n(&mwi_sub->notify_pending, 1, __ATOMIC_SEQ_CST)) {
+		return 0;
+	}
+
 	if (ast_sip_push_task(serializer, serialized_notify, ao2_bump(mwi_sub))) {
+		ast_atomic_store_n(&mwi_sub->notify_pending, 0, __ATOMIC_SEQ_CST);
 		ao2_ref(mwi_sub, -1);
 	}
 
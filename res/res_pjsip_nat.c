@@ -255,7 +255,7 @@ static int find_transport_state_in_use(void *obj, void *arg, int flags)
 	/* If an explicit transport or factory matches then this is what is in use, if we are unavailable
 	 * to compare based on that we make sure that the type is the same and the source IP address/port are the same
 	 */
-	if (transport_state && ((details->transport && details->transport == transport_state->transport) ||
+	if (transport_state && ((details->transport && ast_sip_transport_state_has_transport(transport_state, details->transport)) ||
 		(details->factory && details->factory == transport_state->factory) ||
 		((details->type == transport_state->type) && (transport_state->factory) &&
 			!pj_strcmp(&transport_state->factory->addr_name.host, &details->local_address) &&
@@ -247,6 +247,20 @@ AST_THREADSTORAGE(register_callback_invoked);
 /*! \brief Amount of buffer time (in seconds) before expiration that we re-register at */
 #define REREGISTER_BUFFER_TIME 10
 
+/*!
+ * \brief Re-registrations are spread over this fraction of the expiration before the buffer time
+ *
+ * So that registrations which were sent together, such as on start up, do not
+ * keep refreshing together.
+ */
+#define REREGISTER_SPREAD 10
+
+/*! \brief Most initial registrations sent a second, so that they are not all sent at once on start up */
+#define REGISTRATION_RAMP_RATE 100
+
+/*! \brief Number of serializers the registrations are spread over */
+#define REGISTRATION_SERIALIZERS 32
+
 /*! \brief Size of the buffer for creating a unique string for the line */
 #define LINE_PARAMETER_SIZE 8
 
@@ -400,6 +414,20 @@ struct sip_outbound_registration_state {
 /*! Shutdown group to monitor sip_outbound_registration_client_state serializers. */
 static struct ast_serializer_shutdown_group *shutdown_group;
 
+/*!
+ * \brief Serializers shared by the registrations, picked by the hash of their name
+ *
+ * Each client state keeps a reference to its serializer, so the shutdown group
+ * still waits for every client state to be destroyed.
+ */
+static struct ast_taskprocessor *registration_serializers[REGISTRATION_SERIALIZERS];
+
+/*! \brief Lock for \ref ramp_next */
+AST_MUTEX_DEFINE_STATIC(ramp_lock);
+
+/*! \brief When the next initial registration may be sent */
+static struct timeval ramp_next;
+
 /*! \brief Default number of state container buckets */
 #define DEFAULT_STATE_BUCKETS 53
 static AO2_GLOBAL_OBJ_STATIC(current_states);
@@ -678,19 +706,18 @@ static void sip_outbound_registration_timer_cb(pj_timer_heap_t *timer_heap, stru
 	}
 }
 
-/*! \brief Helper function which sets up the timer to re-register in a specific amount of time */
-static void schedule_registration(struct sip_outbound_registration_client_state *client_state, unsigned int seconds)
+/*! \brief Helper function which sets up the timer to re-register after a delay */
+static void schedule_registration_delay(struct sip_outbound_registration_client_state *client_state, pj_time_val delay)
 {
-	pj_time_val delay = { .sec = seconds, };
 	pjsip_regc_info info;
 
 	cancel_registration(client_state);
 
 	pjsip_regc_get_info(client_state->client, &info);
-	ast_debug(1, "Scheduling outbound registration to server '%.*s' from client '%.*s' in %d seconds\n",
+	ast_debug(1, "Scheduling outbound registration to server '%.*s' from client '%.*s' in %ld.%03ld seconds\n",
 			(int) info.server_uri.slen, info.server_uri.ptr,
 			(int) info.client_uri.slen, info.client_uri.ptr,
-			seconds);
+			(long) delay.sec, (long) delay.msec);
 
 	ao2_ref(client_state, +1);
 	if (pjsip_endpt_schedule_timer(ast_sip_get_pjsip_endpoint(), &client_state->timer, &delay) != PJ_SUCCESS) {
@@ -701,6 +728,45 @@ static void schedule_registration(struct sip_outbound_registration_client_state
 	}
 }
 
+/*! \brief Helper function which sets up the timer to re-register in a specific amount of time */
+static void schedule_registration(struct sip_outbound_registration_client_state *client_state, unsigned int seconds)
+{
+	pj_time_val delay = { .sec = seconds, };
+
+	schedule_registration_delay(client_state, delay);
+}
+
+/*!
+ * \brief Sets up the timer of an initial registration
+ *
+ * The registration is sent after a random delay of one to ten seconds, but
+ * no sooner than REGISTRATION_RAMP_RATE allows after the registrations
+ * scheduled before it, so that thousands of registrations applied together
+ * reach the registrars at a steady rate.
+ */
+static void schedule_initial_registration(struct sip_outbound_registration_client_state *client_state)
+{
+	struct timeval now = ast_tvnow();
+	struct timeval start;
+	int64_t ms;
+	pj_time_val delay;
+
+	start = ast_tvadd(now, ast_samp2tv(1000 + ast_random() % 9000, 1000));
+
+	ast_mutex_lock(&ramp_lock);
+	if (ast_tvcmp(ramp_next, start) > 0) {
+		start = ramp_next;
+	}
+	ramp_next = ast_tvadd(start, ast_samp2tv(1, REGISTRATION_RAMP_RATE));
+	ast_mutex_unlock(&ramp_lock);
+
+	ms = ast_tvdiff_ms(start, now);
+	delay.sec = ms / 1000;
+	delay.msec = ms % 1000;
+
+	schedule_registration_delay(client_state, delay);
+}
+
 static void update_client_state_status(struct sip_outbound_registration_client_state *client_state, enum sip_outbound_registration_status status)
 {
 	const char *status_old;
@@ -1085,7 +1151,8 @@ static int handle_registration_response(void *data)
 			ast_debug(1, "Outbound registration to '%s' with client '%s' successful\n", server_uri, client_uri);
 			update_client_state_status(response->client_state, SIP_REGISTRATION_REGISTERED);
 			response->client_state->retries = 0;
-			next_registration_round = response->expiration - REREGISTER_BUFFER_TIME;
+			next_registration_round = response->expiration - REREGISTER_BUFFER_TIME
+				- ast_random() % (response->expiration / REREGISTER_SPREAD + 1);
 			if (next_registration_round < 0) {
 				/* Re-register immediately. */
 				next_registration_round = 0;
@@ -1258,7 +1325,7 @@ static void sip_outbound_registration_client_state_destroy(void *obj)
 static struct sip_outbound_registration_state *sip_outbound_registration_state_alloc(struct sip_outbound_registration *registration)
 {
 	struct sip_outbound_registration_state *state;
-	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	unsigned int serializer;
 
 	state = ao2_alloc(sizeof(*state), sip_outbound_registration_state_destroy);
 	if (!state) {
@@ -1288,12 +1355,9 @@ static struct sip_outbound_registration_state *sip_outbound_registration_state_a
 		return NULL;
 	}
 
-	/* Create name with seq number appended. */
-	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/outreg/%s",
-		ast_sorcery_object_get_id(registration));
-
-	state->client_state->serializer = ast_sip_create_serializer_group(tps_name,
-		shutdown_group);
+	serializer = (unsigned int) ast_str_hash(ast_sorcery_object_get_id(registration))
+		% REGISTRATION_SERIALIZERS;
+	state->client_state->serializer = ao2_bump(registration_serializers[serializer]);
 	if (!state->client_state->serializer) {
 		ao2_cleanup(state);
 		return NULL;
@@ -1677,7 +1741,7 @@ static int sip_outbound_registration_perform(void *data)
 
 	pjsip_regc_update_expires(state->client_state->client, registration->expiration);
 
-	schedule_registration(state->client_state, (ast_random() % 10) + 1);
+	schedule_initial_registration(state->client_state);
 
 	ao2_ref(registration, -1);
 	ao2_ref(state, -1);
@@ -2405,6 +2469,7 @@ static void network_change_stasis_cb(void *data, struct stasis_subscription *sub
 static int unload_module(void)
 {
 	int remaining;
+	int i;
 
 	network_change_sub = stasis_unsubscribe_and_join(network_change_sub);
 
@@ -2427,6 +2492,10 @@ static int unload_module(void)
 
 	ast_sip_transport_monitor_unregister_all(registration_transport_shutdown_cb, NULL, NULL);
 
+	for (i = 0; i < REGISTRATION_SERIALIZERS; i++) {
+		registration_serializers[i] = ast_taskprocessor_unreference(registration_serializers[i]);
+	}
+
 	/* Wait for registration serializers to get destroyed. */
 	ast_debug(2, "Waiting for registration transactions to complete for unload.\n");
 	remaining = ast_serializer_shutdown_group_join(shutdown_group, MAX_UNLOAD_TIMEOUT_TIME);
@@ -2452,12 +2521,26 @@ static int unload_module(void)
 static int load_module(void)
 {
 	struct ao2_container *new_states;
+	int i;
 
 	shutdown_group = ast_serializer_shutdown_group_alloc();
 	if (!shutdown_group) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	for (i = 0; i < REGISTRATION_SERIALIZERS; i++) {
+		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		/* Create name with seq number appended. */
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/outreg/%d", i);
+
+		registration_serializers[i] = ast_sip_create_serializer_group(tps_name, shutdown_group);
+		if (!registration_serializers[i]) {
+			unload_module();
+			return AST_MODULE_LOAD_DECLINE;
+		}
+	}
+
 	/* Create outbound registration states container. */
 	new_states = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
 		DEFAULT_STATE_BUCKETS, registration_state_hash, NULL, registration_state_cmp);
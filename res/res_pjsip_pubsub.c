@@ -447,6 +447,8 @@ struct sip_subscription_tree {
 	int notify_sched_id;
 	/*! Indicator if scheduled batched notification should be sent */
 	unsigned int send_scheduled_notify;
+	/*! When the last NOTIFY was sent, to coalesce the following ones */
+	struct timeval last_notify;
 	/*! The root of the subscription tree */
 	struct ast_sip_subscription *root;
 	/*! Is this subscription to a list? */
@@ -2453,6 +2455,7 @@ static int send_notify(struct sip_subscription_tree *sub_tree, unsigned int forc
 	}
 
 	sub_tree->send_scheduled_notify = 0;
+	sub_tree->last_notify = ast_tvnow();
 
 	return 0;
 }
@@ -2507,7 +2510,7 @@ static int sched_cb(const void *data)
 	return 0;
 }
 
-static int schedule_notification(struct sip_subscription_tree *sub_tree)
+static int schedule_notification(struct sip_subscription_tree *sub_tree, int delay)
 {
 	/* There's already a notification scheduled */
 	if (sub_tree->notify_sched_id > -1) {
@@ -2515,7 +2518,7 @@ static int schedule_notification(struct sip_subscription_tree *sub_tree)
 	}
 
 	sub_tree->send_scheduled_notify = 1;
-	sub_tree->notify_sched_id = ast_sched_add(sched, sub_tree->notification_batch_interval, sched_cb, ao2_bump(sub_tree));
+	sub_tree->notify_sched_id = ast_sched_add(sched, delay, sched_cb, ao2_bump(sub_tree));
 	if (sub_tree->notify_sched_id < 0) {
 		ao2_cleanup(sub_tree);
 		return -1;
@@ -2524,9 +2527,38 @@ static int schedule_notification(struct sip_subscription_tree *sub_tree)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Determine how long to hold back a NOTIFY to coalesce it with later ones
+ *
+ * \param sub_tree The subscription tree, not to a list
+ *
+ * \retval 0 if the NOTIFY can be sent now
+ * \retval The delay in milliseconds otherwise
+ */
+static int notification_coalesce_delay(struct sip_subscription_tree *sub_tree)
+{
+	unsigned int interval = ast_sip_get_notification_coalesce_interval();
+	int64_t elapsed;
+
+	if (!interval) {
+		return 0;
+	}
+
+	/* A NOTIFY held back already carries the latest state when sent */
+	if (sub_tree->notify_sched_id > -1) {
+		return interval;
+	}
+
+	elapsed = ast_tvdiff_ms(ast_tvnow(), sub_tree->last_notify);
+
+	return elapsed < interval ? interval - elapsed : 0;
+}
+
 int ast_sip_subscription_notify(struct ast_sip_subscription *sub, struct ast_sip_body_data *notify_data,
 		int terminate)
 {
+	int delay;
 	int res;
 	pjsip_dialog *dlg = sub->tree->dlg;
 
@@ -2550,7 +2582,9 @@ int ast_sip_subscription_notify(struct ast_sip_subscription *sub, struct ast_sip
 	}
 
 	if (sub->tree->notification_batch_interval) {
-		res = schedule_notification(sub->tree);
+		res = schedule_notification(sub->tree, sub->tree->notification_batch_interval);
+	} else if (!terminate && (delay = notification_coalesce_delay(sub->tree))) {
+		res = schedule_notification(sub->tree, delay);
 	} else {
 		/* See the note in pubsub_on_rx_refresh() for why sub->tree is refbumped here */
 		ao2_ref(sub->tree, +1);
@@ -36,6 +36,7 @@
 #include "asterisk/taskprocessor.h"
 #include "asterisk/manager.h"
 #include "asterisk/named_locks.h"
+#include "asterisk/heap.h"
 #include "asterisk/res_pjproject.h"
 #include "res_pjsip/include/res_pjsip_private.h"
 
@@ -1239,6 +1240,123 @@ static pthread_t check_thread = AST_PTHREADT_NULL;
 /*! \brief The global interval at which to check for contact expiration */
 static unsigned int check_interval;
 
+/*!
+ * \brief Every how many intervals all contacts are searched for expired ones
+ *
+ * Contacts are normally found through the expiration heap, but those that
+ * were not created or updated on this system (such as by another system
+ * sharing the same realtime backend) are only found by searching.
+ */
+#define CONTACT_EXPIRATION_SWEEP 10
+
+/*! \brief Buckets for the contacts in the expiration heap */
+#define CONTACT_EXPIRATION_BUCKETS 1021
+
+/*! \brief When a contact expires, as kept in the expiration heap */
+struct contact_expiration {
+	/*! When the contact expires */
+	struct timeval expiration;
+	/*! Position in the expiration heap */
+	ssize_t __heap_index;
+	/*! Sorcery id of the contact */
+	char id[0];
+};
+
+AO2_STRING_FIELD_HASH_FN(contact_expiration, id);
+AO2_STRING_FIELD_CMP_FN(contact_expiration, id);
+
+/*! \brief Contacts ordered by when they expire, soonest first */
+static struct ast_heap *expiration_heap;
+
+/*! \brief Contacts in the expiration heap by id, protected by the heap lock */
+static struct ao2_container *expirations;
+
+static int contact_expiration_cmp(void *a, void *b)
+{
+	struct contact_expiration *left = a;
+	struct contact_expiration *right = b;
+
+	return ast_tvcmp(right->expiration, left->expiration);
+}
+
+/*!
+ * \internal
+ * \brief Add or move a contact in the expiration heap
+ */
+static void contact_expiration_set(const struct ast_sip_contact *contact)
+{
+	const char *id = ast_sorcery_object_get_id(contact);
+	struct contact_expiration *entry;
+
+	if (ast_tvzero(contact->expiration_time)) {
+		return;
+	}
+
+	ast_heap_wrlock(expiration_heap);
+	entry = ao2_find(expirations, id, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (entry) {
+		ast_heap_remove(expiration_heap, entry);
+	} else {
+		entry = ao2_alloc_options(sizeof(*entry) + strlen(id) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!entry) {
+			ast_heap_unlock(expiration_heap);
+			return;
+		}
+		strcpy(entry->id, id); /* Safe */
+		ao2_link_flags(expirations, entry, OBJ_NOLOCK);
+	}
+	entry->expiration = contact->expiration_time;
+	if (ast_heap_push(expiration_heap, entry)) {
+		ao2_unlink_flags(expirations, entry, OBJ_NOLOCK);
+	}
+	ast_heap_unlock(expiration_heap);
+
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Remove a contact from the expiration heap
+ */
+static void contact_expiration_remove(const struct ast_sip_contact *contact)
+{
+	struct contact_expiration *entry;
+
+	ast_heap_wrlock(expiration_heap);
+	entry = ao2_find(expirations, ast_sorcery_object_get_id(contact),
+		OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (entry) {
+		ast_heap_remove(expiration_heap, entry);
+		ao2_ref(entry, -1);
+	}
+	ast_heap_unlock(expiration_heap);
+}
+
+static void contact_expiration_created(const void *object)
+{
+	contact_expiration_set(object);
+}
+
+static void contact_expiration_deleted(const void *object)
+{
+	contact_expiration_remove(object);
+}
+
+/*! \brief Observer which keeps the expiration heap in step with the contacts */
+static struct ast_sorcery_observer contact_expiration_observer = {
+	.created = contact_expiration_created,
+	.updated = contact_expiration_created,
+	.deleted = contact_expiration_deleted,
+};
+
+static int contact_expiration_add(void *obj, void *arg, int flags)
+{
+	contact_expiration_set(obj);
+
+	return 0;
+}
+
 /*! \brief Callback function which deletes a contact */
 static int expire_contact(void *obj, void *arg, int flags)
 {
@@ -1264,28 +1382,94 @@ static int expire_contact(void *obj, void *arg, int flags)
 	return 0;
 }
 
-static void *check_expiration_thread(void *data)
+/*!
+ * \internal
+ * \brief Delete the contacts at the top of the expiration heap which have expired
+ */
+static void expire_heap_contacts(void)
+{
+	struct timeval now = ast_tvnow();
+	struct contact_expiration *entry;
+	int checked = 0;
+
+	for (;;) {
+		struct ast_sip_contact *contact;
+
+		ast_heap_wrlock(expiration_heap);
+		entry = ast_heap_peek(expiration_heap, 1);
+		if (!entry || ast_tvcmp(entry->expiration, now) > 0) {
+			ast_heap_unlock(expiration_heap);
+			break;
+		}
+		ast_heap_pop(expiration_heap);
+		ao2_unlink_flags(expirations, entry, OBJ_NOLOCK);
+		ast_heap_unlock(expiration_heap);
+
+		/* The contact may have been renewed or removed since it was last seen */
+		contact = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "contact", entry->id);
+		if (contact) {
+			expire_contact(contact, NULL, 0);
+			if (ast_tvdiff_ms(contact->expiration_time, now) > 0) {
+				contact_expiration_set(contact);
+			}
+			ao2_ref(contact, -1);
+			++checked;
+		}
+		ao2_ref(entry, -1);
+	}
+
+	if (checked) {
+		ast_debug(3, "Checked %d contacts from the expiration heap\n", checked);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Search all contacts for those which have expired and delete them
+ */
+static void expire_contacts_sweep(void)
 {
 	struct ao2_container *contacts;
 	struct ast_variable *var;
-	char *time = alloca(64);
+	char time[64];
 
-	while (check_interval) {
-		sleep(check_interval);
+	snprintf(time, sizeof(time), "%ld", ast_tvnow().tv_sec);
+	var = ast_variable_new("expiration_time <=", time, "");
 
-		sprintf(time, "%ld", ast_tvnow().tv_sec);
-		var = ast_variable_new("expiration_time <=", time, "");
+	contacts = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "contact",
+		AST_RETRIEVE_FLAG_MULTIPLE, var);
 
-		ast_debug(4, "Woke up at %s  Interval: %d\n", time, check_interval);
+	ast_variables_destroy(var);
+	if (contacts) {
+		ast_debug(3, "Expiring %d contacts\n", ao2_container_count(contacts));
+		ao2_callback(contacts, OBJ_NODATA, expire_contact, NULL);
+		ao2_ref(contacts, -1);
+	}
+}
 
-		contacts = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "contact",
-			AST_RETRIEVE_FLAG_MULTIPLE, var);
+static void *check_expiration_thread(void *data)
+{
+	struct ao2_container *contacts;
+	unsigned int sweep = 0;
 
-		ast_variables_destroy(var);
-		if (contacts) {
-			ast_debug(3, "Expiring %d contacts\n", ao2_container_count(contacts));
-			ao2_callback(contacts, OBJ_NODATA, expire_contact, NULL);
-			ao2_ref(contacts, -1);
+	/* Contacts which existed before the observer was added are not in the heap yet */
+	contacts = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "contact",
+		AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (contacts) {
+		ao2_callback(contacts, OBJ_NODATA, contact_expiration_add, NULL);
+		ao2_ref(contacts, -1);
+	}
+
+	while (check_interval) {
+		sleep(check_interval);
+
+		ast_debug(4, "Woke up at %ld  Interval: %d\n", (long) ast_tvnow().tv_sec, check_interval);
+
+		if (++sweep >= CONTACT_EXPIRATION_SWEEP) {
+			sweep = 0;
+			expire_contacts_sweep();
+		} else {
+			expire_heap_contacts();
 		}
 	}
 
@@ -1342,6 +1526,23 @@ static int load_module(void)
 	ast_manager_register_xml(AMI_SHOW_REGISTRATION_CONTACT_STATUSES, EVENT_FLAG_SYSTEM,
 				 ami_show_registration_contact_statuses);
 
+	expiration_heap = ast_heap_create(8, contact_expiration_cmp,
+		offsetof(struct contact_expiration, __heap_index));
+	expirations = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		CONTACT_EXPIRATION_BUCKETS, contact_expiration_hash_fn, NULL, contact_expiration_cmp_fn);
+	if (!expiration_heap || !expirations) {
+		ao2_cleanup(expirations);
+		expirations = NULL;
+		if (expiration_heap) {
+			expiration_heap = ast_heap_destroy(expiration_heap);
+		}
+		ast_manager_unregister(AMI_SHOW_REGISTRATIONS);
+		ast_manager_unregister(AMI_SHOW_REGISTRATION_CONTACT_STATUSES);
+		ast_sip_unregister_service(&registrar_module);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "contact", &contact_expiration_observer);
+
 	ast_sorcery_observer_add(ast_sip_get_sorcery(), "global", &expiration_global_observer);
 	ast_sorcery_reload_object(ast_sip_get_sorcery(), "global");
 
@@ -1359,6 +1560,10 @@ static int unload_module(void)
 	}
 
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "global", &expiration_global_observer);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "contact", &contact_expiration_observer);
+	ao2_cleanup(expirations);
+	expirations = NULL;
+	expiration_heap = ast_heap_destroy(expiration_heap);
 
 	ast_manager_unregister(AMI_SHOW_REGISTRATIONS);
 	ast_manager_unregister(AMI_SHOW_REGISTRATION_CONTACT_STATUSES);
@@ -66,6 +66,37 @@ static struct ast_sockaddr address_rtp;
 static const char STR_AUDIO[] = "audio";
 static const char STR_VIDEO[] = "video";
 
+/*! \brief Number of buckets for the fmtp cache */
+#define FMTP_CACHE_BUCKETS 61
+
+/*! \brief Most fmtp values cached before the cache is emptied */
+#define FMTP_CACHE_MAX 512
+
+/*!
+ * \brief A cached fmtp value of a format
+ *
+ * Formats are immutable, setting an attribute creates a new one, so the
+ * value generated for a format and payload code never changes. The cache
+ * holds a reference to the format so its address is not reused while cached.
+ */
+struct fmtp_cache_entry {
+	/*! The format the value was generated for */
+	struct ast_format *format;
+	/*! The payload code the value was generated for */
+	int rtp_code;
+	/*! The fmtp value, empty if the format has none */
+	char value[0];
+};
+
+/*! \brief Key of an fmtp cache lookup */
+struct fmtp_cache_key {
+	struct ast_format *format;
+	int rtp_code;
+};
+
+/*! \brief The fmtp values generated for formats offered or answered so far */
+static struct ao2_container *fmtp_cache;
+
 static int send_keepalive(const void *data)
 {
 	struct ast_sip_session_media *session_media = (struct ast_sip_session_media *) data;
@@ -252,6 +283,7 @@ static int create_rtp(struct ast_sip_session *session, struct ast_sip_session_me
 
 	ast_rtp_instance_set_prop(session_media->rtp, AST_RTP_PROPERTY_NAT, session->endpoint->media.rtp.symmetric);
 	ast_rtp_instance_set_prop(session_media->rtp, AST_RTP_PROPERTY_ASYMMETRIC_CODEC, session->endpoint->asymmetric_rtp_codec);
+	ast_rtp_instance_set_prop(session_media->rtp, AST_RTP_PROPERTY_RTCP_NO_PUBLISH, !session->endpoint->media.rtcp_publish);
 
 	if (!session->endpoint->media.rtp.ice_support && (ice = ast_rtp_instance_get_ice(session_media->rtp))) {
 		ice->stop(session_media->rtp);
@@ -550,14 +582,72 @@ static pjmedia_sdp_attr* generate_rtpmap_attr(struct ast_sip_session *session, p
 	return attr;
 }
 
-static pjmedia_sdp_attr* generate_fmtp_attr(pj_pool_t *pool, struct ast_format *format, int rtp_code)
+static int fmtp_cache_hash(const void *obj, const int flags)
 {
-	struct ast_str *fmtp0 = ast_str_alloca(256);
-	pj_str_t fmtp1;
-	pjmedia_sdp_attr *attr = NULL;
+	const struct fmtp_cache_entry *entry;
+	const struct fmtp_cache_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return (int) (((uintptr_t) key->format >> 4) ^ key->rtp_code);
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		return (int) (((uintptr_t) entry->format >> 4) ^ entry->rtp_code);
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int fmtp_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct fmtp_cache_entry *entry = obj;
+	const struct fmtp_cache_entry *right_entry;
+	const struct fmtp_cache_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = arg;
+		return (entry->format == key->format && entry->rtp_code == key->rtp_code) ? CMP_MATCH : 0;
+	case OBJ_SEARCH_OBJECT:
+		right_entry = arg;
+		return (entry->format == right_entry->format && entry->rtp_code == right_entry->rtp_code) ? CMP_MATCH : 0;
+	default:
+		return 0;
+	}
+}
+
+static void fmtp_cache_entry_destroy(void *obj)
+{
+	struct fmtp_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->format);
+}
+
+/*!
+ * \brief Get the fmtp value of a format, generating and caching it if needed
+ *
+ * \return The cache entry, which must be unreferenced, or NULL on failure
+ */
+static struct fmtp_cache_entry *fmtp_cache_get(struct ast_format *format, int rtp_code)
+{
+	struct fmtp_cache_key key = { .format = format, .rtp_code = rtp_code, };
+	struct ast_str *fmtp0;
+	struct fmtp_cache_entry *entry;
+	struct fmtp_cache_entry *existing;
+	const char *value;
 	char *tmp;
 
+	entry = ao2_find(fmtp_cache, &key, OBJ_SEARCH_KEY);
+	if (entry) {
+		return entry;
+	}
+
+	fmtp0 = ast_str_alloca(256);
 	ast_format_generate_sdp_fmtp(format, rtp_code, &fmtp0);
+	value = "";
 	if (ast_str_strlen(fmtp0)) {
 		tmp = ast_str_buffer(fmtp0) + ast_str_strlen(fmtp0) - 1;
 		/* remove any carriage return line feeds */
@@ -566,12 +656,53 @@ static pjmedia_sdp_attr* generate_fmtp_attr(pj_pool_t *pool, struct ast_format *
 		/* ast...generate gives us everything, just need value */
 		tmp = strchr(ast_str_buffer(fmtp0), ':');
 		if (tmp && tmp[1] != '\0') {
-			fmtp1 = pj_str(tmp + 1);
+			value = tmp + 1;
 		} else {
-			fmtp1 = pj_str(ast_str_buffer(fmtp0));
+			value = ast_str_buffer(fmtp0);
 		}
-		attr = pjmedia_sdp_attr_create(pool, "fmtp", &fmtp1);
 	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(value) + 1, fmtp_cache_entry_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return NULL;
+	}
+	entry->format = ao2_bump(format);
+	entry->rtp_code = rtp_code;
+	strcpy(entry->value, value); /* Safe */
+
+	ao2_wrlock(fmtp_cache);
+	/* Formats created for a single call would otherwise accumulate */
+	if (ao2_container_count(fmtp_cache) >= FMTP_CACHE_MAX) {
+		ao2_callback(fmtp_cache, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK, NULL, NULL);
+	}
+	existing = ao2_find(fmtp_cache, &key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!existing) {
+		ao2_link_flags(fmtp_cache, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(fmtp_cache);
+	ao2_cleanup(existing);
+
+	return entry;
+}
+
+static pjmedia_sdp_attr* generate_fmtp_attr(pj_pool_t *pool, struct ast_format *format, int rtp_code)
+{
+	struct fmtp_cache_entry *entry;
+	pj_str_t fmtp1;
+	pjmedia_sdp_attr *attr = NULL;
+
+	entry = fmtp_cache_get(format, rtp_code);
+	if (!entry) {
+		return NULL;
+	}
+
+	if (!ast_strlen_zero(entry->value)) {
+		/* The attribute value is copied into the pool */
+		attr = pjmedia_sdp_attr_create(pool, "fmtp", pj_cstr(&fmtp1, entry->value));
+	}
+	ao2_ref(entry, -1);
+
 	return attr;
 }
 
@@ -2148,6 +2279,9 @@ static int unload_module(void)
 		ast_sched_context_destroy(sched);
 	}
 
+	ao2_cleanup(fmtp_cache);
+	fmtp_cache = NULL;
+
 	return 0;
 }
 
@@ -2169,7 +2303,7 @@ static int load_module(void)
 		ast_sockaddr_parse(&address_rtp, "0.0.0.0", 0);
 	}
 
-	if (!(sched = ast_sched_context_create())) {
+	if (!(sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Unable to create scheduler context.\n");
 		goto end;
 	}
@@ -2179,6 +2313,13 @@ static int load_module(void)
 		goto end;
 	}
 
+	fmtp_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, FMTP_CACHE_BUCKETS,
+		fmtp_cache_hash, NULL, fmtp_cache_cmp);
+	if (!fmtp_cache) {
+		ast_log(LOG_ERROR, "Unable to create fmtp cache.\n");
+		goto end;
+	}
+
 	if (ast_sip_session_register_sdp_handler(&audio_sdp_handler, STR_AUDIO)) {
 		ast_log(LOG_ERROR, "Unable to register SDP handler for %s stream type\n", STR_AUDIO);
 		goto end;
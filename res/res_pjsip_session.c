@@ -49,6 +49,7 @@
 #include "asterisk/test.h"
 #include "asterisk/stream.h"
 #include "asterisk/vector.h"
+#include "asterisk/trace_span.h"
 
 #define SDP_HANDLER_BUCKETS 11
 
@@ -2249,6 +2250,7 @@ struct ast_sip_session *ast_sip_session_alloc(struct ast_sip_endpoint *endpoint,
 	RAII_VAR(struct ast_sip_session *, session, NULL, ao2_cleanup);
 	struct ast_sip_session *ret_session;
 	int dsp_features = 0;
+	AST_TRACE_SPAN_BEGIN(span);
 
 	session = ao2_alloc(sizeof(*session), session_destructor);
 	if (!session) {
@@ -2337,6 +2339,13 @@ struct ast_sip_session *ast_sip_session_alloc(struct ast_sip_endpoint *endpoint,
 	/* Fire seesion begin handlers */
 	handle_session_begin(session);
 
+	if (span && inv_session->dlg) {
+		char call_id[64];
+
+		ast_copy_pj_str(call_id, &inv_session->dlg->call_id->id, sizeof(call_id));
+		AST_TRACE_SPAN_END(span, "pjsip_session_creation", call_id);
+	}
+
 	/* Avoid unnecessary ref manipulation to return a session */
 	ret_session = session;
 	session = NULL;
@@ -33,11 +33,23 @@
 #include <pjsip_ua.h>
 
 #include "asterisk/module.h"
+#include "asterisk/alertpipe.h"
 #include "asterisk/http_websocket.h"
 #include "asterisk/res_pjsip.h"
 #include "asterisk/res_pjsip_session.h"
 #include "asterisk/taskprocessor.h"
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+/*! \brief Connections are read without a thread of their own */
+#define WS_TRANSPORT_POLL
+#endif
+
+/*! Most messages read from a connection before letting others be read */
+#define WS_READ_BURST 16
+/*! Connections the poll thread handles per wakeup */
+#define WS_POLL_EVENTS 64
+
 static int transport_type_wss;
 static int transport_type_wss_ipv6;
 
@@ -53,6 +65,8 @@ struct ws_transport {
 	pjsip_transport transport;
 	pjsip_rx_data rdata;
 	struct ast_websocket *ws_session;
+	/*! The serializer the messages of the connection are received on */
+	struct ast_taskprocessor *serializer;
 };
 
 /*!
@@ -105,6 +119,10 @@ static void transport_dtor(void *arg)
 		ast_websocket_unref(wstransport->ws_session);
 	}
 
+	if (wstransport->serializer) {
+		ast_taskprocessor_unreference(wstransport->serializer);
+	}
+
 	if (wstransport->transport.ref_cnt) {
 		pj_atomic_destroy(wstransport->transport.ref_cnt);
 	}
@@ -356,6 +374,192 @@ static struct ast_taskprocessor *create_websocket_serializer(void)
 	return ast_sip_create_serializer(tps_name);
 }
 
+#ifdef WS_TRANSPORT_POLL
+/*!
+ * \brief The connections waiting for a message
+ *
+ * \details One thread waits for all of them with epoll, and reads the
+ * messages that arrive on the serializer of their transport.  A transport
+ * waiting is registered for a single event, so only one read of it is in
+ * progress, which registers it again when done.
+ */
+static struct {
+	int epfd;
+	/*! Wakes the poll thread up to exit */
+	int alert_pipe[2];
+	pthread_t thread;
+	/*! Set when the poll thread should exit */
+	int stop;
+} ws_poll = {
+	.epfd = -1,
+	.alert_pipe = { -1, -1 },
+	.thread = AST_PTHREADT_NULL,
+};
+
+/*!
+ * \internal
+ * \brief Have the poll thread wait for the next message of a transport
+ *
+ * \param transport The transport, its reference is kept by the poll thread
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int ws_poll_wait(struct ws_transport *transport)
+{
+	struct epoll_event event = {
+		.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT,
+		.data.ptr = transport,
+	};
+	int fd = ast_websocket_fd(transport->ws_session);
+
+	if (ws_poll.epfd < 0) {
+		return -1;
+	}
+
+	if (!epoll_ctl(ws_poll.epfd, EPOLL_CTL_MOD, fd, &event)) {
+		return 0;
+	}
+
+	return errno == ENOENT ? epoll_ctl(ws_poll.epfd, EPOLL_CTL_ADD, fd, &event) : -1;
+}
+
+/*!
+ * \internal
+ * \brief Stop waiting for messages of a transport, and shut it down
+ *
+ * \note Runs on the serializer of the transport, taking the reference the
+ * poll thread had.
+ */
+static void transport_read_done(struct ws_transport *transport)
+{
+	if (ws_poll.epfd >= 0) {
+		epoll_ctl(ws_poll.epfd, EPOLL_CTL_DEL, ast_websocket_fd(transport->ws_session), NULL);
+	}
+	transport_shutdown(transport);
+}
+
+/*!
+ * \internal
+ * \brief Read the messages that arrived on a transport
+ *
+ * \note Runs on the serializer of the transport, the poll thread having
+ * handed the transport over.
+ */
+static int transport_read_ready(void *data)
+{
+	struct ws_transport *transport = data;
+	struct ast_websocket *session = transport->ws_session;
+	struct transport_read_data read_data = { .transport = transport, };
+	int count;
+
+	for (count = 0; count < WS_READ_BURST; ++count) {
+		enum ast_websocket_opcode opcode;
+		int fragmented;
+
+		if (count && ast_websocket_wait_for_input(session, 0) <= 0) {
+			break;
+		}
+
+		if (ast_websocket_read(session, &read_data.payload, &read_data.payload_len, &opcode, &fragmented)) {
+			transport_read_done(transport);
+			return 0;
+		}
+
+		if (opcode == AST_WEBSOCKET_OPCODE_TEXT || opcode == AST_WEBSOCKET_OPCODE_BINARY) {
+			if (read_data.payload_len) {
+				transport_read(&read_data);
+			}
+		} else if (opcode == AST_WEBSOCKET_OPCODE_CLOSE) {
+			transport_read_done(transport);
+			return 0;
+		}
+	}
+
+	if (count == WS_READ_BURST && ast_websocket_wait_for_input(session, 0) > 0) {
+		/* Let the other transports of the serializers be read first */
+		if (!ast_sip_push_task(transport->serializer, transport_read_ready, transport)) {
+			return 0;
+		}
+	} else if (!ws_poll_wait(transport)) {
+		return 0;
+	}
+
+	transport_read_done(transport);
+	return 0;
+}
+
+static void *ws_poll_thread(void *data)
+{
+	struct epoll_event events[WS_POLL_EVENTS];
+	int count;
+	int i;
+
+	while (!ws_poll.stop) {
+		count = epoll_wait(ws_poll.epfd, events, ARRAY_LEN(events), -1);
+		if (count < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_WARNING, "WebSocket transport wait failed: %s\n", strerror(errno));
+			}
+			continue;
+		}
+
+		for (i = 0; i < count; ++i) {
+			struct ws_transport *transport = events[i].data.ptr;
+
+			if (!transport) {
+				ast_alertpipe_read(ws_poll.alert_pipe);
+				continue;
+			}
+			if (ast_sip_push_task(transport->serializer, transport_read_ready, transport)) {
+				/* Try again when the next event is reported */
+				ast_log(LOG_WARNING, "Unable to read WebSocket transport %s\n", transport->transport.obj_name);
+				ws_poll_wait(transport);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void ws_poll_stop(void)
+{
+	if (ws_poll.thread != AST_PTHREADT_NULL) {
+		ws_poll.stop = 1;
+		ast_alertpipe_write(ws_poll.alert_pipe);
+		pthread_join(ws_poll.thread, NULL);
+		ws_poll.thread = AST_PTHREADT_NULL;
+	}
+	if (ws_poll.epfd >= 0) {
+		close(ws_poll.epfd);
+		ws_poll.epfd = -1;
+	}
+	ast_alertpipe_close(ws_poll.alert_pipe);
+}
+
+static int ws_poll_start(void)
+{
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL, };
+
+	if (ast_alertpipe_init(ws_poll.alert_pipe)) {
+		return -1;
+	}
+
+	ws_poll.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (ws_poll.epfd < 0
+		|| epoll_ctl(ws_poll.epfd, EPOLL_CTL_ADD, ast_alertpipe_readfd(ws_poll.alert_pipe), &event)
+		|| ast_pthread_create_background(&ws_poll.thread, NULL, ws_poll_thread, NULL)) {
+		ast_log(LOG_WARNING, "Unable to wait for WebSocket transports without a thread each: %s\n",
+			strerror(errno));
+		ws_poll.thread = AST_PTHREADT_NULL;
+		ws_poll_stop();
+		return -1;
+	}
+
+	return 0;
+}
+#endif /* WS_TRANSPORT_POLL */
+
 /*! \brief WebSocket connection handler. */
 static void websocket_cb(struct ast_websocket *session, struct ast_variable *parameters, struct ast_variable *headers)
 {
@@ -390,6 +594,23 @@ static void websocket_cb(struct ast_websocket *session, struct ast_variable *par
 	}
 
 	transport = create_data.transport;
+	transport->serializer = ao2_bump(serializer);
+
+#ifdef WS_TRANSPORT_POLL
+	/*
+	 * The poll thread takes our reference of the transport.  A message
+	 * already buffered, by OpenSSL say, would not wake it up.
+	 */
+	if (ws_poll.epfd >= 0
+		&& (ast_websocket_wait_for_input(session, 0) > 0
+			? !ast_sip_push_task(serializer, transport_read_ready, transport)
+			: !ws_poll_wait(transport))) {
+		ast_taskprocessor_unreference(serializer);
+		ast_websocket_unref(session);
+		return;
+	}
+#endif
+
 	read_data.transport = transport;
 
 	while (ast_websocket_wait_for_input(session, -1) > 0) {
@@ -508,7 +729,15 @@ static int load_module(void)
 
 	ast_sip_session_register_supplement(&websocket_supplement);
 
+#ifdef WS_TRANSPORT_POLL
+	/* Without it each connection is read by a thread of its own */
+	ws_poll_start();
+#endif
+
 	if (ast_websocket_add_protocol("sip", websocket_cb)) {
+#ifdef WS_TRANSPORT_POLL
+		ws_poll_stop();
+#endif
 		ast_sip_session_unregister_supplement(&websocket_supplement);
 		ast_sip_unregister_service(&websocket_module);
 		return AST_MODULE_LOAD_DECLINE;
@@ -522,6 +751,9 @@ static int unload_module(void)
 	ast_sip_unregister_service(&websocket_module);
 	ast_sip_session_unregister_supplement(&websocket_supplement);
 	ast_websocket_remove_protocol("sip", websocket_cb);
+#ifdef WS_TRANSPORT_POLL
+	ws_poll_stop();
+#endif
 
 	return 0;
 }
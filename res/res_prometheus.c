@@ -72,6 +72,31 @@
 						</enumlist>
 					</description>
 				</configOption>
+				<configOption name="channel_metrics_enabled" default="yes">
+					<synopsis>Enable or disable the metrics of each channel.</synopsis>
+					<description>
+						<para>
+						The state and duration of every channel are exported as their own
+						samples.  On a system with thousands of channels, gathering them
+						makes up most of a scrape, so they can be disabled here.  The
+						channel and call counts are always exported.
+						</para>
+						<enumlist>
+							<enum name="no" />
+							<enum name="yes" />
+						</enumlist>
+					</description>
+				</configOption>
+				<configOption name="channel_metrics_interval" default="0">
+					<synopsis>Seconds to reuse the metrics of each channel between scrapes.</synopsis>
+					<description>
+						<para>
+						When not 0, the metrics of each channel are gathered at most once
+						in this many seconds, and scrapes in between export the same
+						samples again.
+						</para>
+					</description>
+				</configOption>
 				<configOption name="uri" default="metrics">
 					<synopsis>The HTTP URI to serve metrics up on.</synopsis>
 				</configOption>
@@ -531,6 +556,18 @@ void prometheus_metric_to_string(struct prometheus_metric *metric,
 	}
 }
 
+void prometheus_metric_family_to_string(struct ast_str **response, const char *name,
+	const char *type, const char *help, struct ast_str *samples)
+{
+	if (!ast_str_strlen(samples)) {
+		return;
+	}
+
+	ast_str_append(response, 0, "# HELP %s %s\n", name, help);
+	ast_str_append(response, 0, "# TYPE %s %s\n", name, type);
+	ast_str_append(response, 0, "%s", ast_str_buffer(samples));
+}
+
 int prometheus_callback_register(struct prometheus_callback *callback)
 {
 	SCOPED_MUTEX(lock, &scrape_lock);
@@ -962,6 +999,8 @@ static int load_module(void)
 	}
 	aco_option_register(&cfg_info, "enabled", ACO_EXACT, global_options, "no", OPT_BOOL_T, 1, FLDSET(struct prometheus_general_config, enabled));
 	aco_option_register(&cfg_info, "core_metrics_enabled", ACO_EXACT, global_options, "yes", OPT_BOOL_T, 1, FLDSET(struct prometheus_general_config, core_metrics_enabled));
+	aco_option_register(&cfg_info, "channel_metrics_enabled", ACO_EXACT, global_options, "yes", OPT_BOOL_T, 1, FLDSET(struct prometheus_general_config, channel_metrics_enabled));
+	aco_option_register(&cfg_info, "channel_metrics_interval", ACO_EXACT, global_options, "0", OPT_UINT_T, 0, FLDSET(struct prometheus_general_config, channel_metrics_interval));
 	aco_option_register(&cfg_info, "uri", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 1, STRFLDSET(struct prometheus_general_config, uri));
 	aco_option_register(&cfg_info, "auth_username", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct prometheus_general_config, auth_username));
 	aco_option_register(&cfg_info, "auth_password", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct prometheus_general_config, auth_password));
@@ -974,7 +1013,12 @@ static int load_module(void)
 		|| channel_metrics_init()
 		|| endpoint_metrics_init()
 		|| bridge_metrics_init()
-		|| pjsip_outbound_registration_metrics_init()) {
+		|| pjsip_outbound_registration_metrics_init()
+		|| stasis_metrics_init()
+		|| taskprocessor_metrics_init()
+		|| lock_metrics_init()
+		|| frame_timing_metrics_init()
+		|| tls_metrics_init()) {
 		goto cleanup;
 	}
 
@@ -31,6 +31,7 @@
 /*** MODULEINFO
 	<use type="external">openssl</use>
 	<use type="external">pjproject</use>
+	<use type="module">res_statsd</use>
 	<support_level>core</support_level>
  ***/
 
@@ -47,6 +48,7 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/bio.h>
+#include <openssl/rand.h>
 #if !defined(OPENSSL_NO_ECDH) && (OPENSSL_VERSION_NUMBER >= 0x10000000L)
 #include <openssl/bn.h>
 #endif
@@ -82,6 +84,10 @@
 #include "asterisk/uuid.h"
 #include "asterisk/test.h"
 #include "asterisk/data_buffer.h"
+#include "asterisk/statsd.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/trace_span.h"
 #ifdef HAVE_PJPROJECT
 #include "asterisk/res_pjproject.h"
 #endif
@@ -149,6 +155,25 @@
 #define SRTP_MASTER_SALT_LEN 14
 #define SRTP_MASTER_LEN (SRTP_MASTER_KEY_LEN + SRTP_MASTER_SALT_LEN)
 
+/*! \brief AES-256 master keys are the longest a DTLS-SRTP profile uses */
+#define SRTP_MAX_MASTER_KEY_LEN 32
+#define SRTP_MAX_MASTER_LEN (SRTP_MAX_MASTER_KEY_LEN + SRTP_MASTER_SALT_LEN)
+
+/*! \brief The AEAD_AES_*_GCM suites use a shorter salt, RFC 7714 section 12 */
+#define SRTP_GCM_MASTER_SALT_LEN 12
+
+#if defined(HAVE_SRTP_GCM) && defined(SRTP_AEAD_AES_128_GCM)
+/*! \brief DTLS-SRTP offers the AEAD_AES_*_GCM protection profiles ahead of the configured suite */
+#define DTLS_SRTP_GCM
+#if defined(HAVE_SRTP_256) && defined(ENABLE_SRTP_AES_256)
+#define DTLS_SRTP_GCM_PROFILES "SRTP_AEAD_AES_128_GCM:SRTP_AEAD_AES_256_GCM:"
+#else
+#define DTLS_SRTP_GCM_PROFILES "SRTP_AEAD_AES_128_GCM:"
+#endif
+#else
+#define DTLS_SRTP_GCM_PROFILES ""
+#endif
+
 #define RTP_DTLS_ESTABLISHED -37
 
 enum strict_rtp_state {
@@ -175,6 +200,9 @@ enum strict_rtp_mode {
 #define DEFAULT_STRICT_RTP STRICT_RTP_YES	/*!< Enabled by default */
 #define DEFAULT_ICESUPPORT 1
 #define DEFAULT_DTLS_MTU 1200
+#define DEFAULT_DTLS_WORKERS 0
+#define DEFAULT_DTLS_SESSION_RESUMPTION 0
+#define DEFAULT_LOCAL_BRIDGE_REWRITE 0
 
 extern struct ast_srtp_res *res_srtp;
 extern struct ast_srtp_policy_res *res_srtp_policy;
@@ -187,6 +215,7 @@ static int rtpdebug;			/*!< Are we debugging? */
 static int rtcpdebug;			/*!< Are we debugging RTCP? */
 static int rtcpstats;			/*!< Are we debugging RTCP? */
 static int rtcpinterval = RTCP_DEFAULT_INTERVALMS; /*!< Time between rtcp reports in millisecs */
+static int rtcp_publish_interval; /*!< Least time between the rtcp reports of an instance published to stasis, in millisecs */
 static struct ast_sockaddr rtpdebugaddr;	/*!< Debug packets to/from this host */
 static struct ast_sockaddr rtcpdebugaddr;	/*!< Debug RTCP packets to/from this host */
 static int rtpdebugport;		/*!< Debug only RTP packets from IP or IP+Port if port is > 0 */
@@ -197,8 +226,40 @@ static int nochecksums;
 static int strictrtp = DEFAULT_STRICT_RTP; /*!< Only accept RTP frames from a defined source. If we receive an indication of a changing source, enter learning mode. */
 static int learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL; /*!< Number of sequential RTP frames needed from a single source during learning mode to accept new source. */
 static int learning_min_duration = DEFAULT_LEARNING_MIN_DURATION; /*!< Lowest acceptable timeout between the first and the last sequential RTP frame. */
+static int local_bridge_rewrite = DEFAULT_LOCAL_BRIDGE_REWRITE; /*!< Locally bridged packets are sent as part of the outgoing instance's own stream. */
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
 static int dtls_mtu = DEFAULT_DTLS_MTU;
+static int dtls_workers = DEFAULT_DTLS_WORKERS; /*!< Threads running the DTLS handshakes, 0 to run them on the reading thread */
+static int dtls_session_resumption = DEFAULT_DTLS_SESSION_RESUMPTION; /*!< Whether DTLS sessions can be resumed */
+/*! \brief Pool running the DTLS handshakes of the instances, when dtls_workers is set */
+static struct ast_threadpool *dtls_pool;
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+/*! \brief Size of the session ticket keys: name, HMAC secret and AES key of 16, 32 and 32 bytes */
+#define DTLS_TICKET_KEYS_LEN 80
+#else
+/*! \brief Size of the session ticket keys: name, HMAC secret and AES key of 16 bytes each */
+#define DTLS_TICKET_KEYS_LEN 48
+#endif
+/*! \brief Session ticket keys shared by every DTLS context so a ticket is accepted by a later call */
+static unsigned char dtls_ticket_keys[DTLS_TICKET_KEYS_LEN];
+/*! \brief Whether dtls_ticket_keys could be generated, without them no ticket is issued */
+static int dtls_ticket_keys_ready;
+
+/*! \brief Statistics of the completed DTLS handshakes */
+static struct {
+	/*! Handshakes completed */
+	unsigned int completed;
+	/*! Handshakes that resumed a previous session */
+	unsigned int resumed;
+	/*! Handshake records processed by the worker pool */
+	unsigned int offloaded;
+	/*! Sum of the handshake durations, in microseconds */
+	int64_t usec_total;
+	/*! Longest handshake, in microseconds */
+	int64_t usec_max;
+} dtls_stats;
+
+AST_MUTEX_DEFINE_STATIC(dtls_stats_lock);
 #endif
 #ifdef HAVE_PJPROJECT
 static int icesupport = DEFAULT_ICESUPPORT;
@@ -296,6 +357,10 @@ struct dtls_details {
 	enum ast_rtp_dtls_setup dtls_setup; /*!< Current setup state */
 	enum ast_rtp_dtls_connection connection; /*!< Whether this is a new or existing connection */
 	int timeout_timer; /*!< Scheduler id for timeout timer */
+	struct timeval handshake_start; /*!< When the handshake in progress started */
+	SSL_SESSION *session; /*!< Last established session, offered again when reconnecting */
+	unsigned int established:1; /*!< A handshake completed by the worker pool, raised on the next read */
+	unsigned int failed:1; /*!< A handshake failed on the worker pool, ending the call on the next read */
 };
 #endif
 
@@ -342,6 +407,38 @@ struct rtp_transport_wide_cc_statistics {
 	int schedid;
 };
 
+/*! \brief Most Opus frames in a packet, RFC 6716 section 3.2.5 */
+#define OPUS_PACKER_MAX_FRAMES 48
+
+/*! \brief Most payload of a combined Opus packet, to stay within the MTU */
+#define OPUS_PACKER_MAX_PAYLOAD 1200
+
+/*!
+ * \brief Opus packets of one frame each, waiting to be sent as one packet
+ *
+ * \details Packets of a single frame (code 0) with the same configuration
+ * are combined into a packet of several frames (code 3), without decoding
+ * them, RFC 6716 section 3.2.
+ */
+struct rtp_opus_packer {
+	/*! The TOC byte of the frames */
+	unsigned char toc;
+	/*! Number of frames */
+	unsigned int frames;
+	/*! Samples of the frames, at 48kHz */
+	unsigned int samples;
+	/*! Delivery time of the first frame */
+	struct timeval delivery;
+	/*! Length of each frame */
+	unsigned short lengths[OPUS_PACKER_MAX_FRAMES];
+	/*! Bytes of frame data */
+	unsigned int datalen;
+	/*! The frame data */
+	unsigned char data[OPUS_PACKER_MAX_PAYLOAD];
+	/*! The combined packet, after room for the RTP header */
+	unsigned char packet[AST_FRIENDLY_OFFSET + OPUS_PACKER_MAX_PAYLOAD + 2 * OPUS_PACKER_MAX_FRAMES + 2];
+};
+
 /*! \brief RTP session description */
 struct ast_rtp {
 	int s;
@@ -393,7 +490,15 @@ struct ast_rtp {
 	double drxcore;                 /*!< The double representation of the first received packet */
 	struct timeval dtmfmute;
 	struct ast_smoother *smoother;
+	struct rtp_opus_packer *opus_packer;	/*!< Combines Opus packets up to the framing */
 	unsigned short seqno;		/*!< Sequence number, RFC 3550, page 13. */
+	/*! Rewriting of the locally bridged stream sent out of this instance */
+	struct {
+		unsigned int active;		/*!< True once a stream is being relayed */
+		unsigned int ssrc;		/*!< SSRC of the stream being relayed */
+		unsigned short seqno_offset;	/*!< Added to the sequence numbers of the stream */
+		unsigned int ts_offset;		/*!< Added to the timestamps of the stream */
+	} relay;
 	struct ast_sched_context *sched;
 	struct ast_rtcp *rtcp;
 	unsigned int asymmetric_codec;  /*!< Indicate if asymmetric send/receive codecs are allowed */
@@ -460,6 +565,7 @@ struct ast_rtp {
 	unsigned int rekey; /*!< Interval at which to renegotiate and rekey */
 	int rekeyid; /*!< Scheduled item id for rekeying */
 	struct dtls_details dtls; /*!< DTLS state information */
+	struct ast_taskprocessor *dtls_serializer; /*!< Serializer processing the DTLS records, if offloaded */
 #endif
 };
 
@@ -486,6 +592,8 @@ struct ast_rtcp {
 	unsigned int expected_prior;	/*!< no. packets in previous interval */
 	unsigned int received_prior;	/*!< no. packets received in previous interval */
 	int schedid;			/*!< Schedid returned from ast_sched_add() to schedule RTCP-transmissions*/
+	struct timeval published_sent;	/*!< When a sent report was last published */
+	struct timeval published_received; /*!< When a received report was last published */
 	unsigned int rr_count;		/*!< number of RRs we've sent, not including report blocks in SR's */
 	unsigned int sr_count;		/*!< number of SRs we've sent */
 	unsigned int lastsrtxcount;     /*!< Transmit packet count when last SR sent */
@@ -2102,6 +2210,20 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 
 	SSL_CTX_set_read_ahead(rtp->ssl_ctx, 1);
 
+	if (dtls_session_resumption && dtls_ticket_keys_ready
+		&& SSL_CTX_set_tlsext_ticket_keys(rtp->ssl_ctx, dtls_ticket_keys, sizeof(dtls_ticket_keys)) != 1) {
+		ast_log(LOG_WARNING, "Could not set the DTLS session ticket keys, sessions will not be resumed\n");
+		dtls_ticket_keys_ready = 0;
+	}
+
+	if (dtls_session_resumption && dtls_ticket_keys_ready) {
+		/* Every context can decrypt the tickets of the others, resumption then works across calls */
+		SSL_CTX_set_session_id_context(rtp->ssl_ctx, (const unsigned char *) "asterisk", 8);
+	} else {
+		SSL_CTX_set_options(rtp->ssl_ctx, SSL_OP_NO_TICKET);
+		SSL_CTX_set_session_cache_mode(rtp->ssl_ctx, SSL_SESS_CACHE_OFF);
+	}
+
 	configure_dhparams(rtp, dtls_cfg);
 
 	rtp->dtls_verify = dtls_cfg->verify;
@@ -2111,9 +2233,9 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 		dtls_verify_callback : NULL);
 
 	if (dtls_cfg->suite == AST_AES_CM_128_HMAC_SHA1_80) {
-		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, "SRTP_AES128_CM_SHA1_80");
+		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, DTLS_SRTP_GCM_PROFILES "SRTP_AES128_CM_SHA1_80");
 	} else if (dtls_cfg->suite == AST_AES_CM_128_HMAC_SHA1_32) {
-		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, "SRTP_AES128_CM_SHA1_32");
+		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, DTLS_SRTP_GCM_PROFILES "SRTP_AES128_CM_SHA1_32");
 	} else {
 		ast_log(LOG_ERROR, "Unsupported suite specified for DTLS-SRTP on RTP instance '%p'\n", instance);
 		return -1;
@@ -2191,6 +2313,14 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 		dtls_setup_rtcp(instance);
 	}
 
+	if (!res && dtls_pool && dtls_workers && !rtp->dtls_serializer) {
+		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		/* Without a serializer the handshake is simply run by the reading thread */
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "rtp-dtls");
+		rtp->dtls_serializer = ast_threadpool_serializer(tps_name, dtls_pool);
+	}
+
 	return res;
 }
 
@@ -2222,6 +2352,12 @@ static void ast_rtp_dtls_stop(struct ast_rtp_instance *instance)
 		rtp->dtls.ssl = NULL;
 	}
 
+	if (rtp->dtls.session) {
+		SSL_SESSION_free(rtp->dtls.session);
+		rtp->dtls.session = NULL;
+	}
+	rtp->dtls.established = 0;
+
 	if (rtp->rtcp) {
 		ao2_unlock(instance);
 		dtls_srtp_stop_timeout_timer(instance, rtp, 1);
@@ -2233,6 +2369,12 @@ static void ast_rtp_dtls_stop(struct ast_rtp_instance *instance)
 			}
 			rtp->rtcp->dtls.ssl = NULL;
 		}
+
+		if (rtp->rtcp->dtls.session) {
+			SSL_SESSION_free(rtp->rtcp->dtls.session);
+			rtp->rtcp->dtls.session = NULL;
+		}
+		rtp->rtcp->dtls.established = 0;
 	}
 }
 
@@ -2488,6 +2630,7 @@ static void dtls_perform_handshake(struct ast_rtp_instance *instance, struct dtl
 		return;
 	}
 
+	dtls->handshake_start = ast_tvnow();
 	SSL_do_handshake(dtls->ssl);
 
 	/*
@@ -2514,6 +2657,10 @@ static void dtls_perform_setup(struct dtls_details *dtls)
 		SSL_set_accept_state(dtls->ssl);
 	} else {
 		SSL_set_connect_state(dtls->ssl);
+		if (dtls->session) {
+			/* Offer the previous session, if the peer still has it the handshake is abbreviated */
+			SSL_set_session(dtls->ssl, dtls->session);
+		}
 	}
 	dtls->connection = AST_RTP_DTLS_CONNECTION_NEW;
 }
@@ -2783,16 +2930,49 @@ static int dtls_srtp_renegotiate(const void *data)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Determine the suite and master key sizes of the negotiated DTLS-SRTP profile
+ *
+ * \note The configured suite is used if the GCM profiles were not offered.
+ */
+static enum ast_srtp_suite dtls_srtp_negotiated_suite(struct ast_rtp *rtp, struct dtls_details *dtls,
+	size_t *key_len, size_t *salt_len)
+{
+#ifdef DTLS_SRTP_GCM
+	SRTP_PROTECTION_PROFILE *profile = SSL_get_selected_srtp_profile(dtls->ssl);
+
+	if (profile && profile->id == SRTP_AEAD_AES_128_GCM) {
+		*key_len = SRTP_MASTER_KEY_LEN;
+		*salt_len = SRTP_GCM_MASTER_SALT_LEN;
+		return AST_AES_GCM_128;
+	} else if (profile && profile->id == SRTP_AEAD_AES_256_GCM) {
+		*key_len = SRTP_MAX_MASTER_KEY_LEN;
+		*salt_len = SRTP_GCM_MASTER_SALT_LEN;
+		return AST_AES_GCM_256;
+	}
+#endif
+
+	*key_len = SRTP_MASTER_KEY_LEN;
+	*salt_len = SRTP_MASTER_SALT_LEN;
+	return rtp->suite;
+}
+
 static int dtls_srtp_add_local_ssrc(struct ast_rtp *rtp, struct ast_rtp_instance *instance, int rtcp, unsigned int ssrc, int set_remote_policy)
 {
-	unsigned char material[SRTP_MASTER_LEN * 2];
+	unsigned char material[SRTP_MAX_MASTER_LEN * 2];
 	unsigned char *local_key, *local_salt, *remote_key, *remote_salt;
 	struct ast_srtp_policy *local_policy, *remote_policy = NULL;
 	int res = -1;
 	struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
+	enum ast_srtp_suite suite;
+	size_t key_len;
+	size_t salt_len;
+
+	suite = dtls_srtp_negotiated_suite(rtp, dtls, &key_len, &salt_len);
 
 	/* Produce key information and set up SRTP */
-	if (!SSL_export_keying_material(dtls->ssl, material, SRTP_MASTER_LEN * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
+	if (!SSL_export_keying_material(dtls->ssl, material, (key_len + salt_len) * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
 		ast_log(LOG_WARNING, "Unable to extract SRTP keying material from DTLS-SRTP negotiation on RTP instance '%p'\n",
 			instance);
 		return -1;
@@ -2801,27 +2981,27 @@ static int dtls_srtp_add_local_ssrc(struct ast_rtp *rtp, struct ast_rtp_instance
 	/* Whether we are acting as a server or client determines where the keys/salts are */
 	if (rtp->dtls.dtls_setup == AST_RTP_DTLS_SETUP_ACTIVE) {
 		local_key = material;
-		remote_key = local_key + SRTP_MASTER_KEY_LEN;
-		local_salt = remote_key + SRTP_MASTER_KEY_LEN;
-		remote_salt = local_salt + SRTP_MASTER_SALT_LEN;
+		remote_key = local_key + key_len;
+		local_salt = remote_key + key_len;
+		remote_salt = local_salt + salt_len;
 	} else {
 		remote_key = material;
-		local_key = remote_key + SRTP_MASTER_KEY_LEN;
-		remote_salt = local_key + SRTP_MASTER_KEY_LEN;
-		local_salt = remote_salt + SRTP_MASTER_SALT_LEN;
+		local_key = remote_key + key_len;
+		remote_salt = local_key + key_len;
+		local_salt = remote_salt + salt_len;
 	}
 
 	if (!(local_policy = res_srtp_policy->alloc())) {
 		return -1;
 	}
 
-	if (res_srtp_policy->set_master_key(local_policy, local_key, SRTP_MASTER_KEY_LEN, local_salt, SRTP_MASTER_SALT_LEN) < 0) {
+	if (res_srtp_policy->set_master_key(local_policy, local_key, key_len, local_salt, salt_len) < 0) {
 		ast_log(LOG_WARNING, "Could not set key/salt information on local policy of '%p' when setting up DTLS-SRTP\n", rtp);
 		goto error;
 	}
 
-	if (res_srtp_policy->set_suite(local_policy, rtp->suite)) {
-		ast_log(LOG_WARNING, "Could not set suite to '%u' on local policy of '%p' when setting up DTLS-SRTP\n", rtp->suite, rtp);
+	if (res_srtp_policy->set_suite(local_policy, suite)) {
+		ast_log(LOG_WARNING, "Could not set suite to '%u' on local policy of '%p' when setting up DTLS-SRTP\n", suite, rtp);
 		goto error;
 	}
 
@@ -2832,13 +3012,13 @@ static int dtls_srtp_add_local_ssrc(struct ast_rtp *rtp, struct ast_rtp_instance
 			goto error;
 		}
 
-		if (res_srtp_policy->set_master_key(remote_policy, remote_key, SRTP_MASTER_KEY_LEN, remote_salt, SRTP_MASTER_SALT_LEN) < 0) {
+		if (res_srtp_policy->set_master_key(remote_policy, remote_key, key_len, remote_salt, salt_len) < 0) {
 			ast_log(LOG_WARNING, "Could not set key/salt information on remote policy of '%p' when setting up DTLS-SRTP\n", rtp);
 			goto error;
 		}
 
-		if (res_srtp_policy->set_suite(remote_policy, rtp->suite)) {
-			ast_log(LOG_WARNING, "Could not set suite to '%u' on remote policy of '%p' when setting up DTLS-SRTP\n", rtp->suite, rtp);
+		if (res_srtp_policy->set_suite(remote_policy, suite)) {
+			ast_log(LOG_WARNING, "Could not set suite to '%u' on remote policy of '%p' when setting up DTLS-SRTP\n", suite, rtp);
 			goto error;
 		}
 
@@ -2974,10 +3154,349 @@ static int rtcp_mux(struct ast_rtp *rtp, const unsigned char *packet)
 	return 0;
 }
 
-/*! \pre instance is locked */
-static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
+#if defined(MSG_WAITFORONE)
+/*! \brief Natively bridged packets are read with recvmmsg() and forwarded with sendmmsg() */
+#define RTP_IO_BATCHING
+
+/*! \brief Maximum number of packets read by one recvmmsg() */
+#define RTP_IO_BATCH_PACKETS 8
+
+/*! \brief Maximum number of recvmmsg() calls made for one read of an instance */
+#define RTP_IO_BATCH_ROUNDS 4
+
+/*! \brief Maximum size of a packet read by recvmmsg(), larger ones are dropped */
+#define RTP_IO_BATCH_PACKET_SIZE 2048
+
+/*!
+ * \brief Packets read and forwarded by a thread draining a natively bridged instance
+ *
+ * \note Only threads that read natively bridged instances allocate one.
+ */
+struct rtp_io_batch {
+	/*! TRUE while forwarded packets are queued rather than sent */
+	int draining;
+	/*! Number of queued packets */
+	unsigned int queued;
+	/*! Socket each queued packet is sent on */
+	int queued_fd[RTP_IO_BATCH_PACKETS];
+	struct mmsghdr queued_msgs[RTP_IO_BATCH_PACKETS];
+	struct iovec queued_iov[RTP_IO_BATCH_PACKETS];
+	struct ast_sockaddr queued_addr[RTP_IO_BATCH_PACKETS];
+	struct mmsghdr msgs[RTP_IO_BATCH_PACKETS];
+	struct iovec iov[RTP_IO_BATCH_PACKETS];
+	struct ast_sockaddr addr[RTP_IO_BATCH_PACKETS];
+	/*! The packets read, each with AST_FRIENDLY_OFFSET of room in front */
+	unsigned char buf[RTP_IO_BATCH_PACKETS][AST_FRIENDLY_OFFSET + RTP_IO_BATCH_PACKET_SIZE];
+};
+
+AST_THREADSTORAGE(rtp_io_batch_storage);
+
+/*!
+ * \internal
+ * \brief Queue a packet forwarded out of the batch being drained
+ *
+ * \retval 0 if the packet was queued
+ * \retval -1 if the packet must be sent now
+ */
+static int rtp_io_batch_queue(int fd, void *buf, size_t size, const struct ast_sockaddr *sa)
+{
+	struct rtp_io_batch *batch = ast_threadstorage_get_ptr(&rtp_io_batch_storage);
+	unsigned int idx;
+
+	if (!batch || !batch->draining || batch->queued == RTP_IO_BATCH_PACKETS
+		|| (unsigned char *) buf < batch->buf[0]
+		|| (unsigned char *) buf >= batch->buf[RTP_IO_BATCH_PACKETS - 1] + sizeof(batch->buf[0])) {
+		return -1;
+	}
+
+	idx = batch->queued++;
+	batch->queued_fd[idx] = fd;
+	ast_sockaddr_copy(&batch->queued_addr[idx], sa);
+	batch->queued_iov[idx].iov_base = buf;
+	batch->queued_iov[idx].iov_len = size;
+	memset(&batch->queued_msgs[idx], 0, sizeof(batch->queued_msgs[idx]));
+	batch->queued_msgs[idx].msg_hdr.msg_iov = &batch->queued_iov[idx];
+	batch->queued_msgs[idx].msg_hdr.msg_iovlen = 1;
+	batch->queued_msgs[idx].msg_hdr.msg_name = &batch->queued_addr[idx].ss;
+	batch->queued_msgs[idx].msg_hdr.msg_namelen = batch->queued_addr[idx].len;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Room left behind a packet forwarded out of the batch being drained
+ *
+ * \retval 0 if the packet is not in a batch being drained
+ */
+static size_t rtp_io_batch_room(const void *buf, size_t size)
+{
+	struct rtp_io_batch *batch = ast_threadstorage_get_ptr(&rtp_io_batch_storage);
+	const unsigned char *start = buf;
+	size_t slot;
+
+	if (!batch || !batch->draining
+		|| start < batch->buf[0]
+		|| start >= batch->buf[RTP_IO_BATCH_PACKETS - 1] + sizeof(batch->buf[0])) {
+		return 0;
+	}
+
+	slot = (start - batch->buf[0]) / sizeof(batch->buf[0]);
+	if (start + size >= batch->buf[slot] + sizeof(batch->buf[0])) {
+		return 0;
+	}
+
+	return batch->buf[slot] + sizeof(batch->buf[0]) - (start + size);
+}
+
+/*!
+ * \internal
+ * \brief Send the queued packets, one sendmmsg() per run of packets on a socket
+ */
+static void rtp_io_batch_flush(struct rtp_io_batch *batch)
+{
+	unsigned int start = 0;
+
+	while (start < batch->queued) {
+		unsigned int count = 1;
+		int res;
+
+		while (start + count < batch->queued
+			&& batch->queued_fd[start + count] == batch->queued_fd[start]) {
+			++count;
+		}
+
+		while (count) {
+			res = sendmmsg(batch->queued_fd[start], &batch->queued_msgs[start], count, 0);
+			if (res <= 0) {
+				ast_debug(1, "Failed to send %u forwarded RTP packets: %s\n",
+					count, strerror(errno));
+				start += count;
+				break;
+			}
+			start += res;
+			count -= res;
+		}
+	}
+
+	batch->queued = 0;
+}
+#endif
+
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+/*!
+ * \internal
+ * \brief Account for a completed DTLS handshake
+ *
+ * \pre instance is locked
+ */
+static void dtls_handshake_completed(struct dtls_details *dtls)
 {
+	int64_t usec = 0;
+	int resumed = SSL_session_reused(dtls->ssl);
+
+	if (!ast_tvzero(dtls->handshake_start)) {
+		usec = ast_tvdiff_us(ast_tvnow(), dtls->handshake_start);
+		dtls->handshake_start = ast_tv(0, 0);
+	}
+
+	if (dtls_session_resumption) {
+		if (dtls->session) {
+			SSL_SESSION_free(dtls->session);
+		}
+		dtls->session = SSL_get1_session(dtls->ssl);
+	}
+
+	ast_mutex_lock(&dtls_stats_lock);
+	++dtls_stats.completed;
+	if (resumed) {
+		++dtls_stats.resumed;
+	}
+	dtls_stats.usec_total += usec;
+	if (usec > dtls_stats.usec_max) {
+		dtls_stats.usec_max = usec;
+	}
+	ast_mutex_unlock(&dtls_stats_lock);
+
+	ast_statsd_log("RTP.dtls.handshake", AST_STATSD_TIMER, usec / 1000);
+	if (resumed) {
+		ast_statsd_log("RTP.dtls.resumed", AST_STATSD_COUNTER, 1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Feed a received DTLS record to OpenSSL
+ *
+ * \retval 0 if the record was consumed
+ * \retval RTP_DTLS_ESTABLISHED if the handshake completed
+ * \retval -1 on failure
+ *
+ * \pre instance is locked
+ */
+static int dtls_process_record(struct ast_rtp_instance *instance, struct ast_rtp *rtp,
+	void *buf, int len, int rtcp)
+{
+	struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
+	int res = 0;
+
+	/*
+	 * A race condition is prevented between dtls_perform_handshake()
+	 * and this function because both functions have to get the
+	 * instance lock before they can do anything.  The
+	 * dtls_perform_handshake() function needs to start the timer
+	 * before we stop it below.
+	 */
+
+	/* Before we feed data into OpenSSL ensure that the timeout timer is either stopped or completed */
+	ao2_unlock(instance);
+	dtls_srtp_stop_timeout_timer(instance, rtp, rtcp);
+	ao2_lock(instance);
+
+	/* The SSL session may have gone away while the instance was unlocked */
+	if (!dtls->ssl) {
+		return 0;
+	}
+
+	/* If we don't yet know if we are active or passive and we receive a packet... we are obviously passive */
+	if (dtls->dtls_setup == AST_RTP_DTLS_SETUP_ACTPASS) {
+		dtls->dtls_setup = AST_RTP_DTLS_SETUP_PASSIVE;
+		SSL_set_accept_state(dtls->ssl);
+	}
+
+	if (!SSL_is_init_finished(dtls->ssl) && ast_tvzero(dtls->handshake_start)) {
+		dtls->handshake_start = ast_tvnow();
+	}
+
+	BIO_write(dtls->read_bio, buf, len);
+
+	len = SSL_read(dtls->ssl, buf, len);
+
+	if ((len < 0) && (SSL_get_error(dtls->ssl, len) == SSL_ERROR_SSL)) {
+		unsigned long error = ERR_get_error();
+		ast_log(LOG_ERROR, "DTLS failure occurred on RTP instance '%p' due to reason '%s', terminating\n",
+			instance, ERR_reason_error_string(error));
+		dtls->handshake_start = ast_tv(0, 0);
+		return -1;
+	}
+
+	if (SSL_is_init_finished(dtls->ssl)) {
+		/* Any further connections will be existing since this is now established */
+		dtls->connection = AST_RTP_DTLS_CONNECTION_EXISTING;
+		/* Use the keying material to set up key/salt information */
+		if ((res = dtls_srtp_setup(rtp, instance, rtcp))) {
+			return res;
+		}
+		if (!ast_tvzero(dtls->handshake_start)) {
+			dtls_handshake_completed(dtls);
+		}
+		/* Notify that dtls has been established */
+		res = RTP_DTLS_ESTABLISHED;
+	} else {
+		/* Since we've sent additional traffic start the timeout timer for retransmission */
+		dtls_srtp_start_timeout_timer(instance, rtp, rtcp);
+	}
+
+	return res;
+}
+
+/*! \brief A received DTLS record waiting for the worker pool */
+struct dtls_record {
+	struct ast_rtp_instance *instance;
+	int rtcp;
 	int len;
+	unsigned char buf[0];
+};
+
+static int dtls_record_process_task(void *data)
+{
+	struct dtls_record *record = data;
+	struct ast_rtp_instance *instance = record->instance;
+	struct ast_rtp *rtp;
+	struct dtls_details *dtls;
+	int res;
+
+	ao2_lock(instance);
+	rtp = ast_rtp_instance_get_data(instance);
+	dtls = !record->rtcp ? &rtp->dtls : rtp->rtcp ? &rtp->rtcp->dtls : NULL;
+	if (dtls && dtls->ssl) {
+		/* The reading thread raises it, as it would had it processed the record itself */
+		res = dtls_process_record(instance, rtp, record->buf, record->len, record->rtcp);
+		if (res == RTP_DTLS_ESTABLISHED) {
+			dtls->established = 1;
+		} else if (res < 0) {
+			dtls->failed = 1;
+		}
+	}
+	ao2_unlock(instance);
+
+	ast_mutex_lock(&dtls_stats_lock);
+	++dtls_stats.offloaded;
+	ast_mutex_unlock(&dtls_stats_lock);
+
+	ao2_ref(instance, -1);
+	ast_free(record);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue a received DTLS record to the serializer of the instance
+ *
+ * \details The record is dropped if it cannot be queued, the peer retransmits it.
+ *
+ * \pre instance is locked
+ */
+static void dtls_offload_record(struct ast_rtp_instance *instance, struct ast_rtp *rtp,
+	const void *buf, int len, int rtcp)
+{
+	struct dtls_record *record;
+
+	record = ast_malloc(sizeof(*record) + len);
+	if (!record) {
+		return;
+	}
+	record->instance = ao2_bump(instance);
+	record->rtcp = rtcp;
+	record->len = len;
+	memcpy(record->buf, buf, len);
+
+	if (ast_taskprocessor_push(rtp->dtls_serializer, dtls_record_process_task, record)) {
+		ao2_ref(instance, -1);
+		ast_free(record);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Check whether a handshake completed by the worker pool is to be raised
+ *
+ * \pre instance is locked
+ */
+static int dtls_established_pending(struct dtls_details *dtls)
+{
+	if (!dtls->established) {
+		return 0;
+	}
+	dtls->established = 0;
+
+	return 1;
+}
+#endif
+
+/*!
+ * \internal
+ * \brief Handle the DTLS, ICE and TURN traffic of a received packet
+ *
+ * \retval length of the media packet left in buf
+ * \retval 0 if the packet was consumed
+ * \retval <0 on error or RTP_DTLS_ESTABLISHED
+ *
+ * \pre instance is locked
+ */
+static int rtp_recv_process(struct ast_rtp_instance *instance, void *buf, int len, struct ast_sockaddr *sa, int rtcp)
+{
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
 	char *in = buf;
@@ -2989,10 +3508,6 @@ static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t s
 	struct ast_rtp_engine_test *test = ast_rtp_instance_get_test(instance);
 #endif
 
-	if ((len = ast_recvfrom(rtcp ? rtp->rtcp->s : rtp->s, buf, size, flags, sa)) < 0) {
-		return len;
-	}
-
 #ifdef TEST_FRAMEWORK
 	if (test && test->packets_to_drop > 0) {
 		test->packets_to_drop--;
@@ -3005,7 +3520,6 @@ static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t s
 	 * https://tools.ietf.org/html/rfc5764#section-5.1.2 */
 	if ((*in >= 20) && (*in <= 63)) {
 		struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
-		int res = 0;
 
 		/* If no SSL session actually exists terminate things */
 		if (!dtls->ssl) {
@@ -3014,51 +3528,12 @@ static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t s
 			return -1;
 		}
 
-		/*
-		 * A race condition is prevented between dtls_perform_handshake()
-		 * and this function because both functions have to get the
-		 * instance lock before they can do anything.  The
-		 * dtls_perform_handshake() function needs to start the timer
-		 * before we stop it below.
-		 */
-
-		/* Before we feed data into OpenSSL ensure that the timeout timer is either stopped or completed */
-		ao2_unlock(instance);
-		dtls_srtp_stop_timeout_timer(instance, rtp, rtcp);
-		ao2_lock(instance);
-
-		/* If we don't yet know if we are active or passive and we receive a packet... we are obviously passive */
-		if (dtls->dtls_setup == AST_RTP_DTLS_SETUP_ACTPASS) {
-			dtls->dtls_setup = AST_RTP_DTLS_SETUP_PASSIVE;
-			SSL_set_accept_state(dtls->ssl);
-		}
-
-		BIO_write(dtls->read_bio, buf, len);
-
-		len = SSL_read(dtls->ssl, buf, len);
-
-		if ((len < 0) && (SSL_get_error(dtls->ssl, len) == SSL_ERROR_SSL)) {
-			unsigned long error = ERR_get_error();
-			ast_log(LOG_ERROR, "DTLS failure occurred on RTP instance '%p' due to reason '%s', terminating\n",
-				instance, ERR_reason_error_string(error));
-			return -1;
-		}
-
-		if (SSL_is_init_finished(dtls->ssl)) {
-			/* Any further connections will be existing since this is now established */
-			dtls->connection = AST_RTP_DTLS_CONNECTION_EXISTING;
-			/* Use the keying material to set up key/salt information */
-			if ((res = dtls_srtp_setup(rtp, instance, rtcp))) {
-				return res;
-			}
-			/* Notify that dtls has been established */
-			res = RTP_DTLS_ESTABLISHED;
-		} else {
-			/* Since we've sent additional traffic start the timeout timer for retransmission */
-			dtls_srtp_start_timeout_timer(instance, rtp, rtcp);
+		if (rtp->dtls_serializer) {
+			dtls_offload_record(instance, rtp, buf, len, rtcp);
+			return 0;
 		}
 
-		return res;
+		return dtls_process_record(instance, rtp, buf, len, rtcp);
 	}
 #endif
 
@@ -3121,6 +3596,19 @@ static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t s
 	return len;
 }
 
+/*! \pre instance is locked */
+static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
+{
+	int len;
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+
+	if ((len = ast_recvfrom(rtcp ? rtp->rtcp->s : rtp->s, buf, size, flags, sa)) < 0) {
+		return len;
+	}
+
+	return rtp_recv_process(instance, buf, len, sa, rtcp);
+}
+
 /*! \pre instance is locked */
 static int rtcp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa)
 {
@@ -3143,9 +3631,27 @@ static int __rtp_sendto(struct ast_rtp_instance *instance, void *buf, size_t siz
 	struct ast_rtp *transport_rtp = ast_rtp_instance_get_data(transport);
 	struct ast_srtp *srtp = ast_rtp_instance_get_srtp(transport, rtcp);
 	int res;
+#ifdef RTP_IO_BATCHING
+	size_t room;
+#endif
 
 	*via_ice = 0;
 
+#ifdef RTP_IO_BATCHING
+	/*
+	 * Protecting a packet forwarded out of a batch in place keeps it in the
+	 * batch, so it is sent with the others rather than copied and sent alone.
+	 */
+	if (use_srtp && res_srtp && srtp && res_srtp->protect_in_place && !rtcp && !flags
+		&& (room = rtp_io_batch_room(buf, size))) {
+		if (res_srtp->protect_in_place(srtp, buf, &len, size + room, rtcp) >= 0) {
+			use_srtp = 0;
+		} else if (errno != ENOBUFS) {
+			return -1;
+		}
+	}
+#endif
+
 	if (use_srtp && res_srtp && srtp && res_srtp->protect(srtp, &temp, &len, rtcp) < 0) {
 		return -1;
 	}
@@ -3181,6 +3687,15 @@ static int __rtp_sendto(struct ast_rtp_instance *instance, void *buf, size_t siz
 	}
 #endif
 
+#ifdef RTP_IO_BATCHING
+	/* Packets forwarded in place out of a batch being drained are sent with the batch */
+	if (!rtcp && temp == buf && !flags
+		&& !rtp_io_batch_queue(transport_rtp->s, temp, len, sa)) {
+		ast_rtp_instance_set_last_tx(instance, time(NULL));
+		return len;
+	}
+#endif
+
 	res = ast_sendto(rtcp ? transport_rtp->rtcp->s : transport_rtp->s, temp, len, flags, sa);
 	if (res > 0) {
 		ast_rtp_instance_set_last_tx(instance, time(NULL));
@@ -3873,10 +4388,15 @@ static int ast_rtp_destroy(struct ast_rtp_instance *instance)
 
 	rtp_deallocate_transport(instance, rtp);
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	ast_taskprocessor_unreference(rtp->dtls_serializer);
+#endif
+
 	/* Destroy the smoother that was smoothing out audio if present */
 	if (rtp->smoother) {
 		ast_smoother_free(rtp->smoother);
 	}
+	ast_free(rtp->opus_packer);
 
 	/* Destroy RTCP if it was being used */
 	if (rtp->rtcp) {
@@ -4137,6 +4657,9 @@ static int ast_rtp_dtmf_end_with_duration(struct ast_rtp_instance *instance, cha
 		ast_smoother_free(rtp->smoother);
 		rtp->smoother = NULL;
 	}
+	if (rtp->opus_packer) {
+		rtp->opus_packer->frames = 0;
+	}
 cleanup:
 	rtp->sending_digit = 0;
 	rtp->send_digit = 0;
@@ -4381,6 +4904,40 @@ static int ast_rtcp_generate_report(struct ast_rtp_instance *instance, unsigned
 	return len;
 }
 
+/*!
+ * \internal
+ * \brief Determine whether an RTCP report is to be published to stasis
+ *
+ * \details With rtcp_publish_interval set, the reports of an instance in
+ * between are skipped. The counters of the reports are cumulative, so only
+ * the snapshots of jitter and fraction lost in between are not published.
+ *
+ * \param instance The instance the report is for
+ * \param message_type The type of the message, NULL if declined
+ * \param last When a report of this type was last published
+ */
+static int rtcp_report_publish_due(struct ast_rtp_instance *instance,
+	struct stasis_message_type *message_type, struct timeval *last)
+{
+	struct timeval now;
+
+	if (!message_type || ast_rtp_instance_get_prop(instance, AST_RTP_PROPERTY_RTCP_NO_PUBLISH)) {
+		return 0;
+	}
+
+	if (rtcp_publish_interval <= 0) {
+		return 1;
+	}
+
+	now = ast_tvnow();
+	if (!ast_tvzero(*last) && ast_tvdiff_ms(now, *last) < rtcp_publish_interval) {
+		return 0;
+	}
+	*last = now;
+
+	return 1;
+}
+
 static int ast_rtcp_calculate_sr_rr_statistics(struct ast_rtp_instance *instance,
 		struct ast_rtp_rtcp_report *rtcp_report, struct ast_sockaddr remote_address, int ice, int sr)
 {
@@ -4434,11 +4991,13 @@ static int ast_rtcp_calculate_sr_rr_statistics(struct ast_rtp_instance *instance
 		}
 	}
 
-	message_blob = ast_json_pack("{s: s, s: s}",
-			"to", ast_sockaddr_stringify(&remote_address),
-			"from", rtp->rtcp->local_addr_str);
-	ast_rtp_publish_rtcp_message(instance, ast_rtp_rtcp_sent_type(),
-			rtcp_report, message_blob);
+	if (rtcp_report_publish_due(instance, ast_rtp_rtcp_sent_type(), &rtp->rtcp->published_sent)) {
+		message_blob = ast_json_pack("{s: s, s: s}",
+				"to", ast_sockaddr_stringify(&remote_address),
+				"from", rtp->rtcp->local_addr_str);
+		ast_rtp_publish_rtcp_message(instance, ast_rtp_rtcp_sent_type(),
+				rtcp_report, message_blob);
+	}
 
 	return 1;
 }
@@ -4846,7 +5405,7 @@ static int rtp_raw_write(struct ast_rtp_instance *instance, struct ast_frame *fr
 		if (rtp->send_buffer) {
 			struct ast_rtp_rtcp_nack_payload *payload;
 
-			payload = ast_malloc(sizeof(*payload) + packet_len);
+			payload = ast_data_buffer_payload_alloc(sizeof(*payload) + packet_len);
 			if (payload) {
 				payload->size = packet_len;
 				memcpy(payload->buf, rtpheader, packet_len);
@@ -5044,30 +5603,157 @@ static void rtp_write_rtcp_psfb(struct ast_rtp_instance *instance, struct ast_rt
 	ao2_lock(instance);
 	res = ast_rtcp_generate_compound_prefix(instance, rtcpheader, rtcp_report, &sr);
 
-	if (res == 0 || res == 1) {
-		ao2_unlock(instance);
-		return;
+	if (res == 0 || res == 1) {
+		ao2_unlock(instance);
+		return;
+	}
+
+	packet_len += res;
+
+	put_unaligned_uint32(rtcpheader + packet_len + 0, htonl((2 << 30) | (AST_RTP_RTCP_FMT_REMB << 24) | (RTCP_PT_PSFB << 16) | ((remb_len/4)-1)));
+	put_unaligned_uint32(rtcpheader + packet_len + 4, htonl(rtp->ssrc));
+	put_unaligned_uint32(rtcpheader + packet_len + 8, htonl(0)); /* Per the draft, this should always be 0 */
+	put_unaligned_uint32(rtcpheader + packet_len + 12, htonl(('R' << 24) | ('E' << 16) | ('M' << 8) | ('B'))); /* Unique identifier 'R' 'E' 'M' 'B' */
+	put_unaligned_uint32(rtcpheader + packet_len + 16, htonl((1 << 24) | (feedback->remb.br_exp << 18) | (feedback->remb.br_mantissa))); /* Number of SSRCs / BR Exp / BR Mantissa */
+	put_unaligned_uint32(rtcpheader + packet_len + 20, htonl(rtp->ssrc)); /* The SSRC this feedback message applies to */
+	res = rtcp_sendto(instance, (unsigned int *)rtcpheader, packet_len + remb_len, 0, rtp->bundled ? remote_address : &rtp->rtcp->them, &ice);
+	if (res < 0) {
+		ast_log(LOG_ERROR, "RTCP PSFB transmission error: %s\n", strerror(errno));
+	} else {
+		ast_rtcp_calculate_sr_rr_statistics(instance, rtcp_report, rtp->bundled ? *remote_address : rtp->rtcp->them, ice, sr);
+	}
+
+	ao2_unlock(instance);
+}
+
+/*! \pre instance is locked */
+/*!
+ * \internal
+ * \brief Get the samples of an Opus frame at 48kHz from its TOC byte, RFC 6716 section 3.1
+ */
+static unsigned int opus_toc_samples(unsigned char toc)
+{
+	static const unsigned int silk[] = { 480, 960, 1920, 2880 };
+	static const unsigned int celt[] = { 120, 240, 480, 960 };
+	unsigned int config = toc >> 3;
+
+	if (config < 12) {
+		return silk[config & 3];
+	} else if (config < 16) {
+		return (config & 1) ? 960 : 480;
+	}
+	return celt[config & 3];
+}
+
+/*!
+ * \internal
+ * \brief Send the Opus frames waiting in the packer as one packet
+ */
+static void opus_packer_flush(struct ast_rtp_instance *instance, struct rtp_opus_packer *packer,
+	const struct ast_frame *frame, int codec)
+{
+	struct ast_frame f = *frame;
+	unsigned char *payload = packer->packet + AST_FRIENDLY_OFFSET;
+	unsigned char *pos = payload;
+	unsigned int vbr = 0;
+	unsigned int i;
+
+	if (!packer->frames) {
+		return;
+	}
+
+	if (packer->frames == 1) {
+		*pos++ = packer->toc;
+	} else {
+		for (i = 1; i < packer->frames; ++i) {
+			vbr |= packer->lengths[i] != packer->lengths[0];
+		}
+		*pos++ = (packer->toc & 0xfc) | 0x3;
+		*pos++ = (vbr ? 0x80 : 0) | packer->frames;
+		for (i = 0; vbr && i < packer->frames - 1; ++i) {
+			if (packer->lengths[i] < 252) {
+				*pos++ = packer->lengths[i];
+			} else {
+				*pos++ = 252 + (packer->lengths[i] & 0x3);
+				*pos++ = (packer->lengths[i] - 252) >> 2;
+			}
+		}
+	}
+	memcpy(pos, packer->data, packer->datalen);
+	pos += packer->datalen;
+
+	f.data.ptr = payload;
+	f.datalen = pos - payload;
+	f.offset = AST_FRIENDLY_OFFSET;
+	f.samples = packer->samples;
+	f.delivery = packer->delivery;
+	f.mallocd = 0;
+	packer->frames = 0;
+
+	rtp_raw_write(instance, &f, codec);
+}
+
+/*!
+ * \internal
+ * \brief Combine Opus packets up to the framing before sending them
+ *
+ * \retval 0 if the frame was taken by the packer
+ * \retval -1 if it is to be sent as it is
+ */
+static int opus_packer_write(struct ast_rtp_instance *instance, struct ast_frame *frame,
+	int codec, unsigned int framing_ms)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct rtp_opus_packer *packer = rtp->opus_packer;
+	const unsigned char *data = frame->data.ptr;
+	unsigned int length = frame->datalen - 1;
+	unsigned int samples;
+
+	if (!packer) {
+		packer = rtp->opus_packer = ast_calloc(1, sizeof(*packer));
+		if (!packer) {
+			return -1;
+		}
+	}
+
+	/* Only packets of a single frame are combined */
+	if ((data[0] & 0x3) || length > OPUS_PACKER_MAX_PAYLOAD) {
+		opus_packer_flush(instance, packer, frame, codec);
+		return -1;
+	}
+
+	samples = opus_toc_samples(data[0]);
+	if (!packer->frames && samples >= framing_ms * 48) {
+		/* Already as long as the framing */
+		return -1;
+	}
+
+	if (packer->frames && ((packer->toc & 0xfc) != (data[0] & 0xfc)
+		|| packer->frames == OPUS_PACKER_MAX_FRAMES
+		|| packer->datalen + length > OPUS_PACKER_MAX_PAYLOAD
+		|| packer->samples + samples > 5760)) {
+		/* Opus packets hold 120ms at most */
+		opus_packer_flush(instance, packer, frame, codec);
 	}
 
-	packet_len += res;
+	if (!packer->frames) {
+		packer->toc = data[0];
+		packer->samples = 0;
+		packer->datalen = 0;
+		packer->delivery = frame->delivery;
+	}
+	packer->lengths[packer->frames++] = length;
+	memcpy(packer->data + packer->datalen, data + 1, length);
+	packer->datalen += length;
+	packer->samples += samples;
 
-	put_unaligned_uint32(rtcpheader + packet_len + 0, htonl((2 << 30) | (AST_RTP_RTCP_FMT_REMB << 24) | (RTCP_PT_PSFB << 16) | ((remb_len/4)-1)));
-	put_unaligned_uint32(rtcpheader + packet_len + 4, htonl(rtp->ssrc));
-	put_unaligned_uint32(rtcpheader + packet_len + 8, htonl(0)); /* Per the draft, this should always be 0 */
-	put_unaligned_uint32(rtcpheader + packet_len + 12, htonl(('R' << 24) | ('E' << 16) | ('M' << 8) | ('B'))); /* Unique identifier 'R' 'E' 'M' 'B' */
-	put_unaligned_uint32(rtcpheader + packet_len + 16, htonl((1 << 24) | (feedback->remb.br_exp << 18) | (feedback->remb.br_mantissa))); /* Number of SSRCs / BR Exp / BR Mantissa */
-	put_unaligned_uint32(rtcpheader + packet_len + 20, htonl(rtp->ssrc)); /* The SSRC this feedback message applies to */
-	res = rtcp_sendto(instance, (unsigned int *)rtcpheader, packet_len + remb_len, 0, rtp->bundled ? remote_address : &rtp->rtcp->them, &ice);
-	if (res < 0) {
-		ast_log(LOG_ERROR, "RTCP PSFB transmission error: %s\n", strerror(errno));
-	} else {
-		ast_rtcp_calculate_sr_rr_statistics(instance, rtcp_report, rtp->bundled ? *remote_address : rtp->rtcp->them, ice, sr);
+	if (packer->samples >= framing_ms * 48) {
+		opus_packer_flush(instance, packer, frame, codec);
 	}
 
-	ao2_unlock(instance);
+	return 0;
 }
 
-/*! \pre instance is locked */
 static int ast_rtp_write(struct ast_rtp_instance *instance, struct ast_frame *frame)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
@@ -5136,6 +5822,18 @@ static int ast_rtp_write(struct ast_rtp_instance *instance, struct ast_frame *fr
 			ast_smoother_free(rtp->smoother);
 			rtp->smoother = NULL;
 		}
+		if (rtp->opus_packer) {
+			rtp->opus_packer->frames = 0;
+		}
+	}
+
+	/* Opus is combined into packets of the framing, if it is longer than a frame */
+	if (ast_format_cmp(format, ast_format_opus) == AST_FORMAT_CMP_EQUAL) {
+		unsigned int framing_ms = ast_rtp_codecs_get_framing(ast_rtp_instance_get_codecs(instance));
+
+		if (framing_ms && !opus_packer_write(instance, frame, codec, framing_ms)) {
+			return 0;
+		}
 	}
 
 	/* If no smoother is present see if we have to set one up */
@@ -6195,14 +6893,17 @@ static struct ast_frame *ast_rtcp_interpret(struct ast_rtp_instance *instance, s
 			 * this loop.
 			 */
 
-			message_blob = ast_json_pack("{s: s, s: s, s: f}",
-				"from", ast_sockaddr_stringify(addr),
-				"to", transport_rtp->rtcp->local_addr_str,
-				"rtt", rtp->rtcp->rtt);
-			ast_rtp_publish_rtcp_message(instance, ast_rtp_rtcp_received_type(),
-					rtcp_report,
-					message_blob);
-			ast_json_unref(message_blob);
+			if (rtcp_report_publish_due(instance, ast_rtp_rtcp_received_type(),
+					&rtp->rtcp->published_received)) {
+				message_blob = ast_json_pack("{s: s, s: s, s: f}",
+					"from", ast_sockaddr_stringify(addr),
+					"to", transport_rtp->rtcp->local_addr_str,
+					"rtt", rtp->rtcp->rtt);
+				ast_rtp_publish_rtcp_message(instance, ast_rtp_rtcp_received_type(),
+						rtcp_report,
+						message_blob);
+				ast_json_unref(message_blob);
+			}
 
 			/* Return an AST_FRAME_RTCP frame with the ast_rtp_rtcp_report
 			 * object as a its data */
@@ -6341,6 +7042,19 @@ static struct ast_frame *ast_rtcp_read(struct ast_rtp_instance *instance)
 	size_t read_area_size = sizeof(rtcpdata) - AST_FRIENDLY_OFFSET;
 	int res;
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	if (rtp->rtcp->dtls.failed) {
+		return NULL;
+	}
+
+	/* What is waiting on the socket is read next time */
+	if (dtls_established_pending(&rtp->rtcp->dtls)) {
+		rtp->f.frametype = AST_FRAME_CONTROL;
+		rtp->f.subclass.integer = AST_CONTROL_SRCCHANGE;
+		return &rtp->f;
+	}
+#endif
+
 	/* Read in RTCP data from the socket */
 	if ((res = rtcp_recvfrom(instance, read_area, read_area_size,
 				0, &addr)) < 0) {
@@ -6389,6 +7103,48 @@ static struct ast_frame *ast_rtcp_read(struct ast_rtp_instance *instance)
 	return ast_rtcp_interpret(instance, srtp, read_area, res, &addr);
 }
 
+/*!
+ * \internal
+ * \brief Rewrite a locally bridged packet into the stream sent by the bridged instance
+ *
+ * \details The packet takes the SSRC of the bridged instance, and its sequence
+ * number and timestamp carry on from the last packet sent.  The far end then
+ * sees a single stream across transfers and across switching between
+ * relaying packets and writing frames.
+ *
+ * \param bridged The RTP session the packet is sent out of.
+ * \param rtpheader The packet to rewrite.
+ * \param rate The RTP clock rate of the packet's payload.
+ *
+ * \pre bridged instance is locked
+ */
+static void bridge_p2p_rtp_rewrite(struct ast_rtp *bridged, unsigned int *rtpheader, unsigned int rate)
+{
+	unsigned int first_word = ntohl(rtpheader[0]);
+	unsigned int seqno = first_word & 0xffff;
+	unsigned int timestamp = ntohl(rtpheader[1]);
+	unsigned int ssrc = ntohl(rtpheader[2]);
+
+	if (!bridged->relay.active || bridged->relay.ssrc != ssrc) {
+		/* Line a new stream up behind what was last sent, one 20ms frame later */
+		bridged->relay.active = 1;
+		bridged->relay.ssrc = ssrc;
+		bridged->relay.seqno_offset = bridged->seqno - seqno;
+		bridged->relay.ts_offset = bridged->lastts + rate / 50 - timestamp;
+		first_word |= (1 << 23);
+	}
+
+	seqno = (seqno + bridged->relay.seqno_offset) & 0xffff;
+	timestamp += bridged->relay.ts_offset;
+
+	rtpheader[0] = htonl((first_word & 0xffff0000) | seqno);
+	rtpheader[1] = htonl(timestamp);
+	rtpheader[2] = htonl(bridged->ssrc);
+
+	bridged->seqno = seqno + 1;
+	bridged->lastts = timestamp;
+}
+
 /*! \pre instance is locked */
 static int bridge_p2p_rtp_write(struct ast_rtp_instance *instance,
 	struct ast_rtp_instance *instance1, unsigned int *rtpheader, int len, int hdrlen)
@@ -6517,6 +7273,11 @@ static int bridge_p2p_rtp_write(struct ast_rtp_instance *instance,
 	reconstruct |= (mark << 23);
 	rtpheader[0] = htonl(reconstruct);
 
+	if (local_bridge_rewrite) {
+		bridge_p2p_rtp_rewrite(bridged, rtpheader, payload_type->asterisk_format
+			? ast_rtp_get_rate(payload_type->format) : 8000);
+	}
+
 	/* Send the packet back out */
 	res = rtp_sendto(instance1, (void *)rtpheader, len, 0, &remote_address, &ice);
 	if (res < 0) {
@@ -7005,6 +7766,7 @@ static struct ast_frame *ast_rtp_interpret(struct ast_rtp_instance *instance, st
 	rtp->rxoctetcount += (res - hdrlen);
 	if (rtp->rxcount == 1) {
 		rtp->seedrxseqno = seqno;
+		AST_TRACE_SPAN_EVENT("first_media_packet", ast_rtp_instance_get_channel_id(instance));
 	}
 
 	/* Do not schedule RR if RTCP isn't run */
@@ -7219,50 +7981,31 @@ static struct ast_frame *ast_rtp_interpret(struct ast_rtp_instance *instance, st
 }
 
 /*! \pre instance is locked */
-static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+/*!
+ * \internal
+ * \brief Process an RTP packet read from the instance's socket
+ *
+ * \param instance The instance the packet was read on.
+ * \param read_area The packet with AST_FRIENDLY_OFFSET of room in front of it.
+ * \param res The length of the packet.
+ * \param packet_addr Where the packet came from.
+ *
+ * \pre instance is locked
+ */
+static struct ast_frame *ast_rtp_read_packet(struct ast_rtp_instance *instance,
+	unsigned char *read_area, int res, const struct ast_sockaddr *packet_addr)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 	struct ast_srtp *srtp;
 	RAII_VAR(struct ast_rtp_instance *, child, NULL, rtp_instance_unlock);
 	struct ast_sockaddr addr;
-	int res, hdrlen = 12, version, payloadtype, mark;
-	unsigned char *read_area = rtp->rawdata + AST_FRIENDLY_OFFSET;
-	size_t read_area_size = sizeof(rtp->rawdata) - AST_FRIENDLY_OFFSET;
+	int hdrlen = 12, version, payloadtype, mark;
 	unsigned int *rtpheader = (unsigned int*)(read_area), seqno, ssrc, timestamp, prev_seqno;
 	struct ast_sockaddr remote_address = { {0,} };
 	struct frame_list frames;
 	struct ast_frame *frame;
 
-	/* If this is actually RTCP let's hop on over and handle it */
-	if (rtcp) {
-		if (rtp->rtcp && rtp->rtcp->type == AST_RTP_INSTANCE_RTCP_STANDARD) {
-			return ast_rtcp_read(instance);
-		}
-		return &ast_null_frame;
-	}
-
-	/* Actually read in the data from the socket */
-	if ((res = rtp_recvfrom(instance, read_area, read_area_size, 0,
-				&addr)) < 0) {
-		if (res == RTP_DTLS_ESTABLISHED) {
-			rtp->f.frametype = AST_FRAME_CONTROL;
-			rtp->f.subclass.integer = AST_CONTROL_SRCCHANGE;
-			return &rtp->f;
-		}
-
-		ast_assert(errno != EBADF);
-		if (errno != EAGAIN) {
-			ast_log(LOG_WARNING, "RTP Read error: %s.  Hanging up.\n",
-				(errno) ? strerror(errno) : "Unspecified");
-			return NULL;
-		}
-		return &ast_null_frame;
-	}
-
-	/* If this was handled by the ICE session don't do anything */
-	if (!res) {
-		return &ast_null_frame;
-	}
+	ast_sockaddr_copy(&addr, packet_addr);
 
 	/* This could be a multiplexed RTCP packet. If so, be sure to interpret it correctly */
 	if (rtcp_mux(rtp, read_area)) {
@@ -7611,7 +8354,7 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 			}
 
 			frame = ast_frdup(ast_rtp_interpret(instance, srtp, &addr, payload->buf, payload->size, rtp->expectedrxseqno - 1));
-			ast_free(payload);
+			ast_data_buffer_payload_free(payload);
 
 			if (!frame) {
 				/* If this packet can't be interpeted due to being out of memory we return what we have and assume
@@ -7679,7 +8422,7 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 					frame->seqno, instance);
 			}
 
-			ast_free(payload);
+			ast_data_buffer_payload_free(payload);
 		}
 
 		if (!inserted) {
@@ -7725,7 +8468,7 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 		ast_debug(2, "Received an out of order packet with sequence number '%d' from the future on RTP instance '%p'\n",
 			seqno, instance);
 
-		payload = ast_malloc(sizeof(*payload) + res);
+		payload = ast_data_buffer_payload_alloc(sizeof(*payload) + res);
 		if (!payload) {
 			/* If the payload can't be allocated then we can't defer this packet right now.
 			 * Instead of dumping what we have we pretend we lost this packet. It will then
@@ -7823,6 +8566,193 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 	return &ast_null_frame;
 }
 
+#ifdef RTP_IO_BATCHING
+/*!
+ * \internal
+ * \brief Drain the packets waiting on a natively bridged instance's socket
+ *
+ * \details Packets are read with recvmmsg() and the ones forwarded to the
+ * bridged instance are sent with sendmmsg() once each read is processed.
+ * The bridged instance cannot go away meanwhile as the channel of the
+ * receiving instance is held locked.
+ *
+ * \return The frames raised while draining, a list when there is more than one.
+ * \retval &ast_null_frame if no frames were raised.
+ * \retval NULL if the channel must be hung up.
+ *
+ * \pre instance is locked
+ */
+static struct ast_frame *rtp_read_batch(struct ast_rtp_instance *instance)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct rtp_io_batch *batch;
+	struct ast_frame *head = NULL;
+	struct ast_frame *tail = NULL;
+	int rounds;
+	int received;
+	int i;
+
+	/* Bundled and ICE traffic is read a packet at a time */
+	if (rtp->bundled || AST_VECTOR_SIZE(&rtp->ssrc_mapping)) {
+		return &ast_null_frame;
+	}
+#ifdef HAVE_PJPROJECT
+	if (rtp->ice) {
+		return &ast_null_frame;
+	}
+#endif
+
+	batch = ast_threadstorage_get(&rtp_io_batch_storage, sizeof(*batch));
+	if (!batch) {
+		return &ast_null_frame;
+	}
+
+	batch->draining = 1;
+	for (rounds = 0; rounds < RTP_IO_BATCH_ROUNDS; ++rounds) {
+		for (i = 0; i < RTP_IO_BATCH_PACKETS; ++i) {
+			batch->iov[i].iov_base = batch->buf[i] + AST_FRIENDLY_OFFSET;
+			batch->iov[i].iov_len = RTP_IO_BATCH_PACKET_SIZE;
+			memset(&batch->msgs[i], 0, sizeof(batch->msgs[i]));
+			batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+			batch->msgs[i].msg_hdr.msg_iovlen = 1;
+			batch->msgs[i].msg_hdr.msg_name = &batch->addr[i].ss;
+			batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->addr[i].ss);
+		}
+
+		received = recvmmsg(rtp->s, batch->msgs, RTP_IO_BATCH_PACKETS, MSG_DONTWAIT, NULL);
+		if (received <= 0) {
+			break;
+		}
+
+		for (i = 0; i < received; ++i) {
+			unsigned char *read_area = batch->buf[i] + AST_FRIENDLY_OFFSET;
+			struct ast_frame *frame;
+			int res;
+
+			batch->addr[i].len = batch->msgs[i].msg_hdr.msg_namelen;
+			if (batch->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+				ast_debug(1, "Dropping oversized packet from %s on RTP instance '%p'\n",
+					ast_sockaddr_stringify(&batch->addr[i]), instance);
+				continue;
+			}
+
+			res = rtp_recv_process(instance, read_area, batch->msgs[i].msg_len, &batch->addr[i], 0);
+			if (res == RTP_DTLS_ESTABLISHED) {
+				rtp->f.frametype = AST_FRAME_CONTROL;
+				rtp->f.subclass.integer = AST_CONTROL_SRCCHANGE;
+				frame = &rtp->f;
+			} else if (res <= 0) {
+				continue;
+			} else {
+				frame = ast_rtp_read_packet(instance, read_area, res, &batch->addr[i]);
+			}
+
+			if (!frame) {
+				rtp_io_batch_flush(batch);
+				batch->draining = 0;
+				ast_frfree(head);
+				return NULL;
+			}
+
+			/* The frames reference the batch and the instance so they must be copied */
+			while (frame && frame != &ast_null_frame) {
+				struct ast_frame *next = AST_LIST_NEXT(frame, frame_list);
+				struct ast_frame *copy;
+
+				AST_LIST_NEXT(frame, frame_list) = NULL;
+				copy = ast_frisolate(frame);
+				if (copy) {
+					if (tail) {
+						AST_LIST_NEXT(tail, frame_list) = copy;
+					} else {
+						head = copy;
+					}
+					tail = copy;
+				}
+				frame = next;
+			}
+		}
+
+		rtp_io_batch_flush(batch);
+
+		if (received < RTP_IO_BATCH_PACKETS) {
+			break;
+		}
+	}
+	batch->draining = 0;
+
+	return head ? head : &ast_null_frame;
+}
+#endif
+
+static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct ast_sockaddr addr;
+	int res;
+	unsigned char *read_area = rtp->rawdata + AST_FRIENDLY_OFFSET;
+	size_t read_area_size = sizeof(rtp->rawdata) - AST_FRIENDLY_OFFSET;
+	struct ast_frame *frame;
+
+	/* If this is actually RTCP let's hop on over and handle it */
+	if (rtcp) {
+		if (rtp->rtcp && rtp->rtcp->type == AST_RTP_INSTANCE_RTCP_STANDARD) {
+			return ast_rtcp_read(instance);
+		}
+		return &ast_null_frame;
+	}
+
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	if (rtp->dtls.failed) {
+		return NULL;
+	}
+
+	/* What is waiting on the socket is read next time */
+	if (dtls_established_pending(&rtp->dtls)) {
+		rtp->f.frametype = AST_FRAME_CONTROL;
+		rtp->f.subclass.integer = AST_CONTROL_SRCCHANGE;
+		return &rtp->f;
+	}
+#endif
+
+	/* Actually read in the data from the socket */
+	if ((res = rtp_recvfrom(instance, read_area, read_area_size, 0,
+				&addr)) < 0) {
+		if (res == RTP_DTLS_ESTABLISHED) {
+			rtp->f.frametype = AST_FRAME_CONTROL;
+			rtp->f.subclass.integer = AST_CONTROL_SRCCHANGE;
+			return &rtp->f;
+		}
+
+		ast_assert(errno != EBADF);
+		if (errno != EAGAIN) {
+			ast_log(LOG_WARNING, "RTP Read error: %s.  Hanging up.\n",
+				(errno) ? strerror(errno) : "Unspecified");
+			return NULL;
+		}
+		return &ast_null_frame;
+	}
+
+	/* If this was handled by the ICE session don't do anything */
+	if (!res) {
+		return &ast_null_frame;
+	}
+
+	frame = ast_rtp_read_packet(instance, read_area, res, &addr);
+
+#ifdef RTP_IO_BATCHING
+	if (frame == &ast_null_frame && ast_rtp_instance_get_bridged(instance)) {
+		/*
+		 * Natively bridged packets are forwarded without raising frames
+		 * so drain what else is waiting on the socket while we are here.
+		 */
+		frame = rtp_read_batch(instance);
+	}
+#endif
+
+	return frame;
+}
+
 /*! \pre instance is locked */
 static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_property property, int value)
 {
@@ -7983,9 +8913,9 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 	} else if (property == AST_RTP_PROPERTY_ASYMMETRIC_CODEC) {
 		rtp->asymmetric_codec = value;
 	} else if (property == AST_RTP_PROPERTY_RETRANS_SEND) {
-		rtp->send_buffer = ast_data_buffer_alloc(ast_free_ptr, DEFAULT_RTP_SEND_BUFFER_SIZE);
+		rtp->send_buffer = ast_data_buffer_alloc(ast_data_buffer_payload_free, DEFAULT_RTP_SEND_BUFFER_SIZE);
 	} else if (property == AST_RTP_PROPERTY_RETRANS_RECV) {
-		rtp->recv_buffer = ast_data_buffer_alloc(ast_free_ptr, DEFAULT_RTP_RECV_BUFFER_SIZE);
+		rtp->recv_buffer = ast_data_buffer_alloc(ast_data_buffer_payload_free, DEFAULT_RTP_RECV_BUFFER_SIZE);
 		AST_VECTOR_INIT(&rtp->missing_seqno, 0);
 	}
 }
@@ -8150,10 +9080,14 @@ static int ast_rtp_local_bridge(struct ast_rtp_instance *instance0, struct ast_r
 
 	ao2_lock(instance0);
 	ast_set_flag(rtp, FLAG_NEED_MARKER_BIT | FLAG_REQ_LOCAL_BRIDGE_BIT);
+	rtp->relay.active = 0;
 	if (rtp->smoother) {
 		ast_smoother_free(rtp->smoother);
 		rtp->smoother = NULL;
 	}
+	if (rtp->opus_packer) {
+		rtp->opus_packer->frames = 0;
+	}
 	ao2_unlock(instance0);
 
 	return 0;
@@ -8652,10 +9586,58 @@ static char *handle_cli_rtcp_set_stats(struct ast_cli_entry *e, int cmd, struct
 	return CLI_SUCCESS;
 }
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+static char *handle_cli_rtp_show_dtls(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int completed;
+	unsigned int resumed;
+	unsigned int offloaded;
+	int64_t usec_total;
+	int64_t usec_max;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "rtp show dtls";
+		e->usage =
+			"Usage: rtp show dtls\n"
+			"       Display statistics of the completed DTLS handshakes.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&dtls_stats_lock);
+	completed = dtls_stats.completed;
+	resumed = dtls_stats.resumed;
+	offloaded = dtls_stats.offloaded;
+	usec_total = dtls_stats.usec_total;
+	usec_max = dtls_stats.usec_max;
+	ast_mutex_unlock(&dtls_stats_lock);
+
+	ast_cli(a->fd, "Handshake workers:    %d\n", dtls_workers);
+	ast_cli(a->fd, "Session resumption:   %s\n", AST_CLI_YESNO(dtls_session_resumption));
+	ast_cli(a->fd, "Handshakes completed: %u\n", completed);
+	ast_cli(a->fd, "Handshakes resumed:   %u\n", resumed);
+	ast_cli(a->fd, "Records offloaded:    %u\n", offloaded);
+	ast_cli(a->fd, "Average handshake:    %.3f ms\n",
+		completed ? (double) usec_total / completed / 1000.0 : 0.0);
+	ast_cli(a->fd, "Longest handshake:    %.3f ms\n", usec_max / 1000.0);
+
+	return CLI_SUCCESS;
+}
+#endif
+
 static struct ast_cli_entry cli_rtp[] = {
 	AST_CLI_DEFINE(handle_cli_rtp_set_debug,  "Enable/Disable RTP debugging"),
 	AST_CLI_DEFINE(handle_cli_rtcp_set_debug, "Enable/Disable RTCP debugging"),
 	AST_CLI_DEFINE(handle_cli_rtcp_set_stats, "Enable/Disable RTCP stats"),
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	AST_CLI_DEFINE(handle_cli_rtp_show_dtls, "Display DTLS handshake statistics"),
+#endif
 };
 
 #ifdef HAVE_PJPROJECT
@@ -8718,6 +9700,42 @@ static void blacklist_config_load(struct ast_config *cfg, const char *option_nam
 }
 #endif
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+/*!
+ * \internal
+ * \brief Create or resize the DTLS handshake pool to the configured number of workers
+ *
+ * \note The pool is kept once created, instances configured while
+ * dtls_workers is 0 just do not use it.
+ */
+static void dtls_pool_configure(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = dtls_workers,
+		.max_size = dtls_workers,
+	};
+
+	if (dtls_pool) {
+		if (dtls_workers) {
+			ast_threadpool_set_size(dtls_pool, dtls_workers);
+		}
+		return;
+	}
+
+	if (!dtls_workers) {
+		return;
+	}
+
+	dtls_pool = ast_threadpool_create("rtp-dtls", NULL, &options);
+	if (!dtls_pool) {
+		ast_log(LOG_WARNING, "Could not create the DTLS handshake pool, handshakes will be run by the reading threads\n");
+	}
+}
+#endif
+
 static int rtp_reload(int reload)
 {
 	struct ast_config *cfg;
@@ -8741,10 +9759,12 @@ static int rtp_reload(int reload)
 	rtpstart = DEFAULT_RTP_START;
 	rtpend = DEFAULT_RTP_END;
 	rtcpinterval = RTCP_DEFAULT_INTERVALMS;
+	rtcp_publish_interval = 0;
 	dtmftimeout = DEFAULT_DTMF_TIMEOUT;
 	strictrtp = DEFAULT_STRICT_RTP;
 	learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL;
 	learning_min_duration = DEFAULT_LEARNING_MIN_DURATION;
+	local_bridge_rewrite = DEFAULT_LOCAL_BRIDGE_REWRITE;
 
 	/** This resource is not "reloaded" so much as unloaded and loaded again.
 	 * In the case of the TURN related variables, the memory referenced by a
@@ -8768,6 +9788,8 @@ static int rtp_reload(int reload)
 
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
 	dtls_mtu = DEFAULT_DTLS_MTU;
+	dtls_workers = DEFAULT_DTLS_WORKERS;
+	dtls_session_resumption = DEFAULT_DTLS_SESSION_RESUMPTION;
 #endif
 
 	if ((s = ast_variable_retrieve(cfg, "general", "rtpstart"))) {
@@ -8793,6 +9815,12 @@ static int rtp_reload(int reload)
 		if (rtcpinterval > RTCP_MAX_INTERVALMS)
 			rtcpinterval = RTCP_MAX_INTERVALMS;
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "rtcp_publish_interval"))) {
+		if ((sscanf(s, "%d", &rtcp_publish_interval) != 1) || rtcp_publish_interval < 0) {
+			ast_log(LOG_WARNING, "Value for 'rtcp_publish_interval' could not be read, publishing every report\n");
+			rtcp_publish_interval = 0;
+		}
+	}
 	if ((s = ast_variable_retrieve(cfg, "general", "rtpchecksums"))) {
 #ifdef SO_NO_CHECK
 		nochecksums = ast_false(s) ? 1 : 0;
@@ -8826,6 +9854,9 @@ static int rtp_reload(int reload)
 		}
 		learning_min_duration = CALC_LEARNING_MIN_DURATION(learning_min_sequential);
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "local_bridge_rewrite"))) {
+		local_bridge_rewrite = ast_true(s);
+	}
 #ifdef HAVE_PJPROJECT
 	if ((s = ast_variable_retrieve(cfg, "general", "icesupport"))) {
 		icesupport = ast_true(s);
@@ -8911,6 +9942,17 @@ static int rtp_reload(int reload)
 			dtls_mtu = DEFAULT_DTLS_MTU;
 		}
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "dtls_workers"))) {
+		if ((sscanf(s, "%d", &dtls_workers) != 1) || dtls_workers < 0) {
+			ast_log(LOG_WARNING, "Value for 'dtls_workers' could not be read, using default of '%d' instead\n",
+				DEFAULT_DTLS_WORKERS);
+			dtls_workers = DEFAULT_DTLS_WORKERS;
+		}
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "dtls_session_resumption"))) {
+		dtls_session_resumption = ast_true(s);
+	}
+	dtls_pool_configure();
 #endif
 
 	ast_config_destroy(cfg);
@@ -9003,6 +10045,14 @@ static int load_module(void)
 	BIO_meth_set_destroy(dtls_bio_methods, dtls_bio_free);
 #endif
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	if (RAND_bytes(dtls_ticket_keys, sizeof(dtls_ticket_keys)) == 1) {
+		dtls_ticket_keys_ready = 1;
+	} else {
+		ast_log(LOG_WARNING, "Could not generate the DTLS session ticket keys, sessions will not be resumed\n");
+	}
+#endif
+
 	if (ast_rtp_engine_register(&asterisk_rtp_engine)) {
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP) && defined(HAVE_OPENSSL_BIO_METHOD)
 		BIO_meth_free(dtls_bio_methods);
@@ -9040,6 +10090,11 @@ static int unload_module(void)
 	}
 #endif
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	ast_threadpool_shutdown(dtls_pool);
+	dtls_pool = NULL;
+#endif
+
 #ifdef HAVE_PJPROJECT
 	host_candidate_overrides_clear();
 	pj_thread_register_check();
@@ -9055,6 +10110,7 @@ AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_LOAD_ORDER, "Asterisk RTP Stack",
 	.unload = unload_module,
 	.reload = reload_module,
 	.load_pri = AST_MODPRI_CHANNEL_DEPEND,
+	.optional_modules = "res_statsd",
 #ifdef HAVE_PJPROJECT
 	.requires = "res_pjproject",
 #endif
@@ -73,6 +73,9 @@ struct sorcery_memory_fields_cmp_params {
 	/*! \brief Pointer to the fields to check */
 	const struct ast_variable *fields;
 
+	/*! \brief Optional matcher for the fields, converting only those of each object */
+	struct ast_sorcery_fields_matcher *matcher;
+
 	/*! \brief Regular expression for checking object id */
 	regex_t *regex;
 
@@ -138,6 +141,10 @@ static int sorcery_memory_fields_cmp(void *obj, void *arg, int flags)
 			ao2_link(params->container, obj);
 		}
 		return 0;
+	} else if (params->matcher) {
+		if (!ast_sorcery_fields_matcher_match(params->matcher, obj)) {
+			return 0;
+		}
 	} else if (params->fields &&
 	    (!(objset = ast_sorcery_objectset_create(params->sorcery, obj)) ||
 	     (!ast_variable_lists_match(objset, params->fields, 0)))) {
@@ -165,13 +172,18 @@ static void *sorcery_memory_retrieve_fields(const struct ast_sorcery *sorcery, v
 		.fields = fields,
 		.container = NULL,
 	};
+	void *object;
 
 	/* If no fields are present return nothing, we require *something* */
 	if (!fields) {
 		return NULL;
 	}
 
-	return ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	params.matcher = ast_sorcery_fields_matcher_create(sorcery, type, fields);
+	object = ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	ast_sorcery_fields_matcher_destroy(params.matcher);
+
+	return object;
 }
 
 static void *sorcery_memory_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id)
@@ -187,7 +199,11 @@ static void sorcery_memory_retrieve_multiple(const struct ast_sorcery *sorcery,
 		.container = objects,
 	};
 
+	if (fields) {
+		params.matcher = ast_sorcery_fields_matcher_create(sorcery, type, fields);
+	}
 	ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	ast_sorcery_fields_matcher_destroy(params.matcher);
 }
 
 static void sorcery_memory_retrieve_regex(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const char *regex)
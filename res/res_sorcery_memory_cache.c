@@ -137,6 +137,12 @@ struct sorcery_memory_cache {
 	unsigned int expire_on_reload;
 	/*! \brief Whether this is a cache of the entire backend, 0 if disabled */
 	unsigned int full_backend_cache;
+	/*! \brief The amount of time (in seconds) an id not found is remembered, 0 if disabled */
+	unsigned int negative_lifetime;
+	/*! \brief Ids recently not found in the backend, if negative_lifetime is set */
+	struct ao2_container *negatives;
+	/*! \brief Backend lookups in progress for ids not in the cache, if negative_lifetime is set */
+	struct ao2_container *lookups;
 	/*! \brief Heap of cached objects. Oldest object is at the top. */
 	struct ast_heap *object_heap;
 	/*! \brief Scheduler item for expiring oldest object. */
@@ -147,6 +153,8 @@ struct sorcery_memory_cache {
 	const struct ast_sorcery *sorcery;
 	/*! \brief The type of object we are caching */
 	char *object_type;
+	/*! \brief Field indexes of a full backend cache, built when first needed */
+	struct ao2_container *field_indexes;
 	/*! TRUE if trying to stop the oldest object expiration scheduler item. */
 	unsigned int del_expire:1;
 #ifdef TEST_FRAMEWORK
@@ -175,6 +183,42 @@ struct sorcery_memory_cached_object {
 	struct ast_variable *objectset;
 };
 
+/*! \brief Structure for an index of the cached objects by the value of a field */
+struct sorcery_memory_cache_field_index {
+	/*! \brief The indexed cached objects, keyed by their value of the field */
+	struct ao2_container *entries;
+	/*! \brief Set if the field is declared indexed, so the index is kept up to date */
+	unsigned int maintained:1;
+	/*! \brief The name of the field */
+	char name[0];
+};
+
+/*! \brief Structure for a cached object in a field index */
+struct sorcery_memory_cache_index_entry {
+	/*! \brief The cached object */
+	struct sorcery_memory_cached_object *cached;
+	/*! \brief The value of the field, within the cached objectset */
+	const char *value;
+};
+
+/*! \brief Structure for an id recently not found in the backend */
+struct sorcery_memory_cache_negative {
+	/*! \brief The time at which the id is forgotten */
+	struct timeval expires;
+	/*! \brief The sorcery object id */
+	char id[0];
+};
+
+/*! \brief Structure for a backend lookup in progress, which others wait on */
+struct sorcery_memory_cache_lookup {
+	/*! \brief Signalled once the lookup is done */
+	ast_cond_t cond;
+	/*! \brief Set once the object was cached or found not to exist */
+	unsigned int done:1;
+	/*! \brief The sorcery object id */
+	char id[0];
+};
+
 /*! \brief Structure used for fields comparison */
 struct sorcery_memory_cache_fields_cmp_params {
 	/*! \brief Pointer to the sorcery structure */
@@ -185,10 +229,6 @@ struct sorcery_memory_cache_fields_cmp_params {
 	const struct ast_variable *fields;
 	/*! \brief Regular expression for checking object id */
 	regex_t *regex;
-	/*! \brief Prefix for matching object id */
-	const char *prefix;
-	/*! \brief Prefix length in bytes for matching object id */
-	const size_t prefix_len;
 	/*! \brief Optional container to put object into */
 	struct ao2_container *container;
 };
@@ -208,6 +248,10 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 static void sorcery_memory_cache_retrieve_prefix(const struct ast_sorcery *sorcery, void *data, const char *type,
 	struct ao2_container *objects, const char *prefix, const size_t prefix_len);
 static int sorcery_memory_cache_delete(const struct ast_sorcery *sorcery, void *data, void *object);
+static int sorcery_memory_cache_is_missing(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id);
+static void sorcery_memory_cache_retrieve_id_missed(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id);
 static void sorcery_memory_cache_close(void *data);
 
 static struct ast_sorcery_wizard memory_cache_object_wizard = {
@@ -223,6 +267,8 @@ static struct ast_sorcery_wizard memory_cache_object_wizard = {
 	.retrieve_multiple = sorcery_memory_cache_retrieve_multiple,
 	.retrieve_regex = sorcery_memory_cache_retrieve_regex,
 	.retrieve_prefix = sorcery_memory_cache_retrieve_prefix,
+	.is_missing = sorcery_memory_cache_is_missing,
+	.retrieve_id_missed = sorcery_memory_cache_retrieve_id_missed,
 	.close = sorcery_memory_cache_close,
 };
 
@@ -232,6 +278,21 @@ static struct ast_sorcery_wizard memory_cache_object_wizard = {
 /*! \brief The default bucket size for the container of objects in the cache */
 #define CACHE_CONTAINER_BUCKET_SIZE 53
 
+/*! \brief The bucket size for the container of field indexes in the cache */
+#define FIELD_INDEXES_BUCKET_SIZE 7
+
+/*! \brief The bucket size for the values of a field index */
+#define FIELD_INDEX_BUCKET_SIZE 257
+
+/*! \brief The bucket size for the ids not found and the lookups in progress */
+#define NEGATIVES_BUCKET_SIZE 53
+
+/*! \brief The most ids not found remembered, unless the cache has a maximum number of objects */
+#define NEGATIVES_MAXIMUM 1024
+
+/*! \brief How long (in milliseconds) a retrieval waits for the lookup of the same id by another */
+#define LOOKUP_WAIT_TIMEOUT 5000
+
 /*! \brief Height of heap for cache object heap. Allows 31 initial objects */
 #define CACHE_HEAP_INIT_HEIGHT 5
 
@@ -411,6 +472,40 @@ static int sorcery_memory_cached_object_cmp(void *obj, void *arg, int flags)
 	return cmp ? 0 : CMP_MATCH;
 }
 
+/*!
+ * \internal
+ * \brief Sort function for the container holding the objects of a full backend cache
+ *
+ * \param obj_left A cached object
+ * \param obj_right A cached object, or id or id prefix of one
+ * \param flags Search flags
+ *
+ * \retval <0 if obj_left sorts before obj_right
+ * \retval 0 if the ids (or the prefix) match
+ * \retval >0 if obj_left sorts after obj_right
+ */
+static int sorcery_memory_cached_object_sort(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct sorcery_memory_cached_object *left = obj_left;
+	const struct sorcery_memory_cached_object *right = obj_right;
+	const char *right_name = obj_right;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	default:
+	case OBJ_SEARCH_OBJECT:
+		right_name = ast_sorcery_object_get_id(right->object);
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcmp(ast_sorcery_object_get_id(left->object), right_name);
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		cmp = strncmp(ast_sorcery_object_get_id(left->object), right_name, strlen(right_name));
+		break;
+	}
+	return cmp;
+}
+
 /*!
  * \internal
  * \brief Destructor function for a sorcery memory cache
@@ -426,6 +521,9 @@ static void sorcery_memory_cache_destructor(void *obj)
 		ast_heap_destroy(cache->object_heap);
 	}
 	ao2_cleanup(cache->objects);
+	ao2_cleanup(cache->field_indexes);
+	ao2_cleanup(cache->negatives);
+	ao2_cleanup(cache->lookups);
 	ast_free(cache->object_type);
 }
 
@@ -445,6 +543,124 @@ static void sorcery_memory_cached_object_destructor(void *obj)
 
 static int schedule_cache_expiration(struct sorcery_memory_cache *cache);
 
+AO2_STRING_FIELD_HASH_FN(sorcery_memory_cache_field_index, name)
+AO2_STRING_FIELD_CMP_FN(sorcery_memory_cache_field_index, name)
+
+static void sorcery_memory_cache_field_index_destructor(void *obj)
+{
+	struct sorcery_memory_cache_field_index *index = obj;
+
+	ao2_cleanup(index->entries);
+}
+
+static void sorcery_memory_cache_index_entry_destructor(void *obj)
+{
+	struct sorcery_memory_cache_index_entry *entry = obj;
+
+	ao2_cleanup(entry->cached);
+}
+
+static int sorcery_memory_cache_index_entry_hash(const void *obj, const int flags)
+{
+	const struct sorcery_memory_cache_index_entry *entry = obj;
+
+	return ast_str_hash(flags & OBJ_SEARCH_KEY ? obj : entry->value);
+}
+
+static int sorcery_memory_cache_index_entry_cmp(void *obj, void *arg, int flags)
+{
+	const struct sorcery_memory_cache_index_entry *entry = obj;
+	const char *value = flags & OBJ_SEARCH_KEY ? arg
+		: ((const struct sorcery_memory_cache_index_entry *) arg)->value;
+
+	return strcmp(entry->value, value) ? 0 : CMP_MATCH;
+}
+
+static int field_index_add(void *obj, void *arg, int flags);
+
+/*! \brief Structure used for building a field index */
+struct field_index_build_params {
+	/*! \brief The index being built */
+	struct sorcery_memory_cache_field_index *index;
+	/*! \brief Set if an entry could not be added */
+	int failed;
+};
+
+static int field_index_entry_is_cached(void *obj, void *arg, void *data, int flags)
+{
+	struct sorcery_memory_cache_index_entry *entry = obj;
+
+	return entry->cached == data ? CMP_MATCH | CMP_STOP : 0;
+}
+
+/*!
+ * \internal
+ * \brief ao2 callback adding a newly cached object to a field index
+ *
+ * \return CMP_MATCH if the index is not maintained, or could not be, and must be dropped
+ */
+static int field_index_cached_added(void *obj, void *arg, int flags)
+{
+	struct field_index_build_params params = { .index = obj, };
+
+	if (!params.index->maintained) {
+		return CMP_MATCH;
+	}
+
+	field_index_add(arg, &params, 0);
+
+	return params.failed ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief ao2 callback removing an uncached object from a field index
+ *
+ * \return CMP_MATCH if the index is not maintained and must be dropped
+ */
+static int field_index_cached_removed(void *obj, void *arg, int flags)
+{
+	struct sorcery_memory_cache_field_index *index = obj;
+	struct sorcery_memory_cached_object *cached = arg;
+	const char *value;
+
+	if (!index->maintained) {
+		return CMP_MATCH;
+	}
+
+	value = ast_variable_find_in_list(cached->objectset, index->name);
+	if (value) {
+		ao2_callback_data(index->entries, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA,
+			field_index_entry_is_cached, (void *) value, cached);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Update the field indexes of a cache as its objects changed
+ *
+ * Indexes of declared indexed fields are updated with the object, any other
+ * index is forgotten and built again when next needed.
+ *
+ * \pre cache->objects is write-locked
+ *
+ * \param cache The cache whose objects changed
+ * \param cached The cached object added or removed, NULL if all were removed
+ * \param added Set if the object was added to the cache
+ */
+static void field_indexes_update(struct sorcery_memory_cache *cache,
+	struct sorcery_memory_cached_object *cached, int added)
+{
+	if (!cache->field_indexes || !ao2_container_count(cache->field_indexes)) {
+		return;
+	}
+
+	ao2_callback(cache->field_indexes, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE,
+		!cached ? NULL : added ? field_index_cached_added : field_index_cached_removed, cached);
+}
+
 /*!
  * \internal
  * \brief Remove an object from the cache.
@@ -470,6 +686,7 @@ static int remove_from_cache(struct sorcery_memory_cache *cache, const char *id,
 	if (!hash_object) {
 		return -1;
 	}
+	field_indexes_update(cache, hash_object, 0);
 
 	ast_assert(!strcmp(ast_sorcery_object_get_id(hash_object->object), id));
 
@@ -556,6 +773,10 @@ static void remove_all_from_cache(struct sorcery_memory_cache *cache)
 
 	ao2_callback(cache->objects, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
 		NULL, NULL);
+	field_indexes_update(cache, NULL, 0);
+	if (cache->negatives) {
+		ao2_callback(cache->negatives, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
 
 	cache->del_expire = 1;
 	AST_SCHED_DEL_UNREF(sched, cache->expire_id, ao2_ref(cache, -1));
@@ -701,6 +922,7 @@ static int remove_oldest_from_cache(struct sorcery_memory_cache *cache)
 	}
 	hash_old_object = ao2_find(cache->objects, heap_old_object,
 		OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NOLOCK);
+	field_indexes_update(cache, hash_old_object, 0);
 
 	ast_assert(heap_old_object == hash_old_object);
 
@@ -742,6 +964,7 @@ static int add_to_cache(struct sorcery_memory_cache *cache,
 			OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
 		return -1;
 	}
+	field_indexes_update(cache, cached_object, 1);
 
 	if (cache->expire_id == -1) {
 		schedule_cache_expiration(cache);
@@ -789,6 +1012,107 @@ static struct sorcery_memory_cached_object *sorcery_memory_cached_object_alloc(c
 	return cached;
 }
 
+AO2_STRING_FIELD_HASH_FN(sorcery_memory_cache_negative, id)
+AO2_STRING_FIELD_CMP_FN(sorcery_memory_cache_negative, id)
+AO2_STRING_FIELD_HASH_FN(sorcery_memory_cache_lookup, id)
+AO2_STRING_FIELD_CMP_FN(sorcery_memory_cache_lookup, id)
+
+static void sorcery_memory_cache_lookup_destructor(void *obj)
+{
+	struct sorcery_memory_cache_lookup *lookup = obj;
+
+	ast_cond_destroy(&lookup->cond);
+}
+
+/*!
+ * \internal
+ * \brief Wake up the retrievals waiting for the lookup of an id
+ *
+ * \param cache The sorcery memory cache
+ * \param id The sorcery object id, now cached or known not to exist
+ */
+static void memory_cache_lookup_done(struct sorcery_memory_cache *cache, const char *id)
+{
+	struct sorcery_memory_cache_lookup *lookup;
+
+	if (!cache->lookups) {
+		return;
+	}
+
+	lookup = ao2_find(cache->lookups, id, OBJ_SEARCH_KEY | OBJ_UNLINK);
+	if (!lookup) {
+		return;
+	}
+
+	ao2_lock(lookup);
+	lookup->done = 1;
+	ast_cond_broadcast(&lookup->cond);
+	ao2_unlock(lookup);
+	ao2_ref(lookup, -1);
+}
+
+/*!
+ * \internal
+ * \brief Wait for the lookup of an id not in the cache by another retrieval
+ *
+ * If no other retrieval is looking the id up in the backend this one becomes
+ * the lookup the others wait on, until the object is cached or is found not
+ * to exist.
+ *
+ * \param cache The sorcery memory cache
+ * \param id The sorcery object id
+ *
+ * \retval non-NULL The cached object, as found by the other retrieval
+ * \retval NULL if the backend has to be queried
+ */
+static struct sorcery_memory_cached_object *memory_cache_lookup_wait(struct sorcery_memory_cache *cache,
+	const char *id)
+{
+	struct sorcery_memory_cache_lookup *lookup;
+	struct timeval start = ast_tvnow();
+	struct timespec end = {
+		.tv_sec = start.tv_sec + LOOKUP_WAIT_TIMEOUT / 1000,
+		.tv_nsec = (start.tv_usec + (LOOKUP_WAIT_TIMEOUT % 1000) * 1000) * 1000,
+	};
+	int timedout = 0;
+
+	ao2_lock(cache->lookups);
+	lookup = ao2_find(cache->lookups, id, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!lookup) {
+		lookup = ao2_alloc(sizeof(*lookup) + strlen(id) + 1, sorcery_memory_cache_lookup_destructor);
+		if (lookup) {
+			ast_cond_init(&lookup->cond, NULL);
+			strcpy(lookup->id, id); /* Safe */
+			ao2_link_flags(cache->lookups, lookup, OBJ_NOLOCK);
+			ao2_ref(lookup, -1);
+		}
+		ao2_unlock(cache->lookups);
+		return NULL;
+	}
+	ao2_unlock(cache->lookups);
+
+	if (end.tv_nsec >= 1000000000) {
+		++end.tv_sec;
+		end.tv_nsec -= 1000000000;
+	}
+
+	ao2_lock(lookup);
+	while (!lookup->done && !timedout) {
+		timedout = ast_cond_timedwait(&lookup->cond, ao2_object_get_lockaddr(lookup), &end) == ETIMEDOUT;
+	}
+	ao2_unlock(lookup);
+
+	if (timedout) {
+		/* Whatever did the lookup will not finish it, so the next retrieval does it again */
+		ast_log(LOG_WARNING, "Retrieval of '%s' from memory cache '%s' gave up waiting on another\n",
+			id, cache->name);
+		ao2_unlink(cache->lookups, lookup);
+	}
+	ao2_ref(lookup, -1);
+
+	return ao2_find(cache->objects, id, OBJ_SEARCH_KEY);
+}
+
 /*!
  * \internal
  * \brief Callback function to cache an object in a memory cache
@@ -833,10 +1157,17 @@ static int sorcery_memory_cache_create(const struct ast_sorcery *sorcery, void *
 			ast_sorcery_object_get_id(object));
 		ao2_unlock(cache->objects);
 		ao2_ref(cached, -1);
+		memory_cache_lookup_done(cache, ast_sorcery_object_get_id(object));
 		return -1;
 	}
 	ao2_unlock(cache->objects);
 
+	if (cache->negatives) {
+		ao2_find(cache->negatives, ast_sorcery_object_get_id(object),
+			OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	}
+	memory_cache_lookup_done(cache, ast_sorcery_object_get_id(object));
+
 	ao2_ref(cached, -1);
 	return 0;
 }
@@ -1227,6 +1558,10 @@ static void *sorcery_memory_cache_retrieve_id(const struct ast_sorcery *sorcery,
 	memory_cache_full_update(sorcery, type, cache);
 
 	cached = ao2_find(cache->objects, id, OBJ_SEARCH_KEY);
+	if (!cached && cache->lookups && !sorcery_memory_cache_is_missing(sorcery, cache, type, id)) {
+		/* Concurrent retrievals of the same id only query the backend once */
+		cached = memory_cache_lookup_wait(cache, id);
+	}
 	if (!cached) {
 		return NULL;
 	}
@@ -1241,6 +1576,93 @@ static void *sorcery_memory_cache_retrieve_id(const struct ast_sorcery *sorcery,
 	return object;
 }
 
+/*!
+ * \internal
+ * \brief Callback function to check if an object was recently not found in the backend
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object
+ * \param id The sorcery object id
+ *
+ * \retval 1 if the object is known not to exist
+ * \retval 0 if it may exist
+ */
+static int sorcery_memory_cache_is_missing(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cache_negative *negative;
+	int missing;
+
+	if (!cache->negatives || is_passthru_update()) {
+		return 0;
+	}
+
+	negative = ao2_find(cache->negatives, id, OBJ_SEARCH_KEY);
+	if (!negative) {
+		return 0;
+	}
+
+	missing = ast_tvcmp(negative->expires, ast_tvnow()) > 0;
+	if (!missing) {
+		ao2_unlink(cache->negatives, negative);
+	}
+	ao2_ref(negative, -1);
+
+	return missing;
+}
+
+static int sorcery_memory_cache_negative_expired(void *obj, void *arg, int flags)
+{
+	struct sorcery_memory_cache_negative *negative = obj;
+	const struct timeval *now = arg;
+
+	return ast_tvcmp(negative->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief Callback function to remember an object was not found in the backend
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object
+ * \param id The sorcery object id
+ */
+static void sorcery_memory_cache_retrieve_id_missed(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cache_negative *negative;
+	struct timeval now = ast_tvnow();
+	unsigned int maximum = cache->maximum_objects ? cache->maximum_objects : NEGATIVES_MAXIMUM;
+
+	if (!cache->negatives || is_passthru_update()) {
+		return;
+	}
+
+	ao2_lock(cache->negatives);
+	if (ao2_container_count(cache->negatives) >= maximum) {
+		ao2_callback(cache->negatives, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK,
+			sorcery_memory_cache_negative_expired, &now);
+	}
+	ao2_find(cache->negatives, id, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	if (ao2_container_count(cache->negatives) < maximum) {
+		negative = ao2_alloc_options(sizeof(*negative) + strlen(id) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (negative) {
+			negative->expires = ast_tvadd(now, ast_samp2tv(cache->negative_lifetime, 1));
+			strcpy(negative->id, id); /* Safe */
+			ao2_link_flags(cache->negatives, negative, OBJ_NOLOCK);
+			ao2_ref(negative, -1);
+		}
+	}
+	ao2_unlock(cache->negatives);
+
+	memory_cache_lookup_done(cache, id);
+}
+
 /*!
  * \internal
  * \brief AO2 callback function for comparing a retrieval request and finding applicable objects
@@ -1261,11 +1683,6 @@ static int sorcery_memory_cache_fields_cmp(void *obj, void *arg, int flags)
 			ao2_link(params->container, cached->object);
 		}
 		return 0;
-	} else if (params->prefix) {
-		if (!strncmp(params->prefix, ast_sorcery_object_get_id(cached->object), params->prefix_len)) {
-			ao2_link(params->container, cached->object);
-		}
-		return 0;
 	} else if (params->fields &&
 	     (!ast_variable_lists_match(cached->objectset, params->fields, 0))) {
 		/* If we can't turn the object into an object set OR if differences exist between the fields
@@ -1287,83 +1704,303 @@ static int sorcery_memory_cache_fields_cmp(void *obj, void *arg, int flags)
 
 /*!
  * \internal
- * \brief Callback function to retrieve a single object based on fields
+ * \brief Find a requested field that a field index can look up
  *
- * \param sorcery The sorcery instance
- * \param data The sorcery memory cache
- * \param type The type of the object to retrieve
- * \param fields Any explicit fields to search for
+ * Only a plain comparison of a value that is neither empty, a regular
+ * expression nor a number compares the exact strings, as an index does.
+ *
+ * \param fields The requested fields
+ *
+ * \return The field, or NULL if none can be looked up
  */
-static void *sorcery_memory_cache_retrieve_fields(const struct ast_sorcery *sorcery, void *data, const char *type,
-	const struct ast_variable *fields)
+static const struct ast_variable *indexable_field(const struct ast_variable *fields)
 {
-	struct sorcery_memory_cache *cache = data;
-	struct sorcery_memory_cache_fields_cmp_params params = {
-		.sorcery = sorcery,
-		.cache = cache,
-		.fields = fields,
-	};
-	struct sorcery_memory_cached_object *cached;
-	void *object = NULL;
+	const struct ast_variable *field;
 
-	if (is_passthru_update() || !cache->full_backend_cache || !fields) {
-		return NULL;
-	}
+	for (field = fields; field; field = field->next) {
+		size_t len = strlen(field->value);
+		double number;
 
-	cached = ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+		if (strchr(field->name, ' ') || !len
+			|| (len >= 2 && field->value[0] == '/' && field->value[len - 1] == '/')
+			|| sscanf(field->value, "%lf", &number) > 0) {
+			continue;
+		}
 
-	if (cached) {
-		memory_cache_stale_check_object(sorcery, cache, cached);
-		object = ao2_bump(cached->object);
-		ao2_ref(cached, -1);
+		return field;
 	}
 
-	return object;
+	return NULL;
 }
 
-/*!
- * \internal
- * \brief Callback function to retrieve multiple objects from a memory cache
- *
- * \param sorcery The sorcery instance
- * \param data The sorcery memory cache
- * \param type The type of the object to retrieve
- * \param objects Container to place the objects into
- * \param fields Any explicit fields to search for
- */
-static void sorcery_memory_cache_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type,
-	struct ao2_container *objects, const struct ast_variable *fields)
+static int field_index_add(void *obj, void *arg, int flags)
 {
-	struct sorcery_memory_cache *cache = data;
-	struct sorcery_memory_cache_fields_cmp_params params = {
-		.sorcery = sorcery,
-		.cache = cache,
-		.fields = fields,
-		.container = objects,
-	};
+	struct sorcery_memory_cached_object *cached = obj;
+	struct field_index_build_params *params = arg;
+	struct sorcery_memory_cache_index_entry *entry;
+	const char *value;
 
-	if (is_passthru_update() || !cache->full_backend_cache) {
-		return;
+	value = ast_variable_find_in_list(cached->objectset, params->index->name);
+	if (!value) {
+		/* An object without the field never matches it */
+		return 0;
 	}
 
-	memory_cache_full_update(sorcery, type, cache);
-	ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+	entry = ao2_alloc_options(sizeof(*entry), sorcery_memory_cache_index_entry_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		params->failed = 1;
+		return CMP_STOP;
+	}
+	entry->cached = ao2_bump(cached);
+	entry->value = value;
 
-	if (ao2_container_count(objects)) {
-		memory_cache_stale_check(sorcery, cache);
+	if (!ao2_link(params->index->entries, entry)) {
+		params->failed = 1;
 	}
+	ao2_ref(entry, -1);
+
+	return params->failed ? CMP_STOP : 0;
 }
 
 /*!
  * \internal
- * \brief Callback function to retrieve multiple objects using a regex on the object id
+ * \brief Get the index of a field, building it if needed
+ *
+ * \pre cache->objects is read-locked
  *
  * \param sorcery The sorcery instance
- * \param data The sorcery memory cache
- * \param type The type of the object to retrieve
- * \param objects Container to place the objects into
- * \param regex Regular expression to apply to the object id
- */
+ * \param cache The sorcery memory cache
+ * \param name The name of the field
+ *
+ * \retval non-NULL The index
+ * \retval NULL if the cache has no field indexes or on error
+ */
+static struct sorcery_memory_cache_field_index *field_index_get(const struct ast_sorcery *sorcery,
+	struct sorcery_memory_cache *cache, const char *name)
+{
+	struct field_index_build_params params = { 0, };
+	struct sorcery_memory_cache_field_index *existing;
+
+	if (!cache->field_indexes) {
+		return NULL;
+	}
+
+	params.index = ao2_find(cache->field_indexes, name, OBJ_SEARCH_KEY);
+	if (params.index) {
+		return params.index;
+	}
+
+	params.index = ao2_alloc_options(sizeof(*params.index) + strlen(name) + 1,
+		sorcery_memory_cache_field_index_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!params.index) {
+		return NULL;
+	}
+	strcpy(params.index->name, name); /* Safe */
+	params.index->maintained = ast_sorcery_object_field_is_indexed(sorcery, cache->object_type, name);
+	params.index->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		FIELD_INDEX_BUCKET_SIZE, sorcery_memory_cache_index_entry_hash, NULL,
+		sorcery_memory_cache_index_entry_cmp);
+	if (!params.index->entries) {
+		ao2_ref(params.index, -1);
+		return NULL;
+	}
+
+	ao2_callback(cache->objects, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE, field_index_add, &params);
+	if (params.failed) {
+		ao2_ref(params.index, -1);
+		return NULL;
+	}
+
+	/* Another reader may have built the same index in the meantime */
+	ao2_lock(cache->field_indexes);
+	existing = ao2_find(cache->field_indexes, name, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (existing) {
+		ao2_ref(params.index, -1);
+		params.index = existing;
+	} else {
+		ao2_link_flags(cache->field_indexes, params.index, OBJ_NOLOCK);
+	}
+	ao2_unlock(cache->field_indexes);
+
+	return params.index;
+}
+
+/*!
+ * \internal
+ * \brief Compare the cached objects against a retrieval request
+ *
+ * When a requested field can be looked up in a field index only the cached
+ * objects with its value are compared, rather than every cached object.
+ *
+ * \pre cache->objects is read-locked
+ *
+ * \param cache The sorcery memory cache
+ * \param params The comparison parameters
+ *
+ * \return The matching cached object if no container is given in the parameters
+ */
+static struct sorcery_memory_cached_object *memory_cache_fields_find(struct sorcery_memory_cache *cache,
+	struct sorcery_memory_cache_fields_cmp_params *params)
+{
+	const struct ast_variable *field = indexable_field(params->fields);
+	struct sorcery_memory_cache_field_index *index = NULL;
+	struct sorcery_memory_cache_index_entry *entry;
+	struct sorcery_memory_cached_object *cached = NULL;
+	struct ao2_iterator *it;
+
+	if (field) {
+		index = field_index_get(params->sorcery, cache, field->name);
+	}
+	if (!index) {
+		return ao2_callback(cache->objects, OBJ_NOLOCK, sorcery_memory_cache_fields_cmp, params);
+	}
+
+	it = ao2_find(index->entries, field->value, OBJ_SEARCH_KEY | OBJ_MULTIPLE);
+	while (it && (entry = ao2_iterator_next(it))) {
+		if (sorcery_memory_cache_fields_cmp(entry->cached, params, 0) & CMP_MATCH) {
+			cached = ao2_bump(entry->cached);
+			ao2_ref(entry, -1);
+			break;
+		}
+		ao2_ref(entry, -1);
+	}
+	if (it) {
+		ao2_iterator_destroy(it);
+	}
+	ao2_ref(index, -1);
+
+	return cached;
+}
+
+/*!
+ * \internal
+ * \brief Callback function to retrieve a single object based on fields
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object to retrieve
+ * \param fields Any explicit fields to search for
+ */
+static void *sorcery_memory_cache_retrieve_fields(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const struct ast_variable *fields)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cache_fields_cmp_params params = {
+		.sorcery = sorcery,
+		.cache = cache,
+		.fields = fields,
+	};
+	struct sorcery_memory_cached_object *cached;
+	void *object = NULL;
+
+	if (is_passthru_update() || !cache->full_backend_cache || !fields) {
+		return NULL;
+	}
+
+	ao2_rdlock(cache->objects);
+	cached = memory_cache_fields_find(cache, &params);
+	ao2_unlock(cache->objects);
+
+	if (cached) {
+		memory_cache_stale_check_object(sorcery, cache, cached);
+		object = ao2_bump(cached->object);
+		ao2_ref(cached, -1);
+	}
+
+	return object;
+}
+
+/*!
+ * \internal
+ * \brief Callback function to retrieve multiple objects from a memory cache
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object to retrieve
+ * \param objects Container to place the objects into
+ * \param fields Any explicit fields to search for
+ */
+static void sorcery_memory_cache_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type,
+	struct ao2_container *objects, const struct ast_variable *fields)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cache_fields_cmp_params params = {
+		.sorcery = sorcery,
+		.cache = cache,
+		.fields = fields,
+		.container = objects,
+	};
+
+	if (is_passthru_update() || !cache->full_backend_cache) {
+		return;
+	}
+
+	memory_cache_full_update(sorcery, type, cache);
+	ao2_rdlock(cache->objects);
+	memory_cache_fields_find(cache, &params);
+	ao2_unlock(cache->objects);
+
+	if (ao2_container_count(objects)) {
+		memory_cache_stale_check(sorcery, cache);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find the literal text every id matching a regular expression starts with
+ *
+ * Only an expression anchored at the start, without alternation, has a prefix.
+ *
+ * \param regex The regular expression
+ * \param prefix Buffer for the prefix, at least as long as the expression
+ *
+ * \return The length of the prefix, 0 if there is none
+ */
+static size_t regex_literal_prefix(const char *regex, char *prefix)
+{
+	size_t len = 0;
+
+	if (*regex != '^' || strchr(regex, '|')) {
+		return 0;
+	}
+
+	for (++regex; *regex && !strchr(".[]()*+?{}\\^$", *regex); ++regex) {
+		prefix[len++] = *regex;
+	}
+	if (len && *regex && strchr("*?{", *regex)) {
+		/* The last character may not be there at all */
+		--len;
+	}
+	prefix[len] = '\0';
+
+	return len;
+}
+
+/*!
+ * \internal
+ * \brief ao2 callback function comparing the cached objects starting with a prefix
+ *
+ * \param obj A cached object
+ * \param arg The prefix
+ * \param data The comparison parameters
+ * \param flags Search flags
+ */
+static int sorcery_memory_cache_prefix_cmp(void *obj, void *arg, void *data, int flags)
+{
+	return sorcery_memory_cache_fields_cmp(obj, data, flags);
+}
+
+/*!
+ * \internal
+ * \brief Callback function to retrieve multiple objects using a regex on the object id
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object to retrieve
+ * \param objects Container to place the objects into
+ * \param regex Regular expression to apply to the object id
+ */
 static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcery, void *data, const char *type,
 	struct ao2_container *objects, const char *regex)
 {
@@ -1375,13 +2012,22 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 		.container = objects,
 		.regex = &expression,
 	};
+	char *prefix;
 
 	if (is_passthru_update() || !cache->full_backend_cache || regcomp(&expression, regex, REG_EXTENDED | REG_NOSUB)) {
 		return;
 	}
 
 	memory_cache_full_update(sorcery, type, cache);
-	ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+
+	prefix = ast_alloca(strlen(regex) + 1);
+	if (regex_literal_prefix(regex, prefix)) {
+		/* The objects are sorted by id so only those starting with the prefix can match */
+		ao2_callback_data(cache->objects, OBJ_SEARCH_PARTIAL_KEY | OBJ_MULTIPLE | OBJ_NODATA,
+			sorcery_memory_cache_prefix_cmp, prefix, &params);
+	} else {
+		ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+	}
 	regfree(&expression);
 
 	if (ao2_container_count(objects)) {
@@ -1389,6 +2035,24 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 	}
 }
 
+/*!
+ * \internal
+ * \brief ao2 callback function to gather the cached objects matching a prefix
+ *
+ * \param obj A cached object
+ * \param arg The prefix
+ * \param data The container to put the object into
+ * \param flags Search flags
+ */
+static int sorcery_memory_cache_prefix_link(void *obj, void *arg, void *data, int flags)
+{
+	struct sorcery_memory_cached_object *cached = obj;
+
+	ao2_link(data, cached->object);
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Callback function to retrieve multiple objects whose id matches a prefix
@@ -1403,20 +2067,20 @@ static void sorcery_memory_cache_retrieve_prefix(const struct ast_sorcery *sorce
 	struct ao2_container *objects, const char *prefix, const size_t prefix_len)
 {
 	struct sorcery_memory_cache *cache = data;
-	struct sorcery_memory_cache_fields_cmp_params params = {
-		.sorcery = sorcery,
-		.cache = cache,
-		.container = objects,
-		.prefix = prefix,
-		.prefix_len = prefix_len,
-	};
+	char *key;
 
 	if (is_passthru_update() || !cache->full_backend_cache) {
 		return;
 	}
 
 	memory_cache_full_update(sorcery, type, cache);
-	ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+
+	key = ast_alloca(prefix_len + 1);
+	ast_copy_string(key, prefix, prefix_len + 1);
+
+	/* The objects are sorted by id so only those starting with the prefix are visited */
+	ao2_callback_data(cache->objects, OBJ_SEARCH_PARTIAL_KEY | OBJ_MULTIPLE | OBJ_NODATA,
+		sorcery_memory_cache_prefix_link, key, objects);
 
 	if (ao2_container_count(objects)) {
 		memory_cache_stale_check(sorcery, cache);
@@ -1551,20 +2215,59 @@ static void *sorcery_memory_cache_open(const char *data)
 			cache->expire_on_reload = ast_true(value);
 		} else if (!strcasecmp(name, "full_backend_cache")) {
 			cache->full_backend_cache = ast_true(value);
+		} else if (!strcasecmp(name, "negative_lifetime")) {
+			if (configuration_parse_unsigned_integer(value, &cache->negative_lifetime) != 1) {
+				ast_log(LOG_ERROR, "Unsupported negative lifetime value of '%s' used for memory cache\n",
+					value);
+				return NULL;
+			}
 		} else {
 			ast_log(LOG_ERROR, "Unsupported option '%s' used for memory cache\n", name);
 			return NULL;
 		}
 	}
 
-	cache->objects = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
-		cache->maximum_objects ? cache->maximum_objects : CACHE_CONTAINER_BUCKET_SIZE,
-		sorcery_memory_cached_object_hash, NULL, sorcery_memory_cached_object_cmp);
+	if (cache->full_backend_cache) {
+		/*
+		 * Holding all of the objects makes a scan for each prefix retrieval
+		 * expensive, so keep them in id order instead.  Ids such as those of
+		 * PJSIP contacts, which start with the name of their AOR, can then
+		 * be found without looking at any other objects.
+		 */
+		cache->objects = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+			sorcery_memory_cached_object_sort, NULL);
+
+		/* Retrievals by fields are served from the whole cache, so are indexed */
+		cache->field_indexes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+			FIELD_INDEXES_BUCKET_SIZE, sorcery_memory_cache_field_index_hash_fn, NULL,
+			sorcery_memory_cache_field_index_cmp_fn);
+		if (!cache->field_indexes) {
+			ast_log(LOG_ERROR, "Could not create a container to hold field indexes for memory cache\n");
+			return NULL;
+		}
+	} else {
+		cache->objects = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+			cache->maximum_objects ? cache->maximum_objects : CACHE_CONTAINER_BUCKET_SIZE,
+			sorcery_memory_cached_object_hash, NULL, sorcery_memory_cached_object_cmp);
+	}
 	if (!cache->objects) {
 		ast_log(LOG_ERROR, "Could not create a container to hold cached objects for memory cache\n");
 		return NULL;
 	}
 
+	if (cache->negative_lifetime) {
+		cache->negatives = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+			NEGATIVES_BUCKET_SIZE, sorcery_memory_cache_negative_hash_fn, NULL,
+			sorcery_memory_cache_negative_cmp_fn);
+		cache->lookups = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+			NEGATIVES_BUCKET_SIZE, sorcery_memory_cache_lookup_hash_fn, NULL,
+			sorcery_memory_cache_lookup_cmp_fn);
+		if (!cache->negatives || !cache->lookups) {
+			ast_log(LOG_ERROR, "Could not create containers to hold ids not found for memory cache\n");
+			return NULL;
+		}
+	}
+
 	cache->object_heap = ast_heap_create(CACHE_HEAP_INIT_HEIGHT, age_cmp,
 		offsetof(struct sorcery_memory_cached_object, __heap_index));
 	if (!cache->object_heap) {
@@ -2368,6 +3071,18 @@ AST_TEST_DEFINE(open_with_valid_options)
 		sorcery_memory_cache_close(cache);
 	}
 
+	cache = sorcery_memory_cache_open("negative_lifetime=30");
+	if (!cache) {
+		ast_test_status_update(test, "Failed to create a sorcery memory cache with a negative lifetime of 30\n");
+		res = AST_TEST_FAIL;
+	} else {
+		if (cache->negative_lifetime != 30 || !cache->negatives) {
+			ast_test_status_update(test, "Created a sorcery memory cache with a negative lifetime of 30 but it has '%u'\n",
+				cache->negative_lifetime);
+		}
+		sorcery_memory_cache_close(cache);
+	}
+
 
 	return res;
 }
@@ -2389,7 +3104,8 @@ AST_TEST_DEFINE(open_with_invalid_options)
 			"\t* Create a memory cache with a maximum object lifetime of -1\n"
 			"\t* Create a memory cache with a maximum object lifetime of toast\n"
 			"\t* Create a memory cache with a stale object lifetime of -1\n"
-			"\t* Create a memory cache with a stale object lifetime of toast";
+			"\t* Create a memory cache with a stale object lifetime of toast\n"
+			"\t* Create a memory cache with a negative lifetime of toast";
 		return AST_TEST_NOT_RUN;
 	case TEST_EXECUTE:
 		break;
@@ -2444,6 +3160,13 @@ AST_TEST_DEFINE(open_with_invalid_options)
 		res = AST_TEST_FAIL;
 	}
 
+	cache = sorcery_memory_cache_open("negative_lifetime=toast");
+	if (cache) {
+		ast_test_status_update(test, "Created a sorcery memory cache with a negative lifetime of toast\n");
+		sorcery_memory_cache_close(cache);
+		res = AST_TEST_FAIL;
+	}
+
 	cache = sorcery_memory_cache_open("tacos");
 	if (cache) {
 		ast_test_status_update(test, "Created a sorcery memory cache with an invalid configuration option 'tacos'\n");
@@ -2968,6 +3691,8 @@ static struct backend_data {
 	int pepper;
 	/*! Indicates whether the backend has data */
 	int exists;
+	/*! Number of objects retrieved by id */
+	int retrievals;
 } *real_backend_data;
 
 /*!
@@ -2979,6 +3704,8 @@ struct test_data {
 	int salt;
 	/*! Mirrors the backend data's pepper field */
 	int pepper;
+	/*! Whether the object is odd or even, as its id starts */
+	char parity[5];
 };
 
 /*!
@@ -3009,6 +3736,7 @@ static void *mock_retrieve_id(const struct ast_sorcery *sorcery, void *data,
 {
 	struct test_data *b_data;
 
+	++real_backend_data->retrievals;
 	if (!real_backend_data->exists) {
 		return NULL;
 	}
@@ -3029,6 +3757,7 @@ static void *mock_retrieve_id(const struct ast_sorcery *sorcery, void *data,
  * The mock wizard uses the \ref real_backend_data in order to construct
  * objects. If the backend data is "nonexisent" then no object is returned.
  * Otherwise, the number of objects matching the exists value will be returned.
+ * Their ids alternately start with "even-" and "odd-".
  *
  * \param sorcery The sorcery instance
  * \param data Unused
@@ -3047,21 +3776,35 @@ static void mock_retrieve_multiple(const struct ast_sorcery *sorcery, void *data
 
 	for (i = 0; i < real_backend_data->exists; ++i) {
 		char uuid[AST_UUID_STR_LEN];
+		char id[AST_UUID_STR_LEN + 5];
 		struct test_data *b_data;
 
-		b_data = ast_sorcery_alloc(sorcery, type, ast_uuid_generate_str(uuid, sizeof(uuid)));
+		snprintf(id, sizeof(id), "%s-%s", i % 2 ? "odd" : "even",
+			ast_uuid_generate_str(uuid, sizeof(uuid)));
+		b_data = ast_sorcery_alloc(sorcery, type, id);
 		if (!b_data) {
 			continue;
 		}
 
 		b_data->salt = real_backend_data->salt;
 		b_data->pepper = real_backend_data->pepper;
+		strcpy(b_data->parity, i % 2 ? "odd" : "even"); /* Safe */
 
 		ao2_link(objects, b_data);
 		ao2_ref(b_data, -1);
 	}
 }
 
+/*!
+ * \brief Callback for deleting a sorcery object
+ *
+ * The backend always agrees, so the object is removed from the cache.
+ */
+static int mock_delete(const struct ast_sorcery *sorcery, void *data, void *object)
+{
+	return 0;
+}
+
 /*!
  * \brief A mock sorcery wizard used for the stale test
  */
@@ -3069,6 +3812,7 @@ static struct ast_sorcery_wizard mock_wizard = {
 	.name = "mock",
 	.retrieve_id = mock_retrieve_id,
 	.retrieve_multiple = mock_retrieve_multiple,
+	.delete = mock_delete,
 };
 
 /*!
@@ -3485,6 +4229,458 @@ cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(full_backend_cache_prefix)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct backend_data initial = {
+		.salt = 0,
+		.pepper = 0,
+		.exists = 6,
+	};
+	struct ao2_container *objects;
+	static const struct {
+		const char *prefix;
+		int count;
+	} prefixes[] = {
+		{ "even-", 3 },
+		{ "odd-", 3 },
+		{ "o", 3 },
+		{ "e", 3 },
+		{ "", 6 },
+		{ "none", 0 },
+	};
+	static const struct {
+		const char *regex;
+		int count;
+	} regexes[] = {
+		{ "^even-", 3 },
+		{ "^odd-[0-9a-f]", 3 },
+		{ "^oz?", 3 },
+		{ "^(odd|even)-", 6 },
+		{ "^none", 0 },
+		{ "-", 6 },
+	};
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "full_backend_cache_prefix";
+		info->category = "/res/res_sorcery_memory_cache/";
+		info->summary = "Ensure that the full backend cache retrieves objects by prefix";
+		info->description = "This test performs the following:\n"
+			"\t* Create a sorcery instance with two wizards"
+			"\t\t* The first is a memory cache that does full backend caching\n"
+			"\t\t* The second is a mock of a back-end\n"
+			"\t* Populates the cache by requesting all objects which returns 6.\n"
+			"\t* Retrieves objects by several prefixes of their ids.\n"
+			"\t* Confirms only the objects matching each prefix are returned.\n"
+			"\t* Does the same with regular expressions, anchored and not.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_sorcery_wizard_register(&mock_wizard);
+
+	sorcery = ast_sorcery_open();
+	if (!sorcery) {
+		ast_test_status_update(test, "Failed to create sorcery instance\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "memory_cache",
+			"full_backend_cache=yes", 1);
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "mock", NULL, 0);
+	ast_sorcery_internal_object_register(sorcery, "test", test_data_alloc, NULL, NULL);
+	ast_sorcery_object_field_register_nodoc(sorcery, "test", "salt", "0", OPT_UINT_T, 0, FLDSET(struct test_data, salt));
+	ast_sorcery_object_field_register_nodoc(sorcery, "test", "pepper", "0", OPT_UINT_T, 0, FLDSET(struct test_data, pepper));
+
+	real_backend_data = &initial;
+
+	/* Get all current objects in the backend */
+	objects = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (!objects) {
+		ast_test_status_update(test, "Unable to retrieve all objects in backend and populate cache\n");
+		goto cleanup;
+	}
+	ao2_ref(objects, -1);
+
+	for (i = 0; i < ARRAY_LEN(prefixes); ++i) {
+		struct ao2_iterator iter;
+		struct test_data *object;
+		int matching = 1;
+
+		objects = ast_sorcery_retrieve_by_prefix(sorcery, "test", prefixes[i].prefix,
+			strlen(prefixes[i].prefix));
+		if (!objects) {
+			ast_test_status_update(test, "Unable to retrieve objects by prefix '%s'\n",
+				prefixes[i].prefix);
+			goto cleanup;
+		}
+
+		iter = ao2_iterator_init(objects, 0);
+		for (; (object = ao2_iterator_next(&iter)); ao2_ref(object, -1)) {
+			if (!ast_begins_with(ast_sorcery_object_get_id(object), prefixes[i].prefix)) {
+				matching = 0;
+			}
+		}
+		ao2_iterator_destroy(&iter);
+
+		if (!matching || ao2_container_count(objects) != prefixes[i].count) {
+			ast_test_status_update(test, "Retrieved %d objects by prefix '%s' instead of %d\n",
+				ao2_container_count(objects), prefixes[i].prefix, prefixes[i].count);
+			ao2_ref(objects, -1);
+			goto cleanup;
+		}
+		ao2_ref(objects, -1);
+	}
+
+	for (i = 0; i < ARRAY_LEN(regexes); ++i) {
+		objects = ast_sorcery_retrieve_by_regex(sorcery, "test", regexes[i].regex);
+		if (!objects) {
+			ast_test_status_update(test, "Unable to retrieve objects by regex '%s'\n",
+				regexes[i].regex);
+			goto cleanup;
+		}
+
+		if (ao2_container_count(objects) != regexes[i].count) {
+			ast_test_status_update(test, "Retrieved %d objects by regex '%s' instead of %d\n",
+				ao2_container_count(objects), regexes[i].regex, regexes[i].count);
+			ao2_ref(objects, -1);
+			goto cleanup;
+		}
+		ao2_ref(objects, -1);
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	if (sorcery) {
+		ast_sorcery_unref(sorcery);
+	}
+	ast_sorcery_wizard_unregister(&mock_wizard);
+	return res;
+}
+
+AST_TEST_DEFINE(negative)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct backend_data backend = {
+		.salt = 0,
+		.pepper = 0,
+		.exists = 0,
+	};
+	struct test_data *object = NULL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "negative";
+		info->category = "/res/res_sorcery_memory_cache/";
+		info->summary = "Ensure that objects not found are remembered for the negative lifetime";
+		info->description = "This test performs the following:\n"
+			"\t* Create a sorcery instance with two wizards"
+			"\t\t* The first is a memory cache with a negative lifetime of 1 second\n"
+			"\t\t* The second is a mock of a back-end\n"
+			"\t* Retrieves an object that does not exist twice, querying the back-end once\n"
+			"\t* Adds the object to the back-end and confirms it is still not found\n"
+			"\t* Waits for the negative lifetime and confirms the object is now found";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_sorcery_wizard_register(&mock_wizard);
+
+	sorcery = ast_sorcery_open();
+	if (!sorcery) {
+		ast_test_status_update(test, "Failed to create sorcery instance\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "memory_cache", "negative_lifetime=1", 1);
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "mock", NULL, 0);
+	ast_sorcery_internal_object_register(sorcery, "test", test_data_alloc, NULL, NULL);
+
+	real_backend_data = &backend;
+
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	if (object || backend.retrievals != 1) {
+		ast_test_status_update(test, "Retrieved a nonexistent object or queried the backend %d times\n",
+			backend.retrievals);
+		goto cleanup;
+	}
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	if (object || backend.retrievals != 1) {
+		ast_test_status_update(test, "Queried the backend again for an object known not to exist\n");
+		goto cleanup;
+	}
+
+	backend.exists = 1;
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	if (object || backend.retrievals != 1) {
+		ast_test_status_update(test, "Queried the backend within the negative lifetime\n");
+		goto cleanup;
+	}
+
+	sleep(2);
+
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	if (!object || backend.retrievals != 2) {
+		ast_test_status_update(test, "Did not retrieve the object after the negative lifetime\n");
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ao2_cleanup(object);
+	if (sorcery) {
+		ast_sorcery_unref(sorcery);
+	}
+	ast_sorcery_wizard_unregister(&mock_wizard);
+	return res;
+}
+
+AST_TEST_DEFINE(negative_refresh)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct backend_data backend = {
+		.salt = 0,
+		.pepper = 0,
+		.exists = 0,
+	};
+	struct test_data *object = NULL;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "negative_refresh";
+		info->category = "/res/res_sorcery_memory_cache/";
+		info->summary = "Ensure that looking up a missing object does not extend its negative lifetime";
+		info->description = "This test performs the following:\n"
+			"\t* Create a sorcery instance with two wizards"
+			"\t\t* The first is a memory cache with a negative lifetime of 2 seconds\n"
+			"\t\t* The second is a mock of a back-end\n"
+			"\t* Retrieves an object that does not exist, then adds it to the back-end\n"
+			"\t* Retrieves the object every half second for three seconds\n"
+			"\t* Confirms the object is found once the negative lifetime passed";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_sorcery_wizard_register(&mock_wizard);
+
+	sorcery = ast_sorcery_open();
+	if (!sorcery) {
+		ast_test_status_update(test, "Failed to create sorcery instance\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "memory_cache", "negative_lifetime=2", 1);
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "mock", NULL, 0);
+	ast_sorcery_internal_object_register(sorcery, "test", test_data_alloc, NULL, NULL);
+
+	real_backend_data = &backend;
+
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	if (object || backend.retrievals != 1) {
+		ast_test_status_update(test, "Retrieved a nonexistent object or queried the backend %d times\n",
+			backend.retrievals);
+		goto cleanup;
+	}
+
+	backend.exists = 1;
+	for (i = 0; i < 6 && !object; i++) {
+		usleep(500000);
+		object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	}
+	if (!object || backend.retrievals != 2) {
+		ast_test_status_update(test, "Frequent lookups kept the object missing past its negative lifetime\n");
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ao2_cleanup(object);
+	if (sorcery) {
+		ast_sorcery_unref(sorcery);
+	}
+	ast_sorcery_wizard_unregister(&mock_wizard);
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Count the objects retrieved by fields, checking they all have a parity
+ *
+ * \return The number of objects, or -1 if they could not be retrieved or one
+ *         has another parity
+ */
+static int retrieve_parity_count(struct ast_sorcery *sorcery, struct ast_variable *fields,
+	const char *parity)
+{
+	struct ao2_container *objects;
+	struct ao2_iterator iter;
+	struct test_data *object;
+	int count;
+
+	objects = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_MULTIPLE, fields);
+	if (!objects) {
+		return -1;
+	}
+
+	count = ao2_container_count(objects);
+	iter = ao2_iterator_init(objects, 0);
+	for (; (object = ao2_iterator_next(&iter)); ao2_ref(object, -1)) {
+		if (strcmp(object->parity, parity)) {
+			count = -1;
+		}
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_ref(objects, -1);
+
+	return count;
+}
+
+AST_TEST_DEFINE(full_backend_cache_fields)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct backend_data initial = {
+		.salt = 0,
+		.pepper = 0,
+		.exists = 6,
+	};
+	struct ao2_container *objects;
+	struct ast_variable *odd = ast_variable_new("parity", "odd", "");
+	struct ast_variable *even_salted = ast_variable_new("parity", "even", "");
+	struct ast_variable *none = ast_variable_new("parity", "none", "");
+	struct test_data *object = NULL;
+	int count;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "full_backend_cache_fields";
+		info->category = "/res/res_sorcery_memory_cache/";
+		info->summary = "Ensure that the full backend cache retrieves objects by fields";
+		info->description = "This test performs the following:\n"
+			"\t* Create a sorcery instance with two wizards"
+			"\t\t* The first is a memory cache that does full backend caching\n"
+			"\t\t* The second is a mock of a back-end\n"
+			"\t* Populates the cache by requesting all objects which returns 6.\n"
+			"\t* Retrieves objects by a string field, alone and with another field.\n"
+			"\t* Deletes an object and confirms it is no longer retrieved.\n"
+			"\t* Declares the field indexed and repeats the delete.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!odd || !even_salted || !none) {
+		ast_test_status_update(test, "Failed to create fields for retrieval\n");
+		goto cleanup;
+	}
+	even_salted->next = ast_variable_new("salt", "0", "");
+	if (!even_salted->next) {
+		ast_test_status_update(test, "Failed to create fields for retrieval\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_wizard_register(&mock_wizard);
+
+	sorcery = ast_sorcery_open();
+	if (!sorcery) {
+		ast_test_status_update(test, "Failed to create sorcery instance\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "memory_cache",
+			"full_backend_cache=yes", 1);
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "mock", NULL, 0);
+	ast_sorcery_internal_object_register(sorcery, "test", test_data_alloc, NULL, NULL);
+	ast_sorcery_object_field_register_nodoc(sorcery, "test", "salt", "0", OPT_UINT_T, 0, FLDSET(struct test_data, salt));
+	ast_sorcery_object_field_register_nodoc(sorcery, "test", "pepper", "0", OPT_UINT_T, 0, FLDSET(struct test_data, pepper));
+	ast_sorcery_object_field_register_nodoc(sorcery, "test", "parity", "", OPT_CHAR_ARRAY_T, 0, CHARFLDSET(struct test_data, parity));
+
+	real_backend_data = &initial;
+
+	/* Get all current objects in the backend */
+	objects = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (!objects) {
+		ast_test_status_update(test, "Unable to retrieve all objects in backend and populate cache\n");
+		goto cleanup;
+	}
+	ao2_ref(objects, -1);
+
+	if ((count = retrieve_parity_count(sorcery, odd, "odd")) != 3) {
+		ast_test_status_update(test, "Retrieved %d odd objects instead of 3\n", count);
+		goto cleanup;
+	}
+	if ((count = retrieve_parity_count(sorcery, even_salted, "even")) != 3) {
+		ast_test_status_update(test, "Retrieved %d even objects with salt 0 instead of 3\n", count);
+		goto cleanup;
+	}
+	if ((count = retrieve_parity_count(sorcery, none, "none")) != 0) {
+		ast_test_status_update(test, "Retrieved %d objects of no parity instead of 0\n", count);
+		goto cleanup;
+	}
+
+	/* The cache changing must be seen by later retrievals */
+	object = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_DEFAULT, odd);
+	if (!object || strcmp(object->parity, "odd")) {
+		ast_test_status_update(test, "Unable to retrieve an odd object\n");
+		goto cleanup;
+	}
+	if (ast_sorcery_delete(sorcery, object)) {
+		ast_test_status_update(test, "Unable to delete an odd object\n");
+		goto cleanup;
+	}
+	if ((count = retrieve_parity_count(sorcery, odd, "odd")) != 2) {
+		ast_test_status_update(test, "Retrieved %d odd objects after a delete instead of 2\n", count);
+		goto cleanup;
+	}
+	ao2_ref(object, -1);
+	object = NULL;
+
+	/* The index of a declared field is updated rather than built again */
+	if (ast_sorcery_object_field_index(sorcery, "test", "parity")
+		|| !ast_sorcery_object_field_is_indexed(sorcery, "test", "parity")) {
+		ast_test_status_update(test, "Unable to declare the parity field indexed\n");
+		goto cleanup;
+	}
+	object = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_DEFAULT, odd);
+	if (!object || ast_sorcery_delete(sorcery, object)) {
+		ast_test_status_update(test, "Unable to retrieve and delete an odd object by an indexed field\n");
+		goto cleanup;
+	}
+	if ((count = retrieve_parity_count(sorcery, odd, "odd")) != 1) {
+		ast_test_status_update(test, "Retrieved %d odd objects by an indexed field instead of 1\n", count);
+		goto cleanup;
+	}
+	if ((count = retrieve_parity_count(sorcery, even_salted, "even")) != 3) {
+		ast_test_status_update(test, "Retrieved %d even objects by an indexed field instead of 3\n", count);
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ao2_cleanup(object);
+	if (sorcery) {
+		ast_sorcery_unref(sorcery);
+	}
+	ast_sorcery_wizard_unregister(&mock_wizard);
+	ast_variables_destroy(odd);
+	ast_variables_destroy(even_salted);
+	ast_variables_destroy(none);
+	return res;
+}
+
 #endif
 
 static int unload_module(void)
@@ -3499,6 +4695,10 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(stale);
 	AST_TEST_UNREGISTER(full_backend_cache_expiration);
 	AST_TEST_UNREGISTER(full_backend_cache_stale);
+	AST_TEST_UNREGISTER(full_backend_cache_prefix);
+	AST_TEST_UNREGISTER(full_backend_cache_fields);
+	AST_TEST_UNREGISTER(negative);
+	AST_TEST_UNREGISTER(negative_refresh);
 
 	ast_manager_unregister("SorceryMemoryCacheExpireObject");
 	ast_manager_unregister("SorceryMemoryCacheExpire");
@@ -3581,6 +4781,10 @@ static int load_module(void)
 	AST_TEST_REGISTER(expiration);
 	AST_TEST_REGISTER(full_backend_cache_expiration);
 	AST_TEST_REGISTER(full_backend_cache_stale);
+	AST_TEST_REGISTER(full_backend_cache_prefix);
+	AST_TEST_REGISTER(full_backend_cache_fields);
+	AST_TEST_REGISTER(negative);
+	AST_TEST_REGISTER(negative_refresh);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
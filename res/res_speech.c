@@ -132,6 +132,9 @@ void ast_speech_start(struct ast_speech *speech)
 		speech->results = NULL;
 	}
 
+	/* Audio gathered before is not part of what is recognized now */
+	speech->batch_len = 0;
+
 	/* If the engine needs to start stuff up, do it */
 	if (speech->engine->start)
 		speech->engine->start(speech);
@@ -139,14 +142,73 @@ void ast_speech_start(struct ast_speech *speech)
 	return;
 }
 
+/*! \brief Write the audio gathered to the engine */
+static int speech_batch_flush(struct ast_speech *speech)
+{
+	int res;
+
+	if (!speech->batch_len) {
+		return 0;
+	}
+
+	res = speech->engine->write(speech, speech->batch, speech->batch_len);
+	speech->batch_len = 0;
+
+	return res;
+}
+
 /*! \brief Write in signed linear audio to be recognized */
 int ast_speech_write(struct ast_speech *speech, void *data, int len)
 {
 	/* Make sure the speech engine is ready to accept audio */
-	if (speech->state != AST_SPEECH_STATE_READY)
+	if (speech->state != AST_SPEECH_STATE_READY) {
+		speech->batch_len = 0;
+		return -1;
+	}
+
+	if (!speech->batch_size || len <= 0) {
+		return speech->engine->write(speech, data, len);
+	}
+
+	if (speech->batch_len + len > speech->batch_size) {
+		if (speech_batch_flush(speech) || speech->state != AST_SPEECH_STATE_READY) {
+			return -1;
+		}
+		if (len >= speech->batch_size) {
+			/* As much as a whole batch, there is nothing to gather */
+			return speech->engine->write(speech, data, len);
+		}
+	}
+
+	memcpy(speech->batch + speech->batch_len, data, len);
+	speech->batch_len += len;
+
+	return speech->batch_len == speech->batch_size ? speech_batch_flush(speech) : 0;
+}
+
+int ast_speech_write_batch(struct ast_speech *speech, unsigned int ms)
+{
+	size_t size = ast_format_determine_length(speech->format,
+		(uint64_t) ast_format_get_sample_rate(speech->format) * ms / 1000);
+	unsigned char *batch;
+
+	if (speech_batch_flush(speech)) {
 		return -1;
+	}
 
-	return speech->engine->write(speech, data, len);
+	if (size == speech->batch_size) {
+		return 0;
+	}
+
+	batch = size ? ast_malloc(size) : NULL;
+	if (size && !batch) {
+		return -1;
+	}
+	ast_free(speech->batch);
+	speech->batch = batch;
+	speech->batch_size = size;
+
+	return 0;
 }
 
 /*! \brief Signal to the engine that DTMF was received */
@@ -157,6 +219,11 @@ int ast_speech_dtmf(struct ast_speech *speech, const char *dtmf)
 	if (speech->state != AST_SPEECH_STATE_READY)
 		return -1;
 
+	/* Audio heard before the digit goes to the engine first */
+	if (speech_batch_flush(speech)) {
+		return -1;
+	}
+
 	if (speech->engine->dtmf != NULL) {
 		res = speech->engine->dtmf(speech, dtmf);
 	}
@@ -230,6 +297,8 @@ struct ast_speech *ast_speech_new(const char *engine_name, const struct ast_form
 		ast_mutex_destroy(&new_speech->lock);
 		ast_free(new_speech);
 		new_speech = NULL;
+	} else if (engine->write_batch_ms) {
+		ast_speech_write_batch(new_speech, engine->write_batch_ms);
 	}
 
 	return new_speech;
@@ -254,6 +323,8 @@ int ast_speech_destroy(struct ast_speech *speech)
 	if (speech->processing_sound)
 		ast_free(speech->processing_sound);
 
+	ast_free(speech->batch);
+
 	ao2_ref(speech->format, -1);
 
 	/* Aloha we are done */
@@ -89,6 +89,7 @@ static int ast_srtp_change_source(struct ast_srtp *srtp, unsigned int from_ssrc,
 
 static int ast_srtp_unprotect(struct ast_srtp *srtp, void *buf, int *len, int rtcp);
 static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtcp);
+static int ast_srtp_protect_in_place(struct ast_srtp *srtp, void *buf, int *len, size_t capacity, int rtcp);
 static void ast_srtp_set_cb(struct ast_srtp *srtp, const struct ast_srtp_cb *cb, void *data);
 static int ast_srtp_get_random(unsigned char *key, size_t len);
 
@@ -108,7 +109,8 @@ static struct ast_srtp_res srtp_res = {
 	.set_cb = ast_srtp_set_cb,
 	.unprotect = ast_srtp_unprotect,
 	.protect = ast_srtp_protect,
-	.get_random = ast_srtp_get_random
+	.get_random = ast_srtp_get_random,
+	.protect_in_place = ast_srtp_protect_in_place,
 };
 
 static struct ast_srtp_policy_res policy_res = {
@@ -482,10 +484,9 @@ tryagain:
 	return *len;
 }
 
-static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtcp)
+static int ast_srtp_protect_in_place(struct ast_srtp *srtp, void *buf, int *len, size_t capacity, int rtcp)
 {
 	int res;
-	unsigned char *localbuf;
 
 	if (!srtp->session) {
 		ast_log(LOG_ERROR, "SRTP protect %s - missing session\n", rtcp ? "rtcp" : "rtp");
@@ -493,6 +494,24 @@ static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtc
 		return -1;
 	}
 
+	if ((*len + SRTP_MAX_TRAILER_LEN) > capacity) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	if ((res = rtcp ? srtp_protect_rtcp(srtp->session, buf, len) : srtp_protect(srtp->session, buf, len)) != err_status_ok && res != err_status_replay_fail) {
+		ast_log(LOG_WARNING, "SRTP protect: %s\n", srtp_errstr(res));
+		errno = EINVAL;
+		return -1;
+	}
+
+	return *len;
+}
+
+static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtcp)
+{
+	unsigned char *localbuf;
+
 	if ((*len + SRTP_MAX_TRAILER_LEN) > sizeof(srtp->buf)) {
 		return -1;
 	}
@@ -501,8 +520,7 @@ static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtc
 
 	memcpy(localbuf, *buf, *len);
 
-	if ((res = rtcp ? srtp_protect_rtcp(srtp->session, localbuf, len) : srtp_protect(srtp->session, localbuf, len)) != err_status_ok && res != err_status_replay_fail) {
-		ast_log(LOG_WARNING, "SRTP protect: %s\n", srtp_errstr(res));
+	if (ast_srtp_protect_in_place(srtp, localbuf, len, sizeof(srtp->buf), rtcp) < 0) {
 		return -1;
 	}
 
@@ -38,6 +38,7 @@
 #include "asterisk/file.h"
 #include "asterisk/logger.h"
 #include "asterisk/module.h"
+#include "asterisk/options.h"
 #include "asterisk/paths.h"
 #include "asterisk/stasis_app_impl.h"
 #include "asterisk/stasis_app_playback.h"
@@ -282,6 +283,79 @@ static void playback_final_update(struct stasis_app_playback *playback,
 	playback_publish(playback);
 }
 
+/*! The sound files a playback will play after the one it starts with */
+struct playback_prefetch {
+	AST_VECTOR(, char *) files;
+	char language[0];
+};
+
+static void playback_prefetch_destroy(struct playback_prefetch *prefetch)
+{
+	AST_VECTOR_RESET(&prefetch->files, ast_free);
+	AST_VECTOR_FREE(&prefetch->files);
+	ast_free(prefetch);
+}
+
+static void *playback_prefetch_thread(void *data)
+{
+	struct playback_prefetch *prefetch = data;
+	size_t i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&prefetch->files); ++i) {
+		ast_file_prefetch(AST_VECTOR_GET(&prefetch->files, i), prefetch->language);
+	}
+	playback_prefetch_destroy(prefetch);
+
+	return NULL;
+}
+
+/*!
+ * \brief Read the sounds a playback plays after the current one into the prompt cache.
+ *
+ * The files are read in the background while the first one plays, so the
+ * next one does not wait on the disk.
+ */
+static void playback_prefetch(struct stasis_app_playback *playback)
+{
+	struct playback_prefetch *prefetch;
+	pthread_t thread;
+	size_t i;
+
+	if (!ast_option_prompt_cache_size
+		|| AST_VECTOR_SIZE(&playback->medias) - playback->media_index < 2) {
+		return;
+	}
+
+	prefetch = ast_calloc(1, sizeof(*prefetch) + strlen(playback->language) + 1);
+	if (!prefetch) {
+		return;
+	}
+	strcpy(prefetch->language, playback->language); /* Safe */
+	if (AST_VECTOR_INIT(&prefetch->files, AST_VECTOR_SIZE(&playback->medias))) {
+		ast_free(prefetch);
+		return;
+	}
+
+	for (i = playback->media_index + 1; i < AST_VECTOR_SIZE(&playback->medias); ++i) {
+		const char *media = AST_VECTOR_GET(&playback->medias, i);
+		char *file;
+
+		if (!ast_begins_with(media, SOUND_URI_SCHEME)) {
+			continue;
+		}
+		file = ast_strdup(media + strlen(SOUND_URI_SCHEME));
+		if (!file || AST_VECTOR_APPEND(&prefetch->files, file)) {
+			ast_free(file);
+			break;
+		}
+	}
+
+	if (!AST_VECTOR_SIZE(&prefetch->files)
+		|| ast_pthread_create_detached_background(&thread, NULL, playback_prefetch_thread, prefetch)) {
+		playback_prefetch_destroy(prefetch);
+	}
+}
+
 static void play_on_channel(struct stasis_app_playback *playback,
 	struct ast_channel *chan)
 {
@@ -305,6 +379,8 @@ static void play_on_channel(struct stasis_app_playback *playback,
 
 	offsetms = playback->offsetms;
 
+	playback_prefetch(playback);
+
 	for (; playback->media_index < AST_VECTOR_SIZE(&playback->medias); playback->media_index++) {
 
 		/* Set the current media to play */
@@ -187,20 +187,6 @@ static struct ast_frame *snoop_read(struct ast_channel *chan)
 	}
 
 	ast_audiohook_lock(&snoop->spy);
-	if (snoop->spy_direction != AST_AUDIOHOOK_DIRECTION_BOTH) {
-		/*
-		 * When a singular direction is chosen frames are still written to the
-		 * opposing direction's queue. Those frames must be read so the queue
-		 * does not continue to grow, however since they are not needed for the
-		 * selected direction they can be dropped.
-		 */
-		enum ast_audiohook_direction opposing_direction =
-			snoop->spy_direction == AST_AUDIOHOOK_DIRECTION_READ ?
-			AST_AUDIOHOOK_DIRECTION_WRITE : AST_AUDIOHOOK_DIRECTION_READ;
-		ast_frame_dtor(ast_audiohook_read_frame(&snoop->spy, snoop->spy_samples,
-							opposing_direction, snoop->spy_format));
-	}
-
 	frame = ast_audiohook_read_frame(&snoop->spy, snoop->spy_samples, snoop->spy_direction, snoop->spy_format);
 	ast_audiohook_unlock(&snoop->spy);
 
@@ -292,6 +278,13 @@ static int snoop_setup_audiohook(struct ast_channel *chan, enum ast_audiohook_ty
 		return -1;
 	}
 
+	/* A spy on a single direction is not fed the other one, which it would only discard */
+	if (type == AST_AUDIOHOOK_TYPE_SPY && *direction == AST_AUDIOHOOK_DIRECTION_READ) {
+		ast_set_flag(audiohook, AST_AUDIOHOOK_SKIP_WRITE);
+	} else if (type == AST_AUDIOHOOK_TYPE_SPY && *direction == AST_AUDIOHOOK_DIRECTION_WRITE) {
+		ast_set_flag(audiohook, AST_AUDIOHOOK_SKIP_READ);
+	}
+
 	return ast_audiohook_attach(chan, audiohook);
 }
 
@@ -0,0 +1,275 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \brief Statsd Stasis stats.
+ *
+ * This module periodically sends the message counts, mailbox depths and
+ * sampled dispatch latencies of the Stasis topics and subscriptions.
+ */
+
+/*** MODULEINFO
+	<depend>res_statsd</depend>
+	<defaultenabled>no</defaultenabled>
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/sched.h"
+#include "asterisk/stasis.h"
+#include "asterisk/statsd.h"
+#include "asterisk/vector.h"
+
+/*! How often the stats are sent, in milliseconds */
+#define STATS_INTERVAL 10000
+
+/*! Buckets for the topics and subscriptions seen */
+#define STATS_BUCKETS 53
+
+/*! Scheduler sending the stats */
+static struct ast_sched_context *sched;
+
+/*!
+ * \brief What was sent for each topic and subscription last time
+ *
+ * Counters are sent as the change since the previous interval.
+ */
+static struct ao2_container *last_sent;
+
+/*! Incremented on each interval, to forget what disappeared */
+static unsigned int generation;
+
+struct stats_last {
+	/*! The interval this was last seen on */
+	unsigned int generation;
+	/*! Messages published or dispatched */
+	uint64_t messages;
+	/*! Latency samples taken */
+	uint64_t samples;
+	/*! Sum of the latency samples, in microseconds */
+	long long latency_sum;
+	/*! "topic." or "subscription." followed by the sanitized name */
+	char key[0];
+};
+
+AO2_STRING_FIELD_HASH_FN(stats_last, key);
+AO2_STRING_FIELD_CMP_FN(stats_last, key);
+
+/*! \brief A topic or subscription as collected, sent once the topic is unlocked */
+struct stats_sample {
+	uint64_t messages;
+	long queued;
+	uint64_t samples;
+	long long latency_sum;
+	int is_subscription;
+	char name[0];
+};
+
+AST_VECTOR(stats_samples, struct stats_sample *);
+
+static struct stats_sample *stats_sample_alloc(const char *name)
+{
+	struct stats_sample *sample;
+	char *pos;
+
+	sample = ast_calloc(1, sizeof(*sample) + strlen(name) + 1);
+	if (!sample) {
+		return NULL;
+	}
+	strcpy(sample->name, name); /* Safe */
+
+	/* Statsd uses ':', '|' and '@' as separators and '.' for the hierarchy */
+	for (pos = sample->name; *pos; ++pos) {
+		if (!isalnum((unsigned char) *pos) && *pos != '-' && *pos != '_') {
+			*pos = '_';
+		}
+	}
+
+	return sample;
+}
+
+static void topic_metrics_cb(const struct stasis_topic_metrics *metrics, void *data)
+{
+	struct stats_samples *samples = data;
+	struct stats_sample *sample = stats_sample_alloc(metrics->name);
+
+	if (!sample) {
+		return;
+	}
+	sample->messages = metrics->published;
+	if (AST_VECTOR_APPEND(samples, sample)) {
+		ast_free(sample);
+	}
+}
+
+static void subscription_metrics_cb(const struct stasis_subscription_metrics *metrics, void *data)
+{
+	struct stats_samples *samples = data;
+	struct stats_sample *sample = stats_sample_alloc(metrics->uniqueid);
+
+	if (!sample) {
+		return;
+	}
+	sample->is_subscription = 1;
+	sample->messages = metrics->dispatched;
+	sample->queued = metrics->queued;
+	sample->samples = metrics->samples;
+	sample->latency_sum = metrics->latency_sum;
+	if (AST_VECTOR_APPEND(samples, sample)) {
+		ast_free(sample);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find what was sent for a topic or subscription last time
+ *
+ * \note Nothing was sent yet if the generation is still 0.
+ */
+static struct stats_last *stats_last_get(const char *prefix, const char *name)
+{
+	struct stats_last *last;
+	char *key;
+
+	if (ast_asprintf(&key, "%s%s", prefix, name) < 0) {
+		return NULL;
+	}
+
+	last = ao2_find(last_sent, key, OBJ_SEARCH_KEY);
+	if (!last) {
+		last = ao2_alloc_options(sizeof(*last) + strlen(key) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (last) {
+			strcpy(last->key, key); /* Safe */
+			ao2_link(last_sent, last);
+		}
+	}
+	ast_free(key);
+
+	return last;
+}
+
+static void send_sample(struct stats_sample *sample)
+{
+	struct stats_last *last;
+
+	last = stats_last_get(sample->is_subscription ? "subscription." : "topic.", sample->name);
+	if (!last) {
+		return;
+	}
+
+	/* The first time only the totals are known, counting starts from there */
+	if (last->generation && !sample->is_subscription) {
+		ast_statsd_log_full_va("stasis.topic.%s.published", AST_STATSD_COUNTER,
+			sample->messages - last->messages, 1.0, sample->name);
+	} else if (last->generation) {
+		ast_statsd_log_full_va("stasis.subscription.%s.dispatched", AST_STATSD_COUNTER,
+			sample->messages - last->messages, 1.0, sample->name);
+		ast_statsd_log_full_va("stasis.subscription.%s.queued", AST_STATSD_GAUGE,
+			sample->queued, 1.0, sample->name);
+		if (sample->samples != last->samples) {
+			/* The average of the samples taken since the previous interval */
+			ast_statsd_log_full_va("stasis.subscription.%s.latency", AST_STATSD_TIMER,
+				(sample->latency_sum - last->latency_sum) / 1000
+					/ (sample->samples - last->samples),
+				1.0, sample->name);
+		}
+	}
+
+	last->generation = generation;
+	last->messages = sample->messages;
+	last->samples = sample->samples;
+	last->latency_sum = sample->latency_sum;
+	ao2_ref(last, -1);
+}
+
+static int stats_last_forgotten(void *obj, void *arg, int flags)
+{
+	struct stats_last *last = obj;
+
+	return last->generation != generation ? CMP_MATCH : 0;
+}
+
+static int send_stats(const void *data)
+{
+	struct stats_samples samples;
+	int idx;
+
+	if (AST_VECTOR_INIT(&samples, 64)) {
+		return STATS_INTERVAL;
+	}
+
+	stasis_metrics_collect(topic_metrics_cb, subscription_metrics_cb, &samples);
+
+	if (!++generation) {
+		/* 0 is kept for what has not been sent yet */
+		generation = 1;
+	}
+	for (idx = 0; idx < AST_VECTOR_SIZE(&samples); ++idx) {
+		send_sample(AST_VECTOR_GET(&samples, idx));
+	}
+	ao2_callback(last_sent, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA,
+		stats_last_forgotten, NULL);
+
+	AST_VECTOR_CALLBACK_VOID(&samples, ast_free);
+	AST_VECTOR_FREE(&samples);
+
+	return STATS_INTERVAL;
+}
+
+static int unload_module(void)
+{
+	if (sched) {
+		ast_sched_context_destroy(sched);
+		sched = NULL;
+	}
+	ao2_cleanup(last_sent);
+	last_sent = NULL;
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	last_sent = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, STATS_BUCKETS,
+		stats_last_hash_fn, NULL, stats_last_cmp_fn);
+	if (!last_sent) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	sched = ast_sched_context_create();
+	if (!sched) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	if (ast_sched_start_thread(sched)
+		|| ast_sched_add_variable(sched, STATS_INTERVAL, send_stats, NULL, 1) < 0) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Stasis statistics",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.requires = "res_statsd"
+	);
@@ -58,6 +58,26 @@
 					you want to fake out a server using netcat
 					(nc -lu 8125)</synopsis>
 				</configOption>
+				<configOption name="flush_interval" default="0">
+					<synopsis>Milliseconds to gather metrics before sending them</synopsis>
+					<description>
+						<para>When 0, every metric is sent in a datagram of its
+						own as soon as it is logged. Otherwise metrics are
+						gathered and sent together, as many as fit in a
+						<literal>max_packet_size</literal> datagram, at least
+						once in this many milliseconds. Counters logged with a
+						sample rate of 1.0 are summed by name meanwhile, so each
+						is sent once per interval.</para>
+					</description>
+				</configOption>
+				<configOption name="max_packet_size" default="1432">
+					<synopsis>Most bytes to send in one datagram when metrics are gathered</synopsis>
+					<description>
+						<para>Should be kept below the MTU of the path to the
+						StatsD server, less the IP and UDP headers. Must be
+						between 64 and 8192.</para>
+					</description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -68,6 +88,7 @@
 #include "asterisk/config_options.h"
 #include "asterisk/module.h"
 #include "asterisk/netsock2.h"
+#include "asterisk/sched.h"
 
 #define AST_API_MODULE
 #include "asterisk/statsd.h"
@@ -76,9 +97,44 @@
 
 #define MAX_PREFIX 40
 
+/*! Largest configurable max_packet_size */
+#define MAX_PACKET_SIZE 8192
+
+#define COUNTER_BUCKETS 127
+
 /*! Socket for sending statd messages */
 static int socket_fd = -1;
 
+/*! \brief Schedules the flushes of gathered metrics */
+static struct ast_sched_context *sched;
+
+/*!
+ * \brief Protects the gathered metrics, and the flush schedule
+ *
+ * Holding it costs appending a metric to batch, or adding to a counter.
+ */
+AST_MUTEX_DEFINE_STATIC(batch_lock);
+
+/*! \brief Metrics gathered for the next datagram, separated by newlines */
+static char batch[MAX_PACKET_SIZE];
+
+/*! \brief Bytes used in batch */
+static size_t batch_len;
+
+/*! \brief Counters summed since the last flush, by prefixed name */
+static struct ao2_container *counters;
+
+/*! \brief The flush scheduled, -1 if none */
+static int flush_sched_id = -1;
+
+/*! \brief A counter summed since the last flush */
+struct statsd_counter {
+	/*! Sum of the values logged */
+	intmax_t value;
+	/*! Name of the metric, prefix included */
+	char name[0];
+};
+
 /*! \brief Global configuration options for statsd client. */
 struct conf_global_options {
 	/*! Enabled by default, disabled if false. */
@@ -89,6 +145,10 @@ struct conf_global_options {
 	struct ast_sockaddr statsd_server;
 	/*! Prefix to put on every stat. */
 	char prefix[MAX_PREFIX + 1];
+	/*! Milliseconds to gather metrics for, 0 to send each at once. */
+	unsigned int flush_interval;
+	/*! Most bytes to send in a datagram of gathered metrics. */
+	unsigned int max_packet_size;
 };
 
 /*! \brief All configuration options for statsd client. */
@@ -108,6 +168,151 @@ static void conf_server(const struct conf *cfg, struct ast_sockaddr *addr)
 	}
 }
 
+AO2_STRING_FIELD_HASH_FN(statsd_counter, name);
+AO2_STRING_FIELD_CMP_FN(statsd_counter, name);
+
+/*!
+ * \brief Send the gathered metrics
+ * \note Called with batch_lock held
+ */
+static void batch_send(const struct conf *cfg)
+{
+	struct ast_sockaddr statsd_server;
+
+	if (!batch_len) {
+		return;
+	}
+
+	if (socket_fd != -1) {
+		conf_server(cfg, &statsd_server);
+		ast_debug(6, "Sending %zu bytes of statistics to StatsD server\n", batch_len);
+		ast_sendto(socket_fd, batch, batch_len, 0, &statsd_server);
+	}
+	batch_len = 0;
+}
+
+/*!
+ * \brief Add a metric to the gathered ones, sending them first if it does not fit
+ * \note Called with batch_lock held
+ */
+static void batch_append(const struct conf *cfg, const char *msg, size_t len)
+{
+	size_t max = MIN(cfg->global->max_packet_size, sizeof(batch));
+	/* With add_newline every metric already ends with one */
+	int separator = !cfg->global->add_newline;
+
+	if (batch_len && batch_len + separator + len > max) {
+		batch_send(cfg);
+	}
+
+	if (len > max) {
+		struct ast_sockaddr statsd_server;
+
+		if (socket_fd != -1) {
+			conf_server(cfg, &statsd_server);
+			ast_sendto(socket_fd, msg, len, 0, &statsd_server);
+		}
+		return;
+	}
+
+	if (batch_len && separator) {
+		batch[batch_len++] = '\n';
+	}
+	memcpy(batch + batch_len, msg, len);
+	batch_len += len;
+}
+
+/*!
+ * \brief Add to a counter summed until the next flush
+ * \note Called with batch_lock held
+ *
+ * \retval 0 on success
+ * \retval -1 if the value is not an integer, or on allocation failure
+ */
+static int counter_add(const char *name, const char *value)
+{
+	struct statsd_counter *counter;
+	intmax_t sum;
+	char *end;
+
+	errno = 0;
+	sum = strtoimax(value, &end, 10);
+	if (errno || *end || end == value) {
+		return -1;
+	}
+
+	counter = ao2_find(counters, name, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!counter) {
+		size_t name_len = strlen(name) + 1;
+
+		counter = ao2_alloc_options(sizeof(*counter) + name_len, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!counter) {
+			return -1;
+		}
+		ast_copy_string(counter->name, name, name_len);
+		ao2_link_flags(counters, counter, OBJ_NOLOCK);
+	}
+	counter->value += sum;
+	ao2_ref(counter, -1);
+
+	return 0;
+}
+
+static int counter_flush_cb(void *obj, void *arg, int flags)
+{
+	struct statsd_counter *counter = obj;
+	const struct conf *cfg = arg;
+	char msg[MAX_PACKET_SIZE];
+	int len;
+
+	len = snprintf(msg, sizeof(msg), "%s:%jd|%s%s", counter->name, counter->value,
+		AST_STATSD_COUNTER, cfg->global->add_newline ? "\n" : "");
+	if (len > 0 && len < sizeof(msg)) {
+		batch_append(cfg, msg, len);
+	}
+
+	return CMP_MATCH;
+}
+
+/*! \brief Send the gathered metrics and counters */
+static void batch_flush(const struct conf *cfg)
+{
+	ast_mutex_lock(&batch_lock);
+	if (counters) {
+		ao2_callback(counters, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK,
+			counter_flush_cb, (void *) cfg);
+	}
+	batch_send(cfg);
+	ast_mutex_unlock(&batch_lock);
+}
+
+static int batch_flush_sched_cb(const void *data)
+{
+	struct conf *cfg = ao2_global_obj_ref(confs);
+	int interval = 0;
+
+	if (!cfg) {
+		return 0;
+	}
+
+	batch_flush(cfg);
+
+	ast_mutex_lock(&batch_lock);
+	if (socket_fd != -1 && cfg->global->flush_interval) {
+		interval = cfg->global->flush_interval;
+	} else {
+		flush_sched_id = -1;
+	}
+	ast_mutex_unlock(&batch_lock);
+
+	ao2_ref(cfg, -1);
+
+	return interval;
+}
+
+AST_THREADSTORAGE(statsd_msg_buf);
+
 void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	const char *metric_type, const char *value, double sample_rate)
 {
@@ -130,18 +335,36 @@ void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	}
 
 	cfg = ao2_global_obj_ref(confs);
-	conf_server(cfg, &statsd_server);
+	if (!cfg) {
+		return;
+	}
 
-	msg = ast_str_create(40);
+	msg = ast_str_thread_get(&statsd_msg_buf, 128);
 	if (!msg) {
-		ao2_cleanup(cfg);
+		ao2_ref(cfg, -1);
 		return;
 	}
+	ast_str_reset(msg);
 
 	if (!ast_strlen_zero(cfg->global->prefix)) {
 		ast_str_append(&msg, 0, "%s.", cfg->global->prefix);
 	}
 
+	if (cfg->global->flush_interval && sample_rate >= 1.0
+		&& !strcmp(metric_type, AST_STATSD_COUNTER)) {
+		int res;
+
+		ast_str_append(&msg, 0, "%s", metric_name);
+		ast_mutex_lock(&batch_lock);
+		res = counters ? counter_add(ast_str_buffer(msg), value) : -1;
+		ast_mutex_unlock(&batch_lock);
+		if (!res) {
+			ao2_ref(cfg, -1);
+			return;
+		}
+		ast_str_truncate(msg, -(ssize_t) strlen(metric_name));
+	}
+
 	ast_str_append(&msg, 0, "%s:%s|%s", metric_name, value, metric_type);
 
 	if (sample_rate < 1.0) {
@@ -154,11 +377,19 @@ void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 
 	len = ast_str_strlen(msg);
 
+	if (cfg->global->flush_interval) {
+		ast_mutex_lock(&batch_lock);
+		batch_append(cfg, ast_str_buffer(msg), len);
+		ast_mutex_unlock(&batch_lock);
+		ao2_ref(cfg, -1);
+		return;
+	}
+
+	conf_server(cfg, &statsd_server);
 	ast_debug(6, "Sending statistic %s to StatsD server\n", ast_str_buffer(msg));
 	ast_sendto(socket_fd, ast_str_buffer(msg), len, 0, &statsd_server);
 
-	ao2_cleanup(cfg);
-	ast_free(msg);
+	ao2_ref(cfg, -1);
 }
 
 void AST_OPTIONAL_API_NAME(ast_statsd_log_full)(const char *metric_name,
@@ -296,6 +527,7 @@ static int statsd_init(void)
 	RAII_VAR(struct conf *, cfg, ao2_global_obj_ref(confs), ao2_cleanup);
 	char *server;
 	struct ast_sockaddr statsd_server;
+	int scheduled;
 
 	ast_assert(is_enabled());
 
@@ -316,13 +548,39 @@ static int statsd_init(void)
 	ast_debug(3, "  StatsD server = %s.\n", server);
 	ast_debug(3, "  add newline = %s\n", AST_YESNO(cfg->global->add_newline));
 	ast_debug(3, "  prefix = %s\n", cfg->global->prefix);
+	ast_debug(3, "  flush interval = %u\n", cfg->global->flush_interval);
+	ast_debug(3, "  max packet size = %u\n", cfg->global->max_packet_size);
+
+	if (!cfg->global->flush_interval) {
+		/* Metrics gathered before a reload still go out */
+		batch_flush(cfg);
+		return 0;
+	}
+
+	ast_mutex_lock(&batch_lock);
+	if (flush_sched_id == -1) {
+		flush_sched_id = ast_sched_add_variable(sched, cfg->global->flush_interval,
+			batch_flush_sched_cb, NULL, 1);
+	}
+	scheduled = flush_sched_id != -1;
+	ast_mutex_unlock(&batch_lock);
+	if (!scheduled) {
+		ast_log(LOG_ERROR, "Failed to schedule the flush of StatsD metrics\n");
+		return -1;
+	}
 
 	return 0;
 }
 
 static void statsd_shutdown(void)
 {
+	struct conf *cfg = ao2_global_obj_ref(confs);
+
 	ast_debug(3, "Shutting down StatsD client.\n");
+	if (cfg) {
+		batch_flush(cfg);
+		ao2_ref(cfg, -1);
+	}
 	if (socket_fd != -1) {
 		close(socket_fd);
 		socket_fd = -1;
@@ -331,16 +589,35 @@ static void statsd_shutdown(void)
 
 static int unload_module(void)
 {
+	if (sched) {
+		ast_sched_context_destroy(sched);
+		sched = NULL;
+	}
+	flush_sched_id = -1;
 	statsd_shutdown();
 	aco_info_destroy(&cfg_info);
 	ao2_global_obj_release(confs);
+	ao2_cleanup(counters);
+	counters = NULL;
 	return 0;
 }
 
 static int load_module(void)
 {
+	counters = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, COUNTER_BUCKETS,
+		statsd_counter_hash_fn, NULL, statsd_counter_cmp_fn);
+	if (!counters) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	sched = ast_sched_context_create();
+	if (!sched || ast_sched_start_thread(sched)) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (aco_info_init(&cfg_info)) {
-		aco_info_destroy(&cfg_info);
+		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -360,20 +637,28 @@ static int load_module(void)
 		"", OPT_CHAR_ARRAY_T, 0,
 		CHARFLDSET(struct conf_global_options, prefix));
 
+	aco_option_register(&cfg_info, "flush_interval", ACO_EXACT, global_options,
+		"0", OPT_UINT_T, 0,
+		FLDSET(struct conf_global_options, flush_interval));
+
+	aco_option_register(&cfg_info, "max_packet_size", ACO_EXACT, global_options,
+		"1432", OPT_UINT_T, PARSE_IN_RANGE,
+		FLDSET(struct conf_global_options, max_packet_size), 64, MAX_PACKET_SIZE);
+
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		struct conf *cfg;
 
 		ast_log(LOG_NOTICE, "Could not load statsd config; using defaults\n");
 		cfg = conf_alloc();
 		if (!cfg) {
-			aco_info_destroy(&cfg_info);
+			unload_module();
 			return AST_MODULE_LOAD_DECLINE;
 		}
 
 		if (aco_set_defaults(&global_option, "general", cfg->global)) {
 			ast_log(LOG_ERROR, "Failed to initialize statsd defaults.\n");
 			ao2_ref(cfg, -1);
-			aco_info_destroy(&cfg_info);
+			unload_module();
 			return AST_MODULE_LOAD_DECLINE;
 		}
 
@@ -0,0 +1,551 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ *
+ * \brief Shared timerfd timing interface
+ *
+ * Rather than a kernel timer for every timer, as res_timing_timerfd has,
+ * a single timerfd is run by a thread for the timers of every rate. Timers
+ * of the same rate are kept in a group, and each group ticks on multiples
+ * of its interval of the monotonic clock, so that all the timers of a rate,
+ * and of rates whose intervals are multiples of each other, tick together
+ * on one wakeup of the thread. Each timer is signalled through an alert
+ * pipe, which is an eventfd where Asterisk has them.
+ */
+
+/*** MODULEINFO
+	<depend>timerfd</depend>
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <stdbool.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+
+#include "asterisk/module.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
+#include "asterisk/dlinkedlists.h"
+#include "asterisk/lock.h"
+#include "asterisk/logger.h"
+#include "asterisk/timing.h"
+#include "asterisk/utils.h"
+
+static void *timing_funcs_handle;
+
+static void *shared_timer_open(void);
+static void shared_timer_close(void *data);
+static int shared_timer_set_rate(void *data, unsigned int rate);
+static int shared_timer_ack(void *data, unsigned int quantity);
+static int shared_timer_enable_continuous(void *data);
+static int shared_timer_disable_continuous(void *data);
+static enum ast_timer_event shared_timer_get_event(void *data);
+static unsigned int shared_timer_get_max_rate(void *data);
+static int shared_timer_fd(void *data);
+
+static struct ast_timing_interface shared_timing = {
+	.name = "shared",
+	/* Below timerfd, so it is only used when res_timing_timerfd is not loaded */
+	.priority = 190,
+	.timer_open = shared_timer_open,
+	.timer_close = shared_timer_close,
+	.timer_set_rate = shared_timer_set_rate,
+	.timer_ack = shared_timer_ack,
+	.timer_enable_continuous = shared_timer_enable_continuous,
+	.timer_disable_continuous = shared_timer_disable_continuous,
+	.timer_get_event = shared_timer_get_event,
+	.timer_get_max_rate = shared_timer_get_max_rate,
+	.timer_fd = shared_timer_fd,
+};
+
+#define SHARED_MAX_RATE 1000
+
+#define NSEC_PER_SEC 1000000000ULL
+
+struct shared_timer_group;
+
+struct shared_timer {
+	int alertpipe[2];
+	/*! The group of the rate of the timer, NULL while it is not ticking */
+	struct shared_timer_group *group;
+	/*! Ticks not acknowledged yet */
+	unsigned int pending_ticks;
+	bool continuous:1;
+	bool signaled:1;
+	AST_DLLIST_ENTRY(shared_timer) list;
+};
+
+/*! \brief The timers ticking at a rate */
+struct shared_timer_group {
+	/*! Nanoseconds between ticks */
+	uint64_t interval;
+	/*! When the group ticks next, on the monotonic clock */
+	uint64_t next;
+	unsigned int count;
+	AST_DLLIST_HEAD_NOLOCK(, shared_timer) timers;
+	AST_LIST_ENTRY(shared_timer_group) list;
+};
+
+/*!
+ * \brief The groups of timers, and the thread ticking them
+ *
+ * The lock of the groups is held while a timer is ticked, so it is to be
+ * locked before the lock of a timer.
+ */
+static struct {
+	AST_LIST_HEAD_NOLOCK(, shared_timer_group) groups;
+	ast_mutex_t lock;
+	pthread_t thread;
+	/*! The single kernel timer, set to the next tick of any group */
+	int timerfd;
+	/*! Wakes the thread when a group with an earlier tick is added */
+	int wakeup[2];
+	unsigned int stop:1;
+} timing_thread = {
+	.thread = AST_PTHREADT_NULL,
+	.timerfd = -1,
+	.wakeup = { -1, -1 },
+};
+
+static uint64_t monotonic_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/*!
+ * \internal
+ * \pre timer is locked
+ */
+static void signal_timer(struct shared_timer *timer)
+{
+	if (timer->signaled) {
+		return;
+	}
+
+	if (ast_alertpipe_write(timer->alertpipe)) {
+		ast_log(LOG_ERROR, "Error signalling shared timer: %s\n", strerror(errno));
+	} else {
+		timer->signaled = true;
+	}
+}
+
+/*!
+ * \internal
+ * \pre timer is locked
+ */
+static void unsignal_timer(struct shared_timer *timer)
+{
+	if (!timer->signaled) {
+		return;
+	}
+
+	if (ast_alertpipe_read(timer->alertpipe) == AST_ALERT_READ_FAIL) {
+		ast_log(LOG_ERROR, "Error clearing shared timer: %s\n", strerror(errno));
+	} else {
+		timer->signaled = false;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Take a timer out of its group, removing the group when it empties
+ * \pre The groups are locked.
+ */
+static void group_remove_timer(struct shared_timer *timer)
+{
+	struct shared_timer_group *group = timer->group;
+
+	if (!group) {
+		return;
+	}
+
+	AST_DLLIST_REMOVE(&group->timers, timer, list);
+	timer->group = NULL;
+	if (!--group->count) {
+		AST_LIST_REMOVE(&timing_thread.groups, group, list);
+		ast_free(group);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Put a timer into the group of a rate, adding the group if there is none
+ * \pre The groups are locked.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int group_add_timer(struct shared_timer *timer, uint64_t interval)
+{
+	struct shared_timer_group *group;
+
+	AST_LIST_TRAVERSE(&timing_thread.groups, group, list) {
+		if (group->interval == interval) {
+			break;
+		}
+	}
+
+	if (!group) {
+		group = ast_calloc(1, sizeof(*group));
+		if (!group) {
+			return -1;
+		}
+		group->interval = interval;
+		/* Tick on multiples of the interval, so that groups of rates whose
+		 * intervals are multiples of each other tick together. */
+		group->next = (monotonic_now() / interval + 1) * interval;
+		AST_LIST_INSERT_TAIL(&timing_thread.groups, group, list);
+
+		/* The thread may be waiting for a later tick */
+		ast_alertpipe_write(timing_thread.wakeup);
+	}
+
+	AST_DLLIST_INSERT_TAIL(&group->timers, timer, list);
+	group->count++;
+	timer->group = group;
+
+	return 0;
+}
+
+static void shared_timer_destructor(void *obj)
+{
+	struct shared_timer *timer = obj;
+
+	ast_alertpipe_close(timer->alertpipe);
+}
+
+static void *shared_timer_open(void)
+{
+	struct shared_timer *timer;
+
+	if (!(timer = ao2_alloc(sizeof(*timer), shared_timer_destructor))) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (ast_alertpipe_init(timer->alertpipe)) {
+		ast_log(LOG_ERROR, "Failed to create shared timer: %s\n", strerror(errno));
+		ao2_ref(timer, -1);
+		return NULL;
+	}
+
+	return timer;
+}
+
+static void shared_timer_close(void *data)
+{
+	struct shared_timer *timer = data;
+
+	ast_mutex_lock(&timing_thread.lock);
+	group_remove_timer(timer);
+	ast_mutex_unlock(&timing_thread.lock);
+
+	ao2_ref(timer, -1);
+}
+
+static int shared_timer_set_rate(void *data, unsigned int rate)
+{
+	struct shared_timer *timer = data;
+	int res = 0;
+
+	if (rate > SHARED_MAX_RATE) {
+		ast_log(LOG_ERROR, "res_timing_shared only supports timers at a "
+				"max rate of %d / sec\n", SHARED_MAX_RATE);
+		errno = EINVAL;
+		return -1;
+	}
+
+	ast_mutex_lock(&timing_thread.lock);
+	ao2_lock(timer);
+	group_remove_timer(timer);
+	if (rate) {
+		res = group_add_timer(timer, NSEC_PER_SEC / rate);
+	}
+	ao2_unlock(timer);
+	ast_mutex_unlock(&timing_thread.lock);
+
+	return res;
+}
+
+static int shared_timer_ack(void *data, unsigned int quantity)
+{
+	struct shared_timer *timer = data;
+
+	ast_assert(quantity > 0);
+
+	ao2_lock(timer);
+	if (quantity > timer->pending_ticks) {
+		ast_debug(2, "Expected to acknowledge %u ticks but got %u instead\n", quantity, timer->pending_ticks);
+		quantity = timer->pending_ticks;
+	}
+	timer->pending_ticks -= quantity;
+	if (!timer->pending_ticks && !timer->continuous) {
+		unsignal_timer(timer);
+	}
+	ao2_unlock(timer);
+
+	return 0;
+}
+
+static int shared_timer_enable_continuous(void *data)
+{
+	struct shared_timer *timer = data;
+
+	ao2_lock(timer);
+	if (!timer->continuous) {
+		timer->continuous = true;
+		signal_timer(timer);
+	}
+	ao2_unlock(timer);
+
+	return 0;
+}
+
+static int shared_timer_disable_continuous(void *data)
+{
+	struct shared_timer *timer = data;
+
+	ao2_lock(timer);
+	if (timer->continuous) {
+		timer->continuous = false;
+		if (!timer->pending_ticks) {
+			unsignal_timer(timer);
+		}
+	}
+	ao2_unlock(timer);
+
+	return 0;
+}
+
+static enum ast_timer_event shared_timer_get_event(void *data)
+{
+	struct shared_timer *timer = data;
+	enum ast_timer_event res = AST_TIMING_EVENT_EXPIRED;
+
+	ao2_lock(timer);
+	if (timer->continuous) {
+		res = AST_TIMING_EVENT_CONTINUOUS;
+	}
+	ao2_unlock(timer);
+
+	return res;
+}
+
+static unsigned int shared_timer_get_max_rate(void *data)
+{
+	return SHARED_MAX_RATE;
+}
+
+static int shared_timer_fd(void *data)
+{
+	struct shared_timer *timer = data;
+
+	return ast_alertpipe_readfd(timer->alertpipe);
+}
+
+/*!
+ * \internal
+ * \brief Tick the groups due, and set the kernel timer to the next tick of any group
+ * \pre The groups are locked.
+ */
+static void run_groups(void)
+{
+	struct shared_timer_group *group;
+	struct shared_timer *timer;
+	struct itimerspec next_tick = { { 0, }, };
+	uint64_t now = monotonic_now();
+	uint64_t next = 0;
+
+	AST_LIST_TRAVERSE(&timing_thread.groups, group, list) {
+		if (group->next <= now) {
+			/* Ticks missed while the thread was late are made up for */
+			unsigned int ticks = (now - group->next) / group->interval + 1;
+
+			group->next += (uint64_t) ticks * group->interval;
+			AST_DLLIST_TRAVERSE(&group->timers, timer, list) {
+				ao2_lock(timer);
+				timer->pending_ticks += ticks;
+				signal_timer(timer);
+				ao2_unlock(timer);
+			}
+		}
+		if (!next || group->next < next) {
+			next = group->next;
+		}
+	}
+
+	/* A disarmed timer, with no groups, leaves the thread to wait for a wakeup */
+	next_tick.it_value.tv_sec = next / NSEC_PER_SEC;
+	next_tick.it_value.tv_nsec = next % NSEC_PER_SEC;
+	if (timerfd_settime(timing_thread.timerfd, TFD_TIMER_ABSTIME, &next_tick, NULL)) {
+		ast_log(LOG_ERROR, "Failed to set the shared timer: %s\n", strerror(errno));
+	}
+}
+
+static void *do_timing(void *arg)
+{
+	struct pollfd pfds[2] = {
+		{ .fd = timing_thread.timerfd, .events = POLLIN, },
+		{ .fd = ast_alertpipe_readfd(timing_thread.wakeup), .events = POLLIN, },
+	};
+	uint64_t expirations;
+
+	while (!timing_thread.stop) {
+		if (poll(pfds, ARRAY_LEN(pfds), -1) < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_ERROR, "Shared timing thread failed to poll: %s\n", strerror(errno));
+				break;
+			}
+			continue;
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			if (read(timing_thread.timerfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+				ast_log(LOG_ERROR, "Shared timing thread failed to read its timer: %s\n", strerror(errno));
+			}
+		}
+		if (pfds[1].revents & POLLIN) {
+			ast_alertpipe_read(timing_thread.wakeup);
+		}
+
+		ast_mutex_lock(&timing_thread.lock);
+		run_groups();
+		ast_mutex_unlock(&timing_thread.lock);
+	}
+
+	return NULL;
+}
+
+static char *handle_cli_timing_shared_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct shared_timer_group *group;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "timing shared show groups";
+		e->usage =
+			"Usage: timing shared show groups\n"
+			"       Shows the rates shared timers tick at, and the timers at each.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "%-12s %-12s %s\n", "Rate", "Interval", "Timers");
+	ast_mutex_lock(&timing_thread.lock);
+	AST_LIST_TRAVERSE(&timing_thread.groups, group, list) {
+		ast_cli(a->fd, "%-12" PRIu64 " %-12.3f %u\n", (uint64_t) (NSEC_PER_SEC / group->interval),
+			group->interval / 1000000.0, group->count);
+	}
+	ast_mutex_unlock(&timing_thread.lock);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_timing_shared[] = {
+	AST_CLI_DEFINE(handle_cli_timing_shared_show, "Show the groups of shared timers"),
+};
+
+static void stop_timing_thread(void)
+{
+	if (timing_thread.thread != AST_PTHREADT_NULL) {
+		timing_thread.stop = 1;
+		ast_alertpipe_write(timing_thread.wakeup);
+		pthread_join(timing_thread.thread, NULL);
+		timing_thread.thread = AST_PTHREADT_NULL;
+	}
+	ast_alertpipe_close(timing_thread.wakeup);
+	if (timing_thread.timerfd > -1) {
+		close(timing_thread.timerfd);
+		timing_thread.timerfd = -1;
+	}
+	ast_mutex_destroy(&timing_thread.lock);
+}
+
+static int init_timing_thread(void)
+{
+	ast_mutex_init(&timing_thread.lock);
+	timing_thread.stop = 0;
+
+	timing_thread.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if (timing_thread.timerfd < 0) {
+		ast_log(LOG_ERROR, "timerfd_create() not supported by the kernel.  Not loading.\n");
+		return -1;
+	}
+
+	if (ast_alertpipe_init(timing_thread.wakeup)) {
+		return -1;
+	}
+
+	if (ast_pthread_create_background(&timing_thread.thread, NULL, do_timing, NULL)) {
+		ast_log(LOG_ERROR, "Unable to start timing thread.\n");
+		timing_thread.thread = AST_PTHREADT_NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	if (init_timing_thread()) {
+		stop_timing_thread();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	if (!(timing_funcs_handle = ast_register_timing_interface(&shared_timing))) {
+		stop_timing_thread();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	ast_cli_register_multiple(cli_timing_shared, ARRAY_LEN(cli_timing_shared));
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+static int unload_module(void)
+{
+	int res;
+
+	if ((res = ast_unregister_timing_interface(timing_funcs_handle))) {
+		return res;
+	}
+
+	ast_cli_unregister_multiple(cli_timing_shared, ARRAY_LEN(cli_timing_shared));
+	stop_timing_thread();
+
+	return 0;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_LOAD_ORDER, "Shared timerfd Timing Interface",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.load_pri = AST_MODPRI_TIMING,
+);
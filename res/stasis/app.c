@@ -45,6 +45,7 @@
 int global_debug;
 
 static int unsubscribe(struct stasis_app *app, const char *kind, const char *id, int terminate);
+static int app_event_type_allowed(struct stasis_app *app, const char *type);
 
 struct stasis_app {
 	/*! Aggregation topic for this application. */
@@ -69,6 +70,8 @@ struct stasis_app {
 	struct ast_json *events_allowed;
 	/*! An array of disallowed events types for this application */
 	struct ast_json *events_disallowed;
+	/*! Fields kept of the objects in events, keyed by the event member holding them */
+	struct ast_json *event_fields;
 	/*! Name of the Stasis application */
 	char name[];
 };
@@ -312,6 +315,8 @@ static void app_dtor(void *obj)
 	app->events_allowed = NULL;
 	ast_json_unref(app->events_disallowed);
 	app->events_disallowed = NULL;
+	ast_json_unref(app->event_fields);
+	app->event_fields = NULL;
 
 }
 
@@ -367,19 +372,30 @@ static void sub_default_handler(void *data, struct stasis_subscription *sub,
 	ast_json_unref(json);
 }
 
-/*! \brief Typedef for callbacks that get called on channel snapshot updates */
+/*!
+ * \brief Typedef for callbacks that get called on channel snapshot updates
+ *
+ * Events the application filters out are not rendered at all.
+ */
 typedef struct ast_json *(*channel_snapshot_monitor)(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *old_snapshot,
 	struct ast_channel_snapshot *new_snapshot,
 	const struct timeval *tv);
 
 static struct ast_json *simple_channel_event(
+	struct stasis_app *app,
 	const char *type,
 	struct ast_channel_snapshot *snapshot,
 	const struct timeval *tv)
 {
-	struct ast_json *json_channel = ast_channel_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+	struct ast_json *json_channel;
+
+	if (!app_event_type_allowed(app, type)) {
+		return NULL;
+	}
 
+	json_channel = ast_channel_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
 	if (!json_channel) {
 		return NULL;
 	}
@@ -391,18 +407,25 @@ static struct ast_json *simple_channel_event(
 }
 
 static struct ast_json *channel_created_event(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *snapshot,
 	const struct timeval *tv)
 {
-	return simple_channel_event("ChannelCreated", snapshot, tv);
+	return simple_channel_event(app, "ChannelCreated", snapshot, tv);
 }
 
 static struct ast_json *channel_destroyed_event(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *snapshot,
 	const struct timeval *tv)
 {
-	struct ast_json *json_channel = ast_channel_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+	struct ast_json *json_channel;
+
+	if (!app_event_type_allowed(app, "ChannelDestroyed")) {
+		return NULL;
+	}
 
+	json_channel = ast_channel_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
 	if (!json_channel) {
 		return NULL;
 	}
@@ -416,14 +439,16 @@ static struct ast_json *channel_destroyed_event(
 }
 
 static struct ast_json *channel_state_change_event(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *snapshot,
 	const struct timeval *tv)
 {
-	return simple_channel_event("ChannelStateChange", snapshot, tv);
+	return simple_channel_event(app, "ChannelStateChange", snapshot, tv);
 }
 
 /*! \brief Handle channel state changes */
 static struct ast_json *channel_state(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *old_snapshot,
 	struct ast_channel_snapshot *new_snapshot,
 	const struct timeval *tv)
@@ -432,17 +457,18 @@ static struct ast_json *channel_state(
 		new_snapshot : old_snapshot;
 
 	if (!old_snapshot) {
-		return channel_created_event(snapshot, tv);
+		return channel_created_event(app, snapshot, tv);
 	} else if (ast_test_flag(&new_snapshot->flags, AST_FLAG_DEAD)) {
-		return channel_destroyed_event(snapshot, tv);
+		return channel_destroyed_event(app, snapshot, tv);
 	} else if (old_snapshot->state != new_snapshot->state) {
-		return channel_state_change_event(snapshot, tv);
+		return channel_state_change_event(app, snapshot, tv);
 	}
 
 	return NULL;
 }
 
 static struct ast_json *channel_dialplan(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *old_snapshot,
 	struct ast_channel_snapshot *new_snapshot,
 	const struct timeval *tv)
@@ -463,6 +489,10 @@ static struct ast_json *channel_dialplan(
 		return NULL;
 	}
 
+	if (!app_event_type_allowed(app, "ChannelDialplan")) {
+		return NULL;
+	}
+
 	json_channel = ast_channel_snapshot_to_json(new_snapshot, stasis_app_get_sanitizer());
 	if (!json_channel) {
 		return NULL;
@@ -477,6 +507,7 @@ static struct ast_json *channel_dialplan(
 }
 
 static struct ast_json *channel_callerid(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *old_snapshot,
 	struct ast_channel_snapshot *new_snapshot,
 	const struct timeval *tv)
@@ -492,6 +523,10 @@ static struct ast_json *channel_callerid(
 		return NULL;
 	}
 
+	if (!app_event_type_allowed(app, "ChannelCallerId")) {
+		return NULL;
+	}
+
 	json_channel = ast_channel_snapshot_to_json(new_snapshot, stasis_app_get_sanitizer());
 	if (!json_channel) {
 		return NULL;
@@ -507,6 +542,7 @@ static struct ast_json *channel_callerid(
 }
 
 static struct ast_json *channel_connected_line(
+	struct stasis_app *app,
 	struct ast_channel_snapshot *old_snapshot,
 	struct ast_channel_snapshot *new_snapshot,
 	const struct timeval *tv)
@@ -522,6 +558,10 @@ static struct ast_json *channel_connected_line(
 		return NULL;
 	}
 
+	if (!app_event_type_allowed(app, "ChannelConnectedLine")) {
+		return NULL;
+	}
+
 	json_channel = ast_channel_snapshot_to_json(new_snapshot, stasis_app_get_sanitizer());
 	if (!json_channel) {
 		return NULL;
@@ -551,7 +591,7 @@ static void sub_channel_update_handler(void *data,
 	for (i = 0; i < ARRAY_LEN(channel_monitors); ++i) {
 		struct ast_json *msg;
 
-		msg = channel_monitors[i](update->old_snapshot, update->new_snapshot,
+		msg = channel_monitors[i](app, update->old_snapshot, update->new_snapshot,
 			stasis_message_timestamp(message));
 		if (msg) {
 			app_send(app, msg);
@@ -565,12 +605,18 @@ static void sub_channel_update_handler(void *data,
 }
 
 static struct ast_json *simple_endpoint_event(
+	struct stasis_app *app,
 	const char *type,
 	struct ast_endpoint_snapshot *snapshot,
 	const struct timeval *tv)
 {
-	struct ast_json *json_endpoint = ast_endpoint_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+	struct ast_json *json_endpoint;
+
+	if (!app_event_type_allowed(app, type)) {
+		return NULL;
+	}
 
+	json_endpoint = ast_endpoint_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
 	if (!json_endpoint) {
 		return NULL;
 	}
@@ -649,7 +695,7 @@ static void sub_endpoint_update_handler(void *data,
 
 		tv = stasis_message_timestamp(update->new_snapshot);
 
-		json = simple_endpoint_event("EndpointStateChange", new_snapshot, tv);
+		json = simple_endpoint_event(app, "EndpointStateChange", new_snapshot, tv);
 		if (!json) {
 			return;
 		}
@@ -664,11 +710,18 @@ static void sub_endpoint_update_handler(void *data,
 }
 
 static struct ast_json *simple_bridge_event(
+	struct stasis_app *app,
 	const char *type,
 	struct ast_bridge_snapshot *snapshot,
 	const struct timeval *tv)
 {
-	struct ast_json *json_bridge = ast_bridge_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+	struct ast_json *json_bridge;
+
+	if (!app_event_type_allowed(app, type)) {
+		return NULL;
+	}
+
+	json_bridge = ast_bridge_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
 	if (!json_bridge) {
 		return NULL;
 	}
@@ -693,12 +746,12 @@ static void sub_bridge_update_handler(void *data,
 	tv = stasis_message_timestamp(message);
 
 	if (!update->new_snapshot) {
-		json = simple_bridge_event("BridgeDestroyed", update->old_snapshot, tv);
+		json = simple_bridge_event(app, "BridgeDestroyed", update->old_snapshot, tv);
 	} else if (!update->old_snapshot) {
-		json = simple_bridge_event("BridgeCreated", update->new_snapshot, tv);
+		json = simple_bridge_event(app, "BridgeCreated", update->new_snapshot, tv);
 	} else if (update->new_snapshot && update->old_snapshot
 		&& strcmp(update->new_snapshot->video_source_id, update->old_snapshot->video_source_id)) {
-		json = simple_bridge_event("BridgeVideoSourceChanged", update->new_snapshot, tv);
+		json = simple_bridge_event(app, "BridgeVideoSourceChanged", update->new_snapshot, tv);
 		if (json && !ast_strlen_zero(update->old_snapshot->video_source_id)) {
 			ast_json_object_set(json, "old_video_source_id",
 				ast_json_string_create(update->old_snapshot->video_source_id));
@@ -1633,6 +1686,9 @@ struct ast_json *stasis_app_event_filter_to_json(struct stasis_app *app, struct
 		ast_json_ref(app->events_allowed) : ast_json_array_create());
 	ast_json_object_set(json, "events_disallowed", app->events_disallowed ?
 		ast_json_ref(app->events_disallowed) : ast_json_array_create());
+	if (app->event_fields) {
+		ast_json_object_set(json, "event_fields", ast_json_ref(app->event_fields));
+	}
 
 	return json;
 }
@@ -1695,12 +1751,62 @@ static int app_events_disallowed_set(struct stasis_app *app, struct ast_json *fi
 	return app_event_filter_set(app, &app->events_disallowed, filter, "disallowed");
 }
 
+static int app_event_fields_set(struct stasis_app *app, struct ast_json *filter)
+{
+	struct ast_json *fields = NULL;
+	struct ast_json_iter *iter;
+
+	if (filter && ast_json_typeof(filter) == AST_JSON_OBJECT && ast_json_object_size(filter)) {
+		fields = ast_json_object_get(filter, "fields");
+		if (!fields) {
+			/* A filter type exists, but not this one, so don't update */
+			return 0;
+		}
+		if (ast_json_typeof(fields) != AST_JSON_OBJECT) {
+			ast_log(LOG_ERROR, "Invalid json type event fields - app: %s\n", app->name);
+			return -1;
+		}
+
+		/* Each member names the fields kept of the object it holds */
+		for (iter = ast_json_object_iter(fields); iter; iter = ast_json_object_iter_next(fields, iter)) {
+			struct ast_json *names = ast_json_object_iter_value(iter);
+			int i;
+
+			if (ast_json_typeof(names) != AST_JSON_ARRAY) {
+				ast_log(LOG_ERROR, "Event fields of '%s' must be an array - app: %s\n",
+					ast_json_object_iter_key(iter), app->name);
+				return -1;
+			}
+			for (i = 0; i < ast_json_array_size(names); ++i) {
+				if (ast_json_typeof(ast_json_array_get(names, i)) != AST_JSON_STRING) {
+					ast_log(LOG_ERROR, "Event fields of '%s' must be strings - app: %s\n",
+						ast_json_object_iter_key(iter), app->name);
+					return -1;
+				}
+			}
+		}
+
+		/* No members projects nothing */
+		if (!ast_json_object_size(fields)) {
+			fields = NULL;
+		}
+	}
+
+	ao2_lock(app);
+	ast_json_unref(app->event_fields);
+	app->event_fields = ast_json_ref(fields);
+	ao2_unlock(app);
+
+	return 0;
+}
+
 int stasis_app_event_filter_set(struct stasis_app *app, struct ast_json *filter)
 {
-	return app_events_disallowed_set(app, filter) || app_events_allowed_set(app, filter);
+	return app_events_disallowed_set(app, filter) || app_events_allowed_set(app, filter)
+		|| app_event_fields_set(app, filter);
 }
 
-static int app_event_filter_matched(struct ast_json *array, struct ast_json *event, int empty)
+static int app_event_filter_matched(struct ast_json *array, const char *type, int empty)
 {
 	struct ast_json *obj;
 	int i;
@@ -1712,8 +1818,7 @@ static int app_event_filter_matched(struct ast_json *array, struct ast_json *eve
 	for (i = 0; i < ast_json_array_size(array) &&
 			(obj = ast_json_array_get(array, i)); ++i) {
 
-		if (ast_strings_equal(ast_json_object_string_get(obj, "type"),
-				ast_json_object_string_get(event, "type"))) {
+		if (ast_strings_equal(ast_json_object_string_get(obj, "type"), type)) {
 			return 1;
 		}
 	}
@@ -1721,6 +1826,24 @@ static int app_event_filter_matched(struct ast_json *array, struct ast_json *eve
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Check the event type filter before an event is rendered
+ *
+ * \return True if events of this type are sent to the application
+ */
+static int app_event_type_allowed(struct stasis_app *app, const char *type)
+{
+	int res;
+
+	ao2_lock(app);
+	res = !app_event_filter_matched(app->events_disallowed, type, 0) &&
+		app_event_filter_matched(app->events_allowed, type, 1);
+	ao2_unlock(app);
+
+	return res;
+}
+
 int stasis_app_event_allowed(const char *app_name, struct ast_json *event)
 {
 	struct stasis_app *app = stasis_app_get_by_name(app_name);
@@ -1730,11 +1853,77 @@ int stasis_app_event_allowed(const char *app_name, struct ast_json *event)
 		return 0;
 	}
 
+	res = app_event_type_allowed(app, ast_json_object_string_get(event, "type"));
+	ao2_ref(app, -1);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Copy the listed fields of an object
+ */
+static struct ast_json *event_object_project(struct ast_json *object, struct ast_json *names)
+{
+	struct ast_json *projected = ast_json_object_create();
+	int i;
+
+	if (!projected) {
+		return NULL;
+	}
+
+	for (i = 0; i < ast_json_array_size(names); ++i) {
+		const char *name = ast_json_string_get(ast_json_array_get(names, i));
+		struct ast_json *value = ast_json_object_get(object, name);
+
+		if (value && ast_json_object_set(projected, name, ast_json_ref(value))) {
+			ast_json_unref(projected);
+			return NULL;
+		}
+	}
+
+	return projected;
+}
+
+struct ast_json *stasis_app_event_project(const char *app_name, struct ast_json *event)
+{
+	struct stasis_app *app = stasis_app_get_by_name(app_name);
+	struct ast_json *fields;
+	struct ast_json *projected;
+	struct ast_json_iter *iter;
+
+	if (!app) {
+		return ast_json_ref(event);
+	}
+
 	ao2_lock(app);
-	res = !app_event_filter_matched(app->events_disallowed, event, 0) &&
-		app_event_filter_matched(app->events_allowed, event, 1);
+	fields = ast_json_ref(app->event_fields);
 	ao2_unlock(app);
 	ao2_ref(app, -1);
 
-	return res;
+	if (!fields) {
+		return ast_json_ref(event);
+	}
+
+	/* The objects are shared with other applications, so the event is rebuilt
+	 * around trimmed copies rather than trimmed in place. */
+	projected = ast_json_object_create();
+	for (iter = ast_json_object_iter(event); projected && iter; iter = ast_json_object_iter_next(event, iter)) {
+		struct ast_json *value = ast_json_object_iter_value(iter);
+		struct ast_json *names = ast_json_object_get(fields, ast_json_object_iter_key(iter));
+
+		if (names && ast_json_typeof(value) == AST_JSON_OBJECT) {
+			value = event_object_project(value, names);
+		} else {
+			value = ast_json_ref(value);
+		}
+
+		if (!value || ast_json_object_set(projected, ast_json_object_iter_key(iter), value)) {
+			ast_json_unref(projected);
+			projected = NULL;
+		}
+	}
+	ast_json_unref(fields);
+
+	return projected;
 }
@@ -1496,18 +1496,30 @@ int control_dispatch_all(struct stasis_app_control *control,
 	struct ast_channel *chan)
 {
 	int count = 0;
-	struct ao2_iterator iter;
+	struct ao2_iterator *iter;
 	struct stasis_app_command *command;
 
 	ast_assert(control->channel == chan);
 
-	iter = ao2_iterator_init(control->command_queue, AO2_ITERATOR_UNLINK);
-	while ((command = ao2_iterator_next(&iter))) {
+	/* Called every time the channel is serviced, most often with nothing queued. */
+	if (!ao2_container_count(control->command_queue)) {
+		return 0;
+	}
+
+	/*
+	 * Take every queued command at once, so that a burst from the controller
+	 * is not contended with the queue lock command by command.
+	 */
+	iter = ao2_callback(control->command_queue, OBJ_MULTIPLE | OBJ_UNLINK, NULL, NULL);
+	if (!iter) {
+		return 0;
+	}
+	while ((command = ao2_iterator_next(iter))) {
 		command_invoke(command, control, chan);
 		ao2_ref(command, -1);
 		++count;
 	}
-	ao2_iterator_destroy(&iter);
+	ao2_iterator_destroy(iter);
 
 	return count;
 }
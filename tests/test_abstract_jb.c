@@ -22,8 +22,8 @@
  *
  * \author \verbatim Matt Jordan <mjordan@digium.com> \endverbatim
  *
- * Tests the abstract jitter buffer API.  This tests both adaptive and fixed
- * jitter buffers.  Functions defined in abstract_jb that are not part of the
+ * Tests the abstract jitter buffer API.  This tests the adaptive, fixed and
+ * ring jitter buffers.  Functions defined in abstract_jb that are not part of the
  * abstract jitter buffer API are not tested by this unit test.
  *
  * \ingroup tests
@@ -511,6 +511,96 @@ test_put_overflow(AST_JB_FIXED, "fixed", 12)
 
 test_put_out_of_order(AST_JB_FIXED, "fixed", DEFAULT_CONFIG_RESYNC_THRESHOLD)
 
+test_create_nominal(AST_JB_RING, "ring")
+
+test_put_first(AST_JB_RING, "ring")
+
+/*!
+ * \internal
+ * \brief The frames put into the ring jitter buffer tests, by sequence number
+ *
+ * Frames 1 and 2 swap places, as do frames 4 and 5, and frame 7 never arrives.
+ */
+static const int ring_put_order[] = { 0, 2, 1, 3, 5, 4, 6, 8, 9 };
+
+AST_TEST_DEFINE(TEST_NAME(AST_JB_RING, put_sequence))
+{
+	RAII_VAR(struct ast_jb *, jb, &default_jb, dispose_jitterbuffer);
+	const struct ast_jb_impl *impl;
+	struct ast_jb_conf conf;
+	RAII_VAR(struct ast_frame *, actual_frame, NULL, ast_frame_dtor);
+	RAII_VAR(struct ast_frame *, expected_frame, NULL, ast_frame_dtor);
+	int res;
+	long next;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = STRINGIFY_TESTNAME(TEST_NAME(AST_JB_RING, put_sequence));
+		info->category = "/main/abstract_jb/";
+		info->summary = "Test putting out of order and lost frames onto a ring jitterbuffer";
+		info->description =
+			"This tests that a ring jitterbuffer plays frames in the order of their "
+			"sequence numbers, interpolating in place of a lost one and dropping "
+			"it when it arrives too late.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	OBTAIN_JITTERBUFFER_IMPL(impl, AST_JB_RING, "ring");
+	MAKE_DEFAULT_CONFIG(&conf, impl);
+	jb->jbobj = impl->create(&conf);
+	jb->impl = impl;
+	if (!jb->jbobj) {
+		ast_test_status_update(test, "Error: Failed to create ring jitterbuffer\n");
+		return AST_TEST_FAIL;
+	}
+
+	for (i = 0; i < ARRAY_LEN(ring_put_order); i++) {
+		expected_frame = create_test_frame(1000 + ring_put_order[i] * DEFAULT_FRAME_MS,
+			ring_put_order[i]);
+		res = i ? jb->impl->put(jb->jbobj, expected_frame, 1100 + i * DEFAULT_FRAME_MS)
+			: jb->impl->put_first(jb->jbobj, expected_frame, 1100);
+		if (res != AST_JB_IMPL_OK) {
+			ast_test_status_update(test, "Error: On frame %d, got %d back from put (expected %d)\n",
+				ring_put_order[i], res, AST_JB_IMPL_OK);
+			return AST_TEST_FAIL;
+		}
+		expected_frame = NULL;
+	}
+
+	for (i = 0; i < 10; i++) {
+		next = jb->impl->next(jb->jbobj);
+		res = jb->impl->get(jb->jbobj, &actual_frame, next, DEFAULT_FRAME_MS);
+		if (i == 7) {
+			INT_TEST(res, AST_JB_IMPL_INTERP);
+			actual_frame = NULL;
+
+			/* The lost frame shows up once its time was filled by interpolation */
+			expected_frame = create_test_frame(1000 + i * DEFAULT_FRAME_MS, i);
+			res = jb->impl->put(jb->jbobj, expected_frame, next);
+			INT_TEST(res, AST_JB_IMPL_DROP);
+			ast_frfree(expected_frame);
+			expected_frame = NULL;
+			continue;
+		}
+		if (res != AST_JB_IMPL_OK) {
+			ast_test_status_update(test, "Error: failed to retrieve frame %d at %ld\n",
+				i, next);
+			return AST_TEST_FAIL;
+		}
+		expected_frame = create_test_frame(1000 + i * DEFAULT_FRAME_MS, i);
+		VERIFY_FRAME(actual_frame, expected_frame);
+		ast_frfree(actual_frame);
+		actual_frame = NULL;
+		ast_frfree(expected_frame);
+		expected_frame = NULL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_ADAPTIVE, create));
@@ -525,6 +615,10 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_FIXED, put_overflow));
 	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_FIXED, put_out_of_order));
 
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_RING, create));
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_RING, put_first));
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_RING, put_sequence));
+
 	return 0;
 }
 
@@ -542,6 +636,10 @@ static int load_module(void)
 	AST_TEST_REGISTER(TEST_NAME(AST_JB_FIXED, put_overflow));
 	AST_TEST_REGISTER(TEST_NAME(AST_JB_FIXED, put_out_of_order));
 
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_RING, create));
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_RING, put_first));
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_RING, put_sequence));
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
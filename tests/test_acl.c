@@ -433,10 +433,162 @@ acl_cleanup:
 	return res;
 }
 
+/*!
+ * \brief Find the sense a list of rules gives an address by walking it
+ *
+ * Each rule is applied on its own, as a list of one rule is never looked up in
+ * a tree, and the last rule matching the address decides.
+ */
+static int walk_ha(const struct acl *acl, size_t len, const struct ast_sockaddr *addr,
+	enum ast_acl_sense *sense)
+{
+	size_t i;
+
+	*sense = AST_SENSE_ALLOW;
+	for (i = 0; i < len; ++i) {
+		struct ast_ha *rule;
+		int err = 0;
+
+		if (!(rule = ast_append_ha("deny", acl[i].host, NULL, &err))) {
+			return -1;
+		}
+		if (ast_apply_ha(rule, addr) == AST_SENSE_DENY) {
+			*sense = strcasecmp(acl[i].access, "permit") ? AST_SENSE_DENY : AST_SENSE_ALLOW;
+		}
+		ast_free_ha(rule);
+	}
+
+	return 0;
+}
+
+AST_TEST_DEFINE(acl_tree)
+{
+	struct acl prefixes[] = {
+		{ "0.0.0.0/0", "deny" },
+		{ "10.0.0.0/8", "permit" },
+		{ "10.1.0.0/16", "deny" },
+		{ "10.1.2.0/24", "permit" },
+		{ "10.1.2.3/32", "deny" },
+		{ "192.168.0.0/16", "permit" },
+		{ "192.168.1.0/24", "deny" },
+		{ "192.168.0.0/16", "deny" },
+		{ "192.168.1.128/25", "permit" },
+		{ "172.16.0.0/12", "permit" },
+		{ "172.16.5.0/24", "deny" },
+		{ "::/0", "deny" },
+		{ "2001:db8::/32", "permit" },
+		{ "2001:db8:1::/48", "deny" },
+		{ "2001:db8:1:2::/64", "permit" },
+		{ "fe80::/10", "permit" },
+		{ "fe80::1/128", "deny" },
+		{ "::ffff:0:0/96", "permit" },
+	};
+
+	/* A netmask that is not a prefix makes the list be walked */
+	struct acl masks[ARRAY_LEN(prefixes) + 1] = {
+		{ "10.0.5.0/255.0.255.0", "permit" },
+	};
+
+	const char *addresses[] = {
+		"10.2.3.4",
+		"10.1.5.5",
+		"10.1.2.4",
+		"10.1.2.3",
+		"10.7.5.9",
+		"10.1.5.9",
+		"192.168.2.1",
+		"192.168.1.1",
+		"192.168.1.200",
+		"172.17.0.1",
+		"172.16.5.9",
+		"8.8.8.8",
+		"2001:db8::1",
+		"2001:db8:1::1",
+		"2001:db8:1:2::1",
+		"2001:dead::1",
+		"fe80::1",
+		"fe80::2",
+		"::1",
+		"::ffff:10.1.2.3",
+		"::ffff:10.7.5.9",
+		"::ffff:192.168.1.200",
+		"::ffff:8.8.8.8",
+	};
+
+	struct {
+		const char *name;
+		const struct acl *acl;
+		size_t len;
+	} lists[] = {
+		{ "prefixes", prefixes, ARRAY_LEN(prefixes) },
+		{ "masks", masks, ARRAY_LEN(masks) },
+	};
+
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "acl_tree";
+		info->category = "/main/acl/";
+		info->summary = "Long ACL unit test";
+		info->description =
+			"Tests that a list long enough to be looked up in a tree\n"
+			"permits and denies the same hosts as walking it does";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	memcpy(&masks[1], prefixes, sizeof(prefixes));
+
+	for (i = 0; i < ARRAY_LEN(lists); ++i) {
+		struct ast_ha *ha = NULL;
+		int err = 0;
+		int j;
+
+		ast_test_validate(test, lists[i].len >= 16);
+		if (build_ha(lists[i].acl, lists[i].len, &ha, lists[i].name, &err, test, &res) != 0) {
+			ast_free_ha(ha);
+			return res;
+		}
+
+		for (j = 0; j < ARRAY_LEN(addresses); ++j) {
+			struct ast_sockaddr addr;
+			enum ast_acl_sense expected;
+			int pass;
+
+			if (!ast_sockaddr_parse(&addr, addresses[j], PARSE_PORT_FORBID)
+				|| walk_ha(lists[i].acl, lists[i].len, &addr, &expected)) {
+				ast_test_status_update(test, "Failed to walk %s for %s\n",
+					lists[i].name, addresses[j]);
+				res = AST_TEST_FAIL;
+				continue;
+			}
+
+			/* Applying the list again uses the tree compiled the first time */
+			for (pass = 0; pass < 2; ++pass) {
+				enum ast_acl_sense sense = ast_apply_ha(ha, &addr);
+
+				if (sense != expected) {
+					ast_test_status_update(test, "Access not as expected to %s on %s. Expected %d but "
+						"got %d instead\n", addresses[j], lists[i].name, expected, sense);
+					res = AST_TEST_FAIL;
+				}
+			}
+		}
+
+		ast_free_ha(ha);
+	}
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(invalid_acl);
 	AST_TEST_UNREGISTER(acl);
+	AST_TEST_UNREGISTER(acl_tree);
 	return 0;
 }
 
@@ -444,6 +596,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(invalid_acl);
 	AST_TEST_REGISTER(acl);
+	AST_TEST_REGISTER(acl_tree);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -393,6 +393,44 @@ AST_TEST_DEFINE(invoke_wildcard)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(invoke_explicit)
+{
+	RAII_VAR(void *, fixture, NULL, tear_down_invocation_test);
+	RAII_VAR(struct ast_ari_response *, response, NULL, response_free);
+	RAII_VAR(struct ast_json *, expected, NULL, ast_json_unref);
+	struct ast_variable *get_params = NULL;
+	struct ast_variable *headers = NULL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = "/res/ari/";
+		info->summary = "Test GET of a resource next to a wildcard.";
+		info->description = "Test ARI binding logic.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	fixture = setup_invocation_test();
+	response = response_alloc();
+	/* The wildcard listed ahead of bang must neither match nor record a path variable */
+	expected = ast_json_pack("{s: s, s: {}, s: {}, s: {}}",
+				 "name", "bang_get",
+				 "get_params",
+				 "headers",
+				 "path_vars");
+
+	ast_ari_invoke(NULL, "foo/bang", AST_HTTP_GET, get_params, headers,
+		ast_json_null(), response);
+
+	ast_test_validate(test, 1 == invocation_count);
+	ast_test_validate(test, 200 == response->response_code);
+	ast_test_validate(test, ast_json_equal(expected, response->message));
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(invoke_delete)
 {
 	RAII_VAR(void *, fixture, NULL, tear_down_invocation_test);
@@ -548,6 +586,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(get_docs_hackerz);
 	AST_TEST_UNREGISTER(invoke_get);
 	AST_TEST_UNREGISTER(invoke_wildcard);
+	AST_TEST_UNREGISTER(invoke_explicit);
 	AST_TEST_UNREGISTER(invoke_delete);
 	AST_TEST_UNREGISTER(invoke_post);
 	AST_TEST_UNREGISTER(invoke_bad_post);
@@ -563,6 +602,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(get_docs_hackerz);
 	AST_TEST_REGISTER(invoke_get);
 	AST_TEST_REGISTER(invoke_wildcard);
+	AST_TEST_REGISTER(invoke_explicit);
 	AST_TEST_REGISTER(invoke_delete);
 	AST_TEST_REGISTER(invoke_post);
 	AST_TEST_REGISTER(invoke_bad_post);
@@ -54,6 +54,9 @@
 #define COUNT_SLEEP_US 500
 #define MAX_TEST_SECONDS 60
 
+#define LOOKUP_BENCH_THREADS 8
+#define LOOKUP_BENCH_LOOKUPS 200000
+
 struct hash_test {
 	/*! Unit under test */
 	struct ao2_container *to_be_thrashed;
@@ -244,7 +247,8 @@ static int compare_strings(void *lhs, void *rhs, int flags)
 	}
 }
 
-AST_TEST_DEFINE(hash_test)
+static enum ast_test_result_state hash_test_run(struct ast_test *test,
+	unsigned int container_options)
 {
 	enum ast_test_result_state res = AST_TEST_PASS;
 	struct hash_test data = {};
@@ -252,23 +256,12 @@ AST_TEST_DEFINE(hash_test)
 	void *thread_results;
 	int i;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "thrash";
-		info->category = "/main/astobj2/";
-		info->summary = "Testing astobj2 container concurrency";
-		info->description = "Test astobj2 container concurrency correctness.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
 	ast_test_status_update(test, "Executing hash concurrency test...\n");
 	data.preload = MAX_HASH_ENTRIES / 2;
 	data.max_grow = MAX_HASH_ENTRIES - data.preload;
 	data.deadline = ast_tvadd(ast_tvnow(), ast_tv(MAX_TEST_SECONDS, 0));
-	data.to_be_thrashed = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
-		HASH_BUCKETS, hash_string, NULL, compare_strings);
+	data.to_be_thrashed = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		container_options, HASH_BUCKETS, hash_string, NULL, compare_strings);
 
 	if (data.to_be_thrashed == NULL) {
 		ast_test_status_update(test, "Allocation failed\n");
@@ -344,15 +337,162 @@ AST_TEST_DEFINE(hash_test)
 	return res;
 }
 
+AST_TEST_DEFINE(hash_test)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing astobj2 container concurrency";
+		info->description = "Test astobj2 container concurrency correctness.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return hash_test_run(test, 0);
+}
+
+AST_TEST_DEFINE(hash_test_read_mostly)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash_read_mostly";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing read-mostly astobj2 container concurrency";
+		info->description = "Test read-mostly astobj2 container concurrency correctness.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return hash_test_run(test, AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY);
+}
+
+struct lookup_bench {
+	/*! Container to lookup objects in */
+	struct ao2_container *container;
+	/*! Number of objects in the container */
+	int entries;
+};
+
+/*! Lookup random objects in the container */
+static void *lookup_bench_thread(void *d)
+{
+	struct lookup_bench *data = d;
+	unsigned seed = (unsigned) (uintptr_t) &seed;
+	char key[12];
+	int i;
+
+	for (i = 0; i < LOOKUP_BENCH_LOOKUPS; ++i) {
+		char *from_ao2;
+
+		snprintf(key, sizeof(key), "key%08x", (unsigned) (rand_r(&seed) % data->entries));
+		from_ao2 = ao2_find(data->container, key, OBJ_SEARCH_KEY);
+		if (!from_ao2) {
+			return "Key unexpectedly missing";
+		}
+		ao2_ref(from_ao2, -1);
+	}
+
+	return NULL;
+}
+
+static int lookup_bench_run(struct ast_test *test, unsigned int container_options,
+	const char *label)
+{
+	struct lookup_bench data = {
+		.entries = MAX_HASH_ENTRIES,
+	};
+	pthread_t threads[LOOKUP_BENCH_THREADS];
+	void *thread_results;
+	struct timeval start;
+	int res = 0;
+	int i;
+
+	data.container = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		container_options, HASH_BUCKETS, hash_string, NULL, compare_strings);
+	if (!data.container) {
+		ast_test_status_update(test, "Allocation failed\n");
+		return -1;
+	}
+
+	for (i = 0; i < data.entries; ++i) {
+		char *ht = ht_new(i);
+
+		if (!ht) {
+			ast_test_status_update(test, "Allocation failed\n");
+			ao2_ref(data.container, -1);
+			return -1;
+		}
+		ao2_link(data.container, ht);
+		ao2_ref(ht, -1);
+	}
+
+	start = ast_tvnow();
+	for (i = 0; i < LOOKUP_BENCH_THREADS; ++i) {
+		ast_pthread_create(&threads[i], NULL, lookup_bench_thread, &data);
+	}
+	for (i = 0; i < LOOKUP_BENCH_THREADS; ++i) {
+		pthread_join(threads[i], &thread_results);
+		if (thread_results != NULL) {
+			ast_test_status_update(test, "Lookup thread failed: %s\n",
+				(char *)thread_results);
+			res = -1;
+		}
+	}
+	ast_test_status_update(test, "%s: %d threads x %d lookups in %" PRIi64 " ms\n",
+		label, LOOKUP_BENCH_THREADS, LOOKUP_BENCH_LOOKUPS, ast_tvdiff_ms(ast_tvnow(), start));
+
+	ao2_ref(data.container, -1);
+	return res;
+}
+
+AST_TEST_DEFINE(lookup_benchmark)
+{
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "lookup_benchmark";
+		info->category = "/main/astobj2/";
+		info->summary = "Benchmark concurrent astobj2 container lookups";
+		info->description =
+			"Compare concurrent ao2_find performance of a default\n"
+			"and a read-mostly hash container.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (lookup_bench_run(test, 0, "default")
+		|| lookup_bench_run(test, AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, "read-mostly")) {
+		res = AST_TEST_FAIL;
+	}
+
+	/* check for object leaks */
+	if (ast_atomic_fetchadd_int(&alloc_count, 0) != 0) {
+		ast_test_status_update(test, "Leaked %d objects!\n",
+			ast_atomic_fetchadd_int(&alloc_count, 0));
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(hash_test);
+	AST_TEST_UNREGISTER(hash_test_read_mostly);
+	AST_TEST_UNREGISTER(lookup_benchmark);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(hash_test);
+	AST_TEST_REGISTER(hash_test_read_mostly);
+	AST_TEST_REGISTER(lookup_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
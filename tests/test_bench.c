@@ -0,0 +1,490 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Benchmarks of core APIs
+ *
+ * Benchmarks of the APIs whose speed matters to every call, to be run
+ * with 'test bench run' before and after a change to them.
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/sched.h"
+#include "asterisk/translate.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/stasis.h"
+#include "asterisk/frame.h"
+#include "asterisk/lock.h"
+#include "asterisk/utils.h"
+#include "asterisk/strings.h"
+
+#define CATEGORY "/main/bench/"
+
+/*! \brief Operations done by an iteration of most of the benchmarks */
+#define BENCH_OPERATIONS 1000
+
+/*! \brief Subscribers a stasis message is fanned out to */
+#define BENCH_SUBSCRIBERS 10
+
+/*! \brief Counts down to a number of events which happen on other threads */
+struct bench_countdown {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	int remaining;
+};
+
+static struct bench_countdown *bench_countdown_alloc(void)
+{
+	struct bench_countdown *countdown = ast_calloc(1, sizeof(*countdown));
+
+	if (countdown) {
+		ast_mutex_init(&countdown->lock);
+		ast_cond_init(&countdown->cond, NULL);
+	}
+	return countdown;
+}
+
+static void bench_countdown_free(struct bench_countdown *countdown)
+{
+	if (countdown) {
+		ast_mutex_destroy(&countdown->lock);
+		ast_cond_destroy(&countdown->cond);
+		ast_free(countdown);
+	}
+}
+
+static void bench_countdown_set(struct bench_countdown *countdown, int remaining)
+{
+	ast_mutex_lock(&countdown->lock);
+	countdown->remaining = remaining;
+	ast_mutex_unlock(&countdown->lock);
+}
+
+static void bench_countdown_event(struct bench_countdown *countdown)
+{
+	ast_mutex_lock(&countdown->lock);
+	if (!--countdown->remaining) {
+		ast_cond_signal(&countdown->cond);
+	}
+	ast_mutex_unlock(&countdown->lock);
+}
+
+/*! \brief Wait for the events counted down, for at most 10 seconds */
+static int bench_countdown_wait(struct bench_countdown *countdown)
+{
+	struct timespec end = {
+		.tv_sec = ast_tvnow().tv_sec + 10,
+	};
+	int res = 0;
+
+	ast_mutex_lock(&countdown->lock);
+	while (countdown->remaining > 0 && !res) {
+		res = ast_cond_timedwait(&countdown->cond, &countdown->lock, &end);
+	}
+	res = countdown->remaining > 0 ? -1 : 0;
+	ast_mutex_unlock(&countdown->lock);
+
+	return res;
+}
+
+static int bench_str_hash_fn(const void *obj, const int flags)
+{
+	return ast_str_hash(obj);
+}
+
+static int bench_str_cmp_fn(void *obj, void *arg, int flags)
+{
+	return strcmp(obj, arg) ? 0 : CMP_MATCH | CMP_STOP;
+}
+
+AST_BENCH_DEFINE(bench_ao2_hash)
+{
+	struct ao2_container *container = ast_bench_get_data(bench);
+	int i;
+
+	switch (cmd) {
+	case BENCH_INIT:
+		info->name = "ao2_hash";
+		info->category = CATEGORY;
+		info->summary = "ao2 hash container link, find and unlink";
+		info->description = "Links objects into a hash container, finds each of them "
+			"by key and then unlinks them.";
+		info->operations = BENCH_OPERATIONS;
+		return 0;
+	case BENCH_SETUP:
+		container = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 257,
+			bench_str_hash_fn, NULL, bench_str_cmp_fn);
+		ast_bench_set_data(bench, container);
+		return container ? 0 : -1;
+	case BENCH_RUN:
+		for (i = 0; i < BENCH_OPERATIONS; ++i) {
+			char *obj = ao2_alloc_options(16, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+
+			if (!obj) {
+				return -1;
+			}
+			snprintf(obj, 16, "obj-%d", i);
+			ao2_link(container, obj);
+			ao2_ref(obj, -1);
+		}
+		for (i = 0; i < BENCH_OPERATIONS; ++i) {
+			char key[16];
+
+			snprintf(key, sizeof(key), "obj-%d", i);
+			ao2_find(container, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+		}
+		return 0;
+	case BENCH_CLEANUP:
+		ao2_cleanup(container);
+		return 0;
+	}
+	return 0;
+}
+
+static int bench_task(void *data)
+{
+	bench_countdown_event(data);
+	return 0;
+}
+
+/*! \brief What the taskprocessor benchmark uses */
+struct bench_tps {
+	struct ast_taskprocessor *tps;
+	struct bench_countdown *countdown;
+};
+
+AST_BENCH_DEFINE(bench_taskprocessor)
+{
+	struct bench_tps *fixture = ast_bench_get_data(bench);
+	int i;
+
+	switch (cmd) {
+	case BENCH_INIT:
+		info->name = "taskprocessor";
+		info->category = CATEGORY;
+		info->summary = "taskprocessor push and execution";
+		info->description = "Pushes tasks to a taskprocessor and waits for all of them "
+			"to be executed.";
+		info->operations = BENCH_OPERATIONS;
+		return 0;
+	case BENCH_SETUP:
+		fixture = ast_calloc(1, sizeof(*fixture));
+		if (!fixture) {
+			return -1;
+		}
+		ast_bench_set_data(bench, fixture);
+		fixture->tps = ast_taskprocessor_get("bench-taskprocessor", TPS_REF_DEFAULT);
+		fixture->countdown = bench_countdown_alloc();
+		return fixture->tps && fixture->countdown ? 0 : -1;
+	case BENCH_RUN:
+		bench_countdown_set(fixture->countdown, BENCH_OPERATIONS);
+		for (i = 0; i < BENCH_OPERATIONS; ++i) {
+			if (ast_taskprocessor_push(fixture->tps, bench_task, fixture->countdown)) {
+				/* Do not wait for what was not pushed */
+				bench_countdown_set(fixture->countdown, 0);
+				return -1;
+			}
+		}
+		return bench_countdown_wait(fixture->countdown);
+	case BENCH_CLEANUP:
+		if (fixture) {
+			ast_taskprocessor_unreference(fixture->tps);
+			bench_countdown_free(fixture->countdown);
+			ast_free(fixture);
+		}
+		return 0;
+	}
+	return 0;
+}
+
+static int bench_sched_cb(const void *data)
+{
+	return 0;
+}
+
+/*! \brief What the scheduler benchmark uses */
+struct bench_sched {
+	struct ast_sched_context *sched;
+	int ids[BENCH_OPERATIONS];
+};
+
+AST_BENCH_DEFINE(bench_sched)
+{
+	struct bench_sched *fixture = ast_bench_get_data(bench);
+	int i;
+
+	switch (cmd) {
+	case BENCH_INIT:
+		info->name = "sched";
+		info->category = CATEGORY;
+		info->summary = "scheduler add and delete";
+		info->description = "Adds entries to a scheduler context at random times, "
+			"and then deletes them.";
+		info->operations = BENCH_OPERATIONS;
+		return 0;
+	case BENCH_SETUP:
+		fixture = ast_calloc(1, sizeof(*fixture));
+		if (!fixture) {
+			return -1;
+		}
+		ast_bench_set_data(bench, fixture);
+		fixture->sched = ast_sched_context_create();
+		return fixture->sched ? 0 : -1;
+	case BENCH_RUN:
+		for (i = 0; i < BENCH_OPERATIONS; ++i) {
+			fixture->ids[i] = ast_sched_add(fixture->sched, 100000 + ast_random() % 100000,
+				bench_sched_cb, NULL);
+			if (fixture->ids[i] < 0) {
+				return -1;
+			}
+		}
+		for (i = 0; i < BENCH_OPERATIONS; ++i) {
+			AST_SCHED_DEL(fixture->sched, fixture->ids[i]);
+		}
+		return 0;
+	case BENCH_CLEANUP:
+		if (fixture) {
+			if (fixture->sched) {
+				ast_sched_context_destroy(fixture->sched);
+			}
+			ast_free(fixture);
+		}
+		return 0;
+	}
+	return 0;
+}
+
+/*! \brief Samples of each frame translated */
+#define BENCH_FRAME_SAMPLES 160
+
+/*! \brief Frames translated by an iteration of the translation benchmark */
+#define BENCH_FRAMES 50
+
+/*! \brief What the translation benchmark uses */
+struct bench_translate {
+	struct ast_trans_pvt *path;
+	int16_t samples[BENCH_FRAME_SAMPLES];
+};
+
+AST_BENCH_DEFINE(bench_translate)
+{
+	struct bench_translate *fixture = ast_bench_get_data(bench);
+	struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.samples = BENCH_FRAME_SAMPLES,
+		.datalen = sizeof(int16_t) * BENCH_FRAME_SAMPLES,
+		.src = "bench",
+	};
+	int i;
+
+	switch (cmd) {
+	case BENCH_INIT:
+		info->name = "translate";
+		info->category = CATEGORY;
+		info->summary = "translation of signed linear frames to ulaw";
+		info->description = "Translates frames of 20 ms of signed linear audio to ulaw, "
+			"along the path chosen by the translation core.";
+		info->operations = BENCH_FRAMES;
+		return 0;
+	case BENCH_SETUP:
+		fixture = ast_calloc(1, sizeof(*fixture));
+		if (!fixture) {
+			return -1;
+		}
+		ast_bench_set_data(bench, fixture);
+		for (i = 0; i < BENCH_FRAME_SAMPLES; ++i) {
+			fixture->samples[i] = (i % 40 - 20) * 1000;
+		}
+		fixture->path = ast_translator_build_path(ast_format_ulaw, ast_format_slin);
+		return fixture->path ? 0 : -1;
+	case BENCH_RUN:
+		f.subclass.format = ast_format_slin;
+		f.data.ptr = fixture->samples;
+		for (i = 0; i < BENCH_FRAMES; ++i) {
+			struct ast_frame *out = ast_translate(fixture->path, &f, 0);
+
+			if (out) {
+				ast_frfree(out);
+			}
+		}
+		return 0;
+	case BENCH_CLEANUP:
+		if (fixture) {
+			if (fixture->path) {
+				ast_translator_free_path(fixture->path);
+			}
+			ast_free(fixture);
+		}
+		return 0;
+	}
+	return 0;
+}
+
+/*! \brief Messages published by an iteration of the stasis benchmark */
+#define BENCH_MESSAGES 100
+
+/*! \brief What the stasis benchmark uses */
+struct bench_stasis {
+	struct stasis_topic *topic;
+	struct stasis_message_type *type;
+	struct stasis_subscription *subs[BENCH_SUBSCRIBERS];
+	struct bench_countdown *countdown;
+};
+
+static void bench_stasis_cb(void *data, struct stasis_subscription *sub, struct stasis_message *message)
+{
+	struct bench_stasis *fixture = data;
+
+	if (stasis_message_type(message) == fixture->type) {
+		bench_countdown_event(fixture->countdown);
+	}
+}
+
+AST_BENCH_DEFINE(bench_stasis)
+{
+	struct bench_stasis *fixture = ast_bench_get_data(bench);
+	int i;
+
+	switch (cmd) {
+	case BENCH_INIT:
+		info->name = "stasis_fanout";
+		info->category = CATEGORY;
+		info->summary = "stasis publish to many subscribers";
+		info->description = "Publishes messages to a topic with ten subscribers, and "
+			"waits for every subscriber to receive every message.";
+		info->operations = BENCH_MESSAGES;
+		return 0;
+	case BENCH_SETUP:
+		fixture = ast_calloc(1, sizeof(*fixture));
+		if (!fixture) {
+			return -1;
+		}
+		ast_bench_set_data(bench, fixture);
+		fixture->countdown = bench_countdown_alloc();
+		fixture->topic = stasis_topic_create("bench:stasis");
+		if (!fixture->countdown || !fixture->topic
+			|| stasis_message_type_create("BenchMessage", NULL, &fixture->type) != STASIS_MESSAGE_TYPE_SUCCESS) {
+			return -1;
+		}
+		for (i = 0; i < BENCH_SUBSCRIBERS; ++i) {
+			fixture->subs[i] = stasis_subscribe(fixture->topic, bench_stasis_cb, fixture);
+			if (!fixture->subs[i]) {
+				return -1;
+			}
+		}
+		return 0;
+	case BENCH_RUN:
+		bench_countdown_set(fixture->countdown, BENCH_MESSAGES * BENCH_SUBSCRIBERS);
+		for (i = 0; i < BENCH_MESSAGES; ++i) {
+			struct stasis_message *message = stasis_message_create(fixture->type, fixture->type);
+
+			if (!message) {
+				bench_countdown_set(fixture->countdown, 0);
+				return -1;
+			}
+			stasis_publish(fixture->topic, message);
+			ao2_ref(message, -1);
+		}
+		return bench_countdown_wait(fixture->countdown);
+	case BENCH_CLEANUP:
+		if (fixture) {
+			for (i = 0; i < BENCH_SUBSCRIBERS; ++i) {
+				stasis_unsubscribe_and_join(fixture->subs[i]);
+			}
+			ao2_cleanup(fixture->topic);
+			ao2_cleanup(fixture->type);
+			bench_countdown_free(fixture->countdown);
+			ast_free(fixture);
+		}
+		return 0;
+	}
+	return 0;
+}
+
+AST_BENCH_DEFINE(bench_frame)
+{
+	int16_t samples[BENCH_FRAME_SAMPLES] = { 0, };
+	struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.samples = BENCH_FRAME_SAMPLES,
+		.datalen = sizeof(samples),
+		.src = "bench",
+	};
+	int i;
+
+	switch (cmd) {
+	case BENCH_INIT:
+		info->name = "frame";
+		info->category = CATEGORY;
+		info->summary = "frame duplication and free";
+		info->description = "Duplicates a voice frame of 20 ms of signed linear audio "
+			"and frees the copy.";
+		info->operations = BENCH_OPERATIONS;
+		return 0;
+	case BENCH_SETUP:
+		return 0;
+	case BENCH_RUN:
+		f.subclass.format = ast_format_slin;
+		f.data.ptr = samples;
+		for (i = 0; i < BENCH_OPERATIONS; ++i) {
+			struct ast_frame *dup = ast_frdup(&f);
+
+			if (!dup) {
+				return -1;
+			}
+			ast_frfree(dup);
+		}
+		return 0;
+	case BENCH_CLEANUP:
+		return 0;
+	}
+	return 0;
+}
+
+static int unload_module(void)
+{
+	AST_BENCH_UNREGISTER(bench_ao2_hash);
+	AST_BENCH_UNREGISTER(bench_taskprocessor);
+	AST_BENCH_UNREGISTER(bench_sched);
+	AST_BENCH_UNREGISTER(bench_translate);
+	AST_BENCH_UNREGISTER(bench_stasis);
+	AST_BENCH_UNREGISTER(bench_frame);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_BENCH_REGISTER(bench_ao2_hash);
+	AST_BENCH_REGISTER(bench_taskprocessor);
+	AST_BENCH_REGISTER(bench_sched);
+	AST_BENCH_REGISTER(bench_translate);
+	AST_BENCH_REGISTER(bench_stasis);
+	AST_BENCH_REGISTER(bench_frame);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Core API benchmarks");
@@ -102,10 +102,90 @@ done:
 	return res;
 }
 
+#define STORAGE_CHANNELS 100
+
+AST_TEST_DEFINE(channel_storage)
+{
+	struct ast_channel *channels[STORAGE_CHANNELS] = { NULL, };
+	struct ast_channel_iterator *iter;
+	struct ast_channel *chan;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int found;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "channel_storage";
+		info->category = "/main/channel/";
+		info->summary = "channel storage lookup and iteration test";
+		info->description =
+			"Test that channels can be found by name, name prefix and uniqueid,\n"
+			"that iterating over all channels returns each channel once and\n"
+			"that a renamed channel can be found by its new name.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < STORAGE_CHANNELS; ++i) {
+		channels[i] = ast_channel_alloc(0, AST_STATE_DOWN, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0,
+			"TestStorage/%d", i);
+		ast_test_validate_cleanup(test, channels[i], res, done);
+		ast_channel_unlock(channels[i]);
+	}
+
+	for (i = 0; i < STORAGE_CHANNELS; ++i) {
+		chan = ast_channel_get_by_name(ast_channel_name(channels[i]));
+		ast_test_validate_cleanup(test, chan == channels[i], res, done);
+		ast_channel_unref(chan);
+
+		chan = ast_channel_get_by_name(ast_channel_uniqueid(channels[i]));
+		ast_test_validate_cleanup(test, chan == channels[i], res, done);
+		ast_channel_unref(chan);
+	}
+
+	found = 0;
+	iter = ast_channel_iterator_all_new();
+	ast_test_validate_cleanup(test, iter, res, done);
+	for (; (chan = ast_channel_iterator_next(iter)); ast_channel_unref(chan)) {
+		if (!strncmp(ast_channel_name(chan), "TestStorage/", 12)) {
+			++found;
+		}
+	}
+	ast_channel_iterator_destroy(iter);
+	ast_test_validate_cleanup(test, found == STORAGE_CHANNELS, res, done);
+
+	found = 0;
+	iter = ast_channel_iterator_by_name_new("TestStorage/", 12);
+	ast_test_validate_cleanup(test, iter, res, done);
+	for (; (chan = ast_channel_iterator_next(iter)); ast_channel_unref(chan)) {
+		++found;
+	}
+	ast_channel_iterator_destroy(iter);
+	ast_test_validate_cleanup(test, found == STORAGE_CHANNELS, res, done);
+
+	ast_change_name(channels[0], "TestStorage/renamed");
+	chan = ast_channel_get_by_name("TestStorage/renamed");
+	ast_test_validate_cleanup(test, chan == channels[0], res, done);
+	ast_channel_unref(chan);
+	chan = ast_channel_get_by_name("TestStorage/0");
+	ast_test_validate_cleanup(test, !chan, res, done);
+
+done:
+	for (i = 0; i < STORAGE_CHANNELS; ++i) {
+		if (channels[i]) {
+			ast_hangup(channels[i]);
+		}
+	}
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(set_fd_grow);
 	AST_TEST_UNREGISTER(add_fd);
+	AST_TEST_UNREGISTER(channel_storage);
 	return 0;
 }
 
@@ -113,6 +193,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(set_fd_grow);
 	AST_TEST_REGISTER(add_fd);
+	AST_TEST_REGISTER(channel_storage);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
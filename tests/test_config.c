@@ -1044,6 +1044,74 @@ out:
 	return res;
 }
 
+AST_TEST_DEFINE(config_snapshot)
+{
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	int config_snapshots = ast_option_config_snapshots;
+	char filename[PATH_MAX];
+	FILE *config_file;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "config_snapshot";
+		info->category = "/main/config/";
+		info->summary = "Test config snapshots";
+		info->description =
+			"Ensure that a config loaded from its snapshot is the same as parsed, "
+			"and that changing the file is seen.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_option_config_snapshots = 1;
+	write_config_file();
+
+	/* The first load parses the file and keeps the snapshot, the second uses it */
+	cfg = ast_config_load(CONFIG_FILE, config_flags);
+	if (!cfg || test_config_validity(cfg)) {
+		ast_test_status_update(test, "Parsed config is not what was written.\n");
+		goto out;
+	}
+	ast_config_destroy(cfg);
+
+	cfg = ast_config_load(CONFIG_FILE, config_flags);
+	if (!cfg || test_config_validity(cfg)) {
+		ast_test_status_update(test, "Config from the snapshot is not what was written.\n");
+		goto out;
+	}
+	ast_config_destroy(cfg);
+
+	snprintf(filename, sizeof(filename), "%s/%s", ast_config_AST_CONFIG_DIR, CONFIG_FILE);
+	config_file = fopen(filename, "a");
+	if (!config_file) {
+		ast_test_status_update(test, "Unable to change the config file.\n");
+		cfg = NULL;
+		goto out;
+	}
+	fprintf(config_file, "[snapshot]\nadded = yes\n");
+	fclose(config_file);
+
+	cfg = ast_config_load(CONFIG_FILE, config_flags);
+	if (!cfg || test_config_validity(cfg)
+		|| !ast_true(ast_variable_retrieve(cfg, "snapshot", "added"))) {
+		ast_test_status_update(test, "Change to the config file was not seen.\n");
+		goto out;
+	}
+
+	res = AST_TEST_PASS;
+
+out:
+	if (cfg) {
+		ast_config_destroy(cfg);
+	}
+	ast_option_config_snapshots = config_snapshots;
+	delete_config_file();
+	return res;
+}
+
 enum {
 	EXPECT_FAIL = 0,
 	EXPECT_SUCCEED,
@@ -1901,6 +1969,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(config_template_ops);
 	AST_TEST_UNREGISTER(copy_config);
 	AST_TEST_UNREGISTER(config_hook);
+	AST_TEST_UNREGISTER(config_snapshot);
 	AST_TEST_UNREGISTER(ast_parse_arg_test);
 	AST_TEST_UNREGISTER(config_options_test);
 	AST_TEST_UNREGISTER(config_dialplan_function);
@@ -1916,6 +1985,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(config_template_ops);
 	AST_TEST_REGISTER(copy_config);
 	AST_TEST_REGISTER(config_hook);
+	AST_TEST_REGISTER(config_snapshot);
 	AST_TEST_REGISTER(ast_parse_arg_test);
 	AST_TEST_REGISTER(config_options_test);
 	AST_TEST_REGISTER(config_dialplan_function);
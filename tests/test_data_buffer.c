@@ -324,12 +324,71 @@ AST_TEST_DEFINE(buffer_nominal)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(buffer_pooled_payloads)
+{
+	RAII_VAR(struct ast_data_buffer *, buffer, NULL, ast_data_buffer_free_wrapper);
+	static const size_t sizes[] = { 1, 172, 332, 1292, 1500, 1984, 1985, 8000 };
+	unsigned char *payload;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "buffer_pooled_payloads";
+		info->category = "/main/data_buffer/";
+		info->summary = "buffer pooled payload unit test";
+		info->description =
+			"Test that pooled payloads of all sizes can be stored in and released by the buffer";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	buffer = ast_data_buffer_alloc(ast_data_buffer_payload_free, ARRAY_LEN(sizes) / 2);
+
+	ast_test_validate(test, buffer != NULL,
+			"Failed to create buffer with valid arguments");
+
+	/* Filling past the maximum releases the oldest payloads through the pool */
+	for (i = 0; i < ARRAY_LEN(sizes); ++i) {
+		payload = ast_data_buffer_payload_alloc(sizes[i]);
+
+		ast_test_validate(test, payload != NULL,
+				"Failed to allocate pooled payload of %zu bytes", sizes[i]);
+
+		memset(payload, i, sizes[i]);
+		ast_test_validate(test, ast_data_buffer_put(buffer, i, payload) == 0,
+				"Adding a pooled payload to the buffer failed");
+	}
+
+	for (i = ARRAY_LEN(sizes) / 2; i < ARRAY_LEN(sizes); ++i) {
+		payload = ast_data_buffer_get(buffer, i);
+
+		ast_test_validate(test, payload != NULL,
+				"Failed to get pooled payload at position %d", i);
+		ast_test_validate(test, payload[0] == i && payload[sizes[i] - 1] == i,
+				"Pooled payload at position %d does not hold the expected data", i);
+	}
+
+	/* Payloads removed from the buffer are released by the caller */
+	payload = ast_data_buffer_remove_head(buffer);
+
+	ast_test_validate(test, payload != NULL,
+			"Failed to remove the oldest pooled payload");
+	ast_test_validate(test, payload[0] == ARRAY_LEN(sizes) / 2,
+			"Removing the oldest pooled payload did not return the expected payload");
+
+	ast_data_buffer_payload_free(payload);
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(buffer_create);
 	AST_TEST_UNREGISTER(buffer_put);
 	AST_TEST_UNREGISTER(buffer_resize);
 	AST_TEST_UNREGISTER(buffer_nominal);
+	AST_TEST_UNREGISTER(buffer_pooled_payloads);
 	return 0;
 }
 
@@ -339,6 +398,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(buffer_put);
 	AST_TEST_REGISTER(buffer_resize);
 	AST_TEST_REGISTER(buffer_nominal);
+	AST_TEST_REGISTER(buffer_pooled_payloads);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
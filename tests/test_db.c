@@ -204,6 +204,132 @@ AST_TEST_DEFINE(gettree_deltree)
 	return res;
 }
 
+AST_TEST_DEFINE(put_del_pending)
+{
+	int res = AST_TEST_PASS;
+	struct ast_db_entry *dbes;
+	struct ast_db_entry *cur;
+	char buf[16];
+	int count = 0;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "put_del_pending";
+		info->category = "/main/astdb/";
+		info->summary = "ast_db write-behind unit test";
+		info->description =
+			"Ensures that changes not yet written to the database are\n"
+			"seen by reads and tree operations";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* Several changes to a key before the sync thread writes them */
+	ast_test_validate(test, !ast_db_put("astdbtest", "pending", "1"));
+	ast_test_validate(test, !ast_db_put("astdbtest", "pending", "2"));
+	ast_test_validate(test, !ast_db_get("astdbtest", "pending", buf, sizeof(buf)));
+	ast_test_validate(test, !strcmp(buf, "2"));
+
+	ast_test_validate(test, !ast_db_del("astdbtest", "pending"));
+	ast_test_validate(test, ast_db_get("astdbtest", "pending", buf, sizeof(buf)));
+
+	ast_test_validate(test, !ast_db_put("astdbtest", "pending", "3"));
+	ast_test_validate(test, !ast_db_put("astdbtest", "other", "4"));
+	dbes = ast_db_gettree("astdbtest", NULL);
+	for (cur = dbes; cur; cur = cur->next) {
+		if (!strcmp(cur->key, "/astdbtest/pending")) {
+			if (strcmp(cur->data, "3")) {
+				ast_test_status_update(test, "Tree has value '%s' instead of '3'\n", cur->data);
+				res = AST_TEST_FAIL;
+			}
+			++count;
+		} else if (!strcmp(cur->key, "/astdbtest/other")) {
+			++count;
+		}
+	}
+	ast_db_freetree(dbes);
+	if (count != 2) {
+		ast_test_status_update(test, "Tree has %d of the 2 keys put\n", count);
+		res = AST_TEST_FAIL;
+	}
+
+	if (ast_db_deltree("astdbtest", NULL) != 2) {
+		ast_test_status_update(test, "Failed to delete the 2 keys put\n");
+		res = AST_TEST_FAIL;
+	}
+	ast_test_validate(test, ast_db_get("astdbtest", "other", buf, sizeof(buf)));
+
+	return res;
+}
+
+AST_TEST_DEFINE(gettree_boundary)
+{
+	int res = AST_TEST_PASS;
+	struct ast_db_entry *dbes;
+	struct ast_db_entry *cur;
+	const char *prev = "";
+	int count;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "gettree_boundary";
+		info->category = "/main/astdb/";
+		info->summary = "ast_db key tree boundary unit test";
+		info->description =
+			"Ensures that a key tree only holds the keys below it, that\n"
+			"a key prefix matches the keys extending it, and that trees\n"
+			"are returned in key order";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_validate(test, !ast_db_put("astdbtest", "tree/2", "a"));
+	ast_test_validate(test, !ast_db_put("astdbtest", "tree/1", "b"));
+	ast_test_validate(test, !ast_db_put("astdbtest", "tree", "c"));
+	ast_test_validate(test, !ast_db_put("astdbtest", "treetop", "d"));
+	ast_test_validate(test, !ast_db_put("astdbtestx", "tree", "e"));
+
+	count = 0;
+	dbes = ast_db_gettree("astdbtest", "tree");
+	for (cur = dbes; cur; cur = cur->next) {
+		if (strcmp(prev, cur->key) >= 0 || !strcmp(cur->key, "/astdbtest/treetop")) {
+			ast_test_status_update(test, "Unexpected key '%s' in the tree\n", cur->key);
+			res = AST_TEST_FAIL;
+		}
+		prev = cur->key;
+		++count;
+	}
+	ast_db_freetree(dbes);
+	if (count != 3) {
+		ast_test_status_update(test, "Tree has %d keys instead of 3\n", count);
+		res = AST_TEST_FAIL;
+	}
+
+	count = 0;
+	dbes = ast_db_gettree_by_prefix("astdbtest", "tree");
+	for (cur = dbes; cur; cur = cur->next) {
+		++count;
+	}
+	ast_db_freetree(dbes);
+	if (count != 3) {
+		ast_test_status_update(test, "Prefix matched %d keys instead of 3\n", count);
+		res = AST_TEST_FAIL;
+	}
+
+	if (ast_db_deltree("astdbtest", NULL) != 4) {
+		ast_test_status_update(test, "Failed to delete only the 4 keys in the family\n");
+		res = AST_TEST_FAIL;
+	}
+	if (ast_db_deltree("astdbtestx", NULL) != 1) {
+		ast_test_status_update(test, "Deleting a family deleted a family it prefixes\n");
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
 AST_TEST_DEFINE(perftest)
 {
 	int res = AST_TEST_PASS;
@@ -294,6 +420,8 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(gettree_deltree);
 	AST_TEST_UNREGISTER(perftest);
 	AST_TEST_UNREGISTER(put_get_long);
+	AST_TEST_UNREGISTER(put_del_pending);
+	AST_TEST_UNREGISTER(gettree_boundary);
 	return 0;
 }
 
@@ -303,6 +431,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(gettree_deltree);
 	AST_TEST_REGISTER(perftest);
 	AST_TEST_REGISTER(put_get_long);
+	AST_TEST_REGISTER(put_del_pending);
+	AST_TEST_REGISTER(gettree_boundary);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
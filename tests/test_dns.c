@@ -31,6 +31,7 @@
 #include "asterisk/dns_core.h"
 #include "asterisk/dns_resolver.h"
 #include "asterisk/dns_internal.h"
+#include "asterisk/dns_test.h"
 
 /* Used when a stub is needed for certain tests */
 static int stub_resolve(struct ast_dns_query *query)
@@ -1296,6 +1297,385 @@ cleanup:
 	return res;
 }
 
+/*!
+ * \brief Data for the mock resolver of the cache tests
+ *
+ * The answer this resolver gives is set by each test, and it counts how often
+ * it has been asked, so that the tests can tell when the cache answered.
+ */
+static struct cache_resolver_data {
+	/*! The number of times the resolver's resolve() method has been called */
+	int resolves;
+	/*! True if the resolver's cancel() method has been called */
+	int canceled;
+	/*! The rcode of the answer */
+	unsigned int rcode;
+	/*! The TTL of the single A record of the answer, 0 for an answer without records */
+	int ttl;
+} cache_resolver_data;
+
+/*!
+ * \brief Thread spawned by the mock resolver of the cache tests
+ *
+ * This thread immediately completes the query with the answer set by the test.
+ *
+ * \param dns_query The ast_dns_query that is being resolved
+ * \return NULL
+ */
+static void *cache_resolution_thread(void *dns_query)
+{
+	struct ast_dns_query *query = dns_query;
+	struct in_addr v4;
+
+	ast_dns_resolver_set_result(query, 0, 0, cache_resolver_data.rcode, "asterisk.org",
+		DNS_ANSWER, DNS_ANSWER_SIZE);
+	if (cache_resolver_data.ttl) {
+		inet_pton(AF_INET, "127.0.0.1", &v4);
+		ast_dns_resolver_add_record(query, T_A, C_IN, cache_resolver_data.ttl,
+			(const char *) &v4, sizeof(v4));
+	}
+	ast_dns_resolver_completed(query);
+
+	ao2_ref(query, -1);
+	return NULL;
+}
+
+static int cache_resolve(struct ast_dns_query *query)
+{
+	pthread_t resolver_thread;
+
+	ast_atomic_fetchadd_int(&cache_resolver_data.resolves, +1);
+	return ast_pthread_create_detached(&resolver_thread, NULL, cache_resolution_thread, ao2_bump(query));
+}
+
+static int cache_cancel(struct ast_dns_query *query)
+{
+	cache_resolver_data.canceled = 1;
+	return 0;
+}
+
+static struct ast_dns_resolver cache_resolver = {
+	.name = "cache",
+	.priority = 0,
+	.resolve = cache_resolve,
+	.cancel = cache_cancel,
+};
+
+/*!
+ * \brief Register the mock resolver of the cache tests, with an empty cache
+ *
+ * \param rcode The rcode of the answers it gives
+ * \param ttl The TTL of the record of the answers it gives, 0 for none
+ */
+static int cache_resolver_register(unsigned int rcode, int ttl)
+{
+	cache_resolver_data.resolves = 0;
+	cache_resolver_data.canceled = 0;
+	cache_resolver_data.rcode = rcode;
+	cache_resolver_data.ttl = ttl;
+
+	/* Registering a resolver empties the cache */
+	return ast_dns_resolver_register(&cache_resolver);
+}
+
+/*!
+ * \brief Resolve synchronously and check the answer
+ *
+ * \param test The test
+ * \param resolves How many times the resolver is expected to have been asked afterwards
+ * \param rcode The rcode the answer is expected to have
+ * \param ttl The TTL its record is expected to have at most, 0 for no records
+ */
+static int cache_resolve_check(struct ast_test *test, int resolves, unsigned int rcode, int ttl)
+{
+	struct ast_dns_result *result = NULL;
+	const struct ast_dns_record *record;
+	int res = 0;
+
+	if (ast_dns_resolve("asterisk.org", T_A, C_IN, &result) || !result) {
+		ast_test_status_update(test, "Resolution of address failed\n");
+		return -1;
+	}
+
+	record = ast_dns_result_get_records(result);
+	if (cache_resolver_data.resolves != resolves) {
+		ast_test_status_update(test, "Resolver was asked %d times rather than %d\n",
+			cache_resolver_data.resolves, resolves);
+		res = -1;
+	} else if (ast_dns_result_get_rcode(result) != rcode) {
+		ast_test_status_update(test, "Answer had rcode %u rather than %u\n",
+			ast_dns_result_get_rcode(result), rcode);
+		res = -1;
+	} else if (!ttl && record) {
+		ast_test_status_update(test, "Answer without records had a record\n");
+		res = -1;
+	} else if (ttl && (!record || ast_dns_record_get_ttl(record) < 1
+		|| ast_dns_record_get_ttl(record) > ttl)) {
+		ast_test_status_update(test, "Answer did not have a record with a TTL of at most %d\n", ttl);
+		res = -1;
+	}
+
+	ast_dns_result_free(result);
+	return res;
+}
+
+AST_TEST_DEFINE(resolver_cache_ttl)
+{
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "resolver_cache_ttl";
+		info->category = "/main/dns/";
+		info->summary = "Test DNS answers being cached for their TTL";
+		info->description =
+			"This test resolves a domain twice, and ensures that the second time it is\n"
+			"answered from the cache rather than by the resolver. It then ages the cache\n"
+			"well past the TTL of the answer, and ensures that the resolver is asked again.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (cache_resolver_register(NOERROR, 60)) {
+		ast_test_status_update(test, "Unable to register cache resolver\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (cache_resolve_check(test, 1, NOERROR, 60)) {
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (cache_resolve_check(test, 1, NOERROR, 60)) {
+		ast_test_status_update(test, "Fresh answer was not given from the cache\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	ast_dns_test_cache_age(3600);
+
+	if (cache_resolve_check(test, 2, NOERROR, 60)) {
+		ast_test_status_update(test, "Expired answer was given from the cache\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+cleanup:
+	ast_dns_resolver_unregister(&cache_resolver);
+	return res;
+}
+
+AST_TEST_DEFINE(resolver_cache_negative)
+{
+	struct {
+		const char *name;
+		unsigned int rcode;
+	} answers[] = {
+		{ "name that does not exist", NXDOMAIN },
+		{ "name without records", NOERROR },
+	};
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "resolver_cache_negative";
+		info->category = "/main/dns/";
+		info->summary = "Test DNS answers without records being cached";
+		info->description =
+			"This test resolves a domain that does not exist, and one without records,\n"
+			"twice each, and ensures that the second time it is answered from the cache.\n"
+			"It then ages the cache, and ensures that the resolver is asked again.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(answers); ++i) {
+		if (cache_resolver_register(answers[i].rcode, 0)) {
+			ast_test_status_update(test, "Unable to register cache resolver\n");
+			return AST_TEST_FAIL;
+		}
+
+		if (cache_resolve_check(test, 1, answers[i].rcode, 0)
+			|| cache_resolve_check(test, 1, answers[i].rcode, 0)) {
+			ast_test_status_update(test, "Answer for a %s was not given from the cache\n",
+				answers[i].name);
+			res = AST_TEST_FAIL;
+		} else {
+			ast_dns_test_cache_age(3600);
+
+			if (cache_resolve_check(test, 2, answers[i].rcode, 0)) {
+				ast_test_status_update(test, "Expired answer for a %s was given from the cache\n",
+					answers[i].name);
+				res = AST_TEST_FAIL;
+			}
+		}
+
+		ast_dns_resolver_unregister(&cache_resolver);
+	}
+
+	return res;
+}
+
+AST_TEST_DEFINE(resolver_cache_stale)
+{
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "resolver_cache_stale";
+		info->category = "/main/dns/";
+		info->summary = "Test stale DNS answers being refreshed";
+		info->description =
+			"This test ages a cached answer just past its TTL, and ensures that it is still\n"
+			"given out, with a TTL of 1, while the resolver is asked to refresh it once.\n"
+			"It then ensures that the refreshed answer replaces it in the cache.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (cache_resolver_register(NOERROR, 60)) {
+		ast_test_status_update(test, "Unable to register cache resolver\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (cache_resolve_check(test, 1, NOERROR, 60)) {
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	ast_dns_test_cache_age(61);
+
+	/* The query refreshing the answer is started before the stale answer is given */
+	if (cache_resolve_check(test, 2, NOERROR, 1)) {
+		ast_test_status_update(test, "Stale answer was not given while it was refreshed\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	/* Until the refreshed answer is stored the stale one is still given, without asking again */
+	for (i = 0; i < 50; ++i) {
+		struct ast_dns_result *result = NULL;
+		int ttl;
+
+		if (ast_dns_resolve("asterisk.org", T_A, C_IN, &result) || !result
+			|| !ast_dns_result_get_records(result)) {
+			ast_test_status_update(test, "Resolution of address failed\n");
+			ast_dns_result_free(result);
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+		ttl = ast_dns_record_get_ttl(ast_dns_result_get_records(result));
+		ast_dns_result_free(result);
+
+		if (cache_resolver_data.resolves != 2) {
+			ast_test_status_update(test, "Stale answer was refreshed more than once\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+		if (ttl > 1) {
+			break;
+		}
+		usleep(100000);
+	}
+
+	if (i == 50) {
+		ast_test_status_update(test, "Refreshed answer did not replace the stale one\n");
+		res = AST_TEST_FAIL;
+	}
+
+cleanup:
+	ast_dns_resolver_unregister(&cache_resolver);
+	return res;
+}
+
+AST_TEST_DEFINE(resolver_cache_cancel)
+{
+	RAII_VAR(struct async_resolution_data *, async_data, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_dns_query_active *, active, NULL, ao2_cleanup);
+	struct ast_dns_result *result;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	struct timespec timeout;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "resolver_cache_cancel";
+		info->category = "/main/dns/";
+		info->summary = "Test canceling a DNS query answered from the cache";
+		info->description =
+			"This test cancels an asynchronous query answered from the cache. The goal of\n"
+			"this test is to ensure that the cancelation fails without calling into the\n"
+			"resolver, and that the query still completes with the cached answer.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (cache_resolver_register(NOERROR, 60)) {
+		ast_test_status_update(test, "Unable to register cache resolver\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (cache_resolve_check(test, 1, NOERROR, 60)) {
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	async_data = async_data_alloc();
+	if (!async_data) {
+		ast_test_status_update(test, "Failed to allocate asynchronous data\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	active = ast_dns_resolve_async("asterisk.org", T_A, C_IN, async_callback, async_data);
+	if (!active) {
+		ast_test_status_update(test, "Asynchronous resolution of address failed\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (!ast_dns_resolve_cancel(active)) {
+		ast_test_status_update(test, "Query answered from the cache was canceled\n");
+		res = AST_TEST_FAIL;
+	}
+
+	if (cache_resolver_data.canceled || cache_resolver_data.resolves != 1) {
+		ast_test_status_update(test, "Query answered from the cache called into the resolver\n");
+		res = AST_TEST_FAIL;
+	}
+
+	timeout = ast_tsnow();
+	timeout.tv_sec += 10;
+	ast_mutex_lock(&async_data->lock);
+	while (!async_data->complete) {
+		if (ast_cond_timedwait(&async_data->cond, &async_data->lock, &timeout) == ETIMEDOUT) {
+			break;
+		}
+	}
+	ast_mutex_unlock(&async_data->lock);
+
+	if (!async_data->complete) {
+		ast_test_status_update(test, "Asynchronous resolution timed out\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	result = ast_dns_query_get_result(active->query);
+	if (!result || !ast_dns_result_get_records(result)) {
+		ast_test_status_update(test, "Query answered from the cache had no records\n");
+		res = AST_TEST_FAIL;
+	}
+
+cleanup:
+	ast_dns_resolver_unregister(&cache_resolver);
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(resolver_register_unregister);
@@ -1311,6 +1691,10 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(resolver_resolve_async);
 	AST_TEST_UNREGISTER(resolver_resolve_async_off_nominal);
 	AST_TEST_UNREGISTER(resolver_resolve_async_cancel);
+	AST_TEST_UNREGISTER(resolver_cache_ttl);
+	AST_TEST_UNREGISTER(resolver_cache_negative);
+	AST_TEST_UNREGISTER(resolver_cache_stale);
+	AST_TEST_UNREGISTER(resolver_cache_cancel);
 
 	return 0;
 }
@@ -1330,6 +1714,10 @@ static int load_module(void)
 	AST_TEST_REGISTER(resolver_resolve_async);
 	AST_TEST_REGISTER(resolver_resolve_async_off_nominal);
 	AST_TEST_REGISTER(resolver_resolve_async_cancel);
+	AST_TEST_REGISTER(resolver_cache_ttl);
+	AST_TEST_REGISTER(resolver_cache_negative);
+	AST_TEST_REGISTER(resolver_cache_stale);
+	AST_TEST_REGISTER(resolver_cache_cancel);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -26,8 +26,12 @@
 #include <sys/stat.h>
 #include <stdio.h>
 
+#include "asterisk/channel.h"
 #include "asterisk/file.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/options.h"
 #include "asterisk/paths.h"
+#include "asterisk/say.h"
 #include "asterisk/test.h"
 #include "asterisk/module.h"
 #include "asterisk/strings.h"
@@ -180,8 +184,374 @@ AST_TEST_DEFINE(read_dirs_test)
 	return res;
 }
 
+AST_TEST_DEFINE(fileexists_index_test)
+{
+	char *dir_name;
+	char *file_name;
+	const char *sounds_name;
+	char *name;
+	FILE *file;
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "fileexists_index_test";
+		info->category = "/main/file/";
+		info->summary = "Sound files are seen as they come and go";
+		info->description = "Create and remove a sound file in the sounds directory,\n"
+			"checking the index answering whether it exists follows.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!ast_get_format_for_file_ext("sln")) {
+		ast_test_status_update(test, "The sln file format is not registered\n");
+		return AST_TEST_NOT_RUN;
+	}
+
+	if (ast_asprintf(&dir_name, "%s/sounds/test_file.XXXXXX", ast_config_AST_DATA_DIR) < 0) {
+		return AST_TEST_FAIL;
+	}
+	if (!mkdtemp(dir_name)) {
+		ast_test_status_update(test, "Failed to create directory: %s\n", dir_name);
+		ast_free(dir_name);
+		return AST_TEST_FAIL;
+	}
+	sounds_name = strrchr(dir_name, '/') + 1;
+	name = ast_alloca(strlen(sounds_name) + sizeof("/prompt"));
+	sprintf(name, "%s/prompt", sounds_name); /* Safe */
+
+	if (ast_asprintf(&file_name, "%s/prompt.sln", dir_name) < 0) {
+		rmdir(dir_name);
+		ast_free(dir_name);
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_fileexists(name, NULL, NULL)) {
+		ast_test_status_update(test, "%s exists before being created\n", name);
+		res = AST_TEST_FAIL;
+	}
+
+	file = fopen(file_name, "w");
+	if (!file) {
+		ast_test_status_update(test, "Failed to create file: %s\n", file_name);
+		res = AST_TEST_FAIL;
+	} else {
+		fclose(file);
+		if (ast_fileexists(name, NULL, NULL) <= 0) {
+			ast_test_status_update(test, "%s does not exist once created\n", name);
+			res = AST_TEST_FAIL;
+		}
+		unlink(file_name);
+		if (ast_fileexists(name, NULL, NULL)) {
+			ast_test_status_update(test, "%s still exists once removed\n", name);
+			res = AST_TEST_FAIL;
+		}
+	}
+
+	if (rmdir(dir_name)) {
+		ast_test_status_update(test, "Failed to remove directory: %s\n", dir_name);
+		res = AST_TEST_FAIL;
+	}
+	ast_free(file_name);
+	ast_free(dir_name);
+
+	return res;
+}
+
+/*! \brief The first sample byte of each file the mock channel played, in order */
+static char played[16];
+
+static int mock_playback_write(struct ast_channel *chan, struct ast_frame *frame)
+{
+	size_t len = strlen(played);
+	char sample;
+
+	if (frame->frametype != AST_FRAME_VOICE || !frame->datalen) {
+		return 0;
+	}
+
+	/* Each file is filled with its own name, so note it once per file */
+	sample = *(char *) frame->data.ptr;
+	if ((!len || played[len - 1] != sample) && len < sizeof(played) - 1) {
+		played[len] = sample;
+	}
+
+	return 0;
+}
+
+static const struct ast_channel_tech mock_playback_tech = {
+	.write = mock_playback_write,
+};
+
+static struct ast_channel *mock_playback_channel(struct ast_test *test)
+{
+	struct ast_format_cap *caps;
+	struct ast_channel *chan;
+
+	caps = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!caps || ast_format_cap_append(caps, ast_format_slin, 0)) {
+		ast_test_status_update(test, "Failed to create the slin capabilities\n");
+		ao2_cleanup(caps);
+		return NULL;
+	}
+
+	chan = ast_channel_alloc(0, AST_STATE_DOWN, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, "TestChannel");
+	if (!chan) {
+		ast_test_status_update(test, "Failed to create a mock channel for testing\n");
+		ao2_ref(caps, -1);
+		return NULL;
+	}
+
+	ast_channel_tech_set(chan, &mock_playback_tech);
+	ast_channel_nativeformats_set(chan, caps);
+	ao2_ref(caps, -1);
+	ast_channel_unlock(chan);
+
+	if (ast_set_write_format(chan, ast_format_slin)) {
+		ast_test_status_update(test, "Failed to set the write format of the mock channel\n");
+		ast_hangup(chan);
+		return NULL;
+	}
+
+	return chan;
+}
+
+static int sound_files_destroy(struct ast_test *test, char *dir_name, const char *names)
+{
+	int res = 0;
+
+	for (; *names; ++names) {
+		char *file_name = ast_alloca(strlen(dir_name) + sizeof("/x.sln"));
+
+		sprintf(file_name, "%s/%c.sln", dir_name, *names); /* Safe */
+		unlink(file_name);
+	}
+
+	if ((res = rmdir(dir_name))) {
+		ast_test_status_update(test, "Failed to remove directory: %s\n", dir_name);
+	}
+	ast_free(dir_name);
+
+	return res;
+}
+
+/*!
+ * \brief Create a directory in the sounds directory holding a 20ms sln file
+ * for each character of \a names, each filled with its name
+ *
+ * \return the path of the directory, relative to the sounds directory
+ */
+static char *sound_files_create(struct ast_test *test, char **dir_name, const char *names)
+{
+	char sample[320];
+	FILE *file;
+	const char *name;
+
+	if (ast_asprintf(dir_name, "%s/sounds/test_file.XXXXXX", ast_config_AST_DATA_DIR) < 0) {
+		return NULL;
+	}
+	if (!mkdtemp(*dir_name)) {
+		ast_test_status_update(test, "Failed to create directory: %s\n", *dir_name);
+		ast_free(*dir_name);
+		return NULL;
+	}
+
+	for (name = names; *name; ++name) {
+		char *file_name = ast_alloca(strlen(*dir_name) + sizeof("/x.sln"));
+
+		sprintf(file_name, "%s/%c.sln", *dir_name, *name); /* Safe */
+		memset(sample, *name, sizeof(sample));
+		file = fopen(file_name, "w");
+		if (!file || fwrite(sample, sizeof(sample), 1, file) != 1) {
+			ast_test_status_update(test, "Failed to create file: %s\n", file_name);
+			if (file) {
+				fclose(file);
+			}
+			break;
+		}
+		fclose(file);
+	}
+
+	if (*name) {
+		sound_files_destroy(test, *dir_name, names);
+		return NULL;
+	}
+
+	return strrchr(*dir_name, '/') + 1;
+}
+
+/*!
+ * \brief Stream a list of the files the sounds directory \a sounds_name
+ * holds, checking which of them were played
+ */
+static int check_streamfile_list(struct ast_test *test, struct ast_channel *chan,
+	const char *sounds_name, const char *names, int streamed, const char *expected)
+{
+	const char **files = ast_alloca(sizeof(*files) * strlen(names));
+	int count = strlen(names);
+	int res;
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		char *file = ast_alloca(strlen(sounds_name) + sizeof("/x"));
+
+		sprintf(file, "%s/%c", sounds_name, names[i]); /* Safe */
+		files[i] = file;
+	}
+
+	memset(played, 0, sizeof(played));
+	res = ast_streamfile_list(chan, files, count, NULL);
+	if (res == streamed && res > 0) {
+		ast_waitstream(chan, "");
+	}
+	ast_stopstream(chan);
+
+	if (res != streamed || strcmp(played, expected)) {
+		ast_test_status_update(test, "Streaming '%s' returned %d and played '%s', expected %d and '%s'\n",
+			names, res, played, streamed, expected);
+		return -1;
+	}
+
+	return 0;
+}
+
+AST_TEST_DEFINE(streamfile_list_test)
+{
+	char *dir_name;
+	const char *sounds_name;
+	struct ast_channel *chan;
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "streamfile_list_test";
+		info->category = "/main/file/";
+		info->summary = "A list of files is played as one stream";
+		info->description = "Stream lists of sound files to a channel, checking they\n"
+			"are played in order and the list stops at a file that does not exist.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!ast_get_format_for_file_ext("sln")) {
+		ast_test_status_update(test, "The sln file format is not registered\n");
+		return AST_TEST_NOT_RUN;
+	}
+
+	if (!(sounds_name = sound_files_create(test, &dir_name, "abc"))) {
+		return AST_TEST_FAIL;
+	}
+	if (!(chan = mock_playback_channel(test))) {
+		sound_files_destroy(test, dir_name, "abc");
+		return AST_TEST_FAIL;
+	}
+
+	if (check_streamfile_list(test, chan, sounds_name, "abc", 3, "abc")
+		|| check_streamfile_list(test, chan, sounds_name, "cab", 3, "cab")
+		|| check_streamfile_list(test, chan, sounds_name, "b", 1, "b")
+		|| check_streamfile_list(test, chan, sounds_name, "bxc", 1, "b")
+		|| check_streamfile_list(test, chan, sounds_name, "xab", -1, "")) {
+		res = AST_TEST_FAIL;
+	}
+
+	ast_hangup(chan);
+	if (sound_files_destroy(test, dir_name, "abc")) {
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
+/*!
+ * \brief Say the literal files of a date format, checking which of them were played
+ */
+static int check_say_files(struct ast_test *test, struct ast_channel *chan,
+	const char *sounds_name, const char *names, int expected_res, const char *expected)
+{
+	char *format = ast_alloca(strlen(names) * (strlen(sounds_name) + sizeof("''/x")) + 1);
+	char *pos = format;
+	int res;
+
+	for (; *names; ++names) {
+		pos += sprintf(pos, "'%s/%c'", sounds_name, *names); /* Safe */
+	}
+	*pos = '\0';
+
+	memset(played, 0, sizeof(played));
+	res = ast_say_date_with_format(chan, 0, "", "en", format, NULL);
+	ast_stopstream(chan);
+
+	if (res != expected_res || strcmp(played, expected)) {
+		ast_test_status_update(test, "Saying %s %s a playlist returned %d and played '%s', expected %d and '%s'\n",
+			format, ast_option_say_playlist ? "with" : "without", res, played, expected_res, expected);
+		return -1;
+	}
+
+	return 0;
+}
+
+AST_TEST_DEFINE(say_playlist_test)
+{
+	char *dir_name;
+	const char *sounds_name;
+	struct ast_channel *chan;
+	int say_playlist = ast_option_say_playlist;
+	int i;
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "say_playlist_test";
+		info->category = "/main/say/";
+		info->summary = "The files of an ast_say_* call are played as a playlist";
+		info->description = "Say literal sound files with and without the say_playlist\n"
+			"option, checking the files collected are played in order and a file\n"
+			"that does not exist stops the sayer the same way in both cases.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!ast_get_format_for_file_ext("sln")) {
+		ast_test_status_update(test, "The sln file format is not registered\n");
+		return AST_TEST_NOT_RUN;
+	}
+
+	if (!(sounds_name = sound_files_create(test, &dir_name, "abc"))) {
+		return AST_TEST_FAIL;
+	}
+	if (!(chan = mock_playback_channel(test))) {
+		sound_files_destroy(test, dir_name, "abc");
+		return AST_TEST_FAIL;
+	}
+
+	for (i = 0; i < 2 && res == AST_TEST_PASS; ++i) {
+		ast_option_say_playlist = i;
+		if (check_say_files(test, chan, sounds_name, "abc", 0, "abc")
+			|| check_say_files(test, chan, sounds_name, "cba", 0, "cba")
+			|| check_say_files(test, chan, sounds_name, "abxc", -1, "ab")
+			|| check_say_files(test, chan, sounds_name, "xa", -1, "")) {
+			res = AST_TEST_FAIL;
+		}
+	}
+	ast_option_say_playlist = say_playlist;
+
+	ast_hangup(chan);
+	if (sound_files_destroy(test, dir_name, "abc")) {
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(say_playlist_test);
+	AST_TEST_UNREGISTER(streamfile_list_test);
+	AST_TEST_UNREGISTER(fileexists_index_test);
 	AST_TEST_UNREGISTER(read_dirs_test);
 	return 0;
 }
@@ -189,6 +559,9 @@ static int unload_module(void)
 static int load_module(void)
 {
 	AST_TEST_REGISTER(read_dirs_test);
+	AST_TEST_REGISTER(fileexists_index_test);
+	AST_TEST_REGISTER(streamfile_list_test);
+	AST_TEST_REGISTER(say_playlist_test);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -0,0 +1,275 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Frame API Unit Tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+
+#define FRAME_SHARE_COPIES 4
+
+/*! \brief Sizes covering a pool size class and a heap sized video frame */
+static const int frame_share_sizes[] = { 320, 4000 };
+
+static void frame_fill(struct ast_frame *fr, unsigned char *data, int datalen)
+{
+	memset(fr, 0, sizeof(*fr));
+	fr->frametype = AST_FRAME_VOICE;
+	fr->subclass.format = ast_format_slin;
+	fr->datalen = datalen;
+	fr->samples = datalen / 2;
+	fr->data.ptr = data;
+	fr->src = "test_frame";
+	fr->seqno = 42;
+	memset(data, 0x5a, datalen);
+}
+
+AST_TEST_DEFINE(frame_share)
+{
+	unsigned char data[4000];
+	struct ast_frame fr;
+	struct ast_frame *master;
+	struct ast_frame *copies[FRAME_SHARE_COPIES];
+	int res = AST_TEST_PASS;
+	int size;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "frame_share";
+		info->category = "/main/frame/";
+		info->summary = "frame payload sharing unit test";
+		info->description =
+			"Test that shared frames reference a single data buffer";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (size = 0; size < ARRAY_LEN(frame_share_sizes); ++size) {
+		frame_fill(&fr, data, frame_share_sizes[size]);
+
+		/* Sharing a frame that is not pooled copies it */
+		master = ast_frame_share(&fr);
+		ast_test_validate(test, master != NULL,
+			"Failed to share a %d byte frame", fr.datalen);
+		ast_test_validate_cleanup(test, master->data.ptr != fr.data.ptr,
+			res, cleanup_master);
+		ast_test_validate_cleanup(test, !ast_frame_is_shared(master),
+			res, cleanup_master);
+
+		memset(copies, 0, sizeof(copies));
+		for (i = 0; i < FRAME_SHARE_COPIES; ++i) {
+			copies[i] = ast_frame_share(master);
+			ast_test_validate_cleanup(test, copies[i] != NULL, res, cleanup);
+			ast_test_validate_cleanup(test, copies[i] != master, res, cleanup);
+			ast_test_validate_cleanup(test, copies[i]->data.ptr == master->data.ptr,
+				res, cleanup);
+			ast_test_validate_cleanup(test, copies[i]->datalen == fr.datalen
+				&& copies[i]->seqno == fr.seqno
+				&& !strcmp(copies[i]->src, fr.src)
+				&& ast_format_cmp(copies[i]->subclass.format, ast_format_slin) == AST_FORMAT_CMP_EQUAL,
+				res, cleanup);
+		}
+		ast_test_validate_cleanup(test, ast_frame_is_shared(master), res, cleanup);
+
+		/* The data must outlive the frame it was first shared from */
+		ast_frfree(master);
+		master = NULL;
+		for (i = 0; i < FRAME_SHARE_COPIES - 1; ++i) {
+			ast_test_validate_cleanup(test, ast_frame_is_shared(copies[i]), res, cleanup);
+			ast_frfree(copies[i]);
+			copies[i] = NULL;
+		}
+		ast_test_validate_cleanup(test, !ast_frame_is_shared(copies[i]), res, cleanup);
+		ast_test_validate_cleanup(test, !memcmp(copies[i]->data.ptr, data, fr.datalen),
+			res, cleanup);
+
+cleanup:
+		for (i = 0; i < FRAME_SHARE_COPIES; ++i) {
+			if (copies[i]) {
+				ast_frfree(copies[i]);
+			}
+		}
+cleanup_master:
+		if (master) {
+			ast_frfree(master);
+		}
+		if (res != AST_TEST_PASS) {
+			ast_test_status_update(test, "Sharing a %d byte frame failed\n", fr.datalen);
+			break;
+		}
+	}
+
+	return res;
+}
+
+AST_TEST_DEFINE(frame_unshare)
+{
+	unsigned char data[320];
+	struct ast_frame fr;
+	struct ast_frame *master = NULL;
+	struct ast_frame *copy = NULL;
+	int res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "frame_unshare";
+		info->category = "/main/frame/";
+		info->summary = "frame payload unsharing unit test";
+		info->description =
+			"Test that unsharing a frame leaves the other frames untouched";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	frame_fill(&fr, data, sizeof(data));
+
+	master = ast_frame_share(&fr);
+	ast_test_validate(test, master != NULL, "Failed to share a frame");
+	copy = ast_frame_share(master);
+	ast_test_validate_cleanup(test, copy != NULL, res, cleanup);
+
+	/* Unsharing a private frame does nothing */
+	ast_test_validate_cleanup(test, !ast_frame_unshare(&fr), res, cleanup);
+	ast_test_validate_cleanup(test, fr.data.ptr == data, res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_frame_unshare(copy), res, cleanup);
+	ast_test_validate_cleanup(test, copy->data.ptr != master->data.ptr, res, cleanup);
+	ast_test_validate_cleanup(test, !ast_frame_is_shared(copy), res, cleanup);
+	ast_test_validate_cleanup(test, !ast_frame_is_shared(master), res, cleanup);
+	ast_test_validate_cleanup(test, !strcmp(copy->src, fr.src), res, cleanup);
+
+	/* Writing to the private copy must not show through the original */
+	memset(copy->data.ptr, 0xa5, copy->datalen);
+	ast_test_validate_cleanup(test, !memcmp(master->data.ptr, data, sizeof(data)),
+		res, cleanup);
+
+cleanup:
+	if (copy) {
+		ast_frfree(copy);
+	}
+	ast_frfree(master);
+
+	return res;
+}
+
+AST_TEST_DEFINE(frame_shared_translation)
+{
+	unsigned char data[320];
+	unsigned char encoded[160];
+	struct ast_frame fr;
+	struct ast_frame translated;
+	struct ast_frame *master = NULL;
+	struct ast_frame *copy = NULL;
+	struct ast_frame *out = NULL;
+	int res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "frame_shared_translation";
+		info->category = "/main/frame/";
+		info->summary = "shared frame translation unit test";
+		info->description =
+			"Test that a translation attached to shared data is seen by every sharing frame";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	frame_fill(&fr, data, sizeof(data));
+	frame_fill(&translated, encoded, sizeof(encoded));
+	translated.subclass.format = ast_format_ulaw;
+	translated.samples = sizeof(encoded);
+	memset(encoded, 0x7f, sizeof(encoded));
+
+	master = ast_frame_share(&fr);
+	ast_test_validate(test, master != NULL, "Failed to share a frame");
+
+	/* Private data cannot carry a translation */
+	ast_test_validate_cleanup(test, ast_frame_shared_translation_set(master, &translated) == -1,
+		res, cleanup);
+
+	copy = ast_frame_share(master);
+	ast_test_validate_cleanup(test, copy != NULL, res, cleanup);
+	ast_test_validate_cleanup(test, !ast_frame_shared_translation_get(master, ast_format_ulaw),
+		res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_frame_shared_translation_set(copy, &translated),
+		res, cleanup);
+	ast_test_validate_cleanup(test, ast_frame_shared_translation_set(master, &translated) == -1,
+		res, cleanup);
+	ast_test_validate_cleanup(test, !ast_frame_shared_translation_get(master, ast_format_alaw),
+		res, cleanup);
+
+	out = ast_frame_shared_translation_get(master, ast_format_ulaw);
+	ast_test_validate_cleanup(test, out != NULL, res, cleanup);
+	ast_test_validate_cleanup(test, out->datalen == sizeof(encoded)
+		&& out->samples == translated.samples
+		&& !memcmp(out->data.ptr, encoded, sizeof(encoded)), res, cleanup);
+
+	/* The translation outlives the frames that shared the data */
+	ast_frfree(copy);
+	copy = NULL;
+	ast_frfree(master);
+	master = NULL;
+	ast_test_validate_cleanup(test, !memcmp(out->data.ptr, encoded, sizeof(encoded)),
+		res, cleanup);
+
+cleanup:
+	if (out) {
+		ast_frfree(out);
+	}
+	if (copy) {
+		ast_frfree(copy);
+	}
+	if (master) {
+		ast_frfree(master);
+	}
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(frame_share);
+	AST_TEST_UNREGISTER(frame_unshare);
+	AST_TEST_UNREGISTER(frame_shared_translation);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(frame_share);
+	AST_TEST_REGISTER(frame_unshare);
+	AST_TEST_REGISTER(frame_shared_translation);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Frame API test module");
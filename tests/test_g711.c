@@ -0,0 +1,177 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief G.711 buffer conversion unit tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/ulaw.h"
+#include "asterisk/alaw.h"
+
+/*! \brief Every signed linear sample, plus a tail that is not a whole vector */
+#define G711_TEST_SAMPLES (65536 + 13)
+
+static void g711_test_fill(int16_t *lin, unsigned char *codes)
+{
+	int i;
+
+	for (i = 0; i < G711_TEST_SAMPLES; ++i) {
+		lin[i] = (int16_t) (i - 32768);
+		codes[i] = i & 0xff;
+	}
+}
+
+AST_TEST_DEFINE(g711_ulaw)
+{
+	int16_t *lin;
+	int16_t *decoded;
+	unsigned char *codes;
+	unsigned char *encoded;
+	int res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "ulaw";
+		info->category = "/main/g711/";
+		info->summary = "mu-law buffer conversion unit test";
+		info->description =
+			"Test that converting buffers matches the mu-law tables";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	lin = ast_malloc(sizeof(*lin) * G711_TEST_SAMPLES);
+	decoded = ast_malloc(sizeof(*decoded) * G711_TEST_SAMPLES);
+	codes = ast_malloc(G711_TEST_SAMPLES);
+	encoded = ast_malloc(G711_TEST_SAMPLES);
+	if (!lin || !decoded || !codes || !encoded) {
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+	g711_test_fill(lin, codes);
+
+	ast_ulaw_encode(encoded, lin, G711_TEST_SAMPLES);
+	ast_ulaw_decode(decoded, codes, G711_TEST_SAMPLES);
+
+	for (i = 0; i < G711_TEST_SAMPLES; ++i) {
+		if (encoded[i] != AST_LIN2MU(lin[i])) {
+			ast_test_status_update(test, "Encoding %d gave %u instead of %u\n",
+				lin[i], encoded[i], AST_LIN2MU(lin[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+		if (decoded[i] != AST_MULAW(codes[i])) {
+			ast_test_status_update(test, "Decoding %u gave %d instead of %d\n",
+				codes[i], decoded[i], AST_MULAW(codes[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+cleanup:
+	ast_free(lin);
+	ast_free(decoded);
+	ast_free(codes);
+	ast_free(encoded);
+
+	return res;
+}
+
+AST_TEST_DEFINE(g711_alaw)
+{
+	int16_t *lin;
+	int16_t *decoded;
+	unsigned char *codes;
+	unsigned char *encoded;
+	int res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "alaw";
+		info->category = "/main/g711/";
+		info->summary = "A-law buffer conversion unit test";
+		info->description =
+			"Test that converting buffers matches the A-law tables";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	lin = ast_malloc(sizeof(*lin) * G711_TEST_SAMPLES);
+	decoded = ast_malloc(sizeof(*decoded) * G711_TEST_SAMPLES);
+	codes = ast_malloc(G711_TEST_SAMPLES);
+	encoded = ast_malloc(G711_TEST_SAMPLES);
+	if (!lin || !decoded || !codes || !encoded) {
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+	g711_test_fill(lin, codes);
+
+	ast_alaw_encode(encoded, lin, G711_TEST_SAMPLES);
+	ast_alaw_decode(decoded, codes, G711_TEST_SAMPLES);
+
+	for (i = 0; i < G711_TEST_SAMPLES; ++i) {
+		if (encoded[i] != AST_LIN2A(lin[i])) {
+			ast_test_status_update(test, "Encoding %d gave %u instead of %u\n",
+				lin[i], encoded[i], AST_LIN2A(lin[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+		if (decoded[i] != AST_ALAW(codes[i])) {
+			ast_test_status_update(test, "Decoding %u gave %d instead of %d\n",
+				codes[i], decoded[i], AST_ALAW(codes[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+cleanup:
+	ast_free(lin);
+	ast_free(decoded);
+	ast_free(codes);
+	ast_free(encoded);
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(g711_ulaw);
+	AST_TEST_UNREGISTER(g711_alaw);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(g711_ulaw);
+	AST_TEST_REGISTER(g711_alaw);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "G.711 buffer conversion test module");
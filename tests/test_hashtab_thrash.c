@@ -230,6 +230,8 @@ AST_TEST_DEFINE(hash_test)
 	struct hash_test data = {};
 	pthread_t grow_thread, count_thread, lookup_thread, shrink_thread;
 	void *thread_results;
+	struct timeval start;
+	int biggest_bucket, resizes, numobjs, numbucks;
 	int i;
 
 	switch (cmd) {
@@ -270,6 +272,8 @@ AST_TEST_DEFINE(hash_test)
 		ast_hashtab_insert_immediate(data.to_be_thrashed, obj);
 	}
 
+	start = ast_tvnow();
+
 	/* add data.max_grow entries to the hashtab */
 	ast_pthread_create(&grow_thread, NULL, hash_test_grow, &data);
 	/* continually count the keys added by the grow thread */
@@ -307,6 +311,10 @@ AST_TEST_DEFINE(hash_test)
 		res = AST_TEST_FAIL;
 	}
 
+	ast_hashtab_get_stats(data.to_be_thrashed, &biggest_bucket, &resizes, &numobjs, &numbucks);
+	ast_test_status_update(test, "Thrashed in %" PRId64 " ms: %d objects, %d slots, %d resizes, at most %d groups probed\n",
+		ast_tvdiff_ms(ast_tvnow(), start), numobjs, numbucks, resizes, biggest_bucket);
+
 	if (ast_hashtab_size(data.to_be_thrashed) != data.max_grow) {
 		ast_test_status_update(test,
 			"Invalid hashtab size. Expected: %d, Actual: %d\n",
@@ -1705,6 +1705,117 @@ AST_TEST_DEFINE(json_test_cep)
 	return AST_TEST_PASS;
 }
 
+/*!
+ * \internal
+ * \brief Write what json_test_writer expects with a writer
+ */
+static int writer_sample(struct ast_str **dst, enum ast_json_encoding_format format)
+{
+	struct ast_json_writer writer;
+	struct ast_json *tree;
+	int res;
+
+	tree = ast_json_pack("{s: [i, s], s: {s: s}}",
+		"list", 1, "two", "nested", "key", "value");
+	if (!tree) {
+		return -1;
+	}
+
+	ast_json_writer_init(&writer, dst, format);
+	ast_json_writer_object_start(&writer);
+	ast_json_writer_key(&writer, "name");
+	ast_json_writer_string(&writer, "quote \" backslash \\ tab \t bell \a");
+	ast_json_writer_key(&writer, "count");
+	ast_json_writer_integer(&writer, -42);
+	ast_json_writer_key(&writer, "flags");
+	ast_json_writer_array_start(&writer);
+	ast_json_writer_boolean(&writer, 1);
+	ast_json_writer_boolean(&writer, 0);
+	ast_json_writer_null(&writer);
+	ast_json_writer_string(&writer, NULL);
+	ast_json_writer_array_end(&writer);
+	ast_json_writer_key(&writer, "empty");
+	ast_json_writer_object_start(&writer);
+	ast_json_writer_object_end(&writer);
+	ast_json_writer_key(&writer, "none");
+	ast_json_writer_array_start(&writer);
+	ast_json_writer_array_end(&writer);
+	ast_json_writer_key(&writer, "tree");
+	ast_json_writer_value(&writer, tree);
+	ast_json_writer_object_end(&writer);
+	res = ast_json_writer_finish(&writer);
+	ast_json_unref(tree);
+
+	return res;
+}
+
+AST_TEST_DEFINE(json_test_writer)
+{
+	RAII_VAR(struct ast_json *, expected, NULL, ast_json_unref);
+	RAII_VAR(struct ast_str *, expected_str, NULL, ast_free);
+	RAII_VAR(struct ast_str *, uut, NULL, ast_free);
+	struct ast_json_writer writer;
+	int format;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "writer";
+		info->category = CATEGORY;
+		info->summary = "Testing the streaming JSON writer.";
+		info->description = "Test JSON abstraction library.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	expected = ast_json_pack("{s: s, s: i, s: [b, b, n, n], s: {}, s: [], s: {s: [i, s], s: {s: s}}}",
+		"name", "quote \" backslash \\ tab \t bell \a",
+		"count", -42,
+		"flags", 1, 0,
+		"empty",
+		"none",
+		"tree", "list", 1, "two", "nested", "key", "value");
+	expected_str = ast_str_create(64);
+	uut = ast_str_create(64);
+	ast_test_validate(test, expected && expected_str && uut);
+
+	/* The writer encodes just as jansson does, in either format */
+	for (format = AST_JSON_COMPACT; format <= AST_JSON_PRETTY; ++format) {
+		ast_str_reset(expected_str);
+		ast_str_reset(uut);
+		ast_test_validate(test, 0 == ast_json_dump_str_format(expected, &expected_str, format));
+		ast_test_validate(test, 0 == writer_sample(&uut, format));
+		ast_test_validate(test, 0 == strcmp(ast_str_buffer(expected_str), ast_str_buffer(uut)));
+	}
+
+	/* A key outside of an object */
+	ast_json_writer_init(&writer, &uut, AST_JSON_COMPACT);
+	ast_json_writer_array_start(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_key(&writer, "key"));
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	/* An object member without a key */
+	ast_json_writer_init(&writer, &uut, AST_JSON_COMPACT);
+	ast_json_writer_object_start(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_integer(&writer, 1));
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	/* Mismatched and unclosed containers */
+	ast_json_writer_init(&writer, &uut, AST_JSON_COMPACT);
+	ast_json_writer_object_start(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_array_end(&writer));
+	ast_json_writer_init(&writer, &uut, AST_JSON_COMPACT);
+	ast_json_writer_array_start(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	/* Invalid UTF-8 */
+	ast_json_writer_init(&writer, &uut, AST_JSON_COMPACT);
+	ast_test_validate(test, -1 == ast_json_writer_string(&writer, "\xff"));
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(json_test_false);
@@ -1758,6 +1869,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(json_test_name_number);
 	AST_TEST_UNREGISTER(json_test_timeval);
 	AST_TEST_UNREGISTER(json_test_cep);
+	AST_TEST_UNREGISTER(json_test_writer);
 	return 0;
 }
 
@@ -1814,6 +1926,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(json_test_name_number);
 	AST_TEST_REGISTER(json_test_timeval);
 	AST_TEST_REGISTER(json_test_cep);
+	AST_TEST_REGISTER(json_test_writer);
 
 	ast_test_register_init(CATEGORY, json_test_init);
 	ast_test_register_cleanup(CATEGORY, json_test_cleanup);
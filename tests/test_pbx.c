@@ -323,6 +323,79 @@ cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(extension_cache_test)
+{
+	static const char registrar[] = "test_pbx_cache";
+	static const char TEST_CACHE[] = "test_cache";
+	static const char TEST_CACHE_INCLUDE[] = "test_cache_include";
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "extension_cache_test";
+		info->category = "/main/pbx/";
+		info->summary = "Test remembered dialplan lookups follow dialplan changes";
+		info->description = "Look up extensions repeatedly while adding and removing\n"
+			"extensions and includes, and check every lookup sees the change.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!ast_context_find_or_create(NULL, NULL, TEST_CACHE, registrar)
+		|| !ast_context_find_or_create(NULL, NULL, TEST_CACHE_INCLUDE, registrar)) {
+		ast_test_status_update(test, "Failed to create contexts\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	/* Each lookup is done twice so the second one can be remembered. */
+	for (i = 0; i < 2; ++i) {
+		ast_test_validate_cleanup(test, !ast_exists_extension(NULL, TEST_CACHE, "100", 1, NULL),
+			res, cleanup);
+	}
+
+	ast_test_validate_cleanup(test, !ast_add_extension(TEST_CACHE_INCLUDE, 0, "100", 1,
+		NULL, NULL, "Noop", NULL, NULL, registrar), res, cleanup);
+	ast_test_validate_cleanup(test, !ast_context_add_include(TEST_CACHE, TEST_CACHE_INCLUDE,
+		registrar), res, cleanup);
+	for (i = 0; i < 2; ++i) {
+		ast_test_validate_cleanup(test, ast_exists_extension(NULL, TEST_CACHE, "100", 1, NULL),
+			res, cleanup);
+		ast_test_validate_cleanup(test, !ast_exists_extension(NULL, TEST_CACHE, "100", 2, NULL),
+			res, cleanup);
+	}
+
+	ast_test_validate_cleanup(test, !ast_context_remove_extension(TEST_CACHE_INCLUDE, "100", 1,
+		registrar), res, cleanup);
+	for (i = 0; i < 2; ++i) {
+		ast_test_validate_cleanup(test, !ast_exists_extension(NULL, TEST_CACHE, "100", 1, NULL),
+			res, cleanup);
+	}
+
+	ast_test_validate_cleanup(test, !ast_add_extension(TEST_CACHE_INCLUDE, 0, "_1XX", 1,
+		NULL, NULL, "Noop", NULL, NULL, registrar), res, cleanup);
+	for (i = 0; i < 2; ++i) {
+		ast_test_validate_cleanup(test, ast_exists_extension(NULL, TEST_CACHE, "100", 1, NULL),
+			res, cleanup);
+	}
+
+	ast_test_validate_cleanup(test, !ast_context_remove_include(TEST_CACHE, TEST_CACHE_INCLUDE,
+		registrar), res, cleanup);
+	for (i = 0; i < 2; ++i) {
+		ast_test_validate_cleanup(test, !ast_exists_extension(NULL, TEST_CACHE, "100", 1, NULL),
+			res, cleanup);
+		ast_test_validate_cleanup(test, ast_exists_extension(NULL, TEST_CACHE_INCLUDE, "100", 1, NULL),
+			res, cleanup);
+	}
+
+cleanup:
+	ast_context_destroy(NULL, registrar);
+
+	return res;
+}
+
 AST_TEST_DEFINE(segv)
 {
 	switch (cmd) {
@@ -389,12 +462,14 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(call_assert);
 	AST_TEST_UNREGISTER(segv);
 	AST_TEST_UNREGISTER(pattern_match_test);
+	AST_TEST_UNREGISTER(extension_cache_test);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(pattern_match_test);
+	AST_TEST_REGISTER(extension_cache_test);
 	AST_TEST_REGISTER(segv);
 	AST_TEST_REGISTER(call_assert);
 	AST_TEST_REGISTER(call_backtrace);
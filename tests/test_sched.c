@@ -104,26 +104,14 @@ static int sched_order_8_cb(const void *data)
 	return 0;
 }
 
-AST_TEST_DEFINE(sched_test_order)
+static enum ast_test_result_state sched_test_order_backend(struct ast_test *test,
+	enum ast_sched_backend backend)
 {
 	struct ast_sched_context *con;
 	enum ast_test_result_state res = AST_TEST_FAIL;
 	int id1, id2, id3, wait;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "sched_test_order";
-		info->category = "/main/sched/";
-		info->summary = "Test ordering of events in the scheduler API";
-		info->description =
-			"This test ensures that events are properly ordered by the "
-			"time they are scheduled to execute in the scheduler API.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
-	if (!(con = ast_sched_context_create())) {
+	if (!(con = ast_sched_context_create_backend(backend))) {
 		ast_test_status_update(test,
 				"Test failed - could not create scheduler context\n");
 		return AST_TEST_FAIL;
@@ -262,77 +250,124 @@ return_cleanup:
 	return res;
 }
 
-static char *handle_cli_sched_bench(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+AST_TEST_DEFINE(sched_test_order)
 {
-	struct ast_sched_context *con;
-	struct timeval start;
-	unsigned int num, i;
-	int *sched_ids = NULL;
-
 	switch (cmd) {
-	case CLI_INIT:
-		e->command = "sched benchmark";
-		e->usage = ""
-			"Usage: sched benchmark <num>\n"
-			"";
-		return NULL;
-	case CLI_GENERATE:
-		return NULL;
+	case TEST_INIT:
+		info->name = "sched_test_order";
+		info->category = "/main/sched/";
+		info->summary = "Test ordering of events in the scheduler API";
+		info->description =
+			"This test ensures that events are properly ordered by the "
+			"time they are scheduled to execute in the scheduler API.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
 	}
 
-	if (a->argc != e->args + 1) {
-		return CLI_SHOWUSAGE;
-	}
+	return sched_test_order_backend(test, AST_SCHED_BACKEND_HEAP);
+}
 
-	if (sscanf(a->argv[e->args], "%u", &num) != 1) {
-		return CLI_SHOWUSAGE;
+AST_TEST_DEFINE(sched_test_order_wheel)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_test_order_wheel";
+		info->category = "/main/sched/";
+		info->summary = "Test ordering of events in the timing wheel scheduler";
+		info->description =
+			"This test ensures that events are properly ordered by the "
+			"time they are scheduled to execute when the scheduler context "
+			"uses the timing wheel backend.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
 	}
 
-	if (!(con = ast_sched_context_create())) {
-		ast_cli(a->fd, "Test failed - could not create scheduler context\n");
-		return CLI_FAILURE;
-	}
+	return sched_test_order_backend(test, AST_SCHED_BACKEND_WHEEL);
+}
 
-	if (!(sched_ids = ast_malloc(sizeof(*sched_ids) * num))) {
-		ast_cli(a->fd, "Test failed - memory allocation failure\n");
-		goto return_cleanup;
+/*! \brief Time adding and then deleting entries with one scheduler backend */
+static void sched_bench(int fd, enum ast_sched_backend backend, const char *name,
+	unsigned int num, int *sched_ids)
+{
+	struct ast_sched_context *con;
+	struct timeval start;
+	unsigned int i;
+
+	if (!(con = ast_sched_context_create_backend(backend))) {
+		ast_cli(fd, "Test failed - could not create %s scheduler context\n", name);
+		return;
 	}
 
-	ast_cli(a->fd, "Testing ast_sched_add() performance - timing how long it takes "
-			"to add %u entries at random time intervals from 0 to 60 seconds\n", num);
+	ast_cli(fd, "Testing %s ast_sched_add() performance - timing how long it takes "
+			"to add %u entries at random time intervals from 0 to 60 seconds\n", name, num);
 
 	start = ast_tvnow();
 
 	for (i = 0; i < num; i++) {
 		long when = labs(ast_random()) % 60000;
 		if ((sched_ids[i] = ast_sched_add(con, when, sched_cb, NULL)) == -1) {
-			ast_cli(a->fd, "Test failed - sched_add returned -1\n");
+			ast_cli(fd, "Test failed - sched_add returned -1\n");
 			goto return_cleanup;
 		}
 	}
 
-	ast_cli(a->fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+	ast_cli(fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
 
-	ast_cli(a->fd, "Testing ast_sched_del() performance - timing how long it takes "
-			"to delete %u entries with random time intervals from 0 to 60 seconds\n", num);
+	ast_cli(fd, "Testing %s ast_sched_del() performance - timing how long it takes "
+			"to delete %u entries with random time intervals from 0 to 60 seconds\n", name, num);
 
 	start = ast_tvnow();
 
 	for (i = 0; i < num; i++) {
 		if (ast_sched_del(con, sched_ids[i]) == -1) {
-			ast_cli(a->fd, "Test failed - sched_del returned -1\n");
+			ast_cli(fd, "Test failed - sched_del returned -1\n");
 			goto return_cleanup;
 		}
 	}
 
-	ast_cli(a->fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+	ast_cli(fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
 
 return_cleanup:
 	ast_sched_context_destroy(con);
-	if (sched_ids) {
-		ast_free(sched_ids);
+}
+
+static char *handle_cli_sched_bench(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int num;
+	int *sched_ids;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "sched benchmark";
+		e->usage = ""
+			"Usage: sched benchmark <num>\n"
+			"       Compare the heap and timing wheel scheduler backends.\n"
+			"";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args + 1) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (sscanf(a->argv[e->args], "%u", &num) != 1) {
+		return CLI_SHOWUSAGE;
 	}
 
+	if (!(sched_ids = ast_malloc(sizeof(*sched_ids) * num))) {
+		ast_cli(a->fd, "Test failed - memory allocation failure\n");
+		return CLI_SUCCESS;
+	}
+
+	sched_bench(a->fd, AST_SCHED_BACKEND_HEAP, "heap", num, sched_ids);
+	sched_bench(a->fd, AST_SCHED_BACKEND_WHEEL, "timing wheel", num, sched_ids);
+
+	ast_free(sched_ids);
+
 	return CLI_SUCCESS;
 }
 
@@ -343,6 +378,7 @@ static struct ast_cli_entry cli_sched[] = {
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(sched_test_order);
+	AST_TEST_UNREGISTER(sched_test_order_wheel);
 	ast_cli_unregister_multiple(cli_sched, ARRAY_LEN(cli_sched));
 	return 0;
 }
@@ -350,6 +386,7 @@ static int unload_module(void)
 static int load_module(void)
 {
 	AST_TEST_REGISTER(sched_test_order);
+	AST_TEST_REGISTER(sched_test_order_wheel);
 	ast_cli_register_multiple(cli_sched, ARRAY_LEN(cli_sched));
 	return AST_MODULE_LOAD_SUCCESS;
 }
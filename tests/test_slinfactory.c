@@ -0,0 +1,264 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Slinfactory unit tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/slinfactory.h"
+
+/*! \brief Samples of the frames fed, not a multiple of the samples read */
+#define SLINFACTORY_TEST_FEED 150
+/*! \brief Samples read at once */
+#define SLINFACTORY_TEST_READ 160
+
+/*!
+ * \brief The value of the sample at an index
+ *
+ * The period is prime, so stale data left from an earlier lap of the ring
+ * never passes for the sample expected.
+ */
+static short sample_value(unsigned int index)
+{
+	return index % 65521;
+}
+
+/*! \brief Feed the samples from \a index on to a slinfactory, in one frame */
+static int slinfactory_test_feed(struct ast_slinfactory *sf, unsigned int index, unsigned int samples)
+{
+	struct ast_frame fr = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = samples * sizeof(short),
+		.samples = samples,
+		.src = "test_slinfactory",
+	};
+	short *data;
+	unsigned int i;
+	int res;
+
+	data = ast_malloc(fr.datalen);
+	if (!data) {
+		return 0;
+	}
+	for (i = 0; i < samples; ++i) {
+		data[i] = sample_value(index + i);
+	}
+	fr.subclass.format = ast_format_slin;
+	fr.data.ptr = data;
+
+	res = ast_slinfactory_feed(sf, &fr);
+	ast_free(data);
+
+	return res;
+}
+
+/*! \brief Read samples from a slinfactory, checking they follow on from \a index */
+static int slinfactory_test_read(struct ast_test *test, struct ast_slinfactory *sf,
+	unsigned int index, unsigned int samples)
+{
+	short buf[SLINFACTORY_TEST_READ];
+	int i;
+
+	if (ast_slinfactory_read(sf, buf, samples) != samples) {
+		ast_test_status_update(test, "Failed to read %u samples from sample %u on\n",
+			samples, index);
+		return -1;
+	}
+	for (i = 0; i < samples; ++i) {
+		if (buf[i] != sample_value(index + i)) {
+			ast_test_status_update(test, "Sample %u read as %d, expected %d\n",
+				index + i, buf[i], sample_value(index + i));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Read every sample of a slinfactory, checking they follow on from \a index */
+static int slinfactory_test_drain(struct ast_test *test, struct ast_slinfactory *sf,
+	unsigned int index)
+{
+	unsigned int samples;
+
+	while ((samples = MIN(ast_slinfactory_available(sf), SLINFACTORY_TEST_READ))) {
+		if (slinfactory_test_read(test, sf, index, samples)) {
+			return -1;
+		}
+		index += samples;
+	}
+
+	return 0;
+}
+
+AST_TEST_DEFINE(slinfactory_ring)
+{
+	struct ast_slinfactory sf;
+	unsigned int fed = 0;
+	unsigned int read = 0;
+	int res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "slinfactory_ring";
+		info->category = "/main/slinfactory/";
+		info->summary = "Slinfactory ring test";
+		info->description = "Read frames of a different size than those fed, so reads\n"
+			"wrap around the ring of a slinfactory, then feed it enough to grow the\n"
+			"ring while its samples wrap. Every sample must come out in order.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_slinfactory_init(&sf);
+
+	/* Stay within the ring first allocated, so it wraps rather than grows */
+	while (read < 20000) {
+		if (fed - read < 800) {
+			if (slinfactory_test_feed(&sf, fed, SLINFACTORY_TEST_FEED) != SLINFACTORY_TEST_FEED) {
+				ast_test_status_update(test, "Failed to feed %d samples\n", SLINFACTORY_TEST_FEED);
+				res = AST_TEST_FAIL;
+				break;
+			}
+			fed += SLINFACTORY_TEST_FEED;
+			continue;
+		}
+		if (slinfactory_test_read(test, &sf, read, SLINFACTORY_TEST_READ)) {
+			res = AST_TEST_FAIL;
+			break;
+		}
+		read += SLINFACTORY_TEST_READ;
+	}
+
+	/* Grow the ring while the samples in it wrap */
+	for (i = 0; res == AST_TEST_PASS && i < 20; ++i) {
+		if (slinfactory_test_feed(&sf, fed, SLINFACTORY_TEST_FEED) != SLINFACTORY_TEST_FEED) {
+			ast_test_status_update(test, "Failed to feed %d samples\n", SLINFACTORY_TEST_FEED);
+			res = AST_TEST_FAIL;
+		}
+		fed += SLINFACTORY_TEST_FEED;
+	}
+	if (res == AST_TEST_PASS && ast_slinfactory_available(&sf) != fed - read) {
+		ast_test_status_update(test, "%u samples available, expected %u\n",
+			ast_slinfactory_available(&sf), fed - read);
+		res = AST_TEST_FAIL;
+	}
+	if (res == AST_TEST_PASS && slinfactory_test_drain(test, &sf, read)) {
+		res = AST_TEST_FAIL;
+	}
+
+	ast_slinfactory_destroy(&sf);
+
+	return res;
+}
+
+AST_TEST_DEFINE(slinfactory_overflow)
+{
+	struct ast_slinfactory sf;
+	unsigned int fed = 0;
+	int res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "slinfactory_overflow";
+		info->category = "/main/slinfactory/";
+		info->summary = "Slinfactory overflow test";
+		info->description = "Feed a slinfactory past the most samples it holds, in\n"
+			"small frames and in one frame larger than that. The oldest samples\n"
+			"must be dropped, and the newest ones kept in order.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_slinfactory_init(&sf);
+
+	/* Small frames, once a read moved the oldest sample off the front of the ring */
+	if (slinfactory_test_feed(&sf, fed, SLINFACTORY_TEST_FEED) != SLINFACTORY_TEST_FEED
+		|| slinfactory_test_read(test, &sf, fed, 100)) {
+		res = AST_TEST_FAIL;
+	}
+	fed += SLINFACTORY_TEST_FEED;
+	while (res == AST_TEST_PASS && fed < AST_SLINFACTORY_MAX_SAMPLES + 1000) {
+		if (slinfactory_test_feed(&sf, fed, SLINFACTORY_TEST_FEED) != SLINFACTORY_TEST_FEED) {
+			ast_test_status_update(test, "Failed to feed %d samples\n", SLINFACTORY_TEST_FEED);
+			res = AST_TEST_FAIL;
+		}
+		fed += SLINFACTORY_TEST_FEED;
+	}
+	if (res == AST_TEST_PASS && ast_slinfactory_available(&sf) != AST_SLINFACTORY_MAX_SAMPLES) {
+		ast_test_status_update(test, "%u samples available, expected %d\n",
+			ast_slinfactory_available(&sf), AST_SLINFACTORY_MAX_SAMPLES);
+		res = AST_TEST_FAIL;
+	}
+	if (res == AST_TEST_PASS && slinfactory_test_drain(test, &sf, fed - AST_SLINFACTORY_MAX_SAMPLES)) {
+		res = AST_TEST_FAIL;
+	}
+
+	/* One frame, on top of samples already in the factory */
+	if (res == AST_TEST_PASS) {
+		fed = AST_SLINFACTORY_MAX_SAMPLES + 500;
+		if (slinfactory_test_feed(&sf, 0, SLINFACTORY_TEST_FEED) != SLINFACTORY_TEST_FEED
+			|| slinfactory_test_feed(&sf, SLINFACTORY_TEST_FEED, fed) != AST_SLINFACTORY_MAX_SAMPLES) {
+			ast_test_status_update(test, "Feeding %u samples at once did not keep %d of them\n",
+				fed, AST_SLINFACTORY_MAX_SAMPLES);
+			res = AST_TEST_FAIL;
+		}
+		fed += SLINFACTORY_TEST_FEED;
+	}
+	if (res == AST_TEST_PASS && ast_slinfactory_available(&sf) != AST_SLINFACTORY_MAX_SAMPLES) {
+		ast_test_status_update(test, "%u samples available, expected %d\n",
+			ast_slinfactory_available(&sf), AST_SLINFACTORY_MAX_SAMPLES);
+		res = AST_TEST_FAIL;
+	}
+	if (res == AST_TEST_PASS && slinfactory_test_drain(test, &sf, fed - AST_SLINFACTORY_MAX_SAMPLES)) {
+		res = AST_TEST_FAIL;
+	}
+
+	ast_slinfactory_destroy(&sf);
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(slinfactory_ring);
+	AST_TEST_UNREGISTER(slinfactory_overflow);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(slinfactory_ring);
+	AST_TEST_REGISTER(slinfactory_overflow);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Slinfactory test module");
@@ -0,0 +1,153 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2020, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Smoother unit tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/smoother.h"
+
+/*! \brief Bytes of the frames fed, not a multiple of the frames read */
+#define SMOOTHER_TEST_FEED 300
+/*! \brief Bytes of the frames read */
+#define SMOOTHER_TEST_READ 320
+/*! \brief The smoother is kept at most this full, about the size of its ring */
+#define SMOOTHER_TEST_FULL 8192
+/*! \brief Samples fed and read, wrapping the ring several times */
+#define SMOOTHER_TEST_SAMPLES 50000
+
+/*!
+ * \brief The value of the sample at an index
+ *
+ * The period is prime, so stale data left from an earlier lap of the ring
+ * never passes for the sample expected.
+ */
+static short sample_value(unsigned int index)
+{
+	return index % 65521;
+}
+
+static void smoother_test_frame(struct ast_frame *fr, short *data, unsigned int index)
+{
+	int i;
+
+	memset(fr, 0, sizeof(*fr));
+	fr->frametype = AST_FRAME_VOICE;
+	fr->subclass.format = ast_format_slin;
+	fr->datalen = SMOOTHER_TEST_FEED;
+	fr->samples = SMOOTHER_TEST_FEED / sizeof(*data);
+	fr->data.ptr = data;
+	fr->src = "test_smoother";
+	for (i = 0; i < fr->samples; ++i) {
+		data[i] = sample_value(index + i);
+	}
+}
+
+AST_TEST_DEFINE(smoother_ring)
+{
+	short data[SMOOTHER_TEST_FEED / sizeof(short)];
+	struct ast_smoother *smoother;
+	struct ast_frame fr;
+	struct ast_frame *out;
+	unsigned int fed = 0;
+	unsigned int read = 0;
+	int res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "smoother_ring";
+		info->category = "/main/smoother/";
+		info->summary = "Smoother ring test";
+		info->description = "Keep a smoother nearly full while reading frames of a\n"
+			"different size than those fed, so reads wrap around its ring and frames\n"
+			"are read in place with little room left. The room before each frame is\n"
+			"written over, as its offset allows, and every sample must still come out\n"
+			"in order.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	smoother = ast_smoother_new(SMOOTHER_TEST_READ);
+	if (!smoother) {
+		return AST_TEST_FAIL;
+	}
+
+	while (res == AST_TEST_PASS && read < SMOOTHER_TEST_SAMPLES) {
+		if ((fed - read) * sizeof(short) + SMOOTHER_TEST_FEED <= SMOOTHER_TEST_FULL) {
+			smoother_test_frame(&fr, data, fed);
+			if (ast_smoother_feed(smoother, &fr)) {
+				ast_test_status_update(test, "Failed to feed the smoother with %u samples in it\n",
+					fed - read);
+				res = AST_TEST_FAIL;
+				break;
+			}
+			fed += fr.samples;
+			continue;
+		}
+
+		out = ast_smoother_read(smoother);
+		if (!out || out->datalen != SMOOTHER_TEST_READ || out->offset < AST_FRIENDLY_OFFSET) {
+			ast_test_status_update(test, "Failed to read a frame with %u samples in the smoother\n",
+				fed - read);
+			res = AST_TEST_FAIL;
+			break;
+		}
+		for (i = 0; i < out->samples; ++i) {
+			if (((short *) out->data.ptr)[i] != sample_value(read + i)) {
+				ast_test_status_update(test, "Sample %u read as %d, expected %d\n",
+					read + i, ((short *) out->data.ptr)[i], sample_value(read + i));
+				res = AST_TEST_FAIL;
+				break;
+			}
+		}
+		read += out->samples;
+
+		/* Whoever gets the frame may prepend to it, e.g. a header */
+		memset((char *) out->data.ptr - AST_FRIENDLY_OFFSET, 0xff, AST_FRIENDLY_OFFSET);
+	}
+
+	ast_smoother_free(smoother);
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(smoother_ring);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(smoother_ring);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Smoother test module");
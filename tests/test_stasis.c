@@ -468,6 +468,151 @@ AST_TEST_DEFINE(publish)
 	return AST_TEST_PASS;
 }
 
+struct metrics_check {
+	const char *topic;
+	const char *uniqueid;
+	uint64_t published;
+	uint64_t dispatched;
+	int topics_seen;
+	int subscriptions_seen;
+};
+
+static void metrics_check_topic_cb(const struct stasis_topic_metrics *metrics, void *data)
+{
+	struct metrics_check *check = data;
+
+	if (!strcmp(metrics->name, check->topic)) {
+		++check->topics_seen;
+		check->published = metrics->published;
+	}
+}
+
+static void metrics_check_subscription_cb(const struct stasis_subscription_metrics *metrics, void *data)
+{
+	struct metrics_check *check = data;
+
+	if (!strcmp(metrics->uniqueid, check->uniqueid)) {
+		++check->subscriptions_seen;
+		check->dispatched = metrics->dispatched;
+	}
+}
+
+AST_TEST_DEFINE(metrics)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_subscription *, uut, NULL, stasis_unsubscribe);
+	RAII_VAR(char *, test_data, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message, NULL, ao2_cleanup);
+	RAII_VAR(struct consumer *, consumer, NULL, ao2_cleanup);
+	struct metrics_check check = {
+		.topic = "TestMetricsTopic",
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test topic and subscription metrics";
+		info->description = "Test that published and dispatched messages are counted";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create(check.topic);
+	ast_test_validate(test, NULL != topic);
+
+	consumer = consumer_create(1);
+	ast_test_validate(test, NULL != consumer);
+
+	uut = stasis_subscribe(topic, consumer_exec, consumer);
+	ast_test_validate(test, NULL != uut);
+	ao2_ref(consumer, +1);
+	check.uniqueid = stasis_subscription_uniqueid(uut);
+
+	test_data = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data);
+	ast_test_validate(test, stasis_message_type_create("TestMessage", NULL, &test_message_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+	test_message = stasis_message_create(test_message_type, test_data);
+
+	stasis_publish(topic, test_message);
+	stasis_publish(topic, test_message);
+
+	ast_test_validate(test, 2 == consumer_wait_for(consumer, 2));
+
+	stasis_metrics_collect(metrics_check_topic_cb, metrics_check_subscription_cb, &check);
+
+	ast_test_validate(test, 1 == check.topics_seen);
+	ast_test_validate(test, 1 == check.subscriptions_seen);
+	/* The subscription change is counted along with the two messages */
+	ast_test_validate(test, 3 == check.published);
+	ast_test_validate(test, 3 == check.dispatched);
+
+	return AST_TEST_PASS;
+}
+
+AST_TEST_DEFINE(metrics_forward)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_topic *, aggregate, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_forward *, forward, NULL, stasis_forward_cancel);
+	RAII_VAR(struct stasis_subscription *, uut, NULL, stasis_unsubscribe);
+	RAII_VAR(char *, test_data, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message, NULL, ao2_cleanup);
+	RAII_VAR(struct consumer *, consumer, NULL, ao2_cleanup);
+	struct metrics_check check = {
+		.topic = "TestMetricsAggregateTopic",
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test the metrics of an aggregate topic";
+		info->description = "Test that messages forwarded to a topic are counted for it";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create("TestMetricsForwardedTopic");
+	ast_test_validate(test, NULL != topic);
+	aggregate = stasis_topic_create(check.topic);
+	ast_test_validate(test, NULL != aggregate);
+	forward = stasis_forward_all(topic, aggregate);
+	ast_test_validate(test, NULL != forward);
+
+	consumer = consumer_create(1);
+	ast_test_validate(test, NULL != consumer);
+
+	uut = stasis_subscribe(aggregate, consumer_exec, consumer);
+	ast_test_validate(test, NULL != uut);
+	ao2_ref(consumer, +1);
+	check.uniqueid = stasis_subscription_uniqueid(uut);
+
+	test_data = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data);
+	ast_test_validate(test, stasis_message_type_create("TestMessage", NULL, &test_message_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+	test_message = stasis_message_create(test_message_type, test_data);
+
+	stasis_publish(topic, test_message);
+	stasis_publish(topic, test_message);
+
+	ast_test_validate(test, 2 == consumer_wait_for(consumer, 2));
+
+	stasis_metrics_collect(metrics_check_topic_cb, metrics_check_subscription_cb, &check);
+
+	ast_test_validate(test, 1 == check.topics_seen);
+	ast_test_validate(test, 1 == check.subscriptions_seen);
+	/* The subscription change is published to the aggregate itself */
+	ast_test_validate(test, 3 == check.published);
+	ast_test_validate(test, 3 == check.dispatched);
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(publish_sync)
 {
 	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
@@ -1889,6 +2034,70 @@ AST_TEST_DEFINE(to_json)
 	return AST_TEST_PASS;
 }
 
+static int counting_json_calls;
+
+static struct ast_json *counting_json(struct stasis_message *message, const struct stasis_message_sanitizer *sanitize)
+{
+	ast_atomic_fetchadd_int(&counting_json_calls, +1);
+
+	return ast_json_pack("{s: s, s: {s: i}}", "data", (const char *) stasis_message_data(message),
+		"nested", "calls", counting_json_calls);
+}
+
+static struct stasis_message_vtable counting_vtable = {
+	.to_json = counting_json,
+	.to_ami = fake_ami
+};
+
+AST_TEST_DEFINE(to_json_memo)
+{
+	RAII_VAR(struct stasis_message_type *, type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, uut, NULL, ao2_cleanup);
+	RAII_VAR(char *, data, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_json *, first, NULL, ast_json_unref);
+	RAII_VAR(struct ast_json *, second, NULL, ast_json_unref);
+	RAII_VAR(struct ast_manager_event_blob *, first_ami, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_manager_event_blob *, second_ami, NULL, ao2_cleanup);
+	const char *expected_text = "SomeData";
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test that message representations are built once";
+		info->description = "Test that converting a message more than once\n"
+			"reuses the representation that was built first";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_validate(test, stasis_message_type_create("SomeMessage", &counting_vtable, &type) == STASIS_MESSAGE_TYPE_SUCCESS);
+
+	data = ao2_alloc(strlen(expected_text) + 1, NULL);
+	strcpy(data, expected_text);
+	uut = stasis_message_create(type, data);
+	ast_test_validate(test, NULL != uut);
+
+	counting_json_calls = 0;
+	first = stasis_message_to_json(uut, NULL);
+	second = stasis_message_to_json(uut, NULL);
+	ast_test_validate(test, NULL != first && NULL != second);
+	ast_test_validate(test, 1 == counting_json_calls);
+	ast_test_validate(test, ast_json_equal(first, second));
+
+	/* Each consumer may add to the object it got */
+	ast_test_validate(test, !ast_json_object_set(first, "application", ast_json_string_create("test")));
+	ast_test_validate(test, NULL == ast_json_object_get(second, "application"));
+
+	first_ami = stasis_message_to_ami(uut);
+	second_ami = stasis_message_to_ami(uut);
+	ast_test_validate(test, NULL != first_ami);
+	ast_test_validate(test, first_ami == second_ami);
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(no_to_ami)
 {
 	RAII_VAR(struct stasis_message_type *, type, NULL, ao2_cleanup);
@@ -2205,8 +2414,8 @@ static void dump_consumer(struct ast_test *test, struct cts *cts)
 	}
 }
 
-static int send_msg(struct ast_test *test, struct cts *cts, struct stasis_message_type *msg_type,
-	const char *data)
+static int send_msg_to(struct ast_test *test, struct stasis_topic *topic,
+	struct stasis_message_type *msg_type, const char *data)
 {
 	struct stasis_message *msg;
 	struct stasis_subscription_change *test_data =
@@ -2225,12 +2434,18 @@ static int send_msg(struct ast_test *test, struct cts *cts, struct stasis_messag
 		return 0;
 	}
 
-	stasis_publish(cts->topic, msg);
+	stasis_publish(topic, msg);
 	ao2_ref(msg, -1);
 
 	return 1;
 }
 
+static int send_msg(struct ast_test *test, struct cts *cts, struct stasis_message_type *msg_type,
+	const char *data)
+{
+	return send_msg_to(test, cts->topic, msg_type, data);
+}
+
 AST_TEST_DEFINE(type_filters)
 {
 	RAII_VAR(struct cts *, cts, NULL, ao2_cleanup);
@@ -2298,6 +2513,69 @@ AST_TEST_DEFINE(type_filters)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(forward_type_filters)
+{
+	RAII_VAR(struct cts *, cts, NULL, ao2_cleanup);
+	RAII_VAR(struct test_message_types *, types, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_topic *, upstream, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_forward *, forward, NULL, stasis_forward_cancel);
+	int ix = 0;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category "filtering/";
+		info->summary = "Test changing type filters of a forwarded subscription";
+		info->description = "Test that a subscription changing its type filters\n"
+			"sees the change on messages from the topics forwarding into its own";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	types = create_message_types(test);
+	ast_test_validate(test, NULL != types);
+
+	cts = create_cts(test);
+	ast_test_validate(test, NULL != cts);
+
+	upstream = stasis_topic_create("TestUpstreamTopic");
+	ast_test_validate(test, NULL != upstream);
+	forward = stasis_forward_all(upstream, cts->topic);
+	ast_test_validate(test, NULL != forward);
+
+	ast_test_validate(test, stasis_subscription_accept_message_type(cts->sub, types->type1) == 0);
+	ast_test_validate(test, stasis_subscription_accept_message_type(cts->sub, types->change) == 0);
+	ast_test_validate(test, stasis_subscription_set_filter(cts->sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE) == 0);
+
+	ast_test_validate(test, send_msg_to(test, upstream, types->type1, "Pass"));
+	ast_test_validate(test, send_msg_to(test, upstream, types->type2, "FAIL"));
+	consumer_wait_for(cts->consumer, 2);
+
+	/* Accepting type 2 must be seen by the upstream topic too */
+	ast_test_validate(test, stasis_subscription_accept_message_type(cts->sub, types->type2) == 0);
+	ast_test_validate(test, stasis_subscription_decline_message_type(cts->sub, types->type1) == 0);
+
+	ast_test_validate(test, send_msg_to(test, upstream, types->type1, "FAIL"));
+	ast_test_validate(test, send_msg_to(test, upstream, types->type2, "Pass2"));
+	consumer_wait_for(cts->consumer, 3);
+
+	stasis_unsubscribe(cts->sub);
+	cts->sub = NULL;
+	consumer_wait_for_completion(cts->consumer);
+
+	dump_consumer(test, cts);
+
+	ast_test_validate(test, 1 == cts->consumer->complete);
+	ast_test_validate(test, 4 == cts->consumer->messages_rxed_len);
+	ast_test_validate(test, is_msg(cts->consumer->messages_rxed[ix++], types->change, "Subscribe"));
+	ast_test_validate(test, is_msg(cts->consumer->messages_rxed[ix++], types->type1, "Pass"));
+	ast_test_validate(test, is_msg(cts->consumer->messages_rxed[ix++], types->type2, "Pass2"));
+	ast_test_validate(test, is_msg(cts->consumer->messages_rxed[ix++], types->change, "Unsubscribe"));
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(formatter_filters)
 {
 	RAII_VAR(struct cts *, cts, NULL, ao2_cleanup);
@@ -2441,6 +2719,8 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(subscription_pool_messages);
 	AST_TEST_UNREGISTER(publish);
 	AST_TEST_UNREGISTER(publish_sync);
+	AST_TEST_UNREGISTER(metrics);
+	AST_TEST_UNREGISTER(metrics_forward);
 	AST_TEST_UNREGISTER(publish_pool);
 	AST_TEST_UNREGISTER(unsubscribe_stops_messages);
 	AST_TEST_UNREGISTER(forward);
@@ -2455,11 +2735,13 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(subscription_interleaving);
 	AST_TEST_UNREGISTER(no_to_json);
 	AST_TEST_UNREGISTER(to_json);
+	AST_TEST_UNREGISTER(to_json_memo);
 	AST_TEST_UNREGISTER(no_to_ami);
 	AST_TEST_UNREGISTER(to_ami);
 	AST_TEST_UNREGISTER(dtor_order);
 	AST_TEST_UNREGISTER(caching_dtor_order);
 	AST_TEST_UNREGISTER(type_filters);
+	AST_TEST_UNREGISTER(forward_type_filters);
 	AST_TEST_UNREGISTER(formatter_filters);
 	AST_TEST_UNREGISTER(combo_filters);
 	return 0;
@@ -2473,6 +2755,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(subscription_pool_messages);
 	AST_TEST_REGISTER(publish);
 	AST_TEST_REGISTER(publish_sync);
+	AST_TEST_REGISTER(metrics);
+	AST_TEST_REGISTER(metrics_forward);
 	AST_TEST_REGISTER(publish_pool);
 	AST_TEST_REGISTER(unsubscribe_stops_messages);
 	AST_TEST_REGISTER(forward);
@@ -2487,11 +2771,13 @@ static int load_module(void)
 	AST_TEST_REGISTER(subscription_interleaving);
 	AST_TEST_REGISTER(no_to_json);
 	AST_TEST_REGISTER(to_json);
+	AST_TEST_REGISTER(to_json_memo);
 	AST_TEST_REGISTER(no_to_ami);
 	AST_TEST_REGISTER(to_ami);
 	AST_TEST_REGISTER(dtor_order);
 	AST_TEST_REGISTER(caching_dtor_order);
 	AST_TEST_REGISTER(type_filters);
+	AST_TEST_REGISTER(forward_type_filters);
 	AST_TEST_REGISTER(formatter_filters);
 	AST_TEST_REGISTER(combo_filters);
 	return AST_MODULE_LOAD_SUCCESS;
@@ -306,6 +306,83 @@ AST_TEST_DEFINE(channel_snapshot_json)
 	return AST_TEST_PASS;
 }
 
+/*! \brief Snapshots encoded by each path of channel_snapshot_json_writer */
+#define WRITER_ITERATIONS 10000
+
+AST_TEST_DEFINE(channel_snapshot_json_writer)
+{
+	RAII_VAR(struct ast_channel *, chan, NULL, safe_channel_release);
+	RAII_VAR(struct ast_channel_snapshot *, snapshot, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_json *, expected, NULL, ast_json_unref);
+	RAII_VAR(struct ast_json *, actual, NULL, ast_json_unref);
+	RAII_VAR(struct ast_str *, buf, NULL, ast_free);
+	struct ast_json_writer writer;
+	struct timeval start;
+	int64_t tree_us;
+	int64_t writer_us;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test streaming encoding of channel snapshots";
+		info->description = "Test that ast_channel_snapshot_to_json_writer encodes\n"
+			"what ast_channel_snapshot_to_json builds, and time both.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	buf = ast_str_create(1024);
+	ast_test_validate(test, NULL != buf);
+
+	ast_json_writer_init(&writer, &buf, AST_JSON_COMPACT);
+	ast_test_validate(test, -1 == ast_channel_snapshot_to_json_writer(NULL, NULL, &writer));
+
+	chan = ast_channel_alloc(0, AST_STATE_DOWN, "cid_num", "cid_name", "acctcode", "exten", "context", NULL, NULL, 0, "TEST/name");
+	ast_channel_unlock(chan);
+	ast_test_validate(test, NULL != chan);
+	ast_channel_lock(chan);
+	snapshot = ast_channel_snapshot_create(chan);
+	ast_channel_unlock(chan);
+	ast_test_validate(test, NULL != snapshot);
+
+	expected = ast_channel_snapshot_to_json(snapshot, NULL);
+	ast_test_validate(test, NULL != expected);
+
+	ast_str_reset(buf);
+	ast_json_writer_init(&writer, &buf, AST_JSON_COMPACT);
+	ast_test_validate(test, 0 == ast_channel_snapshot_to_json_writer(snapshot, NULL, &writer));
+	ast_test_validate(test, 0 == ast_json_writer_finish(&writer));
+	actual = ast_json_load_str(buf, NULL);
+	ast_test_validate(test, ast_json_equal(expected, actual));
+
+	start = ast_tvnow();
+	for (i = 0; i < WRITER_ITERATIONS; ++i) {
+		struct ast_json *json = ast_channel_snapshot_to_json(snapshot, NULL);
+
+		ast_str_reset(buf);
+		ast_test_validate(test, 0 == ast_json_dump_str(json, &buf));
+		ast_json_unref(json);
+	}
+	tree_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	start = ast_tvnow();
+	for (i = 0; i < WRITER_ITERATIONS; ++i) {
+		ast_str_reset(buf);
+		ast_json_writer_init(&writer, &buf, AST_JSON_COMPACT);
+		ast_channel_snapshot_to_json_writer(snapshot, NULL, &writer);
+		ast_test_validate(test, 0 == ast_json_writer_finish(&writer));
+	}
+	writer_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_test_status_update(test, "%d snapshots: tree %ld us, writer %ld us\n",
+		WRITER_ITERATIONS, (long) tree_us, (long) writer_us);
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(channel_blob_create);
@@ -313,6 +390,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(multi_channel_blob_create);
 	AST_TEST_UNREGISTER(multi_channel_blob_snapshots);
 	AST_TEST_UNREGISTER(channel_snapshot_json);
+	AST_TEST_UNREGISTER(channel_snapshot_json_writer);
 
 	return 0;
 }
@@ -324,6 +402,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(multi_channel_blob_create);
 	AST_TEST_REGISTER(multi_channel_blob_snapshots);
 	AST_TEST_REGISTER(channel_snapshot_json);
+	AST_TEST_REGISTER(channel_snapshot_json_writer);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
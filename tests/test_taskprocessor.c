@@ -427,6 +427,99 @@ test_end:
 	return res;
 }
 
+#define BATCH_SIZE 250
+
+/*!
+ * \brief Batch push test for taskprocessor with default listener
+ *
+ * This test queues a large number of tasks in batches, each with random
+ * data associated. The test ensures that all of the tasks are run and that
+ * the tasks are executed in the same order that they were queued
+ */
+AST_TEST_DEFINE(default_taskprocessor_push_batch)
+{
+	struct ast_taskprocessor *tps;
+	struct ast_taskprocessor_task tasks[BATCH_SIZE];
+	struct timeval start;
+	struct timespec ts;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int timedwait_res;
+	int i;
+	int j;
+	int rand_data[NUM_TASKS];
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "default_taskprocessor_push_batch";
+		info->category = "/main/taskprocessor/";
+		info->summary = "Batch push test of default taskproccesor";
+		info->description =
+			"Ensure that tasks queued in batches are all executed in the proper order.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	tps = ast_taskprocessor_get("test_batch", TPS_REF_DEFAULT);
+
+	if (!tps) {
+		ast_test_status_update(test, "Unable to create test taskprocessor\n");
+		return AST_TEST_FAIL;
+	}
+
+	start = ast_tvnow();
+
+	ts.tv_sec = start.tv_sec + 60;
+	ts.tv_nsec = start.tv_usec * 1000;
+
+	ast_cond_init(&load_task_results.cond, NULL);
+	ast_mutex_init(&load_task_results.lock);
+	load_task_results.tasks_completed = 0;
+
+	for (i = 0; i < NUM_TASKS; i += BATCH_SIZE) {
+		for (j = 0; j < BATCH_SIZE; ++j) {
+			rand_data[i + j] = ast_random();
+			tasks[j].task_exe = load_task;
+			tasks[j].datap = &rand_data[i + j];
+		}
+		if (ast_taskprocessor_push_batch(tps, tasks, BATCH_SIZE)) {
+			ast_test_status_update(test, "Failed to queue task batch\n");
+			res = AST_TEST_FAIL;
+			goto test_end;
+		}
+	}
+
+	ast_mutex_lock(&load_task_results.lock);
+	while (load_task_results.tasks_completed < NUM_TASKS) {
+		timedwait_res = ast_cond_timedwait(&load_task_results.cond, &load_task_results.lock, &ts);
+		if (timedwait_res == ETIMEDOUT) {
+			break;
+		}
+	}
+	ast_mutex_unlock(&load_task_results.lock);
+
+	if (load_task_results.tasks_completed != NUM_TASKS) {
+		ast_test_status_update(test, "Unexpected number of tasks executed. Expected %d but got %d\n",
+				NUM_TASKS, load_task_results.tasks_completed);
+		res = AST_TEST_FAIL;
+		goto test_end;
+	}
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		if (rand_data[i] != load_task_results.task_rand[i]) {
+			ast_test_status_update(test, "Queued tasks did not execute in order\n");
+			res = AST_TEST_FAIL;
+			goto test_end;
+		}
+	}
+
+test_end:
+	tps = ast_taskprocessor_unreference(tps);
+	ast_mutex_destroy(&load_task_results.lock);
+	ast_cond_destroy(&load_task_results.cond);
+	return res;
+}
+
 /*!
  * \brief Private data for the test taskprocessor listener
  */
@@ -544,33 +637,20 @@ static int check_stats(struct ast_test *test, const struct test_listener_pvt *pv
 }
 
 /*!
- * \brief Test for a taskprocessor with custom listener.
+ * \brief Push and execute tasks on a taskprocessor with the test listener
  *
- * This test pushes tasks to a taskprocessor with a custom listener, executes the taskss,
- * and destroys the taskprocessor.
- *
- * The test ensures that the listener's callbacks are called when expected and that the data
- * being passed in is accurate.
+ * \param test The currently-running test
+ * \param name The name to give the taskprocessor
+ * \param single_consumer Non-zero if the lock-free single consumer queue should be used
  */
-AST_TEST_DEFINE(taskprocessor_listener)
+static enum ast_test_result_state listener_test(struct ast_test *test, const char *name,
+	int single_consumer)
 {
 	struct ast_taskprocessor *tps = NULL;
 	struct ast_taskprocessor_listener *listener = NULL;
 	struct test_listener_pvt *pvt = NULL;
 	enum ast_test_result_state res = AST_TEST_PASS;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "taskprocessor_listener";
-		info->category = "/main/taskprocessor/";
-		info->summary = "Test of taskproccesor listeners";
-		info->description =
-			"Ensures that listener callbacks are called when expected.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
 	pvt = test_listener_pvt_alloc();
 	if (!pvt) {
 		ast_test_status_update(test, "Unable to allocate test taskprocessor listener user data\n");
@@ -584,7 +664,11 @@ AST_TEST_DEFINE(taskprocessor_listener)
 		goto test_exit;
 	}
 
-	tps = ast_taskprocessor_create_with_listener("test_listener", listener);
+	if (single_consumer) {
+		ast_taskprocessor_listener_set_single_consumer(listener);
+	}
+
+	tps = ast_taskprocessor_create_with_listener(name, listener);
 	if (!tps) {
 		ast_test_status_update(test, "Unable to allocate test taskprocessor\n");
 		res = AST_TEST_FAIL;
@@ -642,6 +726,55 @@ test_exit:
 	return res;
 }
 
+/*!
+ * \brief Test for a taskprocessor with custom listener.
+ *
+ * This test pushes tasks to a taskprocessor with a custom listener, executes the taskss,
+ * and destroys the taskprocessor.
+ *
+ * The test ensures that the listener's callbacks are called when expected and that the data
+ * being passed in is accurate.
+ */
+AST_TEST_DEFINE(taskprocessor_listener)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "taskprocessor_listener";
+		info->category = "/main/taskprocessor/";
+		info->summary = "Test of taskproccesor listeners";
+		info->description =
+			"Ensures that listener callbacks are called when expected.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return listener_test(test, "test_listener", 0);
+}
+
+/*!
+ * \brief Test for a single consumer taskprocessor with custom listener.
+ *
+ * Same as the taskprocessor_listener test but using the lock-free task queue.
+ */
+AST_TEST_DEFINE(taskprocessor_listener_single_consumer)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "taskprocessor_listener_single_consumer";
+		info->category = "/main/taskprocessor/";
+		info->summary = "Test of single consumer taskproccesor listeners";
+		info->description =
+			"Ensures that listener callbacks are called when expected when\n"
+			"the taskprocessor uses the lock-free task queue.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return listener_test(test, "test_listener_single_consumer", 1);
+}
+
 struct shutdown_data {
 	ast_cond_t in;
 	ast_cond_t out;
@@ -963,15 +1096,270 @@ AST_TEST_DEFINE(serializer_pool)
 	return AST_TEST_PASS;
 }
 
+#define MULTI_PRODUCER_THREADS 4
+#define MULTI_PRODUCER_TASKS 5000
+
+/*!
+ * \brief Data shared by the multiple producer load test
+ */
+static struct multi_producer_data {
+	/*! The taskprocessor the producers push to */
+	struct ast_taskprocessor *tps;
+	/*! Condition used to indicate all tasks have completed executing */
+	ast_cond_t cond;
+	/*! Lock used to protect the condition and counters */
+	ast_mutex_t lock;
+	/*! Counter of the number of completed tasks */
+	int tasks_completed;
+	/*! Last sequence number executed for each producer */
+	int last_seq[MULTI_PRODUCER_THREADS];
+	/*! Set if a producer's tasks executed out of order */
+	int out_of_order;
+	/*! Set if a producer failed to push a task */
+	int push_failed;
+	/*! Storage for task-specific data, producer in the high bits */
+	int task_data[MULTI_PRODUCER_THREADS][MULTI_PRODUCER_TASKS];
+} multi_producer_results;
+
+static int multi_producer_task(void *data)
+{
+	int value = *(int *) data;
+	int producer = value / MULTI_PRODUCER_TASKS;
+	int seq = value % MULTI_PRODUCER_TASKS;
+	SCOPED_MUTEX(lock, &multi_producer_results.lock);
+
+	if (seq != multi_producer_results.last_seq[producer] + 1) {
+		multi_producer_results.out_of_order = 1;
+	}
+	multi_producer_results.last_seq[producer] = seq;
+	if (++multi_producer_results.tasks_completed == MULTI_PRODUCER_THREADS * MULTI_PRODUCER_TASKS) {
+		ast_cond_signal(&multi_producer_results.cond);
+	}
+	return 0;
+}
+
+static void *multi_producer_thread(void *data)
+{
+	int producer = (int) (long) data;
+	int i;
+
+	for (i = 0; i < MULTI_PRODUCER_TASKS; ++i) {
+		multi_producer_results.task_data[producer][i] = producer * MULTI_PRODUCER_TASKS + i;
+		if (ast_taskprocessor_push(multi_producer_results.tps, multi_producer_task,
+			&multi_producer_results.task_data[producer][i])) {
+			ast_mutex_lock(&multi_producer_results.lock);
+			multi_producer_results.push_failed = 1;
+			ast_mutex_unlock(&multi_producer_results.lock);
+			break;
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Load test for taskprocessor with many concurrent producers
+ *
+ * Default taskprocessors use the lock-free task queue. This test pushes
+ * tasks from several threads at once and ensures that every task runs and
+ * that each producer's tasks run in the order they were pushed.
+ */
+AST_TEST_DEFINE(default_taskprocessor_multi_producer)
+{
+	pthread_t threads[MULTI_PRODUCER_THREADS];
+	struct timeval start;
+	struct timespec ts;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int started = 0;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "default_taskprocessor_multi_producer";
+		info->category = "/main/taskprocessor/";
+		info->summary = "Load test of default taskproccesor with multiple producers";
+		info->description =
+			"Ensure that tasks queued concurrently from several threads are\n"
+			"all executed and that each thread's tasks are executed in order.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	memset(&multi_producer_results, 0, sizeof(multi_producer_results));
+	for (i = 0; i < MULTI_PRODUCER_THREADS; ++i) {
+		multi_producer_results.last_seq[i] = -1;
+	}
+
+	multi_producer_results.tps = ast_taskprocessor_get("test_multi_producer", TPS_REF_DEFAULT);
+	if (!multi_producer_results.tps) {
+		ast_test_status_update(test, "Unable to create test taskprocessor\n");
+		return AST_TEST_FAIL;
+	}
+
+	ast_cond_init(&multi_producer_results.cond, NULL);
+	ast_mutex_init(&multi_producer_results.lock);
+
+	for (; started < MULTI_PRODUCER_THREADS; ++started) {
+		if (ast_pthread_create(&threads[started], NULL, multi_producer_thread,
+			(void *) (long) started)) {
+			ast_test_status_update(test, "Failed to start producer thread\n");
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+	for (i = 0; i < started; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	if (res == AST_TEST_FAIL) {
+		goto test_end;
+	}
+
+	start = ast_tvnow();
+	ts.tv_sec = start.tv_sec + 60;
+	ts.tv_nsec = start.tv_usec * 1000;
+
+	ast_mutex_lock(&multi_producer_results.lock);
+	while (multi_producer_results.tasks_completed < MULTI_PRODUCER_THREADS * MULTI_PRODUCER_TASKS) {
+		if (ast_cond_timedwait(&multi_producer_results.cond, &multi_producer_results.lock, &ts) == ETIMEDOUT) {
+			break;
+		}
+	}
+	ast_mutex_unlock(&multi_producer_results.lock);
+
+	if (multi_producer_results.push_failed) {
+		ast_test_status_update(test, "Failed to queue task\n");
+		res = AST_TEST_FAIL;
+	}
+
+	if (multi_producer_results.tasks_completed != MULTI_PRODUCER_THREADS * MULTI_PRODUCER_TASKS) {
+		ast_test_status_update(test, "Unexpected number of tasks executed. Expected %d but got %d\n",
+			MULTI_PRODUCER_THREADS * MULTI_PRODUCER_TASKS, multi_producer_results.tasks_completed);
+		res = AST_TEST_FAIL;
+	}
+
+	if (multi_producer_results.out_of_order) {
+		ast_test_status_update(test, "Queued tasks did not execute in order\n");
+		res = AST_TEST_FAIL;
+	}
+
+test_end:
+	multi_producer_results.tps = ast_taskprocessor_unreference(multi_producer_results.tps);
+	ast_mutex_destroy(&multi_producer_results.lock);
+	ast_cond_destroy(&multi_producer_results.cond);
+	return res;
+}
+
+struct metrics_result {
+	/*! Name of the taskprocessor to look for */
+	const char *name;
+	/*! Set once the taskprocessor was reported */
+	int found;
+	struct ast_taskprocessor_metrics metrics;
+};
+
+static void metrics_cb(const struct ast_taskprocessor_metrics *metrics, void *data)
+{
+	struct metrics_result *result = data;
+
+	if (!strcmp(metrics->name, result->name)) {
+		result->found = 1;
+		result->metrics = *metrics;
+		result->metrics.name = result->name;
+	}
+}
+
+/*!
+ * \brief Test the taskprocessor execution and wait histograms
+ */
+AST_TEST_DEFINE(taskprocessor_metrics)
+{
+	RAII_VAR(struct ast_taskprocessor *, tps, NULL, ast_taskprocessor_unreference);
+	RAII_VAR(struct task_data *, slow_task, NULL, ao2_cleanup);
+	RAII_VAR(struct task_data *, sync_task, NULL, ao2_cleanup);
+	struct metrics_result result = {
+		.name = "test_metrics",
+	};
+	uint64_t executed = 0;
+	uint64_t waited = 0;
+	uint64_t slow = 0;
+	int bucket;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "taskprocessor_metrics";
+		info->category = "/main/taskprocessor/";
+		info->summary = "Test of taskprocessor histograms";
+		info->description =
+			"Ensures that executed tasks are counted in the execution\n"
+			"and wait histograms of the taskprocessor.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	tps = ast_taskprocessor_get(result.name, TPS_REF_DEFAULT);
+	slow_task = task_data_create();
+	sync_task = task_data_create();
+	if (!tps || !slow_task || !sync_task) {
+		ast_test_status_update(test, "Unable to create test taskprocessor\n");
+		return AST_TEST_FAIL;
+	}
+	slow_task->wait_time = 5;
+
+	/* Tasks run in order so the first is accounted for once the second runs */
+	if (ast_taskprocessor_push(tps, task, slow_task)) {
+		ast_test_status_update(test, "Failed to queue task\n");
+		return AST_TEST_FAIL;
+	}
+	if (ast_taskprocessor_push(tps, task, sync_task)) {
+		ast_test_status_update(test, "Failed to queue task\n");
+		return AST_TEST_FAIL;
+	}
+	if (task_wait(sync_task)) {
+		ast_test_status_update(test, "Queued task did not execute!\n");
+		return AST_TEST_FAIL;
+	}
+
+	ast_taskprocessor_metrics_collect(metrics_cb, &result);
+	if (!result.found) {
+		ast_test_status_update(test, "Taskprocessor was not reported\n");
+		return AST_TEST_FAIL;
+	}
+
+	for (bucket = 0; bucket < AST_TASKPROCESSOR_HISTOGRAM_BUCKETS; ++bucket) {
+		executed += result.metrics.execution[bucket];
+		waited += result.metrics.wait[bucket];
+		/* 5 ms is more than 2^12 microseconds */
+		if (bucket > 12) {
+			slow += result.metrics.execution[bucket];
+		}
+	}
+
+	if (result.metrics.processed < 1 || executed < 1 || waited < 1) {
+		ast_test_status_update(test, "Executed task was not counted\n");
+		return AST_TEST_FAIL;
+	}
+	if (slow < 1 || result.metrics.execution_sum < 5000) {
+		ast_test_status_update(test, "Slow task was counted in the wrong bucket\n");
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	ast_test_unregister(default_taskprocessor);
 	ast_test_unregister(default_taskprocessor_load);
+	ast_test_unregister(default_taskprocessor_push_batch);
 	ast_test_unregister(subsystem_alert);
 	ast_test_unregister(taskprocessor_listener);
+	ast_test_unregister(taskprocessor_listener_single_consumer);
+	ast_test_unregister(default_taskprocessor_multi_producer);
 	ast_test_unregister(taskprocessor_shutdown);
 	ast_test_unregister(taskprocessor_push_local);
 	ast_test_unregister(serializer_pool);
+	ast_test_unregister(taskprocessor_metrics);
 	return 0;
 }
 
@@ -979,11 +1367,15 @@ static int load_module(void)
 {
 	ast_test_register(default_taskprocessor);
 	ast_test_register(default_taskprocessor_load);
+	ast_test_register(default_taskprocessor_push_batch);
 	ast_test_register(subsystem_alert);
 	ast_test_register(taskprocessor_listener);
+	ast_test_register(taskprocessor_listener_single_consumer);
+	ast_test_register(default_taskprocessor_multi_producer);
 	ast_test_register(taskprocessor_shutdown);
 	ast_test_register(taskprocessor_push_local);
 	ast_test_register(serializer_pool);
+	ast_test_register(taskprocessor_metrics);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -1511,6 +1511,93 @@ end:
 	return res;
 }
 
+AST_TEST_DEFINE(threadpool_auto_increment_batch)
+{
+	struct ast_threadpool *pool = NULL;
+	struct ast_threadpool_listener *listener = NULL;
+	struct complex_task_data *ctds[5] = { NULL, };
+	struct ast_taskprocessor_task tasks[ARRAY_LEN(ctds)];
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct test_listener_data *tld = NULL;
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = 0,
+	};
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "auto_increment_batch";
+		info->category = "/main/threadpool/";
+		info->summary = "Test that the threadpool grows for each task of a batch";
+		info->description =
+			"Create an empty threadpool and push a batch of five stalling tasks\n"
+			"to it. The threadpool should add a thread for each of them, and the\n"
+			"listener should be told of each task pushed";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	tld = test_alloc();
+	if (!tld) {
+		return AST_TEST_FAIL;
+	}
+
+	listener = ast_threadpool_listener_alloc(&test_callbacks, tld);
+	if (!listener) {
+		goto end;
+	}
+
+	pool = ast_threadpool_create(info->name, listener, &options);
+	if (!pool) {
+		goto end;
+	}
+
+	for (i = 0; i < ARRAY_LEN(ctds); ++i) {
+		ctds[i] = complex_task_data_alloc();
+		if (!ctds[i]) {
+			goto end;
+		}
+		tasks[i].task_exe = complex_task;
+		tasks[i].datap = ctds[i];
+	}
+
+	if (ast_threadpool_push_batch(pool, tasks, ARRAY_LEN(tasks))) {
+		goto end;
+	}
+
+	/* The tasks are stalled until we poke them, so each needs a thread */
+	res = wait_until_thread_state_task_pushed(test, tld, ARRAY_LEN(ctds), 0, ARRAY_LEN(ctds));
+	if (res == AST_TEST_FAIL) {
+		goto end;
+	}
+
+	for (i = 0; i < ARRAY_LEN(ctds); ++i) {
+		poke_worker(ctds[i]);
+	}
+	for (i = 0; i < ARRAY_LEN(ctds); ++i) {
+		res = wait_for_complex_completion(ctds[i]);
+		if (res == AST_TEST_FAIL) {
+			goto end;
+		}
+	}
+
+	res = wait_until_thread_state(test, tld, 0, ARRAY_LEN(ctds));
+
+end:
+	ast_threadpool_shutdown(pool);
+	ao2_cleanup(listener);
+	for (i = 0; i < ARRAY_LEN(ctds); ++i) {
+		complex_task_data_free(ctds[i]);
+	}
+	ast_free(tld);
+	return res;
+}
+
 AST_TEST_DEFINE(threadpool_more_destruction)
 {
 	struct ast_threadpool *pool = NULL;
@@ -1798,6 +1885,218 @@ end:
 	return res;
 }
 
+#define WORK_STEALING_TASKS 1000
+
+struct counting_task_data {
+	/*! Number of tasks that have executed */
+	int executed;
+	/*! Set if a task executed out of the order it was pushed in */
+	int out_of_order;
+	ast_mutex_t lock;
+	ast_cond_t cond;
+};
+
+struct counted_task {
+	struct counting_task_data *ctd;
+	/*! Expected value of executed when this task runs */
+	int sequence;
+};
+
+static struct counting_task_data *counting_task_data_alloc(void)
+{
+	struct counting_task_data *ctd = ast_calloc(1, sizeof(*ctd));
+
+	if (!ctd) {
+		return NULL;
+	}
+	ast_mutex_init(&ctd->lock);
+	ast_cond_init(&ctd->cond, NULL);
+	return ctd;
+}
+
+static void counting_task_data_free(struct counting_task_data *ctd)
+{
+	if (!ctd) {
+		return;
+	}
+
+	ast_mutex_destroy(&ctd->lock);
+	ast_cond_destroy(&ctd->cond);
+
+	ast_free(ctd);
+}
+
+static int counted_task(void *data)
+{
+	struct counted_task *task = data;
+	struct counting_task_data *ctd = task->ctd;
+	SCOPED_MUTEX(lock, &ctd->lock);
+
+	if (task->sequence != ctd->executed) {
+		ctd->out_of_order = 1;
+	}
+	++ctd->executed;
+	ast_cond_signal(&ctd->cond);
+	return 0;
+}
+
+static enum ast_test_result_state wait_for_counted_tasks(struct ast_test *test,
+	struct counting_task_data *ctd, int expected)
+{
+	struct timeval start = ast_tvnow();
+	struct timespec end = {
+		.tv_sec = start.tv_sec + 5,
+		.tv_nsec = start.tv_usec * 1000
+	};
+	SCOPED_MUTEX(lock, &ctd->lock);
+
+	while (ctd->executed < expected) {
+		if (ast_cond_timedwait(&ctd->cond, lock, &end) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	if (ctd->executed != expected) {
+		ast_test_status_update(test, "Expected %d tasks to execute but %d did\n",
+			expected, ctd->executed);
+		return AST_TEST_FAIL;
+	}
+	return AST_TEST_PASS;
+}
+
+AST_TEST_DEFINE(threadpool_work_stealing)
+{
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct ast_threadpool *pool = NULL;
+	struct counting_task_data *ctd = NULL;
+	struct counted_task *tasks = NULL;
+	int i;
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = 4,
+		.max_size = 0,
+		.work_stealing = 1,
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "threadpool_work_stealing";
+		info->category = "/main/threadpool/";
+		info->summary = "Test work-stealing threadpool task execution";
+		info->description =
+			"Push a large number of tasks into a work-stealing threadpool\n"
+			"and ensure that every one of them is executed.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	pool = ast_threadpool_create(info->name, NULL, &options);
+	ctd = counting_task_data_alloc();
+	tasks = ast_calloc(WORK_STEALING_TASKS, sizeof(*tasks));
+	if (!pool || !ctd || !tasks) {
+		ast_test_status_update(test, "Allocation failed\n");
+		goto end;
+	}
+
+	for (i = 0; i < WORK_STEALING_TASKS; ++i) {
+		tasks[i].ctd = ctd;
+		if (ast_threadpool_push(pool, counted_task, &tasks[i])) {
+			ast_test_status_update(test, "Failed to push task %d\n", i);
+			goto end;
+		}
+	}
+
+	res = wait_for_counted_tasks(test, ctd, WORK_STEALING_TASKS);
+	if (res == AST_TEST_FAIL) {
+		goto end;
+	}
+
+	if (ast_threadpool_queue_size(pool)) {
+		ast_test_status_update(test, "Expected an empty queue but %ld tasks remain\n",
+			ast_threadpool_queue_size(pool));
+		res = AST_TEST_FAIL;
+	}
+
+end:
+	ast_threadpool_shutdown(pool);
+	counting_task_data_free(ctd);
+	ast_free(tasks);
+	return res;
+}
+
+AST_TEST_DEFINE(threadpool_work_stealing_serializer)
+{
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct ast_threadpool *pool = NULL;
+	struct ast_taskprocessor *uut = NULL;
+	struct counting_task_data *ctd = NULL;
+	struct counted_task *tasks = NULL;
+	int i;
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = 4,
+		.max_size = 0,
+		.work_stealing = 1,
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "threadpool_work_stealing_serializer";
+		info->category = "/main/threadpool/";
+		info->summary = "Test serializers on a work-stealing threadpool";
+		info->description =
+			"Ensures that tasks enqueued to a serializer running on a\n"
+			"work-stealing threadpool execute in sequence.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	pool = ast_threadpool_create(info->name, NULL, &options);
+	if (!pool) {
+		ast_test_status_update(test, "Could not create threadpool\n");
+		goto end;
+	}
+	uut = ast_threadpool_serializer("ws_ser1", pool);
+	ctd = counting_task_data_alloc();
+	tasks = ast_calloc(WORK_STEALING_TASKS, sizeof(*tasks));
+	if (!uut || !ctd || !tasks) {
+		ast_test_status_update(test, "Allocation failed\n");
+		goto end;
+	}
+
+	for (i = 0; i < WORK_STEALING_TASKS; ++i) {
+		tasks[i].ctd = ctd;
+		tasks[i].sequence = i;
+		if (ast_taskprocessor_push(uut, counted_task, &tasks[i])) {
+			ast_test_status_update(test, "Failed to push task %d\n", i);
+			goto end;
+		}
+	}
+
+	res = wait_for_counted_tasks(test, ctd, WORK_STEALING_TASKS);
+	if (res == AST_TEST_FAIL) {
+		goto end;
+	}
+
+	if (ctd->out_of_order) {
+		ast_test_status_update(test, "Serializer tasks executed out of order\n");
+		res = AST_TEST_FAIL;
+	}
+
+end:
+	ast_taskprocessor_unreference(uut);
+	ast_threadpool_shutdown(pool);
+	counting_task_data_free(ctd);
+	ast_free(tasks);
+	return res;
+}
+
 static int unload_module(void)
 {
 	ast_test_unregister(threadpool_push);
@@ -1813,9 +2112,12 @@ static int unload_module(void)
 	ast_test_unregister(threadpool_max_size);
 	ast_test_unregister(threadpool_reactivation);
 	ast_test_unregister(threadpool_task_distribution);
+	ast_test_unregister(threadpool_auto_increment_batch);
 	ast_test_unregister(threadpool_more_destruction);
 	ast_test_unregister(threadpool_serializer);
 	ast_test_unregister(threadpool_serializer_dupe);
+	ast_test_unregister(threadpool_work_stealing);
+	ast_test_unregister(threadpool_work_stealing_serializer);
 	return 0;
 }
 
@@ -1834,9 +2136,12 @@ static int load_module(void)
 	ast_test_register(threadpool_max_size);
 	ast_test_register(threadpool_reactivation);
 	ast_test_register(threadpool_task_distribution);
+	ast_test_register(threadpool_auto_increment_batch);
 	ast_test_register(threadpool_more_destruction);
 	ast_test_register(threadpool_serializer);
 	ast_test_register(threadpool_serializer_dupe);
+	ast_test_register(threadpool_work_stealing);
+	ast_test_register(threadpool_work_stealing_serializer);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -29,6 +29,7 @@
 #include "asterisk/test.h"
 #include "asterisk/uuid.h"
 #include "asterisk/module.h"
+#include "asterisk/time.h"
 
 AST_TEST_DEFINE(uuid)
 {
@@ -137,8 +138,72 @@ end:
 	return res;
 }
 
+#define RANDOM_UUIDS 10000
+
+static int uuid_str_cmp(const void *left, const void *right)
+{
+	return strcmp(left, right);
+}
+
+AST_TEST_DEFINE(uuid_random)
+{
+	char (*uuids)[AST_UUID_STR_LEN];
+	struct timeval start;
+	int64_t elapsed;
+	int i;
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "uuid_random";
+		info->category = "/main/uuid/";
+		info->summary = "Random UUID generation test";
+		info->description =
+			"This tests that generated UUIDs are version 4 UUIDs which\n"
+			"do not repeat, and reports how fast they are generated";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	uuids = ast_malloc(sizeof(*uuids) * RANDOM_UUIDS);
+	if (!uuids) {
+		return AST_TEST_FAIL;
+	}
+
+	start = ast_tvnow();
+	for (i = 0; i < RANDOM_UUIDS; ++i) {
+		ast_uuid_generate_str(uuids[i], sizeof(uuids[i]));
+	}
+	elapsed = ast_tvdiff_us(ast_tvnow(), start);
+	ast_test_status_update(test, "Generated %d UUIDs in %" PRId64 " microseconds\n",
+		RANDOM_UUIDS, elapsed);
+
+	for (i = 0; i < RANDOM_UUIDS; ++i) {
+		if (uuids[i][14] != '4' || !strchr("89ab", uuids[i][19])) {
+			ast_test_status_update(test, "UUID %s is not a version 4 UUID\n", uuids[i]);
+			res = AST_TEST_FAIL;
+			goto end;
+		}
+	}
+
+	qsort(uuids, RANDOM_UUIDS, sizeof(*uuids), uuid_str_cmp);
+	for (i = 1; i < RANDOM_UUIDS; ++i) {
+		if (!strcmp(uuids[i - 1], uuids[i])) {
+			ast_test_status_update(test, "UUID %s was generated twice\n", uuids[i]);
+			res = AST_TEST_FAIL;
+			goto end;
+		}
+	}
+
+end:
+	ast_free(uuids);
+	return res;
+}
+
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(uuid_random);
 	AST_TEST_UNREGISTER(uuid);
 	return 0;
 }
@@ -146,6 +211,7 @@ static int unload_module(void)
 static int load_module(void)
 {
 	AST_TEST_REGISTER(uuid);
+	AST_TEST_REGISTER(uuid_random);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 